@@ -0,0 +1,410 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the latency and the bandwidth of the collective operators over
+// a range of message sizes. Every process of the benchmark runs the same
+// command with its own --rank, the processes meet through a file or a redis
+// store handler. With --engine=nccl, a single process benchmarks the NCCL
+// operators between --num_gpus local GPUs.
+//
+// Rank 0 prints one JSON object per line for every collective, algorithm,
+// data type and size, with the percentiles of the latency of the iterations
+// and the algorithm and bus bandwidths, as in nccl-tests. The bus bandwidth
+// scales the algorithm bandwidth by the share of the data every link
+// carries, to compare it between collectives and world sizes.
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(engine, "gloo", "Collective engine, gloo or nccl.");
+CAFFE2_DEFINE_string(device, "cpu", "Device of the tensors, cpu or cuda.");
+CAFFE2_DEFINE_int(rank, 0, "Rank of this process.");
+CAFFE2_DEFINE_int(size, 1, "Number of processes.");
+CAFFE2_DEFINE_int(num_gpus, 1, "Number of local GPUs with the nccl engine.");
+CAFFE2_DEFINE_string(store_handler, "file", "Store handler, file or redis.");
+CAFFE2_DEFINE_string(file_store_path, "", "Directory of the file store.");
+CAFFE2_DEFINE_string(redis_host, "", "Host of the redis store.");
+CAFFE2_DEFINE_int(redis_port, 6379, "Port of the redis store.");
+CAFFE2_DEFINE_string(
+    prefix,
+    "collective_benchmark",
+    "Prefix of the keys of the store, unique for every run.");
+CAFFE2_DEFINE_string(transport, "tcp", "Transport of the gloo common world.");
+CAFFE2_DEFINE_string(interface, "", "Network interface of the transport.");
+CAFFE2_DEFINE_string(
+    collectives,
+    "allreduce,reduce_scatter,allgather,broadcast",
+    "Comma separated list of collectives to benchmark.");
+CAFFE2_DEFINE_string(
+    algorithms,
+    "halving_doubling,ring,ring_chunked",
+    "Comma separated list of algorithms of the gloo allreduce.");
+CAFFE2_DEFINE_string(
+    dtypes,
+    "float,float16",
+    "Comma separated list of data types, float or float16.");
+CAFFE2_DEFINE_int64(min_bytes, 1024, "Smallest message size.");
+CAFFE2_DEFINE_int64(max_bytes, 64 << 20, "Largest message size.");
+CAFFE2_DEFINE_int(size_factor, 2, "Ratio between two message sizes.");
+CAFFE2_DEFINE_int(warmup, 5, "Number of untimed iterations per size.");
+CAFFE2_DEFINE_int(iterations, 20, "Number of timed iterations per size.");
+
+namespace caffe2 {
+namespace {
+
+const char kCommonWorld[] = "common_world";
+
+struct Result {
+  string collective;
+  string algorithm;
+  string dtype;
+  int64_t bytes;
+  std::vector<float> latencies_us;
+};
+
+DeviceOption GetDeviceOption(int gpu_id) {
+  DeviceOption option;
+  if (FLAGS_engine == "nccl" || FLAGS_device == "cuda") {
+    option.set_device_type(CUDA);
+    option.set_cuda_gpu_id(gpu_id);
+  }
+  return option;
+}
+
+// Number of devices taking part in a collective
+int WorldSize() {
+  return FLAGS_engine == "nccl" ? FLAGS_num_gpus : FLAGS_size;
+}
+
+void RunOnce(Workspace* ws, const OperatorDef& def) {
+  CAFFE_ENFORCE(ws->RunOperatorOnce(def), "Failed to run ", def.type());
+}
+
+void CreateCommonWorld(Workspace* ws) {
+  if (FLAGS_store_handler == "file") {
+    CAFFE_ENFORCE(!FLAGS_file_store_path.empty(), "--file_store_path is empty");
+    RunOnce(
+        ws,
+        CreateOperatorDef(
+            "FileStoreHandlerCreate",
+            "",
+            std::vector<string>{},
+            std::vector<string>{"store_handler"},
+            std::vector<Argument>{
+                MakeArgument<string>("path", FLAGS_file_store_path),
+                MakeArgument<string>("prefix", FLAGS_prefix)}));
+  } else if (FLAGS_store_handler == "redis") {
+    CAFFE_ENFORCE(!FLAGS_redis_host.empty(), "--redis_host is empty");
+    RunOnce(
+        ws,
+        CreateOperatorDef(
+            "RedisStoreHandlerCreate",
+            "",
+            std::vector<string>{},
+            std::vector<string>{"store_handler"},
+            std::vector<Argument>{
+                MakeArgument<string>("host", FLAGS_redis_host),
+                MakeArgument<int>("port", FLAGS_redis_port),
+                MakeArgument<string>("prefix", FLAGS_prefix)}));
+  } else {
+    CAFFE_THROW("Unknown store handler: ", FLAGS_store_handler);
+  }
+  RunOnce(
+      ws,
+      CreateOperatorDef(
+          "CreateCommonWorld",
+          "",
+          std::vector<string>{"store_handler"},
+          std::vector<string>{kCommonWorld},
+          std::vector<Argument>{
+              MakeArgument<int>("size", FLAGS_size),
+              MakeArgument<int>("rank", FLAGS_rank),
+              MakeArgument<string>("transport", FLAGS_transport),
+              MakeArgument<string>("interface", FLAGS_interface)},
+          GetDeviceOption(0),
+          "GLOO"));
+}
+
+// Fills blob with count zeros of dtype, the collectives keep them at zero
+void Fill(
+    Workspace* ws,
+    const string& blob,
+    int64_t count,
+    const string& dtype,
+    int gpu_id) {
+  const auto option = GetDeviceOption(gpu_id);
+  const string fill_blob = dtype == "float16" ? blob + "_float" : blob;
+  RunOnce(
+      ws,
+      CreateOperatorDef(
+          "ConstantFill",
+          "",
+          std::vector<string>{},
+          std::vector<string>{fill_blob},
+          std::vector<Argument>{
+              MakeArgument<std::vector<int64_t>>("shape", {count}),
+              MakeArgument<float>("value", 0.0f)},
+          option));
+  if (dtype == "float16") {
+    RunOnce(
+        ws,
+        CreateOperatorDef(
+            "FloatToHalf",
+            "",
+            std::vector<string>{fill_blob},
+            std::vector<string>{blob},
+            option));
+  }
+}
+
+string BlobName(int gpu_id) {
+  return "X_" + caffe2::to_string(gpu_id);
+}
+
+// Creates the inputs of the collective on count elements and returns the
+// operator running it. As in nccl-tests, count is the size of the gathered
+// tensor for allgather and of the scattered one for reduce_scatter.
+OperatorDef PrepareCollective(
+    Workspace* ws,
+    const string& collective,
+    const string& algorithm,
+    const string& dtype,
+    int64_t count) {
+  const int world_size = WorldSize();
+  const bool gather = collective == "allgather";
+  std::vector<string> inputs;
+  std::vector<string> outputs;
+  std::vector<Argument> args;
+  if (FLAGS_engine == "gloo") {
+    inputs.push_back(kCommonWorld);
+  }
+  const int num_devices = FLAGS_engine == "nccl" ? FLAGS_num_gpus : 1;
+  for (int i = 0; i < num_devices; ++i) {
+    const auto blob = BlobName(i);
+    Fill(ws, blob, gather ? count / world_size : count, dtype, i);
+    inputs.push_back(blob);
+    outputs.push_back(gather ? blob + "_gathered" : blob);
+  }
+
+  string type;
+  if (FLAGS_engine == "nccl") {
+    const std::map<string, string> types = {{"allreduce", "NCCLAllreduce"},
+                                            {"reduce_scatter",
+                                             "NCCLReduceScatter"},
+                                            {"allgather", "NCCLAllGather"},
+                                            {"broadcast", "NCCLBroadcast"}};
+    type = types.at(collective);
+    if (collective == "reduce_scatter") {
+      for (auto& output : outputs) {
+        output += "_scattered";
+      }
+    }
+    return CreateOperatorDef(
+        type, "", inputs, outputs, args, GetDeviceOption(0));
+  }
+
+  if (collective == "allreduce") {
+    type = "Allreduce";
+    args.push_back(MakeArgument<string>("algorithm", algorithm));
+  } else if (collective == "reduce_scatter") {
+    type = "ReduceScatter";
+    // Every rank gets an equal share of the elements
+    RunOnce(
+        ws,
+        CreateOperatorDef(
+            "ConstantFill",
+            "",
+            std::vector<string>{},
+            std::vector<string>{"recv_counts"},
+            std::vector<Argument>{
+                MakeArgument<std::vector<int64_t>>("shape", {world_size}),
+                MakeArgument<int>("dtype", TensorProto::INT32),
+                MakeArgument<int>("value", count / world_size)}));
+    inputs.push_back("recv_counts");
+    outputs.push_back("recv_counts");
+  } else if (collective == "allgather") {
+    type = "Allgather";
+  } else if (collective == "broadcast") {
+    type = "Broadcast";
+    args.push_back(MakeArgument<int>("root", 0));
+  } else {
+    CAFFE_THROW("Unknown collective: ", collective);
+  }
+  return CreateOperatorDef(
+      type, "", inputs, outputs, args, GetDeviceOption(0), "GLOO");
+}
+
+Result Benchmark(
+    Workspace* ws,
+    const string& collective,
+    const string& algorithm,
+    const string& dtype,
+    int64_t bytes) {
+  const int itemsize = dtype == "float16" ? 2 : 4;
+  const int world_size = WorldSize();
+  // The gathered and the scattered tensors split evenly between the devices
+  int64_t count = std::max<int64_t>(bytes / itemsize, 1);
+  if (collective == "allgather" || collective == "reduce_scatter") {
+    count = std::max<int64_t>(count / world_size, 1) * world_size;
+  }
+  Result result{collective, algorithm, dtype, count * itemsize, {}};
+
+  const auto def = PrepareCollective(ws, collective, algorithm, dtype, count);
+  auto op = CreateOperator(def, ws);
+  std::unique_ptr<OperatorBase> barrier;
+  if (FLAGS_engine == "gloo") {
+    barrier = CreateOperator(
+        CreateOperatorDef(
+            "Barrier",
+            "",
+            std::vector<string>{kCommonWorld},
+            std::vector<string>{},
+            DeviceOption(),
+            "GLOO"),
+        ws);
+  }
+  for (int i = 0; i < FLAGS_warmup + FLAGS_iterations; ++i) {
+    // All the ranks start the iteration together, the latency does not
+    // include the time waiting for the slowest rank
+    if (barrier) {
+      CAFFE_ENFORCE(barrier->Run());
+    }
+    Timer timer;
+    CAFFE_ENFORCE(op->Run(), "Failed to run ", def.type());
+    const float latency_us = timer.MicroSeconds();
+    if (i >= FLAGS_warmup) {
+      result.latencies_us.push_back(latency_us);
+    }
+  }
+  return result;
+}
+
+float Percentile(const std::vector<float>& sorted, float percentile) {
+  const auto index = std::min<size_t>(
+      sorted.size() - 1,
+      static_cast<size_t>(percentile / 100.0f * sorted.size()));
+  return sorted[index];
+}
+
+void Report(const Result& result) {
+  auto sorted = result.latencies_us;
+  std::sort(sorted.begin(), sorted.end());
+  const int world_size = WorldSize();
+  // Bytes every link carries for every byte of the message
+  float bus_factor = 1.0f;
+  if (result.collective == "allreduce") {
+    bus_factor = 2.0f * (world_size - 1) / world_size;
+  } else if (
+      result.collective == "reduce_scatter" ||
+      result.collective == "allgather") {
+    bus_factor = static_cast<float>(world_size - 1) / world_size;
+  }
+  const float median_us = Percentile(sorted, 50);
+  // Bytes per microsecond are MB/s, reported in GB/s
+  const float algbw_gbps = result.bytes / median_us / 1e3f;
+  printf(
+      "{\"engine\": \"%s\", \"collective\": \"%s\", \"algorithm\": \"%s\", "
+      "\"dtype\": \"%s\", \"world_size\": %d, \"bytes\": %lld, "
+      "\"iterations\": %zu, \"latency_us\": {\"min\": %.2f, \"p50\": %.2f, "
+      "\"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}, "
+      "\"algbw_gbps\": %.4f, \"busbw_gbps\": %.4f}\n",
+      FLAGS_engine.c_str(),
+      result.collective.c_str(),
+      result.algorithm.c_str(),
+      result.dtype.c_str(),
+      world_size,
+      static_cast<long long>(result.bytes),
+      sorted.size(),
+      sorted.front(),
+      median_us,
+      Percentile(sorted, 90),
+      Percentile(sorted, 99),
+      sorted.back(),
+      algbw_gbps,
+      algbw_gbps * bus_factor);
+  fflush(stdout);
+}
+
+// Whether the engine has the collective on the device
+bool IsSupported(const string& collective) {
+  if (FLAGS_engine == "nccl" || FLAGS_device == "cpu") {
+    return true;
+  }
+  // The gloo reduce_scatter and allgather only take CPU tensors
+  return collective == "allreduce" || collective == "broadcast";
+}
+
+void RunBenchmark() {
+  CAFFE_ENFORCE(
+      FLAGS_engine == "gloo" || FLAGS_engine == "nccl",
+      "Unknown engine: ",
+      FLAGS_engine);
+  CAFFE_ENFORCE_GT(FLAGS_iterations, 0);
+  CAFFE_ENFORCE_GT(FLAGS_size_factor, 1);
+  CAFFE_ENFORCE_GT(FLAGS_min_bytes, 0);
+
+  Workspace ws;
+  if (FLAGS_engine == "gloo") {
+    CreateCommonWorld(&ws);
+  }
+  const bool print = FLAGS_engine == "nccl" || FLAGS_rank == 0;
+  for (const auto& collective : split(',', FLAGS_collectives)) {
+    if (!IsSupported(collective)) {
+      LOG(WARNING) << "Skipping " << collective << " on " << FLAGS_device;
+      continue;
+    }
+    // The other collectives have a single algorithm
+    std::vector<string> algorithms{FLAGS_engine};
+    if (FLAGS_engine == "gloo" && collective == "allreduce") {
+      algorithms = split(',', FLAGS_algorithms);
+    }
+    for (const auto& algorithm : algorithms) {
+      for (const auto& dtype : split(',', FLAGS_dtypes)) {
+        CAFFE_ENFORCE(
+            dtype == "float" || dtype == "float16", "Unknown dtype: ", dtype);
+        for (int64_t bytes = FLAGS_min_bytes; bytes <= FLAGS_max_bytes;
+             bytes *= FLAGS_size_factor) {
+          const auto result =
+              Benchmark(&ws, collective, algorithm, dtype, bytes);
+          if (print) {
+            Report(result);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::RunBenchmark();
+  return 0;
+}
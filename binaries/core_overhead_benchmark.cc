@@ -18,7 +18,11 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/core/event.h"
+#include "caffe2/core/net.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/queue/blobs_queue.h"
+#include "caffe2/utils/proto_utils.h"
 
 #define CAFFE2_SKIP_IF_NO_GPU                                      \
   if (!caffe2::NumCudaDevices()) {                                 \
@@ -220,4 +224,188 @@ static void BM_TensorAllocDeallocCUDA(benchmark::State& state) {
 }
 BENCHMARK(BM_TensorAllocDeallocCUDA);
 
+static void BM_GetSingleArgument(benchmark::State& state) {
+  // An operator with state.range(0) arguments, looking up the last one
+  OperatorDef def;
+  Workspace ws;
+  def.set_type("DummyEmpty");
+  for (int i = 0; i < state.range(0); ++i) {
+    def.add_arg()->CopyFrom(MakeArgument("arg" + caffe2::to_string(i), i));
+  }
+  const string name = "arg" + caffe2::to_string(state.range(0) - 1);
+  auto op = CreateOperator(def, &ws);
+  while (state.KeepRunning()) {
+    volatile int value = op->GetSingleArgument<int>(name, 0);
+  }
+}
+BENCHMARK(BM_GetSingleArgument)->Arg(1)->Arg(8)->Arg(32);
+
+static void BM_WorkspaceGetBlob(benchmark::State& state) {
+  Workspace ws;
+  for (int i = 0; i < state.range(0); ++i) {
+    ws.CreateBlob("blob" + caffe2::to_string(i));
+  }
+  const string name = "blob" + caffe2::to_string(state.range(0) / 2);
+  while (state.KeepRunning()) {
+    volatile Blob* blob = ws.GetBlob(name);
+  }
+}
+BENCHMARK(BM_WorkspaceGetBlob)->Arg(16)->Arg(1024);
+
+static void BM_WorkspaceGetBlobFromParent(benchmark::State& state) {
+  Workspace parent;
+  parent.CreateBlob("shared");
+  Workspace ws(&parent);
+  while (state.KeepRunning()) {
+    volatile Blob* blob = ws.GetBlob("shared");
+  }
+}
+BENCHMARK(BM_WorkspaceGetBlobFromParent);
+
+static void BM_WorkspaceCreateBlobExisting(benchmark::State& state) {
+  Workspace ws;
+  ws.CreateBlob("blob");
+  while (state.KeepRunning()) {
+    volatile Blob* blob = ws.CreateBlob("blob");
+  }
+}
+BENCHMARK(BM_WorkspaceCreateBlobExisting);
+
+static void BM_WorkspaceCreateRemoveBlob(benchmark::State& state) {
+  Workspace ws;
+  while (state.KeepRunning()) {
+    ws.CreateBlob("blob");
+    ws.RemoveBlob("blob");
+  }
+}
+BENCHMARK(BM_WorkspaceCreateRemoveBlob);
+
+static void BM_TensorResizeWithinCapacityCPU(benchmark::State& state) {
+  Tensor<CPUContext> tensor;
+  tensor.Resize(64, 64);
+  tensor.mutable_data<float>();
+  int i = 0;
+  while (state.KeepRunning()) {
+    // Shrinking keeps the memory, so that no resize reallocates
+    tensor.Resize(32 + (i++ % 32), 64);
+    CHECK(tensor.mutable_data<float>());
+  }
+}
+BENCHMARK(BM_TensorResizeWithinCapacityCPU);
+
+static void BM_TensorResizeReallocCPU(benchmark::State& state) {
+  // Without keep_on_shrink, every change of size reallocates
+  const bool keep_on_shrink = FLAGS_caffe2_keep_on_shrink;
+  FLAGS_caffe2_keep_on_shrink = false;
+  Tensor<CPUContext> tensor;
+  int i = 0;
+  while (state.KeepRunning()) {
+    tensor.Resize(32 + (i++ % 2) * 32, 64);
+    CHECK(tensor.mutable_data<float>());
+  }
+  FLAGS_caffe2_keep_on_shrink = keep_on_shrink;
+}
+BENCHMARK(BM_TensorResizeReallocCPU);
+
+static void BM_EventRecordWaitCPU(benchmark::State& state) {
+  DeviceOption option;
+  option.set_device_type(CPU);
+  CPUContext context(option);
+  Event event(option);
+  while (state.KeepRunning()) {
+    event.Reset();
+    event.Record(CPU, &context);
+    event.SetFinished();
+    event.Wait(CPU, &context);
+  }
+}
+BENCHMARK(BM_EventRecordWaitCPU);
+
+static void BM_EventRecordWaitCUDA(benchmark::State& state) {
+  CAFFE2_SKIP_IF_NO_GPU;
+  DeviceOption option;
+  option.set_device_type(CUDA);
+  CUDAContext context(option);
+  Event event(option);
+  while (state.KeepRunning()) {
+    event.Reset();
+    event.Record(CUDA, &context);
+    event.Wait(CUDA, &context);
+  }
+}
+BENCHMARK(BM_EventRecordWaitCUDA);
+
+namespace {
+// A net of state.range(0) empty operators, either chained one after the
+// other, or all reading the same input in a wide fan
+NetDef EmptyNet(const string& type, int num_ops, bool fan) {
+  NetDef net;
+  net.set_name("overhead_" + type);
+  net.set_type(type);
+  net.set_num_workers(4);
+  for (int i = 0; i < num_ops; ++i) {
+    auto* op = net.add_op();
+    op->set_type("DummyEmpty");
+    op->add_input(fan ? "in" : "blob" + caffe2::to_string(i));
+    op->add_output("blob" + caffe2::to_string(i + 1));
+  }
+  net.add_external_input(fan ? "in" : "blob0");
+  return net;
+}
+
+void NetRun(benchmark::State& state, const string& type, bool fan) {
+  Workspace ws;
+  ws.CreateBlob(fan ? "in" : "blob0");
+  auto net = CreateNet(EmptyNet(type, state.range(0), fan), &ws);
+  CHECK(net);
+  while (state.KeepRunning()) {
+    CHECK(net->Run());
+  }
+  // The items per second are the operators run per second
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+} // namespace
+
+static void BM_NetRunChain(benchmark::State& state, const string& type) {
+  NetRun(state, type, false);
+}
+BENCHMARK_CAPTURE(BM_NetRunChain, simple, string("simple"))
+    ->Arg(1)
+    ->Arg(64);
+BENCHMARK_CAPTURE(BM_NetRunChain, dag, string("dag"))->Arg(1)->Arg(64);
+BENCHMARK_CAPTURE(BM_NetRunChain, async_scheduling, string("async_scheduling"))
+    ->Arg(1)
+    ->Arg(64);
+
+static void BM_NetRunFan(benchmark::State& state, const string& type) {
+  NetRun(state, type, true);
+}
+BENCHMARK_CAPTURE(BM_NetRunFan, simple, string("simple"))->Arg(64);
+BENCHMARK_CAPTURE(BM_NetRunFan, dag, string("dag"))->Arg(64);
+BENCHMARK_CAPTURE(BM_NetRunFan, async_scheduling, string("async_scheduling"))
+    ->Arg(64);
+
+static void BM_BlobsQueueWriteRead(benchmark::State& state) {
+  Workspace ws;
+  const int num_blobs = state.range(0);
+  auto queue = std::make_shared<BlobsQueue>(
+      &ws, "queue", 16, num_blobs, false /* enforceUniqueName */);
+  vector<Blob*> inputs, outputs;
+  for (int i = 0; i < num_blobs; ++i) {
+    auto* input = ws.CreateBlob("in" + caffe2::to_string(i));
+    input->GetMutable<TensorCPU>()->Resize(16);
+    input->GetMutable<TensorCPU>()->mutable_data<float>();
+    inputs.push_back(input);
+    outputs.push_back(ws.CreateBlob("out" + caffe2::to_string(i)));
+  }
+  while (state.KeepRunning()) {
+    // The read swaps the blobs, so that the written ones alternate
+    CHECK(queue->blockingWrite(inputs));
+    CHECK(queue->blockingRead(outputs));
+    std::swap(inputs, outputs);
+  }
+  queue->close();
+}
+BENCHMARK(BM_BlobsQueueWriteRead)->Arg(1)->Arg(4);
+
 BENCHMARK_MAIN()
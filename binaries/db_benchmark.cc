@@ -0,0 +1,458 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A suite of db read benchmarks, telling apart the cost of the storage, of
+// the cursor interfaces and of decoding in the input operators. Without
+// --input_db, it runs on synthetic minidbs of TensorProtos records written
+// to --tmp_dir.
+//
+// Example:
+//   db_benchmark --input_db=/data/train_lmdb --input_db_type=lmdb
+//       --benchmarks=sequential,random,batched,prefetch --json=true
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(input_db, "", "The input db, synthetic if empty.");
+CAFFE2_DEFINE_string(input_db_type, "", "The input db type.");
+CAFFE2_DEFINE_string(
+    shards,
+    "",
+    "Source of a sharded db for the sharded benchmark, e.g. "
+    "\"leveldb:/data/train_split_*\". Synthetic shards are used without "
+    "--input_db.");
+CAFFE2_DEFINE_string(
+    image_db,
+    "",
+    "A db of encoded images for the image_input benchmark.");
+CAFFE2_DEFINE_string(image_db_type, "leveldb", "The type of --image_db.");
+CAFFE2_DEFINE_string(
+    benchmarks,
+    "sequential,random,batched,reader,prefetch,sharded,record_sizes,"
+    "tensor_protos_input,image_input",
+    "Comma separated benchmarks to run. Benchmarks that don't apply to the "
+    "input (e.g. random on dbs without seeking) are skipped.");
+CAFFE2_DEFINE_int(records, 10000, "Number of records read per benchmark.");
+CAFFE2_DEFINE_int(repeat, 3, "Number of runs of every benchmark.");
+CAFFE2_DEFINE_int(batch_size, 64, "Batch size of the batched benchmarks.");
+CAFFE2_DEFINE_int(prefetch, 256, "Records read ahead in prefetch.");
+CAFFE2_DEFINE_int(num_read_threads, 4, "Threads sharing one DBReader.");
+CAFFE2_DEFINE_int(record_size, 4096, "Bytes per synthetic record.");
+CAFFE2_DEFINE_string(
+    record_sizes,
+    "64,1024,16384,262144",
+    "Synthetic record sizes of the record_sizes benchmark.");
+CAFFE2_DEFINE_int(synthetic_shards, 4, "Number of synthetic shards.");
+CAFFE2_DEFINE_string(tmp_dir, "/tmp", "Where synthetic dbs are written.");
+CAFFE2_DEFINE_int(crop, 224, "Crop size of the image_input benchmark.");
+CAFFE2_DEFINE_int(decode_threads, 4, "Decode threads of image_input.");
+CAFFE2_DEFINE_bool(json, false, "If true, print the results as JSON.");
+
+namespace caffe2 {
+namespace {
+
+struct Result {
+  string benchmark;
+  string params;
+  int64_t records;
+  int64_t bytes;
+  double seconds;
+};
+
+std::vector<Result> results;
+
+void Report(
+    const string& benchmark,
+    const string& params,
+    int64_t records,
+    int64_t bytes,
+    double seconds) {
+  results.push_back(Result{benchmark, params, records, bytes, seconds});
+  if (!FLAGS_json) {
+    printf(
+        "%-20s %-28s %10.0f records/s %10.2f MB/s\n",
+        benchmark.c_str(),
+        params.c_str(),
+        records / seconds,
+        bytes / seconds / (1 << 20));
+  }
+}
+
+void PrintJSON() {
+  printf("[\n");
+  for (int i = 0; i < results.size(); ++i) {
+    const auto& r = results[i];
+    printf(
+        "  {\"benchmark\": \"%s\", \"params\": \"%s\", \"records\": %lld, "
+        "\"bytes\": %lld, \"seconds\": %.6f, \"records_per_sec\": %.1f, "
+        "\"mb_per_sec\": %.3f}%s\n",
+        r.benchmark.c_str(),
+        r.params.c_str(),
+        static_cast<long long>(r.records),
+        static_cast<long long>(r.bytes),
+        r.seconds,
+        r.records / r.seconds,
+        r.bytes / r.seconds / (1 << 20),
+        i + 1 < results.size() ? "," : "");
+  }
+  printf("]\n");
+}
+
+// Writes records that TensorProtosDBInput can decode: a float tensor of
+// about record_size bytes and an int label.
+void WriteSynthetic(
+    const std::vector<string>& paths,
+    int num_records,
+    int record_size) {
+  std::vector<std::unique_ptr<db::DB>> dbs;
+  std::vector<std::unique_ptr<db::Transaction>> transactions;
+  for (const auto& path : paths) {
+    dbs.push_back(db::CreateDB("minidb", path, db::NEW));
+    CAFFE_ENFORCE(dbs.back(), "Cannot create ", path);
+    transactions.push_back(dbs.back()->NewTransaction());
+  }
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist;
+  const int num_floats = std::max(1, record_size / 4);
+  for (int i = 0; i < num_records; ++i) {
+    TensorProtos protos;
+    auto* data = protos.add_protos();
+    data->set_data_type(TensorProto::FLOAT);
+    data->add_dims(num_floats);
+    for (int j = 0; j < num_floats; ++j) {
+      data->add_float_data(dist(gen));
+    }
+    auto* label = protos.add_protos();
+    label->set_data_type(TensorProto::INT32);
+    label->add_dims(1);
+    label->add_int32_data(i % 1000);
+    char key[16];
+    snprintf(key, sizeof(key), "%08d", i);
+    transactions[i % paths.size()]->Put(key, protos.SerializeAsString());
+  }
+  for (auto& transaction : transactions) {
+    transaction->Commit();
+  }
+}
+
+template <typename F>
+void Run(const string& benchmark, const string& params, F read) {
+  for (int run = 0; run < FLAGS_repeat; ++run) {
+    int64_t bytes = 0;
+    Timer timer;
+    const int64_t records = read(&bytes);
+    Report(benchmark, params, records, bytes, timer.Seconds());
+  }
+}
+
+// Reads records sequentially through the cursor, starting over at the end
+int64_t ReadSequential(db::Cursor* cursor, int64_t* bytes) {
+  for (int i = 0; i < FLAGS_records; ++i) {
+    if (!cursor->Valid()) {
+      cursor->SeekToFirst();
+    }
+    string key = cursor->key();
+    string value = cursor->value();
+    *bytes += key.size() + value.size();
+    cursor->Next();
+  }
+  return FLAGS_records;
+}
+
+void BenchmarkSequential(const string& type, const string& source) {
+  auto in_db = db::CreateDB(type, source, db::READ);
+  CAFFE_ENFORCE(in_db, "Cannot open ", source);
+  auto cursor = in_db->NewCursor();
+  Run("sequential", type, [&](int64_t* bytes) {
+    return ReadSequential(cursor.get(), bytes);
+  });
+}
+
+void BenchmarkRandom(const string& type, const string& source) {
+  auto in_db = db::CreateDB(type, source, db::READ);
+  auto cursor = in_db->NewCursor();
+  if (!cursor->SupportsSeek()) {
+    LOG(INFO) << "Skipping random reads, " << type << " can't seek";
+    return;
+  }
+  std::vector<string> keys;
+  for (; cursor->Valid() && keys.size() < FLAGS_records; cursor->Next()) {
+    keys.push_back(cursor->key());
+  }
+  CAFFE_ENFORCE(!keys.empty(), "Empty db: ", source);
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+  Run("random", type, [&](int64_t* bytes) {
+    for (int i = 0; i < FLAGS_records; ++i) {
+      cursor->Seek(keys[dist(gen)]);
+      *bytes += cursor->value().size();
+    }
+    return FLAGS_records;
+  });
+}
+
+void BenchmarkBatched(const string& type, const string& source) {
+  auto in_db = db::CreateDB(type, source, db::READ);
+  auto cursor = in_db->NewCursor();
+  std::vector<string> keys(FLAGS_batch_size);
+  std::vector<string> values(FLAGS_batch_size);
+  Run("batched", MakeString("batch_size=", FLAGS_batch_size), [&](
+      int64_t* bytes) {
+    int64_t num_read = 0;
+    while (num_read < FLAGS_records) {
+      const int count =
+          cursor->NextBatch(FLAGS_batch_size, keys.data(), values.data());
+      for (int i = 0; i < count; ++i) {
+        *bytes += keys[i].size() + values[i].size();
+      }
+      num_read += count;
+      if (count < FLAGS_batch_size) {
+        cursor->SeekToFirst();
+      }
+    }
+    return num_read;
+  });
+}
+
+void BenchmarkReader(const string& type, const string& source) {
+  db::DBReader reader(type, source);
+  Run("reader", MakeString("threads=", FLAGS_num_read_threads), [&](
+      int64_t* bytes) {
+    std::vector<std::thread> threads;
+    std::vector<int64_t> thread_bytes(FLAGS_num_read_threads);
+    const int per_thread = FLAGS_records / FLAGS_num_read_threads;
+    for (int t = 0; t < FLAGS_num_read_threads; ++t) {
+      threads.emplace_back([&, t]() {
+        string key, value;
+        for (int i = 0; i < per_thread; ++i) {
+          reader.Read(&key, &value);
+          thread_bytes[t] += key.size() + value.size();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    for (auto b : thread_bytes) {
+      *bytes += b;
+    }
+    return static_cast<int64_t>(per_thread) * FLAGS_num_read_threads;
+  });
+}
+
+void BenchmarkPrefetch(const string& type, const string& source) {
+  for (int prefetch : {0, FLAGS_prefetch}) {
+    db::DBReader reader(type, source, 1, 0, prefetch);
+    std::vector<string> values;
+    Run("prefetch",
+        MakeString("prefetch=", prefetch, ",batch_size=", FLAGS_batch_size),
+        [&](int64_t* bytes) {
+          int64_t num_read = 0;
+          for (; num_read < FLAGS_records; num_read += FLAGS_batch_size) {
+            reader.ReadBatch(FLAGS_batch_size, nullptr, &values);
+            for (const auto& value : values) {
+              *bytes += value.size();
+            }
+          }
+          return num_read;
+        });
+  }
+}
+
+void BenchmarkSharded(const string& shards) {
+  for (int deterministic : {0, 1}) {
+    const auto source = MakeString(shards, ";deterministic=", deterministic);
+    auto in_db = db::CreateDB("sharded", source, db::READ);
+    CAFFE_ENFORCE(in_db, "Cannot open ", source);
+    auto cursor = in_db->NewCursor();
+    Run("sharded", MakeString("deterministic=", deterministic), [&](
+        int64_t* bytes) { return ReadSequential(cursor.get(), bytes); });
+  }
+}
+
+void BenchmarkRecordSizes() {
+  for (const auto& size_str : split(',', FLAGS_record_sizes)) {
+    const int size = std::stoi(size_str);
+    const auto path = MakeString(FLAGS_tmp_dir, "/db_benchmark_size_", size);
+    WriteSynthetic({path}, FLAGS_records, size);
+    auto in_db = db::CreateDB("minidb", path, db::READ);
+    auto cursor = in_db->NewCursor();
+    Run("record_sizes", MakeString("record_size=", size), [&](
+        int64_t* bytes) { return ReadSequential(cursor.get(), bytes); });
+    cursor.reset();
+    in_db.reset();
+    std::remove(path.c_str());
+  }
+}
+
+// Runs an input operator reading from a CreateDB reader, batch by batch
+void RunInputNet(
+    const string& benchmark,
+    const string& type,
+    const string& source,
+    const OperatorDef& input_op) {
+  Workspace ws;
+  NetDef net_def;
+  net_def.set_name(benchmark);
+  net_def.add_op()->CopyFrom(CreateOperatorDef(
+      "CreateDB",
+      "",
+      std::vector<string>{},
+      std::vector<string>{"reader"},
+      std::vector<Argument>{MakeArgument<string>("db_type", type),
+                            MakeArgument<string>("db", source)}));
+  auto* net = ws.CreateNet(net_def);
+  CAFFE_ENFORCE(net && net->Run());
+  NetDef input_net;
+  input_net.set_name(benchmark + "_input");
+  input_net.add_op()->CopyFrom(input_op);
+  net = ws.CreateNet(input_net);
+  CAFFE_ENFORCE(net);
+  // The first batch includes starting the prefetching
+  CAFFE_ENFORCE(net->Run());
+  const int iters = std::max(1, FLAGS_records / FLAGS_batch_size);
+  Run(benchmark, MakeString("batch_size=", FLAGS_batch_size), [&](
+      int64_t* bytes) {
+    for (int i = 0; i < iters; ++i) {
+      CAFFE_ENFORCE(net->Run());
+    }
+    *bytes = ws.GetBlob("data")->Get<TensorCPU>().nbytes() * iters;
+    return static_cast<int64_t>(iters) * FLAGS_batch_size;
+  });
+}
+
+void BenchmarkTensorProtosInput(const string& type, const string& source) {
+  RunInputNet(
+      "tensor_protos_input",
+      type,
+      source,
+      CreateOperatorDef(
+          "TensorProtosDBInput",
+          "",
+          std::vector<string>{"reader"},
+          std::vector<string>{"data", "label"},
+          std::vector<Argument>{
+              MakeArgument<int>("batch_size", FLAGS_batch_size)}));
+}
+
+void BenchmarkImageInput() {
+  if (!CPUOperatorRegistry()->Has("ImageInput")) {
+    LOG(INFO) << "Skipping image_input, built without ImageInput";
+    return;
+  }
+  RunInputNet(
+      "image_input",
+      FLAGS_image_db_type,
+      FLAGS_image_db,
+      CreateOperatorDef(
+          "ImageInput",
+          "",
+          std::vector<string>{"reader"},
+          std::vector<string>{"data", "label"},
+          std::vector<Argument>{
+              MakeArgument<int>("batch_size", FLAGS_batch_size),
+              MakeArgument<int>("scale", FLAGS_crop),
+              MakeArgument<int>("crop", FLAGS_crop),
+              MakeArgument<int>("decode_threads", FLAGS_decode_threads),
+              MakeArgument<int>("is_test", 1)}));
+}
+
+int Benchmark() {
+  const auto names = split(',', FLAGS_benchmarks);
+  const std::set<string> benchmarks(names.begin(), names.end());
+  auto enabled = [&](const string& name) {
+    return benchmarks.count(name) > 0;
+  };
+
+  string type = FLAGS_input_db_type;
+  string source = FLAGS_input_db;
+  string shards = FLAGS_shards;
+  std::vector<string> synthetic;
+  if (source.empty()) {
+    type = "minidb";
+    source = FLAGS_tmp_dir + "/db_benchmark";
+    std::vector<string> shard_paths;
+    for (int i = 0; i < FLAGS_synthetic_shards; ++i) {
+      shard_paths.push_back(MakeString(source, "_shard_", i));
+    }
+    WriteSynthetic({source}, FLAGS_records, FLAGS_record_size);
+    WriteSynthetic(shard_paths, FLAGS_records, FLAGS_record_size);
+    if (shards.empty()) {
+      shards = "minidb:" + source + "_shard_*";
+    }
+    synthetic = shard_paths;
+    synthetic.push_back(source);
+  } else {
+    CAFFE_ENFORCE(!type.empty(), "Must specify --input_db_type.");
+  }
+
+  if (enabled("sequential")) {
+    BenchmarkSequential(type, source);
+  }
+  if (enabled("random")) {
+    BenchmarkRandom(type, source);
+  }
+  if (enabled("batched")) {
+    BenchmarkBatched(type, source);
+  }
+  if (enabled("reader")) {
+    BenchmarkReader(type, source);
+  }
+  if (enabled("prefetch")) {
+    BenchmarkPrefetch(type, source);
+  }
+  if (enabled("sharded") && !shards.empty()) {
+    BenchmarkSharded(shards);
+  }
+  if (enabled("record_sizes")) {
+    BenchmarkRecordSizes();
+  }
+  if (enabled("tensor_protos_input")) {
+    BenchmarkTensorProtosInput(type, source);
+  }
+  if (enabled("image_input") && !FLAGS_image_db.empty()) {
+    BenchmarkImageInput();
+  }
+
+  for (const auto& path : synthetic) {
+    std::remove(path.c_str());
+  }
+  if (FLAGS_json) {
+    PrintJSON();
+  }
+  return 0;
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  return caffe2::Benchmark();
+}
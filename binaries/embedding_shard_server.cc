@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Serves a shard of the embedding tables of a sharded embedding service.
+// Every shard runs its own server, which publishes its endpoint in a file
+// store where the EmbeddingShardClientCreate op of the trainers finds it.
+// The trainers look up rows with EmbeddingShardLookup and push their
+// gradients with EmbeddingShardPushGradient, the server applies them with
+// SparseAdagrad.
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/distributed/embedding_shard.h"
+#include "caffe2/distributed/file_store_handler.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(service, "", "Name of the service.");
+CAFFE2_DEFINE_int(shard, 0, "Shard served by this server.");
+CAFFE2_DEFINE_int(num_shards, 1, "Number of shards of the service.");
+CAFFE2_DEFINE_string(
+    tables,
+    "",
+    "Comma separated list of the tables of the service, as name:rows:dim.");
+CAFFE2_DEFINE_string(server, "tcp://*:5556", "The server address.");
+CAFFE2_DEFINE_string(
+    endpoint,
+    "",
+    "The address the clients connect to, e.g. tcp://host:5556.");
+CAFFE2_DEFINE_string(file_store_path, "", "Directory of the file store.");
+CAFFE2_DEFINE_string(prefix, "", "Prefix of the keys of the store.");
+CAFFE2_DEFINE_double(init_scale, 0.01, "Rows are initialized in +-scale.");
+CAFFE2_DEFINE_double(learning_rate, 0.01, "Learning rate of SparseAdagrad.");
+CAFFE2_DEFINE_double(epsilon, 1e-5, "Epsilon of SparseAdagrad.");
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  CAFFE_ENFORCE(!caffe2::FLAGS_service.empty(), "--service is empty");
+  CAFFE_ENFORCE(!caffe2::FLAGS_endpoint.empty(), "--endpoint is empty");
+  CAFFE_ENFORCE(
+      !caffe2::FLAGS_file_store_path.empty(), "--file_store_path is empty");
+
+  std::vector<caffe2::EmbeddingShardServer::Table> tables;
+  for (const auto& spec : caffe2::split(',', caffe2::FLAGS_tables)) {
+    const auto fields = caffe2::split(':', spec);
+    CAFFE_ENFORCE(fields.size() == 3, "Invalid table ", spec);
+    tables.push_back({fields[0], std::stoll(fields[1]), std::stoi(fields[2])});
+  }
+  CAFFE_ENFORCE(!tables.empty(), "--tables is empty");
+
+  caffe2::EmbeddingShardServer server(
+      caffe2::FLAGS_shard,
+      caffe2::FLAGS_num_shards,
+      tables,
+      caffe2::FLAGS_init_scale,
+      caffe2::FLAGS_learning_rate,
+      caffe2::FLAGS_epsilon);
+  caffe2::FileStoreHandler store(
+      caffe2::FLAGS_file_store_path, caffe2::FLAGS_prefix);
+  // Like zmq_feeder, the server runs until it is killed
+  server.Serve(
+      caffe2::FLAGS_server,
+      caffe2::FLAGS_endpoint,
+      &store,
+      caffe2::FLAGS_service);
+  return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Prints the cost of every operator of a net, as given by the cost inference
+// functions of their schemas: FLOPs, bytes read and written, arithmetic
+// intensity, and the run time estimated by the roofline model of a machine
+// with the given peak compute throughput and memory bandwidth.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(net, "", "The net to report the cost of.");
+CAFFE2_DEFINE_string(
+    init_net,
+    "",
+    "The net initializing the parameters of the net, if any.");
+CAFFE2_DEFINE_string(
+    input,
+    "",
+    "Inputs of the net not written by the init net. If multiple inputs are "
+    "needed, use comma separated string.");
+CAFFE2_DEFINE_string(
+    input_dims,
+    "",
+    "Dimensions of the float inputs, as comma separated numbers. If multiple "
+    "inputs are needed, use semicolon to separate the dimensions of "
+    "different tensors.");
+CAFFE2_DEFINE_double(
+    peak_gflops,
+    100,
+    "Peak compute throughput of the machine, in GFLOP/s.");
+CAFFE2_DEFINE_double(
+    peak_gbps,
+    20,
+    "Peak memory bandwidth of the machine, in GB/s.");
+
+using std::string;
+using std::vector;
+
+namespace caffe2 {
+namespace {
+
+struct OpCost {
+  string type;
+  OpSchema::Cost cost;
+  // Roofline estimate, in microseconds
+  double time_us = 0;
+  bool compute_bound = false;
+};
+
+OpCost Estimate(const string& type, const OpSchema::Cost& cost) {
+  OpCost op_cost;
+  op_cost.type = type;
+  op_cost.cost = cost;
+  const double compute_us = cost.flops / (FLAGS_peak_gflops * 1e3);
+  const double memory_us =
+      (cost.bytes_read + cost.bytes_written) / (FLAGS_peak_gbps * 1e3);
+  op_cost.time_us = std::max(compute_us, memory_us);
+  op_cost.compute_bound = compute_us >= memory_us;
+  return op_cost;
+}
+
+void PrintRow(
+    const string& index,
+    const string& name,
+    const OpSchema::Cost& cost,
+    double time_us,
+    const string& bound) {
+  const uint64_t bytes = cost.bytes_read + cost.bytes_written;
+  std::cout << std::setw(6) << index << " " << std::left << std::setw(40)
+            << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << cost.flops / 1e6 << std::setw(12)
+            << cost.bytes_read / 1e6 << std::setw(12)
+            << cost.bytes_written / 1e6 << std::setw(10)
+            << (bytes ? static_cast<double>(cost.flops) / bytes : 0.0)
+            << std::setw(12) << time_us << "  " << bound << std::endl;
+}
+
+void PrintHeader() {
+  std::cout << std::setw(6) << "#" << " " << std::left << std::setw(40)
+            << "operator" << std::right << std::setw(12) << "MFLOP"
+            << std::setw(12) << "MB read" << std::setw(12) << "MB written"
+            << std::setw(10) << "FLOP/B" << std::setw(12) << "est. us"
+            << "  bound" << std::endl;
+}
+
+void Accumulate(const OpSchema::Cost& cost, OpSchema::Cost* total) {
+  total->flops += cost.flops;
+  total->bytes_read += cost.bytes_read;
+  total->bytes_written += cost.bytes_written;
+  total->params_bytes += cost.params_bytes;
+}
+
+void Run() {
+  Workspace workspace;
+  if (!FLAGS_init_net.empty()) {
+    NetDef init_net;
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_init_net, &init_net));
+    CAFFE_ENFORCE(workspace.RunNetOnce(init_net));
+  }
+  if (!FLAGS_input.empty()) {
+    const vector<string> input_names = split(',', FLAGS_input);
+    const vector<string> input_dims_list = split(';', FLAGS_input_dims);
+    CAFFE_ENFORCE_EQ(
+        input_names.size(),
+        input_dims_list.size(),
+        "Input name and dims should have the same number of items.");
+    for (size_t i = 0; i < input_names.size(); ++i) {
+      vector<TIndex> dims;
+      for (const string& s : split(',', input_dims_list[i])) {
+        dims.push_back(caffe2::stoi(s));
+      }
+      auto* tensor =
+          workspace.CreateBlob(input_names[i])->GetMutable<TensorCPU>();
+      tensor->Resize(dims);
+      tensor->mutable_data<float>();
+    }
+  }
+  NetDef net;
+  CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_net, &net));
+
+  // Shapes are propagated through the net, so that every operator gets the
+  // shapes of its inputs at the time it runs
+  std::map<string, TensorShape> shapes;
+  for (const auto& name : workspace.Blobs()) {
+    shapes[name] = GetTensorShapeOfBlob(workspace.GetBlob(name));
+  }
+
+  std::cout << "Roofline of " << FLAGS_peak_gflops << " GFLOP/s and "
+            << FLAGS_peak_gbps << " GB/s, ridge point at "
+            << FLAGS_peak_gflops / FLAGS_peak_gbps << " FLOP/B" << std::endl;
+  PrintHeader();
+  OpSchema::Cost total;
+  double total_us = 0;
+  std::map<string, std::pair<OpSchema::Cost, double>> per_type;
+  int num_unknown = 0;
+  for (int i = 0; i < net.op_size(); ++i) {
+    const auto& op = net.op(i);
+    const string name = op.type() +
+        (op.output_size() > 0 ? " -> " + op.output(0) : string());
+    vector<TensorShape> input_shapes;
+    for (const auto& input : op.input()) {
+      auto it = shapes.find(input);
+      if (it == shapes.end() || it->second.unknown_shape()) {
+        break;
+      }
+      input_shapes.push_back(it->second);
+    }
+    const OpSchema* schema = OpSchemaRegistry::Schema(op.type());
+    bool inferred = false;
+    bool known = false;
+    if (schema && input_shapes.size() == op.input_size()) {
+      try {
+        const auto outputs = schema->InferTensor(op, input_shapes);
+        for (int j = 0; j < outputs.size() && j < op.output_size(); ++j) {
+          shapes[op.output(j)] = outputs[j];
+        }
+        inferred = true;
+        if (schema->HasCostInferenceFunction()) {
+          const auto op_cost =
+              Estimate(op.type(), schema->InferCost(op, input_shapes));
+          PrintRow(
+              caffe2::to_string(i),
+              name,
+              op_cost.cost,
+              op_cost.time_us,
+              op_cost.compute_bound ? "compute" : "memory");
+          Accumulate(op_cost.cost, &total);
+          total_us += op_cost.time_us;
+          Accumulate(op_cost.cost, &per_type[op.type()].first);
+          per_type[op.type()].second += op_cost.time_us;
+          known = true;
+        }
+      } catch (const std::exception& e) {
+        VLOG(1) << "Cost inference of " << name << " failed: " << e.what();
+      }
+    }
+    if (!inferred) {
+      for (const auto& output : op.output()) {
+        shapes[output].set_unknown_shape(true);
+      }
+    }
+    if (!known) {
+      std::cout << std::setw(6) << i << " " << name
+                << " (no cost inference or unknown input shapes)"
+                << std::endl;
+      ++num_unknown;
+    }
+  }
+
+  std::cout << std::endl << "Per operator type:" << std::endl;
+  PrintHeader();
+  vector<std::pair<double, string>> types;
+  for (const auto& kv : per_type) {
+    types.emplace_back(kv.second.second, kv.first);
+  }
+  std::sort(types.rbegin(), types.rend());
+  for (const auto& type : types) {
+    PrintRow("", type.second, per_type[type.second].first, type.first, "");
+  }
+  PrintRow("", "total", total, total_us, "");
+  std::cout << "Parameters: " << total.params_bytes / 1e6 << " MB" << std::endl;
+  if (num_unknown > 0) {
+    std::cout << num_unknown << " operators are not accounted for"
+              << std::endl;
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  return 0;
+}
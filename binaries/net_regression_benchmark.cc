@@ -0,0 +1,451 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks a set of models under every executor, engine set and number of
+// concurrent callers, and compares the results with a stored baseline to
+// catch performance regressions.
+//
+// The models are listed in a file, one per line, with their init net, their
+// predict net and the dimensions of the inputs not written by the init net,
+// which are filled with random values (ints with zeros, being safe indices):
+//   resnet50 resnet50_init.pb resnet50_predict.pb data=1,3,224,224
+//   dlrm dlrm_init.pb dlrm_predict.pb dense=64,13 ids=64,26:int
+//
+// Every configuration reports the latency distribution of the runs, the
+// throughput of the concurrent callers, each running its own instance of the
+// net over the shared parameters, and the peak bytes of the blobs of a run.
+// With --baseline, the latencies are compared with the ones of the baseline
+// with a Mann-Whitney U test, and the run fails if the median latency is
+// significantly worse by more than --threshold, or if the throughput or the
+// peak memory are worse by more than --threshold.
+//
+// For example, to record a baseline then check a new build against it, with
+// the simple and async_scheduling executors and 1 and 4 callers:
+//   net_regression_benchmark --models models.txt --executors
+//     simple,async_scheduling --threads 1,4 --save_baseline baseline.txt
+//   net_regression_benchmark --models models.txt --executors
+//     simple,async_scheduling --threads 1,4 --baseline baseline.txt
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/observers/blob_memory_observer.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(models, "", "The file listing the models to benchmark.");
+CAFFE2_DEFINE_string(
+    executors,
+    "simple",
+    "Comma separated net types to run the models with.");
+CAFFE2_DEFINE_string(
+    engines,
+    "",
+    "Engine sets to run the models with, separated by '|'. An engine set is "
+    "given to every operator as its comma separated engine preference, the "
+    "empty one keeps the engines of the net, e.g. \"|NNPACK\" runs both.");
+CAFFE2_DEFINE_string(
+    threads,
+    "1",
+    "Comma separated numbers of callers running the model concurrently.");
+CAFFE2_DEFINE_int(warmup, 5, "The number of runs to warm up every caller.");
+CAFFE2_DEFINE_int(iter, 50, "The number of timed runs of every caller.");
+CAFFE2_DEFINE_string(baseline, "", "The baseline to compare the results to.");
+CAFFE2_DEFINE_string(
+    save_baseline,
+    "",
+    "If set, the file to save the results to, as a baseline.");
+CAFFE2_DEFINE_double(
+    alpha,
+    0.01,
+    "Significance level of the test comparing the latencies.");
+CAFFE2_DEFINE_double(
+    threshold,
+    0.05,
+    "Relative change of the median latency, throughput or peak memory "
+    "under which a difference is not reported.");
+
+using std::string;
+using std::vector;
+
+namespace caffe2 {
+namespace {
+
+struct Input {
+  string name;
+  vector<int> dims;
+  bool is_int = false;
+};
+
+struct Model {
+  string name;
+  NetDef init_net;
+  NetDef predict_net;
+  vector<Input> inputs;
+};
+
+struct Result {
+  // model/executor/engines/threads
+  string key;
+  // Latency of every run of every caller
+  vector<double> millis;
+  double runs_per_sec = 0;
+  size_t peak_bytes = 0;
+};
+
+vector<Model> ReadModels(const string& filename) {
+  std::ifstream file(filename);
+  CAFFE_ENFORCE(file, "Can't read ", filename);
+  vector<Model> models;
+  string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    Model model;
+    string init_net, predict_net;
+    if (!(fields >> model.name) || model.name[0] == '#') {
+      continue;
+    }
+    CAFFE_ENFORCE(
+        fields >> init_net >> predict_net,
+        "Model ",
+        model.name,
+        " has no init and predict nets");
+    CAFFE_ENFORCE(ReadProtoFromFile(init_net, &model.init_net));
+    CAFFE_ENFORCE(ReadProtoFromFile(predict_net, &model.predict_net));
+    string spec;
+    while (fields >> spec) {
+      const auto pos = spec.find('=');
+      CAFFE_ENFORCE(pos != string::npos, "Input ", spec, " is not name=dims");
+      Input input;
+      input.name = spec.substr(0, pos);
+      auto dims = spec.substr(pos + 1);
+      const auto type_pos = dims.find(':');
+      if (type_pos != string::npos) {
+        const auto type = dims.substr(type_pos + 1);
+        CAFFE_ENFORCE(
+            type == "int" || type == "float", "Unknown input type ", type);
+        input.is_int = type == "int";
+        dims = dims.substr(0, type_pos);
+      }
+      for (const auto& dim : split(',', dims)) {
+        input.dims.push_back(caffe2::stoi(dim));
+      }
+      model.inputs.push_back(input);
+    }
+    models.push_back(model);
+  }
+  return models;
+}
+
+// Runs the init net and fills the inputs in `ws`
+void Prepare(const Model& model, Workspace* ws) {
+  CAFFE_ENFORCE(ws->RunNetOnce(model.init_net), "Init net of ", model.name);
+  NetDef fill_net;
+  for (const auto& input : model.inputs) {
+    auto* fill = fill_net.add_op();
+    fill->add_output(input.name);
+    fill->add_arg()->CopyFrom(MakeArgument("shape", input.dims));
+    if (input.is_int) {
+      fill->set_type("ConstantFill");
+      fill->add_arg()->CopyFrom(
+          MakeArgument("dtype", static_cast<int>(TensorProto::INT32)));
+      fill->add_arg()->CopyFrom(MakeArgument("value", 0));
+    } else {
+      fill->set_type("UniformFill");
+      fill->add_arg()->CopyFrom(MakeArgument("min", -1.f));
+      fill->add_arg()->CopyFrom(MakeArgument("max", 1.f));
+    }
+  }
+  CAFFE_ENFORCE(ws->RunNetOnce(fill_net), "Inputs of ", model.name);
+}
+
+Result Benchmark(
+    const Model& model,
+    Workspace* ws,
+    const string& executor,
+    const string& engines,
+    int num_threads) {
+  NetDef net_def = model.predict_net;
+  net_def.set_type(executor);
+  if (!engines.empty()) {
+    for (auto& op : *net_def.mutable_op()) {
+      op.set_engine(engines);
+    }
+  }
+
+  // Every caller runs its own net in a child workspace, so that only the
+  // parameters and the inputs are shared
+  vector<std::unique_ptr<Workspace>> workspaces;
+  vector<NetBase*> nets;
+  for (int i = 0; i < num_threads; ++i) {
+    workspaces.emplace_back(new Workspace(ws));
+    net_def.set_name(model.predict_net.name() + "_" + caffe2::to_string(i));
+    nets.push_back(workspaces.back()->CreateNet(net_def));
+    CAFFE_ENFORCE(nets.back(), "Can't create the net of ", model.name);
+  }
+  auto* memory = new BlobMemoryObserver(nets[0]);
+  nets[0]->AttachObserver(std::unique_ptr<BlobMemoryObserver>(memory));
+
+  Result result;
+  result.key = model.name + "/" + executor + "/" +
+      (engines.empty() ? "default" : engines) + "/" +
+      caffe2::to_string(num_threads);
+  for (auto* net : nets) {
+    for (int j = 0; j < FLAGS_warmup; ++j) {
+      CAFFE_ENFORCE(net->Run(), "Warmup run of ", result.key, " failed");
+    }
+  }
+  vector<vector<double>> millis(num_threads);
+  auto caller = [&](int i) {
+    Timer timer;
+    for (int j = 0; j < FLAGS_iter; ++j) {
+      timer.Start();
+      CAFFE_ENFORCE(nets[i]->Run(), "Run of ", result.key, " failed");
+      millis[i].push_back(timer.MilliSeconds());
+    }
+  };
+  Timer wall;
+  vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(caller, i);
+  }
+  caller(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  result.runs_per_sec = num_threads * FLAGS_iter / wall.Seconds();
+  for (const auto& m : millis) {
+    result.millis.insert(result.millis.end(), m.begin(), m.end());
+  }
+  result.peak_bytes = memory->max_peak_bytes();
+  return result;
+}
+
+double Median(vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const auto n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+double Percentile(const vector<double>& sorted, double p) {
+  return sorted[std::min<size_t>(sorted.size() * p, sorted.size() - 1)];
+}
+
+// Two-sided p-value of the Mann-Whitney U test that `a` and `b` come from
+// the same distribution, with the normal approximation and the correction
+// for ties
+double MannWhitneyPValue(const vector<double>& a, const vector<double>& b) {
+  const double n1 = a.size();
+  const double n2 = b.size();
+  vector<std::pair<double, int>> values;
+  for (const auto v : a) {
+    values.emplace_back(v, 0);
+  }
+  for (const auto v : b) {
+    values.emplace_back(v, 1);
+  }
+  std::sort(values.begin(), values.end());
+  double rank_sum = 0;
+  double ties = 0;
+  for (size_t i = 0; i < values.size();) {
+    size_t j = i;
+    while (j < values.size() && values[j].first == values[i].first) {
+      ++j;
+    }
+    // Tied values share the mean of their ranks, which are 1-based
+    const double rank = (i + 1 + j) / 2.0;
+    for (size_t k = i; k < j; ++k) {
+      if (values[k].second == 0) {
+        rank_sum += rank;
+      }
+    }
+    const double t = j - i;
+    ties += t * t * t - t;
+    i = j;
+  }
+  const double n = n1 + n2;
+  const double u = rank_sum - n1 * (n1 + 1) / 2;
+  const double variance =
+      n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) {
+    return 1;
+  }
+  // With the continuity correction
+  const double z = (std::abs(u - n1 * n2 / 2) - 0.5) / std::sqrt(variance);
+  return std::erfc(std::max(z, 0.0) / std::sqrt(2.0));
+}
+
+void SaveBaseline(const string& filename, const vector<Result>& results) {
+  std::ofstream file(filename);
+  CAFFE_ENFORCE(file, "Can't write ", filename);
+  file << std::setprecision(9);
+  for (const auto& result : results) {
+    file << result.key << " " << result.runs_per_sec << " "
+         << result.peak_bytes << " ";
+    for (int i = 0; i < result.millis.size(); ++i) {
+      file << (i ? "," : "") << result.millis[i];
+    }
+    file << "\n";
+  }
+}
+
+std::map<string, Result> LoadBaseline(const string& filename) {
+  std::ifstream file(filename);
+  CAFFE_ENFORCE(file, "Can't read ", filename);
+  std::map<string, Result> baseline;
+  string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    Result result;
+    string millis;
+    if (!(fields >> result.key >> result.runs_per_sec >> result.peak_bytes >>
+          millis)) {
+      continue;
+    }
+    for (const auto& ms : split(',', millis)) {
+      result.millis.push_back(std::stod(ms));
+    }
+    baseline[result.key] = result;
+  }
+  return baseline;
+}
+
+void Report(const vector<Result>& results) {
+  std::cout << std::left << std::setw(48) << "model/executor/engines/threads"
+            << std::right << std::setw(10) << "mean ms" << std::setw(10)
+            << "p50 ms" << std::setw(10) << "p90 ms" << std::setw(10)
+            << "p99 ms" << std::setw(12) << "runs/s" << std::setw(12)
+            << "peak MB" << std::endl;
+  for (const auto& result : results) {
+    auto sorted = result.millis;
+    std::sort(sorted.begin(), sorted.end());
+    double mean = 0;
+    for (const auto ms : sorted) {
+      mean += ms / sorted.size();
+    }
+    std::cout << std::left << std::setw(48) << result.key << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << mean
+              << std::setw(10) << Percentile(sorted, 0.5) << std::setw(10)
+              << Percentile(sorted, 0.9) << std::setw(10)
+              << Percentile(sorted, 0.99) << std::setw(12)
+              << result.runs_per_sec << std::setw(12)
+              << result.peak_bytes / 1024.0 / 1024.0 << std::endl;
+  }
+}
+
+// Returns the number of regressions
+int Compare(
+    const vector<Result>& results,
+    const std::map<string, Result>& baseline) {
+  int regressions = 0;
+  for (const auto& result : results) {
+    auto it = baseline.find(result.key);
+    if (it == baseline.end()) {
+      LOG(WARNING) << result.key << " is not in the baseline";
+      continue;
+    }
+    const auto& base = it->second;
+    const double median = Median(result.millis);
+    const double base_median = Median(base.millis);
+    const double p_value = MannWhitneyPValue(result.millis, base.millis);
+    const double latency_change = median / base_median - 1;
+    if (p_value < FLAGS_alpha && std::abs(latency_change) > FLAGS_threshold) {
+      const bool worse = latency_change > 0;
+      regressions += worse;
+      std::cout << (worse ? "REGRESSION " : "improvement ") << result.key
+                << ": median latency " << base_median << " -> " << median
+                << " ms (" << std::showpos << latency_change * 100
+                << std::noshowpos << "%, p=" << p_value << ")" << std::endl;
+    }
+    const double throughput_change =
+        result.runs_per_sec / base.runs_per_sec - 1;
+    if (throughput_change < -FLAGS_threshold) {
+      ++regressions;
+      std::cout << "REGRESSION " << result.key << ": throughput "
+                << base.runs_per_sec << " -> " << result.runs_per_sec
+                << " runs/s (" << throughput_change * 100 << "%)" << std::endl;
+    }
+    if (result.peak_bytes >
+        base.peak_bytes * (1 + FLAGS_threshold) + 1) {
+      ++regressions;
+      std::cout << "REGRESSION " << result.key << ": peak memory "
+                << base.peak_bytes << " -> " << result.peak_bytes << " bytes"
+                << std::endl;
+    }
+  }
+  return regressions;
+}
+
+int Run() {
+  CAFFE_ENFORCE(!FLAGS_models.empty(), "--models is required");
+  CAFFE_ENFORCE_GT(FLAGS_iter, 0);
+  const auto executors = split(',', FLAGS_executors);
+  auto engine_sets = split('|', FLAGS_engines);
+  if (engine_sets.empty()) {
+    engine_sets.push_back("");
+  }
+  vector<int> thread_counts;
+  for (const auto& t : split(',', FLAGS_threads)) {
+    thread_counts.push_back(caffe2::stoi(t));
+    CAFFE_ENFORCE_GT(thread_counts.back(), 0);
+  }
+
+  vector<Result> results;
+  for (const auto& model : ReadModels(FLAGS_models)) {
+    Workspace ws;
+    Prepare(model, &ws);
+    for (const auto& executor : executors) {
+      for (const auto& engines : engine_sets) {
+        for (const auto num_threads : thread_counts) {
+          results.push_back(
+              Benchmark(model, &ws, executor, engines, num_threads));
+        }
+      }
+    }
+  }
+  Report(results);
+  if (!FLAGS_save_baseline.empty()) {
+    SaveBaseline(FLAGS_save_baseline, results);
+  }
+  if (!FLAGS_baseline.empty()) {
+    const int regressions = Compare(results, LoadBaseline(FLAGS_baseline));
+    std::cout << regressions << " regression(s)" << std::endl;
+    return regressions > 0 ? 1 : 0;
+  }
+  return 0;
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  return caffe2::Run();
+}
@@ -0,0 +1,367 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks a single operator over a sweep of input shapes and engines.
+// The inputs are filled with random values on the operator's device, the
+// operator is warmed up, then timed over iterations, optionally flushing the
+// CPU caches before every iteration. Every shape and engine reports the
+// latency percentiles, and the GFLOP/s and GB/s of the cost inference of
+// the operator's schema, as a table and optionally as JSON.
+//
+// For example, the 3x3 convolutions of two layers with two engines:
+//   operator_benchmark --operator Conv --args kernel=3,pad=1
+//     --input_dims "1,64,56,56;64,64,3,3;64|1,128,28,28;128,128,3,3;128"
+//     --engines ",NNPACK" --json conv.json
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/blob_stats.h"
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(operator, "", "The type of the operator to benchmark.");
+CAFFE2_DEFINE_string(
+    args,
+    "",
+    "Arguments of the operator, as comma separated name=value pairs. Values "
+    "with a '.' are floats, other numbers ints, and anything else strings. "
+    "Colon separated numbers, like kernels=3:3, are lists of ints.");
+CAFFE2_DEFINE_string(
+    input_dims,
+    "",
+    "The sweep of input shapes: shapes separated by '|', each of them the "
+    "comma separated dimensions of all the inputs, separated by ';'.");
+CAFFE2_DEFINE_string(
+    input_types,
+    "",
+    "Comma separated type of every input, float (the default) or int. Int "
+    "inputs, like indices, are drawn in [0, int_max].");
+CAFFE2_DEFINE_int(
+    int_max,
+    1,
+    "The largest value of the int inputs, at least 1.");
+CAFFE2_DEFINE_string(
+    engines,
+    "",
+    "Comma separated engines to benchmark, the empty one being the default "
+    "engine.");
+CAFFE2_DEFINE_string(device, "cpu", "The device to run on, cpu or cuda.");
+CAFFE2_DEFINE_int(warmup, 5, "The number of iterations to warm up.");
+CAFFE2_DEFINE_int(iter, 50, "The number of timed iterations.");
+CAFFE2_DEFINE_bool(
+    flush_cache,
+    false,
+    "Flush the CPU caches before every timed iteration, by writing a buffer "
+    "of cache_size_mb, to measure cold cache runs.");
+CAFFE2_DEFINE_int(cache_size_mb, 64, "The size of the cache flushing buffer.");
+CAFFE2_DEFINE_string(json, "", "If set, the file to write the results to.");
+
+using std::string;
+using std::vector;
+
+namespace caffe2 {
+namespace {
+
+struct Result {
+  string engine;
+  vector<vector<TIndex>> input_dims;
+  vector<float> millis;
+  OpSchema::Cost cost;
+  bool has_cost = false;
+};
+
+string JsonString(const string& str) {
+  std::stringstream ss;
+  ss << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      ss << '\\';
+    }
+    ss << c;
+  }
+  ss << '"';
+  return ss.str();
+}
+
+string DimsString(const vector<vector<TIndex>>& input_dims) {
+  std::stringstream ss;
+  for (int i = 0; i < input_dims.size(); ++i) {
+    ss << (i ? ";" : "");
+    for (int j = 0; j < input_dims[i].size(); ++j) {
+      ss << (j ? "," : "") << input_dims[i][j];
+    }
+  }
+  return ss.str();
+}
+
+bool IsNumber(const string& s, bool* is_float) {
+  char* end = nullptr;
+  std::strtod(s.c_str(), &end);
+  *is_float = s.find('.') != string::npos || s.find('e') != string::npos;
+  return !s.empty() && end == s.c_str() + s.size();
+}
+
+void AddArguments(const string& args, OperatorDef* def) {
+  for (const auto& pair : split(',', args)) {
+    if (pair.empty()) {
+      continue;
+    }
+    const auto pos = pair.find('=');
+    CAFFE_ENFORCE(pos != string::npos, "Argument ", pair, " is not name=value");
+    const string name = pair.substr(0, pos);
+    const string value = pair.substr(pos + 1);
+    bool is_float = false;
+    if (value.find(':') != string::npos) {
+      vector<int> ints;
+      for (const auto& s : split(':', value)) {
+        ints.push_back(caffe2::stoi(s));
+      }
+      def->add_arg()->CopyFrom(MakeArgument(name, ints));
+    } else if (IsNumber(value, &is_float) && is_float) {
+      def->add_arg()->CopyFrom(MakeArgument(name, std::stof(value)));
+    } else if (IsNumber(value, &is_float)) {
+      def->add_arg()->CopyFrom(MakeArgument(name, caffe2::stoi(value)));
+    } else {
+      def->add_arg()->CopyFrom(MakeArgument(name, value));
+    }
+  }
+}
+
+void FlushCache() {
+  static vector<char> buffer(size_t(FLAGS_cache_size_mb) * 1024 * 1024);
+  static char value = 0;
+  std::fill(buffer.begin(), buffer.end(), ++value);
+}
+
+float Percentile(const vector<float>& sorted, double p) {
+  return sorted[std::min<size_t>(sorted.size() * p, sorted.size() - 1)];
+}
+
+Result Benchmark(
+    const vector<vector<TIndex>>& input_dims,
+    const string& engine,
+    const DeviceOption& device) {
+  const auto* schema = OpSchemaRegistry::Schema(FLAGS_operator);
+  CAFFE_ENFORCE(schema, "Operator ", FLAGS_operator, " has no schema");
+  const int num_inputs = input_dims.size();
+  CAFFE_ENFORCE(
+      num_inputs >= schema->min_input() && num_inputs <= schema->max_input() &&
+          schema->num_inputs_allowed(num_inputs),
+      FLAGS_operator,
+      " can't take ",
+      num_inputs,
+      " inputs");
+  const int num_outputs = schema->CalculateOutput(num_inputs);
+  CAFFE_ENFORCE_GE(
+      num_outputs,
+      0,
+      "The number of outputs of ",
+      FLAGS_operator,
+      " depends on its arguments");
+  const vector<string> types = split(',', FLAGS_input_types);
+
+  Workspace ws;
+  OperatorDef def;
+  def.set_type(FLAGS_operator);
+  def.set_engine(engine);
+  def.mutable_device_option()->CopyFrom(device);
+  AddArguments(FLAGS_args, &def);
+
+  // The inputs are filled on the device of the operator
+  NetDef init_net;
+  vector<TensorShape> input_shapes;
+  for (int i = 0; i < num_inputs; ++i) {
+    const string name = "X" + caffe2::to_string(i);
+    def.add_input(name);
+    const bool is_int = i < types.size() && types[i] == "int";
+    auto* fill = init_net.add_op();
+    fill->set_type(is_int ? "UniformIntFill" : "UniformFill");
+    fill->add_output(name);
+    fill->mutable_device_option()->CopyFrom(device);
+    vector<int> shape(input_dims[i].begin(), input_dims[i].end());
+    fill->add_arg()->CopyFrom(MakeArgument("shape", shape));
+    if (is_int) {
+      fill->add_arg()->CopyFrom(MakeArgument("min", 0));
+      fill->add_arg()->CopyFrom(MakeArgument("max", FLAGS_int_max));
+    } else {
+      fill->add_arg()->CopyFrom(MakeArgument("min", -1.f));
+      fill->add_arg()->CopyFrom(MakeArgument("max", 1.f));
+    }
+    input_shapes.push_back(CreateTensorShape(
+        input_dims[i], is_int ? TensorProto::INT32 : TensorProto::FLOAT));
+  }
+  for (int i = 0; i < num_outputs; ++i) {
+    def.add_output("Y" + caffe2::to_string(i));
+  }
+  CAFFE_ENFORCE(ws.RunNetOnce(init_net), "Can't create the inputs");
+
+  Result result;
+  result.engine = engine;
+  result.input_dims = input_dims;
+  auto op = CreateOperator(def, &ws);
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(op->Run(), "Warmup iteration ", i, " failed");
+  }
+  // Operator::Run waits for the device, so that the times include the
+  // device computation
+  Timer timer;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    if (FLAGS_flush_cache) {
+      FlushCache();
+    }
+    timer.Start();
+    CAFFE_ENFORCE(op->Run(), "Iteration ", i, " failed");
+    result.millis.push_back(timer.MilliSeconds());
+  }
+
+  if (schema->HasCostInferenceFunction()) {
+    try {
+      result.cost = schema->InferCost(def, input_shapes);
+      result.has_cost = true;
+    } catch (const std::exception& e) {
+      VLOG(1) << "Cost inference failed: " << e.what();
+    }
+  }
+  if (!result.has_cost) {
+    // No FLOPs, the bytes of the inputs and outputs only
+    for (const auto& name : def.input()) {
+      result.cost.bytes_read += BlobStat::sizeBytes(*ws.GetBlob(name));
+    }
+    for (const auto& name : def.output()) {
+      result.cost.bytes_written += BlobStat::sizeBytes(*ws.GetBlob(name));
+    }
+  }
+  return result;
+}
+
+void Report(const vector<Result>& results) {
+  std::cout << std::left << std::setw(40) << "input dims" << std::setw(12)
+            << "engine" << std::right << std::setw(10) << "mean ms"
+            << std::setw(10) << "min ms" << std::setw(10) << "p50 ms"
+            << std::setw(10) << "p90 ms" << std::setw(10) << "p99 ms"
+            << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s"
+            << std::endl;
+  std::ofstream json;
+  if (!FLAGS_json.empty()) {
+    json.open(FLAGS_json);
+    CAFFE_ENFORCE(json, "Can't write ", FLAGS_json);
+    json << "[";
+  }
+  for (int i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    auto sorted = result.millis;
+    std::sort(sorted.begin(), sorted.end());
+    const double mean =
+        std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+    const double p50 = Percentile(sorted, 0.5);
+    // GFLOP/s and GB/s of the median iteration
+    const double gflops = result.cost.flops / (p50 * 1e6);
+    const double gbps =
+        (result.cost.bytes_read + result.cost.bytes_written) / (p50 * 1e6);
+    const string dims = DimsString(result.input_dims);
+    const string engine = result.engine.empty() ? "default" : result.engine;
+    std::cout << std::left << std::setw(40) << dims << std::setw(12) << engine
+              << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << mean << std::setw(10) << sorted.front()
+              << std::setw(10) << p50 << std::setw(10)
+              << Percentile(sorted, 0.9) << std::setw(10)
+              << Percentile(sorted, 0.99) << std::setw(10)
+              << (result.has_cost ? gflops : 0.0) << std::setw(10) << gbps
+              << std::endl;
+    if (json.is_open()) {
+      json << (i ? ",\n" : "\n") << "{\"operator\": "
+           << JsonString(FLAGS_operator)
+           << ", \"args\": " << JsonString(FLAGS_args)
+           << ", \"device\": " << JsonString(FLAGS_device)
+           << ", \"engine\": " << JsonString(engine)
+           << ", \"input_dims\": " << JsonString(dims)
+           << ", \"iterations\": " << sorted.size()
+           << ", \"flush_cache\": " << (FLAGS_flush_cache ? "true" : "false")
+           << ", \"mean_ms\": " << mean << ", \"min_ms\": " << sorted.front()
+           << ", \"p50_ms\": " << p50
+           << ", \"p90_ms\": " << Percentile(sorted, 0.9)
+           << ", \"p99_ms\": " << Percentile(sorted, 0.99)
+           << ", \"max_ms\": " << sorted.back()
+           << ", \"flops\": " << result.cost.flops
+           << ", \"bytes_read\": " << result.cost.bytes_read
+           << ", \"bytes_written\": " << result.cost.bytes_written
+           << ", \"has_cost_inference\": "
+           << (result.has_cost ? "true" : "false");
+      if (result.has_cost) {
+        json << ", \"gflops\": " << gflops;
+      }
+      json << ", \"gbps\": " << gbps << "}";
+    }
+  }
+  if (json.is_open()) {
+    json << "\n]\n";
+  }
+}
+
+void Run() {
+  CAFFE_ENFORCE(!FLAGS_operator.empty(), "--operator is required");
+  CAFFE_ENFORCE(!FLAGS_input_dims.empty(), "--input_dims is required");
+  CAFFE_ENFORCE_GT(FLAGS_iter, 0);
+  DeviceOption device;
+  if (FLAGS_device == "cuda") {
+    device.set_device_type(CUDA);
+  } else {
+    CAFFE_ENFORCE_EQ(FLAGS_device, "cpu", "Unknown device ", FLAGS_device);
+  }
+  // An empty engine is the default one, so that ",NNPACK" benchmarks both
+  vector<string> engines = split(',', FLAGS_engines);
+  if (engines.empty()) {
+    engines.push_back("");
+  }
+
+  vector<Result> results;
+  for (const auto& shapes : split('|', FLAGS_input_dims)) {
+    vector<vector<TIndex>> input_dims;
+    for (const auto& shape : split(';', shapes)) {
+      vector<TIndex> dims;
+      for (const auto& dim : split(',', shape)) {
+        dims.push_back(caffe2::stoi(dim));
+      }
+      input_dims.push_back(dims);
+    }
+    for (const auto& engine : engines) {
+      results.push_back(Benchmark(input_dims, engine, device));
+    }
+  }
+  Report(results);
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  return 0;
+}
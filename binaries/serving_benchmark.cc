@@ -0,0 +1,457 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Serving load generator: client threads send requests of variable batch
+// sizes to Predictors at a target rate and the throughput, the latency
+// percentiles and the CPU utilization are reported per configuration.
+//
+// Requests arrive open-loop, as a Poisson process of rate qps / clients per
+// client, and their latency is measured from the time they were due, so that
+// the time they wait behind slow requests counts as it would for a server.
+// By default every client has its own Predictor, as a Predictor runs one
+// request at a time; run with --caffe2_predictor_share_parameters to share
+// their weights. With --concurrent the clients share a ConcurrentPredictor
+// instead, and with --batching their requests go through a
+// BatchingPredictor in front of it. --arena_allocator makes the workspaces
+// of the predictors allocate from an ArenaCPUAllocator.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/batching_predictor.h"
+#include "caffe2/core/concurrent_predictor.h"
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/predictor.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/proto_utils.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_string(
+    meta_net_def,
+    "",
+    "The given path to the MetaNetDef of the model. Alternative to init_net "
+    "and predict_net.");
+CAFFE2_DEFINE_string(init_net, "", "The given path to the init protobuffer.");
+CAFFE2_DEFINE_string(
+    predict_net,
+    "",
+    "The given path to the predict protobuffer.");
+CAFFE2_DEFINE_string(
+    input_dims,
+    "",
+    "The dimensions of the inputs of the predict net, without the batch "
+    "dimension, as comma separated numbers. Use semicolon to separate the "
+    "dimensions of different inputs.");
+CAFFE2_DEFINE_string(
+    input_types,
+    "",
+    "Comma separated types of the inputs (float/int32/int64), float by "
+    "default.");
+CAFFE2_DEFINE_int(
+    max_int_input,
+    1000,
+    "Integer inputs are drawn uniformly from [0, max_int_input).");
+CAFFE2_DEFINE_string(
+    batch_sizes,
+    "1",
+    "Comma separated batch sizes, every request draws one of them.");
+CAFFE2_DEFINE_string(
+    clients,
+    "1",
+    "Comma separated numbers of client threads to benchmark.");
+CAFFE2_DEFINE_string(
+    qps,
+    "0",
+    "Comma separated total request rates to benchmark, 0 sends requests "
+    "back to back.");
+CAFFE2_DEFINE_double(
+    duration,
+    10,
+    "The number of seconds to send requests for, per configuration.");
+CAFFE2_DEFINE_int(warmup, 10, "The number of warm up requests per client.");
+CAFFE2_DEFINE_bool(
+    concurrent,
+    false,
+    "If set, all the clients share one ConcurrentPredictor instead of having "
+    "a Predictor each.");
+CAFFE2_DEFINE_int(
+    max_instances,
+    0,
+    "The maximum number of nets the ConcurrentPredictor runs at the same "
+    "time, 0 for no limit.");
+CAFFE2_DEFINE_bool(
+    batching,
+    false,
+    "If set, requests go through a BatchingPredictor in front of the "
+    "ConcurrentPredictor. Implies --concurrent.");
+CAFFE2_DEFINE_int(
+    max_batch_size,
+    32,
+    "The maximum number of rows the BatchingPredictor puts in a batch.");
+CAFFE2_DEFINE_int(
+    max_batch_latency_us,
+    1000,
+    "The maximum time a request waits for others to join its batch, in "
+    "microseconds.");
+CAFFE2_DEFINE_int(
+    batching_threads,
+    1,
+    "The number of batches the BatchingPredictor runs at the same time.");
+CAFFE2_DEFINE_bool(
+    arena_allocator,
+    false,
+    "If set, the workspaces of the predictors allocate from an "
+    "ArenaCPUAllocator, reset at the end of every run.");
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace caffe2 {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Seconds of CPU time used by all the threads of the process
+double ProcessCpuSeconds() {
+#ifndef _WIN32
+  struct rusage usage;
+  CAFFE_ENFORCE_EQ(getrusage(RUSAGE_SELF, &usage), 0);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+      (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#else
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+vector<int> ParseInts(const string& list) {
+  vector<int> values;
+  for (const auto& value : split(',', list)) {
+    values.push_back(std::stoi(value));
+  }
+  return values;
+}
+
+const NetDef& GetNet(const MetaNetDef& meta_net_def, const string& key) {
+  for (const auto& net : meta_net_def.nets()) {
+    if (net.key() == key) {
+      return net.value();
+    }
+  }
+  CAFFE_THROW("Net not found in the MetaNetDef: ", key);
+}
+
+// The init and predict nets of the model
+void ReadNets(NetDef* init_net, NetDef* predict_net) {
+  if (!FLAGS_meta_net_def.empty()) {
+    MetaNetDef meta_net_def;
+    CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_meta_net_def, &meta_net_def));
+    const auto& consts = PredictorConsts::default_instance();
+    *init_net = GetNet(meta_net_def, consts.global_init_net_type());
+    *predict_net = GetNet(meta_net_def, consts.predict_net_type());
+    return;
+  }
+  CAFFE_ENFORCE(
+      !FLAGS_init_net.empty() && !FLAGS_predict_net.empty(),
+      "Use --meta_net_def, or --init_net and --predict_net.");
+  CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_init_net, init_net));
+  CAFFE_ENFORCE(ReadProtoFromFile(FLAGS_predict_net, predict_net));
+}
+
+// Parent of the workspaces of the predictors, to set their allocator
+unique_ptr<Workspace> CreateParentWorkspace() {
+  unique_ptr<Workspace> ws(new Workspace());
+  if (FLAGS_arena_allocator) {
+    ws->SetCPUAllocator(std::make_shared<ArenaCPUAllocator>());
+  }
+  return ws;
+}
+
+// The predictors the clients send their requests to: a Predictor per
+// client, or a ConcurrentPredictor shared by all of them, optionally behind
+// a BatchingPredictor
+class Server {
+ public:
+  explicit Server(size_t num_clients) {
+    ReadNets(&init_net_, &predict_net_);
+    if (FLAGS_concurrent || FLAGS_batching) {
+      // One arena for all the instances, it is thread safe
+      parent_workspaces_.push_back(CreateParentWorkspace());
+      concurrent_.reset(new ConcurrentPredictor(
+          init_net_,
+          predict_net_,
+          FLAGS_max_instances,
+          parent_workspaces_.back().get()));
+    } else {
+      for (size_t i = 0; i < num_clients; i++) {
+        parent_workspaces_.push_back(CreateParentWorkspace());
+        predictors_.emplace_back(new Predictor(
+            init_net_, predict_net_, parent_workspaces_.back().get()));
+      }
+    }
+    if (FLAGS_batching) {
+      BatchingPredictor::Options options;
+      options.max_batch_size = FLAGS_max_batch_size;
+      options.max_latency =
+          std::chrono::microseconds(FLAGS_max_batch_latency_us);
+      options.num_threads = FLAGS_batching_threads;
+      batching_.reset(new BatchingPredictor(concurrent_.get(), options));
+    }
+  }
+
+  // Runs a request of the given client
+  void Run(size_t client, const Predictor::TensorVector& inputs) {
+    if (batching_) {
+      Predictor::TensorMap input_map;
+      for (size_t i = 0; i < inputs.size(); i++) {
+        input_map[predict_net_.external_input(i)] = inputs[i];
+      }
+      batching_->run_map(input_map).get();
+    } else if (concurrent_) {
+      ConcurrentPredictor::OutputTensorVector outputs;
+      CAFFE_ENFORCE(concurrent_->run(inputs, &outputs));
+    } else {
+      Predictor::TensorVector outputs;
+      CAFFE_ENFORCE(predictors_[client]->run(inputs, &outputs));
+    }
+  }
+
+ private:
+  NetDef init_net_;
+  NetDef predict_net_;
+  // Declared first so that they outlive the predictors
+  vector<unique_ptr<Workspace>> parent_workspaces_;
+  vector<unique_ptr<Predictor>> predictors_;
+  unique_ptr<ConcurrentPredictor> concurrent_;
+  unique_ptr<BatchingPredictor> batching_;
+};
+
+// The inputs of a request of every batch size
+class Inputs {
+ public:
+  Inputs(const vector<int>& batch_sizes, std::mt19937* gen) {
+    vector<string> types;
+    if (!FLAGS_input_types.empty()) {
+      types = split(',', FLAGS_input_types);
+    }
+    const auto all_dims = split(';', FLAGS_input_dims);
+    for (int batch_size : batch_sizes) {
+      tensors_.emplace_back();
+      for (size_t i = 0; i < all_dims.size(); i++) {
+        vector<TIndex> dims{batch_size};
+        for (const auto& dim : split(',', all_dims[i])) {
+          dims.push_back(std::stoll(dim));
+        }
+        const string type = i < types.size() ? types[i] : "float";
+        tensors_.back().emplace_back(new TensorCPU(dims));
+        Fill(type, tensors_.back().back().get(), gen);
+      }
+      vectors_.emplace_back();
+      for (auto& tensor : tensors_.back()) {
+        vectors_.back().push_back(tensor.get());
+      }
+    }
+  }
+
+  const Predictor::TensorVector& Get(int batch_size_idx) const {
+    return vectors_[batch_size_idx];
+  }
+
+ private:
+  static void Fill(const string& type, TensorCPU* tensor, std::mt19937* gen) {
+    if (type == "float") {
+      std::uniform_real_distribution<float> dist(-1, 1);
+      auto* data = tensor->mutable_data<float>();
+      std::generate(data, data + tensor->size(), [&]() { return dist(*gen); });
+    } else if (type == "int32" || type == "int64") {
+      std::uniform_int_distribution<int64_t> dist(0, FLAGS_max_int_input - 1);
+      if (type == "int32") {
+        auto* data = tensor->mutable_data<int32_t>();
+        std::generate(
+            data, data + tensor->size(), [&]() { return dist(*gen); });
+      } else {
+        auto* data = tensor->mutable_data<int64_t>();
+        std::generate(
+            data, data + tensor->size(), [&]() { return dist(*gen); });
+      }
+    } else {
+      CAFFE_THROW("Unknown input type: ", type);
+    }
+  }
+
+  vector<vector<unique_ptr<TensorCPU>>> tensors_;
+  vector<Predictor::TensorVector> vectors_;
+};
+
+struct Client {
+  size_t id = 0;
+  unique_ptr<Inputs> inputs;
+  std::mt19937 gen;
+  // Latencies of the requests of the last configuration, in milliseconds
+  vector<double> latencies;
+  TIndex num_items = 0;
+};
+
+// Sends requests for FLAGS_duration seconds from start at the given rate,
+// back to back if it is 0
+void RunClient(
+    Server* server,
+    Client* client,
+    const vector<int>& batch_sizes,
+    double rate,
+    Clock::time_point start) {
+  std::exponential_distribution<double> interval(rate > 0 ? rate : 1);
+  std::uniform_int_distribution<int> batch_size_idx(0, batch_sizes.size() - 1);
+  const auto end = start +
+      std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double>(FLAGS_duration));
+  client->latencies.clear();
+  client->num_items = 0;
+
+  auto due = start;
+  while (true) {
+    if (rate > 0) {
+      due += std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(interval(client->gen)));
+      if (due >= end) {
+        break;
+      }
+      std::this_thread::sleep_until(due);
+    } else {
+      due = Clock::now();
+      if (due >= end) {
+        break;
+      }
+    }
+    const int idx = batch_size_idx(client->gen);
+    server->Run(client->id, client->inputs->Get(idx));
+    client->latencies.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - due)
+            .count());
+    client->num_items += batch_sizes[idx];
+  }
+}
+
+double Percentile(const vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  const size_t idx = static_cast<size_t>(p * sorted.size());
+  return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void Benchmark(
+    Server* server,
+    vector<Client>* all_clients,
+    const vector<int>& batch_sizes,
+    int num_clients,
+    double qps) {
+  const double cpu_start = ProcessCpuSeconds();
+  const auto start = Clock::now();
+  vector<std::thread> threads;
+  for (int i = 0; i < num_clients; i++) {
+    threads.emplace_back(
+        RunClient,
+        server,
+        &(*all_clients)[i],
+        batch_sizes,
+        qps / num_clients,
+        start);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  const double cpu_seconds = ProcessCpuSeconds() - cpu_start;
+
+  vector<double> latencies;
+  TIndex num_items = 0;
+  for (int i = 0; i < num_clients; i++) {
+    const auto& client = (*all_clients)[i];
+    latencies.insert(
+        latencies.end(), client.latencies.begin(), client.latencies.end());
+    num_items += client.num_items;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  printf(
+      "clients %d, target qps %.1f: %zu requests, throughput %.1f "
+      "requests/sec, %.1f items/sec, latency p50 %.3f ms, p99 %.3f ms, "
+      "p999 %.3f ms, cpu %.1f%% of %u cores\n",
+      num_clients,
+      qps,
+      latencies.size(),
+      latencies.size() / seconds,
+      num_items / seconds,
+      Percentile(latencies, 0.5),
+      Percentile(latencies, 0.99),
+      Percentile(latencies, 0.999),
+      100 * cpu_seconds / seconds / std::thread::hardware_concurrency(),
+      std::thread::hardware_concurrency());
+}
+
+void Run() {
+  const auto batch_sizes = ParseInts(FLAGS_batch_sizes);
+  const auto clients = ParseInts(FLAGS_clients);
+  vector<double> qps;
+  for (const auto& value : split(',', FLAGS_qps)) {
+    qps.push_back(std::stod(value));
+  }
+  CAFFE_ENFORCE(!batch_sizes.empty() && !clients.empty() && !qps.empty());
+
+  vector<Client> all_clients(*std::max_element(clients.begin(), clients.end()));
+  Server server(all_clients.size());
+  for (size_t i = 0; i < all_clients.size(); i++) {
+    auto& client = all_clients[i];
+    client.id = i;
+    client.gen.seed(i);
+    client.inputs.reset(new Inputs(batch_sizes, &client.gen));
+    for (int j = 0; j < FLAGS_warmup; j++) {
+      server.Run(i, client.inputs->Get(j % batch_sizes.size()));
+    }
+  }
+
+  for (int num_clients : clients) {
+    CAFFE_ENFORCE_GT(num_clients, 0);
+    for (double rate : qps) {
+      Benchmark(&server, &all_clients, batch_sizes, num_clients, rate);
+    }
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  caffe2::Run();
+  // This is to allow us to use memory leak checks.
+  caffe2::ShutdownProtobufLibrary();
+  return 0;
+}
@@ -14,11 +14,22 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include "caffe2/core/init.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/observer.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/proto_utils.h"
 #include "caffe2/utils/string_utils.h"
@@ -70,6 +81,34 @@ CAFFE2_DEFINE_bool(
     false,
     "Whether to benchmark individual operators.");
 
+CAFFE2_DEFINE_bool(
+    report_json,
+    false,
+    "Report the cold and warm run times of the net, and with run_individual "
+    "of every operator and engine, as JSON lines in the format of the "
+    "observers' NetObserverReporterPrint.");
+CAFFE2_DEFINE_bool(
+    wait_for_stable_frequency,
+    false,
+    "With report_json, run the net until the CPU frequencies are stable "
+    "before measuring, and run again the iterations during which they "
+    "dropped, i.e. the CPU was throttled.");
+CAFFE2_DEFINE_int(
+    max_stabilize_runs,
+    50,
+    "The most runs to wait for stable frequencies, and to run again "
+    "throttled iterations.");
+CAFFE2_DEFINE_bool(
+    sample_battery,
+    false,
+    "With report_json, sample the current drawn from the battery (Android "
+    "power_supply) during the main runs, and report the average current "
+    "and the energy per iteration.");
+CAFFE2_DEFINE_int(
+    battery_sample_interval_ms,
+    10,
+    "The interval between two battery samples, in milliseconds.");
+
 CAFFE2_DEFINE_bool(force_engine, false, "Force engine field for all operators");
 CAFFE2_DEFINE_string(engine, "", "Forced engine field value");
 CAFFE2_DEFINE_bool(force_algo, false, "Force algo arg for all operators");
@@ -79,6 +118,367 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+namespace caffe2 {
+namespace {
+
+// The prefix of the lines of NetObserverReporterPrint
+const char kIdentifier[] = "Caffe2Observer ";
+
+string JsonString(const string& s) {
+  string escaped = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped + "\"";
+}
+
+void ReportJson(
+    const string& net,
+    const string& type,
+    const string& metric,
+    const string& unit,
+    double value,
+    const std::map<string, string>& info = {}) {
+  std::stringstream line;
+  line << kIdentifier << "{\"net\": " << JsonString(net)
+       << ", \"type\": " << JsonString(type)
+       << ", \"metric\": " << JsonString(metric)
+       << ", \"unit\": " << JsonString(unit) << ", \"value\": " << value;
+  for (const auto& kv : info) {
+    line << ", " << JsonString(kv.first) << ": " << JsonString(kv.second);
+  }
+  line << "}";
+  std::cout << line.str() << std::endl;
+}
+
+// Accumulates the time of an operator over runs. The GPU backends wait for
+// their observed operators, so that this is the time of their GPU work.
+class OperatorTimeObserver final : public ObserverBase<OperatorBase> {
+ public:
+  explicit OperatorTimeObserver(OperatorBase* op)
+      : ObserverBase<OperatorBase>(op) {}
+
+  void Start() override {
+    timer_.Start();
+  }
+
+  void Stop() override {
+    milliseconds_ += timer_.MilliSeconds();
+  }
+
+  double milliseconds() const {
+    return milliseconds_;
+  }
+
+  void reset() {
+    milliseconds_ = 0;
+  }
+
+ private:
+  Timer timer_;
+  double milliseconds_ = 0;
+};
+
+// The name of an operator in the reports of PerfNetObserver
+string OperatorName(const OperatorBase& op, int idx) {
+  if (!op.has_debug_def()) {
+    return "ID_" + caffe2::to_string(idx) + "_NO_TYPE_NO_DEF";
+  }
+  const auto& def = op.debug_def();
+  const string& name = def.name().size()
+      ? def.name()
+      : (def.output_size() ? def.output(0) : "NO_OUTPUT");
+  return "ID_" + caffe2::to_string(idx) + "_" + def.type() + "_" + name;
+}
+
+string OperatorEngine(const OperatorBase& op) {
+  if (op.device_option().device_type() == OPENGL) {
+    return "OPENGL";
+  }
+  if (!op.has_debug_def()) {
+    return "CPU";
+  }
+  const auto& def = op.debug_def();
+  if (def.type() == "SNPE") {
+    return "SNPE";
+  }
+  return def.engine().empty() ? "CPU" : def.engine();
+}
+
+// The current frequencies of the cores in kHz, 0 when unknown
+vector<int64_t> CpuFrequencies() {
+  vector<int64_t> frequencies;
+  for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+    std::ifstream file(
+        "/sys/devices/system/cpu/cpu" + caffe2::to_string(cpu) +
+        "/cpufreq/scaling_cur_freq");
+    int64_t frequency = 0;
+    if (!(file >> frequency)) {
+      frequency = 0;
+    }
+    frequencies.push_back(frequency);
+  }
+  return frequencies;
+}
+
+// Whether no core changed its frequency by more than tolerance from
+// reference, or, with drops_only, dropped it by more than tolerance
+bool FrequenciesMatch(
+    const vector<int64_t>& reference,
+    const vector<int64_t>& current,
+    double tolerance,
+    bool drops_only) {
+  for (size_t i = 0; i < std::min(reference.size(), current.size()); ++i) {
+    const double change = static_cast<double>(current[i] - reference[i]);
+    const double limit = tolerance * std::max(reference[i], current[i]);
+    if (drops_only ? -change > limit : std::abs(change) > limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Samples the current and voltage of the battery in a thread
+class BatterySampler {
+ public:
+  static constexpr const char* kCurrent =
+      "/sys/class/power_supply/battery/current_now";
+  static constexpr const char* kVoltage =
+      "/sys/class/power_supply/battery/voltage_now";
+
+  ~BatterySampler() {
+    Stop();
+  }
+
+  bool Start(int interval_ms) {
+    double current, voltage;
+    if (!Read(kCurrent, &current) || !Read(kVoltage, &voltage)) {
+      LOG(WARNING) << "Battery current and voltage can't be read from "
+                   << kCurrent << " and " << kVoltage;
+      return false;
+    }
+    stop_ = false;
+    thread_ = std::thread([this, interval_ms]() {
+      while (!stop_) {
+        double current, voltage;
+        if (Read(kCurrent, &current) && Read(kVoltage, &voltage)) {
+          // current_now is in uA, voltage_now in uV, and the sign of the
+          // current of a discharging battery differs between devices
+          milliamps_ += std::abs(current) * 1e-3;
+          milliwatts_ += std::abs(current) * voltage * 1e-9;
+          ++samples_;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+      }
+    });
+    return true;
+  }
+
+  void Stop() {
+    stop_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  double AverageMilliamps() const {
+    return samples_ ? milliamps_ / samples_ : 0;
+  }
+
+  double AverageMilliwatts() const {
+    return samples_ ? milliwatts_ / samples_ : 0;
+  }
+
+ private:
+  static bool Read(const char* path, double* value) {
+    std::ifstream file(path);
+    return static_cast<bool>(file >> *value);
+  }
+
+  std::thread thread_;
+  std::atomic<bool> stop_{true};
+  double milliamps_ = 0;
+  double milliwatts_ = 0;
+  int samples_ = 0;
+};
+
+constexpr const char* BatterySampler::kCurrent;
+constexpr const char* BatterySampler::kVoltage;
+
+// Runs the net once, and again after cooling down while the frequencies
+// dropped below the reference ones, unless reference is empty. Returns the
+// run time in milliseconds and counts the throttled runs.
+float TimedRun(
+    NetBase* net,
+    const vector<int64_t>& reference,
+    int* throttled_runs) {
+  for (;;) {
+    Timer timer;
+    CAFFE_ENFORCE(net->Run(), "Net run has failed.");
+    const float millis = timer.MilliSeconds();
+    if (reference.empty() ||
+        FrequenciesMatch(reference, CpuFrequencies(), 0.1, true) ||
+        *throttled_runs >= FLAGS_max_stabilize_runs) {
+      return millis;
+    }
+    ++*throttled_runs;
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+  }
+}
+
+// Benchmarks the net like TEST_Benchmark, reporting JSON lines: the first
+// (cold) run, which includes the one time setup of the operators, the
+// average of the main (warm) runs, and with run_individual every operator
+// and the total per engine.
+void BenchmarkJson(NetBase* net) {
+  const auto operators = net->GetOperators();
+  vector<const OperatorTimeObserver*> observers;
+  auto attach = [&]() {
+    for (auto* op : operators) {
+      observers.push_back(static_cast<const OperatorTimeObserver*>(
+          op->AttachObserver(make_unique<OperatorTimeObserver>(op))));
+    }
+  };
+  auto detach = [&]() {
+    for (int i = 0; i < operators.size(); ++i) {
+      operators[i]->DetachObserver(observers[i]);
+    }
+    observers.clear();
+  };
+  auto report_operators = [&](const string& run, int runs) {
+    std::map<string, double> engines;
+    for (int i = 0; i < operators.size(); ++i) {
+      const auto engine = OperatorEngine(*operators[i]);
+      const double millis = observers[i]->milliseconds() / runs;
+      engines[engine] += millis;
+      ReportJson(
+          net->Name(),
+          OperatorName(*operators[i], i),
+          "latency",
+          "ms",
+          millis,
+          {{"engine", engine}, {"run", run}});
+    }
+    for (const auto& kv : engines) {
+      ReportJson(
+          net->Name(),
+          "ENGINE_" + kv.first,
+          "latency",
+          "ms",
+          kv.second,
+          {{"run", run}});
+    }
+  };
+
+  int throttled_runs = 0;
+  if (FLAGS_run_individual) {
+    attach();
+  }
+  Timer timer;
+  CAFFE_ENFORCE(net->Run(), "Cold run has failed.");
+  ReportJson(
+      net->Name(),
+      "NET_DELAY",
+      "latency",
+      "ms",
+      timer.MilliSeconds(),
+      {{"run", "cold"}});
+  if (FLAGS_run_individual) {
+    report_operators("cold", 1);
+    detach();
+  }
+
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    CAFFE_ENFORCE(net->Run(), "Warmup run ", i, " has failed.");
+  }
+
+  vector<int64_t> reference;
+  if (FLAGS_wait_for_stable_frequency) {
+    auto previous = CpuFrequencies();
+    bool stable = false;
+    for (int i = 0; i < FLAGS_max_stabilize_runs && !stable; ++i) {
+      CAFFE_ENFORCE(net->Run(), "Stabilization run ", i, " has failed.");
+      reference = CpuFrequencies();
+      stable = FrequenciesMatch(previous, reference, 0.05, false);
+      previous = reference;
+    }
+    if (!stable) {
+      LOG(WARNING) << "The CPU frequencies did not stabilize in "
+                   << FLAGS_max_stabilize_runs << " runs";
+    }
+    if (std::all_of(reference.begin(), reference.end(), [](int64_t f) {
+          return f == 0;
+        })) {
+      LOG(WARNING) << "The CPU frequencies can't be read, throttling is not "
+                      "detected";
+      reference.clear();
+    }
+  }
+
+  BatterySampler battery;
+  const bool sample_battery = FLAGS_sample_battery &&
+      battery.Start(FLAGS_battery_sample_interval_ms);
+  vector<float> times;
+  for (int i = 0; i < FLAGS_iter; ++i) {
+    times.push_back(TimedRun(net, reference, &throttled_runs));
+  }
+  battery.Stop();
+  if (!times.empty()) {
+    double total = 0;
+    for (auto t : times) {
+      total += t;
+    }
+    const double mean = total / times.size();
+    std::sort(times.begin(), times.end());
+    ReportJson(
+        net->Name(),
+        "NET_DELAY",
+        "latency",
+        "ms",
+        mean,
+        {{"run", "warm"},
+         {"min", caffe2::to_string(times.front())},
+         {"p50", caffe2::to_string(times[times.size() / 2])},
+         {"max", caffe2::to_string(times.back())}});
+    if (sample_battery) {
+      ReportJson(
+          net->Name(),
+          "NET_DELAY",
+          "current",
+          "mA",
+          battery.AverageMilliamps(),
+          {{"run", "warm"}});
+      // mW * ms = uJ
+      ReportJson(
+          net->Name(),
+          "NET_DELAY",
+          "energy",
+          "mJ",
+          battery.AverageMilliwatts() * mean * 1e-3,
+          {{"run", "warm"}});
+    }
+  }
+  if (FLAGS_wait_for_stable_frequency) {
+    ReportJson(
+        net->Name(), "THERMAL", "throttled_runs", "count", throttled_runs);
+  }
+
+  if (FLAGS_run_individual && FLAGS_iter > 0) {
+    attach();
+    for (int i = 0; i < FLAGS_iter; ++i) {
+      CAFFE_ENFORCE(net->Run(), "Operator run ", i, " has failed.");
+    }
+    report_operators("warm", FLAGS_iter);
+    detach();
+  }
+}
+
+} // namespace
+} // namespace caffe2
+
 int main(int argc, char** argv) {
   caffe2::GlobalInit(&argc, &argv);
   unique_ptr<caffe2::Workspace> workspace(new caffe2::Workspace());
@@ -167,8 +567,12 @@ int main(int argc, char** argv) {
   }
   caffe2::NetBase* net = workspace->CreateNet(net_def);
   CHECK_NOTNULL(net);
-  net->TEST_Benchmark(
-      caffe2::FLAGS_warmup, caffe2::FLAGS_iter, caffe2::FLAGS_run_individual);
+  if (caffe2::FLAGS_report_json) {
+    caffe2::BenchmarkJson(net);
+  } else {
+    net->TEST_Benchmark(
+        caffe2::FLAGS_warmup, caffe2::FLAGS_iter, caffe2::FLAGS_run_individual);
+  }
 
   string output_prefix = caffe2::FLAGS_output_folder.size()
       ? caffe2::FLAGS_output_folder + "/"
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput (tasks/sec) of the thread pools used by the async
+// nets on tiny tasks, where the cost of submitting a task dominates.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/init.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/utils/lock_free_thread_pool.h"
+#include "caffe2/utils/string_utils.h"
+#include "caffe2/utils/thread_pool.h"
+#include "caffe2/utils/work_stealing_thread_pool.h"
+
+CAFFE2_DEFINE_int(pool_size, 4, "Number of threads in the pool.");
+CAFFE2_DEFINE_int(
+    num_producers,
+    1,
+    "Number of threads submitting tasks from outside of the pool.");
+CAFFE2_DEFINE_int(num_tasks, 1000000, "Number of tasks per iteration.");
+CAFFE2_DEFINE_int(
+    task_work,
+    0,
+    "Number of loop iterations executed by every task, simulates op cost.");
+CAFFE2_DEFINE_int(repeat, 5, "The number of iterations per pool type.");
+CAFFE2_DEFINE_string(
+    pool_types,
+    "default,lock_free,work_stealing",
+    "Comma separated list of pool types to benchmark.");
+
+namespace caffe2 {
+
+std::unique_ptr<TaskThreadPoolBase> CreatePool(const string& type) {
+  if (type == "default") {
+    return std::unique_ptr<TaskThreadPoolBase>(
+        new TaskThreadPool(FLAGS_pool_size));
+  } else if (type == "lock_free") {
+    return std::unique_ptr<TaskThreadPoolBase>(
+        new LockFreeThreadPool(FLAGS_pool_size));
+  } else if (type == "work_stealing") {
+    return std::unique_ptr<TaskThreadPoolBase>(
+        new WorkStealingThreadPool(FLAGS_pool_size));
+  }
+  CAFFE_THROW("Unknown pool type: ", type);
+}
+
+void BenchmarkPool(const string& type) {
+  auto pool = CreatePool(type);
+  const int num_tasks = FLAGS_num_tasks / FLAGS_num_producers;
+  const int total_tasks = num_tasks * FLAGS_num_producers;
+
+  for (int iter_id = 0; iter_id < FLAGS_repeat; ++iter_id) {
+    std::atomic<int> count(0);
+    std::mutex mutex;
+    std::condition_variable cv;
+    auto task = [&]() {
+      volatile int sink = 0;
+      for (int i = 0; i < FLAGS_task_work; ++i) {
+        sink = sink + i;
+      }
+      if (++count == total_tasks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    };
+
+    Timer timer;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < FLAGS_num_producers; ++p) {
+      producers.emplace_back([&]() {
+        for (int i = 0; i < num_tasks; ++i) {
+          pool->run(task);
+        }
+      });
+    }
+    for (auto& producer : producers) {
+      producer.join();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return count == total_tasks; });
+    }
+    double elapsed_seconds = timer.Seconds();
+    printf(
+        "Pool %s iteration %03d, took %4.5f seconds, throughput %f "
+        "tasks/sec.\n",
+        type.c_str(),
+        iter_id,
+        elapsed_seconds,
+        total_tasks / elapsed_seconds);
+  }
+}
+
+} // namespace caffe2
+
+int main(int argc, char** argv) {
+  caffe2::GlobalInit(&argc, &argv);
+  CAFFE_ENFORCE_GT(caffe2::FLAGS_num_producers, 0);
+  for (const auto& type : caffe2::split(',', caffe2::FLAGS_pool_types)) {
+    caffe2::BenchmarkPool(type);
+  }
+  return 0;
+}
@@ -17,6 +17,14 @@
 // This binary provides an easy way to open a zeromq server and feeds data to
 // clients connect to it. It uses the Caffe2 db as the backend, thus allowing
 // one to convert any db-compliant storage to a zeromq service.
+//
+// With --batch_size, records are sent in batches to ZmqDB clients that use
+// credits (see caffe2/db/zmqdb.cc for the protocol); each client receives
+// only as many batches as it has granted.
+
+#include <cstring>
+#include <iterator>
+#include <map>
 
 #include "caffe2/core/db.h"
 #include "caffe2/core/init.h"
@@ -26,11 +34,78 @@
 CAFFE2_DEFINE_string(server, "tcp://*:5555", "The server address.");
 CAFFE2_DEFINE_string(input_db, "", "The input db.");
 CAFFE2_DEFINE_string(input_db_type, "", "The input db type.");
+CAFFE2_DEFINE_int(
+    batch_size,
+    0,
+    "Records per batch of the credit based protocol. If 0, records are "
+    "pushed one at a time to clients without credits.");
 
 using caffe2::db::DB;
 using caffe2::db::Cursor;
 using caffe2::string;
 
+// Sends batches round robin to the clients that have credits left, and
+// otherwise waits for credits.
+void ServeBatches(Cursor* cursor) {
+  caffe2::ZmqSocket sender(ZMQ_ROUTER);
+  sender.Bind(caffe2::FLAGS_server);
+  LOG(INFO) << "Batched server created at " << caffe2::FLAGS_server;
+
+  // Remaining credits per client identity
+  std::map<string, int> credits;
+  int total_credits = 0;
+  string last_client;
+  while (1) {
+    // Takes the pending credit messages, and blocks for one if no client has
+    // credits left
+    while (1) {
+      caffe2::ZmqMessage identity;
+      if (!sender.TryRecv(&identity, total_credits > 0 ? ZMQ_DONTWAIT : 0)) {
+        if (total_credits > 0) {
+          break;
+        }
+        continue;
+      }
+      caffe2::ZmqMessage grant;
+      sender.RecvTillSuccess(&grant);
+      uint32_t count = 0;
+      CAFFE_ENFORCE_EQ(grant.size(), sizeof(count), "Invalid credit message");
+      memcpy(&count, grant.data(), sizeof(count));
+      credits[string(static_cast<char*>(identity.data()), identity.size())] +=
+          count;
+      total_credits += count;
+    }
+
+    auto it = credits.upper_bound(last_client);
+    while (it == credits.end() || it->second == 0) {
+      it = (it == credits.end()) ? credits.begin() : std::next(it);
+    }
+    last_client = it->first;
+    --it->second;
+    --total_credits;
+
+    caffe2::ZmqMessage identity{string(last_client)};
+    sender.SendMessage(&identity, ZMQ_SNDMORE);
+    const uint32_t count = caffe2::FLAGS_batch_size;
+    sender.SendTillSuccess(
+        string(reinterpret_cast<const char*>(&count), sizeof(count)),
+        ZMQ_SNDMORE);
+    for (int i = 0; i < caffe2::FLAGS_batch_size; ++i) {
+      // The strings are handed to zmq without copying them
+      caffe2::ZmqMessage key(cursor->key());
+      sender.SendMessage(&key, ZMQ_SNDMORE);
+      caffe2::ZmqMessage value(cursor->value());
+      sender.SendMessage(
+          &value, i + 1 < caffe2::FLAGS_batch_size ? ZMQ_SNDMORE : 0);
+      cursor->Next();
+      if (!cursor->Valid()) {
+        cursor->SeekToFirst();
+      }
+    }
+    VLOG(1) << "Sent a batch, " << total_credits << " credits left";
+  }
+}
+
 int main(int argc, char** argv) {
   caffe2::GlobalInit(&argc, &argv);
 
@@ -46,6 +121,10 @@ int main(int argc, char** argv) {
 
   LOG(INFO) << "Starting ZeroMQ server...";
 
+  if (caffe2::FLAGS_batch_size > 0) {
+    ServeBatches(cursor.get());
+  }
+
   //  Socket to talk to clients
   caffe2::ZmqSocket sender(ZMQ_PUSH);
   sender.Bind(caffe2::FLAGS_server);
@@ -57,12 +57,34 @@ private:
   at::Type & typeFor(const Tensor<Context> & ten) {
     return at::getType(backend(), atScalarTypeFor(ten.meta()));
   }
-  at::Tensor tensorWrapping(const Tensor<Context>& ten_) {
-    auto& ten = const_cast<Tensor<Context>&>(ten_);
-    return typeFor(ten).tensorFromBlob(ten.raw_mutable_data(), ten.dims());
+  at::Tensor tensorWrapping(const Tensor<Context>& ten) {
+    // Reading through raw_data, a copy on write input isn't copied
+    return typeFor(ten).tensorFromBlob(
+        const_cast<void*>(ten.raw_data()), ten.dims());
   }
+  // The ATen tensors wrapping the inputs, reused across runs as long as the
+  // inputs keep their memory, shape and type
+  struct WrappedInput {
+    const void* data = nullptr;
+    std::vector<TIndex> dims;
+    TypeMeta meta;
+    at::Tensor tensor;
+  };
+  std::vector<WrappedInput> wrapped_inputs_;
   at::Tensor loadInput(size_t i) {
-    return tensorWrapping(Input(i));
+    const auto& ten = Input(i);
+    if (wrapped_inputs_.size() < InputSize()) {
+      wrapped_inputs_.resize(InputSize());
+    }
+    auto& wrapped = wrapped_inputs_[i];
+    if (!wrapped.tensor.defined() || wrapped.data != ten.raw_data() ||
+        wrapped.meta != ten.meta() || wrapped.dims != ten.dims()) {
+      wrapped.tensor = tensorWrapping(ten);
+      wrapped.data = ten.raw_data();
+      wrapped.dims = ten.dims();
+      wrapped.meta = ten.meta();
+    }
+    return wrapped.tensor;
   }
   std::vector<at::Tensor> loadInputsAtOffset(size_t s) {
     std::vector<at::Tensor> results;
@@ -80,11 +102,33 @@ private:
     #undef DEFINE_IF
     CAFFE_THROW("Unknown type meta"); // TODO: improve error message...
   }
+  // The input holding all of the memory of src, if any, e.g. when src is a
+  // view of it
+  const Tensor<Context>* inputSharedBy(const at::Tensor& src) {
+    for (size_t i = 0; i < InputSize(); i++) {
+      const auto& input = Input(i);
+      if (input.size() > 0 && input.raw_data() == src.data_ptr() &&
+          input.size() == src.numel() && input.meta() == typeMetaFor(src)) {
+        return &input;
+      }
+    }
+    return nullptr;
+  }
   void assignTo(Tensor<Context> * dst, const at::Tensor & src_) {
     at::Tensor src = src_.contiguous();
     auto at_sizes = src.sizes();
     std::vector<int64_t> dims(at_sizes.begin(),at_sizes.end());
     dst->Resize(dims);
+    // The ATen tensor doesn't own the memory of an input, share the input
+    // itself so that the output keeps it alive
+    const auto* input = inputSharedBy(src);
+    if (input) {
+      if (input != dst) {
+        dst->ShareData(*input);
+      }
+      return;
+    }
+    // Otherwise the output takes the memory allocated by ATen
     dst->ShareExternalPointer(
         src.data_ptr(), typeMetaFor(src), 0, [src](void* ptr) mutable {
           // return a closure that holds a handle to t until it is called
@@ -3,7 +3,7 @@ from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
 
-from caffe2.python import core, dyndep
+from caffe2.python import core, dyndep, workspace
 from hypothesis import given
 
 import caffe2.python.hypothesis_test_util as hu
@@ -80,6 +80,24 @@ class TestATen(hu.HypothesisTestCase):
 
         self.assertReferenceChecks(gc, op, [], ref)
 
+    def test_reruns(self):
+        # The wrappers of the inputs are reused while the inputs keep their
+        # shapes, and remade once they change
+        net = core.Net("reruns")
+        net.ATen(["X", "Y"], ["Z"], operator="add")
+        net.ATen(["Z"], ["W"], operator="contiguous")
+        workspace.ResetWorkspace()
+        workspace.CreateNet(net)
+        for shape in [(2, 3), (2, 3), (4, 5)]:
+            X = np.random.rand(*shape).astype(np.float32)
+            Y = np.random.rand(*shape).astype(np.float32)
+            workspace.FeedBlob("X", X)
+            workspace.FeedBlob("Y", Y)
+            workspace.RunNet(net.Name())
+            np.testing.assert_allclose(workspace.FetchBlob("Z"), X + Y)
+            # Shares the memory of its input
+            np.testing.assert_allclose(workspace.FetchBlob("W"), X + Y)
+
 
 if __name__ == "__main__":
     import unittest
@@ -20,6 +20,7 @@
 
 #include "caffe2/contrib/gloo/common.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/types.h"
 
 #include <gloo/algorithm.h>
@@ -54,8 +55,10 @@ class AllgatherOp final : public Operator<Context> {
     update(current_);
     CAFFE_ENFORCE(current_ == init_, "Inputs/outputs have changed");
 
+    CAFFE_SDT(collective_start, "gloo_allgather", (void*)this);
     try {
       algorithm_->run();
+      CAFFE_SDT(collective_done, "gloo_allgather", (void*)this);
     } catch (::gloo::IoException& ioe) {
       LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
       if (status_blob_ != "") {
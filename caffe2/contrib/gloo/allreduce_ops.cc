@@ -1,5 +1,9 @@
 #include "allreduce_ops.h"
 
+#include "caffe2/operators/fused_rowwise_8bit_conversion_ops.h"
+#include "caffe2/utils/conversions.h"
+
+#include <gloo/allgather_ring.h>
 #include <gloo/allreduce_halving_doubling.h>
 #include <gloo/allreduce_ring.h>
 #include <gloo/allreduce_ring_chunked.h>
@@ -53,6 +57,135 @@ void AllreduceOp<Context>::initializeRingChunked() {
   }
 }
 
+template <class Context>
+void AllreduceOp<Context>::initializeFused() {
+  TIndex size = 0;
+  for (const auto blob_size : fused_sizes_) {
+    size += blob_size;
+  }
+  for (auto& buffer : fused_) {
+    buffer.Resize(size);
+    buffer.raw_mutable_data(Input(1).meta());
+  }
+}
+
+template <class Context>
+void AllreduceOp<Context>::initializeCompressed() {
+  const auto size = uncompressedSize();
+  const auto rows = (size + chunk_size_ - 1) / chunk_size_;
+  compressed_.resize(num_devices_);
+  residuals_.resize(num_devices_);
+  for (auto device = 0; device < num_devices_; device++) {
+    auto& buffer = compressed_[device];
+    if (compression_ == FP16) {
+      buffer.Resize(size);
+      buffer.template mutable_data<float16>();
+    } else {
+      buffer.Resize(rows, chunk_size_ + 8);
+      buffer.template mutable_data<uint8_t>();
+    }
+
+    // Outlives the op, a residual left by a previous run is kept
+    residuals_[device] = ws_->CreateBlob(
+        OperatorBase::debug_def().output(device) + "_allreduce_residual");
+    auto* residual = residuals_[device]->template GetMutable<TensorCPU>();
+    if (residual->size() != size) {
+      residual->Resize(size);
+      math::Set<float, CPUContext>(
+          size, 0.f, residual->template mutable_data<float>(), &context_);
+    }
+  }
+  if (compression_ == INT8) {
+    const auto& context =
+        OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    gathered_.Resize(context->size * num_devices_, rows, chunk_size_ + 8);
+    gathered_.template mutable_data<uint8_t>();
+  }
+}
+
+template <class Context>
+void AllreduceOp<Context>::initializeAllgather() {
+  algorithm_.reset(new ::gloo::AllgatherRing<uint8_t>(
+      init_.context,
+      init_.template getInputs<uint8_t>(),
+      init_.template getOutput<uint8_t>(),
+      init_.size));
+}
+
+template <class Context>
+void AllreduceOp<Context>::compress() {
+  std::vector<float> row(chunk_size_);
+  std::vector<float> quantized_row(chunk_size_);
+  for (auto device = 0; device < num_devices_; device++) {
+    const auto* data = uncompressed(device);
+    const auto size = uncompressedSize();
+    auto* residual_tensor = residuals_[device]->template GetMutable<TensorCPU>();
+    CAFFE_ENFORCE_EQ(residual_tensor->size(), size, "Residual has changed");
+    auto* residual = residual_tensor->template mutable_data<float>();
+
+    if (compression_ == FP16) {
+      auto* buffer = compressed_[device].template mutable_data<float16>();
+      for (TIndex i = 0; i < size; i++) {
+        const float value = data[i] + residual[i];
+        buffer[i] = convert::cpu_float2half_rn(value);
+        residual[i] = value - convert::cpu_half2float(buffer[i]);
+      }
+      continue;
+    }
+
+    auto* buffer = compressed_[device].template mutable_data<uint8_t>();
+    for (TIndex begin = 0; begin < size; begin += chunk_size_) {
+      const auto count = std::min<TIndex>(chunk_size_, size - begin);
+      for (TIndex i = 0; i < count; i++) {
+        row[i] = data[begin + i] + residual[begin + i];
+      }
+      // Pads the last row without changing its range
+      std::fill(row.begin() + count, row.end(), row[0]);
+      auto* buffer_row = buffer + (begin / chunk_size_) * (chunk_size_ + 8);
+      FloatToFused8BitRowwiseQuantized(row.data(), 1, chunk_size_, buffer_row);
+      Fused8BitRowwiseQuantizedToFloat(
+          buffer_row, 1, chunk_size_ + 8, quantized_row.data());
+      for (TIndex i = 0; i < count; i++) {
+        residual[begin + i] = row[i] - quantized_row[i];
+      }
+    }
+  }
+}
+
+template <class Context>
+void AllreduceOp<Context>::decompress() {
+  const auto size = uncompressedSize();
+  if (compression_ == FP16) {
+    for (auto device = 0; device < num_devices_; device++) {
+      const auto* buffer = compressed_[device].template data<float16>();
+      auto* data = uncompressed(device);
+      for (TIndex i = 0; i < size; i++) {
+        data[i] = convert::cpu_half2float(buffer[i]);
+      }
+    }
+    return;
+  }
+
+  // Sums the buffers of all the devices of all the nodes in float
+  const auto rows = gathered_.dim(1);
+  std::vector<float> values(rows * chunk_size_);
+  auto* sum = uncompressed(0);
+  math::Set<float, CPUContext>(size, 0.f, sum, &context_);
+  const auto* gathered = gathered_.template data<uint8_t>();
+  for (TIndex i = 0; i < gathered_.dim(0); i++) {
+    Fused8BitRowwiseQuantizedToFloat(
+        gathered + i * rows * (chunk_size_ + 8),
+        rows,
+        chunk_size_ + 8,
+        values.data());
+    math::Add<float, CPUContext>(size, sum, values.data(), sum, &context_);
+  }
+  for (auto device = 1; device < num_devices_; device++) {
+    context_.template Copy<float, CPUContext, CPUContext>(
+        size, sum, uncompressed(device));
+  }
+}
+
 namespace {
 
 REGISTER_CPU_OPERATOR_WITH_ENGINE(Allreduce, GLOO, AllreduceOp<CPUContext>);
@@ -4,6 +4,7 @@
 
 #include "caffe2/contrib/gloo/common.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/utils/math.h"
 
 #include <gloo/algorithm.h>
@@ -16,6 +17,7 @@ namespace gloo {
 template <class Context>
 class AllreduceOp final : public Operator<Context> {
   enum Mode { RING_FULL, RING_CHUNKED, HALVING_DOUBLING };
+  enum Compression { NONE, FP16, INT8 };
 
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
@@ -26,10 +28,47 @@ class AllreduceOp final : public Operator<Context> {
         status_blob_(
             OperatorBase::GetSingleArgument<std::string>("status_blob", "")),
         gpu_direct_(
-            OperatorBase::GetSingleArgument<bool>("gpu_direct", false)) {
+            OperatorBase::GetSingleArgument<bool>("gpu_direct", false)),
+        num_devices_(OperatorBase::GetSingleArgument<int>(
+            "num_devices",
+            InputSize() - 1)),
+        chunk_size_(OperatorBase::GetSingleArgument<int>(
+            "compression_chunk_size",
+            256)) {
     if (status_blob_ != "") {
       ws_->CreateBlob(status_blob_);
     }
+    CAFFE_ENFORCE_GT(num_devices_, 0);
+    CAFFE_ENFORCE_EQ(
+        (InputSize() - 1) % num_devices_,
+        0,
+        "Allreduce needs the same blobs on all the devices");
+    num_blobs_ = (InputSize() - 1) / num_devices_;
+
+    const auto compression =
+        OperatorBase::GetSingleArgument<std::string>("compression", "");
+    if (compression == "") {
+      compression_ = NONE;
+    } else if (compression == "fp16") {
+      compression_ = FP16;
+    } else if (compression == "int8") {
+      compression_ = INT8;
+    } else {
+      CAFFE_THROW("Unknown compression: ", compression);
+    }
+    CAFFE_ENFORCE_GT(chunk_size_, 0);
+
+    const auto algorithm = OperatorBase::GetSingleArgument<std::string>(
+        "algorithm", "halving_doubling");
+    if (algorithm == "halving_doubling") {
+      mode_ = HALVING_DOUBLING;
+    } else if (algorithm == "ring") {
+      mode_ = RING_FULL;
+    } else if (algorithm == "ring_chunked") {
+      mode_ = RING_CHUNKED;
+    } else {
+      CAFFE_THROW("Unknown algorithm: ", algorithm);
+    }
   }
 
   virtual ~AllreduceOp() {}
@@ -41,9 +80,22 @@ class AllreduceOp final : public Operator<Context> {
     // algorithm is invalid and cannot be used.
     update(current_);
     CAFFE_ENFORCE(current_ == init_, "Inputs/outputs have changed");
+    if (buffered()) {
+      CAFFE_ENFORCE(fusedSizes() == fused_sizes_, "Input sizes have changed");
+      if (num_blobs_ > 1) {
+        copyFused(true /* pack */);
+      }
+      if (compression_ != NONE) {
+        compress();
+      }
+      // The algorithm reads the buffers outside of the stream of the op
+      context_.FinishDeviceComputation();
+    }
 
+    CAFFE_SDT(collective_start, "gloo_allreduce", (void*)this);
     try {
       algorithm_->run();
+      CAFFE_SDT(collective_done, "gloo_allreduce", (void*)this);
     } catch (::gloo::IoException& ioe) {
       LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
       if (status_blob_ != "") {
@@ -53,17 +105,62 @@ class AllreduceOp final : public Operator<Context> {
         throw ioe;
       }
     }
+    if (compression_ != NONE) {
+      decompress();
+    }
+    if (num_blobs_ > 1) {
+      copyFused(false /* pack */);
+    }
     return true;
   }
 
  protected:
   void initialize() {
-    Mode mode = HALVING_DOUBLING;
-    auto bytes = Input(1).nbytes();
+    // Verify tensors all have same type
+    TypeMeta meta = Input(1).meta();
+    for (auto i = 2; i < InputSize(); i++) {
+      CAFFE_ENFORCE(Input(i).meta() == meta);
+    }
+
+    if (num_blobs_ > 1) {
+      // Verify inputs == outputs, the algorithm works on the buffers
+      for (auto i = 1; i < InputSize(); i++) {
+        CAFFE_ENFORCE_EQ(
+            Input(i).template raw_data(), Output(i - 1)->template raw_data());
+      }
+
+      // Verify every blob has the same size on all the devices
+      for (auto i = 0; i < num_blobs_; i++) {
+        const auto size = Input(1 + i * num_devices_).size();
+        for (auto device = 1; device < num_devices_; device++) {
+          CAFFE_ENFORCE_EQ(Input(1 + i * num_devices_ + device).size(), size);
+        }
+      }
+      fused_.resize(num_devices_);
+    }
+    if (buffered()) {
+      fused_sizes_ = fusedSizes();
+    }
+    if (num_blobs_ > 1) {
+      initializeFused();
+    }
+    if (compression_ != NONE) {
+      CAFFE_ENFORCE(meta.template Match<float>(), "Can only compress floats");
+      for (auto i = 1; i < InputSize(); i++) {
+        CAFFE_ENFORCE_EQ(
+            Input(i).template raw_data(), Output(i - 1)->template raw_data());
+      }
+      initializeCompressed();
+    }
 
     // Store which inputs/outputs this instance initialized with
     update(init_);
 
+    if (compression_ == INT8) {
+      initializeAllgather();
+      return;
+    }
+
     // Verify inputs == ouputs
     CAFFE_ENFORCE_EQ(init_.inputs.size(), init_.outputs.size());
     for (auto i = 0; i < init_.inputs.size(); i++) {
@@ -71,18 +168,14 @@ class AllreduceOp final : public Operator<Context> {
     }
 
     // Verify tensors all have same size
-    size_t size = Input(1).size();
-    for (auto i = 2; i < InputSize(); i++) {
-      CAFFE_ENFORCE_EQ(Input(i).size(), size);
-    }
-
-    // Verify tensors all have same type
-    TypeMeta meta = Input(1).meta();
-    for (auto i = 2; i < InputSize(); i++) {
-      CAFFE_ENFORCE(Input(i).meta() == meta);
+    if (num_blobs_ == 1) {
+      size_t size = Input(1).size();
+      for (auto i = 2; i < InputSize(); i++) {
+        CAFFE_ENFORCE_EQ(Input(i).size(), size);
+      }
     }
 
-    switch (mode) {
+    switch (mode_) {
       case RING_FULL:
         initializeRingFull();
         return;
@@ -100,6 +193,67 @@ class AllreduceOp final : public Operator<Context> {
   void initializeHalvingDoubling();
   void initializeRingFull();
   void initializeRingChunked();
+  // Allocates the buffer of every device next to its inputs
+  void initializeFused();
+  // Allocates the compressed buffers and finds the residuals
+  void initializeCompressed();
+  // Gathers the 8-bit buffers of all the nodes
+  void initializeAllgather();
+  // Adds the residuals to the tensors and compresses them to the buffers,
+  // keeping the error in the residuals
+  void compress();
+  // Writes the sum of the compressed buffers to the tensors
+  void decompress();
+
+  // Whether the algorithm works on buffers rather than on the tensors
+  bool buffered() const {
+    return num_blobs_ > 1 || compression_ != NONE;
+  }
+
+  TIndex uncompressedSize() const {
+    TIndex size = 0;
+    for (const auto blob_size : fused_sizes_) {
+      size += blob_size;
+    }
+    return size;
+  }
+
+  // Tensor of a device the compression reads and writes
+  float* uncompressed(int device) {
+    if (num_blobs_ > 1) {
+      return fused_[device].template mutable_data<float>();
+    }
+    return Output(device)->template mutable_data<float>();
+  }
+
+  // Sizes of the blobs fused by the op
+  std::vector<TIndex> fusedSizes() {
+    std::vector<TIndex> sizes(num_blobs_);
+    for (auto i = 0; i < num_blobs_; i++) {
+      sizes[i] = Input(1 + i * num_devices_).size();
+    }
+    return sizes;
+  }
+
+  // Copies the blobs of every device to its buffer, or back
+  void copyFused(bool pack) {
+    const auto& meta = Input(1).meta();
+    for (auto device = 0; device < num_devices_; device++) {
+      auto* buffer = static_cast<char*>(fused_[device].raw_mutable_data(meta));
+      for (auto i = 0; i < num_blobs_; i++) {
+        const auto index = i * num_devices_ + device;
+        const auto size = fused_sizes_[i];
+        if (pack) {
+          context_.template CopyItems<Context, Context>(
+              meta, size, Input(1 + index).raw_data(), buffer);
+        } else {
+          context_.template CopyItems<Context, Context>(
+              meta, size, buffer, Output(index)->raw_mutable_data(meta));
+        }
+        buffer += size * meta.itemsize();
+      }
+    }
+  }
 
   std::once_flag once_;
   std::unique_ptr<::gloo::Algorithm> algorithm_;
@@ -110,6 +264,36 @@ class AllreduceOp final : public Operator<Context> {
   // changed from run to run, the initialized algorithm is invalid.
   void update(GlooParameters& params) {
     params.context = OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    if (compression_ != NONE) {
+      // Gloo reduces the compressed buffers, or gathers them with int8
+      params.inputs.resize(num_devices_);
+      params.outputs.resize(compression_ == INT8 ? 1 : num_devices_);
+      for (auto i = 0; i < num_devices_; i++) {
+        params.inputs[i] = compressed_[i].template raw_data();
+      }
+      if (compression_ == INT8) {
+        params.outputs[0] = gathered_.template raw_mutable_data();
+      } else {
+        for (auto i = 0; i < num_devices_; i++) {
+          params.outputs[i] = compressed_[i].template raw_mutable_data();
+        }
+      }
+      params.size = compressed_[0].size();
+      params.meta = compressed_[0].meta();
+      return;
+    }
+    if (num_blobs_ > 1) {
+      // Gloo reduces the buffers
+      params.inputs.resize(num_devices_);
+      params.outputs.resize(num_devices_);
+      for (auto i = 0; i < num_devices_; i++) {
+        params.inputs[i] = fused_[i].template raw_data();
+        params.outputs[i] = fused_[i].raw_mutable_data(Input(1).meta());
+      }
+      params.size = fused_[0].size();
+      params.meta = Input(1).meta();
+      return;
+    }
     params.inputs.resize(InputSize() - 1);
     params.outputs.resize(OutputSize());
     for (auto i = 0; i < params.inputs.size(); i++) {
@@ -125,6 +309,24 @@ class AllreduceOp final : public Operator<Context> {
   Workspace* ws_;
   std::string status_blob_;
   const bool gpu_direct_;
+  // With num_devices, the inputs are the blobs of all the devices, blob after
+  // blob. More than one blob per device are reduced at once, through a
+  // buffer per device
+  const int num_devices_;
+  int num_blobs_;
+  Mode mode_;
+  std::vector<TIndex> fused_sizes_;
+  std::vector<Tensor<Context>> fused_;
+  // With compression, the tensors go through float16 buffers reduced by
+  // Gloo, or through buffers of rows of chunk_size_ values quantized to 8
+  // bits with their own scale and bias, gathered from all the nodes and
+  // summed in float. The error of the compression of every device is kept
+  // in a residual blob of the workspace and added to the next iteration.
+  Compression compression_;
+  const int chunk_size_;
+  std::vector<Tensor<Context>> compressed_;
+  std::vector<Blob*> residuals_;
+  Tensor<Context> gathered_;
 };
 
 } // namespace gloo
@@ -100,6 +100,40 @@ void AllreduceOp<Context>::initializeRingChunked() {
   }
 }
 
+template <class Context>
+void AllreduceOp<Context>::initializeFused() {
+  TIndex size = 0;
+  for (const auto blob_size : fused_sizes_) {
+    size += blob_size;
+  }
+  for (auto device = 0; device < num_devices_; device++) {
+    DeviceGuard guard(GetGPUIDForPointer(Input(1 + device).raw_data()));
+    fused_[device].Resize(size);
+    fused_[device].raw_mutable_data(Input(1).meta());
+  }
+}
+
+// The compression runs on the CPU, CUDA tensors are reduced as they are
+template <class Context>
+void AllreduceOp<Context>::initializeCompressed() {
+  CAFFE_THROW("Allreduce compression is only supported for CPU tensors");
+}
+
+template <class Context>
+void AllreduceOp<Context>::initializeAllgather() {
+  CAFFE_THROW("Allreduce compression is only supported for CPU tensors");
+}
+
+template <class Context>
+void AllreduceOp<Context>::compress() {
+  CAFFE_THROW("Allreduce compression is only supported for CPU tensors");
+}
+
+template <class Context>
+void AllreduceOp<Context>::decompress() {
+  CAFFE_THROW("Allreduce compression is only supported for CPU tensors");
+}
+
 namespace {
 
 REGISTER_CUDA_OPERATOR_WITH_ENGINE(Allreduce, GLOO, AllreduceOp<CUDAContext>);
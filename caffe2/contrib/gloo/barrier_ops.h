@@ -2,6 +2,7 @@
 
 #include "caffe2/contrib/gloo/common.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 
 #include <gloo/algorithm.h>
 #include <gloo/barrier_all_to_one.h>
@@ -38,8 +39,10 @@ class BarrierOp final : public Operator<Context> {
     // algorithm is invalid and cannot be used.
     CAFFE_ENFORCE(context == initContext_, "Context has changed");
 
+    CAFFE_SDT(collective_start, "gloo_barrier", (void*)this);
     try {
       algorithm_->run();
+      CAFFE_SDT(collective_done, "gloo_barrier", (void*)this);
     } catch (::gloo::IoException& ioe) {
       LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
       if (status_blob_ != "") {
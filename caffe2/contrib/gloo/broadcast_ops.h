@@ -4,6 +4,7 @@
 
 #include "caffe2/contrib/gloo/common.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/types.h"
 
 #include <gloo/algorithm.h>
@@ -39,8 +40,10 @@ class BroadcastOp final : public Operator<Context> {
     update(current_);
     CAFFE_ENFORCE(current_ == init_, "Inputs/outputs have changed");
 
+    CAFFE_SDT(collective_start, "gloo_broadcast", (void*)this);
     try {
       algorithm_->run();
+      CAFFE_SDT(collective_done, "gloo_broadcast", (void*)this);
     } catch (::gloo::IoException& ioe) {
       LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
       if (status_blob_ != "") {
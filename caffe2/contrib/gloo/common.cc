@@ -3,6 +3,11 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
 
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <tuple>
+
 #include <gloo/transport/tcp/device.h>
 #if defined(GLOO_USE_IBVERBS) && GLOO_USE_IBVERBS
 #include <gloo/transport/ibverbs/device.h>
@@ -44,5 +49,65 @@ std::shared_ptr<::gloo::transport::Device> createDevice(
   CAFFE_THROW("Invalid transport: ", attr.transport);
 }
 
+std::vector<int> topologyOrder(const std::vector<TopologyNode>& nodes) {
+  std::map<std::string, int> racks;
+  std::map<std::pair<std::string, std::string>, int> hosts;
+  std::vector<std::tuple<int, int, int>> keys;
+  for (int i = 0; i < nodes.size(); i++) {
+    const auto& node = nodes[i];
+    auto rack = racks.emplace(node.rack, racks.size()).first->second;
+    auto host = hosts.emplace(std::make_pair(node.rack, node.host),
+                              hosts.size()).first->second;
+    keys.emplace_back(rack, host, i);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::vector<int> order;
+  order.reserve(keys.size());
+  for (const auto& key : keys) {
+    order.push_back(std::get<2>(key));
+  }
+  return order;
+}
+
+std::string describeTopology(
+    const std::vector<TopologyNode>& nodes,
+    const std::vector<int>& order) {
+  auto hops = [&](const std::vector<int>& ring) {
+    int hostHops = 0;
+    int rackHops = 0;
+    for (int i = 0; i < ring.size(); i++) {
+      const auto& a = nodes[ring[i]];
+      const auto& b = nodes[ring[(i + 1) % ring.size()]];
+      if (a.rack != b.rack) {
+        rackHops++;
+      }
+      if (a.rack != b.rack || a.host != b.host) {
+        hostHops++;
+      }
+    }
+    return std::make_pair(hostHops, rackHops);
+  };
+
+  std::vector<int> identity(nodes.size());
+  for (int i = 0; i < identity.size(); i++) {
+    identity[i] = i;
+  }
+  auto before = hops(identity);
+  auto after = hops(order);
+
+  std::stringstream ss;
+  for (int i = 0; i < order.size(); i++) {
+    const auto& node = nodes[order[i]];
+    ss << "\n  rank " << i << " (was " << order[i] << ") on " << node.host;
+    if (!node.rack.empty()) {
+      ss << ", rack " << node.rack;
+    }
+  }
+  ss << "\n  ring hops across hosts: " << after.first << " (was "
+     << before.first << "), across racks: " << after.second << " (was "
+     << before.second << ")";
+  return ss.str();
+}
+
 } // namespace gloo
 } // namespace caffe2
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <exception>
+#include <string>
+#include <vector>
 
 #include "caffe2/core/blob.h"
 
@@ -25,6 +27,23 @@ struct createDeviceAttr {
 std::shared_ptr<::gloo::transport::Device> createDevice(
     const createDeviceAttr attr);
 
+// Placement of a rank, gathered during a topology aware rendezvous.
+struct TopologyNode {
+  std::string host;
+  // Empty when the rack is not known.
+  std::string rack;
+};
+
+// Orders the ranks so the ranks of a rack, and of a host within a rack,
+// are contiguous. Racks and hosts keep the order of their first rank, so
+// rank 0 stays first. Returns the original rank at every position.
+std::vector<int> topologyOrder(const std::vector<TopologyNode>& nodes);
+
+// Describes the ring formed by the ranks in order, for logging.
+std::string describeTopology(
+    const std::vector<TopologyNode>& nodes,
+    const std::vector<int>& order);
+
 // Captures the parameters passed to Gloo.
 struct GlooParameters {
   std::shared_ptr<::gloo::Context> context;
@@ -10,6 +10,9 @@
 #include <gloo/rendezvous/context.h>
 #include <gloo/rendezvous/prefix_store.h>
 
+#include <algorithm>
+#include <unistd.h>
+
 #if defined(GLOO_USE_MPI) && GLOO_USE_MPI
 #include <gloo/mpi/context.h>
 #endif
@@ -38,10 +41,24 @@ class CreateCommonWorld final : public Operator<Context> {
         status_blob_(
             OperatorBase::GetSingleArgument<std::string>("status_blob", "")),
         timeout_ms_(OperatorBase::GetSingleArgument<int>("timeout_ms", -1)),
+        topology_aware_(OperatorBase::template GetSingleArgument<bool>(
+            "topology_aware", false)),
+        hostname_(OperatorBase::template GetSingleArgument<std::string>(
+            "hostname", "")),
+        rack_(OperatorBase::template GetSingleArgument<std::string>(
+            "rack", "")),
         ws_(ws) {
     CAFFE_ENFORCE(
         operator_def.has_name(), "CreateCommonWorld operator requires name");
     CAFFE_ENFORCE(rank_ >= 0 && rank_ < size_);
+    CAFFE_ENFORCE(
+        !(topology_aware_ && mpi_rendezvous_),
+        "Topology aware rendezvous requires a store handler");
+    if (topology_aware_ && hostname_.empty()) {
+      char hostname[256] = {0};
+      CAFFE_ENFORCE_EQ(gethostname(hostname, sizeof(hostname) - 1), 0);
+      hostname_ = hostname;
+    }
     name_ = operator_def.name();
     if (status_blob_ != "") {
       ws_->CreateBlob(status_blob_);
@@ -72,7 +89,8 @@ class CreateCommonWorld final : public Operator<Context> {
     // Use PrefixStore to isolate different CreateCommonWorld instances
     StoreHandlerWrapper wrapper(*handler);
     ::gloo::rendezvous::PrefixStore store(name_, wrapper);
-    auto context = std::make_shared<::gloo::rendezvous::Context>(rank_, size_);
+    auto rank = topology_aware_ ? topologyRank(handler) : rank_;
+    auto context = std::make_shared<::gloo::rendezvous::Context>(rank, size_);
     if (timeout_ms_ != -1) {
       context->setTimeout(std::chrono::milliseconds(timeout_ms_));
     }
@@ -80,6 +98,43 @@ class CreateCommonWorld final : public Operator<Context> {
     return context;
   }
 
+  // Gathers the host and rack of every rank through the store and returns
+  // the rank of this node in the topology order, which the rings and trees
+  // of the collectives follow.
+  int topologyRank(const std::unique_ptr<StoreHandler>& handler) {
+    const auto prefix = name_ + "/topology/";
+    handler->set(prefix + caffe2::to_string(rank_), rack_ + "\n" + hostname_);
+
+    std::vector<std::string> keys;
+    for (int i = 0; i < size_; i++) {
+      keys.push_back(prefix + caffe2::to_string(i));
+    }
+    if (timeout_ms_ != -1) {
+      handler->wait(keys, std::chrono::milliseconds(timeout_ms_));
+    } else {
+      handler->wait(keys);
+    }
+    auto values = handler->multiGet(keys);
+
+    std::vector<TopologyNode> nodes(size_);
+    for (int i = 0; i < size_; i++) {
+      auto pos = values[i].find('\n');
+      CAFFE_ENFORCE(pos != std::string::npos, "Invalid topology of rank ", i);
+      nodes[i].rack = values[i].substr(0, pos);
+      nodes[i].host = values[i].substr(pos + 1);
+    }
+
+    auto order = topologyOrder(nodes);
+    int rank = std::find(order.begin(), order.end(), rank_) - order.begin();
+    if (rank == 0) {
+      LOG(INFO) << "Topology of common world " << name_ << ":"
+                << describeTopology(nodes, order);
+    }
+    VLOG(1) << "Rank " << rank_ << " of common world " << name_
+            << " is rank " << rank << " in topology order";
+    return rank;
+  }
+
   bool RunOnDevice() override {
     try {
       CommonWorld context;
@@ -149,6 +204,9 @@ class CreateCommonWorld final : public Operator<Context> {
   const bool mpi_rendezvous_;
   const std::string status_blob_;
   const int timeout_ms_;
+  const bool topology_aware_;
+  std::string hostname_;
+  const std::string rack_;
   Workspace* ws_;
 
   std::string name_;
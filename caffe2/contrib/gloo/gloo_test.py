@@ -94,7 +94,8 @@ class TestCase(hu.HypothesisTestCase):
             fn(**kwargs)
             workspace.ResetWorkspace()
 
-    def create_common_world(self, comm_rank, comm_size, tmpdir=None, existing_cw=None):
+    def create_common_world(self, comm_rank, comm_size, tmpdir=None, existing_cw=None,
+                            **kwargs):
         store_handler = "store_handler"
 
         # If REDIS_HOST is set, use RedisStoreHandler for rendezvous.
@@ -132,7 +133,8 @@ class TestCase(hu.HypothesisTestCase):
                 size=comm_size,
                 rank=comm_rank,
                 sync=True,
-                engine=op_engine))
+                engine=op_engine,
+                **kwargs))
         return (store_handler, common_world)
 
     def synchronize(self, store_handler, value, comm_rank=None):
@@ -347,6 +349,205 @@ class TestCase(hu.HypothesisTestCase):
                     tmpdir=tmpdir,
                     use_float16=use_float16)
 
+    def _test_allreduce_fused(self,
+                              comm_rank=None,
+                              comm_size=None,
+                              blob_size=None,
+                              num_blobs=None,
+                              tmpdir=None
+                              ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        blob_size = self.synchronize(
+            store_handler,
+            blob_size,
+            comm_rank=comm_rank)
+
+        num_blobs = self.synchronize(
+            store_handler,
+            num_blobs,
+            comm_rank=comm_rank)
+
+        # Blobs of different sizes, reduced through one buffer
+        blobs = []
+        for i in range(num_blobs):
+            blob = "blob_{}".format(i)
+            value = np.full(blob_size * (i + 1), comm_rank * 10 + i,
+                            np.float32)
+            workspace.FeedBlob(blob, value)
+            blobs.append(blob)
+
+        net = core.Net("allreduce_fused")
+        net.Allreduce(
+            [common_world] + blobs,
+            blobs,
+            num_devices=1,
+            engine=op_engine)
+
+        workspace.CreateNet(net)
+        for _tmp in range(3):
+            for i in range(num_blobs):
+                workspace.FeedBlob(
+                    blobs[i],
+                    np.full(blob_size * (i + 1), comm_rank * 10 + i,
+                            np.float32))
+            workspace.RunNet(net.Name())
+            for i in range(num_blobs):
+                np.testing.assert_array_equal(
+                    workspace.FetchBlob(blobs[i]),
+                    np.full(
+                        blob_size * (i + 1),
+                        10 * comm_size * (comm_size - 1) / 2 + comm_size * i,
+                        np.float32))
+
+    @given(comm_size=st.integers(min_value=2, max_value=4),
+           blob_size=st.integers(min_value=1e3, max_value=1e5),
+           num_blobs=st.integers(min_value=2, max_value=4))
+    def test_allreduce_fused(self, comm_size, blob_size, num_blobs):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_allreduce_fused,
+                blob_size=blob_size,
+                num_blobs=num_blobs)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_allreduce_fused,
+                    comm_size=comm_size,
+                    blob_size=blob_size,
+                    num_blobs=num_blobs,
+                    tmpdir=tmpdir)
+
+    def _test_allreduce_compressed(self,
+                                   comm_rank=None,
+                                   comm_size=None,
+                                   blob_size=None,
+                                   compression=None,
+                                   tmpdir=None
+                                   ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        blob_size = self.synchronize(
+            store_handler,
+            blob_size,
+            comm_rank=comm_rank)
+
+        blob = "blob"
+        value = np.linspace(0, 1, blob_size).astype(np.float32)
+        workspace.FeedBlob(blob, value * (comm_rank + 1))
+
+        net = core.Net("allreduce_compressed")
+        net.Allreduce(
+            [common_world, blob],
+            [blob],
+            compression=compression,
+            engine=op_engine)
+
+        workspace.CreateNet(net)
+        for _tmp in range(3):
+            workspace.FeedBlob(blob, value * (comm_rank + 1))
+            workspace.RunNet(net.Name())
+            np.testing.assert_allclose(
+                workspace.FetchBlob(blob),
+                value * comm_size * (comm_size + 1) / 2,
+                atol=0.01 * comm_size)
+        # The error of the compression carries over to the next run
+        self.assertTrue(workspace.HasBlob(blob + "_allreduce_residual"))
+        residual = workspace.FetchBlob(blob + "_allreduce_residual")
+        self.assertEqual(residual.shape, (blob_size,))
+        self.assertLess(np.max(np.abs(residual)), 0.01 * (comm_rank + 1))
+
+    @given(comm_size=st.integers(min_value=2, max_value=4),
+           blob_size=st.integers(min_value=1e3, max_value=1e5),
+           compression=st.sampled_from(["fp16", "int8"]))
+    def test_allreduce_compressed(self, comm_size, blob_size, compression):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_allreduce_compressed,
+                blob_size=blob_size,
+                compression=compression)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_allreduce_compressed,
+                    comm_size=comm_size,
+                    blob_size=blob_size,
+                    compression=compression,
+                    tmpdir=tmpdir)
+
+    def _test_sparse_allreduce(self,
+                               comm_rank=None,
+                               comm_size=None,
+                               block_size=None,
+                               tmpdir=None
+                               ):
+        store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir)
+
+        block_size = self.synchronize(
+            store_handler,
+            block_size,
+            comm_rank=comm_rank)
+
+        def sparse_gradient(rank, iteration):
+            # Every node has its own number of indices, growing every run
+            state = np.random.RandomState(rank * 10 + iteration)
+            num_indices = (3 + 2 * rank) * (iteration + 1)
+            indices = state.randint(0, 20, num_indices).astype(np.int64)
+            values = state.rand(num_indices, block_size).astype(np.float32)
+            return indices, values
+
+        net = core.Net("sparse_allreduce")
+        net.SparseAllreduce(
+            [common_world, "indices", "values"],
+            ["summed_indices", "summed_values"],
+            engine=op_engine)
+
+        for iteration in range(3):
+            indices, values = sparse_gradient(comm_rank, iteration)
+            workspace.FeedBlob("indices", indices)
+            workspace.FeedBlob("values", values)
+            if iteration == 0:
+                workspace.CreateNet(net)
+            workspace.RunNet(net.Name())
+
+            expected = {}
+            for rank in range(comm_size):
+                indices, values = sparse_gradient(rank, iteration)
+                for index, row in zip(indices, values):
+                    expected[index] = expected.get(index, 0) + row
+            summed_indices = workspace.FetchBlob("summed_indices")
+            summed_values = workspace.FetchBlob("summed_values")
+            self.assertEqual(sorted(summed_indices), sorted(expected.keys()))
+            for index, row in zip(summed_indices, summed_values):
+                np.testing.assert_allclose(row, expected[index], rtol=1e-5)
+
+    @given(comm_size=st.integers(min_value=2, max_value=4),
+           block_size=st.integers(min_value=1, max_value=16))
+    def test_sparse_allreduce(self, comm_size, block_size):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_sparse_allreduce,
+                block_size=block_size)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_sparse_allreduce,
+                    comm_size=comm_size,
+                    block_size=block_size,
+                    tmpdir=tmpdir)
+
     def _test_reduce_scatter(self,
                              comm_rank=None,
                              comm_size=None,
@@ -515,6 +716,49 @@ class TestCase(hu.HypothesisTestCase):
                     tmpdir=tmpdir,
                     use_float16=use_float16)
 
+    def _test_allgather_topology(self,
+                                 comm_rank=None,
+                                 comm_size=None,
+                                 tmpdir=None):
+        # Place the even and the odd ranks on two hosts, the ranks of a host
+        # become contiguous in the topology order
+        _store_handler, common_world = self.create_common_world(
+            comm_rank=comm_rank,
+            comm_size=comm_size,
+            tmpdir=tmpdir,
+            topology_aware=True,
+            hostname="host_{}".format(comm_rank % 2),
+            rack="rack_0")
+
+        workspace.FeedBlob("blob", np.full(16, comm_rank, np.float32))
+        net = core.Net("allgather_topology")
+        net.Allgather(
+            [common_world, "blob"],
+            ["Gathered"],
+            engine=op_engine)
+        workspace.RunNetOnce(net)
+
+        order = list(range(0, comm_size, 2)) + list(range(1, comm_size, 2))
+        np.testing.assert_array_equal(
+            workspace.FetchBlob("Gathered"),
+            np.repeat(np.array(order, np.float32), 16))
+
+    @given(comm_size=st.integers(min_value=2, max_value=8),
+           device_option=st.sampled_from([hu.cpu_do]))
+    def test_allgather_topology(self, comm_size, device_option):
+        TestCase.test_counter += 1
+        if os.getenv('COMM_RANK') is not None:
+            self.run_test_distributed(
+                self._test_allgather_topology,
+                device_option=device_option)
+        else:
+            with TemporaryDirectory() as tmpdir:
+                self.run_test_locally(
+                    self._test_allgather_topology,
+                    comm_size=comm_size,
+                    device_option=device_option,
+                    tmpdir=tmpdir)
+
     @given(device_option=st.sampled_from([hu.cpu_do]))
     def test_forked_cw(self, device_option):
         TestCase.test_counter += 1
@@ -0,0 +1,50 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sparse_allreduce_ops.h"
+
+#include <gloo/allgather_ring.h>
+
+namespace caffe2 {
+namespace gloo {
+
+void SparseAllreduceOp::initializeCounts() {
+  counts_algorithm_.reset(new ::gloo::AllgatherRing<long>(
+      comm_, {&count_}, counts_.data(), 1));
+}
+
+void SparseAllreduceOp::grow(long capacity) {
+  capacity_ = capacity;
+  send_indices_.resize(capacity_);
+  send_values_.resize(capacity_ * block_size_);
+  recv_indices_.resize(comm_->size * capacity_);
+  recv_values_.resize(comm_->size * capacity_ * block_size_);
+  indices_algorithm_.reset(new ::gloo::AllgatherRing<long>(
+      comm_, {send_indices_.data()}, recv_indices_.data(), capacity_));
+  values_algorithm_.reset(new ::gloo::AllgatherRing<float>(
+      comm_,
+      {send_values_.data()},
+      recv_values_.data(),
+      capacity_ * block_size_));
+}
+
+namespace {
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(SparseAllreduce, GLOO, SparseAllreduceOp);
+
+} // namespace
+} // namespace gloo
+} // namespace caffe2
@@ -0,0 +1,194 @@
+/**
+ * Copyright (c) 2017-present, Facebook, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+#include "caffe2/contrib/gloo/common.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
+#include "caffe2/utils/math.h"
+
+#include <gloo/algorithm.h>
+#include <gloo/common/error.h>
+#include <gloo/context.h>
+
+namespace caffe2 {
+namespace gloo {
+
+// Sums sparse gradients, pairs of indices and rows of values, over all the
+// nodes. Every node gathers the pairs of all the nodes and sums the rows of
+// every index, so the outputs can be applied like the gradient of a single
+// node, e.g. by SparseAdagrad. The nodes can have different numbers of
+// indices, they gather buffers padded to the largest number, which grow as
+// needed.
+class SparseAllreduceOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+
+  SparseAllreduceOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        status_blob_(
+            OperatorBase::GetSingleArgument<std::string>("status_blob", "")) {
+    if (status_blob_ != "") {
+      ws_->CreateBlob(status_blob_);
+    }
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename TInd>
+  bool DoRunWithType() {
+    const auto& indices = Input(INDICES);
+    const auto& values = Input(VALUES);
+    CAFFE_ENFORCE_EQ(indices.ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_GE(values.ndim(), 1);
+    CAFFE_ENFORCE_EQ(values.dim(0), indices.size());
+    std::call_once(once_, [&] { initialize(); });
+    CAFFE_ENFORCE(
+        OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0) == comm_,
+        "Common world has changed");
+    CAFFE_ENFORCE_EQ(
+        values.size_from_dim(1), block_size_, "Row size has changed");
+
+    // Gathers the number of indices of every node
+    count_ = indices.size();
+    if (!run(counts_algorithm_.get())) {
+      return false;
+    }
+    const auto max_count = *std::max_element(counts_.begin(), counts_.end());
+    if (max_count > capacity_) {
+      // All the nodes see the same counts and grow their buffers together
+      grow(std::max(max_count, 2 * capacity_));
+    }
+
+    const auto* indices_data = indices.template data<TInd>();
+    std::copy(indices_data, indices_data + count_, send_indices_.begin());
+    context_.template Copy<float, CPUContext, CPUContext>(
+        values.size(), values.template data<float>(), send_values_.data());
+    if (!run(indices_algorithm_.get()) || !run(values_algorithm_.get())) {
+      return false;
+    }
+
+    // Sums the rows of every index, in the order the indices are first met
+    std::unordered_map<long, TIndex> rows;
+    rows.reserve(std::accumulate(counts_.begin(), counts_.end(), 0L));
+    std::vector<TIndex> row_of(recv_indices_.size(), -1);
+    std::vector<TInd> unique;
+    for (size_t node = 0; node < counts_.size(); node++) {
+      for (long i = 0; i < counts_[node]; i++) {
+        const auto position = node * capacity_ + i;
+        const auto index = recv_indices_[position];
+        auto inserted = rows.emplace(index, unique.size());
+        if (inserted.second) {
+          unique.push_back(index);
+        }
+        row_of[position] = inserted.first->second;
+      }
+    }
+
+    auto* output_indices = Output(OUTPUT_INDICES);
+    auto* output_values = Output(OUTPUT_VALUES);
+    output_indices->Resize(unique.size());
+    std::copy(
+        unique.begin(),
+        unique.end(),
+        output_indices->template mutable_data<TInd>());
+    auto dims = values.dims();
+    dims[0] = unique.size();
+    output_values->Resize(dims);
+    auto* sums = output_values->template mutable_data<float>();
+    math::Set<float, CPUContext>(output_values->size(), 0.f, sums, &context_);
+    for (size_t position = 0; position < row_of.size(); position++) {
+      if (row_of[position] < 0) {
+        continue;
+      }
+      auto* sum = sums + row_of[position] * block_size_;
+      math::Add<float, CPUContext>(
+          block_size_,
+          sum,
+          recv_values_.data() + position * block_size_,
+          sum,
+          &context_);
+    }
+    return true;
+  }
+
+ protected:
+  void initialize() {
+    comm_ = OperatorBase::Input<std::shared_ptr<::gloo::Context>>(0);
+    block_size_ = Input(VALUES).size_from_dim(1);
+    counts_.resize(comm_->size);
+    initializeCounts();
+    grow(std::max<long>(Input(INDICES).size(), 1));
+  }
+
+  // Gathers count_ of every node to counts_
+  void initializeCounts();
+  // Reallocates the gathered buffers for capacity indices per node
+  void grow(long capacity);
+
+  // Runs a Gloo algorithm, false if it failed and the op has a status blob
+  bool run(::gloo::Algorithm* algorithm) {
+    CAFFE_SDT(collective_start, "gloo_sparse_allreduce", (void*)this);
+    try {
+      algorithm->run();
+      CAFFE_SDT(collective_done, "gloo_sparse_allreduce", (void*)this);
+    } catch (::gloo::IoException& ioe) {
+      LOG(ERROR) << "Caught gloo IO exception: " << ioe.what();
+      if (status_blob_ != "") {
+        signalFailure(ws_->GetBlob(status_blob_), ioe);
+        return false;
+      } else {
+        throw ioe;
+      }
+    }
+    return true;
+  }
+
+  std::once_flag once_;
+  Workspace* ws_;
+  std::string status_blob_;
+  std::shared_ptr<::gloo::Context> comm_;
+  TIndex block_size_;
+
+  long count_;
+  std::vector<long> counts_;
+  std::unique_ptr<::gloo::Algorithm> counts_algorithm_;
+
+  // Indices of rows of values, for every node, of which only the counts_
+  // first are set
+  long capacity_ = 0;
+  std::vector<long> send_indices_;
+  std::vector<float> send_values_;
+  std::vector<long> recv_indices_;
+  std::vector<float> recv_values_;
+  std::unique_ptr<::gloo::Algorithm> indices_algorithm_;
+  std::unique_ptr<::gloo::Algorithm> values_algorithm_;
+
+  INPUT_TAGS(COMM, INDICES, VALUES);
+  OUTPUT_TAGS(OUTPUT_INDICES, OUTPUT_VALUES);
+};
+
+} // namespace gloo
+} // namespace caffe2
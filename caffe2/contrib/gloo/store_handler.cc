@@ -11,6 +11,12 @@ void StoreHandlerWrapper::set(
 }
 
 std::vector<char> StoreHandlerWrapper::get(const std::string& key) {
+  auto it = fetched_.find(key);
+  if (it != fetched_.end()) {
+    std::vector<char> result(it->second.begin(), it->second.end());
+    fetched_.erase(it);
+    return result;
+  }
   std::string str = handler_.get(key);
   return std::vector<char>(str.begin(), str.end());
 }
@@ -19,6 +25,30 @@ void StoreHandlerWrapper::wait(
     const std::vector<std::string>& keys,
     const std::chrono::milliseconds& timeout) {
   handler_.wait(keys, timeout);
+  // The rendezvous gets the keys it waited for, fetch them all at once
+  auto data = handler_.multiGet(keys);
+  for (size_t i = 0; i < keys.size(); i++) {
+    fetched_[keys[i]] = std::move(data[i]);
+  }
+}
+
+void StoreHandlerWrapper::multiSet(
+    const std::vector<std::string>& keys,
+    const std::vector<std::vector<char>>& data) {
+  std::vector<std::string> stringValues;
+  for (const auto& value : data) {
+    stringValues.emplace_back(value.data(), value.size());
+  }
+  handler_.multiSet(keys, stringValues);
+}
+
+std::vector<std::vector<char>> StoreHandlerWrapper::multiGet(
+    const std::vector<std::string>& keys) {
+  std::vector<std::vector<char>> result;
+  for (const auto& str : handler_.multiGet(keys)) {
+    result.emplace_back(str.begin(), str.end());
+  }
+  return result;
 }
 
 } // namespace gloo
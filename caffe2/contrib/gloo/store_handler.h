@@ -2,6 +2,8 @@
 
 #include "caffe2/distributed/store_handler.h"
 
+#include <unordered_map>
+
 #include <gloo/rendezvous/store.h>
 
 namespace caffe2 {
@@ -26,8 +28,17 @@ class StoreHandlerWrapper : public ::gloo::rendezvous::Store {
       const std::vector<std::string>& keys,
       const std::chrono::milliseconds& timeout) override;
 
+  void multiSet(
+      const std::vector<std::string>& keys,
+      const std::vector<std::vector<char>>& data);
+
+  std::vector<std::vector<char>> multiGet(const std::vector<std::string>& keys);
+
  protected:
   StoreHandler& handler_;
+
+  // Data of the keys fetched at once by wait, until get asks for them
+  std::unordered_map<std::string, std::string> fetched_;
 };
 
 } // namespace gloo
@@ -1,5 +1,7 @@
 #include "cuda_nccl_gpu.h"
 
+#include "caffe2/core/static_tracepoint.h"
+
 namespace caffe2 {
 
 namespace nccl {
@@ -120,8 +122,47 @@ class ncclTypeWrapper<float16> {
 };
 #endif
 
+// Packs the fused sources of the element into its buffer, or unpacks the
+// buffer into the fused destinations
+void copyFusedTensors(const NCCLElement& ctx, cudaStream_t stream, bool pack) {
+  if (ctx.fused_srcs.empty() && ctx.fused_dsts.empty()) {
+    return;
+  }
+  CAFFE_ENFORCE_EQ(ctx.src, ctx.dst, "Fused tensors need an in place buffer");
+  auto* buffer = static_cast<char*>(ctx.dst->raw_mutable_data());
+  size_t offset = 0;
+  if (pack) {
+    for (const auto* src : ctx.fused_srcs) {
+      CUDA_ENFORCE(cudaMemcpyAsync(
+          buffer + offset,
+          src->raw_data(),
+          src->nbytes(),
+          cudaMemcpyDeviceToDevice,
+          stream));
+      offset += src->nbytes();
+    }
+  } else {
+    for (auto* dst : ctx.fused_dsts) {
+      CUDA_ENFORCE(cudaMemcpyAsync(
+          dst->raw_mutable_data(),
+          buffer + offset,
+          dst->nbytes(),
+          cudaMemcpyDeviceToDevice,
+          stream));
+      offset += dst->nbytes();
+    }
+  }
+  CAFFE_ENFORCE_LE(offset, ctx.dst->nbytes());
+}
+
+// The collective probes bracket the launch of the kernels, which run
+// asynchronously on the streams of the devices
 template <typename T, typename InitF, typename F>
-void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
+void runNCCL(
+    const char* collective,
+    const NCCLExecution& ex,
+    InitF&& init_f,
+    F&& f) {
   // do initialization
   for (auto i = 0; i < ex.elements.size(); ++i) {
     auto& ctx = ex.elements[i];
@@ -142,6 +183,7 @@ void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
     CUDA_ENFORCE(cudaEventRecord(context->master_event_, ex.stream));
   }
 
+  CAFFE_SDT(collective_start, collective, (void*)&ex);
   {
     // lock out alloc / free while NCCL launches
     std::lock_guard<std::mutex> lock(CUDAContext::mutex());
@@ -159,6 +201,7 @@ void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
 
       DCHECK_EQ(ctx.device, GetGPUIDForPointer(ctx.src->raw_data()));
       CUDA_ENFORCE(cudaStreamWaitEvent(stream, context->master_event_, 0));
+      copyFusedTensors(ctx, stream, true);
       f(ctx, comm, stream);
     }
 
@@ -173,6 +216,7 @@ void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
       auto& stream = streams[i];
       auto& event = events[i];
 
+      copyFusedTensors(ctx, stream, false);
       // Record an event on each children stream that we have finished
       // our computation
       CUDA_ENFORCE(cudaEventRecord(event, stream));
@@ -184,6 +228,7 @@ void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
   for (auto& event : events) {
     CUDA_ENFORCE(cudaStreamWaitEvent(CHECK_NOTNULL(ex.stream), event, 0));
   }
+  CAFFE_SDT(collective_done, collective, (void*)&ex);
 }
 
 }
@@ -191,6 +236,7 @@ void runNCCL(const NCCLExecution& ex, InitF&& init_f, F&& f) {
 template <typename T>
 void NCCL<T>::AllReduce(const NCCLExecution& ex) {
   return runNCCL<T>(
+      "nccl_allreduce",
       ex,
       [](const NCCLElement& ctx) {
         ctx.dst->Resize(ctx.src->dims());
@@ -211,6 +257,7 @@ void NCCL<T>::AllReduce(const NCCLExecution& ex) {
 template <typename T>
 void NCCL<T>::Broadcast(const NCCLExecution& ex) {
   return runNCCL<T>(
+      "nccl_broadcast",
       ex,
       [](const NCCLElement& ctx) {
         ctx.dst->Resize(ctx.src->dims());
@@ -230,6 +277,7 @@ void NCCL<T>::Broadcast(const NCCLExecution& ex) {
 template <typename T>
 void NCCL<T>::Reduce(const NCCLExecution& ex) {
   return runNCCL<T>(
+      "nccl_reduce",
       ex,
       [](const NCCLElement& ctx) {
         if (ctx.dst) {
@@ -253,10 +301,19 @@ void NCCL<T>::Reduce(const NCCLExecution& ex) {
 template <typename T>
 void NCCL<T>::AllGather(const NCCLExecution& ex) {
   const auto n = ex.elements.size();
+  const bool flat = ex.flat;
   return runNCCL<T>(
+      "nccl_allgather",
       ex,
-      [n](const NCCLElement& ctx) {
+      [n, flat](const NCCLElement& ctx) {
         CAFFE_ENFORCE_NE(ctx.src, ctx.dst);
+        if (flat) {
+          if (ctx.dst->size() != n * ctx.src->size()) {
+            ctx.dst->Resize(n * ctx.src->size());
+          }
+          ctx.dst->template mutable_data<T>();
+          return;
+        }
         std::vector<TIndex> dims;
         dims.reserve(ctx.src->ndim() + 1);
         dims.push_back(n);
@@ -290,10 +347,21 @@ void NCCL<T>::AllGather(const NCCLExecution& ex) {
 template <typename T>
 void NCCL<T>::ReduceScatter(const NCCLExecution& ex) {
   const auto n = ex.elements.size();
+  const bool flat = ex.flat;
   return runNCCL<T>(
+      "nccl_reduce_scatter",
       ex,
-      [](const NCCLElement& ctx) {
+      [n, flat](const NCCLElement& ctx) {
         CAFFE_ENFORCE_NE(ctx.src, ctx.dst);
+        if (flat) {
+          CAFFE_ENFORCE_EQ(
+              ctx.src->size() % n,
+              0,
+              "Flat ReduceScatter needs a multiple of the number of devices");
+          ctx.dst->Resize(ctx.src->size() / n);
+          ctx.dst->template mutable_data<T>();
+          return;
+        }
         const auto& srcDims = ctx.src->dims();
         std::vector<TIndex> dstDims(srcDims.begin() + 1, srcDims.end());
         ctx.dst->Resize(dstDims);
@@ -36,6 +36,11 @@ struct NCCLElement {
   const TensorCUDA* src{nullptr};
   TensorCUDA* dst{nullptr};
   int device{0};
+  // Tensors packed one after the other into dst before the collective, and
+  // unpacked from it into fused_dsts after it, on the collective's stream.
+  // Only for collectives run in place, with src and dst the same buffer.
+  std::vector<const TensorCUDA*> fused_srcs;
+  std::vector<TensorCUDA*> fused_dsts;
 };
 
 struct NCCLExecution {
@@ -43,6 +48,10 @@ struct NCCLExecution {
   cudaStream_t stream{nullptr};
   std::vector<NCCLElement> elements;
   size_t root{0};
+  // ReduceScatter and AllGather split the elements of the tensors into equal
+  // shards, instead of their first dim. The gathered tensors keep their shape
+  // if it has the right size.
+  bool flat{false};
 };
 
 template <typename T>
@@ -14,6 +14,7 @@ nccl::NCCLExecution getNCCLElements(
   ex.stream_gpu_id = context.cuda_gpu_id();
   ex.stream = context.cuda_stream();
   ex.root = op->template GetSingleArgument<int>("root", 0);
+  ex.flat = op->template GetSingleArgument<bool>("flat", false);
   ex.elements.resize(op->InputSize());
   for (auto i = 0; i < op->InputSize(); ++i) {
     auto& el = ex.elements[i];
@@ -71,6 +72,129 @@ class NCCLAllreduceOp final : public Operator<CUDAContext> {
  protected:
 };
 
+// Allreduce of many blobs at once: the blobs are packed into buffers of at
+// most bucket_size_bytes, with one collective per buffer, so that small
+// gradients are reduced at the bandwidth of NCCL instead of its latency
+class NCCLBucketedAllreduceOp final : public Operator<CUDAContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CUDAContext);
+  NCCLBucketedAllreduceOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CUDAContext>(operator_def, ws),
+        num_devices_(GetSingleArgument<int>("num_devices", 0)),
+        bucket_size_bytes_(
+            GetSingleArgument<int64_t>("bucket_size_bytes", 25 << 20)) {
+    CAFFE_ENFORCE_GT(num_devices_, 0, "num_devices argument is required");
+    CAFFE_ENFORCE_EQ(
+        InputSize() % num_devices_,
+        0,
+        "Inputs must hold every blob once per device");
+    CAFFE_ENFORCE_EQ(InputSize(), OutputSize());
+    for (int i = 0; i < num_devices_; ++i) {
+      buffers_.emplace_back(new TensorCUDA());
+      views_.emplace_back(new TensorCUDA());
+    }
+  }
+
+  bool RunOnDevice() override {
+    if (num_devices_ == 1)
+      return true;
+
+    if (AllInputsAre<float>(this)) {
+      return DoRunWithType<float>();
+    } else if (AllInputsAre<float16>(this)) {
+      return DoRunWithType<float16>();
+    } else {
+      return false;
+    }
+  }
+
+ private:
+  template <typename T>
+  bool DoRunWithType() {
+    const int num_blobs = InputSize() / num_devices_;
+    std::vector<int> devices(num_devices_);
+    for (int i = 0; i < num_devices_; ++i) {
+      devices[i] = GetGPUIDForPointer(Input(i).raw_data());
+    }
+    for (int i = 0; i < InputSize(); ++i) {
+      const auto& X = Input(i);
+      CAFFE_ENFORCE_EQ(X.size(), Input(i - i % num_devices_).size());
+      auto* Y = Output(i);
+      if (Y != &X) {
+        DeviceGuard g(devices[i % num_devices_]);
+        Y->ResizeLike(X);
+        Y->template mutable_data<T>();
+      }
+    }
+
+    // Buckets of consecutive blobs, a blob larger than a bucket is reduced
+    // on its own
+    const TIndex bucket_size =
+        std::max<TIndex>(1, bucket_size_bytes_ / sizeof(T));
+    std::vector<std::pair<int, int>> buckets;
+    TIndex max_fused_size = 0;
+    for (int begin = 0; begin < num_blobs;) {
+      int end = begin;
+      TIndex size = 0;
+      while (end < num_blobs &&
+             (end == begin ||
+              size + Input(end * num_devices_).size() <= bucket_size)) {
+        size += Input(end * num_devices_).size();
+        ++end;
+      }
+      if (end - begin > 1) {
+        max_fused_size = std::max(max_fused_size, size);
+      }
+      buckets.emplace_back(begin, end);
+      begin = end;
+    }
+    // The buffers are not reallocated between the collectives, which use
+    // them asynchronously
+    if (max_fused_size > 0) {
+      for (int i = 0; i < num_devices_; ++i) {
+        DeviceGuard g(devices[i]);
+        buffers_[i]->Resize(max_fused_size);
+        buffers_[i]->template mutable_data<T>();
+      }
+    }
+
+    for (const auto& bucket : buckets) {
+      nccl::NCCLExecution ex;
+      ex.stream_gpu_id = context_.cuda_gpu_id();
+      ex.stream = context_.cuda_stream();
+      ex.elements.resize(num_devices_);
+      for (int i = 0; i < num_devices_; ++i) {
+        auto& el = ex.elements[i];
+        el.device = devices[i];
+        if (bucket.second - bucket.first == 1) {
+          el.src = &Input(bucket.first * num_devices_ + i);
+          el.dst = Output(bucket.first * num_devices_ + i);
+          continue;
+        }
+        TIndex size = 0;
+        for (int blob = bucket.first; blob < bucket.second; ++blob) {
+          el.fused_srcs.push_back(&Input(blob * num_devices_ + i));
+          el.fused_dsts.push_back(Output(blob * num_devices_ + i));
+          size += el.fused_srcs.back()->size();
+        }
+        views_[i]->Resize(size);
+        views_[i]->ShareExternalPointer(buffers_[i]->template mutable_data<T>());
+        el.src = views_[i].get();
+        el.dst = views_[i].get();
+      }
+      nccl::NCCL<T>::AllReduce(ex);
+    }
+    return true;
+  }
+
+  const int num_devices_;
+  const int64_t bucket_size_bytes_;
+  // Per device buffer of the largest bucket, and its view sized to the
+  // current bucket
+  std::vector<std::unique_ptr<TensorCUDA>> buffers_;
+  std::vector<std::unique_ptr<TensorCUDA>> views_;
+};
+
 class NCCLBroadcastOp final : public Operator<CUDAContext> {
  public:
   USE_OPERATOR_FUNCTIONS(CUDAContext);
@@ -169,6 +293,20 @@ std::pair<std::vector<DeviceOption>, std::vector<DeviceOption>> ncclOpDevInfer(
   return std::make_pair(opt, opt);
 }
 
+std::pair<std::vector<DeviceOption>, std::vector<DeviceOption>>
+ncclBucketedOpDevInfer(const OperatorDef& def) {
+  const int num_devices =
+      ArgumentHelper(def).GetSingleArgument<int>("num_devices", 1);
+  std::vector<DeviceOption> opt;
+  for (int i = 0; i < def.input().size(); ++i) {
+    DeviceOption dev;
+    dev.set_device_type(1);
+    dev.set_cuda_gpu_id(i % num_devices);
+    opt.push_back(dev);
+  }
+  return std::make_pair(opt, opt);
+}
+
 REGISTER_CUDA_OPERATOR(NCCLAllreduce, NCCLAllreduceOp);
 OPERATOR_SCHEMA(NCCLAllreduce)
     .NumInputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
@@ -179,6 +317,27 @@ OPERATOR_SCHEMA(NCCLAllreduce)
     .DeviceInferenceFunction(ncclOpDevInfer);
 SHOULD_NOT_DO_GRADIENT(NCCLAllreduce);
 
+REGISTER_CUDA_OPERATOR(NCCLBucketedAllreduce, NCCLBucketedAllreduceOp);
+OPERATOR_SCHEMA(NCCLBucketedAllreduce)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1, INT_MAX)
+    .IdenticalTypeAndShape()
+    .InputsCanCrossDevices()
+    .AllowOneToOneInplace()
+    .DeviceInferenceFunction(ncclBucketedOpDevInfer)
+    .SetDoc(R"DOC(
+Allreduce of many blobs across devices. The inputs hold the copies of every
+blob on each of the num_devices devices, blob after blob, and the outputs
+receive the sums in the same order. Consecutive blobs are packed into
+contiguous buckets of at most bucket_size_bytes, with one NCCL collective per
+bucket.
+)DOC")
+    .Arg("num_devices", "Number of devices holding a copy of every blob")
+    .Arg(
+        "bucket_size_bytes",
+        "(int, default 25MB) Max size of the blobs reduced by one collective");
+SHOULD_NOT_DO_GRADIENT(NCCLBucketedAllreduce);
+
 REGISTER_CUDA_OPERATOR(NCCLBroadcast, NCCLBroadcastOp);
 OPERATOR_SCHEMA(NCCLBroadcast)
     .NumInputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
@@ -205,6 +364,11 @@ OPERATOR_SCHEMA(NCCLAllGather)
     .NumInputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
     .NumOutputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
     .InputsCanCrossDevices()
+    .Arg(
+        "flat",
+        "(bool, default false) Concatenate the elements of the inputs into "
+        "outputs of the same shape if they have the right size, or 1D ones, "
+        "instead of stacking the inputs along a new first dim")
     .DeviceInferenceFunction(ncclOpDevInfer);
 SHOULD_NOT_DO_GRADIENT(NCCLAllGather);
 
@@ -213,6 +377,11 @@ OPERATOR_SCHEMA(NCCLReduceScatter)
     .NumInputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
     .NumOutputs(1, CAFFE2_COMPILE_TIME_MAX_GPUS)
     .InputsCanCrossDevices()
+    .Arg(
+        "flat",
+        "(bool, default false) Split the elements of the inputs into 1D "
+        "shards, their number must be a multiple of the number of inputs, "
+        "instead of splitting their first dim")
     .DeviceInferenceFunction(ncclOpDevInfer);
 SHOULD_NOT_DO_GRADIENT(NCCLReduceScatter);
 } // namespace
@@ -63,6 +63,38 @@ class NCCLOpsTest(hu.HypothesisTestCase):
             np.testing.assert_array_equal(outputs[0], output)
             self.assertEqual(outputs[0].tobytes(), output.tobytes())
 
+    @given(n=st.integers(min_value=2, max_value=workspace.NumCudaDevices()),
+           sizes=st.lists(st.integers(min_value=1, max_value=1000),
+                          min_size=1, max_size=5),
+           bucket_size_bytes=st.sampled_from([4, 4000, 25 << 20]),
+           in_place=st.booleans())
+    def test_nccl_bucketed_allreduce(self, n, sizes, bucket_size_bytes,
+                                     in_place):
+        xs = []
+        inputs = []
+        input_device_options = {}
+        for b, m in enumerate(sizes):
+            for i in range(n):
+                xs.append(np.random.randn(m).astype(np.float32))
+                inputs.append(str("x_{}_{}".format(b, i)))
+                input_device_options[inputs[-1]] = gpu_device(i)
+        prefix = "" if in_place else "o"
+        outputs = [prefix + x for x in inputs]
+        op = core.CreateOperator(
+            "NCCLBucketedAllreduce", inputs, outputs,
+            num_devices=n, bucket_size_bytes=bucket_size_bytes)
+
+        def bucketed_allreduce(*args):
+            assert len(args) == n * len(sizes)
+            result = []
+            for b in range(len(sizes)):
+                output = np.sum(args[b * n:(b + 1) * n], axis=0)
+                result.extend(output for _ in range(n))
+            return result
+
+        self.assertReferenceChecks(
+            hu.gpu_do, op, xs, bucketed_allreduce, input_device_options)
+
     @given(n=st.integers(min_value=2, max_value=workspace.NumCudaDevices()),
            m=st.integers(min_value=1, max_value=1000),
            root=st.integers(min_value=0,
@@ -144,6 +176,31 @@ class NCCLOpsTest(hu.HypothesisTestCase):
             hu.gpu_do, op, [xs[i] for i, _ in enumerate(inputs)],
             reduce_scatter, input_device_options)
 
+    @given(n=st.integers(min_value=2, max_value=workspace.NumCudaDevices()),
+           m=st.integers(min_value=1, max_value=1000))
+    def test_nccl_flat_reduce_scatter_all_gather(self, n, m):
+        # The hierarchical allreduce of data_parallel_model
+        xs = [np.random.randn(3, n * m).astype(np.float32) for i in range(n)]
+        inputs = [str("x_{}".format(i)) for i in range(n)]
+        shards = [str("s_{}".format(i)) for i in range(n)]
+        for i in range(n):
+            workspace.FeedBlob(inputs[i], xs[i], gpu_device(i))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "NCCLReduceScatter", inputs, shards, flat=True))
+        reduced = sum(xs).flatten()
+        for i in range(n):
+            np.testing.assert_allclose(
+                workspace.FetchBlob(shards[i]),
+                reduced[i * 3 * m:(i + 1) * 3 * m],
+                rtol=1e-5, atol=1e-5)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "NCCLAllGather", shards, inputs, flat=True))
+        for i in range(n):
+            output = workspace.FetchBlob(inputs[i])
+            self.assertEqual(output.shape, (3, n * m))
+            np.testing.assert_allclose(
+                output.flatten(), reduced, rtol=1e-5, atol=1e-5)
+
     @given(n=st.integers(min_value=2, max_value=workspace.NumCudaDevices()),
            m=st.integers(min_value=100000, max_value=100000),
            iters=st.integers(min_value=1, max_value=100),
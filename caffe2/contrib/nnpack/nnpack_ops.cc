@@ -54,13 +54,12 @@ nnp_convolution_algorithm get_nnp_convolution_algorithm(
 
 nnp_convolution_transform_strategy get_nnp_convolution_transform_strategy(
     const std::string& kts) {
-  if (kts == "BLOCK") {
-    return nnp_convolution_transform_strategy_block_based;
+  if (kts == "PRECOMPUTE") {
+    return nnp_convolution_transform_strategy_precompute;
   }
-  if (kts == "TUPLE") {
-    return nnp_convolution_transform_strategy_tuple_based;
-  }
-  return nnp_convolution_transform_strategy_block_based;
+  // BLOCK and TUPLE are the strategies of older NNPACK versions, which now
+  // both compute the kernel transforms on every run
+  return nnp_convolution_transform_strategy_compute;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,7 +99,9 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
         algo_(get_nnp_convolution_algorithm(
             OperatorBase::GetSingleArgument<std::string>("algo", "AUTO"))),
         kts_(get_nnp_convolution_transform_strategy(
-            OperatorBase::GetSingleArgument<std::string>("kts", "TUPLE"))) {
+            OperatorBase::GetSingleArgument<std::string>(
+                "convolution_transform_strategy",
+                OperatorBase::GetSingleArgument<std::string>("kts", "TUPLE")))) {
     OPERATOR_NEEDS_FEATURE(
         this->order_ == StorageOrder::NCHW,
         "NNPack only supports NCHW order. Please consider adding "
@@ -111,6 +112,11 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
     // NNPACK can be built with avx2 support only and might not be able to run
     // on a given machine.
     OPERATOR_NEEDS_FEATURE(has_nnpack(), "NNPack can't run here. No AVX2?");
+    if (kts_ == nnp_convolution_transform_strategy_precompute) {
+      transformed_filter_ =
+          ws->CreateBlob(operator_def.output(0) + "_nnpack_transformed_filter")
+              ->GetMutable<TensorCPU>();
+    }
   }
 
   bool RunOnDeviceWithOrderNCHW() override {
@@ -167,10 +173,20 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
         .height = static_cast<size_t>(stride[0])};
     if (N == 1) {
       VLOG(1) << "Running inference mode";
+      const bool reuse = transformed_filter_ &&
+          TransformFilter(
+              filter,
+              C / group_,
+              M / group_,
+              input_size,
+              padding,
+              kernel_size,
+              output_subsample);
       for (auto g = 0; g < group_; ++g) {
         const auto status = nnp_convolution_inference(
             algo_,
-            kts_,
+            reuse ? nnp_convolution_transform_strategy_reuse
+                  : nnp_convolution_transform_strategy_compute,
             C / group_,
             M / group_,
             input_size,
@@ -178,9 +194,15 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
             kernel_size,
             output_subsample,
             X.template data<float>() + g * H * W * (C / group_),
-            filter.template data<float>() + filter.size() / group_ * g,
+            reuse ? transformed_filter_->template data<float>() +
+                    transformed_filter_->size() / group_ * g
+                  : filter.template data<float>() + filter.size() / group_ * g,
             bias.template data<float>() + bias.size() / group_ * g,
             Y->template mutable_data<float>() + g * oH * oW * (M / group_),
+            nullptr /* workspace buffer, allocated by NNPACK */,
+            nullptr /* workspace size */,
+            nnp_activation_identity,
+            nullptr /* activation parameter */,
             nnpack_threadpool(),
             nullptr);
         CAFFE_ENFORCE(nnp_status_success == status, "");
@@ -200,6 +222,10 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
             filter.template data<float>() + filter.size() / group_ * g,
             bias.template data<float>() + bias.size() / group_ * g,
             Y->template mutable_data<float>() + g * oH * oW * (M / group_),
+            nullptr /* workspace buffer, allocated by NNPACK */,
+            nullptr /* workspace size */,
+            nnp_activation_identity,
+            nullptr /* activation parameter */,
             nnpack_threadpool(),
             nullptr);
         CAFFE_ENFORCE(nnp_status_success == status, "");
@@ -209,8 +235,101 @@ class NNPACKConvOp final : public ConvPoolOpBase<CPUContext> {
   }
 
  private:
+  // Transforms the filter of every group once with NNPACK's precompute
+  // strategy, into the transformed filter blob, and again only when the
+  // filter or the input size changes. The filter is told by its address,
+  // data, shape and version(), like the packed weights of the FC PACKED
+  // engine. Returns false, and stops precomputing, when NNPACK can't
+  // precompute the transforms of this convolution, e.g. for the direct or
+  // implicit GEMM algorithms.
+  bool TransformFilter(
+      const TensorCPU& filter,
+      const size_t input_channels,
+      const size_t output_channels,
+      const nnp_size input_size,
+      const nnp_padding padding,
+      const nnp_size kernel_size,
+      const nnp_size output_subsample) {
+    if (&filter == filter_ && filter.version() == filter_version_ &&
+        filter.raw_data() == filter_data_ && filter.dims() == filter_dims_ &&
+        input_size.width == input_size_.width &&
+        input_size.height == input_size_.height &&
+        transformed_filter_->size() > 0) {
+      return true;
+    }
+    size_t transformed_size = 0;
+    auto status = nnp_convolution_inference(
+        algo_,
+        nnp_convolution_transform_strategy_precompute,
+        input_channels,
+        output_channels,
+        input_size,
+        padding,
+        kernel_size,
+        output_subsample,
+        nullptr /* input */,
+        nullptr /* filter */,
+        nullptr /* bias */,
+        nullptr /* output */,
+        nullptr /* transformed filter */,
+        &transformed_size,
+        nnp_activation_identity,
+        nullptr /* activation parameter */,
+        nnpack_threadpool(),
+        nullptr);
+    if (status != nnp_status_success) {
+      LOG(WARNING) << "NNPACK can't precompute the kernel transforms of "
+                   << debug_def().output(0) << ", computing them every run";
+      transformed_filter_ = nullptr;
+      return false;
+    }
+    // Rounded up to floats
+    const TIndex group_size =
+        (transformed_size + sizeof(float) - 1) / sizeof(float);
+    transformed_filter_->Resize(group_, group_size);
+    for (auto g = 0; g < group_; ++g) {
+      size_t size = group_size * sizeof(float);
+      status = nnp_convolution_inference(
+          algo_,
+          nnp_convolution_transform_strategy_precompute,
+          input_channels,
+          output_channels,
+          input_size,
+          padding,
+          kernel_size,
+          output_subsample,
+          nullptr /* input */,
+          filter.template data<float>() + filter.size() / group_ * g,
+          nullptr /* bias */,
+          nullptr /* output */,
+          transformed_filter_->template mutable_data<float>() + g * group_size,
+          &size,
+          nnp_activation_identity,
+          nullptr /* activation parameter */,
+          nnpack_threadpool(),
+          nullptr);
+      CAFFE_ENFORCE(
+          nnp_status_success == status,
+          "NNPACK failed to precompute the kernel transforms");
+    }
+    filter_ = &filter;
+    filter_version_ = filter.version();
+    filter_data_ = filter.raw_data();
+    filter_dims_ = filter.dims();
+    input_size_ = input_size;
+    return true;
+  }
+
   const nnp_convolution_algorithm algo_;
   const nnp_convolution_transform_strategy kts_;
+  // With the PRECOMPUTE strategy, the transformed filters of all the groups
+  TensorCPU* transformed_filter_ = nullptr;
+  // The filter and input size transformed_filter_ was computed for
+  const TensorCPU* filter_ = nullptr;
+  uint64_t filter_version_ = 0;
+  const void* filter_data_ = nullptr;
+  std::vector<TIndex> filter_dims_;
+  nnp_size input_size_ = {0, 0};
 };
 
 class NNPACKMaxPoolOp final : public ConvPoolOpBase<CPUContext> {
@@ -93,6 +93,42 @@ class NNPackOpsTest(hu.HypothesisTestCase):
             atol=1e-4,
             rtol=1e-4)
 
+    @given(kernel=st.sampled_from([3, 5]),
+           size=st.integers(8, 12),
+           input_channels=st.integers(1, 8),
+           output_channels=st.integers(1, 8),
+           algo=st.sampled_from(["AUTO", "WINOGRAD", "FT8", "FT16"]))
+    def test_convolution_precompute(self, kernel, size, input_channels,
+                                    output_channels, algo):
+        X = np.random.rand(
+            1, input_channels, size, size).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        ref_op = core.CreateOperator(
+            "Conv", ["X", "w", "b"], ["Y_ref"], kernel=kernel, pad=1,
+            order="NCHW")
+        op = core.CreateOperator(
+            "Conv", ["X", "w", "b"], ["Y"], kernel=kernel, pad=1,
+            order="NCHW", algo=algo,
+            convolution_transform_strategy="PRECOMPUTE", engine="NNPACK")
+        self.ws.create_blob("X").feed(X)
+        self.ws.create_blob("b").feed(b)
+        net = core.Net("precompute")
+        net.Proto().op.extend([ref_op, op])
+        created_net = self.ws.create_net(net)
+        # The kernels are transformed again when the weights change
+        for _ in range(2):
+            w = np.random.rand(
+                output_channels, input_channels, kernel, kernel).astype(
+                    np.float32) - 0.5
+            self.ws.create_blob("w").feed(w)
+            for _ in range(2):
+                created_net.run()
+                np.testing.assert_allclose(
+                    self.ws.blobs["Y_ref"].fetch(),
+                    self.ws.blobs["Y"].fetch(),
+                    atol=1e-4,
+                    rtol=1e-4)
+
     @given(size=st.sampled_from([6, 8]),
            input_channels=st.integers(1, 8),
            batch_size=st.integers(1, 5))
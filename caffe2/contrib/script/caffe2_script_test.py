@@ -7,6 +7,7 @@ from hypothesis import given
 
 from caffe2.python import core, workspace
 from caffe2.proto import caffe2_pb2
+from google.protobuf import text_format
 import caffe2.python.hypothesis_test_util as hu
 import hypothesis.strategies as st
 
@@ -518,3 +519,35 @@ class TestCaffe2Script(hu.HypothesisTestCase):
 
         output = workspace.FetchBlob('d')
         np.testing.assert_allclose(output, vector)
+
+    @given(seed=st.integers(min_value=0, max_value=65536), **hu.gcs_cpu_only)
+    def test_optimize(self, seed, gc, dc):
+        program = """
+        def f(x, w) -> (y):
+            y = x
+            n = 0
+            while n < 3:
+                y = Sigmoid(y * (w * 3f) + w) - 0.5f
+                n = n + 1
+        """
+        np.random.seed(int(seed))
+        x = np.random.rand(3, 700).astype(np.float32)
+        w = np.random.rand(3, 700).astype(np.float32)
+
+        outputs = []
+        for optimize in [False, True]:
+            CU = core.C.CompilationUnit(optimize=optimize)
+            CU.define(program)
+            feed_inputs(dict(x=x, w=w))
+            CU.create_net('f').run()
+            outputs.append(workspace.FetchBlob('y'))
+
+        # The loop body is fused, and w * 3 hoisted out of the loop
+        proto = caffe2_pb2.NetDef()
+        text_format.Merge(CU.get_proto('f'), proto)
+        types = [op.type for op in proto.op]
+        self.assertIn('Mul', types)
+        while_op = proto.op[types.index('While')]
+        body = [arg.n for arg in while_op.arg if arg.name == 'loop_net'][0]
+        self.assertIn('FusedElementwise', [op.type for op in body.op])
+        np.testing.assert_allclose(outputs[1], outputs[0], rtol=1e-5)
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <set>
+
 #include "caffe2/core/net.h"
+#include "caffe2/transforms/elementwise_fusion.h"
 #include "caffe2/utils/proto_utils.h"
 
 #include "compiler.h"
@@ -47,6 +51,313 @@ struct FunctionDefinition {
   std::vector<std::string> outputs;
 };
 
+// The temporaries the compiler names with fresh(), assigned once
+bool isTemporary(const std::string& name) {
+  return name.compare(0, 2, "$t") == 0;
+}
+
+// The operators computing their outputs from their inputs only, as emitted
+// for expressions
+static std::unordered_set<std::string> pure_ops = {
+    "ConstantFill", "Copy", "Cast",    "Conditional", "Add",  "Sub",  "Mul",
+    "Div",          "NE",   "EQ",      "LT",          "GT",   "LE",   "GE",
+    "And",          "Or",   "Not",     "Negative",    "Relu", "Tanh", "Exp",
+    "Log",          "Sqrt", "Sigmoid", "Sqr",         "Abs",  "Scale", "Clip",
+};
+
+bool hasNets(const OperatorDef& op) {
+  for (const auto& arg : op.arg()) {
+    if (arg.has_n()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void setOps(NetDef* net, const std::vector<OperatorDef>& ops) {
+  net->clear_op();
+  for (const auto& op : ops) {
+    *net->add_op() = op;
+  }
+}
+
+// Optimizations of the nets of the functions, with the knowledge of the
+// compiler that temporaries are only read by the expressions they were
+// emitted for:
+// - loop invariant expressions are hoisted out of While conditions and
+//   bodies, as long as they only write temporaries,
+// - chains of pointwise float operators are fused into FusedElementwise
+//   operators, keeping every blob but the temporaries,
+// - temporaries whose last reader has run are reused for the next ones, so
+//   that their tensors are too.
+struct FunctionOptimizer {
+  void run(NetDef* net) {
+    hoistLoopInvariants(net);
+    occurrences_.clear();
+    findOccurrences(*net);
+    findNonFloatBlobs(*net);
+    fuseElementwise(net);
+    occurrences_.clear();
+    findOccurrences(*net);
+    reuseTemporaries(net);
+  }
+
+ private:
+  void hoistLoopInvariants(NetDef* net) {
+    std::vector<OperatorDef> ops;
+    for (auto& op : *net->mutable_op()) {
+      // Inner loops first, so that their invariants can be the ones of the
+      // outer loops too
+      for (auto& arg : *op.mutable_arg()) {
+        if (arg.has_n()) {
+          hoistLoopInvariants(arg.mutable_n());
+        }
+      }
+      if (op.type() == "While") {
+        // The number of writes of every blob in the loop
+        std::unordered_map<std::string, int> writes;
+        for (const auto& arg : op.arg()) {
+          if (arg.has_n()) {
+            countWrites(arg.n(), &writes);
+          }
+        }
+        const std::set<std::string> condition(
+            op.input().begin(), op.input().end());
+        // The condition, then the body
+        for (auto& arg : *op.mutable_arg()) {
+          if (!arg.has_n()) {
+            continue;
+          }
+          std::vector<OperatorDef> kept;
+          for (const auto& inner : arg.n().op()) {
+            if (isInvariant(inner, writes, condition)) {
+              ops.push_back(inner);
+              for (const auto& output : inner.output()) {
+                writes.erase(output);
+              }
+            } else {
+              kept.push_back(inner);
+            }
+          }
+          setOps(arg.mutable_n(), kept);
+        }
+      }
+      ops.push_back(op);
+    }
+    setOps(net, ops);
+  }
+
+  void countWrites(
+      const NetDef& net,
+      std::unordered_map<std::string, int>* writes) {
+    for (const auto& op : net.op()) {
+      for (const auto& output : op.output()) {
+        ++(*writes)[output];
+      }
+      for (const auto& arg : op.arg()) {
+        if (arg.has_n()) {
+          countWrites(arg.n(), writes);
+        }
+      }
+    }
+  }
+
+  bool isInvariant(
+      const OperatorDef& op,
+      const std::unordered_map<std::string, int>& writes,
+      const std::set<std::string>& condition) {
+    if (!pure_ops.count(op.type()) || hasNets(op)) {
+      return false;
+    }
+    for (const auto& input : op.input()) {
+      if (writes.count(input)) {
+        return false;
+      }
+    }
+    for (const auto& output : op.output()) {
+      // The blob read by the While operator is written by its condition
+      if (!isTemporary(output) || writes.at(output) != 1 ||
+          condition.count(output)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The nets every blob appears in, not counting those of the nested nets
+  void findOccurrences(const NetDef& net) {
+    for (const auto& op : net.op()) {
+      for (const auto* blobs : {&op.input(), &op.output()}) {
+        for (const auto& blob : *blobs) {
+          occurrences_[blob].insert(&net);
+        }
+      }
+      for (const auto& arg : op.arg()) {
+        if (arg.has_n()) {
+          findOccurrences(arg.n());
+        }
+      }
+    }
+  }
+
+  // Whether blob is a temporary only appearing in net, which no operator
+  // of other nets reads
+  bool isLocal(const std::string& blob, const NetDef& net) const {
+    if (!isTemporary(blob)) {
+      return false;
+    }
+    const auto& nets = occurrences_.at(blob);
+    return nets.size() == 1 && *nets.begin() == &net;
+  }
+
+  // The blobs holding integers or booleans: the outputs of the integer and
+  // boolean constants, of the casts to them, of the comparisons, and of the
+  // operators reading such blobs. The other blobs are taken to be float.
+  void findNonFloatBlobs(const NetDef& net) {
+    size_t size;
+    do {
+      size = non_float_blobs_.size();
+      addNonFloatBlobs(net);
+    } while (non_float_blobs_.size() != size);
+  }
+
+  void addNonFloatBlobs(const NetDef& net) {
+    static const std::unordered_set<std::string> boolean_ops = {
+        "NE", "EQ", "LT", "GT", "LE", "GE", "And", "Or", "Not"};
+    for (const auto& op : net.op()) {
+      ArgumentHelper helper(op);
+      bool non_float = boolean_ops.count(op.type()) > 0;
+      if (op.type() == "ConstantFill") {
+        non_float = helper.GetSingleArgument<int>(
+                        "dtype", TensorProto_DataType_FLOAT) !=
+            TensorProto_DataType_FLOAT;
+      } else if (op.type() == "Cast") {
+        non_float = helper.GetSingleArgument<int>(
+                        "to", TensorProto_DataType_FLOAT) !=
+            TensorProto_DataType_FLOAT;
+      }
+      for (const auto& input : op.input()) {
+        non_float |= non_float_blobs_.count(input) > 0;
+      }
+      if (non_float) {
+        non_float_blobs_.insert(op.output().begin(), op.output().end());
+      }
+      for (const auto& arg : op.arg()) {
+        if (arg.has_n()) {
+          addNonFloatBlobs(arg.n());
+        }
+      }
+    }
+  }
+
+  void fuseElementwise(NetDef* net) {
+    for (auto& op : *net->mutable_op()) {
+      for (auto& arg : *op.mutable_arg()) {
+        if (arg.has_n()) {
+          fuseElementwise(arg.mutable_n());
+        }
+      }
+    }
+    // The constants first, which would otherwise split the chains of the
+    // expressions reading them
+    std::vector<OperatorDef> constants;
+    std::vector<OperatorDef> others;
+    for (const auto& op : net->op()) {
+      const bool constant = op.type() == "ConstantFill" &&
+          op.input_size() == 0 && isLocal(op.output(0), *net);
+      (constant ? constants : others).push_back(op);
+    }
+    constants.insert(constants.end(), others.begin(), others.end());
+    setOps(net, constants);
+
+    ElementwiseFusionOptions options;
+    options.fuse_scalar_broadcast = true;
+    options.non_float_blobs = non_float_blobs_;
+    std::set<std::string> kept;
+    for (const auto& op : net->op()) {
+      for (const auto* blobs : {&op.input(), &op.output()}) {
+        for (const auto& blob : *blobs) {
+          if (!isLocal(blob, *net)) {
+            kept.insert(blob);
+          }
+        }
+      }
+    }
+    for (const auto& blob : kept) {
+      net->add_external_output(blob);
+    }
+    *net = FuseElementwise(*net, options);
+    net->clear_external_output();
+  }
+
+  void reuseTemporaries(NetDef* net) {
+    for (auto& op : *net->mutable_op()) {
+      for (auto& arg : *op.mutable_arg()) {
+        if (arg.has_n()) {
+          reuseTemporaries(arg.mutable_n());
+        }
+      }
+    }
+    std::unordered_map<std::string, int> last_use;
+    for (int i = 0; i < net->op_size(); ++i) {
+      const auto& op = net->op(i);
+      for (const auto* blobs : {&op.input(), &op.output()}) {
+        for (const auto& blob : *blobs) {
+          if (isLocal(blob, *net)) {
+            last_use[blob] = i;
+          }
+        }
+      }
+    }
+    std::unordered_map<std::string, std::string> renames;
+    std::vector<std::string> free_names;
+    auto rename = [&](const std::string& blob, bool written) {
+      auto it = renames.find(blob);
+      if (it == renames.end()) {
+        std::string name = blob;
+        if (written && !free_names.empty()) {
+          name = free_names.back();
+          free_names.pop_back();
+        }
+        it = renames.emplace(blob, name).first;
+      }
+      return it->second;
+    };
+    for (int i = 0; i < net->op_size(); ++i) {
+      auto* op = net->mutable_op(i);
+      std::vector<std::string> last_used;
+      for (const auto* blobs : {&op->input(), &op->output()}) {
+        for (const auto& blob : *blobs) {
+          auto it = last_use.find(blob);
+          if (it != last_use.end() && it->second == i &&
+              std::find(last_used.begin(), last_used.end(), blob) ==
+                  last_used.end()) {
+            last_used.push_back(blob);
+          }
+        }
+      }
+      for (int j = 0; j < op->input_size(); ++j) {
+        if (last_use.count(op->input(j))) {
+          op->set_input(j, rename(op->input(j), false));
+        }
+      }
+      for (int j = 0; j < op->output_size(); ++j) {
+        if (last_use.count(op->output(j))) {
+          op->set_output(j, rename(op->output(j), true));
+        }
+      }
+      // Only free once the operator is done, the outputs never take the
+      // names of its inputs as some operators cannot run in place
+      for (const auto& blob : last_used) {
+        free_names.push_back(renames.at(blob));
+      }
+    }
+  }
+
+  std::unordered_map<std::string, std::set<const NetDef*>> occurrences_;
+  std::set<std::string> non_float_blobs_;
+};
+
 } // namespace
 
 using SymbolTable = std::unordered_map<std::string, FunctionDefinition>;
@@ -723,15 +1034,20 @@ struct DefCompiler {
 };
 
 struct CompilationUnitImpl {
+  explicit CompilationUnitImpl(bool optimize) : optimize(optimize) {}
+
   void defineFunction(const Def& def) {
     if (functions.count(def.name().name()) > 0) {
       throw ErrorReport(def) << def.name().name() << " already defined.";
     }
-    DefCompiler c(
+    auto& definition =
         functions.emplace(def.name().name(), FunctionDefinition(def))
-            .first->second,
-        functions);
+            .first->second;
+    DefCompiler c(definition, functions);
     c.run();
+    if (optimize) {
+      FunctionOptimizer().run(definition.net_def.get());
+    }
   }
 
   void define(const std::string& str) {
@@ -763,9 +1079,11 @@ struct CompilationUnitImpl {
  private:
   friend struct DefCompiler;
   SymbolTable functions;
+  const bool optimize;
 };
 
-CompilationUnit::CompilationUnit() : pImpl(new CompilationUnitImpl()) {}
+CompilationUnit::CompilationUnit(bool optimize)
+    : pImpl(new CompilationUnitImpl(optimize)) {}
 
 void CompilationUnit::define(const std::string& str) {
   return pImpl->define(str);
@@ -8,7 +8,11 @@ namespace script {
 
 struct CompilationUnitImpl;
 struct CompilationUnit {
-  CompilationUnit();
+  // With optimize, the loop invariants of the functions are hoisted out of
+  // their loops, their pointwise float expressions are fused, and their
+  // temporaries reused. The fused expressions then take the values not
+  // derived from integer or boolean constants or casts to be float.
+  explicit CompilationUnit(bool optimize = false);
   void define(const std::string& str);
   void defineExtern(const std::string& str, std::unique_ptr<NetDef> netdef);
   std::unique_ptr<NetBase> createNet(Workspace* ws, const std::string& name);
@@ -0,0 +1,466 @@
+#include "shm_blobs_queue.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <thread>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+// Constants for user tracepoints
+static constexpr int SDT_NONBLOCKING_OP = 0;
+static constexpr int SDT_BLOCKING_OP = 1;
+static constexpr uint64_t SDT_TIMEOUT = (uint64_t)-1;
+static constexpr uint64_t SDT_ABORT = (uint64_t)-2;
+static constexpr uint64_t SDT_CANCEL = (uint64_t)-3;
+
+namespace {
+
+constexpr size_t kAlignment = 64;
+constexpr int kMaxDims = 8;
+
+size_t align(size_t bytes) {
+  return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// States of a slot, it is only read once full and only written once the
+// tensors of its last read are released
+enum SlotState : int { kFree = 0, kWriting, kFull, kRead };
+
+struct Header {
+  std::atomic<int> isInitialized;
+  std::atomic<int> countMapped;
+  pthread_mutex_t mutex;
+  pthread_cond_t readable;
+  pthread_cond_t writable;
+  uint64_t capacity;
+  uint64_t numBlobs;
+  uint64_t slotBytes;
+  // Protected by the mutex
+  int64_t reader;
+  int64_t writer;
+  int closed;
+};
+
+struct SlotHeader {
+  // Dequeued tensors still sharing the slot
+  std::atomic<int> refs;
+  // Protected by the mutex
+  int state;
+};
+
+struct BlobMeta {
+  int32_t dataType;
+  int32_t ndim;
+  int64_t dims[kMaxDims];
+  uint64_t offset;
+  uint64_t nbytes;
+};
+
+} // namespace
+
+class ShmBlobsQueue::Arena {
+ public:
+  Arena(
+      const std::string& name,
+      size_t capacity,
+      size_t numBlobs,
+      size_t slotBytes);
+  ~Arena();
+
+  Header* header() {
+    return header_;
+  }
+
+  SlotHeader* slot(int64_t pos) {
+    return reinterpret_cast<SlotHeader*>(
+        base_ + headerBytes_ + (pos % capacity_) * slotStride_);
+  }
+
+  BlobMeta* blobs(int64_t pos) {
+    return reinterpret_cast<BlobMeta*>(slot(pos) + 1);
+  }
+
+  char* data(int64_t pos) {
+    return reinterpret_cast<char*>(slot(pos)) + slotHeaderBytes_;
+  }
+
+  void lock();
+  void unlock() {
+    pthread_mutex_unlock(&header_->mutex);
+  }
+  // Waits on cv until notified, returns false if deadline, on the
+  // monotonic clock, passed first
+  bool wait(pthread_cond_t* cv, const timespec* deadline = nullptr);
+
+  // Releases a tensor sharing the slot of pos
+  void release(int64_t pos);
+
+ private:
+  const std::string name_;
+  const int64_t capacity_;
+  const size_t headerBytes_;
+  const size_t slotHeaderBytes_;
+  const size_t slotStride_;
+  const size_t size_;
+  char* base_{nullptr};
+  Header* header_{nullptr};
+};
+
+ShmBlobsQueue::Arena::Arena(
+    const std::string& name,
+    size_t capacity,
+    size_t numBlobs,
+    size_t slotBytes)
+    : name_(name),
+      capacity_(capacity),
+      headerBytes_(align(sizeof(Header))),
+      slotHeaderBytes_(align(sizeof(SlotHeader) + numBlobs * sizeof(BlobMeta))),
+      slotStride_(slotHeaderBytes_ + align(slotBytes)),
+      size_(headerBytes_ + capacity * slotStride_) {
+  CAFFE_ENFORCE_GT(capacity, 0);
+  CAFFE_ENFORCE_GT(numBlobs, 0);
+  CAFFE_ENFORCE_GT(slotBytes, 0);
+  // Same protocol as ShmProcessMutex: the creator initializes the header
+  // while the other processes wait for it
+  while (true) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+      CAFFE_ENFORCE(
+          errno == ENOENT,
+          "shm_open failed with not ENOENT: ",
+          strerror(errno));
+      fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (fd == -1 && errno == EEXIST) {
+        // Some other process created first; loop around to re-open
+        continue;
+      }
+      CAFFE_ENFORCE(fd != -1, "shm_open failed with create: ", strerror(errno));
+      auto rv = ftruncate(fd, size_);
+      CAFFE_ENFORCE(rv != -1, "ftruncate: ", strerror(errno));
+      base_ = static_cast<char*>(
+          mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+      CAFFE_ENFORCE(base_ != MAP_FAILED, "mmap: ", strerror(errno));
+      ::close(fd);
+      header_ = reinterpret_cast<Header*>(base_);
+
+      pthread_mutexattr_t mutexAttr;
+      pthread_mutexattr_init(&mutexAttr);
+      pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+      pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+      pthread_mutex_init(&header_->mutex, &mutexAttr);
+      pthread_mutexattr_destroy(&mutexAttr);
+      pthread_condattr_t condAttr;
+      pthread_condattr_init(&condAttr);
+      pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+      pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+      pthread_cond_init(&header_->readable, &condAttr);
+      pthread_cond_init(&header_->writable, &condAttr);
+      pthread_condattr_destroy(&condAttr);
+      // The rest of the object is all 0: the slots are free
+      header_->capacity = capacity;
+      header_->numBlobs = numBlobs;
+      header_->slotBytes = slotBytes;
+      header_->countMapped = 1;
+      header_->isInitialized.store(1, std::memory_order_release);
+      break;
+    }
+
+    // The object exists, wait for its creator to size it
+    struct stat st;
+    while (true) {
+      CAFFE_ENFORCE(fstat(fd, &st) == 0, "fstat: ", strerror(errno));
+      if (st.st_size > 0) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+    if (size_t(st.st_size) != size_) {
+      ::close(fd);
+      CAFFE_THROW(
+          "Shared memory queue ", name, " was created with different sizes");
+    }
+    base_ = static_cast<char*>(
+        mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    CAFFE_ENFORCE(base_ != MAP_FAILED, "mmap: ", strerror(errno));
+    ::close(fd);
+    header_ = reinterpret_cast<Header*>(base_);
+    while (header_->isInitialized.load(std::memory_order_acquire) == 0) {
+      // Spin; should be done soon
+    }
+    if (header_->capacity != capacity || header_->numBlobs != numBlobs ||
+        header_->slotBytes != slotBytes) {
+      munmap(base_, size_);
+      CAFFE_THROW(
+          "Shared memory queue ", name, " was created with different sizes");
+    }
+    // If we are "locked-out" (shared object being destroyed), retry
+    if (header_->countMapped.fetch_add(1, std::memory_order_relaxed) < 0) {
+      header_->countMapped.fetch_sub(1, std::memory_order_relaxed);
+      munmap(base_, size_);
+      continue;
+    }
+    break;
+  }
+}
+
+ShmBlobsQueue::Arena::~Arena() {
+  // The last process to unmap the object locks out the others and unlinks
+  // it, like ShmProcessMutex
+  int oldCount = header_->countMapped.fetch_sub(1, std::memory_order_relaxed);
+  bool doUnlink = false;
+  if (oldCount == 1) {
+    oldCount = 0;
+    doUnlink = header_->countMapped.compare_exchange_strong(
+        oldCount, INT_MIN, std::memory_order_relaxed);
+  }
+  if (munmap(base_, size_) != 0) {
+    LOG(ERROR) << "munmap failed: " << strerror(errno);
+  }
+  if (doUnlink && shm_unlink(name_.c_str()) != 0) {
+    LOG(ERROR) << "shm_unlink failed: " << strerror(errno);
+  }
+}
+
+void ShmBlobsQueue::Arena::lock() {
+  auto rv = pthread_mutex_lock(&header_->mutex);
+  if (rv == EOWNERDEAD) {
+    // The owner died, the state it protects is only updated in small
+    // critical sections which don't leave it inconsistent
+    pthread_mutex_consistent(&header_->mutex);
+  } else {
+    CAFFE_ENFORCE_EQ(rv, 0, "pthread_mutex_lock: ", strerror(rv));
+  }
+}
+
+bool ShmBlobsQueue::Arena::wait(
+    pthread_cond_t* cv,
+    const timespec* deadline) {
+  auto rv = deadline ? pthread_cond_timedwait(cv, &header_->mutex, deadline)
+                     : pthread_cond_wait(cv, &header_->mutex);
+  if (rv == EOWNERDEAD) {
+    pthread_mutex_consistent(&header_->mutex);
+  }
+  return rv != ETIMEDOUT;
+}
+
+void ShmBlobsQueue::Arena::release(int64_t pos) {
+  if (slot(pos)->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    lock();
+    slot(pos)->state = kFree;
+    pthread_cond_broadcast(&header_->writable);
+    unlock();
+  }
+}
+
+ShmBlobsQueue::ShmBlobsQueue(
+    Workspace* ws,
+    const std::string& queueName,
+    const std::string& shmName,
+    size_t capacity,
+    size_t numBlobs,
+    size_t slotBytes,
+    const std::vector<std::string>& fieldNames)
+    // The records are in the arena, not in blobs of the workspace
+    : BlobsQueue(ws, queueName, 0, numBlobs, false, fieldNames),
+      arena_(std::make_shared<Arena>(shmName, capacity, numBlobs, slotBytes)) {
+}
+
+bool ShmBlobsQueue::blockingRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  Timer readTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
+  CAFFE_ENFORCE(inputs.size() >= numBlobs_);
+  auto* header = arena_->header();
+  auto canRead = [&]() {
+    return header->reader < header->writer &&
+        arena_->slot(header->reader)->state == kFull;
+  };
+  auto done = [&]() {
+    return header->closed && header->reader == header->writer;
+  };
+  // Decrease queue balance before reading to indicate queue read pressure
+  // is being increased (-ve queue balance indicates more reads than writes)
+  CAFFE_EVENT(stats_, queue_balance, -1);
+  arena_->lock();
+  if (!canRead() && !done()) {
+    Timer blockedTimer;
+    timespec deadline;
+    if (timeout_secs > 0) {
+      clock_gettime(CLOCK_MONOTONIC, &deadline);
+      int64_t nanos = deadline.tv_nsec + int64_t(timeout_secs * 1e9);
+      deadline.tv_sec += nanos / 1000000000;
+      deadline.tv_nsec = nanos % 1000000000;
+    }
+    while (!canRead() && !done() &&
+           arena_->wait(
+               &header->readable, timeout_secs > 0 ? &deadline : nullptr)) {
+    }
+    CAFFE_EVENT(stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+  }
+  if (!canRead()) {
+    bool closed = header->closed;
+    arena_->unlock();
+    if (!closed) {
+      LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_TIMEOUT);
+    } else {
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_CANCEL);
+    }
+    return false;
+  }
+  const auto pos = header->reader++;
+  auto* slot = arena_->slot(pos);
+  slot->state = kRead;
+  slot->refs.store(numBlobs_, std::memory_order_relaxed);
+  CAFFE_EVENT(stats_, queue_occupancy, header->writer - pos);
+  arena_->unlock();
+
+  auto* blobs = arena_->blobs(pos);
+  auto* data = arena_->data(pos);
+  auto arena = arena_;
+  for (size_t i = 0; i < numBlobs_; ++i) {
+    const auto& meta = blobs[i];
+    auto* tensor = inputs[i]->GetMutable<TensorCPU>();
+    tensor->Resize(std::vector<TIndex>(meta.dims, meta.dims + meta.ndim));
+    tensor->ShareExternalPointer(
+        data + meta.offset,
+        DataTypeToTypeMeta(static_cast<TensorProto::DataType>(meta.dataType)),
+        meta.nbytes,
+        [arena, pos](void*) { arena->release(pos); });
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, meta.nbytes, i);
+  }
+  CAFFE_SDT(queue_read_end, name, (void*)this, header->writer - pos - 1);
+  CAFFE_EVENT(stats_, queue_dequeued_records);
+  CAFFE_EVENT(stats_, read_time_ns, readTimer.NanoSeconds());
+  return true;
+}
+
+bool ShmBlobsQueue::write(const std::vector<Blob*>& inputs, bool blocking) {
+  CAFFE_ENFORCE(inputs.size() >= numBlobs_);
+  auto* header = arena_->header();
+  std::vector<BlobMeta> metas(numBlobs_);
+  size_t bytes = 0;
+  for (size_t i = 0; i < numBlobs_; ++i) {
+    const auto& tensor = inputs[i]->Get<TensorCPU>();
+    auto dataType = TypeMetaToDataType(tensor.meta());
+    CAFFE_ENFORCE(
+        dataType != TensorProto_DataType_UNDEFINED &&
+            dataType != TensorProto_DataType_STRING,
+        "A shared memory queue can't hold tensors of type ",
+        tensor.meta().name());
+    CAFFE_ENFORCE_LE(tensor.ndim(), kMaxDims);
+    auto& meta = metas[i];
+    meta.dataType = dataType;
+    meta.ndim = tensor.ndim();
+    std::copy(tensor.dims().begin(), tensor.dims().end(), meta.dims);
+    meta.offset = bytes;
+    meta.nbytes = tensor.nbytes();
+    bytes = align(bytes + meta.nbytes);
+  }
+  CAFFE_ENFORCE_LE(
+      bytes,
+      align(header->slotBytes),
+      "The record doesn't fit in a slot of ",
+      header->slotBytes,
+      " bytes");
+
+  auto canWrite = [&]() {
+    return header->writer - header->reader < int64_t(header->capacity) &&
+        arena_->slot(header->writer)->state == kFree;
+  };
+  arena_->lock();
+  if (!canWrite() && !header->closed) {
+    if (!blocking) {
+      arena_->unlock();
+      return false;
+    }
+    Timer blockedTimer;
+    while (!canWrite() && !header->closed) {
+      arena_->wait(&header->writable);
+    }
+    CAFFE_EVENT(stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+  }
+  if (header->closed) {
+    arena_->unlock();
+    return false;
+  }
+  const auto pos = header->writer++;
+  arena_->slot(pos)->state = kWriting;
+  CAFFE_EVENT(stats_, queue_occupancy, pos - header->reader);
+  arena_->unlock();
+
+  // Copy outside of the lock, the readers wait for the slot to be full
+  auto* data = arena_->data(pos);
+  for (size_t i = 0; i < numBlobs_; ++i) {
+    const auto& tensor = inputs[i]->Get<TensorCPU>();
+    if (metas[i].nbytes > 0) {
+      memcpy(data + metas[i].offset, tensor.raw_data(), metas[i].nbytes);
+    }
+  }
+  std::copy(metas.begin(), metas.end(), arena_->blobs(pos));
+
+  arena_->lock();
+  arena_->slot(pos)->state = kFull;
+  pthread_cond_broadcast(&header->readable);
+  arena_->unlock();
+  return true;
+}
+
+bool ShmBlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_NONBLOCKING_OP);
+  if (!write(inputs, false)) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  // Increase queue balance to indicate queue write pressure is being
+  // increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+bool ShmBlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_BLOCKING_OP);
+  // Increase queue balance before writing to indicate queue write pressure is
+  // being increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  if (!write(inputs, true)) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+void ShmBlobsQueue::close() {
+  closing_ = true;
+  auto* header = arena_->header();
+  arena_->lock();
+  header->closed = 1;
+  pthread_cond_broadcast(&header->readable);
+  pthread_cond_broadcast(&header->writable);
+  arena_->unlock();
+}
+
+} // namespace caffe2
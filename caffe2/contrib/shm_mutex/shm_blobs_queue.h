@@ -0,0 +1,61 @@
+/*
+ * A BlobsQueue shared between processes, to move tensors from decoding
+ * processes to a trainer without pickling them.
+ *
+ * The queue lives in a POSIX shared memory object made of a header and
+ * capacity slots of slot_bytes each. Every process creates the queue with
+ * the same shared memory name and parameters, the first one creates the
+ * object and the last one to destroy its queue unlinks it. A write copies
+ * the tensors into a free slot, a read shares the slot with the tensors of
+ * the reader through ShareExternalPointer, without copying. The slot is
+ * refcounted in the shared memory and given back to the writers when the
+ * last of these tensors is released.
+ *
+ * Caveats:
+ *   - the tensors have to be CPU tensors of a fixed size type, and fit in
+ *     a slot.
+ *   - the slots are reused in order, a dequeued tensor kept alive blocks
+ *     the writers once they are a lap ahead.
+ *   - the lock is a robust process-shared mutex, it survives a process
+ *     dying while holding it, but the slots of the tensors dequeued by a
+ *     process which died are never given back.
+ *   - close() closes the queue for every process, destroying it doesn't.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/queue/blobs_queue.h"
+
+namespace caffe2 {
+
+class ShmBlobsQueue : public BlobsQueue {
+ public:
+  ShmBlobsQueue(
+      Workspace* ws,
+      const std::string& queueName,
+      const std::string& shmName,
+      size_t capacity,
+      size_t numBlobs,
+      size_t slotBytes,
+      const std::vector<std::string>& fieldNames = {});
+
+  bool blockingRead(
+      const std::vector<Blob*>& inputs,
+      float timeout_secs = 0.0f) override;
+  bool tryWrite(const std::vector<Blob*>& inputs) override;
+  bool blockingWrite(const std::vector<Blob*>& inputs) override;
+  void close() override;
+
+  // The shared memory mapping, kept alive by the dequeued tensors
+  class Arena;
+
+ private:
+  bool write(const std::vector<Blob*>& inputs, bool blocking);
+
+  std::shared_ptr<Arena> arena_;
+};
+
+} // namespace caffe2
@@ -0,0 +1,57 @@
+#include "shm_blobs_queue.h"
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+class CreateShmBlobsQueueOp final : public Operator<CPUContext> {
+ public:
+  CreateShmBlobsQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        name_(operator_def.output().Get(0)),
+        shmName_(GetSingleArgument<std::string>("shm_name", "")) {
+    CAFFE_ENFORCE(!shmName_.empty(), "shm_name is required");
+  }
+
+  bool RunOnDevice() override {
+    const auto capacity = GetSingleArgument("capacity", 1);
+    const auto numBlobs = GetSingleArgument("num_blobs", 1);
+    const auto slotBytes = GetSingleArgument<int64_t>("slot_bytes", 0);
+    const auto fieldNames = GetRepeatedArgument<std::string>("field_names");
+    auto queuePtr = Outputs()[0]->GetMutable<std::shared_ptr<BlobsQueue>>();
+    CAFFE_ENFORCE(queuePtr);
+    *queuePtr = std::make_shared<ShmBlobsQueue>(
+        ws_, name_, shmName_, capacity, numBlobs, slotBytes, fieldNames);
+    return true;
+  }
+
+ private:
+  Workspace* ws_{nullptr};
+  const std::string name_;
+  const std::string shmName_;
+};
+
+REGISTER_CPU_OPERATOR(CreateShmBlobsQueue, CreateShmBlobsQueueOp);
+
+OPERATOR_SCHEMA(CreateShmBlobsQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates a BlobsQueue in POSIX shared memory, which processes creating it
+with the same shm_name and parameters share. Enqueued CPU tensors are copied
+into a slot of the shared memory, dequeued tensors share the slot without
+copying and give it back once they are all released. It is used with
+EnqueueBlobs, DequeueBlobs and CloseBlobsQueue, closing the queue closes it
+in every process.
+)DOC")
+    .Arg("shm_name", "Name of the shared memory object, e.g. /train_queue")
+    .Arg("capacity", "Number of records the queue holds, default: 1")
+    .Arg("num_blobs", "Number of blobs of a record, default: 1")
+    .Arg("slot_bytes", "Bytes of the tensors of a record, at most")
+    .Arg("field_names", "Names of the blobs, for the exported stats")
+    .Output(0, "queue", "The shared pointer to the BlobsQueue");
+
+NO_GRADIENT(CreateShmBlobsQueue);
+
+} // namespace caffe2
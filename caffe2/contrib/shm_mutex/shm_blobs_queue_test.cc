@@ -0,0 +1,92 @@
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "caffe2/contrib/shm_mutex/shm_blobs_queue.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+std::string shmName(const std::string& test) {
+  return "/caffe2_shm_blobs_queue_test_" + test + "_" +
+      caffe2::to_string(getpid());
+}
+
+void writeRecord(BlobsQueue* queue, int value, int size) {
+  Blob blob;
+  auto* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(size);
+  std::fill(
+      tensor->mutable_data<int>(), tensor->mutable_data<int>() + size, value);
+  EXPECT_TRUE(queue->blockingWrite({&blob}));
+}
+
+} // namespace
+
+TEST(ShmBlobsQueueTest, AcrossProcesses) {
+  const auto name = shmName("AcrossProcesses");
+  const int kRecords = 20;
+  Workspace ws;
+  auto queue =
+      std::make_shared<ShmBlobsQueue>(&ws, "queue", name, 4, 1, 1024);
+  auto pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    {
+      Workspace childWs;
+      auto writer =
+          std::make_shared<ShmBlobsQueue>(&childWs, "queue", name, 4, 1, 1024);
+      for (int i = 0; i < kRecords; ++i) {
+        writeRecord(writer.get(), i, i + 1);
+      }
+      writer->close();
+    }
+    _exit(0);
+  }
+
+  Blob blob;
+  for (int i = 0; i < kRecords; ++i) {
+    ASSERT_TRUE(queue->blockingRead({&blob}));
+    const auto& tensor = blob.Get<TensorCPU>();
+    ASSERT_EQ(tensor.size(), i + 1);
+    for (int j = 0; j < tensor.size(); ++j) {
+      EXPECT_EQ(tensor.data<int>()[j], i);
+    }
+  }
+  // The records written before close are all read
+  EXPECT_FALSE(queue->blockingRead({&blob}));
+  int status;
+  waitpid(pid, &status, 0);
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(ShmBlobsQueueTest, SlotHeldByDequeuedTensor) {
+  Workspace ws;
+  auto queue = std::make_shared<ShmBlobsQueue>(
+      &ws, "queue", shmName("SlotHeld"), 1, 1, 1024);
+  writeRecord(queue.get(), 1, 4);
+  Blob blob;
+  ASSERT_TRUE(queue->blockingRead({&blob}));
+  EXPECT_TRUE(blob.Get<TensorCPU>().shares_data());
+
+  Blob record;
+  record.GetMutable<TensorCPU>()->Resize(4);
+  record.GetMutable<TensorCPU>()->mutable_data<float>();
+  EXPECT_FALSE(queue->tryWrite({&record}));
+  // Releasing the dequeued tensor gives the slot back
+  blob.Reset();
+  EXPECT_TRUE(queue->tryWrite({&record}));
+}
+
+TEST(ShmBlobsQueueTest, RecordTooLarge) {
+  Workspace ws;
+  auto queue = std::make_shared<ShmBlobsQueue>(
+      &ws, "queue", shmName("RecordTooLarge"), 2, 1, 64);
+  Blob blob;
+  blob.GetMutable<TensorCPU>()->Resize(1000);
+  blob.GetMutable<TensorCPU>()->mutable_data<float>();
+  EXPECT_THROW(queue->blockingWrite({&blob}), EnforceNotMet);
+}
+
+} // namespace caffe2
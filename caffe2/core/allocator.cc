@@ -1,3 +1,5 @@
+#include <map>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
@@ -18,7 +20,15 @@ namespace caffe2 {
 void NoDelete(void*) {}
 
 static std::unique_ptr<CPUAllocator> g_cpu_allocator(new DefaultCPUAllocator());
+
+namespace {
+thread_local CPUAllocator* t_cpu_allocator = nullptr;
+} // namespace
+
 CPUAllocator* GetCPUAllocator() {
+  if (t_cpu_allocator) {
+    return t_cpu_allocator;
+  }
   return g_cpu_allocator.get();
 }
 
@@ -26,24 +36,266 @@ void SetCPUAllocator(CPUAllocator* alloc) {
   g_cpu_allocator.reset(alloc);
 }
 
+CPUAllocatorGuard::CPUAllocatorGuard(CPUAllocator* alloc)
+    : prev_(t_cpu_allocator), active_(alloc != nullptr) {
+  if (active_) {
+    t_cpu_allocator = alloc;
+  }
+}
+
+CPUAllocatorGuard::~CPUAllocatorGuard() {
+  if (active_) {
+    t_cpu_allocator = prev_;
+  }
+}
+
+// Every allocation is preceded by a gCaffe2Alignment sized header that lets
+// the (stateless) deleter find the arena state and the size of the block.
+struct ArenaCPUAllocator::Header {
+  State* state;
+  size_t total;
+};
+
+struct ArenaCPUAllocator::State {
+  std::mutex mutex;
+  // Start and size of every chunk
+  std::map<char*, size_t> chunks;
+  // Free ranges of the chunks, by start and by size
+  std::map<char*, size_t> free_ranges;
+  std::multimap<size_t, char*> free_sizes;
+  size_t chunk_size;
+  size_t max_bytes;
+  size_t reserved = 0;
+  size_t allocated = 0;
+  // Largest number of bytes allocated at once since the last reset
+  size_t run_peak = 0;
+  int64_t live = 0;
+  bool orphaned = false; // the allocator object was destroyed
+
+  void addFree(char* start, size_t nbytes) {
+    free_ranges.emplace(start, nbytes);
+    free_sizes.emplace(nbytes, start);
+  }
+
+  void removeFree(std::map<char*, size_t>::iterator it) {
+    auto range = free_sizes.equal_range(it->second);
+    for (auto size_it = range.first; size_it != range.second; ++size_it) {
+      if (size_it->second == it->first) {
+        free_sizes.erase(size_it);
+        break;
+      }
+    }
+    free_ranges.erase(it);
+  }
+
+  bool addChunk(size_t nbytes) {
+    if (max_bytes && reserved + nbytes > max_bytes) {
+      return false;
+    }
+    auto* chunk =
+        static_cast<char*>(DefaultCPUAllocator().New(nbytes).first);
+    chunks.emplace(chunk, nbytes);
+    addFree(chunk, nbytes);
+    reserved += nbytes;
+    return true;
+  }
+
+  // Best fit among the free ranges, nullptr if none is large enough
+  char* take(size_t total) {
+    auto size_it = free_sizes.lower_bound(total);
+    if (size_it == free_sizes.end()) {
+      return nullptr;
+    }
+    const size_t nbytes = size_it->first;
+    char* block = size_it->second;
+    free_sizes.erase(size_it);
+    free_ranges.erase(block);
+    if (nbytes > total) {
+      addFree(block + total, nbytes - total);
+    }
+    return block;
+  }
+
+  // Gives a block back, merged with the free ranges around it within the
+  // same chunk
+  void give(char* block, size_t total) {
+    auto next = free_ranges.find(block + total);
+    if (next != free_ranges.end() && !chunks.count(next->first)) {
+      total += next->second;
+      removeFree(next);
+    }
+    if (!chunks.count(block)) {
+      auto prev = free_ranges.lower_bound(block);
+      if (prev != free_ranges.begin()) {
+        --prev;
+        if (prev->first + prev->second == block) {
+          block = prev->first;
+          total += prev->second;
+          removeFree(prev);
+        }
+      }
+    }
+    addFree(block, total);
+  }
+
+  // Frees the chunks that have no live allocation, as long as the rest
+  // holds at least keep_bytes
+  void freeUnusedChunks(size_t keep_bytes) {
+    for (auto it = chunks.begin(); it != chunks.end();) {
+      auto free_it = free_ranges.find(it->first);
+      if (free_it == free_ranges.end() || free_it->second != it->second ||
+          reserved - it->second < keep_bytes) {
+        ++it;
+        continue;
+      }
+      removeFree(free_it);
+      DefaultCPUAllocator::Delete(it->first);
+      reserved -= it->second;
+      it = chunks.erase(it);
+    }
+  }
+
+  void freeChunks() {
+    for (const auto& chunk : chunks) {
+      DefaultCPUAllocator::Delete(chunk.first);
+    }
+    chunks.clear();
+    free_ranges.clear();
+    free_sizes.clear();
+    reserved = 0;
+  }
+};
+
+constexpr size_t ArenaCPUAllocator::kDefaultChunkSize;
+
+ArenaCPUAllocator::ArenaCPUAllocator(size_t chunk_size, size_t max_bytes)
+    : state_(new State()) {
+  CAFFE_ENFORCE_GT(chunk_size, 0);
+  state_->chunk_size = chunk_size;
+  state_->max_bytes = max_bytes;
+}
+
+ArenaCPUAllocator::~ArenaCPUAllocator() {
+  bool free_state = false;
+  {
+    std::lock_guard<std::mutex> guard(state_->mutex);
+    state_->orphaned = true;
+    free_state = state_->live == 0;
+  }
+  if (free_state) {
+    state_->freeChunks();
+    delete state_;
+  }
+}
+
+std::pair<void*, MemoryDeleter> ArenaCPUAllocator::New(size_t nbytes) {
+  static_assert(
+      sizeof(Header) <= gCaffe2Alignment,
+      "Arena allocation header does not fit into the alignment");
+  // Keep every allocation (and thus the next header) aligned
+  const size_t total = gCaffe2Alignment +
+      (nbytes + gCaffe2Alignment - 1) / gCaffe2Alignment * gCaffe2Alignment;
+  char* block = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(state_->mutex);
+    block = state_->take(total);
+    if (!block) {
+      if (!state_->addChunk(std::max(total, state_->chunk_size))) {
+        // Over the limit, fall back to regular allocations
+        return DefaultCPUAllocator().New(nbytes);
+      }
+      block = state_->take(total);
+    }
+    state_->allocated += total;
+    state_->run_peak = std::max(state_->run_peak, state_->allocated);
+    ++state_->live;
+  }
+  auto* header = reinterpret_cast<Header*>(block);
+  header->state = state_;
+  header->total = total;
+  void* data = block + gCaffe2Alignment;
+  if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+    memset(data, 0, nbytes);
+  }
+  CAFFE_SDT(cpu_alloc, data, nbytes);
+  return {data, Delete};
+}
+
+void ArenaCPUAllocator::Delete(void* data) {
+  CAFFE_SDT(cpu_free, data);
+  auto* block = static_cast<char*>(data) - gCaffe2Alignment;
+  const auto* header = reinterpret_cast<const Header*>(block);
+  auto* state = header->state;
+  bool free_state = false;
+  {
+    std::lock_guard<std::mutex> guard(state->mutex);
+    CAFFE_ENFORCE_GT(state->live, 0);
+    --state->live;
+    state->allocated -= header->total;
+    state->give(block, header->total);
+    free_state = state->live == 0 && state->orphaned;
+  }
+  if (free_state) {
+    state->freeChunks();
+    delete state;
+  }
+}
+
+bool ArenaCPUAllocator::Reset() {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  const size_t run_peak = state_->run_peak;
+  state_->run_peak = state_->allocated;
+  if (state_->live > 0) {
+    // Only give back the chunks that the last run did not need
+    state_->freeUnusedChunks(run_peak);
+    return false;
+  }
+  if (state_->chunks.size() > 1) {
+    // Merge the chunks so that the next runs fit into a single one
+    state_->freeChunks();
+    state_->addChunk(std::max(run_peak, state_->chunk_size));
+  }
+  return true;
+}
+
+size_t ArenaCPUAllocator::reserved_bytes() const {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  return state_->reserved;
+}
+
+size_t ArenaCPUAllocator::allocated_bytes() const {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  return state_->allocated;
+}
+
+int64_t ArenaCPUAllocator::live_allocations() const {
+  std::lock_guard<std::mutex> guard(state_->mutex);
+  return state_->live;
+}
+
 MemoryAllocationReporter CPUContext::reporter_;
 
-void MemoryAllocationReporter::New(void* ptr, size_t nbytes) {
+void MemoryAllocationReporter::New(
+    void* ptr,
+    size_t nbytes,
+    MemoryDeleter deleter) {
   std::lock_guard<std::mutex> guard(mutex_);
-  size_table_[ptr] = nbytes;
+  size_table_[ptr] = std::make_pair(nbytes, deleter);
   allocated_ += nbytes;
   LOG(INFO) << "Caffe2 alloc " << nbytes << " bytes, total alloc " << allocated_
             << " bytes.";
 }
 
-void MemoryAllocationReporter::Delete(void* ptr) {
+MemoryDeleter MemoryAllocationReporter::Delete(void* ptr) {
   std::lock_guard<std::mutex> guard(mutex_);
   auto it = size_table_.find(ptr);
   CHECK(it != size_table_.end());
-  allocated_ -= it->second;
-  LOG(INFO) << "Caffe2 deleted " << it->second << " bytes, total alloc "
+  allocated_ -= it->second.first;
+  LOG(INFO) << "Caffe2 deleted " << it->second.first << " bytes, total alloc "
             << allocated_ << " bytes.";
+  auto deleter = it->second.second;
   size_table_.erase(it);
+  return deleter;
 }
 
 } // namespace caffe2
@@ -1,10 +1,15 @@
 #ifndef CAFFE2_CORE_ALLOCATOR_H_
 #define CAFFE2_CORE_ALLOCATOR_H_
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "caffe2/core/logging.h"
 #include "caffe2/core/numa.h"
+#include "caffe2/core/static_tracepoint.h"
 
 CAFFE2_DECLARE_bool(caffe2_report_cpu_memory_usage);
 CAFFE2_DECLARE_bool(caffe2_cpu_allocator_do_zero_fill);
@@ -25,6 +30,9 @@ struct CPUAllocator {
   virtual ~CPUAllocator() noexcept {}
   virtual std::pair<void*, MemoryDeleter> New(size_t nbytes) = 0;
   virtual MemoryDeleter GetDeleter() = 0;
+  // Called at the end of every net run of a workspace that uses this
+  // allocator (see Workspace::SetCPUAllocator)
+  virtual void OnRunFinished() {}
 };
 
 // A virtual struct that is used to report Caffe2's memory allocation and
@@ -32,12 +40,13 @@ struct CPUAllocator {
 class MemoryAllocationReporter {
  public:
   MemoryAllocationReporter() : allocated_(0) {}
-  void New(void* ptr, size_t nbytes);
-  void Delete(void* ptr);
+  void New(void* ptr, size_t nbytes, MemoryDeleter deleter);
+  // Returns the deleter the memory was allocated with
+  MemoryDeleter Delete(void* ptr);
 
  private:
   std::mutex mutex_;
-  std::unordered_map<void*, size_t> size_table_;
+  std::unordered_map<void*, std::pair<size_t, MemoryDeleter>> size_table_;
   size_t allocated_;
 };
 
@@ -59,15 +68,18 @@ struct DefaultCPUAllocator final : CPUAllocator {
     if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
       memset(data, 0, nbytes);
     }
+    CAFFE_SDT(cpu_alloc, data, nbytes);
     return {data, Delete};
   }
 
 #ifdef _MSC_VER
   static void Delete(void* data) {
+    CAFFE_SDT(cpu_free, data);
     _aligned_free(data);
   }
 #else
   static void Delete(void* data) {
+    CAFFE_SDT(cpu_free, data);
     free(data);
   }
 #endif
@@ -77,12 +89,76 @@ struct DefaultCPUAllocator final : CPUAllocator {
   }
 };
 
+/**
+ * An arena allocator, meant for nets with mostly fixed shapes.
+ *
+ * Memory is carved out of large chunks with gCaffe2Alignment alignment.
+ * Freed blocks go back to a free list, merged with their free neighbours,
+ * and allocations take the smallest free range that fits, so that the blocks
+ * of one run are reused by the next. The arena is reset at the end of every
+ * net run: the chunks that the run did not need are released, and once no
+ * allocation is live all chunks are merged into a single one sized to the
+ * peak of the run, so steady-state runs do not allocate chunks at all. Once
+ * `max_bytes` (0 - no limit) are reserved, allocations fall back to
+ * DefaultCPUAllocator. Allocations may outlive the allocator object itself.
+ */
+class ArenaCPUAllocator final : public CPUAllocator {
+ public:
+  explicit ArenaCPUAllocator(
+      size_t chunk_size = kDefaultChunkSize,
+      size_t max_bytes = 0);
+  ~ArenaCPUAllocator() override;
+
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
+  MemoryDeleter GetDeleter() override {
+    return Delete;
+  }
+  void OnRunFinished() override {
+    Reset();
+  }
+
+  // Releases the chunks the last run did not need, and merges all chunks
+  // into one if no allocation is alive; returns false if some are
+  bool Reset();
+
+  // Number of bytes reserved in chunks, and handed out since the last reset
+  size_t reserved_bytes() const;
+  size_t allocated_bytes() const;
+  int64_t live_allocations() const;
+
+  static constexpr size_t kDefaultChunkSize = 16 << 20;
+
+ private:
+  struct Header;
+  struct State;
+  static void Delete(void* data);
+
+  State* state_;
+
+  DISABLE_COPY_AND_ASSIGN(ArenaCPUAllocator);
+};
+
 // Get the CPU Alloctor.
 CPUAllocator* GetCPUAllocator();
 // Sets the CPU allocator to the given allocator: the caller gives away the
 // ownership of the pointer.
 void SetCPUAllocator(CPUAllocator* alloc);
 
+// Makes GetCPUAllocator() return the given allocator on the calling thread
+// while the guard is alive; nullptr keeps the current allocator. The caller
+// keeps the ownership of the allocator.
+class CPUAllocatorGuard {
+ public:
+  explicit CPUAllocatorGuard(CPUAllocator* alloc);
+  ~CPUAllocatorGuard();
+
+ private:
+  CPUAllocator* prev_;
+  bool active_;
+
+  DISABLE_COPY_AND_ASSIGN(CPUAllocatorGuard);
+};
+
 } // namespace caffe2
 
 #endif // CAFFE2_CORE_ALLOCATOR_H_
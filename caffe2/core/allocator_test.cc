@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+
+namespace caffe2 {
+
+TEST(ArenaCPUAllocatorTest, AlignedBumpAllocation) {
+  ArenaCPUAllocator arena(1024);
+  auto a = arena.New(10);
+  auto b = arena.New(100);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a.first) % gCaffe2Alignment, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b.first) % gCaffe2Alignment, 0);
+  EXPECT_LT(a.first, b.first);
+  EXPECT_EQ(arena.live_allocations(), 2);
+  EXPECT_FALSE(arena.Reset());
+
+  a.second(a.first);
+  b.second(b.first);
+  EXPECT_EQ(arena.live_allocations(), 0);
+  EXPECT_TRUE(arena.Reset());
+  EXPECT_EQ(arena.allocated_bytes(), 0);
+}
+
+TEST(ArenaCPUAllocatorTest, LIFOFreeReusesMemory) {
+  ArenaCPUAllocator arena(1024);
+  auto a = arena.New(64);
+  auto b = arena.New(64);
+  b.second(b.first);
+  auto c = arena.New(64);
+  EXPECT_EQ(b.first, c.first);
+  c.second(c.first);
+  a.second(a.first);
+}
+
+TEST(ArenaCPUAllocatorTest, OutOfOrderFreeIsReclaimed) {
+  ArenaCPUAllocator arena(1024);
+  auto a = arena.New(64);
+  auto b = arena.New(64);
+  auto c = arena.New(64);
+  a.second(a.first);
+  b.second(b.first);
+  // The blocks of a and b are merged and fit a larger allocation
+  const size_t reserved = arena.reserved_bytes();
+  auto d = arena.New(128);
+  EXPECT_EQ(d.first, a.first);
+  EXPECT_EQ(arena.reserved_bytes(), reserved);
+  c.second(c.first);
+  d.second(d.first);
+}
+
+TEST(ArenaCPUAllocatorTest, ResetMergesChunks) {
+  ArenaCPUAllocator arena(256);
+  std::vector<std::pair<void*, MemoryDeleter>> allocations;
+  for (int i = 0; i < 8; ++i) {
+    allocations.push_back(arena.New(200));
+  }
+  EXPECT_GE(arena.reserved_bytes(), 8 * 200);
+  for (auto& allocation : allocations) {
+    allocation.second(allocation.first);
+  }
+  EXPECT_TRUE(arena.Reset());
+  // Single chunk that fits the high-water mark
+  allocations.clear();
+  for (int i = 0; i < 8; ++i) {
+    allocations.push_back(arena.New(200));
+  }
+  for (int i = 1; i < 8; ++i) {
+    EXPECT_GT(allocations[i].first, allocations[i - 1].first);
+  }
+  for (auto& allocation : allocations) {
+    allocation.second(allocation.first);
+  }
+}
+
+TEST(ArenaCPUAllocatorTest, MaxBytesFallsBack) {
+  ArenaCPUAllocator arena(256, 256);
+  auto a = arena.New(100);
+  auto b = arena.New(1000);
+  EXPECT_EQ(arena.live_allocations(), 1);
+  EXPECT_NE(b.second, a.second);
+  b.second(b.first);
+  a.second(a.first);
+}
+
+TEST(ArenaCPUAllocatorTest, TensorOutlivesAllocator) {
+  TensorCPU tensor(vector<TIndex>{16});
+  {
+    ArenaCPUAllocator arena;
+    CPUAllocatorGuard guard(&arena);
+    EXPECT_EQ(GetCPUAllocator(), &arena);
+    tensor.mutable_data<float>()[15] = 1;
+  }
+  EXPECT_NE(GetCPUAllocator(), nullptr);
+  EXPECT_EQ(tensor.data<float>()[15], 1);
+}
+
+TEST(ArenaCPUAllocatorTest, WorkspaceAllocator) {
+  auto arena = std::make_shared<ArenaCPUAllocator>();
+  Workspace parent;
+  parent.SetCPUAllocator(arena);
+  Workspace ws(&parent);
+  EXPECT_EQ(ws.GetCPUAllocator(), arena.get());
+
+  NetDef net_def;
+  net_def.set_name("fill");
+  auto* op = net_def.add_op();
+  op->set_type("ConstantFill");
+  op->add_output("out");
+  auto* arg = op->add_arg();
+  arg->set_name("shape");
+  arg->add_ints(10);
+  ASSERT_TRUE(ws.CreateNet(net_def));
+  ASSERT_TRUE(ws.RunNet("fill"));
+  EXPECT_EQ(arena->live_allocations(), 1);
+  ASSERT_TRUE(ws.RunNet("fill"));
+  // Output keeps its buffer between runs
+  EXPECT_EQ(arena->live_allocations(), 1);
+}
+
+TEST(ArenaCPUAllocatorTest, NetRunsReuseMemory) {
+  auto arena = std::make_shared<ArenaCPUAllocator>(4096);
+  Workspace ws;
+  ws.SetCPUAllocator(arena);
+
+  NetDef net_def;
+  net_def.set_name("fill");
+  net_def.add_external_input("shape");
+  auto* fill = net_def.add_op();
+  fill->set_type("ConstantFill");
+  fill->add_input("shape");
+  fill->add_output("a");
+  fill->add_arg()->CopyFrom(MakeArgument("input_as_shape", 1));
+  for (const string& out : {"b", "c"}) {
+    auto* relu = net_def.add_op();
+    relu->set_type("Relu");
+    relu->add_input(net_def.op(net_def.op_size() - 2).output(0));
+    relu->add_output(out);
+  }
+  auto* shape = ws.CreateBlob("shape")->GetMutable<TensorCPU>();
+  shape->Resize(1);
+  // Run directly, as Predictor does, rather than through Workspace::RunNet
+  auto net = CreateNet(net_def, &ws);
+  ASSERT_TRUE(net);
+
+  // Outputs stay alive between runs, while their shapes change
+  const std::vector<int64_t> sizes{100, 5000, 300, 20000, 50, 7000};
+  std::vector<size_t> reserved;
+  for (int cycle = 0; cycle < 3; ++cycle) {
+    for (auto size : sizes) {
+      shape->mutable_data<int64_t>()[0] = size;
+      ASSERT_TRUE(net->Run());
+      EXPECT_EQ(arena->live_allocations(), 3);
+    }
+    reserved.push_back(arena->reserved_bytes());
+  }
+  // Memory freed by earlier runs is reused rather than the arena growing
+  EXPECT_EQ(reserved[1], reserved[0]);
+  EXPECT_EQ(reserved[2], reserved[0]);
+  EXPECT_LE(reserved[0], 2 * 3 * 20000 * sizeof(float) + 3 * 4096);
+}
+
+} // namespace caffe2
@@ -0,0 +1,250 @@
+#include "caffe2/core/batching_predictor.h"
+
+#include "caffe2/core/concurrent_predictor.h"
+#include "caffe2/core/context.h"
+
+namespace caffe2 {
+
+namespace {
+
+TIndex batchSize(const BatchingPredictor::TensorMap& inputs) {
+  CAFFE_ENFORCE(!inputs.empty(), "BatchingPredictor request has no inputs");
+  TIndex batch_size = -1;
+  for (const auto& input : inputs) {
+    CAFFE_ENFORCE(input.second, "Null input tensor: ", input.first);
+    CAFFE_ENFORCE_GT(
+        input.second->ndim(), 0, "Batched input is a scalar: ", input.first);
+    if (batch_size < 0) {
+      batch_size = input.second->dim(0);
+    }
+    CAFFE_ENFORCE_EQ(
+        batch_size,
+        input.second->dim(0),
+        "Inputs of a request have different batch sizes");
+  }
+  return batch_size;
+}
+
+void concat(
+    const std::vector<const TensorCPU*>& parts,
+    TensorCPU* output,
+    CPUContext* context) {
+  const auto& first = *parts.front();
+  auto dims = first.dims();
+  dims[0] = 0;
+  for (const auto* part : parts) {
+    CAFFE_ENFORCE(part->meta() == first.meta(), "Inputs of different types");
+    CAFFE_ENFORCE_EQ(part->ndim(), first.ndim());
+    for (int i = 1; i < first.ndim(); ++i) {
+      CAFFE_ENFORCE_EQ(
+          part->dim(i), first.dim(i), "Inputs of different shapes");
+    }
+    dims[0] += part->dim(0);
+  }
+  output->Resize(dims);
+  auto* dst = static_cast<char*>(output->raw_mutable_data(first.meta()));
+  for (const auto* part : parts) {
+    context->CopyItems<CPUContext, CPUContext>(
+        part->meta(), part->size(), part->raw_data(), dst);
+    dst += part->nbytes();
+  }
+}
+
+} // namespace
+
+BatchingPredictor::BatchingPredictor(
+    Predictor* predictor,
+    const Options& options)
+    : stats_(options.name),
+      predictor_(predictor),
+      concurrent_predictor_(nullptr),
+      options_(options),
+      running_(true) {
+  CAFFE_ENFORCE(predictor_);
+  CAFFE_ENFORCE_EQ(
+      options_.num_threads, 1, "A Predictor runs one batch at a time");
+  start();
+}
+
+BatchingPredictor::BatchingPredictor(
+    ConcurrentPredictor* predictor,
+    const Options& options)
+    : stats_(options.name),
+      predictor_(nullptr),
+      concurrent_predictor_(predictor),
+      options_(options),
+      running_(true) {
+  CAFFE_ENFORCE(concurrent_predictor_);
+  start();
+}
+
+BatchingPredictor::~BatchingPredictor() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    running_ = false;
+    cv_.notify_all();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void BatchingPredictor::start() {
+  CAFFE_ENFORCE_GT(options_.max_batch_size, 0);
+  CAFFE_ENFORCE_GT(options_.num_threads, 0);
+  for (int i = 0; i < options_.num_threads; ++i) {
+    threads_.emplace_back(&BatchingPredictor::batchingLoop, this);
+  }
+}
+
+std::future<BatchingPredictor::OutputTensorVector> BatchingPredictor::run_map(
+    const TensorMap& inputs) {
+  Request request;
+  request.inputs = inputs;
+  request.batch_size = batchSize(inputs);
+  request.enqueue_time = std::chrono::steady_clock::now();
+  auto future = request.promise.get_future();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    CAFFE_ENFORCE(running_, "BatchingPredictor is stopped");
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+  CAFFE_EVENT(stats_, num_requests);
+  return future;
+}
+
+void BatchingPredictor::batchingLoop() {
+  std::vector<Request> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (queue_.empty() && running_) {
+        cv_.wait(lock);
+      }
+      if (queue_.empty()) {
+        // Not running and all requests are served
+        return;
+      }
+
+      // Wait for the batch to fill up, at most until the deadline of the
+      // oldest request
+      const auto deadline = queue_.front().enqueue_time + options_.max_latency;
+      TIndex batch_size = 0;
+      while (true) {
+        while (!queue_.empty()) {
+          auto& request = queue_.front();
+          if (!batch.empty() &&
+              batch_size + request.batch_size > options_.max_batch_size) {
+            break;
+          }
+          batch_size += request.batch_size;
+          batch.push_back(std::move(request));
+          queue_.pop_front();
+        }
+        if (!queue_.empty() || batch_size >= options_.max_batch_size ||
+            !running_ ||
+            cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+          break;
+        }
+      }
+    }
+
+    runBatch(batch);
+    batch.clear();
+  }
+}
+
+void BatchingPredictor::runBatch(std::vector<Request>& batch) {
+  const auto start = std::chrono::steady_clock::now();
+  TIndex batch_size = 0;
+  for (const auto& request : batch) {
+    batch_size += request.batch_size;
+    CAFFE_EVENT(
+        stats_,
+        queue_latency_us,
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            start - request.enqueue_time)
+            .count());
+  }
+
+  try {
+    CPUContext context;
+    TensorMap batch_inputs;
+    std::vector<std::unique_ptr<TensorCPU>> batch_tensors;
+
+    if (batch.size() == 1) {
+      batch_inputs = batch.front().inputs;
+    } else {
+      for (const auto& input : batch.front().inputs) {
+        std::vector<const TensorCPU*> parts;
+        parts.reserve(batch.size());
+        for (const auto& request : batch) {
+          auto it = request.inputs.find(input.first);
+          CAFFE_ENFORCE(
+              it != request.inputs.end() &&
+                  request.inputs.size() == batch.front().inputs.size(),
+              "Batched requests feed different inputs");
+          parts.push_back(it->second);
+        }
+        batch_tensors.emplace_back(new TensorCPU());
+        concat(parts, batch_tensors.back().get(), &context);
+        batch_inputs[input.first] = batch_tensors.back().get();
+      }
+    }
+
+    Predictor::TensorVector outputs;
+    OutputTensorVector owned_outputs;
+    if (concurrent_predictor_) {
+      CAFFE_ENFORCE(
+          concurrent_predictor_->run_map(batch_inputs, &owned_outputs),
+          "Run failed");
+      for (const auto& output : owned_outputs) {
+        outputs.push_back(output.get());
+      }
+    } else {
+      CAFFE_ENFORCE(predictor_->run_map(batch_inputs, &outputs), "Run failed");
+    }
+
+    // Scatter the slices of the outputs back to the requests
+    std::vector<OutputTensorVector> results(batch.size());
+    for (const auto* output : outputs) {
+      CAFFE_ENFORCE_GT(output->ndim(), 0, "Batched output is a scalar");
+      CAFFE_ENFORCE_EQ(
+          output->dim(0), batch_size, "Output batch size does not match");
+      const auto row_size = output->size_from_dim(1);
+      const auto* src = static_cast<const char*>(output->raw_data());
+      for (int i = 0; i < batch.size(); ++i) {
+        auto dims = output->dims();
+        dims[0] = batch[i].batch_size;
+        auto* result = new TensorCPU(dims);
+        results[i].emplace_back(result);
+        auto* dst = result->raw_mutable_data(output->meta());
+        context.CopyItems<CPUContext, CPUContext>(
+            output->meta(), result->size(), src, dst);
+        src += row_size * batch[i].batch_size * output->itemsize();
+      }
+    }
+    for (int i = 0; i < batch.size(); ++i) {
+      batch[i].promise.set_value(std::move(results[i]));
+    }
+  } catch (...) {
+    CAFFE_EVENT(stats_, num_failed_batches);
+    auto error = std::current_exception();
+    for (auto& request : batch) {
+      request.promise.set_exception(error);
+    }
+  }
+
+  CAFFE_EVENT(stats_, num_batches);
+  CAFFE_EVENT(stats_, batch_size, batch_size);
+  CAFFE_EVENT(stats_, requests_per_batch, batch.size());
+  CAFFE_EVENT(
+      stats_,
+      run_time_us,
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+} // namespace caffe2
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/predictor.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+class ConcurrentPredictor;
+
+// Dynamic batching front-end for a Predictor or a ConcurrentPredictor.
+//
+// Requests are queued and a batching thread concatenates the inputs of
+// consecutive requests along the first dimension, until either the batch
+// holds `max_batch_size` rows or `max_latency` passed since the first
+// request of the batch was queued. The batch is run through run_map once,
+// and each caller's future receives its slice of the first dimension of
+// every output. In front of a ConcurrentPredictor, `num_threads` batching
+// threads can run batches at the same time.
+//
+// All requests should feed the same set of inputs; the first dimension of
+// every input (and output) is the batch dimension.
+class BatchingPredictor {
+ public:
+  using TensorMap = Predictor::TensorMap;
+  using OutputTensorVector = std::vector<std::unique_ptr<TensorCPU>>;
+
+  struct Options {
+    // Maximum number of rows in a batch; a single bigger request is run alone
+    TIndex max_batch_size = 32;
+    // Maximum time a request waits for other requests to join its batch
+    std::chrono::microseconds max_latency{1000};
+    // Number of batching threads, more than one needs a ConcurrentPredictor
+    int num_threads = 1;
+    // Prefix of the exported stats
+    std::string name = "batching_predictor";
+  };
+
+  // The predictor is not owned and must outlive the BatchingPredictor;
+  // it is only run from the batching thread.
+  BatchingPredictor(Predictor* predictor, const Options& options);
+  // The predictor is not owned and must outlive the BatchingPredictor.
+  BatchingPredictor(ConcurrentPredictor* predictor, const Options& options);
+  ~BatchingPredictor();
+
+  // Queues the request. Input tensors must stay valid until the returned
+  // future is ready. Failures are reported through the future.
+  std::future<OutputTensorVector> run_map(const TensorMap& inputs);
+
+  const Options& options() const {
+    return options_;
+  }
+
+ private:
+  struct Request {
+    TensorMap inputs;
+    TIndex batch_size;
+    std::chrono::steady_clock::time_point enqueue_time;
+    std::promise<OutputTensorVector> promise;
+  };
+
+  void start();
+  void batchingLoop();
+  void runBatch(std::vector<Request>& batch);
+
+  struct BatchingPredictorStats {
+    CAFFE_STAT_CTOR(BatchingPredictorStats);
+    CAFFE_EXPORTED_STAT(num_requests);
+    CAFFE_EXPORTED_STAT(num_batches);
+    CAFFE_EXPORTED_STAT(num_failed_batches);
+    CAFFE_AVG_EXPORTED_STAT(batch_size);
+    CAFFE_AVG_EXPORTED_STAT(requests_per_batch);
+    CAFFE_AVG_EXPORTED_STAT(queue_latency_us);
+    CAFFE_AVG_EXPORTED_STAT(run_time_us);
+  } stats_;
+
+  Predictor* predictor_;
+  ConcurrentPredictor* concurrent_predictor_;
+  const Options options_;
+
+  std::deque<Request> queue_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool running_;
+  std::vector<std::thread> threads_;
+
+  DISABLE_COPY_AND_ASSIGN(BatchingPredictor);
+};
+
+} // namespace caffe2
@@ -200,6 +200,26 @@ class Blob {
       BlobSerializerBase::SerializationAcceptor acceptor,
       int chunk_size = kDefaultChunkSize) const;
 
+  /**
+   * Same as above, compressing the data with the named codec (see
+   * CompressionCodecRegistry) when the blob's serializer supports it.
+   */
+  void Serialize(
+      const string& name,
+      BlobSerializerBase::SerializationAcceptor acceptor,
+      int chunk_size,
+      const string& compression) const;
+
+  /**
+   * Same as above, serializing the chunks straight into buffers provided by
+   * the acceptor (see BlobSerializerBase::StreamingAcceptor).
+   */
+  void SerializeStreaming(
+      const string& name,
+      BlobSerializerBase::StreamingAcceptor acceptor,
+      int chunk_size = kDefaultChunkSize,
+      const string& compression = "") const;
+
   /**
    * @brief Convenience function to serialize a blob to a string.
    *
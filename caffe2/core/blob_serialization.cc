@@ -16,6 +16,12 @@ CAFFE2_DEFINE_int(
     16,
     "Maximal number of threads that can be used for tensor serialization");
 
+CAFFE2_DEFINE_int(
+    caffe2_max_tensor_deserializer_threads,
+    16,
+    "Maximal number of threads that can be used by Load to deserialize "
+    "tensors split into several chunks");
+
 CAFFE2_DEFINE_bool(
     caffe2_serialize_fp16_as_bytes,
     false,
@@ -71,6 +77,28 @@ void Blob::Serialize(
   serializer->SerializeWithChunkSize(*this, name, acceptor, chunk_size);
 }
 
+void Blob::Serialize(
+    const string& name,
+    BlobSerializerBase::SerializationAcceptor acceptor,
+    int chunk_size,
+    const string& compression) const {
+  std::unique_ptr<BlobSerializerBase> serializer(CreateSerializer(meta_.id()));
+  CAFFE_ENFORCE(serializer, "No known serializer for ", meta_.name());
+  serializer->SerializeWithCompression(
+      *this, name, acceptor, chunk_size, compression);
+}
+
+void Blob::SerializeStreaming(
+    const string& name,
+    BlobSerializerBase::StreamingAcceptor acceptor,
+    int chunk_size,
+    const string& compression) const {
+  std::unique_ptr<BlobSerializerBase> serializer(CreateSerializer(meta_.id()));
+  CAFFE_ENFORCE(serializer, "No known serializer for ", meta_.name());
+  serializer->SerializeStreaming(
+      *this, name, acceptor, chunk_size, compression);
+}
+
 // The blob serialization member function implementation.
 std::string Blob::Serialize(const string& name) const {
   std::string data;
@@ -8,6 +8,7 @@
 
 #include "caffe2/core/blob.h"
 #include "caffe2/core/blob_serializer_base.h"
+#include "caffe2/core/compression_codec.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/typeid.h"
 #include "caffe2/core/types.h"
@@ -15,6 +16,7 @@
 
 CAFFE2_DECLARE_int(caffe2_tensor_chunk_size);
 CAFFE2_DECLARE_int(caffe2_max_tensor_serializer_threads);
+CAFFE2_DECLARE_int(caffe2_max_tensor_deserializer_threads);
 CAFFE2_DECLARE_bool(caffe2_serialize_fp16_as_bytes);
 
 namespace caffe2 {
@@ -60,11 +62,33 @@ class TensorSerializer : public BlobSerializerBase {
       const string& name,
       SerializationAcceptor acceptor,
       int chunk_size) override;
+  void SerializeWithCompression(
+      const Blob& blob,
+      const string& name,
+      SerializationAcceptor acceptor,
+      int chunk_size,
+      const string& compression) override;
+
+  void SerializeStreaming(
+      const Blob& blob,
+      const string& name,
+      StreamingAcceptor acceptor,
+      int chunk_size,
+      const string& compression) override;
 
   void Serialize(const Tensor<Context>& tensor, const string& name,
                  TensorProto* proto, size_t chunkBegin, int32_t chunkSize);
 
  private:
+  // Builds the BlobProto of every chunk and passes it to emit together with
+  // its db key, from several threads for big tensors.
+  void SerializeChunks(
+      const Blob& blob,
+      const string& name,
+      int chunk_size,
+      const string& compression,
+      const std::function<void(const string&, const BlobProto&)>& emit);
+
   // A utility function to store the device context detauls.
   void StoreDeviceDetail(const Tensor<Context>& input, TensorProto* proto);
   Context context_;
@@ -97,6 +121,10 @@ inline unique_ptr<BlobDeserializerBase> CreateDeserializer(const string& type) {
  * device_detail field. If you want to specify the device of the deserialized
  * tensor, change the TensorProto's corresponding fields before calling
  * Deserialize.
+ *
+ * Chunks of a CPU tensor (protos with a segment) may be deserialized
+ * concurrently once the first chunk has been deserialized: the tensor already
+ * has its shape and type then, and every chunk only writes its own slice.
  */
 template <class Context>
 class TensorDeserializer : public BlobDeserializerBase {
@@ -196,6 +224,78 @@ void TensorSerializer<Context>::SerializeWithChunkSize(
     const string& name,
     BlobSerializerBase::SerializationAcceptor acceptor,
     int chunk_size) {
+  this->SerializeWithCompression(blob, name, acceptor, chunk_size, "");
+}
+
+namespace detail {
+// Moves the data of the proto into its compressed_data field
+inline void CompressTensorProto(
+    const string& compression,
+    TensorProto* proto) {
+  TensorProto compressed;
+  compressed.mutable_dims()->CopyFrom(proto->dims());
+  compressed.set_data_type(proto->data_type());
+  if (proto->has_name()) {
+    compressed.set_name(proto->name());
+  }
+  if (proto->has_device_detail()) {
+    compressed.mutable_device_detail()->CopyFrom(proto->device_detail());
+  }
+  if (proto->has_segment()) {
+    compressed.mutable_segment()->CopyFrom(proto->segment());
+  }
+  compressed.set_compression(compression);
+  compressed.set_compressed_data(
+      CreateCompressionCodec(compression)->Compress(proto->SerializeAsString()));
+  proto->Swap(&compressed);
+}
+} // namespace detail
+
+template <class Context>
+void TensorSerializer<Context>::SerializeWithCompression(
+    const Blob& blob,
+    const string& name,
+    BlobSerializerBase::SerializationAcceptor acceptor,
+    int chunk_size,
+    const string& compression) {
+  SerializeChunks(
+      blob,
+      name,
+      chunk_size,
+      compression,
+      [&acceptor](const string& key, const BlobProto& proto) {
+        acceptor(key, proto.SerializeAsString());
+      });
+}
+
+template <class Context>
+void TensorSerializer<Context>::SerializeStreaming(
+    const Blob& blob,
+    const string& name,
+    BlobSerializerBase::StreamingAcceptor acceptor,
+    int chunk_size,
+    const string& compression) {
+  SerializeChunks(
+      blob,
+      name,
+      chunk_size,
+      compression,
+      [&acceptor](const string& key, const BlobProto& proto) {
+        const size_t size = proto.ByteSize();
+        acceptor(key, size, [&proto](char* buffer) {
+          proto.SerializeWithCachedSizesToArray(
+              reinterpret_cast<google::protobuf::uint8*>(buffer));
+        });
+      });
+}
+
+template <class Context>
+void TensorSerializer<Context>::SerializeChunks(
+    const Blob& blob,
+    const string& name,
+    int chunk_size,
+    const string& compression,
+    const std::function<void(const string&, const BlobProto&)>& emit) {
   CAFFE_ENFORCE(blob.IsType<Tensor<Context>>());
   const auto& tensor = blob.template Get<Tensor<Context>>();
   if (chunk_size == kNoChunking) {
@@ -212,9 +312,13 @@ void TensorSerializer<Context>::SerializeWithChunkSize(
     proto.set_name(name);
     this->Serialize(
         tensor, name, blob_proto.mutable_tensor(), chunkStart, chunk_size);
-    acceptor(
+    // Runs on the chunk worker threads together with the serialization
+    if (!compression.empty()) {
+      detail::CompressTensorProto(compression, blob_proto.mutable_tensor());
+    }
+    emit(
         MakeString(name, kChunkIdSeparator, chunkStart / chunk_size),
-        blob_proto.SerializeAsString());
+        blob_proto);
   };
 
 #ifndef __ANDROID__
@@ -426,6 +530,20 @@ template <class Context>
 void TensorDeserializer<Context>::Deserialize(
     const TensorProto& proto,
     Tensor<Context>* tensor) {
+  if (proto.has_compression()) {
+    TensorProto decompressed;
+    CAFFE_ENFORCE(
+        decompressed.ParseFromString(
+            CreateCompressionCodec(proto.compression())
+                ->Decompress(proto.compressed_data())),
+        "Couldn't parse compressed TensorProto");
+    // The device may have been changed by the caller, e.g. LoadOp
+    if (proto.has_device_detail()) {
+      decompressed.mutable_device_detail()->CopyFrom(proto.device_detail());
+    }
+    Deserialize(decompressed, tensor);
+    return;
+  }
   // We create a local context for deserializing. Since Caffe2 contexts are
   // usually lightweighted, this should not involve too much overhead.
   Context context(proto.device_detail());
@@ -434,7 +552,11 @@ void TensorDeserializer<Context>::Deserialize(
   for (const TIndex d : proto.dims()) {
     dims.push_back(d);
   }
-  tensor->Resize(dims);
+  // Resize has to be skipped for already allocated tensors, as it is not
+  // safe to call while other chunks are copied into the tensor
+  if (tensor->dims() != dims) {
+    tensor->Resize(dims);
+  }
 
   int64_t chunkBegin = 0;
   auto chunkEnd = tensor->size();
@@ -25,6 +25,20 @@ class BlobSerializerBase {
   virtual ~BlobSerializerBase() {}
   using SerializationAcceptor =
      std::function<void(const std::string& blobName, const std::string& data)>;
+  /**
+   * Writes a serialized value of known size into the given buffer.
+   */
+  using ValueWriter = std::function<void(char* buffer)>;
+  /**
+   * Like SerializationAcceptor, but instead of the serialized data it gets
+   * its size and a writer that serializes it into a buffer provided by the
+   * acceptor, e.g. the write buffer of a db (see db::Transaction::PutStream).
+   * The writer is only valid during the call.
+   */
+  using StreamingAcceptor = std::function<void(
+      const std::string& blobName,
+      size_t size,
+      const ValueWriter& writer)>;
   /**
    * @brief The virtual function that returns a serialized string for the input
    * blob.
@@ -50,6 +64,44 @@ class BlobSerializerBase {
     // Base implementation.
     Serialize(blob, name, acceptor);
   }
+
+  /**
+   * @brief Like SerializeWithChunkSize, additionally compressing the data of
+   * every chunk with the named codec (see CompressionCodecRegistry).
+   * Serializers that don't support compression serialize uncompressed.
+   */
+  virtual void SerializeWithCompression(
+      const Blob& blob,
+      const std::string& name,
+      SerializationAcceptor acceptor,
+      int chunk_size,
+      const std::string& /*compression*/) {
+    // Base implementation.
+    SerializeWithChunkSize(blob, name, acceptor, chunk_size);
+  }
+
+  /**
+   * @brief Like SerializeWithCompression, handing the chunks to a streaming
+   * acceptor so that they don't have to be serialized into strings first.
+   * The base implementation goes through strings.
+   */
+  virtual void SerializeStreaming(
+      const Blob& blob,
+      const std::string& name,
+      StreamingAcceptor acceptor,
+      int chunk_size,
+      const std::string& compression) {
+    SerializeWithCompression(
+        blob,
+        name,
+        [&acceptor](const std::string& blobName, const std::string& data) {
+          acceptor(blobName, data.size(), [&data](char* buffer) {
+            data.copy(buffer, data.size());
+          });
+        },
+        chunk_size,
+        compression);
+  }
 };
 
 } // namespace caffe2
@@ -1,4 +1,7 @@
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -321,6 +324,28 @@ TYPED_TEST(TensorCPUTest, TensorShareData) {
   }
 }
 
+TYPED_TEST(TensorCPUTest, VersionChangesOnMutableAccess) {
+  vector<int> dims{2, 3};
+  TensorCPU tensor(dims);
+  TensorCPU other_tensor(dims);
+  auto version = tensor.version();
+  tensor.mutable_data<TypeParam>();
+  EXPECT_NE(tensor.version(), version);
+  version = tensor.version();
+  tensor.data<TypeParam>();
+  tensor.raw_data();
+  EXPECT_EQ(tensor.version(), version);
+  tensor.raw_mutable_data();
+  EXPECT_NE(tensor.version(), version);
+  version = tensor.version();
+  other_tensor.mutable_data<TypeParam>();
+  other_tensor.swap(tensor);
+  EXPECT_NE(tensor.version(), version);
+  version = other_tensor.version();
+  other_tensor.ShareData(tensor);
+  EXPECT_NE(other_tensor.version(), version);
+}
+
 TYPED_TEST(TensorCPUTest, TensorShareDataRawPointer) {
   vector<int> dims(3);
   dims[0] = 2;
@@ -421,6 +446,52 @@ TYPED_TEST(TensorCPUTest, NoLongerSharesAfterFreeMemory) {
   EXPECT_NE(old_pointer, tensor.mutable_data<TypeParam>());
 }
 
+TYPED_TEST(TensorCPUTest, CopyOnWriteCopiesOnFirstWrite) {
+  vector<int> dims{2, 3};
+  TensorCPU tensor(dims);
+  auto* data = tensor.mutable_data<TypeParam>();
+  for (int i = 0; i < tensor.size(); ++i) {
+    data[i] = i;
+  }
+  TensorCPU other_tensor;
+  other_tensor.ShareDataCopyOnWrite(&tensor);
+  EXPECT_TRUE(tensor.copy_on_write());
+  EXPECT_TRUE(other_tensor.copy_on_write());
+  EXPECT_EQ(other_tensor.dims(), tensor.dims());
+  // Reading doesn't copy
+  EXPECT_EQ(other_tensor.data<TypeParam>(), data);
+
+  // Writing makes a private copy with the same values
+  auto* other_data = other_tensor.mutable_data<TypeParam>();
+  EXPECT_NE(other_data, data);
+  EXPECT_FALSE(other_tensor.copy_on_write());
+  for (int i = 0; i < other_tensor.size(); ++i) {
+    EXPECT_EQ(other_data[i], i);
+  }
+  other_data[0] = 5;
+  EXPECT_EQ(tensor.data<TypeParam>()[0], 0);
+  // The source is the only owner left, it writes in place
+  EXPECT_EQ(tensor.mutable_data<TypeParam>(), data);
+  EXPECT_FALSE(tensor.copy_on_write());
+}
+
+TYPED_TEST(TensorCPUTest, CopyOnWriteSourceWriteCopies) {
+  vector<int> dims{2, 3};
+  TensorCPU tensor(dims);
+  auto* data = tensor.mutable_data<TypeParam>();
+  data[0] = 1;
+  TensorCPU other_tensor;
+  other_tensor.ShareDataCopyOnWrite(&tensor);
+  tensor.mutable_data<TypeParam>()[0] = 2;
+  EXPECT_NE(tensor.data<TypeParam>(), data);
+  EXPECT_EQ(other_tensor.data<TypeParam>(), data);
+  EXPECT_EQ(other_tensor.data<TypeParam>()[0], 1);
+  // Overwriting all of it doesn't need the old values
+  other_tensor.CopyFrom(tensor);
+  EXPECT_EQ(other_tensor.data<TypeParam>()[0], 2);
+  EXPECT_NE(other_tensor.data<TypeParam>(), tensor.data<TypeParam>());
+}
+
 TYPED_TEST(TensorCPUTest, KeepOnShrink) {
   // Set flags (defaults)
   FLAGS_caffe2_keep_on_shrink = true;
@@ -874,6 +945,241 @@ TYPED_TEST(TypedTensorTest, BigTensorSerialization) {
   }
 }
 
+TEST(TensorSerialization, ParallelChunkDeserialization) {
+  const int64_t size = 10000;
+  Blob blob;
+  auto* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(size / 100, 100);
+  auto* data = tensor->mutable_data<float>();
+  for (int64_t i = 0; i < size; ++i) {
+    data[i] = i;
+  }
+  StringMap chunks;
+  std::mutex mutex;
+  auto acceptor = [&](const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    chunks.emplace_back(key, value);
+  };
+  blob.Serialize("test", acceptor, 128);
+  ASSERT_GT(chunks.size(), 1);
+  // Chunks of parallel serialization can be stored in any order
+  std::reverse(chunks.begin(), chunks.end());
+
+  for (int num_threads : {1, 4}) {
+    string db_source = (string)std::tmpnam(nullptr);
+    VectorDB::registerData(db_source, StringMap(chunks));
+    auto op_def = CreateOperatorDef(
+        "Load",
+        "",
+        std::vector<string>{},
+        std::vector<string>({"test"}),
+        std::vector<Argument>{MakeArgument<string>("db_type", "vector_db"),
+                              MakeArgument<string>("db", db_source),
+                              MakeArgument<bool>("absolute_path", true),
+                              MakeArgument<int>("num_threads", num_threads)});
+    Workspace ws;
+    auto load_op = CreateOperator(op_def, &ws);
+    ASSERT_TRUE(load_op->Run());
+    const auto& new_tensor = ws.GetBlob("test")->Get<TensorCPU>();
+    EXPECT_EQ(tensor->dims(), new_tensor.dims());
+    for (int64_t i = 0; i < size; ++i) {
+      ASSERT_EQ(data[i], new_tensor.data<float>()[i]);
+    }
+  }
+}
+
+TEST(TensorSerialization, CompressedChunks) {
+  Blob blob;
+  auto* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(100, 10);
+  auto* data = tensor->mutable_data<float>();
+  std::fill(data, data + tensor->size(), 0);
+  for (int i = 0; i < 10; ++i) {
+    data[i * 37] = i + 1;
+  }
+  StringMap chunks;
+  std::mutex mutex;
+  auto acceptor = [&](const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> guard(mutex);
+    chunks.emplace_back(key, value);
+  };
+  blob.Serialize("test", acceptor, 300, "zero_rle");
+  ASSERT_EQ(4, chunks.size());
+  size_t compressed_size = 0;
+  for (const auto& chunk : chunks) {
+    BlobProto proto;
+    ASSERT_TRUE(proto.ParseFromString(chunk.second));
+    EXPECT_EQ("zero_rle", proto.tensor().compression());
+    EXPECT_EQ(0, proto.tensor().float_data_size());
+    EXPECT_TRUE(proto.tensor().has_segment());
+    compressed_size += chunk.second.size();
+  }
+  EXPECT_LT(compressed_size, tensor->nbytes() / 4);
+
+  Blob new_blob;
+  for (const auto& chunk : chunks) {
+    BlobProto proto;
+    ASSERT_TRUE(proto.ParseFromString(chunk.second));
+    new_blob.Deserialize(proto);
+  }
+  const auto& new_tensor = new_blob.Get<TensorCPU>();
+  EXPECT_EQ(tensor->dims(), new_tensor.dims());
+  for (int i = 0; i < tensor->size(); ++i) {
+    ASSERT_EQ(data[i], new_tensor.data<float>()[i]);
+  }
+}
+
+TEST(TensorSerialization, StreamingMatchesStrings) {
+  Blob blob;
+  auto* tensor = blob.GetMutable<TensorCPU>();
+  tensor->Resize(100, 3);
+  auto* data = tensor->mutable_data<int>();
+  std::iota(data, data + tensor->size(), 0);
+  for (const string compression : {"", "zero_rle"}) {
+    std::map<string, string> strings;
+    std::map<string, string> streamed;
+    std::mutex mutex;
+    blob.Serialize(
+        "test",
+        [&](const std::string& key, const std::string& value) {
+          std::lock_guard<std::mutex> guard(mutex);
+          strings[key] = value;
+        },
+        70,
+        compression);
+    blob.SerializeStreaming(
+        "test",
+        [&](const std::string& key,
+            size_t size,
+            const BlobSerializerBase::ValueWriter& writer) {
+          string value(size, '\0');
+          writer(&value[0]);
+          std::lock_guard<std::mutex> guard(mutex);
+          streamed[key] = value;
+        },
+        70,
+        compression);
+    EXPECT_EQ(5, streamed.size());
+    EXPECT_EQ(strings, streamed);
+  }
+  // Blobs without a streaming serializer go through strings
+  Blob string_blob;
+  *string_blob.GetMutable<std::string>() = "hello";
+  int calls = 0;
+  string_blob.SerializeStreaming(
+      "s",
+      [&](const std::string& key,
+          size_t size,
+          const BlobSerializerBase::ValueWriter& writer) {
+        string value(size, '\0');
+        writer(&value[0]);
+        EXPECT_EQ("s", key);
+        EXPECT_EQ(string_blob.Serialize("s"), value);
+        ++calls;
+      });
+  EXPECT_EQ(1, calls);
+}
+
+// Reads all records of a minidb
+static StringMap ReadMiniDB(const string& source) {
+  StringMap records;
+  auto in_db = db::CreateDB("minidb", source, db::READ);
+  auto cursor = in_db->NewCursor();
+  for (; cursor->Valid(); cursor->Next()) {
+    records.emplace_back(cursor->key(), cursor->value());
+  }
+  return records;
+}
+
+TEST(TensorSerialization, DeltaCheckpoints) {
+  const auto old_chunk_size = FLAGS_caffe2_tensor_chunk_size;
+  FLAGS_caffe2_tensor_chunk_size = 10;
+  const string prefix = std::tmpnam(nullptr);
+  Workspace ws;
+  auto* iter = ws.CreateBlob("iter")->GetMutable<TensorCPU>();
+  iter->Resize(1);
+  auto* weights = ws.CreateBlob("w")->GetMutable<TensorCPU>();
+  weights->Resize(10, 5);
+  auto* w = weights->mutable_data<float>();
+  std::iota(w, w + weights->size(), 0);
+  auto* names = ws.CreateBlob("names")->GetMutable<TensorCPU>();
+  names->Resize(1);
+  names->mutable_data<string>()[0] = "a";
+
+  OperatorDef op_def = CreateOperatorDef(
+      "Checkpoint",
+      "",
+      std::vector<string>{"iter", "w", "names"},
+      std::vector<string>{},
+      std::vector<Argument>{MakeArgument<string>("db", prefix + "_%d"),
+                            MakeArgument<string>("db_type", "minidb"),
+                            MakeArgument<int>("absolute_path", 1),
+                            MakeArgument<bool>("delta", true),
+                            MakeArgument<int>("full_every", 3)});
+  auto checkpoint = CreateOperator(op_def, &ws);
+  auto run = [&](int64_t it) {
+    iter->mutable_data<int64_t>()[0] = it;
+    ASSERT_TRUE(checkpoint->Run());
+  };
+  run(0);
+  EXPECT_EQ(ReadMiniDB(prefix + "_0").size(), 7);
+
+  // Rows 2 and 9 are in the chunks 1 and 4
+  w[11] = -1;
+  w[47] = -2;
+  run(1);
+  auto records = ReadMiniDB(prefix + "_1");
+  std::vector<string> keys;
+  for (const auto& record : records) {
+    keys.push_back(record.first);
+  }
+  EXPECT_EQ(
+      keys,
+      std::vector<string>({"__delta_checkpoint_manifest__",
+                           MakeString("iter", kChunkIdSeparator, 0),
+                           MakeString("w", kChunkIdSeparator, 1),
+                           MakeString("w", kChunkIdSeparator, 4),
+                           MakeString("names", kChunkIdSeparator, 0)}));
+
+  names->mutable_data<string>()[0] = "b";
+  run(2);
+  EXPECT_EQ(ReadMiniDB(prefix + "_2").size(), 3);
+  // Every third checkpoint is a full one
+  run(3);
+  EXPECT_EQ(ReadMiniDB(prefix + "_3").size(), 7);
+
+  // Loading the last delta composes it with the full checkpoint
+  for (int it : {1, 2}) {
+    Workspace load_ws;
+    auto load = CreateOperator(
+        CreateOperatorDef(
+            "Load",
+            "",
+            std::vector<string>{},
+            std::vector<string>{"iter", "w", "names"},
+            std::vector<Argument>{
+                MakeArgument<string>("db", MakeString(prefix, "_", it)),
+                MakeArgument<string>("db_type", "minidb"),
+                MakeArgument<int>("absolute_path", 1)}),
+        &load_ws);
+    ASSERT_TRUE(load->Run());
+    EXPECT_EQ(
+        load_ws.GetBlob("iter")->Get<TensorCPU>().data<int64_t>()[0], it);
+    const auto& loaded = load_ws.GetBlob("w")->Get<TensorCPU>();
+    EXPECT_EQ(loaded.dims(), weights->dims());
+    for (int i = 0; i < weights->size(); ++i) {
+      EXPECT_EQ(loaded.data<float>()[i], w[i]);
+    }
+    EXPECT_EQ(
+        load_ws.GetBlob("names")->Get<TensorCPU>().data<string>()[0],
+        it == 1 ? "a" : "b");
+  }
+  for (int it = 0; it < 4; ++it) {
+    std::remove(MakeString(prefix, "_", it).c_str());
+  }
+  FLAGS_caffe2_tensor_chunk_size = old_chunk_size;
+}
+
 struct DummyType {
   /* This struct is used to test serialization and deserialization of huge
    * blobs, that are not tensors.
@@ -0,0 +1,92 @@
+#include "caffe2/core/compression_codec.h"
+
+#include <cstdint>
+
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+CAFFE_DEFINE_REGISTRY(CompressionCodecRegistry, CompressionCodec);
+
+namespace {
+
+void appendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+uint64_t readVarint(const std::string& data, size_t* pos) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    CAFFE_ENFORCE_LT(*pos, data.size(), "Truncated compressed data");
+    const auto byte = static_cast<uint8_t>(data[(*pos)++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  CAFFE_THROW("Invalid varint in compressed data");
+}
+
+/**
+ * Dependency-free codec for data with long runs of zero bytes, e.g. the
+ * zero rows of embedding tables. The data is stored as pairs of a varint
+ * number of literal bytes followed by the bytes, and a varint length of the
+ * zero run that comes after them.
+ */
+class ZeroRunLengthCodec final : public CompressionCodec {
+ public:
+  std::string Compress(const std::string& data) override {
+    // Runs shorter than this are cheaper to store as literals
+    const size_t kMinRun = 8;
+    std::string out;
+    size_t literal_begin = 0;
+    size_t pos = 0;
+    while (pos < data.size()) {
+      if (data[pos] != 0) {
+        ++pos;
+        continue;
+      }
+      size_t run_end = pos;
+      while (run_end < data.size() && data[run_end] == 0) {
+        ++run_end;
+      }
+      if (run_end - pos >= kMinRun || run_end == data.size()) {
+        appendVarint(pos - literal_begin, &out);
+        out.append(data, literal_begin, pos - literal_begin);
+        appendVarint(run_end - pos, &out);
+        literal_begin = run_end;
+      }
+      pos = run_end;
+    }
+    if (literal_begin < data.size()) {
+      appendVarint(data.size() - literal_begin, &out);
+      out.append(data, literal_begin, data.size() - literal_begin);
+      appendVarint(0, &out);
+    }
+    return out;
+  }
+
+  std::string Decompress(const std::string& data) override {
+    std::string out;
+    size_t pos = 0;
+    while (pos < data.size()) {
+      const auto literal_size = readVarint(data, &pos);
+      CAFFE_ENFORCE_LE(
+          literal_size, data.size() - pos, "Truncated compressed data");
+      out.append(data, pos, literal_size);
+      pos += literal_size;
+      out.append(readVarint(data, &pos), '\0');
+    }
+    return out;
+  }
+};
+
+} // namespace
+
+REGISTER_COMPRESSION_CODEC(zero_rle, ZeroRunLengthCodec);
+
+} // namespace caffe2
@@ -0,0 +1,40 @@
+#ifndef CAFFE2_CORE_COMPRESSION_CODEC_H_
+#define CAFFE2_CORE_COMPRESSION_CODEC_H_
+
+#include <string>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/registry.h"
+
+namespace caffe2 {
+
+/**
+ * @brief CompressionCodec compresses serialized data, e.g. the chunks of
+ * tensors written by TensorSerializer.
+ *
+ * The output of Compress has to be self-contained: Decompress gets nothing
+ * but the compressed string. Codecs are created per use and don't need to be
+ * thread-safe.
+ */
+class CompressionCodec {
+ public:
+  virtual ~CompressionCodec() {}
+  virtual std::string Compress(const std::string& data) = 0;
+  virtual std::string Decompress(const std::string& data) = 0;
+};
+
+CAFFE_DECLARE_REGISTRY(CompressionCodecRegistry, CompressionCodec);
+#define REGISTER_COMPRESSION_CODEC(name, ...) \
+  CAFFE_REGISTER_CLASS(CompressionCodecRegistry, name, __VA_ARGS__)
+
+inline unique_ptr<CompressionCodec> CreateCompressionCodec(
+    const std::string& name) {
+  auto codec = CompressionCodecRegistry()->Create(name);
+  CAFFE_ENFORCE(codec, "Unknown compression codec: ", name);
+  return codec;
+}
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_COMPRESSION_CODEC_H_
@@ -0,0 +1,27 @@
+#include <string>
+
+#include "caffe2/core/compression_codec.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(CompressionCodecTest, ZeroRunLengthRoundTrip) {
+  auto codec = CreateCompressionCodec("zero_rle");
+  std::string sparse(4096, '\0');
+  sparse[7] = 'a';
+  sparse[2000] = 'b';
+  sparse[2001] = '\0';
+  sparse[2002] = 'c';
+  const std::vector<std::string> inputs = {
+      "", "abc", std::string(3, '\0'), std::string(100, '\0') + "x", sparse};
+  for (const auto& input : inputs) {
+    EXPECT_EQ(input, codec->Decompress(codec->Compress(input)));
+  }
+  EXPECT_LT(codec->Compress(sparse).size(), 32);
+}
+
+TEST(CompressionCodecTest, UnknownCodec) {
+  EXPECT_THROW(CreateCompressionCodec("no_such_codec"), EnforceNotMet);
+}
+
+} // namespace caffe2
@@ -0,0 +1,176 @@
+#include "caffe2/core/concurrent_predictor.h"
+
+#include <unordered_set>
+
+#include "caffe2/core/scope_guard.h"
+
+namespace caffe2 {
+
+namespace {
+
+void shareInputTensor(
+    Workspace* ws,
+    const std::string& name,
+    TensorCPU* input) {
+  auto* blob = ws->GetBlob(name);
+  CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
+  CAFFE_ENFORCE(
+      blob->template IsType<TensorCPU>(), "Blob is not a CPU Tensor: ", name);
+  auto* tensor = blob->template GetMutable<TensorCPU>();
+  tensor->ResizeLike(*input);
+  tensor->ShareData(*input);
+}
+
+} // namespace
+
+ConcurrentPredictor::ConcurrentPredictor(
+    const NetDef& init_net,
+    const NetDef& run_net,
+    size_t max_instances,
+    Workspace* parent)
+    : run_net_(run_net),
+      run_net_template_(run_net),
+      params_ws_(parent),
+      max_instances_(max_instances),
+      num_instances_(0) {
+  CAFFE_ENFORCE(params_ws_.RunNetOnce(init_net));
+
+  // Inputs that are not initialized by init_net are fed per request, so
+  // every child workspace gets its own copy of them
+  std::unordered_set<std::string> local_blobs;
+  for (const auto& name : run_net_.external_input()) {
+    if (!params_ws_.HasBlob(name) && local_blobs.insert(name).second) {
+      local_blobs_.push_back(name);
+    }
+  }
+  // Activations are local as well; parameters are shared among threads and
+  // must not be written by run_net
+  for (const auto& op : run_net_.op()) {
+    for (const auto& name : op.output()) {
+      CAFFE_ENFORCE(
+          !params_ws_.HasBlob(name),
+          "ConcurrentPredictor run_net can not modify shared blob: ",
+          name);
+      if (local_blobs.insert(name).second) {
+        local_blobs_.push_back(name);
+      }
+    }
+  }
+
+  // Instantiate the first child eagerly, so that errors in run_net are
+  // reported at construction time
+  free_instances_.push_back(createInstance());
+  num_instances_ = 1;
+}
+
+ConcurrentPredictor::~ConcurrentPredictor() {}
+
+std::unique_ptr<ConcurrentPredictor::Instance>
+ConcurrentPredictor::createInstance() {
+  std::unique_ptr<Instance> instance(new Instance());
+  instance->ws.reset(new Workspace(&params_ws_));
+  for (const auto& name : local_blobs_) {
+    instance->ws->CreateLocalBlob(name);
+  }
+  for (const auto& name : run_net_.external_input()) {
+    auto* blob = instance->ws->GetBlob(name);
+    CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
+    if (!params_ws_.HasBlob(name)) {
+      blob->template GetMutable<TensorCPU>();
+    }
+  }
+  instance->net = instance->ws->CreateNet(run_net_template_.net_def());
+  CAFFE_ENFORCE(instance->net, "Failed to create net: ", run_net_.name());
+  return instance;
+}
+
+std::unique_ptr<ConcurrentPredictor::Instance>
+ConcurrentPredictor::checkout() {
+  {
+    std::unique_lock<std::mutex> lock(instances_mutex_);
+    while (free_instances_.empty() && max_instances_ > 0 &&
+           num_instances_ >= max_instances_) {
+      instances_cv_.wait(lock);
+    }
+    if (!free_instances_.empty()) {
+      auto instance = std::move(free_instances_.back());
+      free_instances_.pop_back();
+      return instance;
+    }
+    ++num_instances_;
+  }
+  // Net instantiation may be expensive, do it outside of the lock
+  try {
+    return createInstance();
+  } catch (...) {
+    std::unique_lock<std::mutex> lock(instances_mutex_);
+    --num_instances_;
+    instances_cv_.notify_one();
+    throw;
+  }
+}
+
+void ConcurrentPredictor::release(std::unique_ptr<Instance> instance) {
+  std::unique_lock<std::mutex> lock(instances_mutex_);
+  free_instances_.push_back(std::move(instance));
+  instances_cv_.notify_one();
+}
+
+size_t ConcurrentPredictor::num_instances() {
+  std::unique_lock<std::mutex> lock(instances_mutex_);
+  return num_instances_;
+}
+
+bool ConcurrentPredictor::runInstance(
+    Instance* instance,
+    OutputTensorVector* outputs) {
+  if (!instance->net->Run()) {
+    return false;
+  }
+
+  outputs->resize(run_net_.external_output_size());
+  for (auto i = 0; i < outputs->size(); ++i) {
+    const auto& name = run_net_.external_output(i);
+    const auto* blob = instance->ws->GetBlob(name);
+    CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
+    CAFFE_ENFORCE(
+        blob->template IsType<TensorCPU>(), "Blob is not a CPU Tensor: ", name);
+    auto& output = (*outputs)[i];
+    if (!output) {
+      output.reset(new TensorCPU());
+    }
+    output->CopyFrom(blob->template Get<TensorCPU>());
+  }
+  return true;
+}
+
+bool ConcurrentPredictor::run(
+    const TensorVector& inputs,
+    OutputTensorVector* outputs) {
+  CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
+  auto instance = checkout();
+  auto guard = MakeGuard([&]() { release(std::move(instance)); });
+  for (auto i = 0; i < inputs.size(); ++i) {
+    const auto& name = run_net_.external_input(i);
+    CAFFE_ENFORCE(!params_ws_.HasBlob(name), "Can not feed shared blob: ", name);
+    shareInputTensor(instance->ws.get(), name, inputs[i]);
+  }
+  return runInstance(instance.get(), outputs);
+}
+
+bool ConcurrentPredictor::run_map(
+    const TensorMap& inputs,
+    OutputTensorVector* outputs) {
+  auto instance = checkout();
+  auto guard = MakeGuard([&]() { release(std::move(instance)); });
+  for (const auto& input : inputs) {
+    CAFFE_ENFORCE(
+        !params_ws_.HasBlob(input.first),
+        "Can not feed shared blob: ",
+        input.first);
+    shareInputTensor(instance->ws.get(), input.first, input.second);
+  }
+  return runInstance(instance.get(), outputs);
+}
+
+} // namespace caffe2
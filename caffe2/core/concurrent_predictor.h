@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_template.h"
+#include "caffe2/core/predictor.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
+
+namespace caffe2 {
+
+// Predictor that can be run from multiple threads at once.
+//
+// The `init_net` is run once into a parameter workspace that is shared
+// read-only by a pool of child workspaces. Each child workspace only holds
+// the activations of `run_net` and an instantiated copy of the net; a child
+// is checked out for the duration of a single `run` call. Child workspaces
+// are created lazily, up to `max_instances` (0 - no limit), callers block
+// when all of them are in use.
+class ConcurrentPredictor {
+ public:
+  using TensorVector = Predictor::TensorVector;
+  using TensorMap = Predictor::TensorMap;
+  // Outputs are copied into tensors owned by the caller, so that the child
+  // workspace can be returned to the pool; existing tensors are reused
+  using OutputTensorVector = std::vector<std::unique_ptr<TensorCPU>>;
+
+  ConcurrentPredictor(
+      const NetDef& init_net,
+      const NetDef& run_net,
+      size_t max_instances = 0,
+      Workspace* parent = nullptr);
+  ~ConcurrentPredictor();
+
+  // Same semantics as Predictor::run, thread-safe
+  bool run(const TensorVector& inputs, OutputTensorVector* outputs);
+
+  // Same semantics as Predictor::run_map, thread-safe
+  bool run_map(const TensorMap& inputs, OutputTensorVector* outputs);
+
+  const NetDef& def() const {
+    return run_net_;
+  };
+
+  // Workspace holding the shared parameters
+  const Workspace* parameters() const {
+    return &params_ws_;
+  };
+
+  // Number of child workspaces created so far
+  size_t num_instances();
+
+ private:
+  struct Instance {
+    std::unique_ptr<Workspace> ws;
+    NetBase* net;
+  };
+
+  std::unique_ptr<Instance> checkout();
+  void release(std::unique_ptr<Instance> instance);
+  std::unique_ptr<Instance> createInstance();
+
+  bool runInstance(Instance* instance, OutputTensorVector* outputs);
+
+  NetDef run_net_;
+  // Instances after the first one reuse what the first one resolved
+  NetTemplate run_net_template_;
+  Workspace params_ws_;
+  // Blobs that are created in every child workspace, hiding any blob with
+  // the same name in the parameter workspace
+  std::vector<std::string> local_blobs_;
+
+  const size_t max_instances_;
+  size_t num_instances_;
+  std::vector<std::unique_ptr<Instance>> free_instances_;
+  std::mutex instances_mutex_;
+  std::condition_variable instances_cv_;
+
+  DISABLE_COPY_AND_ASSIGN(ConcurrentPredictor);
+};
+
+} // namespace caffe2
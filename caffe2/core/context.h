@@ -16,6 +16,8 @@ CAFFE2_DECLARE_bool(caffe2_report_cpu_memory_usage);
 
 namespace caffe2 {
 
+class ThreadPool;
+
 /**
  * A function to generate a random number seed that is unique in a best-effort
  * basis, using an ever-incrementing seed and the current time.
@@ -102,7 +104,8 @@ class CPUContext final {
   static std::pair<void*, MemoryDeleter> New(size_t nbytes) {
     auto data_and_deleter = GetCPUAllocator()->New(nbytes);
     if (FLAGS_caffe2_report_cpu_memory_usage) {
-      reporter_.New(data_and_deleter.first, nbytes);
+      reporter_.New(
+          data_and_deleter.first, nbytes, data_and_deleter.second);
       data_and_deleter.second = ReportAndDelete;
     }
     return data_and_deleter;
@@ -151,16 +154,32 @@ class CPUContext final {
     return true;
   }
 
+  // Lets math functions that support it, such as Im2col and Col2im, split
+  // their work between up to max_threads threads of pool (0 for all of
+  // them). With no pool, the default, they run on the calling thread.
+  void set_thread_pool(ThreadPool* pool, int max_threads = 0) {
+    thread_pool_ = pool;
+    max_threads_ = max_threads;
+  }
+  ThreadPool* thread_pool() const {
+    return thread_pool_;
+  }
+  int max_threads() const {
+    return max_threads_;
+  }
+
  protected:
   // TODO(jiayq): instead of hard-coding a generator, make it more flexible.
   int random_seed_{1701};
   std::unique_ptr<rand_gen_type> random_generator_;
+  ThreadPool* thread_pool_{nullptr};
+  int max_threads_{0};
   CAFFE2_API static MemoryAllocationReporter reporter_;
 
  private:
   static void ReportAndDelete(void* ptr) {
-    reporter_.Delete(ptr);
-    GetCPUAllocator()->GetDeleter()(ptr);
+    // The allocator may have changed since the allocation
+    reporter_.Delete(ptr)(ptr);
   }
 };
 
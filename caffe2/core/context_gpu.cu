@@ -1,16 +1,22 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <map>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "cub/util_allocator.cuh"
 
 #include "caffe2/core/asan.h"
+#include "caffe2/core/blob_stats.h"
 #include "caffe2/core/common_cudnn.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/init.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/static_tracepoint.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/string_utils.h"
 
@@ -37,6 +43,39 @@ CAFFE2_DEFINE_bool(
     false,
     "If true CachingDeviceAllocator will print allocation and deallocation "
     "events to stdout.");
+CAFFE2_DEFINE_bool(
+    caffe2_cub_stream_aware,
+    false,
+    "If using cub as the memory allocator, associates every allocation with "
+    "the stream the allocating thread last switched to, so that a freed "
+    "block is reused right away on its stream, and on other streams once "
+    "the work queued before the free is done. The streams of the threads "
+    "that exit are then kept alive.");
+
+CAFFE2_DEFINE_bool(
+    caffe2_cuda_pinned_memory_pool,
+    false,
+    "If set, the CPU allocator caches the pinned memory it frees, see "
+    "CachingPinnedCPUAllocator.");
+CAFFE2_DEFINE_int(
+    caffe2_pinned_bin_growth,
+    2,
+    "Growth of the size classes of the pinned memory pool.");
+CAFFE2_DEFINE_int(
+    caffe2_pinned_min_bin,
+    12,
+    "The smallest size class of the pinned memory pool is "
+    "caffe2_pinned_bin_growth ^ caffe2_pinned_min_bin bytes.");
+CAFFE2_DEFINE_int(
+    caffe2_pinned_max_bin,
+    30,
+    "The largest size class of the pinned memory pool is "
+    "caffe2_pinned_bin_growth ^ caffe2_pinned_max_bin bytes, larger blocks "
+    "are not cached.");
+CAFFE2_DEFINE_int(
+    caffe2_pinned_max_cached_mb,
+    1024,
+    "Maximum size of the freed blocks the pinned memory pool keeps.");
 
 CAFFE2_DEFINE_bool(
     caffe2_gpu_memory_tracking,
@@ -76,8 +115,8 @@ unique_ptr<cub::CachingDeviceAllocator> g_cub_allocator;
 // unique.
 static std::unordered_map<void*, uint8_t> g_cuda_device_affiliation;
 
-// Data structures for optional memory tracking. Access to these structures
-// is garded by the CUDAContext::mutex.
+// Requested size of every allocation. Access to this and the structures for
+// optional memory tracking below is garded by the CUDAContext::mutex.
 static std::unordered_map<void*, long> g_size_map;
 static std::vector<long> g_total_by_gpu_map(CAFFE2_COMPILE_TIME_MAX_GPUS, 0);
 static std::vector<long> g_max_by_gpu_map(CAFFE2_COMPILE_TIME_MAX_GPUS, 0);
@@ -85,6 +124,16 @@ static std::vector<long> g_max_by_gpu_map(CAFFE2_COMPILE_TIME_MAX_GPUS, 0);
 static long g_total_mem = 0;
 static long g_last_rep = 0;
 
+// Usage of every GPU and histograms of the requested sizes, always kept.
+// Also garded by the CUDAContext::mutex.
+static std::vector<CudaMemoryPoolStats> g_pool_stats(
+    CAFFE2_COMPILE_TIME_MAX_GPUS);
+static std::vector<HistogramExportedStat*> g_alloc_size_histograms;
+
+// Also garded by the CUDAContext::mutex.
+static std::map<int, CudaMemoryListener> g_memory_listeners;
+static int g_next_memory_listener_id = 0;
+
 CudaMemoryPoolType GetCudaMemoryPoolType() {
   return g_cuda_memory_pool_type;
 }
@@ -181,6 +230,45 @@ static void SetUpCub() {
   VLOG(1) << "Done setting up cub memory pool.";
 }
 
+namespace {
+class CudaMemoryStatPublisher final : public StatPublisher {
+ public:
+  void publish(ExportedStatList& exported, bool reset) override {
+    const auto ts = std::chrono::high_resolution_clock::now();
+    for (int gpu = 0; gpu < NumCudaDevices(); ++gpu) {
+      const auto stats = GetCudaMemoryPoolStats(gpu);
+      if (stats.num_allocs == 0) {
+        continue;
+      }
+      const auto prefix = "cuda_memory/gpu" + caffe2::to_string(gpu) + "/";
+      exported.push_back(
+          {prefix + "allocated_bytes", int64_t(stats.allocated_bytes), ts});
+      exported.push_back({prefix + "peak_allocated_bytes",
+                          int64_t(stats.peak_allocated_bytes),
+                          ts});
+      exported.push_back(
+          {prefix + "cached_bytes", int64_t(stats.cached_bytes), ts});
+      exported.push_back(
+          {prefix + "num_allocs", int64_t(stats.num_allocs), ts});
+    }
+    if (reset) {
+      ResetCudaMemoryPoolPeaks();
+    }
+  }
+};
+
+// Called once, before any allocation. The publisher is registered last, as
+// it takes the CUDAContext::mutex while StatRegistry holds its own.
+void SetUpCudaMemoryStats() {
+  for (int gpu = 0; gpu < NumCudaDevices(); ++gpu) {
+    g_alloc_size_histograms.push_back(new HistogramExportedStat(
+        "cuda_memory/gpu" + caffe2::to_string(gpu), "alloc_bytes"));
+  }
+  // Never destroyed, like the histograms
+  StatRegistry::get().addPublisher(new CudaMemoryStatPublisher());
+}
+} // namespace
+
 static void Caffe2SetCUDAMemoryPool() {
   if (FLAGS_caffe2_cuda_memory_pool == "" ||
       FLAGS_caffe2_cuda_memory_pool == "none") {
@@ -214,6 +302,12 @@ void Caffe2UsePinnedCPUAllocator() {
     VLOG(1) << "No GPU present. I won't use pinned allocator then.";
     return;
   }
+  if (FLAGS_caffe2_cuda_pinned_memory_pool) {
+    VLOG(1) << "Caffe2 gpu: setting CPUAllocator to "
+            << "CachingPinnedCPUAllocator.";
+    SetCPUAllocator(new CachingPinnedCPUAllocator());
+    return;
+  }
   VLOG(1) << "Caffe2 gpu: setting CPUAllocator to PinnedCPUAllocator.";
   SetCPUAllocator(new PinnedCPUAllocator());
 #endif
@@ -232,6 +326,7 @@ struct Caffe2CudaInitializerHelper {
     if (first_call.fetch_and((char)0)) {
       Caffe2InitializeCuda();
       Caffe2SetCUDAMemoryPool();
+      SetUpCudaMemoryStats();
       Caffe2UsePinnedCPUAllocator();
     }
   }
@@ -285,7 +380,64 @@ std::vector<long> CUDAContext::MaxMemoryByGpu() {
   return g_max_by_gpu_map;
 }
 
+CudaMemoryPoolStats GetCudaMemoryPoolStats(int gpu_id) {
+  CAFFE_ENFORCE_GE(gpu_id, 0);
+  CAFFE_ENFORCE_LT(gpu_id, CAFFE2_COMPILE_TIME_MAX_GPUS);
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  auto stats = g_pool_stats[gpu_id];
+  if (g_cuda_memory_pool_type == CudaMemoryPoolType::CUB && g_cub_allocator) {
+    auto it = g_cub_allocator->cached_bytes.find(gpu_id);
+    if (it != g_cub_allocator->cached_bytes.end()) {
+      stats.cached_bytes = it->second.free;
+    }
+  }
+  return stats;
+}
+
+void ResetCudaMemoryPoolPeaks() {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  for (auto& stats : g_pool_stats) {
+    stats.peak_allocated_bytes = stats.allocated_bytes;
+  }
+}
+
+void FreeCachedCudaMemory() {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  if (g_cuda_memory_pool_type == CudaMemoryPoolType::CUB && g_cub_allocator) {
+    CUDA_ENFORCE(g_cub_allocator->FreeAllCached());
+  }
+}
+
+int AddCudaMemoryListener(CudaMemoryListener listener) {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  const int id = g_next_memory_listener_id++;
+  g_memory_listeners.emplace(id, std::move(listener));
+  return id;
+}
+
+void RemoveCudaMemoryListener(int id) {
+  std::lock_guard<std::mutex> lock(CUDAContext::mutex());
+  g_memory_listeners.erase(id);
+}
+
 namespace {
+void NotifyMemoryListeners(int gpu, const void* ptr, long nbytes) {
+  for (const auto& listener : g_memory_listeners) {
+    listener.second(gpu, ptr, nbytes, g_pool_stats[gpu].allocated_bytes);
+  }
+}
+
+void TrackPoolAlloc(int gpu, size_t nbytes) {
+  auto& stats = g_pool_stats[gpu];
+  stats.allocated_bytes += nbytes;
+  stats.peak_allocated_bytes =
+      std::max(stats.peak_allocated_bytes, stats.allocated_bytes);
+  ++stats.num_allocs;
+  if (gpu < g_alloc_size_histograms.size()) {
+    g_alloc_size_histograms[gpu]->increment(nbytes);
+  }
+}
+
 void TrackMemoryAlloc(size_t nbytes) {
   int this_gpu = CaffeCudaGetDevice();
   g_total_by_gpu_map[this_gpu] += nbytes;
@@ -318,6 +470,7 @@ std::pair<void*, MemoryDeleter> CUDAContext::New(size_t nbytes) {
   // A one-time caffe2 cuda initializer.
   static Caffe2CudaInitializerHelper g_cuda_initializer_;
   void* ptr = nullptr;
+  const int gpu = CaffeCudaGetDevice();
 
   if (FLAGS_caffe2_gpu_memory_tracking) {
     TrackMemoryAlloc(nbytes);
@@ -325,37 +478,43 @@ std::pair<void*, MemoryDeleter> CUDAContext::New(size_t nbytes) {
   switch (g_cuda_memory_pool_type) {
   case CudaMemoryPoolType::NONE:
     CUDA_ENFORCE(cudaMalloc(&ptr, nbytes));
-    if (FLAGS_caffe2_gpu_memory_tracking) {
-      g_size_map[ptr] = nbytes;
-      g_cuda_device_affiliation[ptr] = CaffeCudaGetDevice();
-    }
-    return {ptr, Delete};
-  case CudaMemoryPoolType::CUB:
-    CUDA_ENFORCE(g_cub_allocator->DeviceAllocate(&ptr, nbytes));
-    g_cuda_device_affiliation[ptr] = CaffeCudaGetDevice();
-    VLOG(2) << "CUB allocating pointer " << ptr << " on device "
-            << CaffeCudaGetDevice();
-    if (FLAGS_caffe2_gpu_memory_tracking) {
-      g_size_map[ptr] = nbytes;
-    }
-    return {ptr, Delete};
+    break;
+  case CudaMemoryPoolType::CUB: {
+    // With the default stream, a freed block is reused by any allocation
+    cudaStream_t stream = FLAGS_caffe2_cub_stream_aware
+        ? cuda_objects_.GetStream(gpu, cuda_objects_.current_stream_id_)
+        : 0;
+    CUDA_ENFORCE(g_cub_allocator->DeviceAllocate(gpu, &ptr, nbytes, stream));
+    VLOG(2) << "CUB allocating pointer " << ptr << " on device " << gpu;
+    break;
+  }
   }
-  return {nullptr, Delete};
+  g_cuda_device_affiliation[ptr] = gpu;
+  g_size_map[ptr] = nbytes;
+  TrackPoolAlloc(gpu, nbytes);
+  NotifyMemoryListeners(gpu, ptr, nbytes);
+  CAFFE_SDT(cuda_alloc, ptr, nbytes, gpu);
+  return {ptr, Delete};
 }
 
 void CUDAContext::Delete(void* ptr) {
   // lock the mutex
   std::lock_guard<std::mutex> lock(CUDAContext::mutex());
 
+  auto sz_it = g_size_map.find(ptr);
+  DCHECK(sz_it != g_size_map.end());
+  auto aff_it = g_cuda_device_affiliation.find(ptr);
+  DCHECK(aff_it != g_cuda_device_affiliation.end());
+  const int gpu = aff_it->second;
+  CAFFE_SDT(cuda_free, ptr, sz_it->second, gpu);
+  g_pool_stats[gpu].allocated_bytes -= sz_it->second;
+  NotifyMemoryListeners(gpu, ptr, -sz_it->second);
   if (FLAGS_caffe2_gpu_memory_tracking) {
-    auto sz_it = g_size_map.find(ptr);
-    DCHECK(sz_it != g_size_map.end());
-    auto aff_it = g_cuda_device_affiliation.find(ptr);
-    DCHECK(aff_it != g_cuda_device_affiliation.end());
     g_total_mem -= sz_it->second;
-    g_total_by_gpu_map[aff_it->second] -= sz_it->second;
-    g_size_map.erase(sz_it);
+    g_total_by_gpu_map[gpu] -= sz_it->second;
   }
+  g_size_map.erase(sz_it);
+  g_cuda_device_affiliation.erase(aff_it);
 
   switch (g_cuda_memory_pool_type) {
   case CudaMemoryPoolType::NONE: {
@@ -371,21 +530,130 @@ void CUDAContext::Delete(void* ptr) {
       LOG(FATAL) << "Error at: " << __FILE__ << ":" << __LINE__ << ": "
                  << cudaGetErrorString(error);
     }
-
-    if (FLAGS_caffe2_gpu_memory_tracking) {
-      g_cuda_device_affiliation.erase(g_cuda_device_affiliation.find(ptr));
-    }
-
     break; }
   case CudaMemoryPoolType::CUB: {
-    auto it = g_cuda_device_affiliation.find(ptr);
-    DCHECK(it != g_cuda_device_affiliation.end());
-    VLOG(2) << "CUB freeing pointer " << ptr << " on device " << it->second;
-    CUDA_ENFORCE(g_cub_allocator->DeviceFree(it->second, ptr));
-    g_cuda_device_affiliation.erase(it);
+    VLOG(2) << "CUB freeing pointer " << ptr << " on device " << gpu;
+    CUDA_ENFORCE(g_cub_allocator->DeviceFree(gpu, ptr));
     break;
   }
   }
 }
 
+namespace {
+
+struct PinnedMemoryPool {
+  std::mutex mutex;
+  // Size of the blocks handed out
+  std::unordered_map<void*, size_t> live;
+  // Freed blocks by size class
+  std::unordered_map<size_t, std::vector<void*>> cached;
+  PinnedMemoryPoolStats stats;
+  PinnedCPUAllocator allocator;
+};
+
+// Never destroyed, the pool can be used until the end of the process
+PinnedMemoryPool& GetPinnedMemoryPool() {
+  static PinnedMemoryPool* pool = new PinnedMemoryPool();
+  return *pool;
+}
+
+// The size class of nbytes, or 0 if it is larger than the largest one
+size_t PinnedSizeClass(size_t nbytes) {
+  size_t bin_bytes = 1;
+  for (int i = 0; i < FLAGS_caffe2_pinned_min_bin; ++i) {
+    bin_bytes *= FLAGS_caffe2_pinned_bin_growth;
+  }
+  for (int i = FLAGS_caffe2_pinned_min_bin; i <= FLAGS_caffe2_pinned_max_bin;
+       ++i) {
+    if (bin_bytes >= nbytes) {
+      return bin_bytes;
+    }
+    bin_bytes *= FLAGS_caffe2_pinned_bin_growth;
+  }
+  return 0;
+}
+
+} // namespace
+
+std::pair<void*, MemoryDeleter> CachingPinnedCPUAllocator::New(
+    size_t nbytes) {
+  auto& pool = GetPinnedMemoryPool();
+  const size_t bin_bytes = PinnedSizeClass(nbytes);
+  const size_t block_bytes = bin_bytes > 0 ? bin_bytes : nbytes;
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.cached.find(bin_bytes);
+    if (bin_bytes > 0 && it != pool.cached.end() && !it->second.empty()) {
+      void* data = it->second.back();
+      it->second.pop_back();
+      pool.live[data] = block_bytes;
+      pool.stats.cached_bytes -= block_bytes;
+      pool.stats.allocated_bytes += block_bytes;
+      ++pool.stats.hits;
+      if (FLAGS_caffe2_cpu_allocator_do_zero_fill) {
+        memset(data, 0, nbytes);
+      }
+      CAFFE_SDT(pinned_alloc, data, block_bytes);
+      return {data, Delete};
+    }
+    ++pool.stats.misses;
+  }
+  // Allocated and zero filled without holding the lock
+  void* data = pool.allocator.New(block_bytes).first;
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  pool.live[data] = block_bytes;
+  pool.stats.allocated_bytes += block_bytes;
+  CAFFE_SDT(pinned_alloc, data, block_bytes);
+  return {data, Delete};
+}
+
+void CachingPinnedCPUAllocator::Delete(void* data) {
+  auto& pool = GetPinnedMemoryPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  auto it = pool.live.find(data);
+  CAFFE_ENFORCE(it != pool.live.end(), "Unknown pinned memory block ", data);
+  const size_t block_bytes = it->second;
+  CAFFE_SDT(pinned_free, data, block_bytes);
+  pool.live.erase(it);
+  pool.stats.allocated_bytes -= block_bytes;
+  if (PinnedSizeClass(block_bytes) == block_bytes &&
+      pool.stats.cached_bytes + block_bytes <=
+          size_t(FLAGS_caffe2_pinned_max_cached_mb) * 1024 * 1024) {
+    pool.cached[block_bytes].push_back(data);
+    pool.stats.cached_bytes += block_bytes;
+    return;
+  }
+  pool.allocator.GetDeleter()(data);
+}
+
+PinnedMemoryPoolStats CachingPinnedCPUAllocator::GetStats() {
+  auto& pool = GetPinnedMemoryPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  return pool.stats;
+}
+
+void CachingPinnedCPUAllocator::FreeCached() {
+  auto& pool = GetPinnedMemoryPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  const auto deleter = pool.allocator.GetDeleter();
+  for (auto& it : pool.cached) {
+    for (void* data : it.second) {
+      deleter(data);
+    }
+  }
+  pool.cached.clear();
+  pool.stats.cached_bytes = 0;
+}
+
+namespace {
+
+struct TensorCUDAStatGetter : BlobStatGetter {
+  size_t sizeBytes(const Blob& blob) const override {
+    return blob.Get<TensorCUDA>().nbytes();
+  }
+};
+REGISTER_BLOB_STAT_GETTER(TensorCUDA, TensorCUDAStatGetter);
+
+} // namespace
+
 }  // namespace caffe2
@@ -2,6 +2,7 @@
 #define CAFFE2_CORE_CONTEXT_GPU_H_
 
 #include <ctime>
+#include <functional>
 #include <mutex>
 
 #include "caffe2/core/common_cudnn.h"
@@ -13,6 +14,8 @@
 #include "caffe2/core/types.h"
 #include "caffe2/proto/caffe2.pb.h"
 
+CAFFE2_DECLARE_bool(caffe2_cub_stream_aware);
+
 namespace caffe2 {
 
 enum class CudaMemoryPoolType {
@@ -27,6 +30,44 @@ enum class CudaMemoryPoolType {
  */
 CudaMemoryPoolType GetCudaMemoryPoolType();
 
+// Usage of the memory of one GPU allocated through CUDAContext::New
+struct CudaMemoryPoolStats {
+  // Bytes requested by the live allocations
+  size_t allocated_bytes = 0;
+  // Highest allocated_bytes since the start or the last reset
+  size_t peak_allocated_bytes = 0;
+  // Bytes of the freed blocks kept by the cub pool, 0 without a pool
+  size_t cached_bytes = 0;
+  size_t num_allocs = 0;
+};
+
+/**
+ * Gets the memory usage of a GPU. The same values, and percentiles of the
+ * requested sizes, are exported through StatRegistry as
+ * cuda_memory/gpu<id>/...
+ */
+CudaMemoryPoolStats GetCudaMemoryPoolStats(int gpu_id);
+
+// Lowers the peaks of all the GPUs to their current usage
+void ResetCudaMemoryPoolPeaks();
+
+// Returns the blocks kept by the cub pool to the driver
+void FreeCachedCudaMemory();
+
+/**
+ * Called on every allocation and free of CUDAContext with the GPU, the
+ * pointer, the requested bytes, negative for a free, and the allocated_bytes
+ * of the GPU after it. Listeners run with CUDAContext::mutex() held, they
+ * must not allocate or free GPU memory.
+ */
+using CudaMemoryListener =
+    std::function<void(int gpu, const void* ptr, long nbytes, long total)>;
+
+// Registers a listener and returns the id removing it
+int AddCudaMemoryListener(CudaMemoryListener listener);
+
+void RemoveCudaMemoryListener(int id);
+
 /**
  * A struct to host thread-local cuda objects.
  *
@@ -102,7 +143,9 @@ class ThreadLocalCUDAObjects {
         }
       }
       for (auto& stream : cuda_streams_[i]) {
-        if (stream) {
+        // The cub pool records the frees of the blocks allocated on the
+        // stream, which may happen after the thread exits
+        if (stream && !FLAGS_caffe2_cub_stream_aware) {
           CUDA_CHECK(cudaStreamDestroy(stream));
         }
       }
@@ -114,6 +157,8 @@ class ThreadLocalCUDAObjects {
     }
   }
   vector<cudaStream_t> cuda_streams_[CAFFE2_COMPILE_TIME_MAX_GPUS];
+  // Stream of the last SwitchToDevice of the thread
+  int current_stream_id_ = 0;
   vector<cublasHandle_t> cublas_handles_[CAFFE2_COMPILE_TIME_MAX_GPUS];
   vector<cudnnHandle_t> cudnn_handles_[CAFFE2_COMPILE_TIME_MAX_GPUS];
 };
@@ -133,6 +178,7 @@ class CUDAContext final {
 
   inline void SwitchToDevice(int stream_id) {
     set_stream_id(stream_id);
+    cuda_objects_.current_stream_id_ = stream_id;
     CaffeCudaSetDevice(gpu_id_);
   }
   inline void SwitchToDevice() {
@@ -332,6 +378,53 @@ struct PinnedCPUAllocator final : CPUAllocator {
   DefaultCPUAllocator baseAllocator_;
 };
 
+// Usage of the pool of CachingPinnedCPUAllocator
+struct PinnedMemoryPoolStats {
+  // Bytes of the blocks handed out, rounded up to their size class
+  size_t allocated_bytes = 0;
+  // Bytes of the freed blocks kept for reuse
+  size_t cached_bytes = 0;
+  // Allocations served from the cache, and from cudaMallocHost
+  size_t hits = 0;
+  size_t misses = 0;
+};
+
+/**
+ * A pinned allocator that keeps the blocks it frees for reuse, since
+ * cudaMallocHost and cudaFreeHost are slow and serialize the driver.
+ *
+ * Sizes are rounded up to size classes, the powers of
+ * --caffe2_pinned_bin_growth from --caffe2_pinned_min_bin to
+ * --caffe2_pinned_max_bin, the same scheme as the cub device pool, and a
+ * freed block serves the next allocation of its class. Larger sizes are not
+ * cached. Freed blocks are released once the cache would exceed
+ * --caffe2_pinned_max_cached_mb.
+ *
+ * Unlike cudaFreeHost, freeing a block does not wait for the device, so as
+ * with the default allocator a tensor must outlive the copies to or from it.
+ *
+ * The pool is shared by all instances. Set --caffe2_cuda_pinned_memory_pool
+ * to use it as the CPU allocator of the process, or install an instance with
+ * CPUAllocatorGuard or Workspace::SetCPUAllocator around the code that
+ * allocates staging tensors.
+ */
+struct CachingPinnedCPUAllocator final : CPUAllocator {
+  CachingPinnedCPUAllocator() {}
+  ~CachingPinnedCPUAllocator() override {}
+  std::pair<void*, MemoryDeleter> New(size_t nbytes) override;
+
+  MemoryDeleter GetDeleter() override {
+    return Delete;
+  }
+
+  static PinnedMemoryPoolStats GetStats();
+  // Releases the cached blocks
+  static void FreeCached();
+
+ private:
+  static void Delete(void* data);
+};
+
 // For simplicity, we will typedef Tensor<CPUContext> to TensorCPU.
 typedef Tensor<CUDAContext> TensorCUDA;
 
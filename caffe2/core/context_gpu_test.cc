@@ -6,6 +6,7 @@
 
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/core/stats.h"
 #include <gtest/gtest.h>
 
 CAFFE2_DECLARE_bool(caffe2_cuda_full_device_control);
@@ -85,6 +86,60 @@ TEST(CUDAContextTest, MemoryPoolAllocateDealloc) {
   }
 }
 
+TEST(CUDAContextTest, MemoryPoolStats) {
+  if (!HasCudaGPU())
+    return;
+  const int nbytes = 1048576;
+  DeviceGuard guard(0);
+  auto first = shared_from_new(CUDAContext::New(nbytes));
+  ResetCudaMemoryPoolPeaks();
+  const auto before = GetCudaMemoryPoolStats(0);
+  EXPECT_GE(before.allocated_bytes, nbytes);
+  EXPECT_EQ(before.peak_allocated_bytes, before.allocated_bytes);
+  auto second = shared_from_new(CUDAContext::New(nbytes));
+  first.reset();
+  second.reset();
+  const auto after = GetCudaMemoryPoolStats(0);
+  EXPECT_EQ(after.allocated_bytes, before.allocated_bytes - nbytes);
+  EXPECT_EQ(after.peak_allocated_bytes, before.allocated_bytes + nbytes);
+  EXPECT_EQ(after.num_allocs, before.num_allocs + 1);
+  if (GetCudaMemoryPoolType() == CudaMemoryPoolType::CUB) {
+    EXPECT_GE(after.cached_bytes, 2 * nbytes);
+    FreeCachedCudaMemory();
+    EXPECT_EQ(GetCudaMemoryPoolStats(0).cached_bytes, 0);
+  }
+  auto exported = toMap(StatRegistry::get().publish());
+  EXPECT_EQ(
+      exported["cuda_memory/gpu0/allocated_bytes"], after.allocated_bytes);
+}
+
+TEST(CUDAContextTest, PinnedMemoryPoolAllocateDealloc) {
+  if (!HasCudaGPU())
+    return;
+  CachingPinnedCPUAllocator allocator;
+  const int nbytes = 100000;
+  auto allocated = shared_from_new(allocator.New(nbytes));
+  EXPECT_NE(allocated, nullptr);
+  cudaPointerAttributes attr;
+  CUDA_ENFORCE(cudaPointerGetAttributes(&attr, allocated.get()));
+  EXPECT_EQ(attr.memoryType, cudaMemoryTypeHost);
+  const auto stats = CachingPinnedCPUAllocator::GetStats();
+  EXPECT_GE(stats.allocated_bytes, nbytes);
+  void* prev_allocated = allocated.get();
+  allocated.reset();
+  // A block of the same size class comes from the pool
+  auto new_allocated = shared_from_new(allocator.New(nbytes + 1));
+  EXPECT_EQ(new_allocated.get(), prev_allocated);
+  EXPECT_EQ(CachingPinnedCPUAllocator::GetStats().hits, stats.hits + 1);
+  auto larger_allocated = shared_from_new(allocator.New(nbytes * 2));
+  EXPECT_NE(larger_allocated.get(), prev_allocated);
+  new_allocated.reset();
+  larger_allocated.reset();
+  EXPECT_GT(CachingPinnedCPUAllocator::GetStats().cached_bytes, 0);
+  CachingPinnedCPUAllocator::FreeCached();
+  EXPECT_EQ(CachingPinnedCPUAllocator::GetStats().cached_bytes, 0);
+}
+
 cudaStream_t getStreamForHandle(cublasHandle_t handle) {
   cudaStream_t stream = nullptr;
   CUBLAS_ENFORCE(cublasGetStream(handle, &stream));
@@ -14,6 +14,18 @@ namespace db {
 
 CAFFE_DEFINE_REGISTRY(Caffe2DBRegistry, DB, const string&, Mode);
 
+int Cursor::NextBatch(int n, string* keys, string* values) {
+  int count = 0;
+  for (; count < n && Valid(); ++count) {
+    if (keys) {
+      keys[count] = key();
+    }
+    values[count] = value();
+    Next();
+  }
+  return count;
+}
+
 // Below, we provide a bare minimum database "minidb" as a reference
 // implementation as well as a portable choice to store data.
 // Note that the MiniDB classes are not exposed via a header file - they should
@@ -79,6 +91,18 @@ class MiniDBCursor : public Cursor {
 
   bool Valid() override { return valid_; }
 
+  int NextBatch(int n, string* keys, string* values) override {
+    int count = 0;
+    for (; count < n && valid_; ++count) {
+      if (keys) {
+        keys[count].assign(key_.data(), key_len_);
+      }
+      values[count].assign(value_.data(), value_len_);
+      Next();
+    }
+    return count;
+  }
+
  private:
   FILE* file_;
   std::lock_guard<std::mutex> lock_;
@@ -108,6 +132,26 @@ class MiniDBTransaction : public Transaction {
         fwrite(value.c_str(), sizeof(char), value_len, file_), value_len);
   }
 
+  void PutStream(
+      const string& key,
+      size_t size,
+      const BlobSerializerBase::ValueWriter& writer) override {
+    // The buffer is kept across values, so it only grows up to the largest
+    // value written
+    if (buffer_.size() < size) {
+      buffer_.resize(size);
+    }
+    writer(buffer_.data());
+    int key_len = key.size();
+    int value_len = size;
+    CAFFE_ENFORCE_EQ(fwrite(&key_len, sizeof(int), 1, file_), 1);
+    CAFFE_ENFORCE_EQ(fwrite(&value_len, sizeof(int), 1, file_), 1);
+    CAFFE_ENFORCE_EQ(
+        fwrite(key.c_str(), sizeof(char), key_len, file_), key_len);
+    CAFFE_ENFORCE_EQ(
+        fwrite(buffer_.data(), sizeof(char), value_len, file_), value_len);
+  }
+
   void Commit() override {
     if (file_ != nullptr) {
       CAFFE_ENFORCE_EQ(fflush(file_), 0);
@@ -118,6 +162,7 @@ class MiniDBTransaction : public Transaction {
  private:
   FILE* file_;
   std::lock_guard<std::mutex> lock_;
+  vector<char> buffer_;
 
   DISABLE_COPY_AND_ASSIGN(MiniDBTransaction);
 };
@@ -169,6 +214,143 @@ class MiniDB : public DB {
 REGISTER_CAFFE2_DB(MiniDB, MiniDB);
 REGISTER_CAFFE2_DB(minidb, MiniDB);
 
+PrefetchingCursor::PrefetchingCursor(
+    std::unique_ptr<Cursor> cursor,
+    int capacity)
+    : cursor_(std::move(cursor)) {
+  CAFFE_ENFORCE(cursor_, "Passed null cursor");
+  CAFFE_ENFORCE_GT(capacity, 0);
+  buffer_.resize(capacity);
+  Start();
+}
+
+PrefetchingCursor::~PrefetchingCursor() {
+  Stop();
+}
+
+void PrefetchingCursor::Seek(const string& key) {
+  Stop();
+  cursor_->Seek(key);
+  Start();
+}
+
+void PrefetchingCursor::SeekToFirst() {
+  Stop();
+  cursor_->SeekToFirst();
+  Start();
+}
+
+void PrefetchingCursor::Next() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CAFFE_ENFORCE(WaitForFront(lock), "Cursor is at invalid location!");
+  head_ = (head_ + 1) % buffer_.size();
+  --size_;
+  not_full_.notify_one();
+}
+
+string PrefetchingCursor::key() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CAFFE_ENFORCE(WaitForFront(lock), "Cursor is at invalid location!");
+  return buffer_[head_].first;
+}
+
+string PrefetchingCursor::value() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CAFFE_ENFORCE(WaitForFront(lock), "Cursor is at invalid location!");
+  return buffer_[head_].second;
+}
+
+bool PrefetchingCursor::Valid() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return WaitForFront(lock);
+}
+
+int PrefetchingCursor::NextBatch(int n, string* keys, string* values) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int count = 0;
+  // The records are swapped out of the buffer, the read-ahead overwrites
+  // the strings it gets back
+  while (count < n && WaitForFront(lock)) {
+    auto& record = buffer_[head_];
+    if (keys) {
+      std::swap(keys[count], record.first);
+    }
+    std::swap(values[count], record.second);
+    head_ = (head_ + 1) % buffer_.size();
+    --size_;
+    ++count;
+    not_full_.notify_one();
+  }
+  return count;
+}
+
+bool PrefetchingCursor::WaitForFront(std::unique_lock<std::mutex>& lock) {
+  not_empty_.wait(lock, [this] { return size_ > 0 || done_; });
+  if (size_ == 0 && error_) {
+    std::rethrow_exception(error_);
+  }
+  return size_ > 0;
+}
+
+void PrefetchingCursor::Start() {
+  head_ = 0;
+  size_ = 0;
+  done_ = false;
+  stop_ = false;
+  error_ = nullptr;
+  thread_ = std::thread(&PrefetchingCursor::PrefetchLoop, this);
+}
+
+void PrefetchingCursor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  not_full_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void PrefetchingCursor::PrefetchLoop() {
+  try {
+    while (true) {
+      size_t tail;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(
+            lock, [this] { return stop_ || size_ < buffer_.size(); });
+        if (stop_) {
+          return;
+        }
+        tail = (head_ + size_) % buffer_.size();
+      }
+      // Only this thread touches the underlying cursor while it runs, and
+      // the slot past the last buffered record is not read by the consumer.
+      if (!cursor_->Valid()) {
+        break;
+      }
+      auto& slot = buffer_[tail];
+      slot.first = cursor_->key();
+      slot.second = cursor_->value();
+      cursor_->Next();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++size_;
+      }
+      not_empty_.notify_one();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = std::current_exception();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_ = true;
+  }
+  not_empty_.notify_all();
+}
+
 void DBReaderSerializer::Serialize(
     const Blob& blob,
     const string& name,
@@ -1,7 +1,10 @@
 #ifndef CAFFE2_CORE_DB_H_
 #define CAFFE2_CORE_DB_H_
 
+#include <condition_variable>
+#include <exception>
 #include <mutex>
+#include <thread>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/registry.h"
@@ -16,6 +19,44 @@ namespace db {
  */
 enum Mode { READ, WRITE, NEW };
 
+/**
+ * A read-only view of a value that stays valid for as long as the view or a
+ * copy of it exists, independently of the cursor it came from. Dbs that
+ * receive values into buffers of their own, e.g. network messages, hand out
+ * views of these buffers so that consumers can parse them without copying.
+ */
+class ValueView {
+ public:
+  ValueView() {}
+  ValueView(
+      const char* data,
+      size_t size,
+      std::shared_ptr<const void> holder)
+      : data_(data), size_(size), holder_(std::move(holder)) {}
+  explicit ValueView(string value) {
+    auto holder = std::make_shared<const string>(std::move(value));
+    data_ = holder->data();
+    size_ = holder->size();
+    holder_ = std::move(holder);
+  }
+
+  const char* data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+  string ToString() const {
+    return string(data_, size_);
+  }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  // Keeps the storage of data_ alive
+  std::shared_ptr<const void> holder_;
+};
+
 /**
  * An abstract class for the cursor of the database while reading.
  */
@@ -51,6 +92,28 @@ class Cursor {
    * reached the end of the database, return false.
    */
   virtual bool Valid() = 0;
+  /**
+   * Reads up to n records starting at the current location and moves past
+   * them, so that a batch costs a single virtual call. keys and values point
+   * to arrays of at least n strings that are overwritten in place, which lets
+   * callers reuse their storage across batches; keys can be nullptr if the
+   * caller does not need them. Returns the number of records read, which is
+   * less than n only if the end of the database is reached.
+   *
+   * The default implementation goes through key(), value() and Next().
+   */
+  virtual int NextBatch(int n, string* keys, string* values);
+  /**
+   * Returns a view of the current value. SupportsValueView() returns whether
+   * the db hands out views of its own buffers; in default, the view owns a
+   * copy of value().
+   */
+  virtual ValueView value_view() {
+    return ValueView(value());
+  }
+  virtual bool SupportsValueView() {
+    return false;
+  }
 
   DISABLE_COPY_AND_ASSIGN(Cursor);
 };
@@ -66,6 +129,20 @@ class Transaction {
    * Puts the key value pair to the database.
    */
   virtual void Put(const string& key, const string& value) = 0;
+  /**
+   * Puts a value of the given size that is written by writer into a buffer
+   * provided by the transaction. Backends that can hand out (or reuse) their
+   * write buffer override this, so that large values are written without a
+   * temporary string. The default implementation goes through a string.
+   */
+  virtual void PutStream(
+      const string& key,
+      size_t size,
+      const BlobSerializerBase::ValueWriter& writer) {
+    string value(size, '\0');
+    writer(&value[0]);
+    Put(key, value);
+  }
   /**
    * Commits the current writes.
    */
@@ -121,6 +198,88 @@ inline unique_ptr<DB> CreateDB(
   return result;
 }
 
+/**
+ * A cursor that reads ahead up to a fixed number of records of another cursor
+ * on a background thread, so that the reader only waits on the storage when
+ * the buffer runs dry. Works with any cursor; seeking drops the buffered
+ * records and restarts the read-ahead from the new location.
+ */
+class PrefetchingCursor : public Cursor {
+ public:
+  PrefetchingCursor(std::unique_ptr<Cursor> cursor, int capacity);
+  ~PrefetchingCursor() override;
+
+  void Seek(const string& key) override;
+  bool SupportsSeek() override {
+    return cursor_->SupportsSeek();
+  }
+  void SeekToFirst() override;
+  void Next() override;
+  string key() override;
+  string value() override;
+  bool Valid() override;
+  int NextBatch(int n, string* keys, string* values) override;
+
+ private:
+  void Start();
+  void Stop();
+  void PrefetchLoop();
+  // Blocks until the front record is prefetched or the end is reached.
+  // Rethrows the error of the background read, if any.
+  bool WaitForFront(std::unique_lock<std::mutex>& lock);
+
+  std::unique_ptr<Cursor> cursor_;
+  std::vector<std::pair<string, string>> buffer_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  bool done_ = false;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::thread thread_;
+};
+
+/**
+ * Wraps the cursors of a database opened for reading in PrefetchingCursor.
+ */
+class PrefetchingDB : public DB {
+ public:
+  PrefetchingDB(std::unique_ptr<DB> db, int prefetch_records)
+      : DB("", READ), db_(std::move(db)), prefetch_records_(prefetch_records) {}
+
+  void Close() override {
+    db_->Close();
+  }
+  std::unique_ptr<Cursor> NewCursor() override {
+    return make_unique<PrefetchingCursor>(db_->NewCursor(), prefetch_records_);
+  }
+  std::unique_ptr<Transaction> NewTransaction() override {
+    return db_->NewTransaction();
+  }
+
+ private:
+  std::unique_ptr<DB> db_;
+  int prefetch_records_;
+};
+
+/**
+ * Same as above, but if prefetch_records is positive, cursors of a database
+ * opened in READ mode read ahead that many records in the background.
+ */
+inline unique_ptr<DB> CreateDB(
+    const string& db_type,
+    const string& source,
+    Mode mode,
+    int prefetch_records) {
+  auto result = CreateDB(db_type, source, mode);
+  if (result && mode == READ && prefetch_records > 0) {
+    result.reset(new PrefetchingDB(std::move(result), prefetch_records));
+  }
+  return result;
+}
+
 /**
  * Returns whether or not a database exists given the database type and path.
  */
@@ -151,8 +310,9 @@ class DBReader {
       const string& db_type,
       const string& source,
       const int32_t num_shards = 1,
-      const int32_t shard_id = 0) {
-    Open(db_type, source, num_shards, shard_id);
+      const int32_t shard_id = 0,
+      const int prefetch_records = 0) {
+    Open(db_type, source, num_shards, shard_id, prefetch_records);
   }
 
   explicit DBReader(const DBReaderProto& proto) {
@@ -179,14 +339,15 @@ class DBReader {
       const string& db_type,
       const string& source,
       const int32_t num_shards = 1,
-      const int32_t shard_id = 0) {
+      const int32_t shard_id = 0,
+      const int prefetch_records = 0) {
     // Note(jiayq): resetting is needed when we re-open e.g. leveldb where no
     // concurrent access is allowed.
     cursor_.reset();
     db_.reset();
     db_type_ = db_type;
     source_ = source;
-    db_ = CreateDB(db_type_, source_, READ);
+    db_ = CreateDB(db_type_, source_, READ, prefetch_records);
     CAFFE_ENFORCE(db_, "Cannot open db: ", source_, " of type ", db_type_);
     InitializeCursor(num_shards, shard_id);
   }
@@ -235,6 +396,68 @@ class DBReader {
     }
   }
 
+  /**
+   * Reads the next n records, see Read(). Thread safe.
+   *
+   * The vectors are resized to n and their strings are overwritten, so
+   * passing the same vectors for every batch avoids reallocating them. keys
+   * can be nullptr if the keys are not needed.
+   */
+  void ReadBatch(int n, vector<string>* keys, vector<string>* values) const {
+    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
+    if (keys) {
+      keys->resize(n);
+    }
+    values->resize(n);
+    std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
+    int num_read = 0;
+    while (num_read < n) {
+      // In sharded mode, records are read one at a time and the records of
+      // the other shards are skipped in between
+      const int count = cursor_->NextBatch(
+          num_shards_ == 1 ? n - num_read : 1,
+          keys ? keys->data() + num_read : nullptr,
+          values->data() + num_read);
+      CAFFE_ENFORCE_GT(count, 0, "No records to read in db: ", source_);
+      num_read += count;
+      for (int s = 1; s < num_shards_ && cursor_->Valid(); s++) {
+        cursor_->Next();
+      }
+      if (!cursor_->Valid()) {
+        MoveToBeginning();
+      }
+    }
+  }
+
+  /**
+   * Reads the values of the next n records as views, see Read(). Thread
+   * safe. The views keep the buffers of the db alive until they are
+   * released, so callers should clear them once the values are parsed.
+   */
+  void ReadViews(int n, vector<ValueView>* values) const {
+    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
+    values->resize(n);
+    std::unique_lock<std::mutex> mutex_lock(reader_mutex_);
+    for (int i = 0; i < n; ++i) {
+      (*values)[i] = cursor_->value_view();
+      for (int s = 0; s < num_shards_; s++) {
+        cursor_->Next();
+        if (!cursor_->Valid()) {
+          MoveToBeginning();
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * Returns whether ReadViews() avoids copying the values.
+   */
+  bool SupportsValueView() const {
+    CAFFE_ENFORCE(cursor_ != nullptr, "Reader not initialized.");
+    return cursor_->SupportsValueView();
+  }
+
   /**
    * @brief Seeks to the first key. Thread safe.
    */
@@ -135,6 +135,11 @@ struct Graph {
     return external_output_;
   }
 
+  // The NetDef the graph was generated from
+  inline const NetDef& netdef() const {
+    return netdef_;
+  }
+
  private:
   const std::vector<std::pair<string, int>> GetSubgraphPerimeterHelper(
       bool from_children,
@@ -0,0 +1,232 @@
+#include "caffe2/core/mapped_tensor_file.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace caffe2 {
+
+constexpr size_t MappedTensorFile::kAlignment;
+
+namespace {
+const char kMagic[8] = {'C', '2', 'M', 'A', 'P', 'T', 'N', 'S'};
+const uint32_t kVersion = 1;
+
+size_t alignUp(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void append(std::string* out, const T& value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Bounds checked reads of the mapped header and index
+class Reader {
+ public:
+  Reader(const char* data, size_t size, const std::string& path)
+      : data_(data), size_(size), pos_(0), path_(path) {}
+
+  template <typename T>
+  T read() {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  std::string readString(size_t length) {
+    return std::string(take(length), length);
+  }
+
+ private:
+  const char* take(size_t n) {
+    CAFFE_ENFORCE_LE(pos_ + n, size_, "Truncated tensor file: ", path_);
+    const char* ptr = data_ + pos_;
+    pos_ += n;
+    return ptr;
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+  const std::string& path_;
+};
+} // namespace
+
+void MappedTensorFile::Write(
+    const std::string& path,
+    const std::vector<std::pair<std::string, const TensorCPU*>>& tensors,
+    size_t alignment) {
+  CAFFE_ENFORCE(
+      alignment > 0 && alignment % kAlignment == 0,
+      "Alignment has to be a multiple of ",
+      kAlignment,
+      ", got ",
+      alignment);
+  std::string index;
+  std::vector<size_t> offsets;
+  // Index entries have variable size, so the data offsets are computed
+  // once the size of the index is known
+  size_t index_size = 0;
+  for (const auto& kv : tensors) {
+    index_size += sizeof(uint32_t) + kv.first.size() + sizeof(int32_t) +
+        sizeof(uint32_t) + kv.second->ndim() * sizeof(int64_t) +
+        2 * sizeof(uint64_t);
+  }
+  const size_t header_size = sizeof(kMagic) + 2 * sizeof(uint32_t) +
+      sizeof(uint64_t);
+  size_t offset = alignUp(header_size + index_size, alignment);
+  const size_t data_offset = offset;
+
+  for (const auto& kv : tensors) {
+    const auto& tensor = *kv.second;
+    CAFFE_ENFORCE(
+        !tensor.meta().ctor(),
+        "Only tensors of fundamental types can be mapped: ",
+        kv.first);
+    const auto data_type = TypeMetaToDataType(tensor.meta());
+    CAFFE_ENFORCE(
+        data_type != TensorProto_DataType_UNDEFINED,
+        "Unsupported tensor type ",
+        tensor.meta().name(),
+        " of ",
+        kv.first);
+    append<uint32_t>(&index, kv.first.size());
+    index.append(kv.first);
+    append<int32_t>(&index, data_type);
+    append<uint32_t>(&index, tensor.ndim());
+    for (auto d : tensor.dims()) {
+      append<int64_t>(&index, d);
+    }
+    append<uint64_t>(&index, offset);
+    append<uint64_t>(&index, tensor.nbytes());
+    offsets.push_back(offset);
+    offset = alignUp(offset + tensor.nbytes(), alignment);
+  }
+  CAFFE_ENFORCE_EQ(index.size(), index_size);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  CAFFE_ENFORCE(out.good(), "Cannot open file for writing: ", path);
+  std::string header(kMagic, sizeof(kMagic));
+  append<uint32_t>(&header, kVersion);
+  append<uint32_t>(&header, tensors.size());
+  append<uint64_t>(&header, data_offset);
+  out.write(header.data(), header.size());
+  out.write(index.data(), index.size());
+
+  size_t written = header.size() + index.size();
+  const std::string padding(alignment, '\0');
+  for (int i = 0; i < tensors.size(); ++i) {
+    const auto& tensor = *tensors[i].second;
+    out.write(padding.data(), offsets[i] - written);
+    if (tensor.nbytes() > 0) {
+      out.write(static_cast<const char*>(tensor.raw_data()), tensor.nbytes());
+    }
+    written = offsets[i] + tensor.nbytes();
+  }
+  out.close();
+  CAFFE_ENFORCE(!out.fail(), "Failed to write tensor file: ", path);
+}
+
+#ifndef _WIN32
+
+std::shared_ptr<MappedTensorFile> MappedTensorFile::Open(
+    const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CAFFE_ENFORCE_GE(fd, 0, "Cannot open tensor file: ", path);
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    CAFFE_THROW("Cannot stat tensor file: ", path);
+  }
+  const size_t size = st.st_size;
+  void* data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  // The mapping keeps the file referenced
+  close(fd);
+  CAFFE_ENFORCE(
+      data && data != MAP_FAILED, "Cannot map tensor file: ", path);
+
+  std::shared_ptr<MappedTensorFile> file(new MappedTensorFile(data, size));
+  file->self_ = file;
+
+  Reader reader(static_cast<const char*>(data), size, path);
+  CAFFE_ENFORCE(
+      reader.readString(sizeof(kMagic)) == std::string(kMagic, sizeof(kMagic)),
+      "Not a mapped tensor file: ",
+      path);
+  const auto version = reader.read<uint32_t>();
+  CAFFE_ENFORCE_EQ(version, kVersion, "Unsupported tensor file version");
+  const auto num_entries = reader.read<uint32_t>();
+  reader.read<uint64_t>(); // offset of the data, only useful to writers
+  file->entries_.reserve(num_entries);
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    Entry entry;
+    entry.name = reader.readString(reader.read<uint32_t>());
+    entry.meta = DataTypeToTypeMeta(
+        static_cast<TensorProto::DataType>(reader.read<int32_t>()));
+    const auto ndim = reader.read<uint32_t>();
+    size_t numel = 1;
+    for (uint32_t d = 0; d < ndim; ++d) {
+      entry.dims.push_back(reader.read<int64_t>());
+      numel *= entry.dims.back();
+    }
+    entry.offset = reader.read<uint64_t>();
+    entry.nbytes = reader.read<uint64_t>();
+    CAFFE_ENFORCE_EQ(
+        entry.nbytes,
+        numel * entry.meta.itemsize(),
+        "Inconsistent size of ",
+        entry.name);
+    CAFFE_ENFORCE(
+        entry.offset % kAlignment == 0 && entry.offset <= size &&
+            entry.nbytes <= size - entry.offset,
+        "Invalid data offset of ",
+        entry.name,
+        " in ",
+        path);
+    file->entries_.push_back(std::move(entry));
+  }
+  return file;
+}
+
+MappedTensorFile::~MappedTensorFile() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+#else // _WIN32
+
+std::shared_ptr<MappedTensorFile> MappedTensorFile::Open(
+    const std::string& path) {
+  CAFFE_THROW("Mapped tensor files are not supported on this platform");
+}
+
+MappedTensorFile::~MappedTensorFile() {}
+
+#endif // _WIN32
+
+void MappedTensorFile::Bind(const Entry& entry, TensorCPU* tensor) const {
+  auto self = self_.lock();
+  CAFFE_ENFORCE(self, "Tensor file has to be opened with Open()");
+  tensor->Resize(entry.dims);
+  tensor->ShareExternalPointer(
+      static_cast<char*>(data_) + entry.offset,
+      entry.meta,
+      entry.nbytes,
+      [self](void* /* unused */) {});
+}
+
+} // namespace caffe2
@@ -0,0 +1,83 @@
+#ifndef CAFFE2_CORE_MAPPED_TENSOR_FILE_H_
+#define CAFFE2_CORE_MAPPED_TENSOR_FILE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+/**
+ * A flat file of CPU tensors that can be memory-mapped and used in place.
+ *
+ * Layout (little endian, native type sizes):
+ *   header:  magic "C2MAPTNS", uint32 version, uint32 number of entries,
+ *            uint64 offset of the first tensor's data
+ *   index:   for every entry, uint32 name length, name, int32 data type
+ *            (TensorProto::DataType), uint32 number of dims, int64 dims,
+ *            uint64 data offset, uint64 data size in bytes
+ *   data:    tensor contents, every tensor starts at a multiple of the
+ *            alignment given to Write (kAlignment by default) from the
+ *            beginning of the file
+ *
+ * Only tensors of fundamental types (everything but strings and other
+ * non-POD types) can be stored.
+ */
+class MappedTensorFile {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  struct Entry {
+    std::string name;
+    std::vector<TIndex> dims;
+    TypeMeta meta;
+    size_t offset;
+    size_t nbytes;
+  };
+
+  // Maps the file read-only; the mapping stays alive for as long as the
+  // returned object or any tensor bound to it exists.
+  static std::shared_ptr<MappedTensorFile> Open(const std::string& path);
+
+  // alignment has to be a multiple of kAlignment. Aligning the tensors to
+  // pages keeps every page of the file in a single tensor, so that the
+  // pages of the tensors that are never read are never loaded.
+  static void Write(
+      const std::string& path,
+      const std::vector<std::pair<std::string, const TensorCPU*>>& tensors,
+      size_t alignment = kAlignment);
+
+  ~MappedTensorFile();
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+
+  // Makes the tensor use the mapped data without copying. The data is
+  // read-only: writing to it through the tensor (e.g. mutable_data of the
+  // same type and size) crashes, resizing it reallocates.
+  void Bind(const Entry& entry, TensorCPU* tensor) const;
+
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  MappedTensorFile(void* data, size_t size) : data_(data), size_(size) {}
+
+  void* data_;
+  size_t size_;
+  std::vector<Entry> entries_;
+  // Bound tensors keep the mapping alive through their deleters
+  std::weak_ptr<MappedTensorFile> self_;
+
+  DISABLE_COPY_AND_ASSIGN(MappedTensorFile);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_MAPPED_TENSOR_FILE_H_
@@ -0,0 +1,119 @@
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "caffe2/core/mapped_tensor_file.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+std::string TempFileName() {
+  char name[] = "/tmp/mapped_tensor_file_test_XXXXXX";
+  int fd = mkstemp(name);
+  CAFFE_ENFORCE_GE(fd, 0);
+  close(fd);
+  return name;
+}
+
+} // namespace
+
+TEST(MappedTensorFileTest, RoundTrip) {
+  TensorCPU floats(vector<TIndex>{2, 3});
+  for (int i = 0; i < floats.size(); ++i) {
+    floats.mutable_data<float>()[i] = i * 0.5f;
+  }
+  TensorCPU ints(vector<TIndex>{5});
+  for (int i = 0; i < ints.size(); ++i) {
+    ints.mutable_data<int64_t>()[i] = -i;
+  }
+  TensorCPU empty(vector<TIndex>{0, 4});
+  empty.mutable_data<uint8_t>();
+
+  const auto path = TempFileName();
+  MappedTensorFile::Write(
+      path, {{"floats", &floats}, {"ints", &ints}, {"empty", &empty}});
+
+  TensorCPU loaded_floats;
+  TensorCPU loaded_ints;
+  {
+    auto file = MappedTensorFile::Open(path);
+    ASSERT_EQ(3, file->entries().size());
+    for (const auto& entry : file->entries()) {
+      EXPECT_EQ(0, entry.offset % MappedTensorFile::kAlignment);
+    }
+    const auto& entry = file->entries()[0];
+    EXPECT_EQ("floats", entry.name);
+    EXPECT_EQ(vector<TIndex>({2, 3}), entry.dims);
+    EXPECT_TRUE(entry.meta.Match<float>());
+
+    file->Bind(file->entries()[0], &loaded_floats);
+    file->Bind(file->entries()[1], &loaded_ints);
+    TensorCPU loaded_empty;
+    file->Bind(file->entries()[2], &loaded_empty);
+    EXPECT_EQ(vector<TIndex>({0, 4}), loaded_empty.dims());
+    EXPECT_TRUE(loaded_empty.IsType<uint8_t>());
+  }
+  // The tensors keep the file mapped after the file object is gone, the
+  // data is used in place
+  std::remove(path.c_str());
+  EXPECT_EQ(floats.dims(), loaded_floats.dims());
+  EXPECT_EQ(
+      0,
+      reinterpret_cast<uintptr_t>(loaded_floats.raw_data()) %
+          MappedTensorFile::kAlignment);
+  for (int i = 0; i < floats.size(); ++i) {
+    EXPECT_EQ(floats.data<float>()[i], loaded_floats.data<float>()[i]);
+  }
+  ASSERT_TRUE(loaded_ints.IsType<int64_t>());
+  for (int i = 0; i < ints.size(); ++i) {
+    EXPECT_EQ(ints.data<int64_t>()[i], loaded_ints.data<int64_t>()[i]);
+  }
+}
+
+TEST(MappedTensorFileTest, PageAligned) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  TensorCPU a(vector<TIndex>{3});
+  TensorCPU b(vector<TIndex>{static_cast<TIndex>(page_size) + 1});
+  for (int i = 0; i < a.size(); ++i) {
+    a.mutable_data<float>()[i] = i;
+  }
+  for (int i = 0; i < b.size(); ++i) {
+    b.mutable_data<uint8_t>()[i] = i % 7;
+  }
+  const auto path = TempFileName();
+  MappedTensorFile::Write(path, {{"a", &a}, {"b", &b}}, page_size);
+  auto file = MappedTensorFile::Open(path);
+  std::remove(path.c_str());
+  ASSERT_EQ(2, file->entries().size());
+  TensorCPU loaded_b;
+  file->Bind(file->entries()[1], &loaded_b);
+  for (const auto& entry : file->entries()) {
+    EXPECT_EQ(0, entry.offset % page_size);
+  }
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(loaded_b.raw_data()) % page_size);
+  for (int i = 0; i < b.size(); ++i) {
+    EXPECT_EQ(b.data<uint8_t>()[i], loaded_b.data<uint8_t>()[i]);
+  }
+  ASSERT_THROW(
+      MappedTensorFile::Write(path, {{"a", &a}}, 100), EnforceNotMet);
+}
+
+TEST(MappedTensorFileTest, RejectsInvalidFiles) {
+  const auto path = TempFileName();
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << "NOTATENSORFILE";
+  }
+  ASSERT_THROW(MappedTensorFile::Open(path), EnforceNotMet);
+
+  TensorCPU strings(vector<TIndex>{1});
+  strings.mutable_data<std::string>();
+  ASSERT_THROW(
+      MappedTensorFile::Write(path, {{"strings", &strings}}), EnforceNotMet);
+  std::remove(path.c_str());
+}
+
+} // namespace caffe2
@@ -1,8 +1,15 @@
 #include "caffe2/core/memonger.h"
 
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
+#include "caffe2/core/allocator.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/operator_schema.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/types.h"
 #include "caffe2/utils/proto_utils.h"
 
 namespace caffe2 {
@@ -137,7 +144,8 @@ class ComputeBlobRecyclingForDag {
       const std::unordered_set<string>& shareable_blob_names,
       const string& namescope,
       const std::unordered_set<string>& dont_share_blob_names,
-      const std::unordered_map<string, vector<int>>& blob_shapes) {
+      const std::unordered_map<string, vector<int>>& blob_shapes,
+      BlobRecyclingStats* stats) {
     // Construct the set of input blobs.
     std::unordered_set<string> heads_blobs_set(heads.begin(), heads.end());
 
@@ -201,6 +209,15 @@ class ComputeBlobRecyclingForDag {
       }
     }
 
+    if (blob_shapes.size() > 0) {
+      compute_stats(
+          net, op_indices, shareable_blob_names, blob_shapes, stats);
+      LOG(INFO) << "Memonger shares " << stats->unshared_size
+                << " elements of activations in " << stats->shared_size
+                << " elements, " << stats->peak_live_size
+                << " being alive at once at peak.";
+    }
+
     // Rename mapped blobs.
     std::unordered_map<string, string> renamed;
     int name_idx = 0;
@@ -235,9 +252,9 @@ class ComputeBlobRecyclingForDag {
     NetDef optimized_net = apply_assignments(net);
     LOG(INFO) << "Remapping " << mapping_.size() << " using "
               << mapped_blobs_set.size() << " shared blobs.";
-    if (floats_saved_ > 0) {
+    if (elements_saved_ > 0) {
       LOG(INFO) << "Memonger saved approximately : "
-                << (floats_saved_ * 4.0 / 1024.0 / 1024.0) << " MB.";
+                << (elements_saved_ * 4.0 / 1024.0 / 1024.0) << " MB.";
     }
 
     return optimized_net;
@@ -448,14 +465,60 @@ class ComputeBlobRecyclingForDag {
     }
   }
 
-  inline int infer_blob_size(
+  // Sizes of the shareable outputs before and after sharing, and the peak of
+  // the sizes of those alive at once when the ops run in op_indices order.
+  void compute_stats(
+      const NetDef& net,
+      const std::vector<int>& op_indices,
+      const std::unordered_set<string>& shareable_blob_names,
+      const std::unordered_map<string, vector<int>>& blob_shapes,
+      BlobRecyclingStats* stats) {
+    // Position in op_indices of the first write and of the last read
+    std::unordered_map<string, std::pair<int, int>> ranges;
+    for (int pos = 0; pos < op_indices.size(); ++pos) {
+      const auto& op = net.op(op_indices[pos]);
+      for (const auto& input : op.input()) {
+        auto it = ranges.find(input);
+        if (it != ranges.end()) {
+          it->second.second = pos;
+        }
+      }
+      for (const auto& output : op.output()) {
+        if (has_key(shareable_blob_names, output) && !has_key(ranges, output)) {
+          ranges[output] = std::make_pair(pos, pos);
+        }
+      }
+    }
+
+    std::unordered_map<string, TIndex> shared_sizes;
+    std::vector<TIndex> live_delta(op_indices.size() + 1, 0);
+    for (const auto& range : ranges) {
+      const TIndex size = infer_blob_size(range.first, blob_shapes);
+      stats->unshared_size += size;
+      TIndex& shared_size =
+          shared_sizes[get_blob_or_mapped_blob(range.first)];
+      shared_size = std::max(shared_size, size);
+      live_delta[range.second.first] += size;
+      live_delta[range.second.second + 1] -= size;
+    }
+    for (const auto& shared_size : shared_sizes) {
+      stats->shared_size += shared_size.second;
+    }
+    TIndex live = 0;
+    for (const TIndex delta : live_delta) {
+      live += delta;
+      stats->peak_live_size = std::max(stats->peak_live_size, live);
+    }
+  }
+
+  inline TIndex infer_blob_size(
       const string& blob_name,
       const std::unordered_map<string, vector<int>>& blob_shapes) {
     const auto& blob_shapes_iter = blob_shapes.find(blob_name);
     if (blob_shapes_iter == blob_shapes.end()) {
       return 0;
     }
-    int size = 1;
+    TIndex size = 1;
     for (int i = 0; i < blob_shapes_iter->second.size(); ++i) {
       size *= blob_shapes_iter->second[i];
     }
@@ -521,27 +584,28 @@ class ComputeBlobRecyclingForDag {
             std::greater<std::pair<int, string>>());
       }
     } else {
-      // Heuristic to choose the largest blob to fit output thats
-      // slightly less than blob_size.
-      const int blob_size = infer_blob_size(blob_name, blob_shapes);
-      int best_size = -1;
+      // Best fit: the smallest free blob that can hold the output, or else
+      // the largest one, which then grows to the size of the output.
+      const TIndex blob_size = infer_blob_size(blob_name, blob_shapes);
+      TIndex best_size = -1;
       int free_blob_index = -1;
       for (int i = 0; i < free_blobs->size(); ++i) {
         const string& cb_name = (*free_blobs)[i].second;
         if (can_use_blob(cb_name, tokens, device)) {
-          const int cand_bz = blob_sizes_[cb_name];
           CAFFE_ENFORCE(blob_sizes_.find(cb_name) != blob_sizes_.end());
-          if (cand_bz >= best_size) {
-            if (best_size < blob_size || best_size >= cand_bz) {
-              best_size = cand_bz;
-              free_blob_index = i;
-            }
+          const TIndex cand_bz = blob_sizes_[cb_name];
+          const bool best_fits = best_size >= blob_size;
+          if (cand_bz >= blob_size ? !best_fits || cand_bz < best_size
+                                   : !best_fits && cand_bz > best_size) {
+            best_size = cand_bz;
+            free_blob_index = i;
           }
         }
       }
       if (free_blob_index != -1) {
-        floats_saved_ += best_size;
+        elements_saved_ += std::min(best_size, blob_size);
         freed_blob = (*free_blobs)[free_blob_index].second;
+        blob_sizes_[freed_blob] = std::max(best_size, blob_size);
         free_blobs->erase(free_blobs->begin() + free_blob_index);
       }
     }
@@ -549,7 +613,7 @@ class ComputeBlobRecyclingForDag {
   };
 
   int tokens_counter_ = 1;
-  int floats_saved_ = 0;
+  TIndex elements_saved_ = 0;
   // blob_name -> Op edges.
   std::unordered_map<string, std::vector<int>> blob_to_ops_;
   // Current Op in degree.
@@ -559,7 +623,8 @@ class ComputeBlobRecyclingForDag {
   // Current Op visit counts.
   std::vector<int> op_visited_count_;
   std::unordered_map<string, int> share_counts_;
-  std::unordered_map<string, int> blob_sizes_;
+  // Size of the free blobs, which is the largest size of the blobs they hold.
+  std::unordered_map<string, TIndex> blob_sizes_;
   std::unordered_map<string, std::unordered_set<int>> req_tokens_;
   std::vector<std::unordered_set<int>> op_token_deposit_;
   std::unordered_set<string> optim_op_outputs_;
@@ -577,7 +642,13 @@ NetDef compute_blob_recycling_for_dag(
     const std::unordered_set<string>& shareable_blob_names,
     const string& namescope,
     const std::unordered_set<string>& dont_share_blob_names,
-    const std::unordered_map<string, vector<int>>& blob_shapes) {
+    const std::unordered_map<string, vector<int>>& blob_shapes,
+    BlobRecyclingStats* stats) {
+  BlobRecyclingStats local_stats;
+  if (!stats) {
+    stats = &local_stats;
+  }
+  *stats = BlobRecyclingStats();
   ComputeBlobRecyclingForDag memonger(net.op_size());
   return memonger.OptimizeNet(
       net,
@@ -586,7 +657,630 @@ NetDef compute_blob_recycling_for_dag(
       shareable_blob_names,
       namescope,
       dont_share_blob_names,
-      blob_shapes);
+      blob_shapes,
+      stats);
+}
+
+namespace {
+
+size_t alignedSize(size_t nbytes) {
+  return (nbytes + gCaffe2Alignment - 1) / gCaffe2Alignment * gCaffe2Alignment;
+}
+
+bool lifetimesOverlap(
+    const StaticMemoryPlan::Block& a,
+    const StaticMemoryPlan::Block& b) {
+  // An op may not write an output into the memory of its own inputs, so
+  // lifetimes ending and starting at the same op do overlap
+  return a.first_op <= b.last_op && b.first_op <= a.last_op;
+}
+
+} // namespace
+
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes) {
+  CAFFE_ENFORCE(
+      net.type() == "" || net.type() == "simple",
+      "Static memory planning requires sequential execution, net type: ",
+      net.type());
+
+  std::unordered_map<string, const TensorShape*> shape_map;
+  for (const auto& shape : shapes.shapes()) {
+    shape_map[shape.name()] = &shape;
+  }
+  std::set<string> excluded(static_blobs);
+  for (const auto& name : net.external_input()) {
+    excluded.insert(name);
+  }
+
+  // Step 1: compute the lifetime of every activation
+  std::vector<StaticMemoryPlan::Block> blocks;
+  std::unordered_map<string, int> block_index;
+  for (int i = 0; i < net.op_size(); i++) {
+    const auto& op = net.op(i);
+    for (const auto& inp : op.input()) {
+      auto it = block_index.find(inp);
+      if (it != block_index.end()) {
+        blocks[it->second].last_op = i;
+      }
+    }
+    for (const auto& outp : op.output()) {
+      auto it = block_index.find(outp);
+      if (it != block_index.end()) {
+        blocks[it->second].last_op = i;
+        continue;
+      }
+      if (excluded.count(outp)) {
+        continue;
+      }
+      auto sit = shape_map.find(outp);
+      if (sit == shape_map.end() || sit->second->unknown_shape()) {
+        VLOG(1) << "Shape of " << outp << " unknown, not planned";
+        excluded.insert(outp);
+        continue;
+      }
+      const auto& shape = *sit->second;
+      const auto& meta = DataTypeToTypeMeta(shape.data_type());
+      if (meta.ctor() || meta.itemsize() == 0) {
+        excluded.insert(outp);
+        continue;
+      }
+      StaticMemoryPlan::Block block;
+      block.blob = outp;
+      block.offset = 0;
+      block.first_op = i;
+      block.last_op = i;
+      block.meta = meta;
+      TIndex size = 1;
+      for (auto d : shape.dims()) {
+        block.dims.push_back(d);
+        size *= d;
+      }
+      block.nbytes = alignedSize(size * meta.itemsize());
+      block_index[outp] = blocks.size();
+      blocks.push_back(block);
+    }
+  }
+  for (const auto& name : net.external_output()) {
+    auto it = block_index.find(name);
+    if (it != block_index.end()) {
+      blocks[it->second].last_op = net.op_size();
+    }
+  }
+
+  // Step 2: place the biggest blocks first, each one into the smallest gap
+  // left by the already placed blocks with overlapping lifetimes
+  std::vector<int> order(blocks.size());
+  for (int i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return blocks[a].nbytes > blocks[b].nbytes;
+  });
+
+  StaticMemoryPlan plan;
+  std::vector<const StaticMemoryPlan::Block*> placed;
+  for (int idx : order) {
+    auto& block = blocks[idx];
+    std::vector<std::pair<size_t, size_t>> used;
+    for (const auto* other : placed) {
+      if (lifetimesOverlap(block, *other)) {
+        used.emplace_back(other->offset, other->offset + other->nbytes);
+      }
+    }
+    std::sort(used.begin(), used.end());
+
+    size_t best_offset = 0;
+    size_t best_gap = std::numeric_limits<size_t>::max();
+    size_t cursor = 0;
+    for (const auto& range : used) {
+      if (range.first > cursor) {
+        size_t gap = range.first - cursor;
+        if (gap >= block.nbytes && gap < best_gap) {
+          best_gap = gap;
+          best_offset = cursor;
+        }
+      }
+      cursor = std::max(cursor, range.second);
+    }
+    if (best_gap == std::numeric_limits<size_t>::max()) {
+      best_offset = cursor;
+    }
+    block.offset = best_offset;
+    plan.total_bytes = std::max(plan.total_bytes, block.offset + block.nbytes);
+    placed.push_back(&block);
+  }
+  plan.blocks = std::move(blocks);
+  return plan;
+}
+
+void apply_static_memory_plan(
+    const StaticMemoryPlan& plan,
+    Workspace* ws,
+    const string& slab_name) {
+  auto* slab = ws->CreateBlob(slab_name)->GetMutable<TensorCPU>();
+  slab->Resize(std::max<size_t>(plan.total_bytes, 1));
+  auto* base = slab->mutable_data<uint8_t>();
+  for (const auto& block : plan.blocks) {
+    CAFFE_ENFORCE_LE(block.offset + block.nbytes, plan.total_bytes);
+    auto* tensor = ws->CreateBlob(block.blob)->GetMutable<TensorCPU>();
+    tensor->Resize(block.dims);
+    tensor->ShareExternalPointer(
+        base + block.offset, block.meta, block.nbytes);
+    tensor->ReserveCurrentCapacity();
+  }
+}
+
+void preallocate_outputs(const NetDef& net, Workspace* ws) {
+  // Outputs on other devices, and blobs already holding data, such as
+  // parameters updated in place, are left alone
+  std::set<string> excluded;
+  for (const auto& op : net.op()) {
+    const auto& device =
+        op.has_device_option() ? op.device_option() : net.device_option();
+    for (const auto& outp : op.output()) {
+      const Blob* blob = ws->GetBlob(outp);
+      const bool empty = blob &&
+          (blob->meta() == TypeMeta() ||
+           (blob->IsType<TensorCPU>() &&
+            blob->Get<TensorCPU>().capacity_nbytes() == 0));
+      if (device.device_type() != CPU || !empty) {
+        excluded.insert(outp);
+      }
+    }
+  }
+
+  TensorShapes shapes;
+  try {
+    vector<std::unique_ptr<NetDef>> nets;
+    nets.emplace_back(new NetDef(net));
+    shapes = InferBlobShapesAndTypesFromWorkspace(ws, nets);
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Cannot preallocate the outputs of " << net.name()
+                 << ", shape inference failed: " << e.what();
+    return;
+  }
+
+  if (net.type() == "" || net.type() == "simple") {
+    auto plan = plan_static_memory(net, excluded, shapes);
+    apply_static_memory_plan(plan, ws, "__preallocated_" + net.name());
+    VLOG(1) << "Preallocated " << plan.blocks.size() << " outputs of "
+            << net.name() << " in " << plan.total_bytes << " bytes";
+    return;
+  }
+  std::set<string> planned(
+      net.external_input().begin(), net.external_input().end());
+  for (const auto& shape : shapes.shapes()) {
+    const auto& meta = DataTypeToTypeMeta(shape.data_type());
+    if (shape.unknown_shape() || excluded.count(shape.name()) ||
+        planned.count(shape.name()) || meta.ctor() ||
+        meta.itemsize() == 0 || !ws->HasBlob(shape.name())) {
+      continue;
+    }
+    auto* tensor = ws->GetBlob(shape.name())->GetMutable<TensorCPU>();
+    tensor->Resize(GetDimsVector(shape));
+    tensor->raw_mutable_data(meta);
+    tensor->ReserveCurrentCapacity();
+  }
+}
+
+namespace {
+
+bool hasName(
+    const google::protobuf::RepeatedPtrField<string>& names,
+    const string& name) {
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+// Whether ops[i] may write its output `out_idx` into its input `in_idx`,
+// and if so the ops after it reading the value of the output, which have to
+// read the input instead.
+bool canRewriteInplace(
+    const NetDef& net,
+    int i,
+    int in_idx,
+    int out_idx,
+    const std::set<string>& excluded,
+    std::vector<int>* readers) {
+  const auto& op = net.op(i);
+  const string& input = op.input(in_idx);
+  const string& output = op.output(out_idx);
+  if (input == output || excluded.count(input) ||
+      hasName(net.external_input(), output) ||
+      std::count(op.input().begin(), op.input().end(), input) > 1 ||
+      std::count(op.output().begin(), op.output().end(), output) > 1 ||
+      hasName(op.output(), input) || hasName(op.input(), output)) {
+    return false;
+  }
+  // The value of the input must not be read after op i
+  for (int j = i + 1; j < net.op_size(); j++) {
+    if (hasName(net.op(j).input(), input)) {
+      return false;
+    }
+    if (hasName(net.op(j).output(), input)) {
+      break;
+    }
+  }
+  // The readers of the output up to its next writer, which must not see a
+  // new value of the input
+  readers->clear();
+  bool overwritten = false;
+  bool input_written = false;
+  for (int j = i + 1; j < net.op_size() && !overwritten; j++) {
+    const auto& next = net.op(j);
+    // A reader writing the input would become in-place too
+    input_written = input_written || hasName(next.output(), input);
+    if (hasName(next.input(), output)) {
+      if (input_written) {
+        return false;
+      }
+      readers->push_back(j);
+    }
+    overwritten = hasName(next.output(), output);
+  }
+  // External outputs have to keep their name at the end of the net
+  return overwritten || !hasName(net.external_output(), output);
+}
+
+// Aligned size of a blob, 0 if its shape is not known.
+size_t knownBytes(
+    const std::unordered_map<string, const TensorShape*>& shape_map,
+    const string& name) {
+  auto it = shape_map.find(name);
+  if (it == shape_map.end() || it->second->unknown_shape()) {
+    return 0;
+  }
+  TIndex size = 1;
+  for (auto d : it->second->dims()) {
+    size *= d;
+  }
+  return alignedSize(
+      size * DataTypeToTypeMeta(it->second->data_type()).itemsize());
+}
+
+} // namespace
+
+NetDef rewrite_inplace(
+    const NetDef& net,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes,
+    InplaceRewriteStats* stats) {
+  InplaceRewriteStats local_stats;
+  if (!stats) {
+    stats = &local_stats;
+  }
+  *stats = InplaceRewriteStats();
+  if (net.type() != "" && net.type() != "simple") {
+    LOG(INFO) << "Cannot rewrite in-place ops for nets of type: " << net.type();
+    return net;
+  }
+  for (const auto& op : net.op()) {
+    if (op.type() == "RecurrentNetwork") {
+      LOG(INFO) << "In-place rewriting does not support RecurrentNetwork yet";
+      return net;
+    }
+  }
+
+  std::unordered_map<string, const TensorShape*> shape_map;
+  for (const auto& shape : shapes.shapes()) {
+    shape_map[shape.name()] = &shape;
+  }
+  std::set<string> excluded(static_blobs);
+  excluded.insert(net.external_input().begin(), net.external_input().end());
+  excluded.insert(net.external_output().begin(), net.external_output().end());
+
+  NetDef optim_net = net;
+  std::vector<int> readers;
+  for (int i = 0; i < optim_net.op_size(); i++) {
+    auto* op = optim_net.mutable_op(i);
+    const OpSchema* schema = OpSchemaRegistry::Schema(op->type());
+    if (!schema) {
+      continue;
+    }
+    for (int out_idx = 0; out_idx < op->output_size(); out_idx++) {
+      for (int in_idx = 0; in_idx < op->input_size(); in_idx++) {
+        if (!schema->inplace_allowed(in_idx, out_idx) ||
+            !canRewriteInplace(
+                optim_net, i, in_idx, out_idx, excluded, &readers)) {
+          continue;
+        }
+        const string output = op->output(out_idx);
+        const string& input = op->input(in_idx);
+        for (int j : readers) {
+          auto* reader = optim_net.mutable_op(j);
+          for (int k = 0; k < reader->input_size(); k++) {
+            if (reader->input(k) == output) {
+              reader->set_input(k, input);
+            }
+          }
+        }
+        op->set_output(out_idx, input);
+
+        stats->num_outputs++;
+        stats->nbytes += knownBytes(shape_map, output);
+        break;
+      }
+    }
+  }
+
+  LOG(INFO) << "rewrote " << stats->num_outputs << " outputs in-place, saving "
+            << stats->nbytes << " bytes of activations";
+  return optim_net;
+}
+
+namespace {
+
+class Recomputation {
+ public:
+  Recomputation(
+      const NetDef& net,
+      const std::set<string>& op_types,
+      const std::set<string>& static_blobs)
+      : net_(net), op_types_(op_types), excluded_(static_blobs) {
+    excluded_.insert(net.external_input().begin(), net.external_input().end());
+    excluded_.insert(
+        net.external_output().begin(), net.external_output().end());
+    for (int i = 0; i < net.op_size(); i++) {
+      for (const auto& input : net.op(i).input()) {
+        auto& readers = uses_[input].readers;
+        if (readers.empty() || readers.back() != i) {
+          readers.push_back(i);
+        }
+      }
+      for (const auto& output : net.op(i).output()) {
+        uses_[output].writers.push_back(i);
+      }
+    }
+  }
+
+  // Chooses the activations to recompute: first all those read by gradient
+  // ops, then drops those whose inputs can't be read before the first of
+  // them, until the remaining ones can all be recomputed.
+  void Plan() {
+    for (const auto& use : uses_) {
+      const string& blob = use.first;
+      const int i = producer(blob);
+      if (i < 0) {
+        continue;
+      }
+      int first_grad = -1;
+      int last_forward = i;
+      for (int j : use.second.readers) {
+        if (j < i) {
+          first_grad = -1;
+          break;
+        }
+        if (net_.op(j).is_gradient_op()) {
+          first_grad = j;
+          break;
+        }
+        last_forward = j;
+      }
+      // Nothing is saved if the value is read until the backward pass
+      if (first_grad > last_forward + 1) {
+        recomputed_[blob] = first_grad;
+      }
+    }
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto it = recomputed_.begin(); it != recomputed_.end();) {
+        std::map<string, string> names;
+        std::map<int, OperatorDef> ops;
+        if (recompute(it->first, it->second, &names, &ops)) {
+          ++it;
+        } else {
+          it = recomputed_.erase(it);
+          changed = true;
+        }
+      }
+    }
+  }
+
+  NetDef Apply(RecomputeStats* stats) {
+    std::set<string> names_used;
+    for (const auto& use : uses_) {
+      names_used.insert(use.first);
+    }
+    for (const auto& blob : recomputed_) {
+      copy_names_[blob.first] = uniqueName(blob.first, &names_used);
+    }
+
+    // Copies of the ops, in net order, to insert before each gradient op
+    std::map<int, std::map<int, OperatorDef>> inserted;
+    std::map<int, std::map<string, string>> names;
+    for (const auto& blob : recomputed_) {
+      const int b = blob.second;
+      CAFFE_ENFORCE(recompute(blob.first, b, &names[b], &inserted[b]));
+    }
+
+    NetDef optim_net = net_;
+    optim_net.clear_op();
+    for (int j = 0; j < net_.op_size(); j++) {
+      auto iit = inserted.find(j);
+      if (iit != inserted.end()) {
+        auto& blob_names = names[j];
+        for (auto& copy : iit->second) {
+          auto* op = optim_net.add_op();
+          op->CopyFrom(copy.second);
+          for (int k = 0; k < op->input_size(); k++) {
+            op->set_input(k, blob_names.at(op->input(k)));
+          }
+          // Outputs that are not read by later ops get a new name here
+          const string& output = op->output(0);
+          if (!blob_names.count(output)) {
+            blob_names[output] = uniqueName(output, &names_used);
+          }
+          op->set_output(0, blob_names.at(output));
+          stats->num_ops++;
+        }
+      }
+      auto* op = optim_net.add_op();
+      op->CopyFrom(net_.op(j));
+      for (int k = 0; k < op->input_size(); k++) {
+        auto rit = recomputed_.find(op->input(k));
+        if (rit != recomputed_.end() && rit->second <= j) {
+          op->set_input(k, copy_names_.at(op->input(k)));
+        }
+      }
+    }
+    return optim_net;
+  }
+
+  const std::map<string, int>& recomputed() const {
+    return recomputed_;
+  }
+
+ private:
+  struct Uses {
+    std::vector<int> writers;
+    std::vector<int> readers;
+  };
+
+  // The op writing `blob` if it may be recomputed, -1 otherwise.
+  int producer(const string& blob) const {
+    auto it = uses_.find(blob);
+    if (excluded_.count(blob) || it == uses_.end() ||
+        it->second.writers.size() != 1) {
+      return -1;
+    }
+    const int i = it->second.writers[0];
+    const auto& op = net_.op(i);
+    if (op.is_gradient_op() || !op_types_.count(op.type()) ||
+        op.output_size() != 1 || hasName(op.input(), blob)) {
+      return -1;
+    }
+    return i;
+  }
+
+  // The name the value op `i` reads from `blob` can be read with right
+  // before op `b` without keeping it alive longer than it already is, or ""
+  // if it is no longer alive.
+  string liveName(const string& blob, int i, int b) const {
+    auto it = uses_.find(blob);
+    if (it == uses_.end() || it->second.writers.empty()) {
+      return blob;
+    }
+    if (it->second.writers.size() > 1 || it->second.writers[0] > i) {
+      return "";
+    }
+    if (excluded_.count(blob)) {
+      return blob;
+    }
+    const auto& readers = it->second.readers;
+    auto rit = recomputed_.find(blob);
+    if (rit != recomputed_.end() && rit->second <= b) {
+      // The readers from op b on read the copy
+      return readers.back() >= b ? copy_names_lookup(blob) : "";
+    }
+    const int end = rit != recomputed_.end() ? rit->second
+                                             : std::numeric_limits<int>::max();
+    for (int j : readers) {
+      if (j >= b && j < end) {
+        return blob;
+      }
+    }
+    return "";
+  }
+
+  // Copies are only named once the plan is final, until then any name
+  // different from the blob's works.
+  string copy_names_lookup(const string& blob) const {
+    auto it = copy_names_.find(blob);
+    return it != copy_names_.end() ? it->second : blob + "_recompute";
+  }
+
+  // Adds to `ops` the copies of the ops computing `blob` again right before
+  // op `b`, with the names their inputs are read with in `names`. Returns
+  // false if some input can't be read there.
+  bool recompute(
+      const string& blob,
+      int b,
+      std::map<string, string>* names,
+      std::map<int, OperatorDef>* ops) const {
+    const int i = producer(blob);
+    CAFFE_ENFORCE_GE(i, 0);
+    if (ops->count(i)) {
+      return true;
+    }
+    const auto& op = net_.op(i);
+    for (const auto& input : op.input()) {
+      if (names->count(input)) {
+        continue;
+      }
+      string name = liveName(input, i, b);
+      if (name != "") {
+        (*names)[input] = name;
+      } else if (producer(input) < 0 || !recompute(input, b, names, ops)) {
+        return false;
+      }
+    }
+    auto rit = recomputed_.find(blob);
+    if (rit != recomputed_.end() && rit->second == b) {
+      (*names)[blob] = copy_names_lookup(blob);
+    }
+    (*ops)[i] = op;
+    return true;
+  }
+
+  static string uniqueName(const string& blob, std::set<string>* names_used) {
+    string name = blob + "_recompute";
+    for (int k = 1; names_used->count(name); k++) {
+      name = blob + "_recompute_" + caffe2::to_string(k);
+    }
+    names_used->insert(name);
+    return name;
+  }
+
+  const NetDef& net_;
+  const std::set<string>& op_types_;
+  std::set<string> excluded_;
+  std::unordered_map<string, Uses> uses_;
+  // Recomputed blob -> first gradient op reading it
+  std::map<string, int> recomputed_;
+  std::map<string, string> copy_names_;
+};
+
+} // namespace
+
+NetDef insert_recomputation(
+    const NetDef& net,
+    const std::set<string>& op_types,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes,
+    RecomputeStats* stats) {
+  RecomputeStats local_stats;
+  if (!stats) {
+    stats = &local_stats;
+  }
+  *stats = RecomputeStats();
+  for (const auto& op : net.op()) {
+    if (op.type() == "RecurrentNetwork") {
+      LOG(INFO) << "Recomputation does not support RecurrentNetwork yet";
+      return net;
+    }
+  }
+
+  Recomputation recomputation(net, op_types, static_blobs);
+  recomputation.Plan();
+  NetDef optim_net = recomputation.Apply(stats);
+
+  std::unordered_map<string, const TensorShape*> shape_map;
+  for (const auto& shape : shapes.shapes()) {
+    shape_map[shape.name()] = &shape;
+  }
+  for (const auto& blob : recomputation.recomputed()) {
+    stats->num_outputs++;
+    stats->nbytes += knownBytes(shape_map, blob.first);
+  }
+
+  LOG(INFO) << "recomputing " << stats->num_outputs << " activations with "
+            << stats->num_ops << " ops, saving " << stats->nbytes
+            << " bytes of activations";
+  return optim_net;
 }
 
 } // memonger
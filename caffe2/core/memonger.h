@@ -4,6 +4,7 @@
 #include <unordered_set>
 
 #include "caffe2/core/common.h"
+#include "caffe2/core/typeid.h"
 #include "caffe2/core/workspace.h"
 #include "caffe2/proto/caffe2.pb.h"
 
@@ -14,6 +15,22 @@ NetDef optimize_inference_net(
     const NetDef& net,
     const std::set<string>& static_blobs);
 
+// Sizes, in elements, of the shareable outputs of
+// compute_blob_recycling_for_dag, which are only computed when blob shapes
+// are given: `unshared_size` is their total size without sharing,
+// `shared_size` the total size of the blobs they are mapped to, and
+// `peak_live_size` the largest total size of those alive at once when the
+// ops run in the order of `op_indices`, which no sharing can go below.
+struct BlobRecyclingStats {
+  TIndex unshared_size = 0;
+  TIndex shared_size = 0;
+  TIndex peak_live_size = 0;
+};
+
+// Maps the shareable outputs of the ops of `op_indices` to the blobs freed
+// by the ops they depend on. With `blob_shapes`, every output goes to the
+// smallest free blob that is large enough to hold it, or else to the
+// largest free blob.
 NetDef compute_blob_recycling_for_dag(
     const NetDef& net,
     const std::vector<string>& heads,
@@ -21,7 +38,100 @@ NetDef compute_blob_recycling_for_dag(
     const std::unordered_set<string>& shareable_blob_names,
     const string& namescope,
     const std::unordered_set<string>& dont_share_blob_names,
-    const std::unordered_map<string, vector<int>>& blob_shapes);
+    const std::unordered_map<string, vector<int>>& blob_shapes,
+    BlobRecyclingStats* stats = nullptr);
+
+// Offset assignment of the activations of a net into one buffer.
+//
+// Every planned blob lives from the op that first writes it to the op that
+// last reads it (external outputs live until the end of the net); blobs
+// whose lifetimes overlap get disjoint [offset, offset + nbytes) ranges.
+// `total_bytes` is the peak memory needed by the planned blobs.
+struct StaticMemoryPlan {
+  struct Block {
+    string blob;
+    size_t offset;
+    size_t nbytes;
+    int first_op;
+    int last_op;
+    vector<TIndex> dims;
+    TypeMeta meta;
+  };
+  vector<Block> blocks;
+  size_t total_bytes = 0;
+};
+
+// Plans the activations of a simple net with fixed shapes. `shapes` are
+// usually obtained from InferBlobShapesAndTypesFromWorkspace once inputs and
+// parameters are in place. External inputs, static blobs and blobs with
+// unknown shapes or non-POD types are not planned.
+StaticMemoryPlan plan_static_memory(
+    const NetDef& net,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes);
+
+// Allocates a single buffer for the plan into blob `slab_name` of `ws` and
+// binds every planned tensor to its range of the buffer. Tensors that later
+// grow beyond the planned size fall back to a regular allocation, smaller
+// ones keep their range.
+void apply_static_memory_plan(
+    const StaticMemoryPlan& plan,
+    Workspace* ws,
+    const string& slab_name);
+
+// Preallocates the outputs of the ops of `net`, whose operators have been
+// created in `ws`, with the shapes inferred from the blobs of `ws`, so that
+// the first runs don't allocate them and later resizes to the same sizes
+// don't reallocate. The outputs of simple nets are bound to a plan of
+// plan_static_memory in blob "__preallocated_<net name>", so that blobs
+// other than external outputs may not be read after the net runs; the
+// outputs of other nets are allocated one by one. Only empty CPU outputs
+// with known shapes and POD types are preallocated. CreateNet calls it for
+// nets with the `preallocate_outputs` argument set.
+void preallocate_outputs(const NetDef& net, Workspace* ws);
+
+// In-place rewriting: for every op whose schema allows writing output Y
+// into input X, renames Y to X when this value of X is not read by later ops,
+// so that the output reuses the memory of the input. X must not be an
+// external input or output or a static blob, and must not be written before
+// the last reader of Y. `shapes` is only used to count the bytes of the
+// activations no longer allocated, which are reported in `stats` if given.
+// Works on the names the net uses, so it can run before or after the other
+// memonger passes.
+struct InplaceRewriteStats {
+  int num_outputs = 0;
+  size_t nbytes = 0;
+};
+
+NetDef rewrite_inplace(
+    const NetDef& net,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes,
+    InplaceRewriteStats* stats = nullptr);
+
+// Recomputation for training nets: the output of a forward op of one of
+// `op_types` that gradient ops read is computed again right before the first
+// of them, and they read the copy, so that the forward value is not kept
+// alive until the backward pass. The inputs of the op have to be alive at
+// that point anyway, or be outputs of such ops themselves, which are then
+// recomputed first. Only ops with a single output are recomputed, so
+// SpatialBN is only in test mode, and `op_types` must only name ops whose
+// output is a function of their inputs, e.g. Relu. Gradient ops are those
+// with `is_gradient_op` set. Run it before the passes sharing blobs, which
+// reuse the memory freed. `shapes` is only used to count the bytes of the
+// activations no longer kept for the backward pass.
+struct RecomputeStats {
+  int num_outputs = 0;
+  int num_ops = 0;
+  size_t nbytes = 0;
+};
+
+NetDef insert_recomputation(
+    const NetDef& net,
+    const std::set<string>& op_types,
+    const std::set<string>& static_blobs,
+    const TensorShapes& shapes,
+    RecomputeStats* stats = nullptr);
 
 } // memonger
 } // caffe2
@@ -0,0 +1,349 @@
+#include "caffe2/core/memonger.h"
+#include "caffe2/core/graph.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/utils/proto_utils.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+const char kChainNet[] = R"DOC(
+  name: "chain"
+  op {
+    input: "data"
+    output: "a"
+    type: "Relu"
+  }
+  op {
+    input: "a"
+    output: "b"
+    type: "Relu"
+  }
+  op {
+    input: "b"
+    output: "c"
+    type: "Relu"
+  }
+  op {
+    input: "c"
+    output: "out"
+    type: "Relu"
+  }
+  external_input: "data"
+  external_output: "out"
+)DOC";
+
+TensorShapes chainShapes() {
+  TensorShapes shapes;
+  for (const char* name : {"data", "a", "b", "c", "out"}) {
+    auto* shape = shapes.add_shapes();
+    shape->set_name(name);
+    shape->add_dims(4);
+    shape->add_dims(16);
+  }
+  return shapes;
+}
+
+const memonger::StaticMemoryPlan::Block& findBlock(
+    const memonger::StaticMemoryPlan& plan,
+    const string& name) {
+  for (const auto& block : plan.blocks) {
+    if (block.blob == name) {
+      return block;
+    }
+  }
+  CAFFE_THROW("Blob not planned: ", name);
+}
+
+} // namespace
+
+TEST(MemongerTest, StaticPlanReusesMemory) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  auto plan = memonger::plan_static_memory(net, {}, chainShapes());
+
+  // External input is not planned
+  EXPECT_EQ(plan.blocks.size(), 4);
+  const size_t nbytes = 4 * 16 * sizeof(float);
+  // A chain needs only the input and the output of one op at a time
+  EXPECT_EQ(plan.total_bytes, 2 * nbytes);
+  EXPECT_EQ(findBlock(plan, "out").last_op, net.op_size());
+
+  for (const auto& a : plan.blocks) {
+    EXPECT_EQ(a.nbytes, nbytes);
+    EXPECT_EQ(a.offset % gCaffe2Alignment, 0);
+    for (const auto& b : plan.blocks) {
+      if (a.blob == b.blob || a.first_op > b.last_op ||
+          b.first_op > a.last_op) {
+        continue;
+      }
+      EXPECT_TRUE(
+          a.offset + a.nbytes <= b.offset || b.offset + b.nbytes <= a.offset)
+          << a.blob << " overlaps " << b.blob;
+    }
+  }
+}
+
+TEST(MemongerTest, StaticPlanSkipsStaticAndUnknownBlobs) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  auto shapes = chainShapes();
+  shapes.mutable_shapes(2)->set_unknown_shape(true); // "b"
+  auto plan = memonger::plan_static_memory(net, {"c"}, shapes);
+
+  std::set<string> planned;
+  for (const auto& block : plan.blocks) {
+    planned.insert(block.blob);
+  }
+  EXPECT_EQ(planned, std::set<string>({"a", "out"}));
+}
+
+TEST(MemongerTest, StaticPlanRejectsDAGNets) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  net.set_type("dag");
+  EXPECT_THROW(
+      memonger::plan_static_memory(net, {}, chainShapes()), EnforceNotMet);
+}
+
+TEST(MemongerTest, ApplyStaticPlanBindsTensorsToSlab) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  auto plan = memonger::plan_static_memory(net, {}, chainShapes());
+
+  Workspace ws;
+  memonger::apply_static_memory_plan(plan, &ws, "__slab");
+  const auto& slab = ws.GetBlob("__slab")->Get<TensorCPU>();
+  EXPECT_EQ(slab.nbytes(), plan.total_bytes);
+  const auto* base = static_cast<const uint8_t*>(slab.raw_data());
+
+  for (const auto& block : plan.blocks) {
+    auto* tensor = ws.GetBlob(block.blob)->GetMutable<TensorCPU>();
+    EXPECT_EQ(tensor->dims(), block.dims);
+    // Writing the planned shape must not reallocate
+    auto* data = tensor->mutable_data<float>();
+    EXPECT_EQ(reinterpret_cast<uint8_t*>(data), base + block.offset);
+  }
+}
+
+TEST(MemongerTest, RewriteInplaceChain) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  memonger::InplaceRewriteStats stats;
+  auto optim = memonger::rewrite_inplace(net, {}, chainShapes(), &stats);
+
+  // data is an external input and out an external output
+  ASSERT_EQ(optim.op_size(), 4);
+  EXPECT_EQ(optim.op(0).output(0), "a");
+  for (int i = 1; i < 3; i++) {
+    EXPECT_EQ(optim.op(i).input(0), "a");
+    EXPECT_EQ(optim.op(i).output(0), "a");
+  }
+  EXPECT_EQ(optim.op(3).input(0), "a");
+  EXPECT_EQ(optim.op(3).output(0), "out");
+  EXPECT_EQ(stats.num_outputs, 2);
+  EXPECT_EQ(stats.nbytes, 2 * 4 * 16 * sizeof(float));
+}
+
+TEST(MemongerTest, RewriteInplaceKeepsLiveInputs) {
+  NetDef net;
+  AddOp(&net, "Relu", {"data"}, {"a"});
+  AddOp(&net, "Relu", {"a"}, {"b"});
+  AddOp(&net, "Sum", {"a", "b"}, {"c"});
+  AddOp(&net, "Relu", {"c"}, {"out"});
+  net.add_external_input("data");
+  net.add_external_output("out");
+
+  // a is read by Sum, so b can't reuse it, but c can
+  auto optim = memonger::rewrite_inplace(net, {}, TensorShapes());
+  EXPECT_EQ(optim.op(1).output(0), "b");
+  EXPECT_EQ(optim.op(2).output(0), "a");
+  EXPECT_EQ(optim.op(3).input(0), "a");
+
+  Workspace ws;
+  auto* data = ws.CreateBlob("data")->GetMutable<TensorCPU>();
+  data->Resize(3);
+  const float values[] = {-1, 0.5f, 2};
+  std::copy(values, values + 3, data->mutable_data<float>());
+  ASSERT_TRUE(ws.RunNetOnce(optim));
+  const auto& out = ws.GetBlob("out")->Get<TensorCPU>();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_FLOAT_EQ(out.data<float>()[i], 2 * std::max(values[i], 0.0f));
+  }
+
+  // Static blobs are never overwritten
+  optim = memonger::rewrite_inplace(net, {"a"}, TensorShapes());
+  EXPECT_EQ(optim.op(2).output(0), "c");
+}
+
+TEST(MemongerTest, RewriteInplaceRespectsLaterWrites) {
+  NetDef net;
+  AddOp(&net, "Relu", {"data"}, {"a"});
+  AddOp(&net, "Relu", {"a"}, {"b"});
+  // a is written again before b is read
+  AddOp(&net, "Relu", {"data"}, {"a"});
+  AddOp(&net, "Sum", {"b", "a"}, {"out"});
+  net.add_external_input("data");
+  net.add_external_output("out");
+
+  memonger::InplaceRewriteStats stats;
+  auto optim = memonger::rewrite_inplace(net, {}, TensorShapes(), &stats);
+  EXPECT_EQ(optim.op(1).output(0), "b");
+  EXPECT_EQ(stats.num_outputs, 0);
+}
+
+TEST(MemongerTest, DagRecyclingBestFit) {
+  NetDef net;
+  AddOp(&net, "Relu", {"data"}, {"a"});
+  AddOp(&net, "Relu", {"data"}, {"b"});
+  AddOp(&net, "Sum", {"a", "b"}, {"c"});
+  AddOp(&net, "Relu", {"c"}, {"d"});
+  AddOp(&net, "Relu", {"d"}, {"e"});
+  net.add_external_input("data");
+  std::unordered_map<string, vector<int>> shapes{{"data", {100}},
+                                                  {"a", {100}},
+                                                  {"b", {10}},
+                                                  {"c", {10}},
+                                                  {"d", {10}},
+                                                  {"e", {100}}};
+
+  memonger::BlobRecyclingStats stats;
+  auto optim = memonger::compute_blob_recycling_for_dag(
+      net,
+      {"data"},
+      {0, 1, 2, 3, 4},
+      {"a", "b", "c", "d", "e"},
+      "",
+      {},
+      shapes,
+      &stats);
+  // d fits in b, e in a
+  EXPECT_EQ(optim.op(3).output(0), optim.op(1).output(0));
+  EXPECT_EQ(optim.op(4).output(0), optim.op(0).output(0));
+  EXPECT_NE(optim.op(2).output(0), optim.op(0).output(0));
+  EXPECT_EQ(stats.unshared_size, 230);
+  EXPECT_EQ(stats.shared_size, 120);
+  EXPECT_EQ(stats.peak_live_size, 120);
+}
+
+namespace {
+
+// Relu -> FC -> Relu -> FC -> SquaredL2 and their gradients
+NetDef reluFCNet() {
+  NetDef net;
+  AddOp(&net, "Relu", {"data"}, {"a"});
+  AddOp(&net, "FC", {"a", "w"}, {"b"});
+  AddOp(&net, "Relu", {"b"}, {"c"});
+  AddOp(&net, "FC", {"c", "w"}, {"out"});
+  AddOp(&net, "SquaredL2", {"out"}, {"loss"});
+  AddOp(&net, "SquaredL2Gradient", {"out", "loss_grad"}, {"out_grad"})
+      ->set_is_gradient_op(true);
+  AddOp(&net, "FCGradient", {"c", "w", "out_grad"}, {"c_grad"})
+      ->set_is_gradient_op(true);
+  AddOp(&net, "ReluGradient", {"c", "c_grad"}, {"b_grad"})
+      ->set_is_gradient_op(true);
+  AddOp(&net, "FCGradient", {"a", "w", "b_grad"}, {"a_grad"})
+      ->set_is_gradient_op(true);
+  AddOp(&net, "ReluGradient", {"a", "a_grad"}, {"data_grad"})
+      ->set_is_gradient_op(true);
+  net.add_external_input("data");
+  net.add_external_input("w");
+  net.add_external_input("loss_grad");
+  net.add_external_output("loss");
+  return net;
+}
+
+} // namespace
+
+TEST(MemongerTest, RecomputeCheapActivations) {
+  NetDef net = reluFCNet();
+  memonger::RecomputeStats stats;
+  auto optim = memonger::insert_recomputation(
+      net, {"Relu"}, {}, chainShapes(), &stats);
+
+  // The input of the second Relu is not alive in the backward pass
+  ASSERT_EQ(optim.op_size(), net.op_size() + 1);
+  EXPECT_EQ(optim.op(6).input(0), "c");
+  EXPECT_EQ(optim.op(7).input(0), "c");
+  EXPECT_EQ(optim.op(8).type(), "Relu");
+  EXPECT_EQ(optim.op(8).input(0), "data");
+  EXPECT_EQ(optim.op(8).output(0), "a_recompute");
+  EXPECT_EQ(optim.op(9).input(0), "a_recompute");
+  EXPECT_EQ(optim.op(10).input(0), "a_recompute");
+  EXPECT_EQ(optim.op(1).input(0), "a");
+  EXPECT_EQ(stats.num_outputs, 1);
+  EXPECT_EQ(stats.num_ops, 1);
+  EXPECT_EQ(stats.nbytes, 4 * 16 * sizeof(float));
+}
+
+TEST(MemongerTest, RecomputeChains) {
+  NetDef net = reluFCNet();
+  memonger::RecomputeStats stats;
+  auto optim = memonger::insert_recomputation(
+      net, {"Relu", "FC"}, {}, TensorShapes(), &stats);
+
+  // c is recomputed from data, a is recomputed for c and again later, out is
+  // read until the backward pass
+  ASSERT_EQ(optim.op_size(), net.op_size() + 4);
+  EXPECT_EQ(optim.op(6).type(), "Relu");
+  EXPECT_EQ(optim.op(6).input(0), "data");
+  EXPECT_EQ(optim.op(6).output(0), "a_recompute_1");
+  EXPECT_EQ(optim.op(7).type(), "FC");
+  EXPECT_EQ(optim.op(7).input(0), "a_recompute_1");
+  EXPECT_EQ(optim.op(7).input(1), "w");
+  EXPECT_EQ(optim.op(7).output(0), "b_recompute");
+  EXPECT_EQ(optim.op(8).input(0), "b_recompute");
+  EXPECT_EQ(optim.op(8).output(0), "c_recompute");
+  EXPECT_EQ(optim.op(9).input(0), "c_recompute");
+  EXPECT_EQ(optim.op(10).input(0), "c_recompute");
+  EXPECT_EQ(optim.op(11).output(0), "a_recompute");
+  EXPECT_EQ(optim.op(12).input(0), "a_recompute");
+  EXPECT_EQ(optim.op(13).input(0), "a_recompute");
+  EXPECT_EQ(optim.op(3).input(0), "c");
+  EXPECT_EQ(stats.num_outputs, 2);
+  EXPECT_EQ(stats.num_ops, 4);
+}
+
+TEST(MemongerTest, PreallocateOutputsOnNetCreation) {
+  NetDef net;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kChainNet, &net));
+  net.add_arg()->CopyFrom(MakeArgument<int>("preallocate_outputs", 1));
+  Workspace ws;
+  auto* data = ws.CreateBlob("data")->GetMutable<TensorCPU>();
+  data->Resize(4, 16);
+  for (int i = 0; i < data->size(); i++) {
+    data->mutable_data<float>()[i] = i % 2 ? i : -i;
+  }
+  // b already holds data, so it's left alone
+  auto* b = ws.CreateBlob("b")->GetMutable<TensorCPU>();
+  b->Resize(1);
+  const float* b_data = b->mutable_data<float>();
+  ASSERT_TRUE(ws.CreateNet(net));
+
+  const auto& slab = ws.GetBlob("__preallocated_chain")->Get<TensorCPU>();
+  const auto* begin = static_cast<const uint8_t*>(slab.raw_data());
+  const auto* end = begin + slab.nbytes();
+  std::vector<const void*> pointers;
+  for (const char* name : {"a", "c", "out"}) {
+    const auto& tensor = ws.GetBlob(name)->Get<TensorCPU>();
+    EXPECT_EQ(tensor.dims(), std::vector<TIndex>({4, 16}));
+    const auto* ptr = static_cast<const uint8_t*>(tensor.raw_data());
+    EXPECT_TRUE(ptr >= begin && ptr < end);
+    pointers.push_back(ptr);
+  }
+  EXPECT_EQ(ws.GetBlob("b")->Get<TensorCPU>().data<float>(), b_data);
+
+  // Running the net doesn't reallocate the outputs
+  ASSERT_TRUE(ws.RunNet("chain"));
+  int i = 0;
+  for (const char* name : {"a", "c", "out"}) {
+    EXPECT_EQ(ws.GetBlob(name)->Get<TensorCPU>().raw_data(), pointers[i++]);
+  }
+  const auto& out = ws.GetBlob("out")->Get<TensorCPU>();
+  for (int j = 0; j < out.size(); j++) {
+    EXPECT_EQ(out.data<float>()[j], j % 2 ? j : 0);
+  }
+}
+
+} // namespace caffe2
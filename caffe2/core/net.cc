@@ -5,7 +5,9 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/memonger.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/scope_guard.h"
 #include "caffe2/core/timer.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/proto_utils.h"
@@ -20,7 +22,7 @@ CAFFE_DEFINE_REGISTRY(
 
 NetBase::NetBase(
     const std::shared_ptr<const NetDef>& def,
-    Workspace* /* unused */)
+    Workspace* ws)
     : external_input_(
           def->external_input().begin(),
           def->external_input().end()),
@@ -28,7 +30,8 @@ NetBase::NetBase(
           def->external_output().begin(),
           def->external_output().end()),
       name_(def->name()),
-      net_def_(def) {
+      net_def_(def),
+      ws_(ws) {
   // Check that node_name is empty for all ops
   for (const OperatorDef& op : def->op()) {
     if (op.has_device_option()) {
@@ -81,6 +84,15 @@ NetBase::NetBase(
       *remaining_output.begin());
 }
 
+bool NetBase::Run() {
+  auto* allocator = ws_ ? ws_->GetCPUAllocator() : nullptr;
+  if (!allocator) {
+    return DoRun();
+  }
+  auto guard = MakeGuard([allocator]() { allocator->OnRunFinished(); });
+  return DoRun();
+}
+
 bool NetBase::RunAsync() {
   for (auto& op : GetOperators()) {
     op->ResetEvent();
@@ -116,6 +128,11 @@ unique_ptr<NetBase> CreateNet(
   } else {
     net = NetRegistry()->Create(net_def->type(), net_def, ws);
   }
+  if (net &&
+      ArgumentHelper(*net_def).GetSingleArgument<bool>(
+          "preallocate_outputs", false)) {
+    memonger::preallocate_outputs(*net_def, ws);
+  }
   VLOG(1) << "Adding a global observer to a net";
   if (net) {
     auto* observer_creators = GetNetObserverCreators();
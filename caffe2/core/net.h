@@ -49,19 +49,9 @@ class NetBase : public Observable<NetBase> {
     }
   }
 
-  virtual bool Run() {
-    if (!RunAsync()) {
-      LOG(ERROR) << "Failed to execute async run";
-      return false;
-    }
-    Wait();
-    for (const Event* event : events_) {
-      if (event->Query() != EventStatus::EVENT_SUCCESS) {
-        CAFFE_THROW(event->ErrorMessage());
-      }
-    }
-    return true;
-  }
+  // Runs the net; the CPU allocator of the workspace, if any, is notified
+  // at the end of the run (see Workspace::SetCPUAllocator)
+  bool Run();
 
   virtual bool RunAsync();
 
@@ -111,6 +101,21 @@ class NetBase : public Observable<NetBase> {
   }
 
  protected:
+  // Runs the net synchronously, by default through RunAsync and Wait
+  virtual bool DoRun() {
+    if (!RunAsync()) {
+      LOG(ERROR) << "Failed to execute async run";
+      return false;
+    }
+    Wait();
+    for (const Event* event : events_) {
+      if (event->Query() != EventStatus::EVENT_SUCCESS) {
+        CAFFE_THROW(event->ErrorMessage());
+      }
+    }
+    return true;
+  }
+
   virtual bool DoRunAsync() {
     CAFFE_THROW("Not implemented");
   };
@@ -120,6 +125,7 @@ class NetBase : public Observable<NetBase> {
   string name_;
   vector<const Event*> events_;
   std::shared_ptr<const NetDef> net_def_;
+  Workspace* ws_;
   DISABLE_COPY_AND_ASSIGN(NetBase);
 };
 
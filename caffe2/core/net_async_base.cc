@@ -1,7 +1,12 @@
 #include "caffe2/core/net_async_polling.h"
 
+#include "caffe2/core/net_template.h"
+#include "caffe2/core/numa.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
+#include "caffe2/utils/lock_free_thread_pool.h"
+#include "caffe2/utils/work_stealing_thread_pool.h"
 
 CAFFE2_DEFINE_int(
     caffe2_streams_per_gpu,
@@ -35,6 +40,45 @@ CAFFE2_DEFINE_bool(
     true,
     "Select next non-busy stream");
 
+CAFFE2_DEFINE_string(
+    caffe2_net_async_thread_pool_type,
+    "",
+    "Type of the thread pools used by async nets, e.g. work_stealing or "
+    "lock_free (default - device's default pool)");
+
+CAFFE2_DEFINE_bool(
+    caffe2_net_async_inline_cheap_ops,
+    true,
+    "Run chains of cheap CPU ops inline on the thread finishing their parent");
+
+CAFFE2_DEFINE_int(
+    caffe2_net_async_inline_max_output_size,
+    0,
+    "Also treat ops as cheap when shape inference at net creation gives "
+    "outputs of at most this many elements (0 - use schema hints only)");
+
+CAFFE2_DEFINE_bool(
+    caffe2_net_async_numa_placement,
+    false,
+    "Place CPU chains without explicit numa_node_id on NUMA nodes so that "
+    "few chain dependencies cross nodes");
+
+CAFFE2_DEFINE_bool(
+    caffe2_net_async_copy_stream,
+    false,
+    "Run chains of host to device copies on their own stream per GPU, apart "
+    "from the compute streams");
+
+CAFFE2_DEFINE_int(
+    caffe2_net_async_numa_placement_nodes,
+    0,
+    "Number of NUMA nodes used by the placement (default - all nodes)");
+
+CAFFE2_DEFINE_double(
+    caffe2_net_async_numa_max_imbalance,
+    0.2,
+    "Max relative excess of ops placed on a NUMA node over the average");
+
 namespace caffe2 {
 
 thread_local std::vector<int> AsyncNetBase::stream_counters_;
@@ -42,18 +86,32 @@ thread_local std::vector<int> AsyncNetBase::stream_counters_;
 AsyncNetBase::AsyncNetBase(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : NetBase(net_def, ws) {
+    : NetBase(net_def, ws), numa_stats_(net_def->name() + "/numa") {
   operator_nodes_ = dag_utils::prepareOperatorNodes(net_def, ws);
   operators_.reserve(operator_nodes_.size());
   for (const auto& node : operator_nodes_) {
     operators_.push_back(node.operator_.get());
   }
 
-  const auto& execution_chains = dag_utils::computeChains(operator_nodes_);
+  auto* net_template = NetTemplate::Find(*net_def);
+  const auto cached_chains = net_template ? net_template->chains() : nullptr;
+  const auto execution_chains = cached_chains
+      ? dag_utils::reuseChains(operator_nodes_, *cached_chains)
+      : dag_utils::computeChains(operator_nodes_);
+  if (net_template && !cached_chains) {
+    net_template->RecordChains(execution_chains);
+  }
   chains_.reserve(execution_chains.size());
   for (const auto& kv : execution_chains) {
     chains_.push_back(kv.second);
   }
+  ArgumentHelper helper(*net_def);
+  if (helper.GetSingleArgument<bool>(
+          "copy_stream", FLAGS_caffe2_net_async_copy_stream)) {
+    computeCopyChains(*net_def);
+  } else {
+    copy_chains_.assign(chains_.size(), false);
+  }
   chain_nodes_ = dag_utils::prepareChainGraphNodes(operator_nodes_, chains_);
 
   events_.reserve(chains_.size());
@@ -62,29 +120,251 @@ AsyncNetBase::AsyncNetBase(
     events_.push_back(&op->event());
   }
 
+  thread_pool_type_ = helper.GetSingleArgument<std::string>(
+      "thread_pool_type", FLAGS_caffe2_net_async_thread_pool_type);
+
   gpu_pools_.resize(FLAGS_caffe2_net_async_max_gpus);
   cpu_pools_.resize(FLAGS_caffe2_net_async_max_numa_nodes);
   DeviceOption cpu_option;
   cpu_option.set_device_type(CPU);
-  cpu_pool_ = ThreadPoolRegistry()->Create(
-      DeviceTypeName(cpu_option.device_type()), cpu_option);
+  cpu_pool_ = ThreadPoolRegistry()->Create(poolKey(cpu_option), cpu_option);
+
+  if (helper.GetSingleArgument<bool>(
+          "inline_cheap_ops", FLAGS_caffe2_net_async_inline_cheap_ops)) {
+    computeInlineChains(*net_def, ws);
+  } else {
+    inline_chains_.assign(chains_.size(), false);
+  }
+
+  if (helper.GetSingleArgument<bool>(
+          "numa_placement", FLAGS_caffe2_net_async_numa_placement)) {
+    auto num_nodes = helper.GetSingleArgument<int>(
+        "numa_placement_nodes", FLAGS_caffe2_net_async_numa_placement_nodes);
+    if (num_nodes <= 0) {
+      num_nodes = GetNumNUMANodes();
+    }
+    num_nodes = std::min(num_nodes, FLAGS_caffe2_net_async_max_numa_nodes);
+    if (num_nodes > 1) {
+      computeNUMAPlacement(*net_def, num_nodes);
+    } else {
+      VLOG(1) << "Skipping NUMA placement, number of nodes: " << num_nodes;
+    }
+  }
+  task_device_options_.reserve(chains_.size());
+  for (auto task_id = 0; task_id < chains_.size(); ++task_id) {
+    task_device_options_.push_back(event(task_id).GetDeviceOption());
+    if (!chain_numa_nodes_.empty() &&
+        task_device_options_.back().device_type() == CPU) {
+      task_device_options_.back().set_numa_node_id(chain_numa_nodes_[task_id]);
+    }
+  }
+}
+
+void AsyncNetBase::computeNUMAPlacement(const NetDef& net_def, int num_nodes) {
+  std::vector<double> chain_costs(chains_.size(), 0);
+  std::vector<int> fixed_nodes(chains_.size(), -1);
+  for (auto task_id = 0; task_id < chains_.size(); ++task_id) {
+    const auto& device_option = event(task_id).GetDeviceOption();
+    // Non-CPU chains don't add to the load, but still attract their
+    // neighbours
+    if (device_option.device_type() == CPU) {
+      chain_costs[task_id] = chains_[task_id].size();
+      if (device_option.numa_node_id() >= 0) {
+        fixed_nodes[task_id] = device_option.numa_node_id() % num_nodes;
+      }
+    }
+  }
+  chain_numa_nodes_ = dag_utils::partitionChains(
+      chain_nodes_,
+      chain_costs,
+      fixed_nodes,
+      num_nodes,
+      FLAGS_caffe2_net_async_numa_max_imbalance);
+
+  std::vector<int> op_chains(operators_.size());
+  for (auto task_id = 0; task_id < chains_.size(); ++task_id) {
+    for (auto op_id : chains_[task_id]) {
+      op_chains[op_id] = task_id;
+    }
+  }
+  // Ops are in the execution order, so the last writer of a blob seen so
+  // far is the producer of the value an op reads
+  std::unordered_map<std::string, int> producers;
+  cross_node_inputs_.resize(chains_.size());
+  pinned_outputs_.resize(operators_.size());
+  for (auto op_id = 0; op_id < operators_.size(); ++op_id) {
+    const auto& op_def = net_def.op(op_id);
+    const auto task_id = op_chains[op_id];
+    for (auto i = 0; i < op_def.input_size(); ++i) {
+      auto it = producers.find(op_def.input(i));
+      if (it != producers.end() && it->second != task_id &&
+          chain_numa_nodes_[it->second] != chain_numa_nodes_[task_id]) {
+        cross_node_inputs_[task_id].push_back(operators_[op_id]->Inputs()[i]);
+      }
+    }
+    for (const auto& output : op_def.output()) {
+      producers[output] = task_id;
+    }
+    pinned_outputs_[op_id].assign(op_def.output_size(), nullptr);
+  }
 }
 
-std::shared_ptr<TaskThreadPool> AsyncNetBase::pool_getter(
-    std::vector<std::shared_ptr<TaskThreadPool>>& pools,
+void AsyncNetBase::updateNUMAStats(int task_id) {
+  if (!cross_node_inputs_[task_id].empty()) {
+    size_t nbytes = 0;
+    for (const auto* blob : cross_node_inputs_[task_id]) {
+      if (blob->IsType<TensorCPU>()) {
+        nbytes += blob->Get<TensorCPU>().nbytes();
+      }
+    }
+    CAFFE_EVENT(
+        numa_stats_, cross_node_reads, cross_node_inputs_[task_id].size());
+    CAFFE_EVENT(numa_stats_, cross_node_read_bytes, nbytes);
+  }
+
+  if (!IsNUMAEnabled()) {
+    return;
+  }
+  // Outputs are usually allocated by the pool's threads that are bound to
+  // the node, but may have been allocated elsewhere (e.g. on the first run
+  // or by another net), move them once per allocation
+  for (auto op_id : chains_[task_id]) {
+    auto* op = operators_[op_id];
+    auto& pinned = pinned_outputs_[op_id];
+    for (auto i = 0; i < op->OutputSize(); ++i) {
+      const auto* blob = op->Outputs()[i];
+      if (!blob->IsType<TensorCPU>()) {
+        continue;
+      }
+      const auto& tensor = blob->Get<TensorCPU>();
+      const void* data = tensor.raw_data();
+      if (data && data != pinned[i]) {
+        NUMAMove(
+            const_cast<void*>(data),
+            tensor.nbytes(),
+            chain_numa_nodes_[task_id]);
+        pinned[i] = data;
+        CAFFE_EVENT(numa_stats_, pinned_bytes, tensor.nbytes());
+      }
+    }
+  }
+}
+
+const DeviceOption& AsyncNetBase::taskDeviceOption(int task_id) const {
+  return task_device_options_[task_id];
+}
+
+void AsyncNetBase::computeCopyChains(const NetDef& net_def) {
+  std::vector<bool> copy_ops(operators_.size(), false);
+  for (auto op_id = 0; op_id < operators_.size(); ++op_id) {
+    const auto& type = net_def.op(op_id).type();
+    copy_ops[op_id] =
+        operators_[op_id]->device_option().device_type() == CUDA &&
+        (type == "CopyCPUToGPU" || type == "CopyFromCPUInput");
+  }
+
+  // Copies are split from the ops they feed, which then wait for the copy
+  // chain's event on their own stream
+  std::vector<std::vector<int>> chains;
+  chains.reserve(chains_.size());
+  for (const auto& chain : chains_) {
+    auto begin = chain.begin();
+    while (begin != chain.end()) {
+      auto end = begin;
+      while (end != chain.end() && copy_ops[*end] == copy_ops[*begin]) {
+        ++end;
+      }
+      chains.emplace_back(begin, end);
+      copy_chains_.push_back(copy_ops[*begin]);
+      begin = end;
+    }
+  }
+  chains_ = std::move(chains);
+}
+
+void AsyncNetBase::computeInlineChains(const NetDef& net_def, Workspace* ws) {
+  std::vector<bool> cheap_ops(operators_.size(), false);
+  for (auto op_id = 0; op_id < operators_.size(); ++op_id) {
+    const auto* schema = OpSchemaRegistry::Schema(net_def.op(op_id).type());
+    cheap_ops[op_id] = schema && schema->cheap_to_run();
+  }
+
+  // Size based hints are only available when the inputs of the net are
+  // already in the workspace at net creation time
+  if (FLAGS_caffe2_net_async_inline_max_output_size > 0) {
+    try {
+      vector<std::unique_ptr<NetDef>> nets;
+      nets.emplace_back(new NetDef(net_def));
+      auto shapes = InferBlobShapesAndTypesFromWorkspace(ws, nets);
+      std::unordered_map<std::string, const TensorShape*> shape_map;
+      for (const auto& shape : shapes.shapes()) {
+        shape_map[shape.name()] = &shape;
+      }
+      for (auto op_id = 0; op_id < net_def.op_size(); ++op_id) {
+        const auto& op_def = net_def.op(op_id);
+        bool small = op_def.output_size() > 0;
+        for (const auto& output : op_def.output()) {
+          auto it = shape_map.find(output);
+          if (it == shape_map.end() || it->second->unknown_shape()) {
+            small = false;
+            break;
+          }
+          TIndex size = 1;
+          for (auto d : it->second->dims()) {
+            size *= d;
+          }
+          small &= size <= FLAGS_caffe2_net_async_inline_max_output_size;
+        }
+        cheap_ops[op_id] = cheap_ops[op_id] || small;
+      }
+    } catch (const std::exception& e) {
+      VLOG(1) << "Shape inference failed, using schema hints only: "
+              << e.what();
+    }
+  }
+
+  inline_chains_.resize(chains_.size());
+  for (auto task_id = 0; task_id < chains_.size(); ++task_id) {
+    bool can_inline = true;
+    for (auto op_id : chains_[task_id]) {
+      can_inline &= cheap_ops[op_id] &&
+          operators_[op_id]->device_option().device_type() == CPU;
+    }
+    inline_chains_[task_id] = can_inline;
+  }
+}
+
+std::string AsyncNetBase::poolKey(const DeviceOption& device_option) const {
+  auto key = DeviceTypeName(device_option.device_type());
+  if (thread_pool_type_.empty()) {
+    return key;
+  }
+  auto typed_key = key + "_" + thread_pool_type_;
+  if (ThreadPoolRegistry()->Has(typed_key)) {
+    return typed_key;
+  }
+  // Pool types are optional for non-CPU devices, e.g. GPU pools keep using
+  // device's default pool
+  CAFFE_ENFORCE(
+      device_option.device_type() != CPU,
+      "Unknown thread pool type: " + thread_pool_type_);
+  return key;
+}
+
+std::shared_ptr<TaskThreadPoolBase> AsyncNetBase::pool_getter(
+    std::vector<std::shared_ptr<TaskThreadPoolBase>>& pools,
     int pool_idx,
     const DeviceOption& device_option) {
   std::unique_lock<std::mutex> pools_lock(pools_mutex_);
   auto pool = pools[pool_idx];
   if (!pool) {
-    pool = ThreadPoolRegistry()->Create(
-        DeviceTypeName(device_option.device_type()), device_option);
+    pool = ThreadPoolRegistry()->Create(poolKey(device_option), device_option);
     pools[pool_idx] = pool;
   }
   return pool;
 }
 
-std::shared_ptr<TaskThreadPool> AsyncNetBase::pool(
+std::shared_ptr<TaskThreadPoolBase> AsyncNetBase::pool(
     const DeviceOption& device_option) {
   if (device_option.device_type() == CPU) {
     auto numa_node_id = device_option.numa_node_id();
@@ -119,6 +399,10 @@ int AsyncNetBase::stream(int task_id) {
     if (gpu_id >= stream_counters_.size()) {
       stream_counters_.resize(gpu_id + 1, 0);
     }
+    if (copy_chains_[task_id]) {
+      // Past the ids of the compute streams
+      return FLAGS_caffe2_streams_per_gpu;
+    }
     do {
       stream_id = stream_counters_[gpu_id]++;
       stream_counters_[gpu_id] %= FLAGS_caffe2_streams_per_gpu;
@@ -159,6 +443,10 @@ bool AsyncNetBase::canSchedule(
   return true;
 }
 
+bool AsyncNetBase::canRunInline(int task_id) const {
+  return inline_chains_[task_id];
+}
+
 int AsyncNetBase::tasksNum() const {
   return chains_.size();
 }
@@ -199,6 +487,8 @@ void AsyncNetBase::asyncWait(
 
 void AsyncNetBase::run(int task_id, int stream_id) {
   std::string err_msg;
+  const auto& net_name = name_.c_str();
+  CAFFE_SDT(chain_start, net_name, (void*)this, task_id, stream_id);
   for (auto& op_id : chains_[task_id]) {
     auto& op = operators_[op_id];
     try {
@@ -214,9 +504,15 @@ void AsyncNetBase::run(int task_id, int stream_id) {
     }
   }
 
+  if (!chain_numa_nodes_.empty() &&
+      taskDeviceOption(task_id).device_type() == CPU) {
+    updateNUMAStats(task_id);
+  }
+
   if (FLAGS_caffe2_net_async_finish_chain) {
     operators_[chains_[task_id].back()]->event().Finish();
   }
+  CAFFE_SDT(chain_done, net_name, (void*)this, task_id, stream_id);
 }
 
 void AsyncNetBase::finishTasks(const std::unordered_set<int>& task_ids) {
@@ -240,11 +536,11 @@ AsyncNetBase::~AsyncNetBase() {}
 
 CAFFE_DEFINE_SHARED_REGISTRY(
     ThreadPoolRegistry,
-    TaskThreadPool,
+    TaskThreadPoolBase,
     const DeviceOption&);
 
 namespace {
-std::shared_ptr<TaskThreadPool> AsyncNetCPUThreadPoolCreator(
+std::shared_ptr<TaskThreadPoolBase> AsyncNetCPUThreadPoolCreator(
     const DeviceOption& device_option) {
   CAFFE_ENFORCE_EQ(
       device_option.device_type(),
@@ -252,19 +548,35 @@ std::shared_ptr<TaskThreadPool> AsyncNetCPUThreadPoolCreator(
       "Unexpected device type for CPU thread pool");
   return GetAsyncNetCPUThreadPool(device_option.numa_node_id());
 }
-} // namespace
 
-CAFFE_REGISTER_CREATOR(ThreadPoolRegistry, CPU, AsyncNetCPUThreadPoolCreator);
+std::shared_ptr<TaskThreadPoolBase> AsyncNetCPUWorkStealingThreadPoolCreator(
+    const DeviceOption& device_option) {
+  CAFFE_ENFORCE_EQ(
+      device_option.device_type(),
+      CPU,
+      "Unexpected device type for CPU thread pool");
+  return GetAsyncNetCPUWorkStealingThreadPool(device_option.numa_node_id());
+}
 
-/* static */
-std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool(int numa_node_id) {
+std::shared_ptr<TaskThreadPoolBase> AsyncNetCPULockFreeThreadPoolCreator(
+    const DeviceOption& device_option) {
+  CAFFE_ENFORCE_EQ(
+      device_option.device_type(),
+      CPU,
+      "Unexpected device type for CPU thread pool");
+  return GetAsyncNetCPULockFreeThreadPool(device_option.numa_node_id());
+}
+
+// Pools are shared between nets, one pool of each type per NUMA node
+template <typename PoolType>
+std::shared_ptr<TaskThreadPoolBase> GetSharedCPUThreadPool(int numa_node_id) {
   // Note: numa_node_id = -1 (DeviceOption's default value) corresponds to
   // no NUMA used
-  static std::unordered_map<int, std::weak_ptr<TaskThreadPool>> pools;
+  static std::unordered_map<int, std::weak_ptr<TaskThreadPoolBase>> pools;
   static std::mutex pool_mutex;
   std::lock_guard<std::mutex> lock(pool_mutex);
 
-  std::shared_ptr<TaskThreadPool> shared_pool = nullptr;
+  std::shared_ptr<TaskThreadPoolBase> shared_pool = nullptr;
   if (pools.count(numa_node_id)) {
     shared_pool = pools.at(numa_node_id).lock();
   }
@@ -276,10 +588,38 @@ std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool(int numa_node_id) {
       pool_size = num_cores;
     }
     LOG(INFO) << "Using cpu pool size: " << pool_size;
-    shared_pool = std::make_shared<TaskThreadPool>(pool_size, numa_node_id);
+    shared_pool = std::make_shared<PoolType>(pool_size, numa_node_id);
     pools[numa_node_id] = shared_pool;
   }
   return shared_pool;
 }
+} // namespace
+
+CAFFE_REGISTER_CREATOR(ThreadPoolRegistry, CPU, AsyncNetCPUThreadPoolCreator);
+CAFFE_REGISTER_CREATOR(
+    ThreadPoolRegistry,
+    CPU_work_stealing,
+    AsyncNetCPUWorkStealingThreadPoolCreator);
+CAFFE_REGISTER_CREATOR(
+    ThreadPoolRegistry,
+    CPU_lock_free,
+    AsyncNetCPULockFreeThreadPoolCreator);
+
+/* static */
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUThreadPool(int numa_node_id) {
+  return GetSharedCPUThreadPool<TaskThreadPool>(numa_node_id);
+}
+
+/* static */
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUWorkStealingThreadPool(
+    int numa_node_id) {
+  return GetSharedCPUThreadPool<WorkStealingThreadPool>(numa_node_id);
+}
+
+/* static */
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPULockFreeThreadPool(
+    int numa_node_id) {
+  return GetSharedCPUThreadPool<LockFreeThreadPool>(numa_node_id);
+}
 
 } // namespace caffe2
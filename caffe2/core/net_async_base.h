@@ -27,11 +27,19 @@ class AsyncNetBase : public NetBase {
     return operators_;
   }
 
+  const std::vector<std::vector<int>>& TEST_chains() const {
+    return chains_;
+  }
+
  protected:
   bool canSchedule(
       int chain_id,
       const std::vector<EventStatus>* status = nullptr);
 
+  // Whether the chain consists of cheap CPU ops only, so that it can be run
+  // right away on the thread that finished its last parent
+  bool canRunInline(int task_id) const;
+
   int tasksNum() const;
   Event& event(int task_id) const;
   EventStatus query(int task_id) const;
@@ -43,41 +51,83 @@ class AsyncNetBase : public NetBase {
       const std::vector<int>& wait_task_ids) const;
   void run(int task_id, int stream_id);
   int stream(int task_id);
-  std::shared_ptr<TaskThreadPool> pool(const DeviceOption& device_option);
+  std::shared_ptr<TaskThreadPoolBase> pool(const DeviceOption& device_option);
+  // Device option of the task's event, with the NUMA node chosen by the
+  // placement pass for CPU tasks
+  const DeviceOption& taskDeviceOption(int task_id) const;
 
   void finishTasks(const std::unordered_set<int>& task_ids);
   void finalizeEvents();
 
   bool isStreamFree(int task_id, int stream_id) const;
 
+  // ThreadPoolRegistry key of the pool used for the given device
+  std::string poolKey(const DeviceOption& device_option) const;
+
   // Operator/task graph
   std::vector<OperatorBase*> operators_;
   std::vector<dag_utils::OperatorNode> operator_nodes_;
   std::vector<std::vector<int>> chains_;
   std::vector<dag_utils::OpGraphNode> chain_nodes_; // chains' parents/children
+  std::vector<bool> inline_chains_;
+  // Chains of host to device copies, run on a dedicated stream of their GPU
+  std::vector<bool> copy_chains_;
+
+  // NUMA placement, empty when disabled
+  std::vector<int> chain_numa_nodes_;
+  std::vector<DeviceOption> task_device_options_;
+  // Inputs of every chain produced by a chain placed on another node
+  std::vector<std::vector<const Blob*>> cross_node_inputs_;
+  // Last seen data pointer of every output of every op, to pin the outputs
+  // to the chain's node only when they are reallocated
+  std::vector<std::vector<const void*>> pinned_outputs_;
+
+  struct AsyncNetNUMAStats {
+    CAFFE_STAT_CTOR(AsyncNetNUMAStats);
+    CAFFE_EXPORTED_STAT(cross_node_reads);
+    CAFFE_EXPORTED_STAT(cross_node_read_bytes);
+    CAFFE_EXPORTED_STAT(pinned_bytes);
+  } numa_stats_;
 
   // Pools and streams
+  // Optional pool type (e.g. "work_stealing"), set through the
+  // "thread_pool_type" net argument or the corresponding flag
+  std::string thread_pool_type_;
   std::mutex pools_mutex_;
-  std::shared_ptr<TaskThreadPool> cpu_pool_;
-  std::vector<std::shared_ptr<TaskThreadPool>> cpu_pools_;
-  std::vector<std::shared_ptr<TaskThreadPool>> gpu_pools_;
+  std::shared_ptr<TaskThreadPoolBase> cpu_pool_;
+  std::vector<std::shared_ptr<TaskThreadPoolBase>> cpu_pools_;
+  std::vector<std::shared_ptr<TaskThreadPoolBase>> gpu_pools_;
   static thread_local std::vector<int> stream_counters_;
 
   DISABLE_COPY_AND_ASSIGN(AsyncNetBase);
 
  private:
-  std::shared_ptr<TaskThreadPool> pool_getter(
-      std::vector<std::shared_ptr<TaskThreadPool>>& pools,
+  // Splits the chains at the boundaries between CopyCPUToGPU ops and other
+  // ops, so that the copies can overlap with the compute of other chains
+  void computeCopyChains(const NetDef& net_def);
+  void computeInlineChains(const NetDef& net_def, Workspace* ws);
+  // Partitions CPU chains across NUMA nodes, minimizing cross-node edges
+  void computeNUMAPlacement(const NetDef& net_def, int num_nodes);
+  void updateNUMAStats(int task_id);
+
+  std::shared_ptr<TaskThreadPoolBase> pool_getter(
+      std::vector<std::shared_ptr<TaskThreadPoolBase>>& pools,
       int pool_idx,
       const DeviceOption& device_option);
 };
 
 CAFFE_DECLARE_SHARED_REGISTRY(
     ThreadPoolRegistry,
-    TaskThreadPool,
+    TaskThreadPoolBase,
     const DeviceOption&);
 
-std::shared_ptr<TaskThreadPool> GetAsyncNetCPUThreadPool(int numa_node_id);
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUThreadPool(int numa_node_id);
+
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPUWorkStealingThreadPool(
+    int numa_node_id);
+
+std::shared_ptr<TaskThreadPoolBase> GetAsyncNetCPULockFreeThreadPool(
+    int numa_node_id);
 
 } // namespace caffe2
 
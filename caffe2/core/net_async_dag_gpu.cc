@@ -32,6 +32,8 @@ CAFFE2_DECLARE_int(caffe2_streams_per_gpu);
 
 CAFFE2_DECLARE_bool(caffe2_net_async_check_stream_status);
 
+CAFFE2_DECLARE_bool(caffe2_net_async_copy_stream);
+
 namespace caffe2 {
 
 thread_local std::vector<int> AsyncDAGNet::stream_counters_;
@@ -105,6 +107,20 @@ AsyncDAGNet::AsyncDAGNet(
       events_.push_back(&operator_nodes_[tail_op_idx].operator_->event());
     }
   }
+  ArgumentHelper helper(*net_def);
+  if (helper.GetSingleArgument<bool>(
+          "copy_stream", FLAGS_caffe2_net_async_copy_stream)) {
+    for (const auto& chain : execution_chains_) {
+      bool copies_only = true;
+      for (auto idx : chain.second) {
+        const auto& type = net_def->op(idx).type();
+        copies_only &= type == "CopyCPUToGPU" || type == "CopyFromCPUInput";
+      }
+      if (copies_only) {
+        copy_chains_.insert(chain.first);
+      }
+    }
+  }
   VLOG(1) << "Total " << execution_chains_.size()
           << " chains, final waiting on " << events_.size() << " events";
 }
@@ -141,7 +157,10 @@ bool AsyncDAGNet::RunAt(int chain_id, const std::vector<int>& chain) {
       "None of the parent is recorded for an event.");
 
   int stream_id = 0;
-  if (FLAGS_caffe2_async_dag_use_multiple_streams) {
+  if (copy_chains_.count(source_idx)) {
+    // Past the ids of the compute streams
+    stream_id = FLAGS_caffe2_streams_per_gpu;
+  } else if (FLAGS_caffe2_async_dag_use_multiple_streams) {
     stream_id = stream(
         operator_nodes_[source_idx].operator_->event().GetDeviceOption());
   }
@@ -1,6 +1,8 @@
 #ifndef CAFFE2_CORE_NET_ASYNC_DAG_GPU_H_
 #define CAFFE2_CORE_NET_ASYNC_DAG_GPU_H_
 
+#include <unordered_set>
+
 #include "caffe2/core/common.h"
 #include "caffe2/core/net_dag.h"
 #include "caffe2/core/workspace.h"
@@ -29,6 +31,10 @@ class AsyncDAGNet : public DAGNetBase {
   // RunAt() iteration.
   std::vector<int32_t> eventRecorded_;
 
+  // Source ops of the chains made of host to device copies only, which run
+  // on a dedicated stream of their GPU
+  std::unordered_set<int> copy_chains_;
+
   int stream(const DeviceOption& device_option);
   static thread_local std::vector<int> stream_counters_;
 
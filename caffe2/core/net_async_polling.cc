@@ -1,6 +1,7 @@
 #include "caffe2/core/net_async_polling.h"
 
 #include "caffe2/core/operator.h"
+#include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
 
 CAFFE2_DECLARE_bool(caffe2_dag_net_collect_stats);
@@ -50,10 +51,12 @@ bool AsyncPollingNet::DoRunAsync() {
 }
 
 void AsyncPollingNet::schedule(int task_id) {
+  const auto& net_name = name_.c_str();
+  CAFFE_SDT(chain_scheduled, net_name, (void*)this, task_id);
   if (FLAGS_caffe2_dag_net_collect_stats) {
     task_timers_[task_id]->Start();
   }
-  const auto& device_option = event(task_id).GetDeviceOption();
+  const auto& device_option = taskDeviceOption(task_id);
   pool(device_option)->run([this, task_id, device_option]() {
     int stream_id = stream(task_id);
 
@@ -170,7 +173,7 @@ bool AsyncPollingNet::pollAndSchedule() {
 }
 
 void AsyncPollingNet::updateTaskStats(int task_id) {
-  const auto& device_option = event(task_id).GetDeviceOption();
+  const auto& device_option = taskDeviceOption(task_id);
   if (status_[task_id] == EventStatus::EVENT_SCHEDULED) {
     CAFFE_EVENT(
         stats_[device_option.device_type()],
@@ -1,5 +1,7 @@
 #include "caffe2/core/net_async_scheduling.h"
 
+#include "caffe2/core/static_tracepoint.h"
+
 CAFFE2_DEFINE_bool(
     caffe2_net_async_always_schedule_child,
     false,
@@ -10,7 +12,7 @@ namespace caffe2 {
 AsyncSchedulingNet::AsyncSchedulingNet(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : AsyncNetBase(net_def, ws), running_(false) {
+    : AsyncNetBase(net_def, ws), running_(false), stats_(net_def->name()) {
   reset();
 }
 
@@ -35,71 +37,102 @@ void AsyncSchedulingNet::Wait() {
 }
 
 void AsyncSchedulingNet::schedule(int task_id) {
-  const auto& device_option = event(task_id).GetDeviceOption();
+  const auto& net_name = name_.c_str();
+  CAFFE_SDT(chain_scheduled, net_name, (void*)this, task_id);
+  const auto& device_option = taskDeviceOption(task_id);
   pool(device_option)->run([this, task_id]() {
-    if (success_) {
-      int stream_id = stream(task_id);
-      asyncWait(task_id, stream_id, parents(task_id));
-      try {
-        run(task_id, stream_id);
-      } catch (const std::exception& e) {
-        std::unique_lock<std::mutex> lock(exception_mutex_);
-        exception_messages_.push_back(e.what());
-        success_ = false;
-      }
+    // Cheap children are run on this thread after their parent, one at a
+    // time, instead of going through the pool
+    auto next_task_id = task_id;
+    while (next_task_id >= 0) {
+      next_task_id = runTask(next_task_id);
     }
+  });
+}
 
-    auto task_count = ++processed_tasks_num_;
-
-    for (auto child_id : children(task_id)) {
-      int parent_count = updateParentCount(child_id);
-      if (parent_count == 0) {
-        if (cleanup_ || FLAGS_caffe2_net_async_always_schedule_child ||
-            canSchedule(child_id)) {
-          schedule(child_id);
-        } else {
-          const auto& device_option = event(child_id).GetDeviceOption();
-          pool(device_option)
-              ->run(std::bind(
-                  &AsyncSchedulingNet::pollAndSchedule, this, child_id));
-        }
-      }
+int AsyncSchedulingNet::runTask(int task_id) {
+  if (success_) {
+    int stream_id = stream(task_id);
+    asyncWait(task_id, stream_id, parents(task_id));
+    try {
+      run(task_id, stream_id);
+    } catch (const std::exception& e) {
+      std::unique_lock<std::mutex> lock(exception_mutex_);
+      exception_messages_.push_back(e.what());
+      success_ = false;
     }
+  }
 
-    if (success_) {
-      if (task_count == tasksNum()) {
-        // All tasks are finished, polling thread is sleeping;
-        // only one thread enters here
-        finalizeEvents();
-        finishRun();
-        return;
-      }
-    } else {
-      // Before setting running_ to false and notifying waiters we need to
-      // 1. Ensure that only one thread does the cleanup
-      // 2. Ensure that all other pending tasks in workers and polling threads
-      //    are finished and
-      // 3. Ensure that all tasks that were not scheduled have their events set
-      {
-        std::unique_lock<std::mutex> cleanup_lock(cleanup_mutex_);
-        if (cleanup_) {
-          return;
-        }
-        cleanup_ = true;
-      }
-
-      // Errors are not recoverable and happen in exceptional cases,
-      // ok to busy wait
-      while (processed_tasks_num_ != tasksNum()) {
+  auto task_count = ++processed_tasks_num_;
+
+  int inline_child_id = -1;
+  for (auto child_id : children(task_id)) {
+    int parent_count = updateParentCount(child_id);
+    if (parent_count == 0) {
+      // Inline children have to stay on the NUMA node of their parent
+      if (inline_child_id < 0 && !cleanup_ && success_ &&
+          canRunInline(child_id) && canSchedule(child_id) &&
+          taskDeviceOption(child_id).numa_node_id() ==
+              taskDeviceOption(task_id).numa_node_id()) {
+        inline_child_id = child_id;
+      } else if (
+          cleanup_ || FLAGS_caffe2_net_async_always_schedule_child ||
+          canSchedule(child_id)) {
+        schedule(child_id);
+      } else {
+        const auto& device_option = taskDeviceOption(child_id);
+        pool(device_option)
+            ->run(std::bind(
+                &AsyncSchedulingNet::pollAndSchedule, this, child_id));
       }
+    }
+  }
 
-      // Make sure all events are set, wait for scheduled events
+  if (success_) {
+    if (task_count == tasksNum()) {
+      // All tasks are finished, polling thread is sleeping;
+      // only one thread enters here
       finalizeEvents();
-
-      // Notify observers and waiters
       finishRun();
+      return -1;
     }
-  });
+  } else {
+    // The inlined child has to be accounted for before the cleanup
+    if (inline_child_id >= 0) {
+      schedule(inline_child_id);
+      inline_child_id = -1;
+    }
+    // Before setting running_ to false and notifying waiters we need to
+    // 1. Ensure that only one thread does the cleanup
+    // 2. Ensure that all other pending tasks in workers and polling threads
+    //    are finished and
+    // 3. Ensure that all tasks that were not scheduled have their events set
+    {
+      std::unique_lock<std::mutex> cleanup_lock(cleanup_mutex_);
+      if (cleanup_) {
+        return -1;
+      }
+      cleanup_ = true;
+    }
+
+    // Errors are not recoverable and happen in exceptional cases,
+    // ok to busy wait
+    while (processed_tasks_num_ != tasksNum()) {
+    }
+
+    // Make sure all events are set, wait for scheduled events
+    finalizeEvents();
+
+    // Notify observers and waiters
+    finishRun();
+    return -1;
+  }
+
+  if (inline_child_id >= 0) {
+    CAFFE_EVENT(stats_, inlined_chains);
+    CAFFE_EVENT(stats_, inlined_ops, chains_[inline_child_id].size());
+  }
+  return inline_child_id;
 }
 
 void AsyncSchedulingNet::pollAndSchedule(int task_id) {
@@ -107,7 +140,7 @@ void AsyncSchedulingNet::pollAndSchedule(int task_id) {
     // force schedule the rest of the tasks if cleanup is started
     schedule(task_id);
   } else {
-    const auto& device_option = event(task_id).GetDeviceOption();
+    const auto& device_option = taskDeviceOption(task_id);
     pool(device_option)
         ->run(std::bind(&AsyncSchedulingNet::pollAndSchedule, this, task_id));
   }
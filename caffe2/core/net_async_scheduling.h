@@ -19,6 +19,9 @@ class AsyncSchedulingNet : public AsyncNetBase {
 
   void pollAndSchedule(int task_id);
   void schedule(int task_id);
+  // Runs the task and schedules its children, returns the child to be run
+  // inline next or -1
+  int runTask(int task_id);
   void reset();
   virtual void finishRun();
   int updateParentCount(int child_id);
@@ -35,6 +38,12 @@ class AsyncSchedulingNet : public AsyncNetBase {
   std::mutex exception_mutex_;
   std::vector<std::string> exception_messages_;
 
+  struct AsyncSchedulingNetStats {
+    CAFFE_STAT_CTOR(AsyncSchedulingNetStats);
+    CAFFE_EXPORTED_STAT(inlined_chains);
+    CAFFE_EXPORTED_STAT(inlined_ops);
+  } stats_;
+
   DISABLE_COPY_AND_ASSIGN(AsyncSchedulingNet);
 };
 
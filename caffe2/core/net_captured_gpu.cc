@@ -0,0 +1,191 @@
+#include "caffe2/core/net_captured_gpu.h"
+
+#include <cstring>
+#include <unordered_set>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+CapturedNet::CapturedNet(
+    const std::shared_ptr<const NetDef>& net_def,
+    Workspace* ws)
+    : SimpleNet(net_def, ws) {
+  capturable_ = !operators_.empty();
+  std::unordered_set<const Blob*> seen;
+  for (const auto& op : operators_) {
+    const auto& option = op->device_option();
+    if (option.device_type() != CUDA ||
+        (gpu_id_ >= 0 && option.cuda_gpu_id() != gpu_id_)) {
+      capturable_ = false;
+    }
+    gpu_id_ = option.cuda_gpu_id();
+    for (const Blob* blob : op->Inputs()) {
+      if (seen.insert(blob).second) {
+        blobs_.push_back(blob);
+      }
+    }
+    for (const Blob* blob : op->Outputs()) {
+      if (seen.insert(blob).second) {
+        blobs_.push_back(blob);
+      }
+    }
+  }
+#if CUDA_VERSION < 10010
+  capturable_ = false;
+#endif // CUDA_VERSION < 10010
+  if (!capturable_) {
+    LOG(INFO) << "Net " << name_ << " is not captured, it needs CUDA 10.1 "
+              << "and all its operators on the same GPU";
+  }
+}
+
+CapturedNet::~CapturedNet() {
+  ResetGraph();
+}
+
+bool CapturedNet::IsCaptured() const {
+#if CUDA_VERSION >= 10010
+  return graph_exec_ != nullptr;
+#else // CUDA_VERSION >= 10010
+  return false;
+#endif // CUDA_VERSION >= 10010
+}
+
+bool CapturedNet::BlobState::operator==(const BlobState& other) const {
+  return blob_type == other.blob_type && data_type == other.data_type &&
+      dims == other.dims && data == other.data &&
+      host_contents == other.host_contents;
+}
+
+std::vector<CapturedNet::BlobState> CapturedNet::GetBlobStates() const {
+  std::vector<BlobState> states(blobs_.size());
+  for (int i = 0; i < blobs_.size(); ++i) {
+    const Blob* blob = blobs_[i];
+    auto& state = states[i];
+    state.blob_type = blob->meta().id();
+    state.data_type = 0;
+    state.data = nullptr;
+    if (blob->IsType<TensorCUDA>()) {
+      const auto& tensor = blob->Get<TensorCUDA>();
+      state.data_type = tensor.meta().id();
+      state.dims = tensor.dims();
+      state.data = tensor.capacity_nbytes() > 0 ? tensor.raw_data() : nullptr;
+    } else if (blob->IsType<TensorCPU>()) {
+      const auto& tensor = blob->Get<TensorCPU>();
+      state.data_type = tensor.meta().id();
+      state.dims = tensor.dims();
+      state.data = tensor.capacity_nbytes() > 0 ? tensor.raw_data() : nullptr;
+      if (state.data && !tensor.meta().copy()) {
+        const char* data = static_cast<const char*>(state.data);
+        state.host_contents.assign(data, data + tensor.nbytes());
+      }
+    } else {
+      // Other blobs, like the common worlds of collective operators, are
+      // only compared by address
+      state.data = blob->GetRaw();
+    }
+  }
+  return states;
+}
+
+bool CapturedNet::DoRun() {
+  if (!capturable_) {
+    return SimpleNet::DoRun();
+  }
+  const auto states = GetBlobStates();
+  const bool unchanged = has_last_states_ && states == last_states_;
+  if (!unchanged) {
+    ResetGraph();
+  } else if (IsCaptured()) {
+    return Replay();
+  }
+  // The first run with the blobs of the previous run is captured, the runs
+  // after a change run the operators to let them allocate their outputs
+  bool result = unchanged ? CaptureAndRun() : SimpleNet::DoRun();
+  last_states_ = GetBlobStates();
+  has_last_states_ = result;
+  if (last_states_ != states) {
+    // Something was allocated during the capture, the launches point to
+    // memory the blobs do not hold anymore
+    ResetGraph();
+  }
+  return result;
+}
+
+bool CapturedNet::RunAsync() {
+  return Run();
+}
+
+bool CapturedNet::CaptureAndRun() {
+#if CUDA_VERSION >= 10010
+  DeviceGuard guard(gpu_id_);
+  const cudaStream_t stream = CUDAContext::cuda_stream(gpu_id_, 0);
+  // Nothing of the previous runs must be captured
+  CUDA_ENFORCE(cudaStreamSynchronize(stream));
+  CUDA_ENFORCE(cudaStreamBeginCapture(stream, cudaStreamCaptureModeRelaxed));
+  bool recorded = true;
+  try {
+    for (auto& op : operators_) {
+      // RunAsync does not wait for the stream, which is not allowed while it
+      // is captured
+      if (!op->RunAsync(0)) {
+        recorded = false;
+        break;
+      }
+    }
+  } catch (const std::exception& e) {
+    VLOG(1) << "Capture of net " << name_ << " failed: " << e.what();
+    recorded = false;
+  }
+  cudaGraph_t graph = nullptr;
+  recorded = cudaStreamEndCapture(stream, &graph) == cudaSuccess && recorded;
+  if (recorded) {
+    recorded = cudaGraphInstantiate(&graph_exec_, graph, nullptr, nullptr, 0) ==
+        cudaSuccess;
+  }
+  if (graph) {
+    cudaGraphDestroy(graph);
+  }
+  if (recorded) {
+    return Replay();
+  }
+  // Nothing ran, the operators run again without capture, which reports
+  // their errors
+  cudaGetLastError();
+  graph_exec_ = nullptr;
+  capturable_ = false;
+  LOG(WARNING) << "Net " << name_ << " cannot be captured, it runs as a "
+               << "simple net";
+#endif // CUDA_VERSION >= 10010
+  return SimpleNet::DoRun();
+}
+
+bool CapturedNet::Replay() {
+#if CUDA_VERSION >= 10010
+  StartAllObservers();
+  DeviceGuard guard(gpu_id_);
+  const cudaStream_t stream = CUDAContext::cuda_stream(gpu_id_, 0);
+  CUDA_ENFORCE(cudaGraphLaunch(graph_exec_, stream));
+  // Like the operators of a simple net, the net finishes before returning
+  CUDA_ENFORCE(cudaStreamSynchronize(stream));
+  StopAllObservers();
+  return true;
+#else // CUDA_VERSION >= 10010
+  CAFFE_THROW("CUDA graphs need CUDA 10.1");
+#endif // CUDA_VERSION >= 10010
+}
+
+void CapturedNet::ResetGraph() {
+#if CUDA_VERSION >= 10010
+  if (graph_exec_) {
+    cudaGraphExecDestroy(graph_exec_);
+    graph_exec_ = nullptr;
+  }
+#endif // CUDA_VERSION >= 10010
+}
+
+REGISTER_NET(captured, CapturedNet);
+
+} // namespace caffe2
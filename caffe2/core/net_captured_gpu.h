@@ -0,0 +1,71 @@
+#ifndef CAFFE2_CORE_NET_CAPTURED_GPU_H_
+#define CAFFE2_CORE_NET_CAPTURED_GPU_H_
+
+#include <vector>
+
+#include "caffe2/core/common_gpu.h"
+#include "caffe2/core/net_simple.h"
+
+namespace caffe2 {
+
+// A simple net that records the kernels and copies its CUDA operators launch
+// into a CUDA graph, and then replays the graph instead of running the
+// operators, which saves most of the host work of a run.
+//
+// Launches only stay valid for the tensors they were recorded with, so
+// before every run the net compares the shapes, types and data pointers of
+// the blobs its operators read and write (and the contents of CPU tensors,
+// which operators may read on the host) with those of the end of the
+// previous run. A graph is captured on the second run with the same blobs,
+// replayed while they do not change, and dropped when they do, the net then
+// running its operators again until the blobs settle. This covers nets with
+// fixed shapes, but not operators whose launches depend on host state that
+// changes between runs, like the iteration counter of a training net.
+//
+// All the operators must run on the same GPU, and capture needs CUDA 10.1;
+// otherwise, or if capture fails, for example for an operator that
+// synchronizes with the host, the net runs as a simple net.
+class CapturedNet : public SimpleNet {
+ public:
+  CapturedNet(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
+  ~CapturedNet();
+
+  // For tests
+  bool IsCaptured() const;
+
+ protected:
+  bool DoRun() override;
+  bool RunAsync() override;
+
+ private:
+  // What the launches of the operators depend on for one blob
+  struct BlobState {
+    CaffeTypeId blob_type;
+    CaffeTypeId data_type;
+    std::vector<TIndex> dims;
+    const void* data;
+    std::vector<char> host_contents;
+
+    bool operator==(const BlobState& other) const;
+  };
+
+  std::vector<BlobState> GetBlobStates() const;
+  bool CaptureAndRun();
+  bool Replay();
+  void ResetGraph();
+
+  std::vector<const Blob*> blobs_;
+  int gpu_id_ = -1;
+  bool capturable_ = false;
+  bool has_last_states_ = false;
+  std::vector<BlobState> last_states_;
+#if CUDA_VERSION >= 10010
+  cudaGraphExec_t graph_exec_ = nullptr;
+#endif // CUDA_VERSION >= 10010
+
+  DISABLE_COPY_AND_ASSIGN(CapturedNet);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_CAPTURED_GPU_H_
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net_captured_gpu.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+const char kCapturedNet[] = R"NET(
+  name: "captured_test"
+  type: "captured"
+  device_option {
+    device_type: 1
+  }
+  op {
+    input: "X"
+    output: "Y"
+    type: "Scale"
+    arg {
+      name: "scale"
+      f: 2.0
+    }
+  }
+  op {
+    input: "X"
+    input: "Y"
+    output: "Z"
+    type: "Add"
+  }
+)NET";
+
+// Copies values to X on the GPU, reallocating it only if its size changes
+void SetX(Workspace* ws, const std::vector<float>& values) {
+  TensorCPU X_cpu(std::vector<TIndex>{static_cast<TIndex>(values.size())});
+  std::copy(values.begin(), values.end(), X_cpu.mutable_data<float>());
+  ws->CreateBlob("X")->GetMutable<TensorCUDA>()->CopyFrom(X_cpu);
+}
+
+void CheckZ(Workspace* ws, const std::vector<float>& values) {
+  TensorCPU Z(ws->GetBlob("Z")->Get<TensorCUDA>());
+  ASSERT_EQ(Z.size(), values.size());
+  for (int i = 0; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(Z.data<float>()[i], 3 * values[i]);
+  }
+}
+
+} // namespace
+
+TEST(CapturedNetTest, ReplaysWhileTheBlobsDoNotChange) {
+  if (!HasCudaGPU()) return;
+  Workspace ws;
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kCapturedNet, &net_def));
+  SetX(&ws, {1, 2, 3});
+  NetBase* net = ws.CreateNet(net_def);
+  auto* captured = dynamic_cast<CapturedNet*>(net);
+  ASSERT_NE(captured, nullptr);
+#if CUDA_VERSION >= 10010
+  const bool can_capture = true;
+#else // CUDA_VERSION >= 10010
+  const bool can_capture = false;
+#endif // CUDA_VERSION >= 10010
+
+  // The first run allocates the outputs, the second is captured
+  ASSERT_TRUE(net->Run());
+  EXPECT_FALSE(captured->IsCaptured());
+  CheckZ(&ws, {1, 2, 3});
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(captured->IsCaptured(), can_capture);
+  CheckZ(&ws, {1, 2, 3});
+
+  // New values in the same memory are replayed
+  SetX(&ws, {4, 5, 6});
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(captured->IsCaptured(), can_capture);
+  CheckZ(&ws, {4, 5, 6});
+
+  // A new shape drops the graph until the blobs settle
+  SetX(&ws, {7, 8, 9, 10, 11});
+  ASSERT_TRUE(net->Run());
+  EXPECT_FALSE(captured->IsCaptured());
+  CheckZ(&ws, {7, 8, 9, 10, 11});
+  ASSERT_TRUE(net->Run());
+  EXPECT_EQ(captured->IsCaptured(), can_capture);
+  ASSERT_TRUE(net->Run());
+  CheckZ(&ws, {7, 8, 9, 10, 11});
+}
+
+TEST(CapturedNetTest, RunsCPUNetsAsSimpleNets) {
+  Workspace ws;
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kCapturedNet, &net_def));
+  net_def.mutable_device_option()->set_device_type(CPU);
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(2);
+  X->mutable_data<float>()[0] = 1;
+  X->mutable_data<float>()[1] = 2;
+  NetBase* net = ws.CreateNet(net_def);
+  auto* captured = dynamic_cast<CapturedNet*>(net);
+  ASSERT_NE(captured, nullptr);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(net->Run());
+    EXPECT_FALSE(captured->IsCaptured());
+  }
+  const auto& Z = ws.GetBlob("Z")->Get<TensorCPU>();
+  EXPECT_FLOAT_EQ(Z.data<float>()[0], 3);
+  EXPECT_FLOAT_EQ(Z.data<float>()[1], 6);
+}
+
+} // namespace caffe2
@@ -1,11 +1,13 @@
 #include "caffe2/core/net_dag.h"
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <stack>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/net_template.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
@@ -22,21 +24,71 @@ CAFFE2_DEFINE_bool(
     false,
     "Collect time stats in DAG net");
 
+CAFFE2_DEFINE_bool(
+    caffe2_dag_net_priority_scheduling,
+    false,
+    "Run ready chains with the longest critical path first in DAG net");
+
+CAFFE2_DEFINE_int(
+    caffe2_dag_net_priority_measure_iters,
+    3,
+    "Number of first runs used to measure chain costs for priority "
+    "scheduling (0 - use schema cost functions only)");
+
 namespace caffe2 {
 
+void ReadyChainQueue::push(int idx) {
+  if (!priorities_) {
+    fifo_.push(idx);
+    return;
+  }
+  heap_.push_back(idx);
+  std::push_heap(heap_.begin(), heap_.end(), [this](int a, int b) {
+    return (*priorities_)[a] < (*priorities_)[b];
+  });
+}
+
+const int& ReadyChainQueue::front() const {
+  return priorities_ ? heap_.front() : fifo_.front();
+}
+
+void ReadyChainQueue::pop() {
+  if (!priorities_) {
+    fifo_.pop();
+    return;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), [this](int a, int b) {
+    return (*priorities_)[a] < (*priorities_)[b];
+  });
+  heap_.pop_back();
+}
+
 DAGNetBase::DAGNetBase(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws)
-    : NetBase(net_def, ws), caught_exception_yet_(false), iter_(0) {
+    : NetBase(net_def, ws),
+      caught_exception_yet_(false),
+      iter_(0),
+      priority_scheduling_(false),
+      measured_iters_(0) {
   // Blob creator allows us to track which operator created which blob.
   VLOG(1) << "Constructing DAGNet " << net_def->name();
 
   operator_nodes_ = dag_utils::prepareOperatorNodes(net_def, ws);
 
-  execution_chains_ =
-      (FLAGS_caffe2_disable_chaining
-           ? dag_utils::singleChains(operator_nodes_)
-           : dag_utils::computeChains(operator_nodes_));
+  auto* net_template = NetTemplate::Find(*net_def);
+  const auto chains = net_template ? net_template->chains() : nullptr;
+  if (chains) {
+    execution_chains_ = dag_utils::reuseChains(operator_nodes_, *chains);
+  } else {
+    execution_chains_ =
+        (FLAGS_caffe2_disable_chaining
+             ? dag_utils::singleChains(operator_nodes_)
+             : dag_utils::computeChains(operator_nodes_));
+    if (net_template) {
+      net_template->RecordChains(execution_chains_);
+    }
+  }
 
   operators_.reserve(operator_nodes_.size());
   for (const auto& node : operator_nodes_) {
@@ -79,6 +131,65 @@ DAGNetBase::DAGNetBase(
         "dag_net/stats/" + net_def->name() + "/" +
         caffe2::DeviceTypeName(device_idx));
   }
+
+  ArgumentHelper helper(*net_def);
+  priority_scheduling_ = helper.GetSingleArgument<bool>(
+      "priority_scheduling", FLAGS_caffe2_dag_net_priority_scheduling);
+  if (priority_scheduling_) {
+    InitPriorities(*net_def, ws);
+  }
+}
+
+void DAGNetBase::InitPriorities(const NetDef& net_def, Workspace* ws) {
+  // Until chains are measured, use FLOPs from the schema cost functions,
+  // when the inputs are known at net creation time, or else a unit cost
+  op_costs_.assign(operator_nodes_.size(), 1.0);
+  try {
+    vector<std::unique_ptr<NetDef>> nets;
+    nets.emplace_back(new NetDef(net_def));
+    auto shapes = InferBlobShapesAndTypesFromWorkspace(ws, nets);
+    std::unordered_map<std::string, const TensorShape*> shape_map;
+    for (const auto& shape : shapes.shapes()) {
+      shape_map[shape.name()] = &shape;
+    }
+    for (int idx = 0; idx < net_def.op_size(); ++idx) {
+      const auto& op_def = net_def.op(idx);
+      const auto* schema = OpSchemaRegistry::Schema(op_def.type());
+      if (!schema || !schema->HasCostInferenceFunction()) {
+        continue;
+      }
+      vector<TensorShape> input_shapes;
+      for (const auto& input : op_def.input()) {
+        auto it = shape_map.find(input);
+        if (it == shape_map.end() || it->second->unknown_shape()) {
+          break;
+        }
+        input_shapes.push_back(*it->second);
+      }
+      if (input_shapes.size() == op_def.input_size()) {
+        auto cost = schema->InferCost(op_def, input_shapes);
+        op_costs_[idx] = std::max<double>(1.0, cost.flops);
+      }
+    }
+  } catch (const std::exception& e) {
+    VLOG(1) << "Cost inference failed, using unit costs: " << e.what();
+  }
+  measured_chain_time_us_.assign(operator_nodes_.size(), 0);
+  priorities_ =
+      dag_utils::computeCriticalPathLengths(operator_nodes_, op_costs_);
+}
+
+void DAGNetBase::UpdatePriorities() {
+  // Called between runs, when no chain is queued
+  if (++measured_iters_ < FLAGS_caffe2_dag_net_priority_measure_iters) {
+    return;
+  }
+  for (int idx = 0; idx < operator_nodes_.size(); ++idx) {
+    op_costs_[idx] = measured_chain_time_us_[idx] / measured_iters_;
+  }
+  priorities_ =
+      dag_utils::computeCriticalPathLengths(operator_nodes_, op_costs_);
+  VLOG(1) << "Updated chain priorities from " << measured_iters_ << " runs";
 }
 
 DAGNetBase::~DAGNetBase() {
@@ -102,7 +213,8 @@ bool DAGNetBase::DoRunAsync() {
   success_ = true;
   iter_++;
   if (!job_queue_) {
-    job_queue_ = caffe2::make_unique<SimpleQueue<int>>();
+    job_queue_ = caffe2::make_unique<SimpleQueue<int, ReadyChainQueue>>(
+        ReadyChainQueue(priority_scheduling_ ? &priorities_ : nullptr));
   }
   // Figure out number of workers to start.
   auto num_workers_to_start = num_workers_ - workers_.size();
@@ -165,6 +277,11 @@ bool DAGNetBase::DoRunAsync() {
         ") has some runtime parents left.");
   }
 
+  if (priority_scheduling_ &&
+      measured_iters_ < FLAGS_caffe2_dag_net_priority_measure_iters) {
+    UpdatePriorities();
+  }
+
   StopAllObservers();
   // If the above while loop finished, we know that the current run finished.
   return success_;
@@ -221,9 +338,15 @@ void DAGNetBase::WorkerFunction() {
         idx,
         ".");
     const auto& chain = execution_chains_[idx];
+    const bool measure = priority_scheduling_ &&
+        measured_iters_ < FLAGS_caffe2_dag_net_priority_measure_iters;
+    Timer chain_timer;
     bool this_success = false;
     try {
       this_success = RunAt(idx, execution_chains_[idx]);
+      if (measure) {
+        measured_chain_time_us_[idx] += chain_timer.MicroSeconds();
+      }
 
       if (!this_success) {
         // If an exception was thrown, the operator def will get printed
@@ -4,6 +4,7 @@
 #include <atomic>
 #include <climits>
 #include <cstddef>
+#include <queue>
 #include <thread> // NOLINT
 #include <typeinfo>
 #include <unordered_map>
@@ -25,6 +26,27 @@
 
 namespace caffe2 {
 
+// Queue of ready chains (std::queue interface, used by SimpleQueue). Without
+// priorities chains are popped in FIFO order, otherwise the chain with the
+// highest priority (indexed by the chain's first operator) is popped first.
+class ReadyChainQueue {
+ public:
+  explicit ReadyChainQueue(const std::vector<double>* priorities = nullptr)
+      : priorities_(priorities) {}
+
+  void push(int idx);
+  const int& front() const;
+  void pop();
+  size_t size() const {
+    return priorities_ ? heap_.size() : fifo_.size();
+  }
+
+ private:
+  const std::vector<double>* priorities_;
+  std::queue<int> fifo_;
+  std::vector<int> heap_;
+};
+
 class DAGNetBase : public NetBase {
  public:
   DAGNetBase(const std::shared_ptr<const NetDef>& net_def, Workspace* ws);
@@ -54,11 +76,16 @@ class DAGNetBase : public NetBase {
   virtual bool RunAt(int chain_id, const std::vector<int>& chain) = 0;
   void HandleException(int operator_idx, const std::string& exception_str);
 
+  // Priority scheduling: ready chains with the longest remaining critical
+  // path (in estimated cost) are run first
+  void InitPriorities(const NetDef& net_def, Workspace* ws);
+  void UpdatePriorities();
+
   vector<dag_utils::OperatorNode> operator_nodes_;
   vector<OperatorBase*> operators_;
   dag_utils::ExecutionChains execution_chains_;
   vector<int> initial_frontier_;
-  std::unique_ptr<SimpleQueue<int>> job_queue_;
+  std::unique_ptr<SimpleQueue<int, ReadyChainQueue>> job_queue_;
   std::vector<std::thread> workers_;
   int num_workers_;
   int remaining_ops_;
@@ -74,6 +101,16 @@ class DAGNetBase : public NetBase {
   std::condition_variable cv_;
   std::mutex run_in_progress_;
 
+  bool priority_scheduling_;
+  // Cost estimate of every operator; the measured time of a chain is
+  // attributed to its first operator
+  std::vector<double> op_costs_;
+  // Critical path length of every chain, indexed by its first operator
+  std::vector<double> priorities_;
+  // Number of first runs of which chain run times are measured
+  int measured_iters_;
+  std::vector<double> measured_chain_time_us_;
+
   struct DAGNetStats {
     CAFFE_STAT_CTOR(DAGNetStats);
     CAFFE_AVG_EXPORTED_STAT(task_pool_wait_time_us);
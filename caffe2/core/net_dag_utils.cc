@@ -1,10 +1,12 @@
 #include "caffe2/core/net_dag_utils.h"
 
+#include <algorithm>
 #include <set>
 #include <stack>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/net_template.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
@@ -277,6 +279,13 @@ ExecutionChains computeChains(std::vector<OperatorNode>& orig_nodes) {
   return chains;
 }
 
+ExecutionChains reuseChains(
+    std::vector<OperatorNode>& nodes,
+    const ExecutionChains& chains) {
+  updateOperatorNodes(nodes, chains);
+  return chains;
+}
+
 ExecutionChains singleChains(std::vector<OperatorNode>& nodes) {
   ExecutionChains chains;
   for (auto i = 0; i < nodes.size(); ++i) {
@@ -293,12 +302,17 @@ std::vector<OperatorNode> prepareOperatorNodes(
   std::map<string, int> blob_creator;
   std::map<string, std::set<int>> blob_readers;
   bool net_def_has_device_option = net_def->has_device_option();
+  auto* net_template = NetTemplate::Find(*net_def);
+  const auto dependencies =
+      net_template ? net_template->dependencies() : nullptr;
   // Initialize the operators
   for (int idx = 0; idx < net_def->op_size(); ++idx) {
     const OperatorDef& op_def = net_def->op(idx);
     VLOG(1) << "Creating operator #" << idx << ": " << op_def.name() << ": "
             << op_def.type();
-    if (!op_def.has_device_option() && net_def_has_device_option) {
+    if (net_template) {
+      operator_nodes[idx].operator_ = net_template->CreateOperator(idx, ws);
+    } else if (!op_def.has_device_option() && net_def_has_device_option) {
       OperatorDef temp_def(op_def);
       temp_def.mutable_device_option()->CopyFrom(net_def->device_option());
       operator_nodes[idx].operator_ = CreateOperator(temp_def, ws, idx);
@@ -308,6 +322,12 @@ std::vector<OperatorNode> prepareOperatorNodes(
           std::shared_ptr<const OperatorDef>{net_def, &(net_def->op(idx))});
       operator_nodes[idx].operator_ = std::move(op);
     }
+    if (dependencies) {
+      // Computed by an earlier net of the same template
+      operator_nodes[idx].parents_ = (*dependencies)[idx].parents_;
+      operator_nodes[idx].children_ = (*dependencies)[idx].children_;
+      continue;
+    }
     // Check the inputs, and set up parents if necessary. This addressese the
     // read after write case.
     auto checkInputs =
@@ -359,6 +379,18 @@ std::vector<OperatorNode> prepareOperatorNodes(
     }
   }
 
+  if (net_template) {
+    vector<OperatorBase*> operators;
+    operators.reserve(operator_nodes.size());
+    for (const auto& node : operator_nodes) {
+      operators.push_back(node.operator_.get());
+    }
+    net_template->RecordOperators(operators);
+  }
+  if (dependencies) {
+    return operator_nodes;
+  }
+
   // Now, make sure that the parent list and the children list do not contain
   // duplicated items.
   for (int i = 0; i < operator_nodes.size(); ++i) {
@@ -375,6 +407,9 @@ std::vector<OperatorNode> prepareOperatorNodes(
     c.erase(std::remove(c.begin(), c.end(), i), c.end());
   }
 
+  if (net_template) {
+    net_template->RecordDependencies(operator_nodes);
+  }
   return operator_nodes;
 }
 
@@ -425,5 +460,147 @@ std::vector<OpGraphNode> prepareChainGraphNodes(
   return chain_nodes;
 }
 
+namespace {
+// Topological order of the graph (Kahn's algorithm)
+template <typename Node>
+std::vector<int> topologicalOrder(const std::vector<Node>& nodes) {
+  std::vector<int> num_parents(nodes.size());
+  std::vector<int> order;
+  order.reserve(nodes.size());
+  for (int idx = 0; idx < nodes.size(); ++idx) {
+    num_parents[idx] = nodes[idx].parents_.size();
+    if (num_parents[idx] == 0) {
+      order.push_back(idx);
+    }
+  }
+  for (int i = 0; i < order.size(); ++i) {
+    for (auto child : nodes[order[i]].children_) {
+      if (--num_parents[child] == 0) {
+        order.push_back(child);
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(order.size(), nodes.size(), "Operator graph has a cycle");
+  return order;
+}
+} // namespace
+
+std::vector<double> computeCriticalPathLengths(
+    const std::vector<OperatorNode>& nodes,
+    const std::vector<double>& op_costs) {
+  CAFFE_ENFORCE_EQ(nodes.size(), op_costs.size());
+  // Relax in reverse topological order so that every child is done before
+  // its parents
+  const auto order = topologicalOrder(nodes);
+  std::vector<double> lengths(nodes.size(), 0);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    double longest_child = 0;
+    for (auto child : nodes[*it].children_) {
+      longest_child = std::max(longest_child, lengths[child]);
+    }
+    lengths[*it] = op_costs[*it] + longest_child;
+  }
+  return lengths;
+}
+
+std::vector<int> partitionChains(
+    const std::vector<OpGraphNode>& chain_nodes,
+    const std::vector<double>& chain_costs,
+    const std::vector<int>& fixed_parts,
+    int num_parts,
+    double max_imbalance) {
+  CAFFE_ENFORCE_GT(num_parts, 0);
+  CAFFE_ENFORCE_EQ(chain_nodes.size(), chain_costs.size());
+  CAFFE_ENFORCE_EQ(chain_nodes.size(), fixed_parts.size());
+
+  double total_cost = 0;
+  double max_cost = 0;
+  for (auto cost : chain_costs) {
+    total_cost += cost;
+    max_cost = std::max(max_cost, cost);
+  }
+  const double capacity =
+      std::max(total_cost / num_parts * (1 + max_imbalance), max_cost);
+
+  std::vector<int> parts(fixed_parts);
+  std::vector<double> loads(num_parts, 0);
+  for (int idx = 0; idx < parts.size(); ++idx) {
+    if (parts[idx] >= 0) {
+      CAFFE_ENFORCE_LT(parts[idx], num_parts, "Invalid part id");
+      loads[parts[idx]] += chain_costs[idx];
+    }
+  }
+
+  // Number of already placed neighbours of the chain in every part
+  std::vector<int> neighbours(num_parts);
+  auto countNeighbours = [&](int idx) {
+    std::fill(neighbours.begin(), neighbours.end(), 0);
+    for (const auto* adjacent :
+         {&chain_nodes[idx].parents_, &chain_nodes[idx].children_}) {
+      for (auto other : *adjacent) {
+        if (parts[other] >= 0) {
+          ++neighbours[parts[other]];
+        }
+      }
+    }
+  };
+
+  // Greedy pass in topological order: follow the parents as long as the
+  // part has room, otherwise take the least loaded part
+  for (auto idx : topologicalOrder(chain_nodes)) {
+    if (parts[idx] >= 0) {
+      continue;
+    }
+    countNeighbours(idx);
+    int best = -1;
+    for (int part = 0; part < num_parts; ++part) {
+      if (loads[part] + chain_costs[idx] > capacity) {
+        continue;
+      }
+      if (best < 0 || neighbours[part] > neighbours[best] ||
+          (neighbours[part] == neighbours[best] &&
+           loads[part] < loads[best])) {
+        best = part;
+      }
+    }
+    if (best < 0) {
+      best = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    }
+    parts[idx] = best;
+    loads[best] += chain_costs[idx];
+  }
+
+  // Refinement: move single chains while it reduces the number of edges
+  // between parts and keeps the balance
+  const int kMaxPasses = 8;
+  for (int pass = 0; pass < kMaxPasses; ++pass) {
+    bool moved = false;
+    for (int idx = 0; idx < parts.size(); ++idx) {
+      if (fixed_parts[idx] >= 0) {
+        continue;
+      }
+      countNeighbours(idx);
+      const int current = parts[idx];
+      int best = current;
+      for (int part = 0; part < num_parts; ++part) {
+        if (part != current && neighbours[part] > neighbours[best] &&
+            loads[part] + chain_costs[idx] <= capacity) {
+          best = part;
+        }
+      }
+      if (best != current) {
+        loads[current] -= chain_costs[idx];
+        loads[best] += chain_costs[idx];
+        parts[idx] = best;
+        moved = true;
+      }
+    }
+    if (!moved) {
+      break;
+    }
+  }
+  return parts;
+}
+
 } // namespace dag_utils
 } // namespace caffe2
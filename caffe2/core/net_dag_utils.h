@@ -46,6 +46,12 @@ ExecutionChains computeChains(std::vector<OperatorNode>& orig_nodes);
 
 ExecutionChains singleChains(std::vector<OperatorNode>& nodes);
 
+// Marks the chain starts in nodes as computeChains() does, for chains computed
+// for another instance of the same net
+ExecutionChains reuseChains(
+    std::vector<OperatorNode>& nodes,
+    const ExecutionChains& chains);
+
 std::vector<OperatorNode> prepareOperatorNodes(
     const std::shared_ptr<const NetDef>& net_def,
     Workspace* ws);
@@ -54,6 +60,23 @@ std::vector<OpGraphNode> prepareChainGraphNodes(
     const std::vector<dag_utils::OperatorNode>& operator_nodes,
     const std::vector<std::vector<int>>& execution_chains);
 
+// Cost of the most expensive path from every operator to the end of the
+// net, including the operator itself
+std::vector<double> computeCriticalPathLengths(
+    const std::vector<OperatorNode>& nodes,
+    const std::vector<double>& op_costs);
+
+// Assigns every chain to one of num_parts parts (e.g. NUMA nodes), so that
+// few parent/child edges cross parts and the summed cost of every part stays
+// within (1 + max_imbalance) of the average. Chains with a non-negative
+// entry in fixed_parts keep it.
+std::vector<int> partitionChains(
+    const std::vector<OpGraphNode>& chain_nodes,
+    const std::vector<double>& chain_costs,
+    const std::vector<int>& fixed_parts,
+    int num_parts,
+    double max_imbalance);
+
 } // namespace dag_utils
 } // namespace caffe2
 
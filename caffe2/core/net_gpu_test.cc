@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "caffe2/core/common_gpu.h"
+#include "caffe2/core/context_gpu.h"
 #include "caffe2/core/net.h"
+#include "caffe2/core/net_async_base.h"
 #include "caffe2/core/net_dag.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/scope_guard.h"
@@ -133,4 +135,66 @@ TEST(NetTest, DISABLED_ChainingForDifferentDevices) {
   }
 }
 
+TEST(NetTest, AsyncSchedulingCopyStream) {
+  const auto spec = R"DOC(
+        name: "copy_stream_example"
+        type: "async_scheduling"
+        external_input: "x"
+        external_input: "y"
+        device_option {
+          device_type: 1
+        }
+        arg {
+          name: "copy_stream"
+          i: 1
+        }
+        op {
+          input: "x"
+          output: "x_gpu"
+          type: "CopyCPUToGPU"
+        }
+        op {
+          input: "x_gpu"
+          output: "x_gpu"
+          type: "Relu"
+        }
+        op {
+          input: "y"
+          output: "y_gpu"
+          type: "CopyCPUToGPU"
+        }
+        op {
+          input: "x_gpu"
+          input: "y_gpu"
+          output: "out"
+          type: "Add"
+        }
+)DOC";
+  if (!HasCudaGPU()) {
+    return;
+  }
+  Workspace ws;
+  for (const auto& name : {"x", "y"}) {
+    auto* tensor = ws.CreateBlob(name)->GetMutable<TensorCPU>();
+    tensor->Resize(2);
+    tensor->mutable_data<float>()[0] = -1;
+    tensor->mutable_data<float>()[1] = 2;
+  }
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+
+  // The copy of x is split from the Relu it feeds
+  auto* async_net = dynamic_cast_if_rtti<AsyncNetBase*>(net.get());
+  CHECK_NOTNULL(async_net);
+  EXPECT_EQ(async_net->TEST_chains().size(), net_def.op_size());
+
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(net->Run());
+    TensorCPU out(ws.GetBlob("out")->Get<TensorCUDA>());
+    EXPECT_FLOAT_EQ(out.data<float>()[0], -1);
+    EXPECT_FLOAT_EQ(out.data<float>()[1], 4);
+  }
+}
+
 } // namespace caffe2
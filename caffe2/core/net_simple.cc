@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "caffe2/core/net_template.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/static_tracepoint.h"
 #include "caffe2/core/timer.h"
@@ -20,13 +21,17 @@ SimpleNet::SimpleNet(
     : NetBase(net_def, ws) {
   VLOG(1) << "Constructing SimpleNet " << net_def->name();
   const bool net_def_has_device_option = net_def->has_device_option();
+  auto* net_template = NetTemplate::Find(*net_def);
   // Initialize the operators
   for (int idx = 0; idx < net_def->op_size(); ++idx) {
     const auto& operator_def = net_def->op(idx);
     VLOG(1) << "Creating operator " << operator_def.name() << ": "
             << operator_def.type();
     std::unique_ptr<OperatorBase> op{nullptr};
-    if (!operator_def.has_device_option() && net_def_has_device_option) {
+    if (net_template) {
+      op = net_template->CreateOperator(idx, ws);
+    } else if (
+        !operator_def.has_device_option() && net_def_has_device_option) {
       // In the case that the operator def does not specify a device option but
       // the net def has a default option, we copy the device option over to the
       // operator def.
@@ -40,9 +45,12 @@ SimpleNet::SimpleNet(
     }
     operators_.emplace_back(std::move(op));
   }
+  if (net_template) {
+    net_template->RecordOperators(GetOperators());
+  }
 }
 
-bool SimpleNet::Run() {
+bool SimpleNet::DoRun() {
   StartAllObservers();
   VLOG(1) << "Running net " << name_;
   for (auto& op : operators_) {
@@ -134,11 +142,13 @@ vector<float> SimpleNet::TEST_Benchmark(
             OpSchema::Cost cost = schema->InferCost(op->debug_def(), shapes);
 
             flops_per_op.emplace_back(cost.flops);
-            memory_bytes_per_op.emplace_back(cost.bytes_moved);
+            memory_bytes_per_op.emplace_back(
+                cost.bytes_read + cost.bytes_written);
             param_bytes_per_op.emplace_back(cost.params_bytes);
 
             flops_per_op_type[op_type] += cost.flops;
-            memory_bytes_per_op_type[op_type] += cost.bytes_moved;
+            memory_bytes_per_op_type[op_type] +=
+                cost.bytes_read + cost.bytes_written;
             param_bytes_per_op_type[op_type] += cost.params_bytes;
           }
         }
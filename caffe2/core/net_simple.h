@@ -43,7 +43,7 @@ class SimpleNet : public NetBase {
   }
 
  protected:
-  bool Run() override;
+  bool DoRun() override;
   bool RunAsync() override;
 
   vector<unique_ptr<OperatorBase>> operators_;
@@ -162,7 +162,7 @@ class SingleThreadAsyncNet : public SimpleNet {
     }
   }
 
-  bool Run() override {
+  bool DoRun() override {
     if (!executor_.get()) {
       initialize();
     }
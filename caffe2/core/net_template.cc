@@ -0,0 +1,117 @@
+#include "caffe2/core/net_template.h"
+
+#include <unordered_map>
+
+namespace caffe2 {
+
+namespace {
+
+std::mutex& templatesMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// NetDef -> template it belongs to
+std::unordered_map<const NetDef*, NetTemplate*>& templates() {
+  static auto* templates =
+      new std::unordered_map<const NetDef*, NetTemplate*>();
+  return *templates;
+}
+
+} // namespace
+
+NetTemplate::NetTemplate(const NetDef& net_def) {
+  std::shared_ptr<NetDef> def(new NetDef(net_def));
+  if (def->has_device_option()) {
+    for (auto& op : *def->mutable_op()) {
+      if (!op.has_device_option()) {
+        op.mutable_device_option()->CopyFrom(def->device_option());
+      }
+    }
+  }
+  net_def_ = def;
+  std::lock_guard<std::mutex> lock(templatesMutex());
+  templates()[net_def_.get()] = this;
+}
+
+NetTemplate::~NetTemplate() {
+  std::lock_guard<std::mutex> lock(templatesMutex());
+  templates().erase(net_def_.get());
+}
+
+NetTemplate* NetTemplate::Find(const NetDef& net_def) {
+  std::lock_guard<std::mutex> lock(templatesMutex());
+  auto it = templates().find(&net_def);
+  return it != templates().end() ? it->second : nullptr;
+}
+
+unique_ptr<OperatorBase> NetTemplate::CreateOperator(int idx, Workspace* ws)
+    const {
+  const auto& op_def = net_def_->op(idx);
+  std::shared_ptr<const std::vector<std::string>> engines;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    engines = engines_;
+  }
+  unique_ptr<OperatorBase> op;
+  if (engines) {
+    op = TryCreateOperatorWithEngine(op_def, ws, (*engines)[idx], idx);
+  }
+  if (!op) {
+    // Not resolved yet, or the engine name was too long to be kept
+    op = caffe2::CreateOperator(op_def, ws, idx);
+  }
+  op->set_debug_def(std::shared_ptr<const OperatorDef>{net_def_, &op_def});
+  return op;
+}
+
+void NetTemplate::RecordOperators(const vector<OperatorBase*>& operators) {
+  CAFFE_ENFORCE_EQ(operators.size(), net_def_->op_size());
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (engines_) {
+    return;
+  }
+  std::shared_ptr<std::vector<std::string>> engines(
+      new std::vector<std::string>());
+  engines->reserve(operators.size());
+  for (const auto* op : operators) {
+    engines->push_back(op->engine());
+  }
+  engines_ = engines;
+}
+
+void NetTemplate::RecordDependencies(
+    const std::vector<dag_utils::OperatorNode>& nodes) {
+  CAFFE_ENFORCE_EQ(nodes.size(), net_def_->op_size());
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (dependencies_) {
+    return;
+  }
+  std::shared_ptr<std::vector<dag_utils::OpGraphNode>> dependencies(
+      new std::vector<dag_utils::OpGraphNode>(nodes.size()));
+  for (int i = 0; i < nodes.size(); ++i) {
+    (*dependencies)[i].parents_ = nodes[i].parents_;
+    (*dependencies)[i].children_ = nodes[i].children_;
+  }
+  dependencies_ = dependencies;
+}
+
+void NetTemplate::RecordChains(const dag_utils::ExecutionChains& chains) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!chains_) {
+    chains_ = std::make_shared<const dag_utils::ExecutionChains>(chains);
+  }
+}
+
+std::shared_ptr<const std::vector<dag_utils::OpGraphNode>>
+NetTemplate::dependencies() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dependencies_;
+}
+
+std::shared_ptr<const dag_utils::ExecutionChains> NetTemplate::chains() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return chains_;
+}
+
+} // namespace caffe2
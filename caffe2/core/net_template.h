@@ -0,0 +1,78 @@
+#ifndef CAFFE2_CORE_NET_TEMPLATE_H_
+#define CAFFE2_CORE_NET_TEMPLATE_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net_dag_utils.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * A NetDef prepared to instantiate many nets from, e.g. one per thread of a
+ * concurrent predictor or one per child workspace of a Do operator.
+ *
+ * Nets created from net_def() with caffe2::CreateNet() or
+ * Workspace::CreateNet() are instantiated from the template. The first one
+ * resolves the engine of every operator and, for DAG and async nets, the
+ * operator dependencies and execution chains, and the template keeps them.
+ * The next ones create every operator directly with its engine, without
+ * checking its schema or the engine preferences again, and reuse the
+ * dependencies and chains, so they only construct the operators against
+ * their workspace.
+ *
+ * The net device option is copied to the operators that don't have one when
+ * the template is made, rather than on every instantiation. The template must
+ * outlive the creation of its nets, not the nets themselves.
+ */
+class NetTemplate {
+ public:
+  explicit NetTemplate(const NetDef& net_def);
+  ~NetTemplate();
+
+  const std::shared_ptr<const NetDef>& net_def() const {
+    return net_def_;
+  }
+
+  /**
+   * Returns the template net_def is the net_def() of, nullptr if none.
+   */
+  static NetTemplate* Find(const NetDef& net_def);
+
+  /**
+   * Creates the idx-th operator of net_def() in ws, with the engine it was
+   * first created with if a net of the template created its operators already.
+   */
+  unique_ptr<OperatorBase> CreateOperator(int idx, Workspace* ws) const;
+
+  // Called by the nets of the template once they created their operators, or
+  // computed the operator dependencies or chains. The first results are kept.
+  void RecordOperators(const vector<OperatorBase*>& operators);
+  void RecordDependencies(const std::vector<dag_utils::OperatorNode>& nodes);
+  void RecordChains(const dag_utils::ExecutionChains& chains);
+
+  // Operator dependencies and chains recorded for the DAG and async nets,
+  // nullptr until a net of the template computed them
+  std::shared_ptr<const std::vector<dag_utils::OpGraphNode>> dependencies()
+      const;
+  std::shared_ptr<const dag_utils::ExecutionChains> chains() const;
+
+ private:
+  std::shared_ptr<const NetDef> net_def_;
+
+  mutable std::mutex mutex_;
+  std::shared_ptr<const std::vector<std::string>> engines_;
+  std::shared_ptr<const std::vector<dag_utils::OpGraphNode>> dependencies_;
+  std::shared_ptr<const dag_utils::ExecutionChains> chains_;
+
+  DISABLE_COPY_AND_ASSIGN(NetTemplate);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_NET_TEMPLATE_H_
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/net_dag.h"
+#include "caffe2/core/net_template.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace {
+
+static int unsupported_constructed = 0;
+
+class NetTemplateTestOp final : public OperatorBase {
+ public:
+  using OperatorBase::OperatorBase;
+
+  bool Run(int /* unused */) override {
+    return true;
+  }
+};
+
+// Engine that is never available, tried before the one that is
+class NetTemplateTestUnsupportedOp final : public OperatorBase {
+ public:
+  NetTemplateTestUnsupportedOp(const OperatorDef& def, Workspace* ws)
+      : OperatorBase(def, ws) {
+    ++unsupported_constructed;
+    OPERATOR_NEEDS_FEATURE(false, "Never supported");
+  }
+
+  bool Run(int /* unused */) override {
+    return true;
+  }
+};
+
+OPERATOR_SCHEMA(NetTemplateTest);
+REGISTER_CPU_OPERATOR(NetTemplateTest, NetTemplateTestOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    NetTemplateTest,
+    AVAILABLE,
+    NetTemplateTestOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    NetTemplateTest,
+    UNSUPPORTED,
+    NetTemplateTestUnsupportedOp);
+
+NetDef TestNet(const std::string& type) {
+  NetDef net_def;
+  net_def.set_name("template");
+  net_def.set_type(type);
+  net_def.add_external_input("in");
+  auto* op = AddOp(&net_def, "NetTemplateTest", {"in"}, {"hidden"});
+  op->set_engine("UNSUPPORTED,AVAILABLE");
+  AddOp(&net_def, "NetTemplateTest", {"hidden"}, {"out1"});
+  AddOp(&net_def, "NetTemplateTest", {"hidden"}, {"out2"});
+  return net_def;
+}
+
+TEST(NetTemplateTest, TestResolvesEnginesOnce) {
+  unsupported_constructed = 0;
+  NetTemplate net_template(TestNet("simple"));
+  EXPECT_EQ(NetTemplate::Find(*net_template.net_def()), &net_template);
+  for (int i = 0; i < 3; ++i) {
+    Workspace ws;
+    ws.CreateBlob("in");
+    auto net = CreateNet(net_template.net_def(), &ws);
+    ASSERT_TRUE(net);
+    EXPECT_EQ(net->GetOperators()[0]->engine(), "AVAILABLE");
+    EXPECT_EQ(net->GetOperators()[1]->engine(), "");
+    EXPECT_TRUE(ws.HasBlob("out2"));
+    EXPECT_TRUE(net->Run());
+  }
+  EXPECT_EQ(unsupported_constructed, 1);
+}
+
+TEST(NetTemplateTest, TestReusesChains) {
+  NetTemplate net_template(TestNet("dag"));
+  Workspace ws;
+  ws.CreateBlob("in");
+  auto first = CreateNet(net_template.net_def(), &ws);
+  ASSERT_TRUE(net_template.chains());
+  ASSERT_TRUE(net_template.dependencies());
+  EXPECT_EQ((*net_template.dependencies())[0].children_, vector<int>({1, 2}));
+
+  Workspace other_ws;
+  other_ws.CreateBlob("in");
+  auto second = CreateNet(net_template.net_def(), &other_ws);
+  ASSERT_TRUE(second);
+  EXPECT_EQ(
+      dynamic_cast<DAGNet*>(second.get())->TEST_execution_chains(),
+      dynamic_cast<DAGNet*>(first.get())->TEST_execution_chains());
+  EXPECT_TRUE(second->Run());
+}
+
+TEST(NetTemplateTest, TestOnlyOwnNetDef) {
+  NetDef net_def = TestNet("simple");
+  std::unique_ptr<NetTemplate> net_template(new NetTemplate(net_def));
+  EXPECT_EQ(NetTemplate::Find(net_def), nullptr);
+  const auto template_net_def = net_template->net_def();
+  net_template.reset();
+  EXPECT_EQ(NetTemplate::Find(*template_net_def), nullptr);
+}
+
+TEST(NetTemplateTest, TestCopiesNetDeviceOption) {
+  NetDef net_def = TestNet("simple");
+  net_def.mutable_device_option()->set_device_type(CPU);
+  net_def.mutable_device_option()->set_numa_node_id(0);
+  NetTemplate net_template(net_def);
+  for (const auto& op : net_template.net_def()->op()) {
+    EXPECT_TRUE(op.has_device_option());
+    EXPECT_TRUE(op.device_option().has_numa_node_id());
+  }
+}
+
+} // namespace
+
+} // namespace caffe2
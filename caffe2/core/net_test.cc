@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
 #include "caffe2/core/net.h"
 #include "caffe2/core/net_dag.h"
+#include "caffe2/core/net_dag_utils.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/scope_guard.h"
+#include "caffe2/core/stats.h"
 
 CAFFE2_DECLARE_bool(caffe2_disable_chaining);
 
@@ -58,6 +60,108 @@ OPERATOR_SCHEMA(NetTestDummy2)
     .NumOutputs(0, INT_MAX)
     .AllowInplace({{1, 0}});
 
+// CPU-only dummy op; unlike OperatorBase, Operator<CPUContext> finishes its
+// event, which is what async_scheduling nets wait for
+class NetTestCPUDummyOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    counter.fetch_add(1);
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestCPUDummy, NetTestCPUDummyOp);
+REGISTER_CPU_OPERATOR(NetTestCheapDummy, NetTestCPUDummyOp);
+
+OPERATOR_SCHEMA(NetTestCPUDummy)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+OPERATOR_SCHEMA(NetTestCheapDummy)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX)
+    .CheapToRun();
+
+static std::atomic<bool> async_part_done;
+
+// CPU op with an async part, finished on another thread
+class NetTestAsyncCPUOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  ~NetTestAsyncCPUOp() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+  bool RunOnDevice() override {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    async_part_done = false;
+    thread_ = std::thread([this] {
+      /* sleep override */
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      async_part_done = true;
+      event().SetFinished();
+    });
+    return true;
+  }
+
+  bool HasAsyncPart() const override {
+    return true;
+  }
+
+ private:
+  std::thread thread_;
+};
+
+class NetTestCheckAsyncPartOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE(async_part_done, "Ran before the async part was done");
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestAsyncCPU, NetTestAsyncCPUOp);
+REGISTER_CPU_OPERATOR(NetTestCheckAsyncPart, NetTestCheckAsyncPartOp);
+
+OPERATOR_SCHEMA(NetTestAsyncCPU).NumInputs(0, INT_MAX).NumOutputs(0, INT_MAX);
+OPERATOR_SCHEMA(NetTestCheckAsyncPart)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX);
+
+// Records the order in which the ops of a net ran by their first output
+class NetTestRecordOrderOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+
+  bool RunOnDevice() override {
+    std::lock_guard<std::mutex> lock(mutex());
+    order().push_back(debug_def().output(0));
+    return true;
+  }
+
+  static std::mutex& mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<std::string>& order() {
+    static std::vector<std::string> order;
+    return order;
+  }
+};
+
+REGISTER_CPU_OPERATOR(NetTestRecordOrder, NetTestRecordOrderOp);
+
+OPERATOR_SCHEMA(NetTestRecordOrder).NumInputs(0, INT_MAX).NumOutputs(1);
+
 unique_ptr<NetBase> CreateNetTestHelper(
     Workspace* ws,
     const vector<string>& input,
@@ -580,4 +684,283 @@ TEST(NetTest, FailingOperator) {
   }
 }
 
+TEST(NetTest, AsyncSchedulingWorkStealingPool) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "async_scheduling"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out1"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out2"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "out1"
+          input: "out2"
+          output: "out"
+          type: "NetTestCPUDummy"
+        }
+        arg {
+          name: "thread_pool_type"
+          s: "work_stealing"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  testExecution(net, net_def.op().size());
+}
+
+TEST(NetTest, AsyncCPUOperator) {
+  const auto spec = R"DOC(
+        name: "example"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestAsyncCPU"
+        }
+        op {
+          input: "hidden"
+          output: "out"
+          type: "NetTestCheckAsyncPart"
+        }
+)DOC";
+
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  // Executors running the ops with Run wait for the async part as well
+  for (const auto& type : {"simple", "dag", "async_scheduling"}) {
+    net_def.set_type(type);
+    Workspace ws;
+    ws.CreateBlob("in");
+    std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(net->Run()) << type;
+    }
+  }
+}
+
+TEST(NetTest, AsyncSchedulingInlinesCheapOps) {
+  const auto spec = R"DOC(
+        name: "inline_example"
+        type: "async_scheduling"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "hidden"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out1"
+          type: "NetTestCheapDummy"
+        }
+        op {
+          input: "hidden"
+          output: "out2"
+          type: "NetTestCheapDummy"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  StatRegistry::get().publish(true);
+  testExecution(net, net_def.op().size());
+
+  // One of the two ready children runs inline after its parent, the other
+  // one goes through the pool
+  auto stats = toMap(StatRegistry::get().publish());
+  EXPECT_EQ(100, stats["inline_example/inlined_chains"]);
+  EXPECT_EQ(100, stats["inline_example/inlined_ops"]);
+}
+
+TEST(NetTest, CriticalPathLengths) {
+  const auto spec = R"DOC(
+        name: "example"
+        type: "dag"
+        external_input: "in"
+        op {
+          input: "in"
+          output: "x"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "x"
+          output: "a"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "x"
+          output: "b1"
+          type: "NetTestDummy"
+        }
+        op {
+          input: "b1"
+          output: "b2"
+          type: "NetTestDummy"
+        }
+)DOC";
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  auto nodes = dag_utils::prepareOperatorNodes(
+      std::make_shared<const NetDef>(net_def), &ws);
+  auto lengths =
+      dag_utils::computeCriticalPathLengths(nodes, {1.0, 5.0, 2.0, 2.0});
+  EXPECT_EQ(std::vector<double>({6.0, 5.0, 4.0, 2.0}), lengths);
+}
+
+TEST(NetTest, DAGPrioritySchedulingRunsCriticalPathFirst) {
+  const auto spec = R"DOC(
+        name: "priority_example"
+        type: "dag"
+        external_input: "in"
+        arg {
+          name: "priority_scheduling"
+          i: 1
+        }
+        op {
+          input: "in"
+          output: "x"
+          type: "NetTestRecordOrder"
+        }
+        op {
+          input: "x"
+          output: "a"
+          type: "NetTestRecordOrder"
+        }
+        op {
+          input: "x"
+          output: "b1"
+          type: "NetTestRecordOrder"
+        }
+        op {
+          input: "b1"
+          output: "b2"
+          type: "NetTestRecordOrder"
+        }
+        op {
+          input: "b2"
+          output: "b3"
+          type: "NetTestRecordOrder"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  net_def.set_num_workers(1);
+
+  auto old = FLAGS_caffe2_disable_chaining;
+  auto g = MakeGuard([&]() { FLAGS_caffe2_disable_chaining = old; });
+  FLAGS_caffe2_disable_chaining = false;
+
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  NetTestRecordOrderOp::order().clear();
+  ASSERT_TRUE(net->Run());
+  // Without priorities the chains of "a" and "b1" run in the order they
+  // became ready, with them the longer one goes first
+  EXPECT_EQ(
+      std::vector<std::string>({"x", "b1", "b2", "b3", "a"}),
+      NetTestRecordOrderOp::order());
+}
+
+TEST(NetTest, PartitionChains) {
+  // Two pipelines joined at the end: 0 -> 1 -> 4, 2 -> 3 -> 4
+  std::vector<dag_utils::OpGraphNode> nodes(5);
+  auto connect = [&](int parent, int child) {
+    nodes[parent].children_.push_back(child);
+    nodes[child].parents_.push_back(parent);
+  };
+  connect(0, 1);
+  connect(1, 4);
+  connect(2, 3);
+  connect(3, 4);
+  const std::vector<double> costs(5, 1.0);
+
+  auto parts =
+      dag_utils::partitionChains(nodes, costs, {-1, -1, -1, -1, -1}, 2, 0.2);
+  EXPECT_EQ(std::vector<int>({0, 0, 1, 1, 0}), parts);
+
+  // Fixed chains keep their part, their neighbours follow them
+  parts = dag_utils::partitionChains(nodes, costs, {1, -1, -1, -1, -1}, 2, 0.2);
+  EXPECT_EQ(std::vector<int>({1, 1, 0, 0, 0}), parts);
+}
+
+TEST(NetTest, AsyncSchedulingNUMAPlacement) {
+  const auto spec = R"DOC(
+        name: "numa_example"
+        type: "async_scheduling"
+        external_input: "in"
+        arg {
+          name: "numa_placement"
+          i: 1
+        }
+        arg {
+          name: "numa_placement_nodes"
+          i: 2
+        }
+        op {
+          input: "in"
+          output: "a1"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "a1"
+          output: "a2"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "in"
+          output: "b1"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "b1"
+          output: "b2"
+          type: "NetTestCPUDummy"
+        }
+        op {
+          input: "a2"
+          input: "b2"
+          output: "out"
+          type: "NetTestCPUDummy"
+        }
+)DOC";
+
+  Workspace ws;
+  ws.CreateBlob("in");
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(spec, &net_def));
+  std::unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  StatRegistry::get().publish(true);
+  testExecution(net, net_def.op().size());
+
+  // The pipelines go to different nodes, the join reads one of them
+  // from the other node
+  auto stats = toMap(StatRegistry::get().publish());
+  EXPECT_EQ(100, stats["numa_example/numa/cross_node_reads"]);
+}
+
 } // namespace caffe2
@@ -263,10 +263,13 @@ public:
   /// related to the node.
   void deleteNode(NodeRef n, bool deleteEdges = true) {
     if (deleteEdges) {
-      for (auto &edge : n->inEdges) {
+      // deleteEdge removes the edge from n, so iterate over copies
+      const auto inEdges = n->inEdges;
+      for (auto &edge : inEdges) {
         deleteEdge(edge);
       }
-      for (auto &edge : n->outEdges) {
+      const auto outEdges = n->outEdges;
+      for (auto &edge : outEdges) {
         deleteEdge(edge);
       }
     }
@@ -28,6 +28,7 @@ namespace caffe2 {
 OperatorBase::OperatorBase(const OperatorDef& operator_def, Workspace* ws)
     : operator_ws_(ws),
       operator_def_(std::make_shared<OperatorDef>(operator_def)),
+      arg_helper_(operator_def),
       device_option_(
           operator_def.has_device_option() ? operator_def.device_option()
                                            : DeviceOption()),
@@ -280,6 +281,29 @@ unique_ptr<OperatorBase> CreateOperator(
   }
 }
 
+unique_ptr<OperatorBase> TryCreateOperatorWithEngine(
+    const OperatorDef& operator_def,
+    Workspace* ws,
+    const std::string& engine,
+    int net_position) {
+  try {
+    auto op = TryCreateOperator(
+        OpRegistryKey(operator_def.type(), engine), operator_def, ws);
+    if (op) {
+      if (!engine.empty()) {
+        op->annotate_engine(engine);
+      }
+      op->set_net_position(net_position);
+    }
+    return op;
+  } catch (...) {
+    if (net_position != 0) {
+      ws->last_failed_op_net_position = net_position;
+    }
+    throw;
+  }
+}
+
 std::map<int32_t, OperatorRegistry*>* gDeviceTypeRegistry() {
   static std::map<int32_t, OperatorRegistry*> g_device_type_registry;
   return &g_device_type_registry;
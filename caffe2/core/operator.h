@@ -35,31 +35,27 @@ class OperatorBase : public Observable<OperatorBase> {
   /** @brief Checks if the operator has an argument of the given name.
    */
   inline bool HasArgument(const string& name) const {
-    CAFFE_ENFORCE(operator_def_, "operator_def was null!");
-    return ArgumentHelper::HasArgument(*operator_def_, name);
+    return arg_helper_.HasArgument(name);
   }
 
   // Functions that deal with arguments. Basically, this allows us to map an
   // argument name to a specific type of argument that we are trying to access.
+  // The arguments are those of the OperatorDef the operator was created with,
+  // indexed once at construction, so each access is a single lookup. Values
+  // read on every run are still better kept in members, see OP_SINGLE_ARG.
   template <typename T>
   inline T GetSingleArgument(const string& name, const T& default_value) const {
-    CAFFE_ENFORCE(operator_def_, "operator_def was null!");
-    return ArgumentHelper::GetSingleArgument<OperatorDef, T>(
-        *operator_def_, name, default_value);
+    return arg_helper_.GetSingleArgument<T>(name, default_value);
   }
   template <typename T>
   inline bool HasSingleArgumentOfType(const string& name) const {
-    CAFFE_ENFORCE(operator_def_, "operator_def was null!");
-    return ArgumentHelper::HasSingleArgumentOfType<OperatorDef, T>(
-        *operator_def_, name);
+    return arg_helper_.HasSingleArgumentOfType<T>(name);
   }
   template <typename T>
   inline vector<T> GetRepeatedArgument(
       const string& name,
       const vector<T>& default_value = {}) const {
-    CAFFE_ENFORCE(operator_def_, "operator_def was null!");
-    return ArgumentHelper::GetRepeatedArgument<OperatorDef, T>(
-        *operator_def_, name, default_value);
+    return arg_helper_.GetRepeatedArgument<T>(name, default_value);
   }
 
   // Get the inputs and outputs as specific types.
@@ -219,6 +215,11 @@ class OperatorBase : public Observable<OperatorBase> {
     net_position_ = idx;
   }
 
+  // Stream of the device the operator last ran on, for the observers
+  int stream_id() const {
+    return stream_id_;
+  }
+
   const DeviceOption& device_option() const {
     return device_option_;
   }
@@ -267,12 +268,18 @@ class OperatorBase : public Observable<OperatorBase> {
     return engine_;
   }
 
+  // CPU allocator of the operator's workspace, nullptr for the global one
+  CPUAllocator* cpu_allocator() const {
+    return operator_ws_ ? operator_ws_->GetCPUAllocator() : nullptr;
+  }
+
  public:
   static constexpr int kNoNetPositionSet = -1;
 
  private:
   Workspace* operator_ws_;
   std::shared_ptr<const OperatorDef> operator_def_;
+  ArgumentHelper arg_helper_;
   DeviceOption device_option_;
   std::string engine_;
   vector<const Blob*> inputs_;
@@ -280,6 +287,18 @@ class OperatorBase : public Observable<OperatorBase> {
 
   int net_position_{kNoNetPositionSet};
 
+ protected:
+  int stream_id_ = 0;
+
+ protected:
+  // Points the outputs to other blobs of the same count. Only meant for
+  // operators writing their outputs from a thread of their own, like
+  // PrefetchOperator, which don't read Outputs() from the net's thread.
+  void ResetOutputBlobs(const vector<Blob*>& outputs) {
+    CAFFE_ENFORCE_EQ(outputs.size(), outputs_.size());
+    std::copy(outputs.begin(), outputs.end(), outputs_.begin());
+  }
+
  protected:
   virtual void RecordEvent(const char* err_msg = nullptr) {
     CAFFE_NOT_IMPLEMENTED;
@@ -360,15 +379,31 @@ class Operator : public OperatorBase {
   // the actual computation with RunOnDevice(). You should implement RunOnDevice
   // instead of Run().
   // Note: Run does not update operator's event and can be used only with
-  // non-async executors that do not rely on events
+  // non-async executors that do not rely on events, except for async CPU
+  // operators, whose event is waited for
   bool Run(int stream_id = 0) final {
+    CPUAllocatorGuard allocator_guard(cpu_allocator());
     try {
+      stream_id_ = stream_id;
       StartAllObservers();
 
       context_.SwitchToDevice(stream_id);
+      // Async CPU operators finish their event off this thread, once their
+      // async part is done
+      const bool async_cpu = HasAsyncPart() &&
+          !context_.HasAsyncPartDefault() && !IsEventDisabled();
+      if (async_cpu) {
+        ResetEvent();
+      }
       bool result = RunOnDevice();
       if (!result) {
         this->RecordLastFailedOpNetPosition();
+      } else if (async_cpu) {
+        RecordEvent();
+        event().Finish();
+        if (event().Query() != EventStatus::EVENT_SUCCESS) {
+          CAFFE_THROW(event().ErrorMessage());
+        }
       }
       context_.FinishDeviceComputation(); // throws on error
 
@@ -389,8 +424,14 @@ class Operator : public OperatorBase {
     }
   }
 
+  // The observers of an async run time the scheduling of the operator's
+  // work, not the device computation, which may still be running.
   bool RunAsync(int stream_id = 0) final {
+    CPUAllocatorGuard allocator_guard(cpu_allocator());
     try {
+      stream_id_ = stream_id;
+      StartAllObservers();
+
       context_.SwitchToDevice(stream_id);
       auto result = RunOnDevice();
       if (result) {
@@ -401,6 +442,7 @@ class Operator : public OperatorBase {
           // unless this is an async CPU operator
           event().SetFinished();
         }
+        StopAllObservers();
       } else {
         event().SetFinished(getErrorMsg().c_str());
         this->RecordLastFailedOpNetPosition();
@@ -791,6 +833,16 @@ unique_ptr<OperatorBase> CreateOperator(
     Workspace* ws,
     int net_position = OperatorBase::kNoNetPositionSet);
 
+// Creates an operator with the given engine, "" for the default one, without
+// checking its schema or trying the preferred engines. Returns nullptr if the
+// engine is not available. Meant for operators whose engine an earlier
+// CreateOperator() call resolved, see NetTemplate.
+unique_ptr<OperatorBase> TryCreateOperatorWithEngine(
+    const OperatorDef& operator_def,
+    Workspace* ws,
+    const std::string& engine,
+    int net_position = OperatorBase::kNoNetPositionSet);
+
 const std::string OpRegistryKey(
     const std::string& op_type,
     const std::string& engine = "");
@@ -1,4 +1,7 @@
 #include "caffe2/core/operator_schema.h"
+
+#include <mutex>
+
 #include "caffe2/core/logging.h"
 
 namespace caffe2 {
@@ -189,6 +192,16 @@ OpSchema& OpSchema::InputsCanCrossDevices() {
   return *this;
 }
 
+OpSchema& OpSchema::CheapToRun() {
+  cheap_to_run_ = true;
+  return *this;
+}
+
+OpSchema& OpSchema::AcceptsTensorViews() {
+  accepts_tensor_views_ = true;
+  return *this;
+}
+
 OpSchema& OpSchema::TensorInferenceFunction(
     TensorInferenceFunctionType function) {
   tensor_inference_function_ = function;
@@ -247,8 +260,44 @@ OpSchema& OpSchema::DeviceInferenceFunction(
   return *this;
 }
 
-OpSchema& OpSchema::SetDoc(const string& doc) {
+namespace {
+// Guards the generation of the docs set with SetDocGenerator()
+std::mutex& docMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+} // namespace
+
+const char* OpSchema::doc() const {
+  if (doc_) {
+    return doc_;
+  }
+  std::lock_guard<std::mutex> lock(docMutex());
+  if (doc_generator_) {
+    doc_string_ = doc_generator_();
+    doc_generator_ = nullptr;
+  }
+  return doc_string_.empty() ? nullptr : doc_string_.c_str();
+}
+
+OpSchema& OpSchema::SetDoc(const char* doc) {
   doc_ = doc;
+  doc_string_.clear();
+  doc_generator_ = nullptr;
+  return *this;
+}
+
+OpSchema& OpSchema::SetDoc(const string& doc) {
+  doc_ = nullptr;
+  doc_string_ = doc;
+  doc_generator_ = nullptr;
+  return *this;
+}
+
+OpSchema& OpSchema::SetDocGenerator(std::function<string()> generator) {
+  doc_ = nullptr;
+  doc_string_.clear();
+  doc_generator_ = std::move(generator);
   return *this;
 }
 
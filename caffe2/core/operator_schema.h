@@ -38,12 +38,12 @@ constexpr int kCannotComputeNumOutputs = -1;
 class OpSchema {
  public:
   OpSchema() : file_("unknown"), line_(0) {}
-  OpSchema(const string& file, const int line) : file_(file), line_(line) {}
+  OpSchema(const char* file, const int line) : file_(file), line_(line) {}
 
   /**
    * @brief Returns the file that the op schema is registered from.
    */
-  inline const string& file() const {
+  inline const char* file() const {
     return file_;
   }
 
@@ -55,11 +55,10 @@ class OpSchema {
   }
 
   /**
-   * @brief Returns the docstring of the op schema.
+   * @brief Returns the docstring of the op schema. A docstring set with
+   * SetDocGenerator() is generated by the first call.
    */
-  inline const char* doc() const {
-    return doc_.empty() ? nullptr : doc_.c_str();
-  }
+  const char* doc() const;
 
   /**
    * @brief Verifies if an operator definition protobuf matches the pattern
@@ -173,12 +172,13 @@ class OpSchema {
 
   /*
    * @brief A struct to store various cost information about
-   * an operator such as FLOPs, total memory use and parameters.
+   * an operator such as FLOPs, memory traffic and parameters.
    */
   struct Cost {
-    uint64_t flops; // Floating point operations.
-    uint64_t bytes_moved; // Total memory used.
-    uint64_t params_bytes; // Memory footprint of parameters
+    uint64_t flops{0}; // Floating point operations.
+    uint64_t bytes_read{0}; // Bytes of the inputs read, parameters included.
+    uint64_t bytes_written{0}; // Bytes of the outputs written.
+    uint64_t params_bytes{0}; // Memory footprint of parameters
   };
   /**
    * @brief Registers a function that takes in an OperatorDef
@@ -223,7 +223,13 @@ class OpSchema {
   }
 
   // Functions to do documentation for the operator schema.
+  // SetDoc(const char*) keeps the pointer, it is meant for string literals.
+  // Docs that have to be formatted should use SetDocGenerator(), so that they
+  // are only built if the schema's doc is queried rather than at static
+  // initialization of every binary linking the operator.
+  OpSchema& SetDoc(const char* doc);
   OpSchema& SetDoc(const string& doc);
+  OpSchema& SetDocGenerator(std::function<string()> generator);
 
   struct Argument {
     Argument(const char* name, const char* description, bool required)
@@ -270,6 +276,17 @@ class OpSchema {
   // This op can pass data across devices
   OpSchema& InputsCanCrossDevices();
 
+  // Cost hint: running this op is cheaper than dispatching it to a thread
+  // pool (e.g. it only changes the metadata of its inputs), so async nets
+  // may run it inline on the thread that finished its parents
+  OpSchema& CheapToRun();
+
+  // The op only reads its inputs, without writing them in place or sharing
+  // their storage with its outputs, so they may be views of other tensors
+  // (see Tensor::ShareDataWithOffset), as the output_views Slice and Split
+  // produce
+  OpSchema& AcceptsTensorViews();
+
   /**
    * @brief A function to allow one to get the number of outputs based on the
    * number of inputs, if this schema supports it.
@@ -330,6 +347,17 @@ class OpSchema {
   bool inputs_can_cross_devices() const {
     return inputs_can_cross_devices_;
   }
+  bool cheap_to_run() const {
+    return cheap_to_run_;
+  }
+  bool accepts_tensor_views() const {
+    return accepts_tensor_views_;
+  }
+  // Whether output out_idx may be written into input in_idx
+  bool inplace_allowed(int in_idx, int out_idx) const {
+    return inplace_allowed_(in_idx, out_idx) ||
+        inplace_enforced_(in_idx, out_idx);
+  }
 
   /**
    * @brief Returns the required device location of inputs and outputs.
@@ -349,8 +377,10 @@ class OpSchema {
   }
 
  private:
-  string file_;
-  string doc_;
+  const char* file_;
+  const char* doc_ = nullptr;
+  mutable string doc_string_;
+  mutable std::function<string()> doc_generator_;
   string onnx_schema_;
   std::vector<Argument> args_{};
   std::vector<std::pair<const char*, const char*>> input_desc_{};
@@ -362,6 +392,8 @@ class OpSchema {
   int max_output_ = std::numeric_limits<int>::max();
   bool private_ = false;
   bool inputs_can_cross_devices_ = false;
+  bool cheap_to_run_ = false;
+  bool accepts_tensor_views_ = false;
   std::function<bool(int)> num_inputs_allowed_ = [](int) { return true; };
   std::function<bool(int)> num_outputs_allowed_ = [](int) { return true; };
   std::function<bool(int, int)> num_inputs_outputs_allowed_ = [](int, int) {
@@ -402,11 +434,11 @@ class OpSchema {
 class OpSchemaRegistry {
  public:
   static OpSchema&
-  NewSchema(const string& key, const string& file, const int line) {
+  NewSchema(const string& key, const char* file, const int line) {
     auto& m = map();
-    auto it = m.find(key);
-    if (it != m.end()) {
-      const auto& schema = it->second;
+    auto it = m.emplace(key, OpSchema(file, line));
+    if (!it.second) {
+      const auto& schema = it.first->second;
       std::ios_base::Init init;
       std::cerr << "Trying to register schema with name " << key
                 << " from file " << file << " line " << line
@@ -414,8 +446,7 @@ class OpSchemaRegistry {
                 << " line " << schema.line();
       abort();
     }
-    m.emplace(std::make_pair(key, OpSchema(file, line)));
-    return m[key];
+    return it.first->second;
   }
 
   static const OpSchema* Schema(const string& key) {
@@ -467,6 +498,53 @@ inline vector<TIndex> GetDimsVector(const TensorShape& shape) {
   return dims;
 }
 
+// The number of elements of a tensor of shape X in the dimensions [start,
+// stop), stop being the number of dimensions if negative
+inline uint64_t nElemBetweenDim(const TensorShape& X, int start, int stop) {
+  if (stop < 0) {
+    stop = X.dims_size();
+  }
+  uint64_t size = 1;
+  for (int i = start; i < stop; ++i) {
+    size *= X.dims(i);
+  }
+  return size;
+}
+
+// The number of elements of a tensor of shape X from dimension dim on
+inline uint64_t nElemFromDim(const TensorShape& X, int dim = 0) {
+  return nElemBetweenDim(X, dim, -1);
+}
+
+// The size in bytes of the elements of a tensor of shape X, those of unknown
+// type being counted as floats
+inline uint64_t nBytesOfShape(const TensorShape& X) {
+  size_t itemsize = sizeof(float);
+  switch (X.data_type()) {
+    case TensorProto::BOOL:
+    case TensorProto::BYTE:
+    case TensorProto::UINT8:
+    case TensorProto::INT8:
+      itemsize = 1;
+      break;
+    case TensorProto::UINT16:
+    case TensorProto::INT16:
+    case TensorProto::FLOAT16:
+      itemsize = 2;
+      break;
+    case TensorProto::INT64:
+    case TensorProto::DOUBLE:
+      itemsize = 8;
+      break;
+    case TensorProto::STRING:
+      itemsize = sizeof(std::string);
+      break;
+    default:
+      break;
+  }
+  return nElemFromDim(X) * itemsize;
+}
+
 // Helper function for infer op inputs and outputs device information.
 inline std::pair<std::vector<DeviceOption>, std::vector<DeviceOption>>
 InferOpInputOutputDevice(const OperatorDef& op) {
@@ -477,20 +555,19 @@ InferOpInputOutputDevice(const OperatorDef& op) {
   return op_schema->InferDevice(op);
 }
 
+// Cost of operators doing OpsPerPoint operations per element of their first
+// input, and writing outputs of its shape and type
 template <uint64_t OpsPerPoint>
 OpSchema::Cost PointwiseCostInference(
-    const OperatorDef& /* unused */,
+    const OperatorDef& def,
     const vector<TensorShape>& inputs) {
   struct OpSchema::Cost c;
   const TensorShape X = inputs[0];
-  uint64_t size = 1;
-
-  for (auto i = 0; i < X.dims().size(); ++i) {
-    size *= X.dims(i);
+  c.flops = nElemFromDim(X) * OpsPerPoint;
+  for (const auto& input : inputs) {
+    c.bytes_read += nBytesOfShape(input);
   }
-
-  c.flops = size * OpsPerPoint;
-  c.bytes_moved = size * sizeof(X.data_type());
+  c.bytes_written = def.output_size() * nBytesOfShape(X);
   return c;
 }
 
@@ -35,6 +35,27 @@ TEST(OperatorSchemaTest, BasicSchema) {
   EXPECT_FALSE(schema->Verify(def3));
 }
 
+static int doc_generated = 0;
+
+OPERATOR_SCHEMA(OpSchemaGeneratedDocOp)
+  .NumInputs(1).NumOutputs(1)
+  .SetDocGenerator([]() {
+    ++doc_generated;
+    return string("Generated Documentation");
+  });
+
+TEST(OperatorSchemaTest, GeneratedDoc) {
+  const OpSchema* schema = OpSchemaRegistry::Schema("OpSchemaGeneratedDocOp");
+#ifdef CAFFE2_NO_OPERATOR_SCHEMA
+  EXPECT_TRUE(schema == nullptr);
+  return;
+#endif
+  EXPECT_EQ(doc_generated, 0);
+  EXPECT_STREQ(schema->doc(), "Generated Documentation");
+  EXPECT_STREQ(schema->doc(), "Generated Documentation");
+  EXPECT_EQ(doc_generated, 1);
+}
+
 OPERATOR_SCHEMA(OpSchemaSpecifiedInputOutputOp)
   .NumInputs({2, 4}).NumOutputs({1, 3});
 
@@ -276,4 +297,35 @@ TEST(OperatorSchemaTest, TestCostInference) {
   EXPECT_EQ(2000, schema->InferCost(def, shapes).flops);
 }
 
+OPERATOR_SCHEMA(OpSchemaPointwiseCostInference)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<3>);
+
+TEST(OperatorSchemaTest, TestPointwiseCostInference) {
+  const OpSchema* schema =
+      OpSchemaRegistry::Schema("OpSchemaPointwiseCostInference");
+#ifdef CAFFE2_NO_OPERATOR_SCHEMA
+  EXPECT_TRUE(schema == nullptr);
+  return;
+#endif
+  if (!schema) {
+    return;
+  }
+  OperatorDef def = CreateOperatorDef(
+      "OpSchemaPointwiseCostInference",
+      "",
+      vector<string>{"X", "b"},
+      vector<string>{"Y"});
+  vector<TensorShape> shapes(2);
+  shapes[0] = CreateTensorShape(vector<int>{4, 5}, TensorProto::FLOAT);
+  // Broadcast
+  shapes[1] = CreateTensorShape(vector<int>{5}, TensorProto::DOUBLE);
+  const auto cost = schema->InferCost(def, shapes);
+  EXPECT_EQ(60, cost.flops);
+  EXPECT_EQ(20 * sizeof(float) + 5 * sizeof(double), cost.bytes_read);
+  EXPECT_EQ(20 * sizeof(float), cost.bytes_written);
+  EXPECT_EQ(0, cost.params_bytes);
+}
+
 }  // namespace caffe2
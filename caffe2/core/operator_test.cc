@@ -192,6 +192,19 @@ TEST(OperatorTest, TestParameterAccess) {
   EXPECT_EQ(default2.size(), 0);
 }
 
+TEST(OperatorTest, ParametersAreKeptFromConstruction) {
+  OperatorDef op_def;
+  Workspace ws;
+  op_def.set_type("JustTest");
+  AddArgument<int>("arg0", 3, &op_def);
+  OperatorBase op(op_def, &ws);
+  // The arguments are indexed at construction, not read from the debug def
+  op.set_debug_def(nullptr);
+  EXPECT_TRUE(op.HasArgument("arg0"));
+  EXPECT_TRUE(op.HasSingleArgumentOfType<int>("arg0"));
+  EXPECT_EQ(op.GetSingleArgument<int>("arg0", 0), 3);
+}
+
 TEST(OperatorTest, CannotAccessParameterWithWrongType) {
   OperatorDef op_def;
   Workspace ws;
@@ -0,0 +1,209 @@
+#include "caffe2/core/parameter_store.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define CAFFE2_PARAMETER_STORE_USE_MMAP
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/murmur_hash3.h"
+
+CAFFE2_DEFINE_int64(
+    caffe2_parameter_store_min_bytes,
+    1 << 16,
+    "Tensors smaller than this are not deduplicated by the parameter store, "
+    "which keeps every stored tensor in its own pages.");
+CAFFE2_DEFINE_bool(
+    caffe2_parameter_store_huge_pages,
+    false,
+    "If set, ask for transparent huge pages to back the parameter store.");
+
+namespace caffe2 {
+
+namespace {
+
+uint64_t HashTensor(const TensorCPU& tensor) {
+  // MurmurHash3 takes an int length, so big tensors are hashed by chunks
+  constexpr size_t kChunk = 1 << 30;
+  const auto* data = static_cast<const char*>(tensor.raw_data());
+  uint64_t hash[2] = {static_cast<uint64_t>(tensor.meta().id()), 0};
+  for (auto d : tensor.dims()) {
+    hash[0] = hash[0] * 31 + d;
+  }
+  for (size_t offset = 0; offset < tensor.nbytes(); offset += kChunk) {
+    const auto len = std::min(kChunk, tensor.nbytes() - offset);
+    uint64_t chunk[2];
+    MurmurHash3_x64_128(
+        data + offset,
+        static_cast<int>(len),
+        static_cast<uint32_t>(hash[0]),
+        chunk);
+    hash[0] ^= chunk[0] + 0x9e3779b97f4a7c15ULL + (hash[0] << 6);
+    hash[1] ^= chunk[1];
+  }
+  return hash[0] ^ hash[1];
+}
+
+size_t PageSize() {
+#ifdef CAFFE2_PARAMETER_STORE_USE_MMAP
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+#else
+  return 1;
+#endif
+}
+
+// Allocates read-only memory holding a copy of nbytes from src
+void* AllocateReadOnly(const void* src, size_t nbytes, size_t* capacity) {
+#ifdef CAFFE2_PARAMETER_STORE_USE_MMAP
+  *capacity = (nbytes + PageSize() - 1) / PageSize() * PageSize();
+  void* data = mmap(
+      nullptr,
+      *capacity,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0);
+  CAFFE_ENFORCE(data != MAP_FAILED, "Failed to map ", *capacity, " bytes.");
+#ifdef MADV_HUGEPAGE
+  if (FLAGS_caffe2_parameter_store_huge_pages) {
+    madvise(data, *capacity, MADV_HUGEPAGE);
+  }
+#endif
+  memcpy(data, src, nbytes);
+  CAFFE_ENFORCE_EQ(mprotect(data, *capacity, PROT_READ), 0);
+  return data;
+#else
+  *capacity = nbytes;
+  void* data = new char[nbytes];
+  memcpy(data, src, nbytes);
+  return data;
+#endif
+}
+
+void FreeReadOnly(void* data, size_t capacity) {
+#ifdef CAFFE2_PARAMETER_STORE_USE_MMAP
+  munmap(data, capacity);
+#else
+  delete[] static_cast<char*>(data);
+#endif
+}
+
+} // namespace
+
+struct ParameterStore::Entry {
+  Entry(ParameterStore* store, uint64_t hash, const TensorCPU& tensor)
+      : store(store),
+        hash(hash),
+        meta(tensor.meta()),
+        dims(tensor.dims()),
+        nbytes(tensor.nbytes()) {
+    data = AllocateReadOnly(tensor.raw_data(), nbytes, &capacity);
+  }
+
+  ~Entry() {
+    store->Remove(this);
+    FreeReadOnly(data, capacity);
+  }
+
+  bool Matches(const TensorCPU& tensor) const {
+    return tensor.meta() == meta && tensor.dims() == dims &&
+        memcmp(tensor.raw_data(), data, nbytes) == 0;
+  }
+
+  ParameterStore* store;
+  const uint64_t hash;
+  const TypeMeta meta;
+  const TensorDims dims;
+  const size_t nbytes;
+  void* data;
+  size_t capacity;
+};
+
+namespace {
+
+// Deleter of the tensors using an entry, which holds it until they are
+// reallocated or freed
+struct EntryRef {
+  std::shared_ptr<void> entry;
+  void operator()(void* /* unused */) const {}
+};
+
+} // namespace
+
+ParameterStore::~ParameterStore() {
+  CHECK(entries_.empty())
+      << entries_.size()
+      << " tensors still use the parameter store being destroyed.";
+}
+
+ParameterStore& ParameterStore::Global() {
+  // Leaked, as the tensors of static objects may outlive it otherwise
+  static auto* store = new ParameterStore();
+  return *store;
+}
+
+bool ParameterStore::Share(TensorCPU* tensor) {
+  CAFFE_ENFORCE(tensor);
+  const auto& meta = tensor->meta();
+  if (tensor->size() <= 0 || meta.ctor() || meta.copy() || meta.dtor() ||
+      tensor->nbytes() <
+          static_cast<size_t>(FLAGS_caffe2_parameter_store_min_bytes)) {
+    return false;
+  }
+  const auto hash = HashTensor(*tensor);
+  std::shared_ptr<Entry> entry;
+  // Released after the lock, as the last reference to an entry removes it
+  std::vector<std::shared_ptr<Entry>> collisions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto range = entries_.equal_range(hash);
+    for (auto it = range.first; it != range.second && !entry; ++it) {
+      auto candidate = it->second.second.lock();
+      if (candidate && candidate->Matches(*tensor)) {
+        entry = std::move(candidate);
+      } else if (candidate) {
+        collisions.push_back(std::move(candidate));
+      }
+    }
+    if (!entry) {
+      entry = std::make_shared<Entry>(this, hash, *tensor);
+      entries_.emplace(
+          hash, std::make_pair(entry.get(), std::weak_ptr<Entry>(entry)));
+      nbytes_ += entry->nbytes;
+    }
+  }
+  // Outside of the lock, as this frees the previous storage of tensor, which
+  // may be a stored entry too.
+  tensor->ShareExternalPointer(
+      entry->data, entry->meta, entry->nbytes, EntryRef{entry});
+  return true;
+}
+
+void ParameterStore::Remove(Entry* entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto range = entries_.equal_range(entry->hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.first == entry) {
+      nbytes_ -= entry->nbytes;
+      entries_.erase(it);
+      return;
+    }
+  }
+}
+
+size_t ParameterStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t ParameterStore::nbytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return nbytes_;
+}
+
+} // namespace caffe2
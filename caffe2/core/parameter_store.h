@@ -0,0 +1,75 @@
+#ifndef CAFFE2_CORE_PARAMETER_STORE_H_
+#define CAFFE2_CORE_PARAMETER_STORE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+#include "caffe2/core/tensor.h"
+
+CAFFE2_DECLARE_int64(caffe2_parameter_store_min_bytes);
+CAFFE2_DECLARE_bool(caffe2_parameter_store_huge_pages);
+
+namespace caffe2 {
+
+/**
+ * A store of read-only tensors deduplicated by content, so that the
+ * parameters common to several models loaded in a process, e.g. embedding
+ * tables or encoders shared between models, are kept in memory once.
+ *
+ * Share() makes a tensor use the stored copy of its content, storing it
+ * first if no tensor of the same type, shape and bytes is stored yet. The
+ * stored copies are reference counted by the tensors using them and freed
+ * with the last one. On Linux they are mapped read-only, so that writing a
+ * shared parameter faults instead of silently changing it for every model,
+ * and optionally backed by transparent huge pages.
+ *
+ * Predictors share the parameters made by their init_net through Global()
+ * if --caffe2_predictor_share_parameters is set.
+ */
+class ParameterStore {
+ public:
+  ParameterStore() = default;
+  // The tensors shared through the store must be freed before it
+  ~ParameterStore();
+
+  // The store shared by the whole process
+  static ParameterStore& Global();
+
+  /**
+   * Makes tensor use the stored copy of its content. Returns false, leaving
+   * tensor untouched, for the tensors that are not stored: those smaller than
+   * --caffe2_parameter_store_min_bytes and those of types that are not plain
+   * old data, such as strings.
+   *
+   * The tensor must not be written afterwards, until it is resized or
+   * reallocated.
+   */
+  bool Share(TensorCPU* tensor);
+
+  // Number of distinct tensors stored, and their total size
+  size_t size() const;
+  size_t nbytes() const;
+
+ private:
+  struct Entry;
+
+  void Remove(Entry* entry);
+
+  mutable std::mutex mutex_;
+  // Content hash -> entries with that hash. The entries remove themselves
+  // when the last tensor using them is freed.
+  std::unordered_multimap<uint64_t, std::pair<Entry*, std::weak_ptr<Entry>>>
+      entries_;
+  size_t nbytes_ = 0;
+
+  DISABLE_COPY_AND_ASSIGN(ParameterStore);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_PARAMETER_STORE_H_
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/parameter_store.h"
+
+namespace caffe2 {
+
+namespace {
+
+void Fill(TensorCPU* tensor, float value) {
+  tensor->Resize(256, 128);
+  auto* data = tensor->mutable_data<float>();
+  for (int i = 0; i < tensor->size(); ++i) {
+    data[i] = value + i;
+  }
+}
+
+TEST(ParameterStoreTest, TestDeduplicates) {
+  ParameterStore store;
+  TensorCPU a, b, c;
+  Fill(&a, 1);
+  Fill(&b, 1);
+  Fill(&c, 2);
+  TensorCPU expected;
+  expected.CopyFrom(a);
+  EXPECT_TRUE(store.Share(&a));
+  EXPECT_TRUE(store.Share(&b));
+  EXPECT_TRUE(store.Share(&c));
+  EXPECT_EQ(a.raw_data(), b.raw_data());
+  EXPECT_NE(a.raw_data(), c.raw_data());
+  EXPECT_EQ(store.size(), 2);
+  EXPECT_EQ(store.nbytes(), a.nbytes() + c.nbytes());
+  for (int i = 0; i < a.size(); ++i) {
+    EXPECT_EQ(b.data<float>()[i], expected.data<float>()[i]);
+  }
+
+  // Freed with the last tensor using it
+  a.FreeMemory();
+  EXPECT_EQ(store.size(), 2);
+  b.FreeMemory();
+  c.FreeMemory();
+  EXPECT_EQ(store.size(), 0);
+  EXPECT_EQ(store.nbytes(), 0);
+}
+
+TEST(ParameterStoreTest, TestSkipsSmallTensors) {
+  ParameterStore store;
+  TensorCPU small;
+  small.Resize(4);
+  small.mutable_data<float>();
+  EXPECT_FALSE(store.Share(&small));
+  TensorCPU strings;
+  strings.Resize(1 << 16);
+  strings.mutable_data<std::string>();
+  EXPECT_FALSE(store.Share(&strings));
+  EXPECT_EQ(store.size(), 0);
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -1,6 +1,7 @@
 #include "caffe2/core/plan_executor.h"
 
 #include <condition_variable>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -16,6 +17,11 @@ CAFFE2_DEFINE_bool(
     false,
     "If used we will handle exceptions in executor threads. "
     "This avoids SIGABRT but may cause process to deadlock");
+CAFFE2_DEFINE_bool(
+    caffe2_plan_executor_thread_pool,
+    true,
+    "If used the concurrent substeps of plans run on a persistent pool of "
+    "threads, rather than on new threads at every iteration of the step");
 
 namespace caffe2 {
 
@@ -69,6 +75,76 @@ struct Reporter {
   bool done{false};
 };
 
+/**
+ * The threads running the concurrent substeps of plans.
+ *
+ * Concurrent substeps often block for long, like the readers of a pipeline,
+ * and may have concurrent substeps of their own, so a task never waits for
+ * a thread: it runs on an idle thread, or on a new one if all are busy.
+ * Threads stay in the pool once their task is done, so the plans looping
+ * over short concurrent steps don't create threads at every iteration.
+ */
+class StepWorkerPool {
+ public:
+  static StepWorkerPool& Get() {
+    // Never destroyed, the idle threads wait until the process exits
+    static auto* pool = new StepWorkerPool();
+    return *pool;
+  }
+
+  // Runs the tasks and returns once all of them are done
+  void RunAll(std::vector<std::function<void()>> tasks) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    size_t remaining = tasks.size();
+    std::condition_variable done;
+    for (auto& task : tasks) {
+      tasks_.push_back(Task{std::move(task), &remaining, &done});
+      // Each available thread takes one of the pending tasks
+      if (tasks_.size() > available_) {
+        ++available_;
+        std::thread(&StepWorkerPool::WorkerLoop, this).detach();
+      } else {
+        cv_.notify_one();
+      }
+    }
+    done.wait(lock, [&remaining]() { return remaining == 0; });
+  }
+
+ private:
+  struct Task {
+    std::function<void()> run;
+    size_t* remaining;
+    std::condition_variable* done;
+  };
+
+  StepWorkerPool() {}
+
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this]() { return !tasks_.empty(); });
+      auto task = std::move(tasks_.front());
+      tasks_.pop_front();
+      --available_;
+      lock.unlock();
+      task.run();
+      lock.lock();
+      // Available again before the caller of RunAll returns, so that its
+      // next tasks don't start new threads
+      ++available_;
+      if (--*task.remaining == 0) {
+        task.done->notify_all();
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+  // The threads not running a task, or about to take one
+  size_t available_ = 0;
+};
+
 // Returns a function that returns `true` if we should continue
 // iterating, given the current iteration count.
 std::function<bool(int64_t)> getContinuationTest(
@@ -202,6 +278,10 @@ struct ExecutionStepWrapper {
       return compiledRef_;
     }
 
+    CompiledExecutionStep* get() {
+      return compiledRef_;
+    }
+
    private:
     CompiledGuard() {}
     std::unique_ptr<CompiledExecutionStep> compiled_;
@@ -280,8 +360,11 @@ struct CompiledExecutionStep {
       if (!step->concurrent_substeps() || step->substep().size() <= 1) {
         substepShouldContinue = externalShouldContinue;
       } else {
+        // The substeps stop at their next iteration once one of them failed
+        // or set the stop blob of this step
         substepShouldContinue = [this, externalShouldContinue](int64_t it) {
-          return !gotFailure && externalShouldContinue(it);
+          return !gotFailure && !getShouldStop(shouldStop) &&
+              externalShouldContinue(it);
         };
       }
 
@@ -315,6 +398,10 @@ struct CompiledExecutionStep {
       reportNet = nullptr;
     }
 
+#if !CAFFE2_MOBILE
+    iterationTime.reset(new ExecutionStepTime(step->name()));
+#endif // CAFFE2_MOBILE
+
     netShouldContinue = getContinuationTest(workspace, *step);
     shouldContinue = [this, externalShouldContinue](int64_t iter) {
       return externalShouldContinue(iter) && this->netShouldContinue(iter);
@@ -332,6 +419,9 @@ struct CompiledExecutionStep {
   ShouldContinue netShouldContinue;
   ShouldContinue shouldContinue;
   std::atomic<bool> gotFailure{false};
+#if !CAFFE2_MOBILE
+  std::unique_ptr<ExecutionStepTime> iterationTime;
+#endif // CAFFE2_MOBILE
 
  private:
   std::unique_ptr<Workspace> localWorkspace_;
@@ -346,6 +436,25 @@ std::unique_ptr<CompiledExecutionStep> ExecutionStepWrapper::doCompile() {
       ws_id_injector_));
 }
 
+// Adds the time of an iteration of a step to its stats once it is over
+class IterationTimer {
+ public:
+  explicit IterationTimer(CompiledExecutionStep* step) : step_(step) {}
+  ~IterationTimer() {
+#if !CAFFE2_MOBILE
+    auto& stat = *step_->iterationTime;
+    CAFFE_EVENT(
+        stat,
+        step_iteration_time_ns,
+        static_cast<int64_t>(timer_.NanoSeconds()));
+#endif // CAFFE2_MOBILE
+  }
+
+ private:
+  CompiledExecutionStep* step_;
+  Timer timer_;
+};
+
 #define CHECK_SHOULD_STOP(step, shouldStop)                       \
   if (getShouldStop(shouldStop)) {                                \
     VLOG(1) << "Execution step " << step.name() << " stopped by " \
@@ -389,6 +498,7 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
         (!step.has_num_concurrent_instances() ||
          step.num_concurrent_instances() <= 1);
     for (int64_t iter = 0; compiledStep->shouldContinue(iter); ++iter) {
+      IterationTimer iterationTimer(compiledStep.get());
       if (sequential) {
         VLOG(1) << "Executing step " << step.name() << " iteration " << iter;
         for (auto& substepWrapper : compiledStep->recurringSubsteps) {
@@ -432,16 +542,21 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
           }
         };
 
-        std::vector<std::thread> threads;
         auto numThreads = compiledStep->recurringSubsteps.size();
         if (step.has_num_concurrent_instances()) {
           numThreads *= step.num_concurrent_instances();
         }
-        for (int64_t i = 0; i < numThreads; ++i) {
-          threads.emplace_back(worker);
-        }
-        for (auto& thread : threads) {
-          thread.join();
+        if (FLAGS_caffe2_plan_executor_thread_pool) {
+          StepWorkerPool::Get().RunAll(
+              std::vector<std::function<void()>>(numThreads, worker));
+        } else {
+          std::vector<std::thread> threads;
+          for (int64_t i = 0; i < numThreads; ++i) {
+            threads.emplace_back(worker);
+          }
+          for (auto& thread : threads) {
+            thread.join();
+          }
         }
         if (compiledStep->gotFailure) {
           LOG(ERROR) << "One of the workers failed.";
@@ -460,6 +575,7 @@ bool ExecuteStepRecursive(ExecutionStepWrapper& stepWrapper) {
   } else {
     // If this ExecutionStep just contains nets, we can directly run it.
     for (int64_t iter = 0; compiledStep->shouldContinue(iter); ++iter) {
+      IterationTimer iterationTimer(compiledStep.get());
       VLOG(1) << "Executing networks " << step.name() << " iteration " << iter;
       for (NetBase* network : compiledStep->networks) {
         if (!network->Run()) {
@@ -513,7 +629,7 @@ bool RunPlanOnWorkspace(
   }
   float exec_time = plan_timer.Seconds();
 
-#ifndef CAFFE2_MOBILE
+#if !CAFFE2_MOBILE
   PlanExecutionTime plan_stat(plan.name());
   CAFFE_EVENT(
       plan_stat, plan_execution_time_ns, (long)(exec_time * 1000000000));
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <functional>
-#ifndef CAFFE2_MOBILE
+
+#include "caffe2/core/common.h"
+#if !CAFFE2_MOBILE
 #include "caffe2/core/stats.h"
 #endif // CAFFE2_MOBILE
 
@@ -14,10 +16,17 @@ typedef std::function<bool(int)> ShouldContinue;
 
 bool RunPlanOnWorkspace(Workspace* ws, const PlanDef& plan, ShouldContinue);
 
-#ifndef CAFFE2_MOBILE
+#if !CAFFE2_MOBILE
 struct PlanExecutionTime {
   CAFFE_STAT_CTOR(PlanExecutionTime);
   CAFFE_EXPORTED_STAT(plan_execution_time_ns);
 };
+
+// Time and number of the iterations of an execution step, by step name. The
+// report nets of a plan can read them with StatRegistryExport while it runs.
+struct ExecutionStepTime {
+  CAFFE_STAT_CTOR(ExecutionStepTime);
+  CAFFE_AVG_EXPORTED_STAT(step_iteration_time_ns);
+};
 #endif // CAFFE2_MOBILE
 }
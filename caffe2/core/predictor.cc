@@ -2,33 +2,40 @@
 
 #include <unordered_set>
 
+#include "caffe2/core/parameter_store.h"
+
+CAFFE2_DEFINE_bool(
+    caffe2_predictor_share_parameters,
+    false,
+    "If set, the parameters made by the init_net of Predictors are "
+    "deduplicated across the process by the global ParameterStore.");
+
 namespace caffe2 {
 
 namespace {
 
-void enforceIsTensor(Workspace* ws, const std::string& name) {
-  auto blob = ws->GetBlob(name);
+void enforceIsTensor(const Blob* blob, const std::string& name) {
   CAFFE_ENFORCE(blob, "Blob does not exist: ", name);
   CAFFE_ENFORCE(
       blob->template IsType<TensorCPU>(), "Blob is not a CPU Tensor: ", name);
 }
 
+void shareInputTensor(Blob* blob, const std::string& name, TensorCPU* input) {
+  enforceIsTensor(blob, name);
+  auto* tensor = blob->template GetMutable<TensorCPU>();
+  tensor->ResizeLike(*input);
+  tensor->ShareData(*input);
+}
+
 void shareInputTensor(
     Workspace* ws,
     const std::string& name,
     TensorCPU* input) {
-  enforceIsTensor(ws, name);
-  auto* blob = ws->GetBlob(name);
-  CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
-  auto* tensor = blob->template GetMutable<TensorCPU>();
-  tensor->ResizeLike(*input);
-  tensor->ShareData(*input);
+  shareInputTensor(ws->GetBlob(name), name, input);
 }
 
-TensorCPU* extractOutputTensor(Workspace* ws, const std::string& name) {
-  enforceIsTensor(ws, name);
-  auto* blob = ws->GetBlob(name);
-  CAFFE_ENFORCE(blob, "Blob: ", name, " does not exist");
+TensorCPU* extractOutputTensor(Blob* blob, const std::string& name) {
+  enforceIsTensor(blob, name);
   return blob->template GetMutable<TensorCPU>();
 }
 
@@ -71,8 +78,11 @@ Predictor::Predictor(
     const NetDef& init_net,
     const NetDef& run_net,
     Workspace* parent)
-    : run_net_(run_net), ws_(parent) {
+    : run_net_(run_net), ws_(parent ? parent->RootFolder() : ".", parent) {
   CAFFE_ENFORCE(ws_.RunNetOnce(init_net));
+  if (FLAGS_caffe2_predictor_share_parameters) {
+    shareParameters();
+  }
 
   // real model inputs can be fed later in run* functions
   const auto& initialized_vec = ws_.Blobs();
@@ -85,14 +95,51 @@ Predictor::Predictor(
     }
   }
   CAFFE_ENFORCE(ws_.CreateNet(run_net));
+  bindBlobs();
 }
 
 Predictor::~Predictor() {}
 
+void Predictor::shareParameters() {
+  // Blobs written by run_net, e.g. state kept across runs, stay private
+  std::unordered_set<std::string> written;
+  for (const auto& op : run_net_.op()) {
+    written.insert(op.output().begin(), op.output().end());
+  }
+  size_t shared_bytes = 0;
+  for (const auto& name : ws_.LocalBlobs()) {
+    auto* blob = ws_.GetBlob(name);
+    if (written.count(name) || !blob->IsType<TensorCPU>()) {
+      continue;
+    }
+    auto* tensor = blob->GetMutable<TensorCPU>();
+    if (ParameterStore::Global().Share(tensor)) {
+      shared_bytes += tensor->nbytes();
+    }
+  }
+  VLOG(1) << "Predictor of " << run_net_.name() << " shares " << shared_bytes
+          << " bytes of parameters, the process stores "
+          << ParameterStore::Global().nbytes();
+}
+
+void Predictor::bindBlobs() {
+  inputBlobs_.clear();
+  inputBlobsByName_.clear();
+  for (const auto& name : run_net_.external_input()) {
+    auto* blob = ws_.GetBlob(name);
+    inputBlobs_.push_back(blob);
+    inputBlobsByName_[name] = blob;
+  }
+  outputBlobs_.clear();
+  for (const auto& name : run_net_.external_output()) {
+    outputBlobs_.push_back(ws_.GetBlob(name));
+  }
+}
+
 bool Predictor::run(const TensorVector& inputs, TensorVector* outputs) {
   CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
   for (auto i = 0; i < inputs.size(); ++i) {
-    shareInputTensor(&ws_, run_net_.external_input(i), inputs[i]);
+    shareInputTensor(inputBlobs_[i], run_net_.external_input(i), inputs[i]);
   }
 
   if (!ws_.RunNet(run_net_.name())) {
@@ -101,7 +148,8 @@ bool Predictor::run(const TensorVector& inputs, TensorVector* outputs) {
 
   outputs->resize(run_net_.external_output_size());
   for (auto i = 0; i < outputs->size(); ++i) {
-    (*outputs)[i] = extractOutputTensor(&ws_, run_net_.external_output(i));
+    (*outputs)[i] =
+        extractOutputTensor(outputBlobs_[i], run_net_.external_output(i));
   }
   return true;
 }
@@ -114,7 +162,12 @@ bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
     if (!inputNames_.empty()) {
       CAFFE_ENFORCE_GT(inputNames_.count(input.first), 0);
     }
-    shareInputTensor(&ws_, input.first, input.second);
+    auto blob = inputBlobsByName_.find(input.first);
+    if (blob != inputBlobsByName_.end()) {
+      shareInputTensor(blob->second, input.first, input.second);
+    } else {
+      shareInputTensor(&ws_, input.first, input.second);
+    }
   }
 
   if (!ws_.RunNet(run_net_.name())) {
@@ -123,7 +176,8 @@ bool Predictor::run_map(const TensorMap& inputs, TensorVector* outputs) {
 
   outputs->resize(run_net_.external_output_size());
   for (auto i = 0; i < outputs->size(); ++i) {
-    (*outputs)[i] = extractOutputTensor(&ws_, run_net_.external_output(i));
+    (*outputs)[i] =
+        extractOutputTensor(outputBlobs_[i], run_net_.external_output(i));
   }
   return true;
 }
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <unordered_set>
+#include "caffe2/core/flags.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/proto/metanet.pb.h"
 #include "caffe2/proto/predictor_consts.pb.h"
 
+CAFFE2_DECLARE_bool(caffe2_predictor_share_parameters);
+
 namespace caffe2 {
 
 class Predictor {
@@ -18,7 +21,9 @@ class Predictor {
   Predictor(const MetaNetDef& net, Workspace* parent = nullptr);
 
   // Runs the `init_net` once, then saves the `run_net` to be executed
-  // in `::run`
+  // in `::run`. The relative paths of the ops of `init_net`, e.g. the
+  // weights file of a model exported with mobile_exporter.ExportMapped,
+  // are relative to the root folder of `parent`.
   Predictor(
       const NetDef& init_net,
       const NetDef& run_net,
@@ -49,9 +54,28 @@ class Predictor {
     return &ws_;
   };
 
+  // The net running `run_net`, to attach observers to
+  NetBase* net() {
+    return ws_.GetNet(run_net_.name());
+  }
+
  private:
+  // Makes the tensors made by init_net and not written by run_net use the
+  // copies of the global ParameterStore, see
+  // --caffe2_predictor_share_parameters
+  void shareParameters();
+
+  // Resolves the blobs of the run_net inputs and outputs once, so that run()
+  // binds them without looking them up by name
+  void bindBlobs();
+
   NetDef run_net_;
   Workspace ws_;
   std::unordered_set<std::string> inputNames_;
+  // Blobs of run_net external inputs and outputs, in order. They stay valid
+  // as long as the blobs aren't removed from ws_.
+  std::vector<Blob*> inputBlobs_;
+  std::vector<Blob*> outputBlobs_;
+  std::unordered_map<std::string, Blob*> inputBlobsByName_;
 };
 }
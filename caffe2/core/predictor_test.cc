@@ -1,11 +1,17 @@
+#include "caffe2/core/batching_predictor.h"
+#include "caffe2/core/concurrent_predictor.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/parameter_store.h"
 #include "caffe2/core/predictor.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/math.h"
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <thread>
+
 namespace caffe2 {
 
 namespace {
@@ -184,6 +190,26 @@ TEST_F(PredictorTest, SimpleBatchSized) {
   EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
 }
 
+TEST_F(PredictorTest, SharedParameters) {
+  FLAGS_caffe2_predictor_share_parameters = true;
+  FLAGS_caffe2_parameter_store_min_bytes = 0;
+  Predictor p1(parseNetDef(initSpec), parseNetDef(predictSpec));
+  Predictor p2(parseNetDef(initSpec), parseNetDef(predictSpec));
+  FLAGS_caffe2_predictor_share_parameters = false;
+  FLAGS_caffe2_parameter_store_min_bytes = 1 << 16;
+  for (const auto* name : {"W", "b"}) {
+    EXPECT_EQ(
+        p1.ws()->GetBlob(name)->Get<TensorCPU>().raw_data(),
+        p2.ws()->GetBlob(name)->Get<TensorCPU>().raw_data());
+  }
+
+  auto inputData = randomTensor({1, 4}, ctx_.get());
+  Predictor::TensorVector input{inputData->template GetMutable<TensorCPU>()};
+  Predictor::TensorVector output;
+  p2.run(input, &output);
+  EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
+}
+
 TEST_F(PredictorTest, SimpleBatchSizedMapInput) {
   auto inputData = randomTensor({1, 4}, ctx_.get());
   Predictor::TensorMap input{
@@ -222,4 +248,108 @@ TEST_F(PredictorMetaNetDefTest, SimpleMetaNetDefInitializer) {
   EXPECT_TRUE(output.front()->dim(1) == 10);
   EXPECT_NEAR(output.front()->data<float>()[4], 0.1209, 1E-4);
 }
+
+TEST(ConcurrentPredictorTest, SharedParametersMultipleThreads) {
+  ConcurrentPredictor p(parseNetDef(initSpec), parseNetDef(predictSpec), 2);
+  EXPECT_EQ(p.num_instances(), 1);
+  // Parameters live only in the shared workspace
+  EXPECT_TRUE(p.parameters()->HasBlob("W"));
+  EXPECT_FALSE(p.parameters()->HasBlob("y"));
+
+  const int kNumThreads = 4;
+  const int kNumRuns = 20;
+  std::vector<std::thread> threads;
+  std::atomic<int> num_ok(0);
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&]() {
+      DeviceOption op;
+      op.set_random_seed(1701);
+      CPUContext ctx(op);
+      auto inputData = randomTensor({1, 4}, &ctx);
+      auto* input = inputData->template GetMutable<TensorCPU>();
+      ConcurrentPredictor::OutputTensorVector output;
+      for (int i = 0; i < kNumRuns; ++i) {
+        if (!p.run({input}, &output) || output.size() != 1 ||
+            output.front()->dim(0) != 1 || output.front()->dim(1) != 10) {
+          return;
+        }
+        if (std::abs(output.front()->data<float>()[4] - 0.1209) > 1E-4) {
+          return;
+        }
+      }
+      ++num_ok;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_ok, kNumThreads);
+  EXPECT_LE(p.num_instances(), 2);
+}
+
+TEST_F(PredictorTest, BatchingPredictorScattersOutputs) {
+  BatchingPredictor::Options options;
+  options.max_batch_size = 4;
+  options.max_latency = std::chrono::milliseconds(100);
+  BatchingPredictor batching(p_.get(), options);
+
+  std::vector<std::unique_ptr<Blob>> inputs;
+  std::vector<std::future<BatchingPredictor::OutputTensorVector>> futures;
+  for (int i = 0; i < 3; ++i) {
+    inputs.push_back(randomTensor({i + 1, 4}, ctx_.get()));
+    futures.push_back(batching.run_map(
+        {{"data", inputs.back()->template GetMutable<TensorCPU>()}}));
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    auto output = futures[i].get();
+    EXPECT_EQ(output.size(), 1);
+    EXPECT_EQ(output.front()->dim(0), i + 1);
+    EXPECT_EQ(output.front()->dim(1), 10);
+
+    // Compare with an unbatched run
+    Predictor::TensorVector expected;
+    p_->run({inputs[i]->template GetMutable<TensorCPU>()}, &expected);
+    for (int j = 0; j < expected.front()->size(); ++j) {
+      EXPECT_NEAR(
+          output.front()->data<float>()[j],
+          expected.front()->data<float>()[j],
+          1E-5);
+    }
+  }
+}
+
+TEST_F(PredictorTest, BatchingConcurrentPredictor) {
+  ConcurrentPredictor concurrent(
+      parseNetDef(initSpec), parseNetDef(predictSpec), 2);
+  BatchingPredictor::Options options;
+  options.max_batch_size = 2;
+  options.max_latency = std::chrono::milliseconds(10);
+  options.num_threads = 2;
+  BatchingPredictor batching(&concurrent, options);
+
+  std::vector<std::unique_ptr<Blob>> inputs;
+  std::vector<std::future<BatchingPredictor::OutputTensorVector>> futures;
+  for (int i = 0; i < 6; ++i) {
+    inputs.push_back(randomTensor({1, 4}, ctx_.get()));
+    futures.push_back(batching.run_map(
+        {{"data", inputs.back()->template GetMutable<TensorCPU>()}}));
+  }
+
+  for (int i = 0; i < 6; ++i) {
+    auto output = futures[i].get();
+    ASSERT_EQ(output.size(), 1);
+    EXPECT_EQ(output.front()->dim(0), 1);
+    Predictor::TensorVector expected;
+    p_->run({inputs[i]->template GetMutable<TensorCPU>()}, &expected);
+    for (int j = 0; j < expected.front()->size(); ++j) {
+      EXPECT_NEAR(
+          output.front()->data<float>()[j],
+          expected.front()->data<float>()[j],
+          1E-5);
+    }
+  }
+  EXPECT_LE(concurrent.num_instances(), 2);
+}
+
 } // namespace caffe2
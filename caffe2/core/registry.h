@@ -41,6 +41,8 @@ template <class SrcType, class ObjectPtrType, class... Args>
 class Registry {
  public:
   typedef std::function<ObjectPtrType(Args...)> Creator;
+  // Returns a help message, called the first time the message is asked for
+  typedef const char* (*HelpMessageGetter)();
 
   Registry() : registry_() {}
 
@@ -65,6 +67,15 @@ class Registry {
     help_message_[key] = help_msg;
   }
 
+  void Register(
+      const SrcType& key,
+      Creator creator,
+      HelpMessageGetter help_msg_getter) {
+    Register(key, creator);
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    lazy_help_message_[key] = help_msg_getter;
+  }
+
   inline bool Has(const SrcType& key) { return (registry_.count(key) != 0); }
 
   ObjectPtrType Create(const SrcType& key, Args... args) {
@@ -87,10 +98,21 @@ class Registry {
   }
 
   const CaffeMap<SrcType, string>& HelpMessage() const {
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    for (const auto& it : lazy_help_message_) {
+      help_message_[it.first] = it.second();
+    }
+    lazy_help_message_.clear();
     return help_message_;
   }
 
   const char* HelpMessage(const SrcType& key) const {
+    std::lock_guard<std::mutex> lock(register_mutex_);
+    auto lazy_it = lazy_help_message_.find(key);
+    if (lazy_it != lazy_help_message_.end()) {
+      help_message_[key] = lazy_it->second();
+      lazy_help_message_.erase(lazy_it);
+    }
     auto it = help_message_.find(key);
     if (it == help_message_.end()) {
       return nullptr;
@@ -100,8 +122,12 @@ class Registry {
 
  private:
   CaffeMap<SrcType, Creator> registry_;
-  CaffeMap<SrcType, string> help_message_;
-  std::mutex register_mutex_;
+  // Help messages registered with a getter are only built when asked for, so
+  // that registering a class doesn't demangle its name at static
+  // initialization.
+  mutable CaffeMap<SrcType, string> help_message_;
+  mutable CaffeMap<SrcType, HelpMessageGetter> lazy_help_message_;
+  mutable std::mutex register_mutex_;
 
   DISABLE_COPY_AND_ASSIGN(Registry);
 };
@@ -117,6 +143,15 @@ class Registerer {
     registry->Register(key, creator, help_msg);
   }
 
+  Registerer(
+      const SrcType& key,
+      Registry<SrcType, ObjectPtrType, Args...>* registry,
+      typename Registry<SrcType, ObjectPtrType, Args...>::Creator creator,
+      typename Registry<SrcType, ObjectPtrType, Args...>::HelpMessageGetter
+          help_msg_getter) {
+    registry->Register(key, creator, help_msg_getter);
+  }
+
   template <class DerivedType>
   static ObjectPtrType DefaultCreator(Args... args) {
     // TODO(jiayq): old versions of NVCC does not handle make_unique well
@@ -173,7 +208,7 @@ class Registerer {
       key,                                                                    \
       RegistryName(),                                                         \
       Registerer##RegistryName::DefaultCreator<__VA_ARGS__>,                  \
-      DemangleType<__VA_ARGS__>());                                           \
+      DemangleType<__VA_ARGS__>);                                             \
   }
 
 // CAFFE_DECLARE_REGISTRY and CAFFE_DEFINE_REGISTRY are hard-wired to use string
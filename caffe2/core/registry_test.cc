@@ -42,5 +42,13 @@ TEST(RegistryTest, CanRunCreator) {
 TEST(RegistryTest, ReturnNullOnNonExistingCreator) {
   EXPECT_EQ(FooRegistry()->Create("Non-existing bar", 1), nullptr);
 }
+
+TEST(RegistryTest, HelpMessageIsTheClassName) {
+  EXPECT_STREQ(FooRegistry()->HelpMessage("Bar"), DemangleType<Bar>());
+  EXPECT_EQ(FooRegistry()->HelpMessage().size(), 2);
+  EXPECT_EQ(FooRegistry()->HelpMessage().at("AnotherBar"),
+            DemangleType<AnotherBar>());
+  EXPECT_EQ(FooRegistry()->HelpMessage("Non-existing bar"), nullptr);
+}
 }
 }  // namespace caffe2
@@ -1,5 +1,19 @@
 #pragma once
 
+// Static (USDT) probes of the "caffe2" provider, a nop unless a tracer like
+// perf or bpftrace attaches to them:
+//   operator_start/done(net, op name, op type, op)  with CAFFE2_ENABLE_SDT
+//   chain_scheduled(net name, net, chain)           async nets
+//   chain_start/done(net name, net, chain, stream)  async nets
+//   task_enqueue/dequeue(pool, queue)               thread pools
+//   task_steal(pool, thief queue, victim queue)     work stealing pool
+//   queue_read/write_start, _end                    blob queues
+//   queue_read/write_block, _unblock(name, queue)   blob queues
+//   cpu_alloc(ptr, bytes), cpu_free(ptr)            CPU allocators
+//   pinned_alloc/free(ptr, bytes)                   pinned memory pool
+//   cuda_alloc/free(ptr, bytes, gpu)                CUDAContext
+//   collective_start/done(collective, op)           Gloo and NCCL
+
 #if defined(__ELF__) && (defined(__x86_64__) || defined(__i386__))
 #include <caffe2/core/static_tracepoint_elfx86.h>
 
@@ -1,5 +1,6 @@
 #include "caffe2/core/stats.h"
 
+#include <algorithm>
 #include <condition_variable>
 #include <thread>
 
@@ -14,6 +15,29 @@ ExportedStatMap toMap(const ExportedStatList& stats) {
   return statMap;
 }
 
+constexpr int StatValue::kNumShards;
+
+int64_t StatValue::reset(int64_t value) {
+  int64_t previous = shards_[0].v.exchange(value);
+  for (int i = 1; i < kNumShards; ++i) {
+    previous += shards_[i].v.exchange(0);
+  }
+  return previous;
+}
+
+int64_t StatValue::get() const {
+  int64_t value = 0;
+  for (const auto& shard : shards_) {
+    value += shard.v.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int StatValue::nextShardIndex() {
+  static std::atomic<int> next{0};
+  return next++ % kNumShards;
+}
+
 StatValue* StatRegistry::add(const std::string& name) {
   std::lock_guard<std::mutex> lg(mutex_);
   auto it = stats_.find(name);
@@ -36,6 +60,9 @@ void StatRegistry::publish(ExportedStatList& exported, bool reset) {
     out.value = reset ? kv.second->reset() : kv.second->get();
     out.ts = std::chrono::high_resolution_clock::now();
   }
+  for (auto* publisher : publishers_) {
+    publisher->publish(exported, reset);
+  }
 }
 
 void StatRegistry::update(const ExportedStatList& data) {
@@ -44,8 +71,107 @@ void StatRegistry::update(const ExportedStatList& data) {
   }
 }
 
+void StatRegistry::addPublisher(StatPublisher* publisher) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  publishers_.push_back(publisher);
+}
+
+void StatRegistry::removePublisher(StatPublisher* publisher) {
+  std::lock_guard<std::mutex> lg(mutex_);
+  publishers_.erase(
+      std::remove(publishers_.begin(), publishers_.end(), publisher),
+      publishers_.end());
+}
+
 StatRegistry::~StatRegistry() {}
 
+constexpr int HistogramExportedStat::kSubBucketBits;
+constexpr int HistogramExportedStat::kSubBuckets;
+constexpr int HistogramExportedStat::kMaxBits;
+constexpr int HistogramExportedStat::kNumBuckets;
+
+HistogramExportedStat::HistogramExportedStat(
+    const std::string& gn,
+    const std::string& n)
+    : Stat(gn, n) {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  StatRegistry::get().addPublisher(this);
+}
+
+HistogramExportedStat::~HistogramExportedStat() {
+  StatRegistry::get().removePublisher(this);
+}
+
+int64_t HistogramExportedStat::bucketValue(int index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  int shift = index / kSubBuckets - 1;
+  int64_t lower = static_cast<int64_t>(kSubBuckets + index % kSubBuckets)
+      << shift;
+  // Middle of the bucket
+  return lower + ((int64_t(1) << shift) - 1) / 2;
+}
+
+HistogramExportedStat::Counts HistogramExportedStat::snapshot(
+    bool reset) const {
+  Counts counts;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    counts[i] = reset ? buckets_[i].exchange(0, std::memory_order_relaxed)
+                      : buckets_[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+int64_t HistogramExportedStat::percentile(const Counts& counts, double p) {
+  uint64_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  // Rank of the requested value, 1-based
+  auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * total + 0.5));
+  uint64_t cumulative = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    cumulative += counts[i];
+    if (cumulative >= rank) {
+      return bucketValue(i);
+    }
+  }
+  return bucketValue(kNumBuckets - 1);
+}
+
+int64_t HistogramExportedStat::count() const {
+  uint64_t total = 0;
+  for (const auto& bucket : buckets_) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+int64_t HistogramExportedStat::percentile(double p) const {
+  return percentile(snapshot(false), p);
+}
+
+void HistogramExportedStat::publish(ExportedStatList& exported, bool reset) {
+  const auto counts = snapshot(reset);
+  const auto ts = std::chrono::high_resolution_clock::now();
+  const auto prefix = groupName + "/" + name + "/";
+  uint64_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  exported.push_back({prefix + "count", static_cast<int64_t>(total), ts});
+  exported.push_back({prefix + "p50", percentile(counts, 0.5), ts});
+  exported.push_back({prefix + "p90", percentile(counts, 0.9), ts});
+  exported.push_back({prefix + "p99", percentile(counts, 0.99), ts});
+  exported.push_back({prefix + "p999", percentile(counts, 0.999), ts});
+}
+
 StatRegistry& StatRegistry::get() {
   static StatRegistry r;
   return r;
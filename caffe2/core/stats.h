@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -11,21 +12,51 @@
 
 namespace caffe2 {
 
+/**
+ * @brief Counter updated from many threads at once, e.g. by the data
+ * pipeline and the executors.
+ *
+ * The count is split into shards, each on its own cache line, and every
+ * thread always updates the same shard, so threads don't fight over a cache
+ * line unless there are more of them than shards. The shards are only summed
+ * when the value is read, i.e. when the registry is published.
+ */
 class StatValue {
-  std::atomic<int64_t> v_{0};
-
  public:
+  static constexpr int kNumShards = 16;
+
+  /**
+   * Adds `inc` to the shard of the calling thread and returns the new value
+   * of that shard, not of the whole counter.
+   */
   int64_t increment(int64_t inc) {
-    return v_ += inc;
+    return shards_[shardIndex()].v.fetch_add(inc, std::memory_order_relaxed) +
+        inc;
   }
 
-  int64_t reset(int64_t value = 0) {
-    return v_.exchange(value);
-  }
+  /**
+   * Sets the counter to `value`, returning the previous value. Increments
+   * racing with the reset are counted either before or after it.
+   */
+  int64_t reset(int64_t value = 0);
+
+  int64_t get() const;
 
-  int64_t get() const {
-    return v_.load();
+ private:
+  // Shards are padded rather than aligned, 64 bytes apart is enough to never
+  // share a cache line
+  struct Shard {
+    std::atomic<int64_t> v{0};
+    char padding[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  static int shardIndex() {
+    static thread_local int index = nextShardIndex();
+    return index;
   }
+  static int nextShardIndex();
+
+  std::array<Shard, kNumShards> shards_;
 };
 
 struct ExportedStatValue {
@@ -42,6 +73,24 @@ using ExportedStatMap = std::unordered_map<std::string, int64_t>;
 
 ExportedStatMap toMap(const ExportedStatList& stats);
 
+/**
+ * @brief Source of values that are computed at publish time rather than
+ * kept in a counter, e.g. percentiles of a histogram.
+ *
+ * Publishers are registered with StatRegistry::addPublisher and must be
+ * removed before they are destroyed.
+ */
+class StatPublisher {
+ public:
+  virtual ~StatPublisher() {}
+
+  /**
+   * Append the exported values to `exported`; if `reset` is true, start
+   * collecting from scratch.
+   */
+  virtual void publish(ExportedStatList& exported, bool reset) = 0;
+};
+
 /**
  * @brief Holds a map of atomic counters keyed by name.
  *
@@ -103,7 +152,8 @@ ExportedStatMap toMap(const ExportedStatList& stats);
  * The probe will be set up with the following arguments:
  *   - Probe name: field name (e.g. "num_runs")
  *   - Arg #0: instance name (e.g. "first", "second")
- *   - Arg #1: For CAFFE_EXPORTED_STAT, value of the updated counter
+ *   - Arg #1: For CAFFE_EXPORTED_STAT, value of the shard of the counter
+ *             updated by the calling thread (see StatValue)
  *             For CAFFE_STAT, -1 since no counter is available
  *   - Args ...: Arguments passed to CAFFE_EVENT, including update value
  *             when provided.
@@ -117,6 +167,7 @@ ExportedStatMap toMap(const ExportedStatList& stats);
 class StatRegistry {
   std::mutex mutex_;
   std::unordered_map<std::string, std::unique_ptr<StatValue>> stats_;
+  std::vector<StatPublisher*> publishers_;
 
  public:
   /**
@@ -150,6 +201,12 @@ class StatRegistry {
    */
   void update(const ExportedStatList& data);
 
+  /**
+   * Register a publisher whose values are appended on every publish().
+   */
+  void addPublisher(StatPublisher* publisher);
+  void removePublisher(StatPublisher* publisher);
+
   ~StatRegistry();
 };
 
@@ -258,6 +315,76 @@ class DetailedExportedStat : public ExportedStat {
   }
 };
 
+/**
+ * @brief Log-linear histogram of non-negative values (e.g. latencies in
+ * nanoseconds), exporting count and percentiles.
+ *
+ * Every power of two range is split into 16 buckets, so a percentile is
+ * within ~6% of the exact value; values below 16 are exact. Adding a value
+ * is a single relaxed atomic increment. Exported keys are
+ * `<group>/<name>/{count,p50,p90,p99,p999}`.
+ */
+class HistogramExportedStat : public Stat, public StatPublisher {
+ public:
+  HistogramExportedStat(const std::string& gn, const std::string& n);
+  ~HistogramExportedStat() override;
+
+  int64_t increment(int64_t value) {
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    return value;
+  }
+
+  template <typename T, typename Unused1, typename... Unused>
+  int64_t increment(T value, Unused1, Unused...) {
+    return increment(value);
+  }
+
+  int64_t count() const;
+
+  /**
+   * Approximate value below which fraction `p` of the added values lie.
+   */
+  int64_t percentile(double p) const;
+
+  void publish(ExportedStatList& exported, bool reset) override;
+
+ private:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  // Values of 2^kMaxBits and above go to the last bucket
+  static constexpr int kMaxBits = 40;
+  static constexpr int kNumBuckets =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  using Counts = std::array<uint64_t, kNumBuckets>;
+
+  static int bucketIndex(int64_t value) {
+    if (value < kSubBuckets) {
+      return value < 0 ? 0 : value;
+    }
+    auto uvalue = static_cast<uint64_t>(value);
+#ifdef _MSC_VER
+    int msb = 0;
+    while (uvalue >> (msb + 1)) {
+      ++msb;
+    }
+#else
+    int msb = 63 - __builtin_clzll(uvalue);
+#endif
+    if (msb >= kMaxBits) {
+      return kNumBuckets - 1;
+    }
+    int shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((uvalue >> shift) & (kSubBuckets - 1));
+  }
+
+  static int64_t bucketValue(int index);
+  static int64_t percentile(const Counts& counts, double p);
+  Counts snapshot(bool reset) const;
+
+  mutable std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+};
+
 namespace detail {
 
 template <class T>
@@ -311,6 +438,11 @@ _ScopeGuard<T> ScopeGuard(T f) {
     groupName, #name                       \
   }
 
+#define CAFFE_HISTOGRAM_EXPORTED_STAT(name) \
+  HistogramExportedStat name {              \
+    groupName, #name                        \
+  }
+
 #define CAFFE_STAT(name) \
   Stat name {            \
     groupName, #name     \
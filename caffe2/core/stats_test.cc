@@ -1,6 +1,8 @@
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include "caffe2/core/stats.h"
 #include <gtest/gtest.h>
@@ -117,5 +119,64 @@ TEST(StatsTest, StatsTestSimple) {
       toMap(reg2.publish()), ExportedStatMap({{"i1/s3", 0}, {"i2/s3", 0}}));
 }
 
+TEST(StatsTest, StatsTestConcurrentIncrements) {
+  struct TestStats {
+    CAFFE_STAT_CTOR(TestStats);
+    CAFFE_EXPORTED_STAT(count);
+  };
+  TestStats stats("concurrent");
+  const int kNumThreads = 2 * StatValue::kNumShards + 1;
+  const int kNumIncrements = 10000;
+  std::atomic<bool> done{false};
+  int64_t published = 0;
+  // Resets racing with the increments must not lose any count
+  std::thread publisher([&]() {
+    while (!done) {
+      published += toMap(StatRegistry::get().publish(true))["concurrent/count"];
+    }
+  });
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kNumIncrements; ++j) {
+        CAFFE_EVENT(stats, count);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  done = true;
+  publisher.join();
+  published += toMap(StatRegistry::get().publish(true))["concurrent/count"];
+  EXPECT_EQ(published, kNumThreads * kNumIncrements);
+}
+
+TEST(StatsTest, StatsTestHistogram) {
+  struct TestStats {
+    CAFFE_STAT_CTOR(TestStats);
+    CAFFE_HISTOGRAM_EXPORTED_STAT(latency);
+  };
+  TestStats stats("hist");
+  for (int i = 1; i <= 1000; ++i) {
+    CAFFE_EVENT(stats, latency, i);
+  }
+  EXPECT_EQ(stats.latency.count(), 1000);
+  // Buckets are at most 1/16 of the value wide
+  const std::vector<std::pair<double, int64_t>> expected = {
+      {0.5, 500}, {0.9, 900}, {0.99, 990}, {0.999, 999}};
+  for (const auto& e : expected) {
+    EXPECT_NEAR(stats.latency.percentile(e.first), e.second, e.second / 16);
+  }
+  EXPECT_EQ(stats.latency.percentile(0.01), 10);
+
+  auto map = toMap(StatRegistry::get().publish(true));
+  EXPECT_EQ(map["hist/latency/count"], 1000);
+  EXPECT_NEAR(map["hist/latency/p99"], 990, 990 / 16);
+  // Reset on publish
+  EXPECT_EQ(stats.latency.count(), 0);
+  EXPECT_EQ(stats.latency.percentile(0.5), 0);
+}
+
 } // namespace
 } // namespace caffe2
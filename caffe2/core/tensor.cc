@@ -2,6 +2,7 @@
 
 #include "caffe2/core/blob_stats.h"
 #include "caffe2/core/flags.h"
+#include "caffe2/core/stats.h"
 
 CAFFE2_DEFINE_bool(
     caffe2_keep_on_shrink,
@@ -76,6 +77,20 @@ void RegisterTensorInfoFunction(CaffeTypeId id, TensorInfoCall c) {
   tensor_info_call_registry_[id] = c;
 }
 
+namespace {
+struct CopyOnWriteStats {
+  CAFFE_STAT_CTOR(CopyOnWriteStats);
+  CAFFE_EXPORTED_STAT(copies);
+  CAFFE_EXPORTED_STAT(bytes_copied);
+};
+} // namespace
+
+void RecordCopyOnWrite(size_t nbytes) {
+  static CopyOnWriteStats stats("tensor_copy_on_write");
+  CAFFE_EVENT(stats, copies);
+  CAFFE_EVENT(stats, bytes_copied, nbytes);
+}
+
 namespace {
 
 struct TensorCPUStatGetter : BlobStatGetter {
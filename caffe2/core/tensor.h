@@ -1,6 +1,7 @@
 #ifndef CAFFE2_CORE_TENSOR_H_
 #define CAFFE2_CORE_TENSOR_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <fstream>
@@ -14,6 +15,7 @@
 #include "caffe2/core/context.h"
 #include "caffe2/core/typeid.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/utils/small_vector.h"
 
 // A global boolean variable to control whether we free memory when a Tensor
 // is shrinked to a smaller size. As a result, a Tensor is always going to
@@ -27,6 +29,21 @@ CAFFE2_DECLARE_int64(caffe2_max_keep_on_shrink_memory);
 
 namespace caffe2 {
 
+/**
+ * The dimensions of a tensor. Tensors of up to kTensorDimsInline dimensions
+ * keep them inline, so that the common shapes are set, copied and compared
+ * without any heap allocation. TensorDims converts implicitly to
+ * vector<TIndex>.
+ */
+constexpr size_t kTensorDimsInline = 6;
+using TensorDims = SmallVector<TIndex, kTensorDimsInline>;
+
+/**
+ * Counts a copy made by a copy-on-write tensor before it is written, see
+ * Tensor::ShareDataCopyOnWrite().
+ */
+void RecordCopyOnWrite(size_t nbytes);
+
 /**
  * A utility function to convert vector<int> to vector<TIndex>.
  */
@@ -36,8 +53,11 @@ inline vector<TIndex> ToVectorTIndex(const std::vector<int>& src) {
 
 /**
  * Return product of all dimensions starting from K
+ *
+ * The dims are either a vector<TIndex> or TensorDims.
  */
-inline TIndex size_from_dim_(int k, const vector<TIndex>& dims) {
+template <typename Dims>
+inline TIndex size_from_dim_(int k, const Dims& dims) {
   TIndex r = 1;
   for (int i = k; i < dims.size(); ++i) {
     r *= dims[i];
@@ -46,7 +66,8 @@ inline TIndex size_from_dim_(int k, const vector<TIndex>& dims) {
 }
 
 // Product of all dims up to
-inline TIndex size_to_dim_(int k, const vector<TIndex>& dims) {
+template <typename Dims>
+inline TIndex size_to_dim_(int k, const Dims& dims) {
   CAFFE_ENFORCE(k <= dims.size());
   TIndex r = 1;
   for (int i = 0; i < k; ++i) {
@@ -56,7 +77,8 @@ inline TIndex size_to_dim_(int k, const vector<TIndex>& dims) {
 }
 
 // Product of all dims between k and l (not including dims[k] and dims[l])
-inline TIndex size_between_dim_(int k, int l, const vector<TIndex>& dims) {
+template <typename Dims>
+inline TIndex size_between_dim_(int k, int l, const Dims& dims) {
   CAFFE_ENFORCE(l < dims.size());
   TIndex r = 1;
   if (k < l) {
@@ -167,6 +189,10 @@ class Tensor {
     if ((void*)&src == (void*)this) {
       return;
     }
+    if (copy_on_write_ && data_.use_count() > 1) {
+      // All the data is overwritten, no need to copy it first
+      FreeMemory();
+    }
     meta_ = src.meta();
     Resize(src.dims());
     if (size() > 0) {
@@ -230,8 +256,8 @@ class Tensor {
     size_ = newSize;
   }
 
-  template <class T, class ContextForCopy>
-  void Reserve(const std::vector<T>& newCapacity, ContextForCopy* context) {
+  template <class Dims, class ContextForCopy>
+  void Reserve(const Dims& newCapacity, ContextForCopy* context) {
     auto newSize = std::accumulate(
         newCapacity.begin(),
         newCapacity.end(),
@@ -252,6 +278,16 @@ class Tensor {
     reserved_ = true;
   }
 
+  /**
+   * @brief Keeps the current memory of the tensor, as after Reserve().
+   *
+   * Later resizes to sizes that fit in the capacity of the tensor then keep
+   * its memory, whatever caffe2_keep_on_shrink, and larger ones reallocate it.
+   */
+  void ReserveCurrentCapacity() {
+    reserved_ = true;
+  }
+
   /**
    * @brief Shrinks the outer-most dimension to given size, keeping the data.
    *
@@ -285,7 +321,7 @@ class Tensor {
    * items is the same, the underlying storage is kept.
    */
   template <typename... Ts>
-  void Resize(Ts... dim_source) {
+  void Resize(const Ts&... dim_source) {
     bool size_changed = SetDims(dim_source...);
     if (size_changed) {
       // If needed, we will free the data. the next mutable_data() call
@@ -323,7 +359,7 @@ class Tensor {
    * Resizes the tensor without touching underlying storage.
    * This requires the total size of the tensor to remains constant.
    */
-  inline void Reshape(const vector<TIndex>& dims) {
+  inline void Reshape(const TensorDims& dims) {
     TIndex new_size = 1;
     for (auto d : dims) {
       CAFFE_ENFORCE_GE_WITH_CALLER(d, 0);
@@ -341,8 +377,12 @@ class Tensor {
     dims_ = dims;
   }
 
+  inline void Reshape(const vector<TIndex>& dims) {
+    Reshape(TensorDims(dims));
+  }
+
   inline void Reshape(const vector<int>& dims) {
-    Reshape(ToVectorTIndex(dims));
+    Reshape(TensorDims(dims));
   }
 
   /**
@@ -353,6 +393,7 @@ class Tensor {
   inline void FreeMemory() {
     data_.reset();
     capacity_ = 0;
+    copy_on_write_ = false;
     // If reserved is true and we changed tensor memory then it is fine
     // to switch it to false, if Resize is called from Reserve and it triggers
     // FreeMemory() then reserved_ will be set to true at end of Reserve()
@@ -383,6 +424,8 @@ class Tensor {
     std::swap(shares_data_, other.shares_data_);
     std::swap(capacity_, other.capacity_);
     std::swap(reserved_, other.reserved_);
+    std::swap(copy_on_write_, other.copy_on_write_);
+    version_ = other.version_ = std::max(version_, other.version_) + 1;
   }
 
   /**
@@ -413,6 +456,73 @@ class Tensor {
     data_ = src.data_;
     capacity_ = src.capacity_;
     shares_data_ = true;
+    copy_on_write_ = false;
+    ++version_;
+  }
+
+  /**
+   * @brief Shares the data with another tensor until either of them is
+   * written.
+   *
+   * This tensor takes the shape and the data of src, as with ShareData(), and
+   * both become copy-on-write: reading them costs nothing, but the first
+   * mutable_data() or raw_mutable_data() call on either one while they still
+   * share the storage gives that tensor its own copy first, so that the
+   * other one doesn't see the writes. The copies are counted in the
+   * tensor_copy_on_write stats.
+   *
+   * Other tensors sharing the storage of src through ShareData() keep seeing
+   * the shared storage, not the copies.
+   *
+   * This marks src copy-on-write too, so no other thread may write or share
+   * src during the call. Concurrent reads through data() and raw_data() are
+   * fine, as they don't look at the copy-on-write state.
+   */
+  void ShareDataCopyOnWrite(Tensor* src) {
+    CAFFE_ENFORCE(src, "Source tensor must be specified");
+    Resize(src->dims());
+    ShareData(*src);
+    copy_on_write_ = true;
+    src->copy_on_write_ = true;
+  }
+
+  /**
+   * @brief Shares the data of src from its offset-th item, making this tensor
+   * a view of a contiguous range of src without any copy.
+   *
+   * As with ShareData(), the shape of this tensor must be set already, and
+   * the range must fit in src: offset + size() <= src.size(). Slices of the
+   * outermost dimension, such as rows [begin, end) of a matrix, are
+   * contiguous and can be shared this way. The storage of src is kept alive
+   * as long as this tensor uses it.
+   *
+   * Writing through either tensor writes to the other, so ops only output
+   * views of their inputs when asked to, see OpSchema::AcceptsTensorViews().
+   */
+  void ShareDataWithOffset(const Tensor& src, TIndex offset) {
+    CAFFE_ENFORCE_GE_WITH_CALLER(
+        size_, 0, "Set the shape of the tensor before sharing the data.");
+    CAFFE_ENFORCE_WITH_CALLER(
+        offset >= 0 && offset + size_ <= src.size_,
+        "The range [",
+        offset,
+        ", ",
+        offset + size_,
+        ") doesn't fit in the source tensor of size ",
+        src.size_);
+    CAFFE_ENFORCE_WITH_CALLER(
+        src.data_.get() || src.size_ == 0,
+        "Source tensor has no content and has size > 0");
+    meta_ = src.meta();
+    // Aliasing constructor, the view keeps the whole storage of src alive
+    data_ = std::shared_ptr<void>(
+        src.data_, static_cast<char*>(src.data_.get()) + offset * itemsize());
+    // Growing the view reallocates it rather than writing past the range
+    capacity_ = nbytes();
+    shares_data_ = true;
+    reserved_ = false;
+    copy_on_write_ = false;
+    ++version_;
   }
 
   /**
@@ -459,12 +569,33 @@ class Tensor {
       capacity_ = nbytes();
     }
     shares_data_ = true;
+    copy_on_write_ = false;
+    ++version_;
   }
 
   bool shares_data() const {
     return shares_data_;
   }
 
+  /**
+   * Whether the storage is shared with ShareDataCopyOnWrite() and will be
+   * copied before it is written.
+   */
+  bool copy_on_write() const {
+    return copy_on_write_;
+  }
+
+  /**
+   * Returns a counter that changes every time the data may be written through
+   * this tensor, that is on every call to mutable_data(), raw_mutable_data(),
+   * ShareData(), ShareExternalPointer() or swap(). Together with the address
+   * of the tensor, it lets operators cache values computed from an input
+   * tensor, such as transformed convolution filters, until it is modified.
+   */
+  inline uint64_t version() const {
+    return version_;
+  }
+
   /**
    * Returns a const raw void* pointer of the underlying storage. mutable_data()
    * or raw_mutable_data() must have been called prior to this function call.
@@ -508,6 +639,10 @@ class Tensor {
    * and a new storage will be created.
    */
   inline void* raw_mutable_data(const TypeMeta& meta) {
+    ++version_;
+    if (copy_on_write_) {
+      DetachCopyOnWrite(meta);
+    }
     // For 0-size tensors it's fine to return any pointer (including nullptr)
     if (meta_ == meta && (data_.get() || size_ == 0)) {
       return data_.get();
@@ -576,7 +711,8 @@ class Tensor {
    */
    template <typename T>
     inline T* mutable_data() {
-      if ((size_ == 0 || data_.get()) && IsType<T>()) {
+      if ((size_ == 0 || data_.get()) && IsType<T>() && !copy_on_write_) {
+        ++version_;
         return static_cast<T*>(data_.get());
       }
       return static_cast<T*>(raw_mutable_data(TypeMeta::Make<T>()));
@@ -606,9 +742,10 @@ class Tensor {
     return capacity_;
   }
   /**
-   * Returns the dimensions of the tensor as a vector.
+   * Returns the dimensions of the tensor. TensorDims has the read interface
+   * of a vector and converts implicitly to vector<TIndex>, which copies them.
    */
-  inline const vector<TIndex>& dims() const { return dims_; }
+  inline const TensorDims& dims() const { return dims_; }
 
   inline TIndex size_from_dim(int k) const {
     return size_from_dim_(k, dims_);
@@ -677,20 +814,58 @@ class Tensor {
   }
 
  protected:
-  vector<TIndex> dims_;
+  TensorDims dims_;
   TIndex size_ = -1;
   TypeMeta meta_;
   std::shared_ptr<void> data_;
   bool shares_data_ = false;
   size_t capacity_ = 0;
   bool reserved_ = false;
+  // Set on both tensors by ShareDataCopyOnWrite()
+  bool copy_on_write_ = false;
+  uint64_t version_ = 0;
   // In case of chunk load we store how much data was already loaded
 
  private:
+  // Gives this tensor its own storage before it is written, if it still
+  // shares it copy-on-write. The data is copied only if it is kept, that is
+  // if the type doesn't change.
+  void DetachCopyOnWrite(const TypeMeta& meta) {
+    copy_on_write_ = false;
+    if (!data_ || data_.use_count() <= 1) {
+      return;
+    }
+    auto shared_data = std::move(data_);
+    capacity_ = 0;
+    shares_data_ = false;
+    if (meta_ != meta || size_ == 0) {
+      return;
+    }
+    void* data = raw_mutable_data(meta);
+    Context context;
+    context.template CopyItems<Context, Context>(
+        meta_, size_, shared_data.get(), data);
+    context.FinishDeviceComputation();
+    RecordCopyOnWrite(nbytes());
+  }
+
   template <
       typename T,
       typename = typename std::enable_if<std::is_integral<T>::value>::type>
   bool SetDims(const vector<T>& src) {
+    return SetDimsFrom(src);
+  }
+
+  template <
+      typename T,
+      size_t N,
+      typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  bool SetDims(const SmallVector<T, N>& src) {
+    return SetDimsFrom(src);
+  }
+
+  template <typename Dims>
+  bool SetDimsFrom(const Dims& src) {
     auto old_size = size_;
     dims_.resize(src.size());
     TIndex new_size = 1;
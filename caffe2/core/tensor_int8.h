@@ -0,0 +1,37 @@
+#ifndef CAFFE2_CORE_TENSOR_INT8_H_
+#define CAFFE2_CORE_TENSOR_INT8_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+/**
+ * @brief A tensor of 8-bit quantized values and their quantization
+ * parameters, for the Int8 operators.
+ *
+ * The real value of element i is scale(c) * (t[i] - zero_point), where c is
+ * the index of the element along the first dimension. Activations are
+ * uint8 with a single scale and any zero point. Weights are int8 with a zero
+ * point of 0, and one scale for the whole tensor or per output channel.
+ *
+ * Unlike QTensor, which interleaves the bits of the values for the popcount
+ * kernels of low precision, the values are plain bytes that the int8
+ * kernels read directly.
+ */
+struct Int8TensorCPU {
+  float scale(const TIndex channel) const {
+    return scales.size() == 1 ? scales[0] : scales[channel];
+  }
+
+  TensorCPU t;
+  std::vector<float> scales{1.0f};
+  int32_t zero_point{0};
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_CORE_TENSOR_INT8_H_
@@ -78,15 +78,13 @@ vector<string> Workspace::LocalBlobs() const {
   for (auto& entry : blob_map_) {
     names.push_back(entry.first);
   }
+  // Sorted, as they were when blob_map_ was ordered
+  std::sort(names.begin(), names.end());
   return names;
 }
 
 vector<string> Workspace::Blobs() const {
-  vector<string> names;
-  names.reserve(blob_map_.size());
-  for (auto& entry : blob_map_) {
-    names.push_back(entry.first);
-  }
+  vector<string> names = LocalBlobs();
   for (const auto& forwarded : forwarded_blobs_) {
     const auto parent_ws = forwarded.second.first;
     const auto& parent_name = forwarded.second.second;
@@ -116,13 +114,14 @@ Blob* Workspace::CreateBlob(const string& name) {
 }
 
 Blob* Workspace::CreateLocalBlob(const string& name) {
-  if (blob_map_.count(name)) {
+  auto& blob = blob_map_[name];
+  if (blob) {
     VLOG(1) << "Blob " << name << " already exists. Skipping.";
   } else {
     VLOG(1) << "Creating blob " << name;
-    blob_map_[name] = unique_ptr<Blob>(new Blob());
+    blob.reset(new Blob());
   }
-  return GetBlob(name);
+  return blob.get();
 }
 
 Blob* Workspace::RenameBlob(const string& old_name, const string& new_name) {
@@ -162,11 +161,14 @@ bool Workspace::RemoveBlob(const string& name) {
 }
 
 const Blob* Workspace::GetBlob(const string& name) const {
-  if (blob_map_.count(name)) {
-    return blob_map_.at(name).get();
-  } else if (forwarded_blobs_.count(name)) {
-    const auto parent_ws = forwarded_blobs_.at(name).first;
-    const auto& parent_name = forwarded_blobs_.at(name).second;
+  auto it = blob_map_.find(name);
+  if (it != blob_map_.end()) {
+    return it->second.get();
+  }
+  auto forwarded = forwarded_blobs_.find(name);
+  if (forwarded != forwarded_blobs_.end()) {
+    const auto parent_ws = forwarded->second.first;
+    const auto& parent_name = forwarded->second.second;
     return parent_ws->GetBlob(parent_name);
   } else if (shared_ && shared_->HasBlob(name)) {
     return shared_->GetBlob(name);
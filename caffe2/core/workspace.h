@@ -8,6 +8,7 @@
 #include <cstddef>
 #include <mutex>
 #include <typeinfo>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -47,7 +48,10 @@ struct StopOnSignal {
 class Workspace {
  public:
   typedef std::function<bool(int)> ShouldContinue;
-  typedef CaffeMap<string, unique_ptr<Blob> > BlobMap;
+  // Hashed, as blobs are looked up by name on every net instantiation and
+  // input feed. The blobs are owned through pointers, so a Blob* stays valid
+  // until the blob is removed, and callers may keep it as a handle.
+  typedef std::unordered_map<string, unique_ptr<Blob>> BlobMap;
   typedef CaffeMap<string, unique_ptr<NetBase> > NetMap;
   /**
    * Initializes an empty workspace.
@@ -124,6 +128,10 @@ class Workspace {
   /**
    * Converts prevously mapped tensor blobs to local blobs, copies values from
    * parent workspace blobs into new local blobs. Ignores undefined blobs.
+   *
+   * The local tensors share the storage of the parent ones copy-on-write, so
+   * the values are only copied when either side writes them, see
+   * Tensor::ShareDataCopyOnWrite().
    */
   template <class Context>
   void CopyForwardedTensors(const std::unordered_set<std::string>& blobs) {
@@ -131,20 +139,47 @@ class Workspace {
       if (!forwarded_blobs_.count(blob)) {
         continue;
       }
-      const auto& ws_blob = forwarded_blobs_[blob];
-      const auto* parent_ws = ws_blob.first;
-      auto* from_blob = parent_ws->GetBlob(ws_blob.second);
+      const auto parent_name = forwarded_blobs_[blob].second;
+      // The parent blob, writable as through any forwarded name
+      auto* from_blob = GetBlob(blob);
       CAFFE_ENFORCE(from_blob);
       CAFFE_ENFORCE(
           from_blob->template IsType<Tensor<Context>>(),
           "Expected blob with tensor value",
-          ws_blob.second);
+          parent_name);
       forwarded_blobs_.erase(blob);
       auto* to_blob = CreateBlob(blob);
       CAFFE_ENFORCE(to_blob);
-      const auto& from_tensor = from_blob->template Get<Tensor<Context>>();
       auto* to_tensor = to_blob->template GetMutable<Tensor<Context>>();
-      to_tensor->CopyFrom(from_tensor);
+      to_tensor->ShareDataCopyOnWrite(
+          from_blob->template GetMutable<Tensor<Context>>());
+    }
+  }
+
+  /**
+   * Creates local tensor blobs sharing the storage of tensor blobs of another
+   * workspace copy-on-write (local blob name -> blob name in source). They
+   * read the source storage until either side writes them, so e.g. the
+   * workspaces of model variants that only differ in a few layers share one
+   * copy of the other weights. The source tensors are marked copy-on-write
+   * too, so the source workspace must not run nets during the call.
+   */
+  template <class Context>
+  void ShareTensorsCopyOnWrite(
+      Workspace* source,
+      const std::unordered_map<string, string>& blobs) {
+    CAFFE_ENFORCE(source, "Source workspace must be specified");
+    for (const auto& blob : blobs) {
+      auto* from_blob = source->GetBlob(blob.second);
+      CAFFE_ENFORCE(from_blob, "Blob not found in source workspace: ", blob.second);
+      CAFFE_ENFORCE(
+          from_blob->template IsType<Tensor<Context>>(),
+          "Expected blob with tensor value",
+          blob.second);
+      auto* to_tensor =
+          CreateLocalBlob(blob.first)->template GetMutable<Tensor<Context>>();
+      to_tensor->ShareDataCopyOnWrite(
+          from_blob->template GetMutable<Tensor<Context>>());
     }
   }
 
@@ -173,9 +208,11 @@ class Workspace {
     // Then, check the forwarding map, then the parent workspace
     if (blob_map_.count(name)) {
       return true;
-    } else if (forwarded_blobs_.count(name)) {
-      const auto parent_ws = forwarded_blobs_.at(name).first;
-      const auto& parent_name = forwarded_blobs_.at(name).second;
+    }
+    auto forwarded = forwarded_blobs_.find(name);
+    if (forwarded != forwarded_blobs_.end()) {
+      const auto parent_ws = forwarded->second.first;
+      const auto& parent_name = forwarded->second.second;
       return parent_ws->HasBlob(parent_name);
     } else if (shared_) {
       return shared_->HasBlob(name);
@@ -276,6 +313,28 @@ class Workspace {
    */
   ThreadPool* GetThreadPool();
 
+  /**
+   * Sets the allocator used for CPU memory allocated by the operators of
+   * this workspace and of its child workspaces (instead of the global
+   * GetCPUAllocator()); the allocator is notified at the end of every net
+   * run through CPUAllocator::OnRunFinished. Passing nullptr restores the
+   * global allocator.
+   */
+  void SetCPUAllocator(std::shared_ptr<CPUAllocator> allocator) {
+    cpu_allocator_ = std::move(allocator);
+  }
+
+  /**
+   * Returns the allocator set for this workspace or its closest parent,
+   * nullptr if the global allocator is used.
+   */
+  CPUAllocator* GetCPUAllocator() const {
+    if (cpu_allocator_) {
+      return cpu_allocator_.get();
+    }
+    return shared_ ? shared_->GetCPUAllocator() : nullptr;
+  }
+
   // RunOperatorOnce and RunNetOnce runs an operator or net once. The difference
   // between RunNet and RunNetOnce lies in the fact that RunNet allows you to
   // have a persistent net object, while RunNetOnce creates a net and discards
@@ -288,6 +347,8 @@ class Workspace {
   std::atomic<int> last_failed_op_net_position;
 
  private:
+  // Declared first so that it outlives the blobs allocated through it
+  std::shared_ptr<CPUAllocator> cpu_allocator_;
   BlobMap blob_map_;
   NetMap net_map_;
   const string root_folder_;
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
 #include <gtest/gtest.h>
 
 
@@ -115,4 +116,57 @@ TEST(WorkspaceTest, BlobMapping) {
   }
 }
 
+TEST(WorkspaceTest, BlobHandlesAreStable) {
+  Workspace ws;
+  Blob* handle = ws.CreateBlob("c");
+  for (int i = 0; i < 100; ++i) {
+    ws.CreateBlob("blob_" + caffe2::to_string(i));
+  }
+  ws.CreateBlob("a");
+  EXPECT_EQ(ws.GetBlob("c"), handle);
+  EXPECT_EQ(ws.RenameBlob("c", "b"), handle);
+  // Listed by name
+  auto names = ws.LocalBlobs();
+  EXPECT_TRUE(std::is_sorted(names.begin(), names.end()));
+  EXPECT_EQ(names[0], "a");
+  EXPECT_EQ(names[1], "b");
+}
+
+TEST(WorkspaceTest, ForwardedTensorsAreCopiedOnWrite) {
+  Workspace parent;
+  auto* a = parent.CreateBlob("a")->GetMutable<TensorCPU>();
+  a->Resize(3);
+  auto* data = a->mutable_data<float>();
+  data[0] = 1;
+  const auto copies = [] {
+    for (const auto& stat : StatRegistry::get().publish()) {
+      if (stat.key == "tensor_copy_on_write/copies") {
+        return stat.value;
+      }
+    }
+    return int64_t(0);
+  };
+  const auto copies_before = copies();
+  {
+    std::unordered_map<string, string> forwarded_blobs;
+    forwarded_blobs["inner_a"] = "a";
+    Workspace child(&parent, forwarded_blobs);
+    child.CopyForwardedTensors<CPUContext>({"inner_a"});
+    const auto& inner_a = child.GetBlob("inner_a")->Get<TensorCPU>();
+    EXPECT_NE(child.GetBlob("inner_a"), parent.GetBlob("a"));
+    EXPECT_EQ(inner_a.data<float>(), data);
+    EXPECT_EQ(copies(), copies_before);
+
+    child.GetBlob("inner_a")->GetMutable<TensorCPU>()->mutable_data<float>()[0] =
+        2;
+    EXPECT_NE(inner_a.data<float>(), data);
+    EXPECT_EQ(a->data<float>()[0], 1);
+    EXPECT_EQ(copies(), copies_before + 1);
+  }
+  // Model variant sharing the weights of the parent
+  Workspace variant;
+  variant.ShareTensorsCopyOnWrite<CPUContext>(&parent, {{"a", "a"}});
+  EXPECT_EQ(variant.GetBlob("a")->Get<TensorCPU>().data<float>(), data);
+}
+
 }  // namespace caffe2
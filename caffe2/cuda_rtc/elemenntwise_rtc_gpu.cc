@@ -1,3 +1,8 @@
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/operator.h"
@@ -46,6 +51,26 @@ string ElementwiseRTCFunction::GetSource(
      << "}\n}";
   return ss.str();
 }
+
+// Compiles the kernel of the given source for the current GPU, once. Nets
+// made by FuseElementwiseRTC repeat the same chains in every step or layer,
+// which would otherwise all be compiled again.
+std::shared_ptr<ElementwiseRTCFunction>
+GetElementwiseRTCFunction(int input_size, int output_size, const string& src) {
+  static std::mutex mutex;
+  static std::map<
+      std::tuple<int, int, int, string>,
+      std::shared_ptr<ElementwiseRTCFunction>>
+      cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& func = cache[std::make_tuple(
+      CaffeCudaGetDevice(), input_size, output_size, src)];
+  if (!func) {
+    func = std::make_shared<ElementwiseRTCFunction>();
+    func->Compile(input_size, output_size, src);
+  }
+  return func;
+}
 }  // namespace
 
 /**
@@ -68,6 +93,10 @@ string ElementwiseRTCFunction::GetSource(
  * inputs and one outputs, and write rtc_src as
  *     out0[index] = in0[index] * in1[index];
  *
+ * All the inputs must have the same size. Kernels are compiled once per GPU
+ * and source, and shared by the ops. FuseElementwiseRTC generates these ops
+ * for chains of pointwise ops.
+ *
  * This op is currently highly experimental. We do not have a gradient
  * registered for it either.
  */
@@ -78,7 +107,8 @@ class ElementwiseRTCOp final : public Operator<CUDAContext> {
     const string src = OperatorBase::GetSingleArgument<string>(
         "rtc_src", "");
     CAFFE_ENFORCE(src.size(), "Op should have a non-zero source code size.");
-    func_.Compile(InputSize(), OutputSize(), src);
+    DeviceGuard guard(context_.cuda_gpu_id());
+    func_ = GetElementwiseRTCFunction(InputSize(), OutputSize(), src);
   }
   ~ElementwiseRTCOp() {}
 
@@ -94,26 +124,27 @@ class ElementwiseRTCOp final : public Operator<CUDAContext> {
     argBuffer[0] = Input(0).size();
     void** ptr_buffer = reinterpret_cast<void**>(argBuffer + 1);
     for (int i = 0; i < InputSize(); ++i) {
+      CAFFE_ENFORCE_EQ(Input(i).size(), Input(0).size());
       ptr_buffer[i] = const_cast<float*>(Input(i).data<float>());
     }
     for (int i = 0; i < OutputSize(); ++i) {
       Output(i)->ResizeLike(Input(0));
       ptr_buffer[i + InputSize()] = Output(i)->mutable_data<float>();
     }
-    size_t argBufferSize = sizeof(argBuffer);
+    size_t argBufferSize = argBuffer_vec.size() * sizeof(size_t);
     void* config[] = {
       CU_LAUNCH_PARAM_BUFFER_POINTER, argBuffer,
       CU_LAUNCH_PARAM_BUFFER_SIZE, &argBufferSize,
       CU_LAUNCH_PARAM_END
     };
-    func_.LaunchEx(CAFFE_GET_BLOCKS(Input(0).size()), 1, 1,
+    func_->LaunchEx(CAFFE_GET_BLOCKS(Input(0).size()), 1, 1,
                    CAFFE_CUDA_NUM_THREADS, 1, 1,
                    0, context_.cuda_stream(), config);
     return true;
   }
 
  private:
-  ElementwiseRTCFunction func_;
+  std::shared_ptr<ElementwiseRTCFunction> func_;
 };
 
 namespace {
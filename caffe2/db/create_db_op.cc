@@ -3,7 +3,18 @@
 namespace caffe2 {
 REGISTER_CPU_OPERATOR(CreateDB, CreateDBOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateDB).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateDB)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("db_type", "Type of the db, e.g. leveldb, lmdb or minidb")
+    .Arg("db", "Path of the db")
+    .Arg("num_shards", "(int, default 1) Number of readers sharing the db")
+    .Arg("shard_id", "(int, default 0) Shard read by this reader")
+    .Arg(
+        "prefetch",
+        "(int, default 0) If positive, the number of records read ahead "
+        "from the db on a background thread")
+    .Output(0, "reader", "A DBReader over the db");
 
 NO_GRADIENT(CreateDB);
 }  // namespace caffe2
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <cstdio>
 #include <iomanip>
+#include <set>
 #include <sstream>
 #include <thread>
 
@@ -78,6 +80,32 @@ TEST(DBSeekTest, RocksDB) {
   DBSeekTestWrapper("rocksdb");
 }
 
+TEST(DBSeekTest, RocksDBBulkLoad) {
+  std::string name = std::tmpnam(nullptr);
+  {
+    std::unique_ptr<DB> db(
+        CreateDB("rocksdb", name + ";bulk_load=1;bloom_bits=10", NEW));
+    ASSERT_TRUE(db.get());
+    std::unique_ptr<Transaction> trans(db->NewTransaction());
+    // Unsorted, and over several table files
+    for (int i = kMaxItems - 1; i >= 0; --i) {
+      std::stringstream ss;
+      ss << std::setw(2) << std::setfill('0') << i;
+      trans->Put(ss.str(), i == 5 ? "overwritten" : ss.str());
+      if (i == 5) {
+        trans->Put(ss.str(), ss.str());
+        trans->Commit();
+      }
+    }
+  }
+  std::unique_ptr<DB> db(CreateDB(
+      "rocksdb", name + ";block_cache_mb=16;readahead_kb=256", READ));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  TestCursor(cursor.get());
+  EXPECT_THROW(
+      CreateDB("rocksdb", name + ";compression=foo", READ), EnforceNotMet);
+}
+
 TEST(DBSeekTest, LevelDB) {
   DBSeekTestWrapper("leveldb");
 }
@@ -86,6 +114,213 @@ TEST(DBSeekTest, LMDB) {
   DBSeekTestWrapper("lmdb");
 }
 
+TEST(DBSeekTest, PrefetchingLevelDB) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("leveldb", name);
+  std::unique_ptr<DB> db(CreateDB("leveldb", name, READ, 3));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  EXPECT_TRUE(cursor->SupportsSeek());
+  TestCursor(cursor.get());
+}
+
+TEST(TransactionTest, PutStream) {
+  std::string name = std::tmpnam(nullptr);
+  {
+    std::unique_ptr<DB> db(CreateDB("minidb", name, NEW));
+    std::unique_ptr<Transaction> trans(db->NewTransaction());
+    for (int size : {5, 2, 9}) {
+      trans->PutStream(
+          caffe2::to_string(size), size, [size](char* buffer) {
+            std::fill(buffer, buffer + size, 'a' + size);
+          });
+    }
+    trans->Commit();
+  }
+  std::unique_ptr<DB> db(CreateDB("minidb", name, READ));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  for (int size : {5, 2, 9}) {
+    ASSERT_TRUE(cursor->Valid());
+    EXPECT_EQ(cursor->key(), caffe2::to_string(size));
+    EXPECT_EQ(cursor->value(), string(size, 'a' + size));
+    cursor->Next();
+  }
+  EXPECT_FALSE(cursor->Valid());
+}
+
+TEST(PrefetchingCursorTest, MiniDB) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  // The buffer is smaller than the db, so the read-ahead has to wait for
+  // the reader and restart after seeking.
+  std::unique_ptr<DB> db(CreateDB("minidb", name, READ, 3));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  EXPECT_FALSE(cursor->SupportsSeek());
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < kMaxItems; ++i) {
+      std::stringstream ss;
+      ss << std::setw(2) << std::setfill('0') << i;
+      ASSERT_TRUE(cursor->Valid());
+      EXPECT_EQ(cursor->key(), ss.str());
+      EXPECT_EQ(cursor->value(), ss.str());
+      cursor->Next();
+    }
+    EXPECT_FALSE(cursor->Valid());
+    EXPECT_THROW(cursor->key(), EnforceNotMet);
+    cursor->SeekToFirst();
+  }
+  // Destroying a cursor whose read-ahead is blocked on a full buffer
+  cursor.reset();
+
+  std::unique_ptr<DBReader> reader(new DBReader("minidb", name, 3, 1, 2));
+  string key;
+  string value;
+  for (const auto* expected : {"01", "04", "07", "01"}) {
+    reader->Read(&key, &value);
+    EXPECT_EQ(key, expected);
+    EXPECT_EQ(value, expected);
+  }
+}
+
+TEST(CursorTest, NextBatch) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  for (int prefetch : {0, 4}) {
+    std::unique_ptr<DB> db(CreateDB("minidb", name, READ, prefetch));
+    std::unique_ptr<Cursor> cursor(db->NewCursor());
+    vector<string> keys(4);
+    vector<string> values(4);
+    EXPECT_EQ(cursor->NextBatch(4, keys.data(), values.data()), 4);
+    EXPECT_EQ(keys, vector<string>({"00", "01", "02", "03"}));
+    EXPECT_EQ(values, keys);
+    EXPECT_EQ(cursor->key(), "04");
+    EXPECT_EQ(cursor->NextBatch(4, nullptr, values.data()), 4);
+    EXPECT_EQ(values, vector<string>({"04", "05", "06", "07"}));
+    // Only two records are left
+    EXPECT_EQ(cursor->NextBatch(4, keys.data(), values.data()), 2);
+    EXPECT_EQ(keys[0], "08");
+    EXPECT_EQ(values[1], "09");
+    EXPECT_FALSE(cursor->Valid());
+    EXPECT_EQ(cursor->NextBatch(4, keys.data(), values.data()), 0);
+  }
+}
+
+TEST(DBReaderTest, ReadBatch) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  vector<string> keys;
+  vector<string> values;
+  DBReader reader("minidb", name);
+  reader.ReadBatch(4, &keys, &values);
+  EXPECT_EQ(keys, vector<string>({"00", "01", "02", "03"}));
+  EXPECT_EQ(values, keys);
+  // Wraps around at the end of the db
+  reader.ReadBatch(8, nullptr, &values);
+  EXPECT_EQ(
+      values,
+      vector<string>({"04", "05", "06", "07", "08", "09", "00", "01"}));
+
+  DBReader sharded_reader("minidb", name, 3, 2);
+  sharded_reader.ReadBatch(4, &keys, &values);
+  EXPECT_EQ(keys, vector<string>({"02", "05", "08", "02"}));
+  EXPECT_EQ(values, keys);
+}
+
+TEST(DBReaderTest, ReadViews) {
+  std::string name = std::tmpnam(nullptr);
+  CreateAndFill("minidb", name);
+  DBReader reader("minidb", name, 3, 1);
+  EXPECT_FALSE(reader.SupportsValueView());
+  vector<ValueView> views;
+  reader.ReadViews(4, &views);
+  ASSERT_EQ(4, views.size());
+  vector<string> values;
+  for (const auto& view : views) {
+    values.push_back(view.ToString());
+  }
+  EXPECT_EQ(values, vector<string>({"01", "04", "07", "01"}));
+  // The views own their data once the reader is gone
+  reader.Open("minidb", name);
+  EXPECT_EQ("04", views[1].ToString());
+}
+
+// Creates minidb shards name_0, name_1, ... where shard s holds the keys
+// "s_0", "s_1", ... up to sizes[s] records.
+static void CreateShards(const string& name, const vector<int>& sizes) {
+  for (int s = 0; s < sizes.size(); ++s) {
+    std::unique_ptr<DB> db(
+        CreateDB("minidb", name + "_" + caffe2::to_string(s), NEW));
+    std::unique_ptr<Transaction> trans(db->NewTransaction());
+    for (int i = 0; i < sizes[s]; ++i) {
+      const auto key = caffe2::to_string(s) + "_" + caffe2::to_string(i);
+      trans->Put(key, key);
+    }
+    trans->Commit();
+  }
+}
+
+static vector<string> ReadAll(Cursor* cursor) {
+  vector<string> keys;
+  for (; cursor->Valid(); cursor->Next()) {
+    EXPECT_EQ(cursor->key(), cursor->value());
+    keys.push_back(cursor->key());
+  }
+  return keys;
+}
+
+TEST(ShardedDBTest, DeterministicInterleaving) {
+  std::string name = std::tmpnam(nullptr);
+  CreateShards(name, {3, 1, 2});
+  std::unique_ptr<DB> db(CreateDB(
+      "sharded", "minidb:" + name + "_*;threads=2;buffer=1;deterministic=1",
+      READ));
+  ASSERT_TRUE(db);
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  const vector<string> expected = {"0_0", "1_0", "2_0", "0_1", "2_1", "0_2"};
+  EXPECT_EQ(ReadAll(cursor.get()), expected);
+  cursor->SeekToFirst();
+  EXPECT_EQ(ReadAll(cursor.get()), expected);
+}
+
+TEST(ShardedDBTest, ParallelRead) {
+  std::string name = std::tmpnam(nullptr);
+  CreateShards(name, {20, 5, 0, 13});
+  std::unique_ptr<DB> db(CreateDB(
+      "sharded", "minidb:" + name + "_*;threads=3;buffer=2", READ));
+  std::unique_ptr<Cursor> cursor(db->NewCursor());
+  auto keys = ReadAll(cursor.get());
+  EXPECT_EQ(keys.size(), 38);
+  EXPECT_EQ(std::set<string>(keys.begin(), keys.end()).size(), 38);
+  // Records of a shard keep their order
+  int last_in_shard = -1;
+  for (const auto& key : keys) {
+    if (key[0] == '0') {
+      const int index = std::stoi(key.substr(2));
+      EXPECT_EQ(index, last_in_shard + 1);
+      last_in_shard = index;
+    }
+  }
+}
+
+TEST(ShardedDBTest, RankSubsets) {
+  std::string name = std::tmpnam(nullptr);
+  CreateShards(name, {1, 1, 1, 1, 1});
+  // Shards can also be listed explicitly
+  const string shards = "minidb:" + name + "_0," + name + "_1," + name +
+      "_2," + name + "_3," + name + "_4;deterministic=1;num_ranks=2";
+  std::unique_ptr<DB> db0(CreateDB("sharded", shards + ";rank=0", READ));
+  std::unique_ptr<Cursor> cursor0(db0->NewCursor());
+  EXPECT_EQ(ReadAll(cursor0.get()), vector<string>({"0_0", "2_0", "4_0"}));
+  std::unique_ptr<DB> db1(CreateDB("sharded", shards + ";rank=1", READ));
+  std::unique_ptr<Cursor> cursor1(db1->NewCursor());
+  EXPECT_EQ(ReadAll(cursor1.get()), vector<string>({"1_0", "3_0"}));
+
+  EXPECT_THROW(CreateDB("sharded", shards + ";rank=2", READ), EnforceNotMet);
+  EXPECT_THROW(
+      CreateDB("sharded", "minidb:" + name + "_0;num_ranks=2;rank=1", READ),
+      EnforceNotMet);
+  EXPECT_THROW(CreateDB("sharded", shards, NEW), EnforceNotMet);
+}
+
 TEST(DBReaderTest, Reader) {
   std::string name = std::tmpnam(nullptr);
   CreateAndFill("leveldb", name);
@@ -24,6 +24,17 @@ class LevelDBCursor : public Cursor {
   string key() override { return iter_->key().ToString(); }
   string value() override { return iter_->value().ToString(); }
   bool Valid() override { return iter_->Valid(); }
+  int NextBatch(int n, string* keys, string* values) override {
+    int count = 0;
+    for (; count < n && iter_->Valid(); ++count) {
+      if (keys) {
+        keys[count].assign(iter_->key().data(), iter_->key().size());
+      }
+      values[count].assign(iter_->value().data(), iter_->value().size());
+      iter_->Next();
+    }
+    return count;
+  }
 
  private:
   std::unique_ptr<leveldb::Iterator> iter_;
@@ -39,6 +50,17 @@ class LevelDBTransaction : public Transaction {
   void Put(const string& key, const string& value) override {
     batch_->Put(key, value);
   }
+  void PutStream(
+      const string& key,
+      size_t size,
+      const BlobSerializerBase::ValueWriter& writer) override {
+    // The batch copies the value, the buffer is reused for the next one
+    if (buffer_.size() < size) {
+      buffer_.resize(size);
+    }
+    writer(buffer_.data());
+    batch_->Put(key, leveldb::Slice(buffer_.data(), size));
+  }
   void Commit() override {
     leveldb::Status status = db_->Write(leveldb::WriteOptions(), batch_.get());
     batch_.reset(new leveldb::WriteBatch());
@@ -50,6 +72,7 @@ class LevelDBTransaction : public Transaction {
  private:
   leveldb::DB* db_;
   std::unique_ptr<leveldb::WriteBatch> batch_;
+  std::vector<char> buffer_;
 
   DISABLE_COPY_AND_ASSIGN(LevelDBTransaction);
 };
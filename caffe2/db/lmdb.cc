@@ -70,6 +70,21 @@ class LMDBCursor : public Cursor {
 
   bool Valid() override { return valid_; }
 
+  // Copies straight out of the memory map into the callers' strings
+  int NextBatch(int n, string* keys, string* values) override {
+    int count = 0;
+    for (; count < n && valid_; ++count) {
+      if (keys) {
+        keys[count].assign(
+            static_cast<const char*>(mdb_key_.mv_data), mdb_key_.mv_size);
+      }
+      values[count].assign(
+          static_cast<const char*>(mdb_value_.mv_data), mdb_value_.mv_size);
+      SeekLMDB(MDB_NEXT);
+    }
+    return count;
+  }
+
  private:
   void SeekLMDB(MDB_cursor_op op) {
     int mdb_status = mdb_cursor_get(mdb_cursor_, &mdb_key_, &mdb_value_, op);
@@ -101,6 +116,10 @@ class LMDBTransaction final : public Transaction {
     mdb_dbi_close(mdb_env_, mdb_dbi_);
   }
   void Put(const string& key, const string& value) override;
+  void PutStream(
+      const string& key,
+      size_t size,
+      const BlobSerializerBase::ValueWriter& writer) override;
   void Commit() override {
     MDB_CHECK(mdb_txn_commit(mdb_txn_));
     mdb_dbi_close(mdb_env_, mdb_dbi_);
@@ -166,6 +185,19 @@ void LMDBTransaction::Put(const string& key, const string& value) {
   MDB_CHECK(mdb_put(mdb_txn_, mdb_dbi_, &mdb_key, &mdb_value, 0));
 }
 
+void LMDBTransaction::PutStream(
+    const string& key,
+    size_t size,
+    const BlobSerializerBase::ValueWriter& writer) {
+  MDB_val mdb_key, mdb_value;
+  mdb_key.mv_data = const_cast<char*>(key.data());
+  mdb_key.mv_size = key.size();
+  mdb_value.mv_size = size;
+  // Reserves the space in the map, the value is written there directly
+  MDB_CHECK(mdb_put(mdb_txn_, mdb_dbi_, &mdb_key, &mdb_value, MDB_RESERVE));
+  writer(static_cast<char*>(mdb_value.mv_data));
+}
+
 REGISTER_CAFFE2_DB(LMDB, LMDB);
 REGISTER_CAFFE2_DB(lmdb, LMDB);
 
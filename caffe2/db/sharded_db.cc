@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <glob.h>
+#endif
+
+#include "caffe2/core/db.h"
+#include "caffe2/core/flags.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/string_utils.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_sharded_db_threads,
+    4,
+    "Default number of threads reading the shards of a sharded db.");
+CAFFE2_DEFINE_int(
+    caffe2_sharded_db_buffer,
+    16,
+    "Default number of records buffered per shard of a sharded db.");
+
+namespace caffe2 {
+namespace db {
+
+// A read-only db over a set of shards of another db type, e.g. the
+// outputs of binaries/split_db.cc. The source has the form
+//
+//   <db_type>:<path>[,<path>...][;<option>=<value>...]
+//
+// where a path can be a glob pattern, e.g.
+//
+//   leveldb:/data/train_split_*;threads=8;rank=1;num_ranks=4
+//
+// The matched shards are sorted by path. Options:
+//   threads:       number of threads reading the shards concurrently
+//                  (defaults to --caffe2_sharded_db_threads)
+//   buffer:        number of records read ahead per shard (defaults to
+//                  --caffe2_sharded_db_buffer)
+//   deterministic: if 1, records are interleaved round robin over the
+//                  shards, one record per shard in turn, independently of
+//                  the read speed of the shards. Otherwise records are
+//                  returned in the order they become available.
+//   rank, num_ranks: read only the shards whose index modulo num_ranks is
+//                  rank, so that distributed trainers read disjoint data.
+
+namespace {
+
+struct ShardedDBOptions {
+  string db_type;
+  vector<string> paths;
+  int threads = FLAGS_caffe2_sharded_db_threads;
+  int buffer = FLAGS_caffe2_sharded_db_buffer;
+  bool deterministic = false;
+  int rank = 0;
+  int num_ranks = 1;
+};
+
+vector<string> expandPattern(const string& pattern) {
+#ifndef _WIN32
+  glob_t result;
+  // Patterns without a match are kept as they are, some db types take
+  // sources that are not paths
+  const int status = glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &result);
+  CAFFE_ENFORCE_EQ(status, 0, "Cannot expand shard pattern: ", pattern);
+  vector<string> paths(result.gl_pathv, result.gl_pathv + result.gl_pathc);
+  globfree(&result);
+  return paths;
+#else
+  return {pattern};
+#endif
+}
+
+ShardedDBOptions parseSource(const string& source) {
+  ShardedDBOptions options;
+  auto parts = split(';', source);
+  CAFFE_ENFORCE(!parts.empty(), "Empty sharded db source");
+  const auto colon = parts[0].find(':');
+  CAFFE_ENFORCE(
+      colon != string::npos && colon > 0,
+      "A sharded db source has to start with <db_type>: ",
+      source);
+  options.db_type = parts[0].substr(0, colon);
+  CAFFE_ENFORCE(
+      options.db_type != "sharded", "Sharded dbs cannot be nested: ", source);
+  for (const auto& pattern : split(',', parts[0].substr(colon + 1))) {
+    if (!pattern.empty()) {
+      auto paths = expandPattern(pattern);
+      options.paths.insert(options.paths.end(), paths.begin(), paths.end());
+    }
+  }
+  std::sort(options.paths.begin(), options.paths.end());
+  options.paths.erase(
+      std::unique(options.paths.begin(), options.paths.end()),
+      options.paths.end());
+
+  for (int i = 1; i < parts.size(); ++i) {
+    if (parts[i].empty()) {
+      continue;
+    }
+    const auto eq = parts[i].find('=');
+    CAFFE_ENFORCE(
+        eq != string::npos, "Sharded db options are key=value: ", parts[i]);
+    const auto key = parts[i].substr(0, eq);
+    const int value = std::stoi(parts[i].substr(eq + 1));
+    if (key == "threads") {
+      options.threads = value;
+    } else if (key == "buffer") {
+      options.buffer = value;
+    } else if (key == "deterministic") {
+      options.deterministic = value != 0;
+    } else if (key == "rank") {
+      options.rank = value;
+    } else if (key == "num_ranks") {
+      options.num_ranks = value;
+    } else {
+      CAFFE_THROW("Unknown sharded db option: ", key);
+    }
+  }
+  CAFFE_ENFORCE_GT(options.threads, 0);
+  CAFFE_ENFORCE_GT(options.buffer, 0);
+  CAFFE_ENFORCE_GT(options.num_ranks, 0);
+  CAFFE_ENFORCE(
+      options.rank >= 0 && options.rank < options.num_ranks,
+      "Invalid rank ",
+      options.rank,
+      " of ",
+      options.num_ranks);
+
+  vector<string> rank_paths;
+  for (int i = options.rank; i < options.paths.size(); i += options.num_ranks) {
+    rank_paths.push_back(options.paths[i]);
+  }
+  CAFFE_ENFORCE(
+      !rank_paths.empty(),
+      "No shards for rank ",
+      options.rank,
+      " out of ",
+      options.paths.size(),
+      " shards in ",
+      source);
+  options.paths = std::move(rank_paths);
+  options.threads = std::min<int>(options.threads, options.paths.size());
+  return options;
+}
+
+} // namespace
+
+class ShardedDBCursor : public Cursor {
+ public:
+  ShardedDBCursor(
+      vector<unique_ptr<Cursor>> cursors,
+      const ShardedDBOptions& options)
+      : cursors_(std::move(cursors)),
+        shards_(cursors_.size()),
+        num_threads_(options.threads),
+        buffer_(options.buffer),
+        deterministic_(options.deterministic) {
+    Start();
+  }
+  ~ShardedDBCursor() {
+    Stop();
+  }
+
+  void Seek(const string& /*key*/) override {
+    CAFFE_THROW("Sharded db does not support seeking to a specific key.");
+  }
+
+  void SeekToFirst() override {
+    Stop();
+    for (auto& cursor : cursors_) {
+      cursor->SeekToFirst();
+    }
+    Start();
+  }
+
+  void Next() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    valid_ = Pop(lock);
+  }
+
+  string key() override {
+    CAFFE_ENFORCE(valid_, "Cursor is at invalid location!");
+    return current_.first;
+  }
+
+  string value() override {
+    CAFFE_ENFORCE(valid_, "Cursor is at invalid location!");
+    return current_.second;
+  }
+
+  bool Valid() override {
+    return valid_;
+  }
+
+ private:
+  struct Shard {
+    std::deque<std::pair<string, string>> records;
+    bool done = false;
+  };
+
+  void Start() {
+    for (auto& shard : shards_) {
+      shard.records.clear();
+      shard.done = false;
+    }
+    live_shards_.clear();
+    for (int i = 0; i < shards_.size(); ++i) {
+      live_shards_.push_back(i);
+    }
+    next_ = 0;
+    stop_ = false;
+    error_ = nullptr;
+    for (int i = 0; i < num_threads_; ++i) {
+      threads_.emplace_back(&ShardedDBCursor::ReadLoop, this, i);
+    }
+    try {
+      std::unique_lock<std::mutex> lock(mutex_);
+      valid_ = Pop(lock);
+    } catch (...) {
+      Stop();
+      throw;
+    }
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    not_full_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  // Thread thread_id reads the shards thread_id, thread_id + num_threads_,
+  // ... one record at a time from each shard that has room in its buffer,
+  // so that the consumer never waits on a shard whose reader is blocked on
+  // another one.
+  void ReadLoop(int thread_id) {
+    vector<int> owned;
+    for (int i = thread_id; i < cursors_.size(); i += num_threads_) {
+      owned.push_back(i);
+    }
+    try {
+      while (!owned.empty()) {
+        vector<int> ready;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          not_full_.wait(lock, [&] {
+            if (stop_) {
+              return true;
+            }
+            for (int i : owned) {
+              if (shards_[i].records.size() < buffer_) {
+                return true;
+              }
+            }
+            return false;
+          });
+          if (stop_) {
+            return;
+          }
+          for (int i : owned) {
+            if (shards_[i].records.size() < buffer_) {
+              ready.push_back(i);
+            }
+          }
+        }
+        for (int i : ready) {
+          // Only this thread uses the cursor of the shard
+          auto* cursor = cursors_[i].get();
+          const bool valid = cursor->Valid();
+          std::pair<string, string> record;
+          if (valid) {
+            record.first = cursor->key();
+            record.second = cursor->value();
+            cursor->Next();
+          }
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (valid) {
+              shards_[i].records.push_back(std::move(record));
+            } else {
+              shards_[i].done = true;
+              owned.erase(std::find(owned.begin(), owned.end(), i));
+            }
+          }
+          not_empty_.notify_all();
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+      for (int i : owned) {
+        shards_[i].done = true;
+      }
+      not_empty_.notify_all();
+    }
+  }
+
+  // Moves the next record into current_, returns false at the end of all
+  // shards.
+  bool Pop(std::unique_lock<std::mutex>& lock) {
+    while (!live_shards_.empty()) {
+      int found = -1;
+      not_empty_.wait(lock, [&] {
+        if (error_) {
+          return true;
+        }
+        // With deterministic ordering only the next shard in turn counts
+        const int candidates = deterministic_ ? 1 : live_shards_.size();
+        for (int c = 0; c < candidates; ++c) {
+          const int pos = (next_ + c) % live_shards_.size();
+          const auto& shard = shards_[live_shards_[pos]];
+          if (!shard.records.empty() || shard.done) {
+            found = pos;
+            return true;
+          }
+        }
+        return false;
+      });
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      auto& shard = shards_[live_shards_[found]];
+      if (shard.records.empty()) {
+        // The shard is exhausted, the following shards move up one place
+        live_shards_.erase(live_shards_.begin() + found);
+        if (!live_shards_.empty()) {
+          next_ = found % live_shards_.size();
+        }
+        continue;
+      }
+      current_ = std::move(shard.records.front());
+      shard.records.pop_front();
+      next_ = (found + 1) % live_shards_.size();
+      not_full_.notify_all();
+      return true;
+    }
+    return false;
+  }
+
+  vector<unique_ptr<Cursor>> cursors_;
+  vector<Shard> shards_;
+  const int num_threads_;
+  const size_t buffer_;
+  const bool deterministic_;
+
+  // Indices of the shards that are not exhausted yet and the position in
+  // it of the shard to take the next record from
+  vector<int> live_shards_;
+  int next_ = 0;
+  std::pair<string, string> current_;
+  bool valid_ = false;
+  bool stop_ = false;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  vector<std::thread> threads_;
+};
+
+class ShardedDB : public DB {
+ public:
+  ShardedDB(const string& source, Mode mode)
+      : DB(source, mode), options_(parseSource(source)) {
+    CAFFE_ENFORCE_EQ(mode, READ, "Sharded dbs can only be read: ", source);
+    for (const auto& path : options_.paths) {
+      auto db = CreateDB(options_.db_type, path, READ);
+      CAFFE_ENFORCE(
+          db, "Cannot open shard ", path, " of type ", options_.db_type);
+      shards_.push_back(std::move(db));
+    }
+    VLOG(1) << "Opened sharded db " << source << " with " << shards_.size()
+            << " shards";
+  }
+
+  void Close() override {
+    for (auto& shard : shards_) {
+      shard->Close();
+    }
+  }
+
+  unique_ptr<Cursor> NewCursor() override {
+    vector<unique_ptr<Cursor>> cursors;
+    for (auto& shard : shards_) {
+      cursors.push_back(shard->NewCursor());
+    }
+    return make_unique<ShardedDBCursor>(std::move(cursors), options_);
+  }
+
+  unique_ptr<Transaction> NewTransaction() override {
+    CAFFE_THROW("Sharded dbs can only be read.");
+  }
+
+ private:
+  ShardedDBOptions options_;
+  vector<unique_ptr<DB>> shards_;
+};
+
+REGISTER_CAFFE2_DB(ShardedDB, ShardedDB);
+REGISTER_CAFFE2_DB(sharded, ShardedDB);
+
+} // namespace db
+} // namespace caffe2
@@ -1,20 +1,74 @@
 #include <atomic>
 #include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <mutex>
 #include <thread>  // NOLINT
 
 #include "caffe2/core/db.h"
+#include "caffe2/utils/string_utils.h"
 #include "caffe2/utils/zmq_helper.h"
 #include "caffe2/core/logging.h"
 
 namespace caffe2 {
 namespace db {
 
+// The source of a ZmqDB is the address of a feeder (binaries/zmq_feeder.cc),
+// optionally followed by ";credits=<n>", e.g. "tcp://feeder:5555;credits=4".
+//
+// Without credits the feeder pushes one record per multipart message of a
+// key and a value frame (the feeder's default, --batch_size=0).
+//
+// With credits the batched protocol of a feeder started with --batch_size=b
+// is used: the cursor connects a DEALER socket to the feeder's ROUTER and
+// grants it n batches up front, and one more every time it has handed out
+// all the records of a batch. A batch is one multipart message made of a
+// header frame holding the number of records as a uint32, followed by a key
+// and a value frame per record. The feeder only sends batches it has
+// credits for, so a trainer never buffers more than n batches.
+//
+// In both protocols the received frames are not copied: value_view() hands
+// out views that keep the frames alive until the consumer releases them.
+
+namespace {
+
+// Receive timeout that lets the receiving thread notice that the cursor is
+// being destroyed
+const int kRecvTimeoutMs = 100;
+
+struct ZmqDBOptions {
+  string address;
+  int credits = 0;
+};
+
+ZmqDBOptions parseSource(const string& source) {
+  ZmqDBOptions options;
+  auto parts = split(';', source);
+  CAFFE_ENFORCE(!parts.empty() && !parts[0].empty(), "Empty zmq address");
+  options.address = parts[0];
+  for (int i = 1; i < parts.size(); ++i) {
+    const auto eq = parts[i].find('=');
+    CAFFE_ENFORCE(
+        eq != string::npos && parts[i].substr(0, eq) == "credits",
+        "Unknown ZmqDB option: ",
+        parts[i]);
+    options.credits = std::stoi(parts[i].substr(eq + 1));
+    CAFFE_ENFORCE_GE(options.credits, 0);
+  }
+  return options;
+}
+
+} // namespace
+
 class ZmqDBCursor : public Cursor {
  public:
-  explicit ZmqDBCursor(const string& source)
-      : source_(source), socket_(ZMQ_PULL),
-        prefetched_(false), finalize_(false) {
+  explicit ZmqDBCursor(const ZmqDBOptions& options)
+      : source_(options.address),
+        credits_(options.credits),
+        socket_(options.credits > 0 ? ZMQ_DEALER : ZMQ_PULL),
+        freed_batches_(options.credits),
+        finalize_(false) {
+    socket_.SetOption(ZMQ_RCVTIMEO, kRecvTimeoutMs);
     socket_.Connect(source_);
     // Start prefetching thread.
     prefetch_thread_.reset(
@@ -24,8 +78,10 @@ class ZmqDBCursor : public Cursor {
   }
 
   ~ZmqDBCursor() {
-    finalize_ = true;
-    prefetched_ = false;
+    {
+      std::lock_guard<std::mutex> lock(prefetch_access_mutex_);
+      finalize_ = true;
+    }
     producer_.notify_one();
     // Wait for the prefetch thread to finish elegantly.
     prefetch_thread_->join();
@@ -39,47 +95,140 @@ class ZmqDBCursor : public Cursor {
 
   void Next() override {
     std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-    while (!prefetched_) consumer_.wait(lock);
-    key_ = prefetch_key_;
-    value_ = prefetch_value_;
-    prefetched_ = false;
+    consumer_.wait(lock, [this] { return !records_.empty(); });
+    current_ = std::move(records_.front());
+    records_.pop_front();
+    if (current_.ends_batch) {
+      ++freed_batches_;
+    }
     producer_.notify_one();
   }
 
-  string key() override { return key_; }
-  string value() override { return value_; }
+  string key() override {
+    return string(
+        static_cast<char*>(current_.key->data()), current_.key->size());
+  }
+  string value() override {
+    return string(
+        static_cast<char*>(current_.value->data()), current_.value->size());
+  }
+  ValueView value_view() override {
+    return ValueView(
+        static_cast<char*>(current_.value->data()),
+        current_.value->size(),
+        current_.value);
+  }
+  bool SupportsValueView() override { return true; }
   bool Valid() override { return true; }
 
  private:
+  struct Record {
+    std::shared_ptr<ZmqMessage> key;
+    std::shared_ptr<ZmqMessage> value;
+    // Whether the record is the last one of its batch
+    bool ends_batch = false;
+  };
+
+  // Returns nullptr if no frame arrives within the receive timeout, or, with
+  // wait, if the cursor is destroyed before a frame arrives.
+  std::shared_ptr<ZmqMessage> Receive(bool wait) {
+    auto msg = std::make_shared<ZmqMessage>();
+    while (!socket_.TryRecv(msg.get())) {
+      if (!wait || finalize_) {
+        return nullptr;
+      }
+    }
+    return msg;
+  }
 
   void Prefetch() {
     while (!finalize_) {
-      std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-      while (prefetched_) producer_.wait(lock);
+      int grant = 0;
+      {
+        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+        if (credits_ == 0) {
+          // Without flow control a single record is prefetched
+          producer_.wait(
+              lock, [this] { return records_.empty() || finalize_; });
+        } else {
+          // Nothing can arrive without outstanding credits
+          producer_.wait(lock, [this] {
+            return freed_batches_ > 0 || outstanding_ > 0 || finalize_;
+          });
+          grant = freed_batches_;
+          freed_batches_ = 0;
+        }
+      }
       if (finalize_) {
         return;
       }
-      ZmqMessage msg;
-      socket_.RecvTillSuccess(&msg);
-      prefetch_key_.assign(static_cast<char*>(msg.data()), msg.size());
-      socket_.RecvTillSuccess(&msg);
-      prefetch_value_.assign(static_cast<char*>(msg.data()), msg.size());
-      prefetched_ = true;
+      if (grant > 0) {
+        const uint32_t count = grant;
+        socket_.SendTillSuccess(
+            string(reinterpret_cast<const char*>(&count), sizeof(count)), 0);
+        outstanding_ += grant;
+      }
+      std::deque<Record> batch;
+      if (!ReceiveBatch(&batch)) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(prefetch_access_mutex_);
+      for (auto& record : batch) {
+        records_.push_back(std::move(record));
+      }
       consumer_.notify_one();
     }
   }
 
+  // Returns false if nothing was received before the timeout.
+  bool ReceiveBatch(std::deque<Record>* batch) {
+    uint32_t count = 1;
+    if (credits_ > 0) {
+      auto header = Receive(false);
+      if (!header) {
+        return false;
+      }
+      --outstanding_;
+      CAFFE_ENFORCE(
+          header->size() == sizeof(count) && header->more(),
+          "Invalid zmq batch header from ",
+          source_);
+      memcpy(&count, header->data(), sizeof(count));
+      CAFFE_ENFORCE_GT(count, 0, "Empty zmq batch from ", source_);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      Record record;
+      // The frames of a multipart message arrive together, so only the
+      // first one of a message may time out
+      record.key = Receive(credits_ > 0);
+      if (!record.key) {
+        return false;
+      }
+      CAFFE_ENFORCE(record.key->more(), "Missing zmq value frame");
+      record.value = Receive(true);
+      if (!record.value) {
+        return false;
+      }
+      batch->push_back(std::move(record));
+    }
+    batch->back().ends_batch = true;
+    return true;
+  }
+
   string source_;
+  const int credits_;
   ZmqSocket socket_;
-  string key_;
-  string value_;
-  string prefetch_key_;
-  string prefetch_value_;
+  Record current_;
+  std::deque<Record> records_;
+  // Batches handed out to the consumer for which no credit was sent yet
+  int freed_batches_;
+  // Credits sent for batches that have not arrived yet, only used by the
+  // prefetch thread
+  int outstanding_ = 0;
 
   unique_ptr<std::thread> prefetch_thread_;
   std::mutex prefetch_access_mutex_;
   std::condition_variable producer_, consumer_;
-  std::atomic<bool> prefetched_;
   // finalize_ is used to tell the prefetcher to quit.
   std::atomic<bool> finalize_;
 };
@@ -87,7 +236,7 @@ class ZmqDBCursor : public Cursor {
 class ZmqDB : public DB {
  public:
   ZmqDB(const string& source, Mode mode)
-      : DB(source, mode), source_(source) {
+      : DB(source, mode), options_(parseSource(source)) {
     CAFFE_ENFORCE(mode == READ, "ZeroMQ DB only supports read mode.");
   }
 
@@ -96,7 +245,7 @@ class ZmqDB : public DB {
   void Close() override {}
 
   unique_ptr<Cursor> NewCursor() override {
-    return make_unique<ZmqDBCursor>(source_);
+    return make_unique<ZmqDBCursor>(options_);
   }
 
   unique_ptr<Transaction> NewTransaction() override {
@@ -105,7 +254,7 @@ class ZmqDB : public DB {
   }
 
  private:
-  string source_;
+  ZmqDBOptions options_;
 };
 
 REGISTER_CAFFE2_DB(ZmqDB, ZmqDB);
@@ -0,0 +1,414 @@
+#include "embedding_shard.h"
+
+#include <cstring>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+enum RequestType : uint32_t { LOOKUP = 0, PUSH = 1 };
+
+struct RequestHeader {
+  int64_t request;
+  uint32_t type;
+  // Number of values of a row of the pushed gradients
+  uint32_t dim;
+};
+
+struct ReplyHeader {
+  int64_t request;
+  uint32_t ok;
+  // Number of values of a looked up row
+  uint32_t dim;
+};
+
+template <typename T>
+std::string ToString(const T* data, size_t n) {
+  return std::string(reinterpret_cast<const char*>(data), n * sizeof(T));
+}
+
+void RecvFrame(ZmqSocket* socket, ZmqMessage* msg) {
+  while (!socket->TryRecv(msg)) {
+  }
+}
+
+void SendFrame(ZmqSocket* socket, std::string data, bool more) {
+  ZmqMessage msg(std::move(data));
+  socket->SendMessage(&msg, more ? ZMQ_SNDMORE : 0);
+}
+
+} // namespace
+
+std::string EmbeddingShardKey(const std::string& service, int shard) {
+  return service + "/embedding_shard_" + caffe2::to_string(shard);
+}
+
+EmbeddingShardServer::EmbeddingShardServer(
+    int shard,
+    int num_shards,
+    const std::vector<Table>& tables,
+    float init_scale,
+    float learning_rate,
+    float epsilon)
+    : shard_(shard), num_shards_(num_shards) {
+  CAFFE_ENFORCE_GT(num_shards_, 0);
+  CAFFE_ENFORCE(shard_ >= 0 && shard_ < num_shards_, "Invalid shard ", shard_);
+  CAFFE_ENFORCE(
+      ws_.RunOperatorOnce(CreateOperatorDef(
+          "ConstantFill",
+          "",
+          std::vector<string>{},
+          std::vector<string>{"lr"},
+          std::vector<Argument>{
+              MakeArgument<std::vector<int64_t>>("shape", {1}),
+              // SparseAdagrad adds lr times the gradient
+              MakeArgument<float>("value", -learning_rate)})));
+  for (const auto& table : tables) {
+    CAFFE_ENFORCE(!tables_.count(table.name), "Duplicate table ", table.name);
+    CAFFE_ENFORCE_GT(table.dim, 0);
+    auto& shard_table = tables_[table.name];
+    shard_table.rows = std::max<int64_t>(
+        (table.rows - shard_ + num_shards_ - 1) / num_shards_, 0);
+    shard_table.dim = table.dim;
+
+    const std::vector<int64_t> shape{shard_table.rows, table.dim};
+    const auto moment = table.name + "_moment";
+    const auto indices = table.name + "_indices";
+    const auto grad = table.name + "_grad";
+    CAFFE_ENFORCE(ws_.RunOperatorOnce(CreateOperatorDef(
+        "UniformFill",
+        "",
+        std::vector<string>{},
+        std::vector<string>{table.name},
+        std::vector<Argument>{MakeArgument("shape", shape),
+                              MakeArgument<float>("min", -init_scale),
+                              MakeArgument<float>("max", init_scale)})));
+    CAFFE_ENFORCE(ws_.RunOperatorOnce(CreateOperatorDef(
+        "ConstantFill",
+        "",
+        std::vector<string>{},
+        std::vector<string>{moment},
+        std::vector<Argument>{MakeArgument("shape", shape),
+                              MakeArgument<float>("value", 0.0f)})));
+    ws_.CreateBlob(indices)->GetMutable<TensorCPU>();
+    ws_.CreateBlob(grad)->GetMutable<TensorCPU>();
+
+    shard_table.gather = CreateOperator(
+        CreateOperatorDef(
+            "Gather",
+            "",
+            std::vector<string>{table.name, indices},
+            std::vector<string>{table.name + "_rows"}),
+        &ws_);
+    shard_table.adagrad = CreateOperator(
+        CreateOperatorDef(
+            "SparseAdagrad",
+            "",
+            std::vector<string>{table.name, moment, indices, grad, "lr"},
+            std::vector<string>{table.name, moment},
+            std::vector<Argument>{MakeArgument<float>("epsilon", epsilon)}),
+        &ws_);
+  }
+}
+
+void EmbeddingShardServer::Serve(
+    const std::string& address,
+    const std::string& endpoint,
+    StoreHandler* store,
+    const std::string& service) {
+  ZmqSocket socket(ZMQ_ROUTER);
+  socket.Bind(address);
+  store->set(EmbeddingShardKey(service, shard_), endpoint);
+  LOG(INFO) << "Shard " << shard_ << " of " << service << " serving at "
+            << endpoint;
+
+  while (true) {
+    ZmqMessage identity, header, table, indices, grad;
+    RecvFrame(&socket, &identity);
+    RecvFrame(&socket, &header);
+    RecvFrame(&socket, &table);
+    RecvFrame(&socket, &indices);
+    if (indices.more()) {
+      RecvFrame(&socket, &grad);
+    }
+    CAFFE_ENFORCE_EQ(header.size(), sizeof(RequestHeader));
+    RequestHeader request;
+    memcpy(&request, header.data(), sizeof(request));
+
+    ReplyHeader reply{request.request, 1, 0};
+    std::string payload;
+    try {
+      const std::string name(static_cast<char*>(table.data()), table.size());
+      payload = Handle(request.type, name, &indices, &grad);
+      reply.dim = tables_.at(name).dim;
+    } catch (const std::exception& e) {
+      LOG(ERROR) << "Request failed: " << e.what();
+      reply.ok = 0;
+      payload = e.what();
+    }
+    SendFrame(
+        &socket,
+        std::string(static_cast<char*>(identity.data()), identity.size()),
+        true);
+    SendFrame(&socket, ToString(&reply, 1), true);
+    SendFrame(&socket, std::move(payload), false);
+  }
+}
+
+std::string EmbeddingShardServer::Handle(
+    uint32_t type,
+    const std::string& table,
+    ZmqMessage* indices,
+    ZmqMessage* grad) {
+  auto it = tables_.find(table);
+  CAFFE_ENFORCE(it != tables_.end(), "Unknown table ", table);
+  auto& shard_table = it->second;
+  const int64_t n = indices->size() / sizeof(int64_t);
+  if (n == 0) {
+    return "";
+  }
+
+  auto* rows = ws_.GetBlob(table + "_indices")->GetMutable<TensorCPU>();
+  rows->Resize(n);
+  auto* rows_data = rows->mutable_data<int64_t>();
+  memcpy(rows_data, indices->data(), n * sizeof(int64_t));
+  for (int64_t i = 0; i < n; ++i) {
+    CAFFE_ENFORCE(
+        rows_data[i] >= 0 && rows_data[i] < shard_table.rows,
+        "Row ",
+        rows_data[i] * num_shards_ + shard_,
+        " out of the range of ",
+        table);
+  }
+
+  if (type == LOOKUP) {
+    CAFFE_ENFORCE(shard_table.gather->Run());
+    const auto& output = ws_.GetBlob(table + "_rows")->Get<TensorCPU>();
+    return ToString(output.data<float>(), output.size());
+  }
+  CAFFE_ENFORCE_EQ(type, PUSH, "Unknown request type");
+  auto* grad_tensor = ws_.GetBlob(table + "_grad")->GetMutable<TensorCPU>();
+  grad_tensor->Resize(n, shard_table.dim);
+  CAFFE_ENFORCE_EQ(grad_tensor->nbytes(), grad->size(), "Wrong gradient size");
+  memcpy(grad_tensor->mutable_data<float>(), grad->data(), grad->size());
+  CAFFE_ENFORCE(shard_table.adagrad->Run());
+  return "";
+}
+
+EmbeddingShardClient::EmbeddingShardClient(
+    StoreHandler* store,
+    const std::string& service,
+    int num_shards)
+    : num_shards_(num_shards) {
+  CAFFE_ENFORCE_GT(num_shards_, 0);
+  std::vector<std::string> keys;
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    keys.push_back(EmbeddingShardKey(service, shard));
+  }
+  store->wait(keys);
+  const auto endpoints = store->multiGet(keys);
+  for (const auto& endpoint : endpoints) {
+    sockets_.emplace_back(new ZmqSocket(ZMQ_DEALER));
+    sockets_.back()->Connect(endpoint);
+  }
+}
+
+void EmbeddingShardClient::Send(
+    int shard,
+    int64_t request,
+    uint32_t type,
+    const std::string& table,
+    const std::vector<int64_t>& rows,
+    std::string grad) {
+  const bool push = type == PUSH;
+  const RequestHeader header{
+      request,
+      type,
+      push ? static_cast<uint32_t>(grad.size() / sizeof(float) / rows.size())
+           : 0};
+  auto* socket = sockets_[shard].get();
+  SendFrame(socket, ToString(&header, 1), true);
+  SendFrame(socket, table, true);
+  SendFrame(socket, ToString(rows.data(), rows.size()), push);
+  if (push) {
+    SendFrame(socket, std::move(grad), false);
+  }
+}
+
+int64_t EmbeddingShardClient::Lookup(
+    const std::string& table,
+    const int64_t* indices,
+    int64_t n) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  Request request;
+  request.lookup = true;
+  request.n = n;
+  request.positions.resize(num_shards_);
+
+  // Every row is asked once to its shard
+  std::vector<std::vector<int64_t>> rows(num_shards_);
+  std::vector<std::unordered_map<int64_t, int64_t>> slots(num_shards_);
+  for (int64_t i = 0; i < n; ++i) {
+    CAFFE_ENFORCE_GE(indices[i], 0, "Negative index");
+    const int shard = indices[i] % num_shards_;
+    const int64_t row = indices[i] / num_shards_;
+    auto it = slots[shard].find(row);
+    if (it == slots[shard].end()) {
+      it = slots[shard].emplace(row, rows[shard].size()).first;
+      rows[shard].push_back(row);
+    }
+    request.positions[shard].emplace_back(i, it->second);
+  }
+  const auto id = next_request_++;
+  request.remaining = 0;
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    // An empty lookup still asks shard 0 for the size of the rows
+    if (!rows[shard].empty() || (n == 0 && shard == 0)) {
+      Send(shard, id, LOOKUP, table, rows[shard], "");
+      ++request.remaining;
+    }
+  }
+  requests_.emplace(id, std::move(request));
+  return id;
+}
+
+void EmbeddingShardClient::WaitLookup(int64_t id, TensorCPU* output) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = requests_.find(id);
+  CAFFE_ENFORCE(
+      it != requests_.end() && it->second.lookup, "Unknown lookup ", id);
+  while (it->second.remaining > 0 && error_.empty()) {
+    Receive();
+  }
+  if (!error_.empty()) {
+    requests_.erase(it);
+    std::string error;
+    std::swap(error, error_);
+    CAFFE_THROW(error);
+  }
+  auto& request = it->second;
+  output->Resize(request.n, request.dim);
+  if (request.n > 0) {
+    memcpy(
+        output->mutable_data<float>(),
+        request.output.data(),
+        output->nbytes());
+  } else {
+    output->mutable_data<float>();
+  }
+  requests_.erase(it);
+}
+
+void EmbeddingShardClient::PushGradient(
+    const std::string& table,
+    const int64_t* indices,
+    int64_t n,
+    const float* grad,
+    int dim) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  std::vector<std::vector<int64_t>> rows(num_shards_);
+  std::vector<std::string> grads(num_shards_);
+  for (int64_t i = 0; i < n; ++i) {
+    CAFFE_ENFORCE_GE(indices[i], 0, "Negative index");
+    const int shard = indices[i] % num_shards_;
+    rows[shard].push_back(indices[i] / num_shards_);
+    grads[shard].append(ToString(grad + i * dim, dim));
+  }
+  const auto id = next_request_++;
+  Request request;
+  request.lookup = false;
+  request.n = n;
+  request.remaining = 0;
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    if (!rows[shard].empty()) {
+      Send(shard, id, PUSH, table, rows[shard], std::move(grads[shard]));
+      ++request.remaining;
+    }
+  }
+  if (request.remaining > 0) {
+    requests_.emplace(id, std::move(request));
+    ++num_pushes_;
+  }
+}
+
+void EmbeddingShardClient::Flush() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  while (num_pushes_ > 0 && error_.empty()) {
+    Receive();
+  }
+  if (!error_.empty()) {
+    std::string error;
+    std::swap(error, error_);
+    CAFFE_THROW(error);
+  }
+}
+
+void EmbeddingShardClient::Receive() {
+  std::vector<zmq_pollitem_t> items(num_shards_);
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    items[shard] = {sockets_[shard]->ptr(), 0, ZMQ_POLLIN, 0};
+  }
+  const int rc = zmq_poll(items.data(), items.size(), -1);
+  CAFFE_ENFORCE(rc >= 0 || zmq_errno() == EINTR, "zmq_poll failed");
+  for (int shard = 0; shard < num_shards_; ++shard) {
+    if (items[shard].revents & ZMQ_POLLIN) {
+      ZmqMessage header, payload;
+      RecvFrame(sockets_[shard].get(), &header);
+      RecvFrame(sockets_[shard].get(), &payload);
+      Handle(shard, &header, &payload);
+    }
+  }
+}
+
+void EmbeddingShardClient::Handle(
+    int shard,
+    ZmqMessage* header,
+    ZmqMessage* payload) {
+  CAFFE_ENFORCE_EQ(header->size(), sizeof(ReplyHeader));
+  ReplyHeader reply;
+  memcpy(&reply, header->data(), sizeof(reply));
+  auto it = requests_.find(reply.request);
+  if (it == requests_.end()) {
+    // Another shard failed the request
+    return;
+  }
+  auto& request = it->second;
+  if (!reply.ok) {
+    error_ = MakeString(
+        "Shard ",
+        shard,
+        " failed: ",
+        std::string(static_cast<char*>(payload->data()), payload->size()));
+    if (!request.lookup) {
+      requests_.erase(it);
+      --num_pushes_;
+    }
+    return;
+  }
+  --request.remaining;
+  if (!request.lookup) {
+    if (request.remaining == 0) {
+      requests_.erase(it);
+      --num_pushes_;
+    }
+    return;
+  }
+
+  request.dim = reply.dim;
+  request.output.resize(request.n * request.dim);
+  const auto* rows = static_cast<const float*>(payload->data());
+  const int64_t num_rows =
+      request.dim ? payload->size() / sizeof(float) / request.dim : 0;
+  for (const auto& position : request.positions[shard]) {
+    CAFFE_ENFORCE_LT(position.second, num_rows, "Short reply of shard ", shard);
+    memcpy(
+        request.output.data() + position.first * request.dim,
+        rows + position.second * request.dim,
+        request.dim * sizeof(float));
+  }
+}
+
+} // namespace caffe2
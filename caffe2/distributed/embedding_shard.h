@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/distributed/store_handler.h"
+#include "caffe2/utils/zmq_helper.h"
+
+namespace caffe2 {
+
+/*
+ * Embedding tables too large for a trainer are split between the shards of
+ * a service: row r of a table of a service with n shards is row r / n of
+ * shard r % n. Every shard server publishes its address in a store, under
+ * the key returned by EmbeddingShardKey, where the clients find it.
+ *
+ * The clients talk to the servers through a zmq DEALER socket per shard.
+ * A request is a header, the table name, the rows of the shard and, for a
+ * gradient push, the gradients of the rows. A server handles the requests
+ * of a client in order, so a lookup sees the gradients the client pushed
+ * before it.
+ */
+std::string EmbeddingShardKey(const std::string& service, int shard);
+
+class EmbeddingShardServer {
+ public:
+  struct Table {
+    std::string name;
+    int64_t rows;
+    int dim;
+  };
+
+  // Initializes the rows of the shard of every table uniformly in
+  // [-init_scale, init_scale], they are updated by SparseAdagrad
+  EmbeddingShardServer(
+      int shard,
+      int num_shards,
+      const std::vector<Table>& tables,
+      float init_scale,
+      float learning_rate,
+      float epsilon);
+
+  // Binds the socket to address, publishes endpoint, the address clients
+  // connect to, in store and handles the requests until the process ends
+  void Serve(
+      const std::string& address,
+      const std::string& endpoint,
+      StoreHandler* store,
+      const std::string& service);
+
+ private:
+  struct ShardTable {
+    int64_t rows;
+    int dim;
+    std::unique_ptr<OperatorBase> gather;
+    std::unique_ptr<OperatorBase> adagrad;
+  };
+
+  // Handles a request of a client, returns the payload of the reply
+  std::string Handle(
+      uint32_t type,
+      const std::string& table,
+      ZmqMessage* indices,
+      ZmqMessage* grad);
+
+  const int shard_;
+  const int num_shards_;
+  Workspace ws_;
+  std::unordered_map<std::string, ShardTable> tables_;
+};
+
+class EmbeddingShardClient {
+ public:
+  // Waits for the num_shards servers of service to be published in store
+  // and connects to them
+  EmbeddingShardClient(
+      StoreHandler* store,
+      const std::string& service,
+      int num_shards);
+
+  // Sends the lookups of the rows to their shards and returns the request
+  // to wait for, the rows are fetched while the caller keeps running
+  int64_t Lookup(const std::string& table, const int64_t* indices, int64_t n);
+
+  // Waits for the rows of a lookup and writes them to output, n x dim
+  void WaitLookup(int64_t request, TensorCPU* output);
+
+  // Sends the gradients of n rows, of dim values each, to their shards
+  // without waiting for them to be applied. The failures of the pushes are
+  // reported by the next call waiting for a reply.
+  void PushGradient(
+      const std::string& table,
+      const int64_t* indices,
+      int64_t n,
+      const float* grad,
+      int dim);
+
+  // Waits until the shards applied all the pushed gradients
+  void Flush();
+
+ private:
+  struct Request {
+    bool lookup;
+    int64_t n;
+    // Position in the lookup and row in the reply of every row asked to
+    // every shard
+    std::vector<std::vector<std::pair<int64_t, int64_t>>> positions;
+    int remaining;
+    int dim = 0;
+    std::vector<float> output;
+  };
+
+  void Send(
+      int shard,
+      int64_t request,
+      uint32_t type,
+      const std::string& table,
+      const std::vector<int64_t>& rows,
+      std::string grad);
+  // Waits for replies and handles them
+  void Receive();
+  void Handle(int shard, ZmqMessage* header, ZmqMessage* payload);
+
+  const int num_shards_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<ZmqSocket>> sockets_;
+  int64_t next_request_ = 0;
+  std::unordered_map<int64_t, Request> requests_;
+  int num_pushes_ = 0;
+  std::string error_;
+};
+
+} // namespace caffe2
@@ -0,0 +1,170 @@
+#include "embedding_shard_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr auto kService = "service";
+constexpr auto kNumShards = "num_shards";
+constexpr auto kTable = "table";
+
+EmbeddingShardClient* GetClient(OperatorBase* op, int index) {
+  auto* client =
+      op->Input<std::unique_ptr<EmbeddingShardClient>>(index).get();
+  CAFFE_ENFORCE(client, "The embedding shard client is not created");
+  return client;
+}
+
+// The client takes int64 rows
+template <typename T>
+std::vector<int64_t> ToRows(const TensorCPU& indices) {
+  const auto* data = indices.data<T>();
+  return std::vector<int64_t>(data, data + indices.size());
+}
+
+} // namespace
+
+EmbeddingShardClientCreateOp::EmbeddingShardClientCreateOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      service_(GetSingleArgument<std::string>(kService, "")),
+      numShards_(GetSingleArgument<int>(kNumShards, 0)) {
+  CAFFE_ENFORCE_NE(service_, "", "service is a required argument");
+  CAFFE_ENFORCE_GT(numShards_, 0, "num_shards is a required argument");
+}
+
+bool EmbeddingShardClientCreateOp::RunOnDevice() {
+  auto* handler =
+      OperatorBase::Input<std::unique_ptr<StoreHandler>>(HANDLER).get();
+  *OperatorBase::Output<std::unique_ptr<EmbeddingShardClient>>(CLIENT) =
+      std::unique_ptr<EmbeddingShardClient>(
+          new EmbeddingShardClient(handler, service_, numShards_));
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(EmbeddingShardClientCreate, EmbeddingShardClientCreateOp);
+OPERATOR_SCHEMA(EmbeddingShardClientCreate)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates a client of the shard servers of a sharded embedding service, see
+binaries/embedding_shard_server.cc. Waits for the servers of all the shards
+to publish their address in the store and connects to them.
+)DOC")
+    .Arg("service", "name of the service the servers publish")
+    .Arg("num_shards", "number of shards of the tables")
+    .Input(0, "handler", "unique_ptr<StoreHandler>")
+    .Output(0, "client", "unique_ptr<EmbeddingShardClient>");
+
+EmbeddingShardLookupOp::EmbeddingShardLookupOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      table_(GetSingleArgument<std::string>(kTable, "")) {
+  CAFFE_ENFORCE_NE(table_, "", "table is a required argument");
+}
+
+bool EmbeddingShardLookupOp::RunOnDevice() {
+  return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+      this, Input(INDICES));
+}
+
+template <typename T>
+bool EmbeddingShardLookupOp::DoRunWithType() {
+  const auto rows = ToRows<T>(Input(INDICES));
+  auto* request = Output(REQUEST);
+  request->Resize(std::vector<TIndex>());
+  *request->mutable_data<int64_t>() =
+      GetClient(this, CLIENT)->Lookup(table_, rows.data(), rows.size());
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(EmbeddingShardLookup, EmbeddingShardLookupOp);
+OPERATOR_SCHEMA(EmbeddingShardLookup)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Sends the lookup of rows of a sharded embedding table to the shards holding
+them, without waiting for the rows. EmbeddingShardLookupWait gets them. A
+net can send the lookup of the next batch before the computation on the
+current batch, so that the rows are fetched while it runs.
+)DOC")
+    .Arg("table", "name of the table")
+    .Input(0, "client", "unique_ptr<EmbeddingShardClient>")
+    .Input(1, "indices", "int32 or int64 rows of the table")
+    .Output(0, "request", "int64 scalar identifying the lookup");
+
+bool EmbeddingShardLookupWaitOp::RunOnDevice() {
+  const auto& request = Input(REQUEST);
+  CAFFE_ENFORCE_EQ(request.size(), 1);
+  GetClient(this, CLIENT)
+      ->WaitLookup(*request.data<int64_t>(), Output(EMBEDDINGS));
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(EmbeddingShardLookupWait, EmbeddingShardLookupWaitOp);
+OPERATOR_SCHEMA(EmbeddingShardLookupWait)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Waits for the rows of a lookup sent by EmbeddingShardLookup. Every lookup
+is waited for once.
+)DOC")
+    .Input(0, "client", "unique_ptr<EmbeddingShardClient>")
+    .Input(1, "request", "lookup returned by EmbeddingShardLookup")
+    .Output(0, "embeddings", "the rows, one per index, float");
+
+EmbeddingShardPushGradientOp::EmbeddingShardPushGradientOp(
+    const OperatorDef& operator_def,
+    Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      table_(GetSingleArgument<std::string>(kTable, "")),
+      sync_(GetSingleArgument<bool>("sync", false)) {
+  CAFFE_ENFORCE_NE(table_, "", "table is a required argument");
+}
+
+bool EmbeddingShardPushGradientOp::RunOnDevice() {
+  return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+      this, Input(INDICES));
+}
+
+template <typename T>
+bool EmbeddingShardPushGradientOp::DoRunWithType() {
+  const auto rows = ToRows<T>(Input(INDICES));
+  const auto& grad = Input(GRAD);
+  CAFFE_ENFORCE_GT(grad.ndim(), 0);
+  CAFFE_ENFORCE_EQ(grad.dim(0), static_cast<TIndex>(rows.size()));
+  const int dim = rows.empty() ? 0 : grad.size_from_dim(1);
+  auto* client = GetClient(this, CLIENT);
+  client->PushGradient(
+      table_, rows.data(), rows.size(), grad.data<float>(), dim);
+  if (sync_) {
+    client->Flush();
+  }
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(EmbeddingShardPushGradient, EmbeddingShardPushGradientOp);
+OPERATOR_SCHEMA(EmbeddingShardPushGradient)
+    .NumInputs(3)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Sends the gradients of rows of a sharded embedding table to the shards
+holding them, which apply them with SparseAdagrad. The op does not wait for
+the gradients to be applied, unless sync is set, but the shards apply them
+before the later lookups of the client. The failures are reported by the
+next op waiting for the shards.
+)DOC")
+    .Arg("table", "name of the table")
+    .Arg("sync", "(bool, default false) wait for the gradients to be applied")
+    .Input(0, "client", "unique_ptr<EmbeddingShardClient>")
+    .Input(1, "indices", "int32 or int64 rows of the table")
+    .Input(2, "grad", "float gradients of the rows, one row per index");
+
+SHOULD_NOT_DO_GRADIENT(EmbeddingShardClientCreate);
+SHOULD_NOT_DO_GRADIENT(EmbeddingShardLookup);
+SHOULD_NOT_DO_GRADIENT(EmbeddingShardLookupWait);
+SHOULD_NOT_DO_GRADIENT(EmbeddingShardPushGradient);
+
+} // namespace caffe2
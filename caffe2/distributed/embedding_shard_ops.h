@@ -0,0 +1,63 @@
+#pragma once
+
+#include "embedding_shard.h"
+
+#include <caffe2/core/operator.h>
+
+namespace caffe2 {
+
+class EmbeddingShardClientCreateOp final : public Operator<CPUContext> {
+ public:
+  EmbeddingShardClientCreateOp(const OperatorDef& operator_def, Workspace* ws);
+  bool RunOnDevice() override;
+
+ private:
+  std::string service_;
+  int numShards_;
+
+  INPUT_TAGS(HANDLER);
+  OUTPUT_TAGS(CLIENT);
+};
+
+class EmbeddingShardLookupOp final : public Operator<CPUContext> {
+ public:
+  EmbeddingShardLookupOp(const OperatorDef& operator_def, Workspace* ws);
+  bool RunOnDevice() override;
+
+  template <typename T>
+  bool DoRunWithType();
+
+ private:
+  std::string table_;
+
+  INPUT_TAGS(CLIENT, INDICES);
+  OUTPUT_TAGS(REQUEST);
+};
+
+class EmbeddingShardLookupWaitOp final : public Operator<CPUContext> {
+ public:
+  EmbeddingShardLookupWaitOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+  bool RunOnDevice() override;
+
+ private:
+  INPUT_TAGS(CLIENT, REQUEST);
+  OUTPUT_TAGS(EMBEDDINGS);
+};
+
+class EmbeddingShardPushGradientOp final : public Operator<CPUContext> {
+ public:
+  EmbeddingShardPushGradientOp(const OperatorDef& operator_def, Workspace* ws);
+  bool RunOnDevice() override;
+
+  template <typename T>
+  bool DoRunWithType();
+
+ private:
+  std::string table_;
+  bool sync_;
+
+  INPUT_TAGS(CLIENT, INDICES, GRAD);
+};
+
+} // namespace caffe2
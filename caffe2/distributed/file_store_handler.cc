@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <iostream>
@@ -16,6 +17,12 @@
 #include <direct.h> // for _mkdir
 #endif
 
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "caffe2/utils/murmur_hash3.h"
 
 namespace caffe2 {
@@ -34,6 +41,56 @@ static std::string encodeName(const std::string& name) {
   return std::string(buf.data(), buf.size() - 1);
 }
 
+namespace {
+
+// Wakes up when files are created in a directory, through inotify where it
+// is available. Shared filesystems such as NFS don't report the files
+// created by other hosts, waits then time out and the caller polls.
+class DirectoryWatch {
+ public:
+  explicit DirectoryWatch(const std::string& path) {
+#if defined(__linux__)
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ != -1 &&
+        inotify_add_watch(fd_, path.c_str(), IN_CREATE | IN_MOVED_TO) == -1) {
+      close(fd_);
+      fd_ = -1;
+    }
+#endif
+  }
+
+  ~DirectoryWatch() {
+#if defined(__linux__)
+    if (fd_ != -1) {
+      close(fd_);
+    }
+#endif
+  }
+
+  // Waits up to timeout for a file to be created
+  void wait(std::chrono::milliseconds timeout) {
+#if defined(__linux__)
+    if (fd_ != -1) {
+      struct pollfd pfd = {fd_, POLLIN, 0};
+      if (poll(&pfd, 1, timeout.count()) > 0) {
+        // Drain the events, the caller checks its files again anyway
+        std::array<char, 4096> buf;
+        while (read(fd_, buf.data(), buf.size()) > 0) {
+        }
+      }
+      return;
+    }
+#endif
+    /* sleep override */
+    std::this_thread::sleep_for(timeout);
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+} // namespace
+
 FileStoreHandler::FileStoreHandler(
     const std::string& path,
     const std::string& prefix) {
@@ -144,17 +201,22 @@ bool FileStoreHandler::check(const std::vector<std::string>& names) {
 void FileStoreHandler::wait(
     const std::vector<std::string>& names,
     const std::chrono::milliseconds& timeout) {
-  // Not using inotify because it doesn't work on many
-  // shared filesystems (such as NFS).
+  // Keys set on this host wake the wait up through inotify. Keys set by
+  // other hosts on a shared filesystem (such as NFS) are polled, less and
+  // less often so that large jobs don't overload the filesystem.
   const auto start = std::chrono::steady_clock::now();
+  const std::chrono::milliseconds kMaxInterval(200);
+  std::chrono::milliseconds interval(10);
+  // Created before the first check, so no file created after it is missed
+  DirectoryWatch watch(basePath_);
   while (!check(names)) {
     const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::steady_clock::now() - start);
     if (timeout != kNoTimeout && elapsed > timeout) {
       STORE_HANDLER_TIMEOUT("Wait timeout for name(s): ", Join(" ", names));
     }
-    /* sleep override */
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    watch.wait(interval);
+    interval = std::min(interval * 2, kMaxInterval);
   }
 }
 }
@@ -2,12 +2,112 @@
 
 #include <caffe2/core/logging.h>
 
+#include <poll.h>
+
+#include <algorithm>
 #include <chrono>
+#include <memory>
 #include <thread>
 #include <vector>
 
 namespace caffe2 {
 
+namespace {
+
+struct ReplyDeleter {
+  void operator()(redisReply* reply) const {
+    freeReplyObject(reply);
+  }
+};
+
+using ReplyPtr = std::unique_ptr<redisReply, ReplyDeleter>;
+
+// Sends a command made of args, binary safe, null if it failed
+ReplyPtr commandArgv(redisContext* redis, const std::vector<std::string>& args) {
+  std::vector<const char*> argv;
+  std::vector<size_t> argvlen;
+  for (const auto& arg : args) {
+    argv.push_back(arg.c_str());
+    argvlen.push_back(arg.length());
+  }
+  void* ptr = redisCommandArgv(redis, argv.size(), argv.data(), argvlen.data());
+  return ReplyPtr(static_cast<redisReply*>(ptr));
+}
+
+// Wakes up when keys are set, through the keyspace notifications of the
+// server, on its own connection. Servers publish them only when configured
+// to (notify-keyspace-events, with at least "K$"), waits otherwise time out
+// and the caller polls.
+class KeyspaceSubscriber {
+ public:
+  KeyspaceSubscriber(
+      const std::string& host,
+      int port,
+      const std::vector<std::string>& keys) {
+    struct timeval tv = {
+        .tv_sec = 5, .tv_usec = 0,
+    };
+    redis_ = redisConnectWithTimeout(host.c_str(), port, tv);
+    if (redis_ == nullptr || redis_->err) {
+      close();
+      return;
+    }
+    std::vector<std::string> args;
+    args.push_back("SUBSCRIBE");
+    for (const auto& key : keys) {
+      // The store never selects a database, its keys are in database 0
+      args.push_back("__keyspace@0__:" + key);
+    }
+    // Only the first confirmation is read, the others come as messages
+    if (!commandArgv(redis_, args)) {
+      close();
+    }
+  }
+
+  ~KeyspaceSubscriber() {
+    close();
+  }
+
+  // Waits up to timeout for a message
+  void wait(std::chrono::milliseconds timeout) {
+    if (redis_ != nullptr) {
+      void* ptr = nullptr;
+      if (redisGetReplyFromReader(redis_, &ptr) == REDIS_OK && ptr) {
+        freeReplyObject(ptr);
+        return;
+      }
+      struct pollfd pfd = {redis_->fd, POLLIN, 0};
+      if (poll(&pfd, 1, timeout.count()) <= 0) {
+        return;
+      }
+      if (redisBufferRead(redis_) != REDIS_OK) {
+        close();
+        return;
+      }
+      // Drain the messages, the caller checks its keys again anyway
+      while (redisGetReplyFromReader(redis_, &ptr) == REDIS_OK && ptr) {
+        freeReplyObject(ptr);
+        ptr = nullptr;
+      }
+      return;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(timeout);
+  }
+
+ private:
+  void close() {
+    if (redis_ != nullptr) {
+      redisFree(redis_);
+      redis_ = nullptr;
+    }
+  }
+
+  redisContext* redis_ = nullptr;
+};
+
+} // namespace
+
 RedisStoreHandler::RedisStoreHandler(
     std::string& host,
     int port,
@@ -52,15 +152,68 @@ void RedisStoreHandler::set(const std::string& name, const std::string& data) {
 }
 
 std::string RedisStoreHandler::get(const std::string& name) {
-  // Block until key is set
-  wait({name});
+  return multiGet({name})[0];
+}
 
-  auto key = compoundKey(name);
-  void* ptr = redisCommand(redis_, "GET %b", key.c_str(), (size_t)key.size());
-  CAFFE_ENFORCE_NE(ptr, (void*)nullptr, redis_->errstr);
-  redisReply* reply = static_cast<redisReply*>(ptr);
-  CAFFE_ENFORCE_EQ(reply->type, REDIS_REPLY_STRING);
-  return std::string(reply->str, reply->len);
+void RedisStoreHandler::multiSet(
+    const std::vector<std::string>& names,
+    const std::vector<std::string>& data) {
+  CAFFE_ENFORCE_EQ(names.size(), data.size());
+  // Pipeline the commands, then read all the replies before checking them,
+  // so the connection is left in a clean state
+  for (size_t i = 0; i < names.size(); i++) {
+    auto key = compoundKey(names[i]);
+    CAFFE_ENFORCE_EQ(
+        redisAppendCommand(
+            redis_,
+            "SETNX %b %b",
+            key.c_str(),
+            (size_t)key.size(),
+            data[i].c_str(),
+            (size_t)data[i].size()),
+        REDIS_OK,
+        redis_->errstr);
+  }
+  std::vector<ReplyPtr> replies;
+  for (size_t i = 0; i < names.size(); i++) {
+    void* ptr = nullptr;
+    CAFFE_ENFORCE_EQ(redisGetReply(redis_, &ptr), REDIS_OK, redis_->errstr);
+    replies.emplace_back(static_cast<redisReply*>(ptr));
+  }
+  for (size_t i = 0; i < names.size(); i++) {
+    CAFFE_ENFORCE_EQ(replies[i]->type, REDIS_REPLY_INTEGER);
+    CAFFE_ENFORCE_EQ(
+        replies[i]->integer,
+        1,
+        "Value at ",
+        names[i],
+        " was already set",
+        " (perhaps you reused a run ID you have used before?)");
+  }
+}
+
+std::vector<std::string> RedisStoreHandler::multiGet(
+    const std::vector<std::string>& names) {
+  // Block until the keys are set
+  wait(names);
+
+  std::vector<std::string> args;
+  args.push_back("MGET");
+  for (const auto& name : names) {
+    args.push_back(compoundKey(name));
+  }
+  auto reply = commandArgv(redis_, args);
+  CAFFE_ENFORCE(reply, redis_->errstr);
+  CAFFE_ENFORCE_EQ(reply->type, REDIS_REPLY_ARRAY);
+  CAFFE_ENFORCE_EQ(reply->elements, names.size());
+  std::vector<std::string> result;
+  result.reserve(names.size());
+  for (size_t i = 0; i < reply->elements; i++) {
+    const auto* element = reply->element[i];
+    CAFFE_ENFORCE_EQ(element->type, REDIS_REPLY_STRING, names[i]);
+    result.emplace_back(element->str, element->len);
+  }
+  return result;
 }
 
 int64_t RedisStoreHandler::add(const std::string& name, int64_t value) {
@@ -79,18 +232,8 @@ bool RedisStoreHandler::check(const std::vector<std::string>& names) {
   for (const auto& name : names) {
     args.push_back(compoundKey(name));
   }
-
-  std::vector<const char*> argv;
-  std::vector<size_t> argvlen;
-  for (const auto& arg : args) {
-    argv.push_back(arg.c_str());
-    argvlen.push_back(arg.length());
-  }
-
-  auto argc = argv.size();
-  void* ptr = redisCommandArgv(redis_, argc, argv.data(), argvlen.data());
-  CAFFE_ENFORCE_NE(ptr, (void*)nullptr, redis_->errstr);
-  redisReply* reply = static_cast<redisReply*>(ptr);
+  auto reply = commandArgv(redis_, args);
+  CAFFE_ENFORCE(reply, redis_->errstr);
   CAFFE_ENFORCE_EQ(reply->type, REDIS_REPLY_INTEGER);
   return reply->integer == names.size();
 }
@@ -98,19 +241,28 @@ bool RedisStoreHandler::check(const std::vector<std::string>& names) {
 void RedisStoreHandler::wait(
     const std::vector<std::string>& names,
     const std::chrono::milliseconds& timeout) {
-  // Simple approach: poll...
-  // Complex approach: use pub/sub.
-  // Polling is fine for the typical rendezvous use case, as it is
-  // only done at initialization time and  not at run time.
+  if (check(names)) {
+    return;
+  }
+  // Keys set after the subscription wake the wait up right away with
+  // keyspace notifications. Without them, the keys are polled, less and less
+  // often so that large jobs don't overload the server.
+  std::vector<std::string> keys;
+  for (const auto& name : names) {
+    keys.push_back(compoundKey(name));
+  }
+  KeyspaceSubscriber subscriber(host_, port_, keys);
   const auto start = std::chrono::steady_clock::now();
+  const std::chrono::milliseconds kMaxInterval(200);
+  std::chrono::milliseconds interval(10);
   while (!check(names)) {
     const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
         std::chrono::steady_clock::now() - start);
     if (timeout != kNoTimeout && elapsed > timeout) {
       STORE_HANDLER_TIMEOUT("Wait timeout for name(s): ", Join(" ", names));
     }
-    /* sleep override */
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    subscriber.wait(interval);
+    interval = std::min(interval * 2, kMaxInterval);
   }
 }
 }
@@ -27,6 +27,13 @@ class RedisStoreHandler : public StoreHandler {
       const std::vector<std::string>& names,
       const std::chrono::milliseconds& timeout = kDefaultTimeout) override;
 
+  virtual void multiSet(
+      const std::vector<std::string>& names,
+      const std::vector<std::string>& data) override;
+
+  virtual std::vector<std::string> multiGet(
+      const std::vector<std::string>& names) override;
+
  private:
   std::string host_;
   int port_;
@@ -48,6 +48,21 @@ class StoreHandler {
   virtual void wait(
       const std::vector<std::string>& names,
       const std::chrono::milliseconds& timeout = kDefaultTimeout) = 0;
+
+  /*
+   * Set data for several keys, like set for every key.
+   * Handlers can override it to send all the keys at once.
+   */
+  virtual void multiSet(
+      const std::vector<std::string>& names,
+      const std::vector<std::string>& data);
+
+  /*
+   * Get the data for several keys, waiting until they are all stored.
+   * Handlers can override it to fetch all the keys at once.
+   */
+  virtual std::vector<std::string> multiGet(
+      const std::vector<std::string>& names);
 };
 
 struct StoreHandlerTimeoutException : public std::runtime_error {
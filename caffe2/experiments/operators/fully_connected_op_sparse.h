@@ -75,6 +75,8 @@ void Sparse_mm<float, CPUContext>(
 }
 
 // This is Caffe's InnerProductOp, with a name that fits its purpose better.
+// Superseded by BlockSparseFC (operators/block_sparse_fc_op.h), which doesn't
+// need MKL nor transposed inputs.
 template <typename T, class Context, class Engine=DefaultEngine>
 class FullyConnectedOp_SPARSE final : public Operator<Context> {
  public:
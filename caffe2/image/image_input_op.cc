@@ -86,17 +86,30 @@ The dimension of the output image will always be cropxcrop
     .Arg("use_caffe_datum", "1 if the input is in Caffe format. Defaults to 0")
     .Arg("use_gpu_transform", "1 if GPU acceleration should be used."
          " Defaults to 0. Can only be 1 in a CUDAContext")
+    .Arg("use_gpu_augment", "1 if only decoding should happen on the CPU;"
+         " the scaling, cropping, mirroring and normalization of the batch"
+         " then run on the GPU, on the stream of the prefetching thread."
+         " Defaults to 0. Can only be 1 in a CUDAContext, and not with"
+         " use_gpu_transform, color_jitter or color_lighting")
     .Arg("decode_threads", "Number of CPU decode/transform threads."
          " Defaults to 4")
-    .Arg("output_type", "If gpu_transform, can set to FLOAT or FLOAT16.")
+    .Arg("output_type", "If gpu_transform or gpu_augment, can set to FLOAT or"
+         " FLOAT16.")
     .Arg("db", "Name of the database (if not passed as input)")
     .Arg("db_type", "Type of database (if not passed as input)."
          " Defaults to leveldb")
+    .Arg("prefetch", "Number of records the local db reader reads ahead in "
+         "the background (if not passed as input). Defaults to 0")
     .Arg("output_sizes", "The sizes of any outputs besides the data and label "
          "(should have a number of elements equal to the number of additional "
          "outputs)")
     .Arg("random_scale", "[min, max] shortest-side desired for image resize. "
          "Defaults to [-1, -1] or no random resize desired.")
+    .Arg("scaled_decode", "1 if JPEGs should be decoded by the scaled IDCT "
+         "of libjpeg at 1/2, 1/4 or 1/8 of their size, the smallest one still "
+         "at least scale. Only used with scale, without bounding boxes and "
+         "without Inception-style scale jittering in training. Requires "
+         "OpenCV 3.2 or later. Defaults to 0")
     .Input(0, "reader", "The input reader (a db::DBReader)")
     .Output(0, "data", "Tensor containing the images")
     .Output(1, "label", "Tensor containing the labels")
@@ -15,6 +15,13 @@
 #include "caffe2/operators/prefetch_op.h"
 #include "caffe2/image/transform_gpu.h"
 
+// The reduced imdecode modes decode JPEGs with the scaled IDCT of libjpeg
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+#define CAFFE2_IMAGE_SCALED_DECODE 1
+#else
+#define CAFFE2_IMAGE_SCALED_DECODE 0
+#endif
+
 namespace caffe2 {
 
 class CUDAContext;
@@ -73,25 +80,51 @@ class ImageInputOp final
     BoundingBox bounding_params;
   };
 
+  // Images reused by the decodes of a thread, to avoid reallocating them
+  // for every image of the same size
+  struct DecodeBuffers {
+    cv::Mat decoded;
+    cv::Mat scaled;
+  };
+
   bool GetImageAndLabelAndInfoFromDBValue(
       const string& value, cv::Mat* img, PerImageArg& info, int item_id,
-      std::mt19937* randgen);
+      std::mt19937* randgen, bool scale_image = true,
+      DecodeBuffers* buffers = nullptr);
+  void DecodeImage(
+      const char* data, int size, const PerImageArg& info, cv::Mat* dst);
+  ImageResizeCrop GetResizeCrop(
+      const cv::Mat& img, std::mt19937* randgen,
+      std::bernoulli_distribution* mirror_this_image);
   void DecodeAndTransform(
       const std::string& value, float *image_data, int item_id,
       const int channels, std::size_t thread_index);
   void DecodeAndTransposeOnly(
       const std::string& value, uint8_t *image_data, int item_id,
       const int channels, std::size_t thread_index);
+  void DecodeOnly(
+      const std::string& value, int item_id, std::size_t thread_index);
+  void PackDecodedImages(const int channels);
+  void CopyMeanStdToDevice();
 
   unique_ptr<db::DBReader> owned_reader_;
   const db::DBReader* reader_;
   CPUContext cpu_context_;
+  // Records of the batch being decoded, reused across batches
+  std::vector<std::string> prefetched_values_;
   TensorCPU prefetched_image_;
   TensorCPU prefetched_label_;
   vector<TensorCPU> prefetched_additional_outputs_;
   Tensor<Context> prefetched_image_on_device_;
   Tensor<Context> prefetched_label_on_device_;
   vector<Tensor<Context>> prefetched_additional_outputs_on_device_;
+  // For use_gpu_augment: the decoded images of the batch, and where their
+  // output images come from
+  std::vector<cv::Mat> decoded_images_;
+  std::vector<ImageResizeCrop> resize_crops_;
+  TensorCPU prefetched_resize_crops_;
+  Tensor<Context> prefetched_resize_crops_on_device_;
+  Tensor<Context> prefetched_augmented_image_on_device_;
   // Default parameters for images
   PerImageArg default_arg_;
   int batch_size_;
@@ -123,6 +156,7 @@ class ImageInputOp final
   bool is_test_;
   bool use_caffe_datum_;
   bool gpu_transform_;
+  bool gpu_augment_;
   bool mean_std_copied_ = false;
 
   // thread pool for parse + decode
@@ -138,9 +172,12 @@ class ImageInputOp final
   vector<int> random_scale_;
   bool random_scaling_;
 
+  bool scaled_decode_;
+
 
   // Working variables
   std::vector<std::mt19937> randgen_per_thread_;
+  std::vector<DecodeBuffers> decode_buffers_per_thread_;
 };
 
 template <class Context>
@@ -190,6 +227,9 @@ ImageInputOp<Context>::ImageInputOp(
       gpu_transform_(OperatorBase::template GetSingleArgument<int>(
           "use_gpu_transform",
           0)),
+      gpu_augment_(OperatorBase::template GetSingleArgument<int>(
+          "use_gpu_augment",
+          0)),
       num_decode_threads_(
           OperatorBase::template GetSingleArgument<int>("decode_threads", 4)),
       thread_pool_(std::make_shared<TaskThreadPool>(num_decode_threads_)),
@@ -197,7 +237,9 @@ ImageInputOp<Context>::ImageInputOp(
       output_type_(
           cast::GetCastDataType(ArgumentHelper(operator_def), "output_type")),
       random_scale_(
-          OperatorBase::template GetRepeatedArgument<int>("random_scale", {-1,-1})) {
+          OperatorBase::template GetRepeatedArgument<int>("random_scale", {-1,-1})),
+      scaled_decode_(
+          OperatorBase::template GetSingleArgument<int>("scaled_decode", 0)) {
   if ((random_scale_[0] == -1) || (random_scale_[1] == -1)) {
     random_scaling_ = false;
   } else {
@@ -236,7 +278,10 @@ ImageInputOp<Context>::ImageInputOp(
     owned_reader_.reset(new db::DBReader(
         OperatorBase::template GetSingleArgument<string>(
             "db_type", "leveldb"),
-        db_name));
+        db_name,
+        1,
+        0,
+        OperatorBase::template GetSingleArgument<int>("prefetch", 0)));
     reader_ = owned_reader_.get();
   }
 
@@ -286,6 +331,16 @@ ImageInputOp<Context>::ImageInputOp(
       "If the output sizes are specified, they must be specified for all "
       "additional outputs");
 
+  CAFFE_ENFORCE(
+      !gpu_augment_ || !std::is_same<Context, CPUContext>::value,
+      "use_gpu_augment can only be used in a CUDAContext");
+  CAFFE_ENFORCE(
+      !gpu_augment_ || !gpu_transform_,
+      "use_gpu_augment and use_gpu_transform are mutually exclusive");
+  CAFFE_ENFORCE(
+      !gpu_augment_ || (!color_jitter_ && !color_lighting_),
+      "use_gpu_augment does not support color jitter or color lighting");
+
   CAFFE_ENFORCE(random_scale_.size() == 2,
       "Must provide [scale_min, scale_max]");
   CAFFE_ENFORCE_GE(random_scale_[1], random_scale_[0],
@@ -311,6 +366,9 @@ ImageInputOp<Context>::ImageInputOp(
   if (gpu_transform_) {
     LOG(INFO) << "    Performing transformation on GPU";
   }
+  if (gpu_augment_) {
+    LOG(INFO) << "    Performing scaling, cropping and transformation on GPU";
+  }
   LOG(INFO) << "    Outputting in batches of " << batch_size_ << " images;";
   LOG(INFO) << "    Treating input image as "
             << (color_ ? "color " : "grayscale ") << "image;";
@@ -328,6 +386,14 @@ ImageInputOp<Context>::ImageInputOp(
   if (scale_ > 0 && !random_scaling_) {
     LOG(INFO) << "    Scaling image to " << scale_
               << (warp_ ? " with " : " without ") << "warping;";
+    if (scaled_decode_) {
+#if CAFFE2_IMAGE_SCALED_DECODE
+      LOG(INFO) << "    Decoding JPEGs at the smallest scale above " << scale_
+                << ";";
+#else
+      LOG(WARNING) << "    scaled_decode requires OpenCV 3.2, ignoring it;";
+#endif
+    }
   } else {
     if (random_scaling_) {
       // randomly set min_size_ for each image
@@ -364,6 +430,7 @@ ImageInputOp<Context>::ImageInputOp(
   for (int i = 0; i < num_decode_threads_; ++i) {
     randgen_per_thread_.emplace_back(meta_randgen());
   }
+  decode_buffers_per_thread_.resize(num_decode_threads_);
   prefetched_image_.Resize(
       TIndex(batch_size_),
       TIndex(crop_),
@@ -381,21 +448,94 @@ ImageInputOp<Context>::ImageInputOp(
   }
 }
 
+// Reads the size of a JPEG from its frame header, returns false if data is
+// not a JPEG
+inline bool GetJpegSize(const char* data, int size, int* height, int* width) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  if (size < 4 || bytes[0] != 0xFF || bytes[1] != 0xD8) {
+    return false;
+  }
+  int pos = 2;
+  while (pos + 4 <= size) {
+    if (bytes[pos] != 0xFF) {
+      return false;
+    }
+    const uint8_t marker = bytes[pos + 1];
+    if (marker == 0xFF) {
+      // Fill byte
+      ++pos;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      // Markers without a segment
+      pos += 2;
+      continue;
+    }
+    if (marker == 0xD9 || marker == 0xDA) {
+      // End of image or start of scan, before any frame header
+      return false;
+    }
+    const int length = (bytes[pos + 2] << 8) | bytes[pos + 3];
+    // The start of frame markers, except DHT, JPG and DAC
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+        marker != 0xC8 && marker != 0xCC) {
+      if (pos + 9 > size) {
+        return false;
+      }
+      *height = (bytes[pos + 5] << 8) | bytes[pos + 6];
+      *width = (bytes[pos + 7] << 8) | bytes[pos + 8];
+      return *height > 0 && *width > 0;
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+template <class Context>
+void ImageInputOp<Context>::DecodeImage(
+    const char* data,
+    int size,
+    const PerImageArg& info,
+    cv::Mat* dst) {
+  int flags = color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE;
+#if CAFFE2_IMAGE_SCALED_DECODE
+  int height, width;
+  // Bounding boxes and Inception-style crops are taken from the full image
+  if (scaled_decode_ && scale_ > 0 && !info.bounding_params.valid &&
+      !(scale_jitter_type_ == INCEPTION_STYLE && !is_test_) &&
+      GetJpegSize(data, size, &height, &width)) {
+    // libjpeg rounds the scaled sizes up
+    const int shortest = std::min(height, width);
+    if ((shortest + 7) / 8 >= scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_8
+                     : cv::IMREAD_REDUCED_GRAYSCALE_8;
+    } else if ((shortest + 3) / 4 >= scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_4
+                     : cv::IMREAD_REDUCED_GRAYSCALE_4;
+    } else if ((shortest + 1) / 2 >= scale_) {
+      flags = color_ ? cv::IMREAD_REDUCED_COLOR_2
+                     : cv::IMREAD_REDUCED_GRAYSCALE_2;
+    }
+  }
+#endif
+  // We use a cv::Mat to wrap the encoded str so we do not need a copy.
+  cv::imdecode(
+      cv::Mat(1, &size, CV_8UC1, const_cast<char*>(data)), flags, dst);
+}
+
+// Region of an im_height x im_width image to scale to the crop in
 // Inception-stype scale jittering
 template <class Context>
-bool RandomSizedCropping(
-  cv::Mat* img,
-  const int crop,
-  std::mt19937* randgen
+bool RandomSizedCroppingRegion(
+  const int im_height,
+  const int im_width,
+  std::mt19937* randgen,
+  cv::Rect* region
 ) {
-  cv::Mat scaled_img;
-  bool inception_scale_jitter = false;
-  int im_height = img->rows, im_width = img->cols;
   int area = im_height * im_width;
   std::uniform_real_distribution<> area_dis(0.08, 1.0);
   std::uniform_real_distribution<> aspect_ratio_dis(3.0 / 4.0, 4.0 / 3.0);
 
-  cv::Mat cropping;
   for (int i = 0; i < 10; ++i) {
     int target_area = int(ceil(area_dis(*randgen) * area));
     float aspect_ratio = aspect_ratio_dis(*randgen);
@@ -406,21 +546,34 @@ bool RandomSizedCropping(
         0, im_height - nh)(*randgen);
       int width_offset = std::uniform_int_distribution<>(
         0,im_width - nw)(*randgen);
-      cv::Rect ROI(width_offset, height_offset, nw, nh);
-      cropping = (*img)(ROI);
-      cv::resize(
-          cropping,
-          scaled_img,
-          cv::Size(crop, crop),
-          0,
-          0,
-          cv::INTER_AREA);
-      *img = scaled_img;
-      inception_scale_jitter = true;
-      break;
+      *region = cv::Rect(width_offset, height_offset, nw, nh);
+      return true;
     }
   }
-  return inception_scale_jitter;
+  return false;
+}
+
+// Inception-stype scale jittering
+template <class Context>
+bool RandomSizedCropping(
+  cv::Mat* img,
+  const int crop,
+  std::mt19937* randgen
+) {
+  cv::Rect ROI;
+  if (!RandomSizedCroppingRegion<Context>(img->rows, img->cols, randgen, &ROI)) {
+    return false;
+  }
+  cv::Mat scaled_img;
+  cv::resize(
+      (*img)(ROI),
+      scaled_img,
+      cv::Size(crop, crop),
+      0,
+      0,
+      cv::INTER_AREA);
+  *img = scaled_img;
+  return true;
 }
 
 template <class Context>
@@ -429,13 +582,17 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
     cv::Mat* img,
     PerImageArg& info,
     int item_id,
-    std::mt19937* randgen) {
+    std::mt19937* randgen,
+    bool scale_image,
+    DecodeBuffers* buffers) {
   //
   // recommend using --caffe2_use_fatal_for_enforce=1 when using ImageInputOp
   // as this function runs on a worker thread and the exceptions from
   // CAFFE_ENFORCE are silently dropped by the thread worker functions
   //
   cv::Mat src;
+  // Decoding into the buffer of the thread reuses its memory
+  cv::Mat* decoded = buffers ? &buffers->decoded : &src;
 
   // Use the default information for images
   info = default_arg_;
@@ -447,13 +604,8 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
     prefetched_label_.mutable_data<int>()[item_id] = datum.label();
     if (datum.encoded()) {
       // encoded image in datum.
-      src = cv::imdecode(
-          cv::Mat(
-              1,
-              datum.data().size(),
-              CV_8UC1,
-              const_cast<char*>(datum.data().data())),
-          color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE);
+      DecodeImage(datum.data().data(), datum.data().size(), info, decoded);
+      src = *decoded;
     } else {
       // Raw image in datum.
       CAFFE_ENFORCE(datum.channels() == 3 || datum.channels() == 1);
@@ -509,15 +661,9 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
       // encoded image string.
       DCHECK_EQ(image_proto.string_data_size(), 1);
       const string& encoded_image_str = image_proto.string_data(0);
-      int encoded_size = encoded_image_str.size();
-      // We use a cv::Mat to wrap the encoded str so we do not need a copy.
-      src = cv::imdecode(
-          cv::Mat(
-              1,
-              &encoded_size,
-              CV_8UC1,
-              const_cast<char*>(encoded_image_str.data())),
-          color_ ? CV_LOAD_IMAGE_COLOR : CV_LOAD_IMAGE_GRAYSCALE);
+      DecodeImage(
+          encoded_image_str.data(), encoded_image_str.size(), info, decoded);
+      src = *decoded;
     } else if (image_proto.data_type() == TensorProto::BYTE) {
       // raw image content.
       int src_c = (image_proto.dims_size() == 3) ? image_proto.dims(2) : 1;
@@ -675,7 +821,11 @@ bool ImageInputOp<Context>::GetImageAndLabelAndInfoFromDBValue(
     // LOG(INFO) << "No bounding\n";
   }
 
-  cv::Mat scaled_img;
+  if (!scale_image) {
+    return true;
+  }
+  cv::Mat local_scaled_img;
+  cv::Mat& scaled_img = buffers ? buffers->scaled : local_scaled_img;
   bool inception_scale_jitter = false;
   if (scale_jitter_type_ == INCEPTION_STYLE) {
     if (!is_test_) {
@@ -1030,7 +1180,7 @@ void ImageInputOp<Context>::DecodeAndTransform(
   // Decode the image
   PerImageArg info;
   CHECK(GetImageAndLabelAndInfoFromDBValue(value, &img, info, item_id,
-    randgen));
+    randgen, true, &decode_buffers_per_thread_[thread_index]));
 
   // Factor out the image transformation
   TransformImage<Context>(img, channels, image_data,
@@ -1054,13 +1204,141 @@ void ImageInputOp<Context>::DecodeAndTransposeOnly(
   // Decode the image
   PerImageArg info;
   CHECK(GetImageAndLabelAndInfoFromDBValue(value, &img, info, item_id,
-    randgen));
+    randgen, true, &decode_buffers_per_thread_[thread_index]));
 
   // Factor out the image transformation
   CropTransposeImage<Context>(img, channels, image_data, crop_, mirror_,
                               randgen, &mirror_this_image, is_test_);
 }
 
+// The region of img, decoded and bounded, that the scaling of
+// GetImageAndLabelAndInfoFromDBValue and the crop of TransformImage would
+// turn into the output image
+template <class Context>
+ImageResizeCrop ImageInputOp<Context>::GetResizeCrop(
+    const cv::Mat& img,
+    std::mt19937* randgen,
+    std::bernoulli_distribution* mirror_this_image) {
+  ImageResizeCrop region;
+  region.offset = 0;
+  region.height = img.rows;
+  region.width = img.cols;
+  cv::Rect ROI;
+  if (scale_jitter_type_ == INCEPTION_STYLE && !is_test_ &&
+      RandomSizedCroppingRegion<Context>(img.rows, img.cols, randgen, &ROI)) {
+    region.y = ROI.y;
+    region.x = ROI.x;
+    region.h = ROI.height;
+    region.w = ROI.width;
+  } else {
+    int scaled_width, scaled_height;
+    int scale_to_use = scale_ > 0 ? scale_ : minsize_;
+    if (random_scaling_) {
+      scale_to_use = std::uniform_int_distribution<>(random_scale_[0],
+                                                     random_scale_[1])(*randgen);
+    }
+    if (warp_) {
+      scaled_width = scale_to_use;
+      scaled_height = scale_to_use;
+    } else if (img.rows > img.cols) {
+      scaled_width = scale_to_use;
+      scaled_height = static_cast<float>(img.rows) * scale_to_use / img.cols;
+    } else {
+      scaled_height = scale_to_use;
+      scaled_width = static_cast<float>(img.cols) * scale_to_use / img.rows;
+    }
+    if (!((scale_ > 0 &&
+           (scaled_height != img.rows || scaled_width != img.cols)) ||
+          (scaled_height > img.rows || scaled_width > img.cols))) {
+      scaled_height = img.rows;
+      scaled_width = img.cols;
+    }
+    CAFFE_ENFORCE_GE(
+        scaled_height, crop_, "Image height must be bigger than crop.");
+    CAFFE_ENFORCE_GE(
+        scaled_width, crop_, "Image width must be bigger than crop.");
+
+    int width_offset, height_offset;
+    if (is_test_) {
+      width_offset = (scaled_width - crop_) / 2;
+      height_offset = (scaled_height - crop_) / 2;
+    } else {
+      width_offset =
+        std::uniform_int_distribution<>(0, scaled_width - crop_)(*randgen);
+      height_offset =
+        std::uniform_int_distribution<>(0, scaled_height - crop_)(*randgen);
+    }
+    // Source pixels per scaled pixel
+    const float ratio_y = static_cast<float>(img.rows) / scaled_height;
+    const float ratio_x = static_cast<float>(img.cols) / scaled_width;
+    region.y = height_offset * ratio_y;
+    region.x = width_offset * ratio_x;
+    region.h = crop_ * ratio_y;
+    region.w = crop_ * ratio_x;
+  }
+  region.mirror = !is_test_ && mirror_ && (*mirror_this_image)(*randgen);
+  return region;
+}
+
+// Parse datum and decode image, leaving the rest to the GPU
+template <class Context>
+void ImageInputOp<Context>::DecodeOnly(
+    const std::string& value, int item_id, std::size_t thread_index) {
+
+  CAFFE_ENFORCE((int)thread_index < num_decode_threads_);
+
+  std::bernoulli_distribution mirror_this_image(0.5f);
+  std::mt19937* randgen = &(randgen_per_thread_[thread_index]);
+
+  PerImageArg info;
+  CHECK(GetImageAndLabelAndInfoFromDBValue(value, &decoded_images_[item_id],
+    info, item_id, randgen, false));
+  resize_crops_[item_id] =
+      GetResizeCrop(decoded_images_[item_id], randgen, &mirror_this_image);
+}
+
+// Packs the decoded images one after the other in prefetched_image_, and
+// the regions to crop from them in prefetched_resize_crops_
+template <class Context>
+void ImageInputOp<Context>::PackDecodedImages(const int channels) {
+  int64_t nbytes = 0;
+  for (int item_id = 0; item_id < batch_size_; ++item_id) {
+    const cv::Mat& img = decoded_images_[item_id];
+    resize_crops_[item_id].offset = nbytes;
+    nbytes += static_cast<int64_t>(img.rows) * img.cols * channels;
+  }
+  prefetched_image_.Resize(nbytes);
+  uint8_t* image_data = prefetched_image_.mutable_data<uint8_t>();
+  for (int item_id = 0; item_id < batch_size_; ++item_id) {
+    // Bounded images are not continuous
+    const cv::Mat& img = decoded_images_[item_id];
+    const int row_size = img.cols * channels;
+    uint8_t* dst = image_data + resize_crops_[item_id].offset;
+    for (int h = 0; h < img.rows; ++h) {
+      memcpy(dst + h * row_size, img.ptr(h), row_size);
+    }
+  }
+  prefetched_resize_crops_.Resize(batch_size_ * sizeof(ImageResizeCrop));
+  memcpy(
+      prefetched_resize_crops_.mutable_data<uint8_t>(),
+      resize_crops_.data(),
+      batch_size_ * sizeof(ImageResizeCrop));
+}
+
+template <class Context>
+void ImageInputOp<Context>::CopyMeanStdToDevice() {
+  if (!mean_std_copied_) {
+    mean_gpu_.Resize(mean_.size());
+    std_gpu_.Resize(std_.size());
+
+    context_.template Copy<float, CPUContext, Context>(
+      mean_.size(), mean_.data(), mean_gpu_.template mutable_data<float>());
+    context_.template Copy<float, CPUContext, Context>(
+      std_.size(), std_.data(), std_gpu_.template mutable_data<float>());
+    mean_std_copied_ = true;
+  }
+}
+
 
 template <class Context>
 bool ImageInputOp<Context>::Prefetch() {
@@ -1075,6 +1353,10 @@ bool ImageInputOp<Context>::Prefetch() {
   if (gpu_transform_) {
     // we'll transfer up in int8, then convert later
     prefetched_image_.mutable_data<uint8_t>();
+  } else if (gpu_augment_) {
+    // the decoded images are packed once they are all decoded
+    decoded_images_.resize(batch_size_);
+    resize_crops_.resize(batch_size_);
   } else {
     prefetched_image_.mutable_data<float>();
   }
@@ -1082,12 +1364,10 @@ bool ImageInputOp<Context>::Prefetch() {
   prefetched_label_.mutable_data<int>();
   // Prefetching handled with a thread pool of "decode_threads" threads.
 
+  // read data
+  reader_->ReadBatch(batch_size_, nullptr, &prefetched_values_);
   for (int item_id = 0; item_id < batch_size_; ++item_id) {
-    std::string key, value;
-    cv::Mat img;
-
-    // read data
-    reader_->Read(&key, &value);
+    const std::string& value = prefetched_values_[item_id];
 
     // determine label type based on first item
     if( item_id == 0 ) {
@@ -1126,14 +1406,21 @@ bool ImageInputOp<Context>::Prefetch() {
 
     // launch into thread pool for processing
     // TODO: support color jitter and color lighting in gpu_transform
-    if (gpu_transform_) {
+    if (gpu_augment_) {
+      thread_pool_->runTaskWithID(std::bind(
+          &ImageInputOp<Context>::DecodeOnly,
+          this,
+          std::cref(value),
+          item_id,
+          std::placeholders::_1));
+    } else if (gpu_transform_) {
       // output of decode will still be int8
       uint8_t* image_data = prefetched_image_.mutable_data<uint8_t>() +
           crop_ * crop_ * channels * item_id;
       thread_pool_->runTaskWithID(std::bind(
           &ImageInputOp<Context>::DecodeAndTransposeOnly,
           this,
-          std::string(value),
+          std::cref(value),
           image_data,
           item_id,
           channels,
@@ -1144,7 +1431,7 @@ bool ImageInputOp<Context>::Prefetch() {
       thread_pool_->runTaskWithID(std::bind(
           &ImageInputOp<Context>::DecodeAndTransform,
           this,
-          std::string(value),
+          std::cref(value),
           image_data,
           item_id,
           channels,
@@ -1152,6 +1439,9 @@ bool ImageInputOp<Context>::Prefetch() {
     }
   }
   thread_pool_->waitWorkComplete();
+  if (gpu_augment_) {
+    PackDecodedImages(channels);
+  }
 
   // If the context is not CPUContext, we will need to do a copy in the
   // prefetch function as well.
@@ -1163,6 +1453,27 @@ bool ImageInputOp<Context>::Prefetch() {
       prefetched_additional_outputs_on_device_[i].CopyFrom(
           prefetched_additional_outputs_[i], &context_);
     }
+
+    if (gpu_augment_) {
+      // The prefetching thread has its own stream, so this overlaps with
+      // the computation of the net
+      prefetched_resize_crops_on_device_.CopyFrom(
+          prefetched_resize_crops_, &context_);
+      CopyMeanStdToDevice();
+      if (output_type_ == TensorProto_DataType_FLOAT) {
+        ResizeCropOnGPU<float, Context>(
+            prefetched_image_on_device_, prefetched_resize_crops_on_device_,
+            channels, crop_, mean_gpu_, std_gpu_,
+            &prefetched_augmented_image_on_device_, &context_);
+      } else if (output_type_ == TensorProto_DataType_FLOAT16) {
+        ResizeCropOnGPU<float16, Context>(
+            prefetched_image_on_device_, prefetched_resize_crops_on_device_,
+            channels, crop_, mean_gpu_, std_gpu_,
+            &prefetched_augmented_image_on_device_, &context_);
+      } else {
+        return false;
+      }
+    }
   }
   return true;
 }
@@ -1190,17 +1501,10 @@ bool ImageInputOp<Context>::CopyPrefetched() {
     }
   } else {
     // TODO: support color jitter and color lighting in gpu_transform
-    if (gpu_transform_) {
-      if (!mean_std_copied_) {
-        mean_gpu_.Resize(mean_.size());
-        std_gpu_.Resize(std_.size());
-
-        context_.template Copy<float, CPUContext, Context>(
-          mean_.size(), mean_.data(), mean_gpu_.template mutable_data<float>());
-        context_.template Copy<float, CPUContext, Context>(
-          std_.size(), std_.data(), std_gpu_.template mutable_data<float>());
-        mean_std_copied_ = true;
-      }
+    if (gpu_augment_) {
+      image_output->CopyFrom(prefetched_augmented_image_on_device_, &context_);
+    } else if (gpu_transform_) {
+      CopyMeanStdToDevice();
       // GPU transform kernel allows explicitly setting output type
       if (output_type_ == TensorProto_DataType_FLOAT) {
         TransformOnGPU<uint8_t,float,Context>(prefetched_image_on_device_,
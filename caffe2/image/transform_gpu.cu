@@ -46,6 +46,85 @@ __global__ void transform_kernel(
   }
 }
 
+
+// Weight of source pixel k for the output pixel covering [a0, a1) along an
+// axis: its coverage when shrinking, its linear interpolation weight at the
+// center otherwise
+__device__ inline float tap_weight(int k, float a0, float a1, bool area) {
+  if (area) {
+    return fmaxf(0.f, fminf(a1, k + 1.f) - fmaxf(a0, static_cast<float>(k)));
+  }
+  const float center = 0.5f * (a0 + a1) - 0.5f;
+  return fmaxf(0.f, 1.f - fabsf(center - k));
+}
+
+__device__ inline int first_tap(float a0, float a1, bool area) {
+  return area ? static_cast<int>(floorf(a0))
+              : static_cast<int>(floorf(0.5f * (a0 + a1) - 0.5f));
+}
+
+__device__ inline int last_tap(float a0, float a1, bool area) {
+  return area ? static_cast<int>(ceilf(a1)) - 1 : first_tap(a0, a1, area) + 1;
+}
+
+// input in (uint8, HWC, any size), output in (Out, NCHW, crop x crop)
+template <typename Out>
+__global__ void resize_crop_kernel(
+    const int C,
+    const int crop,
+    const ImageResizeCrop* crops,
+    const float* mean,
+    const float* std,
+    const uint8_t* in,
+    Out* out) {
+  const int n = blockIdx.y;
+  const ImageResizeCrop region = crops[n];
+  const uint8_t* image = in + region.offset;
+  const float ry = region.h / crop;
+  const float rx = region.w / crop;
+  const bool area_y = ry > 1.f;
+  const bool area_x = rx > 1.f;
+  Out* output_ptr = out + n * C * crop * crop;
+
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < crop * crop;
+       i += blockDim.x * gridDim.x) {
+    const int h = i / crop;
+    const int w = i % crop;
+    const int src_w = region.mirror ? crop - 1 - w : w;
+    const float y0 = region.y + h * ry;
+    const float y1 = y0 + ry;
+    const float x0 = region.x + src_w * rx;
+    const float x1 = x0 + rx;
+    float sum[3] = {0.f, 0.f, 0.f};
+    float total = 0.f;
+    const int ky_end = last_tap(y0, y1, area_y);
+    const int kx_end = last_tap(x0, x1, area_x);
+    for (int ky = first_tap(y0, y1, area_y); ky <= ky_end; ++ky) {
+      const float wy = tap_weight(ky, y0, y1, area_y);
+      if (wy == 0.f) {
+        continue;
+      }
+      const uint8_t* row = image +
+          min(max(ky, 0), region.height - 1) * region.width * C;
+      for (int kx = first_tap(x0, x1, area_x); kx <= kx_end; ++kx) {
+        const float weight = wy * tap_weight(kx, x0, x1, area_x);
+        if (weight == 0.f) {
+          continue;
+        }
+        const uint8_t* pixel = row + min(max(kx, 0), region.width - 1) * C;
+        for (int c = 0; c < C; ++c) {
+          sum[c] += weight * pixel[c];
+        }
+        total += weight;
+      }
+    }
+    for (int c = 0; c < C; ++c) {
+      output_ptr[c * crop * crop + i] =
+          convert::To<float, Out>((sum[c] / total - mean[c]) * std[c]);
+    }
+  }
+}
+
 }
 
 template <typename T_IN, typename T_OUT, class Context>
@@ -80,4 +159,52 @@ template bool TransformOnGPU<uint8_t, float16, CUDAContext>(Tensor<CUDAContext>&
                                                             Tensor<CUDAContext>& std,
                                                             CUDAContext *context);
 
+template <typename T_OUT, class Context>
+bool ResizeCropOnGPU(const Tensor<Context>& images,
+                     const Tensor<Context>& crops, const int channels,
+                     const int crop, const Tensor<Context>& mean,
+                     const Tensor<Context>& std, Tensor<Context>* Y,
+                     Context* context) {
+  CAFFE_ENFORCE_LE(channels, 3);
+  const int N = crops.nbytes() / sizeof(ImageResizeCrop);
+  Y->Resize(std::vector<int>{N, channels, crop, crop});
+  auto* output_data = Y->template mutable_data<T_OUT>();
+  if (N == 0) {
+    return true;
+  }
+  const int blocks_per_image = std::min(
+      CAFFE_GET_BLOCKS(crop * crop), CAFFE_MAXIMUM_NUM_BLOCKS / N + 1);
+  resize_crop_kernel<T_OUT>
+      <<<dim3(blocks_per_image, N), CAFFE_CUDA_NUM_THREADS, 0,
+         context->cuda_stream()>>>(
+          channels,
+          crop,
+          static_cast<const ImageResizeCrop*>(crops.raw_data()),
+          mean.template data<float>(),
+          std.template data<float>(),
+          images.template data<uint8_t>(),
+          output_data);
+  return true;
+}
+
+template bool ResizeCropOnGPU<float, CUDAContext>(
+    const Tensor<CUDAContext>& images,
+    const Tensor<CUDAContext>& crops,
+    const int channels,
+    const int crop,
+    const Tensor<CUDAContext>& mean,
+    const Tensor<CUDAContext>& std,
+    Tensor<CUDAContext>* Y,
+    CUDAContext* context);
+
+template bool ResizeCropOnGPU<float16, CUDAContext>(
+    const Tensor<CUDAContext>& images,
+    const Tensor<CUDAContext>& crops,
+    const int channels,
+    const int crop,
+    const Tensor<CUDAContext>& mean,
+    const Tensor<CUDAContext>& std,
+    Tensor<CUDAContext>* Y,
+    CUDAContext* context);
+
 }  // namespace caffe2
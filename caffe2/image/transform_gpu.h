@@ -35,6 +35,33 @@ bool TransformOnGPU(Tensor<Context>& X, Tensor<Context>* Y,
                     Tensor<Context>& mean, Tensor<Context>& std,
                     Context* context);
 
+// Region of a decoded image that ResizeCropOnGPU scales to an output image
+struct ImageResizeCrop {
+  // Byte offset of the image, stored in HWC order, in the batch
+  int64_t offset;
+  int height;
+  int width;
+  // Top left corner and size of the region, in source pixels
+  float y;
+  float x;
+  float h;
+  float w;
+  // Whether to flip the output image horizontally
+  int mirror;
+};
+
+// Scales regions of uint8 HWC images packed in images to crop x crop images,
+// averaging the source pixels they cover when shrinking and interpolating
+// linearly when growing, flips them, normalizes them with mean and std (the
+// inverse of the standard deviation) and writes them in NCHW order to Y.
+// crops holds the ImageResizeCrop of every output image.
+template <typename T_OUT, class Context>
+bool ResizeCropOnGPU(const Tensor<Context>& images,
+                     const Tensor<Context>& crops, const int channels,
+                     const int crop, const Tensor<Context>& mean,
+                     const Tensor<Context>& std, Tensor<Context>* Y,
+                     Context* context);
+
 }  // namespace caffe2
 
 #endif
@@ -128,6 +128,66 @@ TEST(MKLDNNTest, MKLMemoryCopyTest) {
   }
 }
 
+TEST(MKLDNNTest, PrimitiveCacheTest) {
+  const int cache_size = FLAGS_caffe2_mkl_primitive_cache_size;
+  FLAGS_caffe2_mkl_primitive_cache_size = 2;
+  PrimitiveCache<float>::Get().Clear();
+
+  size_t dimension = 4;
+  size_t bdata_sizes[4] = {32, 32, 8, 16};
+  size_t fdata_sizes[4] = {3, 3, 8, 64};
+  size_t strides[2] = {1, 1};
+  int pads[2] = {0, 0};
+  auto reset = [&](PrimitiveWrapper<float>* primitive, size_t batch) {
+    bdata_sizes[3] = batch;
+    size_t tdata_sizes[4] = {30, 30, 64, batch};
+    primitive->ResetCached(
+        PrimitiveCacheKey("Conv", batch),
+        dnnConvolutionCreateForwardBias<float>,
+        nullptr,
+        dnnAlgorithmConvolutionDirect,
+        dimension,
+        bdata_sizes,
+        tdata_sizes,
+        fdata_sizes,
+        strides,
+        pads,
+        dnnBorderZeros);
+  };
+
+  // Wrappers with the same key share the primitive and its layouts.
+  PrimitiveWrapper<float> a, b, c;
+  reset(&a, 16);
+  reset(&b, 16);
+  EXPECT_EQ(static_cast<dnnPrimitive_t>(a), static_cast<dnnPrimitive_t>(b));
+  LayoutWrapper<float> a_layout, b_layout;
+  a_layout.Reset(a, dnnResourceSrc);
+  b_layout.Reset(b, dnnResourceSrc);
+  EXPECT_EQ(
+      static_cast<dnnLayout_t>(a_layout), static_cast<dnnLayout_t>(b_layout));
+  EXPECT_EQ(PrimitiveCache<float>::Get().hits(), 1);
+  EXPECT_EQ(PrimitiveCache<float>::Get().misses(), 1);
+
+  reset(&c, 8);
+  EXPECT_NE(static_cast<dnnPrimitive_t>(a), static_cast<dnnPrimitive_t>(c));
+  EXPECT_EQ(PrimitiveCache<float>::Get().size(), 2);
+
+  // The least recently used primitive is evicted, but stays alive for as
+  // long as it is used.
+  reset(&b, 16);
+  reset(&c, 4);
+  EXPECT_EQ(PrimitiveCache<float>::Get().size(), 2);
+  reset(&c, 8);
+  EXPECT_EQ(PrimitiveCache<float>::Get().misses(), 4);
+  EXPECT_TRUE(static_cast<dnnLayout_t>(a_layout) != nullptr);
+  reset(&b, 16);
+  EXPECT_EQ(PrimitiveCache<float>::Get().misses(), 5);
+  EXPECT_NE(static_cast<dnnPrimitive_t>(a), static_cast<dnnPrimitive_t>(b));
+
+  PrimitiveCache<float>::Get().Clear();
+  FLAGS_caffe2_mkl_primitive_cache_size = cache_size;
+}
+
 } // namespace mkl
 } // namespace caffe2
 
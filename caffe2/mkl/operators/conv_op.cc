@@ -84,8 +84,18 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
       size_t strides[2] = {stride_w(), stride_h()};
       int pads[2] = {-pad_l(), -pad_t()};
 
+      const string key = PrimitiveCacheKey(
+          "Conv",
+          X.dims(),
+          filter.dims(),
+          group_,
+          stride_h(),
+          stride_w(),
+          pad_t(),
+          pad_l());
       if (group_ > 1) {
-        primitive_.Reset(
+        primitive_.ResetCached(
+            key,
             dnnGroupsConvolutionCreateForwardBias<float>,
             nullptr,
             dnnAlgorithmConvolutionDirect,
@@ -98,7 +108,8 @@ class MKLConvOp final : public ConvPoolOpBase<MKLContext> {
             pads,
             dnnBorderZeros);
       } else {
-        primitive_.Reset(
+        primitive_.ResetCached(
+            key,
             dnnConvolutionCreateForwardBias<float>,
             nullptr,
             dnnAlgorithmConvolutionDirect,
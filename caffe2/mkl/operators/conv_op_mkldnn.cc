@@ -1,7 +1,10 @@
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/mkl/mkl_utils.h"
 #include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/utils/math.h"
 
 #ifdef CAFFE2_HAS_MKL_DNN
 
@@ -13,7 +16,9 @@ class ConvMKLDNNOp final : public ConvPoolOpBase<CPUContext> {
  public:
   USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
   ConvMKLDNNOp(const OperatorDef& operator_def, Workspace* ws)
-      : ConvPoolOpBase<CPUContext>(operator_def, ws) {
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        batch_size_buckets_(OperatorBase::GetRepeatedArgument<TIndex>(
+            "batch_size_buckets")) {
     OPERATOR_NEEDS_FEATURE(
         dilation_h() == 1 && dilation_w() == 1, "Dilation not supported.");
     OPERATOR_NEEDS_FEATURE(
@@ -21,15 +26,41 @@ class ConvMKLDNNOp final : public ConvPoolOpBase<CPUContext> {
         "Uneven padding not supported.");
     OPERATOR_NEEDS_FEATURE(
         order_ == StorageOrder::NCHW, "Only NCHW order supported.");
+    CAFFE_ENFORCE(
+        std::is_sorted(batch_size_buckets_.begin(), batch_size_buckets_.end()),
+        "batch_size_buckets must be sorted.");
   }
   ~ConvMKLDNNOp() {}
 
   bool RunOnDeviceWithOrderNCHW() override {
-    auto& X = Input(INPUT);
+    auto& input = Input(INPUT);
     auto& filter = Input(FILTER);
     auto& bias = Input(BIAS);
-    TensorCPU* Y = Output(0);
-    CAFFE_ENFORCE(4 == X.ndim());
+    TensorCPU* output = Output(0);
+    CAFFE_ENFORCE(4 == input.ndim());
+
+    // Pad the batch to its bucket, so that the primitives of a few batch
+    // sizes serve all of them.
+    const TIndex batch = input.dim(0);
+    const auto bucket = std::lower_bound(
+        batch_size_buckets_.begin(), batch_size_buckets_.end(), batch);
+    const bool padded = bucket != batch_size_buckets_.end() && *bucket > batch;
+    if (padded) {
+      auto dims = input.dims();
+      dims[0] = *bucket;
+      padded_input_.Resize(dims);
+      T* padded_data = padded_input_.mutable_data<T>();
+      context_.template CopyItems<CPUContext, CPUContext>(
+          input.meta(), input.size(), input.template data<T>(), padded_data);
+      math::Set<T, CPUContext>(
+          padded_input_.size() - input.size(),
+          0,
+          padded_data + input.size(),
+          &context_);
+    }
+    const TensorCPU& X = padded ? padded_input_ : input;
+    TensorCPU* Y = padded ? &padded_output_ : output;
+
     const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
     CAFFE_ENFORCE(4 == filter.ndim());
     const int M = filter.dim32(0);
@@ -61,7 +92,16 @@ class ConvMKLDNNOp final : public ConvPoolOpBase<CPUContext> {
       size_t strides[2] = {stride_w(), stride_h()};
       int pads[2] = {-pad_l(), -pad_t()};
 
-      primitive_.Reset(
+      primitive_.ResetCached(
+          PrimitiveCacheKey(
+              "Conv",
+              X.dims(),
+              filter.dims(),
+              group_,
+              stride_h(),
+              stride_w(),
+              pad_t(),
+              pad_l()),
           dnnConvolutionCreateForwardBias<float>,
           nullptr,
           dnnAlgorithmConvolutionDirect,
@@ -96,6 +136,16 @@ class ConvMKLDNNOp final : public ConvPoolOpBase<CPUContext> {
     }
     MKLDNN_SAFE_CALL(dnnExecute<float>(primitive_, resources_));
     Y_wrapper_->CopyTo(Y);
+    if (padded) {
+      auto dims = Y->dims();
+      dims[0] = batch;
+      output->Resize(dims);
+      context_.template CopyItems<CPUContext, CPUContext>(
+          Y->meta(),
+          output->size(),
+          Y->template data<T>(),
+          output->template mutable_data<T>());
+    }
     return true;
   }
 
@@ -108,6 +158,10 @@ class ConvMKLDNNOp final : public ConvPoolOpBase<CPUContext> {
   // Output: Y
   vector<TIndex> cached_input_dims_;
   vector<TIndex> cached_filter_dims_;
+  // Sorted batch sizes the batch is padded to, larger batches are not padded
+  vector<TIndex> batch_size_buckets_;
+  TensorCPU padded_input_;
+  TensorCPU padded_output_;
   PrimitiveWrapper<T> primitive_;
   unique_ptr<MKLMemory<T>> X_wrapper_ = nullptr;
   unique_ptr<MKLMemory<T>> filter_wrapper_ = nullptr;
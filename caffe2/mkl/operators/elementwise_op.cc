@@ -0,0 +1,65 @@
+#include "caffe2/mkl/mkl_utils.h"
+#include "caffe2/utils/math.h"
+
+#ifdef CAFFE2_HAS_MKL_DNN
+
+namespace caffe2 {
+namespace mkl {
+
+/**
+ * @brief Runs a CPU functor computing every element on its own, like
+ * sigmoid, directly on the buffer of an MKLMemory.
+ *
+ * As the result doesn't depend on where the elements are, the input is not
+ * converted to the plain layout as by MKLFallbackOp, and the output keeps the
+ * layout of the input, internal or not. Padding elements of internal layouts
+ * get computed too and stay meaningless.
+ */
+template <typename T, class Functor>
+class MKLUnaryElementwiseOp final : public MKLOperator<T> {
+ public:
+  USE_MKLOPERATOR_FUNCTIONS(T);
+  USE_SIMPLE_MKL_CTOR_DTOR(MKLUnaryElementwiseOp, T);
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    auto* Y = Output(0);
+    if (&X != Y &&
+        (Y->dims() != X.dims() || Y->size() <= 0 ||
+         !dnnLayoutCompare<T>(X.layout(), Y->layout()))) {
+      Y->ResetLike(X);
+    }
+    if (X.size() == 0) {
+      return true;
+    }
+    functor_(
+        dnnLayoutGetMemorySize<T>(X.layout()) / sizeof(T),
+        static_cast<const T*>(X.buffer()),
+        static_cast<T*>(Y->buffer()),
+        &cpu_context_);
+    return true;
+  }
+
+ private:
+  Functor functor_;
+  CPUContext cpu_context_;
+};
+
+struct SigmoidCPUFunctor {
+  template <typename T>
+  inline void
+  operator()(const int n, const T* x, T* y, CPUContext* /*device_context*/) {
+    ConstEigenVectorArrayMap<T> xM(x, n);
+    EigenVectorArrayMap<T>(y, n) = 1. / (1. + (-xM).exp());
+  }
+};
+
+} // namespace mkl
+
+REGISTER_MKL_OPERATOR(
+    Sigmoid,
+    mkl::MKLUnaryElementwiseOp<float, mkl::SigmoidCPUFunctor>);
+
+} // namespace caffe2
+
+#endif // CAFFE2_HAS_MKL_DNN
@@ -48,7 +48,8 @@ class MKLFullyConnectedOp final : public MKLOperator<T> {
 
       size_t outputSizes[2] = {Y_shape[1], Y_shape[0]};
 
-      primitive_.Reset(
+      primitive_.ResetCached(
+          PrimitiveCacheKey("FC", X.dims(), N),
           dnnInnerProductCreateForwardBias<float>,
           nullptr,
           X.ndim(),
@@ -5,7 +5,6 @@
 #include "caffe2/operators/cross_entropy_op.h"
 #include "caffe2/operators/dropout_op.h"
 #include "caffe2/operators/elementwise_linear_op.h"
-#include "caffe2/operators/elementwise_op.h"
 #include "caffe2/operators/filler_op.h"
 #include "caffe2/operators/load_save_op.h"
 #include "caffe2/operators/loss_op.h"
@@ -13,19 +12,6 @@
 #include "caffe2/operators/softmax_op.h"
 #include "caffe2/operators/utility_ops.h"
 
-namespace caffe2 {
-namespace {
-struct SigmoidCPUFunctor {
-  template <typename T>
-  inline void
-  operator()(const int n, const T* x, T* y, CPUContext* /*device_context*/) {
-    ConstEigenVectorArrayMap<T> xM(x, n);
-    EigenVectorArrayMap<T>(y, n) = 1. / (1. + (-xM).exp());
-  }
-};
-} // namespace
-} // namespace caffe2
-
 // can add more non-MKL operators if needed
 namespace caffe2 {
 REGISTER_MKL_OPERATOR(
@@ -57,10 +43,6 @@ REGISTER_MKL_OPERATOR(
 REGISTER_MKL_OPERATOR(Load, mkl::MKLFallbackOp<LoadOp<CPUContext>>);
 REGISTER_MKL_OPERATOR(Save, mkl::MKLFallbackOp<SaveOp<CPUContext>>);
 
-REGISTER_MKL_OPERATOR(
-    Sigmoid,
-    mkl::MKLFallbackOp<
-        UnaryElementwiseOp<TensorTypes<float>, CPUContext, SigmoidCPUFunctor>>);
 REGISTER_MKL_OPERATOR(
     Dropout,
     mkl::MKLFallbackOp<DropoutOp<float, CPUContext>, SkipIndices<1>>);
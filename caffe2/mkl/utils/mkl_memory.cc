@@ -13,6 +13,14 @@ CAFFE2_DEFINE_bool(
     "original storage is not affected."
     );
 
+CAFFE2_DEFINE_int(
+    caffe2_mkl_primitive_cache_size, 0,
+    "Maximum number of MKL primitives kept by the process-wide primitive "
+    "cache, least recently used ones being evicted. Operators then share "
+    "primitives with the same shapes and parameters instead of creating "
+    "their own whenever their input dims change. 0 disables the cache."
+    );
+
 namespace caffe2 {
 
 CAFFE_KNOWN_TYPE(mkl::MKLMemory<float>);
@@ -8,6 +8,7 @@
 #include "caffe2/core/flags.h" // for TIndex
 #include "caffe2/core/tensor.h" // for TIndex
 #include "caffe2/mkl/utils/mkl_dnn_cppwrapper.h"
+#include "caffe2/mkl/utils/mkl_primitive_cache.h"
 
 // A global boolean variable that controls the behavior when we call View() on
 // an MKLMemory: if it is set true, then the View() function will actually
@@ -39,25 +40,43 @@ class PrimitiveWrapper {
 
   template <typename Creator, typename... Args>
   void Reset(Creator creator, Args&&... args) {
-    if (primitive_) {
-      MKLDNN_SAFE_CALL(dnnDelete<T>(primitive_));
-    }
+    Reset();
     creator(&primitive_, args...);
   }
 
+  // Shares the primitive created with the given key from the process-wide
+  // primitive cache, creating it on a miss. Falls back to Reset() when the
+  // cache is disabled.
+  template <typename Creator, typename... Args>
+  void ResetCached(const std::string& key, Creator creator, Args&&... args) {
+    if (FLAGS_caffe2_mkl_primitive_cache_size <= 0) {
+      Reset(creator, args...);
+      return;
+    }
+    Reset();
+    shared_ = PrimitiveCache<T>::Get().GetOrCreate(key, creator, args...);
+  }
+
   void Reset() {
     if (primitive_) {
       MKLDNN_SAFE_CALL(dnnDelete<T>(primitive_));
       primitive_ = nullptr;
     }
+    shared_.reset();
   }
 
   operator dnnPrimitive_t() const {
-    return primitive_;
+    return shared_ ? shared_->get() : primitive_;
+  }
+
+  // The cached primitive, if the wrapper was reset from the cache.
+  const std::shared_ptr<SharedPrimitive<T>>& shared() const {
+    return shared_;
   }
 
  private:
   dnnPrimitive_t primitive_ = 0;
+  std::shared_ptr<SharedPrimitive<T>> shared_;
   DISABLE_COPY_AND_ASSIGN(PrimitiveWrapper);
 };
 
@@ -85,14 +104,12 @@ class LayoutWrapper {
 
   // Destructs the layout wrapper.
   ~LayoutWrapper() {
-    if (layout_)
-      MKLDNN_CHECK(dnnLayoutDelete<T>(layout_));
+    Reset();
   }
 
   // Create a user layout from a TensorCPU with the given shapes.
   void Reset(const TensorCPU& tensor) {
-    if (layout_)
-      MKLDNN_CHECK(dnnLayoutDelete<T>(layout_));
+    Reset();
     CAFFE_ENFORCE(tensor.size(), "Cannot reset with an empty tensor.");
     size_t dimension = tensor.ndim();
     size_t size[dimension];
@@ -102,6 +119,7 @@ class LayoutWrapper {
       strides[i] = (i == 0) ? 1 : strides[i - 1] * size[i - 1];
     }
     MKLDNN_SAFE_CALL(dnnLayoutCreate<T>(&layout_, dimension, size, strides));
+    Own();
   }
 
   // Create an internal layout from the primitive and type.
@@ -110,34 +128,63 @@ class LayoutWrapper {
     CAFFE_ENFORCE(
         type != dnnResourceNumber,
         "Cannot reset with an unknown resource number.");
-    if (layout_) {
-      MKLDNN_CHECK(dnnLayoutDelete<T>(layout_));
-    }
+    Reset();
     MKLDNN_SAFE_CALL(
         dnnLayoutCreateFromPrimitive<T>(&layout_, primitive, type));
+    Own();
+  }
+
+  // Create an internal layout from the wrapped primitive and type. The
+  // layouts of cached primitives are shared rather than created again.
+  void Reset(
+      const PrimitiveWrapper<T>& primitive,
+      const dnnResourceType_t type) {
+    if (!primitive.shared()) {
+      Reset(static_cast<dnnPrimitive_t>(primitive), type);
+      return;
+    }
+    Reset();
+    layout_ = primitive.shared()->layout(type);
+    owner_ = primitive.shared();
   }
 
   // Create a user layout from the given dimension, size and strides.
   void
   Reset(const size_t dimension, const size_t size[], const size_t strides[]) {
-    if (layout_)
-      MKLDNN_CHECK(dnnLayoutDelete<T>(layout_));
+    Reset();
     MKLDNN_SAFE_CALL(dnnLayoutCreate<T>(&layout_, dimension, size, strides));
+    Own();
   }
 
-  void Reset() {
-    if (layout_) {
-      MKLDNN_CHECK(dnnLayoutDelete<T>(layout_));
-      layout_ = nullptr;
+  // Share the layout, possibly internal, of another wrapper.
+  void Reset(const LayoutWrapper<T>& other) {
+    if (&other != this) {
+      Reset();
+      layout_ = other.layout_;
+      owner_ = other.owner_;
     }
   }
 
+  void Reset() {
+    layout_ = nullptr;
+    owner_.reset();
+  }
+
   operator dnnLayout_t() const {
     return layout_;
   }
 
  private:
+  void Own() {
+    owner_.reset(layout_, [](dnnLayout_t layout) {
+      MKLDNN_CHECK(dnnLayoutDelete<T>(layout));
+    });
+  }
+
   dnnLayout_t layout_ = 0;
+  // Deletes layout_ once no wrapper shares it, or keeps alive the cached
+  // primitive it is the layout of
+  std::shared_ptr<void> owner_;
   DISABLE_COPY_AND_ASSIGN(LayoutWrapper);
 };
 
@@ -249,6 +296,21 @@ class MKLMemory {
     }
   }
 
+  // Initialize an MKLMemory with the dims and the layout, possibly internal,
+  // of another one, without copying its content.
+  void ResetLike(const MKLMemory<T>& other) {
+    buffer_.reset();
+    dims_ = other.dims_;
+    size_ = other.size_;
+    user_layout_.Reset(other.user_layout_);
+    layout_.Reset(other.layout_);
+    convert_in_.Reset(dnnConversionCreate<T>, user_layout_, layout_);
+    convert_out_.Reset(dnnConversionCreate<T>, layout_, user_layout_);
+    share_mem_if_possible_ = false;
+    layout_is_user_layout_ = other.layout_is_user_layout_;
+    buffer();
+  }
+
   void Reset() {
     buffer_.reset();
     dims_.clear();
@@ -0,0 +1,191 @@
+// Do not directly include this file. Include caffe2/mkl/mkl_utils.h instead.
+#ifndef CAFFE2_UTILS_MKL_MKL_PRIMITIVE_CACHE_H_
+#define CAFFE2_UTILS_MKL_MKL_PRIMITIVE_CACHE_H_
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/tensor.h" // for TIndex
+#include "caffe2/mkl/utils/mkl_dnn_cppwrapper.h"
+
+// Maximum number of primitives kept by the process-wide primitive cache. 0
+// disables the cache, every operator then creating its own primitives.
+CAFFE2_DECLARE_int(caffe2_mkl_primitive_cache_size);
+
+namespace caffe2 {
+namespace mkl {
+
+/**
+ * @brief A primitive owned by the process-wide primitive cache, together with
+ * the internal layouts of its resources, created on first use.
+ *
+ * The primitive is shared by all the operators that need a primitive with
+ * the same key, and only executed by them, which MKL allows concurrently.
+ */
+template <typename T>
+class SharedPrimitive {
+ public:
+  explicit SharedPrimitive(dnnPrimitive_t primitive) : primitive_(primitive) {}
+
+  ~SharedPrimitive() {
+    for (auto layout : layouts_) {
+      if (layout) {
+        MKLDNN_CHECK(dnnLayoutDelete<T>(layout));
+      }
+    }
+    if (primitive_) {
+      MKLDNN_CHECK(dnnDelete<T>(primitive_));
+    }
+  }
+
+  dnnPrimitive_t get() const {
+    return primitive_;
+  }
+
+  // The internal layout of the resource of the given type.
+  dnnLayout_t layout(const dnnResourceType_t type) {
+    CAFFE_ENFORCE(
+        type != dnnResourceNumber,
+        "Cannot get the layout of an unknown resource number.");
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!layouts_[type]) {
+      MKLDNN_SAFE_CALL(
+          dnnLayoutCreateFromPrimitive<T>(&layouts_[type], primitive_, type));
+    }
+    return layouts_[type];
+  }
+
+ private:
+  dnnPrimitive_t primitive_ = 0;
+  std::mutex mutex_;
+  dnnLayout_t layouts_[dnnResourceNumber] = {0};
+  DISABLE_COPY_AND_ASSIGN(SharedPrimitive);
+};
+
+/**
+ * @brief The process-wide cache of primitives, keyed by a string describing
+ * the operator type, shapes and parameters they were created with, with
+ * least recently used eviction.
+ *
+ * With variable input shapes, such as the batch sizes of a server, operators
+ * get their primitives back from the cache instead of creating them again
+ * every time their input dims change. Evicted primitives stay alive for as
+ * long as operators still use them.
+ */
+template <typename T>
+class PrimitiveCache {
+ public:
+  static PrimitiveCache& Get() {
+    static PrimitiveCache cache;
+    return cache;
+  }
+
+  template <typename Creator, typename... Args>
+  std::shared_ptr<SharedPrimitive<T>>
+  GetOrCreate(const std::string& key, Creator creator, Args&&... args) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      auto it = index_.find(key);
+      if (it != index_.end()) {
+        ++hits_;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+      }
+      ++misses_;
+    }
+    // Creating the primitive is the expensive part, keep it out of the lock.
+    dnnPrimitive_t primitive = nullptr;
+    MKLDNN_SAFE_CALL(creator(&primitive, args...));
+    auto entry = std::make_shared<SharedPrimitive<T>>(primitive);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      // Another operator created the same primitive in the meantime.
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second->second;
+    }
+    lru_.emplace_front(key, entry);
+    index_[key] = lru_.begin();
+    const size_t capacity =
+        std::max(FLAGS_caffe2_mkl_primitive_cache_size, 1);
+    while (lru_.size() > capacity) {
+      index_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+    return entry;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return lru_.size();
+  }
+
+  int64_t hits() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return hits_;
+  }
+
+  int64_t misses() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return misses_;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    index_.clear();
+    lru_.clear();
+    hits_ = 0;
+    misses_ = 0;
+  }
+
+ private:
+  using Entry = std::pair<std::string, std::shared_ptr<SharedPrimitive<T>>>;
+
+  PrimitiveCache() {}
+
+  mutable std::mutex mutex_;
+  // Most recently used first
+  std::list<Entry> lru_;
+  std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+  int64_t hits_ = 0;
+  int64_t misses_ = 0;
+  DISABLE_COPY_AND_ASSIGN(PrimitiveCache);
+};
+
+inline void AppendPrimitiveCacheKey(
+    std::ostringstream* key,
+    const std::vector<TIndex>& dims) {
+  for (const auto d : dims) {
+    *key << d << ',';
+  }
+  *key << ';';
+}
+
+template <typename Arg>
+inline void AppendPrimitiveCacheKey(std::ostringstream* key, const Arg& arg) {
+  *key << arg << ';';
+}
+
+// Builds the cache key of a primitive from the operator type followed by the
+// dims and the parameters it is created with.
+template <typename... Args>
+std::string PrimitiveCacheKey(const Args&... args) {
+  std::ostringstream key;
+  int unused[] = {0, (AppendPrimitiveCacheKey(&key, args), 0)...};
+  (void)unused;
+  return key.str();
+}
+
+} // namespace mkl
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_MKL_MKL_PRIMITIVE_CACHE_H_
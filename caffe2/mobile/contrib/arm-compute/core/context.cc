@@ -13,6 +13,7 @@ CAFFE_KNOWN_TYPE(GLTensor<half>);
 CAFFE_KNOWN_TYPE(Tensor<GLContext>);
 
 bool GLContext::initialized = false;
+bool GLContext::finish_ops = false;
 
 GLContext::GLContext() {
   CAFFE_ENFORCE(arm_compute::opengles31_is_available());
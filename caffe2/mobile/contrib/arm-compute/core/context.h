@@ -45,6 +45,15 @@ public:
 
   static void sync() { arm_compute::GCScheduler::get().memory_barrier(); }
 
+  // Waits for the GPU to run all the commands enqueued so far
+  static void finish() { glFinish(); }
+
+  // The operators only enqueue their work on the GPU, and the tensors stay
+  // there until they are copied back to the CPU. While finish_ops is set,
+  // every operator waits for the GPU at its end, so that its observers time
+  // its GPU work.
+  static bool finish_ops;
+
   template <typename T>
   using deleted_unique_ptr = std::unique_ptr<T, std::function<void(T *)>>;
 
@@ -102,7 +111,10 @@ public:
 
   inline void WaitEvent(const Event &ev) { /* TODO */
   }
-  void FinishDeviceComputation() { /* TODO */
+  void FinishDeviceComputation() {
+    if (finish_ops) {
+      finish();
+    }
   }
   inline void Record(Event *ev, const char *&) const { /* TODO */
   }
@@ -27,7 +27,6 @@ GLNet::GLNet(
     const auto& operator_def = net_def->op(idx);
     VLOG(1) << "Creating operator " << operator_def.name() << ": "
             << operator_def.type();
-    output_blobs_.push_back(operator_def.output(0));
     if (operator_def.has_device_option() && operator_def.device_option().device_type() == OPENGL) {
       opengl_device_.push_back(true);
     } else {
@@ -51,7 +50,7 @@ GLNet::GLNet(
   }
 }
 
-bool GLNet::Run() {
+bool GLNet::DoRun() {
   StartAllObservers();
   if (first_run_) {
     first_run_ = false;
@@ -62,13 +61,22 @@ bool GLNet::Run() {
     }
   }
   VLOG(1) << "Running net " << name_;
+  // The operators are enqueued on the GPU without waiting for it, the
+  // tensors are only synced when copied back to the CPU. Observed operators
+  // and nets wait for it, so that they are timed with their GPU work.
   for (auto& op : operators_) {
+    GLContext::finish_ops = op->NumObservers() > 0;
     bool res = op->Run();
     if (!res) {
+      GLContext::finish_ops = false;
       LOG(ERROR) << "Operator failed: " << ProtoDebugString(op->debug_def());
       return false;
     }
   }
+  GLContext::finish_ops = false;
+  if (NumObservers() > 0) {
+    GLContext::finish();
+  }
   StopAllObservers();
   return true;
 }
@@ -99,11 +107,8 @@ vector<float> GLNet::TEST_Benchmark(
     CAFFE_ENFORCE(Run(), "Warmup run ", i, " has failed.");
   }
 
-  auto last_blob = output_blobs_[output_blobs_.size() - 1];
-  Blob *gpu_out_blob = ws_->GetBlob(last_blob);
-  auto &g_ = gpu_out_blob->Get<GLTensor<half>>();
   // Enforce gpu execution
-  g_.sync();
+  GLContext::finish();
 
   std::cout << "Main runs." << std::endl;
   CAFFE_ENFORCE(
@@ -115,7 +120,7 @@ vector<float> GLNet::TEST_Benchmark(
   for (int i = 0; i < main_runs; ++i) {
     CAFFE_ENFORCE(Run(), "Main run ", i, " has failed.");
   }
-  g_.sync();
+  GLContext::finish();
 
   auto millis = timer.MilliSeconds();
   std::cout << "[C2DEBUG] Main run finished. Milliseconds per iter: "
@@ -150,9 +155,7 @@ vector<float> GLNet::TEST_Benchmark(
             op_type,
             ") has failed.");
         if (opengl_device_[idx]) {
-          Blob *gpu_out_blob = ws_->GetBlob(output_blobs_[idx]);
-          auto &g_ = gpu_out_blob->Get<GLTensor<half>>();
-          g_.sync();
+          GLContext::finish();
         }
         float spent = timer.MilliSeconds();
         time_per_op[idx] += spent;
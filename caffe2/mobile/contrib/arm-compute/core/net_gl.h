@@ -19,8 +19,6 @@ class GLNet : public NetBase {
  private:
   bool first_run_ = true;
   Workspace* ws_;
-  // record output blob for sync step in operator level benchmarking
-  std::vector<string> output_blobs_;
   // record operator type and only sync after gpu op
   std::vector<bool> opengl_device_;
  public:
@@ -49,7 +47,7 @@ class GLNet : public NetBase {
   }
 
  protected:
-  bool Run();
+  bool DoRun() override;
   bool RunAsync();
   bool DoRunAsync() override {
     return Run();
@@ -50,6 +50,16 @@ static void insertCopyFromGLOp(NetDef& predictNet, const std::string& cpu_blob)
   op->add_output(cpu_blob);
 }
 
+// Uploads a CPU blob for all the OpenGL operators reading it, the weights
+// that are not written by the net are uploaded once by their operators
+static void insertCopyToGLOp(NetDef& predictNet, const std::string& cpu_blob) {
+  auto* op = predictNet.add_op();
+  op->set_name("CopyToGL");
+  op->set_type("CopyToGL");
+  op->add_input(cpu_blob);
+  op->add_output(cpu_blob + "_G");
+}
+
 static NetDef insertInputOutputCopyOps(const NetDef& def, std::unordered_set<std::string>& cpuOp) {
   // Do some validation of the outputs. For this version, we require:
   // - a single input (first element of external_input()) is consumed by the NetDef
@@ -78,7 +88,8 @@ static NetDef insertInputOutputCopyOps(const NetDef& def, std::unordered_set<std
   mdef.CopyFrom(def);
   mdef.clear_op();
 
-  std::unordered_map<std::string, std::set<size_t>> cpu_blobs, gpu_blobs;
+  std::unordered_map<std::string, std::set<size_t>> cpu_blobs, gpu_blobs,
+      uploaded_blobs;
   cpu_blobs[def.external_input(0)].insert(0);
 
   for (auto i = 0; i < def.op_size(); i++) {
@@ -102,6 +113,16 @@ static NetDef insertInputOutputCopyOps(const NetDef& def, std::unordered_set<std
       }
     } else {
       // OpenGL Op
+      // insert CopyToGL for the inputs coming from the CPU, so that the
+      // tensors stay on the GPU for the rest of the net
+      for (auto j = 0; j < currentOp.input_size(); j++) {
+        auto& input = currentOp.input(j);
+        auto version = analysis.ssa[i].inVersions[input];
+        if (cpu_blobs[input].count(version) > 0 &&
+            uploaded_blobs[input].insert(version).second) {
+          insertCopyToGLOp(mdef, input);
+        }
+      }
       auto* op = mdef.add_op();
       op->CopyFrom(currentOp);
 
@@ -110,6 +131,8 @@ static NetDef insertInputOutputCopyOps(const NetDef& def, std::unordered_set<std
         auto version = analysis.ssa[i].inVersions[*input];
         if (gpu_blobs[*input].count(version) > 0) {
           *input = *input + "_M";
+        } else if (cpu_blobs[*input].count(version) > 0) {
+          *input = *input + "_G";
         }
       }
 
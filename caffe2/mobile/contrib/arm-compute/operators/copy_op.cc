@@ -69,4 +69,38 @@ bool CopyFromGLOp<T>::RunOnDevice() {
 
 REGISTER_GL_OPERATOR(CopyFromGL, CopyFromGLOp<DataType>);
 
+// Uploads a CPU tensor to a GLTensor once per run, that all the operators
+// reading it use instead of converting it on their own
+template <typename T> class CopyToGLOp final : public Operator<GLContext> {
+public:
+  CopyToGLOp(const OperatorDef &operator_def, Workspace *ws)
+      : Operator<GLContext>(operator_def, ws) {}
+  virtual ~CopyToGLOp() noexcept {}
+  USE_OPERATOR_FUNCTIONS(GLContext);
+  bool RunOnDevice() override;
+private:
+  bool first_run_ = true, second_run_ = true;
+};
+
+template <typename T>
+bool CopyToGLOp<T>::RunOnDevice() {
+  auto *Xblob = OperatorBase::Inputs()[0];
+  CAFFE_ENFORCE(Xblob->IsType<TensorCPU>(), "CopyToGL takes a CPU tensor");
+  GLTensor<T> *Y =
+      OperatorBase::Outputs()[0]->template GetMutable<GLTensor<T>>();
+  if (first_run_) {
+    first_run_ = false;
+    Y->ResizeLike(Xblob->Get<TensorCPU>());
+  } else {
+    if (second_run_) {
+      second_run_ = false;
+      Y->allocate();
+    }
+    Y->fillGLTensor(Xblob);
+  }
+  return true;
+}
+
+REGISTER_GL_OPERATOR(CopyToGL, CopyToGLOp<DataType>);
+
 } // namespace caffe2
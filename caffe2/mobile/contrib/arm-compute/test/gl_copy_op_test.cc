@@ -37,4 +37,37 @@ TEST(OPENGLOperatorTest, CopyFromGL) {
   }
 }
 
+TEST(OPENGLOperatorTest, CopyToGL) {
+
+  for (auto dims: std::vector<std::vector<int>>{
+      {1, 2, 3},
+      {4, 9, 8, 13},
+    }) {
+    Workspace ws;
+    PopulateCPUBlob(&ws, true, std::string("cpu_X"), dims);
+
+    NetDef gpu_net;
+    gpu_net.set_type("opengl");
+    {
+      OperatorDef* def = AddOp(&gpu_net, "CopyToGL", {"cpu_X"}, {"gpu_X"});
+      MAKE_OPENGL_OPERATOR(def);
+    }
+    {
+      OperatorDef* def = AddOp(&gpu_net, "CopyFromGL", {"gpu_X"}, {"cpu_X2"});
+      MAKE_OPENGL_OPERATOR(def);
+    }
+    ws.RunNetOnce(gpu_net);
+    EXPECT_TRUE(ws.GetBlob("gpu_X")->IsType<GLTensor<half>>());
+
+    auto &t1 = ws.GetBlob("cpu_X")->Get<TensorCPU>();
+    auto &t2 = ws.GetBlob("cpu_X2")->Get<TensorCPU>();
+    ASSERT_EQ(t1.dims(), t2.dims());
+    double tol=0.01;
+    for (auto i = 0; i < t1.size(); ++i) {
+      EXPECT_NEAR(t1.data<float>()[i], t2.data<float>()[i], tol)
+        << "at index " << i;
+    }
+  }
+}
+
 } // namespace caffe2
\ No newline at end of file
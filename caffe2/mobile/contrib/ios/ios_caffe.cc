@@ -29,6 +29,10 @@ Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init_net_str,
   return predictor;
 }
 
+void SetCaffe2PredictorLowPowerMode(Caffe2IOSPredictor* predictor, bool lowPower) {
+  predictor->setLowPowerMode(lowPower);
+}
+
 void GenerateStylizedImage(std::vector<float>& originalImage,
                            const std::string& init_net_str,
                            const std::string& predict_net_str,
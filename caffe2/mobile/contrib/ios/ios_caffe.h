@@ -14,6 +14,8 @@ IOS_CAFFE_EXPORT Caffe2IOSPredictor* MakeCaffe2Predictor(const std::string& init
                                                          bool disableMultithreadProcessing,
                                                          bool allowMetalOperators,
                                                          std::string& errorMessage);
+IOS_CAFFE_EXPORT void SetCaffe2PredictorLowPowerMode(Caffe2IOSPredictor* predictor,
+                                                     bool lowPower);
 IOS_CAFFE_EXPORT void GenerateStylizedImage(std::vector<float>& originalImage,
                                             const std::string& init_net_str,
                                             const std::string& predict_net_str,
@@ -48,6 +48,14 @@ Caffe2IOSPredictor::Caffe2IOSPredictor(const caffe2::NetDef& init_net,
 #endif
 }
 
+void Caffe2IOSPredictor::setLowPowerMode(bool lowPower) {
+  caffe2::ThreadPool* threadpool = predictor_.ws()->GetThreadPool();
+  if (threadpool != nullptr) {
+    threadpool->setCores(lowPower ? caffe2::ThreadPoolCores::kLittle
+                                  : caffe2::ThreadPoolCores::kBig);
+  }
+}
+
 void Caffe2IOSPredictor::run(const Tensor& inData, Tensor& outData, std::string& errorMessage) {
   caffe2::FLAGS_caffe2_force_shared_col_buffer = true;
   caffe2::TensorCPU input;
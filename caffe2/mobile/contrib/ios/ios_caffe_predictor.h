@@ -23,6 +23,11 @@ class IOS_CAFFE_EXPORT Caffe2IOSPredictor final {
                                                    bool disableMultithreadProcessing,
                                                    bool allowMetalOperators);
   void run(const Tensor& inData, Tensor& outData, std::string& errorMessage);
+  /**
+   @lowPower Run on the efficiency cores, for battery life, rather than on the performance
+   cores, for latency.
+   */
+  void setLowPowerMode(bool lowPower);
   ~Caffe2IOSPredictor(){};
 
   const bool usingMetalOperators;
@@ -733,6 +733,27 @@ kernel void elementwise_add(texture2d_array<half, access::read> in0[[texture(0)]
   out.write(in0.read(gid_, gid.z) + in1.read(gid_, gid.z), gid_, gid.z);
 }
 
+kernel void elementwise_add_relu_nonarray(texture2d<half, access::read> in0[[texture(0)]],
+                                          texture2d<half, access::read> in1[[texture(1)]],
+                                          texture2d<half, access::write> out[[texture(2)]],
+                                          ushort2 gid[[thread_position_in_grid]]) {
+  if (gid.x >= out.get_width() || gid.y >= out.get_height()) {
+    return;
+  }
+  out.write(max(in0.read(gid) + in1.read(gid), half4(0)), gid);
+}
+
+kernel void elementwise_add_relu(texture2d_array<half, access::read> in0[[texture(0)]],
+                                 texture2d_array<half, access::read> in1[[texture(1)]],
+                                 texture2d_array<half, access::write> out[[texture(2)]],
+                                 ushort3 gid[[thread_position_in_grid]]) {
+  if (gid.x >= out.get_width() || gid.y >= out.get_height()) {
+    return;
+  }
+  ushort2 gid_ = gid.xy;
+  out.write(max(in0.read(gid_, gid.z) + in1.read(gid_, gid.z), half4(0)), gid_, gid.z);
+}
+
 constant bool has_in0_arg = (ushort_arg_0 > 0);
 constant bool has_in1_arg = (ushort_arg_1 > 0);
 constant bool has_in2_arg = (ushort_arg_2 > 0);
@@ -77,14 +77,15 @@ auto divRoundUp(uint x, uint y) -> uint {
   return (x + y - 1) / y;
 }
 
-MPSTemporaryImage* createTemporaryImage(
-    const OperatorBase* op,
+// Creates a temporary image read once, by the operator that creates it. Its
+// memory goes back to the command buffer as soon as it has been read, for the
+// next temporary images to reuse.
+MPSTemporaryImage* createIntermediateImage(
     id<MTLCommandBuffer> commandBuffer,
     int n,
     int height,
     int width,
-    int channels,
-    size_t output_idx = 0) {
+    int channels) {
   auto* image = [MPSTemporaryImage
       temporaryImageWithCommandBuffer:commandBuffer
                       imageDescriptor:
@@ -98,6 +99,20 @@ MPSTemporaryImage* createTemporaryImage(
                                                          usage:
                                                              MTLTextureUsageShaderRead |
                                                          MTLTextureUsageShaderWrite]];
+  image.readCount = 1;
+  return image;
+}
+
+MPSTemporaryImage* createTemporaryImage(
+    const OperatorBase* op,
+    id<MTLCommandBuffer> commandBuffer,
+    int n,
+    int height,
+    int width,
+    int channels,
+    size_t output_idx = 0) {
+  auto* image =
+      createIntermediateImage(commandBuffer, n, height, width, channels);
   // We'll try to look at the per-output_idx read-count argument, otherwise,
   // we'll use the operator-global default.
   const auto& readCounts = op->GetRepeatedArgument<int>(kMPSCNNReadCountArg);
@@ -135,27 +150,22 @@ class MPSImageWrapper {
       int width,
       int channels,
       size_t output_idx = 0) {
-    /* If the parent wrapper contains a temporary image, we need to pass on the
-     * command buffer because the temporary images are attached to the command
-     * buffer, we will need to use the same command buffer in order to use the
-     * temporary image. We don't want to synchronize the parent wrapper because
-     * it is still in use. If the parent wrapper contains a static image, we
-     * should create a new command buffer because we use static image so it can
-     * survive synchronization(commit of the command buffer), which means if we
-     * pass on the command buffer the command buffer will be commited in
-     * multiple places in the graph. Also since we don't pass on parent's
-     * command buffer,we need to synchronize(commit) it since it won't be used
-     * in the future.
+    /* All the operators of a net run encode into a single command buffer,
+     * which is committed once, by the operator that copies the outputs back to
+     * the CPU. If the parent wrapper contains a temporary image, we need to
+     * pass on the command buffer because the temporary images are attached to
+     * the command buffer. A static image survives the commit of its command
+     * buffer, so its command buffer is passed on as long as it has not been
+     * committed yet, and a new command buffer is only created when a
+     * synchronization already committed it. Committing it here would also
+     * commit the temporary images its other readers still use.
      */
-    bool passOnCb = parent != nullptr && parent->isTemporaryImage_;
+    bool passOnCb = parent != nullptr &&
+        (parent->isTemporaryImage_ ||
+         parent->commandBuffer_.status == MTLCommandBufferStatusNotEnqueued);
     commandBuffer_ = passOnCb ? parent->commandBuffer_
                               : [getMPSCNNContext().commandQueue commandBuffer];
 
-    bool commitInputCb = parent != nullptr && !parent->isTemporaryImage_;
-    if (commitInputCb) {
-      parent->synchronize();
-    }
-
     const auto& isTemporaryImages =
         op->GetRepeatedArgument<int>(kMPSCNNOutputIsTempImageArg);
     isTemporaryImage_ = isTemporaryImages.size()
@@ -242,6 +252,34 @@ LaunchParams spatialPointwiseKernelLaunchParams(
   return {threadsPerThreadgroup, threadgroupsPerGrid};
 };
 
+// Encodes output = X0 + X1, followed by a Relu if fuseRelu.
+void encodeElementwiseAdd(
+    id<MTLCommandBuffer> commandBuffer,
+    const MPSImage* X0,
+    const MPSImage* X1,
+    MPSImage* output,
+    bool fuseRelu) {
+  CAFFE_ENFORCE_EQ(X1.width, X0.width);
+  CAFFE_ENFORCE_EQ(X1.height, X0.height);
+  CAFFE_ENFORCE_EQ(X1.featureChannels, X0.featureChannels);
+  CAFFE_ENFORCE_EQ(X1.numberOfImages, X0.numberOfImages);
+  id<MTLComputeCommandEncoder> encoder = [commandBuffer computeCommandEncoder];
+  NSString* kernel = fuseRelu
+      ? kernelFor(X0, @"elementwise_add_relu", @"elementwise_add_relu_nonarray")
+      : kernelFor(X0, @"elementwise_add", @"elementwise_add_nonarray");
+  id<MTLComputePipelineState> state =
+      getMPSCNNContext().getPipelineState(kernel);
+
+  [encoder setComputePipelineState:state];
+  [encoder setTexture:[X0 texture] atIndex:0];
+  [encoder setTexture:[X1 texture] atIndex:1];
+  [encoder setTexture:[output texture] atIndex:2];
+  const auto& launchParams = spatialPointwiseKernelLaunchParams(state, output);
+  [encoder dispatchThreadgroups:launchParams.threadgroupsPerGrid
+          threadsPerThreadgroup:launchParams.threadsPerThreadgroup];
+  [encoder endEncoding];
+}
+
 void computeOutputHW(
     ConvPoolOpBase<CPUContext>* op,
     int H,
@@ -722,7 +760,14 @@ INIT_NEURON_OP(Tanh);
 
 #undef INIT_NEURON_OP
 
-template <typename Neuron>
+// The residual connection, X + Y, that a convolution Y fuses
+enum class ConvAddFusionTy {
+  NONE,
+  ADD,
+  ADD_RELU,
+};
+
+template <typename Neuron, ConvAddFusionTy fusionTy = ConvAddFusionTy::NONE>
 class MPSCNNConvOp final : public ConvPoolOpBase<CPUContext> {
  public:
   MPSCNNConvOp(const OperatorDef& operator_def, Workspace* ws)
@@ -861,18 +906,44 @@ class MPSCNNConvOp final : public ConvPoolOpBase<CPUContext> {
     MPSImage* output = outputWrapper.getImage();
     CAFFE_ENFORCE_EQ(output.height, output_height);
     CAFFE_ENFORCE_EQ(output.width, output_width);
-    [conv_ encodeToCommandBuffer:commandBuffer
-                     sourceImage:X
-                destinationImage:output];
+    if (fusionTy == ConvAddFusionTy::NONE) {
+      [conv_ encodeToCommandBuffer:commandBuffer
+                       sourceImage:X
+                  destinationImage:output];
+    } else {
+      // The convolution writes to an intermediate image, whose memory the
+      // addition frees right away, instead of the output of a separate
+      // MPSCNNConv operator that lives until its last reader.
+      auto residualWrapper =
+          Inputs()[RESIDUAL]->template Get<MPSImageWrapper>();
+      CAFFE_ENFORCE_EQ(residualWrapper.getCommandBuffer(), commandBuffer);
+      auto convOutput = createIntermediateImage(
+          commandBuffer,
+          X.numberOfImages,
+          output_height,
+          output_width,
+          output_channels);
+      [conv_ encodeToCommandBuffer:commandBuffer
+                       sourceImage:X
+                  destinationImage:convOutput];
+      encodeElementwiseAdd(
+          commandBuffer,
+          convOutput,
+          residualWrapper.getImage(),
+          output,
+          fusionTy == ConvAddFusionTy::ADD_RELU);
+      convOutput.readCount -= 1;
+      residualWrapper.markRead();
+    }
     outputWrapper.copyToOutputBlob(Outputs()[0]);
 
     VLOG(2) << "MPSCNNConv took: " << t.MilliSeconds();
     return true;
   }
 
-  // Input: X, W, b
+  // Input: X, W, b, and the residual R of the fused additions
   // Output: Y
-  INPUT_TAGS(INPUT, FILTER, BIAS);
+  INPUT_TAGS(INPUT, FILTER, BIAS, RESIDUAL);
 
   MPSCNNConvolution* conv_{nullptr};
 };
@@ -897,6 +968,18 @@ INIT_CONV_NEURON_OP(MPSCNNConvSigmoid, SigmoidNeuronInit);
 
 #undef INIT_CONV_NEURON_OP
 
+// Conv followed by an Add of its output to the residual input R, and by a
+// Relu for MPSCNNConvAddRelu.
+#define INIT_CONV_ADD_OP(name, fusionTy)                                \
+  REGISTER_CPU_OPERATOR(name, MPSCNNConvOp<EmptyNeuronInit, fusionTy>); \
+  OPERATOR_SCHEMA(name).NumInputs(4).NumOutputs(1).AllowInplace(        \
+      {{1, 0}, {2, 0}, {3, 0}});
+
+INIT_CONV_ADD_OP(MPSCNNConvAdd, ConvAddFusionTy::ADD);
+INIT_CONV_ADD_OP(MPSCNNConvAddRelu, ConvAddFusionTy::ADD_RELU);
+
+#undef INIT_CONV_ADD_OP
+
 class MPSCNNPadImageOp final : public ConvPoolOpBase<CPUContext> {
  public:
   MPSCNNPadImageOp(const OperatorDef& operator_def, Workspace* ws)
@@ -1093,6 +1176,7 @@ class MPSCNNSubOp final : public Operator<CPUContext> {
 REGISTER_CPU_OPERATOR(MPSCNNSub, MPSCNNSubOp);
 OPERATOR_SCHEMA(MPSCNNSub).NumInputs(2).NumOutputs(1).AllowInplace({{0, 0}});
 
+template <bool fuseRelu>
 class MPSCNNAddOp final : public Operator<CPUContext> {
  public:
   MPSCNNAddOp(const OperatorDef& operator_def, Workspace* ws)
@@ -1116,23 +1200,7 @@ class MPSCNNAddOp final : public Operator<CPUContext> {
         X0.featureChannels);
     auto commandBuffer = outputWrapper.getCommandBuffer();
     MPSImage* output = outputWrapper.getImage();
-    CAFFE_ENFORCE_EQ(X1.width, X0.width);
-    CAFFE_ENFORCE_EQ(X1.height, X0.height);
-    CAFFE_ENFORCE_EQ(X1.featureChannels, X0.featureChannels);
-    id<MTLComputeCommandEncoder> encoder =
-        [commandBuffer computeCommandEncoder];
-    id<MTLComputePipelineState> state = getMPSCNNContext().getPipelineState(
-        kernelFor(X0, @"elementwise_add", @"elementwise_add_nonarray"));
-
-    [encoder setComputePipelineState:state];
-    [encoder setTexture:[X0 texture] atIndex:0];
-    [encoder setTexture:[X1 texture] atIndex:1];
-    [encoder setTexture:[output texture] atIndex:2];
-    const auto& launchParams =
-        spatialPointwiseKernelLaunchParams(state, output);
-    [encoder dispatchThreadgroups:launchParams.threadgroupsPerGrid
-            threadsPerThreadgroup:launchParams.threadsPerThreadgroup];
-    [encoder endEncoding];
+    encodeElementwiseAdd(commandBuffer, X0, X1, output, fuseRelu);
     wrapper0.markRead();
     wrapper1.markRead();
     outputWrapper.copyToOutputBlob(Outputs()[0]);
@@ -1142,10 +1210,15 @@ class MPSCNNAddOp final : public Operator<CPUContext> {
   }
 };
 
-REGISTER_CPU_OPERATOR(MPSCNNAdd, MPSCNNAddOp);
+REGISTER_CPU_OPERATOR(MPSCNNAdd, MPSCNNAddOp<false>);
 // Not really in-place per-se, but semantically is valid and preserves
 // compatibility.
 OPERATOR_SCHEMA(MPSCNNAdd).NumInputs(2).NumOutputs(1).AllowInplace({{0, 0}});
+REGISTER_CPU_OPERATOR(MPSCNNAddRelu, MPSCNNAddOp<true>);
+OPERATOR_SCHEMA(MPSCNNAddRelu)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .AllowInplace({{0, 0}});
 
 class MPSCNNAveragePoolOp final : public ConvPoolOpBase<CPUContext> {
  public:
@@ -1611,8 +1684,7 @@ class MPSCNNConvTransposeOp final : public ConvTransposeUnpoolBase<CPUContext> {
       VLOG(2) << "ConvTranspose:" << output_channels << " " << kH << " " << kW
               << " " << X.numberOfImages;
 
-      auto gemmed = createTemporaryImage(
-          this,
+      auto gemmed = createIntermediateImage(
           commandBuffer,
           X.numberOfImages,
           X.height,
@@ -141,8 +141,18 @@ bool tryFuseAdjacentOps(
     const Analysis& analysis,
     size_t currentIdx,
     const OperatorDef& currentOp,
-    const OperatorDef& nextOp,
+    const OperatorDef& ogNextOp,
     OperatorDef* fusedOp) {
+  // The addition is commutative, so the output of currentOp may be either
+  // input of the residual connection, nextOp.
+  OperatorDef nextOp(ogNextOp);
+  if (nextOp.type() == "MPSCNNAdd" && nextOp.input_size() == 2 &&
+      currentOp.output_size() == 1 &&
+      nextOp.input(1) == currentOp.output(0)) {
+    const auto residual = nextOp.input(0);
+    nextOp.set_input(0, nextOp.input(1));
+    nextOp.set_input(1, residual);
+  }
   // Check for possible invalid opportunities.
   // Must be identical outputs, with either in-place usage for nextOp, *or* the
   // only use of the output of currentOp is the consumption by nextOp.
@@ -164,6 +174,9 @@ bool tryFuseAdjacentOps(
       fusionOpportunities = {{
           {{"MPSCNNConv", "MPSCNNRelu"}, "MPSCNNConvRelu"},
           {{"MPSCNNConv", "MPSCNNSigmoid"}, "MPSCNNConvSigmoid"},
+          {{"MPSCNNConv", "MPSCNNAdd"}, "MPSCNNConvAdd"},
+          {{"MPSCNNConvAdd", "MPSCNNRelu"}, "MPSCNNConvAddRelu"},
+          {{"MPSCNNAdd", "MPSCNNRelu"}, "MPSCNNAddRelu"},
           {{"MPSCNNFC", "MPSCNNRelu"}, "MPSCNNFCRelu"},
           {{"MPSCNNInstanceNorm", "MPSCNNPRelu"}, "MPSCNNInstanceNormPRelu"},
       }};
@@ -171,8 +184,10 @@ bool tryFuseAdjacentOps(
   if (it == fusionOpportunities.end()) {
     return false;
   }
-  // MPSCNNConvRelu and MPSCNNConvSigmoid cannot be in-place
-  if (currentOp.type() == "MPSCNNConv" &&
+  // MPSCNNConvRelu, MPSCNNConvSigmoid, MPSCNNConvAdd and MPSCNNConvAddRelu
+  // cannot be in-place
+  if ((currentOp.type() == "MPSCNNConv" ||
+       currentOp.type() == "MPSCNNConvAdd") &&
       currentOp.input(0) == nextOp.output(0)) {
     return false;
   }
@@ -187,7 +202,7 @@ bool tryFuseAdjacentOps(
   return true;
 }
 
-NetDef runMPSCNNFusion(const NetDef& def) {
+NetDef runMPSCNNFusionPass(const NetDef& def) {
   CAFFE_ENFORCE_GE(def.op_size(), 1);
   NetDef mdef;
   mdef.CopyFrom(def);
@@ -224,6 +239,18 @@ NetDef runMPSCNNFusion(const NetDef& def) {
   return mdef;
 }
 
+NetDef runMPSCNNFusion(const NetDef& def) {
+  // A fused operator may fuse again with the next one, e.g. Conv + Add + Relu
+  // into MPSCNNConvAddRelu, so we fuse until nothing changes.
+  NetDef mdef = runMPSCNNFusionPass(def);
+  auto opSize = def.op_size();
+  while (mdef.op_size() < opSize) {
+    opSize = mdef.op_size();
+    mdef = runMPSCNNFusionPass(mdef);
+  }
+  return mdef;
+}
+
 NetDef rewriteForMetal(const NetDef& def) {
   NetDef mdef;
   mdef.CopyFrom(def);
@@ -286,7 +313,25 @@ NetDef annotateDefWithReadCounts(const NetDef& net) {
   annotatedNet.CopyFrom(net);
   for (auto i = 0; i < annotatedNet.op_size(); ++i) {
     auto* op = annotatedNet.mutable_op(i);
-    // TODO - relax this? CAFFE_ENFORCE_EQ(op->output_size(), 1);
+    // The temporary images of the outputs are freed once read as many times
+    // as their version is used. An operator with several outputs, like
+    // CopyToMPSCNN, gets one read count per output.
+    if (op->output_size() > 1) {
+      std::vector<size_t> outputReadCounts;
+      bool hasMultipleReads = false;
+      for (const auto& blob : op->output()) {
+        outputReadCounts.push_back(std::max<size_t>(readCounts[i][blob], 1));
+        hasMultipleReads |= outputReadCounts.back() > 1;
+      }
+      if (hasMultipleReads) {
+        auto* arg = op->add_arg();
+        arg->set_name(kMPSCNNReadCountArg);
+        for (auto readCount : outputReadCounts) {
+          arg->add_ints(readCount);
+        }
+      }
+      continue;
+    }
     const auto& blob = op->output(0);
     const size_t readCount = readCounts[i][blob];
     if (readCount > 1) {
@@ -3141,6 +3141,58 @@ void testMPSCNN() {
     CHECK_EQ(o0(2), i0(3));
   }
 
+  {
+    LOG(INFO) << "MPSCNNRewriteForMetal residual Fusion Test";
+    NetDef netdef;
+    netdef.add_external_input("X");
+    netdef.add_external_output("Z");
+    {
+      auto& op = *(netdef.add_op());
+      op.set_type("Relu");
+      op.add_input("X");
+      op.add_output("R");
+    }
+    {
+      auto& op = *(netdef.add_op());
+      op.set_type("Conv");
+      op.add_input("R");
+      op.add_input("W");
+      op.add_input("b");
+      op.add_output("Y");
+    }
+    // The output of the Conv is the second input of the Add.
+    {
+      auto& op = *(netdef.add_op());
+      op.set_type("Add");
+      op.add_input("R");
+      op.add_input("Y");
+      op.add_output("Y");
+    }
+    {
+      auto& op = *(netdef.add_op());
+      op.set_type("Relu");
+      op.add_input("Y");
+      op.add_output("Z");
+    }
+    netdef = rewriteForMetal(netdef);
+    netdef = annotateDefWithReadCounts(netdef);
+    CHECK_EQ(netdef.op_size(), 4);
+    auto ty = [&](size_t i) { return netdef.op(i).type(); };
+    auto o0 = [&](size_t i) { return netdef.op(i).output(0); };
+    CHECK_EQ(ty(0), "CopyToMPSCNN");
+    CHECK_EQ(ty(1), "MPSCNNRelu");
+    CHECK_EQ(ty(2), "MPSCNNConvAddRelu");
+    CHECK_EQ(ty(3), "CopyFromMPSCNN");
+    CHECK_EQ(netdef.op(2).input_size(), 4);
+    CHECK_EQ(netdef.op(2).input(0), o0(1));
+    CHECK_EQ(netdef.op(2).input(1), "W");
+    CHECK_EQ(netdef.op(2).input(2), "b");
+    CHECK_EQ(netdef.op(2).input(3), o0(1));
+    CHECK_EQ(o0(2), netdef.op(3).input(0));
+    // R is read by the convolution and the addition.
+    CHECK_EQ(GetArgument(netdef.op(1), "__mpscnn_read_count__").i(), 2);
+  }
+
   {
     LOG(INFO) << "MPSCNNRewriteForMetal out-of-place fusion failure test";
     NetDef netdef;
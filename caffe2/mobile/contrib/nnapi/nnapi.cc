@@ -1,10 +1,23 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/core/timer.h"
 #include "caffe2/core/types.h"
 #include "caffe2/utils/proto_utils.h"
 
 #include "nnapi.h"
 
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <unordered_set>
+
+#if __ANDROID_API__ >= 26
+#include <android/sharedmem.h>
+#else
+#include <linux/ashmem.h>
+#endif
+
 namespace {
 // Bug: ANEURALNETWORKS_UNMAPPABLE and ANEURALNETWORKS_OP_FAILED share the same
 // enum value
@@ -28,6 +41,27 @@ void reportError(int result_code) {
       CAFFE_THROW("unknown error");
   }
 }
+
+// Returns the file descriptor of new shared memory of size bytes, or -1
+int createSharedMemory(const std::string& name, size_t size) {
+#if __ANDROID_API__ >= 26
+  return ASharedMemory_create(name.c_str(), size);
+#else
+  int fd = open("/dev/ashmem", O_RDWR);
+  if (fd < 0) {
+    return -1;
+  }
+  char ashmem_name[ASHMEM_NAME_LEN];
+  strncpy(ashmem_name, name.c_str(), ASHMEM_NAME_LEN - 1);
+  ashmem_name[ASHMEM_NAME_LEN - 1] = '\0';
+  if (ioctl(fd, ASHMEM_SET_NAME, ashmem_name) < 0 ||
+      ioctl(fd, ASHMEM_SET_SIZE, size) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+#endif
+}
 } // namespace
 
 namespace caffe2 {
@@ -37,48 +71,94 @@ bool NNApi::loadNNApiLibrary() {
 }
 
 NNApi::~NNApi() {
-  if (run_end_) {
-    libnnapi_.ANeuralNetworksEvent_free(run_end_);
-  }
-  if (run_) {
-    libnnapi_.ANeuralNetworksExecution_free(run_);
-  }
-  if (compilation_) {
-    libnnapi_.ANeuralNetworksCompilation_free(compilation_);
+  for (auto& partition : partitions_) {
+    if (partition.compilation) {
+      libnnapi_.ANeuralNetworksCompilation_free(partition.compilation);
+    }
+    if (partition.model) {
+      libnnapi_.ANeuralNetworksModel_free(partition.model);
+    }
   }
-  if (model_) {
-    libnnapi_.ANeuralNetworksModel_free(model_);
+  for (auto& shared : shared_tensors_) {
+    if (shared.second.memory) {
+      libnnapi_.ANeuralNetworksMemory_free(shared.second.memory);
+    }
+    if (shared.second.data && shared.second.data != MAP_FAILED) {
+      munmap(shared.second.data, shared.second.nbytes);
+    }
+    if (shared.second.fd >= 0) {
+      close(shared.second.fd);
+    }
   }
 }
 
 bool NNApi::run(const TensorVector& inputs, TensorVector* outputs) {
   CAFFE_ENFORCE(inputs.size() <= run_net_.external_input_size());
   try {
-    init(inputs, outputs);
+    if (partitions_.empty()) {
+      for (int i = 0; i < inputs.size(); i++) {
+        if (inputs[i]->IsType<float>()) {
+          tensor_type_ = ANEURALNETWORKS_TENSOR_FLOAT32;
+        } else if (inputs[i]->IsType<uint8_t>()) {
+          tensor_type_ = ANEURALNETWORKS_TENSOR_QUANT8_ASYMM;
+        } else {
+          CAFFE_THROW("Unsupported tensor type");
+        }
+      }
+      partition();
+    }
   } catch (const std::exception& e) {
     LOG(ERROR) << "Error duing model initialization: " << e.what();
     return false;
   }
 
   try {
-    VLOG(1) << "Start compute";
-    int result_code =
-        libnnapi_.ANeuralNetworksExecution_startCompute(run_, &run_end_);
-    if (result_code != ANEURALNETWORKS_NO_ERROR) {
-      reportError(result_code);
+    // the inputs are read in place
+    for (int i = 0; i < inputs.size(); i++) {
+      const std::string& blob = run_net_.external_input(i);
+      Blob* input = ws_.GetBlob(blob);
+      if (!input || !input->IsType<TensorCPU>() ||
+          &input->Get<TensorCPU>() != inputs[i]) {
+        ws_.CreateLocalBlob(blob)->GetMutable<TensorCPU>()->ShareData(
+            *inputs[i]);
+      }
     }
-    result_code = libnnapi_.ANeuralNetworksEvent_wait(run_end_);
-    if (result_code != ANEURALNETWORKS_NO_ERROR) {
-      reportError(result_code);
+    for (auto& partition : partitions_) {
+      if (partition.nnapi ? !partition.compilation : !partition.cpu_net) {
+        init(partition);
+      }
+      Timer timer;
+      if (partition.nnapi) {
+        runNNApi(partition);
+      } else {
+        runCPU(partition);
+      }
+      partition.milliseconds += timer.MilliSeconds();
     }
-    VLOG(1) << "Finish compute";
+    num_runs_++;
   } catch (const std::exception& e) {
     LOG(ERROR) << "Error during model run: " << e.what();
     return false;
   }
+
+  outputs->clear();
+  for (const auto& blob : run_net_.external_output()) {
+    outputs->push_back(ws_.GetBlob(blob)->GetMutable<TensorCPU>());
+  }
   return true;
 }
 
+std::vector<NNApi::PartitionInfo> NNApi::partitions() const {
+  std::vector<PartitionInfo> infos;
+  for (const auto& partition : partitions_) {
+    infos.push_back(PartitionInfo{partition.nnapi,
+                                  partition.first_op,
+                                  partition.net.op_size(),
+                                  partition.milliseconds});
+  }
+  return infos;
+}
+
 void NNApi::getConvPoolArgs(const ArgumentHelper& helper, ConvPoolArgs& args) {
   std::vector<int> kernel(helper.GetRepeatedArgument<int>("kernels"));
   std::vector<int> stride(helper.GetRepeatedArgument<int>("strides"));
@@ -155,7 +235,7 @@ void NNApi::addPooling(
   // input
   const std::string& input = op.input(0);
   const std::vector<uint32_t>& input_dims = tensor_dims_[input];
-  input_indices[idx++] = operand_map_[input];
+  input_indices[idx++] = partition_->operand_map[input];
 
   CAFFE_ENFORCE_EQ(input_dims.size(), 4);
   uint32_t batches = input_dims[0];
@@ -198,7 +278,12 @@ void NNApi::addPooling(
       op.output(0), tensor_type_, dims, output_scale, output_zero_point);
 
   int result_code = libnnapi_.ANeuralNetworksModel_addOperation(
-      model_, op_code, input_indices_count, input_indices, 1, output_indices);
+      partition_->model,
+      op_code,
+      input_indices_count,
+      input_indices,
+      1,
+      output_indices);
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
@@ -264,7 +349,7 @@ void NNApi::addConv(const OperatorDef& op, bool fuse_relu) {
 
   uint32_t idx = 0;
   // input
-  input_indices[idx++] = operand_map_[input];
+  input_indices[idx++] = partition_->operand_map[input];
 
   // weight
   const std::string& weight_name = op.input(1);
@@ -290,7 +375,7 @@ void NNApi::addConv(const OperatorDef& op, bool fuse_relu) {
       weight_name, tensor_type_, weight_dims, weight_scale, weight_zero_point);
 
   int result_code = libnnapi_.ANeuralNetworksModel_setOperandValue(
-      model_, weight_idx, weight.raw_data(), weight.nbytes());
+      partition_->model, weight_idx, weight.raw_data(), weight.nbytes());
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
@@ -320,7 +405,7 @@ void NNApi::addConv(const OperatorDef& op, bool fuse_relu) {
   uint32_t bias_idx = addTensorOperand(bias_name, bias_type, bias_dims);
 
   result_code = libnnapi_.ANeuralNetworksModel_setOperandValue(
-      model_, bias_idx, bias.raw_data(), bias.nbytes());
+      partition_->model, bias_idx, bias.raw_data(), bias.nbytes());
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
@@ -366,7 +451,7 @@ void NNApi::addConv(const OperatorDef& op, bool fuse_relu) {
   if (run_depthwise) {
     CAFFE_ENFORCE_EQ(input_indices_count, 11);
     result_code = libnnapi_.ANeuralNetworksModel_addOperation(
-        model_,
+        partition_->model,
         ANEURALNETWORKS_DEPTHWISE_CONV_2D,
         input_indices_count,
         input_indices,
@@ -378,7 +463,7 @@ void NNApi::addConv(const OperatorDef& op, bool fuse_relu) {
   } else {
     CAFFE_ENFORCE_EQ(input_indices_count, 10);
     result_code = libnnapi_.ANeuralNetworksModel_addOperation(
-        model_,
+        partition_->model,
         ANEURALNETWORKS_CONV_2D,
         input_indices_count,
         input_indices,
@@ -395,7 +480,7 @@ void NNApi::addRelu(const OperatorDef& op) {
   CAFFE_ENFORCE_EQ(op.input_size(), 1);
   CAFFE_ENFORCE_EQ(op.output_size(), 1);
   const std::string& input = op.input(0);
-  uint32_t input_idx = operand_map_[input];
+  uint32_t input_idx = partition_->operand_map[input];
 
   ArgumentHelper helper(op);
   float output_scale = helper.GetSingleArgument<float>("output_scale", 1.0);
@@ -409,7 +494,12 @@ void NNApi::addRelu(const OperatorDef& op) {
       output_zero_point);
 
   int result_code = libnnapi_.ANeuralNetworksModel_addOperation(
-      model_, ANEURALNETWORKS_RELU, 1, &input_idx, 1, &output_idx);
+      partition_->model,
+      ANEURALNETWORKS_RELU,
+      1,
+      &input_idx,
+      1,
+      &output_idx);
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
@@ -425,7 +515,7 @@ void NNApi::addSoftmax(const OperatorDef& op) {
 
   uint32_t input_indices[2];
   const std::string& input = op.input(0);
-  input_indices[0] = operand_map_[input];
+  input_indices[0] = partition_->operand_map[input];
   const auto& input_dims = tensor_dims_[input];
   CAFFE_ENFORCE(
       input_dims.size() == 2 || input_dims.size() == 4,
@@ -449,7 +539,12 @@ void NNApi::addSoftmax(const OperatorDef& op) {
       output_zero_point);
 
   int result_code = libnnapi_.ANeuralNetworksModel_addOperation(
-      model_, ANEURALNETWORKS_SOFTMAX, 2, input_indices, 1, &output_idx);
+      partition_->model,
+      ANEURALNETWORKS_SOFTMAX,
+      2,
+      input_indices,
+      1,
+      &output_idx);
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
@@ -463,19 +558,20 @@ uint32_t NNApi::addScalarOperand(int32_t val) {
   scalar.zeroPoint = 0;
   scalar.dimensionCount = 0;
   scalar.dimensions = NULL;
-  int result_code = libnnapi_.ANeuralNetworksModel_addOperand(model_, &scalar);
+  int result_code =
+      libnnapi_.ANeuralNetworksModel_addOperand(partition_->model, &scalar);
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
 
   result_code = libnnapi_.ANeuralNetworksModel_setOperandValue(
-      model_, operand_idx, &val, sizeof(val));
+      partition_->model, partition_->operand_idx, &val, sizeof(val));
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
 
-  VLOG(1) << "Added scalar, " << val << ", at " << operand_idx;
-  return operand_idx++;
+  VLOG(1) << "Added scalar, " << val << ", at " << partition_->operand_idx;
+  return partition_->operand_idx++;
 }
 
 // float32
@@ -486,19 +582,20 @@ uint32_t NNApi::addFloatOperand(float val) {
   scalar.zeroPoint = 0;
   scalar.dimensionCount = 0;
   scalar.dimensions = NULL;
-  int result_code = libnnapi_.ANeuralNetworksModel_addOperand(model_, &scalar);
+  int result_code =
+      libnnapi_.ANeuralNetworksModel_addOperand(partition_->model, &scalar);
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
 
   result_code = libnnapi_.ANeuralNetworksModel_setOperandValue(
-      model_, operand_idx, &val, sizeof(val));
+      partition_->model, partition_->operand_idx, &val, sizeof(val));
   if (result_code != ANEURALNETWORKS_NO_ERROR) {
     reportError(result_code);
   }
 
-  VLOG(1) << "Added scalar, " << val << ", at " << operand_idx;
-  return operand_idx++;
+  VLOG(1) << "Added scalar, " << val << ", at " << partition_->operand_idx;
+  return partition_->operand_idx++;
 }
 
 uint32_t NNApi::addTensorOperand(
@@ -510,8 +607,8 @@ uint32_t NNApi::addTensorOperand(
 // clang-format off
 {
   // clang-format on
-  auto found = operand_map_.find(blob);
-  if (found == operand_map_.end()) {
+  auto found = partition_->operand_map.find(blob);
+  if (found == partition_->operand_map.end()) {
     ANeuralNetworksOperandType tensor;
     tensor.type = type;
     tensor.scale = scale;
@@ -520,194 +617,379 @@ uint32_t NNApi::addTensorOperand(
     tensor.dimensions = dims.data();
 
     int result_code =
-        libnnapi_.ANeuralNetworksModel_addOperand(model_, &tensor);
+        libnnapi_.ANeuralNetworksModel_addOperand(partition_->model, &tensor);
     if (result_code != ANEURALNETWORKS_NO_ERROR) {
       reportError(result_code);
     }
 
-    operand_map_[blob] = operand_idx++;
+    partition_->operand_map[blob] = partition_->operand_idx++;
     tensor_dims_[blob] = dims;
-    VLOG(1) << "Added operand, " << blob << ", at " << operand_map_[blob];
+    tensor_quant_[blob] = std::make_pair(scale, zero_point);
+    VLOG(1) << "Added operand, " << blob << ", at "
+            << partition_->operand_map[blob];
   }
-  return operand_map_[blob];
+  return partition_->operand_map[blob];
 }
 
-void NNApi::init(const TensorVector& inputs, TensorVector* outputs) {
-  // model
-  if (!model_) {
-    int result_code = libnnapi_.ANeuralNetworksModel_create(&model_);
-    if (result_code != ANEURALNETWORKS_NO_ERROR) {
-      reportError(result_code);
+void NNApi::partition() {
+  const auto& ops = run_net_.op();
+  for (int i = 0; i < ops.size(); i++) {
+    bool nnapi = isSupported(ops.Get(i));
+    if (partitions_.empty() || partitions_.back().nnapi != nnapi) {
+      partitions_.emplace_back();
+      partitions_.back().nnapi = nnapi;
+      partitions_.back().first_op = i;
+      partitions_.back().net.set_name(
+          run_net_.name() + "_partition_" +
+          caffe2::to_string(partitions_.size() - 1));
     }
-    if (!model_) {
-      CAFFE_THROW("Failed to create NN model");
-    } else {
-      LOG(INFO) << "Created NN model";
+    partitions_.back().net.add_op()->CopyFrom(ops.Get(i));
+  }
+
+  std::unordered_set<std::string> external_outputs(
+      run_net_.external_output().begin(), run_net_.external_output().end());
+  for (int p = 0; p < partitions_.size(); p++) {
+    NetDef& net = partitions_[p].net;
+    std::unordered_set<std::string> written;
+    std::unordered_set<std::string> inputs;
+    for (const auto& op : net.op()) {
+      // The weights of Conv are constants of the model
+      int num_inputs = partitions_[p].nnapi && op.type() == "Conv"
+          ? 1
+          : op.input_size();
+      for (int j = 0; j < num_inputs; j++) {
+        if (!written.count(op.input(j)) && inputs.insert(op.input(j)).second) {
+          net.add_external_input(op.input(j));
+          if (partitions_[p].nnapi) {
+            nnapi_inputs_.insert(op.input(j));
+          }
+        }
+      }
+      for (const auto& output : op.output()) {
+        written.insert(output);
+      }
     }
-
-    ArgumentHelper helper(run_net_);
-    float scale = helper.GetSingleArgument<float>("scale", 1.0);
-    int zero_point = helper.GetSingleArgument<int>("zero_point", 0);
-
-    // add external input dimension
-    for (int i = 0; i < inputs.size(); i++) {
-      if (inputs[i]->IsType<float>()) {
-        tensor_type_ = ANEURALNETWORKS_TENSOR_FLOAT32;
-      } else if (inputs[i]->IsType<uint8_t>()) {
-        tensor_type_ = ANEURALNETWORKS_TENSOR_QUANT8_ASYMM;
-      } else {
-        CAFFE_THROW("Unsupported tensor type");
+    std::unordered_set<std::string> read_later;
+    for (int q = p + 1; q < partitions_.size(); q++) {
+      for (const auto& op : partitions_[q].net.op()) {
+        read_later.insert(op.input().begin(), op.input().end());
       }
-      const std::string& input_blob = run_net_.external_input(i);
-      std::vector<uint32_t> dims;
-      for (auto dim : inputs[i]->dims()) {
-        dims.push_back(dim);
+    }
+    std::unordered_set<std::string> outputs;
+    for (const auto& op : net.op()) {
+      for (const auto& output : op.output()) {
+        if ((read_later.count(output) || external_outputs.count(output)) &&
+            outputs.insert(output).second) {
+          net.add_external_output(output);
+        }
       }
-      addTensorOperand(input_blob, tensor_type_, dims, scale, zero_point);
     }
+    LOG(INFO) << "Partition " << p << ": " << net.op_size() << " operators on "
+              << (partitions_[p].nnapi ? "NN API" : "CPU");
+  }
+}
 
-    // add operands and operations
-    for (const auto& op : run_net_.op()) {
-      if (operator_map_.count(op.type()) == 0) {
-        CAFFE_THROW("Unsupported operator");
+bool NNApi::isSupported(const OperatorDef& op) {
+  if (operator_map_.count(op.type()) == 0 || op.output_size() != 1) {
+    return false;
+  }
+  // NN API operands are written once
+  for (const auto& input : op.input()) {
+    if (input == op.output(0)) {
+      return false;
+    }
+  }
+  ArgumentHelper helper(op);
+  switch (operator_map_[op.type()]) {
+    case AVERAGEPOOL:
+    case CONV:
+    case MAXPOOL: {
+      if (StringToStorageOrder(helper.GetSingleArgument<std::string>(
+              "order", "NCHW")) != NHWC) {
+        return false;
+      }
+      ConvPoolArgs args;
+      getConvPoolArgs(helper, args);
+      if (args.stride_x != args.stride_y) {
+        return false;
+      }
+      if (operator_map_[op.type()] != CONV) {
+        return op.input_size() == 1;
+      }
+      if (op.input_size() != 3 || !ws_.HasBlob(op.input(1)) ||
+          !ws_.HasBlob(op.input(2))) {
+        return false;
+      }
+      for (auto d : helper.GetRepeatedArgument<int>("dilations")) {
+        if (d != 1) {
+          return false;
+        }
+      }
+      for (const char* name : {"dilation", "dilation_h", "dilation_w"}) {
+        if (helper.GetSingleArgument<int>(name, 1) != 1) {
+          return false;
+        }
       }
-      switch (operator_map_[op.type()]) {
-        case AVERAGEPOOL:
-          addPooling(op, ANEURALNETWORKS_AVERAGE_POOL_2D);
-          break;
-        case CONV:
-          addConv(op);
-          break;
-        case MAXPOOL:
-          addPooling(op, ANEURALNETWORKS_MAX_POOL_2D);
-          break;
-        case RELU:
-          addRelu(op);
-          break;
-        case SOFTMAX:
-          addSoftmax(op);
-          break;
-        default:
-          CAFFE_THROW("Unsupported operator");
-          break;
+      // Depthwise is the only convolution with groups
+      if (helper.GetSingleArgument<int>("group", 1) > 1) {
+        const auto& weight = ws_.GetBlob(op.input(1))->Get<TensorCPU>();
+        return weight.ndim() == 4 && weight.dim32(0) == 1 &&
+            weight.dim32(3) == helper.GetSingleArgument<int>("group", 1);
       }
+      return true;
     }
+    case RELU:
+      return op.input_size() == 1;
+    case SOFTMAX:
+      return op.input_size() == 1 &&
+          helper.GetSingleArgument<int>("axis", 1) == 1;
+    default:
+      return false;
+  }
+}
 
-    // model inputs and outputs
-    int output_size = run_net_.external_output_size();
-    std::vector<uint32_t> input_indices(inputs.size());
-    std::vector<uint32_t> output_indices(output_size);
-    for (int i = 0; i < inputs.size(); i++) {
-      input_indices[i] = operand_map_[run_net_.external_input(i)];
+void NNApi::shareTensor(const std::string& blob, const TypeMeta& meta) {
+  auto* tensor = ws_.GetBlob(blob)->GetMutable<TensorCPU>();
+  SharedTensor& shared = shared_tensors_[blob];
+  shared.nbytes = tensor->size() * meta.itemsize();
+  shared.fd = createSharedMemory(blob, shared.nbytes);
+  CAFFE_ENFORCE_GE(shared.fd, 0, "Failed to create shared memory for ", blob);
+  shared.data = mmap(
+      nullptr,
+      shared.nbytes,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED,
+      shared.fd,
+      0);
+  CAFFE_ENFORCE(shared.data != MAP_FAILED, "Failed to map ", blob);
+  int result_code = libnnapi_.ANeuralNetworksMemory_createFromFd(
+      shared.nbytes, PROT_READ | PROT_WRITE, shared.fd, 0, &shared.memory);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
+  if (tensor->meta() == meta && tensor->size() > 0 &&
+      tensor->raw_data() != nullptr) {
+    memcpy(shared.data, tensor->raw_data(), shared.nbytes);
+  }
+  tensor->ShareExternalPointer(shared.data, meta, shared.nbytes);
+  VLOG(1) << "Shared " << blob << " at " << shared.data
+          << ", size = " << shared.nbytes;
+}
+
+void NNApi::init(Partition& partition) {
+  if (!partition.nnapi) {
+    partition.cpu_net = ws_.CreateNet(partition.net);
+    CAFFE_ENFORCE(partition.cpu_net, "Failed to create ", partition.net.name());
+    return;
+  }
+
+  partition_ = &partition;
+  if (partition.model) {
+    // left by a failed run
+    libnnapi_.ANeuralNetworksModel_free(partition.model);
+    partition.model = nullptr;
+    partition.operand_idx = 0;
+    partition.operand_map.clear();
+  }
+  int result_code = libnnapi_.ANeuralNetworksModel_create(&partition.model);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
+  if (!partition.model) {
+    CAFFE_THROW("Failed to create NN model");
+  } else {
+    LOG(INFO) << "Created NN model";
+  }
+
+  ArgumentHelper helper(run_net_);
+  float scale = helper.GetSingleArgument<float>("scale", 1.0);
+  int zero_point = helper.GetSingleArgument<int>("zero_point", 0);
+
+  // add input dimension, of the tensors written by the previous partitions
+  // or given to run()
+  for (const auto& input : partition.net.external_input()) {
+    const auto& tensor = ws_.GetBlob(input)->Get<TensorCPU>();
+    std::vector<uint32_t> dims;
+    for (auto dim : tensor.dims()) {
+      dims.push_back(dim);
     }
-    for (int i = 0; i < output_size; i++) {
-      output_indices[i] = operand_map_[run_net_.external_output(i)];
+    auto quant = tensor_quant_.find(input);
+    if (quant == tensor_quant_.end()) {
+      addTensorOperand(input, tensor_type_, dims, scale, zero_point);
+    } else {
+      addTensorOperand(
+          input, tensor_type_, dims, quant->second.first, quant->second.second);
     }
+  }
 
-    result_code = libnnapi_.ANeuralNetworksModel_identifyInputsAndOutputs(
-        model_,
-        inputs.size(),
-        input_indices.data(),
-        output_size,
-        output_indices.data());
-    if (result_code != ANEURALNETWORKS_NO_ERROR) {
-      reportError(result_code);
+  // add operands and operations
+  for (const auto& op : partition.net.op()) {
+    switch (operator_map_[op.type()]) {
+      case AVERAGEPOOL:
+        addPooling(op, ANEURALNETWORKS_AVERAGE_POOL_2D);
+        break;
+      case CONV:
+        addConv(op);
+        break;
+      case MAXPOOL:
+        addPooling(op, ANEURALNETWORKS_MAX_POOL_2D);
+        break;
+      case RELU:
+        addRelu(op);
+        break;
+      case SOFTMAX:
+        addSoftmax(op);
+        break;
+      default:
+        CAFFE_THROW("Unsupported operator");
+        break;
     }
+  }
 
-    result_code = libnnapi_.ANeuralNetworksModel_finish(model_);
-    if (result_code != ANEURALNETWORKS_NO_ERROR) {
-      reportError(result_code);
-    }
+  // model inputs and outputs
+  std::vector<uint32_t> input_indices;
+  std::vector<uint32_t> output_indices;
+  for (const auto& input : partition.net.external_input()) {
+    input_indices.push_back(partition.operand_map[input]);
+  }
+  for (const auto& output : partition.net.external_output()) {
+    output_indices.push_back(partition.operand_map[output]);
+  }
 
-    LOG(INFO) << "Finish creating model";
+  result_code = libnnapi_.ANeuralNetworksModel_identifyInputsAndOutputs(
+      partition.model,
+      input_indices.size(),
+      input_indices.data(),
+      output_indices.size(),
+      output_indices.data());
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
 
-    // compile
-    if (!compilation_) {
-      result_code =
-          libnnapi_.ANeuralNetworksCompilation_create(model_, &compilation_);
-      if (result_code != ANEURALNETWORKS_NO_ERROR) {
-        reportError(result_code);
-      }
+  result_code = libnnapi_.ANeuralNetworksModel_finish(partition.model);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
 
-      result_code = libnnapi_.ANeuralNetworksCompilation_setPreference(
-          compilation_, preference_);
-      if (result_code != ANEURALNETWORKS_NO_ERROR) {
-        reportError(result_code);
-      }
+  LOG(INFO) << "Finish creating model";
 
-      result_code = libnnapi_.ANeuralNetworksCompilation_finish(compilation_);
-      if (result_code != ANEURALNETWORKS_NO_ERROR) {
-        reportError(result_code);
-      }
+  // compile
+  result_code = libnnapi_.ANeuralNetworksCompilation_create(
+      partition.model, &partition.compilation);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
+
+  result_code = libnnapi_.ANeuralNetworksCompilation_setPreference(
+      partition.compilation, preference_);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
+
+  result_code =
+      libnnapi_.ANeuralNetworksCompilation_finish(partition.compilation);
+  if (result_code != ANEURALNETWORKS_NO_ERROR) {
+    reportError(result_code);
+  }
+
+  LOG(INFO) << "Finish compilation";
+
+  // the outputs are written to shared memory, which the CPU operators and
+  // the caller read in place
+  const TypeMeta meta = tensor_type_ == ANEURALNETWORKS_TENSOR_FLOAT32
+      ? TypeMeta::Make<float>()
+      : TypeMeta::Make<uint8_t>();
+  for (const auto& output : partition.net.external_output()) {
+    std::vector<TIndex> output_dims;
+    for (auto dim : tensor_dims_[output]) {
+      output_dims.push_back(dim);
+    }
+    ws_.CreateLocalBlob(output)->GetMutable<TensorCPU>()->Resize(output_dims);
+    shareTensor(output, meta);
+  }
+  partition_ = nullptr;
+}
 
-      LOG(INFO) << "Finish compilation";
+void NNApi::runNNApi(Partition& partition) {
+  ANeuralNetworksExecution* execution = nullptr;
+  ANeuralNetworksEvent* event = nullptr;
+  try {
+    // an execution computes once
+    int result_code = libnnapi_.ANeuralNetworksExecution_create(
+        partition.compilation, &execution);
+    if (result_code != ANEURALNETWORKS_NO_ERROR) {
+      reportError(result_code);
     }
 
-    // pre-execution
-    if (!run_) {
-      result_code =
-          libnnapi_.ANeuralNetworksExecution_create(compilation_, &run_);
+    for (int i = 0; i < partition.net.external_input_size(); i++) {
+      const std::string& blob = partition.net.external_input(i);
+      auto shared = shared_tensors_.find(blob);
+      if (shared != shared_tensors_.end()) {
+        result_code = libnnapi_.ANeuralNetworksExecution_setInputFromMemory(
+            execution,
+            i,
+            NULL,
+            shared->second.memory,
+            0,
+            shared->second.nbytes);
+      } else {
+        const auto& tensor = ws_.GetBlob(blob)->Get<TensorCPU>();
+        result_code = libnnapi_.ANeuralNetworksExecution_setInput(
+            execution, i, NULL, tensor.raw_data(), tensor.nbytes());
+      }
       if (result_code != ANEURALNETWORKS_NO_ERROR) {
         reportError(result_code);
       }
-      LOG(INFO) << "Created model execution";
     }
-
-    // set external input and output
-    for (int i = 0; i < inputs.size(); i++) {
-      result_code = libnnapi_.ANeuralNetworksExecution_setInput(
-          run_, i, NULL, inputs[i]->raw_data(), inputs[i]->size());
+    for (int i = 0; i < partition.net.external_output_size(); i++) {
+      const auto& shared = shared_tensors_[partition.net.external_output(i)];
+      result_code = libnnapi_.ANeuralNetworksExecution_setOutputFromMemory(
+          execution, i, NULL, shared.memory, 0, shared.nbytes);
       if (result_code != ANEURALNETWORKS_NO_ERROR) {
         reportError(result_code);
       }
-
-      VLOG(1) << "Set external input " << i << " at " << inputs[i]->raw_data()
-              << ", size = " << inputs[i]->size();
     }
-    // allocate memory for outputs
-    for (int i = 0; i < output_size; i++) {
-      const std::string& blob = run_net_.external_output(i);
-      if (operand_map_.find(blob) == operand_map_.end()) {
-        CAFFE_THROW("Unknown external output, ", blob);
-      }
-      uint32_t idx = operand_map_[blob];
-      if (tensor_dims_.find(blob) == tensor_dims_.end()) {
-        CAFFE_THROW("Operand dimension unknown");
-      }
-      std::vector<int> output_dims;
-      for (auto dim : tensor_dims_[blob]) {
-        output_dims.push_back(dim);
-      }
-
-      auto* tensor = ws_.CreateBlob(blob)->GetMutable<TensorCPU>();
-      tensor->Resize(output_dims);
-      outputs->push_back(tensor);
-
-      if (tensor_type_ == ANEURALNETWORKS_TENSOR_FLOAT32) {
-        result_code = libnnapi_.ANeuralNetworksExecution_setOutput(
-            run_,
-            i,
-            NULL,
-            (void*)tensor->template mutable_data<float>(),
-            tensor->size());
-        if (result_code != ANEURALNETWORKS_NO_ERROR) {
-          reportError(result_code);
-        }
 
-      } else {
-        result_code = libnnapi_.ANeuralNetworksExecution_setOutput(
-            run_,
-            i,
-            NULL,
-            (void*)tensor->template mutable_data<uint8_t>(),
-            tensor->size());
-        if (result_code != ANEURALNETWORKS_NO_ERROR) {
-          reportError(result_code);
-        }
-      }
+    VLOG(1) << "Start compute";
+    result_code =
+        libnnapi_.ANeuralNetworksExecution_startCompute(execution, &event);
+    if (result_code != ANEURALNETWORKS_NO_ERROR) {
+      reportError(result_code);
+    }
+    result_code = libnnapi_.ANeuralNetworksEvent_wait(event);
+    if (result_code != ANEURALNETWORKS_NO_ERROR) {
+      reportError(result_code);
+    }
+    VLOG(1) << "Finish compute";
+  } catch (...) {
+    if (event) {
+      libnnapi_.ANeuralNetworksEvent_free(event);
+    }
+    if (execution) {
+      libnnapi_.ANeuralNetworksExecution_free(execution);
+    }
+    throw;
+  }
+  libnnapi_.ANeuralNetworksEvent_free(event);
+  libnnapi_.ANeuralNetworksExecution_free(execution);
+}
 
-      VLOG(1) << "Set external output " << i << " at " << tensor->raw_data()
-              << ", size = " << tensor->size();
+void NNApi::runCPU(Partition& partition) {
+  CAFFE_ENFORCE(
+      partition.cpu_net->Run(), "Failed to run ", partition.net.name());
+  for (const auto& output : partition.net.external_output()) {
+    if (!nnapi_inputs_.count(output)) {
+      continue;
+    }
+    auto* tensor = ws_.GetBlob(output)->GetMutable<TensorCPU>();
+    auto shared = shared_tensors_.find(output);
+    if (shared == shared_tensors_.end()) {
+      // the operators write in place from the next run on
+      shareTensor(output, tensor->meta());
+    } else if (tensor->raw_data() != shared->second.data) {
+      // an operator that reallocated its output
+      CAFFE_ENFORCE_EQ(tensor->nbytes(), shared->second.nbytes);
+      memcpy(shared->second.data, tensor->raw_data(), tensor->nbytes());
     }
   }
 }
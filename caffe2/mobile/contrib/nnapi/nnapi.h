@@ -3,6 +3,8 @@
 #include "caffe2/core/types.h"
 #include "caffe2/utils/proto_utils.h"
 
+#include <unordered_set>
+
 #include "NeuralNetworks.h"
 #include "dlnnapi.h"
 
@@ -35,23 +37,73 @@ class NNApi {
 
   bool loadNNApiLibrary();
 
+  // Runs run_net_ on inputs, its external inputs in order, and returns its
+  // external outputs in outputs. The operators NN API does not support run
+  // on the CPU: run_net_ is split into runs of consecutive operators, the
+  // partitions, executed each by one NN API model or by the CPU operators.
+  // The models are built and compiled on the first run.
   bool run(const TensorVector& inputs, TensorVector* outputs);
 
+  struct PartitionInfo {
+    bool nnapi;
+    // The operators [first_op, first_op + num_ops) of run_net_
+    int first_op;
+    int num_ops;
+    // Time spent in the partition over all the runs
+    double milliseconds;
+  };
+
+  // The split of run_net_, known after the first run
+  std::vector<PartitionInfo> partitions() const;
+
+  int numRuns() const {
+    return num_runs_;
+  }
+
  private:
+  struct Partition {
+    bool nnapi{false};
+    int first_op{0};
+    // The operators, the blobs they read that are written before the
+    // partition as external inputs, and the blobs they write that are read
+    // after it as external outputs
+    NetDef net;
+    double milliseconds{0};
+    // NN API
+    ANeuralNetworksModel* model{nullptr};
+    ANeuralNetworksCompilation* compilation{nullptr};
+    uint32_t operand_idx{0};
+    std::unordered_map<std::string, uint32_t> operand_map;
+    // CPU
+    NetBase* cpu_net{nullptr};
+  };
+
+  // Memory shared without copies between the CPU and NN API, holding a blob
+  // read or written by NN API at the boundary of two partitions
+  struct SharedTensor {
+    int fd{-1};
+    void* data{nullptr};
+    size_t nbytes{0};
+    ANeuralNetworksMemory* memory{nullptr};
+  };
+
   dlnnapi libnnapi_;
-  ANeuralNetworksModel* model_{nullptr};
-  ANeuralNetworksCompilation* compilation_{nullptr};
-  ANeuralNetworksExecution* run_{nullptr};
-  ANeuralNetworksEvent* run_end_{nullptr};
   StorageOrder order_;
   PreferenceCode preference_;
   NetDef run_net_;
   Workspace ws_;
   OperandCode tensor_type_;
-  uint32_t operand_idx{0};
-  std::unordered_map<std::string, uint32_t> operand_map_;
+  std::vector<Partition> partitions_;
+  // The partition whose model is being built
+  Partition* partition_{nullptr};
+  std::unordered_map<std::string, SharedTensor> shared_tensors_;
+  // The blobs read by the NN API partitions
+  std::unordered_set<std::string> nnapi_inputs_;
+  int num_runs_{0};
   // dimensions for the tensors
   std::unordered_map<std::string, std::vector<uint32_t>> tensor_dims_;
+  // quantization scale and zero point of the tensors
+  std::unordered_map<std::string, std::pair<float, int32_t>> tensor_quant_;
 
   // mapping of the operator name "Conv" to OperatorType CONV
   enum OperatorType {
@@ -93,8 +145,23 @@ class NNApi {
       float scale = 1.0,
       int32_t zero_point = 0);
 
-  // lazily initialize model_ in run()
-  void init(const TensorVector& inputs, TensorVector* outputs);
+  // Whether NN API runs op, as far as its arguments tell
+  bool isSupported(const OperatorDef& op);
+
+  // Splits run_net_ into partitions_
+  void partition();
+
+  // Builds and compiles the model of an NN API partition, or creates the
+  // net of a CPU partition, once its inputs are in ws_
+  void init(Partition& partition);
+
+  void runNNApi(Partition& partition);
+
+  void runCPU(Partition& partition);
+
+  // Moves the blob, of meta and of the size of its tensor in ws_, to shared
+  // memory, keeping its content
+  void shareTensor(const std::string& blob, const TypeMeta& meta);
 
   void addConv(const OperatorDef& op, bool fuse_relu = false);
 
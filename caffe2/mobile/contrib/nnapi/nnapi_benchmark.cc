@@ -336,6 +336,121 @@ static double benchmark_conv_nnapi_int8(
   return double(timer.MilliSeconds()) / run;
 }
 
+// Conv -> Relu -> Sigmoid -> Conv -> Relu, where NN API runs all but the
+// Sigmoid, split into three partitions. Prints the time of the partitions.
+static double benchmark_partitioned_nnapi(
+    Workspace* ws,
+    int N,
+    int C,
+    int H,
+    int W,
+    int kernel,
+    int warmup = 5,
+    int run = 10) {
+  caffe2::Workspace localWs;
+  if (!ws) {
+    ws = &localWs;
+  }
+  {
+    auto* t = ws->CreateBlob("X_cpu")->GetMutable<TensorCPU>();
+    t->Resize(N, H, W, C);
+    CPUContext ctx;
+    math::RandGaussian<float, CPUContext>(
+        t->size(), 0, 30, t->mutable_data<float>(), &ctx);
+  }
+  for (const char* blob : {"W1", "W2"}) {
+    auto* t = ws->CreateBlob(blob)->GetMutable<TensorCPU>();
+    t->Resize(C, kernel, kernel, C);
+    CPUContext ctx;
+    math::RandGaussian<float, CPUContext>(
+        t->size(), 0, 0.1, t->mutable_data<float>(), &ctx);
+  }
+  for (const char* blob : {"B1", "B2"}) {
+    auto* t = ws->CreateBlob(blob)->GetMutable<TensorCPU>();
+    t->Resize(C);
+    CPUContext ctx;
+    math::RandGaussian<float, CPUContext>(
+        t->size(), 0, 1, t->mutable_data<float>(), &ctx);
+  }
+
+  NetDef netdef;
+  {
+    auto addConv = [&](const char* X,
+                       const char* W,
+                       const char* B,
+                       const char* Y) {
+      auto& op = *(netdef.add_op());
+      op.set_type("Conv");
+      op.add_input(X);
+      op.add_input(W);
+      op.add_input(B);
+      op.add_output(Y);
+      {
+        auto& arg = *(op.add_arg());
+        arg.set_name("order");
+        arg.set_s("NHWC");
+      }
+      {
+        auto& arg = *(op.add_arg());
+        arg.set_name("kernel");
+        arg.set_i(kernel);
+      }
+      {
+        auto& arg = *(op.add_arg());
+        arg.set_name("pad");
+        arg.set_i(kernel / 2);
+      }
+    };
+    auto addUnary = [&](const char* type, const char* X, const char* Y) {
+      auto& op = *(netdef.add_op());
+      op.set_type(type);
+      op.add_input(X);
+      op.add_output(Y);
+    };
+    addConv("X_cpu", "W1", "B1", "Y1");
+    addUnary("Relu", "Y1", "Y2");
+    addUnary("Sigmoid", "Y2", "Y3");
+    addConv("Y3", "W2", "B2", "Y4");
+    addUnary("Relu", "Y4", "Y5");
+    netdef.add_external_input("X_cpu");
+    netdef.add_external_input("W1");
+    netdef.add_external_input("B1");
+    netdef.add_external_input("W2");
+    netdef.add_external_input("B2");
+    netdef.add_external_output("Y5");
+  }
+
+  NetDef initNet;
+  NNApi model(initNet, netdef, ws);
+  std::vector<TensorCPU*> inputs, outputs;
+  inputs.push_back(ws->GetBlob("X_cpu")->GetMutable<TensorCPU>());
+  CAFFE_ENFORCE(model.run(inputs, &outputs));
+
+  for (int i = 0; i < warmup; i++) {
+    model.run(inputs, &outputs);
+  }
+  const auto first = model.partitions();
+  Timer timer;
+  timer.Start();
+  for (int i = 0; i < run; i++) {
+    model.run(inputs, &outputs);
+  }
+  const double total = double(timer.MilliSeconds()) / run;
+  const auto last = model.partitions();
+  for (int i = 0; i < last.size(); i++) {
+    const double ms = (last[i].milliseconds - first[i].milliseconds) / run;
+    printf(
+        "  Partition %d: ops [%d, %d) on %s: %.3f ms (%.1f%%)\n",
+        i,
+        last[i].first_op,
+        last[i].first_op + last[i].num_ops,
+        last[i].nnapi ? "NN-API" : "CPU",
+        ms,
+        100 * ms / total);
+  }
+  return total;
+}
+
 } // namespace
 
 } // namespace caffe2
@@ -463,4 +578,15 @@ int main(int argc, char** argv) {
       }
     }
   }
+  fflush(stdout);
+
+  // partial offload, the ops NN API does not support running on the CPU
+  for (int space : {14, 52}) {
+    for (int channel : {32, 128}) {
+      printf("Partitioned: X: %ix%i  \tC: %i\tK: 3x3\n", space, space, channel);
+      const double time = caffe2::benchmark_partitioned_nnapi(
+          &ws, 1, channel, space, space, 3, warmup, mainrun);
+      printf("  Total: %.3f ms\n", time);
+    }
+  }
 }
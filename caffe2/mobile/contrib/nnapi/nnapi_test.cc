@@ -545,6 +545,56 @@ static void test_softmax(int N, int C, int H = 1, int W = 1) {
   checkError(t_cpu, t_nn, 0.01);
 }
 
+// Relu -> Sigmoid -> Relu -> Softmax, where the Sigmoid runs on the CPU
+static void test_partition(int N, int C) {
+  Workspace ws;
+  {
+    auto* t = ws.CreateBlob("X_cpu")->GetMutable<TensorCPU>();
+    t->Resize(N, C);
+    CPUContext ctx;
+    math::RandGaussian<float, CPUContext>(
+        t->size(), 0, 30, t->mutable_data<float>(), &ctx);
+  }
+
+  NetDef netdef;
+  {
+    const std::vector<std::string> types(
+        {"Relu", "Sigmoid", "Relu", "Softmax"});
+    for (int i = 0; i < types.size(); i++) {
+      auto& op = *(netdef.add_op());
+      op.set_type(types[i]);
+      op.add_input(i == 0 ? "X_cpu" : "Y" + caffe2::to_string(i - 1));
+      op.add_output("Y" + caffe2::to_string(i));
+    }
+    netdef.add_external_input("X_cpu");
+    netdef.add_external_output("Y3");
+  }
+
+  ws.RunNetOnce(netdef);
+  // copied, since the CPU operators run by NNApi write to the blobs of ws
+  const TensorCPU t_cpu(ws.GetBlob("Y3")->Get<TensorCPU>());
+
+  // NN API
+  NetDef initNet;
+  NNApi model(initNet, netdef, &ws);
+  std::vector<TensorCPU*> inputs, outputs;
+  inputs.push_back(ws.GetBlob("X_cpu")->GetMutable<TensorCPU>());
+  // the second run reads and writes the shared memory in place
+  for (int run = 0; run < 2; run++) {
+    EXPECT_TRUE(model.run(inputs, &outputs));
+    checkError(t_cpu, *outputs[0], 0.01);
+  }
+
+  const auto partitions = model.partitions();
+  ASSERT_EQ(partitions.size(), 3);
+  EXPECT_TRUE(partitions[0].nnapi);
+  EXPECT_FALSE(partitions[1].nnapi);
+  EXPECT_EQ(partitions[1].first_op, 1);
+  EXPECT_EQ(partitions[1].num_ops, 1);
+  EXPECT_TRUE(partitions[2].nnapi);
+  EXPECT_EQ(partitions[2].num_ops, 2);
+}
+
 TEST(NNApi, TestConv) {
   for (int C : {13, 32}) {
     for (int M : {4, 7, 17}) {
@@ -637,6 +687,11 @@ TEST(NNApi, TestSoftmax) {
   // test_softmax(5, 17, 13, 13);
 }
 
+TEST(NNApi, TestPartition) {
+  test_partition(1, 100);
+  test_partition(2, 17);
+}
+
 } // namespace
 
 } // namespace caffe2
@@ -1,5 +1,6 @@
 
 #include "GLImageAllocator.h"
+#include "GLTexturePool.h"
 #include "arm_neon_support.h"
 
 template <class T>
@@ -11,7 +12,8 @@ GLImageVector<T>* GLImageAllocator<T>::newImage(
     images->push_back(
         new GLImage<T>(width, height, channels, tile_x, tile_y, [&](int slice) -> const GLTexture* {
           bool usePadding = is_output;
-          return new GLPlainTexture(type, nullptr, width * tile_x, height * tile_y, usePadding);
+          return GLTexturePool::getPool()->acquire(
+              type, width * tile_x, height * tile_y, usePadding);
         }));
   }
   return images;
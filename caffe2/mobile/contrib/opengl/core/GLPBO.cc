@@ -14,6 +14,17 @@ GLPBO::~GLPBO() {
     glDeleteFramebuffers(1, &pboFrameBuffer);
     pboFrameBuffer = 0;
   }
+  for (auto& buffer : readBuffers) {
+    if (buffer.fence != nullptr) {
+      glDeleteSync(buffer.fence);
+    }
+    glDeleteBuffers(1, &buffer.id);
+  }
+  readBuffers.clear();
+  if (uploadId != 0) {
+    glDeleteBuffers(1, &uploadId);
+    uploadId = 0;
+  }
 }
 
 GLPBO* GLPBO::pboContext = NULL;
@@ -25,18 +36,7 @@ GLPBO* GLPBO::getContext() {
   return pboContext;
 }
 
-void GLPBO::mapTextureData(GLuint _textureId,
-                           GLsizei _width,
-                           GLsizei _height,
-                           GLsizei _stride,
-                           GLsizei _channels,
-                           const GLTexture::Type& _type,
-                           std::function<void(const void* buffer,
-                                              size_t width,
-                                              size_t height,
-                                              size_t stride,
-                                              size_t channels,
-                                              const GLTexture::Type& type)> process) {
+GLint GLPBO::bindTextureFramebuffer(GLuint _textureId) {
   GLint defaultFramebuffer = 0;
   glGetIntegerv(GL_FRAMEBUFFER_BINDING, &defaultFramebuffer);
 
@@ -55,6 +55,22 @@ void GLPBO::mapTextureData(GLuint _textureId,
     errmsg << ": Frame buffer incomplete: " << fbs;
     throw std::runtime_error(errmsg.str());
   }
+  return defaultFramebuffer;
+}
+
+void GLPBO::mapTextureData(GLuint _textureId,
+                           GLsizei _width,
+                           GLsizei _height,
+                           GLsizei _stride,
+                           GLsizei _channels,
+                           const GLTexture::Type& _type,
+                           std::function<void(const void* buffer,
+                                              size_t width,
+                                              size_t height,
+                                              size_t stride,
+                                              size_t channels,
+                                              const GLTexture::Type& type)> process) {
+  GLint defaultFramebuffer = bindTextureFramebuffer(_textureId);
 
   if (pboId == 0) {
     glGenBuffers(1, &pboId);
@@ -91,3 +107,130 @@ void GLPBO::mapTextureData(GLuint _textureId,
   // Bind to the default FrameBuffer
   glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
 }
+
+int GLPBO::readTextureDataAsync(GLuint _textureId,
+                                GLsizei _width,
+                                GLsizei _height,
+                                GLsizei _stride,
+                                GLsizei _channels,
+                                const GLTexture::Type& _type) {
+  // Reuse the first buffer that is not in flight
+  int ticket = 0;
+  while (ticket < readBuffers.size() && readBuffers[ticket].fence != nullptr) {
+    ticket++;
+  }
+  if (ticket == readBuffers.size()) {
+    readBuffers.emplace_back();
+    glGenBuffers(1, &readBuffers[ticket].id);
+    gl_log(GL_VERBOSE, "created readback PBO buffer %d\n", readBuffers[ticket].id);
+  }
+  ReadBuffer& buffer = readBuffers[ticket];
+
+  GLint defaultFramebuffer = bindTextureFramebuffer(_textureId);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+
+  size_t buffer_size = _stride * _height * _channels * _type.dataSize();
+  if (buffer_size > buffer.size) {
+    LOG(INFO) << "Allocating readback PBO of capacity " << buffer_size;
+
+    glBufferData(GL_PIXEL_PACK_BUFFER, buffer_size, NULL, GL_DYNAMIC_READ);
+    buffer.size = buffer_size;
+  }
+
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glReadPixels(0, 0, _stride, _height, _type.format, _type.type, 0);
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  buffer.width = _width;
+  buffer.height = _height;
+  buffer.stride = _stride;
+  buffer.channels = _channels;
+  buffer.type = &_type;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
+  return ticket;
+}
+
+void GLPBO::mapReadData(int ticket,
+                        std::function<void(const void* buffer,
+                                           size_t width,
+                                           size_t height,
+                                           size_t stride,
+                                           size_t channels,
+                                           const GLTexture::Type& type)> process) {
+  CAFFE_ENFORCE_LT(ticket, readBuffers.size());
+  ReadBuffer& buffer = readBuffers[ticket];
+  CAFFE_ENFORCE(buffer.fence != nullptr, "No readback in flight for ticket ", ticket);
+
+  // Flush the commands on the first wait only, and block until the copy is done
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  GLenum status = GL_TIMEOUT_EXPIRED;
+  while (status == GL_TIMEOUT_EXPIRED) {
+    status = glClientWaitSync(buffer.fence, flags, 1000000 /* 1 ms */);
+    flags = 0;
+  }
+  glDeleteSync(buffer.fence);
+  buffer.fence = nullptr;
+  if (status == GL_WAIT_FAILED) {
+    throw std::runtime_error(": glClientWaitSync failed");
+  }
+
+  const size_t buffer_size =
+      buffer.stride * buffer.height * buffer.channels * buffer.type->dataSize();
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer.id);
+  const void* ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer_size, GL_MAP_READ_BIT);
+  if (ptr) {
+    process(ptr, buffer.width, buffer.height, buffer.stride, buffer.channels, *buffer.type);
+  } else {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    std::stringstream errmsg;
+    errmsg << ": glMapBufferRange using PBO incomplete";
+    throw std::runtime_error(errmsg.str());
+  }
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void GLPBO::uploadTextureData(GLuint _textureId,
+                              GLsizei _width,
+                              GLsizei _height,
+                              GLsizei _channels,
+                              const GLTexture::Type& _type,
+                              std::function<void(void* buffer,
+                                                 size_t width,
+                                                 size_t height,
+                                                 size_t stride,
+                                                 size_t channels,
+                                                 const GLTexture::Type& type)> process) {
+  if (uploadId == 0) {
+    glGenBuffers(1, &uploadId);
+    gl_log(GL_VERBOSE, "created upload PBO buffer %d\n", uploadId);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadId);
+
+  size_t buffer_size = _width * _height * _channels * _type.dataSize();
+  if (buffer_size > uploadSize) {
+    LOG(INFO) << "Allocating upload PBO of capacity " << buffer_size;
+    uploadSize = buffer_size;
+  }
+  // Orphan the storage of the previous upload, which the GPU may still read
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, uploadSize, NULL, GL_STREAM_DRAW);
+
+  void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                               0,
+                               buffer_size,
+                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!ptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    std::stringstream errmsg;
+    errmsg << ": glMapBufferRange using PBO incomplete";
+    throw std::runtime_error(errmsg.str());
+  }
+  process(ptr, _width, _height, _width, _channels, _type);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glBindTexture(GL_TEXTURE_2D, _textureId);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, _type.format, _type.type, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
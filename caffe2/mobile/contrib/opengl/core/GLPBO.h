@@ -3,16 +3,38 @@
 
 #include "GLTexture.h"
 #include <functional>
+#include <vector>
 
 class GLPBO {
   GLuint pboId = 0;
   GLuint pboSize = 0;
   GLuint pboFrameBuffer = 0;
 
+  // The pixel buffers of the asynchronous readbacks, each with the fence
+  // signaled once the GPU has copied its texture
+  struct ReadBuffer {
+    GLuint id = 0;
+    size_t size = 0;
+    GLsync fence = nullptr;
+    GLsizei width = 0;
+    GLsizei height = 0;
+    GLsizei stride = 0;
+    GLsizei channels = 0;
+    const GLTexture::Type* type = nullptr;
+  };
+  std::vector<ReadBuffer> readBuffers;
+
+  // The pixel buffer of the uploads, orphaned by each upload so that it never
+  // waits for the previous one
+  GLuint uploadId = 0;
+  size_t uploadSize = 0;
+
   ~GLPBO();
 
   static GLPBO* pboContext;
 
+  GLint bindTextureFramebuffer(GLuint _textureId);
+
  public:
   void mapTextureData(GLuint _textureId,
                       GLsizei _width,
@@ -27,5 +49,37 @@ class GLPBO {
                                          size_t channels,
                                          const GLTexture::Type& type)> process);
 
+  // Queues the copy of the texture to a pixel buffer and returns its ticket,
+  // without waiting for the GPU. mapReadData(ticket, process) waits for the
+  // copy on its fence, then calls process on the data.
+  int readTextureDataAsync(GLuint _textureId,
+                           GLsizei _width,
+                           GLsizei _height,
+                           GLsizei _stride,
+                           GLsizei _channels,
+                           const GLTexture::Type& type);
+
+  void mapReadData(int ticket,
+                   std::function<void(const void* buffer,
+                                      size_t width,
+                                      size_t height,
+                                      size_t stride,
+                                      size_t channels,
+                                      const GLTexture::Type& type)> process);
+
+  // Fills the texture with the data written by process to a pixel buffer.
+  // The GPU copies the buffer to the texture asynchronously.
+  void uploadTextureData(GLuint _textureId,
+                         GLsizei _width,
+                         GLsizei _height,
+                         GLsizei _channels,
+                         const GLTexture::Type& type,
+                         std::function<void(void* buffer,
+                                            size_t width,
+                                            size_t height,
+                                            size_t stride,
+                                            size_t channels,
+                                            const GLTexture::Type& type)> process);
+
   static GLPBO* getContext();
 };
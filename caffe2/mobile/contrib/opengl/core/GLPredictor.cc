@@ -1,7 +1,9 @@
 
 #include "GLPredictor.h"
 #include "GLContext.h"
+#include "GLPBO.h"
 #include "rewrite_net.h"
+#include <array>
 #include <vector>
 
 namespace caffe2 {
@@ -58,6 +60,103 @@ bool GLPredictor::run(std::vector<GLImageVector<T>*>& inputs,
   return true;
 }
 
+template <class T>
+void GLPredictor::upload(GLImageVector<T>* input,
+                         std::function<void(int image,
+                                            int slice,
+                                            void* buffer,
+                                            size_t width,
+                                            size_t height,
+                                            size_t stride,
+                                            size_t channels,
+                                            const GLTexture::Type& type)> fill) {
+  Timer timer;
+  GLContext::getGLContext()->set_context();
+  for (int i = 0; i < input->size(); i++) {
+    const auto& textures = (*input)[i]->textures;
+    for (int slice = 0; slice < textures.size(); slice++) {
+      textures[slice]->map_load_async([&](void* buffer,
+                                          size_t width,
+                                          size_t height,
+                                          size_t stride,
+                                          size_t channels,
+                                          const GLTexture::Type& type) {
+        fill(i, slice, buffer, width, height, stride, channels, type);
+      });
+    }
+  }
+  stats_.upload_ms += timer.MilliSeconds();
+}
+
+template <class T>
+bool GLPredictor::runPipelined(std::vector<GLImageVector<T>*>& inputs, OutputProcessor process) {
+  if (!pending_ && stats_.frames == 0) {
+    elapsed_.Start();
+  }
+  std::unique_ptr<PendingFrame> frame(new PendingFrame());
+  std::vector<const GLImageVector<T>*> outputs;
+  if (!run(inputs, &outputs)) {
+    return false;
+  }
+  for (int output = 0; output < outputs.size(); output++) {
+    const GLImageVector<T>& images = *outputs[output];
+    for (int i = 0; i < images.size(); i++) {
+      for (int slice = 0; slice < images[i]->slices; slice++) {
+        frame->readbacks.push_back({{output, i, slice, images[i]->textures[slice]->read_async()}});
+      }
+    }
+  }
+  stats_.run_ms += frame->timer.MilliSeconds();
+
+  flush(process);
+  pending_ = std::move(frame);
+  return true;
+}
+
+void GLPredictor::flush(OutputProcessor process) {
+  if (!pending_) {
+    return;
+  }
+  Timer timer;
+  GLPBO* pbo = GLPBO::getContext();
+  for (const auto& readback : pending_->readbacks) {
+    pbo->mapReadData(readback[3],
+                     [&](const void* buffer,
+                         size_t width,
+                         size_t height,
+                         size_t stride,
+                         size_t channels,
+                         const GLTexture::Type& type) {
+                       process(readback[0],
+                               readback[1],
+                               readback[2],
+                               buffer,
+                               width,
+                               height,
+                               stride,
+                               channels,
+                               type);
+                     });
+  }
+  stats_.readback_ms += timer.MilliSeconds();
+  stats_.latency_ms += pending_->timer.MilliSeconds();
+  stats_.elapsed_ms = elapsed_.MilliSeconds();
+  stats_.frames++;
+  pending_.reset();
+}
+
 template bool GLPredictor::run(std::vector<GLImageVector<uint8_t>*>& inputs,
                                std::vector<const GLImageVector<uint8_t>*>* outputs);
+template void GLPredictor::upload(
+    GLImageVector<uint8_t>* input,
+    std::function<void(int image,
+                       int slice,
+                       void* buffer,
+                       size_t width,
+                       size_t height,
+                       size_t stride,
+                       size_t channels,
+                       const GLTexture::Type& type)> fill);
+template bool GLPredictor::runPipelined(std::vector<GLImageVector<uint8_t>*>& inputs,
+                                        OutputProcessor process);
 } // namespace caffe2
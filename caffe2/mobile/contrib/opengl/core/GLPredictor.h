@@ -4,10 +4,48 @@
 #include "GLImage.h"
 #include "caffe2/core/net.h"
 #include "caffe2/core/predictor.h"
+#include "caffe2/core/timer.h"
+
+#include <array>
+#include <functional>
+#include <memory>
 
 namespace caffe2 {
+
+// Counters of the pipelined mode of GLPredictor, in milliseconds
+struct GLPipelineStats {
+  int frames = 0;
+  // CPU time of each stage: filling the input textures, issuing the net, and
+  // waiting for and processing the outputs
+  float upload_ms = 0;
+  float run_ms = 0;
+  float readback_ms = 0;
+  // Sum over the frames of the time from their run to their processed outputs
+  float latency_ms = 0;
+  // From the run of the first frame to the processed outputs of the last one
+  float elapsed_ms = 0;
+
+  float averageLatencyMs() const {
+    return frames > 0 ? latency_ms / frames : 0;
+  }
+  float framesPerSecond() const {
+    return elapsed_ms > 0 ? 1000 * frames / elapsed_ms : 0;
+  }
+};
+
 class GLPredictor : public Predictor {
  public:
+  // Called with the data of a slice of an image of the output of the net
+  using OutputProcessor = std::function<void(int output,
+                                             int image,
+                                             int slice,
+                                             const void* buffer,
+                                             size_t width,
+                                             size_t height,
+                                             size_t stride,
+                                             size_t channels,
+                                             const GLTexture::Type& type)>;
+
   GLPredictor(const NetDef& init_net,
               const NetDef& run_net,
               bool use_texture_input = false,
@@ -16,6 +54,46 @@ class GLPredictor : public Predictor {
   template <class T>
   bool run(std::vector<GLImageVector<T>*>& inputs, std::vector<const GLImageVector<T>*>* outputs);
 
+  // Fills the textures of input through pixel buffers, that the GPU copies
+  // without blocking the CPU, so that the upload of the next frame overlaps
+  // with the run of the current one.
+  template <class T>
+  void upload(GLImageVector<T>* input,
+              std::function<void(int image,
+                                 int slice,
+                                 void* buffer,
+                                 size_t width,
+                                 size_t height,
+                                 size_t stride,
+                                 size_t channels,
+                                 const GLTexture::Type& type)> fill);
+
+  // Pipelined mode for streams of frames: runs the net on the inputs of frame
+  // i and queues the readback of its outputs behind it, then processes the
+  // outputs of frame i - 1, whose readback the GPU did before running frame
+  // i, so only its fence is waited for. The inputs of consecutive frames
+  // should be different images, for the upload of frame i + 1 not to wait for
+  // the run of frame i. flush() processes the outputs of the last frame.
+  template <class T>
+  bool runPipelined(std::vector<GLImageVector<T>*>& inputs, OutputProcessor process);
+
+  void flush(OutputProcessor process);
+
+  const GLPipelineStats& pipelineStats() const {
+    return stats_;
+  }
+
   ~GLPredictor();
+
+ private:
+  struct PendingFrame {
+    // The output, image, slice and readback ticket of the textures
+    std::vector<std::array<int, 4>> readbacks;
+    Timer timer;
+  };
+
+  std::unique_ptr<PendingFrame> pending_;
+  GLPipelineStats stats_;
+  Timer elapsed_;
 };
 } // namespace caffe2
@@ -64,6 +64,21 @@ void GLTexture::map_load(std::function<void(void* buffer,
   free(buffer);
 }
 
+void GLTexture::map_load_async(std::function<void(void* buffer,
+                                                  size_t width,
+                                                  size_t height,
+                                                  size_t stride,
+                                                  size_t channels,
+                                                  const Type& type)> process) const {
+  GLPBO* pbo = GLPBO::getContext();
+  pbo->uploadTextureData(_textureId, _width, _height, _channels, _type, process);
+}
+
+int GLTexture::read_async() const {
+  GLPBO* pbo = GLPBO::getContext();
+  return pbo->readTextureDataAsync(_textureId, _width, _height, _stride, _channels, _type);
+}
+
 void GLTexture::loadData(const void* pixels) const {
   glBindTexture(GL_TEXTURE_2D, _textureId);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, _type.format, _type.type, pixels);
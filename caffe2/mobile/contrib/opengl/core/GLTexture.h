@@ -101,5 +101,18 @@ class GLTexture {
                                            size_t channels,
                                            const Type& type)> process) const;
 
+  // Writes the data through a pixel buffer, which the GPU copies to the
+  // texture without blocking the CPU
+  virtual void map_load_async(std::function<void(void* buffer,
+                                                 size_t width,
+                                                 size_t height,
+                                                 size_t stride,
+                                                 size_t channels,
+                                                 const Type& type)> process) const;
+
+  // Queues the readback of the texture, and returns the ticket to pass
+  // GLPBO::mapReadData once the data is needed
+  int read_async() const;
+
   void loadData(const void* pixels) const;
 };
@@ -0,0 +1,92 @@
+
+#include "GLTexturePool.h"
+
+// A texture of the pool, which wraps the owner of the GL texture and gives
+// it back to the pool when deleted
+class GLTexturePool::PooledTexture : public GLPlainTexture {
+ public:
+  PooledTexture(GLTexturePool* pool,
+                const Key& key,
+                std::unique_ptr<GLPlainTexture> texture,
+                const Type& type,
+                GLsizei width,
+                GLsizei height,
+                bool use_padding)
+      : GLPlainTexture(type, texture->name(), width, height, use_padding),
+        pool_(pool),
+        key_(key),
+        texture_(std::move(texture)) {}
+
+  ~PooledTexture() { pool_->release(key_, std::move(texture_)); }
+
+ private:
+  GLTexturePool* pool_;
+  const Key key_;
+  std::unique_ptr<GLPlainTexture> texture_;
+};
+
+GLTexturePool* GLTexturePool::pool = nullptr;
+
+GLTexturePool* GLTexturePool::getPool() {
+  if (pool == nullptr) {
+    pool = new GLTexturePool();
+  }
+  return pool;
+}
+
+const GLTexture* GLTexturePool::acquire(const GLTexture::Type& type,
+                                        int width,
+                                        int height,
+                                        bool use_padding) {
+  const Key key(type.internalFormat, type.format, type.type, width, height, use_padding);
+  std::unique_ptr<GLPlainTexture> texture;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& textures = free_[key];
+    if (!textures.empty()) {
+      texture = std::move(textures.back());
+      textures.pop_back();
+      reuses_++;
+    } else {
+      allocations_++;
+    }
+  }
+  if (!texture) {
+    texture.reset(new GLPlainTexture(type, nullptr, width, height, use_padding));
+    gl_log(GL_VERBOSE,
+           "GLTexturePool - allocated texture %d of %dx%d\n",
+           texture->name(),
+           width,
+           height);
+  }
+  return new PooledTexture(this, key, std::move(texture), type, width, height, use_padding);
+}
+
+void GLTexturePool::release(const Key& key, std::unique_ptr<GLPlainTexture> texture) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_[key].push_back(std::move(texture));
+}
+
+void GLTexturePool::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_.clear();
+}
+
+size_t GLTexturePool::allocations() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return allocations_;
+}
+
+size_t GLTexturePool::reuses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return reuses_;
+}
+
+size_t GLTexturePool::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (const auto& textures : free_) {
+    size += textures.second.size();
+  }
+  return size;
+}
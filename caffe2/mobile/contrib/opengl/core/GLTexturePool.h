@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include "GLPlainTexture.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+/**
+ * Pool of the plain textures of the OpenGL operators.
+ *
+ * Creating and deleting textures is slow on mobile drivers, and the images
+ * of the operators are created anew on every run. The textures acquired
+ * from the pool go back to it instead of being deleted, keyed by format,
+ * size and padding, and are handed out again to the next image of that
+ * key, so that once every key has been seen a run creates no texture. The
+ * content of a reused texture is undefined.
+ */
+class GLTexturePool {
+ public:
+  static GLTexturePool* getPool();
+
+  // A texture of type and size width x height, padded as GLPlainTexture,
+  // which goes back to the pool when deleted
+  const GLTexture* acquire(const GLTexture::Type& type, int width, int height, bool use_padding);
+
+  // Deletes the textures in the pool. Needs the GL context.
+  void clear();
+
+  // Number of textures created by the pool, and handed out again
+  size_t allocations() const;
+  size_t reuses() const;
+  // Number of textures in the pool
+  size_t size() const;
+
+ private:
+  using Key = std::tuple<GLenum, GLenum, GLenum, int, int, bool>;
+
+  class PooledTexture;
+
+  GLTexturePool() {}
+  void release(const Key& key, std::unique_ptr<GLPlainTexture> texture);
+
+  static GLTexturePool* pool;
+
+  mutable std::mutex mutex_;
+  std::map<Key, std::vector<std::unique_ptr<GLPlainTexture>>> free_;
+  size_t allocations_ = 0;
+  size_t reuses_ = 0;
+};
@@ -2,6 +2,7 @@
 #include "rewrite_net.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/proto_utils.h"
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -169,6 +170,67 @@ static NetDef insertInputOutputCopyOps(const NetDef& def, std::unordered_set<std
   return mdef;
 }
 
+// Frees each texture of the net after its last reader, so that its textures
+// go back to the pool for the later operators of the same run. The blobs
+// written by the OpenGL operators are textures, unless read by a CPU
+// operator; the external outputs are kept.
+static NetDef insertTextureReleaseOps(const NetDef& def, const std::unordered_set<std::string>& glOps) {
+  auto isTextureReader = [&](const OperatorDef& op) {
+    return glOps.count(op.type()) > 0 || op.type() == "CopyFromOpenGL";
+  };
+  std::unordered_set<std::string> externalOutputs(def.external_output().begin(),
+                                                  def.external_output().end());
+  std::unordered_map<size_t, std::vector<std::string>> releases;
+  for (auto i = 0; i < def.op_size(); i++) {
+    const auto& op = def.op(i);
+    if (glOps.count(op.type()) == 0 && op.type() != "CopyToOpenGL") {
+      continue;
+    }
+    for (const auto& output : op.output()) {
+      if (externalOutputs.count(output) > 0) {
+        continue;
+      }
+      int lastReader = -1;
+      bool overwritten = false;
+      bool textureOnly = true;
+      for (auto j = i + 1; j < def.op_size() && !overwritten; j++) {
+        const auto& reader = def.op(j);
+        if (std::find(reader.input().begin(), reader.input().end(), output) != reader.input().end()) {
+          lastReader = j;
+          textureOnly = textureOnly && isTextureReader(reader);
+        }
+        overwritten =
+            std::find(reader.output().begin(), reader.output().end(), output) != reader.output().end();
+      }
+      // The version of an operator running in place is the next one's to free
+      if (lastReader < 0 || !textureOnly ||
+          (overwritten && std::find(def.op(lastReader).output().begin(),
+                                    def.op(lastReader).output().end(),
+                                    output) != def.op(lastReader).output().end())) {
+        continue;
+      }
+      releases[lastReader].push_back(output);
+    }
+  }
+
+  NetDef mdef;
+  mdef.CopyFrom(def);
+  mdef.clear_op();
+  for (auto i = 0; i < def.op_size(); i++) {
+    mdef.add_op()->CopyFrom(def.op(i));
+    if (releases.count(i) > 0) {
+      auto* op = mdef.add_op();
+      op->set_name("OpenGLReleaseTextures");
+      op->set_type("OpenGLReleaseTextures");
+      for (const auto& blob : releases[i]) {
+        op->add_input(blob);
+        op->add_output(blob);
+      }
+    }
+  }
+  return mdef;
+}
+
 static bool tryFuseAdjacentOps(const OperatorDef& currentOp,
                                const OperatorDef& nextOp,
                                OperatorDef* fusedOp,
@@ -340,6 +402,8 @@ NetDef rewritePredictNetForOpenGL(const NetDef& predictNet, bool useTextureInput
     net = insertInputOutputCopyOps(net, openGLOps);
   }
 
+  net = insertTextureReleaseOps(net, openGLOps);
+
   return net;
 }
 
@@ -1,5 +1,6 @@
 
 #include "IOSGLContext.h"
+#include "../core/GLTexturePool.h"
 
 std::unique_ptr<GLContext> GLContext::_glcontext = nullptr;
 
@@ -16,4 +17,8 @@ GLContext* GLContext::getGLContext() {
   return _glcontext.get();
 }
 
-void GLContext::deleteGLContext() { _glcontext.reset(nullptr); }
+void GLContext::deleteGLContext() {
+  // The pooled textures belong to the context
+  GLTexturePool::getPool()->clear();
+  _glcontext.reset(nullptr);
+}
@@ -4,6 +4,7 @@
 #include "../core/GLImage.h"
 #include "../core/GLImageAllocator.h"
 #include "../core/GLPlainTexture.h"
+#include "../core/GLTexturePool.h"
 
 #include "IOSGLContext.h"
 #include "IOSGLTexture.h"
@@ -60,8 +61,8 @@ GLImageVector<T>* IOSGLImageAllocator<T>::newImage(int num_images,
     for (int i = 0; i < num_images; i++) {
       GLImage<T>* image = new GLImage<T>(
           width, height, channels, tile_x, tile_y, [&](int slice) -> const GLTexture* {
-            return new GLPlainTexture(
-                GLImageAllocator<T>::type, nullptr, width * tile_x, height * tile_y);
+            return GLTexturePool::getPool()->acquire(
+                GLImageAllocator<T>::type, width * tile_x, height * tile_y, false);
           });
       output_images->push_back(image);
     }
@@ -43,6 +43,16 @@ class IOSGLTexture : public GLTexture {
                                            size_t channels,
                                            const Type& type)> process) const;
 
+  // The pixel buffer is shared with the GPU, so the data is written in place
+  virtual void map_load_async(std::function<void(void* buffer,
+                                                 size_t width,
+                                                 size_t height,
+                                                 size_t stride,
+                                                 size_t channels,
+                                                 const Type& type)> process) const {
+    map_load(process);
+  }
+
   GLuint name() const { return CVOpenGLESTextureGetName(textureRef); }
   GLenum target() const { return CVOpenGLESTextureGetTarget(textureRef); };
   bool flipped() const { return CVOpenGLESTextureIsFlipped(textureRef); };
@@ -0,0 +1,36 @@
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/operator.h"
+
+#include "../core/GLContext.h"
+
+namespace caffe2 {
+
+// Frees the images of its inputs, whose textures go back to the texture pool
+// for the next operators of the run to reuse
+class OpenGLReleaseTexturesOp final : public Operator<CPUContext> {
+ public:
+  OpenGLReleaseTexturesOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    GLContext::getGLContext()->set_context();
+    for (int i = 0; i < OutputSize(); i++) {
+      Outputs()[i]->Reset();
+    }
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(OpenGLReleaseTextures, OpenGLReleaseTexturesOp);
+OPERATOR_SCHEMA(OpenGLReleaseTextures)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1, INT_MAX)
+    .EnforceInplace([](int in, int out) { return in == out; })
+    .SetDoc(R"DOC(
+Frees the OpenGL images of its inputs, which are also its outputs, once
+their last reader has run. Their textures go back to the texture pool, so
+that the later operators of the net reuse them. Inserted by
+rewritePredictNetForOpenGL.
+)DOC");
+} // namespace caffe2
@@ -4,6 +4,7 @@
 #include "../core/GLContext.h"
 #include "../core/GLImageAllocator.h"
 #include "../core/GLLogging.h"
+#include "../core/GLTexturePool.h"
 #include "../core/ImageAllocator.h"
 #include "../core/arm_neon_support.h"
 #include "../core/rewrite_net.h"
@@ -2400,6 +2401,29 @@ void testGLTextureTypes() {
   gl_log(GL_LOG, "...done with %s\n", __PRETTY_FUNCTION__);
 }
 
+template <typename T>
+void testGLTexturePool() {
+  gl_log(GL_LOG, "Executing %s...\n", __PRETTY_FUNCTION__);
+
+  GLImageAllocator<T>* allocator = GLImageAllocator<T>::newGLImageAllocator();
+  GLTexturePool* pool = GLTexturePool::getPool();
+
+  // The textures of a deleted image are handed out again for the same size
+  delete allocator->newImage(1, 10, 10, 8, 1, 2, true);
+  const size_t allocations = pool->allocations();
+  const size_t reuses = pool->reuses();
+  delete allocator->newImage(1, 10, 10, 8, 1, 2, true);
+  CAFFE_ENFORCE_EQ(pool->allocations(), allocations);
+  CAFFE_ENFORCE_EQ(pool->reuses(), reuses + 1);
+
+  // and not for another one
+  delete allocator->newImage(1, 12, 10, 8, 1, 2, true);
+  CAFFE_ENFORCE_EQ(pool->allocations(), allocations + 1);
+
+  delete allocator;
+  gl_log(GL_LOG, "...done with %s\n", __PRETTY_FUNCTION__);
+}
+
 void testOpenGL() {
   {
     // Test a bunch of different tiled convolutions
@@ -2555,6 +2579,8 @@ void testOpenGL() {
   {
     testGLTextureTypes<uint8_t>();
     testGLTextureTypes<float16_t>();
+    testGLTexturePool<uint8_t>();
+    testGLTexturePool<float16_t>();
 
     testOpenGLCopyOps(1, 4, 4, 4, 1e-2);
     testOpenGLCopyOps(1, 3, 4, 4, 1e-2);
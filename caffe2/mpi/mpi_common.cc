@@ -1,6 +1,9 @@
 #include "caffe2/mpi/mpi_common.h"
 
+#include <chrono>
+#include <condition_variable>
 #include <thread>
+#include <vector>
 
 #include "caffe2/core/typeid.h"
 #include "caffe2/utils/proto_utils.h"
@@ -40,6 +43,103 @@ int MPICommRank(MPI_Comm comm) {
   return comm_rank;
 }
 
+namespace {
+
+// Tests the requests of the nonblocking MPI operations in flight, sleeping
+// while there are none
+class MPIProgressThread {
+ public:
+  MPIProgressThread() : thread_([this] { loop(); }) {
+    // Lives until the process exits, MPI might be finalized by then
+    thread_.detach();
+  }
+
+  void add(MPI_Request request, std::function<void(const char*)> done) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    requests_.push_back(request);
+    callbacks_.push_back(std::move(done));
+    cv_.notify_one();
+  }
+
+ private:
+  void loop() {
+    std::vector<MPI_Request> requests;
+    std::vector<std::function<void(const char*)>> callbacks;
+    std::vector<int> indices;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(
+            lock, [&] { return !requests.empty() || !requests_.empty(); });
+        requests.insert(requests.end(), requests_.begin(), requests_.end());
+        callbacks.insert(
+            callbacks.end(),
+            std::make_move_iterator(callbacks_.begin()),
+            std::make_move_iterator(callbacks_.end()));
+        requests_.clear();
+        callbacks_.clear();
+      }
+
+      indices.resize(requests.size());
+      int count = 0;
+      int error;
+      {
+        std::lock_guard<std::mutex> guard(MPIMutex());
+        error = MPI_Testsome(
+            requests.size(),
+            requests.data(),
+            &count,
+            indices.data(),
+            MPI_STATUSES_IGNORE);
+      }
+      if (error != MPI_SUCCESS) {
+        const auto err_msg = MakeString("MPI_Testsome failed: ", error);
+        for (auto& callback : callbacks) {
+          callback(err_msg.c_str());
+        }
+        requests.clear();
+        callbacks.clear();
+        continue;
+      }
+      if (count == 0 || count == MPI_UNDEFINED) {
+        /* sleep override */
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        continue;
+      }
+      // The completed requests were set to MPI_REQUEST_NULL
+      for (int i = 0; i < count; i++) {
+        callbacks[indices[i]](nullptr);
+      }
+      size_t pending = 0;
+      for (size_t i = 0; i < requests.size(); i++) {
+        if (requests[i] != MPI_REQUEST_NULL) {
+          requests[pending] = requests[i];
+          callbacks[pending] = std::move(callbacks[i]);
+          pending++;
+        }
+      }
+      requests.resize(pending);
+      callbacks.resize(pending);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // Requests added since the thread last looked
+  std::vector<MPI_Request> requests_;
+  std::vector<std::function<void(const char*)>> callbacks_;
+  std::thread thread_;
+};
+
+} // namespace
+
+void MPIAsyncWait(
+    MPI_Request request,
+    std::function<void(const char* err_msg)> done) {
+  static auto* progress = new MPIProgressThread();
+  progress->add(request, std::move(done));
+}
+
 /**
  * Helper function used to setup MPI intercommunicator.
  */
@@ -2,6 +2,7 @@
 #define CAFFE2_MPI_MPI_COMMON_H_
 
 #include <mpi.h>
+#include <functional>
 #include <mutex>
 
 #include "caffe2/core/logging.h"
@@ -67,6 +68,16 @@ int MPICommSize(MPI_Comm comm);
  */
 int MPICommRank(MPI_Comm comm);
 
+/**
+ * @brief Calls done once the nonblocking MPI operation of request completes.
+ *
+ * The pending requests are tested by a progress thread, which calls done
+ * with nullptr on success, or with an error message.
+ */
+void MPIAsyncWait(
+    MPI_Request request,
+    std::function<void(const char* err_msg)> done);
+
 /**
  * @brief A simple wrapper over an MPI common world.
  */
@@ -2,23 +2,35 @@
 
 namespace caffe2 {
 
+namespace {
+
+const char kNonblockingDoc[] =
+    "(bool, default false) On CPU, return once the collective is started and "
+    "finish the op's event when it is done";
+
+} // namespace
+
 OPERATOR_SCHEMA(MPICreateCommonWorld)
   .NumInputs(0)
   .NumOutputs(1);
 OPERATOR_SCHEMA(MPIBroadcast)
   .NumInputs(2)
   .NumOutputs(1)
-  .EnforceInplace({{1, 0}});
+  .EnforceInplace({{1, 0}})
+  .Arg("nonblocking", kNonblockingDoc);
 OPERATOR_SCHEMA(MPIReduce)
   .NumInputs(2)
-  .NumOutputs(1);
+  .NumOutputs(1)
+  .Arg("nonblocking", kNonblockingDoc);
 OPERATOR_SCHEMA(MPIAllgather)
   .NumInputs(2)
-  .NumOutputs(1);
+  .NumOutputs(1)
+  .Arg("nonblocking", kNonblockingDoc);
 OPERATOR_SCHEMA(MPIAllreduce)
   .NumInputs(2)
   .NumOutputs(1)
-  .AllowInplace({{1, 0}});
+  .AllowInplace({{1, 0}})
+  .Arg("nonblocking", kNonblockingDoc);
 OPERATOR_SCHEMA(MPISendTensor);
 OPERATOR_SCHEMA(MPIReceiveTensor);
 
@@ -24,12 +24,53 @@ class MPICreateCommonWorldOp final : public Operator<Context> {
   }
 };
 
+// Base of the collective ops, which block until the collective is done.
+// With the nonblocking argument, CPU ops only start the collective and the
+// MPI progress thread finishes their event once it is done. Async nets run
+// the ops depending on them after that, other nets wait for the event. The
+// inputs and outputs must not be resized until then.
 template <class Context>
-class MPIBroadcastOp final : public Operator<Context> {
+class MPICollectiveOpBase : public Operator<Context> {
+ public:
+  MPICollectiveOpBase(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        nonblocking_(OperatorBase::template GetSingleArgument<bool>(
+            "nonblocking",
+            false)) {
+    const bool cpu = std::is_same<Context, CPUContext>::value;
+    CAFFE_ENFORCE(
+        !nonblocking_ || cpu, "Nonblocking MPI collectives need CPU tensors");
+  }
+
+  bool HasAsyncPart() const override {
+    return nonblocking_ || Operator<Context>::HasAsyncPart();
+  }
+
+ protected:
+  // Runs the blocking collective, or starts the nonblocking one, which
+  // return an MPI error code
+  template <typename Blocking, typename Nonblocking>
+  void runCollective(Blocking blocking, Nonblocking nonblocking) {
+    if (!nonblocking_) {
+      MPI_CHECK(blocking());
+      return;
+    }
+    MPI_Request request;
+    MPI_CHECK(nonblocking(&request));
+    MPIAsyncWait(request, [this](const char* err_msg) {
+      this->event().SetFinished(err_msg);
+    });
+  }
+
+  const bool nonblocking_;
+};
+
+template <class Context>
+class MPIBroadcastOp final : public MPICollectiveOpBase<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   MPIBroadcastOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws),
+      : MPICollectiveOpBase<Context>(operator_def, ws),
         root_(OperatorBase::template GetSingleArgument<int>("root", 0)) {}
   ~MPIBroadcastOp() {}
 
@@ -44,12 +85,22 @@ class MPIBroadcastOp final : public Operator<Context> {
         output->size() > 0,
         "Broadcast op uses in-place operation so the output "
         "should be already allocated.");
-    MPI_CHECK(MPI_Bcast(
-        output->raw_mutable_data(),
-        output->nbytes(),
-        MPIDataTypeWrapper<char>::type(),
-        root_,
-        comm));
+    auto* data = output->raw_mutable_data();
+    const int count = output->nbytes();
+    this->runCollective(
+        [&] {
+          return MPI_Bcast(
+              data, count, MPIDataTypeWrapper<char>::type(), root_, comm);
+        },
+        [&](MPI_Request* request) {
+          return MPI_Ibcast(
+              data,
+              count,
+              MPIDataTypeWrapper<char>::type(),
+              root_,
+              comm,
+              request);
+        });
     return true;
   }
 
@@ -59,11 +110,11 @@ class MPIBroadcastOp final : public Operator<Context> {
 
 // MPIReduceOp does Reduce using MPI. Currently, only SUM is supported.
 template <typename T, class Context>
-class MPIReduceOp final : public Operator<Context> {
+class MPIReduceOp final : public MPICollectiveOpBase<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   MPIReduceOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<Context>(operator_def, ws),
+      : MPICollectiveOpBase<Context>(operator_def, ws),
         root_(OperatorBase::template GetSingleArgument<int>("root", 0)) {}
   ~MPIReduceOp() {}
 
@@ -72,14 +123,31 @@ class MPIReduceOp final : public Operator<Context> {
     auto& input = Input(1);
     auto* output = Output(0);
     output->ResizeLike(input);
-    MPI_CHECK(MPI_Reduce(
-        const_cast<T*>(input.template data<T>()),
-        output->template mutable_data<T>(),
-        input.size(),
-        MPIDataTypeWrapper<T>::type(),
-        MPI_SUM,
-        root_,
-        comm));
+    auto* source = const_cast<T*>(input.template data<T>());
+    auto* destination = output->template mutable_data<T>();
+    const int count = input.size();
+    this->runCollective(
+        [&] {
+          return MPI_Reduce(
+              source,
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              MPI_SUM,
+              root_,
+              comm);
+        },
+        [&](MPI_Request* request) {
+          return MPI_Ireduce(
+              source,
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              MPI_SUM,
+              root_,
+              comm,
+              request);
+        });
     return true;
   }
 
@@ -89,10 +157,11 @@ class MPIReduceOp final : public Operator<Context> {
 
 // MPIAllgatherOp does MPIAllgather using MPI.
 template <typename T, class Context>
-class MPIAllgatherOp final : public Operator<Context> {
+class MPIAllgatherOp final : public MPICollectiveOpBase<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(MPIAllgatherOp);
+  MPIAllgatherOp(const OperatorDef& operator_def, Workspace* ws)
+      : MPICollectiveOpBase<Context>(operator_def, ws) {}
 
   bool RunOnDevice() override {
     MPI_Comm comm = OperatorBase::Input<MPICommonWorldWrapper>(0).comm();
@@ -101,24 +170,42 @@ class MPIAllgatherOp final : public Operator<Context> {
     vector<TIndex> output_dims = input.dims();
     output_dims[0] *= OperatorBase::Input<MPICommonWorldWrapper>(0).size();
     output->Resize(output_dims);
-    MPI_CHECK(MPI_Allgather(
-        const_cast<T*>(input.template data<T>()),
-        input.size(),
-        MPIDataTypeWrapper<T>::type(),
-        output->template mutable_data<T>(),
-        input.size(),
-        MPIDataTypeWrapper<T>::type(),
-        comm));
+    auto* source = const_cast<T*>(input.template data<T>());
+    auto* destination = output->template mutable_data<T>();
+    const int count = input.size();
+    this->runCollective(
+        [&] {
+          return MPI_Allgather(
+              source,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              comm);
+        },
+        [&](MPI_Request* request) {
+          return MPI_Iallgather(
+              source,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              comm,
+              request);
+        });
     return true;
   }
 };
 
 // MPIAllreduceOp does MPIAllreduce using MPI. Currently, only SUM is supported.
 template <typename T, class Context>
-class MPIAllreduceOp final : public Operator<Context> {
+class MPIAllreduceOp final : public MPICollectiveOpBase<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(MPIAllreduceOp);
+  MPIAllreduceOp(const OperatorDef& operator_def, Workspace* ws)
+      : MPICollectiveOpBase<Context>(operator_def, ws) {}
 
   bool RunOnDevice() override {
     MPI_Comm comm = OperatorBase::Input<MPICommonWorldWrapper>(0).comm();
@@ -133,13 +220,28 @@ class MPIAllreduceOp final : public Operator<Context> {
       // Normal allreduce takes the source from the input.
       source = const_cast<T*>(input.template data<T>());
     }
-    MPI_CHECK(MPI_Allreduce(
-        source,
-        output->template mutable_data<T>(),
-        input.size(),
-        MPIDataTypeWrapper<T>::type(),
-        MPI_SUM,
-        comm));
+    auto* destination = output->template mutable_data<T>();
+    const int count = input.size();
+    this->runCollective(
+        [&] {
+          return MPI_Allreduce(
+              source,
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              MPI_SUM,
+              comm);
+        },
+        [&](MPI_Request* request) {
+          return MPI_Iallreduce(
+              source,
+              destination,
+              count,
+              MPIDataTypeWrapper<T>::type(),
+              MPI_SUM,
+              comm,
+              request);
+        });
     return true;
   }
 };
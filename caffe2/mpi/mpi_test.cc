@@ -299,6 +299,78 @@ TEST(MPITest, TestInPlaceMPIAllreduce) {
   }
 }
 
+
+const char kNonblockingMPIAllreduceNet[] = R"NET(
+  name: "allreduce"
+  op {
+    output: "comm"
+    type: "MPICreateCommonWorld"
+  }
+  op {
+    output: "X"
+    type: "ConstantFill"
+    arg {
+      name: "shape"
+      ints: 10
+    }
+    arg {
+      name: "value"
+      f: 0.0
+    }
+  }
+  op {
+    input: "comm"
+    input: "X"
+    output: "X_reduced"
+    type: "MPIAllreduce"
+    arg {
+      name: "nonblocking"
+      i: 1
+    }
+  }
+  op {
+    input: "X_reduced"
+    output: "Y"
+    type: "Scale"
+    arg {
+      name: "scale"
+      f: 2.0
+    }
+  }
+)NET";
+
+TEST(MPITest, TestNonblockingMPIAllreduce) {
+  NetDef net_def;
+  CHECK(TextFormat::ParseFromString(
+      string(kNonblockingMPIAllreduceNet), &net_def));
+  // Let's set the network's constant fill value to be the mpi rank.
+  auto* arg = net_def.mutable_op(1)->mutable_arg(1);
+  CAFFE_ENFORCE_EQ(arg->name(), "value");
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  arg->set_f(rank);
+  int size;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  // Scale only runs once the allreduce is done, whether the net schedules
+  // it after the event of the allreduce or runs the ops one after the other
+  for (const auto& type : {"simple", "async_scheduling"}) {
+    net_def.set_type(type);
+    Workspace ws;
+    unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+    EXPECT_NE(nullptr, net.get());
+    for (int iter = 0; iter < 3; ++iter) {
+      EXPECT_TRUE(net->Run());
+      auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+      EXPECT_EQ(Y.size(), 10);
+      int expected_result = size * (size - 1);
+      for (int i = 0; i < Y.size(); ++i) {
+        EXPECT_EQ(Y.data<float>()[i], expected_result);
+      }
+    }
+  }
+}
+
 }  // namespace caffe2
 
 
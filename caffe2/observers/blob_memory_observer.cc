@@ -0,0 +1,126 @@
+#include "caffe2/observers/blob_memory_observer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "caffe2/core/blob_stats.h"
+
+namespace caffe2 {
+
+BlobMemoryOperatorObserver::BlobMemoryOperatorObserver(
+    OperatorBase* subject,
+    BlobMemoryObserver* net_observer)
+    : ObserverBase<OperatorBase>(subject), net_observer_(net_observer) {}
+
+void BlobMemoryOperatorObserver::Stop() {
+  net_observer_->OperatorStopped(subject_);
+}
+
+BlobMemoryObserver::BlobMemoryObserver(NetBase* subject, int num_peak_blobs)
+    : OperatorAttachingNetObserver<
+          BlobMemoryOperatorObserver,
+          BlobMemoryObserver>(subject, this),
+      num_peak_blobs_(num_peak_blobs) {
+  const auto& operators = subject->GetOperators();
+  op_outputs_.resize(operators.size());
+  for (int i = 0; i < operators.size(); ++i) {
+    auto* op = operators[i];
+    op_index_[op] = i;
+    const bool has_def = op->has_debug_def();
+    for (int j = 0; j < op->InputSize(); ++j) {
+      BlobIndex(
+          op->Inputs()[j],
+          has_def && j < op->debug_def().input_size()
+              ? op->debug_def().input(j)
+              : "");
+    }
+    for (int j = 0; j < op->OutputSize(); ++j) {
+      op_outputs_[i].push_back(BlobIndex(
+          op->Outputs()[j],
+          has_def && j < op->debug_def().output_size()
+              ? op->debug_def().output(j)
+              : ""));
+    }
+  }
+  sizes_.resize(blobs_.size());
+  current_.operator_bytes.resize(operators.size());
+}
+
+int BlobMemoryObserver::BlobIndex(const Blob* blob, const std::string& name) {
+  auto it = blob_index_.find(blob);
+  if (it != blob_index_.end()) {
+    return it->second;
+  }
+  blob_index_[blob] = blobs_.size();
+  blobs_.push_back(blob);
+  blob_names_.push_back(name);
+  return blobs_.size() - 1;
+}
+
+void BlobMemoryObserver::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  total_bytes_ = 0;
+  for (int i = 0; i < blobs_.size(); ++i) {
+    sizes_[i] = BlobStat::sizeBytes(*blobs_[i]);
+    total_bytes_ += sizes_[i];
+  }
+  current_.start_bytes = total_bytes_;
+  current_.peak_bytes = total_bytes_;
+  std::fill(
+      current_.operator_bytes.begin(), current_.operator_bytes.end(), 0);
+  peak_sizes_ = sizes_;
+}
+
+void BlobMemoryObserver::OperatorStopped(const OperatorBase* op) {
+  auto it = op_index_.find(op);
+  if (it == op_index_.end()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int blob : op_outputs_[it->second]) {
+    const size_t size = BlobStat::sizeBytes(*blobs_[blob]);
+    const long delta = static_cast<long>(size) - static_cast<long>(sizes_[blob]);
+    sizes_[blob] = size;
+    total_bytes_ += delta;
+    current_.operator_bytes[it->second] += delta;
+  }
+  if (total_bytes_ > current_.peak_bytes) {
+    current_.peak_bytes = total_bytes_;
+    // A copy of the sizes on new peaks only, the largest blobs are picked
+    // when the run stops
+    peak_sizes_ = sizes_;
+  }
+}
+
+void BlobMemoryObserver::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  current_.end_bytes = total_bytes_;
+  std::vector<int> order(blobs_.size());
+  std::iota(order.begin(), order.end(), 0);
+  const int num_blobs =
+      std::min<int>(std::max(num_peak_blobs_, 0), order.size());
+  std::partial_sort(
+      order.begin(),
+      order.begin() + num_blobs,
+      order.end(),
+      [this](int a, int b) { return peak_sizes_[a] > peak_sizes_[b]; });
+  current_.peak_blobs.clear();
+  for (int i = 0; i < num_blobs && peak_sizes_[order[i]] > 0; ++i) {
+    current_.peak_blobs.emplace_back(
+        blob_names_[order[i]], peak_sizes_[order[i]]);
+  }
+  max_peak_bytes_ = std::max(max_peak_bytes_, current_.peak_bytes);
+  last_ = current_;
+}
+
+BlobMemoryObserver::RunStats BlobMemoryObserver::last_run() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_;
+}
+
+size_t BlobMemoryObserver::max_peak_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_peak_bytes_;
+}
+
+} // namespace caffe2
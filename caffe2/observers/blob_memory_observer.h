@@ -0,0 +1,96 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+
+namespace caffe2 {
+
+class BlobMemoryObserver;
+
+class BlobMemoryOperatorObserver final : public ObserverBase<OperatorBase> {
+ public:
+  BlobMemoryOperatorObserver(
+      OperatorBase* subject,
+      BlobMemoryObserver* net_observer);
+
+ private:
+  void Start() override {}
+  void Stop() override;
+
+  BlobMemoryObserver* net_observer_;
+};
+
+/**
+ * Accounts the memory held by the blobs of a net over every run, as given
+ * by BlobStat::sizeBytes, so for the CPU and the CUDA tensors alike.
+ *
+ * The footprint of the blobs the operators read and write is measured when
+ * the run starts, then updated after every operator from the sizes of its
+ * outputs only, which keeps the observer cheap enough to stay attached. A
+ * run gives its peak bytes, the bytes every operator grew its outputs by,
+ * and the largest blobs at the peak. Memory that isn't held by a blob of
+ * the net, like the scratch buffers of the operators, isn't accounted; see
+ * GpuMemoryObserver for a full profile of the CUDA allocations.
+ */
+class BlobMemoryObserver final : public OperatorAttachingNetObserver<
+                                     BlobMemoryOperatorObserver,
+                                     BlobMemoryObserver> {
+ public:
+  struct RunStats {
+    // Bytes of the blobs of the net when the run starts, at its peak, and
+    // when it ends
+    size_t start_bytes = 0;
+    size_t peak_bytes = 0;
+    size_t end_bytes = 0;
+    // Bytes every operator, in net order, grew its outputs by, negative if
+    // it shrank them
+    std::vector<long> operator_bytes;
+    // The largest blobs at the peak, by decreasing size, and their bytes
+    std::vector<std::pair<std::string, size_t>> peak_blobs;
+  };
+
+  explicit BlobMemoryObserver(NetBase* subject, int num_peak_blobs = 10);
+
+  // Stats of the last finished run
+  RunStats last_run() const;
+  // Peak bytes over all the runs
+  size_t max_peak_bytes() const;
+
+ private:
+  friend class BlobMemoryOperatorObserver;
+
+  void Start() override;
+  void Stop() override;
+
+  void OperatorStopped(const OperatorBase* op);
+  int BlobIndex(const Blob* blob, const std::string& name);
+
+  const int num_peak_blobs_;
+  mutable std::mutex mutex_;
+  std::unordered_map<const OperatorBase*, int> op_index_;
+  // Blobs read or written by the operators, and their names
+  std::vector<const Blob*> blobs_;
+  std::vector<std::string> blob_names_;
+  std::unordered_map<const Blob*, int> blob_index_;
+  // Blobs written by every operator
+  std::vector<std::vector<int>> op_outputs_;
+
+  // Bytes of every blob, now and at the peak of the current run
+  std::vector<size_t> sizes_;
+  std::vector<size_t> peak_sizes_;
+  size_t total_bytes_ = 0;
+  RunStats current_;
+  RunStats last_;
+  size_t max_peak_bytes_ = 0;
+};
+
+} // namespace caffe2
@@ -0,0 +1,376 @@
+#include "chrome_trace_observer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include "caffe2/core/flags.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_chrome_trace_iterations,
+    0,
+    "Number of net runs traced by the ChromeTraceNetObservers from the start "
+    "of the process.");
+CAFFE2_DEFINE_int(
+    caffe2_chrome_trace_every_n,
+    1,
+    "Trace one in every n runs of each net.");
+CAFFE2_DEFINE_int(
+    caffe2_chrome_trace_buffer_size,
+    1 << 16,
+    "Number of events kept per thread, the oldest ones are overwritten.");
+CAFFE2_DEFINE_string(
+    caffe2_chrome_trace_file,
+    "",
+    "If set, the Chrome trace is written to this file once the "
+    "caffe2_chrome_trace_iterations runs are traced.");
+
+namespace caffe2 {
+
+namespace {
+
+struct OpInfo {
+  std::string net_name;
+  int net_position;
+  std::string name;
+  std::string type;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::string> nets;
+  std::vector<OpInfo> ops;
+  std::vector<std::string> counters;
+  std::vector<std::shared_ptr<ChromeTrace::RingBuffer>> buffers;
+};
+
+Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+std::atomic<int64_t> remaining_iterations{0};
+std::atomic<int> every_n{1};
+// Sampled runs that haven't stopped yet
+std::atomic<int> runs_in_flight{0};
+std::once_flag flags_once;
+
+void initFromFlags() {
+  std::call_once(flags_once, []() {
+    remaining_iterations = FLAGS_caffe2_chrome_trace_iterations;
+    every_n = std::max(FLAGS_caffe2_chrome_trace_every_n, 1);
+  });
+}
+
+ChromeTrace::RingBuffer& threadBuffer() {
+  // Owned by the registry too, so that the events of the threads that exited
+  // are still dumped
+  static thread_local std::shared_ptr<ChromeTrace::RingBuffer> buffer;
+  if (!buffer) {
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    buffer = std::make_shared<ChromeTrace::RingBuffer>(
+        std::max(FLAGS_caffe2_chrome_trace_buffer_size, 1), r.buffers.size());
+    r.buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+void writeJsonString(std::ostream& out, const std::string& s) {
+  out << '"';
+  for (char c : s) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out << ' ';
+        } else {
+          out << c;
+        }
+    }
+  }
+  out << '"';
+}
+
+std::string operatorName(const OperatorBase* op) {
+  if (!op->has_debug_def()) {
+    return "unknown";
+  }
+  return op->debug_def().name().empty() ? op->type() : op->debug_def().name();
+}
+
+} // namespace
+
+ChromeTrace::RingBuffer::RingBuffer(size_t capacity, int thread_id)
+    : slots_(new Slot[capacity]), capacity_(capacity), thread_id_(thread_id) {}
+
+void ChromeTrace::RingBuffer::push(const Event& event) {
+  const uint64_t position = head_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[position % capacity_];
+  slot.seq.store(2 * position + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.op_id.store(event.op_id, std::memory_order_relaxed);
+  slot.net_id.store(event.net_id, std::memory_order_relaxed);
+  slot.stream_id.store(event.stream_id, std::memory_order_relaxed);
+  slot.iteration.store(event.iteration, std::memory_order_relaxed);
+  slot.start_ns.store(event.start_ns, std::memory_order_relaxed);
+  slot.end_ns.store(event.end_ns, std::memory_order_relaxed);
+  slot.counter_id.store(event.counter_id, std::memory_order_relaxed);
+  slot.value.store(event.value, std::memory_order_relaxed);
+  slot.seq.store(2 * position + 2, std::memory_order_release);
+  head_.store(position + 1, std::memory_order_release);
+}
+
+std::vector<ChromeTrace::Event> ChromeTrace::RingBuffer::read() const {
+  std::vector<Event> events;
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  uint64_t position = std::max(tail_.load(std::memory_order_acquire),
+                               head > capacity_ ? head - capacity_ : 0);
+  for (; position < head; ++position) {
+    const Slot& slot = slots_[position % capacity_];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * position + 2) {
+      continue;
+    }
+    Event event;
+    event.op_id = slot.op_id.load(std::memory_order_relaxed);
+    event.net_id = slot.net_id.load(std::memory_order_relaxed);
+    event.stream_id = slot.stream_id.load(std::memory_order_relaxed);
+    event.iteration = slot.iteration.load(std::memory_order_relaxed);
+    event.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+    event.end_ns = slot.end_ns.load(std::memory_order_relaxed);
+    event.counter_id = slot.counter_id.load(std::memory_order_relaxed);
+    event.value = slot.value.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip the event if the writer wrapped around while we read it
+    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+      events.push_back(event);
+    }
+  }
+  return events;
+}
+
+void ChromeTrace::RingBuffer::clear() {
+  tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void ChromeTrace::Trace(int iterations, int every) {
+  initFromFlags();
+  every_n = std::max(every, 1);
+  remaining_iterations = iterations;
+}
+
+bool ChromeTrace::Sample(int64_t iteration) {
+  initFromFlags();
+  if (iteration % every_n.load(std::memory_order_relaxed) != 0) {
+    return false;
+  }
+  int64_t remaining = remaining_iterations.load(std::memory_order_relaxed);
+  while (remaining > 0) {
+    if (remaining_iterations.compare_exchange_weak(remaining, remaining - 1)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChromeTrace::Tracing() {
+  initFromFlags();
+  return remaining_iterations.load(std::memory_order_relaxed) > 0;
+}
+
+int64_t ChromeTrace::NowNs() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void ChromeTrace::Record(const Event& event) {
+  threadBuffer().push(event);
+}
+
+int ChromeTrace::RegisterNet(const std::string& name) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  auto it = std::find(r.nets.begin(), r.nets.end(), name);
+  if (it != r.nets.end()) {
+    return it - r.nets.begin();
+  }
+  r.nets.push_back(name);
+  return r.nets.size() - 1;
+}
+
+int ChromeTrace::RegisterOp(
+    const std::string& net_name,
+    int net_position,
+    const std::string& name,
+    const std::string& type) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.ops.push_back(OpInfo{net_name, net_position, name, type});
+  return r.ops.size() - 1;
+}
+
+int ChromeTrace::RegisterCounter(const std::string& name) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.counters.push_back(name);
+  return r.counters.size() - 1;
+}
+
+std::string ChromeTrace::Dump(bool clear) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::ostringstream out;
+  out.precision(3);
+  out << std::fixed << "{\"traceEvents\":[";
+  bool first = true;
+  auto separate = [&]() {
+    if (!first) {
+      out << ",\n";
+    }
+    first = false;
+  };
+  for (size_t net_id = 0; net_id < r.nets.size(); ++net_id) {
+    separate();
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << net_id
+        << ",\"args\":{\"name\":";
+    writeJsonString(out, r.nets[net_id]);
+    out << "}}";
+  }
+  for (const auto& buffer : r.buffers) {
+    for (const auto& event : buffer->read()) {
+      separate();
+      out << "{\"name\":";
+      if (event.counter_id >= 0) {
+        writeJsonString(out, r.counters[event.counter_id]);
+        out << ",\"ph\":\"C\",\"ts\":" << event.start_ns / 1000.0
+            << ",\"pid\":" << event.net_id
+            << ",\"tid\":" << buffer->thread_id() << ",\"args\":{\"value\":"
+            << event.value << "}}";
+        continue;
+      }
+      if (event.op_id >= 0) {
+        const auto& op = r.ops[event.op_id];
+        writeJsonString(out, op.name);
+        out << ",\"cat\":";
+        writeJsonString(out, op.type);
+      } else {
+        writeJsonString(out, r.nets[event.net_id]);
+        out << ",\"cat\":\"net\"";
+      }
+      out << ",\"ph\":\"X\",\"ts\":" << event.start_ns / 1000.0
+          << ",\"dur\":" << (event.end_ns - event.start_ns) / 1000.0
+          << ",\"pid\":" << event.net_id << ",\"tid\":" << buffer->thread_id()
+          << ",\"args\":{\"iteration\":" << event.iteration;
+      if (event.op_id >= 0) {
+        out << ",\"net_position\":" << r.ops[event.op_id].net_position
+            << ",\"stream\":" << event.stream_id;
+      }
+      out << "}}";
+    }
+    if (clear) {
+      buffer->clear();
+    }
+  }
+  out << "],\"displayTimeUnit\":\"ms\"}\n";
+  return out.str();
+}
+
+bool ChromeTrace::WriteTo(const std::string& path, bool clear) {
+  std::ofstream file(path);
+  if (!file) {
+    LOG(ERROR) << "Can't write the Chrome trace to " << path;
+    return false;
+  }
+  file << Dump(clear);
+  return static_cast<bool>(file);
+}
+
+ChromeTraceOperatorObserver::ChromeTraceOperatorObserver(
+    OperatorBase* op,
+    ChromeTraceNetObserver* netObserver)
+    : RNNCapableOperatorObserver(op), netObserver_(netObserver) {
+  CAFFE_ENFORCE(netObserver, "Observers can't operate outside of the net");
+  op_id_ = ChromeTrace::RegisterOp(
+      netObserver->subject()->Name(),
+      op->net_position(),
+      operatorName(op),
+      op->has_debug_def() ? op->type() : "unknown");
+}
+
+ChromeTraceOperatorObserver::ChromeTraceOperatorObserver(
+    OperatorBase* op,
+    const ChromeTraceNetObserver* netObserver,
+    int op_id)
+    : RNNCapableOperatorObserver(op), netObserver_(netObserver), op_id_(op_id) {}
+
+void ChromeTraceOperatorObserver::Start() {
+  iteration_ = netObserver_->sampled_iteration();
+  if (iteration_ >= 0) {
+    start_ns_ = ChromeTrace::NowNs();
+  }
+}
+
+void ChromeTraceOperatorObserver::Stop() {
+  if (iteration_ < 0) {
+    return;
+  }
+  ChromeTrace::Record(ChromeTrace::Event{op_id_,
+                                         netObserver_->net_id(),
+                                         subject_->stream_id(),
+                                         iteration_,
+                                         start_ns_,
+                                         ChromeTrace::NowNs(),
+                                         -1,
+                                         0});
+  iteration_ = -1;
+}
+
+std::unique_ptr<ObserverBase<OperatorBase>>
+ChromeTraceOperatorObserver::rnnCopy(OperatorBase* subject, int rnn_order)
+    const {
+  return std::unique_ptr<ObserverBase<OperatorBase>>(
+      new ChromeTraceOperatorObserver(subject, netObserver_, op_id_));
+}
+
+ChromeTraceNetObserver::ChromeTraceNetObserver(NetBase* subject)
+    : OperatorAttachingNetObserver<
+          ChromeTraceOperatorObserver,
+          ChromeTraceNetObserver>(subject, this),
+      net_id_(ChromeTrace::RegisterNet(subject->Name())) {}
+
+void ChromeTraceNetObserver::Start() {
+  if (ChromeTrace::Sample(iteration_)) {
+    ++runs_in_flight;
+    start_ns_ = ChromeTrace::NowNs();
+    sampled_iteration_.store(iteration_, std::memory_order_release);
+  }
+  ++iteration_;
+}
+
+void ChromeTraceNetObserver::Stop() {
+  const int64_t iteration = sampled_iteration();
+  if (iteration < 0) {
+    return;
+  }
+  ChromeTrace::Record(ChromeTrace::Event{
+      -1, net_id_, 0, iteration, start_ns_, ChromeTrace::NowNs(), -1, 0});
+  sampled_iteration_.store(-1, std::memory_order_release);
+  if (--runs_in_flight == 0 && !ChromeTrace::Tracing() &&
+      !FLAGS_caffe2_chrome_trace_file.empty()) {
+    ChromeTrace::WriteTo(FLAGS_caffe2_chrome_trace_file);
+  }
+}
+
+} // namespace caffe2
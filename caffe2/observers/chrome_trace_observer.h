@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+#include "caffe2/operators/rnn/rnn_capable_operator_observer.h"
+
+namespace caffe2 {
+
+// Records the timeline of the operators of any net type into per thread ring
+// buffers, for the iterations sampled by ChromeTrace::Trace, and dumps it in
+// the Chrome trace event format (chrome://tracing). The observers stay
+// attached in production and only read an atomic flag while not sampling.
+//
+// Every net is a process of the trace, every thread running its operators a
+// thread, and every operator run a complete event with its net, iteration,
+// position in the net and stream in the args. For async nets, an operator
+// event covers the scheduling of its work, not its device computation.
+// Other observers can add counter tracks to the processes of the nets.
+class ChromeTrace {
+ public:
+  struct Event {
+    // Id of ChromeTrace::RegisterOp, or -1 for the run of the net
+    int op_id;
+    int net_id;
+    int stream_id;
+    int64_t iteration;
+    // Nanoseconds since the first event of the process
+    int64_t start_ns;
+    int64_t end_ns;
+    // Id of ChromeTrace::RegisterCounter for a sample of the counter, whose
+    // value is at start_ns, or -1 for a span
+    int counter_id;
+    int64_t value;
+  };
+
+  // Single producer ring buffer of the events of one thread. The owning
+  // thread never blocks; a reader skips the events overwritten while it reads
+  // them.
+  class RingBuffer {
+   public:
+    RingBuffer(size_t capacity, int thread_id);
+
+    void push(const Event& event);
+    // The events still in the buffer, oldest first
+    std::vector<Event> read() const;
+    void clear();
+
+    int thread_id() const {
+      return thread_id_;
+    }
+
+   private:
+    struct Slot {
+      // 2 * position + 1 while the event at position is written, then
+      // 2 * position + 2
+      std::atomic<uint64_t> seq{0};
+      std::atomic<int> op_id{0};
+      std::atomic<int> net_id{0};
+      std::atomic<int> stream_id{0};
+      std::atomic<int64_t> iteration{0};
+      std::atomic<int64_t> start_ns{0};
+      std::atomic<int64_t> end_ns{0};
+      std::atomic<int> counter_id{0};
+      std::atomic<int64_t> value{0};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    const size_t capacity_;
+    const int thread_id_;
+    std::atomic<uint64_t> head_{0};
+    // Events before tail_ are cleared
+    std::atomic<uint64_t> tail_{0};
+  };
+
+  // Samples the next `iterations` runs of the observed nets, one in every_n
+  // of their runs.
+  static void Trace(int iterations, int every_n = 1);
+  // Whether the next run of a net, its iteration-th, is sampled
+  static bool Sample(int64_t iteration);
+  static bool Tracing();
+
+  // The Chrome trace JSON of the events recorded so far, which stay recorded
+  // unless clear
+  static std::string Dump(bool clear = false);
+  // Writes Dump(clear) to the file, returns false if it can't be written
+  static bool WriteTo(const std::string& path, bool clear = false);
+
+  static int64_t NowNs();
+  static void Record(const Event& event);
+
+  // Ids of the names of the nets, operators and counters in the events. The
+  // nets of the same name share their id.
+  static int RegisterNet(const std::string& name);
+  static int RegisterOp(
+      const std::string& net_name,
+      int net_position,
+      const std::string& name,
+      const std::string& type);
+  static int RegisterCounter(const std::string& name);
+};
+
+class ChromeTraceNetObserver;
+class ChromeTraceOperatorObserver final : public RNNCapableOperatorObserver {
+ public:
+  explicit ChromeTraceOperatorObserver(OperatorBase* op) = delete;
+  ChromeTraceOperatorObserver(
+      OperatorBase* op,
+      ChromeTraceNetObserver* netObserver);
+  std::unique_ptr<ObserverBase<OperatorBase>> rnnCopy(
+      OperatorBase* subject,
+      int rnn_order) const override;
+
+ private:
+  ChromeTraceOperatorObserver(
+      OperatorBase* op,
+      const ChromeTraceNetObserver* netObserver,
+      int op_id);
+
+  void Start() override;
+  void Stop() override;
+
+  const ChromeTraceNetObserver* netObserver_;
+  int op_id_;
+  // The sampled iteration the operator runs in, or -1
+  int64_t iteration_ = -1;
+  int64_t start_ns_ = 0;
+};
+
+class ChromeTraceNetObserver final
+    : public OperatorAttachingNetObserver<
+          ChromeTraceOperatorObserver,
+          ChromeTraceNetObserver> {
+ public:
+  explicit ChromeTraceNetObserver(NetBase* subject);
+
+  int net_id() const {
+    return net_id_;
+  }
+
+  // The iteration of the current run, or -1 if it isn't sampled
+  int64_t sampled_iteration() const {
+    return sampled_iteration_.load(std::memory_order_acquire);
+  }
+
+ private:
+  void Start() override;
+  void Stop() override;
+
+  const int net_id_;
+  int64_t iteration_ = 0;
+  std::atomic<int64_t> sampled_iteration_{-1};
+  int64_t start_ns_ = 0;
+};
+
+} // namespace caffe2
@@ -0,0 +1,108 @@
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "chrome_trace_observer.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class ChromeTraceTestOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(ChromeTraceTestOp, ChromeTraceTestOp);
+
+OPERATOR_SCHEMA(ChromeTraceTestOp)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX)
+    .AllowInplace({{0, 0}, {1, 1}});
+
+unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws, const string& type) {
+  NetDef net_def;
+  net_def.set_name("trace_net_" + type);
+  net_def.set_type(type);
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("ChromeTraceTestOp");
+    op.set_name("first");
+    op.add_input("in");
+    op.add_output("hidden");
+  }
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("ChromeTraceTestOp");
+    op.add_input("hidden");
+    op.add_output("out");
+  }
+  net_def.add_external_input("in");
+  net_def.add_external_output("out");
+
+  return CreateNet(net_def, ws);
+}
+
+int Count(const std::string& s, const std::string& pattern) {
+  int count = 0;
+  for (auto pos = s.find(pattern); pos != std::string::npos;
+       pos = s.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+} // namespace
+
+TEST(ChromeTraceObserverTest, TracesSampledIterations) {
+  for (const string type : {"simple", "async_scheduling"}) {
+    Workspace ws;
+    ws.CreateBlob("in");
+    unique_ptr<NetBase> net(CreateNetTestHelper(&ws, type));
+    net->AttachObserver(caffe2::make_unique<ChromeTraceNetObserver>(net.get()));
+    ChromeTrace::Dump(true);
+
+    ChromeTrace::Trace(2, 2);
+    for (int i = 0; i < 6; ++i) {
+      EXPECT_TRUE(net->Run());
+    }
+    EXPECT_FALSE(ChromeTrace::Tracing());
+
+    // Iterations 0 and 2, with their two operators each
+    const auto trace = ChromeTrace::Dump(true);
+    EXPECT_EQ(Count(trace, "\"ph\":\"X\""), 6) << trace;
+    EXPECT_EQ(Count(trace, "\"cat\":\"net\""), 2);
+    EXPECT_EQ(Count(trace, "{\"name\":\"first\",\"cat\":\"ChromeTraceTestOp\""), 2);
+    EXPECT_EQ(Count(trace, "\"iteration\":0"), 3);
+    EXPECT_EQ(Count(trace, "\"iteration\":2"), 3);
+    EXPECT_EQ(Count(trace, "\"iteration\":4"), 0);
+    EXPECT_NE(trace.find("\"name\":\"trace_net_" + type + "\""), string::npos);
+
+    // Cleared by the previous dump
+    EXPECT_EQ(Count(ChromeTrace::Dump(), "\"ph\":\"X\""), 0);
+  }
+}
+
+TEST(ChromeTraceObserverTest, RingBufferKeepsLatestEvents) {
+  ChromeTrace::RingBuffer buffer(4, 0);
+  for (int i = 0; i < 6; ++i) {
+    buffer.push(ChromeTrace::Event{i, 0, 0, i, i, i + 1, -1, 0});
+  }
+  auto events = buffer.read();
+  ASSERT_EQ(events.size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(events[i].op_id, i + 2);
+    EXPECT_EQ(events[i].end_ns, i + 3);
+  }
+  buffer.clear();
+  EXPECT_TRUE(buffer.read().empty());
+  buffer.push(ChromeTrace::Event{7, 0, 0, 0, 0, 1, -1, 0});
+  ASSERT_EQ(buffer.read().size(), 1);
+  EXPECT_EQ(buffer.read()[0].op_id, 7);
+}
+
+} // namespace caffe2
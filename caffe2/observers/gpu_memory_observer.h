@@ -0,0 +1,138 @@
+#ifndef CAFFE2_OBSERVERS_GPU_MEMORY_OBSERVER_H_
+#define CAFFE2_OBSERVERS_GPU_MEMORY_OBSERVER_H_
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+
+namespace caffe2 {
+
+class GpuMemoryObserver;
+
+class GpuMemoryOperatorObserver final : public ObserverBase<OperatorBase> {
+ public:
+  GpuMemoryOperatorObserver(
+      OperatorBase* subject,
+      GpuMemoryObserver* net_observer);
+
+ private:
+  void Start() override;
+  void Stop() override;
+
+  GpuMemoryObserver* net_observer_;
+};
+
+/**
+ * Profiles the GPU memory of the last run of a net.
+ *
+ * Every allocation and free of CUDAContext, including the ones served by
+ * the cub pool, is attributed to the operator of the net running on the
+ * allocating thread. The observer keeps the bytes every operator allocated
+ * and freed, a timeline of the live bytes of every GPU, and the blobs alive
+ * at the peak of every GPU. Blobs are named after the operator outputs
+ * holding the memory, other allocations, like the scratch buffers of the
+ * operators, after the operator allocating them.
+ *
+ * The profile is available as JSON through ToJSON() and as a Chrome trace,
+ * to load in chrome://tracing, through ToChromeTrace().
+ */
+class GpuMemoryObserver final : public OperatorAttachingNetObserver<
+                                    GpuMemoryOperatorObserver,
+                                    GpuMemoryObserver> {
+ public:
+  struct OperatorStats {
+    std::string type;
+    std::string name;
+    long allocated_bytes = 0;
+    long freed_bytes = 0;
+    int num_allocs = 0;
+  };
+
+  // Live bytes of a GPU after an allocation or a free
+  struct Sample {
+    float time_us;
+    int gpu;
+    long live_bytes;
+    // Operator running the allocation or the free, -1 outside of them
+    int op;
+  };
+
+  struct Peak {
+    int gpu = -1;
+    long live_bytes = 0;
+    float time_us = 0;
+    int op = -1;
+    // Blobs alive at the peak, by decreasing size, and their bytes
+    std::vector<std::pair<std::string, long>> blobs;
+  };
+
+  explicit GpuMemoryObserver(NetBase* subject);
+  ~GpuMemoryObserver();
+
+  std::vector<OperatorStats> operator_stats() const;
+  std::vector<Sample> timeline() const;
+  std::vector<Peak> peaks() const;
+
+  std::string ToJSON() const;
+  std::string ToChromeTrace() const;
+
+ private:
+  friend class GpuMemoryOperatorObserver;
+
+  struct Allocation {
+    int gpu;
+    long nbytes;
+    int op;
+    std::string blob;
+    // Samples recording the allocation and the free, -1 if they are not in
+    // the last run
+    int alloc_sample;
+    int free_sample;
+  };
+
+  struct Span {
+    int op;
+    int gpu;
+    int thread;
+    float start_us;
+    float end_us;
+  };
+
+  void Start() override;
+  void Stop() override;
+
+  void OnMemoryEvent(int gpu, const void* ptr, long nbytes, long total);
+  void OperatorStarted(const OperatorBase* op);
+  void OperatorStopped(OperatorBase* op);
+  // Names the allocation holding the CUDA tensor of a blob, recording it if
+  // it is not known and add_missing
+  void RecordBlob(const Blob* blob, const std::string& name, bool add_missing);
+  std::vector<Peak> PeaksLocked() const;
+  std::string AllocationName(const Allocation& allocation) const;
+
+  mutable std::mutex mutex_;
+  int listener_ = -1;
+  std::unordered_map<const OperatorBase*, int> op_index_;
+  Timer timer_;
+  std::vector<OperatorStats> stats_;
+  std::vector<Sample> samples_;
+  std::vector<Allocation> allocations_;
+  std::vector<Span> spans_;
+  // Live allocation of every pointer
+  std::unordered_map<const void*, int> live_;
+  std::unordered_map<std::thread::id, int> threads_;
+  std::vector<float> op_start_us_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OBSERVERS_GPU_MEMORY_OBSERVER_H_
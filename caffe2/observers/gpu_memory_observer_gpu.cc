@@ -0,0 +1,388 @@
+#include "caffe2/observers/gpu_memory_observer.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Operators running on this thread and their observers, innermost last
+thread_local std::vector<std::pair<const GpuMemoryObserver*, int>>
+    running_ops;
+
+std::string JsonString(const std::string& str) {
+  std::ostringstream ss;
+  ss << '"';
+  for (const char c : str) {
+    if (c == '"' || c == '\\') {
+      ss << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+         << static_cast<int>(c) << std::dec;
+    } else {
+      ss << c;
+    }
+  }
+  ss << '"';
+  return ss.str();
+}
+
+int OperatorGpu(const OperatorBase* op) {
+  const auto& option = op->device_option();
+  return option.device_type() == CUDA ? option.cuda_gpu_id() : -1;
+}
+
+} // namespace
+
+GpuMemoryOperatorObserver::GpuMemoryOperatorObserver(
+    OperatorBase* subject,
+    GpuMemoryObserver* net_observer)
+    : ObserverBase<OperatorBase>(subject), net_observer_(net_observer) {}
+
+void GpuMemoryOperatorObserver::Start() {
+  net_observer_->OperatorStarted(subject_);
+}
+
+void GpuMemoryOperatorObserver::Stop() {
+  net_observer_->OperatorStopped(subject_);
+}
+
+GpuMemoryObserver::GpuMemoryObserver(NetBase* subject)
+    : OperatorAttachingNetObserver<GpuMemoryOperatorObserver, GpuMemoryObserver>(
+          subject,
+          this) {
+  const auto& operators = subject->GetOperators();
+  stats_.resize(operators.size());
+  op_start_us_.resize(operators.size());
+  for (int i = 0; i < operators.size(); ++i) {
+    const auto* op = operators[i];
+    op_index_[op] = i;
+    if (op->has_debug_def()) {
+      stats_[i].type = op->debug_def().type();
+      stats_[i].name = op->debug_def().name();
+    }
+  }
+}
+
+GpuMemoryObserver::~GpuMemoryObserver() {
+  if (listener_ >= 0) {
+    RemoveCudaMemoryListener(listener_);
+  }
+}
+
+void GpuMemoryObserver::Start() {
+  // The listener of a run that threw is still there
+  if (listener_ >= 0) {
+    RemoveCudaMemoryListener(listener_);
+    listener_ = -1;
+  }
+  std::set<int> gpus;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& stats : stats_) {
+      stats.allocated_bytes = 0;
+      stats.freed_bytes = 0;
+      stats.num_allocs = 0;
+    }
+    samples_.clear();
+    allocations_.clear();
+    spans_.clear();
+    live_.clear();
+    threads_.clear();
+    timer_.Start();
+    // The blobs of the net allocated before the run
+    for (auto* op : subject_->GetOperators()) {
+      if (!op->has_debug_def()) {
+        continue;
+      }
+      const auto& def = op->debug_def();
+      for (int i = 0; i < op->InputSize(); ++i) {
+        RecordBlob(op->Inputs()[i], def.input(i), true);
+      }
+      for (int i = 0; i < op->OutputSize(); ++i) {
+        RecordBlob(op->Outputs()[i], def.output(i), true);
+      }
+    }
+    for (const auto& allocation : allocations_) {
+      gpus.insert(allocation.gpu);
+    }
+  }
+  // The usage at the start of the run, which includes memory not held by
+  // the blobs of the net
+  std::vector<Sample> initial_samples;
+  for (const int gpu : gpus) {
+    initial_samples.push_back(
+        {0,
+         gpu,
+         static_cast<long>(GetCudaMemoryPoolStats(gpu).allocated_bytes),
+         -1});
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_.insert(
+        samples_.begin(), initial_samples.begin(), initial_samples.end());
+  }
+  listener_ = AddCudaMemoryListener(
+      [this](int gpu, const void* ptr, long nbytes, long total) {
+        OnMemoryEvent(gpu, ptr, nbytes, total);
+      });
+}
+
+void GpuMemoryObserver::Stop() {
+  if (listener_ >= 0) {
+    RemoveCudaMemoryListener(listener_);
+    listener_ = -1;
+  }
+}
+
+void GpuMemoryObserver::OnMemoryEvent(
+    int gpu,
+    const void* ptr,
+    long nbytes,
+    long total) {
+  int op = -1;
+  for (auto it = running_ops.rbegin(); it != running_ops.rend(); ++it) {
+    if (it->first == this) {
+      op = it->second;
+      break;
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int sample = samples_.size();
+  samples_.push_back({timer_.MicroSeconds(), gpu, total, op});
+  if (nbytes > 0) {
+    if (op >= 0) {
+      stats_[op].allocated_bytes += nbytes;
+      ++stats_[op].num_allocs;
+    }
+    live_[ptr] = allocations_.size();
+    allocations_.push_back({gpu, nbytes, op, "", sample, -1});
+  } else {
+    if (op >= 0) {
+      stats_[op].freed_bytes -= nbytes;
+    }
+    auto it = live_.find(ptr);
+    if (it != live_.end()) {
+      allocations_[it->second].free_sample = sample;
+      live_.erase(it);
+    }
+  }
+}
+
+void GpuMemoryObserver::OperatorStarted(const OperatorBase* op) {
+  const int index = op_index_.at(op);
+  running_ops.emplace_back(this, index);
+  std::lock_guard<std::mutex> lock(mutex_);
+  op_start_us_[index] = timer_.MicroSeconds();
+}
+
+void GpuMemoryObserver::OperatorStopped(OperatorBase* op) {
+  const int index = op_index_.at(op);
+  if (!running_ops.empty() && running_ops.back().first == this &&
+      running_ops.back().second == index) {
+    running_ops.pop_back();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto thread =
+      threads_.emplace(std::this_thread::get_id(), threads_.size()).first;
+  spans_.push_back({index,
+                    OperatorGpu(op),
+                    thread->second,
+                    op_start_us_[index],
+                    timer_.MicroSeconds()});
+  // The memory the operator allocated for its outputs is now theirs
+  if (op->has_debug_def()) {
+    const auto& def = op->debug_def();
+    for (int i = 0; i < op->OutputSize(); ++i) {
+      RecordBlob(op->Outputs()[i], def.output(i), false);
+    }
+  }
+}
+
+void GpuMemoryObserver::RecordBlob(
+    const Blob* blob,
+    const std::string& name,
+    bool add_missing) {
+  if (!blob || !blob->IsType<TensorCUDA>()) {
+    return;
+  }
+  const auto& tensor = blob->Get<TensorCUDA>();
+  if (tensor.capacity_nbytes() == 0) {
+    return;
+  }
+  const void* ptr = tensor.raw_data();
+  auto it = live_.find(ptr);
+  if (it != live_.end()) {
+    auto& allocation = allocations_[it->second];
+    if (allocation.blob.empty()) {
+      allocation.blob = name;
+    }
+  } else if (add_missing) {
+    live_[ptr] = allocations_.size();
+    allocations_.push_back({GetGPUIDForPointer(ptr),
+                            static_cast<long>(tensor.capacity_nbytes()),
+                            -1,
+                            name,
+                            -1,
+                            -1});
+  }
+}
+
+std::vector<GpuMemoryObserver::OperatorStats>
+GpuMemoryObserver::operator_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::vector<GpuMemoryObserver::Sample> GpuMemoryObserver::timeline() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return samples_;
+}
+
+std::vector<GpuMemoryObserver::Peak> GpuMemoryObserver::peaks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return PeaksLocked();
+}
+
+std::string GpuMemoryObserver::AllocationName(
+    const Allocation& allocation) const {
+  if (!allocation.blob.empty()) {
+    return allocation.blob;
+  }
+  if (allocation.op < 0) {
+    return "<unknown>";
+  }
+  return MakeString(
+      "<", stats_[allocation.op].type, " #", allocation.op, " workspace>");
+}
+
+std::vector<GpuMemoryObserver::Peak> GpuMemoryObserver::PeaksLocked() const {
+  std::map<int, int> peak_samples;
+  for (int i = 0; i < samples_.size(); ++i) {
+    const auto& sample = samples_[i];
+    auto it = peak_samples.find(sample.gpu);
+    if (it == peak_samples.end() ||
+        samples_[it->second].live_bytes < sample.live_bytes) {
+      peak_samples[sample.gpu] = i;
+    }
+  }
+  std::vector<Peak> peaks;
+  for (const auto& peak_sample : peak_samples) {
+    const int index = peak_sample.second;
+    const auto& sample = samples_[index];
+    Peak peak;
+    peak.gpu = sample.gpu;
+    peak.live_bytes = sample.live_bytes;
+    peak.time_us = sample.time_us;
+    peak.op = sample.op;
+    for (const auto& allocation : allocations_) {
+      if (allocation.gpu == peak.gpu && allocation.alloc_sample <= index &&
+          (allocation.free_sample < 0 || allocation.free_sample > index)) {
+        peak.blobs.emplace_back(AllocationName(allocation), allocation.nbytes);
+      }
+    }
+    std::stable_sort(
+        peak.blobs.begin(),
+        peak.blobs.end(),
+        [](const std::pair<std::string, long>& a,
+           const std::pair<std::string, long>& b) {
+          return a.second > b.second;
+        });
+    peaks.push_back(std::move(peak));
+  }
+  return peaks;
+}
+
+std::string GpuMemoryObserver::ToJSON() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream ss;
+  ss << "{\"net\": " << JsonString(subject_->Name()) << ",\n";
+  ss << "\"operators\": [";
+  for (int i = 0; i < stats_.size(); ++i) {
+    const auto& stats = stats_[i];
+    ss << (i ? ",\n" : "\n") << "{\"index\": " << i
+       << ", \"type\": " << JsonString(stats.type)
+       << ", \"name\": " << JsonString(stats.name)
+       << ", \"allocated_bytes\": " << stats.allocated_bytes
+       << ", \"freed_bytes\": " << stats.freed_bytes
+       << ", \"delta_bytes\": " << stats.allocated_bytes - stats.freed_bytes
+       << ", \"num_allocs\": " << stats.num_allocs << "}";
+  }
+  ss << "],\n\"timeline\": [";
+  for (int i = 0; i < samples_.size(); ++i) {
+    const auto& sample = samples_[i];
+    ss << (i ? ",\n" : "\n") << "{\"time_us\": " << sample.time_us
+       << ", \"gpu\": " << sample.gpu
+       << ", \"live_bytes\": " << sample.live_bytes
+       << ", \"op\": " << sample.op << "}";
+  }
+  ss << "],\n\"peaks\": [";
+  const auto peaks = PeaksLocked();
+  for (int i = 0; i < peaks.size(); ++i) {
+    const auto& peak = peaks[i];
+    ss << (i ? ",\n" : "\n") << "{\"gpu\": " << peak.gpu
+       << ", \"live_bytes\": " << peak.live_bytes
+       << ", \"time_us\": " << peak.time_us << ", \"op\": " << peak.op
+       << ", \"blobs\": [";
+    for (int j = 0; j < peak.blobs.size(); ++j) {
+      ss << (j ? ", " : "") << "{\"name\": " << JsonString(peak.blobs[j].first)
+         << ", \"bytes\": " << peak.blobs[j].second << "}";
+    }
+    ss << "]}";
+  }
+  ss << "]}\n";
+  return ss.str();
+}
+
+std::string GpuMemoryObserver::ToChromeTrace() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream ss;
+  ss << "{\"traceEvents\": [";
+  bool first = true;
+  // The operators are on the row of their GPU, -1 for the CPU, and the
+  // thread running them
+  for (const auto& span : spans_) {
+    const auto& stats = stats_[span.op];
+    ss << (first ? "\n" : ",\n") << "{\"name\": " << JsonString(stats.type)
+       << ", \"cat\": \"operator\", \"ph\": \"X\", \"ts\": " << span.start_us
+       << ", \"dur\": " << span.end_us - span.start_us
+       << ", \"pid\": " << span.gpu << ", \"tid\": " << span.thread
+       << ", \"args\": {\"index\": " << span.op
+       << ", \"name\": " << JsonString(stats.name)
+       << ", \"allocated_bytes\": " << stats.allocated_bytes
+       << ", \"freed_bytes\": " << stats.freed_bytes << "}}";
+    first = false;
+  }
+  for (const auto& sample : samples_) {
+    ss << (first ? "\n" : ",\n")
+       << "{\"name\": \"live_bytes\", \"ph\": \"C\", \"ts\": "
+       << sample.time_us << ", \"pid\": " << sample.gpu
+       << ", \"args\": {\"live_bytes\": " << sample.live_bytes << "}}";
+    first = false;
+  }
+  for (const auto& peak : PeaksLocked()) {
+    std::ostringstream blobs;
+    for (int i = 0; i < peak.blobs.size(); ++i) {
+      blobs << (i ? ", " : "") << "{\"name\": "
+            << JsonString(peak.blobs[i].first)
+            << ", \"bytes\": " << peak.blobs[i].second << "}";
+    }
+    ss << (first ? "\n" : ",\n")
+       << "{\"name\": \"peak\", \"ph\": \"i\", \"s\": \"p\", \"ts\": "
+       << peak.time_us << ", \"pid\": " << peak.gpu
+       << ", \"args\": {\"live_bytes\": " << peak.live_bytes
+       << ", \"blobs\": [" << blobs.str() << "]}}";
+    first = false;
+  }
+  ss << "]}\n";
+  return ss.str();
+}
+
+} // namespace caffe2
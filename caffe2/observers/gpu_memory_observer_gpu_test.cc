@@ -0,0 +1,102 @@
+#include "caffe2/core/common.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/proto_utils.h"
+#include "gpu_memory_observer.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+
+namespace caffe2 {
+
+namespace {
+
+const char kNet[] = R"NET(
+  name: "gpu_memory_test"
+  device_option {
+    device_type: 1
+  }
+  op {
+    output: "X"
+    type: "ConstantFill"
+    arg {
+      name: "shape"
+      ints: 1024
+    }
+    arg {
+      name: "value"
+      f: 1.0
+    }
+  }
+  op {
+    input: "X"
+    output: "Y"
+    type: "Relu"
+  }
+  op {
+    input: "X"
+    input: "Y"
+    output: "Z"
+    type: "Add"
+  }
+)NET";
+
+bool HasBlob(const GpuMemoryObserver::Peak& peak, const std::string& name) {
+  return std::find_if(
+             peak.blobs.begin(),
+             peak.blobs.end(),
+             [&](const std::pair<std::string, long>& blob) {
+               return blob.first == name;
+             }) != peak.blobs.end();
+}
+
+} // namespace
+
+TEST(GpuMemoryObserverTest, AttributesAllocationsToOperators) {
+  if (!HasCudaGPU()) return;
+  Workspace ws;
+  NetDef net_def;
+  CAFFE_ENFORCE(TextFormat::ParseFromString(kNet, &net_def));
+  unique_ptr<NetBase> net(CreateNet(net_def, &ws));
+  auto net_ob = caffe2::make_unique<GpuMemoryObserver>(net.get());
+  const auto* ob = net_ob.get();
+  net->AttachObserver(std::move(net_ob));
+
+  ASSERT_TRUE(net->Run());
+  auto stats = ob->operator_stats();
+  ASSERT_EQ(stats.size(), 3);
+  for (const auto& op_stats : stats) {
+    EXPECT_GE(op_stats.allocated_bytes, 1024 * sizeof(float));
+    EXPECT_GE(op_stats.num_allocs, 1);
+  }
+  EXPECT_EQ(stats[1].type, "Relu");
+  EXPECT_FALSE(ob->timeline().empty());
+  auto peaks = ob->peaks();
+  ASSERT_EQ(peaks.size(), 1);
+  EXPECT_EQ(peaks[0].gpu, 0);
+  EXPECT_GE(peaks[0].live_bytes, 3 * 1024 * sizeof(float));
+  EXPECT_TRUE(HasBlob(peaks[0], "X"));
+  EXPECT_TRUE(HasBlob(peaks[0], "Y"));
+  EXPECT_TRUE(HasBlob(peaks[0], "Z"));
+
+  // The second run reuses the blobs, which are found at the start
+  ASSERT_TRUE(net->Run());
+  stats = ob->operator_stats();
+  for (const auto& op_stats : stats) {
+    EXPECT_EQ(op_stats.allocated_bytes, 0);
+  }
+  peaks = ob->peaks();
+  ASSERT_EQ(peaks.size(), 1);
+  EXPECT_TRUE(HasBlob(peaks[0], "X"));
+  EXPECT_TRUE(HasBlob(peaks[0], "Z"));
+
+  const auto json = ob->ToJSON();
+  EXPECT_NE(json.find("\"operators\""), std::string::npos);
+  EXPECT_NE(json.find("\"peaks\""), std::string::npos);
+  const auto trace = ob->ToChromeTrace();
+  EXPECT_NE(trace.find("\"traceEvents\""), std::string::npos);
+  EXPECT_NE(trace.find("\"Relu\""), std::string::npos);
+}
+
+} // namespace caffe2
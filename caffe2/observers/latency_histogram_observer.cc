@@ -0,0 +1,75 @@
+#include "latency_histogram_observer.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace caffe2 {
+
+namespace {
+const std::string kGroupPrefix = "op_latency/";
+
+std::string operatorType(const OperatorBase* op) {
+  return op->has_debug_def() ? op->type() : "unknown";
+}
+} // namespace
+
+LatencyHistogramOperatorObserver::LatencyStats*
+LatencyHistogramNetObserver::typeStats(const std::string& type) {
+  static std::mutex mutex;
+  static std::unordered_map<
+      std::string,
+      std::unique_ptr<LatencyHistogramOperatorObserver::LatencyStats>>
+      stats;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& type_stats = stats[type];
+  if (!type_stats) {
+    type_stats.reset(
+        new LatencyHistogramOperatorObserver::LatencyStats(kGroupPrefix + type));
+  }
+  return type_stats.get();
+}
+
+LatencyHistogramOperatorObserver::LatencyHistogramOperatorObserver(
+    OperatorBase* op,
+    LatencyHistogramNetObserver* netObserver)
+    : RNNCapableOperatorObserver(op) {
+  CAFFE_ENFORCE(netObserver, "Observers can't operate outside of the net");
+  const auto type = operatorType(op);
+  instance_stats_ = std::make_shared<LatencyStats>(
+      kGroupPrefix + netObserver->subject()->Name() + "/" +
+      caffe2::to_string(op->net_position()) + "_" + type);
+  type_stats_ = LatencyHistogramNetObserver::typeStats(type);
+}
+
+LatencyHistogramOperatorObserver::LatencyHistogramOperatorObserver(
+    OperatorBase* op,
+    const std::shared_ptr<LatencyStats>& instance_stats,
+    LatencyStats* type_stats)
+    : RNNCapableOperatorObserver(op),
+      instance_stats_(instance_stats),
+      type_stats_(type_stats) {}
+
+void LatencyHistogramOperatorObserver::Start() {
+  start_ = std::chrono::steady_clock::now();
+}
+
+void LatencyHistogramOperatorObserver::Stop() {
+  auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start_)
+                   .count();
+  auto& instance_stats = *instance_stats_;
+  auto& type_stats = *type_stats_;
+  CAFFE_EVENT(instance_stats, latency_ns, nanos);
+  CAFFE_EVENT(type_stats, latency_ns, nanos);
+}
+
+std::unique_ptr<ObserverBase<OperatorBase>>
+LatencyHistogramOperatorObserver::rnnCopy(
+    OperatorBase* subject,
+    int rnn_order) const {
+  return std::unique_ptr<ObserverBase<OperatorBase>>(
+      new LatencyHistogramOperatorObserver(
+          subject, instance_stats_, type_stats_));
+}
+
+} // namespace caffe2
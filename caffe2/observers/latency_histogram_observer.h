@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+#include "caffe2/operators/rnn/rnn_capable_operator_observer.h"
+
+namespace caffe2 {
+
+// Keeps latency histograms (in nanoseconds) of every operator of the net,
+// exported through StatRegistry as:
+//   op_latency/<op type>/latency_ns/{count,p50,p90,p99,p999}
+//     for all the operators of the same type, over all observed nets
+//   op_latency/<net name>/<net position>_<op type>/latency_ns/...
+//     for every operator instance of the observed net
+class LatencyHistogramNetObserver;
+class LatencyHistogramOperatorObserver final
+    : public RNNCapableOperatorObserver {
+ public:
+  explicit LatencyHistogramOperatorObserver(OperatorBase* op) = delete;
+  LatencyHistogramOperatorObserver(
+      OperatorBase* op,
+      LatencyHistogramNetObserver* netObserver);
+  std::unique_ptr<ObserverBase<OperatorBase>> rnnCopy(
+      OperatorBase* subject,
+      int rnn_order) const override;
+
+  const HistogramExportedStat& instance_latency() const {
+    return instance_stats_->latency_ns;
+  }
+
+  struct LatencyStats {
+    CAFFE_STAT_CTOR(LatencyStats);
+    CAFFE_HISTOGRAM_EXPORTED_STAT(latency_ns);
+  };
+
+ private:
+  LatencyHistogramOperatorObserver(
+      OperatorBase* op,
+      const std::shared_ptr<LatencyStats>& instance_stats,
+      LatencyStats* type_stats);
+
+  void Start() override;
+  void Stop() override;
+
+  // Shared with the copies of the observer made for RNN step nets
+  std::shared_ptr<LatencyStats> instance_stats_;
+  // Owned by the global per type map, lives until the end of the program
+  LatencyStats* type_stats_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+class LatencyHistogramNetObserver final
+    : public OperatorAttachingNetObserver<
+          LatencyHistogramOperatorObserver,
+          LatencyHistogramNetObserver> {
+ public:
+  explicit LatencyHistogramNetObserver(NetBase* subject)
+      : OperatorAttachingNetObserver<
+            LatencyHistogramOperatorObserver,
+            LatencyHistogramNetObserver>(subject, this) {}
+
+  // Observers of the net's operators, in the order of GetOperators()
+  const std::vector<const LatencyHistogramOperatorObserver*>&
+  operator_observers() const {
+    return operator_observers_;
+  }
+
+  // Latency stats of all the operators of the given type
+  static LatencyHistogramOperatorObserver::LatencyStats* typeStats(
+      const std::string& type);
+
+ private:
+  void Start() override {}
+  void Stop() override {}
+};
+
+} // namespace caffe2
@@ -0,0 +1,79 @@
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "latency_histogram_observer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+namespace caffe2 {
+
+namespace {
+
+class LatencySleepOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(LatencySleepOp, LatencySleepOp);
+
+OPERATOR_SCHEMA(LatencySleepOp)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX)
+    .AllowInplace({{0, 0}, {1, 1}});
+
+unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws) {
+  NetDef net_def;
+  net_def.set_name("latency_net");
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("LatencySleepOp");
+    op.add_input("in");
+    op.add_output("hidden");
+  }
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("LatencySleepOp");
+    op.add_input("hidden");
+    op.add_output("out");
+  }
+  net_def.add_external_input("in");
+  net_def.add_external_output("out");
+
+  return CreateNet(net_def, ws);
+}
+} // namespace
+
+TEST(LatencyHistogramObserverTest, ExportsPercentiles) {
+  Workspace ws;
+  ws.CreateBlob("in");
+  unique_ptr<NetBase> net(CreateNetTestHelper(&ws));
+  auto net_ob = caffe2::make_unique<LatencyHistogramNetObserver>(net.get());
+  const auto* ob = net_ob.get();
+  net->AttachObserver(std::move(net_ob));
+  for (int i = 0; i < 5; ++i) {
+    net->Run();
+  }
+
+  ASSERT_EQ(ob->operator_observers().size(), 2);
+  for (const auto* op_ob : ob->operator_observers()) {
+    EXPECT_EQ(op_ob->instance_latency().count(), 5);
+    EXPECT_GE(op_ob->instance_latency().percentile(0.5), 1900000);
+  }
+
+  auto stats = toMap(StatRegistry::get().publish());
+  EXPECT_EQ(stats["op_latency/LatencySleepOp/latency_ns/count"], 10);
+  const std::string instance_prefix = "op_latency/latency_net/";
+  EXPECT_EQ(stats[instance_prefix + "0_LatencySleepOp/latency_ns/count"], 5);
+  EXPECT_EQ(stats[instance_prefix + "1_LatencySleepOp/latency_ns/count"], 5);
+  EXPECT_GE(stats["op_latency/LatencySleepOp/latency_ns/p99"], 1900000);
+}
+
+} // namespace caffe2
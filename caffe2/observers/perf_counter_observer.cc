@@ -0,0 +1,231 @@
+#include "perf_counter_observer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "chrome_trace_observer.h"
+
+namespace caffe2 {
+
+namespace {
+const std::string kGroupPrefix = "op_perf_counters/";
+
+std::string operatorType(const OperatorBase* op) {
+  return op->has_debug_def() ? op->type() : "unknown";
+}
+
+// Ids of the counter tracks of the Chrome trace
+const std::array<int, PerfCounters::NUM_COUNTERS>& traceCounterIds() {
+  static const auto ids = []() {
+    std::array<int, PerfCounters::NUM_COUNTERS> ids;
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+      ids[i] = ChromeTrace::RegisterCounter(PerfCounters::name(i));
+    }
+    return ids;
+  }();
+  return ids;
+}
+
+#ifdef __linux__
+int openCounter(uint32_t type, uint64_t config, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+  return syscall(
+      __NR_perf_event_open, &attr, 0 /* this thread */, -1, group_fd, 0);
+}
+#endif
+} // namespace
+
+PerfCounters& PerfCounters::thread() {
+  static thread_local PerfCounters counters;
+  return counters;
+}
+
+const char* PerfCounters::name(int counter) {
+  switch (counter) {
+    case CYCLES:
+      return "cycles";
+    case INSTRUCTIONS:
+      return "instructions";
+    case LLC_MISSES:
+      return "llc_misses";
+    case DTLB_MISSES:
+      return "dtlb_misses";
+    default:
+      return "unknown";
+  }
+}
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+  ids_.fill(0);
+#ifdef __linux__
+  const std::array<std::pair<uint32_t, uint64_t>, NUM_COUNTERS> events = {{
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+      {PERF_TYPE_HW_CACHE,
+       PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+  }};
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    fds_[i] = openCounter(events[i].first, events[i].second, group_fd_);
+    if (fds_[i] < 0) {
+      if (i == CYCLES) {
+        VLOG(1) << "Can't open the perf_event counters: "
+                << strerror(errno);
+        return;
+      }
+      continue;
+    }
+    if (ioctl(fds_[i], PERF_EVENT_IOC_ID, &ids_[i]) < 0) {
+      close(fds_[i]);
+      fds_[i] = -1;
+      continue;
+    }
+    if (group_fd_ < 0) {
+      group_fd_ = fds_[i];
+    }
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+#endif
+}
+
+bool PerfCounters::read(Values* values) const {
+  values->fill(0);
+  if (!available()) {
+    return false;
+  }
+#ifdef __linux__
+  // {nr, {value, id} * nr} for PERF_FORMAT_GROUP | PERF_FORMAT_ID
+  uint64_t buffer[1 + 2 * NUM_COUNTERS];
+  if (::read(group_fd_, buffer, sizeof(buffer)) < 0) {
+    return false;
+  }
+  for (uint64_t i = 0; i < buffer[0] && i < NUM_COUNTERS; ++i) {
+    for (int counter = 0; counter < NUM_COUNTERS; ++counter) {
+      if (fds_[counter] >= 0 && ids_[counter] == buffer[2 + 2 * i]) {
+        (*values)[counter] = buffer[1 + 2 * i];
+      }
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+PerfCounterOperatorObserver::PerfCounterOperatorObserver(
+    OperatorBase* op,
+    PerfCounterNetObserver* netObserver)
+    : RNNCapableOperatorObserver(op), netObserver_(netObserver) {
+  CAFFE_ENFORCE(netObserver, "Observers can't operate outside of the net");
+  type_stats_ = PerfCounterNetObserver::typeStats(operatorType(op));
+}
+
+PerfCounterOperatorObserver::PerfCounterOperatorObserver(
+    OperatorBase* op,
+    const PerfCounterNetObserver* netObserver,
+    CounterStats* type_stats)
+    : RNNCapableOperatorObserver(op),
+      netObserver_(netObserver),
+      type_stats_(type_stats) {}
+
+void PerfCounterOperatorObserver::Start() {
+  if (netObserver_->tracing()) {
+    start_ns_ = ChromeTrace::NowNs();
+  }
+  auto& counters = PerfCounters::thread();
+  counters_ = counters.read(&start_values_) ? &counters : nullptr;
+}
+
+void PerfCounterOperatorObserver::Stop() {
+  auto& type_stats = *type_stats_;
+  CAFFE_EVENT(type_stats, runs);
+  PerfCounters::Values values;
+  // Operators that don't stop on the thread they started on aren't counted
+  if (counters_ != &PerfCounters::thread() || !counters_->read(&values)) {
+    return;
+  }
+  for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+    values[i] -= start_values_[i];
+  }
+  CAFFE_EVENT(type_stats, cycles, values[PerfCounters::CYCLES]);
+  CAFFE_EVENT(type_stats, instructions, values[PerfCounters::INSTRUCTIONS]);
+  CAFFE_EVENT(type_stats, llc_misses, values[PerfCounters::LLC_MISSES]);
+  CAFFE_EVENT(type_stats, dtlb_misses, values[PerfCounters::DTLB_MISSES]);
+  if (netObserver_->tracing()) {
+    const auto& counter_ids = traceCounterIds();
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+      ChromeTrace::Record(ChromeTrace::Event{-1,
+                                             netObserver_->net_id(),
+                                             0,
+                                             0,
+                                             start_ns_,
+                                             start_ns_,
+                                             counter_ids[i],
+                                             static_cast<int64_t>(values[i])});
+    }
+  }
+}
+
+std::unique_ptr<ObserverBase<OperatorBase>>
+PerfCounterOperatorObserver::rnnCopy(OperatorBase* subject, int rnn_order)
+    const {
+  return std::unique_ptr<ObserverBase<OperatorBase>>(
+      new PerfCounterOperatorObserver(subject, netObserver_, type_stats_));
+}
+
+PerfCounterNetObserver::PerfCounterNetObserver(NetBase* subject)
+    : OperatorAttachingNetObserver<
+          PerfCounterOperatorObserver,
+          PerfCounterNetObserver>(subject, this),
+      net_id_(ChromeTrace::RegisterNet(subject->Name())) {}
+
+void PerfCounterNetObserver::Start() {
+  tracing_ = ChromeTrace::Tracing();
+}
+
+PerfCounterOperatorObserver::CounterStats* PerfCounterNetObserver::typeStats(
+    const std::string& type) {
+  static std::mutex mutex;
+  static std::unordered_map<
+      std::string,
+      std::unique_ptr<PerfCounterOperatorObserver::CounterStats>>
+      stats;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& type_stats = stats[type];
+  if (!type_stats) {
+    type_stats.reset(
+        new PerfCounterOperatorObserver::CounterStats(kGroupPrefix + type));
+  }
+  return type_stats.get();
+}
+
+} // namespace caffe2
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+#include "caffe2/operators/rnn/rnn_capable_operator_observer.h"
+
+namespace caffe2 {
+
+// Hardware event counters of the calling thread, opened with perf_event_open
+// on its first use as one group counting the user space of the thread. They
+// are unavailable on other systems than Linux, or when the kernel refuses to
+// open them (see /proc/sys/kernel/perf_event_paranoid); a counter the CPU
+// doesn't have is left out of the group and reads 0.
+class PerfCounters {
+ public:
+  enum Counter {
+    CYCLES,
+    INSTRUCTIONS,
+    LLC_MISSES,
+    DTLB_MISSES,
+    NUM_COUNTERS,
+  };
+  using Values = std::array<uint64_t, NUM_COUNTERS>;
+
+  static PerfCounters& thread();
+  static const char* name(int counter);
+
+  ~PerfCounters();
+
+  bool available() const {
+    return group_fd_ >= 0;
+  }
+  bool available(int counter) const {
+    return fds_[counter] >= 0;
+  }
+
+  // The events counted by the thread so far, or false if the counters are
+  // unavailable
+  bool read(Values* values) const;
+
+ private:
+  PerfCounters();
+
+  int group_fd_ = -1;
+  std::array<int, NUM_COUNTERS> fds_;
+  std::array<uint64_t, NUM_COUNTERS> ids_;
+};
+
+// Counts the hardware events of every operator run, on the thread that runs
+// it, exported through StatRegistry for all the operators of the same type
+// over all observed nets as:
+//   op_perf_counters/<op type>/{runs,cycles,instructions,llc_misses,
+//     dtlb_misses}
+// While ChromeTrace samples runs, the events of every operator run are also
+// added to the Chrome trace as counter tracks of the net.
+//
+// For async nets, the counts cover the scheduling of an operator's work, not
+// its device computation.
+class PerfCounterNetObserver;
+class PerfCounterOperatorObserver final : public RNNCapableOperatorObserver {
+ public:
+  explicit PerfCounterOperatorObserver(OperatorBase* op) = delete;
+  PerfCounterOperatorObserver(
+      OperatorBase* op,
+      PerfCounterNetObserver* netObserver);
+  std::unique_ptr<ObserverBase<OperatorBase>> rnnCopy(
+      OperatorBase* subject,
+      int rnn_order) const override;
+
+  struct CounterStats {
+    CAFFE_STAT_CTOR(CounterStats);
+    CAFFE_EXPORTED_STAT(runs);
+    CAFFE_EXPORTED_STAT(cycles);
+    CAFFE_EXPORTED_STAT(instructions);
+    CAFFE_EXPORTED_STAT(llc_misses);
+    CAFFE_EXPORTED_STAT(dtlb_misses);
+  };
+
+ private:
+  PerfCounterOperatorObserver(
+      OperatorBase* op,
+      const PerfCounterNetObserver* netObserver,
+      CounterStats* type_stats);
+
+  void Start() override;
+  void Stop() override;
+
+  const PerfCounterNetObserver* netObserver_;
+  // Owned by the global per type map, lives until the end of the program
+  CounterStats* type_stats_;
+  // The counters of the thread that started the operator, if available
+  const PerfCounters* counters_ = nullptr;
+  PerfCounters::Values start_values_;
+  int64_t start_ns_ = 0;
+};
+
+class PerfCounterNetObserver final
+    : public OperatorAttachingNetObserver<
+          PerfCounterOperatorObserver,
+          PerfCounterNetObserver> {
+ public:
+  explicit PerfCounterNetObserver(NetBase* subject);
+
+  // Id of the net in the Chrome trace
+  int net_id() const {
+    return net_id_;
+  }
+
+  // Whether the operator events of the current run go to the Chrome trace
+  bool tracing() const {
+    return tracing_;
+  }
+
+  // Counter stats of all the operators of the given type
+  static PerfCounterOperatorObserver::CounterStats* typeStats(
+      const std::string& type);
+
+ private:
+  void Start() override;
+  void Stop() override {}
+
+  const int net_id_;
+  std::atomic<bool> tracing_{false};
+};
+
+} // namespace caffe2
@@ -0,0 +1,88 @@
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "perf_counter_observer.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class PerfCounterBusyOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    volatile float sum = 0;
+    for (int i = 0; i < 100000; ++i) {
+      sum += i;
+    }
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(PerfCounterBusyOp, PerfCounterBusyOp);
+
+OPERATOR_SCHEMA(PerfCounterBusyOp)
+    .NumInputs(0, INT_MAX)
+    .NumOutputs(0, INT_MAX)
+    .AllowInplace({{0, 0}, {1, 1}});
+
+unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws) {
+  NetDef net_def;
+  net_def.set_name("perf_counter_net");
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("PerfCounterBusyOp");
+    op.add_input("in");
+    op.add_output("hidden");
+  }
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("PerfCounterBusyOp");
+    op.add_input("hidden");
+    op.add_output("out");
+  }
+  net_def.add_external_input("in");
+  net_def.add_external_output("out");
+
+  return CreateNet(net_def, ws);
+}
+} // namespace
+
+TEST(PerfCounterObserverTest, CountsPerOperatorType) {
+  Workspace ws;
+  ws.CreateBlob("in");
+  unique_ptr<NetBase> net(CreateNetTestHelper(&ws));
+  net->AttachObserver(caffe2::make_unique<PerfCounterNetObserver>(net.get()));
+  for (int i = 0; i < 5; ++i) {
+    net->Run();
+  }
+
+  auto stats = toMap(StatRegistry::get().publish());
+  const std::string prefix = "op_perf_counters/PerfCounterBusyOp/";
+  EXPECT_EQ(stats[prefix + "runs"], 10);
+  // Virtual machines and restricted kernels don't expose the counters
+  const auto& counters = PerfCounters::thread();
+  if (counters.available(PerfCounters::CYCLES)) {
+    EXPECT_GT(stats[prefix + "cycles"], 0);
+  }
+  if (counters.available(PerfCounters::INSTRUCTIONS)) {
+    EXPECT_GT(stats[prefix + "instructions"], 10 * 100000);
+  }
+}
+
+TEST(PerfCounterObserverTest, UnavailableCountersReadZero) {
+  PerfCounters::Values values;
+  bool available = PerfCounters::thread().read(&values);
+  EXPECT_EQ(available, PerfCounters::thread().available());
+  for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+    if (!PerfCounters::thread().available(i)) {
+      EXPECT_EQ(values[i], 0);
+    }
+  }
+}
+
+} // namespace caffe2
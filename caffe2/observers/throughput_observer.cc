@@ -0,0 +1,155 @@
+#include "throughput_observer.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "caffe2/core/blob_stats.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+namespace {
+const std::string kGroupPrefix = "op_throughput/";
+
+std::string operatorType(const OperatorBase* op) {
+  return op->has_debug_def() ? op->type() : "unknown";
+}
+
+int64_t numElements(const Blob& blob) {
+  if (blob.IsType<TensorCPU>()) {
+    return blob.Get<TensorCPU>().size();
+  }
+  // Tensors of the other devices register their shape function
+  auto info = GetTensorInfoFunction(blob.meta().id());
+  if (!info) {
+    return 0;
+  }
+  bool shares_data = false;
+  size_t capacity = 0;
+  DeviceOption device;
+  int64_t size = 1;
+  for (const auto dim : info(blob.GetRaw(), &shares_data, &capacity, &device)) {
+    size *= dim;
+  }
+  return size;
+}
+} // namespace
+
+constexpr int SlidingWindowRate::kWindowSeconds;
+constexpr int SlidingWindowRate::kNumBuckets;
+
+SlidingWindowRate::SlidingWindowRate() {
+  for (int i = 0; i < kNumBuckets; ++i) {
+    values_[i].store(0, std::memory_order_relaxed);
+    seconds_[i].store(-1, std::memory_order_relaxed);
+  }
+}
+
+void SlidingWindowRate::add(int64_t value, int64_t second) {
+  const int index = second % kNumBuckets;
+  auto bucket_second = seconds_[index].load(std::memory_order_acquire);
+  if (bucket_second != second &&
+      seconds_[index].compare_exchange_strong(bucket_second, second)) {
+    values_[index].store(0, std::memory_order_release);
+  }
+  values_[index].fetch_add(value, std::memory_order_relaxed);
+}
+
+double SlidingWindowRate::perSecond(int64_t second) const {
+  int64_t sum = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    const auto bucket_second = seconds_[i].load(std::memory_order_acquire);
+    // The current second isn't complete yet
+    if (bucket_second < second && bucket_second >= second - kWindowSeconds) {
+      sum += values_[i].load(std::memory_order_relaxed);
+    }
+  }
+  return static_cast<double>(sum) / kWindowSeconds;
+}
+
+OperatorThroughputStats::OperatorThroughputStats(const std::string& type)
+    : counters_(kGroupPrefix + type) {
+  StatRegistry::get().addPublisher(this);
+}
+
+OperatorThroughputStats::~OperatorThroughputStats() {
+  StatRegistry::get().removePublisher(this);
+}
+
+void OperatorThroughputStats::add(
+    int64_t input_elements,
+    int64_t output_elements,
+    int64_t input_bytes,
+    int64_t output_bytes) {
+  auto& counters = counters_;
+  CAFFE_EVENT(counters, runs);
+  CAFFE_EVENT(counters, input_elements, input_elements);
+  CAFFE_EVENT(counters, output_elements, output_elements);
+  CAFFE_EVENT(counters, input_bytes, input_bytes);
+  CAFFE_EVENT(counters, output_bytes, output_bytes);
+  elements_.add(input_elements + output_elements);
+  bytes_.add(input_bytes + output_bytes);
+}
+
+void OperatorThroughputStats::publish(
+    ExportedStatList& exported,
+    bool /* reset */) {
+  const auto ts = std::chrono::high_resolution_clock::now();
+  const auto prefix = counters_.groupName + "/";
+  exported.push_back({prefix + "elements_per_sec",
+                      static_cast<int64_t>(elementsPerSecond()),
+                      ts});
+  exported.push_back(
+      {prefix + "bytes_per_sec", static_cast<int64_t>(bytesPerSecond()), ts});
+}
+
+OperatorThroughputStats* ThroughputNetObserver::typeStats(
+    const std::string& type) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<OperatorThroughputStats>>
+      stats;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& type_stats = stats[type];
+  if (!type_stats) {
+    type_stats.reset(new OperatorThroughputStats(type));
+  }
+  return type_stats.get();
+}
+
+ThroughputOperatorObserver::ThroughputOperatorObserver(
+    OperatorBase* op,
+    ThroughputNetObserver* netObserver)
+    : RNNCapableOperatorObserver(op),
+      type_stats_(ThroughputNetObserver::typeStats(operatorType(op))) {
+  CAFFE_ENFORCE(netObserver, "Observers can't operate outside of the net");
+}
+
+ThroughputOperatorObserver::ThroughputOperatorObserver(
+    OperatorBase* op,
+    OperatorThroughputStats* type_stats)
+    : RNNCapableOperatorObserver(op), type_stats_(type_stats) {}
+
+void ThroughputOperatorObserver::Stop() {
+  int64_t input_elements = 0;
+  int64_t output_elements = 0;
+  int64_t input_bytes = 0;
+  int64_t output_bytes = 0;
+  for (const auto* blob : subject_->Inputs()) {
+    input_elements += numElements(*blob);
+    input_bytes += BlobStat::sizeBytes(*blob);
+  }
+  for (const auto* blob : subject_->Outputs()) {
+    output_elements += numElements(*blob);
+    output_bytes += BlobStat::sizeBytes(*blob);
+  }
+  type_stats_->add(input_elements, output_elements, input_bytes, output_bytes);
+}
+
+std::unique_ptr<ObserverBase<OperatorBase>> ThroughputOperatorObserver::rnnCopy(
+    OperatorBase* subject,
+    int rnn_order) const {
+  return std::unique_ptr<ObserverBase<OperatorBase>>(
+      new ThroughputOperatorObserver(subject, type_stats_));
+}
+
+} // namespace caffe2
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/observers/operator_attaching_net_observer.h"
+#include "caffe2/operators/rnn/rnn_capable_operator_observer.h"
+
+namespace caffe2 {
+
+// Sum of the values added over the last kWindowSeconds complete seconds, in
+// buckets of a second. Values added while a bucket is recycled for a new
+// second may be dropped, so the rate is approximate.
+class SlidingWindowRate {
+ public:
+  static constexpr int kWindowSeconds = 10;
+
+  SlidingWindowRate();
+
+  void add(int64_t value) {
+    add(value, now());
+  }
+  void add(int64_t value, int64_t second);
+
+  // Average per second over the window ending before the current second
+  double perSecond() const {
+    return perSecond(now());
+  }
+  double perSecond(int64_t second) const;
+
+ private:
+  static constexpr int kNumBuckets = kWindowSeconds + 1;
+
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  std::array<std::atomic<int64_t>, kNumBuckets> values_;
+  // The second every bucket holds the values of
+  std::array<std::atomic<int64_t>, kNumBuckets> seconds_;
+};
+
+// Counts the elements and bytes read and written by the operators, from the
+// sizes of their input and output tensors after every run, exported through
+// StatRegistry for all the operators of the same type, over all observed
+// nets, as:
+//   op_throughput/<op type>/{runs,input_elements,output_elements,
+//     input_bytes,output_bytes}
+//   op_throughput/<op type>/{elements_per_sec,bytes_per_sec}
+//     the elements and bytes read and written per second, over a sliding
+//     window of the last SlidingWindowRate::kWindowSeconds seconds
+// Unlike sampled timings, every run is counted, so bursts of traffic show.
+class OperatorThroughputStats final : public StatPublisher {
+ public:
+  explicit OperatorThroughputStats(const std::string& type);
+  ~OperatorThroughputStats() override;
+
+  void add(
+      int64_t input_elements,
+      int64_t output_elements,
+      int64_t input_bytes,
+      int64_t output_bytes);
+
+  double elementsPerSecond() const {
+    return elements_.perSecond();
+  }
+  double bytesPerSecond() const {
+    return bytes_.perSecond();
+  }
+
+  void publish(ExportedStatList& exported, bool reset) override;
+
+  struct Counters {
+    CAFFE_STAT_CTOR(Counters);
+    CAFFE_EXPORTED_STAT(runs);
+    CAFFE_EXPORTED_STAT(input_elements);
+    CAFFE_EXPORTED_STAT(output_elements);
+    CAFFE_EXPORTED_STAT(input_bytes);
+    CAFFE_EXPORTED_STAT(output_bytes);
+  };
+
+ private:
+  Counters counters_;
+  SlidingWindowRate elements_;
+  SlidingWindowRate bytes_;
+};
+
+class ThroughputNetObserver;
+class ThroughputOperatorObserver final : public RNNCapableOperatorObserver {
+ public:
+  explicit ThroughputOperatorObserver(OperatorBase* op) = delete;
+  ThroughputOperatorObserver(
+      OperatorBase* op,
+      ThroughputNetObserver* netObserver);
+  std::unique_ptr<ObserverBase<OperatorBase>> rnnCopy(
+      OperatorBase* subject,
+      int rnn_order) const override;
+
+ private:
+  ThroughputOperatorObserver(
+      OperatorBase* op,
+      OperatorThroughputStats* type_stats);
+
+  void Start() override {}
+  void Stop() override;
+
+  // Owned by the global per type map, lives until the end of the program
+  OperatorThroughputStats* type_stats_;
+};
+
+class ThroughputNetObserver final : public OperatorAttachingNetObserver<
+                                        ThroughputOperatorObserver,
+                                        ThroughputNetObserver> {
+ public:
+  explicit ThroughputNetObserver(NetBase* subject)
+      : OperatorAttachingNetObserver<
+            ThroughputOperatorObserver,
+            ThroughputNetObserver>(subject, this) {}
+
+  // Throughput stats of all the operators of the given type
+  static OperatorThroughputStats* typeStats(const std::string& type);
+
+ private:
+  void Start() override {}
+  void Stop() override {}
+};
+
+} // namespace caffe2
@@ -0,0 +1,88 @@
+#include "caffe2/core/common.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/observer.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "throughput_observer.h"
+
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+class ThroughputDoubleOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    auto& input = Input(0);
+    auto* output = Output(0);
+    output->Resize(2, input.size());
+    output->mutable_data<float>();
+    return true;
+  }
+};
+
+REGISTER_CPU_OPERATOR(ThroughputDoubleOp, ThroughputDoubleOp);
+
+OPERATOR_SCHEMA(ThroughputDoubleOp).NumInputs(1).NumOutputs(1);
+
+unique_ptr<NetBase> CreateNetTestHelper(Workspace* ws) {
+  NetDef net_def;
+  net_def.set_name("throughput_net");
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("ThroughputDoubleOp");
+    op.add_input("in");
+    op.add_output("hidden");
+  }
+  {
+    auto& op = *(net_def.add_op());
+    op.set_type("ThroughputDoubleOp");
+    op.add_input("hidden");
+    op.add_output("out");
+  }
+  net_def.add_external_input("in");
+  net_def.add_external_output("out");
+
+  return CreateNet(net_def, ws);
+}
+} // namespace
+
+TEST(ThroughputObserverTest, CountsElementsAndBytes) {
+  Workspace ws;
+  auto* in = ws.CreateBlob("in")->GetMutable<TensorCPU>();
+  in->Resize(10);
+  in->mutable_data<float>();
+  unique_ptr<NetBase> net(CreateNetTestHelper(&ws));
+  net->AttachObserver(caffe2::make_unique<ThroughputNetObserver>(net.get()));
+  for (int i = 0; i < 3; ++i) {
+    net->Run();
+  }
+
+  // Every run reads 10 + 20 and writes 20 + 40 elements
+  auto stats = toMap(StatRegistry::get().publish());
+  const std::string prefix = "op_throughput/ThroughputDoubleOp/";
+  EXPECT_EQ(stats[prefix + "runs"], 6);
+  EXPECT_EQ(stats[prefix + "input_elements"], 90);
+  EXPECT_EQ(stats[prefix + "output_elements"], 180);
+  EXPECT_EQ(stats[prefix + "input_bytes"], 90 * sizeof(float));
+  EXPECT_EQ(stats[prefix + "output_bytes"], 180 * sizeof(float));
+  EXPECT_TRUE(stats.count(prefix + "elements_per_sec"));
+}
+
+TEST(ThroughputObserverTest, SlidingWindowRate) {
+  SlidingWindowRate rate;
+  const int64_t start = 1000;
+  for (int64_t second = start; second < start + 20; ++second) {
+    rate.add(100, second);
+    rate.add(100, second);
+  }
+  // Only the complete seconds of the window count
+  EXPECT_DOUBLE_EQ(rate.perSecond(start + 19), 200);
+  EXPECT_DOUBLE_EQ(
+      rate.perSecond(start + 20 + SlidingWindowRate::kWindowSeconds / 2), 100);
+  EXPECT_DOUBLE_EQ(rate.perSecond(start + 40), 0);
+}
+
+} // namespace caffe2
@@ -1,3 +1,4 @@
+#include "caffe2/core/flags.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/onnx/backend.h"
@@ -14,17 +15,122 @@
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
+CAFFE2_DEFINE_string(
+    caffe2_onnx_cache_dir,
+    "",
+    "If set, Caffe2Backend::Prepare keeps the nets converted from ONNX models "
+    "in this directory, and loads them from there instead of converting the "
+    "same model again.");
+
 namespace caffe2 {
 namespace onnx {
 
 namespace {
 
+// Initializers below this number of elements are converted on the calling
+// thread, as starting threads would cost more than the conversion
+constexpr int kMinParallelInitializerSize = 1 << 16;
+
+// 64 bit FNV-1a, stable across builds unlike std::hash
+uint64_t Fingerprint(
+    const std::string& data,
+    uint64_t hash = 14695981039346656037ULL) {
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The file the nets converted from the model are cached in, empty if the
+// cache is disabled
+std::string ConvertedModelCachePath(
+    const std::string& onnx_model_str,
+    const std::string& device,
+    const std::vector<Caffe2Ops>& extras) {
+  if (FLAGS_caffe2_onnx_cache_dir.empty()) {
+    return "";
+  }
+  // The opset version is part of the model, so of its hash
+  uint64_t hash = Fingerprint(onnx_model_str);
+  hash = Fingerprint(device, hash);
+  for (const auto& c2ops : extras) {
+    for (const auto& op : c2ops.init_ops) {
+      hash = Fingerprint(op.SerializeAsString(), hash);
+    }
+    for (const auto& op : c2ops.ops) {
+      hash = Fingerprint(op.SerializeAsString(), hash);
+    }
+    for (const auto& blob : c2ops.interface_blobs) {
+      hash = Fingerprint(blob, hash);
+    }
+  }
+  std::ostringstream path;
+  path << FLAGS_caffe2_onnx_cache_dir << "/onnx_" << std::hex << hash << "_"
+       << onnx_model_str.size() << ".pb";
+  return path.str();
+}
+
+// A converted model is kept as a plan of the init net, the predict net, and a
+// net whose external inputs are the uninitialized inputs
+bool ReadConvertedModel(const std::string& path, Caffe2BackendRep* rep) {
+  PlanDef plan;
+  {
+    std::ifstream file(path);
+    if (!file.good()) {
+      return false;
+    }
+  }
+  if (!ReadProtoFromBinaryFile(path, &plan) || plan.network_size() != 3) {
+    LOG(WARNING) << "Ignoring bad ONNX conversion cache file " << path;
+    return false;
+  }
+  rep->init_net().Swap(plan.mutable_network(0));
+  rep->pred_net().Swap(plan.mutable_network(1));
+  const auto& inputs = plan.network(2).external_input();
+  rep->uninitialized_inputs().assign(inputs.begin(), inputs.end());
+  return true;
+}
+
+void WriteConvertedModel(
+    const std::string& path,
+    const Caffe2BackendRep& rep) {
+  PlanDef plan;
+  plan.set_name("onnx_conversion_cache");
+  *plan.add_network() = rep.init_net();
+  *plan.add_network() = rep.pred_net();
+  auto* inputs = plan.add_network()->mutable_external_input();
+  for (const auto& input : rep.uninitialized_inputs()) {
+    inputs->Add()->assign(input);
+  }
+  // Written aside and renamed, so that replicas loading the model at the same
+  // time never see a partial file
+  const std::string tmp_path =
+      path + ".tmp" + caffe2::to_string(std::random_device()());
+  try {
+    WriteProtoToBinaryFile(plan, tmp_path);
+  } catch (const std::exception& e) {
+    LOG(WARNING) << "Cannot write ONNX conversion cache file " << tmp_path
+                 << ": " << e.what();
+    return;
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Cannot write ONNX conversion cache file " << path;
+    std::remove(tmp_path.c_str());
+  }
+}
+
 constexpr static int kKnownOpsetVersion = 6;
 
 bool AlmostEqual(double a, double b) {
@@ -881,12 +987,17 @@ Caffe2Ops Caffe2Backend::CommonOnnxNodeToCaffe2Ops(
 Caffe2Ops Caffe2Backend::ConvertNode(
     const std::string& node_str,
     int opset_version) {
-  ::google::protobuf::RepeatedPtrField<NodeProto> nodes;
-  auto* n = nodes.Add();
-  ParseProtoFromLargeString(node_str, n);
+  NodeProto node;
+  ParseProtoFromLargeString(node_str, &node);
+  return ConvertNode(node, opset_version);
+}
+
+Caffe2Ops Caffe2Backend::ConvertNode(
+    const NodeProto& node,
+    int opset_version) {
   ModelProto init_model;
   ModelProto pred_model;
-  OnnxNode onnx_node = OnnxNode(nodes.Get(0));
+  OnnxNode onnx_node = OnnxNode(node);
   return OnnxNodeToCaffe2Ops(init_model, pred_model, &onnx_node, opset_version);
 }
 
@@ -927,10 +1038,7 @@ void Caffe2Backend::OnnxToCaffe2(
 
   // Convert initializer if necessary
   if (include_initializers) {
-    for (const auto& tp : onnx_model.graph().initializer()) {
-      auto* c2_op = init_net->add_op();
-      BuildTensorFillingOp(c2_op, tp);
-    }
+    BuildInitializerFillingOps(init_net, onnx_model.graph());
   }
 
   auto name_set = AllNamesInGraph(init_model.graph());
@@ -996,6 +1104,13 @@ Caffe2BackendRep* Caffe2Backend::Prepare(
     const std::string& device,
     const std::vector<Caffe2Ops>& extras) {
   Caffe2BackendRep* rep = new Caffe2BackendRep();
+  const std::string cache_path =
+      ConvertedModelCachePath(onnx_model_str, device, extras);
+  if (!cache_path.empty() && ReadConvertedModel(cache_path, rep)) {
+    VLOG(1) << "Loaded the converted ONNX model from " << cache_path;
+    return rep;
+  }
+
   ModelProto onnx_model;
   ParseProtoFromLargeString(onnx_model_str, &onnx_model);
 
@@ -1053,9 +1168,63 @@ Caffe2BackendRep* Caffe2Backend::Prepare(
     }
   }
 
+  if (!cache_path.empty()) {
+    WriteConvertedModel(cache_path, *rep);
+  }
   return rep;
 }
 
+void Caffe2Backend::BuildInitializerFillingOps(
+    caffe2::NetDef* init_net,
+    const GraphProto& graph) {
+  const int begin = init_net->op_size();
+  const int num_tensors = graph.initializer_size();
+  size_t total_size = 0;
+  for (const auto& tp : graph.initializer()) {
+    total_size += tp.raw_data().size() + tp.float_data_size() +
+        tp.int32_data_size() + tp.int64_data_size() + tp.double_data_size();
+  }
+  for (int i = 0; i < num_tensors; ++i) {
+    init_net->add_op();
+  }
+  // Every tensor is converted independently, on the op allocated for it
+  auto convert = [&](int first, int last) {
+    for (int i = first; i < last; ++i) {
+      BuildTensorFillingOp(
+          init_net->mutable_op(begin + i), graph.initializer(i));
+    }
+  };
+  const int num_threads = std::min<int>(
+      std::max(1U, std::thread::hardware_concurrency()),
+      std::min<size_t>(num_tensors, total_size / kMinParallelInitializerSize));
+  if (num_threads <= 1) {
+    convert(0, num_tensors);
+    return;
+  }
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      try {
+        // Interleaved, so that large tensors next to each other are spread
+        for (int i = t; i < num_tensors; i += num_threads) {
+          convert(i, i + 1);
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 void Caffe2Backend::BuildTensorFillingOp(
     caffe2::OperatorDef* c2_op,
     const TensorProto& onnx_tensor,
@@ -113,6 +113,9 @@ class Caffe2Backend {
 
   Caffe2Ops ConvertNode(const std::string& node_str, int opset_version);
 
+  // Same as above, without serializing the node
+  Caffe2Ops ConvertNode(const NodeProto& node, int opset_version);
+
  private:
   using SpecialOpConverter = Caffe2Ops (Caffe2Backend::*)(OnnxNode*, int);
 
@@ -133,6 +136,12 @@ class Caffe2Backend {
 
   std::unordered_set<std::string> AllNamesInGraph(const GraphProto& graph);
 
+  // Converts the initializers of graph to fill ops appended to init_net,
+  // spreading the tensors over several threads
+  void BuildInitializerFillingOps(
+      caffe2::NetDef* init_net,
+      const GraphProto& graph);
+
   void BuildTensorFillingOp(
       caffe2::OperatorDef* c2_op,
       const TensorProto& onnx_tensor,
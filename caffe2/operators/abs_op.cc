@@ -35,6 +35,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Abs)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
 Calculates the absolute value of the given input tensor, element-wise.
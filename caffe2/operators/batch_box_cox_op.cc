@@ -2,6 +2,7 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/perfkernels/math.h"
 
 #ifdef CAFFE2_USE_MKL
 #include <mkl.h>
@@ -211,7 +212,7 @@ bool BatchBoxCoxOp<CPUContext>::DoRunWithType() {
     }
   }
 #else // CAFFE2_USE_MKL
-  BoxCoxNaive(N, D, data_ptr, lambda1_ptr, lambda2_ptr, k_eps, output_ptr);
+  BoxCox(N, D, data_ptr, lambda1_ptr, lambda2_ptr, k_eps, output_ptr);
 #endif // CAFFE2_USE_MKL
   return true;
 }
@@ -240,6 +241,59 @@ void BatchBoxCoxOp<CPUContext>::BoxCoxNaive(
   }
 }
 
+template <>
+void BatchBoxCoxOp<CPUContext>::BoxCox(
+    TIndex N,
+    TIndex D,
+    const float* data_ptr,
+    const float* lambda1_ptr,
+    const float* lambda2_ptr,
+    float k_eps,
+    float* output_ptr) {
+  // Process K rows at a time, so that narrow rows still fill the vectors.
+  const TIndex K =
+      min_block_size_ < 1 ? 1 : std::min(N, (min_block_size_ + D - 1) / D);
+  TIndex i = 0;
+  if (K > 1) {
+    tiled_lambda1_.resize(K * D);
+    tiled_lambda2_.resize(K * D);
+    for (TIndex k = 0; k < K; k++) {
+      std::copy(lambda1_ptr, lambda1_ptr + D, tiled_lambda1_.begin() + k * D);
+      std::copy(lambda2_ptr, lambda2_ptr + D, tiled_lambda2_.begin() + k * D);
+    }
+    const TIndex num_blocks = N / K;
+    VectorizedBoxCox(
+        num_blocks,
+        K * D,
+        data_ptr,
+        tiled_lambda1_.data(),
+        tiled_lambda2_.data(),
+        k_eps,
+        output_ptr);
+    i = num_blocks * K;
+  }
+  VectorizedBoxCox(
+      N - i,
+      D,
+      data_ptr + i * D,
+      lambda1_ptr,
+      lambda2_ptr,
+      k_eps,
+      output_ptr + i * D);
+}
+
+template <>
+void BatchBoxCoxOp<CPUContext>::BoxCox(
+    TIndex N,
+    TIndex D,
+    const double* data_ptr,
+    const double* lambda1_ptr,
+    const double* lambda2_ptr,
+    double k_eps,
+    double* output_ptr) {
+  BoxCoxNaive(N, D, data_ptr, lambda1_ptr, lambda2_ptr, k_eps, output_ptr);
+}
+
 #ifdef CAFFE2_USE_MKL
 
 template <>
@@ -333,6 +387,11 @@ the transform of each column `x` of the input `data`:
     ((x + lambda2)^lambda1 - 1)/lambda1, if lambda1 != 0
 
 )DOC")
+    .Arg(
+        "min_block_size",
+        "Rows narrower than this are transformed min_block_size / D at a time, "
+        "with the parameters repeated for every row, so that short rows are "
+        "still vectorized. Defaults to 256, and values below 1 disable it")
     .Input(0, "data", "input float or double N * D matrix")
     .Input(1, "lambda1", "tensor of size D with the same type as data")
     .Input(2, "lambda2", "tensor of size D with the same type as data")
@@ -35,6 +35,28 @@ class BatchBoxCoxOp final : public Operator<Context> {
       T k_eps,
       T* output_ptr);
 
+  // Float goes through the vectorized kernel of perfkernels, K rows at a time
+  // when they are narrower than min_block_size, double through BoxCoxNaive
+  void BoxCox(
+      TIndex N,
+      TIndex D,
+      const float* data_ptr,
+      const float* lambda1_ptr,
+      const float* lambda2_ptr,
+      float k_eps,
+      float* output_ptr);
+  void BoxCox(
+      TIndex N,
+      TIndex D,
+      const double* data_ptr,
+      const double* lambda1_ptr,
+      const double* lambda2_ptr,
+      double k_eps,
+      double* output_ptr);
+
+  // lambda1 and lambda2 repeated for the blocks of rows of BoxCox
+  vector<float> tiled_lambda1_, tiled_lambda2_;
+
 #ifdef CAFFE2_USE_MKL
   template <typename T>
   void BoxCoxNonzeroLambda(
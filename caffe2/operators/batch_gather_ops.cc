@@ -46,6 +46,10 @@ Example:
       [4.5, 1.2],
   ]
 )DOC")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace thread pool to "
+        "split the batches between, 0 uses all of them.")
     .Input(0, "DATA", "Tensor of rank r >= 2.")
     .Input(1, "INDICES", "Tensor of int32/int64 indices, of any rank q.")
     .Output(0, "OUTPUT", "Tensor of rank (q - 1) + (r - 1).");
@@ -1,9 +1,14 @@
 #ifndef CAFFE2_OPERATORS_BATCH_GATHER_OPS_H_
 #define CAFFE2_OPERATORS_BATCH_GATHER_OPS_H_
 
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/perfkernels/gather.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -11,7 +16,13 @@ template <class Context>
 class BatchGatherOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(BatchGatherOp)
+  BatchGatherOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(
+            OperatorBase::GetSingleArgument<int>("num_threads", 1)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
@@ -42,26 +53,71 @@ class BatchGatherOp final : public Operator<Context> {
     auto src_base = static_cast<const char*>(data.raw_data());
     auto out = static_cast<char*>(output->raw_mutable_data(data.meta()));
 
-    for (auto batch = 0; batch < data.dim(0); ++batch) {
-      for (auto i = 0; i < N; ++i) {
-        auto idx = idxs[i];
-        CAFFE_ENFORCE(
-            0 <= idx && idx < data.dim(1),
-            "INDICES element is out of DATA bounds, id=",
-            idx,
-            " data_dim=",
-            data.dim(1));
-        auto src =
-            src_base + idx * block_bytesize + batch * data_batch_bytesize;
-        auto dst = out + i * block_bytesize + batch * gathered_batch_bytesize;
-        context_.template CopyItems<Context, Context>(
-            data.meta(), block_size, src, dst);
+    if (data.meta().copy()) {
+      for (auto batch = 0; batch < data.dim(0); ++batch) {
+        for (auto i = 0; i < N; ++i) {
+          auto idx = idxs[i];
+          CAFFE_ENFORCE(
+              0 <= idx && idx < data.dim(1),
+              "INDICES element is out of DATA bounds, id=",
+              idx,
+              " data_dim=",
+              data.dim(1));
+          auto src =
+              src_base + idx * block_bytesize + batch * data_batch_bytesize;
+          auto dst =
+              out + i * block_bytesize + batch * gathered_batch_bytesize;
+          context_.template CopyItems<Context, Context>(
+              data.meta(), block_size, src, dst);
+        }
+      }
+      return true;
+    }
+
+    // Plain old data is gathered with the GatherRows perfkernel, one batch
+    // at a time, and the batches are split between num_threads threads.
+    const TIndex num_batches = data.dim(0);
+    const TIndex num_ranges = NumRanges(num_batches);
+    auto gather = [&](size_t range) {
+      const TIndex begin = range * num_batches / num_ranges;
+      const TIndex end = (range + 1) * num_batches / num_ranges;
+      for (TIndex batch = begin; batch < end; ++batch) {
+        GatherRows<TInd>(
+            block_bytesize,
+            N,
+            data.dim(1),
+            src_base + batch * data_batch_bytesize,
+            idxs,
+            out + batch * gathered_batch_bytesize);
       }
+    };
+    if (num_ranges <= 1 || N == 0) {
+      gather(0);
+    } else {
+      ws_->GetThreadPool()->runRanges(num_ranges, gather);
     }
     return true;
   }
 
   INPUT_TAGS(DATA, INDICES);
+
+ private:
+  // Number of ranges of batches to split the gather in
+  TIndex NumRanges(TIndex num_batches) {
+    if (num_threads_ == 1 || num_batches <= 1) {
+      return 1;
+    }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return std::max<TIndex>(1, std::min<TIndex>(threads, num_batches));
+  }
+
+  Workspace* ws_;
+  // 0 uses all threads of the workspace thread pool, 1 gathers on the
+  // calling thread
+  const int num_threads_;
 };
 
 template <class Context>
@@ -105,7 +105,8 @@ OpSchema::Cost CostInferenceForBatchMatMul(
     K = in[0].dims(ndims_A - 1);
   }
   c.flops = 2 * nElemY * K;
-  c.bytes_moved = nElemY * sizeof(float);
+  c.bytes_read = nBytesOfShape(in[0]) + nBytesOfShape(in[1]);
+  c.bytes_written = nElemY * sizeof(float);
   c.params_bytes = 0;
   return c;
 }
@@ -113,6 +114,7 @@ OpSchema::Cost CostInferenceForBatchMatMul(
 OPERATOR_SCHEMA(BatchMatMul)
     .NumInputs(2)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .SetDoc(R"DOC(
 Batch Matrix multiplication Yi = Ai * Bi, where A has shape (dim0, dim1, ... M, K),
 B has shape (dim0, dim1, ... K, N), Y has shape (dim0, dim1, ... M, N) and i ranges
@@ -133,6 +135,11 @@ two diemnsional, it behaves like normal matrix multiplication.
     .Arg(
         "broadcast",
         "Pass 1 to allow broadcasting of dimensions. Behavior is the same as numpy.matmul. Gradient is currently not supported when running in broadcast mode.")
+    .Arg(
+        "num_threads",
+        "Threads of the workspace thread pool the small matrices of the "
+        "batch are split between on CPU: 0 (default) for all, 1 for the "
+        "calling thread.")
     .TensorInferenceFunction(TensorInferenceForBatchMatMul)
     .CostInferenceFunction(
         OpSchema::CostInferenceFunctionType(CostInferenceForBatchMatMul));
@@ -5,6 +5,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_op_shared.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
@@ -22,6 +23,8 @@ class BatchMatMulOp final : public Operator<Context> {
     if (use_scratch_) {
       scratch_ = std::make_shared<Tensor<Context>>();
     }
+    useMathThreadPool<Context>(
+        ws, OperatorBase::GetSingleArgument<int>("num_threads", 0), &context_);
   }
 
   ~BatchMatMulOp() {}
@@ -0,0 +1,364 @@
+#include "caffe2/operators/beam_search_op.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "caffe2/operators/rnn/recurrent_network_op.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Writes the rows of src selected by rows to dst
+void GatherRows(
+    const TensorCPU& src,
+    const std::vector<int>& rows,
+    TensorCPU* dst,
+    CPUContext* context) {
+  CAFFE_ENFORCE_GT(src.ndim(), 0);
+  auto dims = src.dims();
+  dims[0] = rows.size();
+  dst->Resize(dims);
+  const auto& meta = src.meta();
+  const auto rowItems = src.size_from_dim(1);
+  const auto rowBytes = rowItems * meta.itemsize();
+  const char* srcData = static_cast<const char*>(src.raw_data());
+  char* dstData = static_cast<char*>(dst->raw_mutable_data(meta));
+  for (size_t i = 0; i < rows.size(); ++i) {
+    CAFFE_ENFORCE_LT(rows[i], src.dim(0));
+    context->CopyItems<CPUContext, CPUContext>(
+        meta, rowItems, srcData + rows[i] * rowBytes, dstData + i * rowBytes);
+  }
+}
+
+struct Candidate {
+  float score;
+  int beam;
+  int token;
+};
+
+// Best first, ties going to the lower beam, then the lower token
+bool BetterCandidate(const Candidate& a, const Candidate& b) {
+  if (a.score != b.score) {
+    return a.score > b.score;
+  }
+  if (a.beam != b.beam) {
+    return a.beam < b.beam;
+  }
+  return a.token < b.token;
+}
+
+} // namespace
+
+BeamSearchOp::BeamSearchOp(const OperatorDef& operator_def, Workspace* ws)
+    : Operator<CPUContext>(operator_def, ws),
+      stepNetDef_(detail::extractNetDef(operator_def, "step_net")),
+      stepWs_(caffe2::make_unique<Workspace>(ws)),
+      beamSize_(OperatorBase::GetSingleArgument<int>("beam_size", 1)),
+      maxLength_(OperatorBase::GetSingleArgument<int>("max_length", 0)),
+      goTokenId_(OperatorBase::GetSingleArgument<int>("go_token_id", 1)),
+      eosTokenId_(OperatorBase::GetSingleArgument<int>("eos_token_id", 2)),
+      timestep_(
+          OperatorBase::GetSingleArgument<string>("timestep", "timestep")),
+      tokensPrev_(OperatorBase::GetSingleArgument<string>(
+          "tokens_prev",
+          "tokens_t_prev")),
+      logProbs_(
+          OperatorBase::GetSingleArgument<string>("log_probs", "log_probs")),
+      statesPrev_(OperatorBase::GetRepeatedArgument<string>("states_prev")),
+      states_(OperatorBase::GetRepeatedArgument<string>("states")) {
+  CAFFE_ENFORCE_GT(beamSize_, 0);
+  CAFFE_ENFORCE_GT(maxLength_, 0, "max_length is required");
+  CAFFE_ENFORCE_EQ(statesPrev_.size(), states_.size());
+  CAFFE_ENFORCE_EQ(
+      statesPrev_.size(),
+      InputSize(),
+      "Every states_prev blob needs an initial state input");
+
+  // The step net reads them, they have to exist before it is created
+  stepWs_->CreateBlob(timestep_);
+  stepWs_->CreateBlob(tokensPrev_);
+  for (const auto& name : statesPrev_) {
+    stepWs_->CreateBlob(name);
+  }
+}
+
+void BeamSearchOp::SelectBeams(
+    int b,
+    int t,
+    int vocabSize,
+    const float* logProbs,
+    const float* scores,
+    const int* tokens,
+    float* nextScores,
+    int* nextTokens,
+    int* prevBeams) {
+  std::vector<Candidate> candidates;
+  candidates.reserve(beamSize_ * beamSize_);
+  std::vector<int> indices(vocabSize);
+  // All the beams start from the same go token, only the first one is
+  // expanded at the first step to not select the same hypothesis k times
+  const int numBeams = t == 0 ? 1 : beamSize_;
+  for (int k = 0; k < numBeams; ++k) {
+    const int row = b * beamSize_ + k;
+    if (t > 0 && tokens[row] == eosTokenId_) {
+      candidates.push_back({scores[row], k, eosTokenId_});
+      continue;
+    }
+    // Only the best beamSize_ tokens of a hypothesis can be selected
+    const float* rowLogProbs = logProbs + row * vocabSize;
+    std::iota(indices.begin(), indices.end(), 0);
+    std::partial_sort(
+        indices.begin(),
+        indices.begin() + beamSize_,
+        indices.end(),
+        [rowLogProbs](int i, int j) {
+          return rowLogProbs[i] > rowLogProbs[j] ||
+              (rowLogProbs[i] == rowLogProbs[j] && i < j);
+        });
+    for (int i = 0; i < beamSize_; ++i) {
+      candidates.push_back(
+          {scores[row] + rowLogProbs[indices[i]], k, indices[i]});
+    }
+  }
+
+  CAFFE_ENFORCE_GE(candidates.size(), beamSize_);
+  std::partial_sort(
+      candidates.begin(),
+      candidates.begin() + beamSize_,
+      candidates.end(),
+      BetterCandidate);
+  for (int k = 0; k < beamSize_; ++k) {
+    const int row = b * beamSize_ + k;
+    nextScores[row] = candidates[k].score;
+    nextTokens[row] = candidates[k].token;
+    prevBeams[row] = candidates[k].beam;
+  }
+}
+
+void BeamSearchOp::Backtrack(
+    int batchSize,
+    int numSteps,
+    const std::vector<int>& tokens,
+    const std::vector<int>& prevBeams,
+    const std::vector<float>& scores) {
+  auto* finalTokens = Output(FINAL_TOKENS);
+  auto* finalLengths = Output(FINAL_LENGTHS);
+  auto* finalScores = Output(FINAL_SCORES);
+  finalTokens->Resize(batchSize, beamSize_, numSteps);
+  finalLengths->Resize(batchSize, beamSize_);
+  finalScores->Resize(batchSize, beamSize_);
+  auto* finalTokensData = finalTokens->mutable_data<int>();
+  auto* finalLengthsData = finalLengths->mutable_data<int>();
+  auto* finalScoresData = finalScores->mutable_data<float>();
+
+  const int stepSize = batchSize * beamSize_;
+  for (int b = 0; b < batchSize; ++b) {
+    for (int k = 0; k < beamSize_; ++k) {
+      const int row = b * beamSize_ + k;
+      int* hypothesis = finalTokensData + row * numSteps;
+      int beam = k;
+      for (int t = numSteps - 1; t >= 0; --t) {
+        const int index = t * stepSize + b * beamSize_ + beam;
+        hypothesis[t] = tokens[index];
+        beam = prevBeams[index];
+      }
+      // Finished hypotheses are followed by eos until the last step
+      const int* eos =
+          std::find(hypothesis, hypothesis + numSteps, eosTokenId_);
+      finalLengthsData[row] =
+          eos == hypothesis + numSteps ? numSteps : eos - hypothesis + 1;
+      finalScoresData[row] = scores[(numSteps - 1) * stepSize + row];
+    }
+  }
+}
+
+bool BeamSearchOp::RunOnDevice() {
+  const int batchSize = Input(0).dim32(0);
+  const int numRows = batchSize * beamSize_;
+
+  // Every example starts from beamSize_ copies of its initial states
+  std::vector<int> rows(numRows);
+  for (int i = 0; i < numRows; ++i) {
+    rows[i] = i / beamSize_;
+  }
+  for (int i = 0; i < InputSize(); ++i) {
+    CAFFE_ENFORCE_EQ(
+        Input(i).dim32(0),
+        batchSize,
+        "The initial states must have one row per example");
+    GatherRows(
+        Input(i),
+        rows,
+        stepWs_->GetBlob(statesPrev_[i])->GetMutable<TensorCPU>(),
+        &context_);
+  }
+
+  if (!stepNet_) {
+    stepNet_ = stepWs_->CreateNet(stepNetDef_, true);
+    CAFFE_ENFORCE(stepNet_, "Step Net construction failure");
+  }
+
+  auto* timestep = stepWs_->GetBlob(timestep_)->GetMutable<TensorCPU>();
+  timestep->Resize(1);
+  auto* tokensPrev = stepWs_->GetBlob(tokensPrev_)->GetMutable<TensorCPU>();
+  tokensPrev->Resize(numRows);
+  std::fill_n(tokensPrev->mutable_data<int>(), numRows, goTokenId_);
+
+  std::vector<float> stepScores(numRows, 0.0);
+  std::vector<int> allTokens;
+  std::vector<int> allPrevBeams;
+  std::vector<float> allScores;
+  TensorCPU gathered;
+  int numSteps = 0;
+  for (int t = 0; t < maxLength_; ++t) {
+    timestep->mutable_data<int32_t>()[0] = t;
+    CAFFE_ENFORCE(stepNet_->Run(), "Step net failed at timestep ", t);
+
+    const auto& logProbs =
+        stepWs_->GetBlob(logProbs_)->template Get<TensorCPU>();
+    CAFFE_ENFORCE_EQ(logProbs.ndim(), 2);
+    CAFFE_ENFORCE_EQ(logProbs.dim32(0), numRows);
+    const int vocabSize = logProbs.dim32(1);
+    CAFFE_ENFORCE_GE(
+        vocabSize, beamSize_, "beam_size can't exceed the vocabulary size");
+
+    const int offset = allTokens.size();
+    allTokens.resize(offset + numRows);
+    allPrevBeams.resize(offset + numRows);
+    allScores.resize(offset + numRows);
+    const int* tokens = tokensPrev->data<int>();
+    for (int b = 0; b < batchSize; ++b) {
+      SelectBeams(
+          b,
+          t,
+          vocabSize,
+          logProbs.data<float>(),
+          stepScores.data(),
+          tokens,
+          allScores.data() + offset,
+          allTokens.data() + offset,
+          allPrevBeams.data() + offset);
+    }
+    ++numSteps;
+
+    std::copy(
+        allScores.begin() + offset, allScores.end(), stepScores.begin());
+    std::copy(
+        allTokens.begin() + offset,
+        allTokens.end(),
+        tokensPrev->mutable_data<int>());
+    if (std::all_of(
+            allTokens.begin() + offset, allTokens.end(), [this](int token) {
+              return token == eosTokenId_;
+            })) {
+      break;
+    }
+
+    // The selected hypotheses continue from the states of their predecessors
+    for (int i = 0; i < numRows; ++i) {
+      rows[i] = (i / beamSize_) * beamSize_ + allPrevBeams[offset + i];
+    }
+    for (int i = 0; i < states_.size(); ++i) {
+      const auto& state = stepWs_->GetBlob(states_[i])->Get<TensorCPU>();
+      CAFFE_ENFORCE_EQ(state.dim32(0), numRows);
+      GatherRows(state, rows, &gathered, &context_);
+      stepWs_->GetBlob(statesPrev_[i])->GetMutable<TensorCPU>()->swap(
+          gathered);
+    }
+  }
+
+  auto* outputTokens = Output(TOKENS);
+  auto* outputPrevIndices = Output(PREV_INDICES);
+  auto* outputScores = Output(SCORES);
+  outputTokens->Resize(numSteps, batchSize, beamSize_);
+  outputPrevIndices->Resize(numSteps, batchSize, beamSize_);
+  outputScores->Resize(numSteps, batchSize, beamSize_);
+  std::copy(
+      allTokens.begin(), allTokens.end(), outputTokens->mutable_data<int>());
+  std::copy(
+      allPrevBeams.begin(),
+      allPrevBeams.end(),
+      outputPrevIndices->mutable_data<int>());
+  std::copy(
+      allScores.begin(), allScores.end(), outputScores->mutable_data<float>());
+
+  if (OutputSize() > FINAL_TOKENS) {
+    Backtrack(batchSize, numSteps, allTokens, allPrevBeams, allScores);
+  }
+  return true;
+}
+
+namespace {
+
+REGISTER_CPU_OPERATOR(BeamSearch, BeamSearchOp);
+
+OPERATOR_SCHEMA(BeamSearch)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs({3, 6})
+    .SetDoc(R"DOC(
+Beam search decoding of a batch of B examples, running the decoder step net
+for all the B * beam_size hypotheses at once, up to max_length steps.
+
+At every step t the step net runs in a child workspace of the current one,
+so it can read the parameters and any other blob of the workspace, with:
+
+  - timestep: int32 tensor holding t
+  - tokens_prev: int32 tensor of shape [B * beam_size] of the previous tokens
+    (go_token_id at the first step)
+  - states_prev[i]: state i of the hypotheses, of shape [B * beam_size, ...]
+
+The hypotheses of example b are the rows [b * beam_size, (b + 1) *
+beam_size), blobs of the workspace the step net reads per hypothesis (e.g.
+encoder outputs) have to be tiled accordingly. The step net writes:
+
+  - log_probs: float tensor of shape [B * beam_size, vocab_size]
+  - states[i]: the next state i, of the same shape as states_prev[i]
+
+The op keeps, for every example, the beam_size best continuations of its
+hypotheses by total log probability and feeds the states of their
+predecessors back as states_prev. A hypothesis is finished once it produced
+eos_token_id and keeps its score. Decoding stops when all the hypotheses
+are finished.
+
+The step-wise outputs have the layout of the beam search of the seq2seq
+models; the final outputs are the hypotheses of the last step, best first.
+)DOC")
+    .Arg("step_net", "NetDef of the decoder step")
+    .Arg("beam_size", "Number of hypotheses kept per example, 1 by default")
+    .Arg("max_length", "Maximal number of decoding steps")
+    .Arg("go_token_id", "Token starting the hypotheses, 1 by default")
+    .Arg("eos_token_id", "Token finishing a hypothesis, 2 by default")
+    .Arg("timestep", "Name of the timestep blob, \"timestep\" by default")
+    .Arg(
+        "tokens_prev",
+        "Name of the previous tokens blob, \"tokens_t_prev\" by default")
+    .Arg("log_probs", "Name of the log probs blob, \"log_probs\" by default")
+    .Arg("states_prev", "Names of the blobs of the states read by the step")
+    .Arg("states", "Names of the blobs of the states written by the step")
+    .Input(
+        0,
+        "initial_states",
+        "One initial state per states_prev blob, of shape [B, ...]")
+    .Output(0, "tokens", "int32 tensor [T, B, beam_size] of the tokens")
+    .Output(
+        1,
+        "prev_index",
+        "int32 tensor [T, B, beam_size] of the beam each hypothesis extends")
+    .Output(2, "scores", "float tensor [T, B, beam_size] of the scores")
+    .Output(
+        3,
+        "final_tokens",
+        "int32 tensor [B, beam_size, T] of the final hypotheses, followed by "
+        "eos_token_id after their end")
+    .Output(
+        4,
+        "final_lengths",
+        "int32 tensor [B, beam_size] of their lengths, eos included")
+    .Output(5, "final_scores", "float tensor [B, beam_size] of their scores");
+
+SHOULD_NOT_DO_GRADIENT(BeamSearch);
+
+} // namespace
+
+} // namespace caffe2
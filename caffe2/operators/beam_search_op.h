@@ -0,0 +1,75 @@
+#ifndef CAFFE2_OPERATORS_BEAM_SEARCH_OP_H_
+#define CAFFE2_OPERATORS_BEAM_SEARCH_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+// Beam search decoding around a decoder step net, for a batch of examples.
+//
+// The step net decodes one token for every hypothesis of the batch, the
+// hypotheses of example b being the rows [b * beam_size, (b + 1) *
+// beam_size). It reads the previous tokens, the timestep and the previous
+// states, and writes the log probabilities of the next tokens and the new
+// states. After every step the op picks the best beam_size continuations of
+// every example, gathers the states of their predecessors and feeds them
+// back, without leaving C++. A hypothesis ending with eos_token_id is
+// finished: it is kept with its score and continued with eos_token_id.
+class BeamSearchOp final : public Operator<CPUContext> {
+ public:
+  BeamSearchOp(const OperatorDef& operator_def, Workspace* ws);
+
+  bool RunOnDevice() override;
+
+ protected:
+  OUTPUT_TAGS(
+      TOKENS,
+      PREV_INDICES,
+      SCORES,
+      FINAL_TOKENS,
+      FINAL_LENGTHS,
+      FINAL_SCORES);
+
+ private:
+  // Picks the best continuations of the hypotheses of example b, writing
+  // their token, predecessor beam and score at offset b * beamSize_
+  void SelectBeams(
+      int b,
+      int t,
+      int vocabSize,
+      const float* logProbs,
+      const float* scores,
+      const int* tokens,
+      float* nextScores,
+      int* nextTokens,
+      int* prevBeams);
+
+  // Writes the hypotheses of the final beams, following the predecessors
+  // back from the last step
+  void Backtrack(
+      int batchSize,
+      int numSteps,
+      const std::vector<int>& tokens,
+      const std::vector<int>& prevBeams,
+      const std::vector<float>& scores);
+
+  NetDef stepNetDef_;
+  std::unique_ptr<Workspace> stepWs_;
+  NetBase* stepNet_{nullptr};
+
+  int beamSize_;
+  int maxLength_;
+  int goTokenId_;
+  int eosTokenId_;
+  std::string timestep_;
+  std::string tokensPrev_;
+  std::string logProbs_;
+  std::vector<std::string> statesPrev_;
+  std::vector<std::string> states_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_BEAM_SEARCH_OP_H_
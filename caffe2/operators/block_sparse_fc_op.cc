@@ -0,0 +1,352 @@
+#include "caffe2/operators/block_sparse_fc_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/block_sparse_gemm.h"
+
+namespace caffe2 {
+
+void BlockSparseMatrix::FromDense(
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const float* W,
+    const float threshold) {
+  CAFFE_ENFORCE(
+      block_size == 4 || block_size == 8 || block_size == 16,
+      "The block size must be 4, 8 or 16, not ",
+      block_size);
+  CAFFE_ENFORCE_LE(K, std::numeric_limits<int32_t>::max());
+  this->N = N;
+  this->K = K;
+  this->block_size = block_size;
+  const TIndex num_block_rows = (N + block_size - 1) / block_size;
+  row_ptr.Resize(num_block_rows + 1);
+  auto* rows = row_ptr.mutable_data<int32_t>();
+  std::vector<int32_t> cols;
+  std::vector<float> vals;
+  rows[0] = 0;
+  for (TIndex p = 0; p < num_block_rows; ++p) {
+    const TIndex n0 = p * block_size;
+    const int n_valid =
+        static_cast<int>(std::min<TIndex>(block_size, N - n0));
+    for (TIndex k = 0; k < K; ++k) {
+      bool nonzero = false;
+      for (int j = 0; j < n_valid && !nonzero; ++j) {
+        nonzero = std::abs(W[(n0 + j) * K + k]) > threshold;
+      }
+      if (!nonzero) {
+        continue;
+      }
+      cols.push_back(static_cast<int32_t>(k));
+      for (int j = 0; j < block_size; ++j) {
+        vals.push_back(j < n_valid ? W[(n0 + j) * K + k] : 0);
+      }
+    }
+    CAFFE_ENFORCE_LE(
+        cols.size(),
+        std::numeric_limits<int32_t>::max(),
+        "Too many blocks for int32 offsets");
+    rows[p + 1] = static_cast<int32_t>(cols.size());
+  }
+  col_idx.Resize(cols.size());
+  std::copy(cols.begin(), cols.end(), col_idx.mutable_data<int32_t>());
+  values.Resize(cols.size(), block_size);
+  std::copy(vals.begin(), vals.end(), values.mutable_data<float>());
+}
+
+CAFFE_KNOWN_TYPE(BlockSparseMatrix);
+
+namespace {
+
+// FullyConnectedOp with the weights in block sparse format, given as a
+// BlockSparseMatrix or as dense weights converted once and converted again
+// only when they change, as told by their address, data, shape and version().
+//
+// The block rows of the output are split between the threads of the
+// workspace thread pool, in ranges of about the same number of blocks.
+class BlockSparseFCOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  BlockSparseFCOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        block_size_(OperatorBase::GetSingleArgument<int>("block_size", 8)),
+        threshold_(OperatorBase::GetSingleArgument<float>("threshold", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
+  }
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    const auto& W = Weights();
+    const auto& b = Input(2);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+    const auto canonical_axis = X.canonical_axis_index(axis_);
+    const auto M = X.size_to_dim(canonical_axis);
+    const auto K = X.size_from_dim(canonical_axis);
+    const auto N = W.N;
+    CAFFE_ENFORCE_EQ(K, W.K, "Dimension mismatch of X and W");
+    CAFFE_ENFORCE_EQ(N, b.size(), "Dimension mismatch of W and b");
+
+    Y_shape_cache_ = X.dims();
+    Y_shape_cache_.resize(canonical_axis + 1);
+    Y_shape_cache_[canonical_axis] = N;
+    Y->Resize(Y_shape_cache_);
+    float* Ydata = Y->template mutable_data<float>();
+    if (X.size() == 0) {
+      return true;
+    }
+
+    const auto* row_ptr = W.row_ptr.template data<int32_t>();
+    const auto run = [&](const TIndex begin, const TIndex end) {
+      BlockSparseGemm(
+          M,
+          N,
+          K,
+          W.block_size,
+          begin,
+          end,
+          X.template data<float>(),
+          row_ptr,
+          W.col_idx.template data<int32_t>(),
+          W.values.template data<float>(),
+          b.template data<float>(),
+          Ydata);
+    };
+    const TIndex num_block_rows = W.num_block_rows();
+    const int num_ranges =
+        NumRanges(M * W.num_blocks() * W.block_size, num_block_rows);
+    if (num_ranges <= 1) {
+      run(0, num_block_rows);
+      return true;
+    }
+    bounds_.resize(num_ranges + 1);
+    bounds_[0] = 0;
+    for (int r = 1; r < num_ranges; ++r) {
+      const TIndex blocks = r * W.num_blocks() / num_ranges;
+      bounds_[r] = std::lower_bound(row_ptr, row_ptr + num_block_rows, blocks) -
+          row_ptr;
+    }
+    // Block rows without blocks at the end still get their bias
+    bounds_[num_ranges] = num_block_rows;
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+      run(bounds_[range], bounds_[range + 1]);
+    });
+    return true;
+  }
+
+ private:
+  const BlockSparseMatrix& Weights() {
+    if (OperatorBase::InputIsType<BlockSparseMatrix>(1)) {
+      return OperatorBase::Input<BlockSparseMatrix>(1);
+    }
+    const auto& W = Input(1);
+    if (&W != weight_ || W.version() != weight_version_ ||
+        W.raw_data() != weight_data_ || W.dims() != weight_dims_) {
+      const auto canonical_axis_w = W.canonical_axis_index(axis_w_);
+      sparse_.FromDense(
+          W.size_to_dim(canonical_axis_w),
+          W.size_from_dim(canonical_axis_w),
+          block_size_,
+          W.template data<float>(),
+          threshold_);
+      weight_ = &W;
+      weight_version_ = W.version();
+      weight_data_ = W.raw_data();
+      weight_dims_ = W.dims();
+    }
+    return sparse_;
+  }
+
+  // Number of ranges to split the block rows in, 1 runs them on the calling
+  // thread
+  int NumRanges(const TIndex flops, const TIndex num_block_rows) {
+    // Below this many multiply-adds per range, waking up the threads costs
+    // more than it saves
+    constexpr TIndex kMinFlopsPerRange = 1 << 16;
+    if (num_threads_ == 1) {
+      return 1;
+    }
+    const TIndex max_ranges =
+        std::min(flops / kMinFlopsPerRange, num_block_rows);
+    if (max_ranges <= 1) {
+      return 1;
+    }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return static_cast<int>(std::min<TIndex>(threads, max_ranges));
+  }
+
+  Workspace* ws_;
+  size_t axis_{1};
+  size_t axis_w_{1};
+  const int block_size_;
+  const float threshold_;
+  // 0 uses all threads of the workspace thread pool, 1 runs on the calling
+  // thread
+  const int num_threads_;
+  vector<TIndex> Y_shape_cache_;
+  std::vector<TIndex> bounds_;
+
+  BlockSparseMatrix sparse_;
+  // The dense weight tensor sparse_ was converted from
+  const TensorCPU* weight_ = nullptr;
+  uint64_t weight_version_ = 0;
+  const void* weight_data_ = nullptr;
+  vector<TIndex> weight_dims_;
+};
+
+class BlockSparseFromDenseOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  BlockSparseFromDenseOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        block_size_(OperatorBase::GetSingleArgument<int>("block_size", 8)),
+        threshold_(OperatorBase::GetSingleArgument<float>("threshold", 0)) {}
+
+  bool RunOnDevice() override {
+    const auto& W = Input(0);
+    const auto canonical_axis_w = W.canonical_axis_index(axis_w_);
+    OperatorBase::Output<BlockSparseMatrix>(0)->FromDense(
+        W.size_to_dim(canonical_axis_w),
+        W.size_from_dim(canonical_axis_w),
+        block_size_,
+        W.template data<float>(),
+        threshold_);
+    return true;
+  }
+
+ private:
+  size_t axis_w_{1};
+  const int block_size_;
+  const float threshold_;
+};
+
+/**
+ * Serializes a BlockSparseMatrix as a TensorProtos holding its N, K and
+ * block_size, then its row_ptr, col_idx and values tensors.
+ */
+class BlockSparseMatrixSerializer : public BlobSerializerBase {
+ public:
+  void Serialize(
+      const Blob& blob,
+      const string& name,
+      SerializationAcceptor acceptor) override {
+    const auto& matrix = blob.template Get<BlockSparseMatrix>();
+    TensorCPU shape;
+    shape.Resize(3);
+    auto* shape_data = shape.mutable_data<int64_t>();
+    shape_data[0] = matrix.N;
+    shape_data[1] = matrix.K;
+    shape_data[2] = matrix.block_size;
+
+    TensorProtos protos;
+    TensorSerializer<CPUContext> ser;
+    const TensorCPU* tensors[] = {
+        &shape, &matrix.row_ptr, &matrix.col_idx, &matrix.values};
+    for (const auto* tensor : tensors) {
+      CAFFE_ENFORCE(
+          tensor->size() <= std::numeric_limits<int32_t>::max(),
+          "Block sparse matrix too large to be serialized.");
+      ser.Serialize(*tensor, name, protos.add_protos(), 0, tensor->size());
+    }
+    BlobProto blob_proto;
+    blob_proto.set_name(name);
+    blob_proto.set_type("BlockSparseMatrix");
+    blob_proto.set_content(protos.SerializeAsString());
+    acceptor(name, blob_proto.SerializeAsString());
+  }
+};
+
+class BlockSparseMatrixDeserializer : public BlobDeserializerBase {
+ public:
+  void Deserialize(const BlobProto& proto, Blob* blob) override {
+    TensorProtos protos;
+    CAFFE_ENFORCE(
+        protos.ParseFromString(proto.content()) && protos.protos_size() == 4,
+        "Invalid serialized block sparse matrix.");
+    TensorDeserializer<CPUContext> deser;
+    TensorCPU shape;
+    deser.Deserialize(protos.protos(0), &shape);
+    CAFFE_ENFORCE_EQ(shape.size(), 3);
+    auto* matrix = blob->template GetMutable<BlockSparseMatrix>();
+    matrix->N = shape.data<int64_t>()[0];
+    matrix->K = shape.data<int64_t>()[1];
+    matrix->block_size = static_cast<int>(shape.data<int64_t>()[2]);
+    deser.Deserialize(protos.protos(1), &matrix->row_ptr);
+    deser.Deserialize(protos.protos(2), &matrix->col_idx);
+    deser.Deserialize(protos.protos(3), &matrix->values);
+  }
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(BlockSparseFC, BlockSparseFCOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(FC, BLOCK_SPARSE, BlockSparseFCOp);
+REGISTER_CPU_OPERATOR(BlockSparseFromDense, BlockSparseFromDenseOp);
+
+OPERATOR_SCHEMA(BlockSparseFC)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+FC for pruned weights: Y = X * W^T + b, with W stored in block sparse format
+so that the multiplications by zero weights are skipped. W is either a
+BlockSparseMatrix made by BlockSparseFromDense, or the dense N x K weights of
+FC, converted once like BlockSparseFromDense does and converted again only
+when they change. The FC operator runs the same way with the BLOCK_SPARSE
+engine.
+
+The output block rows are split between the threads of the workspace thread
+pool when the layer is large enough.
+)DOC")
+    .Arg("axis", "See FC")
+    .Arg("axis_w", "See FC, for dense weights")
+    .Arg("block_size", "See BlockSparseFromDense, for dense weights")
+    .Arg("threshold", "See BlockSparseFromDense, for dense weights")
+    .Arg(
+        "num_threads",
+        "Threads to use, 0 (default) for all the threads of the workspace "
+        "thread pool and 1 to run on the calling thread")
+    .Input(0, "X", "Input of the layer, see FC")
+    .Input(1, "W", "BlockSparseMatrix, or dense N x K weights")
+    .Input(2, "b", "Bias of size N")
+    .Output(0, "Y", "Output of the layer, see FC");
+NO_GRADIENT(BlockSparseFC);
+
+OPERATOR_SCHEMA(BlockSparseFromDense)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Converts the dense N x K weights of FC to the BlockSparseMatrix input of
+BlockSparseFC. A block holds the weights of block_size consecutive outputs for
+one input, and only the blocks with a weight larger than threshold in absolute
+value are kept. Larger blocks run faster per block, smaller ones skip more
+weights pruned one by one. The matrix can be saved and loaded like a tensor.
+)DOC")
+    .Arg("axis_w", "See FC")
+    .Arg("block_size", "Outputs per block: 4, 8 (default) or 16")
+    .Arg(
+        "threshold",
+        "Blocks whose weights are all at most this in absolute value are "
+        "dropped, 0 by default")
+    .Input(0, "W", "Dense N x K weights")
+    .Output(0, "W_sparse", "BlockSparseMatrix");
+NO_GRADIENT(BlockSparseFromDense);
+
+REGISTER_BLOB_SERIALIZER(
+    (TypeMeta::Id<BlockSparseMatrix>()),
+    BlockSparseMatrixSerializer);
+REGISTER_BLOB_DESERIALIZER(BlockSparseMatrix, BlockSparseMatrixDeserializer);
+
+} // namespace caffe2
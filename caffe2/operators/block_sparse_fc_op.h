@@ -0,0 +1,55 @@
+#ifndef CAFFE2_OPERATORS_BLOCK_SPARSE_FC_OP_H_
+#define CAFFE2_OPERATORS_BLOCK_SPARSE_FC_OP_H_
+
+#include <cstdint>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+/**
+ * The N x K weights of a fully connected layer in the block compressed
+ * sparse row format of BlockSparseGemm (perfkernels/block_sparse_gemm.h),
+ * for the BlockSparseFC operator and the FC BLOCK_SPARSE engine.
+ *
+ * A block holds the weights of block_size consecutive outputs for one input,
+ * and only the blocks with a non zero weight are stored. The larger blocks
+ * use the SIMD units better, the smaller ones skip more zeros of weights
+ * pruned one by one rather than by groups of outputs.
+ */
+struct BlockSparseMatrix {
+  /**
+   * Builds the matrix from W, the dense N x K weights of FC, storing the
+   * blocks that have a weight larger than threshold in absolute value.
+   */
+  void FromDense(
+      const TIndex N,
+      const TIndex K,
+      const int block_size,
+      const float* W,
+      const float threshold);
+
+  TIndex num_block_rows() const {
+    return row_ptr.size() - 1;
+  }
+
+  TIndex num_blocks() const {
+    return col_idx.size();
+  }
+
+  TIndex N = 0;
+  TIndex K = 0;
+  int block_size = 0;
+  // int32 offsets of the blocks of every block row in col_idx and values,
+  // num_block_rows() + 1 of them
+  TensorCPU row_ptr;
+  // int32 input of every block
+  TensorCPU col_idx;
+  // float weights of every block, num_blocks() x block_size
+  TensorCPU values;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_BLOCK_SPARSE_FC_OP_H_
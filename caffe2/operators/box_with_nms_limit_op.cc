@@ -1,5 +1,11 @@
 #include "box_with_nms_limit_op.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "caffe2/core/workspace.h"
 #include "caffe2/utils/eigen_utils.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 #include "generate_proposals_op_util_nms.h"
 
 #ifdef CAFFE2_USE_MKL
@@ -84,9 +90,90 @@ bool BoxWithNMSLimitOp<CPUContext>::RunOnDevice() {
     out_keeps_size->Resize(batch_size, num_classes);
   }
 
+  // Offsets of the boxes of every image
+  vector<int> offsets(batch_size + 1, 0);
+  for (int b = 0; b < batch_size; ++b) {
+    offsets[b + 1] = offsets[b] + batch_splits(b);
+  }
+
+  // To store updated scores if SoftNMS is used
+  vector<ERArrXXf> all_soft_nms_scores(batch_size);
+  if (soft_nms_enabled_) {
+    for (int b = 0; b < batch_size; ++b) {
+      all_soft_nms_scores[b].resize(batch_splits(b), num_classes);
+    }
+  }
+  vector<vector<vector<int>>> all_keeps(
+      batch_size, vector<vector<int>>(num_classes));
+
+  // Perform nms to each class of each image
+  // skip j = 0, because it's the background class
+  auto run_class = [&](int task) {
+    const int b = task / (num_classes - 1);
+    const int j = task % (num_classes - 1) + 1;
+    const int num_boxes = batch_splits(b);
+    Eigen::Map<const ERArrXXf> scores(
+        tscores.data<float>() + offsets[b] * tscores.dim(1),
+        num_boxes,
+        tscores.dim(1));
+    Eigen::Map<const ERArrXXf> boxes(
+        tboxes.data<float>() + offsets[b] * tboxes.dim(1),
+        num_boxes,
+        tboxes.dim(1));
+
+    auto cur_scores = scores.col(j);
+    auto inds = utils::GetArrayIndices(cur_scores > score_thres_);
+    auto cur_boxes = boxes.block(0, j * 4, boxes.rows(), 4);
+
+    if (soft_nms_enabled_) {
+      auto cur_soft_nms_scores = all_soft_nms_scores[b].col(j);
+      all_keeps[b][j] = utils::soft_nms_cpu(
+          &cur_soft_nms_scores,
+          cur_boxes,
+          cur_scores,
+          inds,
+          soft_nms_sigma_,
+          nms_thres_,
+          soft_nms_min_score_thres_,
+          soft_nms_method_);
+    } else {
+      std::sort(
+          inds.data(),
+          inds.data() + inds.size(),
+          [&cur_scores](int lhs, int rhs) {
+            return cur_scores(lhs) > cur_scores(rhs);
+          });
+      all_keeps[b][j] =
+          utils::nms_cpu(cur_boxes, cur_scores, inds, nms_thres_);
+    }
+  };
+  const int num_tasks = batch_size * (num_classes - 1);
+  int num_ranges = 1;
+  if (num_threads_ != 1 && num_tasks > 1) {
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    num_ranges = std::min(
+        num_tasks,
+        num_threads_ == 0 ? pool_threads
+                          : std::min(num_threads_, pool_threads));
+  }
+  if (num_ranges <= 1) {
+    for (int task = 0; task < num_tasks; ++task) {
+      run_class(task);
+    }
+  } else {
+    // Classes are taken one at a time, as their numbers of boxes above the
+    // score threshold vary a lot
+    std::atomic<int> next_task(0);
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t /* unused */) {
+      for (int task = next_task++; task < num_tasks; task = next_task++) {
+        run_class(task);
+      }
+    });
+  }
+
   vector<int> total_keep_per_batch(batch_size);
-  int offset = 0;
   for (int b = 0; b < batch_splits.size(); ++b) {
+    const int offset = offsets[b];
     int num_boxes = batch_splits(b);
     Eigen::Map<const ERArrXXf> scores(
         tscores.data<float>() + offset * tscores.dim(1),
@@ -96,44 +183,16 @@ bool BoxWithNMSLimitOp<CPUContext>::RunOnDevice() {
         tboxes.data<float>() + offset * tboxes.dim(1),
         num_boxes,
         tboxes.dim(1));
+    auto& keeps = all_keeps[b];
 
-    // To store updated scores if SoftNMS is used
-    ERArrXXf soft_nms_scores(num_boxes, tscores.dim(1));
-    vector<vector<int>> keeps(num_classes);
-
-    // Perform nms to each class
-    // skip j = 0, because it's the background class
     int total_keep_count = 0;
     for (int j = 1; j < num_classes; j++) {
-      auto cur_scores = scores.col(j);
-      auto inds = utils::GetArrayIndices(cur_scores > score_thres_);
-      auto cur_boxes = boxes.block(0, j * 4, boxes.rows(), 4);
-
-      if (soft_nms_enabled_) {
-        auto cur_soft_nms_scores = soft_nms_scores.col(j);
-        keeps[j] = utils::soft_nms_cpu(
-            &cur_soft_nms_scores,
-            cur_boxes,
-            cur_scores,
-            inds,
-            soft_nms_sigma_,
-            nms_thres_,
-            soft_nms_min_score_thres_,
-            soft_nms_method_);
-      } else {
-        std::sort(
-            inds.data(),
-            inds.data() + inds.size(),
-            [&cur_scores](int lhs, int rhs) {
-              return cur_scores(lhs) > cur_scores(rhs);
-            });
-        keeps[j] = utils::nms_cpu(cur_boxes, cur_scores, inds, nms_thres_);
-      }
       total_keep_count += keeps[j].size();
     }
 
     if (soft_nms_enabled_) {
       // Re-map scores to the updated SoftNMS scores
+      const auto& soft_nms_scores = all_soft_nms_scores[b];
       new (&scores) Eigen::Map<const ERArrXXf>(
           soft_nms_scores.data(),
           soft_nms_scores.rows(),
@@ -229,8 +288,6 @@ bool BoxWithNMSLimitOp<CPUContext>::RunOnDevice() {
         cur_out_idx += keeps[j].size();
       }
     }
-
-    offset += num_boxes;
   }
 
   if (OutputSize() > 3) {
@@ -272,6 +329,11 @@ returned boxes.
     .Arg(
         "soft_nms_min_score_thres",
         "(float) Lower bound on updated scores to discard boxes")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the classes of all "
+        "images are split between: 0, the default, uses all of them and 1 "
+        "the calling thread")
     .Input(0, "scores", "Scores, size (count, num_classes)")
     .Input(
         1,
@@ -15,6 +15,8 @@ class BoxWithNMSLimitOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   BoxWithNMSLimitOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
         score_thres_(
             OperatorBase::GetSingleArgument<float>("score_thresh", 0.05)),
         nms_thres_(OperatorBase::GetSingleArgument<float>("nms", 0.3)),
@@ -34,6 +36,7 @@ class BoxWithNMSLimitOp final : public Operator<Context> {
         soft_nms_method_str_ == "linear" || soft_nms_method_str_ == "gaussian",
         "Unexpected soft_nms_method");
     soft_nms_method_ = (soft_nms_method_str_ == "linear") ? 1 : 2;
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
 
   ~BoxWithNMSLimitOp() {}
@@ -41,6 +44,10 @@ class BoxWithNMSLimitOp final : public Operator<Context> {
   bool RunOnDevice() override;
 
  protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the classes are split between: 0
+  // uses all of them, 1 the calling thread
+  int num_threads_;
   // TEST.SCORE_THRESH
   float score_thres_ = 0.05;
   // TEST.NMS
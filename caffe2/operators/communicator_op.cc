@@ -12,7 +12,21 @@ Creates a common world for communication operators.
     .Input(0, "kv_handler", "Key/value handler for rendezvous (optional).")
     .Output(0, "comm_world", "A common world for collective operations.")
     .Arg("size", "(int) size of the common world.")
-    .Arg("rank", "(int) rank of this node in the common world.");
+    .Arg("rank", "(int) rank of this node in the common world.")
+    .Arg(
+        "topology_aware",
+        "(bool) gather the host and rack of every node through the store and "
+        "order the ranks so nodes sharing a host or rack are neighbors in the "
+        "rings and trees of the collectives. Ranks seen by the collectives, "
+        "e.g. the Broadcast root or the Allgather order, follow the new "
+        "order, which keeps rank 0 first. Gloo engine only.")
+    .Arg(
+        "hostname",
+        "(string) host of this node for topology_aware, defaults to the "
+        "hostname of the machine.")
+    .Arg(
+        "rack",
+        "(string) rack of this node for topology_aware, empty if unknown.");
 
 OPERATOR_SCHEMA(CloneCommonWorld)
     .NumInputs(1)
@@ -69,11 +83,57 @@ OPERATOR_SCHEMA(Allreduce)
     .InputsCanCrossDevices()
     .SetDoc(R"DOC(
 Does an allreduce operation among the nodes. Currently only Sum is supported.
+
+The inputs are the copies of a tensor on the local devices. With the
+num_devices argument, they can be the copies of several tensors, the copies
+of the first tensor first, which the GLOO engine reduces at once through one
+buffer per device.
+
+With the compression argument, the GLOO engine sends CPU float tensors in
+float16, or quantized to 8 bits per chunk of compression_chunk_size values,
+with a float scale and bias per chunk. The 8-bit chunks of all the nodes are
+gathered and summed in float. The error of the compression is kept in the
+workspace, in a residual blob named after every output of the first tensor
+with the "_allreduce_residual" suffix, and added to the tensor before its
+next compression.
 )DOC")
+    .Arg(
+        "num_devices",
+        "(int, default is the number of inputs) Number of local devices, "
+        "every tensor has one copy per device")
+    .Arg(
+        "algorithm",
+        "(string, default halving_doubling) Algorithm of the GLOO engine, "
+        "\"halving_doubling\", \"ring\" or \"ring_chunked\"")
+    .Arg(
+        "compression",
+        "(string, default none) \"fp16\" or \"int8\" to compress the "
+        "tensors with error feedback")
+    .Arg(
+        "compression_chunk_size",
+        "(int, default 256) Number of values sharing a scale and a bias with "
+        "int8 compression")
     .Input(0, "comm_world", "The common world.")
     .Input(1, "X", "A tensor to be allreduced.")
     .Output(0, "Y", "The allreduced tensor, same on all nodes.");
 
+OPERATOR_SCHEMA(SparseAllreduce)
+    .NumInputs(3)
+    .NumOutputs(2)
+    .InputsCanCrossDevices()
+    .SetDoc(R"DOC(
+Sums a sparse tensor, like the gradient of an embedding table, among the
+nodes. Every node gathers the indices and the rows of values of all the
+nodes, which can have different numbers of indices, and sums the rows of
+every index. The outputs, with every index once, are the same on all the
+nodes and can be fed to the sparse optimizers like SparseAdagrad.
+)DOC")
+    .Input(0, "comm_world", "The common world.")
+    .Input(1, "indices", "Integer vector of indices, possibly repeated.")
+    .Input(2, "values", "Rows of values of the indices, first dim of indices.")
+    .Output(0, "output_indices", "Unique indices of all the nodes.")
+    .Output(1, "output_values", "Sum of the rows of every index.");
+
 OPERATOR_SCHEMA(ReduceScatter)
     .NumInputsOutputs([](int in, int out) {
       return in >= 2 && out == (in - 1);
@@ -183,6 +243,7 @@ SHOULD_NOT_DO_GRADIENT(Reduce);
 SHOULD_NOT_DO_GRADIENT(Allgather);
 SHOULD_NOT_DO_GRADIENT(Allreduce);
 SHOULD_NOT_DO_GRADIENT(ReduceScatter);
+SHOULD_NOT_DO_GRADIENT(SparseAllreduce);
 SHOULD_NOT_DO_GRADIENT(Barrier);
 SHOULD_NOT_DO_GRADIENT(SendTensor);
 SHOULD_NOT_DO_GRADIENT(ReceiveTensor);
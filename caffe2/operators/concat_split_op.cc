@@ -27,6 +27,11 @@ OPERATOR_SCHEMA(Split)
     .Arg("axis", "Which axis to split on")
     .Arg("split", "length of each output")
     .Arg("order", "Either NHWC or NCWH, will split on C axis, defaults to NCHW")
+    .Arg(
+        "output_views",
+        "If set, and there is nothing before the axis, the outputs share the "
+        "storage of the input instead of copying it. Set by "
+        "EnableTensorViews where all the readers of the outputs accept views")
     .DeviceInferenceFunction(splitOpDevInfer)
     .SetDoc(R"DOC(
 Split a tensor into a list of tensors, along the specified
@@ -63,7 +68,14 @@ OpSchema::Cost CostInferenceForConcat(
 
   struct OpSchema::Cost cost;
   cost.flops = 0;
-  cost.bytes_moved = size * sizeof(float);
+  for (const auto& input : in) {
+    cost.bytes_read += nBytesOfShape(input);
+  }
+  cost.bytes_written = size * sizeof(float);
+  if (def.output_size() > 1) {
+    // split_info
+    cost.bytes_written += in.size() * sizeof(int);
+  }
   cost.params_bytes = 0;
   return cost;
 }
@@ -94,6 +106,7 @@ OPERATOR_SCHEMA(Concat)
         "add_axis",
         "Pass 1 to add the axis specified in arg 'axis' to all "
         "input tensors")
+    .AcceptsTensorViews()
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       ArgumentHelper helper(def);
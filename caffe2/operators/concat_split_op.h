@@ -31,7 +31,9 @@ class SplitOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   SplitOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        split_(OperatorBase::GetRepeatedArgument<int>("split")) {
+        split_(OperatorBase::GetRepeatedArgument<int>("split")),
+        output_views_(
+            OperatorBase::GetSingleArgument<bool>("output_views", false)) {
     CAFFE_ENFORCE(
         !(OperatorBase::HasArgument("axis") &&
           OperatorBase::HasArgument("order")),
@@ -54,6 +56,7 @@ class SplitOp final : public Operator<Context> {
   int axis_;
   int add_axis_;
   vector<int> split_;
+  bool output_views_;
   // Input: X, optionally split
   // The split tensor is stored in CPU.
 };
@@ -144,6 +147,7 @@ bool SplitOp<Context>::RunOnDevice() {
     output_dims.erase(output_dims.begin() + canonical_axis);
   }
   size_t input_offset = 0;
+  TIndex input_item_offset = 0;
   for (int i = 0; i < OutputSize(); ++i) {
     auto* output = Output(i);
     auto axis_dim = add_axis_ ? 1 : axis_data[i];
@@ -151,17 +155,23 @@ bool SplitOp<Context>::RunOnDevice() {
       output_dims[canonical_axis] = axis_data[i];
     }
     output->Resize(output_dims);
-    math::CopyMatrix<Context>(
-        input.itemsize(),
-        before,
-        axis_dim * after,
-        static_cast<const char*>(input.raw_data()) + input_offset,
-        input.dim32(canonical_axis) * after,
-        output->raw_mutable_data(input.meta()),
-        axis_dim * after,
-        &context_,
-        input.meta().copy());
+    if (output_views_ && before == 1) {
+      // Nothing before the axis, the outputs are contiguous parts of input
+      output->ShareDataWithOffset(input, input_item_offset);
+    } else {
+      math::CopyMatrix<Context>(
+          input.itemsize(),
+          before,
+          axis_dim * after,
+          static_cast<const char*>(input.raw_data()) + input_offset,
+          input.dim32(canonical_axis) * after,
+          output->raw_mutable_data(input.meta()),
+          axis_dim * after,
+          &context_,
+          input.meta().copy());
+    }
     input_offset += axis_dim * after * input.itemsize();
+    input_item_offset += axis_dim * after;
   }
   return true;
 }
@@ -18,12 +18,14 @@ why they are separate files.
 
 std::function<void(OpSchema&)> ConvDocGenerator(const char* dim) {
   return [=](OpSchema& schema) {
-    string doc = R"DOC(
+    schema.SetDocGenerator([=]() {
+      string doc = R"DOC(
 The convolution operator consumes an input vector, a {dim}filter blob
 and a bias blob and computes the output. {conv_doc})DOC";
-    ReplaceAll(doc, "{dim}", dim);
-    ReplaceAll(doc, "{conv_doc}", kConvDoc);
-    schema.SetDoc(doc);
+      ReplaceAll(doc, "{dim}", dim);
+      ReplaceAll(doc, "{conv_doc}", kConvDoc);
+      return doc;
+    });
     schema.Input(
         0,
         "X",
@@ -57,6 +59,7 @@ REGISTER_CPU_OPERATOR(Conv, ConvOp<float, CPUContext>);
 OPERATOR_SCHEMA(Conv)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
     .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
         ConvPoolOpBase<CPUContext>::CostInferenceForConv))
@@ -94,4 +97,25 @@ OPERATOR_SCHEMA(Conv3D)
     .FillUsing(ConvDocGenerator("3D "))
     .InheritOnnxSchema("Conv");
 
+REGISTER_CPU_OPERATOR(ConvRelu, ConvOp<float, CPUContext>);
+
+OPERATOR_SCHEMA(ConvRelu)
+    .NumInputs(2, 3)
+    .NumOutputs(1)
+    .AllowInplace({{0, 0}})
+    .CostInferenceFunction(OpSchema::CostInferenceFunctionType(
+        ConvPoolOpBase<CPUContext>::CostInferenceForConv))
+    .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
+    .SetDoc(R"DOC(
+Conv followed by a Relu, Y = max(Conv(X, filter, bias), 0), with the same
+arguments as Conv. The Relu is applied to each output image right after the
+bias, instead of in another pass over the output. FuseConvBNRelu replaces
+Conv and Relu pairs of inference nets with it.
+)DOC")
+    .Input(0, "X", "Input data blob, as for Conv")
+    .Input(1, "filter", "The filter blob, as for Conv")
+    .Input(2, "bias", "The optional 1D bias blob of size M")
+    .Output(0, "Y", "Output data blob, as for Conv");
+SHOULD_NOT_DO_GRADIENT(ConvRelu);
+
 } // namespace caffe2
@@ -1,12 +1,13 @@
 #ifndef CAFFE2_OPERATORS_CONV_OP_H_
 #define CAFFE2_OPERATORS_CONV_OP_H_
 
+#include <type_traits>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/operators/conv_op_shared.h"
 #include "caffe2/operators/conv_pool_op_base.h"
-
-CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
+#include "caffe2/utils/math.h"
 
 namespace caffe2 {
 
@@ -15,18 +16,23 @@ class ConvOp final : public ConvPoolOpBase<Context> {
  public:
   USE_CONV_POOL_BASE_FUNCTIONS(Context);
   ConvOp(const OperatorDef& operator_def, Workspace* ws)
-      : ConvPoolOpBase<Context>(operator_def, ws) {
+      : ConvPoolOpBase<Context>(operator_def, ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        fused_relu_(operator_def.type() == "ConvRelu") {
     // Since this is the default convolution implementation, we will
-    // use CAFFE_ENFORCE instead of OPERATOR_NEEDS_FEATURE.
+    // use CAFFE_ENFORCE instead of OPERATOR_NEEDS_FEATURE. Depthwise
+    // convolutions in NHWC order are checked when run on CPU.
     CAFFE_ENFORCE(
-        group_ == 1 || order_ == StorageOrder::NCHW,
+        group_ == 1 || order_ == StorageOrder::NCHW ||
+            (std::is_same<Context, CPUContext>::value),
         "Group convolution only supports NCHW order right now.");
 
     // Create shared buffer mutex in the constructor
     // to avoid race-condition in DAGNet.
-    if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+    if (useSharedBuffer<Context>(shared_buffer_)) {
       createSharedBuffer<Context>(ws_);
     }
+    useMathThreadPool<Context>(ws_, num_threads_, &context_);
   }
   ~ConvOp() {}
 
@@ -34,15 +40,40 @@ class ConvOp final : public ConvPoolOpBase<Context> {
   bool RunOnDeviceWithOrderNHWC() override;
 
  private:
+  // Runs depthwise 3x3 and 5x5 convolutions on CPU with the kernels of
+  // perfkernels/depthwise_conv.h, or returns false for other convolutions.
+  bool RunDepthwiseConv();
+
+  // Applies the Relu of ConvRelu to size values of the output, while they
+  // are still in cache after the bias is added
+  void RunFusedActivation(const int size, T* Ydata) {
+    if (fused_relu_) {
+      math::Maximum<T, Context>(size, 0, Ydata, Ydata, &context_);
+    }
+  }
+
+  // Threads used by the depthwise convolutions and by Im2col on CPU: 0 uses
+  // all threads of the workspace thread pool, 1 runs on the calling thread
+  const int num_threads_;
+  // ConvRelu, the Conv followed by a Relu that FuseConvBNRelu leaves in
+  // inference nets (transforms/conv_bn_relu_fusion.h)
+  const bool fused_relu_;
+
   Tensor<Context> col_buffer_;
   Tensor<Context> bias_multiplier_;
   Tensor<Context> img_shape_device_;
   Tensor<Context> col_buffer_shape_device_;
+  // Filter of depthwise convolutions in NHWC order, transposed to
+  // kernel_h x kernel_w x C
+  Tensor<Context> depthwise_filter_;
   // Input: X, W, b
   // Output: Y
   INPUT_TAGS(INPUT, FILTER, BIAS);
 };
 
+template <>
+bool ConvOp<float, CPUContext>::RunDepthwiseConv();
+
 template <typename T, class Context>
 class ConvGradientOp final : public ConvPoolOpBase<Context> {
  public:
@@ -50,6 +81,12 @@ class ConvGradientOp final : public ConvPoolOpBase<Context> {
   ConvGradientOp(const OperatorDef& operator_def, Workspace* ws)
       : ConvPoolOpBase<Context>(operator_def, ws),
         no_bias_(OperatorBase::GetSingleArgument<int>("no_bias", 0)) {
+    // Im2col and Col2im are split between num_threads threads on CPU, see
+    // ConvOp.
+    useMathThreadPool<Context>(
+        ws_,
+        OperatorBase::GetSingleArgument<int>("num_threads", 0),
+        &context_);
     CAFFE_ENFORCE(
         !(no_bias_ && OutputSize() == 3),
         "If bias is not present, you should not have 3 grad output.");
@@ -2,13 +2,153 @@
 
 #include <cudnn.h>
 
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
 
+CAFFE2_DEFINE_string(
+    caffe2_cudnn_algo_cache_file,
+    "",
+    "File of the cuDNN algorithms found by the exhaustive searches of "
+    "earlier runs, loaded on first use.");
+CAFFE2_DEFINE_bool(
+    caffe2_cudnn_algo_cache_update,
+    false,
+    "Write the cuDNN algorithms found by new exhaustive searches to "
+    "--caffe2_cudnn_algo_cache_file.");
+
 namespace caffe2 {
 
 template class AlgorithmsCache<cudnnConvolutionFwdAlgo_t>;
 template class AlgorithmsCache<cudnnConvolutionBwdFilterAlgo_t>;
 template class AlgorithmsCache<cudnnConvolutionBwdDataAlgo_t>;
 template class AlgorithmsCache<int>; // For testing.
+
+namespace {
+// First line of the files, to tell them apart from anything else
+constexpr const char* kAlgorithmsCacheHeader = "# caffe2 cudnn algorithms v1";
+} // namespace
+
+PersistentAlgorithmsCache& PersistentAlgorithmsCache::Get() {
+  static PersistentAlgorithmsCache* cache = []() {
+    auto* cache = new PersistentAlgorithmsCache();
+    if (!FLAGS_caffe2_cudnn_algo_cache_file.empty()) {
+      std::ifstream file(FLAGS_caffe2_cudnn_algo_cache_file);
+      // A missing file is expected before the first run that updates it
+      if (file.good()) {
+        const auto count = cache->Load(FLAGS_caffe2_cudnn_algo_cache_file);
+        VLOG(1) << "Loaded " << count << " cuDNN algorithms from "
+                << FLAGS_caffe2_cudnn_algo_cache_file;
+      }
+    }
+    return cache;
+  }();
+  return *cache;
+}
+
+bool PersistentAlgorithmsCache::Find(const std::string& key, Entry* entry) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  const auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    ++misses_;
+    return false;
+  }
+  ++hits_;
+  *entry = it->second;
+  return true;
+}
+
+void PersistentAlgorithmsCache::Insert(
+    const std::string& key,
+    const Entry& entry) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_[key] = entry;
+  }
+  if (FLAGS_caffe2_cudnn_algo_cache_update &&
+      !FLAGS_caffe2_cudnn_algo_cache_file.empty()) {
+    Save(FLAGS_caffe2_cudnn_algo_cache_file);
+  }
+}
+
+size_t PersistentAlgorithmsCache::Load(const std::string& path) {
+  std::ifstream file(path);
+  CAFFE_ENFORCE(file.good(), "Cannot open ", path);
+  std::string line;
+  std::getline(file, line);
+  CAFFE_ENFORCE_EQ(
+      line, kAlgorithmsCacheHeader, path, " is not a cuDNN algorithms file");
+  std::unordered_map<std::string, Entry> entries;
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    // key \t algorithm \t time
+    const auto tab = line.find('\t');
+    CAFFE_ENFORCE(tab != std::string::npos, "Bad line in ", path, ": ", line);
+    std::istringstream values(line.substr(tab + 1));
+    Entry entry;
+    CAFFE_ENFORCE(
+        values >> entry.algorithm >> entry.time,
+        "Bad line in ",
+        path,
+        ": ",
+        line);
+    entries[line.substr(0, tab)] = entry;
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const auto& it : entries) {
+    entries_[it.first] = it.second;
+  }
+  return entries.size();
+}
+
+void PersistentAlgorithmsCache::Save(const std::string& path) const {
+  std::ostringstream contents;
+  contents << kAlgorithmsCacheHeader << "\n";
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const auto& it : entries_) {
+      contents << it.first << "\t" << it.second.algorithm << "\t"
+               << it.second.time << "\n";
+    }
+  }
+  // Written aside and renamed, so that concurrent readers never see a
+  // partial file
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    CAFFE_ENFORCE(file.good(), "Cannot write ", tmp_path);
+    file << contents.str();
+    CAFFE_ENFORCE(file.good(), "Cannot write ", tmp_path);
+  }
+  CAFFE_ENFORCE_EQ(
+      std::rename(tmp_path.c_str(), path.c_str()), 0, "Cannot write ", path);
+}
+
+void PersistentAlgorithmsCache::Clear() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
+
+size_t PersistentAlgorithmsCache::size() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return entries_.size();
+}
+
+size_t PersistentAlgorithmsCache::hits() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return hits_;
+}
+
+size_t PersistentAlgorithmsCache::misses() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return misses_;
+}
+
 } // namespace caffe2
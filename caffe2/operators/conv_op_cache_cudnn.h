@@ -2,12 +2,18 @@
 #define CAFFE2_OPERATORS_CONV_OP_CACHE_H_
 
 #include <functional>
+#include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "caffe2/core/flags.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/tensor.h"
 
+CAFFE2_DECLARE_string(caffe2_cudnn_algo_cache_file);
+CAFFE2_DECLARE_bool(caffe2_cudnn_algo_cache_update);
+
 namespace caffe2 {
 template <typename TAlgorithm>
 class AlgorithmsCache {
@@ -61,6 +67,48 @@ TAlgorithm AlgorithmsCache<TAlgorithm>::getAlgorithm(
 
   return hash_[seed];
 }
+
+// Process wide cache of the results of the exhaustive cuDNN algorithm
+// searches, which outlives the operators and can be saved to a file to skip
+// the searches of later processes, e.g. shipped along with a model to the
+// serving replicas.
+//
+// The keys are strings that describe the whole problem: the GPU model, the
+// cuDNN version, the pass, the shapes, the convolution parameters and the
+// data and compute types, so that a file is only ever reused for the same
+// problem on the same setup. The file named by
+// --caffe2_cudnn_algo_cache_file is loaded on first use, and written again
+// after every new search when --caffe2_cudnn_algo_cache_update is set.
+class PersistentAlgorithmsCache {
+ public:
+  struct Entry {
+    int algorithm;
+    float time;
+  };
+
+  static PersistentAlgorithmsCache& Get();
+
+  // Looks up key, counting a hit or a miss
+  bool Find(const std::string& key, Entry* entry);
+  void Insert(const std::string& key, const Entry& entry);
+
+  // Merges the entries of a file written by Save, the entries of the file
+  // taking precedence. Returns the number of entries read.
+  size_t Load(const std::string& path);
+  void Save(const std::string& path) const;
+  void Clear();
+
+  size_t size() const;
+  size_t hits() const;
+  size_t misses() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
 } // namespace caffe2
 
 #endif
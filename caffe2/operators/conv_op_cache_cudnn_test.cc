@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <vector>
 
 #include "caffe2/core/context_gpu.h"
@@ -58,4 +59,39 @@ TEST(AlgorithmsCacheTest, KeysDifferIfFlagsAreDifferent) {
   EXPECT_EQ(res3, 10);
 }
 
+TEST(PersistentAlgorithmsCacheTest, CountsHitsAndMisses) {
+  PersistentAlgorithmsCache cache;
+  PersistentAlgorithmsCache::Entry entry;
+  EXPECT_FALSE(cache.Find("conv", &entry));
+  cache.Insert("conv", {3, 0.5f});
+  EXPECT_TRUE(cache.Find("conv", &entry));
+  EXPECT_EQ(entry.algorithm, 3);
+  EXPECT_EQ(entry.time, 0.5f);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+  EXPECT_EQ(cache.size(), 1);
+}
+
+TEST(PersistentAlgorithmsCacheTest, SavesAndLoads) {
+  const std::string path = "/tmp/caffe2_cudnn_algorithms_test";
+  PersistentAlgorithmsCache cache;
+  cache.Insert("GPU cudnn7 fwd X:1:3:8:8", {1, 0.25f});
+  cache.Insert("GPU cudnn7 bwd_data X:1:3:8:8", {5, 2.0f});
+  cache.Save(path);
+
+  PersistentAlgorithmsCache loaded;
+  loaded.Insert("GPU cudnn7 fwd X:1:3:8:8", {2, 1.0f});
+  EXPECT_EQ(loaded.Load(path), 2);
+  EXPECT_EQ(loaded.size(), 2);
+  PersistentAlgorithmsCache::Entry entry;
+  // The entries of the file take precedence
+  EXPECT_TRUE(loaded.Find("GPU cudnn7 fwd X:1:3:8:8", &entry));
+  EXPECT_EQ(entry.algorithm, 1);
+  EXPECT_EQ(entry.time, 0.25f);
+  EXPECT_TRUE(loaded.Find("GPU cudnn7 bwd_data X:1:3:8:8", &entry));
+  EXPECT_EQ(entry.algorithm, 5);
+  EXPECT_EQ(entry.time, 2.0f);
+  std::remove(path.c_str());
+}
+
 } // namespace caffe2
@@ -1,5 +1,7 @@
 #include "caffe2/core/context_gpu.h"
 
+#include <sstream>
+
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/cudnn_wrappers.h"
 #include "caffe2/operators/conv_op.h"
@@ -402,6 +404,62 @@ class CudnnConvOpBase : public ConvPoolOpBase<CUDAContext> {
     }
   }
 
+  // Key of the exhaustive search of pass in the persistent algorithms
+  // cache, for X of type T_X and the given compute type
+  template <typename T_X>
+  std::string AlgorithmCacheKey(
+      const char* pass,
+      const Tensor<CUDAContext>& X,
+      const Tensor<CUDAContext>& filter,
+      cudnnDataType_t compute_type) {
+    const auto& prop = GetDeviceProperty(context_.cuda_gpu_id());
+    std::ostringstream key;
+    const auto append = [&key](const char* name, const vector<TIndex>& v) {
+      key << " " << name;
+      for (const auto d : v) {
+        key << ":" << d;
+      }
+    };
+    key << prop.name << " sm" << prop.major << prop.minor << " cudnn"
+        << cudnnRuntimeVersion() << " " << pass << " order" << order_
+        << " type" << cudnnTypeWrapper<T_X>::type << " compute"
+        << compute_type << " tensor_core" << enable_tensor_core_
+        << " ws_limit" << cudnn_ws_nbytes_limit_ << " group" << group_;
+    append("X", X.dims());
+    append("filter", filter.dims());
+    append("kernel", vector<TIndex>(kernel_.begin(), kernel_.end()));
+    append("pads", vector<TIndex>(pads_.begin(), pads_.end()));
+    append("stride", vector<TIndex>(stride_.begin(), stride_.end()));
+    append("dilation", vector<TIndex>(dilation_.begin(), dilation_.end()));
+    return key.str();
+  }
+
+  // Looks up the result of an exhaustive search in the persistent cache
+  template <typename TAlgorithm>
+  bool FindCachedAlgorithm(
+      const std::string& key,
+      std::tuple<TAlgorithm, float>* algo) {
+    PersistentAlgorithmsCache::Entry entry;
+    if (!PersistentAlgorithmsCache::Get().Find(key, &entry)) {
+      return false;
+    }
+    *algo = std::make_tuple(
+        static_cast<TAlgorithm>(entry.algorithm), entry.time);
+    return true;
+  }
+
+  // Adds the result of an exhaustive search to the persistent cache
+  template <typename TAlgorithm>
+  std::tuple<TAlgorithm, float> CacheAlgorithm(
+      const std::string& key,
+      const std::tuple<TAlgorithm, float>& algo) {
+    PersistentAlgorithmsCache::Entry entry;
+    entry.algorithm = static_cast<int>(std::get<0>(algo));
+    entry.time = std::get<1>(algo);
+    PersistentAlgorithmsCache::Get().Insert(key, entry);
+    return algo;
+  }
+
   vector<TIndex> cudnn_input_dims_;
   vector<TIndex> cudnn_filter_dims_;
 
@@ -683,7 +741,16 @@ bool CudnnConvOp::DoRunWithType() {
         SetConvDescComputeType(conv_desc_, kComputeTypesToTry[i]);
 
         algosToCompare[i] = algo_cache_.getAlgorithm(
-            X.dims(), filter.dims(), kComputeTypesToTry[i], [&]() {
+            X.dims(),
+            filter.dims(),
+            kComputeTypesToTry[i],
+            [&]() -> ConvFwdAlgorithmWithCost {
+              const auto key = AlgorithmCacheKey<T_X>(
+                  "fwd", X, filter, kComputeTypesToTry[i]);
+              ConvFwdAlgorithmWithCost cached;
+              if (FindCachedAlgorithm(key, &cached)) {
+                return cached;
+              }
               VLOG(1) << "CUDNN Convolution fwd: doing exhaustive "
                       << "search for " << kComputePassNames[i];
               // When we do an exhaustive search, we will ignore the workspace
@@ -716,7 +783,9 @@ bool CudnnConvOp::DoRunWithType() {
               float algo_time = fwd_perf_stat[0].status == CUDNN_STATUS_SUCCESS
                   ? fwd_perf_stat[0].time
                   : 1e10;
-              return ConvFwdAlgorithmWithCost(fwd_perf_stat[0].algo, algo_time);
+              return CacheAlgorithm(
+                  key,
+                  ConvFwdAlgorithmWithCost(fwd_perf_stat[0].algo, algo_time));
             });
 
         // When set to fp32 compute, don't try fp16
@@ -1048,7 +1117,16 @@ bool CudnnConvGradientOp::DoRunWithType() {
         SetConvDescComputeType(bwd_filter_conv_desc_, kComputeTypesToTry[i]);
 
         algosToCompare[i] = filter_algo_cache_.getAlgorithm(
-            X.dims(), filter.dims(), kComputeTypesToTry[i], [&]() {
+            X.dims(),
+            filter.dims(),
+            kComputeTypesToTry[i],
+            [&]() -> ConvBwdFilterAlgorithmWithCost {
+              const auto key = AlgorithmCacheKey<T_X>(
+                  "bwd_filter", X, filter, kComputeTypesToTry[i]);
+              ConvBwdFilterAlgorithmWithCost cached;
+              if (FindCachedAlgorithm(key, &cached)) {
+                return cached;
+              }
               VLOG(1) << "CUDNN Convolution bwd: doing filter exhaustive"
                       << "search for " << kComputePassNames[i];
               // When we do an exhaustive search, we will ignore the workspace
@@ -1085,8 +1163,10 @@ bool CudnnConvGradientOp::DoRunWithType() {
                   filter_perf_stat[0].status == CUDNN_STATUS_SUCCESS
                   ? filter_perf_stat[0].time
                   : 1e10;
-              return ConvBwdFilterAlgorithmWithCost(
-                  filter_perf_stat[0].algo, algo_time);
+              return CacheAlgorithm(
+                  key,
+                  ConvBwdFilterAlgorithmWithCost(
+                      filter_perf_stat[0].algo, algo_time));
             });
 
         // When set to fp32 compute, don't try fp16
@@ -1135,7 +1215,16 @@ bool CudnnConvGradientOp::DoRunWithType() {
           SetConvDescComputeType(bwd_data_conv_desc_, kComputeTypesToTry[i]);
 
           algosToCompare[i] = data_algo_cache_.getAlgorithm(
-              X.dims(), filter.dims(), kComputeTypesToTry[i], [&]() {
+              X.dims(),
+              filter.dims(),
+              kComputeTypesToTry[i],
+              [&]() -> ConvBwdDataAlgorithmWithCost {
+                const auto key = AlgorithmCacheKey<T_X>(
+                    "bwd_data", X, filter, kComputeTypesToTry[i]);
+                ConvBwdDataAlgorithmWithCost cached;
+                if (FindCachedAlgorithm(key, &cached)) {
+                  return cached;
+                }
                 VLOG(1) << "CUDNN Convolution bwd: doing data exhaustive"
                         << "search for " << kComputePassNames[i];
                 int returned_algo_count;
@@ -1173,8 +1262,10 @@ bool CudnnConvGradientOp::DoRunWithType() {
                     data_perf_stat[0].status == CUDNN_STATUS_SUCCESS
                     ? data_perf_stat[0].time
                     : 1e10;
-                return ConvBwdDataAlgorithmWithCost(
-                    data_perf_stat[0].algo, algo_time);
+                return CacheAlgorithm(
+                    key,
+                    ConvBwdDataAlgorithmWithCost(
+                        data_perf_stat[0].algo, algo_time));
               });
 
           // When set to fp32 compute, don't try fp16
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <functional>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/operators/conv_op.h"
+#include "caffe2/perfkernels/depthwise_conv.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+// Depthwise convolutions run as group_ = C convolutions of a single channel,
+// whose tiny matrix products are much slower than direct convolutions. The
+// planes of NCHW inputs, and the output rows of NHWC inputs, are split
+// between the threads.
+template <>
+bool ConvOp<float, CPUContext>::RunDepthwiseConv() {
+  const auto& X = Input(INPUT);
+  const auto& filter = Input(FILTER);
+  if (X.ndim() != 4 || filter.ndim() != 4) {
+    return false;
+  }
+  const bool nchw = order_ == StorageOrder::NCHW;
+  const int C = nchw ? X.dim32(1) : X.dim32(3);
+  const int M = filter.dim32(0);
+  const int kernel = kernel_h();
+  if (!IsDepthwiseConv2D(C, M) || kernel != kernel_w() ||
+      (kernel != 3 && kernel != 5) || stride_h() != stride_w() ||
+      dilation_h() != 1 || dilation_w() != 1) {
+    return false;
+  }
+  const int stride = stride_h();
+  if (nchw) {
+    CAFFE_ENFORCE_EQ(filter.dim32(1), 1);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), kernel);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), kernel);
+  } else {
+    CAFFE_ENFORCE_EQ(filter.dim32(1), kernel);
+    CAFFE_ENFORCE_EQ(filter.dim32(2), kernel);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), 1);
+  }
+  const float* bias = nullptr;
+  if (InputSize() == 3) {
+    const auto& b = Input(BIAS);
+    CAFFE_ENFORCE_EQ(b.ndim(), 1);
+    CAFFE_ENFORCE_EQ(b.dim32(0), M);
+    bias = b.data<float>();
+  }
+
+  auto* Y = Output(0);
+  SetOutputSize(X, Y, M);
+  const int N = X.dim32(0);
+  const int H = nchw ? X.dim32(2) : X.dim32(1);
+  const int W = nchw ? X.dim32(3) : X.dim32(2);
+  const int out_h = nchw ? Y->dim32(2) : Y->dim32(1);
+  const int out_w = nchw ? Y->dim32(3) : Y->dim32(2);
+  const float* Xdata = X.data<float>();
+  float* Ydata = Y->mutable_data<float>();
+
+  // Runs fn(begin, end) on ranges splitting [0, n) between the threads
+  const auto parallel_for = [&](
+      const TIndex n, const std::function<void(TIndex, TIndex)>& fn) {
+    TIndex num_ranges = 1;
+    if (num_threads_ != 1) {
+      const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+      num_ranges = std::min<TIndex>(
+          n,
+          num_threads_ == 0 ? pool_threads
+                            : std::min(num_threads_, pool_threads));
+    }
+    if (num_ranges <= 1) {
+      fn(0, n);
+      return;
+    }
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+      fn(range * n / num_ranges, (range + 1) * n / num_ranges);
+    });
+  };
+
+  if (nchw) {
+    const float* filter_data = filter.data<float>();
+    parallel_for(
+        static_cast<TIndex>(N) * C, [&](const TIndex begin, const TIndex end) {
+          for (TIndex plane = begin; plane < end; ++plane) {
+            const int c = plane % C;
+            DepthwiseConv2DNCHW(
+                kernel,
+                stride,
+                H,
+                W,
+                out_h,
+                out_w,
+                pad_t(),
+                pad_l(),
+                Xdata + plane * H * W,
+                filter_data + c * kernel * kernel,
+                bias ? bias[c] : 0,
+                Ydata + plane * out_h * out_w);
+            RunFusedActivation(out_h * out_w, Ydata + plane * out_h * out_w);
+          }
+        });
+    return true;
+  }
+
+  // The C x kernel x kernel x 1 filter is transposed so that the filter
+  // values of consecutive channels are contiguous.
+  depthwise_filter_.Resize(kernel, kernel, C);
+  const float* filter_data = filter.data<float>();
+  float* transposed = depthwise_filter_.mutable_data<float>();
+  for (int c = 0; c < C; ++c) {
+    for (int k = 0; k < kernel * kernel; ++k) {
+      transposed[k * C + c] = filter_data[c * kernel * kernel + k];
+    }
+  }
+  parallel_for(
+      static_cast<TIndex>(N) * out_h,
+      [&](const TIndex begin, const TIndex end) {
+        // Rows of the same image are run with one call
+        for (TIndex row = begin; row < end;) {
+          const TIndex image = row / out_h;
+          const TIndex image_end = std::min(end, (image + 1) * out_h);
+          DepthwiseConv2DNHWC(
+              kernel,
+              stride,
+              H,
+              W,
+              C,
+              out_h,
+              out_w,
+              pad_t(),
+              pad_l(),
+              row - image * out_h,
+              image_end - image * out_h,
+              Xdata + image * H * W * C,
+              transposed,
+              bias,
+              Ydata + image * out_h * out_w * C);
+          RunFusedActivation(
+              (image_end - row) * out_w * C, Ydata + row * out_w * C);
+          row = image_end;
+        }
+      });
+  return true;
+}
+
+} // namespace caffe2
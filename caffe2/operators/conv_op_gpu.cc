@@ -14,4 +14,6 @@ REGISTER_CUDA_OPERATOR(Conv2DGradient, ConvGradientOp<float, CUDAContext>);
 
 REGISTER_CUDA_OPERATOR(Conv3D, ConvOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(Conv3DGradient, ConvGradientOp<float, CUDAContext>);
+
+REGISTER_CUDA_OPERATOR(ConvRelu, ConvOp<float, CUDAContext>);
 }  // namespace caffe2
@@ -12,8 +12,18 @@
 
 namespace caffe2 {
 
+// Only the CPU float convolutions have depthwise kernels, see
+// conv_op_depthwise.cc.
+template <typename T, class Context>
+bool ConvOp<T, Context>::RunDepthwiseConv() {
+  return false;
+}
+
 template <typename T, class Context>
 bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
+  if (RunDepthwiseConv()) {
+    return true;
+  }
   const Tensor<Context>& X = Input(INPUT);
   auto& filter = Input(FILTER);
   Tensor<Context>* Y = Output(0);
@@ -81,6 +91,45 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   }
   T* Ydata = Y->template mutable_data<T>();
 
+  // Specialized path for 1 by 1 convolution with stride 1, pad 0 - the
+  // input images are already the columns, so we can skip im2col.
+  if (ConvPoolOpBase<Context>::Is1x1Conv()) {
+    for (int image_id = 0; image_id < N; ++image_id) {
+      for (int group_id = 0; group_id < group_; ++group_id) {
+        math::Gemm<T, Context>(
+            CblasNoTrans,
+            CblasNoTrans,
+            M / group_,
+            output_image_size,
+            kernel_dim,
+            1,
+            filter.template data<T>() + group_id * filter_offset,
+            Xdata + group_id * input_offset,
+            0,
+            Ydata + group_id * output_offset,
+            &context_);
+      }
+      if (InputSize() == 3) {
+        math::Gemm<T, Context>(
+            CblasNoTrans,
+            CblasNoTrans,
+            M,
+            output_image_size,
+            1,
+            1,
+            Input(BIAS).template data<T>(),
+            bias_multiplier_.template data<T>(),
+            1,
+            Ydata,
+            &context_);
+      }
+      RunFusedActivation(output_offset * group_, Ydata);
+      Xdata += input_offset * group_;
+      Ydata += output_offset * group_;
+    }
+    return true;
+  }
+
   auto f = [&](Tensor<Context>* col_buffer) {
     col_buffer->Resize(buffer_shape);
     T* col_buffer_data = col_buffer->template mutable_data<T>();
@@ -151,12 +200,13 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
             Ydata,
             &context_);
       }
+      RunFusedActivation(output_offset * group_, Ydata);
       Xdata += input_offset * group_;
       Ydata += output_offset * group_;
     }
   };
 
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+  if (useSharedBuffer<Context>(shared_buffer_)) {
     runWithSharedBuffer<Context>(ws_, f);
   } else {
     f(&col_buffer_);
@@ -167,6 +217,14 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
 // The implementations.
 template <typename T, class Context>
 bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
+  if (RunDepthwiseConv()) {
+    return true;
+  }
+  CAFFE_ENFORCE_EQ(
+      group_,
+      1,
+      "Group convolution in NHWC order is only supported for depthwise ",
+      "3x3 and 5x5 convolutions on CPU.");
   const Tensor<Context>& X = Input(INPUT);
   auto& filter = Input(FILTER);
   Tensor<Context>* Y = Output(0);
@@ -197,10 +255,8 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
   const T* Xdata = X.template data<T>();
   T* Ydata = Y->template mutable_data<T>();
   // Specialized path for 1 by 1 convolution with stride 1, pad 0 - we
-  // can skip im2col.
-  if (kernel_dim == C && Y->dim32(1) == X.dim32(1) &&
-      Y->dim32(2) == X.dim32(2) && stride_h() == 1 && stride_w() == 1 &&
-      pad_t() == 0 && pad_b() == 0 && pad_l() == 0 && pad_r() == 0) {
+  // can skip im2col, and the batch is a single matrix product.
+  if (ConvPoolOpBase<Context>::Is1x1Conv()) {
     math::Gemm<T, Context>(
         CblasNoTrans,
         CblasTrans,
@@ -239,6 +295,7 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
           Ydata,
           &context_);
     }
+    RunFusedActivation(Y->size(), Ydata);
   } else {
     if (InputSize() == 3) {
       const auto& bias = Input(BIAS);
@@ -298,11 +355,12 @@ bool ConvOp<T, Context>::RunOnDeviceWithOrderNHWC() {
               Ydata,
               &context_);
         }
+        RunFusedActivation(output_offset, Ydata);
         Xdata += input_offset;
         Ydata += output_offset;
       }
     };
-    if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+    if (useSharedBuffer<Context>(shared_buffer_)) {
       runWithSharedBuffer<Context>(ws_, f);
     } else {
       f(&col_buffer_);
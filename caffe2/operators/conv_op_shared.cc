@@ -2,11 +2,17 @@
 #include "caffe2/core/context.h"
 #include "caffe2/core/flags.h"
 #include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 CAFFE2_DEFINE_bool(
     caffe2_force_shared_col_buffer,
     false,
     "Always use the shared col buffer");
+CAFFE2_DEFINE_bool(
+    caffe2_thread_local_col_buffer,
+    false,
+    "Run all the CPU conv ops with one col buffer per thread, which they "
+    "share without locking, instead of their own buffers or the shared one");
 
 namespace caffe2 {
 
@@ -22,6 +28,15 @@ template <>
 void runWithSharedBuffer(
     Workspace* ws,
     std::function<void(Tensor<CPUContext>* buffer)> f) {
+  if (FLAGS_caffe2_thread_local_col_buffer) {
+    // Ops running at the same time run on different threads, so they don't
+    // need to wait for each other
+    static thread_local TensorCPU buffer;
+    f(&buffer);
+    buffer.ReserveCurrentCapacity();
+    return;
+  }
+
   auto* mutexBlob = ws->GetBlob("__CAFFE2_SHARED_CONV_BUFFER_CPU_MUTEX__");
   CAFFE_ENFORCE(mutexBlob, "Must call createSharedBuffer() first");
 
@@ -31,4 +46,15 @@ void runWithSharedBuffer(
       ws->GetBlob("__CAFFE2_SHARED_CONV_BUFFER_CPU__")->GetMutable<TensorCPU>();
   f(buffer);
 }
+
+template <>
+void useMathThreadPool<CPUContext>(
+    Workspace* ws,
+    int num_threads,
+    CPUContext* context) {
+  CAFFE_ENFORCE_GE(num_threads, 0, "num_threads has to be non negative");
+  if (num_threads != 1) {
+    context->set_thread_pool(ws->GetThreadPool(), num_threads);
+  }
+}
 }
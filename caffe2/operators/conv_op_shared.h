@@ -1,12 +1,31 @@
 #ifndef CAFFE2_OPERATORS_CONV_OP_SHARED_H_
 #define CAFFE2_OPERATORS_CONV_OP_SHARED_H_
 
+#include <type_traits>
+
 #include "caffe2/core/context.h"
+#include "caffe2/core/flags.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/workspace.h"
 
+CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
+CAFFE2_DECLARE_bool(caffe2_thread_local_col_buffer);
+
 namespace caffe2 {
 
+/**
+ * Whether an op with the given `shared_buffer` argument runs with
+ * runWithSharedBuffer() rather than with a buffer of its own. With
+ * caffe2_thread_local_col_buffer, CPU ops always do, so that every thread
+ * reuses one buffer for all of them.
+ */
+template <typename Context>
+inline bool useSharedBuffer(bool shared_buffer) {
+  return shared_buffer || FLAGS_caffe2_force_shared_col_buffer ||
+      (FLAGS_caffe2_thread_local_col_buffer &&
+       std::is_same<Context, CPUContext>::value);
+}
+
 /**
  * Creates a mutex and shared buffer in the workspace.
  * Not thread-safe, must be called from the constructor.
@@ -16,12 +35,29 @@ void createSharedBuffer(Workspace* ws);
 
 /**
  * Thread-safe, can be invoked from RunOnDevice() to serialize
- * access to shared buffer.
+ * access to shared buffer. With caffe2_thread_local_col_buffer, CPU ops get
+ * the buffer of the calling thread instead, without locking, which keeps
+ * the largest size it has been resized to.
  */
 template <typename Context>
 void runWithSharedBuffer(
     Workspace* ws,
     std::function<void(Tensor<Context>* buffer)> f);
+
+/**
+ * Lets the math functions run with context, such as Im2col and Col2im, use
+ * up to num_threads threads of the workspace thread pool (0 for all of
+ * them, 1 to run on the calling thread). Only CPUContext supports it, it
+ * does nothing for other contexts. Must be called from the constructor.
+ */
+template <typename Context>
+void useMathThreadPool(Workspace* /*ws*/, int /*num_threads*/, Context*) {}
+
+template <>
+void useMathThreadPool<CPUContext>(
+    Workspace* ws,
+    int num_threads,
+    CPUContext* context);
 } // namespace caffe2
 
 #endif // CAFFE2_OPERATORS_CONV_OP_SHARED_H_
@@ -0,0 +1,84 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "caffe2/core/flags.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_op_shared.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddConstInput(
+    const vector<TIndex>& shape,
+    float value,
+    const string& name,
+    Workspace* ws) {
+  CPUContext context;
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(shape);
+  math::Set<float, CPUContext>(
+      tensor->size(), value, tensor->mutable_data<float>(), &context);
+}
+
+// Conv of X with a kernel_size x kernel_size filter into Y
+OperatorDef ConvDef(int kernel_size, const string& X, const string& Y) {
+  OperatorDef def;
+  def.set_type("Conv");
+  def.add_input(X);
+  def.add_input("W" + caffe2::to_string(kernel_size));
+  def.add_output(Y);
+  def.add_arg()->CopyFrom(MakeArgument("kernel", kernel_size));
+  def.add_arg()->CopyFrom(MakeArgument("pad", kernel_size / 2));
+  return def;
+}
+
+} // namespace
+
+TEST(ConvOpSharedTest, ThreadLocalColBuffer) {
+  Workspace ws;
+  AddConstInput({2, 4, 16, 16}, 1, "X", &ws);
+  AddConstInput({8, 4, 3, 3}, 0.5, "W3", &ws);
+  AddConstInput({8, 4, 5, 5}, 0.25, "W5", &ws);
+
+  // Reference outputs, with buffers of their own
+  for (int k : {3, 5}) {
+    const string k_str = caffe2::to_string(k);
+    ASSERT_TRUE(ws.RunOperatorOnce(ConvDef(k, "X", "Y_ref" + k_str)));
+  }
+
+  FLAGS_caffe2_thread_local_col_buffer = true;
+  std::vector<std::unique_ptr<OperatorBase>> ops;
+  for (int k : {3, 5}) {
+    ops.push_back(CreateOperator(
+        ConvDef(k, "X", "Y" + caffe2::to_string(k)), &ws));
+  }
+  // Both ops run at the same time with the buffers of their threads
+  std::vector<std::thread> threads;
+  for (auto& op : ops) {
+    auto* op_ptr = op.get();
+    threads.emplace_back([op_ptr]() {
+      for (int i = 0; i < 20; i++) {
+        CAFFE_ENFORCE(op_ptr->Run());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  FLAGS_caffe2_thread_local_col_buffer = false;
+
+  for (int k : {3, 5}) {
+    const string k_str = caffe2::to_string(k);
+    const auto& Y = ws.GetBlob("Y" + k_str)->Get<TensorCPU>();
+    const auto& Y_ref = ws.GetBlob("Y_ref" + k_str)->Get<TensorCPU>();
+    ASSERT_EQ(Y.dims(), Y_ref.dims());
+    for (int i = 0; i < Y.size(); i++) {
+      EXPECT_EQ(Y.data<float>()[i], Y_ref.data<float>()[i]);
+    }
+  }
+}
+
+} // namespace caffe2
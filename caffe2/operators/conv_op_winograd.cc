@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+namespace {
+
+// One dimensional transforms of the Winograd F(kTile, 3) algorithms, from
+// Lavin and Gray, "Fast Algorithms for Convolutional Neural Networks", with
+// the products by the zeros of the B^T, G and A^T matrices left out. The
+// input and filter tiles have kAlpha = kTile + 2 elements. Two dimensional
+// transforms apply them to the columns, then to the rows of a tile.
+template <int kTile>
+struct Winograd;
+
+template <>
+struct Winograd<2> {
+  static constexpr int kAlpha = 4;
+
+  // u = G g
+  static void Filter(const float* g, int gs, float* u, int us) {
+    u[0] = g[0];
+    u[us] = 0.5f * (g[0] + g[gs] + g[2 * gs]);
+    u[2 * us] = 0.5f * (g[0] - g[gs] + g[2 * gs]);
+    u[3 * us] = g[2 * gs];
+  }
+
+  // v = B^T d
+  static void Input(const float* d, int ds, float* v, int vs) {
+    v[0] = d[0] - d[2 * ds];
+    v[vs] = d[ds] + d[2 * ds];
+    v[2 * vs] = d[2 * ds] - d[ds];
+    v[3 * vs] = d[ds] - d[3 * ds];
+  }
+
+  // y = A^T m
+  static void Output(const float* m, int ms, float* y, int ys) {
+    y[0] = m[0] + m[ms] + m[2 * ms];
+    y[ys] = m[ms] - m[2 * ms] - m[3 * ms];
+  }
+};
+
+template <>
+struct Winograd<4> {
+  static constexpr int kAlpha = 6;
+
+  static void Filter(const float* g, int gs, float* u, int us) {
+    const float g0 = g[0], g1 = g[gs], g2 = g[2 * gs];
+    u[0] = g0 * (1.0f / 4);
+    u[us] = (g0 + g1 + g2) * (-1.0f / 6);
+    u[2 * us] = (g0 - g1 + g2) * (-1.0f / 6);
+    u[3 * us] = g0 * (1.0f / 24) + g1 * (1.0f / 12) + g2 * (1.0f / 6);
+    u[4 * us] = g0 * (1.0f / 24) - g1 * (1.0f / 12) + g2 * (1.0f / 6);
+    u[5 * us] = g2;
+  }
+
+  static void Input(const float* d, int ds, float* v, int vs) {
+    const float d0 = d[0], d1 = d[ds], d2 = d[2 * ds], d3 = d[3 * ds],
+                d4 = d[4 * ds], d5 = d[5 * ds];
+    v[0] = 4 * d0 - 5 * d2 + d4;
+    v[vs] = d3 + d4 - 4 * (d1 + d2);
+    v[2 * vs] = d4 - d3 + 4 * (d1 - d2);
+    v[3 * vs] = d4 - d2 + 2 * (d3 - d1);
+    v[4 * vs] = d4 - d2 + 2 * (d1 - d3);
+    v[5 * vs] = 4 * d1 - 5 * d3 + d5;
+  }
+
+  static void Output(const float* m, int ms, float* y, int ys) {
+    const float m0 = m[0], m1 = m[ms], m2 = m[2 * ms], m3 = m[3 * ms],
+                m4 = m[4 * ms], m5 = m[5 * ms];
+    const float a = m1 + m2, b = m1 - m2, c = m3 + m4, d = m3 - m4;
+    y[0] = m0 + a + c;
+    y[ys] = b + 2 * d;
+    y[2 * ys] = a + 4 * c;
+    y[3 * ys] = b + 8 * d + m5;
+  }
+};
+
+// u[(i * kAlpha + j) * stride] = (G g G^T)[i][j] for the 3 x 3 filter g
+template <int kTile>
+void TransformFilter(const float* g, const TIndex stride, float* u) {
+  using W = Winograd<kTile>;
+  constexpr int kAlpha = W::kAlpha;
+  float tmp[kAlpha][3];
+  float out[kAlpha][kAlpha];
+  for (int j = 0; j < 3; ++j) {
+    W::Filter(g + j, 3, &tmp[0][j], 3);
+  }
+  for (int i = 0; i < kAlpha; ++i) {
+    W::Filter(tmp[i], 1, out[i], 1);
+  }
+  for (int i = 0; i < kAlpha; ++i) {
+    for (int j = 0; j < kAlpha; ++j) {
+      u[(i * kAlpha + j) * stride] = out[i][j];
+    }
+  }
+}
+
+// v[(i * kAlpha + j) * stride] = (B^T d B)[i][j] for the input tile d
+template <int kTile>
+void TransformInputTile(
+    const float d[Winograd<kTile>::kAlpha][Winograd<kTile>::kAlpha],
+    const TIndex stride,
+    float* v) {
+  using W = Winograd<kTile>;
+  constexpr int kAlpha = W::kAlpha;
+  float tmp[kAlpha][kAlpha];
+  float out[kAlpha][kAlpha];
+  for (int j = 0; j < kAlpha; ++j) {
+    W::Input(&d[0][j], kAlpha, &tmp[0][j], kAlpha);
+  }
+  for (int i = 0; i < kAlpha; ++i) {
+    W::Input(tmp[i], 1, out[i], 1);
+  }
+  for (int i = 0; i < kAlpha; ++i) {
+    for (int j = 0; j < kAlpha; ++j) {
+      v[(i * kAlpha + j) * stride] = out[i][j];
+    }
+  }
+}
+
+// y = A^T m A + bias, where m[i][j] = m[(i * kAlpha + j) * stride]
+template <int kTile>
+void TransformOutputTile(
+    const float* m,
+    const TIndex stride,
+    const float bias,
+    float y[kTile][kTile]) {
+  using W = Winograd<kTile>;
+  constexpr int kAlpha = W::kAlpha;
+  float in[kAlpha][kAlpha];
+  float tmp[kTile][kAlpha];
+  for (int i = 0; i < kAlpha; ++i) {
+    for (int j = 0; j < kAlpha; ++j) {
+      in[i][j] = m[(i * kAlpha + j) * stride];
+    }
+  }
+  for (int j = 0; j < kAlpha; ++j) {
+    W::Output(&in[0][j], kAlpha, &tmp[0][j], kAlpha);
+  }
+  for (int i = 0; i < kTile; ++i) {
+    W::Output(tmp[i], 1, y[i], 1);
+    for (int j = 0; j < kTile; ++j) {
+      y[i][j] += bias;
+    }
+  }
+}
+
+// Upper bound on the number of floats of the transformed input and output
+// tiles processed at once
+constexpr TIndex kWinogradBufferSize = 1 << 21;
+
+} // namespace
+
+// Winograd convolution for 3x3 filters with stride and dilation 1, in NCHW
+// order and without groups. Every output tile of kTile x kTile is computed
+// from a (kTile + 2) x (kTile + 2) input tile: input tiles and filters are
+// transformed, multiplied channel-wise with (kTile + 2)^2 Gemms, and the
+// products are transformed back. This takes 2.25 (F(2x2, 3x3)) or 4
+// (F(4x4, 3x3)) times fewer multiplications than the im2col path.
+//
+// The transformed filters are kept between runs and computed again only when
+// the filter tensor changes, as told by its address, data and version(). The
+// tile transforms and Gemms run on num_threads threads of the workspace
+// thread pool.
+class WinogradConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  WinogradConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        tile_(OperatorBase::GetSingleArgument<int>("winograd_tile", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
+    OPERATOR_NEEDS_FEATURE(
+        order_ == StorageOrder::NCHW, "Winograd only supports NCHW order.");
+    OPERATOR_NEEDS_FEATURE(
+        kernel_.size() == 2 && kernel_h() == 3 && kernel_w() == 3,
+        "Winograd only supports 3x3 filters.");
+    OPERATOR_NEEDS_FEATURE(
+        stride_h() == 1 && stride_w() == 1,
+        "Winograd only supports stride 1.");
+    OPERATOR_NEEDS_FEATURE(
+        dilation_h() == 1 && dilation_w() == 1,
+        "Winograd only supports dilation 1.");
+    OPERATOR_NEEDS_FEATURE(
+        group_ == 1, "Group convolution not supported yet.");
+    CAFFE_ENFORCE(
+        tile_ == 0 || tile_ == 2 || tile_ == 4,
+        "winograd_tile has to be 0 (automatic), 2 or 4");
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
+  ~WinogradConvOp() {}
+
+  bool RunOnDeviceWithOrderNCHW() override {
+    auto& X = Input(INPUT);
+    auto& filter = Input(FILTER);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE_EQ(X.ndim(), 4, "Input has to be 4-D");
+    CAFFE_ENFORCE_EQ(filter.ndim(), 4, "Filter has to be 4-D");
+    CAFFE_ENFORCE_EQ(filter.dim32(1), X.dim32(1));
+    CAFFE_ENFORCE_EQ(filter.dim32(2), 3);
+    CAFFE_ENFORCE_EQ(filter.dim32(3), 3);
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X, Y, filter.dim32(0));
+    const int tile = tile_ != 0
+        ? tile_
+        : (std::min(Y->dim32(2), Y->dim32(3)) >= 8 ? 4 : 2);
+    if (tile == 2) {
+      RunWithTile<2>(X, filter, Y);
+    } else {
+      RunWithTile<4>(X, filter, Y);
+    }
+    return true;
+  }
+
+ private:
+  template <int kTile>
+  void RunWithTile(const TensorCPU& X, const TensorCPU& filter, TensorCPU* Y) {
+    constexpr int kAlpha = Winograd<kTile>::kAlpha;
+    constexpr int kAlpha2 = kAlpha * kAlpha;
+    const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
+    const int M = Y->dim32(1), oH = Y->dim32(2), oW = Y->dim32(3);
+    const float* bias = nullptr;
+    if (InputSize() == 3) {
+      auto& bias_tensor = Input(BIAS);
+      CAFFE_ENFORCE_EQ(bias_tensor.ndim(), 1);
+      CAFFE_ENFORCE_EQ(bias_tensor.dim32(0), M);
+      bias = bias_tensor.data<float>();
+    }
+    const float* U = TransformedFilter<kTile>(filter);
+    const float* Xdata = X.data<float>();
+    float* Ydata = Y->mutable_data<float>();
+
+    const int tiles_h = (oH + kTile - 1) / kTile;
+    const int tiles_w = (oW + kTile - 1) / kTile;
+    const TIndex tiles_per_image = static_cast<TIndex>(tiles_h) * tiles_w;
+    const TIndex num_tiles = N * tiles_per_image;
+    const TIndex block_size = std::max<TIndex>(
+        1,
+        std::min<TIndex>(
+            num_tiles, kWinogradBufferSize / (kAlpha2 * std::max(C, M))));
+    const int pad_top = pad_t(), pad_left = pad_l();
+
+    for (TIndex t0 = 0; t0 < num_tiles; t0 += block_size) {
+      const TIndex nt = std::min(block_size, num_tiles - t0);
+      input_buffer_.Resize(kAlpha2, C, nt);
+      output_buffer_.Resize(kAlpha2, M, nt);
+      float* V = input_buffer_.mutable_data<float>();
+      float* Mt = output_buffer_.mutable_data<float>();
+
+      // V[ij][c][t] = (B^T d B)[i][j] for the input tile d of channel c
+      ParallelFor(C, [&](TIndex c_begin, TIndex c_end) {
+        float d[kAlpha][kAlpha];
+        for (TIndex c = c_begin; c < c_end; ++c) {
+          for (TIndex t = 0; t < nt; ++t) {
+            const TIndex n = (t0 + t) / tiles_per_image;
+            const TIndex p = (t0 + t) % tiles_per_image;
+            const int y0 = (p / tiles_w) * kTile - pad_top;
+            const int x0 = (p % tiles_w) * kTile - pad_left;
+            const float* image = Xdata + (n * C + c) * H * W;
+            if (y0 >= 0 && y0 + kAlpha <= H && x0 >= 0 && x0 + kAlpha <= W) {
+              for (int i = 0; i < kAlpha; ++i) {
+                for (int j = 0; j < kAlpha; ++j) {
+                  d[i][j] = image[(y0 + i) * W + x0 + j];
+                }
+              }
+            } else {
+              for (int i = 0; i < kAlpha; ++i) {
+                for (int j = 0; j < kAlpha; ++j) {
+                  const int y = y0 + i, x = x0 + j;
+                  d[i][j] = (y >= 0 && y < H && x >= 0 && x < W)
+                      ? image[y * W + x]
+                      : 0;
+                }
+              }
+            }
+            TransformInputTile<kTile>(d, C * nt, V + c * nt + t);
+          }
+        }
+      });
+
+      // Mt[ij] = U[ij] V[ij], of size M x nt
+      ParallelFor(kAlpha2, [&](TIndex begin, TIndex end) {
+        for (TIndex ij = begin; ij < end; ++ij) {
+          math::Gemm<float, CPUContext>(
+              CblasNoTrans,
+              CblasNoTrans,
+              M,
+              nt,
+              C,
+              1,
+              U + ij * M * C,
+              V + ij * C * nt,
+              0,
+              Mt + ij * M * nt,
+              &context_);
+        }
+      });
+
+      // Y tile = A^T m A + bias, clipped to the output
+      ParallelFor(M, [&](TIndex m_begin, TIndex m_end) {
+        float y[kTile][kTile];
+        for (TIndex m = m_begin; m < m_end; ++m) {
+          const float b = bias ? bias[m] : 0;
+          for (TIndex t = 0; t < nt; ++t) {
+            TransformOutputTile<kTile>(Mt + m * nt + t, M * nt, b, y);
+            const TIndex n = (t0 + t) / tiles_per_image;
+            const TIndex p = (t0 + t) % tiles_per_image;
+            const int oy = (p / tiles_w) * kTile;
+            const int ox = (p % tiles_w) * kTile;
+            const int rows = std::min(kTile, oH - oy);
+            const int cols = std::min(kTile, oW - ox);
+            float* out = Ydata + (n * M + m) * oH * oW + oy * oW + ox;
+            for (int i = 0; i < rows; ++i) {
+              for (int j = 0; j < cols; ++j) {
+                out[i * oW + j] = y[i][j];
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+
+  // Returns the filters transformed to (kTile + 2)^2 matrices of M x C,
+  // computing them again only if the filter changed since the last run.
+  template <int kTile>
+  const float* TransformedFilter(const TensorCPU& filter) {
+    constexpr int kAlpha = Winograd<kTile>::kAlpha;
+    const int M = filter.dim32(0), C = filter.dim32(1);
+    if (&filter != filter_ || filter.version() != filter_version_ ||
+        filter.raw_data() != filter_data_ || filter.dims() != filter_dims_ ||
+        kTile != filter_tile_) {
+      transformed_filter_.Resize(kAlpha * kAlpha, M, C);
+      float* U = transformed_filter_.mutable_data<float>();
+      const float* g = filter.data<float>();
+      ParallelFor(M, [&](TIndex m_begin, TIndex m_end) {
+        for (TIndex m = m_begin; m < m_end; ++m) {
+          for (TIndex c = 0; c < C; ++c) {
+            TransformFilter<kTile>(
+                g + (m * C + c) * 9, M * C, U + m * C + c);
+          }
+        }
+      });
+      filter_ = &filter;
+      filter_version_ = filter.version();
+      filter_data_ = filter.raw_data();
+      filter_dims_ = filter.dims();
+      filter_tile_ = kTile;
+    }
+    return transformed_filter_.data<float>();
+  }
+
+  // Runs fn(begin, end) on ranges splitting [0, n) between the threads
+  void ParallelFor(
+      const TIndex n,
+      const std::function<void(TIndex, TIndex)>& fn) {
+    TIndex num_ranges = 1;
+    if (num_threads_ != 1) {
+      const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+      num_ranges = std::min<TIndex>(
+          n,
+          num_threads_ == 0 ? pool_threads
+                            : std::min(num_threads_, pool_threads));
+    }
+    if (num_ranges <= 1) {
+      fn(0, n);
+      return;
+    }
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+      fn(range * n / num_ranges, (range + 1) * n / num_ranges);
+    });
+  }
+
+  // Output tile size, 2 or 4, or 0 to use 4 unless the output is smaller
+  // than 8x8
+  const int tile_;
+  // 0 uses all threads of the workspace thread pool, 1 runs on the calling
+  // thread
+  const int num_threads_;
+
+  TensorCPU transformed_filter_;
+  // The filter transformed_filter_ was computed from
+  const TensorCPU* filter_ = nullptr;
+  uint64_t filter_version_ = 0;
+  const void* filter_data_ = nullptr;
+  std::vector<TIndex> filter_dims_;
+  int filter_tile_ = 0;
+
+  TensorCPU input_buffer_;
+  TensorCPU output_buffer_;
+
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv, WINOGRAD, WinogradConvOp);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(Conv2D, WINOGRAD, WinogradConvOp);
+
+} // namespace caffe2
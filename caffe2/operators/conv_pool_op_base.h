@@ -448,12 +448,54 @@ class ConvPoolOpBase : public Operator<Context> {
         out_channels = W.dims(0);
       }
     }
-    // grouping is NOT properly handled yet
+    // W only holds the input channels of a group, so in_channels is already
+    // divided by the number of groups
     c.flops = N * Y_t * Y_h * Y_w * kernel_t * kernel_w * kernel_h *
         in_channels * out_channels * 2;
-    c.bytes_moved = N * out_channels * Y_t * Y_h * Y_w * sizeof(float);
-    c.params_bytes = out_channels * in_channels * kernel_t * kernel_h *
-        kernel_w * sizeof(float);
+    c.params_bytes = nBytesOfShape(W);
+    c.bytes_read = nBytesOfShape(X) + nBytesOfShape(W);
+    if (inputs.size() > 2) {
+      // Bias
+      c.flops += nElemFromDim(Y);
+      c.params_bytes += nBytesOfShape(inputs[2]);
+      c.bytes_read += nBytesOfShape(inputs[2]);
+    }
+    c.bytes_written = nElemFromDim(Y) * sizeof(float);
+    return c;
+  }
+
+  static struct OpSchema::Cost CostInferenceForPool(
+      const OperatorDef& def,
+      const vector<TensorShape>& inputs) {
+    struct OpSchema::Cost c;
+    const TensorShape X = inputs[0];
+    const TensorShape Y = TensorInferenceForPool(def, inputs)[0];
+    ArgumentHelper helper(def);
+    const bool channel_first =
+        StringToStorageOrder(helper.GetSingleArgument<string>(
+            "order", "NCHW")) == StorageOrder::NCHW;
+    uint64_t kernel_size = 1;
+    if (helper.GetSingleArgument<int>("global_pooling", 0)) {
+      kernel_size = channel_first
+          ? nElemFromDim(X, 2)
+          : nElemBetweenDim(X, 1, X.dims_size() - 1);
+    } else if (helper.HasArgument("kernel")) {
+      const int kernel = helper.GetSingleArgument<int>("kernel", 1);
+      for (int i = 2; i < X.dims_size(); ++i) {
+        kernel_size *= kernel;
+      }
+    } else if (helper.HasArgument("kernels")) {
+      for (int k : helper.GetRepeatedArgument<int>("kernels")) {
+        kernel_size *= k;
+      }
+    } else {
+      kernel_size = helper.GetSingleArgument<int>("kernel_h", 1) *
+          helper.GetSingleArgument<int>("kernel_w", 1);
+    }
+    // One comparison or addition per element of the window
+    c.flops = nElemFromDim(Y) * kernel_size;
+    c.bytes_read = nBytesOfShape(X);
+    c.bytes_written = nElemFromDim(Y) * sizeof(float);
     return c;
   }
 
@@ -705,6 +747,26 @@ class ConvPoolOpBase : public Operator<Context> {
     return dilation_[1];
   }
 
+  // Whether the convolution is a matrix product of the filter and the
+  // input: kernel 1 and stride 1 in every dimension, and no padding. The
+  // pads are known once SetOutputSize has been called.
+  bool Is1x1Conv() const {
+    for (int dim = 0; dim < kernel_.size(); ++dim) {
+      if (kernel_[dim] != 1 || stride_[dim] != 1 || pads_[dim] != 0 ||
+          pads_[kernel_.size() + dim] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether a 2D convolution of C input channels to M output channels has
+  // a single filter channel per output channel and one output channel per
+  // input channel, as the depthwise convolutions of MobileNet-style models.
+  bool IsDepthwiseConv2D(const int C, const int M) const {
+    return kernel_.size() == 2 && group_ == C && M == C;
+  }
+
  private:
  inline void AllocateAndCopy(const vector<int>& vec, Tensor<Context>& tensor) {
       tensor.Resize(vec.size());
@@ -11,8 +11,6 @@
 #include "caffe2/operators/conv_transpose_unpool_op_base.h"
 #include "caffe2/utils/math.h"
 
-CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
-
 namespace caffe2 {
 
 template <typename T, class Context>
@@ -130,7 +128,7 @@ bool ConvTransposeOp<T, Context>::RunOnDeviceWithOrderNCHW() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+  if (useSharedBuffer<Context>(shared_buffer_)) {
     runWithSharedBuffer<Context>(ws_, f);
   } else {
     f(&col_buffer_);
@@ -238,7 +236,7 @@ bool ConvTransposeOp<T, Context>::RunOnDeviceWithOrderNHWC() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+  if (useSharedBuffer<Context>(shared_buffer_)) {
     runWithSharedBuffer<Context>(ws_, f);
   } else {
     f(&col_buffer_);
@@ -18,8 +18,6 @@
 #include "caffe2/utils/fixed_divisor.h"
 #include "caffe2/utils/math.h"
 
-CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
-
 namespace caffe2 {
 
 template <typename T, typename Context>
@@ -677,7 +675,7 @@ bool ConvTransposeMobileOp<T, Context>::RunOnDeviceWithOrderNCHW() {
       Ydata += Y->size() / Y->dim32(0);
     }
   };
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+  if (useSharedBuffer<Context>(shared_buffer_)) {
     runWithSharedBuffer<Context>(ws_, f);
   } else {
     f(&threadBuffer_);
@@ -9,8 +9,6 @@
 #include "caffe2/proto/caffe2_legacy.pb.h"
 #include "caffe2/utils/math.h"
 
-CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
-
 namespace caffe2 {
 
 template <class Context>
@@ -126,7 +124,7 @@ class ConvTransposeUnpoolBase : public Operator<Context> {
 
     // Create shared buffer mutex in the constructor
     // to avoid race-condition in DAGNet.
-    if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+    if (useSharedBuffer<Context>(shared_buffer_)) {
       createSharedBuffer<Context>(ws_);
     }
   }
@@ -34,6 +34,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Cos)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
 Calculates the cosine of the given input tensor, element-wise.
@@ -51,17 +51,12 @@ class WorkspaceStack {
           std::make_shared<Workspace>(parent_ws, blob_bindings));
     } else {
       // when reusing workspace, make sure copies of external blobs are
-      // removed and blob bindings are set
+      // removed and blob bindings are set; the workspace keeps its nets
       auto& workspace = workspaces_[top_ + 1];
-      const auto& local_blobs = workspace->LocalBlobs();
-      std::unordered_set<std::string> local_blobs_set;
-      local_blobs_set.insert(local_blobs.begin(), local_blobs.end());
       bool found_local_copy = false;
       for (const auto& blob_pair : blob_bindings) {
-        if (local_blobs_set.count(blob_pair.first)) {
-          workspace->RemoveBlob(blob_pair.first);
-          found_local_copy = true;
-        }
+        // RemoveBlob only looks at the local blobs
+        found_local_copy |= workspace->RemoveBlob(blob_pair.first);
       }
       if (found_local_copy) {
         workspace->AddBlobMapping(parent_ws, blob_bindings);
@@ -113,6 +108,12 @@ class WorkspaceStack {
     return workspaces_[top_];
   }
 
+  // The workspace on top of the stack, nullptr if the stack is empty
+  std::shared_ptr<Workspace> lastForwardWorkspace() const {
+    checkStack();
+    return top_ < 0 ? nullptr : workspaces_[top_];
+  }
+
   void clear() {
     checkStack();
     top_ = -1;
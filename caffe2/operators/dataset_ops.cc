@@ -1,5 +1,7 @@
 #include "caffe2/operators/dataset_ops.h"
 
+#include <condition_variable>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -8,6 +10,7 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/utils/string_utils.h"
+#include "caffe2/utils/thread_pool.h"
 
 namespace caffe2 {
 
@@ -567,8 +570,8 @@ class SortAndShuffleOp : public Operator<CPUContext> {
         sort_by_field_idx_(
             OperatorBase::GetSingleArgument<int>("sort_by_field_idx", 1)),
         batch_size_(OperatorBase::GetSingleArgument<int>("batch_size", 1)),
-        shuffle_size_(OperatorBase::GetSingleArgument<int>("shuffle_size", 1)) {
-  }
+        shuffle_size_(OperatorBase::GetSingleArgument<int>("shuffle_size", 1)),
+        block_size_(OperatorBase::GetSingleArgument<int>("block_size", 0)) {}
 
   bool RunOnDevice() override {
     auto& cursor = OperatorBase::Input<std::unique_ptr<TreeCursor>>(0);
@@ -609,6 +612,11 @@ class SortAndShuffleOp : public Operator<CPUContext> {
       });
     }
 
+    if (block_size_ > 0) {
+      BlockShuffle(shuffle_idx, out_data);
+      return true;
+    }
+
     if (batch_size_ * shuffle_size_ > 1) {
       int offset = 0;
       while (offset + batch_size_ * shuffle_size_ < size) {
@@ -640,9 +648,35 @@ class SortAndShuffleOp : public Operator<CPUContext> {
     return true;
   }
 
+  // Shuffles the order of the blocks of block_size_ consecutive indices,
+  // then the indices within every batch. The rows of a batch come from a
+  // few blocks, so reading it touches a few contiguous ranges of memory.
+  void BlockShuffle(const vector<int>& idx, int64_t* out_data) {
+    const int size = idx.size();
+    const int num_blocks = (size + block_size_ - 1) / block_size_;
+    vector<int> block_idx(num_blocks);
+    iota(block_idx.begin(), block_idx.end(), 0);
+    std::default_random_engine gen;
+    std::shuffle(block_idx.begin(), block_idx.end(), gen);
+
+    int64_t* out = out_data;
+    for (int block : block_idx) {
+      auto begin = idx.begin() + block * block_size_;
+      auto end = idx.begin() + std::min(size, (block + 1) * block_size_);
+      out = std::copy(begin, end, out);
+    }
+    for (int offset = 0; offset < size; offset += batch_size_) {
+      std::shuffle(
+          out_data + offset,
+          out_data + std::min(size, offset + batch_size_),
+          gen);
+    }
+  }
+
   int sort_by_field_idx_;
   int batch_size_;
   int shuffle_size_;
+  int block_size_;
 };
 
 class ReadRandomBatchOp : public Operator<CPUContext> {
@@ -652,16 +686,20 @@ class ReadRandomBatchOp : public Operator<CPUContext> {
         batchSize_(OperatorBase::GetSingleArgument<int>("batch_size", 1)),
         enforceBatchSize_(
             OperatorBase::GetSingleArgument<bool>("enforce_batch_size", false)),
-        loopOver_(OperatorBase::GetSingleArgument<bool>("loop_over", false)) {}
+        loopOver_(OperatorBase::GetSingleArgument<bool>("loop_over", false)) {
+    const int numThreads =
+        OperatorBase::GetSingleArgument<int>("num_threads", 1);
+    CAFFE_ENFORCE_GE(numThreads, 1);
+    if (numThreads > 1) {
+      // The calling thread gathers fields too
+      threadPool_.reset(new TaskThreadPool(numThreads - 1));
+    }
+  }
+
   bool RunOnDevice() override {
     auto& cursor = OperatorBase::Input<std::unique_ptr<TreeCursor>>(0);
     auto& idxblob = Input(1);
-    auto& offsetsmat = Input(2);
     CAFFE_ENFORCE(InputSize() == cursor->it.fields().size() + 3);
-    auto idxvec = idxblob.template data<int64_t>();
-    auto& offsetdim = offsetsmat.dims();
-    // gather data
-    std::vector<TIndex> outDim;
     int64_t idx;
     {
       std::lock_guard<std::mutex> lock(cursor->mutex_);
@@ -679,62 +717,119 @@ class ReadRandomBatchOp : public Operator<CPUContext> {
       cursor->offsets.at(0) += batchSize_;
     }
 
-    for (int i = 0; i < cursor->it.fields().size(); ++i) {
-      auto lengthIdx = cursor->it.fields()[i].lengthFieldId + 1;
-      auto& in = Input(i + 3);
-      outDim = in.dims();
-      outDim.at(0) = 0;
-      auto idxbegin = idx;
-      for (int j = 0; j < batchSize_; ++j) {
-        if (idx >= idxblob.size()) {
-          break;
-        }
-        CAFFE_ENFORCE(
-            (idxvec[idx] + 1) * offsetdim[1] + lengthIdx < offsetsmat.size(),
-            "Out of bound when trying to get elem from offsetsmat");
-        auto offsetptr = offsetsmat.template data<TOffset>() +
-            idxvec[idx] * offsetdim[1] + lengthIdx;
-        auto offset = *offsetptr;
-        auto size = *(offsetptr + offsetdim[1]) - offset;
-        outDim.at(0) += size; // accumulate over the batch
-        idx++;
+    // The fields are gathered in parallel, task t gathers the fields
+    // t, t + numTasks, ...
+    const int numFields = cursor->it.fields().size();
+    const int numTasks = std::max(
+        1,
+        std::min<int>(
+            threadPool_ ? threadPool_->size() + 1 : 1, numFields));
+    auto gatherFields = [&](int task) {
+      for (int i = task; i < numFields; i += numTasks) {
+        GatherField(*cursor, i, idx);
       }
-      idx = idxbegin; // reSet
-      auto* out = Output(i);
-      out->Resize(outDim);
-      if (out->size() == 0) {
-        continue;
+    };
+    std::vector<std::exception_ptr> errors(numTasks);
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining = numTasks - 1;
+    for (int task = 1; task < numTasks; ++task) {
+      threadPool_->run([&, task]() {
+        try {
+          gatherFields(task);
+        } catch (...) {
+          errors[task] = std::current_exception();
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        if (--remaining == 0) {
+          done.notify_one();
+        }
+      });
+    }
+    try {
+      gatherFields(0);
+    } catch (...) {
+      errors[0] = std::current_exception();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&]() { return remaining == 0; });
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
       }
-      auto dst = static_cast<char*>(out->raw_mutable_data(in.meta()));
-      int block_size = in.size() / in.dim(0);
-      auto block_bytesize = in.size_from_dim(1) * in.meta().itemsize();
+    }
+    return true;
+  }
+
+ private:
+  // Gathers the rows of the batch starting at idx of field i
+  void GatherField(const TreeCursor& cursor, int i, int64_t idx) {
+    auto& idxblob = Input(1);
+    auto& offsetsmat = Input(2);
+    auto idxvec = idxblob.template data<int64_t>();
+    auto& offsetdim = offsetsmat.dims();
+    auto lengthIdx = cursor.it.fields()[i].lengthFieldId + 1;
+    auto& in = Input(i + 3);
+    std::vector<TIndex> outDim = in.dims();
+    outDim.at(0) = 0;
+    const int64_t end = std::min<int64_t>(idx + batchSize_, idxblob.size());
+    for (auto j = idx; j < end; ++j) {
       CAFFE_ENFORCE(
-          block_bytesize == in.nbytes() / in.dim(0),
-          "block_bytesize should be consistent with data dim");
-      auto src_base = static_cast<const char*>(in.raw_data());
-      int start = 0;
-      for (int j = 0; j < batchSize_; ++j) {
-        if (idx >= idxblob.size()) {
-          break;
-        }
-        auto offsetptr = offsetsmat.template data<TOffset>() +
-            idxvec[idx] * offsetdim[1] + lengthIdx;
-        auto offset = *offsetptr;
-        auto size = *(offsetptr + offsetdim[1]) - offset;
-        // copy data
-        auto src = src_base + offset * block_bytesize;
+          (idxvec[j] + 1) * offsetdim[1] + lengthIdx < offsetsmat.size(),
+          "Out of bound when trying to get elem from offsetsmat");
+      auto offsetptr = offsetsmat.template data<TOffset>() +
+          idxvec[j] * offsetdim[1] + lengthIdx;
+      auto offset = *offsetptr;
+      auto size = *(offsetptr + offsetdim[1]) - offset;
+      outDim.at(0) += size; // accumulate over the batch
+    }
+    auto* out = Output(i);
+    out->Resize(outDim);
+    if (out->size() == 0) {
+      return;
+    }
+    auto dst = static_cast<char*>(out->raw_mutable_data(in.meta()));
+    int block_size = in.size() / in.dim(0);
+    auto block_bytesize = in.size_from_dim(1) * in.meta().itemsize();
+    CAFFE_ENFORCE(
+        block_bytesize == in.nbytes() / in.dim(0),
+        "block_bytesize should be consistent with data dim");
+    auto src_base = static_cast<const char*>(in.raw_data());
+    // Rows following each other in the field are copied at once
+    TOffset runOffset = 0;
+    TOffset runSize = 0;
+    int start = 0;
+    auto copyRun = [&]() {
+      if (runSize > 0) {
         context_.template CopyItems<CPUContext, CPUContext>(
-            in.meta(), size * block_size, src, dst + start * block_bytesize);
-        start += size;
-        idx++;
+            in.meta(),
+            runSize * block_size,
+            src_base + runOffset * block_bytesize,
+            dst + start * block_bytesize);
+        start += runSize;
+      }
+    };
+    for (auto j = idx; j < end; ++j) {
+      auto offsetptr = offsetsmat.template data<TOffset>() +
+          idxvec[j] * offsetdim[1] + lengthIdx;
+      auto offset = *offsetptr;
+      auto size = *(offsetptr + offsetdim[1]) - offset;
+      if (offset != runOffset + runSize) {
+        copyRun();
+        runOffset = offset;
+        runSize = 0;
       }
-      idx = idxbegin; // reSet
+      runSize += size;
     }
-    return true;
+    copyRun();
   }
+
   int batchSize_;
   bool enforceBatchSize_;
   bool loopOver_;
+  std::unique_ptr<TaskThreadPool> threadPool_;
 };
 
 template <class Context>
@@ -1165,6 +1260,12 @@ Input(0) is a blob pointing to a TreeCursor, and
 [Input(1),... Input(num_fields)] a list of tensors containing the data for
 each field of the dataset.
 
+If block_size is positive, the sorted indices are instead split into blocks of
+block_size consecutive indices, the order of the blocks is shuffled and then
+the indices within every batch. Each batch then reads a few contiguous ranges
+of the dataset, which is much faster to gather than random rows, for a little
+less randomness.
+
 SortAndShuffle is thread safe.
 )DOC")
     .Input(0, "cursor", "A blob containing a pointer to the cursor.")
@@ -1184,7 +1285,8 @@ Input(2) is a blob pointing to the offset matrix and
 [Input(3),... Input(num_fields)] a list of tensors containing the data for
 each field of the dataset.
 
-ReadRandomBatch is thread safe.
+ReadRandomBatch is thread safe. With num_threads > 1 the fields are gathered
+in parallel, which pays off with many fields.
 )DOC")
     .Input(0, "cursor", "A blob containing a pointer to the cursor.")
     .Input(1, "idx", "idx with a shuffled order.")
@@ -1192,7 +1294,8 @@ ReadRandomBatch is thread safe.
     .Input(3, "dataset_field_0", "First dataset field")
     .Output(0, "field_0", "Tensor containing the next batch for field 0.")
     .Arg("batch_size", "Number of top-level entries to read.")
-    .Arg("loop_over", "(bool) Repeat the dataset indefinitely");
+    .Arg("loop_over", "(bool) Repeat the dataset indefinitely")
+    .Arg("num_threads", "Number of threads gathering the fields, default 1");
 
 OPERATOR_SCHEMA(CheckDatasetConsistency)
     .NumInputs(1, INT_MAX)
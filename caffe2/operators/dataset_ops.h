@@ -67,7 +67,7 @@ class TreeIterator {
   }
 
   // Returns the field description for all fields.
-  const std::vector<FieldDesc>& fields() {
+  const std::vector<FieldDesc>& fields() const {
     return fields_;
   }
 
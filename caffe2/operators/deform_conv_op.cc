@@ -1,13 +1,354 @@
 #include "caffe2/operators/deform_conv_op.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
 #include "caffe2/operators/conv_pool_op_base.h"
 #include "caffe2/operators/deform_conv_op_impl.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
+namespace {
+
+// The deformable im2col and col2im split their work in ranges of at least
+// this many elements of the column buffer.
+constexpr TIndex kMinRangeSize = 16384;
+
+// Runs fn(begin, end) on ranges splitting [0, n) between the threads of the
+// thread pool of context, for a total work of size elements.
+void ParallelRanges(
+    const TIndex n,
+    const TIndex size,
+    CPUContext* context,
+    const std::function<void(TIndex, TIndex)>& fn) {
+  ThreadPool* pool = context->thread_pool();
+  TIndex num_ranges = 1;
+  if (pool) {
+    num_ranges = pool->getNumThreads();
+    if (context->max_threads() > 0) {
+      num_ranges = std::min<TIndex>(num_ranges, context->max_threads());
+    }
+    num_ranges = std::min<TIndex>(
+        std::min<TIndex>(num_ranges, n),
+        std::max<TIndex>(1, size / kMinRangeSize));
+  }
+  if (num_ranges <= 1) {
+    fn(0, n);
+    return;
+  }
+  pool->runRanges(num_ranges, [&](size_t range) {
+    fn(range * n / num_ranges, (range + 1) * n / num_ranges);
+  });
+}
+
+// The bilinear sampling point of a kernel element at an output position:
+// the indices of its 4 neighbours in an input plane and their weights, all
+// 0 outside of the plane, and the fractional parts of its coordinates.
+struct DeformableSample {
+  int index[4];
+  float weight[4];
+  float lh;
+  float lw;
+};
+
+// The geometry of a deformable convolution over an image
+struct DeformableShape {
+  int channels;
+  int height;
+  int width;
+  int kernel_h;
+  int kernel_w;
+  int pad_h;
+  int pad_w;
+  int stride_h;
+  int stride_w;
+  int dilation_h;
+  int dilation_w;
+  int deformable_group;
+  int height_col;
+  int width_col;
+
+  int kernel_size() const {
+    return kernel_h * kernel_w;
+  }
+  int col_size() const {
+    return height_col * width_col;
+  }
+  int channels_per_group() const {
+    return channels / deformable_group;
+  }
+};
+
+// Computes the sampling points of every deformable group, kernel element and
+// output position, indexed as ((group * kernel_size + k) * height_col + h) *
+// width_col + w. The channels of a deformable group all share its points.
+// The coordinates and their clamping at the bottom and right borders are
+// those of the CUDA kernels of deform_conv_op.cu.
+void ComputeSamples(
+    const float* data_offset,
+    const DeformableShape& shape,
+    CPUContext* context,
+    std::vector<DeformableSample>* samples) {
+  const int K = shape.kernel_size();
+  const int col_size = shape.col_size();
+  samples->resize(shape.deformable_group * K * col_size);
+  DeformableSample* samples_data = samples->data();
+  ParallelRanges(
+      shape.deformable_group * K * shape.height_col,
+      samples->size(),
+      context,
+      [&](const TIndex begin, const TIndex end) {
+        for (TIndex row = begin; row < end; ++row) {
+          const int h_col = row % shape.height_col;
+          const int k = (row / shape.height_col) % K;
+          const int group = row / shape.height_col / K;
+          const int i = k / shape.kernel_w;
+          const int j = k % shape.kernel_w;
+          const float* offset_h = data_offset +
+              ((group * K + k) * 2 * shape.height_col + h_col) *
+                  shape.width_col;
+          const float* offset_w = offset_h + col_size;
+          DeformableSample* sample = samples_data + row * shape.width_col;
+          for (int w_col = 0; w_col < shape.width_col; ++w_col, ++sample) {
+            *sample = DeformableSample();
+            float h = h_col * shape.stride_h - shape.pad_h +
+                i * shape.dilation_h + offset_h[w_col];
+            float w = w_col * shape.stride_w - shape.pad_w +
+                j * shape.dilation_w + offset_w[w_col];
+            if (!(h >= 0 && w >= 0 && h < shape.height && w < shape.width)) {
+              continue;
+            }
+            int h_low = std::floor(h);
+            int w_low = std::floor(w);
+            int h_high = h_low + 1;
+            int w_high = w_low + 1;
+            if (h_low >= shape.height - 1) {
+              h_high = h_low = shape.height - 1;
+              h = h_low;
+            }
+            if (w_low >= shape.width - 1) {
+              w_high = w_low = shape.width - 1;
+              w = w_low;
+            }
+            const float lh = h - h_low;
+            const float lw = w - w_low;
+            sample->index[0] = h_low * shape.width + w_low;
+            sample->index[1] = h_low * shape.width + w_high;
+            sample->index[2] = h_high * shape.width + w_low;
+            sample->index[3] = h_high * shape.width + w_high;
+            sample->weight[0] = (1 - lh) * (1 - lw);
+            sample->weight[1] = (1 - lh) * lw;
+            sample->weight[2] = lh * (1 - lw);
+            sample->weight[3] = lh * lw;
+            sample->lh = lh;
+            sample->lw = lw;
+          }
+        }
+      });
+}
+
+// The shape of the deformable convolution of the 2d kernel, pads (top, left,
+// bottom, right), strides and dilations over an image of im_shape (N, C, H,
+// W) into a column buffer of col_shape (C * kernel size, H', W')
+DeformableShape GetDeformableShape(
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    const std::vector<int>& kernel,
+    const std::vector<int>& pads,
+    const std::vector<int>& stride,
+    const std::vector<int>& dilation,
+    const int deformable_group) {
+  CAFFE_ENFORCE_EQ(pads[0], pads[2]);
+  CAFFE_ENFORCE_EQ(pads[1], pads[3]);
+  DeformableShape shape;
+  shape.channels = im_shape[1];
+  shape.height = im_shape[2];
+  shape.width = im_shape[3];
+  shape.kernel_h = kernel[0];
+  shape.kernel_w = kernel[1];
+  shape.pad_h = pads[0];
+  shape.pad_w = pads[1];
+  shape.stride_h = stride[0];
+  shape.stride_w = stride[1];
+  shape.dilation_h = dilation[0];
+  shape.dilation_w = dilation[1];
+  shape.deformable_group = deformable_group;
+  shape.height_col = col_shape[1];
+  shape.width_col = col_shape[2];
+  return shape;
+}
+
+} // namespace
+
+// The sampling points are computed once per call and shared by the channels
+// of their deformable group. The column buffer is then filled in parallel
+// over channels and output rows.
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableIm2col(
+    const float* data_im,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* data_col) {
+  const auto shape = GetDeformableShape(
+      im_shape,
+      col_shape,
+      kernel_,
+      pads_,
+      stride_,
+      dilation_,
+      deformable_group_);
+  std::vector<DeformableSample> samples;
+  ComputeSamples(data_offset, shape, &context_, &samples);
+  const int K = shape.kernel_size();
+  const int im_size = shape.height * shape.width;
+  ParallelRanges(
+      shape.channels * K * shape.height_col,
+      shape.channels * K * shape.col_size(),
+      &context_,
+      [&](const TIndex begin, const TIndex end) {
+        for (TIndex row = begin; row < end; ++row) {
+          const int h_col = row % shape.height_col;
+          const int k = (row / shape.height_col) % K;
+          const int c = row / shape.height_col / K;
+          const int group = c / shape.channels_per_group();
+          const float* im = data_im + c * im_size;
+          const DeformableSample* sample = samples.data() +
+              ((group * K + k) * shape.height_col + h_col) * shape.width_col;
+          float* col = data_col + row * shape.width_col;
+          for (int w_col = 0; w_col < shape.width_col; ++w_col, ++sample) {
+            col[w_col] = sample->weight[0] * im[sample->index[0]] +
+                sample->weight[1] * im[sample->index[1]] +
+                sample->weight[2] * im[sample->index[2]] +
+                sample->weight[3] * im[sample->index[3]];
+          }
+        }
+      });
+}
+
+// The gradient of every sampling point is scattered to its 4 neighbours.
+// Every channel of grad_im is written by one range only, so no atomic add or
+// per-thread buffer is needed and the result does not depend on the number
+// of threads.
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableCol2im(
+    const float* data_col,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* grad_im) {
+  const auto shape = GetDeformableShape(
+      im_shape,
+      col_shape,
+      kernel_,
+      pads_,
+      stride_,
+      dilation_,
+      deformable_group_);
+  std::vector<DeformableSample> samples;
+  ComputeSamples(data_offset, shape, &context_, &samples);
+  const int K = shape.kernel_size();
+  const int col_size = shape.col_size();
+  const int im_size = shape.height * shape.width;
+  ParallelRanges(
+      shape.channels,
+      shape.channels * K * col_size,
+      &context_,
+      [&](const TIndex begin, const TIndex end) {
+        for (TIndex c = begin; c < end; ++c) {
+          const int group = c / shape.channels_per_group();
+          float* im = grad_im + c * im_size;
+          const float* col = data_col + c * K * col_size;
+          const DeformableSample* sample =
+              samples.data() + group * K * col_size;
+          for (int i = 0; i < K * col_size; ++i, ++sample) {
+            for (int n = 0; n < 4; ++n) {
+              im[sample->index[n]] += sample->weight[n] * col[i];
+            }
+          }
+        }
+      });
+}
+
+// Every offset gets the gradients of its sampling point summed over the
+// channels of its deformable group. Ranges of output rows are computed in
+// parallel, accumulating a row at a time over the channels.
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableCol2imCoord(
+    const float* data_col,
+    const float* data_im,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* grad_offset) {
+  const auto shape = GetDeformableShape(
+      im_shape,
+      col_shape,
+      kernel_,
+      pads_,
+      stride_,
+      dilation_,
+      deformable_group_);
+  std::vector<DeformableSample> samples;
+  ComputeSamples(data_offset, shape, &context_, &samples);
+  const int K = shape.kernel_size();
+  const int col_size = shape.col_size();
+  const int im_size = shape.height * shape.width;
+  const int channels_per_group = shape.channels_per_group();
+  ParallelRanges(
+      shape.deformable_group * K * shape.height_col,
+      shape.channels * K * col_size,
+      &context_,
+      [&](const TIndex begin, const TIndex end) {
+        for (TIndex row = begin; row < end; ++row) {
+          const int h_col = row % shape.height_col;
+          const int k = (row / shape.height_col) % K;
+          const int group = row / shape.height_col / K;
+          const DeformableSample* samples_row =
+              samples.data() + row * shape.width_col;
+          // The gradients of the vertical and horizontal offsets
+          float* grad_h = grad_offset +
+              ((group * K + k) * 2 * shape.height_col + h_col) *
+                  shape.width_col;
+          float* grad_w = grad_h + col_size;
+          std::fill(grad_h, grad_h + shape.width_col, 0.f);
+          std::fill(grad_w, grad_w + shape.width_col, 0.f);
+          for (int cc = 0; cc < channels_per_group; ++cc) {
+            const int c = group * channels_per_group + cc;
+            const float* im = data_im + c * im_size;
+            const float* col =
+                data_col + ((c * K + k) * shape.height_col + h_col) *
+                    shape.width_col;
+            const DeformableSample* sample = samples_row;
+            for (int w_col = 0; w_col < shape.width_col; ++w_col, ++sample) {
+              const float v1 = im[sample->index[0]];
+              const float v2 = im[sample->index[1]];
+              const float v3 = im[sample->index[2]];
+              const float v4 = im[sample->index[3]];
+              grad_h[w_col] += col[w_col] *
+                  ((1 - sample->lw) * (v3 - v1) + sample->lw * (v4 - v2));
+              grad_w[w_col] += col[w_col] *
+                  ((1 - sample->lh) * (v2 - v1) + sample->lh * (v4 - v3));
+            }
+          }
+        }
+      });
+}
+
+REGISTER_CPU_OPERATOR(DeformConv, DeformConvOp<float, CPUContext>);
+
 OPERATOR_SCHEMA(DeformConv)
     .NumInputs(3, 4)
     .NumOutputs(1)
     .TensorInferenceFunction(ConvPoolOpBase<CPUContext>::TensorInferenceForConv)
+    .Arg(
+        "num_threads",
+        "(int) default 0; number of threads of the workspace pool the "
+        "deformable im2col is split between on CPU: 0 uses all of them and 1 "
+        "the calling thread.")
     .SetDoc(R"DOC(
 Deformable convolution operator consumes an input vector, the kernel offsets
 blob, the filter blob and the bias blob and computes the output. Other
@@ -6,8 +6,6 @@
 #include "caffe2/operators/conv_op_shared.h"
 #include "caffe2/operators/conv_pool_op_base.h"
 
-CAFFE2_DECLARE_bool(caffe2_force_shared_col_buffer);
-
 namespace caffe2 {
 
 template <typename T, class Context>
@@ -17,7 +15,10 @@ class DeformConvOpBase : public ConvPoolOpBase<Context> {
   DeformConvOpBase(const OperatorDef& operator_def, Workspace* ws)
       : ConvPoolOpBase<Context>(operator_def, ws),
         deformable_group_(
-            OperatorBase::GetSingleArgument<int>("deformable_group", 1)) {}
+            OperatorBase::GetSingleArgument<int>("deformable_group", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
+    useMathThreadPool<Context>(ws_, num_threads_, &context_);
+  }
   ~DeformConvOpBase() {}
 
  protected:
@@ -43,6 +44,10 @@ class DeformConvOpBase : public ConvPoolOpBase<Context> {
 
  protected:
   int deformable_group_;
+  // Threads the deformable im2col and col2im split their work between on
+  // CPU: 0 uses all threads of the workspace thread pool, 1 runs on the
+  // calling thread
+  int num_threads_;
 
 #define USE_DEFORMABLE_CONV_BASE_FUNCTIONS(T, Context)   \
   USE_CONV_POOL_BASE_FUNCTIONS(Context);                 \
@@ -61,7 +66,7 @@ class DeformConvOp final : public DeformConvOpBase<T, Context> {
       : DeformConvOpBase<T, Context>(operator_def, ws) {
     // Create shared buffer mutex in the constructor
     // to avoid race-condition in DAGNet.
-    if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+    if (useSharedBuffer<Context>(shared_buffer_)) {
       createSharedBuffer<Context>(ws_);
     }
   }
@@ -107,6 +112,30 @@ class DeformConvGradientOp final : public DeformConvOpBase<T, Context> {
   OUTPUT_TAGS(OFFSET_GRAD, FILTER_GRAD, BIAS_OR_INPUT_GRAD, INPUT_GRAD);
 };
 
+// The CPU implementations, in deform_conv_op.cc
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableIm2col(
+    const float* data_im,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* data_col);
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableCol2im(
+    const float* data_col,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* grad_im);
+template <>
+void DeformConvOpBase<float, CPUContext>::DeformableCol2imCoord(
+    const float* data_col,
+    const float* data_im,
+    const float* data_offset,
+    const std::vector<TIndex>& im_shape,
+    const std::vector<TIndex>& col_shape,
+    float* grad_offset);
+
 } // namespace caffe2
 
 #endif // CAFFE2_OPERATORS_DEFORM_CONV_OP_H_
@@ -92,8 +92,9 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   vector<int> img_shape;
   img_shape.assign(X.dims().begin() + 1, X.dims().end());
 
+  // The columns of all the groups, filled by a single DeformableIm2col
   vector<int> buffer_shape;
-  buffer_shape.push_back(C / group_ * kernel_dims_size);
+  buffer_shape.push_back(C * kernel_dims_size);
   buffer_shape.insert(
       buffer_shape.end(), output_dims.begin(), output_dims.end());
 
@@ -105,6 +106,7 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
   const int output_offset = M / group_ * output_image_size;
   const int offset_offset = offset.size() / offset.dim32(0);
   const int filter_offset = filter.size() / group_;
+  const int col_buffer_offset = kernel_dim * output_image_size;
 
   // The col buffer is stored in CHW order as well - kernel_dim, and the height
   // and width.
@@ -138,13 +140,9 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
     T* col_buffer_data = col_buffer->template mutable_data<T>();
     // Im2col, followed by gemm.
     for (int image_id = 0; image_id < N; ++image_id) {
+      DeformableIm2col(
+          Xdata, offset_data, X.dims(), col_buffer->dims(), col_buffer_data);
       for (int group_id = 0; group_id < group_; ++group_id) {
-        DeformableIm2col(
-            Xdata + group_id * input_offset,
-            offset_data,
-            X.dims(),
-            col_buffer->dims(),
-            col_buffer_data);
         // Weight term
         math::Gemm<T, Context>(
             CblasNoTrans,
@@ -154,7 +152,7 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
             kernel_dim,
             1,
             filter.template data<T>() + group_id * filter_offset,
-            col_buffer_data,
+            col_buffer_data + group_id * col_buffer_offset,
             0,
             Ydata + group_id * output_offset,
             &context_);
@@ -179,7 +177,7 @@ bool DeformConvOp<T, Context>::RunOnDeviceWithOrderNCHW() {
     }
   };
 
-  if (FLAGS_caffe2_force_shared_col_buffer || shared_buffer_) {
+  if (useSharedBuffer<Context>(shared_buffer_)) {
     runWithSharedBuffer<Context>(ws_, f);
   } else {
     f(&col_buffer_);
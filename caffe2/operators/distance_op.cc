@@ -226,7 +226,10 @@ bool DotProductOp<float, CPUContext>::RunOnDevice() {
 OpSchema::Cost CostInferenceForDotProduct(
     const OperatorDef& def,
     const vector<TensorShape>& in) {
-  struct OpSchema::Cost c = PointwiseCostInference<1>(def, in);
+  struct OpSchema::Cost c = PointwiseCostInference<2>(def, in);
+  // One dot product per row
+  c.bytes_written = in[0].dims_size() > 0 ? in[0].dims(0) * sizeof(float)
+                                          : sizeof(float);
   c.params_bytes = 0;
   return c;
 }
@@ -27,7 +27,10 @@ between selected inner blob names and corresponding outer blob indices.
         "in backward pass, used in gradient Do operator")
     .Arg(
         "reuse_workspace",
-        "Whether to reuse workspace or create a new one in a given scope")
+        "Whether to reuse workspace or create a new one in a given scope. "
+        "Workspaces of a scope are pooled and keep their nets either way; a "
+        "reused workspace is run again without checking its blob bindings "
+        "as long as it is the last one of the scope")
     .AllowInplace([](int in, int out) -> bool { return true; });
 
 } // namespace caffe2
@@ -8,6 +8,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/net_template.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/operators/create_scope_op.h"
 #include "caffe2/proto/caffe2.pb.h"
@@ -22,7 +23,9 @@ class DoOp final : public Operator<Context> {
     CAFFE_ENFORCE(
         this->template HasSingleArgumentOfType<NetDef>("net"),
         "net must be specified in Do operator");
-    net_def_ = this->template GetSingleArgument<NetDef>("net", NetDef());
+    // The net is instantiated in every new workspace
+    net_template_.reset(new NetTemplate(
+        this->template GetSingleArgument<NetDef>("net", NetDef())));
     is_gradient_op_ = operator_def.is_gradient_op();
     copy_external_blobs_ =
         this->template GetSingleArgument<bool>("copy_external_blobs", false);
@@ -79,6 +82,12 @@ class DoOp final : public Operator<Context> {
   bool RunOnDevice() override {
     auto* ws_stack =
         OperatorBase::Output<detail::WorkspaceStack>(OutputSize() - 1);
+    if (reuse_workspace_ && reused_workspace_ &&
+        ws_stack->lastForwardWorkspace() == reused_workspace_) {
+      // Forward-only fast path: the workspace this op reused last time, which
+      // it keeps alive, still has its blob bindings and its net
+      return reused_net_->Run();
+    }
     std::shared_ptr<Workspace> net_workspace;
     if (is_gradient_op_) {
       net_workspace =
@@ -95,11 +104,16 @@ class DoOp final : public Operator<Context> {
     CAFFE_ENFORCE(net_workspace, "Failed to initialize Do op workspace");
 
     // TODO(iliacher): figure how to reuse existing net with a new workspace
-    auto* net = net_workspace->GetNet(net_def_.name());
+    const auto& net_def = net_template_->net_def();
+    auto* net = net_workspace->GetNet(net_def->name());
     if (!net) {
-      net = net_workspace->CreateNet(net_def_, true);
+      net = net_workspace->CreateNet(net_def, true);
     }
     CAFFE_ENFORCE(net, "Failed to initialize subnet");
+    if (reuse_workspace_) {
+      reused_workspace_ = net_workspace;
+      reused_net_ = net;
+    }
     auto success = net->Run();
     if (!is_gradient_op_ && copy_external_blobs_) {
       net_workspace->template CopyForwardedTensors<Context>(
@@ -174,8 +188,11 @@ class DoOp final : public Operator<Context> {
   bool is_gradient_op_;
   bool copy_external_blobs_;
   bool reuse_workspace_;
-  NetDef net_def_;
+  std::unique_ptr<NetTemplate> net_template_;
   Workspace* parent_ws_;
+  // With reuse_workspace, the workspace last run in and its net
+  std::shared_ptr<Workspace> reused_workspace_;
+  NetBase* reused_net_ = nullptr;
 };
 
 } // namespace caffe2
@@ -2,11 +2,7 @@
 
 namespace caffe2 {
 
-// See the operations supported here:
-// https://eigen.tuxfamily.org/dox-devel/group__QuickRefPage.html
-#define EIGEN_DIV(x, y) ((x) / (y))
-EIGEN_FUNCTOR(Div, EIGEN_DIV, NumericTypes, SameTypeAsInput);
-#undef EIGEN_DIV
+MATH_BROADCAST_FUNCTOR(Div, NumericTypes, SameTypeAsInput);
 
 void ElementWiseDivide(
     CPUContext& /* unused context */,
@@ -87,6 +87,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(ElementwiseLinear)
     .NumInputs(3)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<2>)
     .SetDoc(R"DOC(
 Given inputs X of size (N x D), w of size D and b of size D,
 the op computes Y of size (N X D) where Y_{nd} = X_{nd} * w_d + b_d
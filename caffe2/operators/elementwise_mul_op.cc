@@ -2,9 +2,5 @@
 
 namespace caffe2 {
 
-// See the operations supported here:
-// https://eigen.tuxfamily.org/dox-devel/group__QuickRefPage.html
-#define EIGEN_MUL(x, y) ((x) * (y))
-EIGEN_FUNCTOR(Mul, EIGEN_MUL, NumericTypes, SameTypeAsInput);
-#undef EIGEN_MUL
+MATH_BROADCAST_FUNCTOR(Mul, NumericTypes, SameTypeAsInput);
 }
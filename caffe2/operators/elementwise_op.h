@@ -6,6 +6,7 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/operators/conv_op_shared.h"
 #include "caffe2/utils/math.h"
 
 #include <tuple>
@@ -167,6 +168,10 @@ class BinaryElementwiseOp : public Operator<Context> {
         OP_SINGLE_ARG(string, "axis_str", axis_str_, ""),
         OP_SINGLE_ARG(string, "order", order_, "NCHW"),
         functor_() {
+    // Large outputs are split between the threads of the workspace thread
+    // pool on CPU, see math::BroadcastAdd.
+    useMathThreadPool<Context>(
+        ws, OperatorBase::GetSingleArgument<int>("num_threads", 0), &context_);
     // Figure out the correct axis to use.
     if (enable_broadcast_) {
       if (axis_ != -1) {
@@ -376,55 +381,54 @@ bool DivGradientOp<Context>::RunOnDevice() {
   return true;
 }
 
-// For arithmetic operators, Eigen provides a good way to vectorize even
-// when broadcasting.
-#define EIGEN_FUNCTOR(name, eigen_op, input_type, output_type)               \
-  struct Eigen##name##Functor {                                              \
-    template <int b_is_scalar, typename T, typename R>                       \
-    inline void Run(size_t n, const T* a, const T* b, R* out, CPUContext*) { \
-      if (b_is_scalar) {                                                     \
-        EigenVectorArrayMap<R>(out, n) =                                     \
-            eigen_op((ConstEigenVectorArrayMap<T>(a, n)), (b[0]));           \
-      } else {                                                               \
-        EigenVectorArrayMap<R>(out, n) = eigen_op(                           \
-            (ConstEigenVectorArrayMap<T>(a, n)),                             \
-            (ConstEigenVectorArrayMap<T>(b, n)));                            \
-      }                                                                      \
-    }                                                                        \
-    template <typename T, typename R>                                        \
-    void RunWithBroadcast(                                                   \
-        const T* a,                                                          \
-        const T* b,                                                          \
-        R* out,                                                              \
-        size_t pre,                                                          \
-        size_t n,                                                            \
-        CPUContext*) {                                                       \
-      EigenArrayMap<R>(out, n, pre) = eigen_op(                              \
-          (ConstEigenArrayMap<T>(a, n, pre).colwise()),                      \
-          (ConstEigenVectorArrayMap<T>(b, n)));                              \
-    }                                                                        \
-    template <typename T, typename R>                                        \
-    void RunWithBroadcast2(                                                  \
-        const T* a,                                                          \
-        const T* b,                                                          \
-        R* out,                                                              \
-        size_t pre,                                                          \
-        size_t n,                                                            \
-        size_t post,                                                         \
-        CPUContext*) {                                                       \
-      for (int i = 0; i < pre; ++i) {                                        \
-        EigenArrayMap<R>(out + i * n * post, post, n) = eigen_op(            \
-            (ConstEigenArrayMap<T>(a + i * n * post, post, n).rowwise()),    \
-            (Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>>(b, n)));   \
-      }                                                                      \
-    }                                                                        \
-  };                                                                         \
-  REGISTER_CPU_OPERATOR(                                                     \
-      name,                                                                  \
-      BinaryElementwiseOp<                                                   \
-          input_type,                                                        \
-          CPUContext,                                                        \
-          Eigen##name##Functor,                                              \
+// The CPU functor of the binary op name, which runs all the broadcast cases
+// of BinaryElementwiseOp through math::Broadcast##name, see utils/math.h.
+#define MATH_BROADCAST_FUNCTOR(name, input_type, output_type)             \
+  struct Broadcast##name##Functor {                                      \
+    template <int b_is_scalar, typename T, typename R>                   \
+    inline void                                                          \
+    Run(size_t n, const T* a, const T* b, R* out, CPUContext* context) { \
+      const int a_dims[] = {static_cast<int>(n)};                        \
+      const int b_dims[] = {b_is_scalar ? 1 : static_cast<int>(n)};      \
+      math::Broadcast##name<T, CPUContext>(                              \
+          1, a_dims, b_dims, a, b, out, context);                        \
+    }                                                                    \
+    template <typename T, typename R>                                    \
+    void RunWithBroadcast(                                               \
+        const T* a,                                                      \
+        const T* b,                                                      \
+        R* out,                                                          \
+        size_t pre,                                                      \
+        size_t n,                                                        \
+        CPUContext* context) {                                           \
+      const int a_dims[] = {static_cast<int>(pre), static_cast<int>(n)}; \
+      const int b_dims[] = {1, static_cast<int>(n)};                     \
+      math::Broadcast##name<T, CPUContext>(                              \
+          2, a_dims, b_dims, a, b, out, context);                        \
+    }                                                                    \
+    template <typename T, typename R>                                    \
+    void RunWithBroadcast2(                                              \
+        const T* a,                                                      \
+        const T* b,                                                      \
+        R* out,                                                          \
+        size_t pre,                                                      \
+        size_t n,                                                        \
+        size_t post,                                                     \
+        CPUContext* context) {                                           \
+      const int a_dims[] = {static_cast<int>(pre),                       \
+                            static_cast<int>(n),                         \
+                            static_cast<int>(post)};                     \
+      const int b_dims[] = {1, static_cast<int>(n), 1};                  \
+      math::Broadcast##name<T, CPUContext>(                              \
+          3, a_dims, b_dims, a, b, out, context);                        \
+    }                                                                    \
+  };                                                                     \
+  REGISTER_CPU_OPERATOR(                                                 \
+      name,                                                              \
+      BinaryElementwiseOp<                                               \
+          input_type,                                                    \
+          CPUContext,                                                    \
+          Broadcast##name##Functor,                                      \
           output_type>)
 
 } // namespace caffe2
@@ -25,16 +25,22 @@ Argument `broadcast=1` needs to be passed to enable broadcasting.
 
 std::function<void(OpSchema&)> MathDocGenerator(const char* name) {
   return [=](OpSchema& schema) {
-    string doc = R"DOC(
+    schema.SetDocGenerator([=]() {
+      string doc = R"DOC(
 Performs element-wise binary {name} (with limited broadcast support).
 {broadcast_doc})DOC";
-    ReplaceAll(doc, "{name}", name);
-    ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
-    schema.SetDoc(doc);
+      ReplaceAll(doc, "{name}", name);
+      ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
+      return doc;
+    });
     schema.Arg("broadcast", "Pass 1 to enable broadcasting");
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Threads of the workspace thread pool large outputs are split "
+        "between on CPU: 0 (default) for all, 1 for the calling thread.");
     schema.Input(
         0,
         "A",
@@ -277,17 +283,23 @@ std::function<void(OpSchema&)> ComparisonDocGenerator(
     const char* name,
     const char* desc) {
   return [=](OpSchema& schema) {
-    string doc = R"DOC(
+    schema.SetDocGenerator([=]() {
+      string doc = R"DOC(
 Performs element-wise {desc} comparison `{name}` (with limited broadcast support).
 {broadcast_doc})DOC";
-    ReplaceAll(doc, "{name}", name);
-    ReplaceAll(doc, "{desc}", desc);
-    ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
-    schema.SetDoc(doc);
+      ReplaceAll(doc, "{name}", name);
+      ReplaceAll(doc, "{desc}", desc);
+      ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
+      return doc;
+    });
     schema.Arg("broadcast", "Pass 1 to enable broadcasting");
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Threads of the workspace thread pool large outputs are split "
+        "between on CPU: 0 (default) for all, 1 for the calling thread.");
     schema.Input(
         0,
         "A",
@@ -301,9 +313,21 @@ Performs element-wise {desc} comparison `{name}` (with limited broadcast support
   };
 }
 
+// Cost of the comparisons and logical operators, which write bools
+OpSchema::Cost CostInferenceForBoolOutput(
+    const OperatorDef& def,
+    const vector<TensorShape>& in) {
+  struct OpSchema::Cost cost = PointwiseCostInference<1>(def, in);
+  cost.bytes_written = nElemFromDim(in[0]) * sizeof(bool);
+  return cost;
+}
+
 #define CAFFE2_SCHEMA_FOR_BINARY_COMPARISON_OP(name, symbol, desc) \
-  OPERATOR_SCHEMA(name).NumInputs(2).NumOutputs(1).FillUsing(      \
-      ComparisonDocGenerator(symbol, desc));                       \
+  OPERATOR_SCHEMA(name)                                            \
+      .NumInputs(2)                                                \
+      .NumOutputs(1)                                               \
+      .CostInferenceFunction(CostInferenceForBoolOutput)           \
+      .FillUsing(ComparisonDocGenerator(symbol, desc));            \
   SHOULD_NOT_DO_GRADIENT(name)
 
 CAFFE2_SCHEMA_FOR_BINARY_COMPARISON_OP(LT, "<", "less than");
@@ -314,17 +338,23 @@ CAFFE2_SCHEMA_FOR_BINARY_COMPARISON_OP(EQ, "==", "equality");
 
 std::function<void(OpSchema&)> LogicalDocGenerator(const char* name) {
   return [=](OpSchema& schema) {
-    string doc = R"DOC(
+    schema.SetDocGenerator([=]() {
+      string doc = R"DOC(
 Performs element-wise logical operation `{name}` (with limited broadcast support).
 Both input operands should be of type `bool`.
 {broadcast_doc})DOC";
-    ReplaceAll(doc, "{name}", name);
-    ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
-    schema.SetDoc(doc);
+      ReplaceAll(doc, "{name}", name);
+      ReplaceAll(doc, "{broadcast_doc}", kBroadcastDoc);
+      return doc;
+    });
     schema.Arg("broadcast", "Pass 1 to enable broadcasting");
     schema.Arg(
         "axis",
         "If set, defines the broadcast dimensions. See doc for details.");
+    schema.Arg(
+        "num_threads",
+        "Threads of the workspace thread pool large outputs are split "
+        "between on CPU: 0 (default) for all, 1 for the calling thread.");
     schema.Input(0, "A", "First operand.");
     schema.Input(
         1,
@@ -340,6 +370,7 @@ Both input operands should be of type `bool`.
       .NumInputs(2)                                       \
       .NumOutputs(1)                                      \
       .AllowInplace({{0, 0}})                             \
+      .CostInferenceFunction(CostInferenceForBoolOutput)  \
       .FillUsing(LogicalDocGenerator(symbol))             \
       .InheritOnnxSchema(onnx_schema);                    \
   SHOULD_NOT_DO_GRADIENT(name)
@@ -351,6 +382,7 @@ CAFFE2_SCHEMA_FOR_BINARY_LOGICAL_OP(Xor, "xor", "Xor");
 OPERATOR_SCHEMA(Not)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(CostInferenceForBoolOutput)
     .SetDoc(R"DOC(Performs element-wise negation.)DOC")
     .Input(0, "X", "Input tensor of type `bool`.")
     .Output(0, "Y", "Output tensor of type `bool`.")
@@ -18,6 +18,7 @@ REGISTER_CPU_OPERATOR(Sum, SumOp<CPUContext>);
 OPERATOR_SCHEMA(Sum)
     .NumInputs(1, INT_MAX)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .AllowInplace({{0, 0}})
     .CostInferenceFunction(CostInferenceForSum)
     .InputsCanCrossDevices()
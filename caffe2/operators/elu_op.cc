@@ -45,6 +45,7 @@ REGISTER_CPU_OPERATOR(EluGradient, EluGradientOp<float, CPUContext>);
 OPERATOR_SCHEMA(Elu)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<2>)
     .AllowInplace({{0, 0}})
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
@@ -0,0 +1,112 @@
+#include "caffe2/operators/embedding_cache_ops.h"
+
+namespace caffe2 {
+
+CAFFE_KNOWN_TYPE(std::unique_ptr<EmbeddingCache>);
+
+REGISTER_CPU_OPERATOR(CreateEmbeddingCache, CreateEmbeddingCacheOp);
+REGISTER_CPU_OPERATOR(
+    CachedSparseLengthsSum,
+    CachedSparseLengthsReductionOp<false, false>);
+REGISTER_CPU_OPERATOR(
+    CachedSparseLengthsWeightedSum,
+    CachedSparseLengthsReductionOp<true, false>);
+REGISTER_CPU_OPERATOR(
+    CachedSparseLengthsMean,
+    CachedSparseLengthsReductionOp<false, true>);
+
+OPERATOR_SCHEMA(CreateEmbeddingCache)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates a software cache for the hottest rows of an embedding table, to be
+used with the CachedSparseLengths[Sum,WeightedSum,Mean] operators.
+
+The cache counts how often every row is looked up and, every
+'refresh_interval' lookups, copies the 'capacity' most accessed rows into a
+contiguous tensor. Indices of cached rows are then served from that copy,
+which keeps the working set of power law accesses to very large tables small
+and dense. Counts are halved at every refresh.
+
+The cache keeps an 8 byte state per table row and copies of the cached rows,
+so the table must not be modified while it is cached. Hit rates are exported
+as the embedding_cache/<cache blob>/num_lookups and
+embedding_cache/<cache blob>/num_hits stats.
+)DOC")
+    .Output(0, "cache", "A blob pointing to an instance of a new cache.")
+    .Arg("capacity", "Maximum number of cached rows.")
+    .Arg(
+        "refresh_interval",
+        "Number of lookups between two refreshes of the cache (default 1000).");
+
+OPERATOR_SCHEMA(CachedSparseLengthsSum)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Same as SparseLengthsSum, but rows of DATA held by CACHE are read from the
+cache. The first call with a DATA tensor attaches the cache to it and later
+calls with a different tensor reset the cache.
+)DOC")
+    .Input(0, "CACHE", "Cache created by CreateEmbeddingCache")
+    .Input(1, "DATA", "Embedding table")
+    .Input(
+        2,
+        "INDICES",
+        "Integer vector containing indices of the first dimension of DATA for "
+        "the slices that are being aggregated")
+    .Input(
+        3,
+        "LENGTHS",
+        "Non negative vector with sum of elements equal to INDICES length")
+    .Output(0, "OUTPUT", "Aggregated tensor");
+
+OPERATOR_SCHEMA(CachedSparseLengthsWeightedSum)
+    .NumInputs(5)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Same as SparseLengthsWeightedSum, but rows of DATA held by CACHE are read from
+the cache. See CachedSparseLengthsSum.
+)DOC")
+    .Input(0, "CACHE", "Cache created by CreateEmbeddingCache")
+    .Input(1, "DATA", "Embedding table")
+    .Input(
+        2,
+        "WEIGHT",
+        "Scalar multipliers for the input slices, one per index")
+    .Input(
+        3,
+        "INDICES",
+        "Integer vector containing indices of the first dimension of DATA for "
+        "the slices that are being aggregated")
+    .Input(
+        4,
+        "LENGTHS",
+        "Non negative vector with sum of elements equal to INDICES length")
+    .Output(0, "OUTPUT", "Aggregated tensor");
+
+OPERATOR_SCHEMA(CachedSparseLengthsMean)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Same as SparseLengthsMean, but rows of DATA held by CACHE are read from the
+cache. See CachedSparseLengthsSum.
+)DOC")
+    .Input(0, "CACHE", "Cache created by CreateEmbeddingCache")
+    .Input(1, "DATA", "Embedding table")
+    .Input(
+        2,
+        "INDICES",
+        "Integer vector containing indices of the first dimension of DATA for "
+        "the slices that are being aggregated")
+    .Input(
+        3,
+        "LENGTHS",
+        "Non negative vector with sum of elements equal to INDICES length")
+    .Output(0, "OUTPUT", "Aggregated tensor");
+
+SHOULD_NOT_DO_GRADIENT(CreateEmbeddingCache);
+NO_GRADIENT(CachedSparseLengthsSum);
+NO_GRADIENT(CachedSparseLengthsWeightedSum);
+NO_GRADIENT(CachedSparseLengthsMean);
+
+} // namespace caffe2
@@ -0,0 +1,374 @@
+#ifndef CAFFE2_OPERATORS_EMBEDDING_CACHE_OPS_H_
+#define CAFFE2_OPERATORS_EMBEDDING_CACHE_OPS_H_
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/perfkernels/embedding_lookup.h"
+
+namespace caffe2 {
+
+/**
+ * Software cache of the most accessed rows of an embedding table.
+ *
+ * The cached rows are copied into one contiguous tensor, so that lookups of
+ * hot rows touch a small, dense working set instead of pages spread over the
+ * whole table. Every row of the table has an 8 byte state with its access
+ * count and its slot in the cache, so counting an access and remapping an
+ * index touch a single cache line.
+ *
+ * Counts are accumulated by Lookup() and the cache is refilled by Refresh()
+ * with the rows of highest count, after which all counts are halved so that
+ * the cache follows drifting access patterns.
+ *
+ * The cache holds copies of the rows: the table must not be modified while
+ * it is cached. A table with a different address, shape or type resets the
+ * cache.
+ */
+class EmbeddingCache {
+ public:
+  EmbeddingCache(TIndex capacity, int refresh_interval)
+      : capacity_(capacity), refresh_interval_(refresh_interval) {
+    CAFFE_ENFORCE_GE(capacity_, 0, "capacity has to be non negative");
+    CAFFE_ENFORCE_GT(
+        refresh_interval_, 0, "refresh_interval has to be positive");
+  }
+
+  std::mutex& mutex() {
+    return mutex_;
+  }
+
+  TIndex capacity() const {
+    return capacity_;
+  }
+
+  TIndex size() const {
+    return cached_rows_.size();
+  }
+
+  const Tensor<CPUContext>& rows() const {
+    return rows_;
+  }
+
+  // Starts caching table if it is not the currently cached one
+  void Attach(const Tensor<CPUContext>& table) {
+    const TIndex row_bytes = table.size_from_dim(1) * table.itemsize();
+    if (table.raw_data() == table_ && table.dim(0) == num_rows_ &&
+        row_bytes == row_bytes_ && table.meta() == rows_.meta()) {
+      return;
+    }
+    table_ = table.raw_data();
+    num_rows_ = table.dim(0);
+    row_bytes_ = row_bytes;
+    states_.assign(num_rows_, RowState());
+    tracked_rows_.clear();
+    cached_rows_.clear();
+    auto shape = table.dims();
+    shape[0] = 0;
+    rows_.Resize(shape);
+    rows_.raw_mutable_data(table.meta());
+    calls_ = 0;
+  }
+
+  // Counts the accesses of the indices and returns the cache slot of every
+  // index, -1 for the indices not in the cache. Refreshes the cache every
+  // refresh_interval calls, before the remapping.
+  template <typename IndexType>
+  void Lookup(
+      const IndexType* indices,
+      TIndex size,
+      std::vector<IndexType>* slots) {
+    for (TIndex i = 0; i < size; ++i) {
+      const IndexType idx = indices[i];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < num_rows_,
+          "Index ",
+          i,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          num_rows_);
+      auto& state = states_[idx];
+      if (state.count == 0) {
+        tracked_rows_.push_back(idx);
+      }
+      if (state.count < kMaxCount) {
+        ++state.count;
+      }
+    }
+    if (++calls_ >= refresh_interval_) {
+      Refresh();
+    }
+    slots->resize(size);
+    for (TIndex i = 0; i < size; ++i) {
+      (*slots)[i] = states_[indices[i]].slot;
+    }
+  }
+
+  // Refills the cache with the rows of highest access count
+  void Refresh() {
+    calls_ = 0;
+    for (const auto row : cached_rows_) {
+      states_[row].slot = -1;
+    }
+    cached_rows_ = tracked_rows_;
+    if (static_cast<TIndex>(cached_rows_.size()) > capacity_) {
+      std::nth_element(
+          cached_rows_.begin(),
+          cached_rows_.begin() + capacity_,
+          cached_rows_.end(),
+          [this](TIndex a, TIndex b) {
+            return states_[a].count > states_[b].count;
+          });
+      cached_rows_.resize(capacity_);
+    }
+    // Copying in row order reads the table sequentially
+    std::sort(cached_rows_.begin(), cached_rows_.end());
+    auto shape = rows_.dims();
+    shape[0] = cached_rows_.size();
+    rows_.Resize(shape);
+    char* dst = static_cast<char*>(rows_.raw_mutable_data(rows_.meta()));
+    const char* src = static_cast<const char*>(table_);
+    for (size_t slot = 0; slot < cached_rows_.size(); ++slot) {
+      const TIndex row = cached_rows_[slot];
+      states_[row].slot = slot;
+      memcpy(dst + slot * row_bytes_, src + row * row_bytes_, row_bytes_);
+    }
+
+    size_t tracked = 0;
+    for (const auto row : tracked_rows_) {
+      states_[row].count >>= 1;
+      if (states_[row].count > 0) {
+        tracked_rows_[tracked++] = row;
+      }
+    }
+    tracked_rows_.resize(tracked);
+  }
+
+ private:
+  static constexpr uint32_t kMaxCount = 1u << 30;
+
+  struct RowState {
+    uint32_t count = 0;
+    int32_t slot = -1;
+  };
+
+  const TIndex capacity_;
+  const int refresh_interval_;
+  std::mutex mutex_;
+
+  const void* table_ = nullptr;
+  TIndex num_rows_ = 0;
+  TIndex row_bytes_ = 0;
+  std::vector<RowState> states_;
+  // Rows with a non zero count
+  std::vector<TIndex> tracked_rows_;
+  // Table row of every cache slot
+  std::vector<TIndex> cached_rows_;
+  Tensor<CPUContext> rows_;
+  int calls_ = 0;
+};
+
+class CreateEmbeddingCacheOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CreateEmbeddingCacheOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        capacity_(OperatorBase::GetSingleArgument<int64_t>("capacity", 0)),
+        refresh_interval_(
+            OperatorBase::GetSingleArgument<int>("refresh_interval", 1000)) {}
+
+  bool RunOnDevice() override {
+    *OperatorBase::Output<std::unique_ptr<EmbeddingCache>>(0) =
+        caffe2::make_unique<EmbeddingCache>(capacity_, refresh_interval_);
+    return true;
+  }
+
+ private:
+  const int64_t capacity_;
+  const int refresh_interval_;
+};
+
+// Cached variant of SparseLengths[Sum,WeightedSum,Mean]. The hits are
+// reduced from the cache and the misses from the table, both with the
+// EmbeddingLookup perfkernel, and the two partial sums are added.
+template <bool USE_WEIGHT, bool USE_MEAN>
+class CachedSparseLengthsReductionOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CachedSparseLengthsReductionOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        stats_(std::string("embedding_cache/") + operator_def.input(CACHE)) {
+    static_assert(
+        !(USE_WEIGHT & USE_MEAN), "Cannot both specify weight and mean.");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, float16>>::call(
+        this, Input(DATA));
+  }
+
+  template <typename InputType>
+  bool DoRunWithType() {
+    return DispatchHelper<TensorTypes2<int32_t, int64_t>, InputType>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename InputType, typename IndexType>
+  bool DoRunWithType2() {
+    auto& cache =
+        *OperatorBase::Input<std::unique_ptr<EmbeddingCache>>(CACHE);
+    auto& dataInput = Input(DATA);
+    auto& indicesInput = Input(INDICES);
+    auto& lengthsInput = Input(LENGTHS);
+
+    CAFFE_ENFORCE_EQ(1, indicesInput.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(1, lengthsInput.ndim(), "LENGTHS must be a vector");
+    const TIndex N = dataInput.dim(0);
+    const TIndex D = dataInput.size_from_dim(1);
+    const TIndex M = lengthsInput.dim(0);
+    const TIndex indices_size = indicesInput.size();
+
+    auto* output = Output(0);
+    auto shape = dataInput.dims();
+    shape[0] = M;
+    output->Resize(shape);
+    float* out_data = output->template mutable_data<float>();
+
+    const IndexType* indices = indicesInput.template data<IndexType>();
+    const int* lengths = lengthsInput.template data<int>();
+    const float* in_weight = nullptr;
+    if (USE_WEIGHT) {
+      auto& weightInput = Input(WEIGHT);
+      CAFFE_ENFORCE_EQ(1, weightInput.ndim(), "WEIGHT must be a vector");
+      CAFFE_ENFORCE_EQ(
+          weightInput.size(),
+          indices_size,
+          "Weight should have the same length as indices.");
+      in_weight = weightInput.template data<float>();
+    }
+
+    std::lock_guard<std::mutex> guard(cache.mutex());
+    cache.Attach(dataInput);
+    std::vector<IndexType> slots;
+    cache.Lookup(indices, indices_size, &slots);
+
+    // Split every segment into its hits and its misses
+    hit_lengths_.resize(M);
+    miss_lengths_.resize(M);
+    std::vector<IndexType> hit_indices, miss_indices;
+    hit_indices.reserve(indices_size);
+    miss_indices.reserve(indices_size);
+    hit_weights_.clear();
+    miss_weights_.clear();
+    TIndex current = 0;
+    for (TIndex m = 0; m < M; ++m) {
+      CAFFE_ENFORCE_GE(lengths[m], 0, "LENGTHS must be non negative");
+      CAFFE_ENFORCE_LE(
+          current + lengths[m],
+          indices_size,
+          "The sum of LENGTHS has to be the size of INDICES");
+      int hits = 0;
+      for (int i = 0; i < lengths[m]; ++i, ++current) {
+        const bool hit = slots[current] >= 0;
+        if (hit) {
+          hit_indices.push_back(slots[current]);
+          ++hits;
+        } else {
+          miss_indices.push_back(indices[current]);
+        }
+        if (USE_WEIGHT) {
+          (hit ? hit_weights_ : miss_weights_).push_back(in_weight[current]);
+        }
+      }
+      hit_lengths_[m] = hits;
+      miss_lengths_[m] = lengths[m] - hits;
+    }
+    CAFFE_ENFORCE_EQ(
+        current,
+        indices_size,
+        "The sum of LENGTHS has to be the size of INDICES");
+
+    EmbeddingLookup<IndexType, InputType, float, false>(
+        D,
+        M,
+        hit_indices.size(),
+        cache.size(),
+        cache.rows().template data<InputType>(),
+        hit_indices.data(),
+        hit_lengths_.data(),
+        USE_WEIGHT ? hit_weights_.data() : nullptr,
+        nullptr,
+        false,
+        out_data);
+    if (!miss_indices.empty()) {
+      miss_out_.resize(M * D);
+      EmbeddingLookup<IndexType, InputType, float, false>(
+          D,
+          M,
+          miss_indices.size(),
+          N,
+          dataInput.template data<InputType>(),
+          miss_indices.data(),
+          miss_lengths_.data(),
+          USE_WEIGHT ? miss_weights_.data() : nullptr,
+          nullptr,
+          false,
+          miss_out_.data());
+      for (TIndex i = 0; i < M * D; ++i) {
+        out_data[i] += miss_out_[i];
+      }
+    }
+    if (USE_MEAN) {
+      for (TIndex m = 0; m < M; ++m) {
+        if (lengths[m]) {
+          const float len_inv = 1.0f / lengths[m];
+          for (TIndex j = 0; j < D; ++j) {
+            out_data[m * D + j] *= len_inv;
+          }
+        }
+      }
+    }
+
+    CAFFE_EVENT(stats_, num_lookups, indices_size);
+    CAFFE_EVENT(stats_, num_hits, hit_indices.size());
+    CAFFE_EVENT(stats_, num_cached_rows, cache.size());
+    return true;
+  }
+
+ private:
+  struct EmbeddingCacheStats {
+    CAFFE_STAT_CTOR(EmbeddingCacheStats);
+    CAFFE_EXPORTED_STAT(num_lookups);
+    CAFFE_EXPORTED_STAT(num_hits);
+    CAFFE_AVG_EXPORTED_STAT(num_cached_rows);
+  } stats_;
+
+  std::vector<int> hit_lengths_;
+  std::vector<int> miss_lengths_;
+  std::vector<float> hit_weights_;
+  std::vector<float> miss_weights_;
+  std::vector<float> miss_out_;
+
+  enum {
+    CACHE = 0,
+    DATA = 1,
+    WEIGHT = 2,
+    INDICES = 2 + USE_WEIGHT,
+    LENGTHS = 3 + USE_WEIGHT,
+  };
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_EMBEDDING_CACHE_OPS_H_
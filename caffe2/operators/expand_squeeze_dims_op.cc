@@ -7,6 +7,7 @@ REGISTER_CPU_OPERATOR(Squeeze, SqueezeOp<CPUContext>);
 OPERATOR_SCHEMA(ExpandDims)
     .NumInputs(1)
     .NumOutputs(1)
+    .CheapToRun()
     .AllowInplace({{0, 0}})
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
@@ -62,6 +63,7 @@ If the same blob is provided in input and output, the operation is copy-free.
 OPERATOR_SCHEMA(Squeeze)
     .NumInputs(1)
     .NumOutputs(1)
+    .CheapToRun()
     .AllowInplace({{0, 0}})
     .SetDoc(R"DOC(
 Remove single-dimensional entries from the shape of a tensor.
@@ -39,9 +39,13 @@ OpSchema::Cost CostInferenceForFC(
   const int canonical_axis_w =
       canonical_axis_index_(axis_w, in[1].dims().size());
   const int N = size_to_dim_(canonical_axis_w, GetDimsVector(in[1]));
-  c.flops = 2 * K * M * N + M * N;
-  c.bytes_moved = M * N * sizeof(float);
-  c.params_bytes = (K * N + N) * sizeof(float);
+  const uint64_t size_X = static_cast<uint64_t>(M) * K;
+  const uint64_t size_W = static_cast<uint64_t>(K) * N;
+  const uint64_t size_Y = static_cast<uint64_t>(M) * N;
+  c.flops = 2 * size_Y * K + size_Y;
+  c.bytes_read = (size_X + size_W + N) * sizeof(float);
+  c.bytes_written = size_Y * sizeof(float);
+  c.params_bytes = (size_W + N) * sizeof(float);
   return c;
 }
 } // namespace caffe2
@@ -1,9 +1,63 @@
 #include <functional>
 
 #include "caffe2/operators/fully_connected_op.h"
+#include "caffe2/perfkernels/half_float.h"
 
 namespace caffe2 {
 
+template <class Context, class Engine, bool TransposeWeight>
+bool FullyConnectedOp<Context, Engine, TransposeWeight>::
+    RunWithFloat16Storage() {
+  const auto& X = Input(0);
+  X_float_.ResizeLike(X);
+  Float16ToFloat(
+      X.size(),
+      X.template data<float16>(),
+      X_float_.template mutable_data<float>());
+  if (!DoRunWithType<
+          float, // X
+          float, // W
+          float, // B
+          float, // Y
+          float>(X_float_, &Y_float_)) { // Math
+    return false;
+  }
+  auto* Y = Output(0);
+  Y->ResizeLike(Y_float_);
+  FloatToFloat16(
+      Y_float_.size(),
+      Y_float_.template data<float>(),
+      Y->template mutable_data<float16>());
+  return true;
+}
+
+// Float16 activations are stored as float16 and computed in float on CPU
+template <>
+bool FullyConnectedOp<CPUContext>::RunOnDevice() {
+  if (Input(0).IsType<float16>()) {
+    return RunWithFloat16Storage();
+  }
+  return DoRunWithType<
+      float, // X
+      float, // W
+      float, // B
+      float, // Y
+      float>(); // Math
+}
+
+template <>
+bool FullyConnectedOp<CPUContext, DefaultEngine, false>::RunOnDevice() {
+  if (Input(0).IsType<float16>()) {
+    return RunWithFloat16Storage();
+  }
+  return DoRunWithType<
+      float, // X
+      float, // W
+      float, // B
+      float, // Y
+      float>(); // Math
+}
+
 REGISTER_CPU_OPERATOR(FC, FullyConnectedOp<CPUContext>);
 REGISTER_CPU_OPERATOR(FCGradient, FullyConnectedGradientOp<CPUContext>);
 
@@ -64,9 +118,17 @@ OpSchema::Cost CostInferenceForFC(
       ? size_from_dim_(canonical_axis_w, GetDimsVector(in[1]))
       : size_to_dim_(canonical_axis_w, GetDimsVector(in[1]));
 
-  c.flops = 2 * K * M * N + M * N;
-  c.bytes_moved = M * N * sizeof(float);
-  c.params_bytes = (K * N + N) * sizeof(float);
+  const uint64_t size_X = static_cast<uint64_t>(M) * K;
+  const uint64_t size_W = static_cast<uint64_t>(K) * N;
+  const uint64_t size_Y = static_cast<uint64_t>(M) * N;
+  c.flops = 2 * size_Y * K + size_Y;
+  // Float16 activations are computed in float, from float parameters
+  const uint64_t activation_bytes =
+      in[0].data_type() == TensorProto_DataType_FLOAT16 ? sizeof(float16)
+                                                        : sizeof(float);
+  c.bytes_read = size_X * activation_bytes + (size_W + N) * sizeof(float);
+  c.bytes_written = size_Y * activation_bytes;
+  c.params_bytes = (size_W + N) * sizeof(float);
   return c;
 }
 
@@ -128,9 +190,13 @@ OpSchema::Cost CostInferenceForFCGradient(
     size_db *= db.dims(i);
   }
 
-  c.flops = 2 * (M * N * K + M * N);
-  c.bytes_moved = (size_dW + size_db) * sizeof(float);
-  c.params_bytes = (K * N + N) * sizeof(float);
+  const uint64_t size_dY = static_cast<uint64_t>(M) * N;
+  c.flops = 2 * (size_dY * K + size_dY);
+  // X, W and dY
+  c.bytes_read = nBytesOfShape(in[0]) + nBytesOfShape(in[1]) +
+      size_dY * sizeof(float);
+  c.bytes_written = (size_dW + size_db) * sizeof(float);
+  c.params_bytes = (static_cast<uint64_t>(K) * N + N) * sizeof(float);
 
   if (out.size() == 3) {
     const TensorShape dX = out[2];
@@ -139,8 +205,8 @@ OpSchema::Cost CostInferenceForFCGradient(
       size_dX *= dX.dims(i);
     }
 
-    c.flops += M * N * K;
-    c.bytes_moved += size_dX * sizeof(float);
+    c.flops += 2 * size_dY * K;
+    c.bytes_written += size_dX * sizeof(float);
   }
   return c;
 }
@@ -161,6 +227,7 @@ FCTransposed stands for calling blass with no noTrans, noTrans
 OPERATOR_SCHEMA(FC)
     .NumInputs(3)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .TensorInferenceFunction(std::bind(FCShapeInference, _1, _2, false))
     .CostInferenceFunction(std::bind(CostInferenceForFC, _1, _2, false))
     .SetDoc(R"DOC(
@@ -199,7 +266,8 @@ will throw errors.
         0,
         "X",
         "input tensor that's coerced into a 2D matrix of size (MxK) "
-        "as described above")
+        "as described above. On CPU, a float16 X is computed in float and "
+        "gives a float16 Y")
     .Input(
         1,
         "W",
@@ -31,10 +31,18 @@ class FullyConnectedOp final : public Operator<Context> {
       typename T_Y,
       typename MATH>
   bool DoRunWithType() {
-    const auto& X = Input(0);
+    return DoRunWithType<T_X, T_W, T_B, T_Y, MATH>(Input(0), Output(0));
+  }
+
+  template <
+      typename T_X,
+      typename T_W,
+      typename T_B,
+      typename T_Y,
+      typename MATH>
+  bool DoRunWithType(const Tensor<Context>& X, Tensor<Context>* Y) {
     const auto& W = Input(1);
     const auto& b = Input(2);
-    auto* Y = Output(0);
     CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
     // batch size
     const auto canonical_axis = X.canonical_axis_index(axis_);
@@ -138,6 +146,11 @@ class FullyConnectedOp final : public Operator<Context> {
         float>(); // Math
   }
 
+  // Runs on a float16 X and writes a float16 Y, computed in float from the
+  // float W and b: X is converted to float and the result back to float16.
+  // CPU only.
+  bool RunWithFloat16Storage();
+
  protected:
   size_t axis_{1};
   size_t axis_w_{1};
@@ -145,6 +158,9 @@ class FullyConnectedOp final : public Operator<Context> {
   // a vector object every time we run Run().
   vector<TIndex> Y_shape_cache_;
   Tensor<Context> bias_multiplier_;
+  // The float X and Y of RunWithFloat16Storage
+  Tensor<Context> X_float_;
+  Tensor<Context> Y_float_;
 
   bool float16_compute_;
 };
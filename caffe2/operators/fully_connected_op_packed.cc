@@ -0,0 +1,132 @@
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/mkl/utils/mkl_version_check.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+
+namespace caffe2 {
+
+// FullyConnectedOp with the weights packed by PackMatrix in panels of 16
+// outputs (see perfkernels/packed_gemm.h), so that every call reads them as
+// contiguous streams instead of strided rows. This helps most for inference
+// with small batches, where reading the weights is the bulk of the time.
+//
+// The packed weights are kept between runs and packed again only when the
+// weight tensor changes, as told by its address, data, shape and version().
+template <bool TransposeWeight>
+class PackedFullyConnectedOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  PackedFullyConnectedOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)) {}
+  ~PackedFullyConnectedOp() {}
+
+  bool RunOnDevice() override {
+    const auto& X = Input(0);
+    const auto& W = Input(1);
+    const auto& b = Input(2);
+    auto* Y = Output(0);
+    CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+    // batch size
+    const auto canonical_axis = X.canonical_axis_index(axis_);
+    const auto M = X.size_to_dim(canonical_axis);
+    const auto K = X.size_from_dim(canonical_axis);
+    const auto canonical_axis_w = W.canonical_axis_index(axis_w_);
+    const TIndex N = TransposeWeight ? W.size_to_dim(canonical_axis_w)
+                                     : W.size_from_dim(canonical_axis_w);
+
+    auto dimErrorString = [&]() {
+      return MakeString(
+          "Dimension mismatch: ",
+          "X: ",
+          X.dims(),
+          ", W: ",
+          W.dims(),
+          ", b: ",
+          b.dims(),
+          ", axis: ",
+          axis_,
+          ", M: ",
+          M,
+          ", N: ",
+          N,
+          ", K: ",
+          K);
+    };
+
+    // Error checking
+    CAFFE_ENFORCE(M == X.size() / K, dimErrorString());
+    CAFFE_ENFORCE(K == W.size() / N, dimErrorString());
+    CAFFE_ENFORCE(N == b.dim32(0), dimErrorString());
+    CAFFE_ENFORCE(N == b.size(), dimErrorString());
+
+    Y_shape_cache_ = X.dims();
+    // This is an invariant of canonical_axis, so we can DCHECK.
+    DCHECK_LE(canonical_axis + 1, Y_shape_cache_.size());
+    Y_shape_cache_.resize(canonical_axis + 1);
+    Y_shape_cache_[canonical_axis] = N;
+    Y->Resize(Y_shape_cache_);
+    CAFFE_ENFORCE(M * N == Y->size(), dimErrorString());
+
+    if (X.size() == 0) {
+      // skip the rest of the computation if X is empty
+      Y->template mutable_data<float>();
+      return true;
+    }
+
+    if (&W != weight_ || W.version() != weight_version_ ||
+        W.raw_data() != weight_data_ || W.dims() != weight_dims_) {
+      packed_.Resize(PackedMatrixSize(N, K));
+      PackMatrix(
+          TransposeWeight,
+          N,
+          K,
+          W.template data<float>(),
+          packed_.template mutable_data<float>());
+      weight_ = &W;
+      weight_version_ = W.version();
+      weight_data_ = W.raw_data();
+      weight_dims_ = W.dims();
+    }
+
+    PackedGemm(
+        M,
+        N,
+        K,
+        X.template data<float>(),
+        packed_.template data<float>(),
+        b.template data<float>(),
+        Y->template mutable_data<float>());
+    return true;
+  }
+
+ protected:
+  size_t axis_{1};
+  size_t axis_w_{1};
+  // A local vector to cache the output shape so we don't need to recreate
+  // a vector object every time we run Run().
+  vector<TIndex> Y_shape_cache_;
+
+  TensorCPU packed_;
+  // The weight tensor packed_ was computed from
+  const TensorCPU* weight_ = nullptr;
+  uint64_t weight_version_ = 0;
+  const void* weight_data_ = nullptr;
+  vector<TIndex> weight_dims_;
+};
+
+// MKL builds with sgemm packing register their own FC PACKED engine
+// (mkl/operators/packed_fc_op.cc).
+#ifndef CAFFE2_HAS_MKL_SGEMM_PACK
+REGISTER_CPU_OPERATOR_WITH_ENGINE(FC, PACKED, PackedFullyConnectedOp<true>);
+#endif // CAFFE2_HAS_MKL_SGEMM_PACK
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    FCTransposed,
+    PACKED,
+    PackedFullyConnectedOp<false>);
+
+} // namespace caffe2
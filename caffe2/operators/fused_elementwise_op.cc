@@ -0,0 +1,554 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/perfkernels/half_float.h"
+#include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+namespace {
+
+enum class Opcode {
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  RELU,
+  SIGMOID,
+  TANH,
+  EXP,
+  LOG,
+  SQRT,
+  SQR,
+  ABS,
+  NEGATIVE,
+  SCALE,
+  CLIP,
+  LOGIT,
+  COPY,
+};
+
+bool IsBinary(Opcode opcode) {
+  return opcode == Opcode::ADD || opcode == Opcode::SUB ||
+      opcode == Opcode::MUL || opcode == Opcode::DIV;
+}
+
+Opcode GetOpcode(const string& name) {
+  static const std::unordered_map<string, Opcode> opcodes = {
+      {"Add", Opcode::ADD},
+      {"Sub", Opcode::SUB},
+      {"Mul", Opcode::MUL},
+      {"Div", Opcode::DIV},
+      {"Relu", Opcode::RELU},
+      {"Sigmoid", Opcode::SIGMOID},
+      {"Tanh", Opcode::TANH},
+      {"Exp", Opcode::EXP},
+      {"Log", Opcode::LOG},
+      {"Sqrt", Opcode::SQRT},
+      {"Sqr", Opcode::SQR},
+      {"Abs", Opcode::ABS},
+      {"Negative", Opcode::NEGATIVE},
+      {"Scale", Opcode::SCALE},
+      {"Clip", Opcode::CLIP},
+      {"Logit", Opcode::LOGIT},
+      {"Copy", Opcode::COPY},
+  };
+  auto it = opcodes.find(name);
+  CAFFE_ENFORCE(it != opcodes.end(), "Unknown fused operation: ", name);
+  return it->second;
+}
+
+class FusedElementwiseOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  FusedElementwiseOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        broadcast_(OperatorBase::GetSingleArgument<int>("broadcast", 0)),
+        outputs_(OperatorBase::GetRepeatedArgument<int>("outputs")),
+        float16_outputs_(
+            OperatorBase::GetRepeatedArgument<int>("float16_outputs")) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+    const auto ops = OperatorBase::GetRepeatedArgument<string>("ops");
+    const auto lhs = OperatorBase::GetRepeatedArgument<int>("lhs");
+    const auto rhs = OperatorBase::GetRepeatedArgument<int>("rhs");
+    auto scale = OperatorBase::GetRepeatedArgument<float>("scale");
+    if (scale.empty()) {
+      scale.resize(ops.size(), 1.0f);
+    }
+    auto min = OperatorBase::GetRepeatedArgument<float>("min");
+    if (min.empty()) {
+      min.resize(ops.size(), std::numeric_limits<float>::lowest());
+    }
+    auto max = OperatorBase::GetRepeatedArgument<float>("max");
+    if (max.empty()) {
+      max.resize(ops.size(), std::numeric_limits<float>::max());
+    }
+    CAFFE_ENFORCE_EQ(lhs.size(), ops.size());
+    CAFFE_ENFORCE_EQ(rhs.size(), ops.size());
+    CAFFE_ENFORCE_EQ(scale.size(), ops.size());
+    CAFFE_ENFORCE_EQ(min.size(), ops.size());
+    CAFFE_ENFORCE_EQ(max.size(), ops.size());
+    for (int i = 0; i < ops.size(); ++i) {
+      // Instructions read the inputs and the results of the previous ones
+      const int num_registers = InputSize() + i;
+      Instruction instruction{
+          GetOpcode(ops[i]), lhs[i], rhs[i], scale[i], min[i], max[i]};
+      CAFFE_ENFORCE(lhs[i] >= 0 && lhs[i] < num_registers);
+      if (IsBinary(instruction.opcode)) {
+        CAFFE_ENFORCE(rhs[i] >= 0 && rhs[i] < num_registers);
+      }
+      instructions_.push_back(instruction);
+    }
+    CAFFE_ENFORCE_EQ(outputs_.size(), OutputSize());
+    if (float16_outputs_.empty()) {
+      float16_outputs_.resize(OutputSize(), 0);
+    }
+    CAFFE_ENFORCE_EQ(float16_outputs_.size(), OutputSize());
+    for (int output : outputs_) {
+      CAFFE_ENFORCE(
+          output >= 0 && output < InputSize() + instructions_.size());
+    }
+  }
+
+  bool RunOnDevice() override {
+    // The number of elements of the registers, except for the scalars
+    TIndex size = Input(0).size();
+    if (broadcast_) {
+      for (int i = 1; i < InputSize(); ++i) {
+        size = std::max(size, Input(i).size());
+      }
+    }
+    const int num_registers = InputSize() + instructions_.size();
+    // With broadcast, the inputs of a single element when others have more,
+    // and the instructions reading only those, are scalars computed once
+    std::vector<bool> scalar(num_registers, false);
+    std::vector<float> scalar_values(num_registers, 0.0f);
+    // The dims of every register, those of the first operand as for the
+    // operators of the same names
+    std::vector<std::vector<TIndex>> dims;
+    // Float16 inputs are converted to float tile by tile
+    std::vector<const float*> inputs;
+    std::vector<const float16*> float16_inputs;
+    for (int i = 0; i < InputSize(); ++i) {
+      const auto& input = Input(i);
+      dims.push_back(input.dims());
+      const bool is_float16 = input.template IsType<float16>();
+      if (broadcast_ && input.size() == 1 && size != 1) {
+        scalar[i] = true;
+        if (is_float16) {
+          Float16ToFloat(1, input.template data<float16>(), &scalar_values[i]);
+        } else {
+          scalar_values[i] = input.template data<float>()[0];
+        }
+        inputs.push_back(nullptr);
+        float16_inputs.push_back(nullptr);
+        continue;
+      }
+      CAFFE_ENFORCE_EQ(
+          input.size(),
+          size,
+          broadcast_ ? "Fused inputs must have the same size or a single "
+                       "element"
+                     : "Fused inputs must have the same size");
+      if (is_float16) {
+        inputs.push_back(nullptr);
+        float16_inputs.push_back(input.template data<float16>());
+      } else {
+        inputs.push_back(input.template data<float>());
+        float16_inputs.push_back(nullptr);
+      }
+    }
+    for (int i = 0; i < instructions_.size(); ++i) {
+      const auto& instruction = instructions_[i];
+      const int reg = InputSize() + i;
+      dims.push_back(dims[instruction.lhs]);
+      if (!scalar[instruction.lhs]) {
+        continue;
+      }
+      if (IsBinary(instruction.opcode)) {
+        CAFFE_ENFORCE(
+            scalar[instruction.rhs],
+            "Instruction ",
+            i,
+            " cannot broadcast its first operand");
+      }
+      scalar[reg] = true;
+      Compute(
+          instruction,
+          &scalar_values[instruction.lhs],
+          &scalar_values[std::max(instruction.rhs, 0)],
+          1,
+          &scalar_values[reg]);
+    }
+
+    // Outputs may share their blob with an input, so the input pointers are
+    // taken first, and the type of such an output must be the one of the
+    // input for them to stay valid
+    std::vector<float*> outputs;
+    std::vector<float16*> float16_outputs;
+    for (int i = 0; i < OutputSize(); ++i) {
+      for (int j = 0; j < InputSize(); ++j) {
+        if (OperatorBase::Outputs()[i] == OperatorBase::Inputs()[j]) {
+          CAFFE_ENFORCE_EQ(
+              static_cast<bool>(float16_outputs_[i]),
+              float16_inputs[j] != nullptr,
+              "Output ",
+              i,
+              " is computed in place of input ",
+              j,
+              " of another type");
+        }
+      }
+      if (scalar[outputs_[i]]) {
+        // Written once the tiles, which may read the same blob, are done
+        outputs.push_back(nullptr);
+        float16_outputs.push_back(nullptr);
+        continue;
+      }
+      Output(i)->Resize(dims[outputs_[i]]);
+      if (float16_outputs_[i]) {
+        outputs.push_back(nullptr);
+        float16_outputs.push_back(
+            Output(i)->template mutable_data<float16>());
+      } else {
+        outputs.push_back(Output(i)->template mutable_data<float>());
+        float16_outputs.push_back(nullptr);
+      }
+    }
+
+    const TIndex num_tiles = (size + kTileSize - 1) / kTileSize;
+    const TIndex num_ranges = NumRanges(num_tiles, size);
+    scratch_.resize(num_ranges);
+    auto run = [&](size_t range) {
+      auto& scratch = scratch_[range];
+      scratch.resize(num_registers * kTileSize);
+      // The scalars fill the tiles of their registers once for all
+      for (int reg = 0; reg < num_registers; ++reg) {
+        if (scalar[reg]) {
+          float* tile = scratch.data() + Slot(reg) * kTileSize;
+          std::fill(tile, tile + kTileSize, scalar_values[reg]);
+        }
+      }
+      const TIndex begin = range * num_tiles / num_ranges;
+      const TIndex end = (range + 1) * num_tiles / num_ranges;
+      for (TIndex tile = begin; tile < end; ++tile) {
+        const TIndex offset = tile * kTileSize;
+        RunTile(
+            inputs,
+            float16_inputs,
+            scalar,
+            offset,
+            std::min<TIndex>(kTileSize, size - offset),
+            scratch.data(),
+            outputs,
+            float16_outputs);
+      }
+    };
+    if (num_ranges <= 1) {
+      run(0);
+    } else {
+      ws_->GetThreadPool()->runRanges(num_ranges, run);
+    }
+
+    for (int i = 0; i < OutputSize(); ++i) {
+      if (!scalar[outputs_[i]]) {
+        continue;
+      }
+      auto* output = Output(i);
+      output->Resize(dims[outputs_[i]]);
+      const float value = scalar_values[outputs_[i]];
+      if (float16_outputs_[i]) {
+        FloatToFloat16(1, &value, output->template mutable_data<float16>());
+      } else {
+        *output->template mutable_data<float>() = value;
+      }
+    }
+    return true;
+  }
+
+ private:
+  struct Instruction {
+    Opcode opcode;
+    int lhs;
+    int rhs;
+    float scale;
+    float min;
+    float max;
+  };
+
+  // Floats of every register of a tile, so that the registers of a few
+  // instructions stay in L1 and those of long chains in L2
+  static constexpr int kTileSize = 1024;
+
+  // The tile of scratch holding the register: the instructions come first,
+  // then the inputs, which only use theirs when converted from float16 or
+  // scalars
+  int Slot(int reg) const {
+    return reg < InputSize() ? instructions_.size() + reg : reg - InputSize();
+  }
+
+  // Computes the instruction on n elements, one at a time over the whole
+  // tile so that the Eigen expressions are vectorized
+  static void Compute(
+      const Instruction& instruction,
+      const float* lhs,
+      const float* rhs,
+      int n,
+      float* y) {
+    ConstEigenVectorArrayMap<float> a(lhs, n);
+    EigenVectorArrayMap<float> Y(y, n);
+    if (IsBinary(instruction.opcode)) {
+      ConstEigenVectorArrayMap<float> b(rhs, n);
+      switch (instruction.opcode) {
+        case Opcode::ADD:
+          Y = a + b;
+          break;
+        case Opcode::SUB:
+          Y = a - b;
+          break;
+        case Opcode::MUL:
+          Y = a * b;
+          break;
+        default:
+          Y = a / b;
+          break;
+      }
+      return;
+    }
+    switch (instruction.opcode) {
+      case Opcode::RELU:
+        Y = a.cwiseMax(0.f);
+        break;
+      case Opcode::SIGMOID:
+        Y = 1. / (1. + (-a).exp());
+        break;
+      case Opcode::TANH:
+        Y = 1 - 2 * ((a * 2).exp() + 1).inverse();
+        break;
+      case Opcode::EXP:
+        Y = a.exp();
+        break;
+      case Opcode::LOG:
+        Y = a.log();
+        break;
+      case Opcode::SQRT:
+        Y = a.sqrt();
+        break;
+      case Opcode::SQR:
+        Y = a.square();
+        break;
+      case Opcode::ABS:
+        Y = a.abs();
+        break;
+      case Opcode::NEGATIVE:
+        Y = -a;
+        break;
+      case Opcode::SCALE:
+        Y = a * instruction.scale;
+        break;
+      case Opcode::CLIP:
+        Y = a.cwiseMax(instruction.min).cwiseMin(instruction.max);
+        break;
+      case Opcode::LOGIT:
+        Y = a.cwiseMax(instruction.min).cwiseMin(instruction.max);
+        Y = (Y / (1.0f - Y)).log();
+        break;
+      default:
+        Y = a;
+        break;
+    }
+  }
+
+  // Runs all instructions on the n elements from offset on. The scalar
+  // registers already fill their tiles of scratch and are not computed
+  // again.
+  void RunTile(
+      const std::vector<const float*>& inputs,
+      const std::vector<const float16*>& float16_inputs,
+      const std::vector<bool>& scalar,
+      TIndex offset,
+      int n,
+      float* scratch,
+      const std::vector<float*>& outputs,
+      const std::vector<float16*>& float16_outputs) const {
+    std::vector<const float*> registers;
+    for (int i = 0; i < inputs.size(); ++i) {
+      float* x = scratch + Slot(i) * kTileSize;
+      if (scalar[i]) {
+        registers.push_back(x);
+      } else if (float16_inputs[i]) {
+        Float16ToFloat(n, float16_inputs[i] + offset, x);
+        registers.push_back(x);
+      } else {
+        registers.push_back(inputs[i] + offset);
+      }
+    }
+    for (int i = 0; i < instructions_.size(); ++i) {
+      const auto& instruction = instructions_[i];
+      float* y = scratch + i * kTileSize;
+      if (!scalar[inputs.size() + i]) {
+        Compute(
+            instruction,
+            registers[instruction.lhs],
+            IsBinary(instruction.opcode) ? registers[instruction.rhs]
+                                         : nullptr,
+            n,
+            y);
+      }
+      registers.push_back(y);
+    }
+    for (int i = 0; i < outputs.size(); ++i) {
+      const float* value = registers[outputs_[i]];
+      if (float16_outputs[i]) {
+        FloatToFloat16(n, value, float16_outputs[i] + offset);
+        continue;
+      }
+      if (!outputs[i]) {
+        // A scalar, written after the tiles
+        continue;
+      }
+      float* output = outputs[i] + offset;
+      if (value != output) {
+        std::memcpy(output, value, n * sizeof(float));
+      }
+    }
+  }
+
+  // Number of ranges of the num_tiles tiles of size elements in all to
+  // split the work in, with at least kMinParallelSize elements each
+  TIndex NumRanges(TIndex num_tiles, TIndex size) const {
+    constexpr TIndex kMinParallelSize = 1 << 16;
+    if (num_threads_ == 1 || num_tiles <= 1 || size < 2 * kMinParallelSize) {
+      return 1;
+    }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return std::min<TIndex>(
+        std::min<TIndex>(threads, num_tiles), size / kMinParallelSize);
+  }
+
+  Workspace* ws_;
+  // 0 uses all threads of the workspace thread pool, 1 the calling thread
+  const int num_threads_;
+  // Whether inputs of a single element are read by every element
+  const bool broadcast_;
+  std::vector<Instruction> instructions_;
+  std::vector<int> outputs_;
+  // Whether every output is stored as float16 rather than float
+  std::vector<int> float16_outputs_;
+  // The registers of the tiles of every range
+  std::vector<std::vector<float>> scratch_;
+};
+
+constexpr int FusedElementwiseOp::kTileSize;
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(FusedElementwise, FusedElementwiseOp);
+
+OPERATOR_SCHEMA(FusedElementwise)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1, INT_MAX)
+    // Every tile is read before the outputs of the tile are written
+    .AllowInplace([](int, int) { return true; })
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      ArgumentHelper helper(def);
+      const auto float16_outputs =
+          helper.GetRepeatedArgument<int>("float16_outputs");
+      const auto outputs = helper.GetRepeatedArgument<int>("outputs");
+      // Every register has the shape of the first operand of its instruction
+      auto registers = in;
+      for (int lhs : helper.GetRepeatedArgument<int>("lhs")) {
+        registers.push_back(registers.at(lhs));
+      }
+      vector<TensorShape> out;
+      for (int i = 0; i < def.output_size(); ++i) {
+        out.push_back(
+            i < outputs.size() ? registers.at(outputs[i]) : registers[0]);
+        out[i].set_data_type(
+            i < float16_outputs.size() && float16_outputs[i]
+                ? TensorProto_DataType_FLOAT16
+                : TensorProto_DataType_FLOAT);
+      }
+      return out;
+    })
+    .SetDoc(R"DOC(
+Computes a chain of pointwise float operations in one pass over its inputs,
+which all have the same size unless broadcast is set. The instructions read registers: registers 0 to
+N - 1 are the N inputs, and register N + i is the result of instruction i.
+The inputs are split into tiles of 1024 elements, and every tile goes through
+all instructions before the next one, so that the intermediate values stay in
+cache instead of being written to memory. Large inputs are split between the
+threads of the workspace pool.
+
+With broadcast, inputs may also have a single element, which every element of
+the other inputs reads, as the operators of the same names do with broadcast
+of scalars. The instructions reading only such inputs are computed once, and
+their outputs have a single element too.
+
+The inputs and outputs may be stored as float16 while the instructions compute
+in float: float16 inputs are converted to float and float16 outputs from float
+one tile at a time, which halves the memory traffic of the activations of nets
+storing them as float16.
+
+FuseElementwise (caffe2/transforms/elementwise_fusion.h) replaces chains of
+pointwise operators of CPU nets with FusedElementwise operators.
+)DOC")
+    .Arg(
+        "ops",
+        "(list of string) The operation of every instruction: Add, Sub, Mul, "
+        "Div, Relu, Sigmoid, Tanh, Exp, Log, Sqrt, Sqr, Abs, Negative, Scale, "
+        "Clip, Logit or Copy, computed as by the operators of the same names. "
+        "Logit clamps its input to [min, max] rather than to [eps, 1 - eps]")
+    .Arg("lhs", "(list of int) The register every instruction reads")
+    .Arg(
+        "rhs",
+        "(list of int) The second register read by the binary instructions, "
+        "ignored by the others")
+    .Arg(
+        "scale",
+        "(list of float) The factor of the Scale instructions, ignored by the "
+        "others. Defaults to 1 for all instructions")
+    .Arg(
+        "min",
+        "(list of float) The lower bound of the Clip and Logit instructions, "
+        "ignored by the others. Defaults to the lowest float")
+    .Arg(
+        "max",
+        "(list of float) The upper bound of the Clip and Logit instructions, "
+        "ignored by the others. Defaults to the largest float")
+    .Arg("outputs", "(list of int) The register written to every output")
+    .Arg(
+        "float16_outputs",
+        "(list of int) Whether every output is stored as float16 rather than "
+        "float. Defaults to 0 for all outputs")
+    .Arg(
+        "broadcast",
+        "Whether the inputs of a single element are read by every element "
+        "of the others. The first operand of a binary instruction has to have "
+        "at least as many elements as the second, as for the operators of "
+        "the same names. Defaults to 0, all inputs then have the same size")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace pool large inputs are split "
+        "between: 0, the default, uses all of them and 1 the calling thread")
+    .Input(
+        0,
+        "X",
+        "Float or float16 tensor read by the instructions as register 0")
+    .Output(0, "Y", "Float or float16 tensor of the shape of X");
+
+SHOULD_NOT_DO_GRADIENT(FusedElementwise);
+
+} // namespace caffe2
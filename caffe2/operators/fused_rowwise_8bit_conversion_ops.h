@@ -15,12 +15,67 @@ namespace caffe2 {
     return reinterpret_cast<const uint8_t*>(&kValue)[0] == 1; \
   }()
 
+// The "fused" representation stores the scale and bias with the row-wise
+// quantized data in one tensor. Since we quantize with 8 bits (1 byte) and
+// represent the scale and bias with 32-bit floats, we'll use the last 8
+// bytes of each row for scale (4 bytes) and bias (4 bytes).
+// | ... int8 data ... | scale | bias |
+// | number_of_columns |  4B   |  4B  |
+inline void FloatToFused8BitRowwiseQuantized(
+    const float* input_data,
+    TIndex input_rows,
+    TIndex input_columns,
+    uint8_t* output_data) {
+  constexpr float kEpsilon = 1e-8f;
+  const auto output_columns = input_columns + 8;
+  for (TIndex row = 0; row < input_rows; ++row) {
+    ConstEigenVectorArrayMap<float> input_row(
+        input_data + row * input_columns, input_columns);
+
+    uint8_t* output_row = output_data + row * output_columns;
+    EigenVectorArrayMap<uint8_t> output_row_values(output_row, input_columns);
+    EigenVectorArrayMap<float> output_row_scale_bias(
+        reinterpret_cast<float*>(output_row + input_columns), 2);
+
+    const float minimum_element = input_row.minCoeff();
+    const float maximum_element = input_row.maxCoeff();
+    const float range = maximum_element - minimum_element;
+
+    output_row_scale_bias(0) = range / 255.0f;
+    output_row_scale_bias(1) = minimum_element;
+    const auto inverse_scale = 255.0f / (range + kEpsilon);
+    output_row_values = ((input_row - minimum_element) * inverse_scale)
+                            .round()
+                            .cast<uint8_t>();
+  }
+}
+
+// Inverse of FloatToFused8BitRowwiseQuantized, input_columns includes the
+// 8 bytes of scale and bias of every row
+inline void Fused8BitRowwiseQuantizedToFloat(
+    const uint8_t* input_data,
+    TIndex input_rows,
+    TIndex input_columns,
+    float* output_data) {
+  const auto output_columns = input_columns - 8;
+  for (TIndex row = 0; row < input_rows; ++row) {
+    const uint8_t* input_row = input_data + row * input_columns;
+    ConstEigenVectorArrayMap<uint8_t> input_row_values(
+        input_row, output_columns);
+    ConstEigenVectorArrayMap<float> input_row_scale_bias(
+        reinterpret_cast<const float*>(input_row + output_columns), 2);
+
+    EigenVectorArrayMap<float> output_row(
+        output_data + row * output_columns, output_columns);
+
+    output_row = input_row_values.cast<float>() * input_row_scale_bias(0) +
+        input_row_scale_bias(1);
+  }
+}
+
 template <class Context>
 class FloatToFused8BitRowwiseQuantizedOp : public Operator<Context> {
  public:
-  static constexpr float kEqualityThreshold = 1e-7f;
-  static constexpr float kEpsilon = 1e-8f;
-
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   USE_SIMPLE_CTOR_DTOR(FloatToFused8BitRowwiseQuantizedOp)
 
@@ -34,40 +89,16 @@ class FloatToFused8BitRowwiseQuantizedOp : public Operator<Context> {
     const auto input_columns = input.dim(1);
     CAFFE_ENFORCE_EQ(input.ndim(), 2, "Expect input to be a matrix");
 
-    // The "fused" representation stores the scale and bias with the row-wise
-    // quantized data in one tensor. Since we quantize with 8 bits (1 byte) and
-    // represent the scale and bias with 32-bit floats, we'll use the last 8
-    // bytes of each row for scale (4 bytes) and bias (4 bytes).
-    // | ... int8 data ... | scale | bias |
-    // | number_of_columns |  4B   |  4B  |
+    // The scale and the bias of every row follow its quantized values
     const std::vector<TIndex> output_dimensions = {input_rows,
                                                    input_columns + 8};
     output->Resize(output_dimensions);
 
-    const auto* input_data = input.template data<float>();
-    auto* output_data = output->template mutable_data<uint8_t>();
-    const auto output_columns = output->dim(1);
-
-    for (size_t row = 0; row < input_rows; ++row) {
-      ConstEigenVectorArrayMap<float> input_row(
-          input_data + row * input_columns, input_columns);
-
-      uint8_t* output_row = output_data + row * output_columns;
-      EigenVectorArrayMap<uint8_t> output_row_values(output_row, input_columns);
-      EigenVectorArrayMap<float> output_row_scale_bias(
-          reinterpret_cast<float*>(output_row + input_columns), 2);
-
-      const float minimum_element = input_row.minCoeff();
-      const float maximum_element = input_row.maxCoeff();
-      const float range = maximum_element - minimum_element;
-
-      output_row_scale_bias(0) = range / 255.0f;
-      output_row_scale_bias(1) = minimum_element;
-      const auto inverse_scale = 255.0f / (range + kEpsilon);
-      output_row_values = ((input_row - minimum_element) * inverse_scale)
-                              .round()
-                              .cast<uint8_t>();
-    }
+    FloatToFused8BitRowwiseQuantized(
+        input.template data<float>(),
+        input_rows,
+        input_columns,
+        output->template mutable_data<uint8_t>());
 
     return true;
   }
@@ -98,24 +129,11 @@ class Fused8BitRowwiseQuantizedToFloatOp : public Operator<Context> {
     const std::vector<TIndex> output_dimensions = {input_rows,
                                                    input_columns - 8};
     output->Resize(output_dimensions);
-    const auto output_columns = output->dim(1);
-
-    const auto* input_data = input.template data<uint8_t>();
-    auto* output_data = output->template mutable_data<float>();
-
-    for (size_t row = 0; row < input_rows; ++row) {
-      const uint8_t* input_row = input_data + row * input_columns;
-      ConstEigenVectorArrayMap<uint8_t> input_row_values(
-          input_row, output_columns);
-      ConstEigenVectorArrayMap<float> input_row_scale_bias(
-          reinterpret_cast<const float*>(input_row + output_columns), 2);
-
-      EigenVectorArrayMap<float> output_row(
-          output_data + row * output_columns, output_columns);
-
-      output_row = input_row_values.cast<float>() * input_row_scale_bias(0) +
-          input_row_scale_bias(1);
-    }
+    Fused8BitRowwiseQuantizedToFloat(
+        input.template data<uint8_t>(),
+        input_rows,
+        input_columns,
+        output->template mutable_data<float>());
     return true;
   }
 
@@ -0,0 +1,84 @@
+#include "caffe2/operators/fused_rowwise_nbit_conversion_ops.h"
+#include "caffe2/core/registry.h"
+
+namespace caffe2 {
+REGISTER_CPU_OPERATOR(
+    FloatToFused4BitRowwiseQuantized,
+    FloatToFusedNBitRowwiseQuantizedOp<4, CPUContext>);
+OPERATOR_SCHEMA(FloatToFused4BitRowwiseQuantized)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Applies 4-bit row-wise quantization by determining the range
+(maximum - minimum) and offset (minimum value) of each row in the input
+matrix, and then scaling each element to a 4-bit number between 0 and
+15. The quantized values are packed, two per byte with the first one in
+the lowest bits, so the number of columns has to be a multiple of 2. As
+in FloatToFused8BitRowwiseQuantized, the packed values of each row are
+followed by the scale (range / 15) and the bias (minimum), each stored as
+a 32-bit float in 4 bytes.
+)DOC")
+    .Input(0, "input", "Float32 input data")
+    .Output(0, "output", "Fused scale, bias and quantized data");
+NO_GRADIENT(FloatToFused4BitRowwiseQuantized);
+
+REGISTER_CPU_OPERATOR(
+    Fused4BitRowwiseQuantizedToFloat,
+    FusedNBitRowwiseQuantizedToFloatOp<4, CPUContext>);
+OPERATOR_SCHEMA(Fused4BitRowwiseQuantizedToFloat)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+De-quantizes the result of the FloatToFused4BitRowwiseQuantized
+operator. Each row of the input holds packed 4-bit values followed by
+the scale and the bias as 32-bit floats. The output is a matrix of the
+de-quantized values, each value multiplied by its row's scale plus its
+row's bias.
+)DOC")
+    .Input(
+        0,
+        "scale_bias_quantized_input",
+        "Fused scale, bias and quantized data")
+    .Output(0, "float_input", "Float32 data");
+NO_GRADIENT(Fused4BitRowwiseQuantizedToFloat);
+
+REGISTER_CPU_OPERATOR(
+    FloatToFused2BitRowwiseQuantized,
+    FloatToFusedNBitRowwiseQuantizedOp<2, CPUContext>);
+OPERATOR_SCHEMA(FloatToFused2BitRowwiseQuantized)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Applies 2-bit row-wise quantization by determining the range
+(maximum - minimum) and offset (minimum value) of each row in the input
+matrix, and then scaling each element to a 2-bit number between 0 and
+3. The quantized values are packed, four per byte with the first one in
+the lowest bits, so the number of columns has to be a multiple of 4. As
+in FloatToFused8BitRowwiseQuantized, the packed values of each row are
+followed by the scale (range / 3) and the bias (minimum), each stored as
+a 32-bit float in 4 bytes.
+)DOC")
+    .Input(0, "input", "Float32 input data")
+    .Output(0, "output", "Fused scale, bias and quantized data");
+NO_GRADIENT(FloatToFused2BitRowwiseQuantized);
+
+REGISTER_CPU_OPERATOR(
+    Fused2BitRowwiseQuantizedToFloat,
+    FusedNBitRowwiseQuantizedToFloatOp<2, CPUContext>);
+OPERATOR_SCHEMA(Fused2BitRowwiseQuantizedToFloat)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+De-quantizes the result of the FloatToFused2BitRowwiseQuantized
+operator. Each row of the input holds packed 2-bit values followed by
+the scale and the bias as 32-bit floats. The output is a matrix of the
+de-quantized values, each value multiplied by its row's scale plus its
+row's bias.
+)DOC")
+    .Input(
+        0,
+        "scale_bias_quantized_input",
+        "Fused scale, bias and quantized data")
+    .Output(0, "float_input", "Float32 data");
+NO_GRADIENT(Fused2BitRowwiseQuantizedToFloat);
+} // namespace caffe2
@@ -0,0 +1,153 @@
+#ifndef CAFFE2_OPERATORS_FUSED_ROWWISE_NBIT_CONVERSION_OPS_H_
+#define CAFFE2_OPERATORS_FUSED_ROWWISE_NBIT_CONVERSION_OPS_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+#define IS_LITTLE_ENDIAN                                      \
+  [] {                                                        \
+    const int32_t kValue = 1;                                 \
+    return reinterpret_cast<const uint8_t*>(&kValue)[0] == 1; \
+  }()
+
+// Row-wise quantization to BIT_RATE (4 or 2) bits with fused storage. Like
+// the 8-bit format, every row ends with 4 bytes for the scale and 4 bytes for
+// the bias as 32-bit floats, but the quantized values are packed, 8 / BIT_RATE
+// of them per byte with the first value in the lowest bits:
+// | ... packed data ... | scale | bias |
+// | columns / (8 / BIT_RATE) |  4B   |  4B  |
+// The number of columns has to be a multiple of 8 / BIT_RATE.
+template <int BIT_RATE, class Context>
+class FloatToFusedNBitRowwiseQuantizedOp : public Operator<Context> {
+ public:
+  static_assert(BIT_RATE == 2 || BIT_RATE == 4, "Unsupported bit rate");
+  static constexpr int kElementsPerByte = 8 / BIT_RATE;
+  static constexpr float kEpsilon = 1e-8f;
+
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(FloatToFusedNBitRowwiseQuantizedOp)
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE(IS_LITTLE_ENDIAN, "Unsupported endianness");
+
+    const auto& input = Input(DATA_FLOAT);
+    auto* output = Output(DATA_FUSED_SCALE_BIAS);
+
+    CAFFE_ENFORCE_EQ(input.ndim(), 2, "Expect input to be a matrix");
+    const auto input_rows = input.dim(0);
+    const auto input_columns = input.dim(1);
+    CAFFE_ENFORCE_EQ(
+        input_columns % kElementsPerByte,
+        0,
+        "The number of columns has to be a multiple of ",
+        kElementsPerByte,
+        " for ",
+        BIT_RATE,
+        "-bit quantization");
+
+    const auto packed_columns = input_columns / kElementsPerByte;
+    output->Resize(input_rows, packed_columns + 8);
+
+    const auto* input_data = input.template data<float>();
+    auto* output_data = output->template mutable_data<uint8_t>();
+    const auto output_columns = output->dim(1);
+    const float levels = (1 << BIT_RATE) - 1;
+
+    for (TIndex row = 0; row < input_rows; ++row) {
+      const float* input_row = input_data + row * input_columns;
+      uint8_t* output_row = output_data + row * output_columns;
+      float* output_row_scale_bias =
+          reinterpret_cast<float*>(output_row + packed_columns);
+
+      const auto minmax =
+          std::minmax_element(input_row, input_row + input_columns);
+      const float minimum_element = *minmax.first;
+      const float range = *minmax.second - minimum_element;
+
+      output_row_scale_bias[0] = range / levels;
+      output_row_scale_bias[1] = minimum_element;
+      const float inverse_scale = levels / (range + kEpsilon);
+      std::fill(output_row, output_row + packed_columns, 0);
+      for (TIndex col = 0; col < input_columns; ++col) {
+        const float quantized = std::min(
+            levels,
+            std::round((input_row[col] - minimum_element) * inverse_scale));
+        output_row[col / kElementsPerByte] |= static_cast<uint8_t>(quantized)
+            << ((col % kElementsPerByte) * BIT_RATE);
+      }
+    }
+
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DATA_FLOAT);
+  OUTPUT_TAGS(DATA_FUSED_SCALE_BIAS);
+};
+
+template <int BIT_RATE, class Context>
+class FusedNBitRowwiseQuantizedToFloatOp : public Operator<Context> {
+ public:
+  static_assert(BIT_RATE == 2 || BIT_RATE == 4, "Unsupported bit rate");
+  static constexpr int kElementsPerByte = 8 / BIT_RATE;
+
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(FusedNBitRowwiseQuantizedToFloatOp)
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE(IS_LITTLE_ENDIAN, "Unsupported endianness");
+
+    const auto& input = Input(DATA_FUSED_SCALE_BIAS);
+    auto* output = Output(DATA_FLOAT);
+
+    CAFFE_ENFORCE_EQ(input.ndim(), 2, "Expect input to be a matrix");
+    CAFFE_ENFORCE_GT(
+        input.dim(1), 8, "Expect input to have more than 8 columns");
+    const auto input_rows = input.dim(0);
+    const auto input_columns = input.dim(1);
+
+    // The last 8 bytes per row are the scale and the bias, the rest are the
+    // packed values of the original row.
+    const auto packed_columns = input_columns - 8;
+    output->Resize(input_rows, packed_columns * kElementsPerByte);
+    const auto output_columns = output->dim(1);
+
+    const auto* input_data = input.template data<uint8_t>();
+    auto* output_data = output->template mutable_data<float>();
+    const uint8_t mask = (1 << BIT_RATE) - 1;
+
+    for (TIndex row = 0; row < input_rows; ++row) {
+      const uint8_t* input_row = input_data + row * input_columns;
+      const float* input_row_scale_bias =
+          reinterpret_cast<const float*>(input_row + packed_columns);
+      float* output_row = output_data + row * output_columns;
+
+      for (TIndex col = 0; col < output_columns; ++col) {
+        const uint8_t quantized =
+            (input_row[col / kElementsPerByte] >>
+             ((col % kElementsPerByte) * BIT_RATE)) &
+            mask;
+        output_row[col] =
+            quantized * input_row_scale_bias[0] + input_row_scale_bias[1];
+      }
+    }
+    return true;
+  }
+
+ private:
+  INPUT_TAGS(DATA_FUSED_SCALE_BIAS);
+  OUTPUT_TAGS(DATA_FLOAT);
+};
+
+#undef IS_LITTLE_ENDIAN
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_FUSED_ROWWISE_NBIT_CONVERSION_OPS_H_
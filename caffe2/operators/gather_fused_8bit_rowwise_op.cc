@@ -10,7 +10,21 @@ Perform the same operation as Gather, but operating on 8-bit rowwise quantized
 matrices with fused storage (where each row stores quantized values, and then
 the scale and offset).
 DATA needs to have rank 2 and INDICES needs to have rank 1.
+
+By default the gathered rows are dequantized into a float OUTPUT. With
+dequantize=0, OUTPUT holds the fused uint8 rows, scale and bias included.
 )DOC")
+    .Arg(
+        "dequantize",
+        "(bool, default true) Whether to dequantize the rows to float.")
+    .Arg(
+        "num_threads",
+        "(int, default 1) Number of threads of the workspace thread pool to "
+        "split the indices between, 0 uses all of them.")
+    .Arg(
+        "min_indices_per_thread",
+        "(int, default 1024) Minimum number of indices per thread when "
+        "num_threads is not 1.")
     .Input(
         0,
         "DATA",
@@ -23,14 +37,17 @@ DATA needs to have rank 2 and INDICES needs to have rank 1.
     .Output(0, "OUTPUT", "output")
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
+      ArgumentHelper helper(def);
+      const bool dequantize =
+          helper.GetSingleArgument<bool>("dequantize", true);
       vector<TensorShape> out(1);
       for (auto d : in[1].dims()) {
         out[0].add_dims(d);
       }
-      for (int i = 1; i < in[0].dims_size(); ++i) {
-        out[0].add_dims(in[0].dims(i));
-      }
-      out[0].set_data_type(in[0].data_type());
+      // The scale and bias take the last 8 columns of the fused rows
+      out[0].add_dims(dequantize ? in[0].dims(1) - 8 : in[0].dims(1));
+      out[0].set_data_type(
+          dequantize ? TensorProto::FLOAT : in[0].data_type());
       return out;
     });
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+
 #include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/perfkernels/gather.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -9,7 +14,17 @@ template <class Context>
 class GatherFused8BitRowwiseOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(GatherFused8BitRowwiseOp);
+  GatherFused8BitRowwiseOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        dequantize_(
+            OperatorBase::GetSingleArgument<bool>("dequantize", true)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 1)),
+        min_indices_per_thread_(OperatorBase::GetSingleArgument<int>(
+            "min_indices_per_thread",
+            1024)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
@@ -27,39 +42,77 @@ class GatherFused8BitRowwiseOp : public Operator<Context> {
     CAFFE_ENFORCE_GT(data.dim(1), 8, "DATA must have more than 8 columns");
     // Subtract 8 from the #columns of data for the 4 bytes for scale and 4
     // bytes for bias that we use in the fused representation (per row).
-    const std::vector<TIndex> shape = {indices.dim(0), data.dim(1) - 8};
-    output->Resize(shape);
-
-    int block_size = shape[1];
-    auto block_bytesize = data.size_from_dim(1) * data.meta().itemsize();
-    int N = indices.size();
+    const TIndex block_size = data.dim(1) - 8;
+    const TIndex fused_block_size = data.dim(1);
+    const TIndex N = indices.size();
+    if (dequantize_) {
+      output->Resize(N, block_size);
+    } else {
+      output->Resize(N, fused_block_size);
+    }
 
     const uint8_t* src_base = data.template data<uint8_t>();
     const Index* idxs = indices.template data<Index>();
-    auto out = output->template mutable_data<float>();
-
-    for (int i = 0; i < N; ++i) {
-      auto idx = idxs[i];
-      CAFFE_ENFORCE(
-          0 <= idx && idx < data.dim(0),
-          "INDICES element is out of DATA bounds, id=",
-          idx,
-          " data_dim=",
-          data.dim(0));
-      const uint8_t* src = src_base + idx * block_bytesize;
-      ConstEigenVectorArrayMap<uint8_t> input_row_values(src, shape[1]);
-      ConstEigenVectorArrayMap<float> input_row_scale_bias(
-          reinterpret_cast<const float*>(src + shape[1]), 2);
-
-      EigenVectorArrayMap<float> output_row(out + i * shape[1], shape[1]);
+    float* out = dequantize_ ? output->template mutable_data<float>() : nullptr;
+    uint8_t* fused_out =
+        dequantize_ ? nullptr : output->template mutable_data<uint8_t>();
 
-      output_row = input_row_values.cast<float>() * input_row_scale_bias(0) +
-          input_row_scale_bias(1);
+    const TIndex num_ranges = NumRanges(N);
+    auto gather = [&](size_t range) {
+      const TIndex begin = range * N / num_ranges;
+      const TIndex end = (range + 1) * N / num_ranges;
+      if (dequantize_) {
+        GatherFused8BitRowwise<Index>(
+            block_size,
+            end - begin,
+            data.dim(0),
+            src_base,
+            idxs + begin,
+            out + begin * block_size);
+      } else {
+        GatherRows<Index>(
+            fused_block_size,
+            end - begin,
+            data.dim(0),
+            src_base,
+            idxs + begin,
+            fused_out + begin * fused_block_size);
+      }
+    };
+    if (num_ranges <= 1) {
+      gather(0);
+    } else {
+      ws_->GetThreadPool()->runRanges(num_ranges, gather);
     }
     return true;
   }
 
   INPUT_TAGS(DATA, INDICES);
+
+ private:
+  // Number of ranges of indices to split the gather in
+  TIndex NumRanges(TIndex num_indices) {
+    if (num_threads_ == 1) {
+      return 1;
+    }
+    const TIndex max_ranges =
+        num_indices / std::max(1, min_indices_per_thread_);
+    if (max_ranges <= 1) {
+      return 1;
+    }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return std::max<TIndex>(1, std::min<TIndex>(threads, max_ranges));
+  }
+
+  Workspace* ws_;
+  const bool dequantize_;
+  // 0 uses all threads of the workspace thread pool, 1 gathers on the
+  // calling thread
+  const int num_threads_;
+  const int min_indices_per_thread_;
 };
 
 } // namespace caffe2
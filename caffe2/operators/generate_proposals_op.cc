@@ -1,5 +1,11 @@
 #include "caffe2/operators/generate_proposals_op.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "caffe2/core/workspace.h"
 #include "caffe2/operators/generate_proposals_op_util_boxes.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 #include "generate_proposals_op_util_nms.h"
 
 #ifdef CAFFE2_USE_MKL
@@ -224,22 +230,44 @@ bool GenerateProposalsOp<CPUContext>::RunOnDevice() {
   out_rois->Resize(0, roi_col_count);
   out_rois_probs->Resize(0);
 
-  // Use openmp for acceleration?
-  for (int i = 0; i < num_images; i++) {
-    auto cur_im_info = im_info.row(i);
-    auto cur_bbox_deltas = GetSubTensorView<float>(bbox_deltas, i);
-    auto cur_scores = GetSubTensorView<float>(scores, i);
-
-    ERArrXXf im_i_boxes;
-    EArrXf im_i_probs;
+  // The proposals of every image, computed in parallel
+  std::vector<ERArrXXf> im_boxes(num_images);
+  std::vector<EArrXf> im_probs(num_images);
+  auto run_image = [&](int i) {
     ProposalsForOneImage(
-        cur_im_info,
+        im_info.row(i),
         all_anchors,
-        cur_bbox_deltas,
-        cur_scores,
-        &im_i_boxes,
-        &im_i_probs);
+        GetSubTensorView<float>(bbox_deltas, i),
+        GetSubTensorView<float>(scores, i),
+        &im_boxes[i],
+        &im_probs[i]);
+  };
+  int num_ranges = 1;
+  if (num_threads_ != 1 && num_images > 1) {
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    num_ranges = std::min<int>(
+        num_images,
+        num_threads_ == 0 ? pool_threads
+                          : std::min(num_threads_, pool_threads));
+  }
+  if (num_ranges <= 1) {
+    for (int i = 0; i < num_images; i++) {
+      run_image(i);
+    }
+  } else {
+    // Images are taken one at a time, as they may keep different numbers of
+    // proposals
+    std::atomic<int> next_image(0);
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t /* unused */) {
+      for (int i = next_image++; i < num_images; i = next_image++) {
+        run_image(i);
+      }
+    });
+  }
 
+  for (int i = 0; i < num_images; i++) {
+    const auto& im_i_boxes = im_boxes[i];
+    const auto& im_i_probs = im_probs[i];
     int csz = im_i_boxes.rows();
     int cur_start_idx = out_rois->dim(0);
 
@@ -293,6 +321,10 @@ non-maximum suppression is applied to generate the final bounding boxes.
     .Arg("post_nms_topN", "(int) RPN_POST_NMS_TOP_N")
     .Arg("nms_thresh", "(float) RPN_NMS_THRESH")
     .Arg("min_size", "(float) RPN_MIN_SIZE")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the images are split "
+        "between: 0, the default, uses all of them and 1 the calling thread")
     .Input(0, "scores", "Scores from conv layer, size (img_count, A, H, W)")
     .Input(
         1,
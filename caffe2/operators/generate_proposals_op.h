@@ -66,6 +66,8 @@ class GenerateProposalsOp final : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   GenerateProposalsOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
         spatial_scale_(
             OperatorBase::GetSingleArgument<float>("spatial_scale", 1.0 / 16)),
         feat_stride_(1.0 / spatial_scale_),
@@ -78,7 +80,9 @@ class GenerateProposalsOp final : public Operator<Context> {
         rpn_min_size_(OperatorBase::GetSingleArgument<float>("min_size", 16)),
         correct_transform_coords_(OperatorBase::GetSingleArgument<bool>(
             "correct_transform_coords",
-            false)) {}
+            false)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
 
   ~GenerateProposalsOp() {}
 
@@ -100,6 +104,11 @@ class GenerateProposalsOp final : public Operator<Context> {
       EArrXf* out_probs) const;
 
  protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the images are split between: 0
+  // uses all of them, 1 the calling thread
+  int num_threads_;
+
   // spatial_scale_ must be declared before feat_stride_
   float spatial_scale_{1.0};
   float feat_stride_{1.0};
@@ -22,6 +22,13 @@ namespace utils {
 // scores: scores for each bounding box, size: (M, 1)
 // sorted_indices: indices that sorts the scores from high to low
 // return: row indices of the selected proposals
+//
+// The candidates are gathered in score order into one array per coordinate,
+// so that the IoU of a selected box with all the next candidates is computed
+// on contiguous vectors, and suppressed candidates are only cleared in a
+// mask instead of being removed from the arrays. The arrays are compacted
+// every few selected boxes, and the loop stops as soon as topN boxes are
+// selected.
 template <class Derived1, class Derived2>
 std::vector<int> nms_cpu(
     const Eigen::ArrayBase<Derived1>& proposals,
@@ -34,41 +41,68 @@ std::vector<int> nms_cpu(
   CAFFE_ENFORCE_EQ(scores.cols(), 1);
   CAFFE_ENFORCE_LE(sorted_indices.size(), proposals.rows());
 
-  using EArrX = EArrXt<typename Derived1::Scalar>;
-
-  auto x1 = proposals.col(0);
-  auto y1 = proposals.col(1);
-  auto x2 = proposals.col(2);
-  auto y2 = proposals.col(3);
+  using T = typename Derived1::Scalar;
+  using EArrX = EArrXt<T>;
+  // Number of selected boxes between two compactions of the candidates
+  constexpr int kCompactInterval = 16;
 
+  int n = sorted_indices.size();
+  std::vector<int> order(sorted_indices);
+  EArrX x1(n), y1(n), x2(n), y2(n);
+  for (int k = 0; k < n; ++k) {
+    const int idx = order[k];
+    x1[k] = proposals(idx, 0);
+    y1[k] = proposals(idx, 1);
+    x2[k] = proposals(idx, 2);
+    y2[k] = proposals(idx, 3);
+  }
   EArrX areas = (x2 - x1 + 1.0) * (y2 - y1 + 1.0);
+  // 1 for the candidates that are not suppressed yet, 0 for the others
+  EArrX alive = EArrX::Ones(n);
+  EArrX inter(n);
 
-  EArrXi order = AsEArrXt(sorted_indices);
   std::vector<int> keep;
-  int ci = 0;
-  while (order.size() > 0) {
+  for (int i = 0; i < n; ++i) {
+    if (alive[i] == 0) {
+      continue;
+    }
     // exit if already enough proposals
     if (topN >= 0 && keep.size() >= topN) {
       break;
     }
+    keep.push_back(order[i]);
 
-    int i = order[0];
-    keep.push_back(i);
-    ConstEigenVectorArrayMap<int> rest_indices(
-        order.data() + 1, order.size() - 1);
-    EArrX xx1 = GetSubArray(x1, rest_indices).cwiseMax(x1[i]);
-    EArrX yy1 = GetSubArray(y1, rest_indices).cwiseMax(y1[i]);
-    EArrX xx2 = GetSubArray(x2, rest_indices).cwiseMin(x2[i]);
-    EArrX yy2 = GetSubArray(y2, rest_indices).cwiseMin(y2[i]);
-
-    EArrX w = (xx2 - xx1 + 1.0).cwiseMax(0.0);
-    EArrX h = (yy2 - yy1 + 1.0).cwiseMax(0.0);
-    EArrX inter = w * h;
-    EArrX ovr = inter / (areas[i] + GetSubArray(areas, rest_indices) - inter);
+    // The candidates after i
+    const int rest = n - i - 1;
+    auto next = [i, rest](EArrX& a) { return a.segment(i + 1, rest); };
+    inter.head(rest) =
+        (next(x2).cwiseMin(x2[i]) - next(x1).cwiseMax(x1[i]) + 1.0)
+            .cwiseMax(0.0) *
+        (next(y2).cwiseMin(y2[i]) - next(y1).cwiseMax(y1[i]) + 1.0)
+            .cwiseMax(0.0);
+    // Candidates whose IoU is not below the threshold, NaN included, are
+    // suppressed
+    next(alive) =
+        (inter.head(rest) / (areas[i] + next(areas) - inter.head(rest)) <=
+         thresh)
+            .select(next(alive), T(0));
 
-    // indices for sub array order[1:n]
-    auto inds = GetArrayIndices(ovr <= thresh);
-    order = GetSubArray(order, AsEArrXt(inds) + 1);
+    if (keep.size() % kCompactInterval == 0) {
+      int end = i + 1;
+      for (int k = i + 1; k < n; ++k) {
+        if (alive[k] != 0) {
+          order[end] = order[k];
+          x1[end] = x1[k];
+          y1[end] = y1[k];
+          x2[end] = x2[k];
+          y2[end] = y2[k];
+          areas[end] = areas[k];
+          alive[end] = 1;
+          ++end;
+        }
+      }
+      n = end;
+    }
   }
 
   return keep;
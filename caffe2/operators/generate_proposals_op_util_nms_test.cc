@@ -44,6 +44,67 @@ TEST(UtilsNMSTest, TestNMS) {
   }
 }
 
+TEST(UtilsNMSTest, TestNMSManyBoxes) {
+  // Clusters of overlapping boxes, so that many boxes are selected and
+  // suppressed and the candidates get compacted
+  const int num_boxes = 500;
+  Eigen::ArrayXXf proposals(num_boxes, 4);
+  Eigen::ArrayXf scores(num_boxes);
+  for (int i = 0; i < num_boxes; i++) {
+    const float x = (i % 23) * 17 + (i * 7 % 13);
+    const float y = (i % 19) * 13 + (i * 5 % 11);
+    proposals.row(i) << x, y, x + 20 + i % 7, y + 15 + i % 5;
+    scores[i] = (i * 37 % 101) / 101.0f;
+  }
+  std::vector<int> indices(num_boxes);
+  std::iota(indices.begin(), indices.end(), 0);
+  std::stable_sort(
+      indices.begin(), indices.end(), [&scores](int lhs, int rhs) {
+        return scores(lhs) > scores(rhs);
+      });
+
+  for (float thresh : {0.0f, 0.1f, 0.3f, 0.5f, 0.7f, 1.0f}) {
+    // Reference: every candidate checked against all selected boxes
+    std::vector<int> expected;
+    for (int i : indices) {
+      bool suppressed = false;
+      for (int k : expected) {
+        const float w = std::max(
+            std::min(proposals(i, 2), proposals(k, 2)) -
+                std::max(proposals(i, 0), proposals(k, 0)) + 1.0f,
+            0.0f);
+        const float h = std::max(
+            std::min(proposals(i, 3), proposals(k, 3)) -
+                std::max(proposals(i, 1), proposals(k, 1)) + 1.0f,
+            0.0f);
+        const float inter = w * h;
+        const float area_i = (proposals(i, 2) - proposals(i, 0) + 1.0f) *
+            (proposals(i, 3) - proposals(i, 1) + 1.0f);
+        const float area_k = (proposals(k, 2) - proposals(k, 0) + 1.0f) *
+            (proposals(k, 3) - proposals(k, 1) + 1.0f);
+        if (!(inter / (area_k + area_i - inter) <= thresh)) {
+          suppressed = true;
+          break;
+        }
+      }
+      if (!suppressed) {
+        expected.push_back(i);
+      }
+    }
+    EXPECT_EQ(expected, utils::nms_cpu(proposals, scores, indices, thresh));
+
+    for (int top_n : {0, 1, 17, 100}) {
+      auto expected_top = expected;
+      if (expected_top.size() > top_n) {
+        expected_top.resize(top_n);
+      }
+      EXPECT_EQ(
+          expected_top,
+          utils::nms_cpu(proposals, scores, indices, thresh, top_n));
+    }
+  }
+}
+
 TEST(UtilsNMSTest, TestSoftNMS) {
   Eigen::ArrayXXf input(5, 5);
   input.row(0) << 5.18349426e+02, 1.77783920e+02, 9.06085266e+02,
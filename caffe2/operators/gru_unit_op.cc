@@ -1,6 +1,97 @@
 #include "gru_unit_op.h"
 
+#include <vector>
+
+#include "caffe2/perfkernels/math.h"
+
 namespace caffe2 {
+namespace detail {
+
+template <>
+void GRUUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* H,
+    bool fast_activations,
+    CPUContext* /*context*/) {
+  std::vector<float> gates(2 * D);
+  for (int n = 0; n < N; ++n) {
+    const bool valid = seqLengths == nullptr || t < seqLengths[n];
+    if (!valid) {
+      if (drop_states) {
+        std::fill(H, H + D, 0.0f);
+      } else {
+        std::copy(H_prev, H_prev + D, H);
+      }
+    } else {
+      VectorizedSigmoid(D, X + D, gates.data(), fast_activations);
+      VectorizedTanh(D, X + 2 * D, gates.data() + D, fast_activations);
+      ConstEigenVectorArrayMap<float> u(gates.data(), D);
+      ConstEigenVectorArrayMap<float> o(gates.data() + D, D);
+      EigenVectorArrayMap<float>(H, D) =
+          ConstEigenVectorArrayMap<float>(H_prev, D) * u + o * (1 - u);
+    }
+    H_prev += D;
+    X += 3 * D;
+    H += D;
+  }
+}
+
+template <>
+void GRUUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* /*H*/,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* X_diff,
+    bool fast_activations,
+    CPUContext* /*context*/) {
+  std::vector<float> gates(2 * D);
+  for (int n = 0; n < N; ++n) {
+    const bool valid = seqLengths == nullptr || t < seqLengths[n];
+    if (!valid) {
+      if (drop_states) {
+        std::fill(H_prev_diff, H_prev_diff + D, 0.0f);
+      } else {
+        std::copy(H_diff, H_diff + D, H_prev_diff);
+      }
+      std::fill(X_diff, X_diff + 3 * D, 0.0f);
+    } else {
+      VectorizedSigmoid(D, X + D, gates.data(), fast_activations);
+      VectorizedTanh(D, X + 2 * D, gates.data() + D, fast_activations);
+      ConstEigenVectorArrayMap<float> u(gates.data(), D);
+      ConstEigenVectorArrayMap<float> o(gates.data() + D, D);
+      ConstEigenVectorArrayMap<float> h_diff(H_diff, D);
+      EigenVectorArrayMap<float>(H_prev_diff, D) = h_diff * u;
+      // 0 contribution to the reset gradient from this operation
+      std::fill(X_diff, X_diff + D, 0.0f);
+      EigenVectorArrayMap<float>(X_diff + D, D) =
+          h_diff * (ConstEigenVectorArrayMap<float>(H_prev, D) - o) * u *
+          (1 - u);
+      EigenVectorArrayMap<float>(X_diff + 2 * D, D) =
+          h_diff * (1 - u) * (1 - o * o);
+    }
+    H_prev += D;
+    X += 3 * D;
+    H_diff += D;
+    X_diff += 3 * D;
+    H_prev_diff += D;
+  }
+}
+
+} // namespace detail
+
 REGISTER_CPU_OPERATOR(GRUUnit, GRUUnitOp<float, CPUContext>);
 OPERATOR_SCHEMA(GRUUnit)
     .NumInputs(3, 4)
@@ -19,6 +110,10 @@ value at X[t][n] >= seqLengths[n].
         "drop_states",
         "Bool to determine if hidden state is zeroes or passed "
         "along for timesteps past the given sequence_length.")
+    .Arg(
+        "fast_activations",
+        "If set, the CPU op approximates sigmoid and tanh with a rational "
+        "function, faster and within 4e-7 of them")
     .Arg(
         "sequence_lengths",
         "When false, the sequence lengths input is left out, "
@@ -28,6 +28,7 @@ void GRUUnit(
     const int32_t* seqLengths,
     bool drop_states,
     T* H,
+    bool /*fast_activations*/,
     Context* /*context*/) {
   for (int n = 0; n < N; ++n) {
     const bool valid = seqLengths == nullptr || t < seqLengths[n];
@@ -67,6 +68,7 @@ void GRUUnitGradient(
     bool drop_states,
     T* H_prev_diff,
     T* X_diff,
+    bool /*fast_activations*/,
     Context* /*context*/) {
   for (int n = 0; n < N; ++n) {
     const bool valid = seqLengths == nullptr || t < seqLengths[n];
@@ -107,6 +109,37 @@ void GRUUnitGradient(
   }
 }
 
+// Row-wise vectorized versions, with VectorizedSigmoid and VectorizedTanh
+// (fast approximations of them if fast_activations).
+template <>
+void GRUUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* H,
+    bool fast_activations,
+    CPUContext* context);
+
+template <>
+void GRUUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* H,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* X_diff,
+    bool fast_activations,
+    CPUContext* context);
+
 } // namespace detail
 
 template <typename T, typename Context>
@@ -119,7 +152,10 @@ class GRUUnitOp : public Operator<Context> {
             false)),
         sequence_lengths_(OperatorBase::template GetSingleArgument<bool>(
             "sequence_lengths",
-            true)) {}
+            true)),
+        fast_activations_(OperatorBase::template GetSingleArgument<bool>(
+            "fast_activations",
+            false)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
   bool RunOnDevice() override {
@@ -149,7 +185,16 @@ class GRUUnitOp : public Operator<Context> {
     auto* H = Output(HIDDEN_T)->template mutable_data<T>();
 
     detail::GRUUnit<T, Context>(
-        N, D, t, H_prev, X, seqLengths, drop_states_, H, &context_);
+        N,
+        D,
+        t,
+        H_prev,
+        X,
+        seqLengths,
+        drop_states_,
+        H,
+        fast_activations_,
+        &context_);
     return true;
   }
 
@@ -162,6 +207,7 @@ class GRUUnitOp : public Operator<Context> {
  private:
   bool drop_states_;
   bool sequence_lengths_;
+  bool fast_activations_;
 };
 
 template <typename T, typename Context>
@@ -174,7 +220,10 @@ class GRUUnitGradientOp : public Operator<Context> {
             false)),
         sequence_lengths_(OperatorBase::template GetSingleArgument<bool>(
             "sequence_lengths",
-            true)) {}
+            true)),
+        fast_activations_(OperatorBase::template GetSingleArgument<bool>(
+            "fast_activations",
+            false)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
   bool RunOnDevice() override {
@@ -222,6 +271,7 @@ class GRUUnitGradientOp : public Operator<Context> {
         drop_states_,
         H_prev_diff,
         X_diff,
+        fast_activations_,
         &context_);
     return true;
   }
@@ -233,6 +283,7 @@ class GRUUnitGradientOp : public Operator<Context> {
  private:
   bool drop_states_;
   bool sequence_lengths_;
+  bool fast_activations_;
 };
 
 } // namespace caffe2
@@ -93,6 +93,7 @@ void GRUUnit<float, CUDAContext>(
     const int32_t* seqLengths,
     bool drop_states,
     float* H,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   GRUUnitKernel<float>
       <<<CAFFE_GET_BLOCKS(N * D),
@@ -115,6 +116,7 @@ void GRUUnitGradient<float, CUDAContext>(
     bool drop_states,
     float* H_prev_diff,
     float* X_diff,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   GRUUnitGradientKernel<float>
       <<<CAFFE_GET_BLOCKS(N * D),
@@ -1,6 +1,42 @@
 #include "caffe2/operators/half_float_ops.h"
 
+#include <algorithm>
+
+#include "caffe2/perfkernels/half_float.h"
+
 namespace caffe2 {
+
+template <>
+bool FloatToHalfOp<CPUContext>::RunOnDevice() {
+  auto& X = Input(0);
+  auto* Y = Output(0);
+  Y->ResizeLike(X);
+  FloatToFloat16(X.size(), X.data<float>(), Y->mutable_data<float16>());
+  return true;
+}
+
+template <>
+bool HalfToFloatOp<CPUContext>::RunOnDevice() {
+  auto& X = Input(0);
+  auto* Y = Output(0);
+  Y->ResizeLike(X);
+  Float16ToFloat(X.size(), X.data<float16>(), Y->mutable_data<float>());
+  return true;
+}
+
+bool Float16ConstantFillOp::RunOnDevice() {
+  auto* output = Output(0);
+  output->Resize(shape_);
+  float16 value;
+  FloatToFloat16(1, &value_, &value);
+  std::fill_n(output->mutable_data<float16>(), output->size(), value);
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(FloatToHalf, FloatToHalfOp<CPUContext>);
+REGISTER_CPU_OPERATOR(HalfToFloat, HalfToFloatOp<CPUContext>);
+REGISTER_CPU_OPERATOR(Float16ConstantFill, Float16ConstantFillOp);
+
 OPERATOR_SCHEMA(FloatToHalf)
     .NumInputs(1)
     .NumOutputs(1)
@@ -29,7 +29,8 @@ class Float16ConstantFillOp : public Operator<CPUContext> {
   Float16ConstantFillOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<CPUContext>(operator_def, ws),
         shape_(
-            ToVectorTIndex(OperatorBase::GetRepeatedArgument<int>("shape"))) {}
+            ToVectorTIndex(OperatorBase::GetRepeatedArgument<int>("shape"))),
+        OP_SINGLE_ARG(float, "value", value_, 0.0f) {}
 
   USE_OPERATOR_FUNCTIONS(CPUContext);
   virtual ~Float16ConstantFillOp() {}
@@ -38,6 +39,7 @@ class Float16ConstantFillOp : public Operator<CPUContext> {
 
  private:
   vector<TIndex> shape_;
+  float value_;
 };
 
 inline std::vector<TensorShape> Float16FillerTensorInference(
@@ -13,11 +13,18 @@ This operator translates a list of indices into a list of hashed indices.
 A seed can be fed as an argument to change the behavior of the hash function.
 If a modulo is specified, all the hashed indices will be modulo the
 specified number. All input and output indices are enforced to be positive.
+
+The ids are hashed several at a time with AVX2, and large inputs are split
+between the threads of the workspace thread pool.
 )DOC")
     .Input(0, "Indices", "Input feature indices.")
     .Output(0, "HashedIndices", "Hashed feature indices.")
     .Arg("seed", "seed for the hash function")
     .Arg("modulo", "must be > 0, hashed ids will be modulo this number")
+    .Arg(
+        "num_threads",
+        "Threads to hash large inputs with, 0 (default) for all the threads of "
+        "the workspace thread pool and 1 to run on the calling thread")
     .TensorInferenceFunction([](const OperatorDef& /* unused */,
                                 const vector<TensorShape>& in) {
       std::vector<TensorShape> out(1);
@@ -1,9 +1,9 @@
 #ifndef CAFFE2_OPERATORS_INDEX_HASH_OPS_H_
 #define CAFFE2_OPERATORS_INDEX_HASH_OPS_H_
 
-#include "caffe2/core/asan.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/index_hash.h"
 
 namespace caffe2 {
 
@@ -13,9 +13,12 @@ class IndexHashOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   IndexHashOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
         seed_(OperatorBase::GetSingleArgument<int64_t>("seed", 0)),
-        modulo_(OperatorBase::GetSingleArgument<int64_t>("modulo", 0)) {
+        modulo_(OperatorBase::GetSingleArgument<int64_t>("modulo", 0)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE_GT(modulo_, 0, "MODULO should be > 0");
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
 
   bool RunOnDevice() override {
@@ -38,33 +41,53 @@ class IndexHashOp : public Operator<Context> {
     auto* indices_data = indices.template data<T>();
     auto* hashed_indices_data = hashed_indices->template mutable_data<T>();
 
-    for (auto i = 0; i < N; i++) {
-      hashed_indices_data[i] = hash(indices_data[i]);
+    const int num_ranges = NumRanges(N);
+    if (num_ranges <= 1) {
+      hash(N, indices_data, hashed_indices_data);
+      return true;
     }
-
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+      const TIndex begin = range * N / num_ranges;
+      const TIndex end = (range + 1) * N / num_ranges;
+      hash(end - begin, indices_data + begin, hashed_indices_data + begin);
+    });
     return true;
   }
 
  protected:
-  template <typename T>
-  CAFFE2_NO_SANITIZE("signed-integer-overflow") T hash(T id) {
-    int8_t* bytes = (int8_t*)&id;
-    T hashed = seed_ * 0xDEADBEEF;
-    for (int i = 0; i < sizeof(T) / sizeof(int8_t); i++) {
-      hashed = hashed * 65537 + bytes[i];
+  void hash(const TIndex n, const int32_t* ids, int32_t* hashed) {
+    IndexHashInt32(n, ids, seed_, modulo_, hashed);
+  }
+
+  void hash(const TIndex n, const int64_t* ids, int64_t* hashed) {
+    IndexHashInt64(n, ids, seed_, modulo_, hashed);
+  }
+
+  // Number of ranges to split the ids in, 1 hashes them on the calling thread
+  int NumRanges(const TIndex n) {
+    // Below this many ids per range, waking up the threads costs more than
+    // it saves
+    constexpr TIndex kMinIdsPerRange = 1 << 16;
+    if (num_threads_ == 1 || n < 2 * kMinIdsPerRange) {
+      return 1;
     }
-    // We want the result of the modulo to be positive. This works under the
-    // assumption that modulo_ > 0 which is enforced in the constructor.
-    auto modHashed = hashed % modulo_;
-    return modHashed >= 0 ? modHashed : modHashed + modulo_;
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return static_cast<int>(std::min<TIndex>(threads, n / kMinIdsPerRange));
   }
 
  private:
   INPUT_TAGS(INDICES);
   OUTPUT_TAGS(HASHED_INDICES);
 
+  Workspace* ws_;
   int64_t seed_;
   int64_t modulo_;
+  // 0 uses all threads of the workspace thread pool for large inputs, 1
+  // hashes on the calling thread
+  int num_threads_;
 };
 
 } // namespace caffe2
@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <atomic>
+#include <functional>
 #include <limits>
 #include <mutex>
 #include <sstream>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/operator.h"
@@ -36,40 +38,68 @@ struct IndexBase {
   const TypeMeta& Type() const { return meta_; }
 
   TIndexValue Size() {
-    std::lock_guard<std::mutex> guard(dictMutex_);
     return nextId_;
   }
 
  protected:
   int64_t maxElements_;
   TypeMeta meta_;
-  TIndexValue nextId_{1}; // guarded by dictMutex_
+  std::atomic<TIndexValue> nextId_{1}; // written under dictMutex_
   std::atomic<bool> frozen_{false};
   std::mutex dictMutex_;
 };
 
+/**
+ * Open addressing hash table with linear probing, mapping keys to their index.
+ *
+ * Lookups take no lock: a slot is published by storing its id after its key,
+ * and is never changed afterwards, so readers only compare the key of the
+ * slots whose id they saw set. Inserts are serialized by dictMutex_, and only
+ * the keys missing from a batch take it. When the table is half full, it is
+ * copied into one twice as large; the previous tables are kept until the
+ * index is loaded or destroyed, since readers may still be probing them, which
+ * costs at most as much memory as the current table. A reader that missed a
+ * key inserted in a newer table finds it when it takes the lock to insert it.
+ *
+ * Once frozen, lookups neither insert nor synchronize with inserters.
+ */
 template<typename T>
 struct Index: IndexBase {
   explicit Index(TIndexValue maxElements)
-    : IndexBase(maxElements, TypeMeta::Make<T>()) {}
+    : IndexBase(maxElements, TypeMeta::Make<T>()) {
+    tables_.emplace_back(new Table(kMinCapacity));
+    table_ = tables_.back().get();
+  }
 
   void Get(const T* keys, TIndexValue* values, size_t numKeys) {
-    if (frozen_) {
-      FrozenGet(keys, values, numKeys);
+    const bool frozen = frozen_;
+    // Inserts happen before the index is frozen, so frozen lookups don't need
+    // to synchronize with them
+    const auto order =
+        frozen ? std::memory_order_relaxed : std::memory_order_acquire;
+    const auto* table = table_.load(std::memory_order_acquire);
+    std::vector<size_t> missing;
+    size_t hashes[kBatchSize];
+    for (size_t begin = 0; begin < numKeys; begin += kBatchSize) {
+      const auto end = std::min(numKeys, begin + kBatchSize);
+      // Hash the whole batch first, so that its slots are loaded in parallel
+      for (auto i = begin; i < end; ++i) {
+        hashes[i - begin] = Hash(keys[i]);
+        Prefetch(&table->slots[hashes[i - begin] & table->mask]);
+      }
+      for (auto i = begin; i < end; ++i) {
+        values[i] = Find(*table, keys[i], hashes[i - begin], order);
+        if (values[i] == 0 && !frozen) {
+          missing.push_back(i);
+        }
+      }
+    }
+    if (missing.empty()) {
       return;
     }
     std::lock_guard<std::mutex> lock(dictMutex_);
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      if (it != dict_.end()) {
-        values[i] = it->second;
-      } else if (nextId_ < maxElements_) {
-        auto newValue = nextId_++;
-        dict_.insert({keys[i], newValue});
-        values[i] = newValue;
-      } else {
-        CAFFE_THROW("Dict max size reached");
-      }
+    for (auto i : missing) {
+      values[i] = Insert(keys[i]);
     }
   }
 
@@ -77,17 +107,24 @@ struct Index: IndexBase {
     CAFFE_ENFORCE(
         numKeys <= maxElements_,
         "Cannot load index: Tensor is larger than max_elements.");
-    decltype(dict_) dict;
+    size_t capacity = kMinCapacity;
+    while (capacity < 2 * numKeys) {
+      capacity *= 2;
+    }
+    std::unique_ptr<Table> table(new Table(capacity));
     for (int i = 0; i < numKeys; ++i) {
       CAFFE_ENFORCE(
-          dict.insert({keys[i], i + 1}).second,
+          Place(table.get(), keys[i], i + 1),
           "Repeated elements found: cannot load into dictionary.");
     }
     // assume no `get` is inflight while this happens
+    decltype(tables_) tables;
     {
       std::lock_guard<std::mutex> lock(dictMutex_);
-      // let the old dict get destructed outside of the lock
-      dict_.swap(dict);
+      // let the old tables get destructed outside of the lock
+      tables_.swap(tables);
+      tables_.push_back(std::move(table));
+      table_.store(tables_.back().get(), std::memory_order_release);
       nextId_ = numKeys + 1;
     }
     return true;
@@ -98,21 +135,117 @@ struct Index: IndexBase {
     std::lock_guard<std::mutex> lock(dictMutex_);
     out->Resize(nextId_ - 1);
     auto outData = out->template mutable_data<T>();
-    for (const auto& entry : dict_) {
-      outData[entry.second - 1] = entry.first;
+    const auto& table = *tables_.back();
+    for (size_t i = 0; i <= table.mask; ++i) {
+      const auto id = table.slots[i].id.load(std::memory_order_relaxed);
+      if (id != 0) {
+        outData[id - 1] = table.slots[i].key;
+      }
     }
     return true;
   }
 
  private:
-  void FrozenGet(const T* keys, TIndexValue* values, size_t numKeys) {
-    for (int i = 0; i < numKeys; ++i) {
-      auto it = dict_.find(keys[i]);
-      values[i] = it != dict_.end() ? it->second : 0;
+  static constexpr size_t kMinCapacity = 16;
+  // Number of keys hashed and prefetched ahead of their lookup
+  static constexpr size_t kBatchSize = 16;
+
+  struct Slot {
+    // 0 while the slot is empty
+    std::atomic<TIndexValue> id{0};
+    T key;
+  };
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : mask(capacity - 1), slots(new Slot[capacity]) {}
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  static size_t Hash(const T& key) {
+    // std::hash is the identity for integers, which would put consecutive keys
+    // in consecutive slots, so mix its bits before they are masked
+    uint64_t hash = std::hash<T>()(key);
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+  }
+
+  static void Prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 1);
+#endif
+  }
+
+  static TIndexValue Find(
+      const Table& table,
+      const T& key,
+      size_t hash,
+      std::memory_order order) {
+    for (auto i = hash & table.mask;; i = (i + 1) & table.mask) {
+      const auto id = table.slots[i].id.load(order);
+      if (id == 0) {
+        return 0;
+      }
+      if (table.slots[i].key == key) {
+        return id;
+      }
+    }
+  }
+
+  // Places key with the given id unless it's in table already. Tables are
+  // never more than half full, so probing always finds an empty slot.
+  static bool Place(Table* table, const T& key, TIndexValue id) {
+    for (auto i = Hash(key) & table->mask;; i = (i + 1) & table->mask) {
+      auto& slot = table->slots[i];
+      if (slot.id.load(std::memory_order_relaxed) == 0) {
+        slot.key = key;
+        slot.id.store(id, std::memory_order_release);
+        return true;
+      }
+      if (slot.key == key) {
+        return false;
+      }
+    }
+  }
+
+  // Called with dictMutex_ held
+  TIndexValue Insert(const T& key) {
+    auto* table = tables_.back().get();
+    if (auto id = Find(*table, key, Hash(key), std::memory_order_relaxed)) {
+      return id;
+    }
+    if (nextId_ >= maxElements_) {
+      CAFFE_THROW("Dict max size reached");
+    }
+    const TIndexValue id = nextId_;
+    if (2 * static_cast<size_t>(id) > table->mask + 1) {
+      table = Grow(*table);
+    }
+    Place(table, key, id);
+    nextId_ = id + 1;
+    return id;
+  }
+
+  // Called with dictMutex_ held
+  Table* Grow(const Table& table) {
+    std::unique_ptr<Table> grown(new Table(2 * (table.mask + 1)));
+    for (size_t i = 0; i <= table.mask; ++i) {
+      const auto id = table.slots[i].id.load(std::memory_order_relaxed);
+      if (id != 0) {
+        Place(grown.get(), table.slots[i].key, id);
+      }
     }
+    tables_.push_back(std::move(grown));
+    table_.store(tables_.back().get(), std::memory_order_release);
+    return tables_.back().get();
   }
 
-  std::unordered_map<T, TIndexValue> dict_;
+  // Tables probed by lookups, the last one being current. Guarded by
+  // dictMutex_, while table_ points to the current one for lookups.
+  std::vector<std::unique_ptr<Table>> tables_;
+  std::atomic<Table*> table_{nullptr};
 };
 
 // TODO(azzolini): support sizes larger than int32
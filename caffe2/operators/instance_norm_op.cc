@@ -103,9 +103,25 @@ bool InstanceNormOp<T, Context>::RunOnDeviceWithOrderNCHW() {
 
 REGISTER_CPU_OPERATOR(InstanceNorm, InstanceNormOp<float, CPUContext>);
 
+namespace {
+OpSchema::Cost CostInferenceForInstanceNorm(
+    const OperatorDef& def,
+    const vector<TensorShape>& in) {
+  // Mean, variance, then a multiplication and an addition per element
+  struct OpSchema::Cost cost = PointwiseCostInference<5>(def, in);
+  // Y, and the mean and inverse standard deviation of every image channel
+  const uint64_t num_channels = in[0].dims(0) * nElemFromDim(in[1]);
+  cost.bytes_written = nBytesOfShape(in[0]) +
+      (def.output_size() - 1) * num_channels * sizeof(float);
+  cost.params_bytes = nBytesOfShape(in[1]) + nBytesOfShape(in[2]);
+  return cost;
+}
+} // namespace
+
 OPERATOR_SCHEMA(InstanceNorm)
     .NumInputs(3)
     .NumOutputs(1, 3)
+    .CostInferenceFunction(CostInferenceForInstanceNorm)
     .AllowInplace({{0,0}})
     .SetDoc(R"DOC(
 Carries out instance normalization as described in the paper
@@ -0,0 +1,203 @@
+#include <cstring>
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor_int8.h"
+#include "caffe2/operators/conv_pool_op_base.h"
+#include "caffe2/operators/int8_packed_weights.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The quantized version of the NHWC 2D convolution. The image is laid out
+// as columns of kernel_h x kernel_w x C bytes, in the order of the NHWC
+// filter, and the whole batch is multiplied with the packed filter in one
+// int8 GEMM. The padding is the zero point of X, the quantized value of 0.
+// Depthwise convolutions, with as many groups as channels, run their own
+// kernel over each image instead, as there is no reduction over channels.
+class Int8ConvOp final : public ConvPoolOpBase<CPUContext> {
+ public:
+  USE_CONV_POOL_BASE_FUNCTIONS(CPUContext);
+  Int8ConvOp(const OperatorDef& operator_def, Workspace* ws)
+      : ConvPoolOpBase<CPUContext>(operator_def, ws),
+        Y_scale_(OperatorBase::GetSingleArgument<float>("Y_scale", 0)),
+        Y_zero_point_(
+            OperatorBase::GetSingleArgument<int32_t>("Y_zero_point", 0)) {
+    CAFFE_ENFORCE_GT(Y_scale_, 0, "Int8Conv needs the Y_scale argument.");
+    CAFFE_ENFORCE(
+        order_ == StorageOrder::NHWC, "Int8Conv only supports NHWC order.");
+    CAFFE_ENFORCE_EQ(kernel_.size(), 2, "Int8Conv only supports 2D.");
+  }
+
+  bool RunOnDeviceWithOrderNHWC() override {
+    const auto& X = OperatorBase::Input<Int8TensorCPU>(INPUT);
+    const auto& W = OperatorBase::Input<Int8TensorCPU>(FILTER);
+    auto* Y = OperatorBase::Output<Int8TensorCPU>(0);
+    CAFFE_ENFORCE(X.t.IsType<uint8_t>(), "The input must be uint8.");
+    CAFFE_ENFORCE_EQ(X.scales.size(), 1);
+    CAFFE_ENFORCE_EQ(X.t.ndim(), 4);
+    CAFFE_ENFORCE_EQ(W.t.ndim(), 4);
+    const int N = X.t.dim32(0);
+    const int H = X.t.dim32(1);
+    const int W_in = X.t.dim32(2);
+    const int C = X.t.dim32(3);
+    const int M = W.t.dim32(0);
+    CAFFE_ENFORCE_EQ(W.t.dim32(1), kernel_h());
+    CAFFE_ENFORCE_EQ(W.t.dim32(2), kernel_w());
+    CAFFE_ENFORCE_EQ(C % group_, 0);
+    CAFFE_ENFORCE_EQ(W.t.dim32(3), C / group_);
+    ConvPoolOpBase<CPUContext>::SetOutputSize(X.t, &Y->t, M);
+    Y->scales.assign(1, Y_scale_);
+    Y->zero_point = Y_zero_point_;
+    uint8_t* Ydata = Y->t.mutable_data<uint8_t>();
+    const int out_h = Y->t.dim32(1);
+    const int out_w = Y->t.dim32(2);
+    const TIndex K = kernel_h() * kernel_w() * C;
+    const TIndex rows = static_cast<TIndex>(N) * out_h * out_w;
+
+    const float* bias = nullptr;
+    if (InputSize() == 3) {
+      const auto& b = Input(BIAS);
+      CAFFE_ENFORCE_EQ(b.size(), M);
+      bias = b.data<float>();
+    } else {
+      zero_bias_.assign(M, 0);
+      bias = zero_bias_.data();
+    }
+
+    if (group_ > 1) {
+      CAFFE_ENFORCE(
+          group_ == C && M == C && kernel_h() == kernel_w() &&
+              stride_h() == stride_w() && dilation_h() == 1 &&
+              dilation_w() == 1,
+          "Int8Conv only supports groups for depthwise convolutions with ",
+          "square kernels, equal strides and no dilation.");
+      weights_.PackDepthwise(W, C, kernel_h() * kernel_w());
+      const TIndex image_size = static_cast<TIndex>(H) * W_in * C;
+      const TIndex out_image_size = static_cast<TIndex>(out_h) * out_w * C;
+      for (int n = 0; n < N; ++n) {
+        weights_.DepthwiseConv(
+            kernel_h(),
+            stride_h(),
+            H,
+            W_in,
+            C,
+            out_h,
+            out_w,
+            pad_t(),
+            pad_l(),
+            X,
+            X.t.data<uint8_t>() + n * image_size,
+            W,
+            bias,
+            Y_scale_,
+            Y_zero_point_,
+            Ydata + n * out_image_size);
+      }
+      return true;
+    }
+
+    // The input of a 1x1 convolution already is its column buffer
+    const uint8_t* col = X.t.data<uint8_t>();
+    if (!Is1x1Conv()) {
+      col_buffer_.Resize(rows, K);
+      Im2col(
+          X,
+          N,
+          H,
+          W_in,
+          C,
+          out_h,
+          out_w,
+          col_buffer_.mutable_data<uint8_t>());
+      col = col_buffer_.data<uint8_t>();
+    }
+
+    weights_.Pack(W, M, K);
+    weights_.Gemm(
+        rows,
+        M,
+        K,
+        X,
+        col,
+        W,
+        bias,
+        Y_scale_,
+        Y_zero_point_,
+        Ydata);
+    return true;
+  }
+
+ private:
+  void Im2col(
+      const Int8TensorCPU& X,
+      const int N,
+      const int H,
+      const int W,
+      const int C,
+      const int out_h,
+      const int out_w,
+      uint8_t* col) {
+    const uint8_t* Xdata = X.t.data<uint8_t>();
+    const uint8_t pad_value = static_cast<uint8_t>(X.zero_point);
+    for (int n = 0; n < N; ++n) {
+      const uint8_t* image = Xdata + static_cast<TIndex>(n) * H * W * C;
+      for (int oh = 0; oh < out_h; ++oh) {
+        for (int ow = 0; ow < out_w; ++ow) {
+          for (int kh = 0; kh < kernel_h(); ++kh) {
+            const int ih = oh * stride_h() - pad_t() + kh * dilation_h();
+            for (int kw = 0; kw < kernel_w(); ++kw) {
+              const int iw = ow * stride_w() - pad_l() + kw * dilation_w();
+              if (ih >= 0 && ih < H && iw >= 0 && iw < W) {
+                memcpy(col, image + (ih * W + iw) * C, C);
+              } else {
+                memset(col, pad_value, C);
+              }
+              col += C;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  const float Y_scale_;
+  const int32_t Y_zero_point_;
+  TensorCPU col_buffer_;
+  std::vector<float> zero_bias_;
+  Int8PackedWeights weights_;
+
+  INPUT_TAGS(INPUT, FILTER, BIAS);
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(Int8Conv, Int8ConvOp);
+OPERATOR_SCHEMA(Int8Conv)
+    .NumInputs(2, 3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+The quantized version of the NHWC 2D Conv: X is a uint8 Int8TensorCPU from
+Int8Quantize, filter the M x kernel_h x kernel_w x C int8 weights from
+Int8Quantize with signed=1 and optionally per_channel=1, and bias the
+optional float bias. Groups are only supported for depthwise convolutions,
+where group = C = M and the filter is C x kernel x kernel x 1, with square
+kernels and no dilation. The products are accumulated in int32 and
+requantized to the uint8 output with the Y_scale and Y_zero_point arguments,
+as chosen by Int8Quantize from the range recorded by Int8RecordRange on the
+float output of Conv.
+
+The filter is packed once and packed again only when it changes. The
+kernels use NEON on ARM, and the ARMv8.2 dot products when the CPU has them.
+)DOC")
+    .Arg("Y_scale", "Scale of the output")
+    .Arg("Y_zero_point", "Zero point of the output")
+    .Input(0, "X", "uint8 Int8TensorCPU of the NHWC images")
+    .Input(1, "filter", "int8 Int8TensorCPU of the filter")
+    .Input(2, "bias", "Optional float bias of size M")
+    .Output(0, "Y", "uint8 Int8TensorCPU");
+NO_GRADIENT(Int8Conv);
+
+} // namespace caffe2
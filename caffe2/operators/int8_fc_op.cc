@@ -0,0 +1,100 @@
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor_int8.h"
+#include "caffe2/operators/int8_packed_weights.h"
+
+namespace caffe2 {
+
+namespace {
+
+class Int8FCOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8FCOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        axis_(OperatorBase::GetSingleArgument<int32_t>("axis", 1)),
+        axis_w_(OperatorBase::GetSingleArgument<int32_t>("axis_w", 1)),
+        Y_scale_(OperatorBase::GetSingleArgument<float>("Y_scale", 0)),
+        Y_zero_point_(
+            OperatorBase::GetSingleArgument<int32_t>("Y_zero_point", 0)) {
+    CAFFE_ENFORCE_GT(Y_scale_, 0, "Int8FC needs the Y_scale argument.");
+  }
+
+  bool RunOnDevice() override {
+    const auto& X = OperatorBase::Input<Int8TensorCPU>(0);
+    const auto& W = OperatorBase::Input<Int8TensorCPU>(1);
+    const auto& b = Input(2);
+    auto* Y = OperatorBase::Output<Int8TensorCPU>(0);
+    CAFFE_ENFORCE(X.t.IsType<uint8_t>(), "The input must be uint8.");
+    CAFFE_ENFORCE_EQ(X.scales.size(), 1);
+    CAFFE_ENFORCE(b.ndim() == 1, b.ndim());
+    const auto canonical_axis = X.t.canonical_axis_index(axis_);
+    const auto M = X.t.size_to_dim(canonical_axis);
+    const auto K = X.t.size_from_dim(canonical_axis);
+    const auto canonical_axis_w = W.t.canonical_axis_index(axis_w_);
+    const auto N = W.t.size_to_dim(canonical_axis_w);
+    CAFFE_ENFORCE_EQ(K, W.t.size() / N, "Dimension mismatch of X and W");
+    CAFFE_ENFORCE_EQ(N, b.size(), "Dimension mismatch of W and b");
+
+    Y_shape_cache_ = X.t.dims();
+    Y_shape_cache_.resize(canonical_axis + 1);
+    Y_shape_cache_[canonical_axis] = N;
+    Y->t.Resize(Y_shape_cache_);
+    Y->scales.assign(1, Y_scale_);
+    Y->zero_point = Y_zero_point_;
+    uint8_t* Ydata = Y->t.mutable_data<uint8_t>();
+    if (X.t.size() == 0) {
+      return true;
+    }
+
+    weights_.Pack(W, N, K);
+    weights_.Gemm(
+        M,
+        N,
+        K,
+        X,
+        X.t.data<uint8_t>(),
+        W,
+        b.data<float>(),
+        Y_scale_,
+        Y_zero_point_,
+        Ydata);
+    return true;
+  }
+
+ private:
+  size_t axis_{1};
+  size_t axis_w_{1};
+  const float Y_scale_;
+  const int32_t Y_zero_point_;
+  vector<TIndex> Y_shape_cache_;
+  Int8PackedWeights weights_;
+};
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(Int8FC, Int8FCOp);
+OPERATOR_SCHEMA(Int8FC)
+    .NumInputs(3)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+The quantized version of FC: Y = X * W^T + b, with X a uint8 Int8TensorCPU
+from Int8Quantize, W the int8 weights from Int8Quantize with signed=1 and
+optionally per_channel=1, and b the float bias. The products are accumulated
+in int32 and requantized to the uint8 output with the Y_scale and
+Y_zero_point arguments, as chosen by Int8Quantize from the range recorded by
+Int8RecordRange on the float output of FC.
+
+The weights are packed once and packed again only when they change.
+)DOC")
+    .Arg("Y_scale", "Scale of the output")
+    .Arg("Y_zero_point", "Zero point of the output")
+    .Arg("axis", "See FC")
+    .Arg("axis_w", "See FC")
+    .Input(0, "X", "uint8 Int8TensorCPU")
+    .Input(1, "W", "int8 Int8TensorCPU of the weights, N x K")
+    .Input(2, "b", "Float bias of size N")
+    .Output(0, "Y", "uint8 Int8TensorCPU");
+NO_GRADIENT(Int8FC);
+
+} // namespace caffe2
@@ -0,0 +1,181 @@
+#ifndef CAFFE2_OPERATORS_INT8_PACKED_WEIGHTS_H_
+#define CAFFE2_OPERATORS_INT8_PACKED_WEIGHTS_H_
+
+#include <vector>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/tensor_int8.h"
+#include "caffe2/perfkernels/int8_depthwise_conv.h"
+#include "caffe2/perfkernels/int8_gemm.h"
+
+namespace caffe2 {
+
+/**
+ * The int8 weights of Int8FC and Int8Conv packed by PackInt8Matrix, or
+ * transposed for the depthwise Int8Conv, with the requantization parameters
+ * of the outputs.
+ *
+ * The weights are packed again only when the weight tensor changes, as told
+ * by its address, data, shape and version(), like the packed weights of the
+ * FC PACKED engine. The scales and biases are cheap and computed on every
+ * run, since they depend on the scale of the input.
+ */
+class Int8PackedWeights {
+ public:
+  // Packs W, an N x K int8 tensor, unless it is already packed
+  void Pack(const Int8TensorCPU& W, const TIndex N, const TIndex K) {
+    CheckWeights(W, N);
+    if (IsPacked(W)) {
+      return;
+    }
+    packed_.Resize(Int8PackedMatrixSize(N, K));
+    row_sums_.Resize(N);
+    PackInt8Matrix(
+        N,
+        K,
+        W.t.data<int8_t>(),
+        packed_.mutable_data<int8_t>(),
+        row_sums_.mutable_data<int32_t>());
+    SetPacked(W);
+  }
+
+  // Packs W, the C x taps x 1 int8 filter of a depthwise convolution, as the
+  // taps x C filter of Int8DepthwiseConv2DNHWC, unless it is already packed
+  void
+  PackDepthwise(const Int8TensorCPU& W, const TIndex C, const TIndex taps) {
+    CheckWeights(W, C);
+    if (IsPacked(W)) {
+      return;
+    }
+    packed_.Resize(taps, C);
+    const int8_t* Wdata = W.t.data<int8_t>();
+    int8_t* packed = packed_.mutable_data<int8_t>();
+    for (TIndex c = 0; c < C; ++c) {
+      for (TIndex t = 0; t < taps; ++t) {
+        packed[t * C + c] = Wdata[c * taps + t];
+      }
+    }
+    SetPacked(W);
+  }
+
+  // Computes Y = X * W' + b, requantized to the scale and zero point of Y.
+  // X is M x K uint8 with the quantization parameters of X_params, and b
+  // holds the N float biases.
+  void Gemm(
+      const TIndex M,
+      const TIndex N,
+      const TIndex K,
+      const Int8TensorCPU& X_params,
+      const uint8_t* X,
+      const Int8TensorCPU& W,
+      const float* b,
+      const float Y_scale,
+      const int32_t Y_zero_point,
+      uint8_t* Y) {
+    SetRequantization(N, X_params, W, b, Y_scale);
+    Int8PackedGemm(
+        M,
+        N,
+        K,
+        X,
+        X_params.zero_point,
+        packed_.data<int8_t>(),
+        row_sums_.data<int32_t>(),
+        scale_.data(),
+        bias_.data(),
+        Y_zero_point,
+        Y);
+  }
+
+  // Computes the depthwise convolution of one NHWC image X, of C channels,
+  // with the filter packed by PackDepthwise, requantized like Gemm.
+  void DepthwiseConv(
+      const int kernel,
+      const int stride,
+      const int H,
+      const int W_in,
+      const int C,
+      const int out_h,
+      const int out_w,
+      const int pad_t,
+      const int pad_l,
+      const Int8TensorCPU& X_params,
+      const uint8_t* X,
+      const Int8TensorCPU& W,
+      const float* b,
+      const float Y_scale,
+      const int32_t Y_zero_point,
+      uint8_t* Y) {
+    SetRequantization(C, X_params, W, b, Y_scale);
+    Int8DepthwiseConv2DNHWC(
+        kernel,
+        stride,
+        H,
+        W_in,
+        C,
+        out_h,
+        out_w,
+        pad_t,
+        pad_l,
+        X,
+        X_params.zero_point,
+        packed_.data<int8_t>(),
+        scale_.data(),
+        bias_.data(),
+        Y_zero_point,
+        Y);
+  }
+
+ private:
+  void CheckWeights(const Int8TensorCPU& W, const TIndex N) {
+    CAFFE_ENFORCE(W.t.IsType<int8_t>(), "The weights must be int8.");
+    CAFFE_ENFORCE_EQ(W.zero_point, 0, "The weights must be symmetric.");
+    CAFFE_ENFORCE(
+        W.scales.size() == 1 || W.scales.size() == N,
+        "One weight scale, or one per output channel");
+  }
+
+  bool IsPacked(const Int8TensorCPU& W) const {
+    return &W.t == weight_ && W.t.version() == weight_version_ &&
+        W.t.raw_data() == weight_data_ && W.t.dims() == weight_dims_;
+  }
+
+  void SetPacked(const Int8TensorCPU& W) {
+    weight_ = &W.t;
+    weight_version_ = W.t.version();
+    weight_data_ = W.t.raw_data();
+    weight_dims_ = W.t.dims();
+  }
+
+  void SetRequantization(
+      const TIndex N,
+      const Int8TensorCPU& X_params,
+      const Int8TensorCPU& W,
+      const float* b,
+      const float Y_scale) {
+    // acc * x_scale * w_scale(n) is the real value of the product, which
+    // divided by Y_scale is in the units of Y
+    scale_.resize(N);
+    bias_.resize(N);
+    const float x_scale = X_params.scale(0);
+    for (TIndex n = 0; n < N; ++n) {
+      scale_[n] = x_scale * W.scale(n) / Y_scale;
+      bias_[n] = b[n] / Y_scale;
+    }
+  }
+
+  TensorCPU packed_;
+  TensorCPU row_sums_;
+  std::vector<float> scale_;
+  std::vector<float> bias_;
+  // The weight tensor packed_ was computed from
+  const TensorCPU* weight_ = nullptr;
+  uint64_t weight_version_ = 0;
+  const void* weight_data_ = nullptr;
+  std::vector<TIndex> weight_dims_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_INT8_PACKED_WEIGHTS_H_
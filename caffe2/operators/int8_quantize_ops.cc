@@ -0,0 +1,181 @@
+#include "caffe2/operators/int8_quantize_ops.h"
+
+namespace caffe2 {
+
+bool Int8QuantizeOp::RunOnDevice() {
+  const auto& X = Input(DATA);
+  auto* Y = OperatorBase::Output<Int8TensorCPU>(0);
+  Y->t.Resize(X.dims());
+  const float* Xdata = X.data<float>();
+
+  if (signed_) {
+    // Symmetric quantization to [-127, 127], leaving out -128 so that
+    // negating a weight stays exact
+    const TIndex channels = per_channel_ ? X.dim(0) : 1;
+    const TIndex channel_size = channels ? X.size() / channels : 0;
+    int8_t* Ydata = Y->t.mutable_data<int8_t>();
+    Y->scales.resize(std::max<TIndex>(channels, 1));
+    Y->zero_point = 0;
+    for (TIndex c = 0; c < channels; ++c) {
+      const float* x = Xdata + c * channel_size;
+      float scale = Y_scale_;
+      if (scale == 0) {
+        float max_abs = 0;
+        for (TIndex i = 0; i < channel_size; ++i) {
+          max_abs = std::max(max_abs, std::abs(x[i]));
+        }
+        scale = max_abs > 0 ? max_abs / 127 : 1;
+      }
+      Y->scales[c] = scale;
+      const float inv_scale = 1 / scale;
+      int8_t* y = Ydata + c * channel_size;
+      for (TIndex i = 0; i < channel_size; ++i) {
+        y[i] = static_cast<int8_t>(std::min(
+            127.0f, std::max(-127.0f, std::nearbyint(x[i] * inv_scale))));
+      }
+    }
+    return true;
+  }
+
+  float scale = Y_scale_;
+  int32_t zero_point = Y_zero_point_;
+  if (scale == 0) {
+    float min = 0;
+    float max = 0;
+    if (InputSize() > RANGE) {
+      const auto& range = Input(RANGE);
+      CAFFE_ENFORCE_EQ(range.size(), 2, "The range is a min and a max.");
+      min = range.data<float>()[0];
+      max = range.data<float>()[1];
+    } else if (X.size() > 0) {
+      const auto minmax = std::minmax_element(Xdata, Xdata + X.size());
+      min = *minmax.first;
+      max = *minmax.second;
+    }
+    ChooseUint8QuantizationParams(min, max, &scale, &zero_point);
+  }
+  Y->scales.assign(1, scale);
+  Y->zero_point = zero_point;
+  const float inv_scale = 1 / scale;
+  uint8_t* Ydata = Y->t.mutable_data<uint8_t>();
+  for (TIndex i = 0; i < X.size(); ++i) {
+    Ydata[i] = static_cast<uint8_t>(std::min(
+        255.0f,
+        std::max(0.0f, std::nearbyint(Xdata[i] * inv_scale) + zero_point)));
+  }
+  return true;
+}
+
+namespace {
+
+template <typename T>
+void Dequantize(
+    const Int8TensorCPU& X,
+    const TIndex channels,
+    const TIndex channel_size,
+    const T* Xdata,
+    float* Ydata) {
+  for (TIndex c = 0; c < channels; ++c) {
+    const float scale = X.scales[c];
+    for (TIndex i = c * channel_size; i < (c + 1) * channel_size; ++i) {
+      Ydata[i] = scale * (static_cast<int32_t>(Xdata[i]) - X.zero_point);
+    }
+  }
+}
+
+} // namespace
+
+bool Int8DequantizeOp::RunOnDevice() {
+  const auto& X = OperatorBase::Input<Int8TensorCPU>(0);
+  auto* Y = Output(0);
+  Y->Resize(X.t.dims());
+  float* Ydata = Y->mutable_data<float>();
+  const TIndex channels = X.scales.size() == 1 ? 1 : X.t.dim(0);
+  CAFFE_ENFORCE_EQ(X.scales.size(), channels);
+  const TIndex channel_size = channels ? X.t.size() / channels : 0;
+  if (X.t.IsType<uint8_t>()) {
+    Dequantize(X, channels, channel_size, X.t.data<uint8_t>(), Ydata);
+  } else {
+    Dequantize(X, channels, channel_size, X.t.data<int8_t>(), Ydata);
+  }
+  return true;
+}
+
+bool Int8RecordRangeOp::RunOnDevice() {
+  const auto& X = Input(0);
+  auto* range = Output(0);
+  const float* Xdata = X.data<float>();
+  float min = 0;
+  float max = 0;
+  if (range->size() == 2) {
+    min = range->data<float>()[0];
+    max = range->data<float>()[1];
+  } else if (X.size() > 0) {
+    min = max = Xdata[0];
+  }
+  if (X.size() > 0) {
+    const auto minmax = std::minmax_element(Xdata, Xdata + X.size());
+    min = std::min(min, *minmax.first);
+    max = std::max(max, *minmax.second);
+  }
+  range->Resize(2);
+  float* range_data = range->mutable_data<float>();
+  range_data[0] = min;
+  range_data[1] = max;
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(Int8Quantize, Int8QuantizeOp);
+OPERATOR_SCHEMA(Int8Quantize)
+    .NumInputs(1, 2)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Quantizes a float tensor to an 8-bit Int8TensorCPU, the input of Int8FC and
+Int8Conv.
+
+By default the output is uint8 activations, x = Y_scale * (q - Y_zero_point).
+Without the Y_scale argument, the scale and zero point come from the range
+input, as recorded by Int8RecordRange over calibration batches, or else from
+the range of the data itself.
+
+With signed=1 the output is int8 weights in [-127, 127] with a zero point of
+0, and a scale from the largest absolute value, per slice along the first
+dimension with per_channel=1.
+)DOC")
+    .Arg("Y_scale", "Scale of the output, 0 (default) to choose it")
+    .Arg("Y_zero_point", "Zero point of the output, used with Y_scale")
+    .Arg("signed", "Quantize to symmetric int8 instead of uint8")
+    .Arg(
+        "per_channel",
+        "With signed, one scale per slice along the first dimension")
+    .Input(0, "X", "Float tensor")
+    .Input(1, "range", "Optional min and max of the data")
+    .Output(0, "Y", "Int8TensorCPU");
+NO_GRADIENT(Int8Quantize);
+
+REGISTER_CPU_OPERATOR(Int8Dequantize, Int8DequantizeOp);
+OPERATOR_SCHEMA(Int8Dequantize)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Converts an Int8TensorCPU back to a float tensor.
+)DOC")
+    .Input(0, "X", "Int8TensorCPU")
+    .Output(0, "Y", "Float tensor");
+NO_GRADIENT(Int8Dequantize);
+
+REGISTER_CPU_OPERATOR(Int8RecordRange, Int8RecordRangeOp);
+OPERATOR_SCHEMA(Int8RecordRange)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Records the range of a float tensor for the calibration of Int8Quantize: the
+output is the min and max of the data over all the runs of the operator, as
+long as the output blob is kept. Running it after each activation of a net
+over a few sample batches gives the ranges of the activations.
+)DOC")
+    .Input(0, "X", "Float tensor")
+    .Output(0, "range", "Min and max of X over the runs");
+NO_GRADIENT(Int8RecordRange);
+
+} // namespace caffe2
@@ -0,0 +1,84 @@
+#ifndef CAFFE2_OPERATORS_INT8_QUANTIZE_OPS_H_
+#define CAFFE2_OPERATORS_INT8_QUANTIZE_OPS_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor_int8.h"
+
+namespace caffe2 {
+
+/**
+ * Scale and zero point of the uint8 quantization of the real range [min,
+ * max], which is first extended to contain 0 so that 0 is exact.
+ */
+inline void ChooseUint8QuantizationParams(
+    float min,
+    float max,
+    float* scale,
+    int32_t* zero_point) {
+  min = std::min(min, 0.0f);
+  max = std::max(max, 0.0f);
+  *scale = (max - min) / 255;
+  if (*scale == 0) {
+    *scale = 1;
+  }
+  *zero_point = std::min(
+      255, std::max(0, static_cast<int32_t>(std::nearbyint(-min / *scale))));
+}
+
+class Int8QuantizeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8QuantizeOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        Y_scale_(OperatorBase::GetSingleArgument<float>("Y_scale", 0)),
+        Y_zero_point_(
+            OperatorBase::GetSingleArgument<int32_t>("Y_zero_point", 0)),
+        signed_(OperatorBase::GetSingleArgument<bool>("signed", false)),
+        per_channel_(
+            OperatorBase::GetSingleArgument<bool>("per_channel", false)) {
+    CAFFE_ENFORCE_GE(Y_scale_, 0);
+    CAFFE_ENFORCE(
+        signed_ || !per_channel_,
+        "Per channel scales are only supported for signed quantization.");
+    CAFFE_ENFORCE(
+        !signed_ || Y_zero_point_ == 0,
+        "Signed quantization is symmetric, with a zero point of 0.");
+  }
+
+  bool RunOnDevice() override;
+
+ private:
+  // 0 when the scale comes from the range of the data
+  const float Y_scale_;
+  const int32_t Y_zero_point_;
+  const bool signed_;
+  const bool per_channel_;
+
+  INPUT_TAGS(DATA, RANGE);
+};
+
+class Int8DequantizeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8DequantizeOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override;
+};
+
+class Int8RecordRangeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  Int8RecordRangeOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws) {}
+
+  bool RunOnDevice() override;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_INT8_QUANTIZE_OPS_H_
@@ -1,6 +1,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "caffe2/core/numa.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 
@@ -14,24 +15,55 @@ class LastNWindowCollectorOp : public Operator<Context> {
   LastNWindowCollectorOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         numToCollect_(
-            OperatorBase::GetSingleArgument<int>("num_to_collect", -1)) {
+            OperatorBase::GetSingleArgument<int>("num_to_collect", -1)),
+        concurrentCopies_(OperatorBase::GetSingleArgument<bool>(
+            "concurrent_copies",
+            false)),
+        numaNodeId_(OperatorBase::GetSingleArgument<int>("numa_node_id", -1)) {
     CAFFE_ENFORCE_GT(numToCollect_, 0);
+    CAFFE_ENFORCE(
+        !concurrentCopies_ || InputSize() > MUTEX,
+        "concurrent_copies needs a MUTEX");
   }
 
   bool RunOnDevice() override {
     if (InputSize() > MUTEX) {
       auto& mutex = OperatorBase::Input<std::unique_ptr<std::mutex>>(MUTEX);
-      std::lock_guard<std::mutex> guard(*mutex);
-      return collect();
+      std::unique_lock<std::mutex> guard(*mutex);
+      reserveSlots();
+      if (concurrentCopies_) {
+        // The slots are reserved, other writers may reserve theirs while
+        // the rows get copied
+        guard.unlock();
+      }
+      copyRows();
     } else {
-      return collect();
+      reserveSlots();
+      copyRows();
     }
+    return true;
   }
 
  private:
-  const int32_t numToCollect_;
+  // rows [src, src + size) of DATA go to rows [dst, dst + size) of the buffer
+  struct Chunk {
+    TIndex src;
+    TIndex dst;
+    TIndex size;
+  };
 
-  bool collect() {
+  const int32_t numToCollect_;
+  // Whether the rows are copied after releasing the mutex
+  const bool concurrentCopies_;
+  const int numaNodeId_;
+  const void* numaPlacedData_ = nullptr;
+  char* outputData_ = nullptr;
+  std::vector<Chunk> chunks_;
+
+  // Updates the cursor and the size of the buffer for the rows of DATA, and
+  // plans the copies of the rows into chunks_, without copying them.
+  void reserveSlots() {
+    chunks_.clear();
     auto* output = Output(LAST_N);
     const auto& input = Input(DATA);
 
@@ -62,13 +94,21 @@ class LastNWindowCollectorOp : public Operator<Context> {
 
     dims[0] = numToCollect_;
     output->Reserve(dims, &context_);
+    if (numaNodeId_ >= 0 && output->size() > 0 &&
+        output->raw_data() != numaPlacedData_) {
+      NUMAMove(
+          output->raw_mutable_data(output->meta()),
+          output->capacity_nbytes(),
+          numaNodeId_);
+      numaPlacedData_ = output->raw_data();
+    }
 
     if (num_entries == 0) {
       if (!output_initialized) {
         // Get both shape and meta
         output->CopyFrom(input, &context_);
       }
-      return true;
+      return;
     }
 
     auto num_to_copy = std::min<int32_t>(num_entries, numToCollect_);
@@ -77,8 +117,7 @@ class LastNWindowCollectorOp : public Operator<Context> {
     if (output_batch_size < numToCollect_) {
       output->Resize(dims);
     }
-    auto* output_data =
-        static_cast<char*>(output->raw_mutable_data(input.meta()));
+    outputData_ = static_cast<char*>(output->raw_mutable_data(input.meta()));
 
     auto* next = Output(NEXT);
     CAFFE_ENFORCE_EQ(0, next->ndim());
@@ -88,38 +127,40 @@ class LastNWindowCollectorOp : public Operator<Context> {
     }
     CAFFE_ENFORCE_LT(*next_data, output->dim(0));
 
-    auto block_size = input.size_from_dim(1);
-    auto block_bytesize = block_size * input.itemsize();
-    const auto* input_data = static_cast<const char*>(input.raw_data());
-
     if (num_entries > numToCollect_) {
       // just copy the last N rows
-      context_.template CopyItems<Context, Context>(
-          input.meta(),
-          num_to_copy * block_size,
-          input_data + (num_entries - numToCollect_) * block_bytesize,
-          output_data);
+      chunks_.push_back({num_entries - numToCollect_, 0, num_to_copy});
       *next_data = 0;
-      return true;
+      return;
     }
     auto start = *next_data;
     auto first_chunk_size =
         std::min<size_t>(num_to_copy + start, numToCollect_) - start;
-    context_.template CopyItems<Context, Context>(
-        input.meta(),
-        first_chunk_size * block_size,
-        input_data,
-        output_data + start * block_bytesize);
-
-    context_.template CopyItems<Context, Context>(
-        input.meta(),
-        (num_to_copy - first_chunk_size) * block_size,
-        input_data + first_chunk_size * block_bytesize,
-        output_data);
+    chunks_.push_back({0, start, static_cast<TIndex>(first_chunk_size)});
+    if (num_to_copy > first_chunk_size) {
+      chunks_.push_back({static_cast<TIndex>(first_chunk_size),
+                         0,
+                         static_cast<TIndex>(num_to_copy - first_chunk_size)});
+    }
 
     *next_data = (start + num_to_copy) % numToCollect_;
+  }
 
-    return true;
+  void copyRows() {
+    if (chunks_.empty()) {
+      return;
+    }
+    const auto& input = Input(DATA);
+    auto block_size = input.size_from_dim(1);
+    auto block_bytesize = block_size * input.itemsize();
+    const auto* input_data = static_cast<const char*>(input.raw_data());
+    for (const auto& chunk : chunks_) {
+      context_.template CopyItems<Context, Context>(
+          input.meta(),
+          chunk.size * block_size,
+          input_data + chunk.src * block_bytesize,
+          outputData_ + chunk.dst * block_bytesize);
+    }
   }
 
   INPUT_TAGS(LAST_N_IN, NEXT_IN, DATA, MUTEX, NUM_VISITED_IN);
@@ -162,11 +203,23 @@ A possible output would be
 
   [[6, 7], [7, 8], [8, 9], [9, 10], [10, 11], [11, 12]]
 
-This is not thread safe unless a mutex is given.
+This is not thread safe unless a mutex is given. With `concurrent_copies`, the
+mutex is only held while moving the cursor, so that several writers copy their
+rows at the same time; readers of the buffer then have to wait for the writers
+on their own, and writers of more than N rows at once in total may leave rows
+of any of them.
 )DOC")
     .Arg(
         "num_to_collect",
         "The number of random samples to append for each positive samples")
+    .Arg(
+        "concurrent_copies",
+        "(bool, default false) Copy the rows after releasing the mutex, which "
+        "has to be given")
+    .Arg(
+        "numa_node_id",
+        "(int, default -1) NUMA node to place the memory of the buffer on "
+        "when it is allocated, -1 to leave it where it is allocated")
     .Input(
         0,
         "last-N buffer",
@@ -1,15 +1,53 @@
 #include "caffe2/operators/layer_norm_op.h"
 
+#include <cstring>
+#include <functional>
+
+#include "caffe2/perfkernels/layer_norm.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
 namespace caffe2 {
 
 namespace {
-template <typename T>
-using EigenMatrixMapRowMajor = Eigen::Map<
-    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
 
-template <typename T>
-using ConstEigenMatrixMapRowMajor = Eigen::Map<
-    const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+// Number of ranges to split N rows of D columns in, between the threads of
+// pool. 1 runs on the calling thread.
+int NumRanges(
+    ThreadPool* pool,
+    const int num_threads,
+    const int N,
+    const int D) {
+  // Below this many elements per range, waking up the threads costs more than
+  // it saves
+  constexpr int64_t kMinElementsPerRange = 1 << 15;
+  const int64_t size = static_cast<int64_t>(N) * D;
+  if (num_threads == 1 || N < 2 || size < 2 * kMinElementsPerRange) {
+    return 1;
+  }
+  const int pool_threads = pool->getNumThreads();
+  const int threads =
+      num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads);
+  return static_cast<int>(std::min<int64_t>(
+      std::min(threads, N), size / kMinElementsPerRange));
+}
+
+// Runs fn(range, begin, end) on num_ranges ranges splitting the N rows
+void ParallelRows(
+    ThreadPool* pool,
+    const int num_ranges,
+    const int N,
+    const std::function<void(int, int, int)>& fn) {
+  if (num_ranges <= 1) {
+    fn(0, 0, N);
+    return;
+  }
+  pool->runRanges(num_ranges, [&](size_t range) {
+    fn(range,
+       static_cast<int64_t>(range) * N / num_ranges,
+       static_cast<int64_t>(range + 1) * N / num_ranges);
+  });
+}
+
 } // namespace
 
 template <>
@@ -33,27 +71,37 @@ bool LayerNormOp<CPUContext>::DoRunWithType<float>() {
   mean->Resize(stats_dims);
   stdev->Resize(stats_dims);
 
-  auto input_map = ConstEigenMatrixMapRowMajor<float>(
-      input.template data<float>(), left, right);
-  auto mean_map = EigenMatrixMapRowMajor<float>(
-      mean->template mutable_data<float>(), left, 1);
-  auto stdev_map = EigenMatrixMapRowMajor<float>(
-      stdev->template mutable_data<float>(), left, 1);
-  auto output_map = EigenMatrixMapRowMajor<float>(
-      output->template mutable_data<float>(), left, right);
-
-  auto sqr = [](float f) { return f * f; };
-  auto add_ep = [this](float f) { return f + epsilon_; };
-  auto fsqrt = [](float f) { return std::sqrt(f); };
-  // Calculate row-wise statistics
-  mean_map = input_map.rowwise().mean();
-  stdev_map =
-      (input_map.unaryExpr(sqr).rowwise().mean() - mean_map.unaryExpr(sqr))
-          .unaryExpr(add_ep)
-          .unaryExpr(fsqrt);
-  output_map = (input_map - mean_map.replicate(1, right))
-                   .cwiseQuotient(stdev_map.replicate(1, right));
+  const float* gamma = nullptr;
+  const float* beta = nullptr;
+  if (InputSize() == 3) {
+    CAFFE_ENFORCE_EQ(Input(1).size(), right);
+    CAFFE_ENFORCE_EQ(Input(2).size(), right);
+    gamma = Input(1).data<float>();
+    beta = Input(2).data<float>();
+  }
 
+  const float* X = input.data<float>();
+  float* Y = output->mutable_data<float>();
+  float* mean_data = mean->mutable_data<float>();
+  float* stdev_data = stdev->mutable_data<float>();
+  auto* pool = ws_->GetThreadPool();
+  ParallelRows(
+      pool,
+      NumRanges(pool, num_threads_, left, right),
+      left,
+      [&](int /* unused */, int begin, int end) {
+        const size_t offset = static_cast<size_t>(begin) * right;
+        LayerNorm(
+            end - begin,
+            right,
+            X + offset,
+            gamma,
+            beta,
+            epsilon_,
+            Y + offset,
+            mean_data + begin,
+            stdev_data + begin);
+      });
   return true;
 }
 
@@ -63,7 +111,6 @@ template <>
 template <>
 bool LayerNormGradientOp<CPUContext>::DoRunWithType<float>() {
   const auto& dout = Input(0);
-  const auto& norm_outputs = Input(1);
   const auto& means = Input(2);
   const auto& stdev = Input(3);
   const auto& norm_inputs = Input(4);
@@ -75,63 +122,75 @@ bool LayerNormGradientOp<CPUContext>::DoRunWithType<float>() {
 
   ginput->ResizeLike(norm_inputs);
 
-  auto dout_map = ConstEigenMatrixMapRowMajor<float>(
-      dout.template data<float>(), left, right);
-  auto means_map =
-      ConstEigenMatrixMapRowMajor<float>(means.template data<float>(), left, 1);
-  auto stdev_map =
-      ConstEigenMatrixMapRowMajor<float>(stdev.template data<float>(), left, 1);
-  auto norm_inputs_map = ConstEigenMatrixMapRowMajor<float>(
-      norm_inputs.template data<float>(), left, right);
-  auto ginput_map = EigenMatrixMapRowMajor<float>(
-      ginput->template mutable_data<float>(), left, right);
-
-  // Helper functors
-  auto sqr = [](float f) { return f * f; };
-  auto recip = [](float f) { return 1.0f / f; };
-  auto neg_recip = [](float f) { return -1.0f / f; };
-
-  // Gradients - output block
-  // -1 / (stdev + epsilon)^2 * \sum_j^D x_ij - mean * dout
-  // First part: -1 / (stdev + epsilon)^2
-  auto dstdev_end_0 = stdev_map.unaryExpr(sqr).unaryExpr(neg_recip);
-  // Second part: \sum_j^D x_ij - mean * dout
-  auto dstdev_end_1 = (norm_inputs_map - means_map.replicate(1, right))
-                          .cwiseProduct(dout_map)
-                          .rowwise()
-                          .sum();
-  auto dstdev_end = dstdev_end_0.cwiseProduct(dstdev_end_1);
-  // \sum_j^D -dout * 1/(std+epsilon)
-  auto dmean_end = stdev_map.unaryExpr(neg_recip)
-                       .replicate(1, right)
-                       .cwiseProduct(dout_map)
-                       .rowwise()
-                       .sum();
-  // 1.0 / (stdev + epsilon) * dout
-  auto dx_end =
-      stdev_map.unaryExpr(recip).replicate(1, right).cwiseProduct(dout_map);
-
-  // Gradients - standard deviation block
-  // -1.0*(mean / stdev) * dstdev_end
-  auto dmean_stdev = stdev_map.unaryExpr(neg_recip)
-                         .cwiseProduct(means_map)
-                         .replicate(1, right)
-                         .cwiseProduct(dstdev_end);
-  // (mean / (D*stdev)) * dstdev
-  auto dx_stdev = (1.0f / right) *
-      norm_inputs_map.cwiseQuotient(stdev_map.replicate(1, right))
-          .cwiseProduct(dstdev_end.replicate(1, right));
-
-  // Gradients - mean block
-  auto dmean = dmean_end + dmean_stdev;
-  auto dx_mean = (1.0f / right) * dmean.replicate(1, right);
-
-  ginput_map = dx_end + dx_stdev + dx_mean;
+  const float* gamma = nullptr;
+  if (InputSize() == 6) {
+    CAFFE_ENFORCE_EQ(Input(5).size(), right);
+    gamma = Input(5).data<float>();
+  }
+
+  auto* pool = ws_->GetThreadPool();
+  const int num_ranges = NumRanges(pool, num_threads_, left, right);
+  // Every range accumulates the gradients of gamma and beta of its rows in
+  // its own slice, summed below
+  float* partials = nullptr;
+  if (OutputSize() == 3) {
+    affine_partials_.Resize(num_ranges, 2, right);
+    partials = affine_partials_.mutable_data<float>();
+    memset(partials, 0, affine_partials_.nbytes());
+  }
 
+  const float* dY = dout.data<float>();
+  const float* X = norm_inputs.data<float>();
+  const float* mean_data = means.data<float>();
+  const float* stdev_data = stdev.data<float>();
+  float* dX = ginput->mutable_data<float>();
+  ParallelRows(pool, num_ranges, left, [&](int range, int begin, int end) {
+    const size_t offset = static_cast<size_t>(begin) * right;
+    float* dgamma = partials ? partials + 2 * range * right : nullptr;
+    LayerNormGradient(
+        end - begin,
+        right,
+        dY + offset,
+        X + offset,
+        gamma,
+        mean_data + begin,
+        stdev_data + begin,
+        dX + offset,
+        dgamma,
+        partials ? dgamma + right : nullptr);
+  });
+
+  if (OutputSize() == 3) {
+    auto* dgamma = Output(1);
+    auto* dbeta = Output(2);
+    dgamma->ResizeLike(Input(5));
+    dbeta->ResizeLike(Input(5));
+    math::Set<float, CPUContext>(
+        right, 0.f, dgamma->mutable_data<float>(), &context_);
+    math::Set<float, CPUContext>(
+        right, 0.f, dbeta->mutable_data<float>(), &context_);
+    for (int range = 0; range < num_ranges; ++range) {
+      const float* partial = partials + 2 * range * right;
+      math::Add<float, CPUContext>(
+          right,
+          dgamma->data<float>(),
+          partial,
+          dgamma->mutable_data<float>(),
+          &context_);
+      math::Add<float, CPUContext>(
+          right,
+          dbeta->data<float>(),
+          partial + right,
+          dbeta->mutable_data<float>(),
+          &context_);
+    }
+  }
   return true;
 }
 
-OPERATOR_SCHEMA(LayerNormGradient).NumInputs(5).NumOutputs(1);
+// Input: dY, Y, mean, stdev, X and gamma if given. Output: dX, and the
+// gradients of gamma and beta if given.
+OPERATOR_SCHEMA(LayerNormGradient).NumInputs(5, 6).NumOutputs({1, 3});
 
 REGISTER_CPU_OPERATOR(LayerNormGradient, LayerNormGradientOp<CPUContext>);
 
@@ -140,21 +199,39 @@ namespace {
 class GetLayerNormGradient : public GradientMakerBase {
   using GradientMakerBase::GradientMakerBase;
   vector<OperatorDef> GetGradientDefs() override {
-    return SingleGradientDef(
-        "LayerNormGradient",
-        "",
-        vector<string>{GO(0), O(0), O(1), O(2), I(0)},
-        vector<string>{GI(0)});
+    vector<string> inputs{GO(0), O(0), O(1), O(2), I(0)};
+    vector<string> outputs{GI(0)};
+    if (def_.input_size() == 3) {
+      inputs.push_back(I(1));
+      outputs.push_back(GI(1));
+      outputs.push_back(GI(2));
+    }
+    return SingleGradientDef("LayerNormGradient", "", inputs, outputs);
   }
 };
 
+OpSchema::Cost CostInferenceForLayerNorm(
+    const OperatorDef& def,
+    const vector<TensorShape>& in) {
+  // Mean, variance, then a subtraction and a multiplication per element
+  struct OpSchema::Cost cost = PointwiseCostInference<5>(def, in);
+  ArgumentHelper helper(def);
+  const auto canonical_axis = canonical_axis_index_(
+      helper.GetSingleArgument<int32_t>("axis", 1), in[0].dims_size());
+  // Y, and the mean and standard deviation of every feature vector
+  cost.bytes_written = nBytesOfShape(in[0]) +
+      2 * nElemBetweenDim(in[0], 0, canonical_axis) * sizeof(float);
+  return cost;
+}
+
 }  // namespace
 
 REGISTER_GRADIENT(LayerNorm, GetLayerNormGradient);
 
 OPERATOR_SCHEMA(LayerNorm)
-    .NumInputs(1)
+    .NumInputs({1, 3})
     .NumOutputs(3)
+    .CostInferenceFunction(CostInferenceForLayerNorm)
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       vector<TensorShape> out(3);
@@ -182,11 +259,11 @@ this op treats dimensions a_k through a_{n-1} as feature vectors. For each
 feature vector, the op contains the mean and standard deviation. Then,
 it returns the normalized values (with respect to the feature vector).
 
-Note that this op does not contain the scale an bias terms described in the
-paper. Simply follow this op with an FC op to add those. Concretely, this op
-implements:
+The scale and bias terms described in the paper are applied when given as
+the gamma and beta inputs. Concretely, this op implements:
 
-h = \frac{1}{\sigma}(a - \mu)
+h = \gamma \frac{1}{\sigma}(a - \mu) + \beta
+with \gamma = 1 and \beta = 0 if not given,
 where \mu = \frac{1}{H}\sum_{i=1}^{H} a_i
 and \sigma = \sqrt{\frac{1}{H}\sum_{i=1}^{H}(a_i - \mu)^2}
 where H is the number of hidden units (i.e. product of dimensions from 'axis'
@@ -200,10 +277,24 @@ to the end.)
         "epsilon",
         "(float) default to 0.001. Small value to be added to the stdev when"
         " dividing out by that value. This prevents division by zero.")
+    .Arg(
+        "num_threads",
+        "(int) default to 0; number of threads of the workspace pool to split "
+        "the rows of large inputs between on CPU, 0 for all of them and 1 to "
+        "run on the calling thread")
     .Input(
         0,
         "input",
         "Input tensor which layer normalization will be applied to")
+    .Input(
+        1,
+        "gamma",
+        "Optional scale of every normalized value of a feature vector, of the "
+        "size of a feature vector, given with beta")
+    .Input(
+        2,
+        "beta",
+        "Optional bias added to every scaled value of a feature vector")
     .Output(0, "output", "Normalized values")
     .Output(1, "mean", "Mean values for each feature vector")
     .Output(2, "stddev", "Standard deviations for each feature vector");
@@ -13,8 +13,10 @@ class LayerNormOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   LayerNormOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
         axis_(OperatorBase::GetSingleArgument<int>("axis", 1)),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {}
   ~LayerNormOp() {}
 
   template <typename T>
@@ -25,11 +27,12 @@ class LayerNormOp : public Operator<Context> {
   }
 
  protected:
+  Workspace* ws_;
   int axis_;
   float epsilon_;
-
-  Tensor<Context> scratch_;
-  Tensor<Context> seg_indices_;
+  // 0 splits the rows of large inputs between all threads of the workspace
+  // thread pool on CPU, 1 runs on the calling thread
+  int num_threads_;
 };
 
 template <class Context>
@@ -38,8 +41,10 @@ class LayerNormGradientOp : public Operator<Context> {
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   LayerNormGradientOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
         axis_(OperatorBase::GetSingleArgument<int>("axis", 1)),
-        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 0.001f)) {}
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 0.001f)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {}
   ~LayerNormGradientOp() {}
 
   template <typename T>
@@ -50,14 +55,13 @@ class LayerNormGradientOp : public Operator<Context> {
   }
 
  protected:
+  Workspace* ws_;
   int axis_;
   float epsilon_;
+  int num_threads_;
 
-  Tensor<Context> scratch_;
-  Tensor<Context> gscratch_;
-  Tensor<Context> seg_indices_;
-  Tensor<Context> dstdev_;
-  Tensor<Context> dmean_;
+  // Gradients of gamma and beta accumulated by every range of rows
+  Tensor<Context> affine_partials_;
 };
 
 } // namespace caffe2
@@ -3,12 +3,40 @@
 
 namespace caffe2 {
 
+namespace {
+OpSchema::Cost CostInferenceForSparseLengthsFused8BitRowwise(
+    const OperatorDef& /* unused */,
+    const vector<TensorShape>& in,
+    bool with_weights) {
+  struct OpSchema::Cost c;
+  const TensorShape& data = in[0];
+  const TensorShape& indices = in[1];
+  const TensorShape& lengths = in[2];
+  // The rows hold the quantized values, then a float scale and bias
+  const uint64_t row_bytes = nElemFromDim(data, 1);
+  const uint64_t block_size =
+      row_bytes > 2 * sizeof(float) ? row_bytes - 2 * sizeof(float) : 0;
+  const uint64_t num_rows = nElemFromDim(indices);
+  // Dequantization and addition, and a multiplication by the weight, per
+  // element of the looked up rows
+  c.flops = num_rows * block_size * (with_weights ? 3 : 2);
+  c.bytes_read = num_rows * row_bytes + nBytesOfShape(indices) +
+      nBytesOfShape(lengths) + (with_weights ? nBytesOfShape(in[3]) : 0);
+  c.bytes_written = nElemFromDim(lengths) * block_size * sizeof(float);
+  return c;
+}
+} // namespace
+
+using namespace std::placeholders;
+
 REGISTER_CPU_OPERATOR(
     SparseLengthsSumFused8BitRowwise,
     SparseLengthsFused8BitRowwiseOp<CPUContext>);
 OPERATOR_SCHEMA(SparseLengthsSumFused8BitRowwise)
     .NumInputs(3)
     .NumOutputs(1)
+    .CostInferenceFunction(std::bind(
+        CostInferenceForSparseLengthsFused8BitRowwise, _1, _2, false))
     .SetDoc(R"DOC(
 Performs the same operation as SparseLengthsSum, but operating on
 8-bit rowwise quantized matrices with fused storage (where each row
@@ -37,6 +65,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(SparseLengthsWeightedSumFused8BitRowwise)
     .NumInputs(4)
     .NumOutputs(1)
+    .CostInferenceFunction(std::bind(
+        CostInferenceForSparseLengthsFused8BitRowwise, _1, _2, true))
     .SetDoc(R"DOC(
 Performs the same operation as SparseLengthsWeightedSum,
 but operating on 8-bit rowwise quantized matrices with fused storage
@@ -73,6 +103,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(SparseLengthsMeanFused8BitRowwise)
     .NumInputs(3)
     .NumOutputs(1)
+    .CostInferenceFunction(std::bind(
+        CostInferenceForSparseLengthsFused8BitRowwise, _1, _2, false))
     .SetDoc(R"DOC(
 Performs the same operation as SparseLengthsMean, but
 operating on 8-bit rowwise quantized matrices with fused storage
@@ -1,8 +1,21 @@
 #include "caffe2/operators/lengths_reducer_ops.h"
+#include "caffe2/operators/segment_reduction_op.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
 
+CAFFE2_DEFINE_int(
+    caffe2_sparse_lengths_num_threads,
+    1,
+    "Default number of threads of SparseLengths[Sum,WeightedSum,Mean] on CPU. "
+    "1 runs them on the calling thread, 0 uses every thread of the workspace "
+    "thread pool.");
+CAFFE2_DEFINE_int(
+    caffe2_sparse_lengths_min_indices_per_thread,
+    2048,
+    "Minimum number of looked up indices per thread in the intra-op parallel "
+    "mode of SparseLengths[Sum,WeightedSum,Mean].");
+
 namespace caffe2 {
 
 // Use _STR option because the schema is declared using _STR version too in
@@ -22,6 +35,10 @@ REGISTER_CPU_OPERATOR_STR(
 OPERATOR_SCHEMA(SparseLengthsPositionalWeightedSum)
     .NumInputs(4)
     .NumOutputs(1)
+    .CostInferenceFunction(
+        [](const OperatorDef& def, const vector<TensorShape>& inputs) {
+          return CostInferenceForSparseLengths(def, inputs, true);
+        })
     .SetDoc(R"DOC(
 Variation of SparseLengthsWeightedSum operator, where, for each row,
 weights are accessed by indices [0..L-1], where L is the length of given row.
@@ -53,4 +70,46 @@ REGISTER_CPU_OPERATOR_STR(
     "SparseLengthsPositionalWeightedSum",
     CPUSparseLengthsReductionOp<float, TensorTypes<float, float16>, 1, 0, 1>);
 
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumDedupGradient,
+    CPUSparseLengthsDedupGradientOp<false>);
+REGISTER_CPU_OPERATOR(
+    SparseLengthsMeanDedupGradient,
+    CPUSparseLengthsDedupGradientOp<true>);
+
+namespace {
+
+void PopulateSparseLengthsDedupGradientSchema(OpSchema& schema) {
+  schema.NumInputs(3)
+      .NumOutputs(2)
+      .SetDoc(R"DOC(
+Gradient of SparseLengths{Sum,Mean} with respect to DATA, holding every looked
+up index once with the gradient rows of its occurrences summed. It replaces
+the SparseLengths{Sum,Mean}Gradient of a forward op with dedup_gradient set,
+so that the optimizer and the sparse allreduce do not process the same rows
+several times. UNIQUE_INDICES are in the order of their first occurrence in
+INDICES.
+)DOC")
+      .Input(0, "SEGMENT_GRADS", "Gradient of the output of the forward op")
+      .Input(1, "LENGTHS", "LENGTHS of the forward op")
+      .Input(2, "INDICES", "INDICES of the forward op")
+      .Output(0, "UNIQUE_INDICES", "Every index of INDICES once")
+      .Output(
+          1,
+          "GRADS",
+          "Gradient rows of DATA, one per element of UNIQUE_INDICES")
+      .Arg(
+          "num_threads",
+          "Number of threads of the workspace thread pool summing the rows, "
+          "as for the forward op")
+      .Arg("min_indices_per_thread", "Minimum number of INDICES per thread");
+}
+
+} // namespace
+
+OPERATOR_SCHEMA(SparseLengthsSumDedupGradient)
+    .FillUsing(PopulateSparseLengthsDedupGradientSchema);
+OPERATOR_SCHEMA(SparseLengthsMeanDedupGradient)
+    .FillUsing(PopulateSparseLengthsDedupGradientSchema);
+
 } // namespace caffe2
@@ -1,10 +1,85 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "caffe2/core/context.h"
+#include "caffe2/core/flags.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
 #include "caffe2/perfkernels/embedding_lookup.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+CAFFE2_DECLARE_int(caffe2_sparse_lengths_num_threads);
+CAFFE2_DECLARE_int(caffe2_sparse_lengths_min_indices_per_thread);
 
 namespace caffe2 {
 
+/**
+ * Splits num_segments segments into at most num_ranges contiguous ranges of
+ * similar cost, where a segment costs its length plus one for writing its
+ * output row. Range i is [bounds[i], bounds[i + 1]) of the returned bounds.
+ *
+ * Bounds are moved forward by at most a cache line worth of rows so that
+ * every range starts its output (out + bound * block_size) on a cache line,
+ * which keeps threads from writing to the same lines.
+ */
+template <typename T>
+std::vector<TIndex> BalancedSegmentRanges(
+    const int* lengths,
+    TIndex num_segments,
+    int num_ranges,
+    const T* out,
+    TIndex block_size) {
+  std::vector<TIndex> cost(num_segments + 1, 0);
+  for (TIndex i = 0; i < num_segments; ++i) {
+    cost[i + 1] = cost[i] + lengths[i] + 1;
+  }
+  const TIndex total = cost[num_segments];
+  std::vector<TIndex> bounds{0};
+  for (int r = 1; r < num_ranges; ++r) {
+    TIndex bound =
+        std::lower_bound(cost.begin(), cost.end(), total * r / num_ranges) -
+        cost.begin();
+    for (TIndex b = bound; b < num_segments && b < bound + kCacheLineSize;
+         ++b) {
+      if (reinterpret_cast<uintptr_t>(out + b * block_size) %
+              kCacheLineSize ==
+          0) {
+        bound = b;
+        break;
+      }
+    }
+    if (bound > bounds.back() && bound < num_segments) {
+      bounds.push_back(bound);
+    }
+  }
+  bounds.push_back(num_segments);
+  return bounds;
+}
+
+// Number of ranges to split a lookup of indices_size indices in, 1 runs it on
+// the calling thread. num_threads 0 uses the whole workspace thread pool.
+inline int SparseLengthsNumRanges(
+    Workspace* ws,
+    int num_threads,
+    int min_indices_per_thread,
+    TIndex indices_size) {
+  if (num_threads == 1) {
+    return 1;
+  }
+  const TIndex max_ranges = indices_size / std::max(1, min_indices_per_thread);
+  if (max_ranges <= 1) {
+    return 1;
+  }
+  const int pool_threads = ws->GetThreadPool()->getNumThreads();
+  const int threads =
+      num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads);
+  return static_cast<int>(std::min<TIndex>(threads, max_ranges));
+}
+
 // A templated class that implements SparseLengths[Sum,WeightedSum,Mean].
 template <
     typename T, // output type
@@ -19,9 +94,17 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
  public:
   USE_OPERATOR_FUNCTIONS(CPUContext);
   CPUSparseLengthsReductionOp(const OperatorDef& operator_def, Workspace* ws)
-      : Operator<CPUContext>(operator_def, ws) {
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>(
+            "num_threads",
+            FLAGS_caffe2_sparse_lengths_num_threads)),
+        min_indices_per_thread_(OperatorBase::GetSingleArgument<int>(
+            "min_indices_per_thread",
+            FLAGS_caffe2_sparse_lengths_min_indices_per_thread)) {
     static_assert(
         !(USE_WEIGHT & USE_MEAN), "Cannot both specify weight and mean.");
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
 
   ~CPUSparseLengthsReductionOp() {}
@@ -76,23 +159,70 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
       in_weight = weightInput.template data<T>();
     }
 
-    // delegate work to perfkernel that branches based on architecture
-    EmbeddingLookup<IndexType, InputType, T, USE_POSITIONAL_WEIGHT>(
-        D,
-        M,
+    const int num_ranges = SparseLengthsNumRanges(
+        ws_, num_threads_, min_indices_per_thread_, indices_size);
+    if (num_ranges <= 1) {
+      // delegate work to perfkernel that branches based on architecture
+      EmbeddingLookup<IndexType, InputType, T, USE_POSITIONAL_WEIGHT>(
+          D,
+          M,
+          indices_size,
+          N,
+          in_data,
+          indices,
+          lengths,
+          in_weight,
+          // scale_bias field is only used in SparseLengths8BitsRowwiseOp
+          nullptr,
+          USE_MEAN,
+          out_data);
+      return true;
+    }
+
+    // Intra-op parallel mode: every range of segments is an independent
+    // EmbeddingLookup over its own slice of indices, weights and output.
+    std::vector<TIndex> index_offsets(M + 1, 0);
+    for (TIndex i = 0; i < M; ++i) {
+      CAFFE_ENFORCE_GE(lengths[i], 0, "LENGTHS must be non negative");
+      index_offsets[i + 1] = index_offsets[i] + lengths[i];
+    }
+    CAFFE_ENFORCE_EQ(
+        index_offsets[M],
         indices_size,
-        N,
-        in_data,
-        indices,
-        lengths,
-        in_weight,
-        nullptr, // scale_bias field is only used in SparseLengths8BitsRowwiseOp
-        USE_MEAN,
-        out_data);
+        "The sum of LENGTHS has to be the size of INDICES");
+    const auto bounds =
+        BalancedSegmentRanges(lengths, M, num_ranges, out_data, D);
+    ws_->GetThreadPool()->runRanges(bounds.size() - 1, [&](size_t range) {
+      const TIndex begin = bounds[range];
+      const TIndex end = bounds[range + 1];
+      const TIndex index_begin = index_offsets[begin];
+      const T* weight = in_weight;
+      if (in_weight && !USE_POSITIONAL_WEIGHT) {
+        weight += index_begin;
+      }
+      EmbeddingLookup<IndexType, InputType, T, USE_POSITIONAL_WEIGHT>(
+          D,
+          end - begin,
+          index_offsets[end] - index_begin,
+          N,
+          in_data,
+          indices + index_begin,
+          lengths + begin,
+          weight,
+          nullptr,
+          USE_MEAN,
+          out_data + begin * D);
+    });
     return true;
   }
 
  private:
+  Workspace* ws_;
+  // 0 uses all threads of the workspace thread pool, 1 disables the
+  // intra-op parallel mode
+  const int num_threads_;
+  const int min_indices_per_thread_;
+
   enum {
     DATA = 0, // Data input.
     WEIGHT = 1, // Weight input used in SparseLengthsWeightedSum
@@ -103,4 +233,176 @@ class CPUSparseLengthsReductionOp : public Operator<CPUContext> {
   };
 };
 
+/**
+ * Gradient of SparseLengths[Sum,Mean] with respect to DATA as a slice holding
+ * every looked up index once, with the gradient rows of its occurrences
+ * summed, instead of one row per element of INDICES.
+ *
+ * The indices are numbered by first occurrence with an open addressing hash
+ * table, and their occurrences are grouped with a counting sort. The rows of
+ * the unique indices are then summed in ranges balanced by their number of
+ * occurrences on the workspace thread pool, every range writing its own
+ * output rows. Occurrences are summed in the order of INDICES, so the result
+ * does not depend on the number of threads.
+ */
+template <bool USE_MEAN = 0>
+class CPUSparseLengthsDedupGradientOp : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  CPUSparseLengthsDedupGradientOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>(
+            "num_threads",
+            FLAGS_caffe2_sparse_lengths_num_threads)),
+        min_indices_per_thread_(OperatorBase::GetSingleArgument<int>(
+            "min_indices_per_thread",
+            FLAGS_caffe2_sparse_lengths_min_indices_per_thread)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename IndexType>
+  bool DoRunWithType() {
+    auto& segmentGradsInput = Input(SEGMENT_GRADS);
+    auto& lengthsInput = Input(LENGTHS);
+    auto& indicesInput = Input(INDICES);
+
+    CAFFE_ENFORCE_EQ(1, indicesInput.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(1, lengthsInput.ndim(), "LENGTHS must be a vector");
+    CAFFE_ENFORCE_GT(segmentGradsInput.ndim(), 0);
+    const TIndex M = lengthsInput.dim(0);
+    CAFFE_ENFORCE_EQ(M, segmentGradsInput.dim(0));
+    const TIndex D = segmentGradsInput.size_from_dim(1);
+    const TIndex indices_size = indicesInput.size();
+    const int* lengths = lengthsInput.template data<int>();
+    const IndexType* indices = indicesInput.template data<IndexType>();
+    const float* segment_grads = segmentGradsInput.template data<float>();
+
+    segment_of_.resize(indices_size);
+    TIndex position = 0;
+    for (TIndex i = 0; i < M; ++i) {
+      CAFFE_ENFORCE_GE(lengths[i], 0, "LENGTHS must be non negative");
+      CAFFE_ENFORCE_LE(
+          position + lengths[i],
+          indices_size,
+          "The sum of LENGTHS has to be the size of INDICES");
+      std::fill_n(segment_of_.begin() + position, lengths[i], i);
+      position += lengths[i];
+    }
+    CAFFE_ENFORCE_EQ(
+        position,
+        indices_size,
+        "The sum of LENGTHS has to be the size of INDICES");
+
+    // Slot of every index, at most half of the table being used
+    int table_bits = 1;
+    while ((TIndex(1) << table_bits) < 2 * indices_size) {
+      ++table_bits;
+    }
+    const uint64_t table_mask = (uint64_t(1) << table_bits) - 1;
+    table_.assign(table_mask + 1, -1);
+    slot_of_.resize(indices_size);
+    counts_.clear();
+    std::vector<IndexType> unique;
+    for (TIndex i = 0; i < indices_size; ++i) {
+      const IndexType idx = indices[i];
+      uint64_t h = (static_cast<uint64_t>(idx) * 0x9E3779B97F4A7C15ULL) >>
+          (64 - table_bits);
+      while (table_[h] >= 0 && unique[table_[h]] != idx) {
+        h = (h + 1) & table_mask;
+      }
+      if (table_[h] < 0) {
+        table_[h] = unique.size();
+        unique.push_back(idx);
+        counts_.push_back(0);
+      }
+      slot_of_[i] = table_[h];
+      ++counts_[table_[h]];
+    }
+    const TIndex U = unique.size();
+
+    // Occurrences of every slot, in the order of INDICES
+    offsets_.resize(U + 1);
+    offsets_[0] = 0;
+    for (TIndex u = 0; u < U; ++u) {
+      offsets_[u + 1] = offsets_[u] + counts_[u];
+    }
+    cursor_.assign(offsets_.begin(), offsets_.end() - 1);
+    occurrences_.resize(indices_size);
+    for (TIndex i = 0; i < indices_size; ++i) {
+      occurrences_[cursor_[slot_of_[i]]++] = i;
+    }
+
+    auto* indicesOutput = Output(UNIQUE_INDICES);
+    indicesOutput->Resize(U);
+    std::copy(
+        unique.begin(),
+        unique.end(),
+        indicesOutput->template mutable_data<IndexType>());
+
+    auto* gradsOutput = Output(GRADS);
+    auto shape = segmentGradsInput.dims();
+    shape[0] = U;
+    gradsOutput->Resize(shape);
+    float* grads = gradsOutput->template mutable_data<float>();
+
+    auto reduce = [&](TIndex begin, TIndex end) {
+      for (TIndex u = begin; u < end; ++u) {
+        float* out = grads + u * D;
+        for (TIndex k = offsets_[u]; k < offsets_[u + 1]; ++k) {
+          const TIndex segment = segment_of_[occurrences_[k]];
+          const float* g = segment_grads + segment * D;
+          const float scale =
+              USE_MEAN ? static_cast<float>(1.0 / lengths[segment]) : 1.0f;
+          if (k == offsets_[u]) {
+            for (TIndex j = 0; j < D; ++j) {
+              out[j] = USE_MEAN ? g[j] * scale : g[j];
+            }
+          } else {
+            for (TIndex j = 0; j < D; ++j) {
+              out[j] += USE_MEAN ? g[j] * scale : g[j];
+            }
+          }
+        }
+      }
+    };
+
+    const int num_ranges = SparseLengthsNumRanges(
+        ws_, num_threads_, min_indices_per_thread_, indices_size);
+    if (num_ranges <= 1) {
+      reduce(0, U);
+      return true;
+    }
+    const auto bounds =
+        BalancedSegmentRanges(counts_.data(), U, num_ranges, grads, D);
+    ws_->GetThreadPool()->runRanges(bounds.size() - 1, [&](size_t range) {
+      reduce(bounds[range], bounds[range + 1]);
+    });
+    return true;
+  }
+
+ private:
+  Workspace* ws_;
+  const int num_threads_;
+  const int min_indices_per_thread_;
+  // Scratch reused across runs
+  std::vector<TIndex> segment_of_;
+  std::vector<TIndex> table_;
+  std::vector<TIndex> slot_of_;
+  std::vector<int> counts_;
+  std::vector<TIndex> offsets_;
+  std::vector<TIndex> cursor_;
+  std::vector<TIndex> occurrences_;
+
+  INPUT_TAGS(SEGMENT_GRADS, LENGTHS, INDICES);
+  OUTPUT_TAGS(UNIQUE_INDICES, GRADS);
+};
+
 } // namespace caffe2
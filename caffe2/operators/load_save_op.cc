@@ -1,7 +1,29 @@
 #include "caffe2/operators/load_save_op.h"
 
+#include <cstring>
+
 namespace caffe2 {
 
+namespace detail {
+uint64_t HashChunk(const void* data, size_t nbytes) {
+  // 64 bit FNV-1a over words, followed by the tail bytes
+  const uint64_t kPrime = 1099511628211ULL;
+  uint64_t hash = 14695981039346656037ULL;
+  const char* bytes = static_cast<const char*>(data);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= nbytes; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * kPrime;
+    hash ^= hash >> 29;
+  }
+  for (; i < nbytes; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(bytes[i])) * kPrime;
+  }
+  return hash ^ nbytes;
+}
+} // namespace detail
+
 template <>
 void LoadOp<CPUContext>::SetCurrentDevice(BlobProto* proto) {
   if (proto->has_tensor()) {
@@ -42,6 +64,10 @@ If at least one input is passed, then it is assumed that that input blobs are a
 set of DBReaders to load from. Otherwise the db or dbs argument is used to load
 blobs from one single db or multiple dbs respectively. db_type argument is used
 to specify the type of the input db/dbs.
+
+A db written by Checkpoint in delta mode is loaded on top of the checkpoints it
+applies to, down to the last full checkpoint, which have to be available under
+the names recorded by Checkpoint.
 )DOC")
     .Arg(
         "absolute_path",
@@ -82,7 +108,18 @@ to specify the type of the input db/dbs.
         "source_blob_names",
         "(list of strings) if set, used instead of output "
         "blob names, to specify which blobs in the db shall be loaded. Must be "
-        "the same length as number of output blobs.");
+        "the same length as number of output blobs.")
+    .Arg(
+        "num_threads",
+        "(int, default caffe2_max_tensor_deserializer_threads flag) number of "
+        "threads parsing the chunks of tensors split into several chunks in "
+        "parallel, CPU only.")
+    .Arg(
+        "mmap",
+        "(bool, default false) if true, db (or dbs) are flat tensor files "
+        "written by Save with mmap, which are memory-mapped and used in place "
+        "without copies. The loaded tensors are read-only and keep the file "
+        "mapped until they are destroyed. CPU only.");
 
 OPERATOR_SCHEMA(Save)
     .NumInputs(1, INT_MAX)
@@ -107,7 +144,23 @@ db specified by the arguments.
         "(list of strings) if set, used instead of original "
         "blob names. Must be the same length as number of blobs.")
     .Arg("db", "(string) the path to the db to load.")
-    .Arg("db_type", "(string) the type of the db.");
+    .Arg("db_type", "(string) the type of the db.")
+    .Arg(
+        "mmap",
+        "(bool, default false) if true, writes CPU tensors of fundamental "
+        "types to a flat file with aligned data that Load can map with mmap, "
+        "db_type is ignored.")
+    .Arg(
+        "alignment",
+        "(int, default 64) with mmap, the alignment of the data of every "
+        "tensor in the file, a multiple of 64. The page size keeps the pages "
+        "of tensors that are never read out of memory.")
+    .Arg(
+        "compression",
+        "(string, default \"\") if set, the codec used to compress every "
+        "chunk of the tensors, e.g. \"zero_rle\" for tensors with many zero "
+        "rows, or \"zstd\" when built with zstd. Load decompresses "
+        "transparently.");
 
 OPERATOR_SCHEMA(Checkpoint)
     .NumInputs(1, INT_MAX)
@@ -129,10 +182,22 @@ counter). This is determined whether we need to do checkpointing.
         "iteration to create the final db name. For example, "
         "\"/home/lonestarr/checkpoint_%08d.db\"")
     .Arg("db_type", "(string) the type of the db.")
+    .Arg(
+        "compression",
+        "(string, default \"\") codec used to compress the tensors, see Save.")
     .Arg(
         "every",
         "(int, default 1) the checkpointing is carried out when "
-        "(iter mod every) is zero.");
+        "(iter mod every) is zero.")
+    .Arg(
+        "delta",
+        "(bool, default false) if true, checkpoints after the first one only "
+        "store the chunks of CPU tensors that changed since the previous "
+        "checkpoint and the name of that checkpoint. Load composes them.")
+    .Arg(
+        "full_every",
+        "(int, default 0) in delta mode, every full_every-th checkpoint stores "
+        "all blobs. If 0, only the first one does.");
 
 OPERATOR_SCHEMA(Snapshot);
 
@@ -1,21 +1,26 @@
 #ifndef CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 #define CAFFE2_OPERATORS_LOAD_SAVE_OP_H_
 
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
+#include <future>
 #include <map>
+#include <mutex>
 #include <unordered_set>
 
 #include "caffe2/core/blob_serialization.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/db.h"
 #include "caffe2/core/logging.h"
+#include "caffe2/core/mapped_tensor_file.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
 #include "caffe2/utils/proto_utils.h"
 
 namespace caffe2 {
 
-namespace {
+namespace detail {
 struct BlobState {
   int64_t total_size;
   int64_t current_size;
@@ -30,12 +35,23 @@ struct BlobState {
         current_size(current_size),
         is_tensor(is_tensor) {}
 };
-} // namespace
+} // namespace detail
 
 using db::Cursor;
 using db::DB;
 using db::Transaction;
 
+// Key of the record that marks a db written by CheckpointOp in delta mode.
+// Its content is the name of the checkpoint the delta applies to.
+constexpr auto kDeltaManifestKey = "__delta_checkpoint_manifest__";
+constexpr auto kDeltaManifestType = "DeltaCheckpointManifest";
+
+namespace detail {
+// Fingerprint of a chunk of tensor data, used to find the chunks that
+// changed since the previous checkpoint.
+uint64_t HashChunk(const void* data, size_t nbytes);
+} // namespace detail
+
 template <class Context>
 class DBExistsOp final : public Operator<Context> {
  public:
@@ -85,10 +101,20 @@ class LoadOp final : public Operator<Context> {
         load_all_(OperatorBase::GetSingleArgument<int>("load_all", 0)),
         allow_incomplete_(
             OperatorBase::GetSingleArgument<bool>("allow_incomplete", false)),
+        mmap_(OperatorBase::GetSingleArgument<bool>("mmap", false)),
+        num_threads_(OperatorBase::GetSingleArgument<int>(
+            "num_threads",
+            FLAGS_caffe2_max_tensor_deserializer_threads)),
         blob_names_(
             OperatorBase::GetRepeatedArgument<string>("source_blob_names")) {
+    CAFFE_ENFORCE(
+        !mmap_ || InputSize() == 0, "mmap can't be used with DBReader inputs");
+    CAFFE_ENFORCE(
+        !mmap_ || (std::is_same<Context, CPUContext>::value),
+        "Mapped tensors can only be loaded on CPU");
     if (InputSize() == 0) {
-      CAFFE_ENFORCE_GT(db_type_.size(), 0, "Must specify a db type.");
+      CAFFE_ENFORCE(
+          mmap_ || db_type_.size() > 0, "Must specify a db type.");
       if (db_names_.empty()) {
         CAFFE_ENFORCE_GT(db_name_.size(), 0, "Must specify a db name.");
         db_names_.push_back(db_name_);
@@ -134,22 +160,23 @@ class LoadOp final : public Operator<Context> {
 
   bool RunOnDevice() override {
     int total_loaded_blobs = 0;
-    std::unordered_map<string, BlobState> blob_states;
-    if (InputSize() > 0) {
+    std::unordered_map<string, detail::BlobState> blob_states;
+    if (mmap_) {
+      for (int i = 0; i < db_names_.size(); ++i) {
+        string full_db_name = absolute_path_
+            ? db_names_[i]
+            : (ws_->RootFolder() + "/" + db_names_[i]);
+        extractMapped(i, full_db_name, &blob_states, &total_loaded_blobs);
+      }
+    } else if (InputSize() > 0) {
       for (int i = 0; i < InputSize(); ++i) {
         const db::DBReader& reader = OperatorBase::Input<db::DBReader>(i);
         extract(i, reader.cursor(), &blob_states, &total_loaded_blobs);
       }
     } else {
       for (int i = 0; i < db_names_.size(); ++i) {
-        string full_db_name = absolute_path_
-            ? db_names_[i]
-            : (ws_->RootFolder() + "/" + db_names_[i]);
-        std::unique_ptr<DB> in_db(
-            caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::READ));
-        CAFFE_ENFORCE(in_db.get(), "Cannot open db: ", full_db_name);
-        std::unique_ptr<Cursor> cursor(in_db->NewCursor());
-        extract(i, cursor.get(), &blob_states, &total_loaded_blobs);
+        extractWithDeltas(
+            i, fullDbName(db_names_[i]), &blob_states, &total_loaded_blobs);
       }
     }
 
@@ -182,31 +209,267 @@ class LoadOp final : public Operator<Context> {
   }
 
  private:
+  // Parses and deserializes db records. Once a tensor split into several
+  // chunks shows up, the records are processed on num_threads_ threads, and
+  // every chunk is copied straight into its slice of the destination tensor,
+  // which is allocated by the first chunk of the tensor.
+  class RecordLoader {
+   public:
+    RecordLoader(
+        LoadOp* op,
+        std::unordered_map<string, detail::BlobState>* blob_states,
+        int num_threads)
+        : op_(op),
+          blob_states_(blob_states),
+          num_threads_(num_threads),
+          loaded_blobs_(0),
+          in_flight_(0) {}
+
+    ~RecordLoader() {
+#ifndef __ANDROID__
+      // Only reached with running workers when the caller throws
+      queue_.NoMoreJobs();
+      for (auto& fut : futures_) {
+        fut.wait();
+      }
+#endif
+    }
+
+    void Load(Blob* blob, const string& key, const string& value) {
+#ifndef __ANDROID__
+      if (!futures_.empty()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Bounds the memory taken by the records waiting to be parsed
+        cv_.wait(lock, [&]() { return in_flight_ < 2 * num_threads_; });
+        if (error_) {
+          return;
+        }
+        ++in_flight_;
+        lock.unlock();
+        queue_.Push(std::make_shared<Record>(Record{blob, key, value}));
+        return;
+      }
+#endif
+      BlobProto proto;
+      CAFFE_ENFORCE(proto.ParseFromString(value), "Couldn't parse Proto");
+#ifndef __ANDROID__
+      // Any chunk but the first one of a tensor (chunks can be stored in any
+      // order) starts the workers for the rest of the db
+      if (num_threads_ > 1 && proto.has_tensor() &&
+          proto.tensor().has_segment() &&
+          proto.tensor().segment().begin() > 0) {
+        for (int i = 0; i < num_threads_; ++i) {
+          futures_.emplace_back(std::async(
+              std::launch::async, &RecordLoader::workerLoop, this));
+        }
+      }
+#endif
+      process(blob, key, &proto);
+    }
+
+    // Waits for the pending records, returns the number of loaded blobs
+    int Finish() {
+#ifndef __ANDROID__
+      queue_.NoMoreJobs();
+      for (auto& fut : futures_) {
+        fut.get();
+      }
+      futures_.clear();
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+#endif
+      return loaded_blobs();
+    }
+
+    int loaded_blobs() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return loaded_blobs_;
+    }
+
+   private:
+    struct Record {
+      Blob* blob;
+      string key;
+      string value;
+    };
+
+    void workerLoop() {
+      std::shared_ptr<Record> record;
+      while (queue_.Pop(&record)) {
+        try {
+          BlobProto proto;
+          CAFFE_ENFORCE(
+              proto.ParseFromString(record->value), "Couldn't parse Proto");
+          process(record->blob, record->key, &proto);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!error_) {
+            error_ = std::current_exception();
+          }
+        }
+        record.reset();
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_flight_;
+        cv_.notify_all();
+      }
+    }
+
+    void process(Blob* blob, const string& key, BlobProto* proto) {
+      if (!op_->keep_device_) {
+        // If we are not keeping the device as the one specified in the
+        // proto, we will set the current device.
+        op_->SetCurrentDevice(proto);
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      const bool first = blob_states_->count(key) == 0;
+      // Allocations (first chunk) and non-tensor blobs are done under the
+      // lock, the copies of the other tensor chunks run concurrently
+      if (!proto->has_tensor() || (first && proto->tensor().has_segment())) {
+        op_->ProcessBlob(blob, *proto, blob_states_, key, &loaded_blobs_);
+        return;
+      }
+      if (first) {
+        blob->Reset();
+      }
+      op_->UpdateBlobState(*proto, blob_states_, key, &loaded_blobs_);
+      lock.unlock();
+      blob->Deserialize(*proto);
+    }
+
+    LoadOp* op_;
+    std::unordered_map<string, detail::BlobState>* blob_states_;
+    const int num_threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int loaded_blobs_;
+    int in_flight_;
+    std::exception_ptr error_;
+#ifndef __ANDROID__
+    SimpleQueue<std::shared_ptr<Record>> queue_;
+    std::vector<std::future<void>> futures_;
+#endif
+  };
+
+  string fullDbName(const string& db_name) {
+    return absolute_path_ ? db_name : (ws_->RootFolder() + "/" + db_name);
+  }
+
+  // Returns the checkpoint a delta db applies to, or an empty string if the
+  // db is not a delta. Leaves the cursor at the first record.
+  string deltaParent(Cursor* cursor) {
+    string parent;
+    // The manifest is the first record written to a delta
+    if (cursor->SupportsSeek()) {
+      cursor->Seek(kDeltaManifestKey);
+    }
+    if (cursor->Valid() && cursor->key() == kDeltaManifestKey) {
+      BlobProto proto;
+      CAFFE_ENFORCE(
+          proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
+      CAFFE_ENFORCE_EQ(proto.type(), kDeltaManifestType);
+      parent = proto.content();
+      CAFFE_ENFORCE(!parent.empty(), "Delta checkpoint without a base");
+    }
+    if (cursor->SupportsSeek()) {
+      cursor->SeekToFirst();
+    }
+    return parent;
+  }
+
+  // Loads a db; if it is a delta checkpoint, loads the checkpoint it applies
+  // to first (recursively down to the full checkpoint) and patches the
+  // loaded blobs with the chunks stored in the delta.
+  void extractWithDeltas(
+      int db_id,
+      const string& full_db_name,
+      std::unordered_map<string, detail::BlobState>* blob_states,
+      int* total_loaded_blobs) {
+    std::unique_ptr<DB> in_db(
+        caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::READ));
+    CAFFE_ENFORCE(in_db.get(), "Cannot open db: ", full_db_name);
+    std::unique_ptr<Cursor> cursor(in_db->NewCursor());
+    const auto parent = deltaParent(cursor.get());
+    if (parent.empty()) {
+      extract(db_id, cursor.get(), blob_states, total_loaded_blobs);
+      return;
+    }
+    VLOG(1) << "Loading delta checkpoint " << full_db_name << " over "
+            << parent;
+    // Some dbs (e.g. leveldb) can't be opened twice at the same time
+    cursor.reset();
+    in_db.reset();
+    extractWithDeltas(
+        db_id, fullDbName(parent), blob_states, total_loaded_blobs);
+    in_db = caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::READ);
+    CAFFE_ENFORCE(in_db.get(), "Cannot open db: ", full_db_name);
+    cursor = in_db->NewCursor();
+    extractDelta(cursor.get(), blob_states, total_loaded_blobs);
+  }
+
+  void extractDelta(
+      Cursor* cursor,
+      std::unordered_map<string, detail::BlobState>* blob_states,
+      int* total_loaded_blobs) {
+    for (; cursor->Valid(); cursor->Next()) {
+      if (cursor->key() == kDeltaManifestKey) {
+        continue;
+      }
+      const auto key = buildBlobNameFromDbKey(cursor->key());
+      Blob* blob = nullptr;
+      if (load_all_) {
+        blob = ws_->CreateBlob(key);
+      } else if (output_indices_.count(key)) {
+        blob = OperatorBase::Outputs().at(output_indices_[key]);
+      } else {
+        VLOG(1) << "Key " << key << " not used. Skipping.";
+        continue;
+      }
+      BlobProto proto;
+      CAFFE_ENFORCE(
+          proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
+      if (!keep_device_) {
+        SetCurrentDevice(&proto);
+      }
+      if (blob_states->count(key) == 0) {
+        // A blob that is not in the earlier checkpoints
+        ProcessBlob(blob, proto, blob_states, key, total_loaded_blobs);
+        continue;
+      }
+      // Chunks of a tensor of the same shape are copied into the loaded
+      // tensor in place, everything else replaces the loaded blob
+      if (!proto.has_tensor()) {
+        blob->Reset();
+      }
+      blob->Deserialize(proto);
+    }
+  }
+
   void extract(
       int db_id,
       Cursor* cursor,
-      std::unordered_map<string, BlobState>* blob_states,
+      std::unordered_map<string, detail::BlobState>* blob_states,
       int* total_loaded_blobs) {
+    // Deserializing chunks concurrently is only safe for CPU tensors
+    RecordLoader loader(
+        this,
+        blob_states,
+        std::is_same<Context, CPUContext>::value ? num_threads_ : 1);
     if (load_all_) {
-      extractAll(db_id, cursor, blob_states, total_loaded_blobs);
+      extractAll(db_id, cursor, &loader);
     } else {
       extractFrom(
-          db_id,
-          cursor,
-          OperatorBase::Outputs(),
-          blob_states,
-          total_loaded_blobs);
+          db_id, cursor, OperatorBase::Outputs(), *total_loaded_blobs, &loader);
     }
+    *total_loaded_blobs += loader.Finish();
   }
 
-  void extractAll(
-      int db_id,
-      Cursor* cursor,
-      std::unordered_map<string, BlobState>* blob_states,
-      int* total_loaded_blobs) {
+  void extractAll(int db_id, Cursor* cursor, RecordLoader* loader) {
     CAFFE_ENFORCE(cursor, "cursor is not valid");
-    int loaded_blobs = 0;
     for (; cursor->Valid(); cursor->Next()) {
+      if (cursor->key() == kDeltaManifestKey) {
+        continue;
+      }
       const auto key = buildBlobNameFromDbKey(cursor->key());
       if (key_to_dbid_.count(key) && key_to_dbid_[key] != db_id) {
         CAFFE_THROW("Duplicate Key ", key, " is found!\n");
@@ -214,29 +477,22 @@ class LoadOp final : public Operator<Context> {
         key_to_dbid_[key] = db_id;
       }
 
-      BlobProto proto;
-      CAFFE_ENFORCE(
-          proto.ParseFromString(cursor->value()), "Couldn't parse Proto");
-      if (!keep_device_) {
-        // If we are not keeping the device as the one specified in the
-        // proto, we will set the current device.
-        SetCurrentDevice(&proto);
-      }
       Blob* blob = ws_->CreateBlob(key);
-      ProcessBlob(blob, proto, blob_states, key, &loaded_blobs);
+      loader->Load(blob, key, cursor->value());
     }
-    *total_loaded_blobs += loaded_blobs;
   }
 
   void extractFrom(
       int db_id,
       Cursor* cursor,
       const vector<Blob*>& outputs,
-      std::unordered_map<string, BlobState>* blob_states,
-      int* total_loaded_blobs) {
+      int total_loaded_blobs,
+      RecordLoader* loader) {
     CAFFE_ENFORCE(cursor);
-    int loaded_blobs = 0;
     for (; cursor->Valid(); cursor->Next()) {
+      if (cursor->key() == kDeltaManifestKey) {
+        continue;
+      }
       const auto key = buildBlobNameFromDbKey(cursor->key());
       if (!output_indices_.count(key)) {
         VLOG(1) << "Key " << key << " not used. Skipping.";
@@ -248,24 +504,49 @@ class LoadOp final : public Operator<Context> {
         }
 
         VLOG(2) << "Deserializing blob " << key;
-        BlobProto proto;
-        CAFFE_ENFORCE(proto.ParseFromString(cursor->value()));
-        if (!keep_device_) {
-          // If we are not keeping the device as the one specified in the
-          // proto, we will set the current device.
-          SetCurrentDevice(&proto);
-        }
         auto blobIndex = output_indices_[key];
         Blob* blob = outputs.at(blobIndex);
-        ProcessBlob(blob, proto, blob_states, key, &loaded_blobs);
+        loader->Load(blob, key, cursor->value());
 
-        if (*total_loaded_blobs + loaded_blobs == OutputSize()) {
+        if (total_loaded_blobs + loader->loaded_blobs() == OutputSize()) {
           break;
         }
       }
     }
+  }
 
-    *total_loaded_blobs += loaded_blobs;
+  // Binds the tensors of a flat tensor file (see MappedTensorFile) to the
+  // blobs without copies, the blobs keep the file mapped
+  void extractMapped(
+      int db_id,
+      const string& path,
+      std::unordered_map<string, detail::BlobState>* blob_states,
+      int* total_loaded_blobs) {
+    auto file = MappedTensorFile::Open(path);
+    for (const auto& entry : file->entries()) {
+      const auto key = buildBlobNameFromDbKey(entry.name);
+      Blob* blob = nullptr;
+      if (load_all_) {
+        blob = ws_->CreateBlob(key);
+      } else if (output_indices_.count(key)) {
+        blob = OperatorBase::Outputs().at(output_indices_[key]);
+      } else {
+        VLOG(1) << "Key " << key << " not used. Skipping.";
+        continue;
+      }
+      if (key_to_dbid_.count(key) && key_to_dbid_[key] != db_id) {
+        CAFFE_THROW("Duplicate Key ", key, " is found!\n");
+      } else {
+        key_to_dbid_[key] = db_id;
+      }
+      CAFFE_ENFORCE(blob_states->count(key) == 0, "Blob duplicated: ", key);
+
+      VLOG(2) << "Mapping blob " << key;
+      blob->Reset();
+      file->Bind(entry, blob->template GetMutable<TensorCPU>());
+      (*blob_states)[key] = detail::BlobState();
+      (*total_loaded_blobs)++;
+    }
   }
 
   string buildBlobNameFromDbKey(const string& dbKey) {
@@ -286,7 +567,7 @@ class LoadOp final : public Operator<Context> {
   void ProcessBlob(
       Blob* blob,
       const BlobProto& proto,
-      std::unordered_map<string, BlobState>* blob_states_ptr,
+      std::unordered_map<string, detail::BlobState>* blob_states_ptr,
       const string& key,
       int* loaded_blobs) {
     auto& blob_states = *blob_states_ptr;
@@ -299,9 +580,18 @@ class LoadOp final : public Operator<Context> {
       blob->Reset();
     }
     blob->Deserialize(proto);
+    UpdateBlobState(proto, blob_states_ptr, key, loaded_blobs);
+  }
+
+  void UpdateBlobState(
+      const BlobProto& proto,
+      std::unordered_map<string, detail::BlobState>* blob_states_ptr,
+      const string& key,
+      int* loaded_blobs) {
+    auto& blob_states = *blob_states_ptr;
     if (proto.has_content_num_chunks()) {
       if (!blob_states.count(key)) {
-        blob_states[key] = BlobState(proto.content_num_chunks());
+        blob_states[key] = detail::BlobState(proto.content_num_chunks());
       }
       CAFFE_ENFORCE(
           blob_states[key]
@@ -333,7 +623,7 @@ class LoadOp final : public Operator<Context> {
       // If blob is divided into chunks the field content_chunks has to be set,
       // otherwise only tensors can be seen multiple times as chunks.
       CAFFE_ENFORCE(blob_states.count(key) == 0, "Blob duplicated: ", key);
-      blob_states[key] = BlobState();
+      blob_states[key] = detail::BlobState();
       (*loaded_blobs)++;
       return;
     }
@@ -366,7 +656,7 @@ class LoadOp final : public Operator<Context> {
             proto.tensor().segment().end() - proto.tensor().segment().begin();
       }
       blob_states[key] =
-          BlobState(total_size, current_size, true /* is_tensor */);
+          detail::BlobState(total_size, current_size, true /* is_tensor */);
     }
 
     if (blob_states[key].current_size == blob_states[key].total_size) {
@@ -375,9 +665,9 @@ class LoadOp final : public Operator<Context> {
   }
 
   void validateBlobStates(
-      const std::unordered_map<string, BlobState>& blob_states) {
+      const std::unordered_map<string, detail::BlobState>& blob_states) {
     for (const auto& iter : blob_states) {
-      const BlobState& blob_state = iter.second;
+      const detail::BlobState& blob_state = iter.second;
       CAFFE_ENFORCE(
           blob_state.current_size == blob_state.total_size,
           "Data size mismatch for blob ",
@@ -399,6 +689,8 @@ class LoadOp final : public Operator<Context> {
   bool keep_device_;
   bool load_all_;
   bool allow_incomplete_;
+  bool mmap_;
+  int num_threads_;
   std::map<string, int> output_indices_;
   std::map<string, int> key_to_dbid_;
   std::vector<std::string> blob_names_;
@@ -417,10 +709,16 @@ class SaveOp final : public Operator<Context> {
             OperatorBase::GetSingleArgument<string>("strip_prefix", "")),
         db_name_(OperatorBase::GetSingleArgument<string>("db", "")),
         db_type_(OperatorBase::GetSingleArgument<string>("db_type", "")),
+        mmap_(OperatorBase::GetSingleArgument<bool>("mmap", false)),
+        alignment_(OperatorBase::GetSingleArgument<int64_t>(
+            "alignment",
+            MappedTensorFile::kAlignment)),
+        compression_(
+            OperatorBase::GetSingleArgument<string>("compression", "")),
         blob_names_(
             OperatorBase::GetRepeatedArgument<string>("blob_name_overrides")) {
     CAFFE_ENFORCE_GT(db_name_.size(), 0, "Must specify a db name.");
-    CAFFE_ENFORCE_GT(db_type_.size(), 0, "Must specify a db type.");
+    CAFFE_ENFORCE(mmap_ || db_type_.size() > 0, "Must specify a db type.");
     CAFFE_ENFORCE(
         blob_names_.empty() ||
             blob_names_.size() == OperatorBase::Inputs().size(),
@@ -455,34 +753,61 @@ class SaveOp final : public Operator<Context> {
   bool RunOnDevice() override {
     string full_db_name =
         absolute_path_ ? db_name_ : (ws_->RootFolder() + "/" + db_name_);
+    if (mmap_) {
+      std::vector<std::pair<std::string, const TensorCPU*>> tensors;
+      const vector<const Blob*>& inputs = OperatorBase::Inputs();
+      for (int i = 0; i < inputs.size(); ++i) {
+        CAFFE_ENFORCE(
+            inputs[i]->template IsType<TensorCPU>(),
+            "Only CPU tensors can be saved in mapped format: ",
+            blob_names_[i]);
+        tensors.emplace_back(
+            blob_names_[i], &inputs[i]->template Get<TensorCPU>());
+      }
+      MappedTensorFile::Write(full_db_name, tensors, alignment_);
+      return true;
+    }
     std::unique_ptr<DB> out_db(
         caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::NEW));
     CAFFE_ENFORCE(out_db.get(), "Cannot open db for writing: ", full_db_name);
 
-    BlobSerializerBase::SerializationAcceptor acceptor = [&](
-        const std::string& blobName, const std::string& data) {
+    // Chunks are serialized straight into the write buffer of the db, so
+    // only the chunks being serialized are held in memory
+    BlobSerializerBase::StreamingAcceptor acceptor = [&](
+        const std::string& blobName,
+        size_t size,
+        const BlobSerializerBase::ValueWriter& writer) {
       // transaction should take care of locking
-      VLOG(2) << "Sending " << blobName << " blob's data of size "
-              << data.size() << " to db";
+      VLOG(2) << "Sending " << blobName << " blob's data of size " << size
+              << " to db";
       auto transaction = out_db->NewTransaction();
-      transaction->Put(blobName, data);
+      transaction->PutStream(blobName, size, writer);
       transaction->Commit();
     };
 
     const vector<const Blob*>& inputs = OperatorBase::Inputs();
     for (int i = 0; i < inputs.size(); ++i) {
-      inputs[i]->Serialize(blob_names_[i], acceptor);
+      inputs[i]->SerializeStreaming(
+          blob_names_[i], acceptor, kDefaultChunkSize, compression_);
     }
     out_db->Close();
     return true;
   }
 
+  // The db keys of the inputs
+  const std::vector<std::string>& blob_names() const {
+    return blob_names_;
+  }
+
  private:
   Workspace* ws_;
   bool absolute_path_;
   string strip_prefix_;
   string db_name_;
   string db_type_;
+  bool mmap_;
+  int64_t alignment_;
+  string compression_;
   std::vector<std::string> blob_names_;
 };
 
@@ -514,18 +839,37 @@ string FormatString(const string& pattern, Ts... values) {
 // The file pattern in db_name should be a format string that can be passed into
 // sprintf with an int argument specifying the current iteration. An example:
 //     "/path/to/my/checkpoint/checkpoint_at_%d.pb"
+//
+// In delta mode only the first (and every full_every-th) checkpoint stores
+// all blobs. The other ones store only the chunks of CPU tensors that
+// changed since the previous checkpoint, found by comparing hashes of the
+// chunks, together with a manifest naming the previous checkpoint. LoadOp
+// follows the manifests and composes the chain.
 template <class Context>
 class CheckpointOp final : public Operator<Context> {
  public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
   CheckpointOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         db_pattern_(OperatorBase::GetSingleArgument<string>("db", "")),
         every_(OperatorBase::GetSingleArgument<int>("every", 1)),
+        delta_(OperatorBase::GetSingleArgument<bool>("delta", false)),
+        full_every_(OperatorBase::GetSingleArgument<int>("full_every", 0)),
+        absolute_path_(
+            OperatorBase::GetSingleArgument<int>("absolute_path", false)),
+        db_type_(OperatorBase::GetSingleArgument<string>("db_type", "")),
+        compression_(
+            OperatorBase::GetSingleArgument<string>("compression", "")),
         ws_(ws),
-        save_op_def_(operator_def) {
+        save_op_def_(operator_def),
+        snapshots_(operator_def.input_size()) {
     CAFFE_ENFORCE_GT(
         db_pattern_.size(), 0, "Must specify a checkpoint file pattern.");
     CAFFE_ENFORCE_GT(every_, 0, "Checkpoint interval should be positive.");
+    CAFFE_ENFORCE_GE(full_every_, 0);
+    CAFFE_ENFORCE(
+        !delta_ || !OperatorBase::GetSingleArgument<bool>("mmap", false),
+        "Delta checkpoints can't be written in mapped format");
     if (every_ == 1) {
       // Just issue a warning, but it's totally legal so we don't do anything.
       LOG(WARNING) << "It seems that we are checkpointting every iteration. "
@@ -538,20 +882,154 @@ class CheckpointOp final : public Operator<Context> {
     int64_t iter =
         OperatorBase::Input<TensorCPU>(0).template data<int64_t>()[0];
     if (iter % every_ == 0) {
-      GetMutableArgument("db", true, &save_op_def_)
-          ->set_s(FormatString(db_pattern_, iter));
+      const auto db_name = FormatString(db_pattern_, iter);
+      GetMutableArgument("db", true, &save_op_def_)->set_s(db_name);
       SaveOp<Context> sub_op(save_op_def_, ws_);
-      return sub_op.Run();
+      if (!delta_) {
+        return sub_op.Run();
+      }
+      const bool full = previous_.empty() ||
+          (full_every_ > 0 && num_checkpoints_ % full_every_ == 0);
+      if (full) {
+        if (!sub_op.Run()) {
+          return false;
+        }
+        for (int i = 0; i < InputSize(); ++i) {
+          updateSnapshot(i, nullptr);
+        }
+      } else {
+        saveDelta(db_name, sub_op.blob_names());
+      }
+      previous_ = db_name;
+      ++num_checkpoints_;
+      return true;
     } else {
       return true;
     }
   }
 
  private:
+  // The chunks of a tensor at the previous checkpoint
+  struct TensorSnapshot {
+    bool valid = false;
+    vector<TIndex> dims;
+    TypeMeta meta;
+    std::vector<uint64_t> hashes;
+  };
+
+  int64_t chunkSize() const {
+    // Same chunks as the ones written by SaveOp
+    return FLAGS_caffe2_tensor_chunk_size;
+  }
+
+  // Hashes the chunks of input i if it is a CPU tensor of a fundamental type.
+  // If changed is not null, it gets the ids of the chunks that differ from
+  // the snapshot, or all of them if the tensor can't be compared with it.
+  // Returns false if the input is not tracked.
+  bool updateSnapshot(int i, std::vector<int64_t>* changed) {
+    auto& snapshot = snapshots_[i];
+    const Blob* blob = OperatorBase::Inputs()[i];
+    if (!blob->template IsType<TensorCPU>() ||
+        blob->template Get<TensorCPU>().meta().ctor()) {
+      snapshot.valid = false;
+      return false;
+    }
+    const auto& tensor = blob->template Get<TensorCPU>();
+    const bool comparable = snapshot.valid && snapshot.dims == tensor.dims() &&
+        snapshot.meta == tensor.meta();
+    const int64_t chunk_size = chunkSize();
+    const int64_t num_chunks =
+        std::max<int64_t>(1, (tensor.size() + chunk_size - 1) / chunk_size);
+    std::vector<uint64_t> hashes(num_chunks);
+    const char* data = static_cast<const char*>(tensor.raw_data());
+    for (int64_t c = 0; c < num_chunks; ++c) {
+      const int64_t begin = c * chunk_size;
+      const int64_t end = std::min<int64_t>(begin + chunk_size, tensor.size());
+      hashes[c] = detail::HashChunk(
+          data + begin * tensor.itemsize(), (end - begin) * tensor.itemsize());
+      if (changed && (!comparable || hashes[c] != snapshot.hashes[c])) {
+        changed->push_back(c);
+      }
+    }
+    snapshot.valid = true;
+    snapshot.dims = tensor.dims();
+    snapshot.meta = tensor.meta();
+    snapshot.hashes = std::move(hashes);
+    return true;
+  }
+
+  void saveDelta(const string& db_name, const std::vector<string>& names) {
+    const string full_db_name =
+        absolute_path_ ? db_name : (ws_->RootFolder() + "/" + db_name);
+    std::unique_ptr<DB> out_db(
+        caffe2::db::CreateDB(db_type_, full_db_name, caffe2::db::NEW));
+    CAFFE_ENFORCE(out_db.get(), "Cannot open db for writing: ", full_db_name);
+    BlobSerializerBase::SerializationAcceptor acceptor =
+        [&](const std::string& key, const std::string& data) {
+          auto transaction = out_db->NewTransaction();
+          transaction->Put(key, data);
+          transaction->Commit();
+        };
+
+    BlobProto manifest;
+    manifest.set_name(kDeltaManifestKey);
+    manifest.set_type(kDeltaManifestType);
+    manifest.set_content(previous_);
+    acceptor(kDeltaManifestKey, manifest.SerializeAsString());
+
+    TensorSerializer<CPUContext> serializer;
+    size_t num_chunks = 0;
+    size_t num_changed = 0;
+    for (int i = 0; i < InputSize(); ++i) {
+      std::vector<int64_t> changed;
+      if (!updateSnapshot(i, &changed)) {
+        OperatorBase::Inputs()[i]->Serialize(
+            names[i], acceptor, kDefaultChunkSize, compression_);
+        continue;
+      }
+      const auto& tensor = OperatorBase::Input<TensorCPU>(i);
+      // Written the way TensorSerializer writes the chunks of a tensor, so
+      // that a delta chunk replaces the chunk of the same id
+      for (auto c : changed) {
+        BlobProto blob_proto;
+        blob_proto.set_name(names[i]);
+        blob_proto.set_type(kTensorBlobType);
+        blob_proto.mutable_tensor()->set_name(names[i]);
+        serializer.Serialize(
+            tensor,
+            names[i],
+            blob_proto.mutable_tensor(),
+            c * chunkSize(),
+            chunkSize());
+        if (!compression_.empty()) {
+          detail::CompressTensorProto(
+              compression_, blob_proto.mutable_tensor());
+        }
+        acceptor(
+            MakeString(names[i], kChunkIdSeparator, c),
+            blob_proto.SerializeAsString());
+      }
+      num_chunks += snapshots_[i].hashes.size();
+      num_changed += changed.size();
+    }
+    out_db->Close();
+    VLOG(1) << "Delta checkpoint " << full_db_name << ": " << num_changed
+            << " of " << num_chunks << " tensor chunks changed";
+  }
+
   string db_pattern_;
   int every_;
+  bool delta_;
+  int full_every_;
+  bool absolute_path_;
+  string db_type_;
+  string compression_;
   Workspace* ws_;
   OperatorDef save_op_def_;
+  // Delta mode state
+  string previous_;
+  int64_t num_checkpoints_ = 0;
+  std::vector<TensorSnapshot> snapshots_;
 };
 
 } // namespace caffe2
@@ -303,7 +303,24 @@ bool LRNGradientOp<float, CPUContext>::RunOnDeviceWithOrderNHWC() {
 REGISTER_CPU_OPERATOR(LRN, LRNOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(LRNGradient, LRNGradientOp<float, CPUContext>);
 
-OPERATOR_SCHEMA(LRN).NumInputs(1).NumOutputs(1, 2).InheritOnnxSchema("LRN");
+namespace {
+OpSchema::Cost CostInferenceForLRN(
+    const OperatorDef& def,
+    const vector<TensorShape>& in) {
+  // Sums of squares over windows of size elements, then the scale and power
+  struct OpSchema::Cost cost = PointwiseCostInference<3>(def, in);
+  ArgumentHelper helper(def);
+  cost.flops +=
+      nElemFromDim(in[0]) * helper.GetSingleArgument<int>("size", 0);
+  return cost;
+}
+} // namespace
+
+OPERATOR_SCHEMA(LRN)
+    .NumInputs(1)
+    .NumOutputs(1, 2)
+    .CostInferenceFunction(CostInferenceForLRN)
+    .InheritOnnxSchema("LRN");
 OPERATOR_SCHEMA(LRNGradient).NumInputs(3).NumOutputs(1);
 
 class GetLRNGradient : public GradientMakerBase {
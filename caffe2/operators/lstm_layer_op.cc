@@ -0,0 +1,178 @@
+#include "caffe2/operators/lstm_layer_op.h"
+
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+namespace detail {
+
+void LSTMLayerStep(
+    int N,
+    int D,
+    const float* gates,
+    const float* H_prev,
+    const float* C_prev,
+    float forget_bias,
+    float* H,
+    float* C) {
+  // The gates are D x N column major arrays with a stride of 4D between the
+  // columns, so that the whole batch is one vectorized expression
+  using GatesMap =
+      Eigen::Map<const Eigen::ArrayXXf, 0, Eigen::OuterStride<Eigen::Dynamic>>;
+  const Eigen::OuterStride<Eigen::Dynamic> stride(4 * D);
+  GatesMap i(gates, D, N, stride);
+  GatesMap f(gates + D, D, N, stride);
+  GatesMap o(gates + 2 * D, D, N, stride);
+  GatesMap g(gates + 3 * D, D, N, stride);
+  ConstEigenArrayMap<float> c_prev(C_prev, D, N);
+  EigenArrayMap<float> c(C, D, N);
+  EigenArrayMap<float> h(H, D, N);
+  // sigmoid(x) = 1 / (1 + exp(-x)), tanh(x) = 1 - 2 / (exp(2x) + 1)
+  c = ((-f - forget_bias).exp() + 1).inverse() * c_prev +
+      ((-i).exp() + 1).inverse() * (1 - 2 * ((2 * g).exp() + 1).inverse());
+  h = ((-o).exp() + 1).inverse() * (1 - 2 * ((2 * c).exp() + 1).inverse());
+}
+
+} // namespace detail
+
+bool LSTMLayerOp::RunOnDevice() {
+  const auto& X = Input(INPUT);
+  const auto& i2hW = Input(I2H_W);
+  const auto& gatesW = Input(GATES_W);
+  CAFFE_ENFORCE_EQ(X.ndim(), 3, "Input must be T x N x input_dim");
+  const int T = X.dim32(0);
+  const int N = X.dim32(1);
+  const int I = X.dim32(2);
+  CAFFE_ENFORCE_EQ(gatesW.ndim(), 2);
+  const int G = gatesW.dim32(0);
+  const int D = gatesW.dim32(1);
+  CAFFE_ENFORCE_EQ(G, 4 * D, "gates_t_w must be 4 * hidden_dim x hidden_dim");
+  CAFFE_ENFORCE_EQ(i2hW.ndim(), 2);
+  CAFFE_ENFORCE_EQ(i2hW.dim32(0), G);
+  CAFFE_ENFORCE_EQ(i2hW.dim32(1), I);
+  CAFFE_ENFORCE_EQ(Input(I2H_B).size(), G);
+  CAFFE_ENFORCE_EQ(Input(GATES_B).size(), G);
+  CAFFE_ENFORCE_EQ(Input(HIDDEN_INIT).size(), N * D);
+  CAFFE_ENFORCE_EQ(Input(CELL_INIT).size(), N * D);
+  const int32_t* seqLengths = nullptr;
+  if (InputSize() > SEQ_LENGTHS) {
+    CAFFE_ENFORCE_EQ(Input(SEQ_LENGTHS).size(), N);
+    seqLengths = Input(SEQ_LENGTHS).data<int32_t>();
+  }
+
+  auto* hiddenAll = Output(HIDDEN_ALL);
+  auto* cellAll = Output(CELL_ALL);
+  hiddenAll->Resize(T, N, D);
+  cellAll->Resize(T, N, D);
+  auto* H = hiddenAll->mutable_data<float>();
+  auto* C = cellAll->mutable_data<float>();
+
+  // Projects the inputs of all the timesteps at once, the biases of both
+  // FCs are added up front
+  gates_.Resize(T, N, G);
+  auto* gates = gates_.mutable_data<float>();
+  if (T * N > 0) {
+    EigenArrayMap<float>(gates, G, T * N).colwise() =
+        ConstEigenVectorArrayMap<float>(Input(I2H_B).data<float>(), G) +
+        ConstEigenVectorArrayMap<float>(Input(GATES_B).data<float>(), G);
+    math::Gemm<float, CPUContext>(
+        CblasNoTrans,
+        CblasTrans,
+        T * N,
+        G,
+        I,
+        1,
+        X.data<float>(),
+        i2hW.data<float>(),
+        1,
+        gates,
+        &context_);
+  }
+
+  const float* H_prev = Input(HIDDEN_INIT).data<float>();
+  const float* C_prev = Input(CELL_INIT).data<float>();
+  for (int t = 0; t < T; ++t) {
+    auto* gates_t = gates + t * N * G;
+    auto* H_t = H + t * N * D;
+    auto* C_t = C + t * N * D;
+    math::Gemm<float, CPUContext>(
+        CblasNoTrans,
+        CblasTrans,
+        N,
+        G,
+        D,
+        1,
+        H_prev,
+        gatesW.data<float>(),
+        1,
+        gates_t,
+        &context_);
+    detail::LSTMLayerStep(
+        N, D, gates_t, H_prev, C_prev, forget_bias_, H_t, C_t);
+    if (seqLengths) {
+      // The sequences which ended keep their states, or drop them, like
+      // LSTMUnit
+      for (int n = 0; n < N; ++n) {
+        if (t < seqLengths[n]) {
+          continue;
+        }
+        if (drop_states_) {
+          math::Set<float, CPUContext>(D, 0, H_t + n * D, &context_);
+          math::Set<float, CPUContext>(D, 0, C_t + n * D, &context_);
+        } else {
+          context_.Copy<float, CPUContext, CPUContext>(
+              D, H_prev + n * D, H_t + n * D);
+          context_.Copy<float, CPUContext, CPUContext>(
+              D, C_prev + n * D, C_t + n * D);
+        }
+      }
+    }
+    H_prev = H_t;
+    C_prev = C_t;
+  }
+
+  auto* hiddenLast = Output(HIDDEN_LAST);
+  auto* cellLast = Output(CELL_LAST);
+  hiddenLast->Resize(1, N, D);
+  cellLast->Resize(1, N, D);
+  context_.Copy<float, CPUContext, CPUContext>(
+      N * D, H_prev, hiddenLast->mutable_data<float>());
+  context_.Copy<float, CPUContext, CPUContext>(
+      N * D, C_prev, cellLast->mutable_data<float>());
+  return true;
+}
+
+REGISTER_CPU_OPERATOR(LSTMLayer, LSTMLayerOp);
+
+OPERATOR_SCHEMA(LSTMLayer)
+    .NumInputs(7, 8)
+    .NumOutputs(4)
+    .SetDoc(R"DOC(
+Runs a whole LSTM layer, without peephole connections, over a sequence in a
+single operator. It computes the same outputs as rnn_cell.LSTM with
+forward_only, a RecurrentNetwork of FC and LSTMUnit, from the same weights,
+without running a step net per timestep: the input projection of all the
+timesteps is a single GEMM, and every step is a GEMM of the hidden state
+followed by a vectorized pass computing the gates and the states.
+
+The gates are in i, f, o, g order, like LSTMUnit. With sequence lengths, the
+states of a sequence are kept, or zeroed with drop_states, once it ended.
+CPU only, there is no gradient.
+)DOC")
+    .Arg("forget_bias", "Bias term to add in while calculating forget gate")
+    .Arg("drop_states", "Whether the states of ended sequences are zeroed")
+    .Input(0, "input", "The input sequence, T x N x input_dim")
+    .Input(1, "hidden_init", "Initial hidden state, 1 x N x D")
+    .Input(2, "cell_init", "Initial cell state, 1 x N x D")
+    .Input(3, "i2h_w", "Weights of the input projection, 4D x input_dim")
+    .Input(4, "i2h_b", "Bias of the input projection, 4D")
+    .Input(5, "gates_t_w", "Weights of the recurrent projection, 4D x D")
+    .Input(6, "gates_t_b", "Bias of the recurrent projection, 4D")
+    .Input(7, "seq_lengths", "Optional lengths of the sequences, int32 N")
+    .Output(0, "hidden_all", "Hidden states of all the timesteps, T x N x D")
+    .Output(1, "hidden_last", "Last hidden state, 1 x N x D")
+    .Output(2, "cell_all", "Cell states of all the timesteps, T x N x D")
+    .Output(3, "cell_last", "Last cell state, 1 x N x D");
+
+SHOULD_NOT_DO_GRADIENT(LSTMLayer);
+
+} // namespace caffe2
@@ -0,0 +1,61 @@
+#ifndef CAFFE2_OPERATORS_LSTM_LAYER_OP_H_
+#define CAFFE2_OPERATORS_LSTM_LAYER_OP_H_
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+namespace detail {
+
+// One step of an LSTM over a batch of N: given the pre-activations of the
+// gates (N x 4D, in i, f, o, g order), computes the cell and hidden states
+// C and H (N x D) from the previous ones.
+void LSTMLayerStep(
+    int N,
+    int D,
+    const float* gates,
+    const float* H_prev,
+    const float* C_prev,
+    float forget_bias,
+    float* H,
+    float* C);
+
+} // namespace detail
+
+// Runs a whole LSTM layer over a sequence in a single op: the input
+// projection of all the timesteps is a single GEMM, then every step is a
+// GEMM of the hidden state followed by the gate and cell math. It computes
+// the same as RecurrentNetwork running a step net of FC and LSTMUnit,
+// without the cost of running a net per step. Forward only.
+class LSTMLayerOp final : public Operator<CPUContext> {
+ public:
+  LSTMLayerOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        forget_bias_(OperatorBase::GetSingleArgument<float>("forget_bias", 0)),
+        drop_states_(
+            OperatorBase::GetSingleArgument<bool>("drop_states", false)) {}
+
+  bool RunOnDevice() override;
+
+ protected:
+  INPUT_TAGS(
+      INPUT,
+      HIDDEN_INIT,
+      CELL_INIT,
+      I2H_W,
+      I2H_B,
+      GATES_W,
+      GATES_B,
+      SEQ_LENGTHS);
+  OUTPUT_TAGS(HIDDEN_ALL, HIDDEN_LAST, CELL_ALL, CELL_LAST);
+
+ private:
+  float forget_bias_;
+  bool drop_states_;
+  // Pre-activations of the gates of all the timesteps, T x N x 4D
+  TensorCPU gates_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_LSTM_LAYER_OP_H_
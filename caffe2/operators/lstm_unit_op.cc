@@ -1,6 +1,143 @@
 #include "lstm_unit_op.h"
 
+#include <vector>
+
+#include "caffe2/perfkernels/math.h"
+#include "caffe2/utils/math.h"
+
 namespace caffe2 {
+namespace detail {
+
+namespace {
+
+// Activations of the i, f, o and g gates of a row of X
+void LSTMGates(
+    int D,
+    const float* X,
+    const float forget_bias,
+    bool fast_activations,
+    float* gates) {
+  std::copy(X, X + 4 * D, gates);
+  EigenVectorArrayMap<float>(gates + D, D) += forget_bias;
+  VectorizedSigmoid(3 * D, gates, gates, fast_activations);
+  VectorizedTanh(D, gates + 3 * D, gates + 3 * D, fast_activations);
+}
+
+} // namespace
+
+template <>
+void LSTMUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* C,
+    float* H,
+    const float forget_bias,
+    bool fast_activations,
+    CPUContext* /*context*/) {
+  std::vector<float> gates(4 * D);
+  for (int n = 0; n < N; ++n) {
+    const bool valid = seqLengths == nullptr || t < seqLengths[n];
+    if (!valid) {
+      if (drop_states) {
+        std::fill(H, H + D, 0.0f);
+        std::fill(C, C + D, 0.0f);
+      } else {
+        std::copy(H_prev, H_prev + D, H);
+        std::copy(C_prev, C_prev + D, C);
+      }
+    } else {
+      LSTMGates(D, X, forget_bias, fast_activations, gates.data());
+      ConstEigenVectorArrayMap<float> i(gates.data(), D);
+      ConstEigenVectorArrayMap<float> f(gates.data() + D, D);
+      ConstEigenVectorArrayMap<float> o(gates.data() + 2 * D, D);
+      ConstEigenVectorArrayMap<float> g(gates.data() + 3 * D, D);
+      EigenVectorArrayMap<float>(C, D) =
+          f * ConstEigenVectorArrayMap<float>(C_prev, D) + i * g;
+      VectorizedTanh(D, C, H, fast_activations);
+      EigenVectorArrayMap<float>(H, D) *= o;
+    }
+    H_prev += D;
+    C_prev += D;
+    X += 4 * D;
+    C += D;
+    H += D;
+  }
+}
+
+template <>
+void LSTMUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* C,
+    const float* /*H*/,
+    const float* C_diff,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* C_prev_diff,
+    float* X_diff,
+    const float forget_bias,
+    bool fast_activations,
+    CPUContext* /*context*/) {
+  std::vector<float> gates(4 * D);
+  std::vector<float> tanh_c(D);
+  for (int n = 0; n < N; ++n) {
+    const bool valid = seqLengths == nullptr || t < seqLengths[n];
+    if (!valid) {
+      if (drop_states) {
+        std::fill(H_prev_diff, H_prev_diff + D, 0.0f);
+        std::fill(C_prev_diff, C_prev_diff + D, 0.0f);
+      } else {
+        std::copy(H_diff, H_diff + D, H_prev_diff);
+        std::copy(C_diff, C_diff + D, C_prev_diff);
+      }
+      std::fill(X_diff, X_diff + 4 * D, 0.0f);
+    } else {
+      LSTMGates(D, X, forget_bias, fast_activations, gates.data());
+      VectorizedTanh(D, C, tanh_c.data(), fast_activations);
+      ConstEigenVectorArrayMap<float> i(gates.data(), D);
+      ConstEigenVectorArrayMap<float> f(gates.data() + D, D);
+      ConstEigenVectorArrayMap<float> o(gates.data() + 2 * D, D);
+      ConstEigenVectorArrayMap<float> g(gates.data() + 3 * D, D);
+      ConstEigenVectorArrayMap<float> tc(tanh_c.data(), D);
+      ConstEigenVectorArrayMap<float> h_diff(H_diff, D);
+      // c_term_diff is kept in C_prev_diff until it is multiplied by f
+      EigenVectorArrayMap<float> c_term_diff(C_prev_diff, D);
+      c_term_diff = ConstEigenVectorArrayMap<float>(C_diff, D) +
+          h_diff * o * (1 - tc * tc);
+      EigenVectorArrayMap<float>(X_diff, D) = c_term_diff * g * i * (1 - i);
+      EigenVectorArrayMap<float>(X_diff + D, D) = c_term_diff *
+          ConstEigenVectorArrayMap<float>(C_prev, D) * f * (1 - f);
+      EigenVectorArrayMap<float>(X_diff + 2 * D, D) =
+          h_diff * tc * o * (1 - o);
+      EigenVectorArrayMap<float>(X_diff + 3 * D, D) =
+          c_term_diff * i * (1 - g * g);
+      c_term_diff *= f;
+      std::fill(H_prev_diff, H_prev_diff + D, 0.0f); // not used if valid
+    }
+    C_prev += D;
+    X += 4 * D;
+    C += D;
+    C_diff += D;
+    H_diff += D;
+    X_diff += 4 * D;
+    H_prev_diff += D;
+    C_prev_diff += D;
+  }
+}
+
+} // namespace detail
+
 REGISTER_CPU_OPERATOR(LSTMUnit, LSTMUnitOp<CPUContext>);
 OPERATOR_SCHEMA(LSTMUnit)
     .NumInputs(4, 5)
@@ -16,6 +153,10 @@ value at X{t][n] >= seqLengths[n].
 
 )DOC")
     .Arg("forget_bias", "Bias term to add in while calculating forget gate")
+    .Arg(
+        "fast_activations",
+        "If set, the CPU op approximates sigmoid and tanh with a rational "
+        "function, faster and within 4e-7 of them")
     .Arg(
         "sequence_lengths",
         "When false, the sequence lengths input is left out, "
@@ -30,6 +30,7 @@ void LSTMUnit(
     T* C,
     T* H,
     const float forget_bias,
+    bool /*fast_activations*/,
     Context* /*context*/) {
   for (int n = 0; n < N; ++n) {
     const bool valid = seqLengths == nullptr || t < seqLengths[n];
@@ -80,6 +81,7 @@ void LSTMUnitGradient(
     T* C_prev_diff,
     T* X_diff,
     const float forget_bias,
+    bool /*fast_activations*/,
     Context* /*context*/) {
   for (int n = 0; n < N; ++n) {
     const bool valid = seqLengths == nullptr || t < seqLengths[n];
@@ -132,6 +134,43 @@ void LSTMUnitGradient(
     C_prev_diff += D;
   }
 }
+// Row-wise vectorized versions, with VectorizedSigmoid and VectorizedTanh
+// (fast approximations of them if fast_activations).
+template <>
+void LSTMUnit<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* H_prev,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    bool drop_states,
+    float* C,
+    float* H,
+    const float forget_bias,
+    bool fast_activations,
+    CPUContext* context);
+
+template <>
+void LSTMUnitGradient<float, CPUContext>(
+    int N,
+    int D,
+    int t,
+    const float* C_prev,
+    const float* X,
+    const int32_t* seqLengths,
+    const float* C,
+    const float* H,
+    const float* C_diff,
+    const float* H_diff,
+    bool drop_states,
+    float* H_prev_diff,
+    float* C_prev_diff,
+    float* X_diff,
+    const float forget_bias,
+    bool fast_activations,
+    CPUContext* context);
 } // namespace detail
 
 template <typename Context>
@@ -148,6 +187,9 @@ class LSTMUnitOp : public Operator<Context> {
             true)),
         drop_states_(OperatorBase::template GetSingleArgument<bool>(
             "drop_states",
+            false)),
+        fast_activations_(OperatorBase::template GetSingleArgument<bool>(
+            "fast_activations",
             false)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   using Operator<Context>::Operator;
@@ -194,6 +236,7 @@ class LSTMUnitOp : public Operator<Context> {
         C,
         H,
         forget_bias_,
+        fast_activations_,
         &context_);
     return true;
   }
@@ -213,6 +256,7 @@ class LSTMUnitOp : public Operator<Context> {
 
  private:
   bool drop_states_;
+  bool fast_activations_;
 };
 
 template <typename Context>
@@ -229,6 +273,9 @@ class LSTMUnitGradientOp : public Operator<Context> {
             true)),
         drop_states_(OperatorBase::template GetSingleArgument<bool>(
             "drop_states",
+            false)),
+        fast_activations_(OperatorBase::template GetSingleArgument<bool>(
+            "fast_activations",
             false)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
@@ -289,6 +336,7 @@ class LSTMUnitGradientOp : public Operator<Context> {
         C_prev_diff,
         X_diff,
         forget_bias_,
+        fast_activations_,
         &context_);
     return true;
   }
@@ -308,6 +356,7 @@ class LSTMUnitGradientOp : public Operator<Context> {
 
  private:
   bool drop_states_;
+  bool fast_activations_;
 };
 } // namespace caffe2
 
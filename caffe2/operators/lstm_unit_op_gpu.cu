@@ -121,6 +121,7 @@ void LSTMUnit<float, CUDAContext>(
     float* C,
     float* H,
     const float forget_bias,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   LSTMUnitKernel<float, float><<<
       CAFFE_GET_BLOCKS(N * D),
@@ -153,6 +154,7 @@ void LSTMUnit<float16, CUDAContext>(
     float16* C,
     float16* H,
     const float forget_bias,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   LSTMUnitKernel<float16, float><<<
       CAFFE_GET_BLOCKS(N * D),
@@ -189,6 +191,7 @@ void LSTMUnitGradient<float, CUDAContext>(
     float* C_prev_diff,
     float* X_diff,
     const float forget_bias,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   LSTMUnitGradientKernel<float, float><<<
       CAFFE_GET_BLOCKS(N * D),
@@ -229,6 +232,7 @@ void LSTMUnitGradient<float16, CUDAContext>(
     float16* C_prev_diff,
     float16* X_diff,
     const float forget_bias,
+    bool /*fast_activations*/,
     CUDAContext* context) {
   LSTMUnitGradientKernel<float16, float><<<
       CAFFE_GET_BLOCKS(N * D),
@@ -18,6 +18,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Sqr)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}})
     .IdenticalTypeAndShape()
     .SetDoc("Square (x^2) the elements of the input")
@@ -62,6 +63,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Sign)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .SetDoc("Computes sign for each element of the input: -1, 0 or 1.")
     .IdenticalTypeAndShape();
 SHOULD_NOT_DO_GRADIENT(Sign);
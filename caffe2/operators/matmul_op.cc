@@ -7,6 +7,7 @@ REGISTER_CPU_OPERATOR(MatMul, MatMulOp<float, CPUContext>);
 OPERATOR_SCHEMA(MatMul)
     .NumInputs(2, 3)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       vector<TensorShape> out(1);
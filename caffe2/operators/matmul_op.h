@@ -20,6 +20,11 @@ class MatMulOp final : public Operator<Context> {
   ~MatMulOp() {}
 
   bool RunOnDevice() override {
+    return DoRunWithType<T>();
+  }
+
+  template <typename TData>
+  bool DoRunWithType() {
     const auto& A = Input(0);
     const auto& B = Input(1);
     auto* Y = Output(0);
@@ -69,17 +74,17 @@ class MatMulOp final : public Operator<Context> {
     Y->Resize(Y_shape_cache_);
     CAFFE_ENFORCE(a_dim0 * b_dim1 == Y->size(), dimErrorString());
     // Y = A * B
-    math::Gemm<T, Context, Engine>(
+    math::Gemm<TData, Context, Engine>(
         trans_a_ ? CblasTrans : CblasNoTrans,
         trans_b_ ? CblasTrans : CblasNoTrans,
         a_dim0,
         b_dim1,
         a_dim1,
         1,
-        A.template data<T>(),
-        B.template data<T>(),
+        A.template data<TData>(),
+        B.template data<TData>(),
         0,
-        Y->template mutable_data<T>(),
+        Y->template mutable_data<TData>(),
         &context_);
 
     if (InputSize() == 3) {
@@ -4,6 +4,24 @@
 
 namespace caffe2 {
 
+template <>
+bool MatMulOp<float, CUDAContext, DefaultEngine>::RunOnDevice() {
+  return DispatchHelper<TensorTypes<float, float16>>::call(this, Input(0));
+}
+
 REGISTER_CUDA_OPERATOR(MatMul, MatMulOp<float, CUDAContext>);
 
+#if CUDA_VERSION >= 9000
+
+template <>
+bool MatMulOp<float, CUDAContext, TensorCoreEngine>::RunOnDevice() {
+  return DispatchHelper<TensorTypes<float, float16>>::call(this, Input(0));
+}
+
+REGISTER_CUDA_OPERATOR_WITH_ENGINE(
+    MatMul,
+    TENSORCORE,
+    MatMulOp<float, CUDAContext, TensorCoreEngine>);
+#endif
+
 }
@@ -0,0 +1,180 @@
+#include "caffe2/operators/multi_head_attention_op.h"
+
+#include <limits>
+
+namespace caffe2 {
+
+namespace attention {
+
+namespace {
+
+// Number of keys a query attends to
+inline int NumValidKeys(
+    int cols,
+    int query,
+    bool causal,
+    const int* lengths,
+    int example) {
+  int valid = cols;
+  if (lengths) {
+    valid = std::min(valid, lengths[example]);
+  }
+  if (causal) {
+    valid = std::min(valid, query + 1);
+  }
+  return std::max(valid, 0);
+}
+
+} // namespace
+
+template <>
+void MaskedSoftmax<CPUContext>(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    float* scores,
+    float* logSumExp,
+    CPUContext* /*context*/) {
+  for (int i = 0; i < rows; ++i) {
+    float* row = scores + i * cols;
+    const int valid =
+        NumValidKeys(cols, firstQuery + i, causal, lengths, example);
+    if (valid == 0) {
+      std::fill(row, row + cols, 0.0f);
+      logSumExp[i] = -std::numeric_limits<float>::infinity();
+      continue;
+    }
+    const float maxScore = *std::max_element(row, row + valid);
+    float sum = 0;
+    for (int j = 0; j < valid; ++j) {
+      row[j] = std::exp(row[j] - maxScore);
+      sum += row[j];
+    }
+    for (int j = 0; j < valid; ++j) {
+      row[j] /= sum;
+    }
+    std::fill(row + valid, row + cols, 0.0f);
+    logSumExp[i] = maxScore + std::log(sum);
+  }
+}
+
+template <>
+void MaskedProbabilities<CPUContext>(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    const float* logSumExp,
+    float* scores,
+    CPUContext* /*context*/) {
+  for (int i = 0; i < rows; ++i) {
+    float* row = scores + i * cols;
+    const int valid =
+        NumValidKeys(cols, firstQuery + i, causal, lengths, example);
+    for (int j = 0; j < valid; ++j) {
+      row[j] = std::exp(row[j] - logSumExp[i]);
+    }
+    std::fill(row + valid, row + cols, 0.0f);
+  }
+}
+
+template <>
+void SoftmaxGradient<CPUContext>(
+    int rows,
+    int cols,
+    int valueDim,
+    int ld,
+    const float* probs,
+    const float* output,
+    const float* dOutput,
+    float* dProbs,
+    CPUContext* /*context*/) {
+  for (int i = 0; i < rows; ++i) {
+    // sum_j probs_j * dProbs_j, from the output rather than over the keys
+    float dot = 0;
+    for (int k = 0; k < valueDim; ++k) {
+      dot += output[i * ld + k] * dOutput[i * ld + k];
+    }
+    for (int j = 0; j < cols; ++j) {
+      dProbs[i * cols + j] =
+          probs[i * cols + j] * (dProbs[i * cols + j] - dot);
+    }
+  }
+}
+
+} // namespace attention
+
+REGISTER_CPU_OPERATOR(MultiHeadAttention, MultiHeadAttentionOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    MultiHeadAttentionGradient,
+    MultiHeadAttentionGradientOp<CPUContext>);
+
+OPERATOR_SCHEMA(MultiHeadAttention)
+    .NumInputs(3, 4)
+    .NumOutputs(1, 2)
+    .SetDoc(R"DOC(
+Scaled dot-product attention with num_heads heads, fused into a single op:
+
+  output[b, i, h] = softmax_j(scale * queries[b, i, h] . keys[b, j, h])
+                    * values[b, j, h]
+
+where [b, i, h] is the slice of the last dimension of head h, the heads
+splitting it in num_heads equal parts. The keys can be masked by the lengths
+of the examples, and by the position of the query if causal.
+
+It replaces the chain of FC, BatchMatMul, Softmax and reduction ops of the
+attention models without materializing the [B, num_heads, T_q, T_k] scores:
+they are computed for block_size queries of a head at a time, and are
+recomputed by the gradient from the log_sum_exp output.
+)DOC")
+    .Arg("num_heads", "Number of heads, 1 by default")
+    .Arg("scale", "Scale of the scores, 1 / sqrt(head dim) by default")
+    .Arg("causal", "If set, query i only attends to the keys up to i")
+    .Arg(
+        "block_size",
+        "Number of queries whose scores are computed at once, 64 by default")
+    .Input(0, "queries", "Tensor of shape [B, T_q, num_heads * D]")
+    .Input(1, "keys", "Tensor of shape [B, T_k, num_heads * D]")
+    .Input(2, "values", "Tensor of shape [B, T_k, num_heads * D_v]")
+    .Input(
+        3,
+        "lengths",
+        "Optional int32 tensor [B] of the number of keys of the examples")
+    .Output(0, "output", "Tensor of shape [B, T_q, num_heads * D_v]")
+    .Output(
+        1,
+        "log_sum_exp",
+        "Tensor [B, num_heads, T_q] of the log of the softmax denominators, "
+        "required for the gradient");
+
+OPERATOR_SCHEMA(MultiHeadAttentionGradient).NumInputs(6, 7).NumOutputs(3);
+
+class GetMultiHeadAttentionGradient : public GradientMakerBase {
+  using GradientMakerBase::GradientMakerBase;
+  vector<OperatorDef> GetGradientDefs() override {
+    CAFFE_ENFORCE_EQ(
+        def_.output_size(),
+        2,
+        "The gradient of MultiHeadAttention needs its log_sum_exp output");
+    vector<string> inputs{I(0), I(1), I(2)};
+    if (def_.input_size() == 4) {
+      inputs.push_back(I(3));
+    }
+    inputs.push_back(O(0));
+    inputs.push_back(O(1));
+    inputs.push_back(GO(0));
+    return SingleGradientDef(
+        "MultiHeadAttentionGradient",
+        "",
+        inputs,
+        vector<string>{GI(0), GI(1), GI(2)});
+  }
+};
+REGISTER_GRADIENT(MultiHeadAttention, GetMultiHeadAttentionGradient);
+
+} // namespace caffe2
@@ -0,0 +1,198 @@
+#include "caffe2/operators/multi_head_attention_op.h"
+
+#include <cfloat>
+
+#include <cub/block/block_reduce.cuh>
+
+#include "caffe2/core/context_gpu.h"
+
+namespace caffe2 {
+
+namespace attention {
+
+namespace {
+
+// Number of keys a query attends to
+inline __device__ int NumValidKeys(
+    int cols,
+    int query,
+    bool causal,
+    const int* lengths,
+    int example) {
+  int valid = cols;
+  if (lengths) {
+    valid = min(valid, lengths[example]);
+  }
+  if (causal) {
+    valid = min(valid, query + 1);
+  }
+  return max(valid, 0);
+}
+
+// One block per row
+__global__ void MaskedSoftmaxKernel(
+    const int rows,
+    const int cols,
+    const int firstQuery,
+    const bool causal,
+    const int* lengths,
+    const int example,
+    float* scores,
+    float* logSumExp) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ float rowMax;
+  __shared__ float rowSum;
+
+  for (int i = blockIdx.x; i < rows; i += gridDim.x) {
+    float* row = scores + i * cols;
+    const int valid =
+        NumValidKeys(cols, firstQuery + i, causal, lengths, example);
+    float localMax = -FLT_MAX;
+    for (int j = threadIdx.x; j < valid; j += blockDim.x) {
+      localMax = max(localMax, row[j]);
+    }
+    const float blockMax =
+        BlockReduce(temp_storage).Reduce(localMax, cub::Max());
+    if (threadIdx.x == 0) {
+      rowMax = blockMax;
+    }
+    __syncthreads();
+
+    float localSum = 0;
+    for (int j = threadIdx.x; j < valid; j += blockDim.x) {
+      row[j] = expf(row[j] - rowMax);
+      localSum += row[j];
+    }
+    const float blockSum = BlockReduce(temp_storage).Sum(localSum);
+    if (threadIdx.x == 0) {
+      rowSum = blockSum;
+      logSumExp[i] = valid > 0 ? rowMax + logf(blockSum) : -INFINITY;
+    }
+    __syncthreads();
+
+    for (int j = threadIdx.x; j < cols; j += blockDim.x) {
+      row[j] = j < valid ? row[j] / rowSum : 0;
+    }
+    __syncthreads();
+  }
+}
+
+__global__ void MaskedProbabilitiesKernel(
+    const int rows,
+    const int cols,
+    const int firstQuery,
+    const bool causal,
+    const int* lengths,
+    const int example,
+    const float* logSumExp,
+    float* scores) {
+  CUDA_1D_KERNEL_LOOP(index, rows * cols) {
+    const int i = index / cols;
+    const int j = index % cols;
+    const int valid =
+        NumValidKeys(cols, firstQuery + i, causal, lengths, example);
+    scores[index] = j < valid ? expf(scores[index] - logSumExp[i]) : 0;
+  }
+}
+
+// One block per row
+__global__ void SoftmaxGradientKernel(
+    const int rows,
+    const int cols,
+    const int valueDim,
+    const int ld,
+    const float* probs,
+    const float* output,
+    const float* dOutput,
+    float* dProbs) {
+  typedef cub::BlockReduce<float, CAFFE_CUDA_NUM_THREADS> BlockReduce;
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+  __shared__ float rowDot;
+
+  for (int i = blockIdx.x; i < rows; i += gridDim.x) {
+    float localDot = 0;
+    for (int k = threadIdx.x; k < valueDim; k += blockDim.x) {
+      localDot += output[i * ld + k] * dOutput[i * ld + k];
+    }
+    const float blockDot = BlockReduce(temp_storage).Sum(localDot);
+    if (threadIdx.x == 0) {
+      rowDot = blockDot;
+    }
+    __syncthreads();
+
+    for (int j = threadIdx.x; j < cols; j += blockDim.x) {
+      const int index = i * cols + j;
+      dProbs[index] = probs[index] * (dProbs[index] - rowDot);
+    }
+    __syncthreads();
+  }
+}
+
+} // namespace
+
+template <>
+void MaskedSoftmax<CUDAContext>(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    float* scores,
+    float* logSumExp,
+    CUDAContext* context) {
+  MaskedSoftmaxKernel<<<
+      std::min(rows, CAFFE_MAXIMUM_NUM_BLOCKS),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      rows, cols, firstQuery, causal, lengths, example, scores, logSumExp);
+}
+
+template <>
+void MaskedProbabilities<CUDAContext>(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    const float* logSumExp,
+    float* scores,
+    CUDAContext* context) {
+  MaskedProbabilitiesKernel<<<
+      CAFFE_GET_BLOCKS(rows * cols),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      rows, cols, firstQuery, causal, lengths, example, logSumExp, scores);
+}
+
+template <>
+void SoftmaxGradient<CUDAContext>(
+    int rows,
+    int cols,
+    int valueDim,
+    int ld,
+    const float* probs,
+    const float* output,
+    const float* dOutput,
+    float* dProbs,
+    CUDAContext* context) {
+  SoftmaxGradientKernel<<<
+      std::min(rows, CAFFE_MAXIMUM_NUM_BLOCKS),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      rows, cols, valueDim, ld, probs, output, dOutput, dProbs);
+}
+
+} // namespace attention
+
+REGISTER_CUDA_OPERATOR(MultiHeadAttention, MultiHeadAttentionOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MultiHeadAttentionGradient,
+    MultiHeadAttentionGradientOp<CUDAContext>);
+
+} // namespace caffe2
@@ -0,0 +1,386 @@
+#ifndef CAFFE2_OPERATORS_MULTI_HEAD_ATTENTION_OP_H_
+#define CAFFE2_OPERATORS_MULTI_HEAD_ATTENTION_OP_H_
+
+#include <algorithm>
+#include <cmath>
+
+#include "caffe2/core/context.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace attention {
+
+// The helpers below work on a block of the attention of an example: rows
+// queries starting at query firstQuery, over its cols keys.
+// The keys at or after lengths[example] (if lengths isn't null), and after
+// the query if causal, are masked.
+
+// scores = softmax(scores) in place over the unmasked keys, logSumExp =
+// log(sum(exp(scores))) per row. Rows without any key get 0 probabilities.
+template <class Context>
+void MaskedSoftmax(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    float* scores,
+    float* logSumExp,
+    Context* context);
+
+// scores = exp(scores - logSumExp), the probabilities of the forward pass
+template <class Context>
+void MaskedProbabilities(
+    int rows,
+    int cols,
+    int firstQuery,
+    bool causal,
+    const int* lengths,
+    int example,
+    const float* logSumExp,
+    float* scores,
+    Context* context);
+
+// dProbs = probs * (dProbs - sum(dOutput * output)), the gradient of the
+// scores from the one of the probabilities, the sum being over the valueDim
+// columns of the rows of output and dOutput, which are ld apart
+template <class Context>
+void SoftmaxGradient(
+    int rows,
+    int cols,
+    int valueDim,
+    int ld,
+    const float* probs,
+    const float* output,
+    const float* dOutput,
+    float* dProbs,
+    Context* context);
+
+} // namespace attention
+
+// Scaled dot-product attention over num_heads heads, computed by blocks of
+// queries so that the scores of a block are the only ones in memory.
+template <class Context>
+class MultiHeadAttentionOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiHeadAttentionOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        numHeads_(OperatorBase::GetSingleArgument<int>("num_heads", 1)),
+        scale_(OperatorBase::GetSingleArgument<float>("scale", 0)),
+        causal_(OperatorBase::GetSingleArgument<bool>("causal", false)),
+        blockSize_(OperatorBase::GetSingleArgument<int>("block_size", 64)) {
+    CAFFE_ENFORCE_GT(numHeads_, 0);
+    CAFFE_ENFORCE_GT(blockSize_, 0);
+  }
+
+  bool RunOnDevice() override {
+    const auto& Q = Input(QUERIES);
+    const auto& K = Input(KEYS);
+    const auto& V = Input(VALUES);
+    CAFFE_ENFORCE_EQ(Q.ndim(), 3);
+    CAFFE_ENFORCE_EQ(K.ndim(), 3);
+    CAFFE_ENFORCE_EQ(V.ndim(), 3);
+    const int batchSize = Q.dim32(0);
+    const int numQueries = Q.dim32(1);
+    const int numKeys = K.dim32(1);
+    CAFFE_ENFORCE_EQ(K.dim32(0), batchSize);
+    CAFFE_ENFORCE_EQ(V.dim32(0), batchSize);
+    CAFFE_ENFORCE_EQ(V.dim32(1), numKeys);
+    CAFFE_ENFORCE_EQ(K.dim32(2), Q.dim32(2));
+    CAFFE_ENFORCE_EQ(Q.dim32(2) % numHeads_, 0);
+    CAFFE_ENFORCE_EQ(V.dim32(2) % numHeads_, 0);
+    const int ldQ = Q.dim32(2);
+    const int ldV = V.dim32(2);
+    const int headDim = ldQ / numHeads_;
+    const int valueDim = ldV / numHeads_;
+    const float scale = scale_ > 0 ? scale_ : 1.0f / std::sqrt(headDim);
+    const int* lengths = nullptr;
+    if (InputSize() > LENGTHS) {
+      CAFFE_ENFORCE_EQ(Input(LENGTHS).size(), batchSize);
+      lengths = Input(LENGTHS).template data<int>();
+    }
+
+    auto* output = Output(OUTPUT);
+    output->Resize(batchSize, numQueries, ldV);
+    auto* logSumExp = OutputSize() > LOG_SUM_EXP ? Output(LOG_SUM_EXP)
+                                                 : &logSumExp_;
+    logSumExp->Resize(batchSize, numHeads_, numQueries);
+    const int blockSize = std::min(blockSize_, numQueries);
+    scores_.Resize(blockSize, numKeys);
+
+    const float* q = Q.template data<float>();
+    const float* k = K.template data<float>();
+    const float* v = V.template data<float>();
+    float* out = output->template mutable_data<float>();
+    float* lse = logSumExp->template mutable_data<float>();
+    float* scores = scores_.template mutable_data<float>();
+    for (int b = 0; b < batchSize; ++b) {
+      for (int h = 0; h < numHeads_; ++h) {
+        const float* kHead = k + b * numKeys * ldQ + h * headDim;
+        const float* vHead = v + b * numKeys * ldV + h * valueDim;
+        for (int i = 0; i < numQueries; i += blockSize) {
+          const int rows = std::min(blockSize, numQueries - i);
+          const float* qBlock = q + (b * numQueries + i) * ldQ + h * headDim;
+          float* outBlock = out + (b * numQueries + i) * ldV + h * valueDim;
+          // scores = scale * Q K^T
+          math::GemmEx<float, Context>(
+              CblasNoTrans,
+              CblasTrans,
+              rows,
+              numKeys,
+              headDim,
+              scale,
+              qBlock,
+              ldQ,
+              kHead,
+              ldQ,
+              0,
+              scores,
+              numKeys,
+              &context_);
+          attention::MaskedSoftmax<Context>(
+              rows,
+              numKeys,
+              i,
+              causal_,
+              lengths,
+              b,
+              scores,
+              lse + (b * numHeads_ + h) * numQueries + i,
+              &context_);
+          // output = softmax(scores) V
+          math::GemmEx<float, Context>(
+              CblasNoTrans,
+              CblasNoTrans,
+              rows,
+              valueDim,
+              numKeys,
+              1,
+              scores,
+              numKeys,
+              vHead,
+              ldV,
+              0,
+              outBlock,
+              ldV,
+              &context_);
+        }
+      }
+    }
+    return true;
+  }
+
+ protected:
+  INPUT_TAGS(QUERIES, KEYS, VALUES, LENGTHS);
+  OUTPUT_TAGS(OUTPUT, LOG_SUM_EXP);
+
+  int numHeads_;
+  float scale_;
+  bool causal_;
+  int blockSize_;
+  Tensor<Context> scores_;
+  Tensor<Context> logSumExp_;
+};
+
+template <class Context>
+class MultiHeadAttentionGradientOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiHeadAttentionGradientOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        numHeads_(OperatorBase::GetSingleArgument<int>("num_heads", 1)),
+        scale_(OperatorBase::GetSingleArgument<float>("scale", 0)),
+        causal_(OperatorBase::GetSingleArgument<bool>("causal", false)),
+        blockSize_(OperatorBase::GetSingleArgument<int>("block_size", 64)) {
+    CAFFE_ENFORCE_GT(numHeads_, 0);
+    CAFFE_ENFORCE_GT(blockSize_, 0);
+  }
+
+  bool RunOnDevice() override {
+    // The lengths are optional, the inputs after them shift without them
+    const bool hasLengths = InputSize() == 7;
+    const int offset = hasLengths ? 0 : -1;
+    const auto& Q = Input(QUERIES);
+    const auto& K = Input(KEYS);
+    const auto& V = Input(VALUES);
+    const auto& O = Input(OUTPUT + offset);
+    const auto& lse = Input(LOG_SUM_EXP + offset);
+    const auto& dO = Input(OUTPUT_GRAD + offset);
+    const int batchSize = Q.dim32(0);
+    const int numQueries = Q.dim32(1);
+    const int numKeys = K.dim32(1);
+    const int ldQ = Q.dim32(2);
+    const int ldV = V.dim32(2);
+    const int headDim = ldQ / numHeads_;
+    const int valueDim = ldV / numHeads_;
+    const float scale = scale_ > 0 ? scale_ : 1.0f / std::sqrt(headDim);
+    CAFFE_ENFORCE(O.dims() == dO.dims());
+    CAFFE_ENFORCE_EQ(lse.size(), batchSize * numHeads_ * numQueries);
+    const int* lengths =
+        hasLengths ? Input(LENGTHS).template data<int>() : nullptr;
+
+    auto* dQ = Output(QUERIES_GRAD);
+    auto* dK = Output(KEYS_GRAD);
+    auto* dV = Output(VALUES_GRAD);
+    dQ->ResizeLike(Q);
+    dK->ResizeLike(K);
+    dV->ResizeLike(V);
+    const int blockSize = std::min(blockSize_, numQueries);
+    probs_.Resize(blockSize, numKeys);
+    dScores_.Resize(blockSize, numKeys);
+
+    const float* q = Q.template data<float>();
+    const float* k = K.template data<float>();
+    const float* v = V.template data<float>();
+    const float* out = O.template data<float>();
+    const float* dOut = dO.template data<float>();
+    const float* lseData = lse.template data<float>();
+    float* dq = dQ->template mutable_data<float>();
+    float* dk = dK->template mutable_data<float>();
+    float* dv = dV->template mutable_data<float>();
+    float* probs = probs_.template mutable_data<float>();
+    float* dScores = dScores_.template mutable_data<float>();
+    // dK and dV are accumulated over the query blocks
+    math::Set<float, Context>(dK->size(), 0, dk, &context_);
+    math::Set<float, Context>(dV->size(), 0, dv, &context_);
+    for (int b = 0; b < batchSize; ++b) {
+      for (int h = 0; h < numHeads_; ++h) {
+        const float* kHead = k + b * numKeys * ldQ + h * headDim;
+        const float* vHead = v + b * numKeys * ldV + h * valueDim;
+        float* dkHead = dk + b * numKeys * ldQ + h * headDim;
+        float* dvHead = dv + b * numKeys * ldV + h * valueDim;
+        for (int i = 0; i < numQueries; i += blockSize) {
+          const int rows = std::min(blockSize, numQueries - i);
+          const int qOffset = (b * numQueries + i) * ldQ + h * headDim;
+          const int vOffset = (b * numQueries + i) * ldV + h * valueDim;
+          // The probabilities are recomputed rather than stored
+          math::GemmEx<float, Context>(
+              CblasNoTrans,
+              CblasTrans,
+              rows,
+              numKeys,
+              headDim,
+              scale,
+              q + qOffset,
+              ldQ,
+              kHead,
+              ldQ,
+              0,
+              probs,
+              numKeys,
+              &context_);
+          attention::MaskedProbabilities<Context>(
+              rows,
+              numKeys,
+              i,
+              causal_,
+              lengths,
+              b,
+              lseData + (b * numHeads_ + h) * numQueries + i,
+              probs,
+              &context_);
+          // dV += P^T dO
+          math::GemmEx<float, Context>(
+              CblasTrans,
+              CblasNoTrans,
+              numKeys,
+              valueDim,
+              rows,
+              1,
+              probs,
+              numKeys,
+              dOut + vOffset,
+              ldV,
+              1,
+              dvHead,
+              ldV,
+              &context_);
+          // dP = dO V^T, then dS in place
+          math::GemmEx<float, Context>(
+              CblasNoTrans,
+              CblasTrans,
+              rows,
+              numKeys,
+              valueDim,
+              1,
+              dOut + vOffset,
+              ldV,
+              vHead,
+              ldV,
+              0,
+              dScores,
+              numKeys,
+              &context_);
+          attention::SoftmaxGradient<Context>(
+              rows,
+              numKeys,
+              valueDim,
+              ldV,
+              probs,
+              out + vOffset,
+              dOut + vOffset,
+              dScores,
+              &context_);
+          // dQ = scale * dS K, dK += scale * dS^T Q
+          math::GemmEx<float, Context>(
+              CblasNoTrans,
+              CblasNoTrans,
+              rows,
+              headDim,
+              numKeys,
+              scale,
+              dScores,
+              numKeys,
+              kHead,
+              ldQ,
+              0,
+              dq + qOffset,
+              ldQ,
+              &context_);
+          math::GemmEx<float, Context>(
+              CblasTrans,
+              CblasNoTrans,
+              numKeys,
+              headDim,
+              rows,
+              scale,
+              dScores,
+              numKeys,
+              q + qOffset,
+              ldQ,
+              1,
+              dkHead,
+              ldQ,
+              &context_);
+        }
+      }
+    }
+    return true;
+  }
+
+ protected:
+  INPUT_TAGS(
+      QUERIES,
+      KEYS,
+      VALUES,
+      LENGTHS,
+      OUTPUT,
+      LOG_SUM_EXP,
+      OUTPUT_GRAD);
+  OUTPUT_TAGS(QUERIES_GRAD, KEYS_GRAD, VALUES_GRAD);
+
+  int numHeads_;
+  float scale_;
+  bool causal_;
+  int blockSize_;
+  Tensor<Context> probs_;
+  Tensor<Context> dScores_;
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_MULTI_HEAD_ATTENTION_OP_H_
@@ -21,6 +21,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Negative)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .AllowInplace({{0, 0}})
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
@@ -11,7 +11,8 @@ template <typename T, class Context>
 class NormalizeL1Op final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(NormalizeL1Op)
+  NormalizeL1Op(const OperatorDef& def, Workspace* ws)
+      : Operator<Context>(def, ws), OP_SINGLE_ARG(int, "axis", axis_, -1) {}
 
   bool RunOnDevice() override {
     const auto& x = Input(0);
@@ -20,8 +21,7 @@ class NormalizeL1Op final : public Operator<Context> {
     y->ResizeLike(x);
     auto* yData = y->template mutable_data<T>();
 
-    const auto canonical_axis = x.canonical_axis_index(
-        OperatorBase::GetSingleArgument<int>("axis", -1));
+    const auto canonical_axis = x.canonical_axis_index(axis_);
     const int m = x.dim32(canonical_axis);
     const int n = x.size() / m;
     const int sf = x.size_from_dim(canonical_axis + 1);
@@ -30,6 +30,8 @@ class NormalizeL1Op final : public Operator<Context> {
   }
 
  private:
+  const int axis_;
+
   void
   DoNormalize(const T* xData, T* yData, const int m, const int n, const int sf);
 };
@@ -61,6 +61,7 @@ REGISTER_CPU_OPERATOR(Normalize, NormalizeOp<float, CPUContext>);
 OPERATOR_SCHEMA(Normalize)
     .NumInputs(1)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<3>)
     .Arg("axis", "axis to normalize")
     .SetDoc(R"DOC(
 Given a matrix, apply L2-normalization along the specified dimension.
@@ -12,7 +12,7 @@ class NormalizeOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   NormalizeOp(const OperatorDef& def, Workspace* ws)
-      : Operator<Context>(def, ws) {}
+      : Operator<Context>(def, ws), OP_SINGLE_ARG(int, "axis", axis_, -1) {}
 
   bool RunOnDevice() override {
     const auto& x = Input(0);
@@ -21,8 +21,7 @@ class NormalizeOp final : public Operator<Context> {
     y->ResizeLike(x);
     auto* yData = y->template mutable_data<T>();
 
-    const auto canonical_axis = x.canonical_axis_index(
-        OperatorBase::GetSingleArgument<int>("axis", -1));
+    const auto canonical_axis = x.canonical_axis_index(axis_);
     const int m = x.dim32(canonical_axis);
     const int n = x.size() / m;
     const int sf = x.size_from_dim(canonical_axis + 1);
@@ -31,6 +30,8 @@ class NormalizeOp final : public Operator<Context> {
   }
 
  private:
+  const int axis_;
+
   void
   DoNormalize(const T* xData, T* yData, const int m, const int n, const int sf);
 };
@@ -40,7 +41,7 @@ class NormalizeGradientOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   NormalizeGradientOp(const OperatorDef& def, Workspace* ws)
-      : Operator<Context>(def, ws) {}
+      : Operator<Context>(def, ws), OP_SINGLE_ARG(int, "axis", axis_, -1) {}
 
   bool RunOnDevice() override {
     const auto& x = Input(0);
@@ -52,8 +53,7 @@ class NormalizeGradientOp final : public Operator<Context> {
     const auto* gOutData = gOut.template data<T>();
     auto* gInData = gIn->template mutable_data<T>();
 
-    const auto canonical_axis = x.canonical_axis_index(
-        OperatorBase::GetSingleArgument<int>("axis", -1));
+    const auto canonical_axis = x.canonical_axis_index(axis_);
     const int m = x.dim32(canonical_axis);
     const int n = x.size() / m;
     const int sf = x.size_from_dim(canonical_axis + 1);
@@ -62,6 +62,8 @@ class NormalizeGradientOp final : public Operator<Context> {
   }
 
  private:
+  const int axis_;
+
   void DoNormalize(
       const T* xData,
       const T* gOutData,
@@ -100,8 +100,7 @@ bool NormalizeGradientOp<float, CUDAContext>::RunOnDevice() {
   auto* dX = Output(0);
   dX->ResizeLike(X);
 
-  const auto canonical_axis =
-      X.canonical_axis_index(OperatorBase::GetSingleArgument<int>("axis", -1));
+  const auto canonical_axis = X.canonical_axis_index(axis_);
   int N = X.dim32(canonical_axis);
   int M = X.size() / N;
   const int SF = X.size_from_dim(canonical_axis + 1);
@@ -1,10 +1,12 @@
 #ifndef CAFFE2_OPERATORS_OPERATOR_FALLBACK_H_
 #define CAFFE2_OPERATORS_OPERATOR_FALLBACK_H_
 
+#include "caffe2/core/asan.h"
 #include "caffe2/core/common.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/proto/caffe2.pb.h"
 
 namespace caffe2 {
@@ -29,6 +31,14 @@ namespace caffe2 {
  *     REGISTER_CUDA_OPERATOR(MyMagic,
  *                            GPUFallbackOp<MyMagicOp>);
  *
+ * Inputs are copied to the CPU only when they change, as told by their
+ * address, data, shape and version(), so parameters and other inputs that
+ * stay the same across runs are copied once. The copies are staged in pinned
+ * memory, and so run asynchronously, whatever the CPU allocator of the
+ * workspace. The bytes copied each way, and the input bytes spared by the
+ * cache, are exported as the stats of the "gpu_fallback/<type>" group, to
+ * tell which operators most need a CUDA implementation.
+ *
  * Advanced usage: if you want to have some specific outputs never copied, you
  * can use the SkipOutputCopy template argument to do that. For example, if
  * MyMagic produces two outputs and the first output is always going to live on
@@ -41,8 +51,12 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
  public:
   USE_OPERATOR_FUNCTIONS(CUDAContext);
   GPUFallbackOp(const OperatorDef& def, Workspace* ws)
-      : Operator<CUDAContext>(def, ws) {
+      : Operator<CUDAContext>(def, ws), stats_("gpu_fallback/" + def.type()) {
     CAFFE_ENFORCE_EQ(def.device_option().device_type(), CUDA);
+#if !CAFFE2_ASAN_ENABLED
+    // Both the staging tensors and those the base op allocates are pinned
+    local_ws_.SetCPUAllocator(std::make_shared<CachingPinnedCPUAllocator>());
+#endif
     OperatorDef base_def_(def);
     // base_def_ runs on CPU, so we will set its device option to CPU.
     base_def_.clear_device_option();
@@ -57,15 +71,46 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
       local_output_blobs_.push_back(local_ws_.GetBlob(name));
       CHECK_NOTNULL(local_output_blobs_.back());
     }
+    cached_inputs_.resize(def.input_size());
+  }
+
+  ~GPUFallbackOp() {
+    // The output copies of an async run may still read the staging tensors
+    if (outputs_in_flight_) {
+      cudaStreamSynchronize(context_.cuda_stream());
+    }
   }
 
   bool RunOnDevice() override {
-    bool need_sync = false;
+    // The base op must not write the staging tensors of the outputs before
+    // the copies of the previous run are done
+    bool need_sync = outputs_in_flight_;
     for (int i = 0; i < InputSize(); ++i) {
+      auto& cached = cached_inputs_[i];
       if (OperatorBase::InputIsType<TensorCUDA>(i)) {
-        local_input_blobs_[i]->template GetMutable<TensorCPU>()->CopyFrom(
-            Input(i), &context_);
+        const auto& input = Input(i);
+        if (cached.external) {
+          // Do not copy into the tensor shared by the previous run
+          local_input_blobs_[i]->Reset();
+          cached = CachedInput();
+        }
+        auto* local = local_input_blobs_[i]->template GetMutable<TensorCPU>();
+        const size_t nbytes = input.nbytes();
+        if (&input == cached.tensor && input.version() == cached.version &&
+            input.raw_data() == cached.data && input.dims() == cached.dims &&
+            local->version() == cached.local_version) {
+          CAFFE_EVENT(stats_, input_bytes_cached, nbytes);
+          continue;
+        }
+        local->CopyFrom(input, &context_);
         need_sync = true;
+        CAFFE_EVENT(stats_, input_bytes_copied, nbytes);
+        cached.tensor = &input;
+        cached.version = input.version();
+        cached.data = input.raw_data();
+        cached.dims = input.dims();
+        // Changes if the base op writes its input in place
+        cached.local_version = local->version();
       } else {
         VLOG(1) << "Input " << i << " is not TensorCUDA. Skipping copy.";
         // Note(jiayq): This removes a const but conceptually
@@ -74,12 +119,15 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
         local_input_blobs_[i]->ShareExternal(
             const_cast<void*>(OperatorBase::Inputs()[i]->GetRaw()),
             OperatorBase::Inputs()[i]->meta());
+        cached = CachedInput();
+        cached.external = true;
       }
     }
 
     // Sync to make sure copies are done.
     if (need_sync) {
       context_.FinishDeviceComputation();
+      outputs_in_flight_ = false;
     }
 
     if (!base_op_->Run()) {
@@ -96,17 +144,41 @@ class GPUFallbackOp final : public Operator<CUDAContext> {
           local_output_blobs_[i]->template IsType<TensorCPU>(),
           "GPU fallback op currently does not support non-TensorCPU "
           "output type who needs copying.");
-      Output(i)->CopyFrom(
-          local_output_blobs_[i]->template Get<TensorCPU>(), &context_);
+      const auto& local = local_output_blobs_[i]->template Get<TensorCPU>();
+      Output(i)->CopyFrom(local, &context_);
+      outputs_in_flight_ = true;
+      CAFFE_EVENT(stats_, output_bytes_copied, local.nbytes());
     }
     return true;
   }
 
  protected:
+  // The CUDA input last copied to a local blob, and the version of its copy
+  struct CachedInput {
+    const TensorCUDA* tensor = nullptr;
+    uint64_t version = 0;
+    const void* data = nullptr;
+    vector<TIndex> dims;
+    uint64_t local_version = 0;
+    // Whether the local blob shares a non-CUDA input instead
+    bool external = false;
+  };
+
+  struct GPUFallbackStats {
+    CAFFE_STAT_CTOR(GPUFallbackStats);
+    CAFFE_EXPORTED_STAT(input_bytes_copied);
+    CAFFE_EXPORTED_STAT(input_bytes_cached);
+    CAFFE_EXPORTED_STAT(output_bytes_copied);
+  };
+
   Workspace local_ws_;
   vector<Blob*> local_input_blobs_;
   vector<Blob*> local_output_blobs_;
   std::unique_ptr<CPUOp> base_op_;
+  vector<CachedInput> cached_inputs_;
+  // Whether output copies may still be running on the stream
+  bool outputs_in_flight_ = false;
+  GPUFallbackStats stats_;
 };
 
 } // namespace caffe2
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
 #include "caffe2/operators/operator_fallback_gpu.h"
 #include <gtest/gtest.h>
 
@@ -79,4 +80,37 @@ TEST(OperatorFallbackTest, GPUIncrementByOneOp) {
   }
 }
 
+TEST(OperatorFallbackTest, GPUUnchangedInputsAreCopiedOnce) {
+  if (!HasCudaGPU()) return;
+  OperatorDef op_def = CreateOperatorDef(
+      "IncrementByOne", "", vector<string>{"X"},
+      vector<string>{"Y"});
+  op_def.mutable_device_option()->set_device_type(CUDA);
+  Workspace ws;
+  TensorCPU source_tensor(vector<TIndex>{2, 3});
+  for (int i = 0; i < 6; ++i) {
+    source_tensor.mutable_data<float>()[i] = i;
+  }
+  auto* input = ws.CreateBlob("X")->GetMutable<TensorCUDA>();
+  input->CopyFrom(source_tensor);
+  unique_ptr<OperatorBase> op(CreateOperator(op_def, &ws));
+  EXPECT_TRUE(op.get() != nullptr);
+  StatRegistry::get().publish();
+  EXPECT_TRUE(op->Run());
+  EXPECT_TRUE(op->Run());
+  // Writing the input makes the next run copy it again
+  input->CopyFrom(source_tensor);
+  EXPECT_TRUE(op->Run());
+
+  auto stats = toMap(StatRegistry::get().publish());
+  const std::string prefix = "gpu_fallback/IncrementByOne/";
+  EXPECT_EQ(stats[prefix + "input_bytes_copied"], 2 * 6 * sizeof(float));
+  EXPECT_EQ(stats[prefix + "input_bytes_cached"], 6 * sizeof(float));
+  EXPECT_EQ(stats[prefix + "output_bytes_copied"], 3 * 6 * sizeof(float));
+  TensorCPU output_cpu(ws.GetBlob("Y")->Get<TensorCUDA>());
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(output_cpu.data<float>()[i], i + 1);
+  }
+}
+
 }  // namespace caffe2
@@ -1,5 +1,7 @@
 #include "caffe2/operators/order_switch_ops.h"
 
+#include "caffe2/utils/math.h"
+
 namespace caffe2 {
 
 template <>
@@ -9,17 +11,18 @@ bool NHWC2NCHWOp<float, CPUContext>::RunOnDevice() {
   CAFFE_ENFORCE(X.ndim() == 4);
   const int N = X.dim32(0), H = X.dim32(1), W = X.dim32(2), C = X.dim32(3);
   Y->Resize(N, C, H, W);
-  const float* Xdata = X.data<float>();
-  float* Ydata = Y->mutable_data<float>();
-  for (int n = 0; n < N; ++n) {
-    for (int h = 0; h < H; ++h) {
-      for (int w = 0; w < W; ++w) {
-        for (int c = 0; c < C; ++c) {
-          Ydata[((n * C + c) * H + h) * W + w] = *(Xdata++);
-        }
-      }
-    }
-  }
+  const int x_dims[] = {N, H, W, C};
+  const int y_dims[] = {N, C, H, W};
+  const int axes[] = {0, 3, 1, 2};
+  math::Transpose<float, CPUContext>(
+      4,
+      x_dims,
+      y_dims,
+      axes,
+      X.size(),
+      X.data<float>(),
+      Y->mutable_data<float>(),
+      &context_);
   return true;
 }
 
@@ -30,21 +33,21 @@ bool NCHW2NHWCOp<float, CPUContext>::RunOnDevice() {
   CAFFE_ENFORCE(X.ndim() == 4);
   const int N = X.dim32(0), C = X.dim32(1), H = X.dim32(2), W = X.dim32(3);
   Y->Resize(N, H, W, C);
-  const float* Xdata = X.data<float>();
-  float* Ydata = Y->mutable_data<float>();
-  for (int n = 0; n < N; ++n) {
-    for (int c = 0; c < C; ++c) {
-      for (int h = 0; h < H; ++h) {
-        for (int w = 0; w < W; ++w) {
-          Ydata[((n * H + h) * W + w) * C + c] = *(Xdata++);
-        }
-      }
-    }
-  }
+  const int x_dims[] = {N, C, H, W};
+  const int y_dims[] = {N, H, W, C};
+  const int axes[] = {0, 2, 3, 1};
+  math::Transpose<float, CPUContext>(
+      4,
+      x_dims,
+      y_dims,
+      axes,
+      X.size(),
+      X.data<float>(),
+      Y->mutable_data<float>(),
+      &context_);
   return true;
 }
 
-
 REGISTER_CPU_OPERATOR(NHWC2NCHW, NHWC2NCHWOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(NCHW2NHWC, NCHW2NHWCOp<float, CPUContext>);
 
@@ -66,6 +69,10 @@ OPERATOR_SCHEMA(NHWC2NCHW)
 The operator switches the order of data in a tensor from NHWC- sample index N,
 height H, width H and channels C, to the NCHW order.
 )DOC")
+    .Arg(
+        "num_threads",
+        "Threads of the workspace thread pool large outputs are split "
+        "between on CPU: 0 (default) for all, 1 for the calling thread.")
     .Input(0, "data", "The input data (Tensor<float>) in the NHWC order.")
     .Output(
         0,
@@ -77,6 +84,10 @@ OPERATOR_SCHEMA(NCHW2NHWC).NumInputs(1).NumOutputs(1)
 The operator switches the order of data in a tensor from NCHW- sample index N,
 channels C, height H and width W, to the NHWC order.
 )DOC")
+  .Arg(
+      "num_threads",
+      "Threads of the workspace thread pool large outputs are split "
+      "between on CPU: 0 (default) for all, 1 for the calling thread.")
   .Input(0, "data", "The input data (Tensor<float>) in the NCHW order.")
   .Output(0, "output", "The output tensor (Tensor<float>) in the NHWC order.");
 
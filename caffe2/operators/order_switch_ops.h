@@ -2,6 +2,7 @@
 #define CAFFE2_OPERATORS_ORDER_SWITCH_OPS_H_
 
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_op_shared.h"
 
 namespace caffe2 {
 
@@ -12,8 +13,12 @@ namespace caffe2 {
 template <typename T, class Context>
 class NHWC2NCHWOp final : public Operator<Context> {
  public:
-  USE_SIMPLE_CTOR_DTOR(NHWC2NCHWOp);
   USE_OPERATOR_CONTEXT_FUNCTIONS;
+  NHWC2NCHWOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws) {
+    useMathThreadPool<Context>(
+        ws, OperatorBase::GetSingleArgument<int>("num_threads", 0), &context_);
+  }
   bool RunOnDevice() override;
 
  protected:
@@ -22,8 +27,12 @@ class NHWC2NCHWOp final : public Operator<Context> {
 template <typename T, class Context>
 class NCHW2NHWCOp final : public Operator<Context> {
  public:
-  USE_SIMPLE_CTOR_DTOR(NCHW2NHWCOp);
   USE_OPERATOR_CONTEXT_FUNCTIONS;
+  NCHW2NHWCOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws) {
+    useMathThreadPool<Context>(
+        ws, OperatorBase::GetSingleArgument<int>("num_threads", 0), &context_);
+  }
   bool RunOnDevice() override;
 
  protected:
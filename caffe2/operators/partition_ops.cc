@@ -53,6 +53,12 @@ X_0_part_0, X_1_part_0, ..., X_N-1_part_0, X_0_part_1, ..., X_N-1_part_K-1
         "pack_first_input",
         "(int, default 0) If set, the operator transforms "
         "the first tensor values as floor(X_ij / num_partitions)")
+    .Arg(
+        "num_threads",
+        "(int, default 0) Number of threads of the workspace pool to "
+        "partition large inputs with, 0 for all of them and 1 to partition "
+        "on the calling thread only. The order of the elements within each "
+        "partition doesn't depend on it.")
     .Input(
         0,
         "input",
@@ -94,6 +100,12 @@ X_0_part_0, X_1_part_0, ..., X_N-1_part_0, X_0_part_1, ..., X_N-1_part_K-1
         "pack_first_input",
         "(int, default 0) If set, the operator transforms "
         "the first tensor values as floor(X_ij / num_partitions)")
+    .Arg(
+        "num_threads",
+        "(int, default 0) Number of threads of the workspace pool to "
+        "partition large inputs with, 0 for all of them and 1 to partition "
+        "on the calling thread only. The order of the elements within each "
+        "partition doesn't depend on it.")
     .Input(
         0,
         "input",
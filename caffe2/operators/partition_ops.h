@@ -1,8 +1,12 @@
 #ifndef CAFFE2_OPERATORS_PARTITION_OPS_H_
 #define CAFFE2_OPERATORS_PARTITION_OPS_H_
 
+#include <cstring>
+#include <functional>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/fixed_divisor.h"
 
 namespace caffe2 {
 
@@ -14,6 +18,17 @@ static inline int moduloPartition(Index key, int numPartitions) {
   return shard;
 }
 
+// moduloPartition with the division by numPartitions precomputed in divisor
+template <typename Index>
+static inline int moduloPartition(
+    Index key,
+    const FixedDivisor<int64_t>& divisor,
+    int numPartitions) {
+  int shard = static_cast<int>(divisor.mod(key));
+  shard += numPartitions & (shard >> (sizeof(int) * 8 - 1));
+  return shard;
+}
+
 class GatherByKeyOp : public Operator<CPUContext> {
  public:
   USE_DISPATCH_HELPER;
@@ -107,9 +122,19 @@ class PartitionOpBase : public Operator<CPUContext> {
 
   PartitionOpBase(const OperatorDef& operator_def, Workspace* ws)
       : Operator<CPUContext>(operator_def, ws),
-        OP_SINGLE_ARG(int, "pack_first_input", pack_first_input_, 0) {}
+        ws_(ws),
+        OP_SINGLE_ARG(int, "pack_first_input", pack_first_input_, 0),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 0) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
 
  protected:
+  // Partitions the inputs in three passes over ranges of the main input,
+  // which are split between the threads of the workspace thread pool for
+  // large inputs: the shard of every element and the histogram of every range
+  // are computed, then the prefix sums of the histograms give where every
+  // range writes in every partition, then the elements are copied there. The
+  // elements keep their order within a partition.
   template <typename Index>
   void ApplyPartition(bool skipFirstArgument) {
     CAFFE_ENFORCE_EQ(
@@ -124,10 +149,27 @@ class PartitionOpBase : public Operator<CPUContext> {
     auto& main_input = Input(mainInputIndex);
     TIndex size = main_input.size();
     const Index* data = main_input.template data<Index>();
-    counts_.assign(partitions, 0);
-    for (TIndex p = 0; p < size; p++) {
-      int shard = moduloPartition(data[p], partitions);
-      ++counts_[shard];
+    const FixedDivisor<int64_t> divisor(partitions);
+    const int num_ranges = NumRanges(size);
+    shards_.resize(size);
+    counts_.assign(num_ranges * partitions, 0);
+    ParallelFor(num_ranges, size, [&](int range, TIndex begin, TIndex end) {
+      TIndex* counts = counts_.data() + range * partitions;
+      for (TIndex p = begin; p < end; p++) {
+        int shard = moduloPartition(data[p], divisor, partitions);
+        shards_[p] = shard;
+        ++counts[shard];
+      }
+    });
+    // counts_ becomes the offset of every range in every partition
+    totals_.assign(partitions, 0);
+    for (int range = 0; range < num_ranges; ++range) {
+      TIndex* counts = counts_.data() + range * partitions;
+      for (int j = 0; j < partitions; ++j) {
+        const TIndex count = counts[j];
+        counts[j] = totals_[j];
+        totals_[j] += count;
+      }
     }
 
     raw_datas_.resize(inputSize);
@@ -163,40 +205,89 @@ class PartitionOpBase : public Operator<CPUContext> {
       for (int j = 0; j < partitions; ++j) {
         int out_idx = i + j * inputSize;
         auto output = Output(out_idx);
-        shape[0] = counts_[j];
+        shape[0] = totals_[j];
         output->Resize(shape);
         out_datas_[out_idx] = output->raw_mutable_data(input.meta());
       }
     }
 
-    counts_.assign(partitions, 0);
-    for (TIndex p = 0; p < size; p++) {
-      int shard = moduloPartition(data[p], partitions);
-      TIndex idx = counts_[shard]++;
-
-      // special case first input
-      static_cast<Index*>(out_datas_[shard * inputSize + mainInputIndex])[idx] =
-          pack_first_input_ ? ((data[p] - shard) / partitions) : data[p];
-
-      int baseIndex = shard * inputSize;
-      for (int i = mainInputIndex + 1; i < inputSize; ++i) {
-        auto bs = block_sizes_[i];
-        auto meta = metas_[i];
-        // special case for small bs?
-        context_.template CopyItems<CPUContext, CPUContext>(
-            meta,
-            bs,
-            static_cast<const char*>(raw_datas_[i]) + p * bs * meta.itemsize(),
-            static_cast<char*>(out_datas_[baseIndex + i]) +
-                idx * bs * meta.itemsize());
+    ParallelFor(num_ranges, size, [&](int range, TIndex begin, TIndex end) {
+      TIndex* offsets = counts_.data() + range * partitions;
+      for (TIndex p = begin; p < end; p++) {
+        int shard = shards_[p];
+        TIndex idx = offsets[shard]++;
+
+        // special case first input
+        static_cast<Index*>(
+            out_datas_[shard * inputSize + mainInputIndex])[idx] =
+            pack_first_input_ ? divisor.div(data[p] - shard) : data[p];
+
+        int baseIndex = shard * inputSize;
+        for (int i = mainInputIndex + 1; i < inputSize; ++i) {
+          auto bs = block_sizes_[i];
+          const auto& meta = metas_[i];
+          const char* src = static_cast<const char*>(raw_datas_[i]) +
+              p * bs * meta.itemsize();
+          char* dst = static_cast<char*>(out_datas_[baseIndex + i]) +
+              idx * bs * meta.itemsize();
+          if (meta.copy()) {
+            context_.template CopyItems<CPUContext, CPUContext>(
+                meta, bs, src, dst);
+          } else if (bs * meta.itemsize() == 4) {
+            // Inlined copies of the common sizes of a single value
+            memcpy(dst, src, 4);
+          } else if (bs * meta.itemsize() == 8) {
+            memcpy(dst, src, 8);
+          } else {
+            memcpy(dst, src, bs * meta.itemsize());
+          }
+        }
       }
+    });
+  }
+
+  // Number of ranges to split size elements in, 1 runs on the calling thread
+  int NumRanges(TIndex size) {
+    // Below this many elements per range, waking up the threads costs more
+    // than it saves
+    constexpr TIndex kMinElementsPerRange = 1 << 14;
+    if (num_threads_ == 1 || size < 2 * kMinElementsPerRange) {
+      return 1;
     }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return static_cast<int>(
+        std::min<TIndex>(threads, size / kMinElementsPerRange));
   }
 
+  // Runs fn(range, begin, end) on num_ranges ranges splitting [0, size)
+  void ParallelFor(
+      int num_ranges,
+      TIndex size,
+      const std::function<void(int, TIndex, TIndex)>& fn) {
+    if (num_ranges <= 1) {
+      fn(0, 0, size);
+      return;
+    }
+    ws_->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+      fn(range, range * size / num_ranges, (range + 1) * size / num_ranges);
+    });
+  }
+
+  Workspace* ws_;
   bool pack_first_input_;
+  // 0 uses all threads of the workspace thread pool for large inputs, 1
+  // runs on the calling thread
+  int num_threads_;
 
   // use member fields to reuse memory
+  // Shard of every element of the main input
+  vector<int32_t> shards_;
+  // Histogram, then offsets, of every range in every partition
   vector<TIndex> counts_;
+  vector<TIndex> totals_;
   vector<TIndex> block_sizes_;
   vector<TypeMeta> metas_;
   vector<const void*> raw_datas_;
@@ -252,9 +343,7 @@ class LengthsPartitionOp : public PartitionOpBase {
     ApplyPartition<Index>(true /* skipFirstArgument */);
 
     // Compute lengths after sharding
-    auto& main_input = Input(1);
-    TIndex size = main_input.size();
-    const Index* data = main_input.template data<Index>();
+    TIndex size = Input(1).size();
 
     auto& length_input = Input(0);
     TIndex elements = length_input.size();
@@ -280,8 +369,7 @@ class LengthsPartitionOp : public PartitionOpBase {
         out_length_[j][i] = 0;
       }
       for (int j = 0; j < lengths_data[i]; ++j, ++index) {
-        int shard = moduloPartition(data[index], partitions);
-        ++out_length_[shard][i];
+        ++out_length_[shards_[index]][i];
       }
     }
     return true;
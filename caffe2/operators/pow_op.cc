@@ -82,6 +82,7 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Pow)
     .NumInputs(1, 2)
     .NumOutputs(1)
+    .CostInferenceFunction(PointwiseCostInference<1>)
     .Arg("exponent", "The exponent of the power function.")
     .AllowInplace({{0, 0}, {1, 0}})
     .IdenticalTypeAndShapeOfInput(0)
@@ -2,11 +2,16 @@
 #define CAFFE2_OPERATORS_PREFETCH_OP_H_
 
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <thread> // NOLINT
+#include <vector>
 
+#include "caffe2/core/blob_stats.h"
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/timer.h"
 
 namespace caffe2 {
 
@@ -17,6 +22,15 @@ namespace caffe2 {
 // For any operator that is derived from PrefetchOperator, it should
 // explicitly call the Finalize() function in its destructor, so that the
 // prefetching thread is properly destructed.
+//
+// With the prefetch_depth argument N > 1, up to N batches are prefetched
+// ahead: the prefetching thread runs both Prefetch() and CopyPrefetched(),
+// with the outputs bound to the blobs of one of N slots, and Run() swaps
+// the oldest slot with the outputs. Derived classes must then only write
+// their outputs in CopyPrefetched() and copy, not share, the prefetched data.
+//
+// The prefetched batches are reported with the queue stats of BlobsQueue,
+// under prefetch/<operator name or first output>.
 
 // Note: We inherit from OperatorBase since we control the
 // synchronization properties of this operator ourselves (we inform
@@ -31,8 +45,23 @@ class PrefetchOperator : public OperatorBase {
         prefetched_(false),
         prefetch_success_(true),
         finalize_(false),
-        no_prefetch_(GetSingleArgument<bool>("no_prefetch", false)) {
+        no_prefetch_(GetSingleArgument<bool>("no_prefetch", false)),
+        prefetch_depth_(GetSingleArgument<int>("prefetch_depth", 1)),
+        prefetch_stats_(
+            "prefetch/" +
+            (operator_def.name().empty() ? operator_def.output(0)
+                                         : operator_def.name())) {
+    CAFFE_ENFORCE_GT(prefetch_depth_, 0);
     context_.SwitchToDevice(0);
+    if (prefetch_depth_ > 1) {
+      output_blobs_ = Outputs();
+      slots_.resize(prefetch_depth_);
+      for (auto& slot : slots_) {
+        for (int i = 0; i < OutputSize(); ++i) {
+          slot.blobs.emplace_back(new Blob());
+        }
+      }
+    }
   }
 
   virtual ~PrefetchOperator() noexcept {
@@ -43,7 +72,15 @@ class PrefetchOperator : public OperatorBase {
   }
 
   void Finalize() {
-    if (prefetch_thread_.get()) {
+    if (prefetch_thread_.get() && prefetch_depth_ > 1) {
+      {
+        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+        finalize_ = true;
+      }
+      producer_.notify_one();
+      prefetch_thread_->join();
+      prefetch_thread_.reset();
+    } else if (prefetch_thread_.get()) {
       {
         std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
         while (!prefetched_)
@@ -66,19 +103,36 @@ class PrefetchOperator : public OperatorBase {
       context_.SwitchToDevice(0);
       bool result = Prefetch() && CopyPrefetched();
       context_.FinishDeviceComputation();
+      if (result) {
+        RecordBatch(Outputs());
+      }
       return result;
     }
     // Note(jiayq): We only start the prefetch_thread at the Run() function
     // instead of in the constructor, because the prefetch_thread needs to start
     // after all derived classes' constructors finish.
     if (!prefetch_thread_) {
-      prefetch_thread_.reset(
-          new std::thread([this] { this->PrefetchWorker(); }));
+      if (prefetch_depth_ > 1) {
+        prefetch_thread_.reset(
+            new std::thread([this] { this->PrefetchSlotsWorker(); }));
+      } else {
+        prefetch_thread_.reset(
+            new std::thread([this] { this->PrefetchWorker(); }));
+      }
     }
     context_.SwitchToDevice(0);
+    if (prefetch_depth_ > 1) {
+      return RunFromSlot();
+    }
     std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
-    while (!prefetched_)
-      consumer_.wait(lock);
+    CAFFE_EVENT(prefetch_stats_, queue_occupancy, prefetched_ ? 1 : 0);
+    if (!prefetched_) {
+      Timer blockedTimer;
+      while (!prefetched_)
+        consumer_.wait(lock);
+      CAFFE_EVENT(
+          prefetch_stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+    }
     if (!prefetch_success_) {
       LOG(ERROR) << "Prefetching failed.";
       return false;
@@ -87,6 +141,7 @@ class PrefetchOperator : public OperatorBase {
       LOG(ERROR) << "Error when copying prefetched data.";
       return false;
     }
+    RecordBatch(Outputs());
     prefetched_ = false;
     context_.FinishDeviceComputation();
     producer_.notify_one();
@@ -103,8 +158,11 @@ class PrefetchOperator : public OperatorBase {
       // prefetcher thread and the main thread are potentially using different
       // streams (like on GPU).
       try {
+        Timer prefetchTimer;
         prefetch_success_ = Prefetch();
         context_.FinishDeviceComputation();
+        CAFFE_EVENT(
+            prefetch_stats_, prefetch_time_ns, prefetchTimer.NanoSeconds());
       } catch (const std::exception& e) {
         // TODO: propagate exception_ptr to the caller side
         LOG(ERROR) << "Prefetching error " << e.what();
@@ -112,8 +170,63 @@ class PrefetchOperator : public OperatorBase {
       }
       prefetched_ = true;
       consumer_.notify_one();
+      Timer blockedTimer;
       while (prefetched_)
         producer_.wait(lock);
+      CAFFE_EVENT(
+          prefetch_stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+    }
+  }
+
+  void PrefetchSlotsWorker() {
+    context_.SwitchToDevice();
+    while (true) {
+      Slot* slot;
+      {
+        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+        if (slots_written_ - slots_read_ == prefetch_depth_) {
+          Timer blockedTimer;
+          producer_.wait(lock, [this]() {
+            return finalize_ || slots_written_ - slots_read_ < prefetch_depth_;
+          });
+          CAFFE_EVENT(
+              prefetch_stats_,
+              queue_write_blocked_ns,
+              blockedTimer.NanoSeconds());
+        }
+        if (finalize_) {
+          return;
+        }
+        slot = &slots_[slots_written_ % prefetch_depth_];
+      }
+      // The slot is only read once it is written, the batch is prefetched
+      // and copied without holding the lock
+      bool success = false;
+      std::vector<Blob*> blobs;
+      for (const auto& blob : slot->blobs) {
+        blobs.push_back(blob.get());
+      }
+      try {
+        Timer prefetchTimer;
+        if (Prefetch()) {
+          ResetOutputBlobs(blobs);
+          success = CopyPrefetched();
+          ResetOutputBlobs(output_blobs_);
+        }
+        context_.FinishDeviceComputation();
+        CAFFE_EVENT(
+            prefetch_stats_, prefetch_time_ns, prefetchTimer.NanoSeconds());
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Prefetching error " << e.what();
+        ResetOutputBlobs(output_blobs_);
+        success = false;
+      }
+      {
+        std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+        slot->success = success;
+        ++slots_written_;
+      }
+      consumer_.notify_one();
     }
   }
 
@@ -135,6 +248,70 @@ class PrefetchOperator : public OperatorBase {
 
   // Whether to do prefetching or run this as a normal operator
   const bool no_prefetch_;
+
+ private:
+  struct Slot {
+    std::vector<std::unique_ptr<Blob>> blobs;
+    bool success{false};
+  };
+
+  bool RunFromSlot() {
+    std::unique_lock<std::mutex> lock(prefetch_access_mutex_);
+    CAFFE_EVENT(
+        prefetch_stats_, queue_occupancy, slots_written_ - slots_read_);
+    if (slots_read_ == slots_written_) {
+      Timer blockedTimer;
+      consumer_.wait(lock, [this]() { return slots_read_ < slots_written_; });
+      CAFFE_EVENT(
+          prefetch_stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+    }
+    auto& slot = slots_[slots_read_ % prefetch_depth_];
+    if (!slot.success) {
+      LOG(ERROR) << "Prefetching failed.";
+      return false;
+    }
+    // The outputs of the previous batch go back to the slot, where they
+    // are reused by the next batch copied to it
+    for (int i = 0; i < output_blobs_.size(); ++i) {
+      using std::swap;
+      swap(*output_blobs_[i], *slot.blobs[i]);
+    }
+    ++slots_read_;
+    lock.unlock();
+    producer_.notify_one();
+    // Outputs() is bound to the slots by the prefetching thread
+    RecordBatch(output_blobs_);
+    return true;
+  }
+
+  void RecordBatch(const std::vector<Blob*>& outputs) {
+    CAFFE_EVENT(prefetch_stats_, queue_dequeued_records);
+    size_t bytes = 0;
+    for (const auto* blob : outputs) {
+      bytes += BlobStat::sizeBytes(*blob);
+    }
+    CAFFE_EVENT(prefetch_stats_, queue_dequeued_bytes, bytes);
+  }
+
+  // Number of batches prefetched ahead
+  const int prefetch_depth_;
+  // The outputs of the operator, which are bound to the slots while the
+  // batches are copied to them
+  std::vector<Blob*> output_blobs_;
+  std::vector<Slot> slots_;
+  int64_t slots_written_{0};
+  int64_t slots_read_{0};
+
+  // Same stats as BlobsQueue, in batches, and the time spent prefetching
+  struct PrefetchStats {
+    CAFFE_STAT_CTOR(PrefetchStats);
+    CAFFE_EXPORTED_STAT(queue_dequeued_records);
+    CAFFE_EXPORTED_STAT(queue_dequeued_bytes);
+    CAFFE_EXPORTED_STAT(queue_read_blocked_ns);
+    CAFFE_EXPORTED_STAT(queue_write_blocked_ns);
+    CAFFE_HISTOGRAM_EXPORTED_STAT(queue_occupancy);
+    CAFFE_AVG_EXPORTED_STAT(prefetch_time_ns);
+  } prefetch_stats_;
 };
 
 } // namespace caffe2
@@ -64,4 +64,48 @@ class GetQuantDecodeGradient : public GradientMakerBase {
 
 REGISTER_GRADIENT(QuantDecode, GetQuantDecodeGradient);
 
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumQuantDecode,
+    SparseLengthsSumQuantDecodeOp);
+OPERATOR_SCHEMA(SparseLengthsSumQuantDecode)
+    .NumInputs(4)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Performs the same operation as QuantDecode of CODES followed by
+SparseLengthsSum of the decoded rows, without materializing them: the
+centroids of the codes of every row indexed by INDICES are looked up in the
+codebook and summed straight into the output row of its segment. Segments
+are split between the threads of the workspace thread pool when there are
+enough indices.
+)DOC")
+    .Arg(
+        "num_threads",
+        "Maximum number of threads of the workspace thread pool to run on, 0 "
+        "for all of them and 1 for the calling thread only "
+        "(default: --caffe2_sparse_lengths_num_threads)")
+    .Arg(
+        "min_indices_per_thread",
+        "Minimum number of indices per thread "
+        "(default: --caffe2_sparse_lengths_min_indices_per_thread)")
+    .Input(0, "codebook", "Codebook in 1d tensor (float)")
+    .Input(
+        1,
+        "CODES",
+        "Encoded rows (uint8/uint16/int32), every code indexing the codebook")
+    .Input(
+        2,
+        "INDICES",
+        "Integer vector containing indices of the first dimension of CODES "
+        "for the rows that are being aggregated")
+    .Input(
+        3,
+        "LENGTHS",
+        "Vector of segment lengths, summing to the size of INDICES")
+    .Output(
+        0,
+        "OUTPUT",
+        "Sums of the decoded rows of every segment, of the shape of CODES "
+        "with its first dimension the size of LENGTHS (float)");
+NO_GRADIENT(SparseLengthsSumQuantDecode);
+
 } // namespace caffe2
@@ -5,6 +5,8 @@
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/core/typeid.h"
+#include "caffe2/operators/lengths_reducer_ops.h"
+#include "caffe2/perfkernels/quant_decode_embedding_lookup.h"
 
 namespace caffe2 {
 
@@ -165,5 +167,118 @@ class QuantDecodeGradientOp final : public Operator<CPUContext> {
   }
 };
 
+// QuantDecode followed by SparseLengthsSum: the rows of codes are decoded
+// straight into the sums of their segments.
+class SparseLengthsSumQuantDecodeOp final : public Operator<CPUContext> {
+ public:
+  USE_OPERATOR_FUNCTIONS(CPUContext);
+  SparseLengthsSumQuantDecodeOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<CPUContext>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>(
+            "num_threads",
+            FLAGS_caffe2_sparse_lengths_num_threads)),
+        min_indices_per_thread_(OperatorBase::GetSingleArgument<int>(
+            "min_indices_per_thread",
+            FLAGS_caffe2_sparse_lengths_min_indices_per_thread)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<uint8_t, uint16_t, int32_t>>::call(
+        this, Input(CODES));
+  }
+
+  template <typename CodeType>
+  bool DoRunWithType() {
+    return DispatchHelper<TensorTypes2<int32_t, int64_t>, CodeType>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename CodeType, typename IndexType>
+  bool DoRunWithType2() {
+    const auto& codebook = Input(CODEBOOK);
+    const auto& codes = Input(CODES);
+    const auto& indices = Input(INDICES);
+    const auto& lengths = Input(LENGTHS);
+    CAFFE_ENFORCE(codebook.template IsType<float>(), codebook.meta().name());
+    CAFFE_ENFORCE_GE(codes.ndim(), 1, "CODES has to be at least a vector");
+    CAFFE_ENFORCE_EQ(1, indices.ndim(), "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(1, lengths.ndim(), "LENGTHS must be a vector");
+
+    const TIndex N = codes.dim(0);
+    const TIndex D = codes.size_from_dim(1);
+    const TIndex M = lengths.dim(0);
+    const TIndex indices_size = indices.size();
+
+    auto* output = Output(0);
+    auto shape = codes.dims();
+    shape[0] = M;
+    output->Resize(shape);
+    float* out_data = output->template mutable_data<float>();
+
+    const float* cb_data = codebook.template data<float>();
+    const TIndex cb_size = codebook.size();
+    const CodeType* codes_data = codes.template data<CodeType>();
+    const IndexType* indices_data = indices.template data<IndexType>();
+    const int* lengths_data = lengths.template data<int>();
+
+    const int num_ranges = SparseLengthsNumRanges(
+        ws_, num_threads_, min_indices_per_thread_, indices_size);
+    if (num_ranges <= 1) {
+      QuantDecodeEmbeddingLookup(
+          D,
+          M,
+          indices_size,
+          N,
+          cb_data,
+          cb_size,
+          codes_data,
+          indices_data,
+          lengths_data,
+          out_data);
+      return true;
+    }
+
+    std::vector<TIndex> index_offsets(M + 1, 0);
+    for (TIndex i = 0; i < M; ++i) {
+      CAFFE_ENFORCE_GE(lengths_data[i], 0, "LENGTHS must be non negative");
+      index_offsets[i + 1] = index_offsets[i] + lengths_data[i];
+    }
+    CAFFE_ENFORCE_EQ(
+        index_offsets[M],
+        indices_size,
+        "The sum of LENGTHS has to be the size of INDICES");
+    const auto bounds =
+        BalancedSegmentRanges(lengths_data, M, num_ranges, out_data, D);
+    ws_->GetThreadPool()->runRanges(bounds.size() - 1, [&](size_t range) {
+      const TIndex begin = bounds[range];
+      const TIndex end = bounds[range + 1];
+      const TIndex index_begin = index_offsets[begin];
+      QuantDecodeEmbeddingLookup(
+          D,
+          end - begin,
+          index_offsets[end] - index_begin,
+          N,
+          cb_data,
+          cb_size,
+          codes_data,
+          indices_data + index_begin,
+          lengths_data + begin,
+          out_data + begin * D);
+    });
+    return true;
+  }
+
+ private:
+  Workspace* ws_;
+  // 0 uses all threads of the workspace thread pool, 1 runs on the calling
+  // thread
+  const int num_threads_;
+  const int min_indices_per_thread_;
+
+  INPUT_TAGS(CODEBOOK, CODES, INDICES, LENGTHS);
+};
+
 } // namespace caffe2
 #endif // QUANT_DECODE_OP_H_
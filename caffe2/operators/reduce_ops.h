@@ -38,7 +38,8 @@ class ReduceOpBase : public Operator<Context> {
     auto& X = Input(0);
     auto* Y = Output(0);
 
-    vector<TIndex> y_dims = X.dims();
+    vector<TIndex> x_dims = X.dims();
+    vector<TIndex> y_dims = x_dims;
     TIndex Y_size = X.size();
     for (TIndex id = axes_.size() - 1; id >= 0; id--) {
       TIndex reduced_axis = axes_[id];
@@ -54,7 +55,7 @@ class ReduceOpBase : public Operator<Context> {
     return this->Compute(
         X.template data<T>(),
         X.size(),
-        const_cast<vector<TIndex>&>(X.dims()),
+        x_dims,
         Y->template mutable_data<T>(),
         Y_size,
         axes_,
@@ -98,16 +98,18 @@ class SumElementsGradientOp : public Operator<Context> {
 template <class Context>
 class SumSqrElementsOp : public Operator<Context> {
  public:
-  USE_SIMPLE_CTOR_DTOR(SumSqrElementsOp)
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
+  SumSqrElementsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(bool, "average", average_, false) {}
+
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<float>>::call(this, Input(0));
   }
 
   template <typename T>
   bool DoRunWithType() {
-    bool average = OperatorBase::GetSingleArgument<bool>("average", false);
     auto& X = Input(0);
     auto* sum = Output(0);
     sum->Resize(vector<TIndex>());
@@ -117,7 +119,7 @@ class SumSqrElementsOp : public Operator<Context> {
         sum->template mutable_data<T>(),
         &context_,
         &scratch_);
-    if (average) {
+    if (average_) {
       math::Scale<T, Context>(
           1,
           float(1.) / X.size(),
@@ -129,6 +131,7 @@ class SumSqrElementsOp : public Operator<Context> {
   }
 
  private:
+  bool average_;
   Tensor<Context> scratch_;
 };
 
@@ -68,6 +68,7 @@ REGISTER_CPU_OPERATOR(ReluGradient, ReluGradientOp<float, CPUContext>);
 OPERATOR_SCHEMA(Relu)
     .NumInputs(1)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .AllowInplace({{0, 0}})
     .CostInferenceFunction(CostInferenceForRelu)
     .IdenticalTypeAndShape()
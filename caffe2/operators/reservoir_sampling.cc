@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
+#include "caffe2/core/numa.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
 #include "caffe2/operators/map_ops.h"
@@ -15,14 +18,37 @@ class ReservoirSamplingOp final : public Operator<Context> {
   ReservoirSamplingOp(const OperatorDef operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
         numToCollect_(
-            OperatorBase::GetSingleArgument<int>("num_to_collect", -1)) {
+            OperatorBase::GetSingleArgument<int>("num_to_collect", -1)),
+        concurrentCopies_(OperatorBase::GetSingleArgument<bool>(
+            "concurrent_copies",
+            false)),
+        numaNodeId_(OperatorBase::GetSingleArgument<int>("numa_node_id", -1)) {
     CAFFE_ENFORCE(numToCollect_ > 0);
+    CAFFE_ENFORCE(
+        !concurrentCopies_ || InputSize() <= OBJECT_ID,
+        "concurrent_copies cannot be used with OBJECT_ID");
   }
 
   bool RunOnDevice() override {
     auto& mutex = OperatorBase::Input<std::unique_ptr<std::mutex>>(MUTEX);
-    std::lock_guard<std::mutex> guard(*mutex);
+    std::unique_lock<std::mutex> guard(*mutex);
+    char* output_data = reserveSlots();
+    if (output_data) {
+      if (concurrentCopies_) {
+        // The slots are reserved, other writers may reserve theirs while
+        // the rows get copied
+        guard.unlock();
+      }
+      copyRows(output_data);
+    }
+    return true;
+  }
 
+ private:
+  // Draws the positions of the rows of DATA in the reservoir and updates the
+  // bookkeeping, without copying the rows. Returns the data of the reservoir
+  // to copy them to, nullptr if there is nothing to copy.
+  char* reserveSlots() {
     auto* output = Output(RESERVOIR);
     const auto& input = Input(DATA);
 
@@ -47,6 +73,13 @@ class ReservoirSamplingOp final : public Operator<Context> {
     // so that the output gets the right capacity
     output->raw_mutable_data(input.meta());
     output->Reserve(dims, &context_);
+    if (numaNodeId_ >= 0 && output->raw_data() != numaPlacedData_) {
+      NUMAMove(
+          output->raw_mutable_data(input.meta()),
+          output->capacity_nbytes(),
+          numaNodeId_);
+      numaPlacedData_ = output->raw_data();
+    }
 
     auto* pos_to_object =
         OutputSize() > POS_TO_OBJECT ? Output(POS_TO_OBJECT) : nullptr;
@@ -59,7 +92,7 @@ class ReservoirSamplingOp final : public Operator<Context> {
         // Get both shape and meta
         output->CopyFrom(input, &context_);
       }
-      return true;
+      return nullptr;
     }
 
     const int64_t* object_id_data = nullptr;
@@ -89,10 +122,6 @@ class ReservoirSamplingOp final : public Operator<Context> {
         ? pos_to_object->template mutable_data<int64_t>()
         : nullptr;
 
-    auto block_size = input.size_from_dim(1);
-    auto block_bytesize = block_size * input.itemsize();
-    const auto* input_data = static_cast<const char*>(input.raw_data());
-
     auto* num_visited_tensor = Output(NUM_VISITED);
     CAFFE_ENFORCE_EQ(1, num_visited_tensor->size());
     auto* num_visited = num_visited_tensor->template mutable_data<int64_t>();
@@ -116,6 +145,7 @@ class ReservoirSamplingOp final : public Operator<Context> {
       }
     }
 
+    copies_.clear();
     for (int i = 0; i < num_entries; ++i) {
       if (object_id_data && object_to_pos_map &&
           !eligible_object_ids.count(object_id_data[i])) {
@@ -145,11 +175,7 @@ class ReservoirSamplingOp final : public Operator<Context> {
         CAFFE_ENFORCE_GE(*num_visited, numToCollect_);
       } else {
         // replace
-        context_.template CopyItems<Context, Context>(
-            input.meta(),
-            block_size,
-            input_data + i * block_bytesize,
-            output_data + pos * block_bytesize);
+        copies_.emplace_back(pos, i);
 
         if (object_id_data && pos_to_object_data && object_to_pos_map) {
           auto old_oid = pos_to_object_data[pos];
@@ -164,12 +190,51 @@ class ReservoirSamplingOp final : public Operator<Context> {
     }
     // Sanity check
     CAFFE_ENFORCE_EQ(*num_visited, start_num_visited + num_new_entries);
-    return true;
+    return output_data;
+  }
+
+  // Copies the rows of DATA to the positions drawn for them. Only the last
+  // row drawn for a position is copied, and runs of consecutive rows going to
+  // consecutive positions, like the ones appended while the reservoir fills
+  // up, are copied at once.
+  void copyRows(char* output_data) {
+    const auto& input = Input(DATA);
+    const auto block_size = input.size_from_dim(1);
+    const auto block_bytesize = block_size * input.itemsize();
+    const auto* input_data = static_cast<const char*>(input.raw_data());
+
+    std::sort(copies_.begin(), copies_.end());
+    size_t num_copies = 0;
+    for (const auto& copy : copies_) {
+      if (num_copies > 0 && copies_[num_copies - 1].first == copy.first) {
+        copies_[num_copies - 1] = copy;
+      } else {
+        copies_[num_copies++] = copy;
+      }
+    }
+    for (size_t i = 0; i < num_copies;) {
+      size_t j = i + 1;
+      while (j < num_copies && copies_[j].first == copies_[i].first + (j - i) &&
+             copies_[j].second == copies_[i].second + (j - i)) {
+        ++j;
+      }
+      context_.template CopyItems<Context, Context>(
+          input.meta(),
+          (j - i) * block_size,
+          input_data + copies_[i].second * block_bytesize,
+          output_data + copies_[i].first * block_bytesize);
+      i = j;
+    }
   }
 
- private:
   // number of tensors to collect
   int numToCollect_;
+  // Whether the rows are copied after releasing the mutex
+  bool concurrentCopies_;
+  int numaNodeId_;
+  const void* numaPlacedData_ = nullptr;
+  // (position in the reservoir, row of DATA) of the rows to copy
+  std::vector<std::pair<int64_t, int64_t>> copies_;
 
   INPUT_TAGS(
       RESERVOIR_IN,
@@ -213,11 +278,24 @@ instance of each 'object' in the reservoir, `OBJECT_ID` can be given for
 deduplication. If `OBJECT_ID` is given, then you also need to supply additional
 book-keeping tensors. See input blob documentation for details.
 
-This operator is thread-safe.
+This operator is thread-safe. The positions of all the rows of a batch are
+drawn first, and only the rows staying in the reservoir are copied, in runs of
+consecutive rows. With `concurrent_copies`, the mutex is only held while
+drawing the positions, so that several writers copy their rows at the same
+time; readers of the reservoir then have to wait for the writers on their
+own, and writers drawing the same position may leave either row there.
 )DOC")
     .Arg(
         "num_to_collect",
         "The number of random samples to append for each positive samples")
+    .Arg(
+        "concurrent_copies",
+        "(bool, default false) Copy the rows after releasing the mutex. Not "
+        "supported with OBJECT_ID.")
+    .Arg(
+        "numa_node_id",
+        "(int, default -1) NUMA node to place the memory of the reservoir on "
+        "when it is allocated, -1 to leave it where it is allocated")
     .Input(
         0,
         "RESERVOIR",
@@ -8,6 +8,7 @@ REGISTER_CPU_OPERATOR(Reshape, ReshapeOp<float, CPUContext>);
 OPERATOR_SCHEMA(Reshape)
     .NumInputs(1, 2)
     .NumOutputs(2)
+    .CheapToRun()
     .TensorInferenceFunction(
         [](const OperatorDef& def, const vector<TensorShape>& in) {
           vector<TensorShape> out(2);
@@ -11,6 +11,10 @@ Reverse segments in a 3-D tensor (lengths, segments, embeddings,), leaving
 paddings unchanged. This operator is used to reverse input of a recurrent neural
 network to make it a BRNN.
   )DOC")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace pool large inputs are split "
+        "between on CPU, all of them by default (0)")
     .Input(0, "data", "a 3-D (lengths, segments, embeddings,) tensor.")
     .Input(1, "lengths", "length of each segment.")
     .Output(
@@ -1,8 +1,12 @@
 #ifndef CAFFE2_OPERATORS_REVERSE_PACKED_SEGS_OP_H_
 #define CAFFE2_OPERATORS_REVERSE_PACKED_SEGS_OP_H_
 
+#include <algorithm>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -10,8 +14,13 @@ template <class Context>
 class ReversePackedSegsOp final : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(ReversePackedSegsOp);
   USE_DISPATCH_HELPER;
+  ReversePackedSegsOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
 
   bool RunOnDevice() override {
     return DispatchHelper<TensorTypes<float, double, int, long, bool>>::call(
@@ -62,27 +71,55 @@ class ReversePackedSegsOp final : public Operator<Context> {
         batch_size, lengths_ptr, &lengths_host[0]);
     context_.FinishDeviceComputation();
 
-    T* rev_data_ptr = output->template mutable_data<T>();
     for (TIndex i = 0; i < batch_size; i++) {
-      const auto& seg_length = lengths_host[i];
-      CAFFE_ENFORCE_LE(seg_length, max_length);
-      TIndex j = 0;
-      for (; j < seg_length; j++) {
-        const T* data_block_ptr = data_ptr + (j * batch_size + i) * block_size;
-        T* rev_data_block_ptr =
-            rev_data_ptr + ((seg_length - 1 - j) * batch_size + i) * block_size;
-        context_.template Copy<T, Context, Context>(
-            block_size, data_block_ptr, rev_data_block_ptr);
-      }
-      for (; j < max_length; j++) {
-        const T* data_block_ptr = data_ptr + (j * batch_size + i) * block_size;
-        T* rev_data_block_ptr =
-            rev_data_ptr + (j * batch_size + i) * block_size;
-        context_.template Copy<T, Context, Context>(
-            block_size, data_block_ptr, rev_data_block_ptr);
+      CAFFE_ENFORCE_LE(lengths_host[i], max_length);
+    }
+
+    // The input is read one timestep at a time, and the timesteps of large
+    // inputs are split between the threads of the workspace pool.
+    T* rev_data_ptr = output->template mutable_data<T>();
+    const TIndex num_ranges = NumRanges(max_length, data.size());
+    auto reverse = [&](size_t range) {
+      const TIndex begin = range * max_length / num_ranges;
+      const TIndex end = (range + 1) * max_length / num_ranges;
+      for (TIndex j = begin; j < end; j++) {
+        for (TIndex i = 0; i < batch_size; i++) {
+          const auto& seg_length = lengths_host[i];
+          const TIndex rev_j = j < seg_length ? seg_length - 1 - j : j;
+          context_.template Copy<T, Context, Context>(
+              block_size,
+              data_ptr + (j * batch_size + i) * block_size,
+              rev_data_ptr + (rev_j * batch_size + i) * block_size);
+        }
       }
+    };
+    if (num_ranges <= 1) {
+      reverse(0);
+    } else {
+      ws_->GetThreadPool()->runRanges(num_ranges, reverse);
+    }
+  }
+
+  // Number of ranges of the num_timesteps timesteps of size elements in all
+  // to split the copies in, with at least kMinParallelSize elements each
+  TIndex NumRanges(TIndex num_timesteps, TIndex size) {
+    constexpr TIndex kMinParallelSize = 1 << 16;
+    if (num_threads_ == 1 || num_timesteps <= 1 ||
+        size < 2 * kMinParallelSize) {
+      return 1;
     }
+    const int pool_threads = ws_->GetThreadPool()->getNumThreads();
+    const int threads = num_threads_ == 0
+        ? pool_threads
+        : std::min(num_threads_, pool_threads);
+    return std::min<TIndex>(
+        std::min<TIndex>(threads, num_timesteps), size / kMinParallelSize);
   }
+
+  Workspace* ws_;
+  // 0 uses all threads of the workspace thread pool, 1 copies on the
+  // calling thread. Only used by the CPU version.
+  const int num_threads_;
 };
 
 } // namespace caffe2
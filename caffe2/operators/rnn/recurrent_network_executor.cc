@@ -1,5 +1,7 @@
 #include "caffe2/operators/rnn/recurrent_network_executor.h"
 
+#include <algorithm>
+
 #include "caffe2/core/timer.h"
 
 namespace caffe2 {
@@ -16,17 +18,65 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CPUContext>(
     std::string timestep_blob,
     ArgumentHelper rnn_args) {
   auto* exec = new ThreadedRecurrentNetworkExecutor(
-      step_net_def, recurrent_input_map, timestep_blob);
+      step_net_def,
+      recurrent_input_map,
+      timestep_blob,
+      rnn_args.GetSingleArgument<bool>("rnn_executor.wavefront", false));
   int num_threads =
       rnn_args.GetSingleArgument<int>("rnn_executor.num_threads", 0);
   if (num_threads > 0) {
     exec->setNumThreads(num_threads);
     LOG(INFO) << "Set num threads: " << num_threads;
   }
+  int max_parallel_timesteps =
+      rnn_args.GetSingleArgument<int>("rnn_executor.max_parallel_timesteps", 0);
+  if (max_parallel_timesteps > 0) {
+    exec->SetMaxParallelTimesteps(max_parallel_timesteps);
+    LOG(INFO) << "Set max parallel timesteps: " << max_parallel_timesteps;
+  }
   exec->debug_ = rnn_args.GetSingleArgument<int>("rnn_executor_debug", 0);
   return std::unique_ptr<RecurrentNetworkExecutorBase>(exec);
 }
 
+namespace {
+
+// Position of the timestep of a task in the direction of its pass
+inline int stepIndex(const OpTask& task) {
+  return task.direction == 1 ? task.timestep : task.T - 1 - task.timestep;
+}
+
+// Orders the heap of ReadyOpTaskQueue so that the task of the earliest
+// timestep, then of the earliest op, is at the top
+inline bool laterTask(const OpTask& a, const OpTask& b) {
+  int step_a = stepIndex(a);
+  int step_b = stepIndex(b);
+  return step_a != step_b ? step_a > step_b : a.op_idx > b.op_idx;
+}
+
+} // namespace
+
+void ReadyOpTaskQueue::push(const OpTask& task) {
+  if (!wavefront_) {
+    fifo_.push(task);
+    return;
+  }
+  heap_.push_back(task);
+  std::push_heap(heap_.begin(), heap_.end(), laterTask);
+}
+
+const OpTask& ReadyOpTaskQueue::front() const {
+  return wavefront_ ? heap_.front() : fifo_.front();
+}
+
+void ReadyOpTaskQueue::pop() {
+  if (!wavefront_) {
+    fifo_.pop();
+    return;
+  }
+  std::pop_heap(heap_.begin(), heap_.end(), laterTask);
+  heap_.pop_back();
+}
+
 /**
  * Run forwardpass with T timesteps.
  */
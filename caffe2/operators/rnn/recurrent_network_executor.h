@@ -2,6 +2,7 @@
 #define CAFFE2_OPERATORS_RECURRENT_NETWORK_EXECUTOR_H_
 
 #include <map>
+#include <queue>
 #include <unordered_set>
 #include <vector>
 
@@ -25,6 +26,22 @@ namespace caffe2 {
  * next timestep's lower layer can start executing at the same time as
  * the same timestep's upper layer.
  *
+ * The layers have to be in the same step net for that, as with
+ * rnn_cell.MultiRNNCell: a stack of layers built as separate
+ * RecurrentNetworkOps runs layer after layer, since every op runs all its
+ * timesteps before the next one starts. Within the step net, layer l at
+ * timestep t runs in parallel with layer l + 1 at timestep t - 1, a
+ * diagonal wavefront over the layers and the timesteps.
+ *
+ * The executor is tuned per op with the arguments of the RecurrentNetworkOp:
+ *   rnn_executor.num_threads: number of workers (CPU)
+ *   rnn_executor.max_cuda_streams: number of streams (GPU)
+ *   rnn_executor.max_parallel_timesteps: how many timesteps can run
+ *     concurrently, i.e. the depth of the wavefront. In forward-only mode
+ *     this is also the number of step workspaces cycled over.
+ *   rnn_executor.wavefront: schedule the ready ops of the earliest
+ *     timestep first instead of in FIFO order (CPU)
+ *
  * There are two implementations of the RNN executor: one for CPUs
  * (ThreadedRecurrentNetworkExecutor) and another for GPUs
  * (CUDARecurrentNetworkExecutor).
@@ -192,6 +209,10 @@ class RecurrentNetworkExecutorBase {
     max_parallel_timesteps_ = p;
   }
 
+  int MaxParallelTimesteps() const {
+    return max_parallel_timesteps_;
+  }
+
   size_t NumObserversStepNet() {
     size_t num = 0;
     for (auto& ops_at_timestep_t : timestep_ops_) {
@@ -481,13 +502,41 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor(
     std::string timestep_blob,
     ArgumentHelper rnn_args);
 
+/**
+ * Queue of ready ops (std::queue interface, used by SimpleQueue). Without
+ * wavefront scheduling the ops are popped in FIFO order. Otherwise the op
+ * of the earliest timestep, in the direction of the pass, is popped first,
+ * and the earliest op of the step net among those of a timestep. With a
+ * stack of layers in the step net, the upper layers at timestep t are then
+ * preferred over the lower layers at timestep t + 1, which keeps the
+ * wavefront tight instead of letting the lower layers run ahead.
+ */
+class ReadyOpTaskQueue {
+ public:
+  explicit ReadyOpTaskQueue(bool wavefront = false) : wavefront_(wavefront) {}
+
+  void push(const OpTask& task);
+  const OpTask& front() const;
+  void pop();
+  size_t size() const {
+    return wavefront_ ? heap_.size() : fifo_.size();
+  }
+
+ private:
+  bool wavefront_;
+  std::queue<OpTask> fifo_;
+  std::vector<OpTask> heap_;
+};
+
 class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
  public:
   ThreadedRecurrentNetworkExecutor(
       const NetDef& step_net_def,
       std::map<string, string>& recurrent_input_map,
-      std::string timestep_blob)
+      std::string timestep_blob,
+      bool wavefront = false)
       : RecurrentNetworkExecutorBase(step_net_def, recurrent_input_map, timestep_blob),
+        task_queue_(ReadyOpTaskQueue(wavefront)),
         failed_(false) {}
 
   ~ThreadedRecurrentNetworkExecutor() {
@@ -519,7 +568,7 @@ class ThreadedRecurrentNetworkExecutor : public RecurrentNetworkExecutorBase {
 
   void RunOp(OpTask job, int thread_id);
 
-  SimpleQueue<OpTask> task_queue_;
+  SimpleQueue<OpTask, ReadyOpTaskQueue> task_queue_;
   std::atomic<int> countdown_;
   std::atomic<bool> failed_;
   std::atomic<int> finished_timesteps_;
@@ -17,6 +17,12 @@ std::unique_ptr<RecurrentNetworkExecutorBase> createRNNExecutor<CUDAContext>(
     exec->setMaxStreams(max_streams);
     LOG(INFO) << "Set max streams:" << max_streams;
   }
+  int max_parallel_timesteps = arg_helper.GetSingleArgument<int>(
+      "rnn_executor.max_parallel_timesteps", 0);
+  if (max_parallel_timesteps > 0) {
+    exec->SetMaxParallelTimesteps(max_parallel_timesteps);
+    LOG(INFO) << "Set max parallel timesteps: " << max_parallel_timesteps;
+  }
   std::unique_ptr<RecurrentNetworkExecutorBase> ptr(exec);
   return ptr;
 }
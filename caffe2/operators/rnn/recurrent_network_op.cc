@@ -2,6 +2,8 @@
 #include "caffe2/core/workspace.h"
 #include "caffe2/utils/proto_utils.h"
 
+#include <set>
+
 #ifndef CAFFE2_RNN_NO_TEXT_FORMAT
 #endif
 
@@ -34,7 +36,28 @@ against performance and control (compared to e.g. TF
 dynamic_rnn, Theano scan, etc).
 
 See the usage examples for a flavor of how to use it.
-)DOC");
+
+Training keeps the step workspace of every timestep, with the intermediate
+blobs of the step net needed by the backward pass. With the
+`recompute_segment_length` argument set to k, only the step workspaces of k
+timesteps are kept and cycled over, and the gradient op recomputes the
+forward steps of every segment of k timesteps, from the last one, right
+before running its backward steps. The memory of the step nets then does
+not grow with the sequence length, at the cost of running the forward step
+net twice. The recurrent states are still kept for every timestep, they are
+outputs of the op.
+
+In forward-only mode (without a backward step net), two step workspaces are
+cycled over, or more with the RNN executor to run timesteps in parallel.
+With `plan_step_memory`, the blobs of the step net that are not linked to
+the recurrent states are only used within a timestep: they are created once
+and shared by all the timesteps, which then run one after the other without
+the executor.
+)DOC")
+    .Arg(
+        "plan_step_memory",
+        "In forward-only mode, share the intermediate blobs of the step net "
+        "between the timesteps");
 
 REGISTER_CPU_OPERATOR(
     RecurrentNetworkGradient,
@@ -237,6 +260,30 @@ void extractLinks(
   }
 }
 
+std::vector<std::string> GetStepNetIntermediates(
+    const NetDef& stepNetDef,
+    const std::vector<Link>& links) {
+  std::set<std::string> persistent(
+      stepNetDef.external_input().begin(), stepNetDef.external_input().end());
+  persistent.insert(
+      stepNetDef.external_output().begin(),
+      stepNetDef.external_output().end());
+  for (const auto& link : links) {
+    persistent.insert(link.internal);
+    persistent.insert(link.external);
+  }
+  std::vector<std::string> intermediates;
+  std::set<std::string> seen;
+  for (const auto& op : stepNetDef.op()) {
+    for (const auto& output : op.output()) {
+      if (!persistent.count(output) && seen.insert(output).second) {
+        intermediates.push_back(output);
+      }
+    }
+  }
+  return intermediates;
+}
+
 NetDef extractNetDef(const OperatorDef& op, const std::string& argName) {
   if (ArgumentHelper::HasSingleArgumentOfType<OperatorDef, NetDef>(
           op, argName)) {
@@ -167,6 +167,15 @@ void extractLinks(
     std::vector<detail::Link>* links);
 
 NetDef extractNetDef(const OperatorDef& op, const std::string& argName);
+
+/**
+ * Blobs written by the ops of the step net that are only used within a
+ * timestep: neither external inputs or outputs of the step net, nor linked
+ * to the recurrent states.
+ */
+std::vector<std::string> GetStepNetIntermediates(
+    const NetDef& stepNetDef,
+    const std::vector<Link>& links);
 } // namespace detail
 
 template <class Context>
@@ -181,8 +190,15 @@ class RecurrentNetworkOp final : public Operator<Context> {
             false)),
         timestep_(OperatorBase::template GetSingleArgument<std::string>(
             "timestep",
-            "timestep")) {
+            "timestep")),
+        recomputeSegmentLength_(OperatorBase::template GetSingleArgument<int>(
+            "recompute_segment_length",
+            0)),
+        planStepMemory_(OperatorBase::template GetSingleArgument<bool>(
+            "plan_step_memory",
+            false)) {
     CAFFE_ENFORCE(ws);
+    CAFFE_ENFORCE_GE(recomputeSegmentLength_, 0);
 
     stepNetDef_ = detail::extractNetDef(operator_def, "step_net");
 
@@ -194,7 +210,15 @@ class RecurrentNetworkOp final : public Operator<Context> {
     detail::AddApplyLinkOps(
         links_, timestep_, operator_def.device_option(), &stepNetDef_);
 
-    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_) {
+    // The timesteps then run one after the other, as plain nets
+    planStepMemory_ = planStepMemory_ && !hasBackwardPass();
+    if (planStepMemory_) {
+      stepIntermediates_ =
+          detail::GetStepNetIntermediates(stepNetDef_, links_);
+    }
+
+    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_ &&
+        !planStepMemory_) {
       VLOG(1) << "Use RecurrentNetworkExecutor";
       auto recurrent_map = detail::GetRecurrentMapping(links_, false /* backward */);
       rnnExecutor_ =
@@ -292,6 +316,16 @@ class RecurrentNetworkOp final : public Operator<Context> {
     return links;
   }
 
+  // If we don't have a backward step net, this operator is forward_only
+  // and we can avoid creating multiple workspaces.
+  bool hasBackwardPass() {
+    return OperatorBase::HasSingleArgumentOfType<NetDef>(
+               "backward_step_net") ||
+        (OperatorBase::HasSingleArgumentOfType<string>("backward_step_net") &&
+         OperatorBase::GetSingleArgument<string>("backward_step_net", "") !=
+             "");
+  }
+
   template<typename T>
   bool DoRunWithType() {
     const auto seqLen = Input(0).dim32(0);
@@ -301,13 +335,7 @@ class RecurrentNetworkOp final : public Operator<Context> {
           ri, seqLen, batchSize, sharedWs_, &context_);
     }
 
-    // If we don't have a backward step net, this operator is forward_only
-    // and we can avoid creating multiple workspaces.
-    bool has_backward_pass =
-        OperatorBase::HasSingleArgumentOfType<NetDef>("backward_step_net") ||
-        (OperatorBase::HasSingleArgumentOfType<string>("backward_step_net") &&
-         OperatorBase::GetSingleArgument<string>("backward_step_net", "") !=
-             "");
+    bool has_backward_pass = hasBackwardPass();
 
     // With backward pass: we need to create workspace for each timestep
     detail::ScratchWorkspaces* scratch =
@@ -324,16 +352,37 @@ class RecurrentNetworkOp final : public Operator<Context> {
     // have to be stored in step workspaces but can be shared.
     initializeBlobsToRecomputeOnBackward(sharedBlobsWs.get());
 
-    if (has_backward_pass && seqLen > stepWorkspaces.size()) {
+    // With plan_step_memory, the intermediate blobs of the step net are
+    // created once in the shared workspace: every timestep reuses their
+    // memory, and the step workspaces only hold the linked blobs.
+    for (const auto& blob : stepIntermediates_) {
+      sharedBlobsWs->CreateBlob(blob);
+    }
+
+    // With recompute_segment_length, the backward pass recomputes the
+    // forward steps segment by segment, so only the step workspaces of a
+    // segment are kept, like in forward-only mode.
+    const bool keep_all_steps =
+        has_backward_pass && recomputeSegmentLength_ == 0;
+    if (keep_all_steps && seqLen > stepWorkspaces.size()) {
       stepWorkspaces.resize(seqLen);
     }
 
     // In forward-only mode, we cycle over workspaces. This limits the amount
     // of parallelism over timesteps that the RNNExecutor provides. So with
-    // RNN executor we use more workspaces to get better perf.
-    int num_workspaces_on_fwd_only = rnnExecutor_ ? 4 : 2;
+    // RNN executor we use more workspaces to get better perf, as many as
+    // the timesteps it may run in parallel if that was set.
+    int num_workspaces_on_fwd_only = rnnExecutor_
+        ? (rnnExecutor_->MaxParallelTimesteps() > 0
+               ? rnnExecutor_->MaxParallelTimesteps()
+               : 4)
+        : 2;
+    if (has_backward_pass) {
+      num_workspaces_on_fwd_only = recomputeSegmentLength_;
+    }
 
-    if (!has_backward_pass && stepWorkspaces.size() < num_workspaces_on_fwd_only) {
+    if (!keep_all_steps &&
+        stepWorkspaces.size() < num_workspaces_on_fwd_only) {
       // Use alternating stepWorkspaces when forward_only=True.
       // Note that the step workspaces can be shared by other ops, thus
       // we cannot shrink it to 2 if there are more than 2 step workspaces.
@@ -342,14 +391,14 @@ class RecurrentNetworkOp final : public Operator<Context> {
 
     for (auto t = 0; t < seqLen; ++t) {
       auto& currentStepWorkspace =
-          (has_backward_pass ? stepWorkspaces[t] :
+          (keep_all_steps ? stepWorkspaces[t] :
               stepWorkspaces[t % num_workspaces_on_fwd_only]);
       if (!currentStepWorkspace) {
         currentStepWorkspace = std::make_shared<Workspace>(sharedBlobsWs.get());
       }
 
       if (rnnExecutor_) {
-        if (!has_backward_pass) {
+        if (!keep_all_steps) {
           // Need to limit timestep parallelism because we cycle over workspaces
           rnnExecutor_->SetMaxParallelTimesteps(num_workspaces_on_fwd_only);
         }
@@ -393,6 +442,9 @@ class RecurrentNetworkOp final : public Operator<Context> {
   std::vector<detail::OffsetAlias> aliases_;
   std::vector<detail::RecurrentInput> recurrentInputs_;
   std::string timestep_;
+  int recomputeSegmentLength_;
+  bool planStepMemory_;
+  std::vector<std::string> stepIntermediates_;
 };
 
 template <class Context>
@@ -409,7 +461,10 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
             "timestep",
             "timestep")),
         gradInputs_(OperatorBase::template GetRepeatedArgument<int32_t>(
-            "outputs_with_grads")) {
+            "outputs_with_grads")),
+        recomputeSegmentLength_(OperatorBase::template GetSingleArgument<int>(
+            "recompute_segment_length",
+            0)) {
     CAFFE_ENFORCE(ws);
 
     stepNetDef_ = detail::extractNetDef(operator_def, "backward_step_net");
@@ -430,7 +485,30 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
         links_, timestep_, operator_def.device_option(), &stepNetDef_);
     AddParamGradientAccumulationOps(operator_def);
 
-    if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_) {
+    if (recomputeSegmentLength_ > 0) {
+      // The forward step net, run again before the backward steps of
+      // every segment. The segments run one after the other, so they
+      // don't use the executor.
+      recomputeNetDef_ = detail::extractNetDef(operator_def, "step_net");
+      recomputeNetDef_.set_name(recomputeNetDef_.name() + "_recompute");
+      recomputeNetDef_.add_external_input(timestep_);
+      std::vector<detail::Link> forwardLinks;
+      detail::extractLinks(
+          this,
+          "link_internal",
+          "link_external",
+          "link_offset",
+          "link_window",
+          &forwardLinks);
+      for (auto& link : forwardLinks) {
+        link = remappedLink(link);
+      }
+      detail::AddApplyLinkOps(
+          forwardLinks,
+          timestep_,
+          operator_def.device_option(),
+          &recomputeNetDef_);
+    } else if (FLAGS_caffe2_rnn_executor && enable_rnn_executor_) {
       InitializeExecutor(operator_def);
     }
   }
@@ -622,6 +700,38 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
     }
   }
 
+  void RunStepNet(const NetDef& netDef, Workspace* stepWs, int32_t t) {
+    detail::UpdateTimestepBlob(stepWs, timestep_, t);
+    auto* stepNet = stepWs->GetNet(netDef.name());
+    if (stepNet == nullptr) {
+      stepNet = stepWs->CreateNet(netDef);
+    }
+    CAFFE_ENFORCE(stepNet);
+    stepNet->RunAsync();
+  }
+
+  /**
+    * Runs the backward pass segment by segment, from the last one. The
+    * forward op only kept the step workspaces of a segment, cycled over
+    * as t % recompute_segment_length, so the forward steps of each segment
+    * are recomputed from the recurrent states first, then its backward
+    * steps run in reverse.
+    */
+  void RunRecomputedSegments(
+      int32_t seqLen,
+      const std::vector<std::shared_ptr<Workspace>>& stepWorkspaces) {
+    const int32_t k = recomputeSegmentLength_;
+    for (int32_t start = (seqLen - 1) / k * k; start >= 0; start -= k) {
+      const int32_t end = std::min(start + k, seqLen);
+      for (int32_t t = start; t < end; ++t) {
+        RunStepNet(recomputeNetDef_, stepWorkspaces[t % k].get(), t);
+      }
+      for (int32_t t = end - 1; t >= start; --t) {
+        RunStepNet(stepNetDef_, stepWorkspaces[t % k].get(), t);
+      }
+    }
+  }
+
   void CreateSharedBlobs(
       const std::shared_ptr<Workspace>& step0Ws,
       Workspace* sharedBlobsWs) {
@@ -647,7 +757,10 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
         OperatorBase::Input<detail::ScratchWorkspaces>(InputSize() - 1);
     const std::vector<std::shared_ptr<Workspace>>& stepWorkspaces =
         scratch.stepWorkspaces;
-    CAFFE_ENFORCE_GE(stepWorkspaces.size(), seqLen);
+    CAFFE_ENFORCE_GE(
+        stepWorkspaces.size(),
+        recomputeSegmentLength_ > 0 ? std::min(seqLen, recomputeSegmentLength_)
+                                    : seqLen);
     Workspace& sharedBlobsWs = *scratch.sharedBlobsWs.get();
 
     const auto batchSize = Input(0).dim32(1);
@@ -744,22 +857,26 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
     if (stepWorkspaces.size() > 0) {
       CreateSharedBlobs(stepWorkspaces[0], &sharedBlobsWs);
     }
-    for (int32_t t = seqLen - 1; t >= 0; --t) {
-      if (rnnExecutor_) {
-        rnnExecutor_->EnsureTimestepInitialized(
-            t, stepWorkspaces[t].get(), this->observers_list_);
-      } else {
-        auto* stepNet = stepWorkspaces[t].get()->GetNet(stepNetDef_.name());
-        if (stepNet == nullptr) {
-          stepNet = stepWorkspaces[t].get()->CreateNet(stepNetDef_);
+    if (recomputeSegmentLength_ > 0) {
+      RunRecomputedSegments(seqLen, stepWorkspaces);
+    } else {
+      for (int32_t t = seqLen - 1; t >= 0; --t) {
+        if (rnnExecutor_) {
+          rnnExecutor_->EnsureTimestepInitialized(
+              t, stepWorkspaces[t].get(), this->observers_list_);
+        } else {
+          auto* stepNet = stepWorkspaces[t].get()->GetNet(stepNetDef_.name());
+          if (stepNet == nullptr) {
+            stepNet = stepWorkspaces[t].get()->CreateNet(stepNetDef_);
+          }
+          CAFFE_ENFORCE(stepNet);
+          stepNet->RunAsync();
         }
-        CAFFE_ENFORCE(stepNet);
-        stepNet->RunAsync();
       }
-    }
 
-    if (rnnExecutor_) {
-      rnnExecutor_->RunBackwards(seqLen);
+      if (rnnExecutor_) {
+        rnnExecutor_->RunBackwards(seqLen);
+      }
     }
 
     CAFFE_ENFORCE_EQ(recurrentInputIds_.size(), recurrentGradients_.size());
@@ -827,6 +944,9 @@ class RecurrentNetworkGradientOp final : public Operator<Context> {
   const int numSequences_{1};
   std::vector<int32_t> recurrentInputIds_;
   std::vector<int32_t> gradInputs_;
+  int recomputeSegmentLength_;
+  // Forward step net recomputing the segments, with recompute_segment_length
+  NetDef recomputeNetDef_;
 };
 
 template <class Context>
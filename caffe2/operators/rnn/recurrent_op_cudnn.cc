@@ -31,31 +31,93 @@ TensorDescriptors<T>::~TensorDescriptors() {
     cudnnDestroyTensorDescriptor(desc);
   }
 }
+
+template <typename T>
+RecurrentShapeDescriptors<T>::RecurrentShapeDescriptors(
+    cudnnHandle_t handle,
+    cudnnRNNDescriptor_t rnnDesc,
+    int seqLength,
+    int batchSize,
+    int inputDim,
+    int hiddenSize,
+    int numLayers,
+    int numDirections)
+    : xDesc(
+          seqLength,
+          // Third dimension is unused
+          {batchSize, inputDim, 1},
+          // Fully-packed
+          {inputDim, 1, 1}),
+      yDesc(
+          seqLength,
+          // Third dimension is unused
+          {batchSize, hiddenSize * numDirections, 1},
+          // Fully-packed
+          {numDirections * hiddenSize, 1, 1}) {
+  // Hidden/Cell setup
+  {
+    const std::array<int, 3> dim{
+        numLayers * numDirections, batchSize, hiddenSize};
+    const std::array<int, 3> stride{batchSize * hiddenSize, hiddenSize, 1};
+    CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&hiddenDesc));
+    CUDNN_ENFORCE(cudnnSetTensorNdDescriptor(
+        hiddenDesc, cudnnTypeWrapper<T>::type, 3, dim.data(), stride.data()));
+  }
+
+  // Weights setup
+  {
+    CUDNN_ENFORCE(cudnnGetRNNParamsSize(
+        handle,
+        rnnDesc,
+        xDesc.descs()[0],
+        &weightsNbytes,
+        cudnnTypeWrapper<T>::type));
+    const std::array<int, 3> dims{
+        static_cast<int>(
+            weightsNbytes / 4 /* sizeof(T) - workaround clang bug */),
+        1,
+        1};
+    CUDNN_ENFORCE(cudnnCreateFilterDescriptor(&wDesc));
+    CUDNN_ENFORCE(cudnnSetFilterNdDescriptor(
+        wDesc, cudnnTypeWrapper<T>::type, CUDNN_TENSOR_NCHW, 3, dims.data()));
+  }
+
+  // RNN workspace and training reserve sizes
+  {
+    CUDNN_ENFORCE(cudnnGetRNNWorkspaceSize(
+        handle, rnnDesc, seqLength, xDesc.descs(), &cudnnWsNbytes));
+    CUDNN_ENFORCE(cudnnGetRNNTrainingReserveSize(
+        handle, rnnDesc, seqLength, xDesc.descs(), &reserveNbytes));
+  }
 }
 
+template <typename T>
+RecurrentShapeDescriptors<T>::~RecurrentShapeDescriptors() {
+  cudnnDestroyTensorDescriptor(hiddenDesc);
+  cudnnDestroyFilterDescriptor(wDesc);
+}
+} // namespace detail
+
 template <typename T>
 RecurrentBaseOp<T>::RecurrentBaseOp(
     const OperatorDef& operator_def,
     Workspace* ws)
-    : Operator<CUDAContext>(operator_def, ws), cudnn_wrapper_(&context_) {
+    : Operator<CUDAContext>(operator_def, ws),
+      cudnn_wrapper_(&context_),
+      seqLengthBucket_(
+          OperatorBase::GetSingleArgument<int>("seq_length_bucket", 0)),
+      maxCachedShapes_(
+          OperatorBase::GetSingleArgument<int>("max_cached_shapes", 64)) {
+  CAFFE_ENFORCE_GE(seqLengthBucket_, 0);
+  CAFFE_ENFORCE_GT(maxCachedShapes_, 0);
   CUDNN_ENFORCE(cudnnCreateDropoutDescriptor(&dropoutDesc_));
   CUDNN_ENFORCE(cudnnCreateRNNDescriptor(&rnnDesc_));
-  CUDNN_ENFORCE(cudnnCreateFilterDescriptor(&wDesc_));
-  CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&hxDesc_));
-  CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&cxDesc_));
-  CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&hyDesc_));
-  CUDNN_ENFORCE(cudnnCreateTensorDescriptor(&cyDesc_));
 }
 
 template <typename T>
 RecurrentBaseOp<T>::~RecurrentBaseOp() {
   CUDNN_ENFORCE(cudnnDestroyDropoutDescriptor(dropoutDesc_));
   CUDNN_ENFORCE(cudnnDestroyRNNDescriptor(rnnDesc_));
-  CUDNN_ENFORCE(cudnnDestroyFilterDescriptor(wDesc_));
-  CUDNN_ENFORCE(cudnnDestroyTensorDescriptor(hxDesc_));
-  CUDNN_ENFORCE(cudnnDestroyTensorDescriptor(cxDesc_));
-  CUDNN_ENFORCE(cudnnDestroyTensorDescriptor(hyDesc_));
-  CUDNN_ENFORCE(cudnnDestroyTensorDescriptor(cyDesc_));
 }
 
 template <typename T>
@@ -77,23 +139,13 @@ void RecurrentBaseOp<T>::initialize(
   CAFFE_ENFORCE(bidirectional == 0 || bidirectional == 1);
   const auto numDirections = bidirectional == 1 ? 2 : 1;
   const auto outputDim = hiddenSize * numDirections;
-  const auto rnnDirection =
-      bidirectional == 1 ? CUDNN_BIDIRECTIONAL : CUDNN_UNIDIRECTIONAL;
   const auto numLayers = OperatorBase::GetSingleArgument<int>("num_layers", 0);
   CAFFE_ENFORCE_GT(numLayers, 0);
-  const auto& rnnModeStr =
-      OperatorBase::GetSingleArgument<string>("rnn_mode", "");
-  CAFFE_ENFORCE(rnnModeStr == "lstm" || rnnModeStr == "gru");
-  const auto rnnMode = rnnModeStr == "lstm" ? CUDNN_LSTM : CUDNN_GRU;
-  const auto& rnnInputStr =
-      OperatorBase::GetSingleArgument<string>("input_mode", "");
-  CAFFE_ENFORCE(rnnInputStr == "linear" || rnnInputStr == "skip");
-  const auto rnnInput =
-      rnnInputStr == "linear" ? CUDNN_LINEAR_INPUT : CUDNN_SKIP_INPUT;
-
-  // Dropout setup
+
+  // Dropout setup, the states are only initialized once: setting the
+  // descriptor reseeds them on the device
   {
-    if (dropoutStates) {
+    if (dropoutStates && !dropoutInitialized_) {
       size_t stateSize;
       float dropout_param =
           OperatorBase::GetSingleArgument<float>("dropout", 1.0);
@@ -110,11 +162,23 @@ void RecurrentBaseOp<T>::initialize(
             stateSize,
             OperatorBase::GetSingleArgument<int>("seed", 0)));
       }
+      dropoutInitialized_ = true;
     }
   }
 
   // RNN setup
-  {
+  if (!rnnDescInitialized_) {
+    const auto rnnDirection =
+        bidirectional == 1 ? CUDNN_BIDIRECTIONAL : CUDNN_UNIDIRECTIONAL;
+    const auto& rnnModeStr =
+        OperatorBase::GetSingleArgument<string>("rnn_mode", "");
+    CAFFE_ENFORCE(rnnModeStr == "lstm" || rnnModeStr == "gru");
+    const auto rnnMode = rnnModeStr == "lstm" ? CUDNN_LSTM : CUDNN_GRU;
+    const auto& rnnInputStr =
+        OperatorBase::GetSingleArgument<string>("input_mode", "");
+    CAFFE_ENFORCE(rnnInputStr == "linear" || rnnInputStr == "skip");
+    const auto rnnInput =
+        rnnInputStr == "linear" ? CUDNN_LINEAR_INPUT : CUDNN_SKIP_INPUT;
 #if CUDNN_VERSION_MIN(7, 0, 0)
     CUDNN_ENFORCE(cudnnSetRNNDescriptor(
         cudnn_wrapper_.inline_cudnn_handle(),
@@ -138,81 +202,61 @@ void RecurrentBaseOp<T>::initialize(
         rnnMode,
         cudnnTypeWrapper<T>::type));
 #endif
-  }
-  // X setup
-  {
-    xDesc_.reset(new detail::TensorDescriptors<T>(
-        seqLength,
-        // Third dimension is unused
-        {batchSize, inputDim, 1},
-        // Fully-packed
-        {inputDim, 1, 1}));
-  }
-  // Y setup
-  {
-    yDesc_.reset(new detail::TensorDescriptors<T>(
-        seqLength,
-        // Third dimension is unused
-        {batchSize, hiddenSize * numDirections, 1},
-        // Fully-packed
-        {numDirections * hiddenSize, 1, 1}));
-
-    if (output) {
-      output->Resize(std::vector<int>{seqLength, batchSize, outputDim});
-    }
+    rnnDescInitialized_ = true;
   }
 
-  // Hidden/Cell setup
+  // X, Y, Hidden/Cell and weights setup, cached by shape. The descriptors of
+  // a longer bucketed sequence work for the shorter ones: cuDNN only reads
+  // the first seqLength of them and the sizes are upper bounds.
   {
-    const std::array<int, 3> dim{
-        numLayers * numDirections, batchSize, hiddenSize};
-    const std::array<int, 3> stride{batchSize * hiddenSize, hiddenSize, 1};
-    CUDNN_ENFORCE(cudnnSetTensorNdDescriptor(
-        hxDesc_, cudnnTypeWrapper<T>::type, 3, dim.data(), stride.data()));
-    CUDNN_ENFORCE(cudnnSetTensorNdDescriptor(
-        cxDesc_, cudnnTypeWrapper<T>::type, 3, dim.data(), stride.data()));
-    CUDNN_ENFORCE(cudnnSetTensorNdDescriptor(
-        hyDesc_, cudnnTypeWrapper<T>::type, 3, dim.data(), stride.data()));
-    CUDNN_ENFORCE(cudnnSetTensorNdDescriptor(
-        cyDesc_, cudnnTypeWrapper<T>::type, 3, dim.data(), stride.data()));
-
-    if (hiddenOutput) {
-      hiddenOutput->Resize(
-          std::vector<int>{numLayers * numDirections, batchSize, hiddenSize});
-    }
-
-    if (cellOutput) {
-      cellOutput->Resize(
-          std::vector<int>{numLayers * numDirections, batchSize, hiddenSize});
+    const int bucketedSeqLength = seqLengthBucket_ > 0
+        ? (seqLength + seqLengthBucket_ - 1) / seqLengthBucket_ *
+            seqLengthBucket_
+        : seqLength;
+    const std::array<int, 3> key{bucketedSeqLength, batchSize, inputDim};
+    auto it = shapeDescriptors_.find(key);
+    if (it == shapeDescriptors_.end()) {
+      if (shapeDescriptors_.size() >=
+          static_cast<size_t>(maxCachedShapes_)) {
+        shapeDescriptors_.clear();
+      }
+      it = shapeDescriptors_
+               .emplace(
+                   key,
+                   caffe2::make_unique<detail::RecurrentShapeDescriptors<T>>(
+                       cudnn_wrapper_.inline_cudnn_handle(),
+                       rnnDesc_,
+                       bucketedSeqLength,
+                       batchSize,
+                       inputDim,
+                       hiddenSize,
+                       numLayers,
+                       numDirections))
+               .first;
     }
+    const auto& descriptors = *it->second;
+    xDesc_ = &descriptors.xDesc;
+    yDesc_ = &descriptors.yDesc;
+    hxDesc_ = descriptors.hiddenDesc;
+    cxDesc_ = descriptors.hiddenDesc;
+    hyDesc_ = descriptors.hiddenDesc;
+    cyDesc_ = descriptors.hiddenDesc;
+    wDesc_ = descriptors.wDesc;
+    weightsNbytes_ = descriptors.weightsNbytes;
+    cudnnWsNbytes_ = descriptors.cudnnWsNbytes;
+    reserveNbytes_ = descriptors.reserveNbytes;
   }
 
-  // Weights setup
-  {
-    size_t weightsSize;
-    CUDNN_ENFORCE(cudnnGetRNNParamsSize(
-        cudnn_wrapper_.inline_cudnn_handle(),
-        rnnDesc_,
-        xDesc_->descs()[0],
-        &weightsSize,
-        cudnnTypeWrapper<T>::type));
-    const std::array<int, 3> dims{
-        static_cast<int>(
-            weightsSize / 4 /* sizeof(T) - workaround clang bug */),
-        1,
-        1};
-    CUDNN_ENFORCE(cudnnSetFilterNdDescriptor(
-        wDesc_, cudnnTypeWrapper<T>::type, CUDNN_TENSOR_NCHW, 3, dims.data()));
+  if (output) {
+    output->Resize(std::vector<int>{seqLength, batchSize, outputDim});
   }
-
-  // RNN workspace size
-  {
-    CUDNN_ENFORCE(cudnnGetRNNWorkspaceSize(
-        cudnn_wrapper_.inline_cudnn_handle(),
-        rnnDesc_,
-        seqLength,
-        xDesc_->descs(),
-        &cudnnWsNbytes_));
+  if (hiddenOutput) {
+    hiddenOutput->Resize(
+        std::vector<int>{numLayers * numDirections, batchSize, hiddenSize});
+  }
+  if (cellOutput) {
+    cellOutput->Resize(
+        std::vector<int>{numLayers * numDirections, batchSize, hiddenSize});
   }
 }
 
@@ -230,22 +274,9 @@ bool RecurrentOp<T>::RunOnDevice() {
   }
 
   // Validation checks
-  size_t weightsSize;
-  CUDNN_ENFORCE(cudnnGetRNNParamsSize(
-      cudnn_wrapper_.inline_cudnn_handle(),
-      rnnDesc_,
-      xDesc_->descs()[0],
-      &weightsSize,
-      cudnnTypeWrapper<T>::type));
-  CAFFE_ENFORCE_EQ(Input(WEIGHT).nbytes(), weightsSize);
+  CAFFE_ENFORCE_EQ(Input(WEIGHT).nbytes(), weightsNbytes_);
 
   // Training reserve size
-  CUDNN_ENFORCE(cudnnGetRNNTrainingReserveSize(
-      cudnn_wrapper_.inline_cudnn_handle(),
-      rnnDesc_,
-      seqLength,
-      xDesc_->descs(),
-      &reserveNbytes_));
   Output(RNN_SCRATCH)
       ->Resize(std::vector<int>{static_cast<int>(
           reserveNbytes_ / 4)}); // sizeof(T) - workaround clang bug
@@ -316,12 +347,6 @@ bool RecurrentGradientOp<T>::RunOnDevice() {
     initialize(Input(INPUT), Output(DROPOUT_STATES));
     cachedInputDims_ = Input(INPUT).dims();
   }
-  CUDNN_ENFORCE(cudnnGetRNNTrainingReserveSize(
-      cudnn_wrapper_.inline_cudnn_handle(),
-      rnnDesc_,
-      seqLength,
-      xDesc_->descs(),
-      &reserveNbytes_));
   CAFFE_ENFORCE_EQ(reserveNbytes_, Input(RNN_SCRATCH).nbytes());
   Output(GRAD_INPUT)->ResizeLike(Input(INPUT));
   Output(GRAD_HIDDEN_INPUT)->ResizeLike(Input(HIDDEN_INPUT));
@@ -399,19 +424,16 @@ bool RecurrentGradientOp<T>::RunOnDevice() {
 
 template <typename T, RecurrentParamOpMode mode>
 bool RecurrentParamAccessOp<T, mode>::RunOnDevice() {
-  initialize(Input(0));
+  if (Input(0).dims() != cachedInputDims_) {
+    initialize(Input(0));
+    cachedInputDims_ = Input(0).dims();
+  }
 
   if (mode == SET_PARAM) {
-    size_t paramsSize;
-    CUDNN_ENFORCE(cudnnGetRNNParamsSize(
-        cudnn_wrapper_.inline_cudnn_handle(),
-        rnnDesc_,
-        xDesc_->descs()[0],
-        &paramsSize,
-        cudnnTypeWrapper<T>::type));
-
     CAFFE_ENFORCE_EQ(
-        paramsSize / 4, Input(1).size(), "Incorrect weight initialization");
+        weightsNbytes_ / 4,
+        Input(1).size(),
+        "Incorrect weight initialization");
   }
 
   int layer = OperatorBase::GetSingleArgument<int>("layer", 0);
@@ -531,7 +553,21 @@ minibatches) by multiplying by zero.
 The CuDNN arguments (hidden_size, bidirectional, num_layers, rnn_mode,
 input_mode) are passed directly through to CuDNN.
 
-)DOC");
+The descriptors and sizes CuDNN needs for an input shape are computed once
+and cached, which matters when the sequence lengths vary, e.g. for serving.
+With seq_length_bucket, the lengths are rounded up to a multiple of it for
+the cache, so that close lengths share their descriptors, at the cost of a
+larger workspace and scratch.
+
+)DOC")
+    .Arg(
+        "seq_length_bucket",
+        "Sequence lengths sharing cached descriptors are rounded up to a "
+        "multiple of it, 0 (default) to cache every length")
+    .Arg(
+        "max_cached_shapes",
+        "Number of input shapes cached before the cache is reset, "
+        "64 by default");
 REGISTER_CUDNN_OPERATOR(RecurrentGradient, RecurrentGradientOp<float>);
 OPERATOR_SCHEMA(RecurrentGradient)
     .NumInputs(7)
@@ -7,6 +7,9 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 
+#include <array>
+#include <map>
+
 namespace caffe2 {
 namespace detail {
 
@@ -26,6 +29,31 @@ class TensorDescriptors {
   std::vector<cudnnTensorDescriptor_t> descs_;
 };
 
+// Descriptors and cuDNN sizes depending on the input shape. They are cached
+// by the ops, querying them costs as much as a short sequence.
+template <typename T>
+struct RecurrentShapeDescriptors {
+  RecurrentShapeDescriptors(
+      cudnnHandle_t handle,
+      cudnnRNNDescriptor_t rnnDesc,
+      int seqLength,
+      int batchSize,
+      int inputDim,
+      int hiddenSize,
+      int numLayers,
+      int numDirections);
+  ~RecurrentShapeDescriptors();
+
+  TensorDescriptors<T> xDesc;
+  TensorDescriptors<T> yDesc;
+  // Descriptor of the hidden and cell states, inputs and outputs
+  cudnnTensorDescriptor_t hiddenDesc;
+  cudnnFilterDescriptor_t wDesc;
+  size_t weightsNbytes;
+  size_t cudnnWsNbytes;
+  size_t reserveNbytes;
+};
+
 } // namespace detail
 
 template <typename T>
@@ -47,20 +75,35 @@ class RecurrentBaseOp : public Operator<CUDAContext> {
   CuDNNWrapper cudnn_wrapper_;
   cudnnDropoutDescriptor_t dropoutDesc_;
   cudnnRNNDescriptor_t rnnDesc_;
+
+  // The descriptors of the current input shape, owned by the cache
   cudnnFilterDescriptor_t wDesc_;
   cudnnTensorDescriptor_t hxDesc_;
   cudnnTensorDescriptor_t cxDesc_;
   cudnnTensorDescriptor_t hyDesc_;
   cudnnTensorDescriptor_t cyDesc_;
-
-  std::unique_ptr<detail::TensorDescriptors<T>> xDesc_;
-  std::unique_ptr<detail::TensorDescriptors<T>> yDesc_;
+  const detail::TensorDescriptors<T>* xDesc_{nullptr};
+  const detail::TensorDescriptors<T>* yDesc_{nullptr};
 
   std::vector<TIndex> cachedInputDims_;
+  size_t weightsNbytes_;
   size_t reserveNbytes_;
   size_t cudnnWsNbytes_;
 
  private:
+  // The RNN and dropout descriptors only depend on the arguments
+  bool rnnDescInitialized_{false};
+  bool dropoutInitialized_{false};
+
+  // Sequence lengths are rounded up to a multiple of seqLengthBucket_ to
+  // share the descriptors of close lengths, 0 keeps them exact
+  const int seqLengthBucket_;
+  const int maxCachedShapes_;
+  // Keyed by (bucketed sequence length, batch size, input dim)
+  std::map<
+      std::array<int, 3>,
+      std::unique_ptr<detail::RecurrentShapeDescriptors<T>>>
+      shapeDescriptors_;
 };
 
 #define USE_RECURRENT_BASE_FUNCTIONS          \
@@ -76,6 +119,7 @@ class RecurrentBaseOp : public Operator<CUDAContext> {
   using RecurrentBaseOp<T>::xDesc_;           \
   using RecurrentBaseOp<T>::yDesc_;           \
   using RecurrentBaseOp<T>::cachedInputDims_; \
+  using RecurrentBaseOp<T>::weightsNbytes_;   \
   using RecurrentBaseOp<T>::reserveNbytes_;   \
   using RecurrentBaseOp<T>::cudnnWsNbytes_;   \
   using RecurrentBaseOp<T>::initialize;
@@ -1,84 +1,18 @@
 #include "roi_align_gradient_op.h"
 
+#include <functional>
+
+#include "caffe2/operators/roi_align_op.h"
 #include "caffe2/utils/eigen_utils.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
 namespace {
 
-template <typename T>
-void bilinear_interpolate_gradient(
-    const int height,
-    const int width,
-    T y,
-    T x,
-    T& w1,
-    T& w2,
-    T& w3,
-    T& w4,
-    int& x_low,
-    int& x_high,
-    int& y_low,
-    int& y_high,
-    const int /*index*/ /* index for debug only*/) {
-  // deal with cases that inverse elements are out of feature map boundary
-  if (y < -1.0 || y > height || x < -1.0 || x > width) {
-    // empty
-    w1 = w2 = w3 = w4 = 0.;
-    x_low = x_high = y_low = y_high = -1;
-    return;
-  }
-
-  if (y <= 0) {
-    y = 0;
-  }
-  if (x <= 0) {
-    x = 0;
-  }
-
-  y_low = (int)y;
-  x_low = (int)x;
-
-  if (y_low >= height - 1) {
-    y_high = y_low = height - 1;
-    y = (T)y_low;
-  } else {
-    y_high = y_low + 1;
-  }
-
-  if (x_low >= width - 1) {
-    x_high = x_low = width - 1;
-    x = (T)x_low;
-  } else {
-    x_high = x_low + 1;
-  }
-
-  T ly = y - y_low;
-  T lx = x - x_low;
-  T hy = 1. - ly, hx = 1. - lx;
-
-  // reference in forward
-  // T v1 = bottom_data[y_low * width + x_low];
-  // T v2 = bottom_data[y_low * width + x_high];
-  // T v3 = bottom_data[y_high * width + x_low];
-  // T v4 = bottom_data[y_high * width + x_high];
-  // T val = (w1 * v1 + w2 * v2 + w3 * v3 + w4 * v4);
-
-  w1 = hy * hx, w2 = hy * lx, w3 = ly * hx, w4 = ly * lx;
-
-  return;
-}
-
-template <class T>
-inline void add(const T& val, T* address) {
-  *address += val;
-}
-
 template <typename T>
 void ROIAlignBackwardFeature(
-    const int nthreads,
+    const int num_rois,
     const T* top_diff,
-    const int /*num_rois*/,
     const T& spatial_scale,
     const int channels,
     const int height,
@@ -88,98 +22,113 @@ void ROIAlignBackwardFeature(
     const int sampling_ratio,
     T* bottom_diff,
     const T* bottom_rois,
-    int rois_cols) {
+    int rois_cols,
+    StorageOrder order,
+    ThreadPool* pool,
+    int num_ranges) {
   DCHECK(rois_cols == 4 || rois_cols == 5);
 
-  for (int index = 0; index < nthreads; index++) {
-    // (n, c, ph, pw) is an element in the pooled output
-    int pw = index % pooled_width;
-    int ph = (index / pooled_width) % pooled_height;
-    int c = (index / pooled_width / pooled_height) % channels;
-    int n = index / pooled_width / pooled_height / channels;
-
-    const T* offset_bottom_rois = bottom_rois + n * rois_cols;
-    int roi_batch_ind = 0;
-    if (rois_cols == 5) {
-      roi_batch_ind = offset_bottom_rois[0];
-      offset_bottom_rois++;
+  auto run = [pool](int ranges, const std::function<void(size_t)>& fn) {
+    if (ranges <= 1) {
+      fn(0);
+    } else {
+      pool->runRanges(ranges, fn);
     }
-
-    // Do not using rounding; this implementation detail is critical
-    T roi_start_w = offset_bottom_rois[0] * spatial_scale;
-    T roi_start_h = offset_bottom_rois[1] * spatial_scale;
-    T roi_end_w = offset_bottom_rois[2] * spatial_scale;
-    T roi_end_h = offset_bottom_rois[3] * spatial_scale;
-    // T roi_start_w = round(offset_bottom_rois[0] * spatial_scale);
-    // T roi_start_h = round(offset_bottom_rois[1] * spatial_scale);
-    // T roi_end_w = round(offset_bottom_rois[2] * spatial_scale);
-    // T roi_end_h = round(offset_bottom_rois[3] * spatial_scale);
-
-    // Force malformed ROIs to be 1x1
-    T roi_width = std::max(roi_end_w - roi_start_w, (T)1.);
-    T roi_height = std::max(roi_end_h - roi_start_h, (T)1.);
-    T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
-    T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
-
-    T* offset_bottom_diff =
-        bottom_diff + (roi_batch_ind * channels + c) * height * width;
-
-    int top_offset = (n * channels + c) * pooled_height * pooled_width;
-    const T* offset_top_diff = top_diff + top_offset;
-    const T top_diff_this_bin = offset_top_diff[ph * pooled_width + pw];
-
-    // We use roi_bin_grid to sample the grid and mimic integral
-    int roi_bin_grid_h = (sampling_ratio > 0)
-        ? sampling_ratio
-        : ceil(roi_height / pooled_height); // e.g., = 2
-    int roi_bin_grid_w =
-        (sampling_ratio > 0) ? sampling_ratio : ceil(roi_width / pooled_width);
-
-    // We do average (integral) pooling inside a bin
-    const T count = roi_bin_grid_h * roi_bin_grid_w; // e.g. = 4
-
-    for (int iy = 0; iy < roi_bin_grid_h; iy++) {
-      const T y = roi_start_h + ph * bin_size_h +
-          static_cast<T>(iy + .5f) * bin_size_h /
-              static_cast<T>(roi_bin_grid_h); // e.g., 0.5, 1.5
-      for (int ix = 0; ix < roi_bin_grid_w; ix++) {
-        const T x = roi_start_w + pw * bin_size_w +
-            static_cast<T>(ix + .5f) * bin_size_w /
-                static_cast<T>(roi_bin_grid_w);
-
-        T w1, w2, w3, w4;
-        int x_low, x_high, y_low, y_high;
-
-        bilinear_interpolate_gradient(
-            height,
-            width,
-            y,
-            x,
-            w1,
-            w2,
-            w3,
-            w4,
-            x_low,
-            x_high,
-            y_low,
-            y_high,
-            index);
-
-        T g1 = top_diff_this_bin * w1 / count;
-        T g2 = top_diff_this_bin * w2 / count;
-        T g3 = top_diff_this_bin * w3 / count;
-        T g4 = top_diff_this_bin * w4 / count;
-
-        if (x_low >= 0 && x_high >= 0 && y_low >= 0 && y_high >= 0) {
-          // atomic add is not needed for now since it is single threaded
-          add(static_cast<T>(g1), offset_bottom_diff + y_low * width + x_low);
-          add(static_cast<T>(g2), offset_bottom_diff + y_low * width + x_high);
-          add(static_cast<T>(g3), offset_bottom_diff + y_high * width + x_low);
-          add(static_cast<T>(g4), offset_bottom_diff + y_high * width + x_high);
-        } // if
-      } // ix
-    } // iy
-  } // for
+  };
+
+  // The RoIs are taken num_ranges at a time: their sampling points are
+  // computed in parallel, one RoI per range, then their gradients are
+  // scattered in parallel over ranges of channels. Every channel of dX is
+  // written by one range only, in the order of the RoIs, so no atomic add is
+  // needed and the result does not depend on the number of threads.
+  const int pooled_size = pooled_height * pooled_width;
+  const int channel_ranges = std::max(1, std::min(channels, num_ranges));
+  std::vector<roi_align::RoISamples<T>> samples(num_ranges);
+  for (int begin = 0; begin < num_rois; begin += num_ranges) {
+    const int end = std::min(num_rois, begin + num_ranges);
+    run(end - begin, [&](size_t i) {
+      roi_align::ComputeRoISamples(
+          bottom_rois + (begin + i) * rois_cols,
+          rois_cols,
+          spatial_scale,
+          height,
+          width,
+          pooled_height,
+          pooled_width,
+          sampling_ratio,
+          &samples[i]);
+    });
+
+    run(channel_ranges, [&](size_t range) {
+      const int c_begin = channels * range / channel_ranges;
+      const int c_end = channels * (range + 1) / channel_ranges;
+      for (int n = begin; n < end; n++) {
+        const auto& roi_samples = samples[n - begin];
+        const auto& pre_calc = roi_samples.pre_calc;
+        // We do average (integral) pooling inside a bin
+        const T count = roi_samples.count;
+
+        if (order == StorageOrder::NCHW) {
+          for (int c = c_begin; c < c_end; c++) {
+            T* offset_bottom_diff = bottom_diff +
+                (roi_samples.batch_ind * channels + c) * height * width;
+            const T* offset_top_diff =
+                top_diff + (n * channels + c) * pooled_size;
+            int pre_calc_index = 0;
+            for (int bin = 0; bin < pooled_size; bin++) {
+              const T top_diff_this_bin = offset_top_diff[bin];
+              for (int i = 0; i < roi_samples.count; i++) {
+                const auto& pc = pre_calc[pre_calc_index++];
+                // The sampling points out of the feature map are empty
+                if (pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0) {
+                  continue;
+                }
+                offset_bottom_diff[pc.pos1] +=
+                    top_diff_this_bin * pc.w1 / count;
+                offset_bottom_diff[pc.pos2] +=
+                    top_diff_this_bin * pc.w2 / count;
+                offset_bottom_diff[pc.pos3] +=
+                    top_diff_this_bin * pc.w3 / count;
+                offset_bottom_diff[pc.pos4] +=
+                    top_diff_this_bin * pc.w4 / count;
+              }
+            }
+          }
+        } // if nchw
+
+        if (order == StorageOrder::NHWC) {
+          const int block = c_end - c_begin;
+          T* offset_bottom_diff = bottom_diff +
+              roi_samples.batch_ind * height * width * channels + c_begin;
+          const T* offset_top_diff =
+              top_diff + n * pooled_size * channels + c_begin;
+          int pre_calc_index = 0;
+          for (int bin = 0; bin < pooled_size; bin++) {
+            ConstEigenVectorMap<T> top_diff_this_bin(
+                offset_top_diff + bin * channels, block);
+            for (int i = 0; i < roi_samples.count; i++) {
+              const auto& pc = pre_calc[pre_calc_index++];
+              if (pc.w1 == 0 && pc.w2 == 0 && pc.w3 == 0 && pc.w4 == 0) {
+                continue;
+              }
+              EigenVectorMap<T>(
+                  offset_bottom_diff + channels * pc.pos1, block) +=
+                  top_diff_this_bin * pc.w1 / count;
+              EigenVectorMap<T>(
+                  offset_bottom_diff + channels * pc.pos2, block) +=
+                  top_diff_this_bin * pc.w2 / count;
+              EigenVectorMap<T>(
+                  offset_bottom_diff + channels * pc.pos3, block) +=
+                  top_diff_this_bin * pc.w3 / count;
+              EigenVectorMap<T>(
+                  offset_bottom_diff + channels * pc.pos4, block) +=
+                  top_diff_this_bin * pc.w4 / count;
+            }
+          }
+        } // if nhwc
+      }
+    });
+  }
 } // ROIAlignBackward
 
 } // namespace
@@ -205,20 +154,32 @@ bool RoIAlignGradientOp<float, CPUContext>::RunOnDevice() {
       dX->size(), 0.f, dX->mutable_data<float>(), &context_);
 
   if (dY.size() > 0) { // Handle possibly empty gradient if there were no rois
+    const bool nchw = order_ == StorageOrder::NCHW;
+    const int channels = nchw ? X.dim32(1) : X.dim32(3);
+    ThreadPool* pool = nullptr;
+    int num_ranges = 1;
+    if (num_threads_ != 1) {
+      pool = ws_->GetThreadPool();
+      const int pool_threads = pool->getNumThreads();
+      num_ranges = num_threads_ == 0 ? pool_threads
+                                     : std::min(num_threads_, pool_threads);
+    }
     ROIAlignBackwardFeature<float>(
-        dY.size(),
-        dY.data<float>(),
         R.dim32(0),
+        dY.data<float>(),
         spatial_scale_,
-        X.dim32(1),
-        X.dim32(2),
-        X.dim32(3),
+        channels,
+        nchw ? X.dim32(2) : X.dim32(1),
+        nchw ? X.dim32(3) : X.dim32(2),
         pooled_height_,
         pooled_width_,
         sampling_ratio_,
         dX->mutable_data<float>(),
         R.data<float>(),
-        R.dim32(1));
+        R.dim32(1),
+        order_,
+        pool,
+        num_ranges);
   }
   return true;
 }
@@ -230,6 +191,11 @@ REGISTER_CPU_OPERATOR(RoIAlignGradient, RoIAlignGradientOp<float, CPUContext>);
 OPERATOR_SCHEMA(RoIAlignGradient)
     .NumInputs(3)
     .NumOutputs(1)
+    .Arg(
+        "num_threads",
+        "(int) default 0; number of threads of the workspace pool the "
+        "gradient is split between on CPU: 0 uses all of them and 1 the "
+        "calling thread.")
     .Input(0, "X", "See RoIPoolF.")
     .Input(1, "RoIs", "See RoIPoolF.")
     .Input(2, "dY", "Gradient of forward output 0 (Y)")
@@ -1,7 +1,7 @@
 // Copyright 2004-present Facebook. All Rights Reserved.
 
-#ifndef ROI_ALIGN_OP_H_
-#define ROI_ALIGN_OP_H_
+#ifndef ROI_ALIGN_GRADIENT_OP_H_
+#define ROI_ALIGN_GRADIENT_OP_H_
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
@@ -14,6 +14,10 @@ class RoIAlignGradientOp final : public Operator<Context> {
  public:
   RoIAlignGradientOp(const OperatorDef& def, Workspace* ws)
       : Operator<Context>(def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        order_(StringToStorageOrder(
+            OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
         spatial_scale_(
             OperatorBase::GetSingleArgument<float>("spatial_scale", 1.)),
         pooled_height_(OperatorBase::GetSingleArgument<int>("pooled_h", 1)),
@@ -24,6 +28,8 @@ class RoIAlignGradientOp final : public Operator<Context> {
     DCHECK_GT(pooled_height_, 0);
     DCHECK_GT(pooled_width_, 0);
     DCHECK_GE(sampling_ratio_, 0);
+    DCHECK(order_ == StorageOrder::NCHW || order_ == StorageOrder::NHWC);
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
@@ -32,6 +38,11 @@ class RoIAlignGradientOp final : public Operator<Context> {
   }
 
  protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the gradient is split between on
+  // CPU: 0 uses all of them, 1 the calling thread
+  int num_threads_;
+  StorageOrder order_;
   float spatial_scale_;
   int pooled_height_;
   int pooled_width_;
@@ -40,4 +51,4 @@ class RoIAlignGradientOp final : public Operator<Context> {
 
 } // namespace caffe2
 
-#endif // ROI_ALIGN_OP_H_
+#endif // ROI_ALIGN_GRADIENT_OP_H_
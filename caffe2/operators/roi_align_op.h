@@ -3,17 +3,162 @@
 #ifndef ROI_ALIGN_OP_H_
 #define ROI_ALIGN_OP_H_
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "caffe2/core/context.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 
 namespace caffe2 {
 
+namespace roi_align {
+
+// Indices and bilinear interpolation weights of the 4 neighbours of a
+// sampling point in an H x W plane
+template <typename T>
+struct PreCalc {
+  int pos1;
+  int pos2;
+  int pos3;
+  int pos4;
+  T w1;
+  T w2;
+  T w3;
+  T w4;
+};
+
+// The sampling points of a RoI, shared by all channels
+template <typename T>
+struct RoISamples {
+  int batch_ind;
+  // Number of sampling points averaged in every bin
+  int count;
+  // The count sampling points of every bin, bin after bin in row-major order.
+  // The points out of the feature map have zero weights.
+  std::vector<PreCalc<T>> pre_calc;
+};
+
+// Computes the sampling points of roi, which has 4 or 5 columns, as used by
+// the CPU RoIAlign and RoIAlignGradient
+template <typename T>
+void ComputeRoISamples(
+    const T* roi,
+    const int roi_cols,
+    const T spatial_scale,
+    const int height,
+    const int width,
+    const int pooled_height,
+    const int pooled_width,
+    const int sampling_ratio,
+    RoISamples<T>* samples) {
+  // roi could have 4 or 5 columns
+  samples->batch_ind = 0;
+  if (roi_cols == 5) {
+    samples->batch_ind = roi[0];
+    roi++;
+  }
+
+  // Do not using rounding; this implementation detail is critical
+  T roi_start_w = roi[0] * spatial_scale;
+  T roi_start_h = roi[1] * spatial_scale;
+  T roi_end_w = roi[2] * spatial_scale;
+  T roi_end_h = roi[3] * spatial_scale;
+
+  // Force malformed ROIs to be 1x1
+  T roi_width = std::max(roi_end_w - roi_start_w, (T)1.);
+  T roi_height = std::max(roi_end_h - roi_start_h, (T)1.);
+  T bin_size_h = static_cast<T>(roi_height) / static_cast<T>(pooled_height);
+  T bin_size_w = static_cast<T>(roi_width) / static_cast<T>(pooled_width);
+
+  // We use roi_bin_grid to sample the grid and mimic integral
+  int roi_bin_grid_h = (sampling_ratio > 0)
+      ? sampling_ratio
+      : std::ceil(roi_height / pooled_height); // e.g., = 2
+  int roi_bin_grid_w = (sampling_ratio > 0)
+      ? sampling_ratio
+      : std::ceil(roi_width / pooled_width);
+  samples->count = roi_bin_grid_h * roi_bin_grid_w; // e.g. = 4
+
+  samples->pre_calc.resize(samples->count * pooled_height * pooled_width);
+  int pre_calc_index = 0;
+  for (int ph = 0; ph < pooled_height; ph++) {
+    for (int pw = 0; pw < pooled_width; pw++) {
+      for (int iy = 0; iy < roi_bin_grid_h; iy++) {
+        const T yy = roi_start_h + ph * bin_size_h +
+            static_cast<T>(iy + .5f) * bin_size_h /
+                static_cast<T>(roi_bin_grid_h); // e.g., 0.5, 1.5
+        for (int ix = 0; ix < roi_bin_grid_w; ix++) {
+          const T xx = roi_start_w + pw * bin_size_w +
+              static_cast<T>(ix + .5f) * bin_size_w /
+                  static_cast<T>(roi_bin_grid_w);
+
+          T x = xx;
+          T y = yy;
+          PreCalc<T>& pc = samples->pre_calc[pre_calc_index++];
+          // deal with: inverse elements are out of feature map boundary
+          if (y < -1.0 || y > height || x < -1.0 || x > width) {
+            // empty
+            pc.pos1 = pc.pos2 = pc.pos3 = pc.pos4 = 0;
+            pc.w1 = pc.w2 = pc.w3 = pc.w4 = 0;
+            continue;
+          }
+
+          if (y <= 0) {
+            y = 0;
+          }
+          if (x <= 0) {
+            x = 0;
+          }
+
+          int y_low = (int)y;
+          int x_low = (int)x;
+          int y_high;
+          int x_high;
+
+          if (y_low >= height - 1) {
+            y_high = y_low = height - 1;
+            y = (T)y_low;
+          } else {
+            y_high = y_low + 1;
+          }
+
+          if (x_low >= width - 1) {
+            x_high = x_low = width - 1;
+            x = (T)x_low;
+          } else {
+            x_high = x_low + 1;
+          }
+
+          T ly = y - y_low;
+          T lx = x - x_low;
+          T hy = 1. - ly, hx = 1. - lx;
+
+          // save weights and indeces
+          pc.pos1 = y_low * width + x_low;
+          pc.pos2 = y_low * width + x_high;
+          pc.pos3 = y_high * width + x_low;
+          pc.pos4 = y_high * width + x_high;
+          pc.w1 = hy * hx;
+          pc.w2 = hy * lx;
+          pc.w3 = ly * hx;
+          pc.w4 = ly * lx;
+        }
+      }
+    }
+  }
+}
+
+} // namespace roi_align
+
 template <typename T, class Context>
 class RoIAlignOp final : public Operator<Context> {
  public:
   RoIAlignOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
         order_(StringToStorageOrder(
             OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
         spatial_scale_(
@@ -27,6 +172,7 @@ class RoIAlignOp final : public Operator<Context> {
     DCHECK_GT(pooled_width_, 0);
     DCHECK_GE(sampling_ratio_, 0);
     DCHECK(order_ == StorageOrder::NCHW || order_ == StorageOrder::NHWC);
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
   USE_OPERATOR_CONTEXT_FUNCTIONS;
 
@@ -35,6 +181,10 @@ class RoIAlignOp final : public Operator<Context> {
   }
 
  protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the RoIs are split between on
+  // CPU: 0 uses all of them, 1 the calling thread
+  int num_threads_;
   StorageOrder order_;
   float spatial_scale_;
   int pooled_height_;
@@ -6,6 +6,7 @@ REGISTER_CPU_OPERATOR(Scale, ScaleOp<CPUContext>);
 OPERATOR_SCHEMA(Scale)
   .NumInputs(1)
   .NumOutputs(1)
+  .CostInferenceFunction(PointwiseCostInference<1>)
   .AllowInplace({{0, 0}})
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
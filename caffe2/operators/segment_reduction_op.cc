@@ -71,7 +71,7 @@ string FormatDoc() {
       string(__VA_ARGS__::basename) + (__VA_ARGS__::OpDef::name))              \
       .NumInputs(__VA_ARGS__::ForwardOp::kNumInputs)                           \
       .NumOutputs(1)                                                           \
-      .SetDoc(FormatDoc<__VA_ARGS__>())                                        \
+      .SetDocGenerator(FormatDoc<__VA_ARGS__>)                                 \
       .Output(0, "OUTPUT", "Aggregated tensor")                                \
       .FillUsing(__VA_ARGS__::PopulateSchema);                                 \
   REGISTER_CPU_OPERATOR_STR(                                                   \
@@ -191,7 +191,7 @@ REGISTER_GRADIENT_WITH_MAIN_INPUT(
       string(__VA_ARGS__::basename) + (__VA_ARGS__::OpDef::name))        \
       .NumInputs(__VA_ARGS__::ForwardOp::kNumInputs)                     \
       .NumOutputs(1)                                                     \
-      .SetDoc(FormatDoc<__VA_ARGS__>())                                  \
+      .SetDocGenerator(FormatDoc<__VA_ARGS__>)                           \
       .Output(0, "OUTPUT", "Aggregated tensor")                          \
       .FillUsing(__VA_ARGS__::PopulateSchema);                           \
   REGISTER_GRADIENT_WITH_MAIN_INPUT_AND_FORWARD_OUTPUT(__VA_ARGS__);     \
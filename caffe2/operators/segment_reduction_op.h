@@ -5,6 +5,7 @@
 #include "caffe2/core/logging.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/operators/reducer_functors.h"
+#include "caffe2/perfkernels/half_float.h"
 
 namespace caffe2 {
 
@@ -1689,7 +1690,17 @@ class AbstractLengthsWithMainInputGradientOp : public Operator<Context> {
     TIndex segmentBlockSize = segmentGradsInput.size_from_dim(1);
     T* dataGrads = dataGradsOutput->template mutable_data<T>();
 
-    const T* data = dataInput.template data<T>();
+    // Half precision tables are read one row at a time into a float buffer
+    const T* data = nullptr;
+    const float16* dataFloat16 = nullptr;
+    vector<float> dataRow;
+    if (std::is_same<T, float>::value &&
+        dataInput.template IsType<float16>()) {
+      dataFloat16 = dataInput.template data<float16>();
+      dataRow.resize(dataGradsBlockSize);
+    } else {
+      data = dataInput.template data<T>();
+    }
 
     TIndex dataIndex = 0;
     for (TIndex rangeIndex = 0; rangeIndex < numSegments; ++rangeIndex) {
@@ -1704,9 +1715,19 @@ class AbstractLengthsWithMainInputGradientOp : public Operator<Context> {
         } else {
           data_pos = dataIndex;
         }
+        const T* dataPtr;
+        if (dataFloat16) {
+          Float16ToFloat(
+              dataGradsBlockSize,
+              dataFloat16 + dataGradsBlockSize * data_pos,
+              dataRow.data());
+          dataPtr = reinterpret_cast<const T*>(dataRow.data());
+        } else {
+          dataPtr = data + dataGradsBlockSize * data_pos;
+        }
         reducer.template fillGradWithMainInput<FixedSize>(
             ctx,
-            data + dataGradsBlockSize * data_pos,
+            dataPtr,
             dataGrads + dataGradsBlockSize * dataIndex,
             dataIndex,
             &context_,
@@ -1834,6 +1855,19 @@ template <
 struct LengthsOpGetGradient : public GradientMakerBase {
   using GradientMakerBase::GradientMakerBase;
   vector<OperatorDef> GetGradientDefs() override {
+    if (SparseFused &&
+        ArgumentHelper::GetSingleArgument(def_, "dedup_gradient", false)) {
+      const string name = ReducerDef::name;
+      CAFFE_ENFORCE(
+          name == "Sum" || name == "Mean",
+          "dedup_gradient is only supported by SparseLengthsSum and "
+          "SparseLengthsMean");
+      return SingleGradientDef(
+          "SparseLengths" + name + "DedupGradient",
+          "",
+          vector<string>{GO(0), I(ForwardOp::LENGTHS), I(ForwardOp::INDICES)},
+          vector<string>{GI_I(0), GI_V(0)});
+    }
     vector<string> grad_ins;
     string suffix = "Gradient";
     for (const int i : ReducerGradient::originalInputs()) {
@@ -1963,6 +1997,32 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
       GradientNeedIndices>;
 };
 
+// Cost of the SparseLengths reductions, whose inputs are DATA, WEIGHTS if
+// use_weight, INDICES and LENGTHS
+inline OpSchema::Cost CostInferenceForSparseLengths(
+    const OperatorDef& /* unused */,
+    const vector<TensorShape>& inputs,
+    bool use_weight) {
+  CAFFE_ENFORCE_GE(inputs.size(), use_weight ? 4 : 3);
+  struct OpSchema::Cost c;
+  const TensorShape& data = inputs[0];
+  const TensorShape& indices = inputs[1 + use_weight];
+  const TensorShape& lengths = inputs[2 + use_weight];
+  const uint64_t num_rows = nElemFromDim(indices);
+  const uint64_t block_size = nElemFromDim(data, 1);
+  const uint64_t row_bytes =
+      data.dims_size() > 0 && data.dims(0) > 0
+      ? nBytesOfShape(data) / data.dims(0)
+      : block_size * sizeof(float);
+  // An addition, and a multiplication by the weight, per element of the
+  // looked up rows
+  c.flops = num_rows * block_size * (use_weight ? 2 : 1);
+  c.bytes_read = num_rows * row_bytes + nBytesOfShape(indices) +
+      nBytesOfShape(lengths) + (use_weight ? nBytesOfShape(inputs[1]) : 0);
+  c.bytes_written = nElemFromDim(lengths) * block_size * sizeof(float);
+  return c;
+}
+
 template <
     typename T,
     typename SIndex,
@@ -2006,6 +2066,27 @@ i.e. `len(LENGTHS)`. Other dimensions are inherited from the input tensor.
         "OUTPUT",
         "Aggregated output tensor. Has the first dimension of K "
         "(the number of segments).");
+    schema.Arg(
+        "num_threads",
+        "(CPU Sum, WeightedSum and Mean only) Number of threads of the "
+        "workspace thread pool to split the segments over, balanced by the "
+        "sum of their lengths. Default is "
+        "--caffe2_sparse_lengths_num_threads; 1 runs on the calling thread "
+        "and 0 uses the whole pool.");
+    schema.Arg(
+        "min_indices_per_thread",
+        "(CPU Sum, WeightedSum and Mean only) Minimum number of INDICES per "
+        "thread, smaller lookups use fewer threads.");
+    schema.Arg(
+        "dedup_gradient",
+        "(CPU Sum and Mean only) If set, the gradient with respect to DATA "
+        "holds every looked up index once, with the rows of its occurrences "
+        "summed, rather than one row per element of INDICES.");
+    schema.CostInferenceFunction(
+        [](const OperatorDef& def, const vector<TensorShape>& inputs) {
+          return CostInferenceForSparseLengths(
+              def, inputs, Reducer::kInputCount == 2);
+        });
     ReducerDef::PopulateSchema(schema);
   }
   using Reducer = typename ReducerDef::template Reducer<T, Context>;
@@ -1,9 +1,71 @@
 #include "caffe2/operators/sequence_ops.h"
+
+#include <functional>
+
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
+namespace {
+
+// Below this many elements per thread, the segments aren't split
+constexpr TIndex kMinParallelSize = 1 << 16;
+
+// Number of ranges to split num_segments segments of size elements in all
+// between num_threads threads of the workspace pool
+TIndex NumSegmentRanges(
+    Workspace* ws,
+    int num_threads,
+    TIndex num_segments,
+    TIndex size) {
+  if (num_threads == 1 || num_segments <= 1 || size < 2 * kMinParallelSize) {
+    return 1;
+  }
+  const int pool_threads = ws->GetThreadPool()->getNumThreads();
+  const int threads =
+      num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads);
+  return std::max<TIndex>(
+      1,
+      std::min<TIndex>(
+          std::min<TIndex>(threads, num_segments), size / kMinParallelSize));
+}
+
+// Runs fn(range, begin, end) on num_ranges ranges of [0, num_segments)
+void RunSegmentRanges(
+    Workspace* ws,
+    TIndex num_ranges,
+    TIndex num_segments,
+    const std::function<void(TIndex, TIndex, TIndex)>& fn) {
+  auto run = [&](size_t range) {
+    fn(range,
+       range * num_segments / num_ranges,
+       (range + 1) * num_segments / num_ranges);
+  };
+  if (num_ranges <= 1) {
+    run(0);
+  } else {
+    ws->GetThreadPool()->runRanges(num_ranges, run);
+  }
+}
+
+// Offsets of the segments in the lengths_size + 1 offsets, checking that
+// their total length is consistent
+void SegmentOffsets(
+    const int32_t* lengths_ptr,
+    int64_t lengths_size,
+    int32_t outer_size,
+    int64_t* offsets) {
+  offsets[0] = 0;
+  for (int64_t i = 0; i < lengths_size; ++i) {
+    offsets[i + 1] = offsets[i] + lengths_ptr[i];
+    CAFFE_ENFORCE_LE(offsets[i + 1], outer_size);
+  }
+}
+
+} // namespace
+
 template <>
 template <typename T>
 void GatherPaddingOp<CPUContext>::GatherPadding(
@@ -19,30 +81,67 @@ void GatherPaddingOp<CPUContext>::GatherPadding(
       (!std::is_same<bool, T>::value),
       "GatherPadding should not be executed on an input of type bool, as "
       "addition is not properly defined with booleans.");
-  int64_t total_length = 0;
-  for (int i = 0; i < lengths_size; ++i) {
-    // check total length consistency
-    const auto length = lengths_ptr[i];
-    total_length += length;
-    CAFFE_ENFORCE_LE(total_length, outer_size);
-    // accumulate start paddings
-    for (int j = 0; j < startPaddingWidth_; ++j) {
-      for (int k = 0; k < block_size; ++k) {
-        // Note: MSVC warns about unsafe use of type bool in operation.
-        // This is now guarded by a CAFFE_ENFORCE so we can suppress it.
-        #pragma warning(suppress: 4804)
-        padding_start_ptr[k] += in_ptr[k];
-      }
-      in_ptr += block_size;
+  std::vector<int64_t> offsets(lengths_size + 1);
+  SegmentOffsets(lengths_ptr, lengths_size, outer_size, offsets.data());
+
+  // The ranges after the first one accumulate the paddings of their
+  // segments in partial sums, added to the outputs at the end
+  const TIndex num_ranges = NumSegmentRanges(
+      ws_, numThreads_, lengths_size, offsets.back() * block_size);
+  const bool same_padding = padding_start_ptr == padding_end_ptr;
+  const int partial_size = (same_padding ? 1 : 2) * block_size;
+  TensorCPU partials;
+  T* partials_ptr = nullptr;
+  if (num_ranges > 1) {
+    partials.Resize((num_ranges - 1) * partial_size);
+    partials_ptr = partials.mutable_data<T>();
+    std::fill(partials_ptr, partials_ptr + partials.size(), T(0));
+  }
+  RunSegmentRanges(
+      ws_,
+      num_ranges,
+      lengths_size,
+      [&](TIndex range, TIndex begin, TIndex end) {
+        T* start_ptr = padding_start_ptr;
+        T* end_ptr = padding_end_ptr;
+        if (range > 0) {
+          start_ptr = partials_ptr + (range - 1) * partial_size;
+          end_ptr = same_padding ? start_ptr : start_ptr + block_size;
+        }
+        for (TIndex i = begin; i < end; ++i) {
+          // accumulate start paddings
+          const T* rows_ptr = in_ptr + offsets[i] * block_size;
+          for (int j = 0; j < startPaddingWidth_; ++j) {
+            for (int k = 0; k < block_size; ++k) {
+              // Note: MSVC warns about unsafe use of type bool in operation.
+              // This is now guarded by a CAFFE_ENFORCE so we can suppress it.
+              #pragma warning(suppress: 4804)
+              start_ptr[k] += rows_ptr[k];
+            }
+            rows_ptr += block_size;
+          }
+          // accumulate end paddings
+          rows_ptr = in_ptr + (offsets[i + 1] - endPaddingWidth_) * block_size;
+          for (int j = 0; j < endPaddingWidth_; ++j) {
+            for (int k = 0; k < block_size; ++k) {
+              #pragma warning(suppress: 4804)
+              end_ptr[k] += rows_ptr[k];
+            }
+            rows_ptr += block_size;
+          }
+        }
+      });
+  for (TIndex range = 1; range < num_ranges; ++range) {
+    const T* partial_ptr = partials_ptr + (range - 1) * partial_size;
+    for (int k = 0; k < block_size; ++k) {
+      #pragma warning(suppress: 4804)
+      padding_start_ptr[k] += partial_ptr[k];
     }
-    in_ptr += block_size * (length - pad_width);
-    // accumulate end paddings
-    for (int j = 0; j < endPaddingWidth_; ++j) {
+    if (!same_padding) {
       for (int k = 0; k < block_size; ++k) {
         #pragma warning(suppress: 4804)
-        padding_end_ptr[k] += in_ptr[k];
+        padding_end_ptr[k] += partial_ptr[block_size + k];
       }
-      in_ptr += block_size;
     }
   }
 }
@@ -74,19 +173,22 @@ bool RemovePaddingOp<CPUContext>::DoRunWithType() {
   }
   const auto* in_ptr = in.template data<T>();
   auto* out_ptr = out->template mutable_data<T>();
-  int64_t total_length = 0;
-  for (int i = 0; i < lengths_size; ++i) {
-    // check that total length is consistent
-    const auto length = lengths_ptr[i];
-    total_length += length;
-    CAFFE_ENFORCE_LE(total_length, outer_size);
-    std::copy(
-        in_ptr + block_size * startPaddingWidth_,
-        in_ptr + block_size * (length - endPaddingWidth_),
-        out_ptr);
-    in_ptr += block_size * length;
-    out_ptr += block_size * (length - pad_width);
-  }
+  std::vector<int64_t> offsets(lengths_size + 1);
+  SegmentOffsets(lengths_ptr, lengths_size, outer_size, offsets.data());
+  // every segment is a single copy, and the segments are split between
+  // threads for large inputs
+  RunSegmentRanges(
+      ws_,
+      NumSegmentRanges(ws_, numThreads_, lengths_size, out->size()),
+      lengths_size,
+      [&](TIndex /*range*/, TIndex begin, TIndex end) {
+        for (TIndex i = begin; i < end; ++i) {
+          std::copy(
+              in_ptr + block_size * (offsets[i] + startPaddingWidth_),
+              in_ptr + block_size * (offsets[i + 1] - endPaddingWidth_),
+              out_ptr + block_size * (offsets[i] - i * pad_width));
+        }
+      });
   if (OutputSize() == 1) {
     return true;
   }
@@ -115,44 +217,46 @@ bool AddPaddingOp<CPUContext>::MakePadding(
     lengths_ptr = &outer_size;
   }
 
-  int64_t total_length = 0;
-  for (int i = 0; i < lengths_size; ++i) {
-    // check that total length is consistent
-    const auto length = lengths_ptr[i];
-    total_length += length;
-    CAFFE_ENFORCE_LE(total_length, outer_size);
-    // copy padding before
-    if (!padding_start_ptr) {
-      memset(out_ptr, 0, block_size * startPaddingWidth_ * sizeof(T));
-      out_ptr += block_size * startPaddingWidth_;
-    } else {
-      for (int j = 0; j < startPaddingWidth_; ++j) {
-        std::copy(padding_start_ptr, padding_start_ptr + block_size, out_ptr);
-        out_ptr += block_size;
-      }
+  const auto pad_width = startPaddingWidth_ + endPaddingWidth_;
+  std::vector<int64_t> offsets(lengths_size + 1);
+  SegmentOffsets(lengths_ptr, lengths_size, outer_size, offsets.data());
+  // copies a padding of width rows to out
+  auto pad = [block_size](const T* padding_ptr, int width, T* out) {
+    if (!padding_ptr) {
+      memset(out, 0, block_size * width * sizeof(T));
+      return;
     }
-    // copy payload
-    const auto num_elems = block_size * length;
-    std::copy(in_ptr, in_ptr + num_elems, out_ptr);
-    in_ptr += num_elems;
-    out_ptr += num_elems;
-    // copy padding after
-    if (!padding_end_ptr) {
-      memset(out_ptr, 0, block_size * endPaddingWidth_ * sizeof(T));
-      out_ptr += block_size * endPaddingWidth_;
-    } else {
-      for (int j = 0; j < endPaddingWidth_; ++j) {
-        std::copy(padding_end_ptr, padding_end_ptr + block_size, out_ptr);
-        out_ptr += block_size;
-      }
+    for (int j = 0; j < width; ++j) {
+      std::copy(padding_ptr, padding_ptr + block_size, out + j * block_size);
     }
-  }
+  };
+  RunSegmentRanges(
+      ws_,
+      NumSegmentRanges(
+          ws_,
+          numThreads_,
+          lengths_size,
+          (offsets.back() + pad_width * lengths_size) * block_size),
+      lengths_size,
+      [&](TIndex /*range*/, TIndex begin, TIndex end) {
+        for (TIndex i = begin; i < end; ++i) {
+          T* out = out_ptr + block_size * (offsets[i] + i * pad_width);
+          // copy padding before
+          pad(padding_start_ptr, startPaddingWidth_, out);
+          out += block_size * startPaddingWidth_;
+          // copy payload
+          const auto num_elems = block_size * (offsets[i + 1] - offsets[i]);
+          const T* in = in_ptr + block_size * offsets[i];
+          std::copy(in, in + num_elems, out);
+          // copy padding after
+          pad(padding_end_ptr, endPaddingWidth_, out + num_elems);
+        }
+      });
   if (OutputSize() == 1) {
     return true;
   }
   auto* lengths_out = Output(1);
   lengths_out->Resize(lengths_size);
-  const auto pad_width = startPaddingWidth_ + endPaddingWidth_;
   std::transform(
       lengths_ptr,
       lengths_ptr + lengths_size,
@@ -302,6 +406,10 @@ at the start and end of data.
     .Arg(
         "end_padding_width",
         "(Optional) Specifies a different end-padding width.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace pool large inputs are split "
+        "between on CPU, all of them by default (0)")
     .Input(0, "data_in", "(T<N, D1..., Dn>) Input data")
     .Input(
         1,
@@ -328,6 +436,10 @@ for input and output data format.
     .Arg(
         "end_padding_width",
         "(Optional) Specifies a different end-padding width.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace pool large inputs are split "
+        "between on CPU, all of them by default (0)")
     .Input(0, "data_in", "T<N, D1..., Dn> Input data")
     .Input(
         1,
@@ -351,6 +463,10 @@ order to compute the gradients of AddPadding w.r.t the padding tensors.
     .Arg(
         "end_padding_width",
         "(Optional) Specifies a different end-padding width.")
+    .Arg(
+        "num_threads",
+        "Number of threads of the workspace pool large inputs are split "
+        "between on CPU, all of them by default (0)")
     .Input(0, "data_in", "T<N, D1..., Dn> Padded input data")
     .Input(
         1,
@@ -3,6 +3,7 @@
 
 #include "caffe2/core/operator.h"
 #include "caffe2/core/tensor.h"
+#include "caffe2/core/workspace.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
@@ -16,8 +17,11 @@ class GatherPaddingOp final : public Operator<Context> {
         startPaddingWidth_(
             OperatorBase::GetSingleArgument<int>("padding_width", 1)),
         endPaddingWidth_(
-            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)) {
+            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)),
+        ws_(ws),
+        numThreads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE_GE(startPaddingWidth_, 0);
+    CAFFE_ENFORCE_GE(numThreads_, 0, "num_threads has to be non negative");
     if (endPaddingWidth_ < 0) {
       endPaddingWidth_ = startPaddingWidth_;
     }
@@ -92,6 +96,10 @@ class GatherPaddingOp final : public Operator<Context> {
 
   int startPaddingWidth_;
   int endPaddingWidth_;
+  // The CPU version splits the segments of large inputs between the threads
+  // of the workspace pool: 0 uses all of them, 1 the calling thread
+  Workspace* ws_;
+  int numThreads_;
   // Scratch space required by the CUDA version
   Tensor<Context> lengths_prefix_sum_buffer_;
   Tensor<Context> lengths_prefix_sum_;
@@ -106,8 +114,11 @@ class RemovePaddingOp final : public Operator<Context> {
         startPaddingWidth_(
             OperatorBase::GetSingleArgument<int>("padding_width", 1)),
         endPaddingWidth_(
-            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)) {
+            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)),
+        ws_(ws),
+        numThreads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE_GE(startPaddingWidth_, 0);
+    CAFFE_ENFORCE_GE(numThreads_, 0, "num_threads has to be non negative");
     if (endPaddingWidth_ < 0) {
       endPaddingWidth_ = startPaddingWidth_;
     }
@@ -131,6 +142,10 @@ class RemovePaddingOp final : public Operator<Context> {
  private:
   int startPaddingWidth_;
   int endPaddingWidth_;
+  // The CPU version splits the segments of large inputs between the threads
+  // of the workspace pool: 0 uses all of them, 1 the calling thread
+  Workspace* ws_;
+  int numThreads_;
 
   // Scratch space required by the CUDA version
   Tensor<Context> lengths_prefix_sum_buffer_;
@@ -146,8 +161,11 @@ class AddPaddingOp final : public Operator<Context> {
         startPaddingWidth_(
             OperatorBase::GetSingleArgument<int>("padding_width", 1)),
         endPaddingWidth_(
-            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)) {
+            OperatorBase::GetSingleArgument<int>("end_padding_width", -1)),
+        ws_(ws),
+        numThreads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE_GE(startPaddingWidth_, 0);
+    CAFFE_ENFORCE_GE(numThreads_, 0, "num_threads has to be non negative");
     if (endPaddingWidth_ < 0) {
       endPaddingWidth_ = startPaddingWidth_;
     }
@@ -234,6 +252,10 @@ class AddPaddingOp final : public Operator<Context> {
 
   int startPaddingWidth_;
   int endPaddingWidth_;
+  // The CPU version splits the segments of large inputs between the threads
+  // of the workspace pool: 0 uses all of them, 1 the calling thread
+  Workspace* ws_;
+  int numThreads_;
 
   // Scratch space required by the CUDA version
   Tensor<Context> lengths_prefix_sum_buffer_;
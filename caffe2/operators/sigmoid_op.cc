@@ -39,6 +39,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Sigmoid)
   .NumInputs(1)
   .NumOutputs(1)
+  .AcceptsTensorViews()
+  .CostInferenceFunction(PointwiseCostInference<3>)
   .AllowInplace({{0, 0}})
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
@@ -0,0 +1,132 @@
+#include "caffe2/operators/sketch_ops.h"
+
+namespace caffe2 {
+
+CAFFE_KNOWN_TYPE(CountMinSketch);
+CAFFE_KNOWN_TYPE(HyperLogLog);
+
+namespace {
+
+REGISTER_BLOB_SERIALIZER(
+    (TypeMeta::Id<CountMinSketch>()),
+    CountMinSketchSerializer);
+REGISTER_BLOB_DESERIALIZER(caffe2::CountMinSketch, CountMinSketchDeserializer);
+REGISTER_BLOB_SERIALIZER(
+    (TypeMeta::Id<HyperLogLog>()),
+    HyperLogLogSerializer);
+REGISTER_BLOB_DESERIALIZER(caffe2::HyperLogLog, HyperLogLogDeserializer);
+
+REGISTER_CPU_OPERATOR(CreateCountMinSketch, CreateCountMinSketchOp<CPUContext>);
+REGISTER_CPU_OPERATOR(CountMinSketchUpdate, CountMinSketchUpdateOp<CPUContext>);
+REGISTER_CPU_OPERATOR(CountMinSketchQuery, CountMinSketchQueryOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    CountMinSketchMerge,
+    MergeSketchesOp<CountMinSketch, CPUContext>);
+REGISTER_CPU_OPERATOR(CreateHyperLogLog, CreateHyperLogLogOp<CPUContext>);
+REGISTER_CPU_OPERATOR(HyperLogLogUpdate, HyperLogLogUpdateOp<CPUContext>);
+REGISTER_CPU_OPERATOR(HyperLogLogEstimate, HyperLogLogEstimateOp<CPUContext>);
+REGISTER_CPU_OPERATOR(
+    HyperLogLogMerge,
+    MergeSketchesOp<HyperLogLog, CPUContext>);
+
+OPERATOR_SCHEMA(CreateCountMinSketch)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates an empty count-min sketch, which estimates the frequencies of integer
+keys in constant memory. The estimates are never below the true frequencies,
+and exceed them by at most e / width of the total count with probability
+1 - exp(-depth). The sketch can be saved and loaded.
+)DOC")
+    .Arg("width", "Number of counters per row (default 65536)")
+    .Arg("depth", "Number of rows, each with its own hash (default 4)")
+    .Arg("seed", "Seed of the hashes (default 0)")
+    .Output(0, "sketch", "Blob reference to the sketch");
+
+OPERATOR_SCHEMA(CountMinSketchUpdate)
+    .NumInputs(2, 3)
+    .NumOutputs(1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc("Adds a batch of keys to a count-min sketch.")
+    .Input(0, "sketch", "Blob reference to the sketch")
+    .Input(1, "keys", "int32 or int64 tensor of keys")
+    .Input(
+        2,
+        "counts",
+        "Optional int64 tensor of the count of each key, 1 by default")
+    .Output(0, "sketch", "Blob reference to the same sketch");
+
+OPERATOR_SCHEMA(CountMinSketchQuery)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .SetDoc("Estimates the frequencies of keys with a count-min sketch.")
+    .Input(0, "sketch", "Blob reference to the sketch")
+    .Input(1, "keys", "int32 or int64 tensor of keys")
+    .Output(0, "counts", "int64 tensor of the estimated count of each key");
+
+OPERATOR_SCHEMA(CountMinSketchMerge)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Adds the counts of count-min sketches, e.g. those built by different trainers,
+into the first one. The sketches must have the same width, depth and seed.
+)DOC")
+    .Input(0, "sketch", "Blob reference to the sketch to merge into")
+    .Output(0, "sketch", "Blob reference to the same sketch");
+
+OPERATOR_SCHEMA(CreateHyperLogLog)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates an empty HyperLogLog, which estimates the number of distinct integer
+keys with 2^precision bytes of memory. The relative standard error of the
+estimate is about 1.04 / sqrt(2^precision). The HyperLogLog can be saved and
+loaded.
+)DOC")
+    .Arg(
+        "precision",
+        "Number of bits of the hash picking the register, in [4, 18] "
+        "(default 14)")
+    .Arg("seed", "Seed of the hash (default 0)")
+    .Output(0, "hll", "Blob reference to the HyperLogLog");
+
+OPERATOR_SCHEMA(HyperLogLogUpdate)
+    .NumInputs(2)
+    .NumOutputs(1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc("Adds a batch of keys to a HyperLogLog.")
+    .Input(0, "hll", "Blob reference to the HyperLogLog")
+    .Input(1, "keys", "int32 or int64 tensor of keys")
+    .Output(0, "hll", "Blob reference to the same HyperLogLog");
+
+OPERATOR_SCHEMA(HyperLogLogEstimate)
+    .NumInputs(1)
+    .NumOutputs(1)
+    .SetDoc("Estimates the number of distinct keys added to a HyperLogLog.")
+    .Input(0, "hll", "Blob reference to the HyperLogLog")
+    .Output(0, "estimate", "int64 scalar tensor of the estimate");
+
+OPERATOR_SCHEMA(HyperLogLogMerge)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1)
+    .EnforceInplace({{0, 0}})
+    .SetDoc(R"DOC(
+Merges HyperLogLogs into the first one, which then estimates the number of
+distinct keys added to any of them. The HyperLogLogs must have the same
+precision and seed.
+)DOC")
+    .Input(0, "hll", "Blob reference to the HyperLogLog to merge into")
+    .Output(0, "hll", "Blob reference to the same HyperLogLog");
+
+SHOULD_NOT_DO_GRADIENT(CreateCountMinSketch);
+SHOULD_NOT_DO_GRADIENT(CountMinSketchUpdate);
+SHOULD_NOT_DO_GRADIENT(CountMinSketchQuery);
+SHOULD_NOT_DO_GRADIENT(CountMinSketchMerge);
+SHOULD_NOT_DO_GRADIENT(CreateHyperLogLog);
+SHOULD_NOT_DO_GRADIENT(HyperLogLogUpdate);
+SHOULD_NOT_DO_GRADIENT(HyperLogLogEstimate);
+SHOULD_NOT_DO_GRADIENT(HyperLogLogMerge);
+
+} // namespace
+} // namespace caffe2
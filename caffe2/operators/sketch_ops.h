@@ -0,0 +1,505 @@
+#ifndef CAFFE2_OPERATORS_SKETCH_OPS_H_
+#define CAFFE2_OPERATORS_SKETCH_OPS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "caffe2/core/blob_serialization.h"
+#include "caffe2/core/context.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+namespace sketch {
+
+// Number of keys hashed ahead of the updates of the counters
+constexpr TIndex kBatchSize = 256;
+
+// 64 bit finalizer of MurmurHash3, so that every bit of the key affects
+// every bit of the hash
+inline uint64_t Hash(int64_t key, int64_t seed) {
+  uint64_t h = static_cast<uint64_t>(key) ^
+      (static_cast<uint64_t>(seed) * 0x9e3779b97f4a7c15ULL);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+inline int LeadingZeros(uint64_t x) {
+#ifdef __GNUC__
+  return x == 0 ? 64 : __builtin_clzll(x);
+#else
+  int n = 0;
+  for (uint64_t bit = 1ULL << 63; bit && !(x & bit); bit >>= 1) {
+    n++;
+  }
+  return n;
+#endif
+}
+
+} // namespace sketch
+
+// Count-min sketch of the frequencies of integer keys: each of the `depth`
+// rows of `width` counters gets the count of a key added to the counter
+// picked by its own hash of the key, and the frequency of a key is
+// estimated as the smallest of its counters. Estimates are never below the
+// true frequencies, and exceed them by at most e / width of the total count
+// with probability 1 - exp(-depth).
+class CountMinSketch {
+ public:
+  void Init(int64_t width, int depth, int64_t seed) {
+    CAFFE_ENFORCE_GT(width, 0, "width should be > 0");
+    CAFFE_ENFORCE_LE(
+        width,
+        std::numeric_limits<uint32_t>::max(),
+        "width should fit in 32 bits");
+    CAFFE_ENFORCE_GT(depth, 0, "depth should be > 0");
+    width_ = width;
+    depth_ = depth;
+    seed_ = seed;
+    counts_.assign(width * depth, 0);
+  }
+
+  // Adds counts[i], or 1 if counts is null, to the frequency of keys[i].
+  template <typename T>
+  void Add(TIndex n, const T* keys, const int64_t* counts) {
+    CAFFE_ENFORCE(!counts_.empty(), "Count-min sketch is not initialized");
+    uint64_t hashes[sketch::kBatchSize];
+    for (TIndex begin = 0; begin < n; begin += sketch::kBatchSize) {
+      const TIndex size = std::min(n - begin, sketch::kBatchSize);
+      for (TIndex i = 0; i < size; i++) {
+        hashes[i] = sketch::Hash(keys[begin + i], seed_);
+      }
+      // One row at a time, so that only its counters are touched
+      for (int d = 0; d < depth_; d++) {
+        int64_t* row = counts_.data() + d * width_;
+        for (TIndex i = 0; i < size; i++) {
+          row[Bucket(hashes[i], d)] += counts ? counts[begin + i] : 1;
+        }
+      }
+    }
+  }
+
+  // Estimates the frequencies of the keys into out.
+  template <typename T>
+  void Query(TIndex n, const T* keys, int64_t* out) const {
+    CAFFE_ENFORCE(!counts_.empty(), "Count-min sketch is not initialized");
+    uint64_t hashes[sketch::kBatchSize];
+    for (TIndex begin = 0; begin < n; begin += sketch::kBatchSize) {
+      const TIndex size = std::min(n - begin, sketch::kBatchSize);
+      for (TIndex i = 0; i < size; i++) {
+        hashes[i] = sketch::Hash(keys[begin + i], seed_);
+        out[begin + i] = std::numeric_limits<int64_t>::max();
+      }
+      for (int d = 0; d < depth_; d++) {
+        const int64_t* row = counts_.data() + d * width_;
+        for (TIndex i = 0; i < size; i++) {
+          out[begin + i] =
+              std::min(out[begin + i], row[Bucket(hashes[i], d)]);
+        }
+      }
+    }
+  }
+
+  // Adds the counts of another sketch with the same dimensions and seed,
+  // e.g. one built from another shard of the data.
+  void Merge(const CountMinSketch& other) {
+    CAFFE_ENFORCE(
+        width_ == other.width_ && depth_ == other.depth_ &&
+            seed_ == other.seed_,
+        "Only count-min sketches with the same width, depth and seed can be "
+        "merged");
+    for (size_t i = 0; i < counts_.size(); i++) {
+      counts_[i] += other.counts_[i];
+    }
+  }
+
+  int64_t width() const {
+    return width_;
+  }
+  int depth() const {
+    return depth_;
+  }
+  int64_t seed() const {
+    return seed_;
+  }
+  const std::vector<int64_t>& counts() const {
+    return counts_;
+  }
+  std::vector<int64_t>* mutable_counts() {
+    return &counts_;
+  }
+
+ private:
+  // Counter of row d for a hash: the rows hash with h1 + d * h2 for the two
+  // halves of the hash, which are mapped to [0, width) with a multiplication
+  // rather than a division.
+  inline TIndex Bucket(uint64_t hash, int d) const {
+    const uint32_t h = static_cast<uint32_t>(hash) +
+        static_cast<uint32_t>(d) * (static_cast<uint32_t>(hash >> 32) | 1);
+    return static_cast<TIndex>(
+        (static_cast<uint64_t>(h) * static_cast<uint64_t>(width_)) >> 32);
+  }
+
+  int64_t width_ = 0;
+  int depth_ = 0;
+  int64_t seed_ = 0;
+  std::vector<int64_t> counts_;
+};
+
+// HyperLogLog estimate of the number of distinct integer keys, with
+// 2^precision registers of one byte. The relative standard error of the
+// estimate is about 1.04 / sqrt(2^precision).
+class HyperLogLog {
+ public:
+  void Init(int precision, int64_t seed) {
+    CAFFE_ENFORCE(
+        precision >= 4 && precision <= 18,
+        "precision should be in [4, 18], got ",
+        precision);
+    precision_ = precision;
+    seed_ = seed;
+    registers_.assign(1 << precision, 0);
+  }
+
+  template <typename T>
+  void Add(TIndex n, const T* keys) {
+    CAFFE_ENFORCE(!registers_.empty(), "HyperLogLog is not initialized");
+    uint64_t hashes[sketch::kBatchSize];
+    for (TIndex begin = 0; begin < n; begin += sketch::kBatchSize) {
+      const TIndex size = std::min(n - begin, sketch::kBatchSize);
+      for (TIndex i = 0; i < size; i++) {
+        hashes[i] = sketch::Hash(keys[begin + i], seed_);
+      }
+      for (TIndex i = 0; i < size; i++) {
+        // The first bits pick the register, which keeps the largest
+        // position of the first set bit among the rest
+        const uint64_t hash = hashes[i];
+        const uint8_t rank = sketch::LeadingZeros(
+                                 (hash << precision_) |
+                                 (1ULL << (precision_ - 1))) +
+            1;
+        uint8_t& reg = registers_[hash >> (64 - precision_)];
+        reg = std::max(reg, rank);
+      }
+    }
+  }
+
+  double Estimate() const {
+    CAFFE_ENFORCE(!registers_.empty(), "HyperLogLog is not initialized");
+    const double m = registers_.size();
+    double sum = 0;
+    int zeros = 0;
+    for (const auto reg : registers_) {
+      sum += std::ldexp(1.0, -reg);
+      zeros += reg == 0;
+    }
+    double alpha;
+    switch (registers_.size()) {
+      case 16:
+        alpha = 0.673;
+        break;
+      case 32:
+        alpha = 0.697;
+        break;
+      case 64:
+        alpha = 0.709;
+        break;
+      default:
+        alpha = 0.7213 / (1 + 1.079 / m);
+    }
+    const double estimate = alpha * m * m / sum;
+    // Linear counting is more accurate for small cardinalities. The hash has
+    // 64 bits, so large cardinalities need no correction.
+    if (estimate <= 2.5 * m && zeros > 0) {
+      return m * std::log(m / zeros);
+    }
+    return estimate;
+  }
+
+  // Takes the union with another HyperLogLog with the same precision and
+  // seed.
+  void Merge(const HyperLogLog& other) {
+    CAFFE_ENFORCE(
+        precision_ == other.precision_ && seed_ == other.seed_,
+        "Only HyperLogLogs with the same precision and seed can be merged");
+    for (size_t i = 0; i < registers_.size(); i++) {
+      registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+  }
+
+  int precision() const {
+    return precision_;
+  }
+  int64_t seed() const {
+    return seed_;
+  }
+  const std::vector<uint8_t>& registers() const {
+    return registers_;
+  }
+  std::vector<uint8_t>* mutable_registers() {
+    return &registers_;
+  }
+
+ private:
+  int precision_ = 0;
+  int64_t seed_ = 0;
+  std::vector<uint8_t> registers_;
+};
+
+template <class Context>
+class CreateCountMinSketchOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  CreateCountMinSketchOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        width_(OperatorBase::GetSingleArgument<int64_t>("width", 1 << 16)),
+        depth_(OperatorBase::GetSingleArgument<int>("depth", 4)),
+        seed_(OperatorBase::GetSingleArgument<int64_t>("seed", 0)) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Output<CountMinSketch>(SKETCH)->Init(width_, depth_, seed_);
+    return true;
+  }
+
+ private:
+  int64_t width_;
+  int depth_;
+  int64_t seed_;
+
+  OUTPUT_TAGS(SKETCH);
+};
+
+template <class Context>
+class CountMinSketchUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(CountMinSketchUpdateOp);
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(KEYS));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    const auto& keys = Input(KEYS);
+    const int64_t* counts = nullptr;
+    if (InputSize() > COUNTS) {
+      const auto& counts_input = Input(COUNTS);
+      CAFFE_ENFORCE_EQ(
+          keys.size(),
+          counts_input.size(),
+          "There should be one count per key");
+      counts = counts_input.template data<int64_t>();
+    }
+    OperatorBase::Output<CountMinSketch>(SKETCH_OUT)
+        ->Add(keys.size(), keys.template data<T>(), counts);
+    return true;
+  }
+
+  INPUT_TAGS(SKETCH, KEYS, COUNTS);
+  OUTPUT_TAGS(SKETCH_OUT);
+};
+
+template <class Context>
+class CountMinSketchQueryOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(CountMinSketchQueryOp);
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(KEYS));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    const auto& keys = Input(KEYS);
+    auto* counts = Output(COUNTS);
+    counts->ResizeLike(keys);
+    OperatorBase::Input<CountMinSketch>(SKETCH).Query(
+        keys.size(),
+        keys.template data<T>(),
+        counts->template mutable_data<int64_t>());
+    return true;
+  }
+
+  INPUT_TAGS(SKETCH, KEYS);
+  OUTPUT_TAGS(COUNTS);
+};
+
+template <class Context>
+class CreateHyperLogLogOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  CreateHyperLogLogOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        precision_(OperatorBase::GetSingleArgument<int>("precision", 14)),
+        seed_(OperatorBase::GetSingleArgument<int64_t>("seed", 0)) {}
+
+  bool RunOnDevice() override {
+    OperatorBase::Output<HyperLogLog>(HLL)->Init(precision_, seed_);
+    return true;
+  }
+
+ private:
+  int precision_;
+  int64_t seed_;
+
+  OUTPUT_TAGS(HLL);
+};
+
+template <class Context>
+class HyperLogLogUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(HyperLogLogUpdateOp);
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(KEYS));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    const auto& keys = Input(KEYS);
+    OperatorBase::Output<HyperLogLog>(HLL_OUT)->Add(
+        keys.size(), keys.template data<T>());
+    return true;
+  }
+
+  INPUT_TAGS(HLL, KEYS);
+  OUTPUT_TAGS(HLL_OUT);
+};
+
+template <class Context>
+class HyperLogLogEstimateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(HyperLogLogEstimateOp);
+
+  bool RunOnDevice() override {
+    auto* estimate = Output(ESTIMATE);
+    estimate->Resize(vector<TIndex>());
+    *estimate->template mutable_data<int64_t>() = static_cast<int64_t>(
+        std::llround(OperatorBase::Input<HyperLogLog>(HLL).Estimate()));
+    return true;
+  }
+
+  INPUT_TAGS(HLL);
+  OUTPUT_TAGS(ESTIMATE);
+};
+
+// Merges the sketches of inputs 1.. into input 0, which is also the output.
+template <typename Sketch, class Context>
+class MergeSketchesOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  USE_SIMPLE_CTOR_DTOR(MergeSketchesOp);
+
+  bool RunOnDevice() override {
+    auto* sketch = OperatorBase::Output<Sketch>(0);
+    for (int i = 1; i < InputSize(); i++) {
+      sketch->Merge(OperatorBase::Input<Sketch>(i));
+    }
+    return true;
+  }
+};
+
+class CountMinSketchSerializer : public BlobSerializerBase {
+ public:
+  void Serialize(
+      const Blob& blob,
+      const string& name,
+      SerializationAcceptor acceptor) override {
+    const auto& sketch = blob.template Get<CountMinSketch>();
+    Tensor<CPUContext> counts(
+        vector<TIndex>{sketch.depth(), sketch.width()});
+    std::copy(
+        sketch.counts().begin(),
+        sketch.counts().end(),
+        counts.mutable_data<int64_t>());
+
+    BlobProto blob_proto;
+    TensorSerializer<CPUContext> ser;
+    ser.Serialize(counts, name, blob_proto.mutable_tensor(), 0, counts.size());
+    blob_proto.set_name(name);
+    blob_proto.set_type("caffe2::CountMinSketch");
+    blob_proto.set_content(caffe2::to_string(sketch.seed()));
+    acceptor(name, blob_proto.SerializeAsString());
+  }
+};
+
+class CountMinSketchDeserializer : public BlobDeserializerBase {
+ public:
+  void Deserialize(const BlobProto& proto, Blob* blob) override {
+    Tensor<CPUContext> counts;
+    TensorDeserializer<CPUContext> deser;
+    deser.Deserialize(proto.tensor(), &counts);
+    CAFFE_ENFORCE_EQ(counts.ndim(), 2);
+
+    auto* sketch = blob->template GetMutable<CountMinSketch>();
+    sketch->Init(counts.dim(1), counts.dim(0), std::stoll(proto.content()));
+    std::copy(
+        counts.data<int64_t>(),
+        counts.data<int64_t>() + counts.size(),
+        sketch->mutable_counts()->begin());
+  }
+};
+
+class HyperLogLogSerializer : public BlobSerializerBase {
+ public:
+  void Serialize(
+      const Blob& blob,
+      const string& name,
+      SerializationAcceptor acceptor) override {
+    const auto& hll = blob.template Get<HyperLogLog>();
+    Tensor<CPUContext> registers(
+        vector<TIndex>{static_cast<TIndex>(hll.registers().size())});
+    std::copy(
+        hll.registers().begin(),
+        hll.registers().end(),
+        registers.mutable_data<uint8_t>());
+
+    BlobProto blob_proto;
+    TensorSerializer<CPUContext> ser;
+    ser.Serialize(
+        registers, name, blob_proto.mutable_tensor(), 0, registers.size());
+    blob_proto.set_name(name);
+    blob_proto.set_type("caffe2::HyperLogLog");
+    blob_proto.set_content(caffe2::to_string(hll.seed()));
+    acceptor(name, blob_proto.SerializeAsString());
+  }
+};
+
+class HyperLogLogDeserializer : public BlobDeserializerBase {
+ public:
+  void Deserialize(const BlobProto& proto, Blob* blob) override {
+    Tensor<CPUContext> registers;
+    TensorDeserializer<CPUContext> deser;
+    deser.Deserialize(proto.tensor(), &registers);
+
+    int precision = 0;
+    while ((TIndex{1} << precision) < registers.size()) {
+      precision++;
+    }
+    auto* hll = blob->template GetMutable<HyperLogLog>();
+    hll->Init(precision, std::stoll(proto.content()));
+    CAFFE_ENFORCE_EQ(registers.size(), hll->registers().size());
+    std::copy(
+        registers.data<uint8_t>(),
+        registers.data<uint8_t>() + registers.size(),
+        hll->mutable_registers()->begin());
+  }
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_OPERATORS_SKETCH_OPS_H_
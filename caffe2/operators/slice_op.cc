@@ -38,6 +38,11 @@ Example:
     .Input(2, "ends", "1D tensor: end-indices for each dimension of data.")
     .Arg("starts", "List of starting indices")
     .Arg("ends", "List of ending indices")
+    .Arg(
+        "output_views",
+        "If set, and the slice is contiguous in data, the output shares the "
+        "storage of data instead of copying it. Set by EnableTensorViews "
+        "where all the readers of the output accept views")
     .TensorInferenceFunction([](const OperatorDef& def,
                                 const vector<TensorShape>& in) {
       if (in.size() > 1) {
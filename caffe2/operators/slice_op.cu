@@ -55,7 +55,8 @@ bool SliceImplGpu(
     const TensorCPU& ends,
     Context* context,
     Tensor<Context>* gdata = nullptr,
-    const Tensor<Context>* go = nullptr) {
+    const Tensor<Context>* go = nullptr,
+    bool output_view = false) {
   bool backward = output == nullptr;
 
   auto* starts_data = starts.template data<SIndex>();
@@ -122,7 +123,10 @@ bool SliceImplGpu(
     }
   }
   if (dim == -1) {
-    if (!backward) {
+    if (!backward && output_view) {
+      output->ResizeLike(data);
+      output->ShareData(data);
+    } else if (!backward) {
       output->CopyFrom(data, context);
     } else {
       gdata->CopyFrom(*go, context);
@@ -141,6 +145,11 @@ bool SliceImplGpu(
       std::multiplies<int>());
   if (!backward) {
     output->Resize(dst_sizes);
+    if (output_view && num_blocks == 1) {
+      // Nothing before the sliced dimension, the slice is contiguous
+      output->ShareDataWithOffset(data, unit * starts_idx[dim]);
+      return true;
+    }
   } else {
     gdata->ResizeLike(data);
   }
@@ -261,7 +270,14 @@ bool SliceOp<int, CUDAContext>::RunOnDevice() {
   }
 
   return SliceImplGpu<int, CUDAContext>(
-      output, data, starts_host_, ends_host_, &context_);
+      output,
+      data,
+      starts_host_,
+      ends_host_,
+      &context_,
+      nullptr,
+      nullptr,
+      output_view_);
 }
 
 REGISTER_CUDA_OPERATOR(Slice, SliceOp<int, CUDAContext>);
@@ -17,7 +17,8 @@ bool SliceImpl(
     const Tensor<Context>& ends,
     Context* context,
     Tensor<Context>* gdata = nullptr,
-    const Tensor<Context>* go = nullptr) {
+    const Tensor<Context>* go = nullptr,
+    bool output_view = false) {
   bool backward = output == nullptr;
 
   auto* starts_data = starts.template data<SIndex>();
@@ -84,7 +85,10 @@ bool SliceImpl(
     }
   }
   if (dim == -1) {
-    if (!backward) {
+    if (!backward && output_view) {
+      output->ResizeLike(data);
+      output->ShareData(data);
+    } else if (!backward) {
       output->CopyFrom(data, context);
     } else {
       gdata->CopyFrom(*go, context);
@@ -103,6 +107,11 @@ bool SliceImpl(
       std::multiplies<SIndex>());
   if (!backward) {
     output->Resize(dst_sizes);
+    if (output_view && num_blocks == 1) {
+      // Nothing before the sliced dimension, the slice is contiguous
+      output->ShareDataWithOffset(data, unit * starts_idx[dim]);
+      return true;
+    }
   } else {
     gdata->ResizeLike(data);
   }
@@ -206,7 +215,9 @@ class SliceOp : public Operator<Context> {
       : Operator<Context>(operator_def, ws),
         starts_(OperatorBase::GetRepeatedArgument<SIndex>("starts")),
         ends_(OperatorBase::GetRepeatedArgument<SIndex>("ends")),
-        statically_inited_(false) {}
+        statically_inited_(false),
+        output_view_(
+            OperatorBase::GetSingleArgument<bool>("output_views", false)) {}
 
   bool RunOnDevice() override {
     auto* output = Output(0);
@@ -237,7 +248,14 @@ class SliceOp : public Operator<Context> {
     }
 
     return SliceImpl<SIndex, Context>(
-        output, data, starts_host_, ends_host_, &context_);
+        output,
+        data,
+        starts_host_,
+        ends_host_,
+        &context_,
+        nullptr,
+        nullptr,
+        output_view_);
   }
 
   DISABLE_COPY_AND_ASSIGN(SliceOp);
@@ -246,6 +264,7 @@ class SliceOp : public Operator<Context> {
   std::vector<SIndex> starts_;
   std::vector<SIndex> ends_;
   bool statically_inited_;
+  bool output_view_;
   TensorCPU starts_host_;
   TensorCPU ends_host_;
 };
@@ -20,22 +20,17 @@ bool SoftmaxOp<float, CPUContext>::RunOnDevice() {
   if (rowmax_.size() != N) {
     rowmax_.Resize(N);
   }
-  if (sum_multiplier_.size() != D) {
-    sum_multiplier_.Resize(D);
-    math::Set<float, CPUContext>(D, 1.f, sum_multiplier_.mutable_data<float>(),
-                                 &context_);
-  }
 
   SoftmaxCPU(
-      context_,
       N,
       D,
       X.data<float>(),
       Ydata,
       scale_.mutable_data<float>(),
-      sum_multiplier_.data<float>(),
       false,
-      rowmax_.mutable_data<float>());
+      rowmax_.mutable_data<float>(),
+      ws_->GetThreadPool(),
+      num_threads_);
   return true;
 }
 
@@ -48,30 +43,15 @@ bool SoftmaxGradientOp<float, CPUContext>::RunOnDevice() {
   const auto canonical_axis = Y.canonical_axis_index(axis_);
   const int N = Y.size_to_dim(canonical_axis);
   const int D = Y.size_from_dim(canonical_axis);
-  // First, get scales
-  if (scale_.size() != N) {
-    scale_.Resize(N);
-  }
-  if (sum_multiplier_.size() != D) {
-    sum_multiplier_.Resize(D);
-    math::Set<float, CPUContext>(D, 1.f, sum_multiplier_.mutable_data<float>(),
-                                 &context_);
-  }
   dX->ResizeLike(Y);
-  const float* Ydata = Y.data<float>();
-  const float* dYdata = dY.data<float>();
-  float* dXdata = dX->mutable_data<float>();
-  context_.Copy<float, CPUContext, CPUContext>(Y.size(), dYdata, dXdata);
-  float* scaledata = scale_.mutable_data<float>();
-  for (int i = 0; i < N; ++i) {
-    math::Dot<float, CPUContext>(D, Ydata + i * D, dYdata + i * D,
-                                 scaledata + i, &context_);
-  }
-  math::Gemm<float, CPUContext>(CblasNoTrans, CblasNoTrans, N, D, 1, -1,
-                                scaledata, sum_multiplier_.data<float>(), 1,
-                                dXdata, &context_);
-  math::Mul<float, CPUContext>(Y.size(), dXdata, Ydata, dXdata,
-                               &context_);
+  SoftmaxGradientCPU(
+      N,
+      D,
+      Y.data<float>(),
+      dY.data<float>(),
+      dX->mutable_data<float>(),
+      ws_->GetThreadPool(),
+      num_threads_);
   return true;
 }
 
@@ -81,6 +61,7 @@ REGISTER_CPU_OPERATOR(SoftmaxGradient, SoftmaxGradientOp<float, CPUContext>);
 OPERATOR_SCHEMA(Softmax)
   .NumInputs(1)
   .NumOutputs(1)
+  .AcceptsTensorViews()
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
 The operator computes the softmax normalized values for each layer in the batch
@@ -103,6 +84,10 @@ will throw errors.
        "(int) default to 1; describes the axis of the inputs when coerced "
        "to 2D; defaults to one because the 0th axis most likely describes "
        "the batch_size")
+  .Arg("num_threads",
+       "(int) default to 0; number of threads of the workspace pool to split "
+       "the rows of large inputs between on CPU, 0 for all of them and 1 to "
+       "run on the calling thread")
   .Input(0, "input",
          "The input tensor that's coerced into a 2D matrix of size (NxD) "
          "as described above.")
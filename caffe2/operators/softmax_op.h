@@ -13,12 +13,18 @@ class SoftmaxOp final : public Operator<Context> {
  public:
   SoftmaxOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-      axis_(OperatorBase::GetSingleArgument<int>("axis", 1)) {}
+        ws_(ws),
+        axis_(OperatorBase::GetSingleArgument<int>("axis", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   bool RunOnDevice() override;
 
  protected:
+  Workspace* ws_;
   int axis_;
+  // 0 splits the rows of large inputs between all threads of the workspace
+  // thread pool on CPU, 1 runs on the calling thread
+  int num_threads_;
   Tensor<Context> scale_;
   Tensor<Context> rowmax_;
   Tensor<Context> sum_multiplier_;
@@ -29,12 +35,16 @@ class SoftmaxGradientOp final : public Operator<Context> {
  public:
   SoftmaxGradientOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
-        axis_(OperatorBase::GetSingleArgument<int>("axis", 1)) {}
+        ws_(ws),
+        axis_(OperatorBase::GetSingleArgument<int>("axis", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {}
   USE_OPERATOR_CONTEXT_FUNCTIONS;
   bool RunOnDevice() override;
 
  protected:
+  Workspace* ws_;
   int axis_;
+  int num_threads_;
   Tensor<Context> scale_;
   Tensor<Context> sum_multiplier_;
 };
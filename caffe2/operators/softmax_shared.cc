@@ -1,55 +1,96 @@
-#include "caffe2/core/context.h"
-#include "caffe2/core/operator.h"
-#include "caffe2/utils/math.h"
+#include "caffe2/operators/softmax_shared.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "caffe2/perfkernels/math.h"
 
 namespace caffe2 {
 
+namespace {
+
+// Runs fn(begin, end) on ranges of the N rows of D columns, split between
+// the threads of pool when there are enough of them
+void ForEachRows(
+    const int N,
+    const int D,
+    ThreadPool* pool,
+    const int num_threads,
+    const std::function<void(int, int)>& fn) {
+  // Below this many elements per range, waking up the threads costs more than
+  // it saves
+  constexpr int64_t kMinElementsPerRange = 1 << 15;
+  const int64_t size = static_cast<int64_t>(N) * D;
+  int num_ranges = 1;
+  if (pool && num_threads != 1 && N > 1 && size >= 2 * kMinElementsPerRange) {
+    const int pool_threads = pool->getNumThreads();
+    const int threads = num_threads == 0
+        ? pool_threads
+        : std::min(num_threads, pool_threads);
+    num_ranges = static_cast<int>(std::min<int64_t>(
+        std::min(threads, N), size / kMinElementsPerRange));
+  }
+  if (num_ranges <= 1) {
+    fn(0, N);
+    return;
+  }
+  pool->runRanges(num_ranges, [&](size_t range) {
+    fn(static_cast<int64_t>(range) * N / num_ranges,
+       static_cast<int64_t>(range + 1) * N / num_ranges);
+  });
+}
+
+} // namespace
+
+void SoftmaxCPU(
+    const int N,
+    const int D,
+    const float* Xdata,
+    float* Ydata,
+    float* scale,
+    bool logarithmic,
+    float* rowmax,
+    ThreadPool* pool,
+    int num_threads) {
+  ForEachRows(N, D, pool, num_threads, [&](int begin, int end) {
+    const size_t offset = static_cast<size_t>(begin) * D;
+    VectorizedSoftmax(
+        end - begin,
+        D,
+        Xdata + offset,
+        Ydata + offset,
+        logarithmic,
+        rowmax + begin,
+        scale + begin);
+  });
+}
+
 void SoftmaxCPU(
-    CPUContext& context,
+    CPUContext& /* unused */,
     const int N,
     const int D,
     const float* Xdata,
     float* Ydata,
     float* scale,
-    const float* sum_multiplier,
+    const float* /* unused */,
     bool logarithmic,
     float* rowmax) {
-  math::RowwiseMax<float, CPUContext>(N, D, Xdata, rowmax, &context);
-  // Put the intermediate result X - max(X) into Y
-  context.template Copy<float, CPUContext, CPUContext>(N * D, Xdata, Ydata);
-  // Subtract the max (for numerical reasons)
-  math::Gemm<float, CPUContext>(
-      CblasNoTrans,
-      CblasNoTrans,
-      N,
-      D,
-      1,
-      -1,
-      rowmax,
-      sum_multiplier,
-      1,
-      Ydata,
-      &context);
-  // Exponentiation
-  math::Exp<float, CPUContext>(N * D, Ydata, Ydata, &context);
-  math::Gemv<float, CPUContext>(
-      CblasNoTrans, N, D, 1, Ydata, sum_multiplier, 0, scale, &context);
-  // Do division
-  // TODO(Yangqing): maybe implement it more beautifully?
-  if (!logarithmic) {
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < D; ++j) {
-        Ydata[i * D + j] /= scale[i];
-      }
-    }
-  } else {
-    for (int i = 0; i < N; ++i) {
-      for (int j = 0; j < D; ++j) {
-        Ydata[i * D + j] =
-            Xdata[i * D + j] - rowmax[i] - log(fmaxf(scale[i], 1e-20f));
-      }
-    }
-  }
+  SoftmaxCPU(N, D, Xdata, Ydata, scale, logarithmic, rowmax, nullptr, 1);
+}
+
+void SoftmaxGradientCPU(
+    const int N,
+    const int D,
+    const float* Ydata,
+    const float* dYdata,
+    float* dXdata,
+    ThreadPool* pool,
+    int num_threads) {
+  ForEachRows(N, D, pool, num_threads, [&](int begin, int end) {
+    const size_t offset = static_cast<size_t>(begin) * D;
+    VectorizedSoftmaxGradient(
+        end - begin, D, Ydata + offset, dYdata + offset, dXdata + offset);
+  });
 }
 
 } // namespace caffe2
@@ -3,9 +3,26 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
+// Softmax of the N x D matrix Xdata into Ydata, or log softmax with
+// logarithmic. scale and rowmax receive the sum of exp(x - max) and the max of
+// every row. Large inputs have their rows split between num_threads threads of
+// pool, all of them for 0, if pool is not null. Ydata can be Xdata.
+void SoftmaxCPU(
+    const int N,
+    const int D,
+    const float* Xdata,
+    float* Ydata,
+    float* scale,
+    bool logarithmic,
+    float* rowmax,
+    ThreadPool* pool,
+    int num_threads);
+
+// Same, on the calling thread. sum_multiplier is not used anymore.
 void SoftmaxCPU(
     CPUContext& context,
     const int N,
@@ -16,6 +33,18 @@ void SoftmaxCPU(
     const float* sum_multiplier,
     bool logarithmic,
     float* rowmax);
+
+// Softmax gradient dX = Y * (dY - dot(Y, dY)) of every row, split between
+// threads like SoftmaxCPU. dXdata can be dYdata.
+void SoftmaxGradientCPU(
+    const int N,
+    const int D,
+    const float* Ydata,
+    const float* dYdata,
+    float* dXdata,
+    ThreadPool* pool,
+    int num_threads);
+
 } // namespace caffe2
 
 #endif // #define CAFFE2_OPERATORS_SOFTMAX_SHARED_H_
@@ -47,6 +47,11 @@ Use parameter label_prob=1 to enable inputting labels as a probability
 distribution.
 Optional third input blob can be used to weight the samples for the loss.
 )DOC")
+    .Arg(
+        "num_threads",
+        "(int, default 0) Number of threads of the workspace pool to split "
+        "the softmax of large inputs between, 0 for all of them and 1 to run "
+        "on the calling thread")
     .Input(0, "logits", "Unscaled log probabilities")
     .Input(1, "labels", "Ground truth")
     .Input(
@@ -74,12 +79,6 @@ bool SoftmaxWithLossOp<float, CPUContext>::RunOnDevice() {
   D = X.size_from_dim(canonical_axis);
   P->ResizeLike(X);
 
-  if (sum_multiplier_.size() != D) {
-    sum_multiplier_.Resize(D);
-    math::Set<float, CPUContext>(
-        D, 1.f, sum_multiplier_.mutable_data<float>(), &context_);
-  }
-
   float* Pdata = P->mutable_data<float>();
   const float* weights = (InputSize() > 2 ? Input(2).data<float>() : nullptr);
 
@@ -96,32 +95,29 @@ bool SoftmaxWithLossOp<float, CPUContext>::RunOnDevice() {
     }
   }
 
-  if (sum_multiplier_.size() != D) {
-    sum_multiplier_.Resize(D);
-    math::Set<float, CPUContext>(
-        D, 1.f, sum_multiplier_.mutable_data<float>(), &context_);
-  }
-
   rowmax_.Resize(N);
   losses_.Resize(N);
 
+  // losses_ receives the sums of exp(x - max) of every row
+  const float* Xdata = X.data<float>();
+  float* rowsum = losses_.mutable_data<float>();
+  float* rowmax = rowmax_.mutable_data<float>();
   SoftmaxCPU(
-      context_,
       N,
       D,
-      X.data<float>(),
+      Xdata,
       Pdata,
-      losses_.mutable_data<float>(),
-      sum_multiplier_.data<float>(),
-      !label_prob_mode_,
-      rowmax_.mutable_data<float>());
+      rowsum,
+      false,
+      rowmax,
+      ws_->GetThreadPool(),
+      num_threads_);
 
   // Then compute cross entropy
   float loss_sum = 0.0;
   float weight_sum = 0.0;
   if (!label_prob_mode_) {
     const int* label_data = T.data<int>();
-    const float* Xdata = X.data<float>();
 
     for (int i = 0; i < N; ++i) {
       CAFFE_ENFORCE(
@@ -131,11 +127,14 @@ bool SoftmaxWithLossOp<float, CPUContext>::RunOnDevice() {
           " vs ",
           D);
       float weight = weights ? weights[i] : 1.0;
-      float l = -Pdata[i * D + label_data[i]] * weight;
+      // Log probability of the label, from the logits rather than its
+      // probability for small probabilities not to underflow
+      const float log_prob = Xdata[i * D + label_data[i]] - rowmax[i] -
+          log(std::max(rowsum[i], 1e-20f));
+      float l = -log_prob * weight;
       loss_sum += l;
       weight_sum += weight;
     }
-    math::Exp(N * D, Pdata, Pdata, &context_);
   } else {
     const float* label_data = T.data<float>();
 
@@ -205,67 +204,38 @@ bool SoftmaxWithLossGradientOp<float, CPUContext>::RunOnDevice() {
   const float* Pdata = P.data<float>();
   float* dX_data = dX->mutable_data<float>();
 
-  // Copy softmax probabilities into dX. All but the neuron
-  // corresponding to the correct label has gradient equaling e(x_j)
-  // which is the probability under softmax.
-  context_.Copy<float, CPUContext, CPUContext>(P.size(), Pdata, dX_data);
+  float total_weight = N;
+  if (weights) {
+    total_weight = 0.0f;
+    for (int i = 0; i < N; ++i) {
+      total_weight += weights[i];
+    }
+  }
+  // Scale by d_avg_loss / total_weight, in the same pass as the gradient
+  const float scale = total_weight > 0
+      ? scale_ / total_weight * d_avg_loss.data<float>()[0]
+      : 1.0f;
 
-  // Compute gradient for the matching labels.
-  float total_weight = 0.0f;
+  // The gradient is the softmax probabilities minus the labels, one-hot for
+  // integer labels, times the weight of every example.
   if (!label_prob_mode_) {
     const int* label_data = T.data<int>();
-
-    if (weights) {
-      for (int i = 0; i < N; ++i) {
-        int idx = i * D + label_data[i];
-        float weight = weights[i];
-        dX_data[idx] = Pdata[idx] - 1.0;
-        for (int d = 0; d < D; d++) {
-          int k = i * D + d;
-          dX_data[k] *= weight;
-        }
-
-        total_weight += weight;
-      }
-    } else {
-      for (int i = 0; i < N; ++i) {
-        int idx = i * D + label_data[i];
-        dX_data[idx] = Pdata[idx] - 1.0f;
-      }
-      total_weight = N;
+    for (int i = 0; i < N; ++i) {
+      const float weight = (weights ? weights[i] : 1.0f) * scale;
+      math::Scale<float, CPUContext>(
+          D, weight, Pdata + i * D, dX_data + i * D, &context_);
+      dX_data[i * D + label_data[i]] -= weight;
     }
   } else {
     const float* label_data = T.data<float>();
-
-    if (weights) {
-      for (int i = 0; i < N; ++i) {
-        float weight = weights[i];
-        for (int j = 0; j < D; ++j) {
-          int idx = i * D + j;
-          dX_data[idx] = (Pdata[idx] - label_data[idx]) * weight;
-        }
-        total_weight += weight;
-      }
-    } else {
-      for (int i = 0; i < N; ++i) {
-        for (int j = 0; j < D; ++j) {
-          int idx = i * D + j;
-          dX_data[idx] = Pdata[idx] - label_data[idx];
-        }
+    for (int i = 0; i < N; ++i) {
+      const float weight = (weights ? weights[i] : 1.0f) * scale;
+      for (int j = 0; j < D; ++j) {
+        const int idx = i * D + j;
+        dX_data[idx] = (Pdata[idx] - label_data[idx]) * weight;
       }
-      total_weight = N;
     }
   }
-
-  // Scale by d_avg_loss / N
-  if (total_weight > 0) {
-    math::Scale<float, CPUContext>(
-        dX->size(),
-        scale_ / total_weight * d_avg_loss.data<float>()[0],
-        dX->data<float>(),
-        dX_data,
-        &context_);
-  }
   return true;
 }
 
@@ -13,11 +13,13 @@ class SoftmaxWithLossOp final : public Operator<Context> {
  public:
   SoftmaxWithLossOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
         scale_(OperatorBase::GetSingleArgument<float>("scale", 1.)),
         label_prob_mode_(OperatorBase::GetSingleArgument<int>("label_prob", 0)),
         order_(StringToStorageOrder(
             OperatorBase::GetSingleArgument<string>("order", "NCHW"))),
-        axis_(OperatorBase::GetSingleArgument<int>("axis", 1)) {
+        axis_(OperatorBase::GetSingleArgument<int>("axis", 1)),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
     CAFFE_ENFORCE(scale_ >= 0);
     CAFFE_ENFORCE_EQ(
         order_, StorageOrder::NCHW, "Only NCHW order is supported right now.");
@@ -27,10 +29,14 @@ class SoftmaxWithLossOp final : public Operator<Context> {
   bool RunOnDevice() override;
 
  protected:
+  Workspace* ws_;
   float scale_;
   int label_prob_mode_;
   StorageOrder order_;
   int axis_;
+  // 0 splits the softmax of large inputs between all threads of the
+  // workspace thread pool on CPU, 1 runs on the calling thread
+  int num_threads_;
 
   Tensor<Context> losses_; // Per example loss
   Tensor<Context> rowmax_; // per example row max
@@ -171,6 +171,9 @@ OpSchema::Cost CostInferenceForSpatialBN(
   const int C =
       (order == StorageOrder::NCHW ? X.dims(1) : X.dims(X.dims_size() - 1));
   cost.params_bytes = 2 * C * sizeof(float);
+  // Only Y has the shape of X, the other outputs are per channel
+  cost.bytes_written = nBytesOfShape(X) +
+      (def.output_size() - 1) * C * sizeof(float);
   return cost;
 }
 } // namespace
@@ -180,6 +183,7 @@ REGISTER_CPU_OPERATOR(SpatialBN, SpatialBNOp<CPUContext>);
 OPERATOR_SCHEMA(SpatialBN)
     .NumInputs({5, 7})
     .NumOutputs({1, 5})
+    .AcceptsTensorViews()
     .AllowInplace({{0, 0}})
     .CostInferenceFunction(CostInferenceForSpatialBN)
     .EnforceInplace({{3, 1}, {4, 2}})
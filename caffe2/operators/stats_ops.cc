@@ -1,4 +1,7 @@
 #include <chrono>
+#include <iomanip>
+#include <map>
+#include <sstream>
 #include <vector>
 #include "caffe2/core/operator.h"
 #include "caffe2/core/stats.h"
@@ -195,6 +198,85 @@ struct CpuUtilizationReportOp : public Operator<CPUContext> {
   } stat_;
 };
 
+// Summarizes the stats of the stages of an input pipeline: the queues and
+// the prefetching operators, which all export queue_dequeued_records under
+// their name, since the previous run of the op.
+class PipelineReportOp : public Operator<CPUContext> {
+ public:
+  PipelineReportOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws),
+        last_ts_(std::chrono::high_resolution_clock::now()) {}
+
+  bool RunOnDevice() override {
+    auto registry = InputSize() > 0
+        ? OperatorBase::Input<std::unique_ptr<StatRegistry>>(0).get()
+        : &StatRegistry::get();
+    // Don't reset the counters, other exporters may be publishing them
+    auto data = registry->publish(false);
+    auto now = std::chrono::high_resolution_clock::now();
+    double secs = std::chrono::duration<double>(now - last_ts_).count();
+    last_ts_ = now;
+
+    std::map<std::string, int64_t> values;
+    std::map<std::string, int64_t> deltas;
+    for (const auto& stat : data) {
+      auto it = last_values_.find(stat.key);
+      // A value going down was reset by another exporter
+      deltas[stat.key] = it == last_values_.end() || stat.value < it->second
+          ? stat.value
+          : stat.value - it->second;
+      values[stat.key] = stat.value;
+    }
+    last_values_ = values;
+
+    const std::string kRecords = "/queue_dequeued_records";
+    std::vector<std::string> lines;
+    for (const auto& kv : deltas) {
+      const auto& key = kv.first;
+      if (key.size() <= kRecords.size() ||
+          key.compare(
+              key.size() - kRecords.size(), kRecords.size(), kRecords) != 0) {
+        continue;
+      }
+      auto stage = key.substr(0, key.size() - kRecords.size());
+      auto delta = [&](const std::string& name) -> double {
+        auto it = deltas.find(stage + "/" + name);
+        return it == deltas.end() ? 0 : it->second;
+      };
+      auto value = [&](const std::string& name) -> int64_t {
+        auto it = values.find(stage + "/" + name);
+        return it == values.end() ? 0 : it->second;
+      };
+      std::ostringstream line;
+      line << std::fixed << std::setprecision(1) << stage << ": "
+           << kv.second / secs << " items/s, "
+           << delta("queue_dequeued_bytes") / secs / (1 << 20)
+           << " MB/s, readers blocked "
+           << delta("queue_read_blocked_ns") / 1e9 / secs
+           << " s/s, writers blocked "
+           << delta("queue_write_blocked_ns") / 1e9 / secs
+           << " s/s, occupancy p50 " << value("queue_occupancy/p50") << " p90 "
+           << value("queue_occupancy/p90");
+      lines.push_back(line.str());
+    }
+
+    for (const auto& line : lines) {
+      LOG(INFO) << line;
+    }
+    if (OutputSize() > 0) {
+      auto* report = Output(0);
+      report->Resize(lines.size());
+      std::copy(
+          lines.begin(), lines.end(), report->mutable_data<std::string>());
+    }
+    return true;
+  }
+
+ private:
+  std::chrono::time_point<std::chrono::high_resolution_clock> last_ts_;
+  std::map<std::string, int64_t> last_values_;
+};
+
 REGISTER_CPU_OPERATOR(StatRegistryCreate, StatRegistryCreateOp);
 REGISTER_CPU_OPERATOR(StatRegistryUpdate, StatRegistryUpdateOp);
 REGISTER_CPU_OPERATOR(StatRegistryExport, StatRegistryExportOp);
@@ -204,6 +286,7 @@ REGISTER_CPU_OPERATOR(TimerEnd, TimerEndOp);
 REGISTER_CPU_OPERATOR(TimerGetAndEnd, TimerGetAndEndOp);
 REGISTER_CPU_OPERATOR(TimerGet, TimerGetOp);
 REGISTER_CPU_OPERATOR(CpuUtilizationReport, CpuUtilizationReportOp);
+REGISTER_CPU_OPERATOR(PipelineReport, PipelineReportOp);
 
 OPERATOR_SCHEMA(StatRegistryCreate)
     .NumInputs(0)
@@ -286,6 +369,24 @@ OPERATOR_SCHEMA(CpuUtilizationReport)
         "Delta in max CPU utilization observed, in percentage as a float value")
     .Arg("stats_name", "String name of the stat entry holding CPU utilization");
 
+OPERATOR_SCHEMA(PipelineReport)
+    .NumInputs(0, 1)
+    .NumOutputs(0, 1)
+    .SetDoc(R"DOC(
+Logs a line per stage of the input pipeline, the queues and the prefetching
+operators, with the rates since the previous run of the op: the items and
+bytes dequeued per second, the seconds per second the readers were blocked
+on an empty queue and the writers on a full one, and the occupancy
+percentiles. Readers blocked point to a slow producer, writers blocked to a
+slow consumer. The counters aren't reset.
+)DOC")
+    .Input(
+        0,
+        "handle",
+        "If provided, report the stats of the given StatRegistry. "
+        "Otherwise, report the stats of the global singleton.")
+    .Output(0, "report", "If provided, 1D string tensor with the lines.");
+
 CAFFE_KNOWN_TYPE(TimerInstance*);
 CAFFE_KNOWN_TYPE(std::unique_ptr<caffe2::StatRegistry>);
 } // namespace caffe2
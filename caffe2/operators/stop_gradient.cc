@@ -7,6 +7,7 @@ REGISTER_CPU_OPERATOR(StopGradient, StopGradientOp<CPUContext>);
 OPERATOR_SCHEMA(StopGradient)
     .NumInputs(1, 1)
     .NumOutputs(1, 1)
+    .CheapToRun()
     .AllowInplace({{0, 0}})
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
@@ -44,6 +44,8 @@ REGISTER_CPU_OPERATOR(
 OPERATOR_SCHEMA(Tanh)
   .NumInputs(1)
   .NumOutputs(1)
+  .AcceptsTensorViews()
+  .CostInferenceFunction(PointwiseCostInference<3>)
   .AllowInplace({{0, 0}})
   .IdenticalTypeAndShape()
   .SetDoc(R"DOC(
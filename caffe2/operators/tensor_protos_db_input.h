@@ -29,6 +29,10 @@ class TensorProtosDBInput final : public PrefetchOperator<Context> {
   bool shape_inferred_ = false;
   string key_;
   string value_;
+  vector<string> values_;
+  // Used instead of values_ with dbs that do not copy their values, e.g.
+  // ZmqDB
+  vector<db::ValueView> views_;
 };
 
 template <class Context>
@@ -61,10 +65,20 @@ bool TensorProtosDBInput<Context>::Prefetch() {
     }
   } else {
     vector<TensorCPU> temp_tensors(OutputSize());
+    const bool use_views = reader.SupportsValueView();
+    if (use_views) {
+      reader.ReadViews(batch_size_, &views_);
+    } else {
+      reader.ReadBatch(batch_size_, nullptr, &values_);
+    }
     for (int item_id = 0; item_id < batch_size_; ++item_id) {
-      reader.Read(&key_, &value_);
       TensorProtos protos;
-      CAFFE_ENFORCE(protos.ParseFromString(value_));
+      if (use_views) {
+        CAFFE_ENFORCE(protos.ParseFromArray(
+            views_[item_id].data(), views_[item_id].size()));
+      } else {
+        CAFFE_ENFORCE(protos.ParseFromString(values_[item_id]));
+      }
       CAFFE_ENFORCE(protos.protos_size() == OutputSize());
       if (!shape_inferred_) {
         // First, set the shape of all the blobs.
@@ -91,6 +105,8 @@ bool TensorProtosDBInput<Context>::Prefetch() {
                 src.nbytes() * item_id);
       }
     }
+    // Releases the buffers of the db
+    views_.clear();
   }
   return true;
 }
@@ -4,6 +4,7 @@
 #include "caffe2/core/types.h"
 #include "caffe2/operators/text_file_reader_utils.h"
 #include "caffe2/utils/string_utils.h"
+#include "caffe2/utils/thread_pool.h"
 
 namespace caffe2 {
 
@@ -13,10 +14,24 @@ struct TextFileReaderInstance {
       char escape,
       const std::string& filename,
       int numPasses,
-      const std::vector<int>& types)
-      : fileReader(filename),
-        tokenizer(Tokenizer(delims, escape), &fileReader, numPasses),
+      const std::vector<int>& types,
+      bool mapped,
+      int numThreads)
+      : delims(delims),
+        escape(escape),
+        numPasses(numPasses),
         fieldTypes(types) {
+    if (mapped) {
+      mappedFile.reset(new MappedFile(filename));
+      if (numThreads > 1) {
+        // the thread reading a batch converts a chunk of it as well
+        threadPool.reset(new TaskThreadPool(numThreads - 1));
+      }
+    } else {
+      fileReader.reset(new FileReader(filename));
+      tokenizer.reset(new BufferedTokenizer(
+          Tokenizer(delims, escape), fileReader.get(), numPasses));
+    }
     for (const auto dt : fieldTypes) {
       fieldMetas.push_back(
           DataTypeToTypeMeta(static_cast<TensorProto_DataType>(dt)));
@@ -24,8 +39,21 @@ struct TextFileReaderInstance {
     }
   }
 
-  FileReader fileReader;
-  BufferedTokenizer tokenizer;
+  std::vector<char> delims;
+  char escape;
+  int numPasses;
+
+  // buffered reading
+  std::unique_ptr<FileReader> fileReader;
+  std::unique_ptr<BufferedTokenizer> tokenizer;
+
+  // mapped reading: the rows of a batch are claimed under the mutex and
+  // converted in parallel by chunks of consecutive rows
+  std::unique_ptr<MappedFile> mappedFile;
+  std::unique_ptr<TaskThreadPool> threadPool;
+  size_t offset{0};
+  int pass{0};
+
   std::vector<int> fieldTypes;
   std::vector<TypeMeta> fieldMetas;
   std::vector<size_t> fieldByteSizes;
@@ -42,14 +70,26 @@ class CreateTextFileReaderOp : public Operator<CPUContext> {
       : Operator<CPUContext>(operator_def, ws),
         filename_(GetSingleArgument<string>("filename", "")),
         numPasses_(GetSingleArgument<int>("num_passes", 1)),
-        fieldTypes_(GetRepeatedArgument<int>("field_types")) {
+        fieldTypes_(GetRepeatedArgument<int>("field_types")),
+        mmap_(GetSingleArgument<bool>("mmap", false)),
+        numThreads_(GetSingleArgument<int>("num_threads", 1)) {
     CAFFE_ENFORCE(fieldTypes_.size() > 0, "field_types arg must be non-empty");
+    CAFFE_ENFORCE_GT(numThreads_, 0);
+    CAFFE_ENFORCE(
+        mmap_ || numThreads_ == 1,
+        "num_threads > 1 is only supported with mmap");
   }
 
   bool RunOnDevice() override {
     *OperatorBase::Output<std::unique_ptr<TextFileReaderInstance>>(0) =
         std::unique_ptr<TextFileReaderInstance>(new TextFileReaderInstance(
-            {'\n', '\t'}, '\0', filename_, numPasses_, fieldTypes_));
+            {'\n', '\t'},
+            '\0',
+            filename_,
+            numPasses_,
+            fieldTypes_,
+            mmap_,
+            numThreads_));
     return true;
   }
 
@@ -57,6 +97,8 @@ class CreateTextFileReaderOp : public Operator<CPUContext> {
   std::string filename_;
   int numPasses_;
   std::vector<int> fieldTypes_;
+  bool mmap_;
+  int numThreads_;
 };
 
 inline void convert(
@@ -113,7 +155,9 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
     }
 
     int rowsRead = 0;
-    {
+    if (instance->mappedFile) {
+      rowsRead = ReadMapped(instance, datas);
+    } else {
       // TODO(azzolini): support multi-threaded reading
       std::lock_guard<std::mutex> guard(instance->globalMutex_);
 
@@ -122,7 +166,7 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
       while (!finished && (rowsRead < batchSize_)) {
         int field;
         for (field = 0; field < numFields; ++field) {
-          finished = !instance->tokenizer.next(token);
+          finished = !instance->tokenizer->next(token);
           if (finished) {
             CAFFE_ENFORCE(
                 field == 0, "Invalid number of fields at end of file.");
@@ -156,6 +200,120 @@ class TextFileReaderReadOp : public Operator<CPUContext> {
   }
 
  private:
+  // Minimum number of rows converted by a thread
+  static constexpr int kMinRowsPerChunk = 64;
+
+  int ReadMapped(TextFileReaderInstance* instance, std::vector<char*>& datas) {
+    std::vector<CharRange> rows;
+    size_t firstRow;
+    {
+      std::lock_guard<std::mutex> guard(instance->globalMutex_);
+      char* data = instance->mappedFile->data();
+      const size_t size = instance->mappedFile->size();
+      while (rows.size() < batchSize_ && instance->pass < instance->numPasses) {
+        if (instance->offset == size) {
+          ++instance->pass;
+          instance->offset = 0;
+          continue;
+        }
+        char* start = data + instance->offset;
+        char* end = findUnescaped(start, data + size, '\n', instance->escape);
+        CAFFE_ENFORCE(end, "Invalid number of fields at end of file.");
+        rows.push_back({start, end});
+        instance->offset = end + 1 - data;
+      }
+      firstRow = instance->rowsRead;
+      instance->rowsRead += rows.size();
+    }
+
+    const int numRows = rows.size();
+    const int numChunks = std::max(
+        1,
+        std::min<int>(
+            instance->threadPool ? instance->threadPool->size() + 1 : 1,
+            numRows / kMinRowsPerChunk));
+    std::vector<std::exception_ptr> errors(numChunks);
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining = numChunks - 1;
+    for (int chunk = 1; chunk < numChunks; ++chunk) {
+      instance->threadPool->run([&, chunk]() {
+        try {
+          ConvertRows(instance, rows, firstRow, datas, chunk, numChunks);
+        } catch (...) {
+          errors[chunk] = std::current_exception();
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        if (--remaining == 0) {
+          done.notify_one();
+        }
+      });
+    }
+    try {
+      ConvertRows(instance, rows, firstRow, datas, 0, numChunks);
+    } catch (...) {
+      errors[0] = std::current_exception();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [&]() { return remaining == 0; });
+    }
+    for (const auto& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+    return numRows;
+  }
+
+  // Tokenizes and converts the rows of a chunk, runs of rows following
+  // each other in the file are tokenized at once
+  void ConvertRows(
+      TextFileReaderInstance* instance,
+      const std::vector<CharRange>& rows,
+      size_t firstRow,
+      const std::vector<char*>& datas,
+      int chunk,
+      int numChunks) {
+    const int numFields = datas.size();
+    const size_t begin = rows.size() * chunk / numChunks;
+    const size_t end = rows.size() * (chunk + 1) / numChunks;
+    Tokenizer tokenizer(instance->delims, instance->escape);
+    TokenizedString tokenized;
+    size_t row = begin;
+    while (row < end) {
+      size_t runEnd = row + 1;
+      while (runEnd < end && rows[runEnd].start == rows[runEnd - 1].end + 1) {
+        ++runEnd;
+      }
+      tokenizer.reset();
+      // the newline of the last row ends its last field
+      tokenizer.next(rows[row].start, rows[runEnd - 1].end + 1, tokenized);
+      const auto& tokens = tokenized.tokens();
+      size_t tokenIndex = 0;
+      for (; row < runEnd; ++row) {
+        for (int field = 0; field < numFields; ++field) {
+          CAFFE_ENFORCE(
+              tokenIndex < tokens.size() &&
+                  ((field == 0 && tokens[tokenIndex].startDelimId == 0) ||
+                   (field > 0 && tokens[tokenIndex].startDelimId == 1)),
+              "Invalid number of columns at row ",
+              firstRow + row + 1);
+          const auto& token = tokens[tokenIndex++];
+          convert(
+              (TensorProto_DataType)instance->fieldTypes[field],
+              token.start,
+              token.end,
+              datas[field] + row * instance->fieldByteSizes[field]);
+        }
+      }
+      CAFFE_ENFORCE(
+          tokenIndex == tokens.size(),
+          "Invalid number of columns at row ",
+          firstRow + runEnd);
+    }
+  }
+
   TIndex batchSize_;
 };
 
@@ -173,6 +331,14 @@ OPERATOR_SCHEMA(CreateTextFileReader)
     .Arg(
         "field_types",
         "List with type of each field. Type enum is found at core.DataType.")
+    .Arg(
+        "mmap",
+        "Memory map the file instead of reading it through a buffer. "
+        "Default false.")
+    .Arg(
+        "num_threads",
+        "Number of threads converting the rows of a batch, requires mmap. "
+        "The rows are returned in the order of the file. Default 1.")
     .Output(0, "handler", "Pointer to the created TextFileReaderInstance.");
 
 OPERATOR_SCHEMA(TextFileReaderRead)
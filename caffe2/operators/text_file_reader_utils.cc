@@ -1,6 +1,9 @@
 #include "caffe2/operators/text_file_reader_utils.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <cerrno>
 #include <cstring>
 #include <sstream>
@@ -116,4 +119,60 @@ void FileReader::operator()(CharRange& range) {
   range.start = buffer;
   range.end = buffer + numRead;
 }
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY, 0777);
+  if (fd < 0) {
+    throw std::runtime_error(
+        "Error opening file for reading: " + std::string(std::strerror(errno)) +
+        " Path=" + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    auto error = std::string(std::strerror(errno));
+    close(fd);
+    throw std::runtime_error("Error reading file size: " + error);
+  }
+  size_ = st.st_size;
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      auto error = std::string(std::strerror(errno));
+      close(fd);
+      throw std::runtime_error(
+          "Error mapping file: " + error + " Path=" + path);
+    }
+    data_ = static_cast<char*>(data);
+    // the rows are claimed in file order
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+  // the mapping keeps the file open
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+char* findUnescaped(char* start, char* end, char delim, char escape) {
+  char* ch = start;
+  while (ch < end) {
+    char* found = static_cast<char*>(std::memchr(ch, delim, end - ch));
+    if (!found) {
+      return nullptr;
+    }
+    // the delimiter is escaped by an odd number of escape characters
+    char* escapes = found;
+    while (escapes > start && *(escapes - 1) == escape) {
+      --escapes;
+    }
+    if ((found - escapes) % 2 == 0) {
+      return found;
+    }
+    ch = found + 1;
+  }
+  return nullptr;
+}
 }
@@ -117,6 +117,29 @@ class FileReader : public StringProvider {
   std::unique_ptr<char[]> buffer_;
 };
 
+// Read only memory mapping of a whole file, to tokenize ranges of it in
+// place
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  char* data() const {
+    return data_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  char* data_{nullptr};
+  size_t size_{0};
+};
+
+// Returns the first delimiter in [start, end) which isn't escaped, or
+// nullptr if there is none
+char* findUnescaped(char* start, char* end, char delim, char escape);
+
 } // namespace caffe2
 
 #endif // CAFFE2_OPERATORS_TEXT_FILE_READER_UTILS_H
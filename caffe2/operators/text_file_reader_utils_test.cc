@@ -119,4 +119,29 @@ TEST(TextFileReaderUtilsTest, TokenizeTest) {
   std::remove(tmpname);
 }
 
+TEST(TextFileReaderUtilsTest, MappedFileTest) {
+  std::string ch = "a\tb\nc\\\nd\t\\\\\ne\tf\\";
+  char* tmpname = std::tmpnam(nullptr);
+  std::ofstream outFile;
+  outFile.open(tmpname);
+  outFile << ch;
+  outFile.close();
+
+  MappedFile mapped(tmpname);
+  EXPECT_EQ(ch, std::string(mapped.data(), mapped.size()));
+
+  // the second newline is escaped, the third one follows an escaped escape
+  char* start = mapped.data();
+  char* end = mapped.data() + mapped.size();
+  std::vector<std::string> rows;
+  while (char* row = findUnescaped(start, end, '\n', '\\')) {
+    rows.emplace_back(start, row);
+    start = row + 1;
+  }
+  std::vector<std::string> expected = {"a\tb", "c\\\nd\t\\\\"};
+  EXPECT_EQ(expected, rows);
+  EXPECT_EQ("e\tf\\", std::string(start, end));
+  std::remove(tmpname);
+}
+
 } // namespace caffe2
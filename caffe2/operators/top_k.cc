@@ -1,13 +1,16 @@
 #include "caffe2/operators/top_k.h"
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
-#include <queue>
+#include <numeric>
 #include <utility>
 #include <vector>
 
+#include "caffe2/core/workspace.h"
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -23,47 +26,149 @@ struct ValueComp {
   }
 };
 
+// Heap selection is used while k is below 1 / kHeapSelectionRatio of the
+// row, a selection over the whole row above.
+constexpr TIndex kHeapSelectionRatio = 16;
+// Contiguous rows are compared to the smallest value of the heap by blocks of
+// kBlockSize, so that most values of long rows are discarded in SIMD.
+constexpr int kBlockSize = 16;
+// Below this many input elements per range, waking up the threads costs more
+// than it saves.
+constexpr TIndex kMinElementsPerRange = 1 << 15;
+
+template <typename T>
+using TopKBuffer = std::vector<std::pair<T, TIndex>>;
+
+template <typename T>
+inline bool AnyGreater(const T* x, const T threshold) {
+  return Eigen::Map<const Eigen::Array<T, kBlockSize, 1>>(x).maxCoeff() >
+      threshold;
+}
+
+// Selects the k largest of the n values x[i * stride] into buffer, in
+// decreasing order and the lower index first among equal values.
 template <typename T>
-void GetTopK(
-    const T* input,
+void SelectTopK(
+    const T* x,
     const TIndex n,
     const TIndex k,
-    const TIndex src_offset,
-    const TIndex dst_offset,
     const TIndex stride,
-    T* values,
-    TIndex* indices,
-    TIndex* flatten_indices) {
-  const T* src_ptr = input + src_offset;
-  std::vector<std::pair<T, TIndex>> heap_data;
-  heap_data.reserve(k);
+    TopKBuffer<T>* buffer) {
+  buffer->clear();
+  if (k * kHeapSelectionRatio >= n) {
+    for (TIndex i = 0; i < n; ++i) {
+      buffer->emplace_back(x[i * stride], i);
+    }
+    if (k < n) {
+      std::nth_element(
+          buffer->begin(),
+          buffer->begin() + k - 1,
+          buffer->end(),
+          ValueComp<T>());
+      buffer->resize(k);
+    }
+    std::sort(buffer->begin(), buffer->end(), ValueComp<T>());
+    return;
+  }
+
+  // Min-heap of the k largest values so far, a value only gets in when it is
+  // larger than the smallest of them since its index is larger.
   for (TIndex i = 0; i < k; ++i) {
-    heap_data.emplace_back(*src_ptr, i);
-    src_ptr += stride;
+    buffer->emplace_back(x[i * stride], i);
   }
-  std::priority_queue<
-      std::pair<T, TIndex>,
-      std::vector<std::pair<T, TIndex>>,
-      ValueComp<T>>
-      pq(ValueComp<T>(), std::move(heap_data));
-  for (TIndex i = k; i < n; ++i) {
-    if (pq.top().first < *src_ptr) {
-      pq.pop();
-      pq.emplace(*src_ptr, i);
+  std::make_heap(buffer->begin(), buffer->end(), ValueComp<T>());
+  T threshold = buffer->front().first;
+  auto push = [&](const T value, const TIndex i) {
+    std::pop_heap(buffer->begin(), buffer->end(), ValueComp<T>());
+    buffer->back() = std::make_pair(value, i);
+    std::push_heap(buffer->begin(), buffer->end(), ValueComp<T>());
+    threshold = buffer->front().first;
+  };
+  TIndex i = k;
+  if (stride == 1) {
+    for (; i + kBlockSize <= n; i += kBlockSize) {
+      if (!AnyGreater(x + i, threshold)) {
+        continue;
+      }
+      for (TIndex j = i; j < i + kBlockSize; ++j) {
+        if (threshold < x[j]) {
+          push(x[j], j);
+        }
+      }
     }
-    src_ptr += stride;
   }
-  TIndex dst_pos = dst_offset + (k - 1) * stride;
-  while (!pq.empty()) {
-    const auto& item = pq.top();
-    values[dst_pos] = item.first;
-    indices[dst_pos] = item.second;
-    if (flatten_indices != nullptr) {
-      flatten_indices[dst_pos] = src_offset + item.second * stride;
+  for (; i < n; ++i) {
+    if (threshold < x[i * stride]) {
+      push(x[i * stride], i);
     }
-    pq.pop();
-    dst_pos -= stride;
   }
+  std::sort_heap(buffer->begin(), buffer->end(), ValueComp<T>());
+}
+
+// The rows of n values along axis of a tensor of dims, where every row
+// has next_size times the stride of its values.
+struct TopKRows {
+  TopKRows(const std::vector<TIndex>& dims, const int axis, const TIndex k)
+      : n(dims[axis]),
+        next_size(std::accumulate(
+            dims.cbegin() + axis + 1,
+            dims.cend(),
+            TIndex(1),
+            std::multiplies<TIndex>())),
+        num_rows(
+            std::accumulate(
+                dims.cbegin(),
+                dims.cbegin() + axis,
+                TIndex(1),
+                std::multiplies<TIndex>()) *
+            next_size),
+        k(k) {}
+
+  TIndex src_offset(const TIndex row) const {
+    return row / next_size * n * next_size + row % next_size;
+  }
+
+  TIndex dst_offset(const TIndex row) const {
+    return row / next_size * k * next_size + row % next_size;
+  }
+
+  const TIndex n;
+  const TIndex next_size;
+  const TIndex num_rows;
+  const TIndex k;
+};
+
+// Runs fn(row, buffer) on every row, splitting the rows between the threads
+// of the workspace thread pool when they are large enough.
+template <typename T>
+void ForEachRow(
+    Workspace* ws,
+    const int num_threads,
+    const TopKRows& rows,
+    const std::function<void(TIndex, TopKBuffer<T>*)>& fn) {
+  int num_ranges = 1;
+  const TIndex size = rows.num_rows * rows.n;
+  if (num_threads != 1 && rows.num_rows > 1 &&
+      size >= 2 * kMinElementsPerRange) {
+    const int pool_threads = ws->GetThreadPool()->getNumThreads();
+    const int threads =
+        num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads);
+    num_ranges = static_cast<int>(std::min<TIndex>(
+        std::min<TIndex>(threads, rows.num_rows), size / kMinElementsPerRange));
+  }
+  auto run_range = [&](size_t range) {
+    TopKBuffer<T> buffer;
+    const TIndex begin = range * rows.num_rows / num_ranges;
+    const TIndex end = (range + 1) * rows.num_rows / num_ranges;
+    for (TIndex row = begin; row < end; ++row) {
+      fn(row, &buffer);
+    }
+  };
+  if (num_ranges <= 1) {
+    run_range(0);
+    return;
+  }
+  ws->GetThreadPool()->runRanges(num_ranges, run_range);
 }
 
 template <typename T>
@@ -116,36 +221,70 @@ bool TopKOp<T, Context>::RunOnDevice() {
       ? nullptr
       : flatten_indices->template mutable_data<TIndex>();
 
-  const TIndex prev_size = std::accumulate(
-      input_dims.cbegin(),
-      input_dims.cbegin() + axis_,
-      TIndex(1),
-      std::multiplies<TIndex>());
-  const TIndex next_size = std::accumulate(
-      input_dims.cbegin() + axis_ + 1,
-      input_dims.cend(),
-      TIndex(1),
-      std::multiplies<TIndex>());
-  const TIndex src_offset_stride = input_dims[axis_] * next_size;
-  const TIndex dst_offset_stride = k_ * next_size;
-  TIndex src_offset = 0;
-  TIndex dst_offset = 0;
-  for (TIndex i = 0; i < prev_size; ++i) {
-    for (TIndex j = 0; j < next_size; ++j) {
-      GetTopK(
-          input_data,
-          input_dims[axis_],
-          k_,
-          src_offset + j,
-          dst_offset + j,
-          next_size,
-          values_data,
-          indices_data,
-          flatten_indices_data);
-    }
-    src_offset += src_offset_stride;
-    dst_offset += dst_offset_stride;
-  }
+  const TopKRows rows(input_dims, axis_, k_);
+  ForEachRow<T>(
+      ws_, num_threads_, rows, [&](TIndex row, TopKBuffer<T>* buffer) {
+        const TIndex src_offset = rows.src_offset(row);
+        SelectTopK(
+            input_data + src_offset, rows.n, rows.k, rows.next_size, buffer);
+        TIndex dst_pos = rows.dst_offset(row);
+        for (const auto& item : *buffer) {
+          values_data[dst_pos] = item.first;
+          indices_data[dst_pos] = item.second;
+          if (flatten_indices_data != nullptr) {
+            flatten_indices_data[dst_pos] =
+                src_offset + item.second * rows.next_size;
+          }
+          dst_pos += rows.next_size;
+        }
+      });
+  return true;
+}
+
+template <typename T, class Context>
+bool SoftmaxTopKOp<T, Context>::RunOnDevice() {
+  const auto& input = Input(0);
+  auto* values = Output(0);
+  auto* indices = Output(1);
+
+  const std::vector<TIndex>& input_dims = input.dims();
+  const int axis = input.canonical_axis_index(axis_);
+  CAFFE_ENFORCE_LE(
+      k_,
+      input_dims[axis],
+      "k argument should not be greater than the axis dim.");
+
+  std::vector<TIndex> output_dims = input_dims;
+  output_dims[axis] = k_;
+  values->Resize(output_dims);
+  indices->Resize(output_dims);
+  const T* input_data = input.template data<T>();
+  T* values_data = values->template mutable_data<T>();
+  TIndex* indices_data = indices->template mutable_data<TIndex>();
+
+  const TopKRows rows(input_dims, axis, k_);
+  ForEachRow<T>(
+      ws_, num_threads_, rows, [&](TIndex row, TopKBuffer<T>* buffer) {
+        // The softmax keeps the order, so the top k are the ones of X, and
+        // the other values are only needed for the normalization.
+        const T* x = input_data + rows.src_offset(row);
+        SelectTopK(x, rows.n, rows.k, rows.next_size, buffer);
+        const T max = buffer->front().first;
+        T sum = 0;
+        if (rows.next_size == 1) {
+          sum = (ConstEigenVectorArrayMap<T>(x, rows.n) - max).exp().sum();
+        } else {
+          for (TIndex i = 0; i < rows.n; ++i) {
+            sum += std::exp(x[i * rows.next_size] - max);
+          }
+        }
+        TIndex dst_pos = rows.dst_offset(row);
+        for (const auto& item : *buffer) {
+          values_data[dst_pos] = std::exp(item.first - max) / sum;
+          indices_data[dst_pos] = item.second;
+          dst_pos += rows.next_size;
+        }
+      });
   return true;
 }
 
@@ -200,6 +339,7 @@ bool TopKGradientOp<T, Context>::RunOnDevice() {
 
 REGISTER_CPU_OPERATOR(TopK, TopKOp<float, CPUContext>);
 REGISTER_CPU_OPERATOR(TopKGradient, TopKGradientOp<float, CPUContext>);
+REGISTER_CPU_OPERATOR(SoftmaxTopK, SoftmaxTopKOp<float, CPUContext>);
 
 OPERATOR_SCHEMA(TopK)
     .NumInputs(1)
@@ -238,6 +378,11 @@ shape [a_1, a_2, ..., a_n, r] and integer argument k, return two outputs:
 Given two equivalent values, this operator uses the indices along the last dim-
 ension as a tiebreaker. That is, the element with the lower index will appear
 first.
+
+On CPU, rows are split between the threads of the workspace thread pool when
+the input is large enough. Small k are selected with a heap, contiguous rows
+being compared to its smallest value by blocks, larger k with a selection over
+the whole row.
     )DOC")
     .Input(0, "X", "Tensor of shape [a_1, a_2, ..., a_n, r]")
     .Output(
@@ -255,7 +400,51 @@ first.
         "Flatten indices",
         "Tensor of shape [a_1 * a_2 * ... * a_n * k] containing the indices "
         "into the flatten input")
-    .Arg("k", "Number of top elements to retrieve");
+    .Arg("k", "Number of top elements to retrieve")
+    .Arg(
+        "num_threads",
+        "(CPU only) Maximum number of threads of the workspace thread pool to "
+        "run on, 0 for all of them (default) and 1 for the calling thread "
+        "only");
+
+OPERATOR_SCHEMA(SoftmaxTopK)
+    .NumInputs(1)
+    .NumOutputs(2)
+    .TensorInferenceFunction([](const OperatorDef& def,
+                                const vector<TensorShape>& in) {
+      vector<TensorShape> out = {in[0], in[0]};
+      ArgumentHelper helper(def);
+      const int k = helper.GetSingleArgument("k", -1);
+      const int dims_size = in[0].dims_size();
+      int axis = helper.GetSingleArgument("axis", -1);
+      if (axis < 0) {
+        axis += dims_size;
+      }
+      out[0].set_dims(axis, k);
+      out[1].set_dims(axis, k);
+      out[1].set_data_type(TensorProto_DataType_INT64);
+      return out;
+    })
+    .SetDoc(R"DOC(
+Same as Softmax along `axis` followed by TopK, without computing the
+probabilities of the elements out of the top k: as the softmax keeps the order
+of the elements, the top k are selected on X, and the other elements are only
+read to compute the normalization.
+    )DOC")
+    .Arg("k", "Number of top elements to retrieve")
+    .Arg("axis", "Axis of the softmax and the top k, -1 (default) for the last")
+    .Arg(
+        "num_threads",
+        "Maximum number of threads of the workspace thread pool to run on, 0 "
+        "for all of them (default) and 1 for the calling thread only")
+    .Input(0, "X", "Tensor of logits")
+    .Output(
+        0,
+        "Values",
+        "Softmax probabilities of the top k elements along axis, of the shape "
+        "of X with k elements along axis")
+    .Output(1, "Indices", "Indices of the top k elements along axis");
+NO_GRADIENT(SoftmaxTopK);
 
 OPERATOR_SCHEMA(TopKGradient).NumInputs(3).NumOutputs(1);
 
@@ -7,13 +7,13 @@
 #include <numeric>
 #include <vector>
 
-#include <thrust/sort.h>
-#include <thrust/system/cuda/execution_policy.h>
+#include <cub/cub.cuh>
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/context_gpu.h"
 #include "caffe2/operators/top_k_heap_selection.cuh"
 #include "caffe2/operators/top_k_radix_selection.cuh"
+#include "caffe2/utils/GpuBitonicSort.cuh"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
@@ -72,6 +72,156 @@ void RunHeapSelectionImpl(
           k);
 }
 
+// Rows longer than this many elements per top-k element are split across
+// blocks for the radix selection
+constexpr int kMinChunkSizePerK = 8;
+constexpr int kMinChunkSize = 1 << 14;
+
+// Scratch memory of the radix selection path
+struct TopKRadixSelectionBuffers {
+  TensorCUDA chunk_values;
+  TensorCUDA chunk_indices;
+  TensorCUDA chunk_positions;
+  TensorCUDA selected_values;
+  TensorCUDA selected_indices;
+  TensorCUDA segment_offsets;
+  TensorCUDA sort_buffer;
+};
+
+// Number of blocks the radix selection of a row is split across, enough to
+// fill the GPU when there are few rows
+int GetNumTopKChunks(
+    const TIndex outer_size,
+    const TIndex inner_size,
+    const int k,
+    CUDAContext* context) {
+  const int num_sms =
+      GetDeviceProperty(context->cuda_gpu_id()).multiProcessorCount;
+  const TIndex min_chunk_size =
+      std::max<TIndex>(kMinChunkSize, TIndex(k) * kMinChunkSizePerK);
+  const TIndex num_chunks = std::min<TIndex>(
+      inner_size / min_chunk_size,
+      math::divUp<TIndex>(2 * num_sms, outer_size));
+  return std::max<TIndex>(num_chunks, 1);
+}
+
+// Maps the positions of the top-k of the rows of candidates to the indices
+// of the candidates in the input
+__global__ void GatherChunkTopKIndicesCUDA(
+    const TIndex* chunk_indices,
+    const TIndex* positions,
+    const TIndex size,
+    const int num_candidates,
+    const int k,
+    TIndex* indices) {
+  CUDA_1D_KERNEL_LOOP(i, size) {
+    const TIndex row = i / k;
+    indices[i] = chunk_indices[row * num_candidates + positions[i]];
+  }
+}
+
+// Sorts each row of k values and indices in place, by decreasing value and
+// increasing index, with a bitonic sort in shared memory
+template <typename T, int kPower2SortSize, int kThreadsPerBlock>
+__global__ void BitonicSortTopKRowsCUDA(
+    const int k,
+    const T pad_value,
+    const TIndex pad_index,
+    T* values,
+    TIndex* indices) {
+  __shared__ T smem_values[kPower2SortSize];
+  __shared__ TIndex smem_indices[kPower2SortSize];
+  T* row_values = values + static_cast<TIndex>(blockIdx.x) * k;
+  TIndex* row_indices = indices + static_cast<TIndex>(blockIdx.x) * k;
+  for (int i = threadIdx.x; i < kPower2SortSize; i += kThreadsPerBlock) {
+    // The padding goes last
+    smem_values[i] = i < k ? row_values[i] : pad_value;
+    smem_indices[i] = i < k ? row_indices[i] : pad_index;
+  }
+  __syncthreads();
+  bitonicSort<GTComp<T, TIndex>, T, TIndex, kPower2SortSize, kThreadsPerBlock>(
+      smem_values, smem_indices, GTComp<T, TIndex>());
+  for (int i = threadIdx.x; i < k; i += kThreadsPerBlock) {
+    row_values[i] = smem_values[i];
+    row_indices[i] = smem_indices[i];
+  }
+}
+
+__global__ void SetSegmentOffsetsCUDA(const int n, const int k, int* offsets) {
+  CUDA_1D_KERNEL_LOOP(i, n) {
+    offsets[i] = i * k;
+  }
+}
+
+template <typename T>
+void SortTopKRows(
+    const TIndex outer_size,
+    const int k,
+    T* selected_values,
+    TIndex* selected_indices,
+    T* values,
+    TIndex* indices,
+    TopKRadixSelectionBuffers* buffers,
+    CUDAContext* context) {
+  constexpr int kThreadsPerBlock = 512;
+  const T pad_value = -std::numeric_limits<T>::infinity();
+  const TIndex pad_index = std::numeric_limits<TIndex>::max();
+  if (k <= 1024) {
+    BitonicSortTopKRowsCUDA<T, 1024, kThreadsPerBlock>
+        <<<outer_size, kThreadsPerBlock, 0, context->cuda_stream()>>>(
+            k, pad_value, pad_index, values, indices);
+  } else if (k <= 2048) {
+    BitonicSortTopKRowsCUDA<T, 2048, kThreadsPerBlock>
+        <<<outer_size, kThreadsPerBlock, 0, context->cuda_stream()>>>(
+            k, pad_value, pad_index, values, indices);
+  } else if (k <= kMaxBitonicSortSize) {
+    BitonicSortTopKRowsCUDA<T, kMaxBitonicSortSize, kThreadsPerBlock>
+        <<<outer_size, kThreadsPerBlock, 0, context->cuda_stream()>>>(
+            k, pad_value, pad_index, values, indices);
+  } else {
+    // Too large for shared memory, one segmented sort of all the rows. The
+    // sort is stable, which keeps the smaller indices first among equal
+    // values, as they come from the selection
+    buffers->segment_offsets.Resize(outer_size + 1);
+    int* offsets = buffers->segment_offsets.mutable_data<int>();
+    SetSegmentOffsetsCUDA<<<
+        CAFFE_GET_BLOCKS(outer_size + 1),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context->cuda_stream()>>>(outer_size + 1, k, offsets);
+    size_t temp_bytes = 0;
+    CUDA_ENFORCE(cub::DeviceSegmentedRadixSort::SortPairsDescending(
+        nullptr,
+        temp_bytes,
+        selected_values,
+        values,
+        selected_indices,
+        indices,
+        outer_size * k,
+        outer_size,
+        offsets,
+        offsets + 1,
+        0,
+        sizeof(T) * 8,
+        context->cuda_stream()));
+    buffers->sort_buffer.Resize(temp_bytes);
+    CUDA_ENFORCE(cub::DeviceSegmentedRadixSort::SortPairsDescending(
+        static_cast<void*>(buffers->sort_buffer.mutable_data<char>()),
+        temp_bytes,
+        selected_values,
+        values,
+        selected_indices,
+        indices,
+        outer_size * k,
+        outer_size,
+        offsets,
+        offsets + 1,
+        0,
+        sizeof(T) * 8,
+        context->cuda_stream()));
+  }
+}
+
 template <typename T, bool kSelectMax = true>
 void RunRadixSelectionImpl(
     const T* input,
@@ -80,24 +230,82 @@ void RunRadixSelectionImpl(
     const int k,
     T* values,
     TIndex* indices,
+    TopKRadixSelectionBuffers* buffers,
     CUDAContext* context) {
-  const int block = std::min(
-      math::roundUp(static_cast<int>(inner_size), kWarpSize),
-      CAFFE_CUDA_NUM_THREADS);
-  gatherTopK<T, kSelectMax, TIndex>
-      <<<outer_size, block, 0, context->cuda_stream()>>>(
-          input, inner_size, k, outer_size, values, indices);
-  // Unfortunately the output is not currently sorted, and there is no batch
-  // sorting utility available. Iterate over all of the slices and sort them
-  // in-place using Thrust.
-  for (int i = 0; i < outer_size; ++i) {
-    thrust::sort_by_key(
-        thrust::cuda::par.on(context->cuda_stream()),
-        values + i * k,
-        values + i * k + k,
-        indices + i * k,
-        thrust::greater<T>());
+  // The rows too long to sort in shared memory are selected into buffers and
+  // sorted into the outputs, the others are sorted in place
+  T* selected_values = values;
+  TIndex* selected_indices = indices;
+  if (k > kMaxBitonicSortSize) {
+    buffers->selected_values.Resize(outer_size, k);
+    buffers->selected_indices.Resize(outer_size, k);
+    selected_values = buffers->selected_values.template mutable_data<T>();
+    selected_indices = buffers->selected_indices.mutable_data<TIndex>();
   }
+
+  const int num_chunks = GetNumTopKChunks(outer_size, inner_size, k, context);
+  if (num_chunks > 1) {
+    // Top-k of every chunk of the rows, then top-k of the k * num_chunks
+    // candidates of every row
+    const int chunk_size = inner_size / num_chunks;
+    const int num_candidates = num_chunks * k;
+    buffers->chunk_values.Resize(outer_size, num_candidates);
+    buffers->chunk_indices.Resize(outer_size, num_candidates);
+    buffers->chunk_positions.Resize(outer_size, k);
+    T* chunk_values = buffers->chunk_values.template mutable_data<T>();
+    TIndex* chunk_indices = buffers->chunk_indices.mutable_data<TIndex>();
+    TIndex* chunk_positions = buffers->chunk_positions.mutable_data<TIndex>();
+    const int chunk_block = std::min(
+        math::roundUp(chunk_size, kWarpSize), CAFFE_CUDA_NUM_THREADS);
+    gatherChunkTopK<T, kSelectMax, TIndex>
+        <<<outer_size * num_chunks, chunk_block, 0, context->cuda_stream()>>>(
+            input,
+            inner_size,
+            chunk_size,
+            num_chunks,
+            k,
+            outer_size,
+            chunk_values,
+            chunk_indices);
+    const int block = std::min(
+        math::roundUp(num_candidates, kWarpSize), CAFFE_CUDA_NUM_THREADS);
+    gatherTopK<T, kSelectMax, TIndex>
+        <<<outer_size, block, 0, context->cuda_stream()>>>(
+            chunk_values,
+            num_candidates,
+            k,
+            outer_size,
+            selected_values,
+            chunk_positions);
+    GatherChunkTopKIndicesCUDA<<<
+        CAFFE_GET_BLOCKS(outer_size * k),
+        CAFFE_CUDA_NUM_THREADS,
+        0,
+        context->cuda_stream()>>>(
+        chunk_indices,
+        chunk_positions,
+        outer_size * k,
+        num_candidates,
+        k,
+        selected_indices);
+  } else {
+    const int block = std::min(
+        math::roundUp(static_cast<int>(inner_size), kWarpSize),
+        CAFFE_CUDA_NUM_THREADS);
+    gatherTopK<T, kSelectMax, TIndex>
+        <<<outer_size, block, 0, context->cuda_stream()>>>(
+            input, inner_size, k, outer_size, selected_values, selected_indices);
+  }
+  // The output of the selection is not sorted
+  SortTopKRows<T>(
+      outer_size,
+      k,
+      selected_values,
+      selected_indices,
+      values,
+      indices,
+      buffers,
+      context);
 }
 
 template <typename T>
@@ -108,6 +316,7 @@ void RunTopKOnLastDimCUDAImpl(
     const int k,
     T* values,
     TIndex* indices,
+    TopKRadixSelectionBuffers* buffers,
     CUDAContext* context) {
   // If k is small, uses heap selection, otherwise uses radix selection.
   if (k < 32) {
@@ -121,7 +330,7 @@ void RunTopKOnLastDimCUDAImpl(
         input, outer_size, inner_size, k, values, indices, context);
   } else {
     RunRadixSelectionImpl<T>(
-        input, outer_size, inner_size, k, values, indices, context);
+        input, outer_size, inner_size, k, values, indices, buffers, context);
   }
 }
 
@@ -198,6 +407,8 @@ class TopKOp<T, CUDAContext> : public Operator<CUDAContext> {
   TensorCUDA output_dims_device_;
   TensorCUDA output_transposed_dims_device_;
   TensorCUDA output_transposed_axes_device_;
+
+  TopKRadixSelectionBuffers radix_selection_buffers_;
 };
 
 template <typename T>
@@ -279,6 +490,7 @@ bool TopKOp<T, CUDAContext>::RunOnDevice() {
       k_,
       values_data,
       indices_data,
+      &radix_selection_buffers_,
       &context_);
   if (need_transpose) {
     MakeTransposeParams(
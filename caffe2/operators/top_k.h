@@ -14,9 +14,12 @@ class TopKOp : public Operator<Context> {
 
   TopKOp(const OperatorDef& operator_def, Workspace* ws)
       : Operator<Context>(operator_def, ws),
+        ws_(ws),
         OP_SINGLE_ARG(int, "k", k_, -1),
-        OP_SINGLE_ARG(int, "axis", axis_, -1) {
+        OP_SINGLE_ARG(int, "axis", axis_, -1),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 0) {
     CAFFE_ENFORCE(k_ >= 1, "k argument must be >= 1");
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
   }
 
   ~TopKOp() {}
@@ -24,8 +27,37 @@ class TopKOp : public Operator<Context> {
   bool RunOnDevice() override;
 
  private:
+  Workspace* ws_;
   const int k_;
   int axis_;
+  // 0 uses all threads of the workspace thread pool, 1 the calling thread
+  int num_threads_;
+};
+
+// TopK of the softmax along axis, only computing the probabilities of the
+// top k elements.
+template <typename T, class Context>
+class SoftmaxTopKOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+
+  SoftmaxTopKOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        OP_SINGLE_ARG(int, "k", k_, -1),
+        OP_SINGLE_ARG(int, "axis", axis_, -1),
+        OP_SINGLE_ARG(int, "num_threads", num_threads_, 0) {
+    CAFFE_ENFORCE(k_ >= 1, "k argument must be >= 1");
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
+
+  bool RunOnDevice() override;
+
+ private:
+  Workspace* ws_;
+  const int k_;
+  const int axis_;
+  const int num_threads_;
 };
 
 template <typename T, class Context>
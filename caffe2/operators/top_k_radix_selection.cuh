@@ -343,25 +343,16 @@ __device__ void radixSelect(const DataType* data,
   *topK = TopKTypeConfig<DataType>::deconvert(desired);
 }
 
+// Writes the top-k of the slice handled by the block, with the position of
+// every element in the slice plus sliceIndexOffset as its index
 template <typename T, bool Order, typename IndicesType>
-__global__ void gatherTopK(const T* inputPtr,
-                           int inputSliceSize,
-                           int outputSliceSize, // aka `k`
-                           int numInputSlices,
-                           T* topKPtr,
-                           IndicesType* indicesPtr) {
-  __shared__ int smem[32]; // one per each warp, up to warp limit
-
-  int slice = blockIdx.x;
-  if (slice >= numInputSlices) {
-    return;
-  }
-
-  // Find the start offset for our slice
-  const T* inputSliceStart = &inputPtr[slice * inputSliceSize];
-  T* topKSliceStart = &topKPtr[slice * outputSliceSize];
-  caffe2::TIndex* indicesSliceStart = &indicesPtr[slice * outputSliceSize];
-
+__device__ void gatherSliceTopK(const T* inputSliceStart,
+                                int inputSliceSize,
+                                int outputSliceSize, // aka `k`
+                                int* smem,
+                                T* topKSliceStart,
+                                IndicesType* indicesSliceStart,
+                                IndicesType sliceIndexOffset) {
   // Find the k-th highest element in our input
   T topKValue = (T)0;
   radixSelect<T, typename TopKTypeConfig<T>::RadixType, Order>(
@@ -408,7 +399,7 @@ __global__ void gatherTopK(const T* inputPtr,
       int indexOffset = writeIndex;
 
       topKSliceStart[topKOffset] = v;
-      indicesSliceStart[indexOffset] = i;
+      indicesSliceStart[indexOffset] = i + sliceIndexOffset;
     }
 
     writeIndexStart += carry;
@@ -439,7 +430,7 @@ __global__ void gatherTopK(const T* inputPtr,
       int indexOffset = writeIndex;
 
       topKSliceStart[topKOffset] = v;
-      indicesSliceStart[indexOffset] = i;
+      indicesSliceStart[indexOffset] = i + sliceIndexOffset;
     }
 
     if (carry >= topKRemaining) {
@@ -451,6 +442,62 @@ __global__ void gatherTopK(const T* inputPtr,
   }
 }
 
+template <typename T, bool Order, typename IndicesType>
+__global__ void gatherTopK(const T* inputPtr,
+                           int inputSliceSize,
+                           int outputSliceSize, // aka `k`
+                           int numInputSlices,
+                           T* topKPtr,
+                           IndicesType* indicesPtr) {
+  __shared__ int smem[32]; // one per each warp, up to warp limit
+
+  int slice = blockIdx.x;
+  if (slice >= numInputSlices) {
+    return;
+  }
+
+  // Find the start offset for our slice
+  gatherSliceTopK<T, Order, IndicesType>(
+    &inputPtr[slice * inputSliceSize], inputSliceSize, outputSliceSize, smem,
+    &topKPtr[slice * outputSliceSize], &indicesPtr[slice * outputSliceSize],
+    0);
+}
+
+// Top-k of every chunk of every slice, for slices too long for one block.
+// Every slice is split in numChunksPerSlice chunks of chunkSize elements,
+// the last one also taking the remainder, and the top-k of the chunk handled
+// by each block is written with indices into the slice. chunkSize must be
+// at least `k`.
+template <typename T, bool Order, typename IndicesType>
+__global__ void gatherChunkTopK(const T* inputPtr,
+                                int inputSliceSize,
+                                int chunkSize,
+                                int numChunksPerSlice,
+                                int outputSliceSize, // aka `k`
+                                int numInputSlices,
+                                T* topKPtr,
+                                IndicesType* indicesPtr) {
+  __shared__ int smem[32]; // one per each warp, up to warp limit
+
+  int slice = blockIdx.x / numChunksPerSlice;
+  int chunk = blockIdx.x % numChunksPerSlice;
+  if (slice >= numInputSlices) {
+    return;
+  }
+
+  int chunkStart = chunk * chunkSize;
+  int chunkLength = (chunk == numChunksPerSlice - 1)
+    ? inputSliceSize - chunkStart : chunkSize;
+  gatherSliceTopK<T, Order, IndicesType>(
+    &inputPtr[static_cast<caffe2::TIndex>(slice) * inputSliceSize +
+              chunkStart],
+    chunkLength,
+    outputSliceSize, smem,
+    &topKPtr[static_cast<caffe2::TIndex>(blockIdx.x) * outputSliceSize],
+    &indicesPtr[static_cast<caffe2::TIndex>(blockIdx.x) * outputSliceSize],
+    chunkStart);
+}
+
 #undef RADIX_BITS
 #undef RADIX_SIZE
 #undef RADIX_MASK
@@ -17,6 +17,7 @@ REGISTER_MKL_OPERATOR(Transpose, mkl::MKLFallbackOp<TransposeOp<CPUContext>>);
 OPERATOR_SCHEMA(Transpose)
     .NumInputs(1)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .TensorInferenceFunction([](
         const OperatorDef& def,
         const vector<TensorShape>& in) {
@@ -58,6 +59,10 @@ will be (2, 1, 3).
         "axes",
         "A list of integers. By default, reverse the dimensions, "
         "otherwise permute the axes according to the values given.")
+    .Arg(
+        "num_threads",
+        "Threads of the workspace thread pool large outputs are split "
+        "between on CPU: 0 (default) for all, 1 for the calling thread.")
     .Input(0, "data", "An input tensor.")
     .Output(0, "transposed", "Transposed output.")
     .InheritOnnxSchema("Transpose");
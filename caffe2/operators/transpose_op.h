@@ -4,6 +4,7 @@
 
 #include "caffe2/core/context.h"
 #include "caffe2/core/operator.h"
+#include "caffe2/operators/conv_op_shared.h"
 #include "caffe2/utils/math.h"
 
 namespace caffe2 {
@@ -24,6 +25,8 @@ class TransposeOp final : public Operator<Context> {
         CAFFE_THROW("Axes should be a permutation of 0 to ndim.");
       }
     }
+    useMathThreadPool<Context>(
+        ws, OperatorBase::GetSingleArgument<int>("num_threads", 0), &context_);
   }
   ~TransposeOp() {}
 
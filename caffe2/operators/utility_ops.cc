@@ -144,6 +144,7 @@ Flattens the input tensor into a 1D vector.
 OPERATOR_SCHEMA(Alias)
     .NumInputs(1)
     .NumOutputs(1)
+    .CheapToRun()
     .IdenticalTypeAndShape()
     .SetDoc(R"DOC(
 Makes the output and the input share the same underlying storage.
@@ -288,6 +289,7 @@ Currently only works on CPU because of access to INDICES.
 OPERATOR_SCHEMA(Copy)
     .NumInputs(1)
     .NumOutputs(1)
+    .AcceptsTensorViews()
     .IdenticalTypeAndShape()
     .InputsCanCrossDevices()
     .SetDoc("Copy input tensor into output, potentially across devices.")
@@ -671,11 +671,20 @@ template <class Context, class DstContext, class SrcContext>
 class CopyOp : public Operator<Context> {
  public:
   USE_OPERATOR_CONTEXT_FUNCTIONS;
-  USE_SIMPLE_CTOR_DTOR(CopyOp);
+  CopyOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        OP_SINGLE_ARG(bool, "move_input", move_input_, false) {}
 
   bool RunOnDevice() override {
     auto& input = OperatorBase::Input<Tensor<SrcContext>>(0);
     auto* output = OperatorBase::Output<Tensor<DstContext>>(0);
+    // The input isn't used after this operator, see MoveLastUses(). Tensors
+    // sharing their storage, e.g. views, are still copied so that writing the
+    // output doesn't write to the tensors they share it with.
+    if (move_input_ && !input.shares_data() &&
+        Move(const_cast<Tensor<SrcContext>*>(&input), output)) {
+      return true;
+    }
     output->ResizeLike(input);
     this->context_.template CopyItems<SrcContext, DstContext>(
         input.meta(),
@@ -684,6 +693,20 @@ class CopyOp : public Operator<Context> {
         output->raw_mutable_data(input.meta()));
     return true;
   }
+
+ private:
+  // Gives the input the previous buffer of the output. Only CPU tensors are
+  // moved, copies across devices are kept.
+  static bool Move(TensorCPU* input, TensorCPU* output) {
+    output->swap(*input);
+    return true;
+  }
+  template <class Src, class Dst>
+  static bool Move(Tensor<Src>* /* unused */, Tensor<Dst>* /* unused */) {
+    return false;
+  }
+
+  bool move_input_;
 };
 
 template <class Context, class DstContext, class SrcContext>
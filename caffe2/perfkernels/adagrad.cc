@@ -0,0 +1,524 @@
+#include "caffe2/perfkernels/adagrad.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
+#include "caffe2/perfkernels/stochastic_rounding.h"
+#include "caffe2/utils/conversions.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation does the same scalar updates as SparseAdagrad
+template <typename IndexType>
+static void SparseLengthsSumSparseAdagradGenericSlow(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  TIndex current = 0;
+  for (TIndex m = 0; m < output_size; ++m) {
+    CAFFE_ENFORCE_LE(
+        current + lengths[m],
+        index_size,
+        "The sum of lengths is larger than the size of the indices tensor");
+    const float* g = grad + m * block_size;
+    for (int i = 0; i < lengths[m]; ++i, ++current) {
+      const TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+#ifdef __GNUC__
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        const TIndex next = indices[current + prefetch_distance];
+        if (0 <= next && next < data_size) {
+          __builtin_prefetch(param_out + next * block_size, 1, 1);
+          __builtin_prefetch(moment_out + next * block_size, 1, 1);
+        }
+      }
+#endif // __GNUC__
+      const TIndex offset = idx * block_size;
+      for (TIndex k = 0; k < block_size; ++k) {
+        const float gk = g[k];
+        const float hk = moment_out[offset + k] = moment[offset + k] + gk * gk;
+        param_out[offset + k] =
+            param[offset + k] + lr * gk / (std::sqrt(hk) + epsilon);
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+template <typename IndexType>
+static void SparseLengthsSumRowWiseSparseAdagradGenericSlow(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  TIndex current = 0;
+  for (TIndex m = 0; m < output_size; ++m) {
+    CAFFE_ENFORCE_LE(
+        current + lengths[m],
+        index_size,
+        "The sum of lengths is larger than the size of the indices tensor");
+    const float* g = grad + m * block_size;
+    // Every row of the segment gets the same gradient, and so the same
+    // moment increment
+    float hs = 0.f;
+    for (TIndex k = 0; k < block_size; ++k) {
+      hs += g[k] * g[k];
+    }
+    hs /= block_size;
+    for (int i = 0; i < lengths[m]; ++i, ++current) {
+      const TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+#ifdef __GNUC__
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        const TIndex next = indices[current + prefetch_distance];
+        if (0 <= next && next < data_size) {
+          __builtin_prefetch(param_out + next * block_size, 1, 1);
+        }
+      }
+#endif // __GNUC__
+      const float hi = moment_out[idx] = moment[idx] + hs;
+      const float step = lr / (std::sqrt(hi) + epsilon);
+      const TIndex offset = idx * block_size;
+      for (TIndex k = 0; k < block_size; ++k) {
+        param_out[offset + k] = param[offset + k] + g[k] * step;
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+template <typename IndexType>
+static void RowWiseSparseAdagradGenericSlow(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        __builtin_prefetch(param_out + next * block_size, 1, 1);
+        __builtin_prefetch(moment_out + next, 1, 1);
+      }
+    }
+#endif // __GNUC__
+    const float* g = grad + i * block_size;
+    float hs = 0.f;
+    for (TIndex k = 0; k < block_size; ++k) {
+      hs += g[k] * g[k];
+    }
+    const float hi = moment_out[idx] = moment[idx] + hs / block_size;
+    const float step = lr / (std::sqrt(hi) + epsilon);
+    const TIndex offset = idx * block_size;
+    for (TIndex k = 0; k < block_size; ++k) {
+      param_out[offset + k] = param[offset + k] + g[k] * step;
+    }
+  }
+}
+
+template <typename IndexType>
+static void SparseAdagradFloat16GenericSlow(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float16* param,
+    const float16* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const uint32_t seed,
+    const int prefetch_distance,
+    float16* param_out,
+    float16* moment_out) {
+  // xorshift32 never leaves the all zero state
+  uint32_t state = seed ? seed : 0x9e3779b9;
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        __builtin_prefetch(param_out + next * block_size, 1, 1);
+        __builtin_prefetch(moment_out + next * block_size, 1, 1);
+      }
+    }
+#endif // __GNUC__
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex k = 0; k < block_size; ++k) {
+      const float gk = g[k];
+      const float hk = convert::cpu_half2float(moment[offset + k]) + gk * gk;
+      const float wk = convert::cpu_half2float(param[offset + k]) +
+          lr * gk / (std::sqrt(hk) + epsilon);
+      moment_out[offset + k] =
+          StochasticRoundToFloat16(hk, NextRandom(&state));
+      param_out[offset + k] = StochasticRoundToFloat16(wk, NextRandom(&state));
+    }
+  }
+}
+
+// Proxy back to generic implementation
+#define SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION(Name, IndexType)           \
+  void Name##_##IndexType##__base(                                           \
+      const TIndex block_size,                                               \
+      const TIndex output_size,                                              \
+      const TIndex index_size,                                               \
+      const TIndex data_size,                                                \
+      const float* param,                                                    \
+      const float* moment,                                                   \
+      const IndexType* indices,                                              \
+      const int* lengths,                                                    \
+      const float* grad,                                                     \
+      const float lr,                                                        \
+      const float epsilon,                                                   \
+      const int prefetch_distance,                                           \
+      float* param_out,                                                      \
+      float* moment_out) {                                                   \
+    Name##GenericSlow<IndexType>(                                            \
+        block_size,                                                          \
+        output_size,                                                         \
+        index_size,                                                          \
+        data_size,                                                           \
+        param,                                                               \
+        moment,                                                              \
+        indices,                                                             \
+        lengths,                                                             \
+        grad,                                                                \
+        lr,                                                                  \
+        epsilon,                                                             \
+        prefetch_distance,                                                   \
+        param_out,                                                           \
+        moment_out);                                                         \
+  }                                                                          \
+  template <>                                                                \
+  void Name<IndexType>(                                                      \
+      const TIndex block_size,                                               \
+      const TIndex output_size,                                              \
+      const TIndex index_size,                                               \
+      const TIndex data_size,                                                \
+      const float* param,                                                    \
+      const float* moment,                                                   \
+      const IndexType* indices,                                              \
+      const int* lengths,                                                    \
+      const float* grad,                                                     \
+      const float lr,                                                        \
+      const float epsilon,                                                   \
+      float* param_out,                                                      \
+      float* moment_out) {                                                   \
+    PrefetchDistance prefetch(#Name "_" #IndexType, block_size, index_size); \
+    AVX512_DO(                                                               \
+        Name##_##IndexType,                                                  \
+        block_size,                                                          \
+        output_size,                                                         \
+        index_size,                                                          \
+        data_size,                                                           \
+        param,                                                               \
+        moment,                                                              \
+        indices,                                                             \
+        lengths,                                                             \
+        grad,                                                                \
+        lr,                                                                  \
+        epsilon,                                                             \
+        prefetch.distance(),                                                 \
+        param_out,                                                           \
+        moment_out);                                                         \
+    AVX2_FMA_DO(                                                             \
+        Name##_##IndexType,                                                  \
+        block_size,                                                          \
+        output_size,                                                         \
+        index_size,                                                          \
+        data_size,                                                           \
+        param,                                                               \
+        moment,                                                              \
+        indices,                                                             \
+        lengths,                                                             \
+        grad,                                                                \
+        lr,                                                                  \
+        epsilon,                                                             \
+        prefetch.distance(),                                                 \
+        param_out,                                                           \
+        moment_out);                                                         \
+    BASE_DO(                                                                 \
+        Name##_##IndexType,                                                  \
+        block_size,                                                          \
+        output_size,                                                         \
+        index_size,                                                          \
+        data_size,                                                           \
+        param,                                                               \
+        moment,                                                              \
+        indices,                                                             \
+        lengths,                                                             \
+        grad,                                                                \
+        lr,                                                                  \
+        epsilon,                                                             \
+        prefetch.distance(),                                                 \
+        param_out,                                                           \
+        moment_out);                                                         \
+  }
+
+SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION(
+    SparseLengthsSumSparseAdagrad,
+    int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION(
+    SparseLengthsSumSparseAdagrad,
+    int64_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    int64_t);
+
+#undef SPARSE_LENGTHS_SUM_ADAGRAD_SPECIALIZATION
+
+#define ROW_WISE_SPARSE_ADAGRAD_SPECIALIZATION(IndexType)            \
+  void RowWiseSparseAdagrad_##IndexType##__base(                     \
+      const TIndex block_size,                                       \
+      const TIndex index_size,                                       \
+      const TIndex data_size,                                        \
+      const float* param,                                            \
+      const float* moment,                                           \
+      const IndexType* indices,                                      \
+      const float* grad,                                             \
+      const float lr,                                                \
+      const float epsilon,                                           \
+      const int prefetch_distance,                                   \
+      float* param_out,                                              \
+      float* moment_out) {                                           \
+    RowWiseSparseAdagradGenericSlow<IndexType>(                      \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        prefetch_distance,                                           \
+        param_out,                                                   \
+        moment_out);                                                 \
+  }                                                                  \
+  template <>                                                        \
+  void RowWiseSparseAdagrad<IndexType>(                              \
+      const TIndex block_size,                                       \
+      const TIndex index_size,                                       \
+      const TIndex data_size,                                        \
+      const float* param,                                            \
+      const float* moment,                                           \
+      const IndexType* indices,                                      \
+      const float* grad,                                             \
+      const float lr,                                                \
+      const float epsilon,                                           \
+      float* param_out,                                              \
+      float* moment_out) {                                           \
+    PrefetchDistance prefetch(                                       \
+        "RowWiseSparseAdagrad_" #IndexType, block_size, index_size); \
+    AVX512_DO(                                                       \
+        RowWiseSparseAdagrad_##IndexType,                            \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        prefetch.distance(),                                         \
+        param_out,                                                   \
+        moment_out);                                                 \
+    AVX2_FMA_DO(                                                     \
+        RowWiseSparseAdagrad_##IndexType,                            \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        prefetch.distance(),                                         \
+        param_out,                                                   \
+        moment_out);                                                 \
+    BASE_DO(                                                         \
+        RowWiseSparseAdagrad_##IndexType,                            \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        prefetch.distance(),                                         \
+        param_out,                                                   \
+        moment_out);                                                 \
+  }
+
+ROW_WISE_SPARSE_ADAGRAD_SPECIALIZATION(int32_t);
+ROW_WISE_SPARSE_ADAGRAD_SPECIALIZATION(int64_t);
+
+#undef ROW_WISE_SPARSE_ADAGRAD_SPECIALIZATION
+
+#define SPARSE_ADAGRAD_FLOAT16_SPECIALIZATION(IndexType)             \
+  void SparseAdagradFloat16_##IndexType##__base(                     \
+      const TIndex block_size,                                       \
+      const TIndex index_size,                                       \
+      const TIndex data_size,                                        \
+      const float16* param,                                          \
+      const float16* moment,                                         \
+      const IndexType* indices,                                      \
+      const float* grad,                                             \
+      const float lr,                                                \
+      const float epsilon,                                           \
+      const uint32_t seed,                                           \
+      const int prefetch_distance,                                   \
+      float16* param_out,                                            \
+      float16* moment_out) {                                         \
+    SparseAdagradFloat16GenericSlow<IndexType>(                      \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        seed,                                                        \
+        prefetch_distance,                                           \
+        param_out,                                                   \
+        moment_out);                                                 \
+  }                                                                  \
+  template <>                                                        \
+  void SparseAdagradFloat16<IndexType>(                              \
+      const TIndex block_size,                                       \
+      const TIndex index_size,                                       \
+      const TIndex data_size,                                        \
+      const float16* param,                                          \
+      const float16* moment,                                         \
+      const IndexType* indices,                                      \
+      const float* grad,                                             \
+      const float lr,                                                \
+      const float epsilon,                                           \
+      const uint32_t seed,                                           \
+      float16* param_out,                                            \
+      float16* moment_out) {                                         \
+    PrefetchDistance prefetch(                                       \
+        "SparseAdagradFloat16_" #IndexType, block_size, index_size); \
+    AVX2_FMA_DO(                                                     \
+        SparseAdagradFloat16_##IndexType,                            \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        seed,                                                        \
+        prefetch.distance(),                                         \
+        param_out,                                                   \
+        moment_out);                                                 \
+    BASE_DO(                                                         \
+        SparseAdagradFloat16_##IndexType,                            \
+        block_size,                                                  \
+        index_size,                                                  \
+        data_size,                                                   \
+        param,                                                       \
+        moment,                                                      \
+        indices,                                                     \
+        grad,                                                        \
+        lr,                                                          \
+        epsilon,                                                     \
+        seed,                                                        \
+        prefetch.distance(),                                         \
+        param_out,                                                   \
+        moment_out);                                                 \
+  }
+
+SPARSE_ADAGRAD_FLOAT16_SPECIALIZATION(int32_t);
+SPARSE_ADAGRAD_FLOAT16_SPECIALIZATION(int64_t);
+
+#undef SPARSE_ADAGRAD_FLOAT16_SPECIALIZATION
+
+} // namespace caffe2
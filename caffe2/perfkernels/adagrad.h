@@ -0,0 +1,148 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+/**
+ * SparseLengthsSumGradient fused with the SparseAdagrad update.
+ *
+ * `grad` of size output_size * block_size is the gradient of the output of a
+ * SparseLengthsSum over `indices` (of size index_size) and `lengths` (of size
+ * output_size). Every looked up row gets the gradient of its segment, without
+ * materializing the index_size * block_size gradient.
+ * `param`, `moment`, `param_out` and `moment_out` of size
+ * data_size * block_size; the outputs can alias the inputs.
+ *
+ * Behavior is equivalent to pseudocode:
+ *
+ * pos = 0
+ * for (m = 0..output_size-1)
+ *   for (j = 0..lengths[m]-1)
+ *     idx = indices[pos++]
+ *     for (k = 0..block_size-1)
+ *       g = grad[m*block_size + k]
+ *       moment_out[idx*block_size + k] = moment[idx*block_size + k] + g * g
+ *       param_out[idx*block_size + k] = param[idx*block_size + k] +
+ *           lr * g / (sqrt(moment_out[idx*block_size + k]) + epsilon)
+ *
+ * The distance at which rows are prefetched is picked by PrefetchDistance,
+ * see prefetch_tuner.h.
+ */
+template <typename IndexType>
+void SparseLengthsSumSparseAdagrad(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    float* param_out,
+    float* moment_out);
+
+/**
+ * Same as SparseLengthsSumSparseAdagrad with the RowWiseSparseAdagrad update:
+ * `moment` and `moment_out` have data_size elements, one per row.
+ *
+ * pos = 0
+ * for (m = 0..output_size-1)
+ *   hs = mean(grad[m*block_size + k] ^ 2 for k = 0..block_size-1)
+ *   for (j = 0..lengths[m]-1)
+ *     idx = indices[pos++]
+ *     moment_out[idx] = moment[idx] + hs
+ *     step = lr / (sqrt(moment_out[idx]) + epsilon)
+ *     for (k = 0..block_size-1)
+ *       param_out[idx*block_size + k] =
+ *           param[idx*block_size + k] + grad[m*block_size + k] * step
+ */
+template <typename IndexType>
+void SparseLengthsSumRowWiseSparseAdagrad(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    float* param_out,
+    float* moment_out);
+
+/**
+ * The RowWiseSparseAdagrad update: the i-th row of `grad` (of size
+ * index_size * block_size) is the gradient of row indices[i] of `param`.
+ * `moment` and `moment_out` have data_size elements, one per row.
+ *
+ * for (i = 0..index_size-1)
+ *   idx = indices[i]
+ *   moment_out[idx] = moment[idx] +
+ *       mean(grad[i*block_size + k] ^ 2 for k = 0..block_size-1)
+ *   step = lr / (sqrt(moment_out[idx]) + epsilon)
+ *   for (k = 0..block_size-1)
+ *     param_out[idx*block_size + k] =
+ *         param[idx*block_size + k] + grad[i*block_size + k] * step
+ *
+ * The vectorized implementations sum the squares in a fixed order per
+ * instruction set, so the results are deterministic for a given machine but
+ * can differ from the base implementation in the last bits.
+ */
+template <typename IndexType>
+void RowWiseSparseAdagrad(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    float* param_out,
+    float* moment_out);
+
+/**
+ * The SparseAdagrad update of float16 parameters and moments: the i-th row of
+ * `grad` (of size index_size * block_size) is the gradient of row indices[i]
+ * of `param`. The update is computed in float and written back with
+ * stochastic rounding, so that updates smaller than the float16 resolution
+ * are not systematically lost: a value is rounded up with a probability
+ * proportional to its distance to the float16 value below it. The random
+ * bits are generated from `seed`.
+ *
+ * for (i = 0..index_size-1)
+ *   idx = indices[i]
+ *   for (k = 0..block_size-1)
+ *     g = grad[i*block_size + k]
+ *     h = float(moment[idx*block_size + k]) + g * g
+ *     moment_out[idx*block_size + k] = stochastic_round(h)
+ *     param_out[idx*block_size + k] = stochastic_round(
+ *         float(param[idx*block_size + k]) + lr * g / (sqrt(h) + epsilon))
+ *
+ * The rounding is exact in distribution for results in the normal float16
+ * range; results below it are biased towards zero.
+ */
+template <typename IndexType>
+void SparseAdagradFloat16(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float16* param,
+    const float16* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const uint32_t seed,
+    float16* param_out,
+    float16* moment_out);
+
+} // namespace caffe2
@@ -0,0 +1,430 @@
+#include <cmath>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/stochastic_rounding_avx2.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const float* row, const TIndex block_size) {
+  for (TIndex k = 0; k < block_size; k += 16) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+// The squares are accumulated in 8 lanes, which are then summed pairwise,
+// followed by the scalar tail.
+inline float SquaredNorm(const float* g, const TIndex block_size) {
+  __m256 vsum = _mm256_setzero_ps();
+  TIndex k = 0;
+  for (; k + 8 <= block_size; k += 8) {
+    const __m256 vg = _mm256_loadu_ps(g + k);
+    vsum = _mm256_fmadd_ps(vg, vg, vsum);
+  }
+  __m128 vsum4 = _mm_add_ps(
+      _mm256_castps256_ps128(vsum), _mm256_extractf128_ps(vsum, 1));
+  vsum4 = _mm_add_ps(vsum4, _mm_movehl_ps(vsum4, vsum4));
+  vsum4 = _mm_add_ss(vsum4, _mm_shuffle_ps(vsum4, vsum4, 1));
+  float sum = _mm_cvtss_f32(vsum4);
+  for (; k < block_size; ++k) {
+    sum += g[k] * g[k];
+  }
+  return sum;
+}
+
+// The updates below use separate multiplies and adds, so that the results are
+// the same as the ones of the scalar SparseAdagrad / RowWiseSparseAdagrad.
+inline void RowWiseAdagradRow(
+    const TIndex block_size,
+    const float* w,
+    const float* g,
+    const float step,
+    float* nw) {
+  const __m256 vstep = _mm256_set1_ps(step);
+  TIndex k = 0;
+  for (; k + 8 <= block_size; k += 8) {
+    _mm256_storeu_ps(
+        nw + k,
+        _mm256_add_ps(
+            _mm256_loadu_ps(w + k),
+            _mm256_mul_ps(_mm256_loadu_ps(g + k), vstep)));
+  }
+  for (; k < block_size; ++k) {
+    nw[k] = w[k] + g[k] * step;
+  }
+}
+
+inline void AdagradRow(
+    const TIndex block_size,
+    const float* w,
+    const float* g,
+    const float* h,
+    const float lr,
+    const float epsilon,
+    float* nw,
+    float* nh) {
+  const __m256 vlr = _mm256_set1_ps(lr);
+  const __m256 veps = _mm256_set1_ps(epsilon);
+  TIndex k = 0;
+  for (; k + 8 <= block_size; k += 8) {
+    const __m256 vg = _mm256_loadu_ps(g + k);
+    const __m256 vh =
+        _mm256_add_ps(_mm256_loadu_ps(h + k), _mm256_mul_ps(vg, vg));
+    _mm256_storeu_ps(nh + k, vh);
+    _mm256_storeu_ps(
+        nw + k,
+        _mm256_add_ps(
+            _mm256_loadu_ps(w + k),
+            _mm256_div_ps(
+                _mm256_mul_ps(vlr, vg),
+                _mm256_add_ps(_mm256_sqrt_ps(vh), veps))));
+  }
+  for (; k < block_size; ++k) {
+    const float gk = g[k];
+    const float hk = nh[k] = h[k] + gk * gk;
+    nw[k] = w[k] + lr * gk / (std::sqrt(hk) + epsilon);
+  }
+}
+
+inline void AdagradFloat16Block(
+    const __m256 vg,
+    const float16* w,
+    const float16* h,
+    const __m256 vlr,
+    const __m256 veps,
+    __m256i* state,
+    __m128i* nw,
+    __m128i* nh) {
+  const __m256 vh = _mm256_add_ps(
+      _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(h))),
+      _mm256_mul_ps(vg, vg));
+  const __m256 vw = _mm256_add_ps(
+      _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w))),
+      _mm256_div_ps(
+          _mm256_mul_ps(vlr, vg), _mm256_add_ps(_mm256_sqrt_ps(vh), veps)));
+  *nh = StochasticRoundToFloat16(vh, state);
+  *nw = StochasticRoundToFloat16(vw, state);
+}
+
+template <bool ROWWISE, typename IndexType>
+void SparseLengthsSumSparseAdagradKernel(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  TIndex current = 0;
+  for (TIndex m = 0; m < output_size; ++m) {
+    CAFFE_ENFORCE_LE(
+        current + lengths[m],
+        index_size,
+        "The sum of lengths is larger than the size of the indices tensor");
+    const float* g = grad + m * block_size;
+    const float hs = ROWWISE ? SquaredNorm(g, block_size) / block_size : 0.f;
+    for (int i = 0; i < lengths[m]; ++i, ++current) {
+      const TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        const TIndex next = indices[current + prefetch_distance];
+        if (0 <= next && next < data_size) {
+          PrefetchRow(param + next * block_size, block_size);
+          if (!ROWWISE) {
+            PrefetchRow(moment + next * block_size, block_size);
+          }
+        }
+      }
+
+      const TIndex offset = idx * block_size;
+      if (ROWWISE) {
+        const float hi = moment_out[idx] = moment[idx] + hs;
+        const float step = lr / (std::sqrt(hi) + epsilon);
+        RowWiseAdagradRow(
+            block_size, param + offset, g, step, param_out + offset);
+      } else {
+        AdagradRow(
+            block_size,
+            param + offset,
+            g,
+            moment + offset,
+            lr,
+            epsilon,
+            param_out + offset,
+            moment_out + offset);
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+template <typename IndexType>
+void RowWiseSparseAdagradKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        _mm_prefetch(
+            reinterpret_cast<const char*>(moment + next), _MM_HINT_T0);
+      }
+    }
+
+    const float* g = grad + i * block_size;
+    const float hi = moment_out[idx] =
+        moment[idx] + SquaredNorm(g, block_size) / block_size;
+    const float step = lr / (std::sqrt(hi) + epsilon);
+    const TIndex offset = idx * block_size;
+    RowWiseAdagradRow(block_size, param + offset, g, step, param_out + offset);
+  }
+}
+
+template <typename IndexType>
+void SparseAdagradFloat16Kernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float16* param,
+    const float16* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const uint32_t seed,
+    const int prefetch_distance,
+    float16* param_out,
+    float16* moment_out) {
+  const __m256 vlr = _mm256_set1_ps(lr);
+  const __m256 veps = _mm256_set1_ps(epsilon);
+  __m256i state = InitRandom(seed);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        for (TIndex k = 0; k < block_size; k += 32) {
+          _mm_prefetch(
+              reinterpret_cast<const char*>(param + next * block_size + k),
+              _MM_HINT_T0);
+          _mm_prefetch(
+              reinterpret_cast<const char*>(moment + next * block_size + k),
+              _MM_HINT_T0);
+        }
+      }
+    }
+
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex k = 0;
+    for (; k + 8 <= block_size; k += 8) {
+      __m128i nw, nh;
+      AdagradFloat16Block(
+          _mm256_loadu_ps(g + k),
+          param + offset + k,
+          moment + offset + k,
+          vlr,
+          veps,
+          &state,
+          &nw,
+          &nh);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(param_out + offset + k), nw);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(moment_out + offset + k), nh);
+    }
+    if (k < block_size) {
+      // The tail goes through zero padded blocks
+      const TIndex tail = block_size - k;
+      float g_tail[8] = {0};
+      float16 w_tail[8] = {}, h_tail[8] = {};
+      memcpy(g_tail, g + k, tail * sizeof(float));
+      memcpy(w_tail, param + offset + k, tail * sizeof(float16));
+      memcpy(h_tail, moment + offset + k, tail * sizeof(float16));
+      __m128i nw, nh;
+      AdagradFloat16Block(
+          _mm256_loadu_ps(g_tail),
+          w_tail,
+          h_tail,
+          vlr,
+          veps,
+          &state,
+          &nw,
+          &nh);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(w_tail), nw);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(h_tail), nh);
+      memcpy(param_out + offset + k, w_tail, tail * sizeof(float16));
+      memcpy(moment_out + offset + k, h_tail, tail * sizeof(float16));
+    }
+  }
+}
+
+} // namespace
+
+#define SPARSE_LENGTHS_SUM_ADAGRAD_AVX2(Name, ROWWISE, IndexType) \
+  void Name##_##IndexType##__avx2_fma(                            \
+      const TIndex block_size,                                    \
+      const TIndex output_size,                                   \
+      const TIndex index_size,                                    \
+      const TIndex data_size,                                     \
+      const float* param,                                         \
+      const float* moment,                                        \
+      const IndexType* indices,                                   \
+      const int* lengths,                                         \
+      const float* grad,                                          \
+      const float lr,                                             \
+      const float epsilon,                                        \
+      const int prefetch_distance,                                \
+      float* param_out,                                           \
+      float* moment_out) {                                        \
+    SparseLengthsSumSparseAdagradKernel<ROWWISE>(                 \
+        block_size,                                               \
+        output_size,                                              \
+        index_size,                                               \
+        data_size,                                                \
+        param,                                                    \
+        moment,                                                   \
+        indices,                                                  \
+        lengths,                                                  \
+        grad,                                                     \
+        lr,                                                       \
+        epsilon,                                                  \
+        prefetch_distance,                                        \
+        param_out,                                                \
+        moment_out);                                              \
+  }
+
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX2(SparseLengthsSumSparseAdagrad, false, int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX2(SparseLengthsSumSparseAdagrad, false, int64_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX2(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    true,
+    int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX2(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    true,
+    int64_t);
+
+#undef SPARSE_LENGTHS_SUM_ADAGRAD_AVX2
+
+#define ROW_WISE_SPARSE_ADAGRAD_AVX2(IndexType)      \
+  void RowWiseSparseAdagrad_##IndexType##__avx2_fma( \
+      const TIndex block_size,                       \
+      const TIndex index_size,                       \
+      const TIndex data_size,                        \
+      const float* param,                            \
+      const float* moment,                           \
+      const IndexType* indices,                      \
+      const float* grad,                             \
+      const float lr,                                \
+      const float epsilon,                           \
+      const int prefetch_distance,                   \
+      float* param_out,                              \
+      float* moment_out) {                           \
+    RowWiseSparseAdagradKernel(                      \
+        block_size,                                  \
+        index_size,                                  \
+        data_size,                                   \
+        param,                                       \
+        moment,                                      \
+        indices,                                     \
+        grad,                                        \
+        lr,                                          \
+        epsilon,                                     \
+        prefetch_distance,                           \
+        param_out,                                   \
+        moment_out);                                 \
+  }
+
+ROW_WISE_SPARSE_ADAGRAD_AVX2(int32_t);
+ROW_WISE_SPARSE_ADAGRAD_AVX2(int64_t);
+
+#undef ROW_WISE_SPARSE_ADAGRAD_AVX2
+
+#define SPARSE_ADAGRAD_FLOAT16_AVX2(IndexType)       \
+  void SparseAdagradFloat16_##IndexType##__avx2_fma( \
+      const TIndex block_size,                       \
+      const TIndex index_size,                       \
+      const TIndex data_size,                        \
+      const float16* param,                          \
+      const float16* moment,                         \
+      const IndexType* indices,                      \
+      const float* grad,                             \
+      const float lr,                                \
+      const float epsilon,                           \
+      const uint32_t seed,                           \
+      const int prefetch_distance,                   \
+      float16* param_out,                            \
+      float16* moment_out) {                         \
+    SparseAdagradFloat16Kernel(                      \
+        block_size,                                  \
+        index_size,                                  \
+        data_size,                                   \
+        param,                                       \
+        moment,                                      \
+        indices,                                     \
+        grad,                                        \
+        lr,                                          \
+        epsilon,                                     \
+        seed,                                        \
+        prefetch_distance,                           \
+        param_out,                                   \
+        moment_out);                                 \
+  }
+
+SPARSE_ADAGRAD_FLOAT16_AVX2(int32_t);
+SPARSE_ADAGRAD_FLOAT16_AVX2(int64_t);
+
+#undef SPARSE_ADAGRAD_FLOAT16_AVX2
+
+} // namespace caffe2
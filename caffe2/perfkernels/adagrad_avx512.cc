@@ -0,0 +1,310 @@
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const float* row, const TIndex block_size) {
+  for (TIndex k = 0; k < block_size; k += 16) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+inline __mmask16 TailMask(const TIndex block_size) {
+  return (1 << (block_size % 16)) - 1;
+}
+
+// The squares are accumulated in 16 lanes, the tail with a masked load, and
+// the lanes are then summed with a fixed reduction order.
+inline float SquaredNorm(const float* g, const TIndex block_size) {
+  __m512 vsum = _mm512_setzero_ps();
+  TIndex k = 0;
+  for (; k + 16 <= block_size; k += 16) {
+    const __m512 vg = _mm512_loadu_ps(g + k);
+    vsum = _mm512_fmadd_ps(vg, vg, vsum);
+  }
+  if (k < block_size) {
+    const __m512 vg = _mm512_maskz_loadu_ps(TailMask(block_size), g + k);
+    vsum = _mm512_fmadd_ps(vg, vg, vsum);
+  }
+  return _mm512_reduce_add_ps(vsum);
+}
+
+// The updates below use separate multiplies and adds, so that the results are
+// the same as the ones of the scalar SparseAdagrad / RowWiseSparseAdagrad. The
+// last block_size % 16 columns are handled with masked loads and stores.
+inline void RowWiseAdagradRow(
+    const TIndex block_size,
+    const float* w,
+    const float* g,
+    const float step,
+    float* nw) {
+  const __m512 vstep = _mm512_set1_ps(step);
+  TIndex k = 0;
+  for (; k + 16 <= block_size; k += 16) {
+    _mm512_storeu_ps(
+        nw + k,
+        _mm512_add_ps(
+            _mm512_loadu_ps(w + k),
+            _mm512_mul_ps(_mm512_loadu_ps(g + k), vstep)));
+  }
+  if (k < block_size) {
+    const __mmask16 mask = TailMask(block_size);
+    _mm512_mask_storeu_ps(
+        nw + k,
+        mask,
+        _mm512_add_ps(
+            _mm512_maskz_loadu_ps(mask, w + k),
+            _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, g + k), vstep)));
+  }
+}
+
+inline void AdagradRow(
+    const TIndex block_size,
+    const float* w,
+    const float* g,
+    const float* h,
+    const float lr,
+    const float epsilon,
+    float* nw,
+    float* nh) {
+  const __m512 vlr = _mm512_set1_ps(lr);
+  const __m512 veps = _mm512_set1_ps(epsilon);
+  TIndex k = 0;
+  for (; k + 16 <= block_size; k += 16) {
+    const __m512 vg = _mm512_loadu_ps(g + k);
+    const __m512 vh =
+        _mm512_add_ps(_mm512_loadu_ps(h + k), _mm512_mul_ps(vg, vg));
+    _mm512_storeu_ps(nh + k, vh);
+    _mm512_storeu_ps(
+        nw + k,
+        _mm512_add_ps(
+            _mm512_loadu_ps(w + k),
+            _mm512_div_ps(
+                _mm512_mul_ps(vlr, vg),
+                _mm512_add_ps(_mm512_sqrt_ps(vh), veps))));
+  }
+  if (k < block_size) {
+    const __mmask16 mask = TailMask(block_size);
+    const __m512 vg = _mm512_maskz_loadu_ps(mask, g + k);
+    const __m512 vh = _mm512_add_ps(
+        _mm512_maskz_loadu_ps(mask, h + k), _mm512_mul_ps(vg, vg));
+    _mm512_mask_storeu_ps(nh + k, mask, vh);
+    _mm512_mask_storeu_ps(
+        nw + k,
+        mask,
+        _mm512_add_ps(
+            _mm512_maskz_loadu_ps(mask, w + k),
+            _mm512_div_ps(
+                _mm512_mul_ps(vlr, vg),
+                _mm512_add_ps(_mm512_sqrt_ps(vh), veps))));
+  }
+}
+
+template <bool ROWWISE, typename IndexType>
+void SparseLengthsSumSparseAdagradKernel(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const int* lengths,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  TIndex current = 0;
+  for (TIndex m = 0; m < output_size; ++m) {
+    CAFFE_ENFORCE_LE(
+        current + lengths[m],
+        index_size,
+        "The sum of lengths is larger than the size of the indices tensor");
+    const float* g = grad + m * block_size;
+    const float hs = ROWWISE ? SquaredNorm(g, block_size) / block_size : 0.f;
+    for (int i = 0; i < lengths[m]; ++i, ++current) {
+      const TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        const TIndex next = indices[current + prefetch_distance];
+        if (0 <= next && next < data_size) {
+          PrefetchRow(param + next * block_size, block_size);
+          if (!ROWWISE) {
+            PrefetchRow(moment + next * block_size, block_size);
+          }
+        }
+      }
+
+      const TIndex offset = idx * block_size;
+      if (ROWWISE) {
+        const float hi = moment_out[idx] = moment[idx] + hs;
+        const float step = lr / (std::sqrt(hi) + epsilon);
+        RowWiseAdagradRow(
+            block_size, param + offset, g, step, param_out + offset);
+      } else {
+        AdagradRow(
+            block_size,
+            param + offset,
+            g,
+            moment + offset,
+            lr,
+            epsilon,
+            param_out + offset,
+            moment_out + offset);
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+template <typename IndexType>
+void RowWiseSparseAdagradKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float epsilon,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment_out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        _mm_prefetch(
+            reinterpret_cast<const char*>(moment + next), _MM_HINT_T0);
+      }
+    }
+
+    const float* g = grad + i * block_size;
+    const float hi = moment_out[idx] =
+        moment[idx] + SquaredNorm(g, block_size) / block_size;
+    const float step = lr / (std::sqrt(hi) + epsilon);
+    const TIndex offset = idx * block_size;
+    RowWiseAdagradRow(block_size, param + offset, g, step, param_out + offset);
+  }
+}
+
+} // namespace
+
+#define SPARSE_LENGTHS_SUM_ADAGRAD_AVX512(Name, ROWWISE, IndexType) \
+  void Name##_##IndexType##__avx512(                                \
+      const TIndex block_size,                                      \
+      const TIndex output_size,                                     \
+      const TIndex index_size,                                      \
+      const TIndex data_size,                                       \
+      const float* param,                                           \
+      const float* moment,                                          \
+      const IndexType* indices,                                     \
+      const int* lengths,                                           \
+      const float* grad,                                            \
+      const float lr,                                               \
+      const float epsilon,                                          \
+      const int prefetch_distance,                                  \
+      float* param_out,                                             \
+      float* moment_out) {                                          \
+    SparseLengthsSumSparseAdagradKernel<ROWWISE>(                   \
+        block_size,                                                 \
+        output_size,                                                \
+        index_size,                                                 \
+        data_size,                                                  \
+        param,                                                      \
+        moment,                                                     \
+        indices,                                                    \
+        lengths,                                                    \
+        grad,                                                       \
+        lr,                                                         \
+        epsilon,                                                    \
+        prefetch_distance,                                          \
+        param_out,                                                  \
+        moment_out);                                                \
+  }
+
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX512(
+    SparseLengthsSumSparseAdagrad,
+    false,
+    int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX512(
+    SparseLengthsSumSparseAdagrad,
+    false,
+    int64_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX512(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    true,
+    int32_t);
+SPARSE_LENGTHS_SUM_ADAGRAD_AVX512(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    true,
+    int64_t);
+
+#undef SPARSE_LENGTHS_SUM_ADAGRAD_AVX512
+
+#define ROW_WISE_SPARSE_ADAGRAD_AVX512(IndexType)  \
+  void RowWiseSparseAdagrad_##IndexType##__avx512( \
+      const TIndex block_size,                     \
+      const TIndex index_size,                     \
+      const TIndex data_size,                      \
+      const float* param,                          \
+      const float* moment,                         \
+      const IndexType* indices,                    \
+      const float* grad,                           \
+      const float lr,                              \
+      const float epsilon,                         \
+      const int prefetch_distance,                 \
+      float* param_out,                            \
+      float* moment_out) {                         \
+    RowWiseSparseAdagradKernel(                    \
+        block_size,                                \
+        index_size,                                \
+        data_size,                                 \
+        param,                                     \
+        moment,                                    \
+        indices,                                   \
+        grad,                                      \
+        lr,                                        \
+        epsilon,                                   \
+        prefetch_distance,                         \
+        param_out,                                 \
+        moment_out);                               \
+  }
+
+ROW_WISE_SPARSE_ADAGRAD_AVX512(int32_t);
+ROW_WISE_SPARSE_ADAGRAD_AVX512(int64_t);
+
+#undef ROW_WISE_SPARSE_ADAGRAD_AVX512
+
+} // namespace caffe2
@@ -0,0 +1,322 @@
+#include "caffe2/perfkernels/adam.h"
+
+#include <cmath>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
+#include "caffe2/perfkernels/stochastic_rounding.h"
+#include "caffe2/utils/conversions.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+static inline float LoadMoment(const float x) {
+  return x;
+}
+
+static inline float LoadMoment(const float16 x) {
+  return convert::cpu_half2float(x);
+}
+
+static inline float
+StoreMoment(const float x, uint32_t* /* state */, float* y) {
+  return *y = x;
+}
+
+static inline float StoreMoment(const float x, uint32_t* state, float16* y) {
+  *y = StochasticRoundToFloat16(x, NextRandom(state));
+  return x;
+}
+
+// Base implementation does the same scalar updates as SparseAdam
+template <typename IndexType, typename MomentType>
+static void SparseAdamGenericSlow(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const MomentType* moment1,
+    const MomentType* moment2,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float beta1,
+    const float beta2,
+    const float epsilon,
+    const float correction,
+    const int64_t iter,
+    int64_t* last_iter,
+    const uint32_t seed,
+    const int prefetch_distance,
+    float* param_out,
+    MomentType* moment1_out,
+    MomentType* moment2_out) {
+  const float lr_correction = lr * correction;
+  // xorshift32 never leaves the all zero state
+  uint32_t state = seed ? seed : 0x9e3779b9;
+  float b1 = beta1;
+  float b2 = beta2;
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        __builtin_prefetch(param_out + next * block_size, 1, 1);
+        __builtin_prefetch(moment1_out + next * block_size, 1, 1);
+        __builtin_prefetch(moment2_out + next * block_size, 1, 1);
+      }
+    }
+#endif // __GNUC__
+    if (last_iter) {
+      LazyAdamDecays(beta1, beta2, iter, last_iter + idx, &b1, &b2);
+    }
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex k = 0; k < block_size; ++k) {
+      const float gk = g[k];
+      const float mk = StoreMoment(
+          LoadMoment(moment1[offset + k]) * b1 + gk * (1 - beta1),
+          &state,
+          moment1_out + offset + k);
+      const float vk = StoreMoment(
+          LoadMoment(moment2[offset + k]) * b2 + gk * gk * (1 - beta2),
+          &state,
+          moment2_out + offset + k);
+      param_out[offset + k] =
+          param[offset + k] + lr_correction * mk / (std::sqrt(vk) + epsilon);
+    }
+  }
+}
+
+// Proxy back to generic implementation
+#define SPARSE_ADAM_BASE(Name, IndexType, MomentType)                   \
+  void Name##_##IndexType##__base(                                      \
+      const TIndex block_size,                                          \
+      const TIndex index_size,                                          \
+      const TIndex data_size,                                           \
+      const float* param,                                               \
+      const MomentType* moment1,                                        \
+      const MomentType* moment2,                                        \
+      const IndexType* indices,                                         \
+      const float* grad,                                                \
+      const float lr,                                                   \
+      const float beta1,                                                \
+      const float beta2,                                                \
+      const float epsilon,                                              \
+      const float correction,                                           \
+      const int64_t iter,                                               \
+      int64_t* last_iter,                                               \
+      const uint32_t seed,                                              \
+      const int prefetch_distance,                                      \
+      float* param_out,                                                 \
+      MomentType* moment1_out,                                          \
+      MomentType* moment2_out) {                                        \
+    SparseAdamGenericSlow<IndexType, MomentType>(                       \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        seed,                                                           \
+        prefetch_distance,                                              \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+  }
+
+#define SPARSE_ADAM_SPECIALIZATION(IndexType)                           \
+  SPARSE_ADAM_BASE(SparseAdam, IndexType, float)                        \
+  template <>                                                           \
+  void SparseAdam<IndexType>(                                           \
+      const TIndex block_size,                                          \
+      const TIndex index_size,                                          \
+      const TIndex data_size,                                           \
+      const float* param,                                               \
+      const float* moment1,                                             \
+      const float* moment2,                                             \
+      const IndexType* indices,                                         \
+      const float* grad,                                                \
+      const float lr,                                                   \
+      const float beta1,                                                \
+      const float beta2,                                                \
+      const float epsilon,                                              \
+      const float correction,                                           \
+      const int64_t iter,                                               \
+      int64_t* last_iter,                                               \
+      float* param_out,                                                 \
+      float* moment1_out,                                               \
+      float* moment2_out) {                                             \
+    PrefetchDistance prefetch(                                          \
+        "SparseAdam_" #IndexType, block_size, index_size);              \
+    AVX512_DO(                                                          \
+        SparseAdam_##IndexType,                                         \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        0,                                                              \
+        prefetch.distance(),                                            \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+    AVX2_FMA_DO(                                                        \
+        SparseAdam_##IndexType,                                         \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        0,                                                              \
+        prefetch.distance(),                                            \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+    BASE_DO(                                                            \
+        SparseAdam_##IndexType,                                         \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        0,                                                              \
+        prefetch.distance(),                                            \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+  }
+
+#define SPARSE_ADAM_FLOAT16_MOMENTS_SPECIALIZATION(IndexType)           \
+  SPARSE_ADAM_BASE(SparseAdamFloat16Moments, IndexType, float16)        \
+  template <>                                                           \
+  void SparseAdamFloat16Moments<IndexType>(                             \
+      const TIndex block_size,                                          \
+      const TIndex index_size,                                          \
+      const TIndex data_size,                                           \
+      const float* param,                                               \
+      const float16* moment1,                                           \
+      const float16* moment2,                                           \
+      const IndexType* indices,                                         \
+      const float* grad,                                                \
+      const float lr,                                                   \
+      const float beta1,                                                \
+      const float beta2,                                                \
+      const float epsilon,                                              \
+      const float correction,                                           \
+      const int64_t iter,                                               \
+      int64_t* last_iter,                                               \
+      const uint32_t seed,                                              \
+      float* param_out,                                                 \
+      float16* moment1_out,                                             \
+      float16* moment2_out) {                                           \
+    PrefetchDistance prefetch(                                          \
+        "SparseAdamFloat16Moments_" #IndexType,                         \
+        block_size,                                                     \
+        index_size);                                                    \
+    AVX2_FMA_DO(                                                        \
+        SparseAdamFloat16Moments_##IndexType,                           \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        seed,                                                           \
+        prefetch.distance(),                                            \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+    BASE_DO(                                                            \
+        SparseAdamFloat16Moments_##IndexType,                           \
+        block_size,                                                     \
+        index_size,                                                     \
+        data_size,                                                      \
+        param,                                                          \
+        moment1,                                                        \
+        moment2,                                                        \
+        indices,                                                        \
+        grad,                                                           \
+        lr,                                                             \
+        beta1,                                                          \
+        beta2,                                                          \
+        epsilon,                                                        \
+        correction,                                                     \
+        iter,                                                           \
+        last_iter,                                                      \
+        seed,                                                           \
+        prefetch.distance(),                                            \
+        param_out,                                                      \
+        moment1_out,                                                    \
+        moment2_out);                                                   \
+  }
+
+SPARSE_ADAM_SPECIALIZATION(int32_t);
+SPARSE_ADAM_SPECIALIZATION(int64_t);
+SPARSE_ADAM_FLOAT16_MOMENTS_SPECIALIZATION(int32_t);
+SPARSE_ADAM_FLOAT16_MOMENTS_SPECIALIZATION(int64_t);
+
+#undef SPARSE_ADAM_FLOAT16_MOMENTS_SPECIALIZATION
+#undef SPARSE_ADAM_SPECIALIZATION
+#undef SPARSE_ADAM_BASE
+
+} // namespace caffe2
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cmath>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+/**
+ * The SparseAdam update: the i-th row of `grad` (of size
+ * index_size * block_size) is the gradient of row indices[i] of `param`.
+ * `param`, `moment1`, `moment2` and the outputs of size
+ * data_size * block_size; the outputs can alias the inputs.
+ *
+ * Behavior is equivalent to pseudocode:
+ *
+ * for (i = 0..index_size-1)
+ *   idx = indices[i]
+ *   for (k = 0..block_size-1)
+ *     g = grad[i*block_size + k]
+ *     m = moment1_out[idx*block_size + k] =
+ *         moment1[idx*block_size + k] * beta1 + g * (1 - beta1)
+ *     v = moment2_out[idx*block_size + k] =
+ *         moment2[idx*block_size + k] * beta2 + g * g * (1 - beta2)
+ *     param_out[idx*block_size + k] = param[idx*block_size + k] +
+ *         lr * correction * m / (sqrt(v) + epsilon)
+ *
+ * If `last_iter` (of size data_size) is not null, the update is lazy: rows
+ * only decay their moments when they are touched, so last_iter[idx] keeps the
+ * iteration of the last update of row idx, and the moments of a row touched
+ * at `iter` are first decayed for the iterations it missed:
+ *
+ *   skipped = iter - last_iter[idx]
+ *   b1 = skipped > 1 ? beta1 ^ skipped : beta1
+ *   b2 = skipped > 1 ? beta2 ^ skipped : beta2
+ *   last_iter[idx] = iter
+ *
+ * and b1 and b2 replace beta1 and beta2 as the factors of the moments above.
+ * The parameter steps of the missed iterations are not applied.
+ *
+ * The distance at which rows are prefetched is picked by PrefetchDistance,
+ * see prefetch_tuner.h.
+ */
+template <typename IndexType>
+void SparseAdam(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float beta1,
+    const float beta2,
+    const float epsilon,
+    const float correction,
+    const int64_t iter,
+    int64_t* last_iter,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out);
+
+/**
+ * SparseAdam with float16 moments, which halves the optimizer state of big
+ * embedding tables. The update is computed in float and the moments are
+ * written back with stochastic rounding, as by SparseAdagradFloat16, from the
+ * random bits generated from `seed`. `param` stays in float.
+ */
+template <typename IndexType>
+void SparseAdamFloat16Moments(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float16* moment1,
+    const float16* moment2,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float beta1,
+    const float beta2,
+    const float epsilon,
+    const float correction,
+    const int64_t iter,
+    int64_t* last_iter,
+    const uint32_t seed,
+    float* param_out,
+    float16* moment1_out,
+    float16* moment2_out);
+
+// The moment decays b1 and b2 of a row of the lazy SparseAdam, see above
+inline void LazyAdamDecays(
+    const float beta1,
+    const float beta2,
+    const int64_t iter,
+    int64_t* last_iter,
+    float* b1,
+    float* b2) {
+  const int64_t skipped = iter - *last_iter;
+  if (skipped > 1) {
+    *b1 = std::pow(beta1, skipped);
+    *b2 = std::pow(beta2, skipped);
+  } else {
+    *b1 = beta1;
+    *b2 = beta2;
+  }
+  *last_iter = iter;
+}
+
+} // namespace caffe2
@@ -0,0 +1,238 @@
+#include <cmath>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/adam.h"
+#include "caffe2/perfkernels/stochastic_rounding_avx2.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <typename T>
+inline void PrefetchRow(const T* row, const TIndex block_size) {
+  constexpr TIndex kLine = 64 / sizeof(T);
+  for (TIndex k = 0; k < block_size; k += kLine) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+inline __m256 LoadMoments(const float* x) {
+  return _mm256_loadu_ps(x);
+}
+
+inline __m256 LoadMoments(const float16* x) {
+  return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x)));
+}
+
+inline void StoreMoments(const __m256 x, __m256i* /* state */, float* y) {
+  _mm256_storeu_ps(y, x);
+}
+
+inline void StoreMoments(const __m256 x, __m256i* state, float16* y) {
+  _mm_storeu_si128(
+      reinterpret_cast<__m128i*>(y), StochasticRoundToFloat16(x, state));
+}
+
+// Updates 8 columns of a row, b1 and b2 being the decays of the moments of
+// the row.
+template <typename MomentType>
+inline void AdamBlock(
+    const float* g,
+    const float* w,
+    const MomentType* m,
+    const MomentType* v,
+    const __m256 vb1,
+    const __m256 vb2,
+    const __m256 vone_minus_beta1,
+    const __m256 vone_minus_beta2,
+    const __m256 vlr_correction,
+    const __m256 veps,
+    __m256i* state,
+    float* nw,
+    MomentType* nm,
+    MomentType* nv) {
+  const __m256 vg = _mm256_loadu_ps(g);
+  const __m256 vm = _mm256_add_ps(
+      _mm256_mul_ps(LoadMoments(m), vb1), _mm256_mul_ps(vg, vone_minus_beta1));
+  const __m256 vv = _mm256_add_ps(
+      _mm256_mul_ps(LoadMoments(v), vb2),
+      _mm256_mul_ps(_mm256_mul_ps(vg, vg), vone_minus_beta2));
+  StoreMoments(vm, state, nm);
+  StoreMoments(vv, state, nv);
+  _mm256_storeu_ps(
+      nw,
+      _mm256_add_ps(
+          _mm256_loadu_ps(w),
+          _mm256_div_ps(
+              _mm256_mul_ps(vlr_correction, vm),
+              _mm256_add_ps(_mm256_sqrt_ps(vv), veps))));
+}
+
+// The update uses separate multiplies and adds, so that the results are the
+// same as the ones of the scalar SparseAdam. The last block_size % 8 columns
+// go through zero padded blocks.
+template <typename IndexType, typename MomentType>
+void SparseAdamKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const MomentType* moment1,
+    const MomentType* moment2,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float beta1,
+    const float beta2,
+    const float epsilon,
+    const float correction,
+    const int64_t iter,
+    int64_t* last_iter,
+    const uint32_t seed,
+    const int prefetch_distance,
+    float* param_out,
+    MomentType* moment1_out,
+    MomentType* moment2_out) {
+  const float lr_correction = lr * correction;
+  __m256 vb1 = _mm256_set1_ps(beta1);
+  __m256 vb2 = _mm256_set1_ps(beta2);
+  const __m256 vone_minus_beta1 = _mm256_set1_ps(1 - beta1);
+  const __m256 vone_minus_beta2 = _mm256_set1_ps(1 - beta2);
+  const __m256 vlr_correction = _mm256_set1_ps(lr_correction);
+  const __m256 veps = _mm256_set1_ps(epsilon);
+  __m256i state = InitRandom(seed);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        PrefetchRow(moment1 + next * block_size, block_size);
+        PrefetchRow(moment2 + next * block_size, block_size);
+      }
+    }
+    if (last_iter) {
+      float b1, b2;
+      LazyAdamDecays(beta1, beta2, iter, last_iter + idx, &b1, &b2);
+      vb1 = _mm256_set1_ps(b1);
+      vb2 = _mm256_set1_ps(b2);
+    }
+
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex k = 0;
+    for (; k + 8 <= block_size; k += 8) {
+      AdamBlock(
+          g + k,
+          param + offset + k,
+          moment1 + offset + k,
+          moment2 + offset + k,
+          vb1,
+          vb2,
+          vone_minus_beta1,
+          vone_minus_beta2,
+          vlr_correction,
+          veps,
+          &state,
+          param_out + offset + k,
+          moment1_out + offset + k,
+          moment2_out + offset + k);
+    }
+    if (k < block_size) {
+      const TIndex tail = block_size - k;
+      float g_tail[8] = {0}, w_tail[8] = {0}, nw_tail[8];
+      MomentType m_tail[8] = {}, v_tail[8] = {}, nm_tail[8], nv_tail[8];
+      memcpy(g_tail, g + k, tail * sizeof(float));
+      memcpy(w_tail, param + offset + k, tail * sizeof(float));
+      memcpy(m_tail, moment1 + offset + k, tail * sizeof(MomentType));
+      memcpy(v_tail, moment2 + offset + k, tail * sizeof(MomentType));
+      AdamBlock(
+          g_tail,
+          w_tail,
+          m_tail,
+          v_tail,
+          vb1,
+          vb2,
+          vone_minus_beta1,
+          vone_minus_beta2,
+          vlr_correction,
+          veps,
+          &state,
+          nw_tail,
+          nm_tail,
+          nv_tail);
+      memcpy(param_out + offset + k, nw_tail, tail * sizeof(float));
+      memcpy(moment1_out + offset + k, nm_tail, tail * sizeof(MomentType));
+      memcpy(moment2_out + offset + k, nv_tail, tail * sizeof(MomentType));
+    }
+  }
+}
+
+} // namespace
+
+#define SPARSE_ADAM_AVX2(Name, IndexType, MomentType) \
+  void Name##_##IndexType##__avx2_fma(                \
+      const TIndex block_size,                        \
+      const TIndex index_size,                        \
+      const TIndex data_size,                         \
+      const float* param,                             \
+      const MomentType* moment1,                      \
+      const MomentType* moment2,                      \
+      const IndexType* indices,                       \
+      const float* grad,                              \
+      const float lr,                                 \
+      const float beta1,                              \
+      const float beta2,                              \
+      const float epsilon,                            \
+      const float correction,                         \
+      const int64_t iter,                             \
+      int64_t* last_iter,                             \
+      const uint32_t seed,                            \
+      const int prefetch_distance,                    \
+      float* param_out,                               \
+      MomentType* moment1_out,                        \
+      MomentType* moment2_out) {                      \
+    SparseAdamKernel(                                 \
+        block_size,                                   \
+        index_size,                                   \
+        data_size,                                    \
+        param,                                        \
+        moment1,                                      \
+        moment2,                                      \
+        indices,                                      \
+        grad,                                         \
+        lr,                                           \
+        beta1,                                        \
+        beta2,                                        \
+        epsilon,                                      \
+        correction,                                   \
+        iter,                                         \
+        last_iter,                                    \
+        seed,                                         \
+        prefetch_distance,                            \
+        param_out,                                    \
+        moment1_out,                                  \
+        moment2_out);                                 \
+  }
+
+SPARSE_ADAM_AVX2(SparseAdam, int32_t, float);
+SPARSE_ADAM_AVX2(SparseAdam, int64_t, float);
+SPARSE_ADAM_AVX2(SparseAdamFloat16Moments, int32_t, float16);
+SPARSE_ADAM_AVX2(SparseAdamFloat16Moments, int64_t, float16);
+
+#undef SPARSE_ADAM_AVX2
+
+} // namespace caffe2
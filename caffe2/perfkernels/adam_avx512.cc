@@ -0,0 +1,179 @@
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/adam.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const float* row, const TIndex block_size) {
+  for (TIndex k = 0; k < block_size; k += 16) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+// The update uses separate multiplies and adds, so that the results are the
+// same as the ones of the scalar SparseAdam. The last block_size % 16 columns
+// are handled with masked loads and stores.
+template <typename IndexType>
+void SparseAdamKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* moment1,
+    const float* moment2,
+    const IndexType* indices,
+    const float* grad,
+    const float lr,
+    const float beta1,
+    const float beta2,
+    const float epsilon,
+    const float correction,
+    const int64_t iter,
+    int64_t* last_iter,
+    const uint32_t /* seed */,
+    const int prefetch_distance,
+    float* param_out,
+    float* moment1_out,
+    float* moment2_out) {
+  const float lr_correction = lr * correction;
+  __m512 vbeta1 = _mm512_set1_ps(beta1);
+  __m512 vbeta2 = _mm512_set1_ps(beta2);
+  const __m512 vone_minus_beta1 = _mm512_set1_ps(1 - beta1);
+  const __m512 vone_minus_beta2 = _mm512_set1_ps(1 - beta2);
+  const __m512 vlr_correction = _mm512_set1_ps(lr_correction);
+  const __m512 veps = _mm512_set1_ps(epsilon);
+  const __mmask16 tail_mask = (1 << (block_size % 16)) - 1;
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        PrefetchRow(moment1 + next * block_size, block_size);
+        PrefetchRow(moment2 + next * block_size, block_size);
+      }
+    }
+    if (last_iter) {
+      float b1, b2;
+      LazyAdamDecays(beta1, beta2, iter, last_iter + idx, &b1, &b2);
+      vbeta1 = _mm512_set1_ps(b1);
+      vbeta2 = _mm512_set1_ps(b2);
+    }
+
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    const float* w = param + offset;
+    const float* m = moment1 + offset;
+    const float* v = moment2 + offset;
+    float* nw = param_out + offset;
+    float* nm = moment1_out + offset;
+    float* nv = moment2_out + offset;
+    TIndex k = 0;
+    for (; k + 16 <= block_size; k += 16) {
+      const __m512 vg = _mm512_loadu_ps(g + k);
+      const __m512 vm = _mm512_add_ps(
+          _mm512_mul_ps(_mm512_loadu_ps(m + k), vbeta1),
+          _mm512_mul_ps(vg, vone_minus_beta1));
+      const __m512 vv = _mm512_add_ps(
+          _mm512_mul_ps(_mm512_loadu_ps(v + k), vbeta2),
+          _mm512_mul_ps(_mm512_mul_ps(vg, vg), vone_minus_beta2));
+      _mm512_storeu_ps(nm + k, vm);
+      _mm512_storeu_ps(nv + k, vv);
+      _mm512_storeu_ps(
+          nw + k,
+          _mm512_add_ps(
+              _mm512_loadu_ps(w + k),
+              _mm512_div_ps(
+                  _mm512_mul_ps(vlr_correction, vm),
+                  _mm512_add_ps(_mm512_sqrt_ps(vv), veps))));
+    }
+    if (k < block_size) {
+      const __m512 vg = _mm512_maskz_loadu_ps(tail_mask, g + k);
+      const __m512 vm = _mm512_add_ps(
+          _mm512_mul_ps(_mm512_maskz_loadu_ps(tail_mask, m + k), vbeta1),
+          _mm512_mul_ps(vg, vone_minus_beta1));
+      const __m512 vv = _mm512_add_ps(
+          _mm512_mul_ps(_mm512_maskz_loadu_ps(tail_mask, v + k), vbeta2),
+          _mm512_mul_ps(_mm512_mul_ps(vg, vg), vone_minus_beta2));
+      _mm512_mask_storeu_ps(nm + k, tail_mask, vm);
+      _mm512_mask_storeu_ps(nv + k, tail_mask, vv);
+      _mm512_mask_storeu_ps(
+          nw + k,
+          tail_mask,
+          _mm512_add_ps(
+              _mm512_maskz_loadu_ps(tail_mask, w + k),
+              _mm512_div_ps(
+                  _mm512_mul_ps(vlr_correction, vm),
+                  _mm512_add_ps(_mm512_sqrt_ps(vv), veps))));
+    }
+  }
+}
+
+} // namespace
+
+#define SPARSE_ADAM_AVX512(IndexType)    \
+  void SparseAdam_##IndexType##__avx512( \
+      const TIndex block_size,           \
+      const TIndex index_size,           \
+      const TIndex data_size,            \
+      const float* param,                \
+      const float* moment1,              \
+      const float* moment2,              \
+      const IndexType* indices,          \
+      const float* grad,                 \
+      const float lr,                    \
+      const float beta1,                 \
+      const float beta2,                 \
+      const float epsilon,               \
+      const float correction,            \
+      const int64_t iter,                \
+      int64_t* last_iter,                \
+      const uint32_t seed,               \
+      const int prefetch_distance,       \
+      float* param_out,                  \
+      float* moment1_out,                \
+      float* moment2_out) {              \
+    SparseAdamKernel(                    \
+        block_size,                      \
+        index_size,                      \
+        data_size,                       \
+        param,                           \
+        moment1,                         \
+        moment2,                         \
+        indices,                         \
+        grad,                            \
+        lr,                              \
+        beta1,                           \
+        beta2,                           \
+        epsilon,                         \
+        correction,                      \
+        iter,                            \
+        last_iter,                       \
+        seed,                            \
+        prefetch_distance,               \
+        param_out,                       \
+        moment1_out,                     \
+        moment2_out);                    \
+  }
+
+SPARSE_ADAM_AVX512(int32_t);
+SPARSE_ADAM_AVX512(int64_t);
+
+#undef SPARSE_ADAM_AVX512
+
+} // namespace caffe2
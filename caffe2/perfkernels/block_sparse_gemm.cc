@@ -0,0 +1,109 @@
+#include "caffe2/perfkernels/block_sparse_gemm.h"
+
+#include <algorithm>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation computes one row of one block row at a time
+void BlockSparseGemm__base(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y) {
+  for (TIndex p = block_begin; p < block_end; ++p) {
+    const TIndex n0 = p * block_size;
+    const int n_valid =
+        static_cast<int>(std::min<TIndex>(block_size, N - n0));
+    for (TIndex m = 0; m < M; ++m) {
+      const float* x = X + m * K;
+      float acc[kMaxSparseBlockSize];
+      for (int j = 0; j < block_size; ++j) {
+        acc[j] = bias && j < n_valid ? bias[n0 + j] : 0;
+      }
+      for (int32_t b = row_ptr[p]; b < row_ptr[p + 1]; ++b) {
+        const float xk = x[col_idx[b]];
+        const float* w = values + static_cast<TIndex>(b) * block_size;
+        for (int j = 0; j < block_size; ++j) {
+          acc[j] += xk * w[j];
+        }
+      }
+      std::copy(acc, acc + n_valid, Y + m * N + n0);
+    }
+  }
+}
+
+void BlockSparseGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y) {
+  CAFFE_ENFORCE(
+      block_size == 4 || block_size == 8 || block_size == 16,
+      "Unsupported block size: ",
+      block_size);
+  AVX512_DO(
+      BlockSparseGemm,
+      M,
+      N,
+      K,
+      block_size,
+      block_begin,
+      block_end,
+      X,
+      row_ptr,
+      col_idx,
+      values,
+      bias,
+      Y);
+  AVX2_FMA_DO(
+      BlockSparseGemm,
+      M,
+      N,
+      K,
+      block_size,
+      block_begin,
+      block_end,
+      X,
+      row_ptr,
+      col_idx,
+      values,
+      bias,
+      Y);
+  BASE_DO(
+      BlockSparseGemm,
+      M,
+      N,
+      K,
+      block_size,
+      block_begin,
+      block_end,
+      X,
+      row_ptr,
+      col_idx,
+      values,
+      bias,
+      Y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+// Largest number of outputs of a block of a block sparse matrix.
+constexpr int kMaxSparseBlockSize = 16;
+
+/**
+ * Y = X W^T + bias for the block rows [block_begin, block_end) of Y, where X
+ * is M x K row major and W is an N x K matrix stored in block compressed
+ * sparse row format:
+ *
+ * Block row p holds the outputs [p * block_size, (p + 1) * block_size) of W,
+ * and is made of the blocks [row_ptr[p], row_ptr[p + 1]). Block j holds
+ * the weights of these outputs for the input col_idx[j], as the block_size
+ * floats values[j * block_size, (j + 1) * block_size), zero padded past N.
+ * Inputs without a block in a block row have zero weights for all its
+ * outputs.
+ *
+ * block_size is 4, 8 or 16, so that a block is one SIMD vector (or two for
+ * 16 outputs with AVX2). bias has N elements, or is nullptr for no bias, and
+ * Y is M x N.
+ */
+void BlockSparseGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y);
+
+} // namespace caffe2
@@ -0,0 +1,233 @@
+#include <algorithm>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/block_sparse_gemm.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Rows of X multiplied at a time with a block row
+constexpr int kRows = 4;
+
+inline __m256i Mask(const int n) {
+  return _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// Loads the first n, up to 8, floats of p
+inline __m256 LoadPartial(const float* p, const int n) {
+  if (n >= 8) {
+    return _mm256_loadu_ps(p);
+  }
+  return n > 0 ? _mm256_maskload_ps(p, Mask(n)) : _mm256_setzero_ps();
+}
+
+inline void StorePartial(float* p, const __m256 v, const int n) {
+  if (n >= 8) {
+    _mm256_storeu_ps(p, v);
+  } else if (n > 0) {
+    _mm256_maskstore_ps(p, Mask(n), v);
+  }
+}
+
+inline __m128i Mask4(const int n) {
+  return _mm_cmpgt_epi32(_mm_set1_epi32(n), _mm_setr_epi32(0, 1, 2, 3));
+}
+
+// Computes the outputs of one block row for MR rows of X, from the blocks
+// [begin, end). Only the first n_valid outputs are read from the bias and
+// written to Y. Blocks of 8 and 16 outputs are one and two AVX vectors.
+template <int B, int MR>
+struct Kernel {
+  static void Run(
+      const int32_t begin,
+      const int32_t end,
+      const int32_t* col_idx,
+      const float* values,
+      const float* x,
+      const TIndex ldx,
+      const float* bias,
+      const int n_valid,
+      float* y,
+      const TIndex ldy) {
+    constexpr int kVectors = B / 8;
+    __m256 acc[MR][kVectors];
+    for (int q = 0; q < kVectors; ++q) {
+      const __m256 init = bias ? LoadPartial(bias + q * 8, n_valid - q * 8)
+                               : _mm256_setzero_ps();
+      for (int i = 0; i < MR; ++i) {
+        acc[i][q] = init;
+      }
+    }
+    for (int32_t b = begin; b < end; ++b) {
+      const float* w = values + static_cast<TIndex>(b) * B;
+      __m256 wv[kVectors];
+      for (int q = 0; q < kVectors; ++q) {
+        wv[q] = _mm256_loadu_ps(w + q * 8);
+      }
+      const TIndex k = col_idx[b];
+      for (int i = 0; i < MR; ++i) {
+        const __m256 a = _mm256_broadcast_ss(x + i * ldx + k);
+        for (int q = 0; q < kVectors; ++q) {
+          acc[i][q] = _mm256_fmadd_ps(a, wv[q], acc[i][q]);
+        }
+      }
+    }
+    for (int q = 0; q < kVectors; ++q) {
+      for (int i = 0; i < MR; ++i) {
+        StorePartial(y + i * ldy + q * 8, acc[i][q], n_valid - q * 8);
+      }
+    }
+  }
+};
+
+// Blocks of 4 outputs are one SSE vector
+template <int MR>
+struct Kernel<4, MR> {
+  static void Run(
+      const int32_t begin,
+      const int32_t end,
+      const int32_t* col_idx,
+      const float* values,
+      const float* x,
+      const TIndex ldx,
+      const float* bias,
+      const int n_valid,
+      float* y,
+      const TIndex ldy) {
+    const __m128i mask = Mask4(n_valid);
+    const __m128 init = bias ? _mm_maskload_ps(bias, mask) : _mm_setzero_ps();
+    __m128 acc[MR];
+    for (int i = 0; i < MR; ++i) {
+      acc[i] = init;
+    }
+    for (int32_t b = begin; b < end; ++b) {
+      const __m128 w = _mm_loadu_ps(values + static_cast<TIndex>(b) * 4);
+      const TIndex k = col_idx[b];
+      for (int i = 0; i < MR; ++i) {
+        acc[i] = _mm_fmadd_ps(_mm_broadcast_ss(x + i * ldx + k), w, acc[i]);
+      }
+    }
+    for (int i = 0; i < MR; ++i) {
+      if (n_valid >= 4) {
+        _mm_storeu_ps(y + i * ldy, acc[i]);
+      } else {
+        _mm_maskstore_ps(y + i * ldy, mask, acc[i]);
+      }
+    }
+  }
+};
+
+template <int B>
+void RunBlockRows(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y) {
+  for (TIndex p = block_begin; p < block_end; ++p) {
+    const TIndex n0 = p * B;
+    const int n_valid = static_cast<int>(std::min<TIndex>(B, N - n0));
+    const float* b = bias ? bias + n0 : nullptr;
+    TIndex m = 0;
+    for (; m + kRows <= M; m += kRows) {
+      Kernel<B, kRows>::Run(
+          row_ptr[p],
+          row_ptr[p + 1],
+          col_idx,
+          values,
+          X + m * K,
+          K,
+          b,
+          n_valid,
+          Y + m * N + n0,
+          N);
+    }
+    for (; m < M; ++m) {
+      Kernel<B, 1>::Run(
+          row_ptr[p],
+          row_ptr[p + 1],
+          col_idx,
+          values,
+          X + m * K,
+          K,
+          b,
+          n_valid,
+          Y + m * N + n0,
+          N);
+    }
+  }
+}
+
+} // namespace
+
+void BlockSparseGemm__avx2_fma(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y) {
+  // The block size is checked by BlockSparseGemm
+  switch (block_size) {
+    case 4:
+      RunBlockRows<4>(
+          M,
+          N,
+          K,
+          block_begin,
+          block_end,
+          X,
+          row_ptr,
+          col_idx,
+          values,
+          bias,
+          Y);
+      break;
+    case 8:
+      RunBlockRows<8>(
+          M,
+          N,
+          K,
+          block_begin,
+          block_end,
+          X,
+          row_ptr,
+          col_idx,
+          values,
+          bias,
+          Y);
+      break;
+    case 16:
+      RunBlockRows<16>(
+          M,
+          N,
+          K,
+          block_begin,
+          block_end,
+          X,
+          row_ptr,
+          col_idx,
+          values,
+          bias,
+          Y);
+      break;
+  }
+}
+
+} // namespace caffe2
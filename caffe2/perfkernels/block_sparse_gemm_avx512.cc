@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/block_sparse_gemm.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Rows of X multiplied at a time with a block row
+constexpr int kRows = 8;
+
+// Computes the outputs of one block row for MR rows of X, from the blocks
+// [begin, end). A block of up to 16 outputs is one vector, loaded with the
+// mask of its block_size weights. Only the outputs of valid are read from
+// the bias and written to Y.
+template <int MR>
+void Kernel(
+    const int block_size,
+    const __mmask16 weights,
+    const __mmask16 valid,
+    const int32_t begin,
+    const int32_t end,
+    const int32_t* col_idx,
+    const float* values,
+    const float* x,
+    const TIndex ldx,
+    const float* bias,
+    float* y,
+    const TIndex ldy) {
+  const __m512 init =
+      bias ? _mm512_maskz_loadu_ps(valid, bias) : _mm512_setzero_ps();
+  __m512 acc[MR];
+  for (int i = 0; i < MR; ++i) {
+    acc[i] = init;
+  }
+  for (int32_t b = begin; b < end; ++b) {
+    const __m512 w = _mm512_maskz_loadu_ps(
+        weights, values + static_cast<TIndex>(b) * block_size);
+    const TIndex k = col_idx[b];
+    for (int i = 0; i < MR; ++i) {
+      acc[i] = _mm512_fmadd_ps(_mm512_set1_ps(x[i * ldx + k]), w, acc[i]);
+    }
+  }
+  for (int i = 0; i < MR; ++i) {
+    _mm512_mask_storeu_ps(y + i * ldy, valid, acc[i]);
+  }
+}
+
+} // namespace
+
+void BlockSparseGemm__avx512(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const int block_size,
+    const TIndex block_begin,
+    const TIndex block_end,
+    const float* X,
+    const int32_t* row_ptr,
+    const int32_t* col_idx,
+    const float* values,
+    const float* bias,
+    float* Y) {
+  const __mmask16 weights = static_cast<__mmask16>((1U << block_size) - 1);
+  for (TIndex p = block_begin; p < block_end; ++p) {
+    const TIndex n0 = p * block_size;
+    const int n_valid =
+        static_cast<int>(std::min<TIndex>(block_size, N - n0));
+    const __mmask16 valid = static_cast<__mmask16>((1U << n_valid) - 1);
+    const float* b = bias ? bias + n0 : nullptr;
+    TIndex m = 0;
+    for (; m + kRows <= M; m += kRows) {
+      Kernel<kRows>(
+          block_size,
+          weights,
+          valid,
+          row_ptr[p],
+          row_ptr[p + 1],
+          col_idx,
+          values,
+          X + m * K,
+          K,
+          b,
+          Y + m * N + n0,
+          N);
+    }
+    for (; m < M; ++m) {
+      Kernel<1>(
+          block_size,
+          weights,
+          valid,
+          row_ptr[p],
+          row_ptr[p + 1],
+          col_idx,
+          values,
+          X + m * K,
+          K,
+          b,
+          Y + m * N + n0,
+          N);
+    }
+  }
+}
+
+} // namespace caffe2
@@ -7,6 +7,11 @@ implement a functionality called void foo(int a, float b).
 In foo.h, do:
    void foo(int a, float b);
 
+In foo_avx512.cc, do:
+   void foo__avx512(int a, float b) {
+     [actual avx512 implementation]
+   }
+
 In foo_avx2.cc, do:
    void foo__avx2(int a, float b) {
      [actual avx2 implementation]
@@ -25,6 +30,7 @@ In foo.cc, do:
    void foo(int a, float b) {
      // You should always order things by their preference, faster
      // implementations earlier in the function.
+     AVX512_DO(foo, a, b);
      AVX2_DO(foo, a, b);
      AVX_DO(foo, a, b);
      BASE_DO(foo, a, b);
@@ -35,11 +41,12 @@ In foo.cc, do:
 // and run time architecture support.
 //
 // During build time:
-//    The build system should provide flags CAFFE2_PERF_WITH_AVX2 and
-//    CAFFE2_PERF_WITH_AVX that corresponds to the __AVX__ and __AVX2__ flags
-//    the compiler provides. Note that we do not use the compiler flags but
-//    rely on the build system flags, because the common files (like foo.cc
-//    above) will always be built without __AVX__ and __AVX2__.
+//    The build system should provide flags CAFFE2_PERF_WITH_AVX512,
+//    CAFFE2_PERF_WITH_AVX2 and CAFFE2_PERF_WITH_AVX that corresponds to the
+//    __AVX512F__, __AVX2__ and __AVX__ flags the compiler provides. Note that
+//    we do not use the compiler flags but rely on the build system flags,
+//    because the common files (like foo.cc above) will always be built
+//    without them.
 // During run time:
 //    we use cpuid to identify cpu support and run the proper functions.
 
@@ -50,6 +57,31 @@ In foo.cc, do:
 
 #define BASE_DO(funcname, ...) return funcname##__base(__VA_ARGS__);
 
+// AVX512 kernels are compiled with -mavx512f -mavx512bw -mavx512vl and may
+// use instructions of all three extensions.
+#ifdef CAFFE2_PERF_WITH_AVX512
+#define AVX512_DO(funcname, ...)                                \
+  decltype(funcname##__base) funcname##__avx512;                \
+  if (GetCpuId().avx512f() && GetCpuId().avx512bw() &&          \
+      GetCpuId().avx512vl()) {                                  \
+    return funcname##__avx512(__VA_ARGS__);                     \
+  }
+#else // CAFFE2_PERF_WITH_AVX512
+#define AVX512_DO(funcname, ...)
+#endif // CAFFE2_PERF_WITH_AVX512
+
+// AVX512 VNNI kernels are compiled with the AVX512 flags and -mavx512vnni.
+#ifdef CAFFE2_PERF_WITH_AVX512VNNI
+#define AVX512VNNI_DO(funcname, ...)                              \
+  decltype(funcname##__base) funcname##__avx512vnni;              \
+  if (GetCpuId().avx512f() && GetCpuId().avx512bw() &&            \
+      GetCpuId().avx512vl() && GetCpuId().avx512vnni()) {         \
+    return funcname##__avx512vnni(__VA_ARGS__);                   \
+  }
+#else // CAFFE2_PERF_WITH_AVX512VNNI
+#define AVX512VNNI_DO(funcname, ...)
+#endif // CAFFE2_PERF_WITH_AVX512VNNI
+
 #ifdef CAFFE2_PERF_WITH_AVX2
 #define AVX2_DO(funcname, ...)                 \
   decltype(funcname##__base) funcname##__avx2; \
@@ -81,3 +113,25 @@ In foo.cc, do:
 #define AVX_DO(funcname, ...)
 #define AVX_F16C_DO(funcname, ...)
 #endif // CAFFE2_PERF_WITH_AVX
+
+// NEON kernels are part of the common sources, compiled on the ARM targets
+// with NEON, where they always run.
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define NEON_DO(funcname, ...)                 \
+  decltype(funcname##__base) funcname##__neon; \
+  return funcname##__neon(__VA_ARGS__);
+#else // __ARM_NEON__
+#define NEON_DO(funcname, ...)
+#endif // __ARM_NEON__
+
+// ARMv8.2 dot product kernels are compiled with -march=armv8.2-a+dotprod and
+// run on the CPUs that report the sdot/udot instructions.
+#ifdef CAFFE2_PERF_WITH_NEON_DOTPROD
+#define NEON_DOTPROD_DO(funcname, ...)                 \
+  decltype(funcname##__base) funcname##__neon_dotprod; \
+  if (ArmHasDotProduct()) {                            \
+    return funcname##__neon_dotprod(__VA_ARGS__);      \
+  }
+#else // CAFFE2_PERF_WITH_NEON_DOTPROD
+#define NEON_DOTPROD_DO(funcname, ...)
+#endif // CAFFE2_PERF_WITH_NEON_DOTPROD
@@ -0,0 +1,270 @@
+#include "caffe2/perfkernels/depthwise_conv.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// The row kernels compute n consecutive outputs of a row whose windows all
+// lie in the input columns. rows[kh] points to the first input of the
+// window of the first output in input row kh of the window, or is nullptr
+// when that row is padding.
+
+void DepthwiseConvRowNCHW__base(
+    const int kernel,
+    const int stride,
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  for (int j = 0; j < n; ++j) {
+    float acc = bias;
+    for (int kh = 0; kh < kernel; ++kh) {
+      if (rows[kh]) {
+        const float* x = rows[kh] + j * stride;
+        for (int kw = 0; kw < kernel; ++kw) {
+          acc += filter[kh * kernel + kw] * x[kw];
+        }
+      }
+    }
+    y[j] = acc;
+  }
+}
+
+void DepthwiseConvRowNCHW(
+    const int kernel,
+    const int stride,
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  if ((kernel == 3 || kernel == 5) && (stride == 1 || stride == 2)) {
+    AVX512_DO(DepthwiseConvRowNCHW, kernel, stride, n, rows, filter, bias, y);
+    AVX2_FMA_DO(
+        DepthwiseConvRowNCHW, kernel, stride, n, rows, filter, bias, y);
+  }
+  BASE_DO(DepthwiseConvRowNCHW, kernel, stride, n, rows, filter, bias, y);
+}
+
+void DepthwiseConvRowNHWC__base(
+    const int kernel,
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  for (int j = 0; j < n; ++j) {
+    float* yj = y + j * C;
+    for (int c = 0; c < C; ++c) {
+      yj[c] = bias ? bias[c] : 0;
+    }
+    for (int kh = 0; kh < kernel; ++kh) {
+      if (!rows[kh]) {
+        continue;
+      }
+      for (int kw = 0; kw < kernel; ++kw) {
+        const float* x = rows[kh] + (j * stride + kw) * C;
+        const float* f = filter + (kh * kernel + kw) * C;
+        for (int c = 0; c < C; ++c) {
+          yj[c] += f[c] * x[c];
+        }
+      }
+    }
+  }
+}
+
+void DepthwiseConvRowNHWC(
+    const int kernel,
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  if (kernel == 3 || kernel == 5) {
+    AVX512_DO(
+        DepthwiseConvRowNHWC, kernel, stride, n, C, rows, filter, bias, y);
+    AVX2_FMA_DO(
+        DepthwiseConvRowNHWC, kernel, stride, n, C, rows, filter, bias, y);
+  }
+  BASE_DO(DepthwiseConvRowNHWC, kernel, stride, n, C, rows, filter, bias, y);
+}
+
+namespace {
+
+// Outputs [ow_begin, ow_end) of a row have their windows in the input
+// columns
+void InteriorColumns(
+    const int kernel,
+    const int stride,
+    const int W,
+    const int out_w,
+    const int pad_l,
+    int* ow_begin,
+    int* ow_end) {
+  *ow_begin = std::min(out_w, (pad_l + stride - 1) / stride);
+  *ow_end = W + pad_l >= kernel
+      ? std::min(out_w, (W + pad_l - kernel) / stride + 1)
+      : 0;
+  *ow_end = std::max(*ow_begin, *ow_end);
+}
+
+// Points rows[kh] to row kh of the window of output row oh, or to nullptr
+// for padding rows
+void WindowRows(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int pad_t,
+    const int oh,
+    const float* X,
+    const TIndex row_size,
+    const float** rows) {
+  for (int kh = 0; kh < kernel; ++kh) {
+    const int ih = oh * stride - pad_t + kh;
+    rows[kh] = ih >= 0 && ih < H ? X + ih * row_size : nullptr;
+  }
+}
+
+} // namespace
+
+void DepthwiseConv2DNCHW(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const float* X,
+    const float* filter,
+    const float bias,
+    float* Y) {
+  int ow_begin, ow_end;
+  InteriorColumns(kernel, stride, W, out_w, pad_l, &ow_begin, &ow_end);
+  std::vector<const float*> rows(kernel);
+  std::vector<const float*> interior_rows(kernel);
+  const auto border = [&](const int ow, float* y) {
+    float acc = bias;
+    for (int kh = 0; kh < kernel; ++kh) {
+      if (!rows[kh]) {
+        continue;
+      }
+      for (int kw = 0; kw < kernel; ++kw) {
+        const int iw = ow * stride - pad_l + kw;
+        if (iw >= 0 && iw < W) {
+          acc += filter[kh * kernel + kw] * rows[kh][iw];
+        }
+      }
+    }
+    y[ow] = acc;
+  };
+  for (int oh = 0; oh < out_h; ++oh) {
+    float* y = Y + oh * out_w;
+    WindowRows(kernel, stride, H, pad_t, oh, X, W, rows.data());
+    for (int ow = 0; ow < ow_begin; ++ow) {
+      border(ow, y);
+    }
+    if (ow_begin < ow_end) {
+      for (int kh = 0; kh < kernel; ++kh) {
+        interior_rows[kh] =
+            rows[kh] ? rows[kh] + ow_begin * stride - pad_l : nullptr;
+      }
+      DepthwiseConvRowNCHW(
+          kernel,
+          stride,
+          ow_end - ow_begin,
+          interior_rows.data(),
+          filter,
+          bias,
+          y + ow_begin);
+    }
+    for (int ow = ow_end; ow < out_w; ++ow) {
+      border(ow, y);
+    }
+  }
+}
+
+void DepthwiseConv2DNHWC(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const int oh_begin,
+    const int oh_end,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y) {
+  int ow_begin, ow_end;
+  InteriorColumns(kernel, stride, W, out_w, pad_l, &ow_begin, &ow_end);
+  std::vector<const float*> rows(kernel);
+  std::vector<const float*> interior_rows(kernel);
+  const auto border = [&](const int ow, float* y) {
+    float* yo = y + ow * C;
+    for (int c = 0; c < C; ++c) {
+      yo[c] = bias ? bias[c] : 0;
+    }
+    for (int kh = 0; kh < kernel; ++kh) {
+      if (!rows[kh]) {
+        continue;
+      }
+      for (int kw = 0; kw < kernel; ++kw) {
+        const int iw = ow * stride - pad_l + kw;
+        if (iw < 0 || iw >= W) {
+          continue;
+        }
+        const float* x = rows[kh] + iw * C;
+        const float* f = filter + (kh * kernel + kw) * C;
+        for (int c = 0; c < C; ++c) {
+          yo[c] += f[c] * x[c];
+        }
+      }
+    }
+  };
+  for (int oh = oh_begin; oh < oh_end; ++oh) {
+    float* y = Y + static_cast<TIndex>(oh) * out_w * C;
+    WindowRows(
+        kernel, stride, H, pad_t, oh, X, static_cast<TIndex>(W) * C,
+        rows.data());
+    for (int ow = 0; ow < ow_begin; ++ow) {
+      border(ow, y);
+    }
+    if (ow_begin < ow_end) {
+      for (int kh = 0; kh < kernel; ++kh) {
+        interior_rows[kh] = rows[kh]
+            ? rows[kh] + static_cast<TIndex>(ow_begin * stride - pad_l) * C
+            : nullptr;
+      }
+      DepthwiseConvRowNHWC(
+          kernel,
+          stride,
+          ow_end - ow_begin,
+          C,
+          interior_rows.data(),
+          filter,
+          bias,
+          y + static_cast<TIndex>(ow_begin) * C);
+    }
+    for (int ow = ow_end; ow < out_w; ++ow) {
+      border(ow, y);
+    }
+  }
+}
+
+} // namespace caffe2
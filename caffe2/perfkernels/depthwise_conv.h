@@ -0,0 +1,59 @@
+#pragma once
+
+namespace caffe2 {
+
+/**
+ * Depthwise 2-D convolution of one channel plane in NCHW order, for square
+ * kernels without dilation:
+ *
+ * for (oh = 0..out_h-1, ow = 0..out_w-1)
+ *   Y[oh][ow] = bias + sum_{kh,kw} filter[kh][kw] *
+ *       X[oh * stride - pad_t + kh][ow * stride - pad_l + kw]
+ *
+ * where the terms outside of the H x W input are left out. The outputs
+ * whose window lies in the input are computed with AVX2 or AVX512 for 3x3
+ * and 5x5 kernels of stride 1 or 2, the others in scalar code.
+ */
+void DepthwiseConv2DNCHW(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const float* X,
+    const float* filter,
+    const float bias,
+    float* Y);
+
+/**
+ * Depthwise 2-D convolution of output rows [oh_begin, oh_end) of one image
+ * of C channels in NHWC order:
+ *
+ * Y[oh][ow][c] = bias[c] + sum_{kh,kw} filter[kh][kw][c] *
+ *     X[oh * stride - pad_t + kh][ow * stride - pad_l + kw][c]
+ *
+ * The filter is kernel x kernel x C, which is the transpose of the C x
+ * kernel x kernel x 1 filter of the Conv operator, and bias, of C elements,
+ * can be nullptr. The channels are vectorized for 3x3 and 5x5 kernels.
+ */
+void DepthwiseConv2DNHWC(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const int oh_begin,
+    const int oh_end,
+    const float* X,
+    const float* filter,
+    const float* bias,
+    float* Y);
+
+} // namespace caffe2
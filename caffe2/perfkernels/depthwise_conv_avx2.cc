@@ -0,0 +1,151 @@
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Mask of the first n, up to 8, lanes for the masked loads and stores
+inline __m256i FirstLanes(const int n) {
+  return _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+template <int kKernel, int kStride>
+void RowNCHW(
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  __m256 f[kKernel * kKernel];
+  for (int i = 0; i < kKernel * kKernel; ++i) {
+    f[i] = _mm256_set1_ps(filter[i]);
+  }
+  for (int j = 0; j < n; j += 8) {
+    const int lanes = n - j;
+    const __m256i mask = FirstLanes(lanes);
+    __m256 acc = _mm256_set1_ps(bias);
+    for (int kh = 0; kh < kKernel; ++kh) {
+      if (!rows[kh]) {
+        continue;
+      }
+      const float* x = rows[kh] + j * kStride;
+      for (int kw = 0; kw < kKernel; ++kw) {
+        __m256 v;
+        if (kStride == 1) {
+          v = lanes >= 8 ? _mm256_loadu_ps(x + kw)
+                         : _mm256_maskload_ps(x + kw, mask);
+        } else {
+          // Inputs 0 .. 2 * (lanes - 1) of the window column are read, and
+          // the even ones kept: shuffling gives 0 2 8 10 4 6 12 14, which
+          // the permutation of 64-bit pairs puts in order.
+          const int count = 2 * lanes - 1;
+          __m256 lo, hi;
+          if (count >= 16) {
+            lo = _mm256_loadu_ps(x + kw);
+            hi = _mm256_loadu_ps(x + kw + 8);
+          } else {
+            lo = _mm256_maskload_ps(x + kw, FirstLanes(count));
+            hi = _mm256_maskload_ps(x + kw + 8, FirstLanes(count - 8));
+          }
+          v = _mm256_castpd_ps(_mm256_permute4x64_pd(
+              _mm256_castps_pd(_mm256_shuffle_ps(lo, hi, 0x88)), 0xD8));
+        }
+        acc = _mm256_fmadd_ps(f[kh * kKernel + kw], v, acc);
+      }
+    }
+    if (lanes >= 8) {
+      _mm256_storeu_ps(y + j, acc);
+    } else {
+      _mm256_maskstore_ps(y + j, mask, acc);
+    }
+  }
+}
+
+template <int kKernel>
+void RowNHWC(
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  // The filter vectors of a block of 8 channels are loaded once for all
+  // the outputs of the row.
+  for (int c = 0; c < C; c += 8) {
+    const bool full = C - c >= 8;
+    const __m256i mask = FirstLanes(C - c);
+    const auto load = [&](const float* p) {
+      return full ? _mm256_loadu_ps(p) : _mm256_maskload_ps(p, mask);
+    };
+    __m256 f[kKernel * kKernel];
+    for (int i = 0; i < kKernel * kKernel; ++i) {
+      f[i] = load(filter + i * C + c);
+    }
+    const __m256 b = bias ? load(bias + c) : _mm256_setzero_ps();
+    for (int j = 0; j < n; ++j) {
+      __m256 acc = b;
+      for (int kh = 0; kh < kKernel; ++kh) {
+        if (!rows[kh]) {
+          continue;
+        }
+        const float* x = rows[kh] + static_cast<TIndex>(j) * stride * C + c;
+        for (int kw = 0; kw < kKernel; ++kw) {
+          acc = _mm256_fmadd_ps(f[kh * kKernel + kw], load(x + kw * C), acc);
+        }
+      }
+      float* yj = y + static_cast<TIndex>(j) * C + c;
+      if (full) {
+        _mm256_storeu_ps(yj, acc);
+      } else {
+        _mm256_maskstore_ps(yj, mask, acc);
+      }
+    }
+  }
+}
+
+} // namespace
+
+void DepthwiseConvRowNCHW__avx2_fma(
+    const int kernel,
+    const int stride,
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  if (kernel == 3) {
+    if (stride == 1) {
+      RowNCHW<3, 1>(n, rows, filter, bias, y);
+    } else {
+      RowNCHW<3, 2>(n, rows, filter, bias, y);
+    }
+  } else {
+    if (stride == 1) {
+      RowNCHW<5, 1>(n, rows, filter, bias, y);
+    } else {
+      RowNCHW<5, 2>(n, rows, filter, bias, y);
+    }
+  }
+}
+
+void DepthwiseConvRowNHWC__avx2_fma(
+    const int kernel,
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  if (kernel == 3) {
+    RowNHWC<3>(stride, n, C, rows, filter, bias, y);
+  } else {
+    RowNHWC<5>(stride, n, C, rows, filter, bias, y);
+  }
+}
+
+} // namespace caffe2
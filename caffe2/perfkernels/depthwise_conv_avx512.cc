@@ -0,0 +1,137 @@
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Mask of the first n, up to 16, lanes
+inline __mmask16 FirstLanes(const int n) {
+  return n >= 16 ? static_cast<__mmask16>(0xFFFF)
+                 : static_cast<__mmask16>((1U << n) - 1);
+}
+
+template <int kKernel, int kStride>
+void RowNCHW(
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  __m512 f[kKernel * kKernel];
+  for (int i = 0; i < kKernel * kKernel; ++i) {
+    f[i] = _mm512_set1_ps(filter[i]);
+  }
+  // Picks the even elements of two vectors for stride 2
+  const __m512i evens = _mm512_setr_epi32(
+      0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+  for (int j = 0; j < n; j += 16) {
+    const int lanes = n - j;
+    const __mmask16 mask = FirstLanes(lanes);
+    __m512 acc = _mm512_set1_ps(bias);
+    for (int kh = 0; kh < kKernel; ++kh) {
+      if (!rows[kh]) {
+        continue;
+      }
+      const float* x = rows[kh] + j * kStride;
+      for (int kw = 0; kw < kKernel; ++kw) {
+        __m512 v;
+        if (kStride == 1) {
+          v = _mm512_maskz_loadu_ps(mask, x + kw);
+        } else {
+          // Inputs 0 .. 2 * (lanes - 1) of the window column are read
+          const int count = 2 * lanes - 1;
+          const __m512 lo =
+              _mm512_maskz_loadu_ps(FirstLanes(count), x + kw);
+          const __m512 hi = _mm512_maskz_loadu_ps(
+              count > 16 ? FirstLanes(count - 16) : 0, x + kw + 16);
+          v = _mm512_permutex2var_ps(lo, evens, hi);
+        }
+        acc = _mm512_fmadd_ps(f[kh * kKernel + kw], v, acc);
+      }
+    }
+    _mm512_mask_storeu_ps(y + j, mask, acc);
+  }
+}
+
+template <int kKernel>
+void RowNHWC(
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  // The filter vectors of a block of 16 channels are loaded once for all
+  // the outputs of the row.
+  for (int c = 0; c < C; c += 16) {
+    const __mmask16 mask = FirstLanes(C - c);
+    __m512 f[kKernel * kKernel];
+    for (int i = 0; i < kKernel * kKernel; ++i) {
+      f[i] = _mm512_maskz_loadu_ps(mask, filter + i * C + c);
+    }
+    const __m512 b =
+        bias ? _mm512_maskz_loadu_ps(mask, bias + c) : _mm512_setzero_ps();
+    for (int j = 0; j < n; ++j) {
+      __m512 acc = b;
+      for (int kh = 0; kh < kKernel; ++kh) {
+        if (!rows[kh]) {
+          continue;
+        }
+        const float* x = rows[kh] + static_cast<TIndex>(j) * stride * C + c;
+        for (int kw = 0; kw < kKernel; ++kw) {
+          acc = _mm512_fmadd_ps(
+              f[kh * kKernel + kw],
+              _mm512_maskz_loadu_ps(mask, x + kw * C),
+              acc);
+        }
+      }
+      _mm512_mask_storeu_ps(y + static_cast<TIndex>(j) * C + c, mask, acc);
+    }
+  }
+}
+
+} // namespace
+
+void DepthwiseConvRowNCHW__avx512(
+    const int kernel,
+    const int stride,
+    const int n,
+    const float* const* rows,
+    const float* filter,
+    const float bias,
+    float* y) {
+  if (kernel == 3) {
+    if (stride == 1) {
+      RowNCHW<3, 1>(n, rows, filter, bias, y);
+    } else {
+      RowNCHW<3, 2>(n, rows, filter, bias, y);
+    }
+  } else {
+    if (stride == 1) {
+      RowNCHW<5, 1>(n, rows, filter, bias, y);
+    } else {
+      RowNCHW<5, 2>(n, rows, filter, bias, y);
+    }
+  }
+}
+
+void DepthwiseConvRowNHWC__avx512(
+    const int kernel,
+    const int stride,
+    const int n,
+    const int C,
+    const float* const* rows,
+    const float* filter,
+    const float* bias,
+    float* y) {
+  if (kernel == 3) {
+    RowNHWC<3>(stride, n, C, rows, filter, bias, y);
+  } else {
+    RowNHWC<5>(stride, n, C, rows, filter, bias, y);
+  }
+}
+
+} // namespace caffe2
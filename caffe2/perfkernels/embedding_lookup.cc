@@ -2,6 +2,7 @@
 
 #include "caffe2/core/types.h"
 #include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
 #include "caffe2/perfkernels/typed_axpy.h"
 #include "caffe2/utils/cpuid.h"
 #include "caffe2/utils/math.h"
@@ -25,6 +26,7 @@ static void EmbeddingLookupGenericSlow(
     const float* weights, // optional, can be null for sum reducer
     const float* scale_bias, // optional scale & bias params for uint8 input
     bool normalize_by_lengths,
+    const int prefetch_distance,
     OutType* out) {
   TIndex current = 0;
   for (int m = 0; m < output_size; ++m) {
@@ -43,8 +45,9 @@ static void EmbeddingLookupGenericSlow(
           data_size);
       CAFFE_ENFORCE_LT(idx, data_size);
 #ifdef __GNUC__
-      if (current + 1 < index_size) {
-        __builtin_prefetch(input + block_size * indices[current + 1], 0, 1);
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
+        __builtin_prefetch(
+            input + block_size * indices[current + prefetch_distance], 0, 1);
       }
 #endif // __GNUC__
 
@@ -95,6 +98,7 @@ static void EmbeddingLookupGenericSlow(
           const float* weights,                                                            \
           const float* scale_bias,                                                         \
           bool normalize_by_lengths,                                                       \
+          const int prefetch_distance,                                                     \
           OutType* out) {                                                                  \
     EmbeddingLookupGenericSlow<                                                            \
         IndexType,                                                                         \
@@ -111,6 +115,7 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                                           \
         scale_bias,                                                                        \
         normalize_by_lengths,                                                              \
+        prefetch_distance,                                                                 \
         out);                                                                              \
   }                                                                                        \
   template <>                                                                              \
@@ -126,6 +131,25 @@ static void EmbeddingLookupGenericSlow(
       const float* scale_bias,                                                             \
       bool normalize_by_lengths,                                                           \
       OutType* out) {                                                                      \
+    PrefetchDistance prefetch(                                                             \
+        "EmbeddingLookup_" #IndexType "_" #InType "_" #OutType "_"                         \
+            #IS_WEIGHT_POSITIONAL,                                                         \
+        block_size,                                                                        \
+        index_size);                                                                       \
+    AVX512_DO(                                                                             \
+        EmbeddingLookup_##IndexType##_##InType##_##OutType##_##IS_WEIGHT_POSITIONAL,       \
+        block_size,                                                                        \
+        output_size,                                                                       \
+        index_size,                                                                        \
+        data_size,                                                                         \
+        input,                                                                             \
+        indices,                                                                           \
+        lengths,                                                                           \
+        weights,                                                                           \
+        scale_bias,                                                                        \
+        normalize_by_lengths,                                                              \
+        prefetch.distance(),                                                               \
+        out);                                                                              \
     AVX2_FMA_DO(                                                                           \
         EmbeddingLookup_##IndexType##_##InType##_##OutType##_##IS_WEIGHT_POSITIONAL,       \
         block_size,                                                                        \
@@ -138,6 +162,7 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                                           \
         scale_bias,                                                                        \
         normalize_by_lengths,                                                              \
+        prefetch.distance(),                                                               \
         out);                                                                              \
     BASE_DO(                                                                               \
         EmbeddingLookup_##IndexType##_##InType##_##OutType##_##IS_WEIGHT_POSITIONAL,       \
@@ -151,6 +176,7 @@ static void EmbeddingLookupGenericSlow(
         weights,                                                                           \
         scale_bias,                                                                        \
         normalize_by_lengths,                                                              \
+        prefetch.distance(),                                                               \
         out);                                                                              \
   }
 
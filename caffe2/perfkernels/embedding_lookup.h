@@ -29,6 +29,9 @@ namespace caffe2 {
  *     for (k = 0..block_size-1)
  *       out[i*block_size + k] /= lengths[i]
  *
+ * The distance at which rows are prefetched is picked by PrefetchDistance,
+ * see prefetch_tuner.h.
+ *
  */
 template <
     typename IndexType,
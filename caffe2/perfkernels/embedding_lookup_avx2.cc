@@ -23,8 +23,9 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
@@ -65,44 +66,38 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (64)), vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (72)), vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (80)), vop80);
-        _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
         vop88 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (88)), vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (96)), vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (104)), vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (112)), vop112);
-        _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -171,28 +166,26 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -241,20 +234,20 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -293,16 +286,17 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -342,19 +336,23 @@ static void EmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 16) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
               &op[j],
               _mm256_fmadd_ps(
                   vwgt, _mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ip[j];
@@ -386,6 +384,7 @@ void EmbeddingLookup_int32_t_float_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_float_float__avx2_fma<false>(
       block_size,
@@ -398,6 +397,7 @@ void EmbeddingLookup_int32_t_float_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int32_t_float_float_true__avx2_fma(
@@ -411,6 +411,7 @@ void EmbeddingLookup_int32_t_float_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_float_float__avx2_fma<true>(
       block_size,
@@ -423,6 +424,7 @@ void EmbeddingLookup_int32_t_float_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -438,8 +440,9 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
@@ -480,44 +483,38 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (64)), vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (72)), vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (80)), vop80);
-        _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
         vop88 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (88)), vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (96)), vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (104)), vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (112)), vop112);
-        _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -586,28 +583,26 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -656,20 +651,20 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -708,16 +703,17 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -757,19 +753,23 @@ static void EmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 16) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
               &op[j],
               _mm256_fmadd_ps(
                   vwgt, _mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ip[j];
@@ -801,6 +801,7 @@ void EmbeddingLookup_int64_t_float_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_float_float__avx2_fma<false>(
       block_size,
@@ -813,6 +814,7 @@ void EmbeddingLookup_int64_t_float_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int64_t_float_float_true__avx2_fma(
@@ -826,6 +828,7 @@ void EmbeddingLookup_int64_t_float_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_float_float__avx2_fma<true>(
       block_size,
@@ -838,6 +841,7 @@ void EmbeddingLookup_int64_t_float_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -853,8 +857,9 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
@@ -895,108 +900,98 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
             vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
             vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
             vop80);
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
             vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
             vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
             vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
             vop112);
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
             vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1065,60 +1060,56 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1167,36 +1158,35 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1235,24 +1225,25 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1292,12 +1283,17 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 32) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -1307,7 +1303,6 @@ static void EmbeddingLookup_int32_t_float16_float__avx2_fma(
                   _mm256_cvtph_ps(_mm_loadu_si128(
                       reinterpret_cast<const __m128i*>(&ip[j]))),
                   _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         float16 vtmp1[8] CAFFE2_ALIGNED(64);
         for (; j < block_size; j++) {
@@ -1342,6 +1337,7 @@ void EmbeddingLookup_int32_t_float16_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_float16_float__avx2_fma<false>(
       block_size,
@@ -1354,6 +1350,7 @@ void EmbeddingLookup_int32_t_float16_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int32_t_float16_float_true__avx2_fma(
@@ -1367,6 +1364,7 @@ void EmbeddingLookup_int32_t_float16_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_float16_float__avx2_fma<true>(
       block_size,
@@ -1379,6 +1377,7 @@ void EmbeddingLookup_int32_t_float16_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -1394,8 +1393,9 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias == nullptr, "scale_bias must be nullptr");
   if (block_size == 128) {
@@ -1436,108 +1436,98 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
             vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
             vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
             vop80);
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
             vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
             vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
             vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
             vop112);
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
             vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1606,60 +1596,56 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1708,36 +1694,35 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1776,24 +1761,25 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1833,12 +1819,17 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 32) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -1848,7 +1839,6 @@ static void EmbeddingLookup_int64_t_float16_float__avx2_fma(
                   _mm256_cvtph_ps(_mm_loadu_si128(
                       reinterpret_cast<const __m128i*>(&ip[j]))),
                   _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         float16 vtmp1[8] CAFFE2_ALIGNED(64);
         for (; j < block_size; j++) {
@@ -1883,6 +1873,7 @@ void EmbeddingLookup_int64_t_float16_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_float16_float__avx2_fma<false>(
       block_size,
@@ -1895,6 +1886,7 @@ void EmbeddingLookup_int64_t_float16_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int64_t_float16_float_true__avx2_fma(
@@ -1908,6 +1900,7 @@ void EmbeddingLookup_int64_t_float16_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_float16_float__avx2_fma<true>(
       block_size,
@@ -1920,6 +1913,7 @@ void EmbeddingLookup_int64_t_float16_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -1935,8 +1929,9 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias != nullptr, "scale_bias must not be nullptr");
   if (block_size == 128) {
@@ -1981,108 +1976,96 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (64))))),
             _mm256_add_ps(vop64, vbio));
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (72))))),
             _mm256_add_ps(vop72, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (80))))),
             _mm256_add_ps(vop80, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (88))))),
             _mm256_add_ps(vop88, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (96))))),
             _mm256_add_ps(vop96, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[96])
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (104))))),
             _mm256_add_ps(vop104, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (112))))),
             _mm256_add_ps(vop112, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (120))))),
             _mm256_add_ps(vop120, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2155,60 +2138,55 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2261,36 +2239,35 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2333,24 +2310,25 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2395,12 +2373,17 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 64) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -2410,7 +2393,6 @@ static void EmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(
                       reinterpret_cast<const __m128i*>(&ip[j])))),
                   _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio)));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ((float)ip[j]) + bio;
@@ -2442,6 +2424,7 @@ void EmbeddingLookup_int32_t_uint8_t_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_uint8_t_float__avx2_fma<false>(
       block_size,
@@ -2454,6 +2437,7 @@ void EmbeddingLookup_int32_t_uint8_t_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
@@ -2467,6 +2451,7 @@ void EmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int32_t_uint8_t_float__avx2_fma<true>(
       block_size,
@@ -2479,6 +2464,7 @@ void EmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -2494,8 +2480,9 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 0;
   CAFFE_ENFORCE(scale_bias != nullptr, "scale_bias must not be nullptr");
   if (block_size == 128) {
@@ -2540,108 +2527,96 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (64))))),
             _mm256_add_ps(vop64, vbio));
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (72))))),
             _mm256_add_ps(vop72, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (80))))),
             _mm256_add_ps(vop80, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (88))))),
             _mm256_add_ps(vop88, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (96))))),
             _mm256_add_ps(vop96, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[96])
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (104))))),
             _mm256_add_ps(vop104, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (112))))),
             _mm256_add_ps(vop112, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (120))))),
             _mm256_add_ps(vop120, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2714,60 +2689,55 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2820,36 +2790,35 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2892,24 +2861,25 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2954,12 +2924,17 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 64) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -2969,7 +2944,6 @@ static void EmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(
                       reinterpret_cast<const __m128i*>(&ip[j])))),
                   _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio)));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ((float)ip[j]) + bio;
@@ -3001,6 +2975,7 @@ void EmbeddingLookup_int64_t_uint8_t_float_false__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_uint8_t_float__avx2_fma<false>(
       block_size,
@@ -3013,6 +2988,7 @@ void EmbeddingLookup_int64_t_uint8_t_float_false__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void EmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
@@ -3026,6 +3002,7 @@ void EmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
     const float* weights,
     const float* scale_bias,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   EmbeddingLookup_int64_t_uint8_t_float__avx2_fma<true>(
       block_size,
@@ -3038,6 +3015,7 @@ void EmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
       weights,
       scale_bias,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -22,8 +22,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 2;
   if (block_size == 128) {
     // unrolling 16 times
@@ -63,44 +64,38 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (64)), vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (72)), vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (80)), vop80);
-        _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
         vop88 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (88)), vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (96)), vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (104)), vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (112)), vop112);
-        _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -169,28 +164,26 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -239,20 +232,20 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -291,16 +284,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -340,19 +334,23 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 16) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
               &op[j],
               _mm256_fmadd_ps(
                   vwgt, _mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ip[j];
@@ -383,6 +381,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma<false>(
       block_size,
@@ -394,6 +393,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float_true__avx2_fma(
@@ -406,6 +406,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_float_float__avx2_fma<true>(
       block_size,
@@ -417,6 +418,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -431,8 +433,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 2;
   if (block_size == 128) {
     // unrolling 16 times
@@ -472,44 +475,38 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (64)), vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (72)), vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (80)), vop80);
-        _mm_prefetch((&ip_next_T0[80]), _MM_HINT_T0);
         vop88 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (88)), vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (96)), vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (104)), vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (112)), vop112);
-        _mm_prefetch((&ip_next_T0[112]), _MM_HINT_T0);
         vop120 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (120)), vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -578,28 +575,26 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (32)), vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (40)), vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (48)), vop48);
-        _mm_prefetch((&ip_next_T0[48]), _MM_HINT_T0);
         vop56 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (56)), vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -648,20 +643,20 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (16)), vop16);
-        _mm_prefetch((&ip_next_T0[16]), _MM_HINT_T0);
         vop24 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (24)), vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -700,16 +695,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (0)), vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(vwgt, _mm256_loadu_ps(ip + (8)), vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -749,19 +745,23 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 16) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
               &op[j],
               _mm256_fmadd_ps(
                   vwgt, _mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ip[j];
@@ -792,6 +792,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma<false>(
       block_size,
@@ -803,6 +804,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float_true__avx2_fma(
@@ -815,6 +817,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_float_float__avx2_fma<true>(
       block_size,
@@ -826,6 +829,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -840,8 +844,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 4;
   if (block_size == 128) {
     // unrolling 16 times
@@ -881,108 +886,98 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
             vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
             vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
             vop80);
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
             vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
             vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
             vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
             vop112);
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
             vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1051,60 +1046,56 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1153,36 +1144,35 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1221,24 +1211,25 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1278,12 +1269,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 32) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -1293,7 +1289,6 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma(
                   _mm256_cvtph_ps(_mm_loadu_si128(
                       reinterpret_cast<const __m128i*>(&ip[j]))),
                   _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         float16 vtmp1[8] CAFFE2_ALIGNED(64);
         for (; j < block_size; j++) {
@@ -1327,6 +1322,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma<false>(
       block_size,
@@ -1338,6 +1334,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float_true__avx2_fma(
@@ -1350,6 +1347,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float__avx2_fma<true>(
       block_size,
@@ -1361,6 +1359,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_float16_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -1375,8 +1374,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 4;
   if (block_size == 128) {
     // unrolling 16 times
@@ -1416,108 +1416,98 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (64)))),
             vop64);
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (72)))),
             vop72);
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (80)))),
             vop80);
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (88)))),
             vop88);
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (96)))),
             vop96);
-        _mm_prefetch((&ip_next_T0[96]), _MM_HINT_T0);
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (104)))),
             vop104);
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (112)))),
             vop112);
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (120)))),
             vop120);
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1586,60 +1576,56 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (32)))),
             vop32);
-        _mm_prefetch((&ip_next_T0[32]), _MM_HINT_T0);
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (40)))),
             vop40);
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (48)))),
             vop48);
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (56)))),
             vop56);
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1688,36 +1674,35 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (16)))),
             vop16);
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (24)))),
             vop24);
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1756,24 +1741,25 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (0)))),
             vop0);
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtph_ps(
                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (8)))),
             vop8);
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -1813,12 +1799,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
         }
         __m256 vwgt = _mm256_set1_ps(wgt);
         const float16* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const float16* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 32) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -1828,7 +1819,6 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma(
                   _mm256_cvtph_ps(_mm_loadu_si128(
                       reinterpret_cast<const __m128i*>(&ip[j]))),
                   _mm256_loadu_ps(&op[j])));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         float16 vtmp1[8] CAFFE2_ALIGNED(64);
         for (; j < block_size; j++) {
@@ -1862,6 +1852,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma<false>(
       block_size,
@@ -1873,6 +1864,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float_true__avx2_fma(
@@ -1885,6 +1877,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float__avx2_fma<true>(
       block_size,
@@ -1896,6 +1889,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_float16_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -1910,8 +1904,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int32_t prefdist_T0 = 16;
+  const int32_t prefdist_T0 = prefetch_distance;
   const int32_t fused_block_size = block_size + 8;
   if (block_size == 128) {
     // unrolling 16 times
@@ -1957,108 +1952,96 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (64))))),
             _mm256_add_ps(vop64, vbio));
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (72))))),
             _mm256_add_ps(vop72, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (80))))),
             _mm256_add_ps(vop80, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (88))))),
             _mm256_add_ps(vop88, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (96))))),
             _mm256_add_ps(vop96, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[96])
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (104))))),
             _mm256_add_ps(vop104, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (112))))),
             _mm256_add_ps(vop112, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (120))))),
             _mm256_add_ps(vop120, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2133,60 +2116,55 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2241,36 +2219,35 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2315,24 +2292,25 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2378,12 +2356,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int32_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int32_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int32_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 64) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -2393,7 +2376,6 @@ static void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(
                       reinterpret_cast<const __m128i*>(&ip[j])))),
                   _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio)));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ((float)ip[j]) + bio;
@@ -2424,6 +2406,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma<false>(
       block_size,
@@ -2435,6 +2418,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
@@ -2447,6 +2431,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma<true>(
       block_size,
@@ -2458,6 +2443,7 @@ void Fused8BitRowwiseEmbeddingLookup_int32_t_uint8_t_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
@@ -2472,8 +2458,9 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
-  const int64_t prefdist_T0 = 16;
+  const int64_t prefdist_T0 = prefetch_distance;
   const int64_t fused_block_size = block_size + 8;
   if (block_size == 128) {
     // unrolling 16 times
@@ -2519,108 +2506,96 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+          _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
         vop64 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (64))))),
             _mm256_add_ps(vop64, vbio));
-        _mm_prefetch((&ip_next_T0[64]), _MM_HINT_T0);
         vop72 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (72))))),
             _mm256_add_ps(vop72, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[72])
         vop80 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (80))))),
             _mm256_add_ps(vop80, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[80])
         vop88 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (88))))),
             _mm256_add_ps(vop88, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[88])
         vop96 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (96))))),
             _mm256_add_ps(vop96, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[96])
         vop104 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (104))))),
             _mm256_add_ps(vop104, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[104])
         vop112 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (112))))),
             _mm256_add_ps(vop112, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[112])
         vop120 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (120))))),
             _mm256_add_ps(vop120, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[120])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2695,60 +2670,55 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
         vop32 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (32))))),
             _mm256_add_ps(vop32, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[32])
         vop40 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (40))))),
             _mm256_add_ps(vop40, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[40])
         vop48 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (48))))),
             _mm256_add_ps(vop48, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[48])
         vop56 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (56))))),
             _mm256_add_ps(vop56, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[56])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2803,36 +2773,35 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
         vop16 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (16))))),
             _mm256_add_ps(vop16, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[16])
         vop24 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (24))))),
             _mm256_add_ps(vop24, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[24])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2877,24 +2846,25 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
+        }
         vop0 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (0))))),
             _mm256_add_ps(vop0, vbio));
-        _mm_prefetch((&ip_next_T0[0]), _MM_HINT_T0);
         vop8 = _mm256_fmadd_ps(
             vwgt,
             _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
                 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (8))))),
             _mm256_add_ps(vop8, vbio));
-        // skip unnecessary prefetch of (&ip_next_T0[8])
       }
       if (normalize_by_lengths == false) {
         _mm256_storeu_ps(&op[0], vop0);
@@ -2940,12 +2910,17 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
         __m256 vbio = _mm256_set1_ps(bio);
         __m256 vwgt = _mm256_set1_ps(wgt);
         const uint8_t* ip = &input[idx * fused_block_size];
-        const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
-            ? (dataInd + prefdist_T0)
-            : dataInd;
-        const int64_t idx_pref_T0 = indices[next_T0];
-        CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
-        const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+        if (prefdist_T0 > 0) {
+          const int64_t next_T0 = (dataInd < index_size - prefdist_T0)
+              ? (dataInd + prefdist_T0)
+              : dataInd;
+          const int64_t idx_pref_T0 = indices[next_T0];
+          CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+          const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+          for (TIndex k = 0; k < block_size; k += 64) {
+            _mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);
+          }
+        }
         j = 0;
         for (; j + 8 <= block_size; j += 8) {
           _mm256_storeu_ps(
@@ -2955,7 +2930,6 @@ static void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(
                       reinterpret_cast<const __m128i*>(&ip[j])))),
                   _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio)));
-          _mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);
         }
         for (; j < block_size; j++) {
           op[j] += wgt * ((float)ip[j]) + bio;
@@ -2986,6 +2960,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float_false__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma<false>(
       block_size,
@@ -2997,6 +2972,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float_false__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
@@ -3009,6 +2985,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
     const int* lengths,
     const float* weights,
     bool normalize_by_lengths,
+    const int prefetch_distance,
     float* out) {
   Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma<true>(
       block_size,
@@ -3020,6 +2997,7 @@ void Fused8BitRowwiseEmbeddingLookup_int64_t_uint8_t_float_true__avx2_fma(
       lengths,
       weights,
       normalize_by_lengths,
+      prefetch_distance,
       out);
 }
 
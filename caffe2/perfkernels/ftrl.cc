@@ -0,0 +1,181 @@
+#include "caffe2/perfkernels/ftrl.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation does the same scalar updates as SparseFtrl
+template <typename IndexType>
+static void SparseFtrlGenericSlow(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* nz,
+    const IndexType* indices,
+    const float* grad,
+    const float alpha_inv,
+    const float beta,
+    const float lambda1,
+    const float lambda2,
+    const int prefetch_distance,
+    float* param_out,
+    float* nz_out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        __builtin_prefetch(param_out + next * block_size, 1, 1);
+        __builtin_prefetch(nz_out + 2 * next * block_size, 1, 1);
+      }
+    }
+#endif // __GNUC__
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    for (TIndex k = 0; k < block_size; ++k) {
+      const TIndex j = offset + k;
+      const float gk = g[k];
+      const float n = nz[2 * j];
+      const float new_n = n + gk * gk;
+      const float sigma = gk * gk /
+          std::max(std::sqrt(new_n) + std::sqrt(n),
+                   std::numeric_limits<float>::min()) *
+          alpha_inv;
+      const float new_z = nz[2 * j + 1] + gk - sigma * param[j];
+      nz_out[2 * j] = new_n;
+      nz_out[2 * j + 1] = new_z;
+      if (std::abs(new_z) > lambda1) {
+        const float sign = new_z < 0 ? -1.0f : (new_z > 0 ? 1.0f : 0.0f);
+        param_out[j] = (lambda1 * sign - new_z) /
+            ((beta + std::sqrt(new_n)) * alpha_inv + lambda2);
+      } else {
+        param_out[j] = 0;
+      }
+    }
+  }
+}
+
+// Proxy back to generic implementation
+#define SPARSE_FTRL_SPECIALIZATION(IndexType)              \
+  void SparseFtrl_##IndexType##__base(                     \
+      const TIndex block_size,                             \
+      const TIndex index_size,                             \
+      const TIndex data_size,                              \
+      const float* param,                                  \
+      const float* nz,                                     \
+      const IndexType* indices,                            \
+      const float* grad,                                   \
+      const float alpha_inv,                               \
+      const float beta,                                    \
+      const float lambda1,                                 \
+      const float lambda2,                                 \
+      const int prefetch_distance,                         \
+      float* param_out,                                    \
+      float* nz_out) {                                     \
+    SparseFtrlGenericSlow<IndexType>(                      \
+        block_size,                                        \
+        index_size,                                        \
+        data_size,                                         \
+        param,                                             \
+        nz,                                                \
+        indices,                                           \
+        grad,                                              \
+        alpha_inv,                                         \
+        beta,                                              \
+        lambda1,                                           \
+        lambda2,                                           \
+        prefetch_distance,                                 \
+        param_out,                                         \
+        nz_out);                                           \
+  }                                                        \
+  template <>                                              \
+  void SparseFtrl<IndexType>(                              \
+      const TIndex block_size,                             \
+      const TIndex index_size,                             \
+      const TIndex data_size,                              \
+      const float* param,                                  \
+      const float* nz,                                     \
+      const IndexType* indices,                            \
+      const float* grad,                                   \
+      const float alpha_inv,                               \
+      const float beta,                                    \
+      const float lambda1,                                 \
+      const float lambda2,                                 \
+      float* param_out,                                    \
+      float* nz_out) {                                     \
+    PrefetchDistance prefetch(                             \
+        "SparseFtrl_" #IndexType, block_size, index_size); \
+    AVX512_DO(                                             \
+        SparseFtrl_##IndexType,                            \
+        block_size,                                        \
+        index_size,                                        \
+        data_size,                                         \
+        param,                                             \
+        nz,                                                \
+        indices,                                           \
+        grad,                                              \
+        alpha_inv,                                         \
+        beta,                                              \
+        lambda1,                                           \
+        lambda2,                                           \
+        prefetch.distance(),                               \
+        param_out,                                         \
+        nz_out);                                           \
+    AVX2_FMA_DO(                                           \
+        SparseFtrl_##IndexType,                            \
+        block_size,                                        \
+        index_size,                                        \
+        data_size,                                         \
+        param,                                             \
+        nz,                                                \
+        indices,                                           \
+        grad,                                              \
+        alpha_inv,                                         \
+        beta,                                              \
+        lambda1,                                           \
+        lambda2,                                           \
+        prefetch.distance(),                               \
+        param_out,                                         \
+        nz_out);                                           \
+    BASE_DO(                                               \
+        SparseFtrl_##IndexType,                            \
+        block_size,                                        \
+        index_size,                                        \
+        data_size,                                         \
+        param,                                             \
+        nz,                                                \
+        indices,                                           \
+        grad,                                              \
+        alpha_inv,                                         \
+        beta,                                              \
+        lambda1,                                           \
+        lambda2,                                           \
+        prefetch.distance(),                               \
+        param_out,                                         \
+        nz_out);                                           \
+  }
+
+SPARSE_FTRL_SPECIALIZATION(int32_t);
+SPARSE_FTRL_SPECIALIZATION(int64_t);
+
+#undef SPARSE_FTRL_SPECIALIZATION
+
+} // namespace caffe2
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * The SparseFtrl update: the i-th row of `grad` (of size
+ * index_size * block_size) is the gradient of row indices[i] of `param`.
+ * `param` and `param_out` have data_size * block_size elements and `nz` and
+ * `nz_out` twice as many, the (n, z) accumulators of every element of
+ * `param` being interleaved; the outputs can alias the inputs.
+ *
+ * Behavior is equivalent to pseudocode:
+ *
+ * for (i = 0..index_size-1)
+ *   idx = indices[i]
+ *   for (k = 0..block_size-1)
+ *     j = idx*block_size + k
+ *     g = grad[i*block_size + k]
+ *     n = nz_out[2*j] = nz[2*j] + g * g
+ *     sigma = (sqrt(n) - sqrt(nz[2*j])) * alpha_inv, computed as
+ *           g * g / (sqrt(n) + sqrt(nz[2*j])) * alpha_inv
+ *     z = nz_out[2*j + 1] = nz[2*j + 1] + g - sigma * param[j]
+ *     param_out[j] = abs(z) > lambda1
+ *         ? (lambda1 * sign(z) - z) / ((beta + sqrt(n)) * alpha_inv + lambda2)
+ *         : 0
+ *
+ * The distance at which rows are prefetched is picked by PrefetchDistance,
+ * see prefetch_tuner.h.
+ */
+template <typename IndexType>
+void SparseFtrl(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* nz,
+    const IndexType* indices,
+    const float* grad,
+    const float alpha_inv,
+    const float beta,
+    const float lambda1,
+    const float lambda2,
+    float* param_out,
+    float* nz_out);
+
+} // namespace caffe2
@@ -0,0 +1,199 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const float* row, const TIndex size) {
+  for (TIndex k = 0; k < size; k += 16) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+// Updates 8 elements, whose 16 interleaved (n, z) accumulators are
+// deinterleaved and interleaved back around the update.
+inline void FtrlBlock(
+    const float* g,
+    const float* w,
+    const float* nz,
+    const __m256 valpha_inv,
+    const __m256 vbeta,
+    const __m256 vlambda1,
+    const __m256 vlambda2,
+    float* nw,
+    float* nnz) {
+  const __m256 lo = _mm256_loadu_ps(nz);
+  const __m256 hi = _mm256_loadu_ps(nz + 8);
+  // n0 n1 n4 n5 n2 n3 n6 n7 and z0 z1 z4 z5 z2 z3 z6 z7, then in order
+  const __m256 vn = _mm256_castpd_ps(_mm256_permute4x64_pd(
+      _mm256_castps_pd(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+      _MM_SHUFFLE(3, 1, 2, 0)));
+  const __m256 vz = _mm256_castpd_ps(_mm256_permute4x64_pd(
+      _mm256_castps_pd(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))),
+      _MM_SHUFFLE(3, 1, 2, 0)));
+
+  const __m256 vg = _mm256_loadu_ps(g);
+  const __m256 g2 = _mm256_mul_ps(vg, vg);
+  const __m256 new_n = _mm256_add_ps(vn, g2);
+  const __m256 sqrt_new_n = _mm256_sqrt_ps(new_n);
+  // sqrt(n + g * g) - sqrt(n) computed as g * g / (sqrt(n + g * g) + sqrt(n))
+  // without cancellation, the max keeping it 0 for n == g == 0
+  const __m256 vmin_normal =
+      _mm256_set1_ps(std::numeric_limits<float>::min());
+  const __m256 sigma = _mm256_mul_ps(
+      _mm256_div_ps(
+          g2,
+          _mm256_max_ps(
+              _mm256_add_ps(sqrt_new_n, _mm256_sqrt_ps(vn)), vmin_normal)),
+      valpha_inv);
+  const __m256 new_z = _mm256_sub_ps(
+      _mm256_add_ps(vz, vg), _mm256_mul_ps(sigma, _mm256_loadu_ps(w)));
+
+  // sign(z) is 0 for z == 0, and +-1 with the sign bit of z otherwise
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 sign = _mm256_and_ps(
+      _mm256_or_ps(_mm256_set1_ps(1.0f), _mm256_and_ps(new_z, sign_mask)),
+      _mm256_cmp_ps(new_z, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+  const __m256 new_w = _mm256_div_ps(
+      _mm256_sub_ps(_mm256_mul_ps(vlambda1, sign), new_z),
+      _mm256_add_ps(
+          _mm256_mul_ps(_mm256_add_ps(vbeta, sqrt_new_n), valpha_inv),
+          vlambda2));
+  const __m256 active = _mm256_cmp_ps(
+      _mm256_andnot_ps(sign_mask, new_z), vlambda1, _CMP_GT_OQ);
+  _mm256_storeu_ps(nw, _mm256_and_ps(new_w, active));
+
+  const __m256 nz_lo = _mm256_unpacklo_ps(new_n, new_z);
+  const __m256 nz_hi = _mm256_unpackhi_ps(new_n, new_z);
+  _mm256_storeu_ps(nnz, _mm256_permute2f128_ps(nz_lo, nz_hi, 0x20));
+  _mm256_storeu_ps(nnz + 8, _mm256_permute2f128_ps(nz_lo, nz_hi, 0x31));
+}
+
+// The update uses separate multiplies and adds, so that the results are the
+// same as the ones of the scalar SparseFtrl. The last block_size % 8 elements
+// go through zero padded blocks.
+template <typename IndexType>
+void SparseFtrlKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* nz,
+    const IndexType* indices,
+    const float* grad,
+    const float alpha_inv,
+    const float beta,
+    const float lambda1,
+    const float lambda2,
+    const int prefetch_distance,
+    float* param_out,
+    float* nz_out) {
+  const __m256 valpha_inv = _mm256_set1_ps(alpha_inv);
+  const __m256 vbeta = _mm256_set1_ps(beta);
+  const __m256 vlambda1 = _mm256_set1_ps(lambda1);
+  const __m256 vlambda2 = _mm256_set1_ps(lambda2);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        PrefetchRow(nz + 2 * next * block_size, 2 * block_size);
+      }
+    }
+
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex k = 0;
+    for (; k + 8 <= block_size; k += 8) {
+      FtrlBlock(
+          g + k,
+          param + offset + k,
+          nz + 2 * (offset + k),
+          valpha_inv,
+          vbeta,
+          vlambda1,
+          vlambda2,
+          param_out + offset + k,
+          nz_out + 2 * (offset + k));
+    }
+    if (k < block_size) {
+      const TIndex tail = block_size - k;
+      float g_tail[8] = {0}, w_tail[8] = {0}, nz_tail[16] = {0};
+      float nw_tail[8], nnz_tail[16];
+      memcpy(g_tail, g + k, tail * sizeof(float));
+      memcpy(w_tail, param + offset + k, tail * sizeof(float));
+      memcpy(nz_tail, nz + 2 * (offset + k), 2 * tail * sizeof(float));
+      FtrlBlock(
+          g_tail,
+          w_tail,
+          nz_tail,
+          valpha_inv,
+          vbeta,
+          vlambda1,
+          vlambda2,
+          nw_tail,
+          nnz_tail);
+      memcpy(param_out + offset + k, nw_tail, tail * sizeof(float));
+      memcpy(nz_out + 2 * (offset + k), nnz_tail, 2 * tail * sizeof(float));
+    }
+  }
+}
+
+} // namespace
+
+#define SPARSE_FTRL_AVX2(IndexType)        \
+  void SparseFtrl_##IndexType##__avx2_fma( \
+      const TIndex block_size,             \
+      const TIndex index_size,             \
+      const TIndex data_size,              \
+      const float* param,                  \
+      const float* nz,                     \
+      const IndexType* indices,            \
+      const float* grad,                   \
+      const float alpha_inv,               \
+      const float beta,                    \
+      const float lambda1,                 \
+      const float lambda2,                 \
+      const int prefetch_distance,         \
+      float* param_out,                    \
+      float* nz_out) {                     \
+    SparseFtrlKernel(                      \
+        block_size,                        \
+        index_size,                        \
+        data_size,                         \
+        param,                             \
+        nz,                                \
+        indices,                           \
+        grad,                              \
+        alpha_inv,                         \
+        beta,                              \
+        lambda1,                           \
+        lambda2,                           \
+        prefetch_distance,                 \
+        param_out,                         \
+        nz_out);                           \
+  }
+
+SPARSE_FTRL_AVX2(int32_t);
+SPARSE_FTRL_AVX2(int64_t);
+
+#undef SPARSE_FTRL_AVX2
+
+} // namespace caffe2
@@ -0,0 +1,207 @@
+#include <cmath>
+#include <limits>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const float* row, const TIndex size) {
+  for (TIndex k = 0; k < size; k += 16) {
+    _mm_prefetch(reinterpret_cast<const char*>(&row[k]), _MM_HINT_T0);
+  }
+}
+
+// Updates the first n of 16 elements, whose 2 * n interleaved (n, z)
+// accumulators are deinterleaved and interleaved back around the update.
+inline void FtrlBlock(
+    const int n,
+    const float* g,
+    const float* w,
+    const float* nz,
+    const __m512 valpha_inv,
+    const __m512 vbeta,
+    const __m512 vlambda1,
+    const __m512 vlambda2,
+    float* nw,
+    float* nnz) {
+  const __mmask16 mask = (1u << n) - 1;
+  // The masks of the first and last 16 accumulators
+  const uint32_t nz_mask = (static_cast<uint64_t>(1) << (2 * n)) - 1;
+  const __mmask16 lo_mask = nz_mask & 0xffff;
+  const __mmask16 hi_mask = nz_mask >> 16;
+  const __m512 lo = _mm512_maskz_loadu_ps(lo_mask, nz);
+  const __m512 hi = _mm512_maskz_loadu_ps(hi_mask, nz + 16);
+  const __m512i even = _mm512_setr_epi32(
+      0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+  const __m512i odd = _mm512_setr_epi32(
+      1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+  const __m512 vn = _mm512_permutex2var_ps(lo, even, hi);
+  const __m512 vz = _mm512_permutex2var_ps(lo, odd, hi);
+
+  const __m512 vg = _mm512_maskz_loadu_ps(mask, g);
+  const __m512 g2 = _mm512_mul_ps(vg, vg);
+  const __m512 new_n = _mm512_add_ps(vn, g2);
+  const __m512 sqrt_new_n = _mm512_sqrt_ps(new_n);
+  // sqrt(n + g * g) - sqrt(n) computed as g * g / (sqrt(n + g * g) + sqrt(n))
+  // without cancellation, the max keeping it 0 for n == g == 0
+  const __m512 vmin_normal =
+      _mm512_set1_ps(std::numeric_limits<float>::min());
+  const __m512 sigma = _mm512_mul_ps(
+      _mm512_div_ps(
+          g2,
+          _mm512_max_ps(
+              _mm512_add_ps(sqrt_new_n, _mm512_sqrt_ps(vn)), vmin_normal)),
+      valpha_inv);
+  const __m512 new_z = _mm512_sub_ps(
+      _mm512_add_ps(vz, vg),
+      _mm512_mul_ps(sigma, _mm512_maskz_loadu_ps(mask, w)));
+
+  // sign(z) is 0 for z == 0, and +-1 with the sign bit of z otherwise
+  const __m512i sign_mask = _mm512_set1_epi32(0x80000000);
+  const __m512i z_bits = _mm512_castps_si512(new_z);
+  const __m512 sign = _mm512_maskz_mov_ps(
+      _mm512_cmp_ps_mask(new_z, _mm512_setzero_ps(), _CMP_NEQ_OQ),
+      _mm512_castsi512_ps(_mm512_or_si512(
+          _mm512_castps_si512(_mm512_set1_ps(1.0f)),
+          _mm512_and_si512(z_bits, sign_mask))));
+  const __m512 new_w = _mm512_div_ps(
+      _mm512_sub_ps(_mm512_mul_ps(vlambda1, sign), new_z),
+      _mm512_add_ps(
+          _mm512_mul_ps(_mm512_add_ps(vbeta, sqrt_new_n), valpha_inv),
+          vlambda2));
+  const __mmask16 active = _mm512_cmp_ps_mask(
+      _mm512_castsi512_ps(_mm512_andnot_si512(sign_mask, z_bits)),
+      vlambda1,
+      _CMP_GT_OQ);
+  _mm512_mask_storeu_ps(nw, mask, _mm512_maskz_mov_ps(active, new_w));
+
+  const __m512i first = _mm512_setr_epi32(
+      0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+  const __m512i second = _mm512_setr_epi32(
+      8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+  _mm512_mask_storeu_ps(
+      nnz, lo_mask, _mm512_permutex2var_ps(new_n, first, new_z));
+  _mm512_mask_storeu_ps(
+      nnz + 16, hi_mask, _mm512_permutex2var_ps(new_n, second, new_z));
+}
+
+// The update uses separate multiplies and adds, so that the results are the
+// same as the ones of the scalar SparseFtrl. The last block_size % 16
+// elements are handled with masked loads and stores.
+template <typename IndexType>
+void SparseFtrlKernel(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* param,
+    const float* nz,
+    const IndexType* indices,
+    const float* grad,
+    const float alpha_inv,
+    const float beta,
+    const float lambda1,
+    const float lambda2,
+    const int prefetch_distance,
+    float* param_out,
+    float* nz_out) {
+  const __m512 valpha_inv = _mm512_set1_ps(alpha_inv);
+  const __m512 vbeta = _mm512_set1_ps(beta);
+  const __m512 vlambda1 = _mm512_set1_ps(lambda1);
+  const __m512 vlambda2 = _mm512_set1_ps(lambda2);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "Index ",
+        i,
+        " is out of bounds: ",
+        idx,
+        ", range 0 to ",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(param + next * block_size, block_size);
+        PrefetchRow(nz + 2 * next * block_size, 2 * block_size);
+      }
+    }
+
+    const float* g = grad + i * block_size;
+    const TIndex offset = idx * block_size;
+    TIndex k = 0;
+    for (; k + 16 <= block_size; k += 16) {
+      FtrlBlock(
+          16,
+          g + k,
+          param + offset + k,
+          nz + 2 * (offset + k),
+          valpha_inv,
+          vbeta,
+          vlambda1,
+          vlambda2,
+          param_out + offset + k,
+          nz_out + 2 * (offset + k));
+    }
+    if (k < block_size) {
+      FtrlBlock(
+          block_size - k,
+          g + k,
+          param + offset + k,
+          nz + 2 * (offset + k),
+          valpha_inv,
+          vbeta,
+          vlambda1,
+          vlambda2,
+          param_out + offset + k,
+          nz_out + 2 * (offset + k));
+    }
+  }
+}
+
+} // namespace
+
+#define SPARSE_FTRL_AVX512(IndexType)    \
+  void SparseFtrl_##IndexType##__avx512( \
+      const TIndex block_size,           \
+      const TIndex index_size,           \
+      const TIndex data_size,            \
+      const float* param,                \
+      const float* nz,                   \
+      const IndexType* indices,          \
+      const float* grad,                 \
+      const float alpha_inv,             \
+      const float beta,                  \
+      const float lambda1,               \
+      const float lambda2,               \
+      const int prefetch_distance,       \
+      float* param_out,                  \
+      float* nz_out) {                   \
+    SparseFtrlKernel(                    \
+        block_size,                      \
+        index_size,                      \
+        data_size,                       \
+        param,                           \
+        nz,                              \
+        indices,                         \
+        grad,                            \
+        alpha_inv,                       \
+        beta,                            \
+        lambda1,                         \
+        lambda2,                         \
+        prefetch_distance,               \
+        param_out,                       \
+        nz_out);                         \
+  }
+
+SPARSE_FTRL_AVX512(int32_t);
+SPARSE_FTRL_AVX512(int64_t);
+
+#undef SPARSE_FTRL_AVX512
+
+} // namespace caffe2
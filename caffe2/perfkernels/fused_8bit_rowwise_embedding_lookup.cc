@@ -2,6 +2,7 @@
 
 #include "caffe2/core/types.h"
 #include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
 #include "caffe2/perfkernels/typed_axpy.h"
 #include "caffe2/utils/cpuid.h"
 #include "caffe2/utils/math.h"
@@ -24,6 +25,7 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
     const int* lengths,
     const float* weights, // optional, can be null for sum reducer
     bool normalize_by_lengths,
+    const int prefetch_distance,
     OutType* out) {
   // block_size is the number of elements and fused_block_size is the size of
   // an entire row, including scale and bias.
@@ -46,9 +48,11 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
           data_size);
       CAFFE_ENFORCE_LT(idx, data_size);
 #ifdef __GNUC__
-      if (current + 1 < index_size) {
+      if (prefetch_distance > 0 && current + prefetch_distance < index_size) {
         __builtin_prefetch(
-            input + fused_block_size * indices[current + 1], 0, 1);
+            input + fused_block_size * indices[current + prefetch_distance],
+            0,
+            1);
       }
 #endif // __GNUC__
 
@@ -97,6 +101,7 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
           const int* lengths,                                                           \
           const float* weights,                                                         \
           bool normalize_by_lengths,                                                    \
+          const int prefetch_distance,                                                  \
           OutType* out) {                                                               \
     Fused8BitRowwiseEmbeddingLookupGenericSlow<                                         \
         IndexType,                                                                      \
@@ -112,6 +117,7 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
         lengths,                                                                        \
         weights,                                                                        \
         normalize_by_lengths,                                                           \
+        prefetch_distance,                                                              \
         out);                                                                           \
   }                                                                                     \
   template <>                                                                           \
@@ -131,6 +137,24 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
         reinterpret_cast<const uint8_t*>(&one)[0],                                      \
         1,                                                                              \
         "Fused8BitRowwiseEmbeddingLookup is not supported on this platform");           \
+    PrefetchDistance prefetch(                                                          \
+        "Fused8BitRowwiseEmbeddingLookup_" #IndexType "_" #InType "_"                   \
+            #OutType "_false",                                                          \
+        block_size,                                                                     \
+        index_size);                                                                    \
+    AVX512_DO(                                                                          \
+        Fused8BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType##_false,     \
+        block_size,                                                                     \
+        output_size,                                                                    \
+        index_size,                                                                     \
+        data_size,                                                                      \
+        input,                                                                          \
+        indices,                                                                        \
+        lengths,                                                                        \
+        weights,                                                                        \
+        normalize_by_lengths,                                                           \
+        prefetch.distance(),                                                            \
+        out);                                                                           \
     AVX2_FMA_DO(                                                                        \
         Fused8BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType##_false,     \
         block_size,                                                                     \
@@ -142,6 +166,7 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
         lengths,                                                                        \
         weights,                                                                        \
         normalize_by_lengths,                                                           \
+        prefetch.distance(),                                                            \
         out);                                                                           \
     BASE_DO(                                                                            \
         Fused8BitRowwiseEmbeddingLookup_##IndexType##_##InType##_##OutType##_false,     \
@@ -154,6 +179,7 @@ static void Fused8BitRowwiseEmbeddingLookupGenericSlow(
         lengths,                                                                        \
         weights,                                                                        \
         normalize_by_lengths,                                                           \
+        prefetch.distance(),                                                            \
         out);                                                                           \
   }
 
@@ -0,0 +1,173 @@
+#include "caffe2/perfkernels/fused_nbit_rowwise_embedding_lookup.h"
+
+#include <cstring>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation unpacks one value at a time
+template <typename IndexType, typename OutType>
+static void FusedNBitRowwiseEmbeddingLookupGenericSlow(
+    const int bit_rate,
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights, // optional, can be null for sum reducer
+    bool normalize_by_lengths,
+    OutType* out) {
+  const int elements_per_byte = 8 / bit_rate;
+  const uint8_t mask = (1 << bit_rate) - 1;
+  // block_size is the number of elements and fused_block_size is the size of
+  // an entire row, including scale and bias.
+  const TIndex packed_block_size = block_size / elements_per_byte;
+  const TIndex fused_block_size = packed_block_size + 8;
+  TIndex current = 0;
+  for (int m = 0; m < output_size; ++m) {
+    memset(out, 0, sizeof(OutType) * block_size);
+    for (int i = 0; i < lengths[m]; ++i) {
+      CAFFE_ENFORCE_LT(current, index_size);
+      TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+#ifdef __GNUC__
+      if (current + 1 < index_size) {
+        __builtin_prefetch(
+            input + fused_block_size * indices[current + 1], 0, 1);
+      }
+#endif // __GNUC__
+
+      const uint8_t* row = input + fused_block_size * idx;
+      float scale_bias[2];
+      memcpy(scale_bias, row + packed_block_size, sizeof(scale_bias));
+
+      float weight = 1.0f;
+      if (weights) {
+        weight = weights[current];
+      }
+      const float scale = weight * scale_bias[0];
+      const float bias = weight * scale_bias[1];
+
+      for (TIndex k = 0; k < block_size; ++k) {
+        const uint8_t quantized =
+            (row[k / elements_per_byte] >>
+             ((k % elements_per_byte) * bit_rate)) &
+            mask;
+        out[k] += quantized * scale + bias;
+      }
+
+      ++current;
+    }
+    if (normalize_by_lengths && lengths[m]) {
+      const float len_inv = 1.0f / lengths[m];
+      for (TIndex k = 0; k < block_size; ++k) {
+        out[k] *= len_inv;
+      }
+    }
+    out += block_size;
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+// Proxy back to generic implementation
+#define FUSED_NBIT_ROWWISE_EMBEDDING_SPECIALIZATION(IndexType, OutType)         \
+  void FusedNBitRowwiseEmbeddingLookup_##IndexType##_uint8_t_##OutType##__base( \
+      const int bit_rate,                                                       \
+      const TIndex block_size,                                                  \
+      const TIndex output_size,                                                 \
+      const TIndex index_size,                                                  \
+      const TIndex data_size,                                                   \
+      const uint8_t* input,                                                     \
+      const IndexType* indices,                                                 \
+      const int* lengths,                                                       \
+      const float* weights,                                                     \
+      bool normalize_by_lengths,                                                \
+      OutType* out) {                                                           \
+    FusedNBitRowwiseEmbeddingLookupGenericSlow<IndexType, OutType>(             \
+        bit_rate,                                                               \
+        block_size,                                                             \
+        output_size,                                                            \
+        index_size,                                                             \
+        data_size,                                                              \
+        input,                                                                  \
+        indices,                                                                \
+        lengths,                                                                \
+        weights,                                                                \
+        normalize_by_lengths,                                                   \
+        out);                                                                   \
+  }                                                                             \
+  template <>                                                                   \
+  void FusedNBitRowwiseEmbeddingLookup<IndexType, OutType>(                     \
+      const int bit_rate,                                                       \
+      const TIndex block_size,                                                  \
+      const TIndex output_size,                                                 \
+      const TIndex index_size,                                                  \
+      const TIndex data_size,                                                   \
+      const uint8_t* input,                                                     \
+      const IndexType* indices,                                                 \
+      const int* lengths,                                                       \
+      const float* weights,                                                     \
+      bool normalize_by_lengths,                                                \
+      OutType* out) {                                                           \
+    CAFFE_ENFORCE(                                                              \
+        bit_rate == 4 || bit_rate == 2, "Unsupported bit rate ", bit_rate);     \
+    CAFFE_ENFORCE_EQ(                                                           \
+        block_size % (8 / bit_rate),                                            \
+        0,                                                                      \
+        "block_size has to be a multiple of ",                                  \
+        8 / bit_rate);                                                          \
+    const int32_t one = 1;                                                      \
+    CAFFE_ENFORCE_EQ(                                                           \
+        reinterpret_cast<const uint8_t*>(&one)[0],                              \
+        1,                                                                      \
+        "FusedNBitRowwiseEmbeddingLookup is not supported on this platform");   \
+    AVX2_FMA_DO(                                                                \
+        FusedNBitRowwiseEmbeddingLookup_##IndexType##_uint8_t_##OutType,        \
+        bit_rate,                                                               \
+        block_size,                                                             \
+        output_size,                                                            \
+        index_size,                                                             \
+        data_size,                                                              \
+        input,                                                                  \
+        indices,                                                                \
+        lengths,                                                                \
+        weights,                                                                \
+        normalize_by_lengths,                                                   \
+        out);                                                                   \
+    BASE_DO(                                                                    \
+        FusedNBitRowwiseEmbeddingLookup_##IndexType##_uint8_t_##OutType,        \
+        bit_rate,                                                               \
+        block_size,                                                             \
+        output_size,                                                            \
+        index_size,                                                             \
+        data_size,                                                              \
+        input,                                                                  \
+        indices,                                                                \
+        lengths,                                                                \
+        weights,                                                                \
+        normalize_by_lengths,                                                   \
+        out);                                                                   \
+  }
+
+FUSED_NBIT_ROWWISE_EMBEDDING_SPECIALIZATION(int32_t, float);
+FUSED_NBIT_ROWWISE_EMBEDDING_SPECIALIZATION(int64_t, float);
+
+#undef FUSED_NBIT_ROWWISE_EMBEDDING_SPECIALIZATION
+
+} // namespace caffe2
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * Embedding lookup with reduction over rows quantized to bit_rate (4 or 2)
+ * bits, see FloatToFused4BitRowwiseQuantized.
+ *
+ * `input` of size data_size * (block_size / (8 / bit_rate) + 8B)
+ * `indices` of size index_size
+ * `lengths` of size output_size
+ * `weights` nullptr or array of size index_size
+ * `out` of size output_size * block_size
+ * sum(lengths[i]) == index_size
+ *
+ * block_size is the number of quantized values per row and has to be a
+ * multiple of 8 / bit_rate. Every row holds the packed values, 8 / bit_rate
+ * per byte starting in the lowest bits, followed by 4 bytes for scale and 4
+ * bytes for bias.
+ *
+ * Behavior is roughly equivalent to pseudocode:
+ *
+ * pos = 0
+ * fused_block_size = block_size / (8 / bit_rate) + 8B
+ * for (i = 0..index_size-1)
+ *   for (k = 0..block_size-1)
+ *     out[i*block_size + k] = 0
+ *   for (j = 0..lengths[i]-1)
+ *     for (k = 0..block_size-1)
+ *       out[i*block_size + k] += unpack(input[indices[pos]*fused_block_size],
+ *           k) * scale + bias, weighted by (weights ? weights[pos] : 1.0)
+ *     pos += 1
+ *   if (normalize_weights && lengths[i] > 0)
+ *     for (k = 0..block_size-1)
+ *       out[i*block_size + k] /= lengths[i]
+ *
+ */
+template <typename IndexType, typename OutType>
+void FusedNBitRowwiseEmbeddingLookup(
+    const int bit_rate,
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights, // optional, can be null for non-weighted sum
+    bool normalize_by_lengths,
+    OutType* out);
+} // namespace caffe2
@@ -0,0 +1,246 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Unpacks the 32 bits packing 8 four-bit or 16 two-bit values in register:
+// the word is broadcast to all lanes and every lane shifts its value down.
+template <int BIT_RATE>
+struct Unpack;
+
+template <>
+struct Unpack<4> {
+  static constexpr int kValuesPerWord = 8;
+
+  static inline void
+  Accumulate(const uint8_t* p, __m256 vscale, __m256 vbias, float* op) {
+    const __m256i vshift = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i vmask = _mm256_set1_epi32(0xF);
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    const __m256i q = _mm256_and_si256(
+        _mm256_srlv_epi32(_mm256_set1_epi32(word), vshift), vmask);
+    _mm256_storeu_ps(
+        op,
+        _mm256_fmadd_ps(
+            _mm256_cvtepi32_ps(q),
+            vscale,
+            _mm256_add_ps(_mm256_loadu_ps(op), vbias)));
+  }
+};
+
+template <>
+struct Unpack<2> {
+  static constexpr int kValuesPerWord = 16;
+
+  static inline void
+  Accumulate(const uint8_t* p, __m256 vscale, __m256 vbias, float* op) {
+    const __m256i vshift_lo = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m256i vshift_hi =
+        _mm256_setr_epi32(16, 18, 20, 22, 24, 26, 28, 30);
+    const __m256i vmask = _mm256_set1_epi32(0x3);
+    uint32_t word;
+    memcpy(&word, p, sizeof(word));
+    const __m256i vword = _mm256_set1_epi32(word);
+    const __m256i q_lo =
+        _mm256_and_si256(_mm256_srlv_epi32(vword, vshift_lo), vmask);
+    const __m256i q_hi =
+        _mm256_and_si256(_mm256_srlv_epi32(vword, vshift_hi), vmask);
+    _mm256_storeu_ps(
+        op,
+        _mm256_fmadd_ps(
+            _mm256_cvtepi32_ps(q_lo),
+            vscale,
+            _mm256_add_ps(_mm256_loadu_ps(op), vbias)));
+    _mm256_storeu_ps(
+        op + 8,
+        _mm256_fmadd_ps(
+            _mm256_cvtepi32_ps(q_hi),
+            vscale,
+            _mm256_add_ps(_mm256_loadu_ps(op + 8), vbias)));
+  }
+};
+
+template <int BIT_RATE, typename IndexType>
+void FusedNBitRowwiseEmbeddingLookupKernel(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  constexpr int kElementsPerByte = 8 / BIT_RATE;
+  constexpr int kValuesPerWord = Unpack<BIT_RATE>::kValuesPerWord;
+  constexpr uint8_t kMask = (1 << BIT_RATE) - 1;
+  const IndexType prefdist_T0 = 16;
+  const TIndex packed_block_size = block_size / kElementsPerByte;
+  const TIndex fused_block_size = packed_block_size + 8;
+
+  IndexType dataInd = 0;
+  for (IndexType rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+    float* op = &out[rangeIndex * block_size];
+    memset(op, 0, sizeof(float) * block_size);
+    for (IndexType start = dataInd; dataInd < start + lengths[rangeIndex];
+         ++dataInd) {
+      const IndexType idx = indices[dataInd];
+      CAFFE_ENFORCE(
+          idx >= 0 && idx < data_size,
+          "Index ",
+          dataInd,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+      const uint8_t* ip = &input[idx * fused_block_size];
+      const IndexType next_T0 = (dataInd < index_size - prefdist_T0)
+          ? (dataInd + prefdist_T0)
+          : dataInd;
+      const IndexType idx_pref_T0 = indices[next_T0];
+      CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+      const uint8_t* ip_next_T0 = &input[idx_pref_T0 * fused_block_size];
+      for (TIndex offset = 0; offset < fused_block_size; offset += 64) {
+        _mm_prefetch(
+            reinterpret_cast<const char*>(ip_next_T0 + offset), _MM_HINT_T0);
+      }
+
+      float scale_bias[2];
+      memcpy(scale_bias, ip + packed_block_size, sizeof(scale_bias));
+      const float wgt = weights ? weights[dataInd] : 1.f;
+      const float scale = wgt * scale_bias[0];
+      const float bias = wgt * scale_bias[1];
+      const __m256 vscale = _mm256_set1_ps(scale);
+      const __m256 vbias = _mm256_set1_ps(bias);
+
+      TIndex j = 0;
+      for (; j + kValuesPerWord <= block_size; j += kValuesPerWord) {
+        Unpack<BIT_RATE>::Accumulate(
+            ip + j / kElementsPerByte, vscale, vbias, op + j);
+      }
+      for (; j < block_size; ++j) {
+        const uint8_t quantized =
+            (ip[j / kElementsPerByte] >> ((j % kElementsPerByte) * BIT_RATE)) &
+            kMask;
+        op[j] += quantized * scale + bias;
+      }
+    }
+    if (normalize_by_lengths && lengths[rangeIndex]) {
+      const float len_inv = 1.0f / lengths[rangeIndex];
+      const __m256 vlen_inv = _mm256_set1_ps(len_inv);
+      TIndex j = 0;
+      for (; j + 8 <= block_size; j += 8) {
+        _mm256_storeu_ps(
+            &op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));
+      }
+      for (; j < block_size; ++j) {
+        op[j] *= len_inv;
+      }
+    }
+  }
+}
+
+template <typename IndexType>
+void FusedNBitRowwiseEmbeddingLookupDispatch(
+    const int bit_rate,
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const IndexType* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  if (bit_rate == 4) {
+    FusedNBitRowwiseEmbeddingLookupKernel<4>(
+        block_size,
+        output_size,
+        index_size,
+        data_size,
+        input,
+        indices,
+        lengths,
+        weights,
+        normalize_by_lengths,
+        out);
+  } else {
+    FusedNBitRowwiseEmbeddingLookupKernel<2>(
+        block_size,
+        output_size,
+        index_size,
+        data_size,
+        input,
+        indices,
+        lengths,
+        weights,
+        normalize_by_lengths,
+        out);
+  }
+}
+
+} // namespace
+
+void FusedNBitRowwiseEmbeddingLookup_int32_t_uint8_t_float__avx2_fma(
+    const int bit_rate,
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const int32_t* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  FusedNBitRowwiseEmbeddingLookupDispatch(
+      bit_rate,
+      block_size,
+      output_size,
+      index_size,
+      data_size,
+      input,
+      indices,
+      lengths,
+      weights,
+      normalize_by_lengths,
+      out);
+}
+
+void FusedNBitRowwiseEmbeddingLookup_int64_t_uint8_t_float__avx2_fma(
+    const int bit_rate,
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* input,
+    const int64_t* indices,
+    const int* lengths,
+    const float* weights,
+    bool normalize_by_lengths,
+    float* out) {
+  FusedNBitRowwiseEmbeddingLookupDispatch(
+      bit_rate,
+      block_size,
+      output_size,
+      index_size,
+      data_size,
+      input,
+      indices,
+      lengths,
+      weights,
+      normalize_by_lengths,
+      out);
+}
+
+} // namespace caffe2
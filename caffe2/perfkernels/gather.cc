@@ -0,0 +1,205 @@
+#include "caffe2/perfkernels/gather.h"
+
+#include <cstring>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/perfkernels/prefetch_tuner.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation copies one row with memcpy at a time
+template <typename IndexType>
+static void GatherRowsGenericSlow(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const void* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    void* out) {
+  const char* src = static_cast<const char*>(data);
+  char* dst = static_cast<char*>(out);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        for (TIndex k = 0; k < block_bytes; k += 64) {
+          __builtin_prefetch(src + next * block_bytes + k, 0, 1);
+        }
+      }
+    }
+#endif // __GNUC__
+    std::memcpy(dst + i * block_bytes, src + idx * block_bytes, block_bytes);
+  }
+}
+
+// Base implementation dequantizes the same way as
+// Fused8BitRowwiseQuantizedToFloat
+template <typename IndexType>
+static void GatherFused8BitRowwiseGenericSlow(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    float* out) {
+  const TIndex fused_block_size = block_size + 2 * sizeof(float);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+#ifdef __GNUC__
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        for (TIndex k = 0; k < fused_block_size; k += 64) {
+          __builtin_prefetch(data + next * fused_block_size + k, 0, 1);
+        }
+      }
+    }
+#endif // __GNUC__
+    const uint8_t* row = data + idx * fused_block_size;
+    float scale_bias[2];
+    std::memcpy(scale_bias, row + block_size, sizeof(scale_bias));
+    float* y = out + i * block_size;
+    for (TIndex k = 0; k < block_size; ++k) {
+      y[k] = static_cast<float>(row[k]) * scale_bias[0] + scale_bias[1];
+    }
+  }
+}
+
+// Proxy back to generic implementation
+#define GATHER_SPECIALIZATION(IndexType)                               \
+  void GatherRows_##IndexType##__base(                                 \
+      const TIndex block_bytes,                                        \
+      const TIndex index_size,                                         \
+      const TIndex data_size,                                          \
+      const void* data,                                                \
+      const IndexType* indices,                                        \
+      const int prefetch_distance,                                     \
+      void* out) {                                                     \
+    GatherRowsGenericSlow<IndexType>(                                  \
+        block_bytes,                                                   \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch_distance,                                             \
+        out);                                                          \
+  }                                                                    \
+  template <>                                                          \
+  void GatherRows<IndexType>(                                          \
+      const TIndex block_bytes,                                        \
+      const TIndex index_size,                                         \
+      const TIndex data_size,                                          \
+      const void* data,                                                \
+      const IndexType* indices,                                        \
+      void* out) {                                                     \
+    PrefetchDistance prefetch(                                         \
+        "GatherRows_" #IndexType, block_bytes, index_size);            \
+    AVX512_DO(                                                         \
+        GatherRows_##IndexType,                                        \
+        block_bytes,                                                   \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+    AVX2_DO(                                                           \
+        GatherRows_##IndexType,                                        \
+        block_bytes,                                                   \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+    BASE_DO(                                                           \
+        GatherRows_##IndexType,                                        \
+        block_bytes,                                                   \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+  }                                                                    \
+  void GatherFused8BitRowwise_##IndexType##__base(                     \
+      const TIndex block_size,                                         \
+      const TIndex index_size,                                         \
+      const TIndex data_size,                                          \
+      const uint8_t* data,                                             \
+      const IndexType* indices,                                        \
+      const int prefetch_distance,                                     \
+      float* out) {                                                    \
+    GatherFused8BitRowwiseGenericSlow<IndexType>(                      \
+        block_size,                                                    \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch_distance,                                             \
+        out);                                                          \
+  }                                                                    \
+  template <>                                                          \
+  void GatherFused8BitRowwise<IndexType>(                              \
+      const TIndex block_size,                                         \
+      const TIndex index_size,                                         \
+      const TIndex data_size,                                          \
+      const uint8_t* data,                                             \
+      const IndexType* indices,                                        \
+      float* out) {                                                    \
+    PrefetchDistance prefetch(                                         \
+        "GatherFused8BitRowwise_" #IndexType, block_size, index_size); \
+    AVX512_DO(                                                         \
+        GatherFused8BitRowwise_##IndexType,                            \
+        block_size,                                                    \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+    AVX2_FMA_DO(                                                       \
+        GatherFused8BitRowwise_##IndexType,                            \
+        block_size,                                                    \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+    BASE_DO(                                                           \
+        GatherFused8BitRowwise_##IndexType,                            \
+        block_size,                                                    \
+        index_size,                                                    \
+        data_size,                                                     \
+        data,                                                          \
+        indices,                                                       \
+        prefetch.distance(),                                           \
+        out);                                                          \
+  }
+
+GATHER_SPECIALIZATION(int32_t);
+GATHER_SPECIALIZATION(int64_t);
+
+#undef GATHER_SPECIALIZATION
+
+} // namespace caffe2
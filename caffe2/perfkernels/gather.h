@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * Gathers rows of a table of data_size rows of block_bytes bytes each:
+ *
+ * for (i = 0..index_size-1)
+ *   memcpy(out + i * block_bytes, data + indices[i] * block_bytes,
+ *          block_bytes)
+ *
+ * Rows of 32 to 512 bytes that are a multiple of 32 bytes are copied with
+ * unrolled vector loads and stores, and rows indices[i + d] are prefetched,
+ * with the distance d picked by PrefetchDistance (see prefetch_tuner.h).
+ * Throws if an index is out of [0, data_size).
+ */
+template <typename IndexType>
+void GatherRows(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const void* data,
+    const IndexType* indices,
+    void* out);
+
+/**
+ * Gathers and dequantizes rows of a table of data_size rows in the fused
+ * 8-bit rowwise representation (see FloatToFused8BitRowwiseQuantized): each
+ * row holds block_size uint8 values followed by a float scale and a float
+ * bias.
+ *
+ * for (i = 0..index_size-1)
+ *   row = data + indices[i] * (block_size + 8)
+ *   for (k = 0..block_size-1)
+ *     out[i * block_size + k] = row[k] * scale(row) + bias(row)
+ *
+ * The vector versions use fused multiply adds, so results can differ from
+ * the ones of Fused8BitRowwiseQuantizedToFloat in the last bit.
+ * Throws if an index is out of [0, data_size).
+ */
+template <typename IndexType>
+void GatherFused8BitRowwise(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* data,
+    const IndexType* indices,
+    float* out);
+
+} // namespace caffe2
@@ -0,0 +1,190 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const char* row, const TIndex bytes) {
+  for (TIndex k = 0; k < bytes; k += 64) {
+    _mm_prefetch(row + k, _MM_HINT_T0);
+  }
+}
+
+// Copies a row of kBytes bytes, a multiple of 32, or of block_bytes bytes
+// when kBytes is 0
+template <int kBytes>
+inline void CopyRow(const char* src, char* dst, const TIndex block_bytes) {
+  if (kBytes == 0) {
+    std::memcpy(dst, src, block_bytes);
+    return;
+  }
+  for (int k = 0; k < kBytes; k += 32) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dst + k),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + k)));
+  }
+}
+
+template <typename IndexType, int kBytes>
+void GatherRowsKernel(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const char* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    char* out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(data + next * block_bytes, block_bytes);
+      }
+    }
+    CopyRow<kBytes>(
+        data + idx * block_bytes, out + i * block_bytes, block_bytes);
+  }
+}
+
+template <typename IndexType>
+void GatherRowsAVX2(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const void* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    void* out) {
+  const char* src = static_cast<const char*>(data);
+  char* dst = static_cast<char*>(out);
+#define GATHER_ROWS_CASE(Bytes)         \
+  case Bytes:                           \
+    GatherRowsKernel<IndexType, Bytes>( \
+        block_bytes,                    \
+        index_size,                     \
+        data_size,                      \
+        src,                            \
+        indices,                        \
+        prefetch_distance,              \
+        dst);                           \
+    return;
+  switch (block_bytes) {
+    GATHER_ROWS_CASE(32)
+    GATHER_ROWS_CASE(64)
+    GATHER_ROWS_CASE(128)
+    GATHER_ROWS_CASE(256)
+    GATHER_ROWS_CASE(512)
+    default:
+      GatherRowsKernel<IndexType, 0>(
+          block_bytes,
+          index_size,
+          data_size,
+          src,
+          indices,
+          prefetch_distance,
+          dst);
+  }
+#undef GATHER_ROWS_CASE
+}
+
+template <typename IndexType>
+void GatherFused8BitRowwiseAVX2(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    float* out) {
+  const TIndex fused_block_size = block_size + 2 * sizeof(float);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(
+            reinterpret_cast<const char*>(data + next * fused_block_size),
+            fused_block_size);
+      }
+    }
+    const uint8_t* row = data + idx * fused_block_size;
+    float scale_bias[2];
+    std::memcpy(scale_bias, row + block_size, sizeof(scale_bias));
+    const __m256 vscale = _mm256_set1_ps(scale_bias[0]);
+    const __m256 vbias = _mm256_set1_ps(scale_bias[1]);
+    float* y = out + i * block_size;
+    TIndex k = 0;
+    for (; k + 8 <= block_size; k += 8) {
+      const __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + k))));
+      _mm256_storeu_ps(y + k, _mm256_fmadd_ps(v, vscale, vbias));
+    }
+    for (; k < block_size; ++k) {
+      y[k] = static_cast<float>(row[k]) * scale_bias[0] + scale_bias[1];
+    }
+  }
+}
+
+} // namespace
+
+#define GATHER_AVX2(IndexType)                         \
+  void GatherRows_##IndexType##__avx2(                 \
+      const TIndex block_bytes,                        \
+      const TIndex index_size,                         \
+      const TIndex data_size,                          \
+      const void* data,                                \
+      const IndexType* indices,                        \
+      const int prefetch_distance,                     \
+      void* out) {                                     \
+    GatherRowsAVX2(                                    \
+        block_bytes,                                   \
+        index_size,                                    \
+        data_size,                                     \
+        data,                                          \
+        indices,                                       \
+        prefetch_distance,                             \
+        out);                                          \
+  }                                                    \
+  void GatherFused8BitRowwise_##IndexType##__avx2_fma( \
+      const TIndex block_size,                         \
+      const TIndex index_size,                         \
+      const TIndex data_size,                          \
+      const uint8_t* data,                             \
+      const IndexType* indices,                        \
+      const int prefetch_distance,                     \
+      float* out) {                                    \
+    GatherFused8BitRowwiseAVX2(                        \
+        block_size,                                    \
+        index_size,                                    \
+        data_size,                                     \
+        data,                                          \
+        indices,                                       \
+        prefetch_distance,                             \
+        out);                                          \
+  }
+
+GATHER_AVX2(int32_t);
+GATHER_AVX2(int64_t);
+
+#undef GATHER_AVX2
+
+} // namespace caffe2
@@ -0,0 +1,193 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline void PrefetchRow(const char* row, const TIndex bytes) {
+  for (TIndex k = 0; k < bytes; k += 64) {
+    _mm_prefetch(row + k, _MM_HINT_T0);
+  }
+}
+
+// Copies a row of kBytes bytes, a multiple of 64, or of block_bytes bytes
+// when kBytes is 0, in which case the last partial vector is masked
+template <int kBytes>
+inline void CopyRow(const char* src, char* dst, const TIndex block_bytes) {
+  const TIndex bytes = kBytes == 0 ? block_bytes : kBytes;
+  TIndex k = 0;
+  for (; k + 64 <= bytes; k += 64) {
+    _mm512_storeu_si512(dst + k, _mm512_loadu_si512(src + k));
+  }
+  if (kBytes == 0 && k < bytes) {
+    const __mmask64 mask = (1ULL << (bytes - k)) - 1;
+    _mm512_mask_storeu_epi8(
+        dst + k, mask, _mm512_maskz_loadu_epi8(mask, src + k));
+  }
+}
+
+template <typename IndexType, int kBytes>
+void GatherRowsKernel(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const char* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    char* out) {
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(data + next * block_bytes, block_bytes);
+      }
+    }
+    CopyRow<kBytes>(
+        data + idx * block_bytes, out + i * block_bytes, block_bytes);
+  }
+}
+
+template <typename IndexType>
+void GatherRowsAVX512(
+    const TIndex block_bytes,
+    const TIndex index_size,
+    const TIndex data_size,
+    const void* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    void* out) {
+  const char* src = static_cast<const char*>(data);
+  char* dst = static_cast<char*>(out);
+#define GATHER_ROWS_CASE(Bytes)         \
+  case Bytes:                           \
+    GatherRowsKernel<IndexType, Bytes>( \
+        block_bytes,                    \
+        index_size,                     \
+        data_size,                      \
+        src,                            \
+        indices,                        \
+        prefetch_distance,              \
+        dst);                           \
+    return;
+  switch (block_bytes) {
+    GATHER_ROWS_CASE(64)
+    GATHER_ROWS_CASE(128)
+    GATHER_ROWS_CASE(256)
+    GATHER_ROWS_CASE(512)
+    default:
+      GatherRowsKernel<IndexType, 0>(
+          block_bytes,
+          index_size,
+          data_size,
+          src,
+          indices,
+          prefetch_distance,
+          dst);
+  }
+#undef GATHER_ROWS_CASE
+}
+
+template <typename IndexType>
+void GatherFused8BitRowwiseAVX512(
+    const TIndex block_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const uint8_t* data,
+    const IndexType* indices,
+    const int prefetch_distance,
+    float* out) {
+  const TIndex fused_block_size = block_size + 2 * sizeof(float);
+  for (TIndex i = 0; i < index_size; ++i) {
+    const TIndex idx = indices[i];
+    CAFFE_ENFORCE(
+        0 <= idx && idx < data_size,
+        "INDICES element is out of DATA bounds, id=",
+        idx,
+        " data_dim=",
+        data_size);
+    if (prefetch_distance > 0 && i + prefetch_distance < index_size) {
+      const TIndex next = indices[i + prefetch_distance];
+      if (0 <= next && next < data_size) {
+        PrefetchRow(
+            reinterpret_cast<const char*>(data + next * fused_block_size),
+            fused_block_size);
+      }
+    }
+    const uint8_t* row = data + idx * fused_block_size;
+    float scale_bias[2];
+    std::memcpy(scale_bias, row + block_size, sizeof(scale_bias));
+    const __m512 vscale = _mm512_set1_ps(scale_bias[0]);
+    const __m512 vbias = _mm512_set1_ps(scale_bias[1]);
+    float* y = out + i * block_size;
+    TIndex k = 0;
+    for (; k + 16 <= block_size; k += 16) {
+      const __m512 v = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k))));
+      _mm512_storeu_ps(y + k, _mm512_fmadd_ps(v, vscale, vbias));
+    }
+    if (k < block_size) {
+      const __mmask16 mask = (1U << (block_size - k)) - 1;
+      const __m512 v = _mm512_cvtepi32_ps(
+          _mm512_cvtepu8_epi32(_mm_maskz_loadu_epi8(mask, row + k)));
+      _mm512_mask_storeu_ps(y + k, mask, _mm512_fmadd_ps(v, vscale, vbias));
+    }
+  }
+}
+
+} // namespace
+
+#define GATHER_AVX512(IndexType)                     \
+  void GatherRows_##IndexType##__avx512(             \
+      const TIndex block_bytes,                      \
+      const TIndex index_size,                       \
+      const TIndex data_size,                        \
+      const void* data,                              \
+      const IndexType* indices,                      \
+      const int prefetch_distance,                   \
+      void* out) {                                   \
+    GatherRowsAVX512(                                \
+        block_bytes,                                 \
+        index_size,                                  \
+        data_size,                                   \
+        data,                                        \
+        indices,                                     \
+        prefetch_distance,                           \
+        out);                                        \
+  }                                                  \
+  void GatherFused8BitRowwise_##IndexType##__avx512( \
+      const TIndex block_size,                       \
+      const TIndex index_size,                       \
+      const TIndex data_size,                        \
+      const uint8_t* data,                           \
+      const IndexType* indices,                      \
+      const int prefetch_distance,                   \
+      float* out) {                                  \
+    GatherFused8BitRowwiseAVX512(                    \
+        block_size,                                  \
+        index_size,                                  \
+        data_size,                                   \
+        data,                                        \
+        indices,                                     \
+        prefetch_distance,                           \
+        out);                                        \
+  }
+
+GATHER_AVX512(int32_t);
+GATHER_AVX512(int64_t);
+
+#undef GATHER_AVX512
+
+} // namespace caffe2
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+// Converts N floats to float16, rounding to nearest even.
+void FloatToFloat16(const TIndex N, const float* x, float16* y);
+
+// Converts N float16 values to float.
+void Float16ToFloat(const TIndex N, const float16* x, float* y);
+
+} // namespace caffe2
@@ -0,0 +1,34 @@
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/cvtsh_ss_bugfix.h"
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+namespace caffe2 {
+
+void FloatToFloat16__avx_f16c(const TIndex N, const float* x, float16* y) {
+  TIndex i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(y + i),
+        _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i < N; ++i) {
+    y[i].x = _cvtss_sh(x[i], _MM_FROUND_TO_NEAREST_INT);
+  }
+}
+
+void Float16ToFloat__avx_f16c(const TIndex N, const float16* x, float* y) {
+  TIndex i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i,
+        _mm256_cvtph_ps(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))));
+  }
+  for (; i < N; ++i) {
+    y[i] = _cvtsh_ss(x[i].x);
+  }
+}
+
+} // namespace caffe2
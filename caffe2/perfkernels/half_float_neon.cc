@@ -0,0 +1,48 @@
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#include "caffe2/core/types.h"
+#include "caffe2/utils/conversions.h"
+
+// The vector conversions need the half precision extension of NEON, which
+// ARMv8 always has
+#if defined(__aarch64__) || (defined(__ARM_NEON_FP) && (__ARM_NEON_FP & 2))
+#define CAFFE2_PERF_NEON_FP16_CONVERSION
+#endif
+
+namespace caffe2 {
+
+void FloatToFloat16__neon(const TIndex N, const float* x, float16* y) {
+  TIndex i = 0;
+#ifdef CAFFE2_PERF_NEON_FP16_CONVERSION
+  for (; i + 8 <= N; i += 8) {
+    const float16x4_t lo = vcvt_f16_f32(vld1q_f32(x + i));
+    const float16x4_t hi = vcvt_f16_f32(vld1q_f32(x + i + 4));
+    vst1q_u16(
+        reinterpret_cast<uint16_t*>(y + i),
+        vcombine_u16(vreinterpret_u16_f16(lo), vreinterpret_u16_f16(hi)));
+  }
+#endif
+  for (; i < N; ++i) {
+    y[i] = convert::cpu_float2half_rn(x[i]);
+  }
+}
+
+void Float16ToFloat__neon(const TIndex N, const float16* x, float* y) {
+  TIndex i = 0;
+#ifdef CAFFE2_PERF_NEON_FP16_CONVERSION
+  for (; i + 8 <= N; i += 8) {
+    const uint16x8_t h = vld1q_u16(reinterpret_cast<const uint16_t*>(x + i));
+    vst1q_f32(y + i, vcvt_f32_f16(vreinterpret_f16_u16(vget_low_u16(h))));
+    vst1q_f32(y + i + 4, vcvt_f32_f16(vreinterpret_f16_u16(vget_high_u16(h))));
+  }
+#endif
+  for (; i < N; ++i) {
+    y[i] = convert::cpu_half2float(x[i]);
+  }
+}
+
+} // namespace caffe2
+
+#endif // __ARM_NEON__
@@ -7,38 +7,63 @@ import sys
 
 sizeof = {'float': 4, 'float16': 2, 'uint8_t': 1}
 
+# Per instruction set: the float vector type and width, the prefix of its
+# intrinsics, and how a vector of floats is loaded from {ptr} for every
+# input type. AVX-512 kernels handle the leftover of block sizes that are not
+# a multiple of the vector width with masked loads ({mask}) and stores, the
+# 16-bit and 8-bit masked loads need AVX-512BW and VL.
+isas = {
+    'avx2': {
+        'suffix': '__avx2_fma',
+        'vtype': '__m256',
+        'vlen': 8,
+        'mm': '_mm256',
+        'load': {
+            'float': '_mm256_loadu_ps({ptr})',
+            'float16': '_mm256_cvtph_ps(_mm_loadu_si128('
+                       'reinterpret_cast<const __m128i*>({ptr})))',
+            'uint8_t': '_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32('
+                       '_mm_loadl_epi64(reinterpret_cast<const __m128i*>({ptr}))))',
+        },
+    },
+    'avx512': {
+        'suffix': '__avx512',
+        'vtype': '__m512',
+        'vlen': 16,
+        'mm': '_mm512',
+        'load': {
+            'float': '_mm512_loadu_ps({ptr})',
+            'float16': '_mm512_cvtph_ps(_mm256_loadu_si256('
+                       'reinterpret_cast<const __m256i*>({ptr})))',
+            'uint8_t': '_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32('
+                       '_mm_loadu_si128(reinterpret_cast<const __m128i*>({ptr}))))',
+        },
+        'masked_load': {
+            'float': '_mm512_maskz_loadu_ps({mask}, {ptr})',
+            'float16': '_mm512_cvtph_ps(_mm256_maskz_loadu_epi16({mask}, {ptr}))',
+            'uint8_t': '_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32('
+                       '_mm_maskz_loadu_epi8({mask}, {ptr})))',
+        },
+    },
+}
+
 
 def unroll(uf, IndexType, InType, OutType, use_weights, isa, fused):
-    def compute(regid, InType, use_weights, isa, prefetch):
+    def compute(regid, InType, use_weights, isa):
         code = []
+        mm = isa['mm']
+        load = isa['load'][InType].format(ptr='ip + (%d)' % regid)
 
-        if InType == "float":
+        if InType == "uint8_t":
             code.append(
-                "vop%d = _mm256_fmadd_ps(vwgt,  \
-                  _mm256_loadu_ps(ip + (%d)), vop%d);"
-                                                       % (regid, regid, regid)
+                "vop%d = %s_fmadd_ps(vwgt, %s, %s_add_ps(vop%d, vbio));"
+                % (regid, mm, load, mm, regid)
             )
-        elif InType == "float16":
-            code.append(
-                "vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ip + (%d)))), \
-                   vop%d);"
-                            % (regid, regid, regid)
-            )
-        elif InType == "uint8_t":
+        else:
             code.append(
-                "vop%d = _mm256_fmadd_ps(vwgt,  \
-                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ip + (%d))))), \
-                   _mm256_add_ps(vop%d, vbio));"
-                                                 % (regid, regid, regid)
+                "vop%d = %s_fmadd_ps(vwgt, %s, vop%d);"
+                % (regid, mm, load, regid)
             )
-        else:
-            assert False
-
-        if prefetch:
-            code.append("_mm_prefetch((&ip_next_T0[%d]), _MM_HINT_T0);" % (regid))
-        else:
-            code.append("// skip unnecessary prefetch of (&ip_next_T0[%d])" % (regid))
 
         return code
 
@@ -48,9 +73,12 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa, fused):
     code.append("for (" + IndexType +
                 " rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {")
     code.append(OutType + " *op = &out[rangeIndex * block_size];")
+    vtype = isa['vtype']
+    mm = isa['mm']
+    vlen = isa['vlen']
     for i in range(0, uf):
-        j = 8 * i
-        code.append("__m256 vop" + str(j) + " = _mm256_setzero_ps();")
+        j = vlen * i
+        code.append(vtype + " vop" + str(j) + " = " + mm + "_setzero_ps();")
 
     # inner loop
     code.append("for (" + IndexType +
@@ -77,16 +105,18 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa, fused):
         else:
             code.append("bio = wgt * scale_bias[2 * idx + 1];")
             code.append("wgt = wgt * scale_bias[2 * idx];")
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
+        code.append(vtype + " vbio = " + mm + "_set1_ps(bio);")
     else:
         code.append(OutType + " wgt = 1.f;")
         code.append("if (weights) {")
         code.append(
             "wgt = weights[IS_WEIGHT_POSITIONAL ? (dataInd - start) : dataInd];")
         code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
+    code.append(vtype + " vwgt = " + mm + "_set1_ps(wgt);")
 
     code.append("const {} *ip = &input[idx * fused_block_size];".format(InType))
+    # A prefetch distance of 0 skips the prefetch of later rows entirely
+    code.append("if (prefdist_T0 > 0) {")
     code.append(
         'const {} next_T0 = (dataInd < index_size - prefdist_T0)'
         ' ? (dataInd + prefdist_T0) : dataInd;'.format(IndexType)
@@ -99,28 +129,33 @@ def unroll(uf, IndexType, InType, OutType, use_weights, isa, fused):
         'const {} *ip_next_T0 = &input[idx_pref_T0'
         ' * fused_block_size];'.format(InType)
     )
-
+    # one prefetch per cache line
     for i in range(0, uf):
-        j = 8 * i
+        j = vlen * i
         cachelinesize = 64
         byteoffset = sizeof[InType] * j
-        prefetch = (byteoffset % cachelinesize) == 0
-        code.extend(compute(j, InType, use_weights, isa, prefetch))
+        if (byteoffset % cachelinesize) == 0:
+            code.append("_mm_prefetch((&ip_next_T0[%d]), _MM_HINT_T0);" % (j))
+    code.append("}")
+
+    for i in range(0, uf):
+        j = vlen * i
+        code.extend(compute(j, InType, use_weights, isa))
     code.append("}")
 
     code.append("if (normalize_by_lengths == false) {")
     for i in range(0, uf):
-        j = 8 * i
+        j = vlen * i
         code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], vop" + str(j) + ");")
+            mm + "_storeu_ps(&op[" + str(j) + "], vop" + str(j) + ");")
     code.append("} else if (lengths[rangeIndex]) {")
     # inv of length
     code.append(
-        "__m256 vlen_inv = _mm256_set1_ps(1.0f / lengths[rangeIndex]);")
+        vtype + " vlen_inv = " + mm + "_set1_ps(1.0f / lengths[rangeIndex]);")
     for i in range(0, uf):
-        j = 8 * i
+        j = vlen * i
         code.append(
-            "_mm256_storeu_ps(&op[" + str(j) + "], _mm256_mul_ps(" + "vop" + str(j) + ", vlen_inv));")
+            mm + "_storeu_ps(&op[" + str(j) + "], " + mm + "_mul_ps(" + "vop" + str(j) + ", vlen_inv));")
     code.append("}")
 
     code.append("}")
@@ -131,35 +166,39 @@ def generic(IndexType, InType, OutType, use_weights, isa, fused):
 
     def compute(InType, use_weights, isa):
         code = []
-        if InType == "float":
-            code.append(
-                "_mm256_storeu_ps(&op[j], \
-                                 _mm256_fmadd_ps(vwgt,_mm256_loadu_ps(&ip[j]), _mm256_loadu_ps(&op[j])) \
-                                   );"
-            )
-        elif InType == "float16":
-            code.append(
-                "_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&ip[j]))), _mm256_loadu_ps(&op[j])) \
-                                   );"
-            )
-        elif InType == "uint8_t":
-            code.append(
-                "_mm256_storeu_ps(&op[j], \
-                   _mm256_fmadd_ps(vwgt, \
-                     _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&ip[j])))), \
-                     _mm256_add_ps(_mm256_loadu_ps(&op[j]), vbio) ) \
-                                   );"
-            )
-        else:
-            assert False
+        mm = isa['mm']
+        load = isa['load'][InType].format(ptr='&ip[j]')
+        acc = mm + "_loadu_ps(&op[j])"
+        if InType == "uint8_t":
+            acc = mm + "_add_ps(" + acc + ", vbio)"
+        code.append(
+            mm + "_storeu_ps(&op[j], " + mm + "_fmadd_ps(vwgt, " + load +
+            ", " + acc + "));")
 
-        code.append("_mm_prefetch((&ip_next_T0[j]), _MM_HINT_T0);")
+        return code
 
+    def compute_masked(InType, use_weights, isa):
+        code = []
+        mm = isa['mm']
+        load = isa['masked_load'][InType].format(ptr='&ip[j]', mask='tail_mask')
+        acc = mm + "_maskz_loadu_ps(tail_mask, &op[j])"
+        if InType == "uint8_t":
+            acc = mm + "_add_ps(" + acc + ", vbio)"
+        code.append(
+            mm + "_mask_storeu_ps(&op[j], tail_mask, " + mm + "_fmadd_ps(vwgt, " +
+            load + ", " + acc + "));")
         return code
 
+    vtype = isa['vtype']
+    mm = isa['mm']
+    vlen = str(isa['vlen'])
+    masked = 'masked_load' in isa
+
     code = []
+    if masked:
+        code.append(
+            "const __mmask16 tail_mask = (1 << (block_size % " + vlen +
+            ")) - 1;")
     code.append(IndexType + " dataInd = 0;")
     code.append("for (" + IndexType +
                 " rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {")
@@ -167,12 +206,18 @@ def generic(IndexType, InType, OutType, use_weights, isa, fused):
 
     # initialize to 0
     code.append("TIndex j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
-    code.append("_mm256_storeu_ps(op + j, _mm256_setzero_ps());")
-    code.append("}")
-    code.append("for(; j < block_size; j++) {")
-    code.append("op[j] = 0.0f;")
+    code.append("for(; j + " + vlen + " <= block_size; j += " + vlen + ") {")
+    code.append(mm + "_storeu_ps(op + j, " + mm + "_setzero_ps());")
     code.append("}")
+    if masked:
+        code.append("if (j < block_size) {")
+        code.append(mm + "_mask_storeu_ps(op + j, tail_mask, " + mm +
+                    "_setzero_ps());")
+        code.append("}")
+    else:
+        code.append("for(; j < block_size; j++) {")
+        code.append("op[j] = 0.0f;")
+        code.append("}")
 
     # inner loop
     code.append("for (" + IndexType +
@@ -200,16 +245,18 @@ def generic(IndexType, InType, OutType, use_weights, isa, fused):
             code.append("assert (scale_bias);")
             code.append("bio = wgt * scale_bias[2 * idx + 1];")
             code.append("wgt = wgt * scale_bias[2 * idx];")
-        code.append("__m256 vbio = _mm256_set1_ps(bio);")
+        code.append(vtype + " vbio = " + mm + "_set1_ps(bio);")
     else:
         code.append(OutType + " wgt = 1.f;")
         code.append("if (weights) {")
         code.append(
             "wgt = weights[IS_WEIGHT_POSITIONAL ? (dataInd - start) : dataInd];")
         code.append("}")
-    code.append("__m256 vwgt = _mm256_set1_ps(wgt);")
+    code.append(vtype + " vwgt = " + mm + "_set1_ps(wgt);")
 
     code.append("const {} *ip = &input[idx * fused_block_size];".format(InType))
+    # A prefetch distance of 0 skips the prefetch of later rows entirely
+    code.append("if (prefdist_T0 > 0) {")
     code.append(
         'const {} next_T0 = (dataInd < index_size - prefdist_T0)'
         ' ? (dataInd + prefdist_T0) : dataInd;'.format(IndexType)
@@ -221,42 +268,63 @@ def generic(IndexType, InType, OutType, use_weights, isa, fused):
         "const {} *ip_next_T0 = &input[idx_pref_T0 * fused_block_size];".
         format(InType)
     )
+    # one prefetch per cache line
+    code.append(
+        "for (TIndex k = 0; k < block_size; k += {}) {{".
+        format(64 // sizeof[InType])
+    )
+    code.append("_mm_prefetch((&ip_next_T0[k]), _MM_HINT_T0);")
+    code.append("}")
+    code.append("}")
 
     # compute and store main loop
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
+    code.append("for(; j + " + vlen + " <= block_size; j += " + vlen + ") {")
     code.extend(compute(InType, use_weights, isa))
     code.append("}")
     # leftover
-    if InType == "float16":
-        code.append("float16 vtmp1[8] CAFFE2_ALIGNED(64);")
-    code.append("for(; j < block_size; j++) {")
-    if InType == "float":
-        code.append("op[j] += wgt * ip[j];")
-    elif InType == "float16":
-        code.append("vtmp1[0] = ip[j];")
-        code.append("__m256 vtmp2 = _mm256_cvtph_ps(*((__m128i*)vtmp1));")
-        code.append("op[j] += wgt * ((float*)(&vtmp2))[0];")
-    elif InType == "uint8_t":
-        code.append("op[j] += wgt * ((float)ip[j]) + bio;")
+    if masked:
+        code.append("if (j < block_size) {")
+        code.extend(compute_masked(InType, use_weights, isa))
+        code.append("}")
     else:
-        assert False
+        if InType == "float16":
+            code.append("float16 vtmp1[8] CAFFE2_ALIGNED(64);")
+        code.append("for(; j < block_size; j++) {")
+        if InType == "float":
+            code.append("op[j] += wgt * ip[j];")
+        elif InType == "float16":
+            code.append("vtmp1[0] = ip[j];")
+            code.append("__m256 vtmp2 = _mm256_cvtph_ps(*((__m128i*)vtmp1));")
+            code.append("op[j] += wgt * ((float*)(&vtmp2))[0];")
+        elif InType == "uint8_t":
+            code.append("op[j] += wgt * ((float)ip[j]) + bio;")
+        else:
+            assert False
 
-    code.append("}")
+        code.append("}")
 
     code.append("}")
 
     code.append("if (normalize_by_lengths && lengths[rangeIndex]) {")
     code.append("float len_inv = 1.0f / lengths[rangeIndex];")
-    code.append("__m256 vlen_inv = _mm256_set1_ps(len_inv);")
+    code.append(vtype + " vlen_inv = " + mm + "_set1_ps(len_inv);")
     code.append("j = 0;")
-    code.append("for(; j + 8 <= block_size; j += 8) {")
+    code.append("for(; j + " + vlen + " <= block_size; j += " + vlen + ") {")
     code.append(
-        "_mm256_storeu_ps(&op[j], _mm256_mul_ps(_mm256_loadu_ps(&op[j]), vlen_inv));")
-    code.append("}")
-    code.append("for(; j < block_size; j++) {")
-    code.append("op[j] = len_inv * op[j];")
+        mm + "_storeu_ps(&op[j], " + mm + "_mul_ps(" + mm +
+        "_loadu_ps(&op[j]), vlen_inv));")
     code.append("}")
+    if masked:
+        code.append("if (j < block_size) {")
+        code.append(
+            mm + "_mask_storeu_ps(&op[j], tail_mask, " + mm + "_mul_ps(" + mm +
+            "_maskz_loadu_ps(tail_mask, &op[j]), vlen_inv));")
+        code.append("}")
+    else:
+        code.append("for(; j < block_size; j++) {")
+        code.append("op[j] = len_inv * op[j];")
+        code.append("}")
 
     code.append("}")
 
@@ -268,13 +336,15 @@ def generic(IndexType, InType, OutType, use_weights, isa, fused):
 parser = argparse.ArgumentParser()
 parser.add_argument('-f', '--filename', help="file name")
 parser.add_argument('--fused', action='store_true')
+parser.add_argument('--isa', choices=sorted(isas.keys()), default='avx2')
 opts = parser.parse_args()
+isa = isas[opts.isa]
 if opts.filename:
     filename = opts.filename
 elif opts.fused:
-    filename = "embedding_lookup_fused_8bit_rowwise_avx2.cc"
+    filename = "embedding_lookup_fused_8bit_rowwise_{}.cc".format(opts.isa)
 else:
-    filename = "embedding_lookup_avx2.cc"
+    filename = "embedding_lookup_{}.cc".format(opts.isa)
 fout = open(filename, 'w')
 
 options = [["int32_t", "float", "float"],
@@ -307,7 +377,7 @@ for o in options:
     fn_base = '{}EmbeddingLookup_{}_{}_{}'.format(
         prefix, IndexType, InType, OutType
     )
-    suffix = '__avx2_fma'
+    suffix = isa['suffix']
     fn = "static void " + fn_base + suffix
     code.append(fn + "(")
 
@@ -323,11 +393,12 @@ for o in options:
     if not opts.fused:
         args.append("const float* scale_bias,")
     args.append("bool normalize_by_lengths,")
+    args.append("const int prefetch_distance,")
     args.append(OutType + "* out)")
     code += args
 
     code.append("{")
-    code.append("const " + IndexType + " prefdist_T0 = 16;")
+    code.append("const " + IndexType + " prefdist_T0 = prefetch_distance;")
     # block_size is the number of elements and fused_block_size is the size of
     # an entire row, including scale and bias.
     offset = (8 // sizeof[InType]) if opts.fused else 0
@@ -349,17 +420,15 @@ for o in options:
                 ' "scale_bias must not be nullptr");'
             )
 
-    code.append("if (block_size == 128) {")
-    code += unroll(16, IndexType, InType, OutType, True, "AVX2", opts.fused)
-    code.append("} else if (block_size == 64) {")
-    code += unroll(8, IndexType, InType, OutType, True, "AVX2", opts.fused)
-    code.append("} else if (block_size == 32) {")
-    code += unroll(4, IndexType, InType, OutType, True, "AVX2", opts.fused)
-    code.append("} else if (block_size == 16) {")
-    code += unroll(2, IndexType, InType, OutType, True, "AVX2", opts.fused)
+    # Block sizes with fully unrolled kernels, largest first
+    for i, block_size in enumerate([128, 64, 32, 16]):
+        code.append("{}if (block_size == {}) {{".format(
+            "} else " if i else "", block_size))
+        code += unroll(block_size // isa['vlen'], IndexType, InType, OutType,
+                       True, isa, opts.fused)
     code.append("} else {")
     code.append("// generic code")
-    code += generic(IndexType, InType, OutType, True, "AVX2", opts.fused)
+    code += generic(IndexType, InType, OutType, True, isa, opts.fused)
     code.append("}")
 
     code.append("}")
@@ -381,6 +450,7 @@ for o in options:
         if not opts.fused:
             code.append("scale_bias,")
         code.append("normalize_by_lengths,")
+        code.append("prefetch_distance,")
         code.append("out);")
         code.append("}")
 
@@ -0,0 +1,59 @@
+#include "caffe2/perfkernels/index_hash.h"
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void IndexHashInt32__base(
+    const TIndex n,
+    const int32_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int32_t* buckets) {
+  const FixedDivisor<int64_t> divisor(modulo);
+  for (TIndex i = 0; i < n; ++i) {
+    buckets[i] = static_cast<int32_t>(detail::PositiveMod(
+        detail::IndexHashOne<int32_t, uint32_t>(ids[i], seed),
+        divisor,
+        modulo));
+  }
+}
+
+void IndexHashInt64__base(
+    const TIndex n,
+    const int64_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int64_t* buckets) {
+  const FixedDivisor<int64_t> divisor(modulo);
+  for (TIndex i = 0; i < n; ++i) {
+    buckets[i] = detail::PositiveMod(
+        detail::IndexHashOne<int64_t, uint64_t>(ids[i], seed),
+        divisor,
+        modulo);
+  }
+}
+
+void IndexHashInt32(
+    const TIndex n,
+    const int32_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int32_t* buckets) {
+  AVX2_DO(IndexHashInt32, n, ids, seed, modulo, buckets);
+  BASE_DO(IndexHashInt32, n, ids, seed, modulo, buckets);
+}
+
+void IndexHashInt64(
+    const TIndex n,
+    const int64_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int64_t* buckets) {
+  AVX2_DO(IndexHashInt64, n, ids, seed, modulo, buckets);
+  BASE_DO(IndexHashInt64, n, ids, seed, modulo, buckets);
+}
+
+} // namespace caffe2
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+#include "caffe2/core/common.h"
+#include "caffe2/utils/fixed_divisor.h"
+
+namespace caffe2 {
+
+/**
+ * The buckets of the IndexHash operator: for each id, a hash of its bytes,
+ * seeded by seed, modulo modulo into [0, modulo). The hash and the modulo are
+ * computed in one pass, and the modulo with a FixedDivisor instead of a
+ * division. modulo must be positive.
+ *
+ * The AVX2 versions hash 8 ids at a time, in 64 or 32 bit lanes.
+ */
+void IndexHashInt32(
+    const TIndex n,
+    const int32_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int32_t* buckets);
+
+void IndexHashInt64(
+    const TIndex n,
+    const int64_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int64_t* buckets);
+
+namespace detail {
+
+// The scalar hash of IndexHash: seed * 0xDEADBEEF, then times 65537 plus
+// every signed byte of id, little endian first, wrapping around like T.
+template <typename T, typename U>
+inline T IndexHashOne(const T id, const int64_t seed) {
+  U hashed = static_cast<U>(static_cast<uint64_t>(seed) * 0xDEADBEEFULL);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    const int8_t byte = static_cast<int8_t>(static_cast<U>(id) >> (8 * i));
+    hashed = hashed * 65537 + static_cast<U>(static_cast<T>(byte));
+  }
+  return static_cast<T>(hashed);
+}
+
+// hashed modulo d in [0, d)
+inline int64_t PositiveMod(
+    const int64_t hashed,
+    const FixedDivisor<int64_t>& divisor,
+    const int64_t d) {
+  const int64_t r = divisor.mod(hashed);
+  return r >= 0 ? r : r + d;
+}
+
+} // namespace detail
+
+} // namespace caffe2
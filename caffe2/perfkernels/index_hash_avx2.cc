@@ -0,0 +1,112 @@
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/index_hash.h"
+
+namespace caffe2 {
+
+namespace {
+
+// hashed * 65537 + byte, without a 64 bit multiplication
+inline __m256i HashStep64(const __m256i hashed, const __m256i byte) {
+  return _mm256_add_epi64(
+      _mm256_add_epi64(_mm256_slli_epi64(hashed, 16), hashed), byte);
+}
+
+inline __m256i HashStep32(const __m256i hashed, const __m256i byte) {
+  return _mm256_add_epi32(
+      _mm256_add_epi32(_mm256_slli_epi32(hashed, 16), hashed), byte);
+}
+
+// Hashes 4 int64 ids. AVX2 has no 64 bit arithmetic shift, so the low byte
+// of the remaining bytes is sign extended as u - 2 * (u & 0x80).
+inline __m256i Hash64(__m256i ids, const __m256i init) {
+  const __m256i byte_mask = _mm256_set1_epi64x(0xFF);
+  const __m256i sign_bit = _mm256_set1_epi64x(0x80);
+  __m256i hashed = init;
+  for (int i = 0; i < 8; ++i) {
+    const __m256i u = _mm256_and_si256(ids, byte_mask);
+    const __m256i byte = _mm256_sub_epi64(
+        u, _mm256_slli_epi64(_mm256_and_si256(u, sign_bit), 1));
+    hashed = HashStep64(hashed, byte);
+    ids = _mm256_srli_epi64(ids, 8);
+  }
+  return hashed;
+}
+
+// Hashes 8 int32 ids
+inline __m256i Hash32(__m256i ids, const __m256i init) {
+  __m256i hashed = init;
+  for (int i = 0; i < 4; ++i) {
+    const __m256i byte = _mm256_srai_epi32(_mm256_slli_epi32(ids, 24), 24);
+    hashed = HashStep32(hashed, byte);
+    ids = _mm256_srli_epi32(ids, 8);
+  }
+  return hashed;
+}
+
+} // namespace
+
+void IndexHashInt32__avx2(
+    const TIndex n,
+    const int32_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int32_t* buckets) {
+  const FixedDivisor<int64_t> divisor(modulo);
+  const __m256i init = _mm256_set1_epi32(static_cast<int32_t>(
+      static_cast<uint32_t>(static_cast<uint64_t>(seed) * 0xDEADBEEFULL)));
+  alignas(32) int32_t hashed[8];
+  TIndex i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_store_si256(
+        reinterpret_cast<__m256i*>(hashed),
+        Hash32(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i)),
+            init));
+    for (int j = 0; j < 8; ++j) {
+      buckets[i + j] = static_cast<int32_t>(
+          detail::PositiveMod(hashed[j], divisor, modulo));
+    }
+  }
+  for (; i < n; ++i) {
+    buckets[i] = static_cast<int32_t>(detail::PositiveMod(
+        detail::IndexHashOne<int32_t, uint32_t>(ids[i], seed),
+        divisor,
+        modulo));
+  }
+}
+
+void IndexHashInt64__avx2(
+    const TIndex n,
+    const int64_t* ids,
+    const int64_t seed,
+    const int64_t modulo,
+    int64_t* buckets) {
+  const FixedDivisor<int64_t> divisor(modulo);
+  const __m256i init = _mm256_set1_epi64x(
+      static_cast<int64_t>(static_cast<uint64_t>(seed) * 0xDEADBEEFULL));
+  alignas(32) int64_t hashed[8];
+  TIndex i = 0;
+  // Two independent vectors of 4 ids, so that their hashes overlap
+  for (; i + 8 <= n; i += 8) {
+    const __m256i lo = Hash64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i)), init);
+    const __m256i hi = Hash64(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ids + i + 4)),
+        init);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(hashed), lo);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(hashed + 4), hi);
+    for (int j = 0; j < 8; ++j) {
+      buckets[i + j] = detail::PositiveMod(hashed[j], divisor, modulo);
+    }
+  }
+  for (; i < n; ++i) {
+    buckets[i] = detail::PositiveMod(
+        detail::IndexHashOne<int64_t, uint64_t>(ids[i], seed),
+        divisor,
+        modulo);
+  }
+}
+
+} // namespace caffe2
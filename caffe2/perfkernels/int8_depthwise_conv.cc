@@ -0,0 +1,117 @@
+#include "caffe2/perfkernels/int8_depthwise_conv.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void Int8DepthwiseConv2DNHWC__base(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* filter,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  std::vector<int32_t> acc(C);
+  for (int oh = 0; oh < out_h; ++oh) {
+    for (int ow = 0; ow < out_w; ++ow) {
+      std::fill(acc.begin(), acc.end(), 0);
+      for (int kh = 0; kh < kernel; ++kh) {
+        const int ih = oh * stride - pad_t + kh;
+        if (ih < 0 || ih >= H) {
+          continue;
+        }
+        for (int kw = 0; kw < kernel; ++kw) {
+          const int iw = ow * stride - pad_l + kw;
+          if (iw < 0 || iw >= W) {
+            continue;
+          }
+          const uint8_t* x = X + (ih * W + iw) * C;
+          const int8_t* f = filter + (kh * kernel + kw) * C;
+          for (int c = 0; c < C; ++c) {
+            acc[c] += (x[c] - x_zero_point) * f[c];
+          }
+        }
+      }
+      uint8_t* y = Y + (oh * out_w + ow) * C;
+      for (int c = 0; c < C; ++c) {
+        const int32_t q = static_cast<int32_t>(
+                              std::nearbyint(scale[c] * acc[c] + bias[c])) +
+            y_zero_point;
+        y[c] = static_cast<uint8_t>(std::min(std::max(q, 0), 255));
+      }
+    }
+  }
+}
+
+void Int8DepthwiseConv2DNHWC(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* filter,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  NEON_DO(
+      Int8DepthwiseConv2DNHWC,
+      kernel,
+      stride,
+      H,
+      W,
+      C,
+      out_h,
+      out_w,
+      pad_t,
+      pad_l,
+      X,
+      x_zero_point,
+      filter,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+  BASE_DO(
+      Int8DepthwiseConv2DNHWC,
+      kernel,
+      stride,
+      H,
+      W,
+      C,
+      out_h,
+      out_w,
+      pad_t,
+      pad_l,
+      X,
+      x_zero_point,
+      filter,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+}
+
+} // namespace caffe2
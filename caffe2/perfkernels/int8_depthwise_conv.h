@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+namespace caffe2 {
+
+/**
+ * Quantized depthwise 2-D convolution of one image of C channels in NHWC
+ * order, for square kernels without dilation:
+ *
+ * acc[oh][ow][c] = sum_{kh,kw} filter[kh][kw][c] *
+ *     (X[oh * stride - pad_t + kh][ow * stride - pad_l + kw][c] -
+ *      x_zero_point)
+ * Y[oh][ow][c] = clamp(
+ *     round(scale[c] * acc[oh][ow][c] + bias[c]) + y_zero_point, 0, 255)
+ *
+ * where the terms outside of the H x W input, the padding of value
+ * x_zero_point, are left out. The filter is kernel x kernel x C int8, which
+ * is the transpose of the C x kernel x kernel x 1 filter of the Int8Conv
+ * operator, and scale and bias are the requantization parameters of
+ * Int8PackedGemm. The channels are vectorized with NEON on ARM.
+ */
+void Int8DepthwiseConv2DNHWC(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* filter,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y);
+
+} // namespace caffe2
@@ -0,0 +1,124 @@
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <arm_neon.h>
+
+#include "caffe2/perfkernels/int8_depthwise_conv.h"
+#include "caffe2/perfkernels/int8_neon.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Accumulates 8 channels over the taps of one output: x - x_zero_point is
+// widened to 16 bits by vsubl, whose wrapped unsigned result is the signed
+// difference, and multiplied with the widened filter into 32 bits.
+inline void AccumulateTaps(
+    const int num_taps,
+    const uint8_t* const* x,
+    const int8_t* const* f,
+    const int c,
+    const uint8x8_t x_zero_point,
+    int32x4_t* lo,
+    int32x4_t* hi) {
+  int32x4_t acc_lo = vdupq_n_s32(0);
+  int32x4_t acc_hi = vdupq_n_s32(0);
+  for (int t = 0; t < num_taps; ++t) {
+    const int16x8_t xt =
+        vreinterpretq_s16_u16(vsubl_u8(vld1_u8(x[t] + c), x_zero_point));
+    const int16x8_t ft = vmovl_s8(vld1_s8(f[t] + c));
+    acc_lo = vmlal_s16(acc_lo, vget_low_s16(xt), vget_low_s16(ft));
+    acc_hi = vmlal_s16(acc_hi, vget_high_s16(xt), vget_high_s16(ft));
+  }
+  *lo = acc_lo;
+  *hi = acc_hi;
+}
+
+} // namespace
+
+void Int8DepthwiseConv2DNHWC__neon(
+    const int kernel,
+    const int stride,
+    const int H,
+    const int W,
+    const int C,
+    const int out_h,
+    const int out_w,
+    const int pad_t,
+    const int pad_l,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* filter,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const uint8x8_t zp = vdup_n_u8(static_cast<uint8_t>(x_zero_point));
+  // The inputs and filters of the taps of an output that are in the image
+  std::vector<const uint8_t*> x(kernel * kernel);
+  std::vector<const int8_t*> f(kernel * kernel);
+  // The last C % 8 channels of the taps, padded to 8 with values that add
+  // nothing
+  const int tail = C % 8;
+  const int c_tail = C - tail;
+  std::vector<uint8_t> x_tail(kernel * kernel * 8);
+  std::vector<int8_t> f_tail(kernel * kernel * 8);
+  std::vector<const uint8_t*> x_tail_ptr(kernel * kernel);
+  std::vector<const int8_t*> f_tail_ptr(kernel * kernel);
+  for (int oh = 0; oh < out_h; ++oh) {
+    for (int ow = 0; ow < out_w; ++ow) {
+      int num_taps = 0;
+      for (int kh = 0; kh < kernel; ++kh) {
+        const int ih = oh * stride - pad_t + kh;
+        if (ih < 0 || ih >= H) {
+          continue;
+        }
+        for (int kw = 0; kw < kernel; ++kw) {
+          const int iw = ow * stride - pad_l + kw;
+          if (iw < 0 || iw >= W) {
+            continue;
+          }
+          x[num_taps] = X + (ih * W + iw) * C;
+          f[num_taps] = filter + (kh * kernel + kw) * C;
+          ++num_taps;
+        }
+      }
+      uint8_t* y = Y + (oh * out_w + ow) * C;
+      int32x4_t lo, hi;
+      for (int c = 0; c < c_tail; c += 8) {
+        AccumulateTaps(num_taps, x.data(), f.data(), c, zp, &lo, &hi);
+        Int8RequantizeNeon(
+            lo, hi, scale + c, bias + c, y_zero_point, 8, y + c);
+      }
+      if (tail > 0) {
+        for (int t = 0; t < num_taps; ++t) {
+          uint8_t* xt = x_tail.data() + t * 8;
+          int8_t* ft = f_tail.data() + t * 8;
+          memset(xt, x_zero_point, 8);
+          memset(ft, 0, 8);
+          memcpy(xt, x[t] + c_tail, tail);
+          memcpy(ft, f[t] + c_tail, tail);
+          x_tail_ptr[t] = xt;
+          f_tail_ptr[t] = ft;
+        }
+        AccumulateTaps(
+            num_taps, x_tail_ptr.data(), f_tail_ptr.data(), 0, zp, &lo, &hi);
+        Int8RequantizeNeon(
+            lo,
+            hi,
+            scale + c_tail,
+            bias + c_tail,
+            y_zero_point,
+            tail,
+            y + c_tail);
+      }
+    }
+  }
+}
+
+} // namespace caffe2
+
+#endif // __ARM_NEON__
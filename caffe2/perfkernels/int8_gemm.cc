@@ -0,0 +1,168 @@
+#include "caffe2/perfkernels/int8_gemm.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+TIndex Int8PackedMatrixSize(const TIndex N, const TIndex K) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  return num_panels * ((K + 3) / 4) * kInt8PanelWidth * 4;
+}
+
+void PackInt8Matrix(
+    const TIndex N,
+    const TIndex K,
+    const int8_t* W,
+    int8_t* packed,
+    int32_t* row_sums) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex p = 0; p < num_panels; ++p) {
+    int8_t* panel = packed + p * num_groups * kInt8PanelWidth * 4;
+    for (TIndex g = 0; g < num_groups; ++g) {
+      for (int j = 0; j < kInt8PanelWidth; ++j) {
+        const TIndex n = p * kInt8PanelWidth + j;
+        for (int i = 0; i < 4; ++i) {
+          const TIndex k = 4 * g + i;
+          panel[(g * kInt8PanelWidth + j) * 4 + i] =
+              n < N && k < K ? W[n * K + k] : 0;
+        }
+      }
+    }
+  }
+  for (TIndex n = 0; n < N; ++n) {
+    int32_t sum = 0;
+    for (TIndex k = 0; k < K; ++k) {
+      sum += W[n * K + k];
+    }
+    row_sums[n] = sum;
+  }
+}
+
+// Base implementation computes one row of one panel at a time
+void Int8PackedGemm__base(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex p = 0; p < num_panels; ++p) {
+    const int8_t* panel = packed + p * num_groups * kInt8PanelWidth * 4;
+    const TIndex n0 = p * kInt8PanelWidth;
+    const int n_valid =
+        static_cast<int>(std::min<TIndex>(kInt8PanelWidth, N - n0));
+    for (TIndex m = 0; m < M; ++m) {
+      const uint8_t* x = X + m * K;
+      int32_t acc[kInt8PanelWidth] = {0};
+      for (TIndex k = 0; k < K; ++k) {
+        const int32_t xk = x[k];
+        const int8_t* w = panel + (k / 4) * kInt8PanelWidth * 4 + k % 4;
+        for (int j = 0; j < kInt8PanelWidth; ++j) {
+          acc[j] += xk * w[j * 4];
+        }
+      }
+      for (int j = 0; j < n_valid; ++j) {
+        const TIndex n = n0 + j;
+        const int32_t q =
+            static_cast<int32_t>(std::nearbyint(
+                scale[n] * (acc[j] - x_zero_point * row_sums[n]) + bias[n])) +
+            y_zero_point;
+        Y[m * N + n] = static_cast<uint8_t>(std::min(std::max(q, 0), 255));
+      }
+    }
+  }
+}
+
+void Int8PackedGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  NEON_DOTPROD_DO(
+      Int8PackedGemm,
+      M,
+      N,
+      K,
+      X,
+      x_zero_point,
+      packed,
+      row_sums,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+  NEON_DO(
+      Int8PackedGemm,
+      M,
+      N,
+      K,
+      X,
+      x_zero_point,
+      packed,
+      row_sums,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+  AVX512VNNI_DO(
+      Int8PackedGemm,
+      M,
+      N,
+      K,
+      X,
+      x_zero_point,
+      packed,
+      row_sums,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+  AVX2_FMA_DO(
+      Int8PackedGemm,
+      M,
+      N,
+      K,
+      X,
+      x_zero_point,
+      packed,
+      row_sums,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+  BASE_DO(
+      Int8PackedGemm,
+      M,
+      N,
+      K,
+      X,
+      x_zero_point,
+      packed,
+      row_sums,
+      scale,
+      bias,
+      y_zero_point,
+      Y);
+}
+
+} // namespace caffe2
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+// Number of output columns of a panel of a packed int8 matrix.
+constexpr int kInt8PanelWidth = 16;
+
+/**
+ * Number of bytes of an N x K int8 weight matrix packed by PackInt8Matrix.
+ */
+TIndex Int8PackedMatrixSize(const TIndex N, const TIndex K);
+
+/**
+ * Packs the N x K int8 weight matrix W of a quantized fully connected or
+ * convolution layer for Int8PackedGemm, and sets row_sums[n] to the sum of
+ * row n of W.
+ *
+ * The packed matrix is made of ceil(N / kInt8PanelWidth) panels. Panel p
+ * holds the rows n in [p * kInt8PanelWidth, (p + 1) * kInt8PanelWidth) as
+ * groups of 4 columns: group g is kInt8PanelWidth x 4 bytes, the 4 weights
+ * W[n][4 * g .. 4 * g + 3] of each row in turn, so that a 32-bit lane holds
+ * the operands of one VNNI dot product. Rows past N and columns past K are
+ * zero.
+ */
+void PackInt8Matrix(
+    const TIndex N,
+    const TIndex K,
+    const int8_t* W,
+    int8_t* packed,
+    int32_t* row_sums);
+
+/**
+ * Requantized product of the M x K row major uint8 matrix X, of zero point
+ * x_zero_point, and the N x K int8 matrix W packed by PackInt8Matrix:
+ *
+ * acc = sum_k (X[m][k] - x_zero_point) * W[n][k]
+ * Y[m][n] = clamp(round(scale[n] * acc + bias[n]) + y_zero_point, 0, 255)
+ *
+ * where row_sums are the sums set by PackInt8Matrix, and Y is M x N. For
+ * real values x_scale * (X - x_zero_point) and w_scale[n] * W, real bias b
+ * and output scale y_scale, scale[n] = x_scale * w_scale[n] / y_scale and
+ * bias[n] = b[n] / y_scale. The products are exact 32-bit integers, with
+ * the VNNI or ARMv8.2 dot products when the CPU has them, and with NEON on
+ * the other ARM CPUs.
+ */
+void Int8PackedGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y);
+
+} // namespace caffe2
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/int8_gemm.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Panels multiplied at a time with all the rows of X
+constexpr TIndex kPanelsPerChunk = 8;
+
+// Loads the 4 bytes of x, or the first n when n < 4, as an int32
+inline int32_t LoadGroup(const uint8_t* x, const int n) {
+  int32_t v = 0;
+  if (n == 4) {
+    memcpy(&v, x, 4);
+  } else {
+    memcpy(&v, x, n);
+  }
+  return v;
+}
+
+// Mask of the first n, up to 8, lanes for the masked loads
+inline __m256i FirstLanes(const int n) {
+  return _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(n), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// Computes the requantized columns [0, 16) of MR rows of Y from one panel.
+// Only the first n_valid columns are read from the parameters and written
+// to Y.
+//
+// AVX2 has no byte dot product that cannot saturate, so the weights and
+// activations are widened to 16 bits for _mm256_madd_epi16. acc[i][c] holds
+// the sums for the 4 columns 4 * c .. 4 * c + 3 as pairs of 32-bit lanes,
+// which are added together once the whole of K is done.
+template <int MR>
+void Kernel(
+    const TIndex K,
+    const uint8_t* x,
+    const int8_t* panel,
+    const int32_t x_zero_point,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n_valid,
+    uint8_t* y,
+    const TIndex ldy) {
+  __m256i acc[MR][4];
+  for (int i = 0; i < MR; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      acc[i][c] = _mm256_setzero_si256();
+    }
+  }
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex g = 0; g < num_groups; ++g) {
+    // The last group of a K that is not a multiple of 4 is read in part,
+    // the packed weights past K are zero.
+    const int bytes = g < K / 4 ? 4 : static_cast<int>(K % 4);
+    const int8_t* w = panel + g * kInt8PanelWidth * 4;
+    __m256i a[MR];
+    for (int i = 0; i < MR; ++i) {
+      a[i] = _mm256_cvtepu8_epi16(
+          _mm_set1_epi32(LoadGroup(x + i * K + 4 * g, bytes)));
+    }
+    for (int c = 0; c < 4; ++c) {
+      const __m256i wc = _mm256_cvtepi8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + c * 16)));
+      for (int i = 0; i < MR; ++i) {
+        acc[i][c] = _mm256_add_epi32(acc[i][c], _mm256_madd_epi16(wc, a[i]));
+      }
+    }
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max_value = _mm256_set1_epi32(255);
+  const __m256i x_zp = _mm256_set1_epi32(x_zero_point);
+  const __m256i y_zp = _mm256_set1_epi32(y_zero_point);
+  for (int h = 0; h < 2; ++h) {
+    const int valid = std::min(8, n_valid - 8 * h);
+    if (valid <= 0) {
+      break;
+    }
+    const __m256i mask = FirstLanes(valid);
+    const int offset = 8 * h;
+    const __m256i correction = _mm256_mullo_epi32(
+        x_zp, _mm256_maskload_epi32(row_sums + offset, mask));
+    const __m256 s = _mm256_maskload_ps(scale + offset, mask);
+    const __m256 b = _mm256_maskload_ps(bias + offset, mask);
+    for (int i = 0; i < MR; ++i) {
+      // Adds the pairs of lanes: columns 0 1 4 5 2 3 6 7, put in order by
+      // the permutation of 64-bit pairs.
+      const __m256i sums = _mm256_permute4x64_epi64(
+          _mm256_hadd_epi32(acc[i][2 * h], acc[i][2 * h + 1]), 0xD8);
+      const __m256 v = _mm256_fmadd_ps(
+          _mm256_cvtepi32_ps(_mm256_sub_epi32(sums, correction)), s, b);
+      const __m256i r = _mm256_min_epi32(
+          _mm256_max_epi32(
+              _mm256_add_epi32(_mm256_cvtps_epi32(v), y_zp), zero),
+          max_value);
+      // The low byte of each lane, columns 0 1 2 3 in the low 128 bits and
+      // 4 5 6 7 in the high 128 bits
+      const __m256i bytes_per_half = _mm256_shuffle_epi8(
+          r,
+          _mm256_setr_epi8(
+              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+              0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+      const __m128i packed = _mm_unpacklo_epi32(
+          _mm256_castsi256_si128(bytes_per_half),
+          _mm256_extracti128_si256(bytes_per_half, 1));
+      uint8_t* yi = y + i * ldy + offset;
+      if (valid == 8) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(yi), packed);
+      } else {
+        uint8_t out[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+        memcpy(yi, out, valid);
+      }
+    }
+  }
+}
+
+} // namespace
+
+void Int8PackedGemm__avx2_fma(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  const TIndex panel_stride = (K + 3) / 4 * kInt8PanelWidth * 4;
+  for (TIndex p0 = 0; p0 < num_panels; p0 += kPanelsPerChunk) {
+    const TIndex p1 = std::min(num_panels, p0 + kPanelsPerChunk);
+    for (TIndex m = 0; m < M; m += 2) {
+      for (TIndex p = p0; p < p1; ++p) {
+        const TIndex n0 = p * kInt8PanelWidth;
+        const int n_valid =
+            static_cast<int>(std::min<TIndex>(kInt8PanelWidth, N - n0));
+        if (m + 2 <= M) {
+          Kernel<2>(
+              K,
+              X + m * K,
+              packed + p * panel_stride,
+              x_zero_point,
+              row_sums + n0,
+              scale + n0,
+              bias + n0,
+              y_zero_point,
+              n_valid,
+              Y + m * N + n0,
+              N);
+        } else {
+          Kernel<1>(
+              K,
+              X + m * K,
+              packed + p * panel_stride,
+              x_zero_point,
+              row_sums + n0,
+              scale + n0,
+              bias + n0,
+              y_zero_point,
+              n_valid,
+              Y + m * N + n0,
+              N);
+        }
+      }
+    }
+  }
+}
+
+} // namespace caffe2
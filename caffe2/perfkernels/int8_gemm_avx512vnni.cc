@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/int8_gemm.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Panels multiplied at a time with all the rows of X
+constexpr TIndex kPanelsPerChunk = 8;
+
+// Loads the 4 bytes of x, or the first n when n < 4, as an int32
+inline int32_t LoadGroup(const uint8_t* x, const int n) {
+  int32_t v = 0;
+  if (n == 4) {
+    memcpy(&v, x, 4);
+  } else {
+    memcpy(&v, x, n);
+  }
+  return v;
+}
+
+// Computes the requantized columns [0, NP * 16) of MR rows of Y from NP
+// panels. Only the first n_valid columns of the last panel are read from
+// the parameters and written to Y.
+template <int MR, int NP>
+void Kernel(
+    const TIndex K,
+    const uint8_t* x,
+    const int8_t* panels,
+    const TIndex panel_stride,
+    const int32_t x_zero_point,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n_valid,
+    uint8_t* y,
+    const TIndex ldy) {
+  __m512i acc[MR][NP];
+  for (int i = 0; i < MR; ++i) {
+    for (int q = 0; q < NP; ++q) {
+      acc[i][q] = _mm512_setzero_si512();
+    }
+  }
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex g = 0; g < num_groups; ++g) {
+    // The last group of a K that is not a multiple of 4 is read in part,
+    // the packed weights past K are zero.
+    const int bytes = g < K / 4 ? 4 : static_cast<int>(K % 4);
+    __m512i w[NP];
+    for (int q = 0; q < NP; ++q) {
+      w[q] = _mm512_loadu_si512(
+          panels + q * panel_stride + g * kInt8PanelWidth * 4);
+    }
+    for (int i = 0; i < MR; ++i) {
+      const __m512i a =
+          _mm512_set1_epi32(LoadGroup(x + i * K + 4 * g, bytes));
+      for (int q = 0; q < NP; ++q) {
+        acc[i][q] = _mm512_dpbusd_epi32(acc[i][q], a, w[q]);
+      }
+    }
+  }
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i max_value = _mm512_set1_epi32(255);
+  const __m512i x_zp = _mm512_set1_epi32(x_zero_point);
+  const __m512i y_zp = _mm512_set1_epi32(y_zero_point);
+  for (int q = 0; q < NP; ++q) {
+    const int valid = q == NP - 1 ? n_valid : kInt8PanelWidth;
+    const __mmask16 mask = static_cast<__mmask16>((1U << valid) - 1);
+    const int offset = q * kInt8PanelWidth;
+    const __m512i correction = _mm512_mullo_epi32(
+        x_zp, _mm512_maskz_loadu_epi32(mask, row_sums + offset));
+    const __m512 s = _mm512_maskz_loadu_ps(mask, scale + offset);
+    const __m512 b = _mm512_maskz_loadu_ps(mask, bias + offset);
+    for (int i = 0; i < MR; ++i) {
+      const __m512 v = _mm512_fmadd_ps(
+          _mm512_cvtepi32_ps(_mm512_sub_epi32(acc[i][q], correction)), s, b);
+      const __m512i r = _mm512_min_epi32(
+          _mm512_max_epi32(
+              _mm512_add_epi32(_mm512_cvtps_epi32(v), y_zp), zero),
+          max_value);
+      _mm512_mask_cvtepi32_storeu_epi8(y + i * ldy + offset, mask, r);
+    }
+  }
+}
+
+// Runs the kernel on panels [p, p_end), NP panels at a time
+template <int MR, int NP>
+void RunPanels(
+    TIndex p,
+    const TIndex p_end,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* x,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* y) {
+  const TIndex panel_stride = (K + 3) / 4 * kInt8PanelWidth * 4;
+  const auto run = [&](const TIndex panel, const int np) {
+    const TIndex n0 = panel * kInt8PanelWidth;
+    const int n_valid = static_cast<int>(std::min<TIndex>(
+        kInt8PanelWidth, N - (panel + np - 1) * kInt8PanelWidth));
+    if (np == NP) {
+      Kernel<MR, NP>(
+          K,
+          x,
+          packed + panel * panel_stride,
+          panel_stride,
+          x_zero_point,
+          row_sums + n0,
+          scale + n0,
+          bias + n0,
+          y_zero_point,
+          n_valid,
+          y + n0,
+          N);
+    } else {
+      Kernel<MR, 1>(
+          K,
+          x,
+          packed + panel * panel_stride,
+          panel_stride,
+          x_zero_point,
+          row_sums + n0,
+          scale + n0,
+          bias + n0,
+          y_zero_point,
+          n_valid,
+          y + n0,
+          N);
+    }
+  };
+  for (; p + NP <= p_end; p += NP) {
+    run(p, NP);
+  }
+  for (; p < p_end; ++p) {
+    run(p, 1);
+  }
+}
+
+} // namespace
+
+void Int8PackedGemm__avx512vnni(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  for (TIndex p0 = 0; p0 < num_panels; p0 += kPanelsPerChunk) {
+    const TIndex p1 = std::min(num_panels, p0 + kPanelsPerChunk);
+    TIndex m = 0;
+    for (; m + 4 <= M; m += 4) {
+      RunPanels<4, 2>(
+          p0,
+          p1,
+          N,
+          K,
+          X + m * K,
+          x_zero_point,
+          packed,
+          row_sums,
+          scale,
+          bias,
+          y_zero_point,
+          Y + m * N);
+    }
+    const uint8_t* x = X + m * K;
+    uint8_t* y = Y + m * N;
+    switch (M - m) {
+      case 3:
+        RunPanels<3, 2>(
+            p0, p1, N, K, x, x_zero_point, packed, row_sums, scale, bias,
+            y_zero_point, y);
+        break;
+      case 2:
+        RunPanels<2, 4>(
+            p0, p1, N, K, x, x_zero_point, packed, row_sums, scale, bias,
+            y_zero_point, y);
+        break;
+      case 1:
+        RunPanels<1, 4>(
+            p0, p1, N, K, x, x_zero_point, packed, row_sums, scale, bias,
+            y_zero_point, y);
+        break;
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,151 @@
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <algorithm>
+#include <cstring>
+
+#include <arm_neon.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/int8_gemm.h"
+#include "caffe2/perfkernels/int8_neon.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Panels multiplied at a time with all the rows of X
+constexpr TIndex kPanelsPerChunk = 8;
+
+// Rows of X multiplied at a time, as many as the 16 (ARMv7) or 32 (ARMv8)
+// q registers hold the accumulators of, next to the widened weights
+#ifdef __aarch64__
+constexpr int kRows = 4;
+#else
+constexpr int kRows = 2;
+#endif
+
+// Computes the requantized columns [0, 16) of MR rows of Y from one panel.
+// Only the first n_valid columns are read from the parameters and written
+// to Y.
+//
+// The weights are widened to 16 bits, and each activation multiplies 16 of
+// them at a time into 32-bit accumulators, which cannot overflow. vld4
+// splits a group of 4 columns of the panel into the 4 values of k, for all
+// 16 output columns.
+template <int MR>
+void Kernel(
+    const TIndex K,
+    const uint8_t* x,
+    const int8_t* panel,
+    const int32_t x_zero_point,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n_valid,
+    uint8_t* y,
+    const TIndex ldy) {
+  int32x4_t acc[MR][4];
+  for (int i = 0; i < MR; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      acc[i][c] = vdupq_n_s32(0);
+    }
+  }
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex g = 0; g < num_groups; ++g) {
+    // The last group of a K that is not a multiple of 4 is read in part,
+    // the packed weights past K are zero.
+    const int bytes = g < K / 4 ? 4 : static_cast<int>(K % 4);
+    const int8x16x4_t w = vld4q_s8(panel + g * kInt8PanelWidth * 4);
+    int16x8_t w_low[4];
+    int16x8_t w_high[4];
+    for (int k = 0; k < 4; ++k) {
+      w_low[k] = vmovl_s8(vget_low_s8(w.val[k]));
+      w_high[k] = vmovl_s8(vget_high_s8(w.val[k]));
+    }
+    for (int i = 0; i < MR; ++i) {
+      const int32_t group = Int8LoadGroup(x + i * K + 4 * g, bytes);
+      uint8_t a[4];
+      memcpy(a, &group, 4);
+      for (int k = 0; k < 4; ++k) {
+        const int16_t ak = a[k];
+        acc[i][0] = vmlal_n_s16(acc[i][0], vget_low_s16(w_low[k]), ak);
+        acc[i][1] = vmlal_n_s16(acc[i][1], vget_high_s16(w_low[k]), ak);
+        acc[i][2] = vmlal_n_s16(acc[i][2], vget_low_s16(w_high[k]), ak);
+        acc[i][3] = vmlal_n_s16(acc[i][3], vget_high_s16(w_high[k]), ak);
+      }
+    }
+  }
+  for (int i = 0; i < MR; ++i) {
+    Int8RequantizePanelRowNeon(
+        acc[i],
+        -x_zero_point,
+        row_sums,
+        scale,
+        bias,
+        y_zero_point,
+        n_valid,
+        y + i * ldy);
+  }
+}
+
+} // namespace
+
+void Int8PackedGemm__neon(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  const TIndex panel_stride = (K + 3) / 4 * kInt8PanelWidth * 4;
+  for (TIndex p0 = 0; p0 < num_panels; p0 += kPanelsPerChunk) {
+    const TIndex p1 = std::min(num_panels, p0 + kPanelsPerChunk);
+    for (TIndex m = 0; m < M; m += kRows) {
+      for (TIndex p = p0; p < p1; ++p) {
+        const TIndex n0 = p * kInt8PanelWidth;
+        const int n_valid =
+            static_cast<int>(std::min<TIndex>(kInt8PanelWidth, N - n0));
+        if (m + kRows <= M) {
+          Kernel<kRows>(
+              K,
+              X + m * K,
+              packed + p * panel_stride,
+              x_zero_point,
+              row_sums + n0,
+              scale + n0,
+              bias + n0,
+              y_zero_point,
+              n_valid,
+              Y + m * N + n0,
+              N);
+        } else {
+          for (TIndex r = m; r < M; ++r) {
+            Kernel<1>(
+                K,
+                X + r * K,
+                packed + p * panel_stride,
+                x_zero_point,
+                row_sums + n0,
+                scale + n0,
+                bias + n0,
+                y_zero_point,
+                n_valid,
+                Y + r * N + n0,
+                N);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace caffe2
+
+#endif // __ARM_NEON__
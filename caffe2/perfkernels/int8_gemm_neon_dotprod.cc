@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cstring>
+
+#include <arm_neon.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/int8_gemm.h"
+#include "caffe2/perfkernels/int8_neon.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Panels multiplied at a time with all the rows of X
+constexpr TIndex kPanelsPerChunk = 8;
+
+// Computes the requantized columns [0, 16) of MR rows of Y from one panel.
+// Only the first n_valid columns are read from the parameters and written
+// to Y.
+//
+// sdot multiplies signed bytes only, so the activations are flipped to
+// x - 128, and 128 * row_sums is added back at the end. A 32-bit lane of a
+// group of the panel holds the 4 weights of one column, the operands of one
+// sdot lane with the 4 activations broadcast to all the lanes.
+template <int MR>
+void Kernel(
+    const TIndex K,
+    const uint8_t* x,
+    const int8_t* panel,
+    const int32_t x_zero_point,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n_valid,
+    uint8_t* y,
+    const TIndex ldy) {
+  int32x4_t acc[MR][4];
+  for (int i = 0; i < MR; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      acc[i][c] = vdupq_n_s32(0);
+    }
+  }
+  const uint8x16_t sign = vdupq_n_u8(0x80);
+  const TIndex num_groups = (K + 3) / 4;
+  for (TIndex g = 0; g < num_groups; ++g) {
+    // The last group of a K that is not a multiple of 4 is read in part,
+    // the packed weights past K are zero.
+    const int bytes = g < K / 4 ? 4 : static_cast<int>(K % 4);
+    const int8_t* w = panel + g * kInt8PanelWidth * 4;
+    int8x16_t a[MR];
+    for (int i = 0; i < MR; ++i) {
+      a[i] = vreinterpretq_s8_u8(veorq_u8(
+          vreinterpretq_u8_s32(
+              vdupq_n_s32(Int8LoadGroup(x + i * K + 4 * g, bytes))),
+          sign));
+    }
+    for (int c = 0; c < 4; ++c) {
+      const int8x16_t wc = vld1q_s8(w + c * 16);
+      for (int i = 0; i < MR; ++i) {
+        acc[i][c] = vdotq_s32(acc[i][c], wc, a[i]);
+      }
+    }
+  }
+  for (int i = 0; i < MR; ++i) {
+    Int8RequantizePanelRowNeon(
+        acc[i],
+        128 - x_zero_point,
+        row_sums,
+        scale,
+        bias,
+        y_zero_point,
+        n_valid,
+        y + i * ldy);
+  }
+}
+
+} // namespace
+
+void Int8PackedGemm__neon_dotprod(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const uint8_t* X,
+    const int32_t x_zero_point,
+    const int8_t* packed,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    uint8_t* Y) {
+  const TIndex num_panels = (N + kInt8PanelWidth - 1) / kInt8PanelWidth;
+  const TIndex panel_stride = (K + 3) / 4 * kInt8PanelWidth * 4;
+  for (TIndex p0 = 0; p0 < num_panels; p0 += kPanelsPerChunk) {
+    const TIndex p1 = std::min(num_panels, p0 + kPanelsPerChunk);
+    for (TIndex m = 0; m < M; m += 4) {
+      for (TIndex p = p0; p < p1; ++p) {
+        const TIndex n0 = p * kInt8PanelWidth;
+        const int n_valid =
+            static_cast<int>(std::min<TIndex>(kInt8PanelWidth, N - n0));
+        if (m + 4 <= M) {
+          Kernel<4>(
+              K,
+              X + m * K,
+              packed + p * panel_stride,
+              x_zero_point,
+              row_sums + n0,
+              scale + n0,
+              bias + n0,
+              y_zero_point,
+              n_valid,
+              Y + m * N + n0,
+              N);
+        } else {
+          for (TIndex r = m; r < M; ++r) {
+            Kernel<1>(
+                K,
+                X + r * K,
+                packed + p * panel_stride,
+                x_zero_point,
+                row_sums + n0,
+                scale + n0,
+                bias + n0,
+                y_zero_point,
+                n_valid,
+                Y + r * N + n0,
+                N);
+          }
+        }
+      }
+    }
+  }
+}
+
+} // namespace caffe2
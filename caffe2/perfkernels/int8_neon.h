@@ -0,0 +1,106 @@
+#pragma once
+
+// Helpers of the NEON int8 kernels. They are static, since this header is
+// compiled both with the default flags and with the dot product flags, and
+// the linker must not pick the latter for the former.
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace caffe2 {
+
+// Loads the 4 bytes of x, or the first n when n < 4, as an int32
+static inline int32_t Int8LoadGroup(const uint8_t* x, const int n) {
+  int32_t v = 0;
+  if (n == 4) {
+    memcpy(&v, x, 4);
+  } else {
+    memcpy(&v, x, n);
+  }
+  return v;
+}
+
+// Requantizes 8 int32 accumulators, lo then hi, to the first n bytes of y:
+//
+// y[i] = clamp(round(scale[i] * acc[i] + bias[i]) + y_zero_point, 0, 255)
+//
+// Only the first n values of scale and bias are read.
+static inline void Int8RequantizeNeon(
+    const int32x4_t lo,
+    const int32x4_t hi,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n,
+    uint8_t* y) {
+#ifdef __aarch64__
+  if (n == 8) {
+    const float32x4_t v0 = vmlaq_f32(
+        vld1q_f32(bias), vcvtq_f32_s32(lo), vld1q_f32(scale));
+    const float32x4_t v1 = vmlaq_f32(
+        vld1q_f32(bias + 4), vcvtq_f32_s32(hi), vld1q_f32(scale + 4));
+    const int32x4_t zp = vdupq_n_s32(y_zero_point);
+    // Rounds to nearest even like nearbyint, then saturates to 16 bits and
+    // to [0, 255]
+    const int16x8_t q = vcombine_s16(
+        vqmovn_s32(vaddq_s32(vcvtnq_s32_f32(v0), zp)),
+        vqmovn_s32(vaddq_s32(vcvtnq_s32_f32(v1), zp)));
+    vst1_u8(y, vqmovun_s16(q));
+    return;
+  }
+#endif // __aarch64__
+  // ARMv7 has no float to int conversion rounding to nearest
+  int32_t acc[8];
+  vst1q_s32(acc, lo);
+  vst1q_s32(acc + 4, hi);
+  for (int i = 0; i < n; ++i) {
+    const int32_t q =
+        static_cast<int32_t>(std::nearbyint(scale[i] * acc[i] + bias[i])) +
+        y_zero_point;
+    y[i] = static_cast<uint8_t>(std::min(std::max(q, 0), 255));
+  }
+}
+
+// Requantizes the accumulators of one row of a panel of Int8PackedGemm,
+// columns 4 * c .. 4 * c + 3 in acc[c], to the first n_valid bytes of y,
+// after adding correction * row_sums to them.
+static inline void Int8RequantizePanelRowNeon(
+    const int32x4_t* acc,
+    const int32_t correction,
+    const int32_t* row_sums,
+    const float* scale,
+    const float* bias,
+    const int32_t y_zero_point,
+    const int n_valid,
+    uint8_t* y) {
+  for (int h = 0; h < 2; ++h) {
+    const int valid = std::min(8, n_valid - 8 * h);
+    if (valid <= 0) {
+      break;
+    }
+    const int offset = 8 * h;
+    int32_t sums[8] = {0};
+    const int32_t* s = row_sums + offset;
+    if (valid < 8) {
+      memcpy(sums, s, valid * sizeof(int32_t));
+      s = sums;
+    }
+    Int8RequantizeNeon(
+        vmlaq_n_s32(acc[2 * h], vld1q_s32(s), correction),
+        vmlaq_n_s32(acc[2 * h + 1], vld1q_s32(s + 4), correction),
+        scale + offset,
+        bias + offset,
+        y_zero_point,
+        valid,
+        y + offset);
+  }
+}
+
+} // namespace caffe2
+
+#endif // __ARM_NEON__
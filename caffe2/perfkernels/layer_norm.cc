@@ -0,0 +1,140 @@
+#include "caffe2/perfkernels/layer_norm.h"
+
+#include <cmath>
+
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+void LayerNorm__base(
+    const int N,
+    const int D,
+    const float* x,
+    const float* gamma,
+    const float* beta,
+    const float epsilon,
+    float* y,
+    float* mean,
+    float* stdev) {
+  for (int i = 0; i < N; ++i) {
+    const float* xrow = x + static_cast<size_t>(i) * D;
+    float* yrow = y + static_cast<size_t>(i) * D;
+    // Shifted by the first value, see layer_norm_avx2.cc
+    const float offset = D > 0 ? xrow[0] : 0;
+    float mu = 0;
+    float m2 = 0;
+    for (int j = 0; j < D; ++j) {
+      const float value = xrow[j] - offset;
+      const float delta = value - mu;
+      mu += delta / (j + 1);
+      m2 += delta * (value - mu);
+    }
+    mu += offset;
+    const float sigma = std::sqrt(m2 / D + epsilon);
+    const float scale = 1.0f / sigma;
+    for (int j = 0; j < D; ++j) {
+      float v = (xrow[j] - mu) * scale;
+      if (gamma) {
+        v *= gamma[j];
+      }
+      if (beta) {
+        v += beta[j];
+      }
+      yrow[j] = v;
+    }
+    mean[i] = mu;
+    stdev[i] = sigma;
+  }
+}
+
+void LayerNorm(
+    const int N,
+    const int D,
+    const float* x,
+    const float* gamma,
+    const float* beta,
+    const float epsilon,
+    float* y,
+    float* mean,
+    float* stdev) {
+  AVX2_FMA_DO(LayerNorm, N, D, x, gamma, beta, epsilon, y, mean, stdev);
+  BASE_DO(LayerNorm, N, D, x, gamma, beta, epsilon, y, mean, stdev);
+}
+
+void LayerNormGradient__base(
+    const int N,
+    const int D,
+    const float* dy,
+    const float* x,
+    const float* gamma,
+    const float* mean,
+    const float* stdev,
+    float* dx,
+    float* dgamma,
+    float* dbeta) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    const float scale = 1.0f / stdev[i];
+    float sum_g = 0;
+    float sum_gx = 0;
+    for (int j = 0; j < D; ++j) {
+      const float xhat = (x[offset + j] - mean[i]) * scale;
+      const float g = gamma ? dy[offset + j] * gamma[j] : dy[offset + j];
+      sum_g += g;
+      sum_gx += g * xhat;
+      if (dgamma) {
+        dgamma[j] += dy[offset + j] * xhat;
+      }
+      if (dbeta) {
+        dbeta[j] += dy[offset + j];
+      }
+    }
+    const float mean_g = sum_g / D;
+    const float mean_gx = sum_gx / D;
+    for (int j = 0; j < D; ++j) {
+      const float xhat = (x[offset + j] - mean[i]) * scale;
+      const float g = gamma ? dy[offset + j] * gamma[j] : dy[offset + j];
+      dx[offset + j] = (g - mean_g - xhat * mean_gx) * scale;
+    }
+  }
+}
+
+void LayerNormGradient(
+    const int N,
+    const int D,
+    const float* dy,
+    const float* x,
+    const float* gamma,
+    const float* mean,
+    const float* stdev,
+    float* dx,
+    float* dgamma,
+    float* dbeta) {
+  AVX2_FMA_DO(
+      LayerNormGradient,
+      N,
+      D,
+      dy,
+      x,
+      gamma,
+      mean,
+      stdev,
+      dx,
+      dgamma,
+      dbeta);
+  BASE_DO(
+      LayerNormGradient,
+      N,
+      D,
+      dy,
+      x,
+      gamma,
+      mean,
+      stdev,
+      dx,
+      dgamma,
+      dbeta);
+}
+
+} // namespace caffe2
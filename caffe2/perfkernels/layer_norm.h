@@ -0,0 +1,45 @@
+#pragma once
+
+namespace caffe2 {
+
+/**
+ * Layer normalization of N rows of D columns. The mean and the standard
+ * deviation stdev = sqrt(var + epsilon) of every row are computed with
+ * Welford's algorithm in one pass, then a second pass over the row, still in
+ * cache, writes y = (x - mean) / stdev, times gamma and plus beta when they
+ * are not null. y can be x.
+ *
+ * The AVX2 version keeps a Welford mean and M2 per lane and merges the lanes
+ * at the end of every row.
+ */
+void LayerNorm(
+    const int N,
+    const int D,
+    const float* x,
+    const float* gamma,
+    const float* beta,
+    const float epsilon,
+    float* y,
+    float* mean,
+    float* stdev);
+
+/**
+ * Gradient of LayerNorm with respect to x, given x and the mean and stdev of
+ * its rows: with xhat = (x - mean) / stdev and g = dy * gamma,
+ * dx = (g - mean(g) - xhat * mean(g * xhat)) / stdev. gamma can be null for
+ * 1. The gradients of gamma and beta, sum(dy * xhat) and sum(dy) over the
+ * rows, are added to dgamma and dbeta when they are not null. dx can be dy.
+ */
+void LayerNormGradient(
+    const int N,
+    const int D,
+    const float* dy,
+    const float* x,
+    const float* gamma,
+    const float* mean,
+    const float* stdev,
+    float* dx,
+    float* dgamma,
+    float* dbeta);
+
+} // namespace caffe2
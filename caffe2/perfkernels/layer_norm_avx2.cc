@@ -0,0 +1,203 @@
+#include <immintrin.h>
+
+#include <cmath>
+
+#include "caffe2/perfkernels/layer_norm.h"
+
+namespace caffe2 {
+
+namespace {
+
+inline float HorizontalSum(__m256 v) {
+  __m128 s =
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+// Mean and M2, the sum of the squared deviations from the mean, of a row.
+// Two sets of 8 lanes run Welford's update on every other vector, so that
+// the updates of consecutive vectors don't wait for each other, and are
+// merged with Chan's formula before the tail is added one value at a time.
+// The values are shifted by the first one, for a large offset common to the
+// row not to take the precision of the small updates of the mean.
+inline void WelfordRow(const int D, const float* x, float* mean, float* m2) {
+  const float offset = D > 0 ? x[0] : 0;
+  int j = 0;
+  float mu = 0;
+  float sum_m2 = 0;
+  int count = 0;
+  if (D >= 16) {
+    __m256 mean0 = _mm256_setzero_ps();
+    __m256 mean1 = _mm256_setzero_ps();
+    __m256 m20 = _mm256_setzero_ps();
+    __m256 m21 = _mm256_setzero_ps();
+    const __m256 voffset = _mm256_set1_ps(offset);
+    int n = 0;
+    for (; j + 16 <= D; j += 16) {
+      ++n;
+      const __m256 rcp = _mm256_set1_ps(1.0f / n);
+      const __m256 x0 = _mm256_sub_ps(_mm256_loadu_ps(x + j), voffset);
+      const __m256 x1 = _mm256_sub_ps(_mm256_loadu_ps(x + j + 8), voffset);
+      const __m256 delta0 = _mm256_sub_ps(x0, mean0);
+      const __m256 delta1 = _mm256_sub_ps(x1, mean1);
+      mean0 = _mm256_fmadd_ps(delta0, rcp, mean0);
+      mean1 = _mm256_fmadd_ps(delta1, rcp, mean1);
+      m20 = _mm256_fmadd_ps(delta0, _mm256_sub_ps(x0, mean0), m20);
+      m21 = _mm256_fmadd_ps(delta1, _mm256_sub_ps(x1, mean1), m21);
+    }
+    // All 16 lanes have n values, so the merged mean is the mean of the lane
+    // means, and M2 gains n times the squared deviations of the lane means.
+    mu = HorizontalSum(_mm256_add_ps(mean0, mean1)) / 16;
+    const __m256 vmu = _mm256_set1_ps(mu);
+    const __m256 d0 = _mm256_sub_ps(mean0, vmu);
+    const __m256 d1 = _mm256_sub_ps(mean1, vmu);
+    sum_m2 = HorizontalSum(_mm256_add_ps(m20, m21)) +
+        n * HorizontalSum(_mm256_fmadd_ps(d0, d0, _mm256_mul_ps(d1, d1)));
+    count = 16 * n;
+  }
+  for (; j < D; ++j) {
+    ++count;
+    const float value = x[j] - offset;
+    const float delta = value - mu;
+    mu += delta / count;
+    sum_m2 += delta * (value - mu);
+  }
+  *mean = mu + offset;
+  *m2 = sum_m2;
+}
+
+} // namespace
+
+void LayerNorm__avx2_fma(
+    const int N,
+    const int D,
+    const float* x,
+    const float* gamma,
+    const float* beta,
+    const float epsilon,
+    float* y,
+    float* mean,
+    float* stdev) {
+  for (int i = 0; i < N; ++i) {
+    const float* xrow = x + static_cast<size_t>(i) * D;
+    float* yrow = y + static_cast<size_t>(i) * D;
+    float mu;
+    float m2;
+    WelfordRow(D, xrow, &mu, &m2);
+    const float sigma = std::sqrt(m2 / D + epsilon);
+    const float scale = 1.0f / sigma;
+    const __m256 vmu = _mm256_set1_ps(mu);
+    const __m256 vscale = _mm256_set1_ps(scale);
+    int j = 0;
+    for (; j + 8 <= D; j += 8) {
+      __m256 v =
+          _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(xrow + j), vmu), vscale);
+      if (gamma) {
+        v = _mm256_mul_ps(v, _mm256_loadu_ps(gamma + j));
+      }
+      if (beta) {
+        v = _mm256_add_ps(v, _mm256_loadu_ps(beta + j));
+      }
+      _mm256_storeu_ps(yrow + j, v);
+    }
+    for (; j < D; ++j) {
+      float v = (xrow[j] - mu) * scale;
+      if (gamma) {
+        v *= gamma[j];
+      }
+      if (beta) {
+        v += beta[j];
+      }
+      yrow[j] = v;
+    }
+    mean[i] = mu;
+    stdev[i] = sigma;
+  }
+}
+
+void LayerNormGradient__avx2_fma(
+    const int N,
+    const int D,
+    const float* dy,
+    const float* x,
+    const float* gamma,
+    const float* mean,
+    const float* stdev,
+    float* dx,
+    float* dgamma,
+    float* dbeta) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    const float* dyrow = dy + offset;
+    const float* xrow = x + offset;
+    float* dxrow = dx + offset;
+    const float mu = mean[i];
+    const float scale = 1.0f / stdev[i];
+    const __m256 vmu = _mm256_set1_ps(mu);
+    const __m256 vscale = _mm256_set1_ps(scale);
+
+    // Sums of g and g * xhat, and the gradients of gamma and beta
+    __m256 vsum_g = _mm256_setzero_ps();
+    __m256 vsum_gx = _mm256_setzero_ps();
+    int j = 0;
+    for (; j + 8 <= D; j += 8) {
+      const __m256 xhat =
+          _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(xrow + j), vmu), vscale);
+      const __m256 vdy = _mm256_loadu_ps(dyrow + j);
+      const __m256 g =
+          gamma ? _mm256_mul_ps(vdy, _mm256_loadu_ps(gamma + j)) : vdy;
+      vsum_g = _mm256_add_ps(vsum_g, g);
+      vsum_gx = _mm256_fmadd_ps(g, xhat, vsum_gx);
+      if (dgamma) {
+        _mm256_storeu_ps(
+            dgamma + j,
+            _mm256_fmadd_ps(vdy, xhat, _mm256_loadu_ps(dgamma + j)));
+      }
+      if (dbeta) {
+        _mm256_storeu_ps(
+            dbeta + j, _mm256_add_ps(vdy, _mm256_loadu_ps(dbeta + j)));
+      }
+    }
+    float sum_g = HorizontalSum(vsum_g);
+    float sum_gx = HorizontalSum(vsum_gx);
+    for (int k = j; k < D; ++k) {
+      const float xhat = (xrow[k] - mu) * scale;
+      const float g = gamma ? dyrow[k] * gamma[k] : dyrow[k];
+      sum_g += g;
+      sum_gx += g * xhat;
+      if (dgamma) {
+        dgamma[k] += dyrow[k] * xhat;
+      }
+      if (dbeta) {
+        dbeta[k] += dyrow[k];
+      }
+    }
+
+    // dx = (g - mean(g) - xhat * mean(g * xhat)) * scale
+    const float mean_g = sum_g / D;
+    const float mean_gx = sum_gx / D;
+    const __m256 vmean_g = _mm256_set1_ps(mean_g);
+    const __m256 vmean_gx = _mm256_set1_ps(mean_gx);
+    for (j = 0; j + 8 <= D; j += 8) {
+      const __m256 xhat =
+          _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(xrow + j), vmu), vscale);
+      const __m256 vdy = _mm256_loadu_ps(dyrow + j);
+      const __m256 g =
+          gamma ? _mm256_mul_ps(vdy, _mm256_loadu_ps(gamma + j)) : vdy;
+      _mm256_storeu_ps(
+          dxrow + j,
+          _mm256_mul_ps(
+              _mm256_fnmadd_ps(xhat, vmean_gx, _mm256_sub_ps(g, vmean_g)),
+              vscale));
+    }
+    for (; j < D; ++j) {
+      const float xhat = (xrow[j] - mu) * scale;
+      const float g = gamma ? dyrow[j] * gamma[j] : dyrow[j];
+      dxrow[j] = (g - mean_g - xhat * mean_gx) * scale;
+    }
+  }
+}
+
+} // namespace caffe2
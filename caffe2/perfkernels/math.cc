@@ -0,0 +1,423 @@
+#include "caffe2/perfkernels/math.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+void VectorizedExp__base(const int N, const float* x, float* y) {
+  EigenVectorMap<float>(y, N) = ConstEigenVectorMap<float>(x, N).array().exp();
+}
+
+void VectorizedExp(const int N, const float* x, float* y) {
+  AVX512_DO(VectorizedExp, N, x, y);
+  AVX2_FMA_DO(VectorizedExp, N, x, y);
+  BASE_DO(VectorizedExp, N, x, y);
+}
+
+void VectorizedLog__base(const int N, const float* x, float* y) {
+  EigenVectorMap<float>(y, N) = ConstEigenVectorMap<float>(x, N).array().log();
+}
+
+void VectorizedLog(const int N, const float* x, float* y) {
+  AVX512_DO(VectorizedLog, N, x, y);
+  AVX2_FMA_DO(VectorizedLog, N, x, y);
+  BASE_DO(VectorizedLog, N, x, y);
+}
+
+void VectorizedSqrt__base(const int N, const float* x, float* y) {
+  EigenVectorMap<float>(y, N) =
+      ConstEigenVectorMap<float>(x, N).array().sqrt();
+}
+
+void VectorizedSqrt(const int N, const float* x, float* y) {
+  AVX512_DO(VectorizedSqrt, N, x, y);
+  AVX2_FMA_DO(VectorizedSqrt, N, x, y);
+  BASE_DO(VectorizedSqrt, N, x, y);
+}
+
+namespace {
+
+// Rational approximation of tanh on [-9, 9] from Eigen, see math.h
+inline float FastTanh(float x) {
+  x = std::max(std::min(x, 9.0f), -9.0f);
+  const float x2 = x * x;
+  float p = -2.76076847742355e-16f;
+  p = p * x2 + 2.00018790482477e-13f;
+  p = p * x2 - 8.60467152213735e-11f;
+  p = p * x2 + 5.12229709037114e-08f;
+  p = p * x2 + 1.48572235717979e-05f;
+  p = p * x2 + 6.37261928875436e-04f;
+  p = p * x2 + 4.89352455891786e-03f;
+  float q = 1.19825839466702e-06f;
+  q = q * x2 + 1.18534705686654e-04f;
+  q = q * x2 + 2.26843463243900e-03f;
+  q = q * x2 + 4.89352518554385e-03f;
+  return x * p / q;
+}
+
+} // namespace
+
+void VectorizedSigmoid__base(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  if (fast) {
+    for (int i = 0; i < N; ++i) {
+      y[i] = 0.5f + 0.5f * FastTanh(0.5f * x[i]);
+    }
+    return;
+  }
+  EigenVectorArrayMap<float>(y, N) =
+      ((-ConstEigenVectorArrayMap<float>(x, N)).exp() + 1).inverse();
+}
+
+void VectorizedSigmoid(const int N, const float* x, float* y, const bool fast) {
+  AVX512_DO(VectorizedSigmoid, N, x, y, fast);
+  AVX2_FMA_DO(VectorizedSigmoid, N, x, y, fast);
+  BASE_DO(VectorizedSigmoid, N, x, y, fast);
+}
+
+void VectorizedTanh__base(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  if (fast) {
+    for (int i = 0; i < N; ++i) {
+      y[i] = FastTanh(x[i]);
+    }
+    return;
+  }
+  EigenVectorArrayMap<float>(y, N) =
+      1 - 2 * ((2 * ConstEigenVectorArrayMap<float>(x, N)).exp() + 1).inverse();
+}
+
+void VectorizedTanh(const int N, const float* x, float* y, const bool fast) {
+  AVX512_DO(VectorizedTanh, N, x, y, fast);
+  AVX2_FMA_DO(VectorizedTanh, N, x, y, fast);
+  BASE_DO(VectorizedTanh, N, x, y, fast);
+}
+
+void VectorizedPowx__base(
+    const int N,
+    const float* a,
+    const float b,
+    float* y) {
+  EigenVectorMap<float>(y, N) = ConstEigenVectorMap<float>(a, N).array().pow(b);
+}
+
+void VectorizedPowx(const int N, const float* a, const float b, float* y) {
+  if (b == -1.0f || b == 0.5f || b == 1.0f || b == 2.0f) {
+    AVX512_DO(VectorizedPowx, N, a, b, y);
+    AVX2_FMA_DO(VectorizedPowx, N, a, b, y);
+  }
+  BASE_DO(VectorizedPowx, N, a, b, y);
+}
+
+void VectorizedRowwiseMax__base(
+    const int N,
+    const int D,
+    const float* x,
+    float* y) {
+  EigenVectorMap<float>(y, N) =
+      ConstEigenMatrixMap<float>(x, D, N).colwise().maxCoeff();
+}
+
+void VectorizedRowwiseMax(const int N, const int D, const float* x, float* y) {
+  AVX512_DO(VectorizedRowwiseMax, N, D, x, y);
+  AVX2_FMA_DO(VectorizedRowwiseMax, N, D, x, y);
+  BASE_DO(VectorizedRowwiseMax, N, D, x, y);
+}
+
+void VectorizedSoftmax__base(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    const bool logarithmic,
+    const bool /* unused */,
+    float* rowmax,
+    float* rowsum) {
+  for (int i = 0; i < N; ++i) {
+    const float* xrow = x + static_cast<size_t>(i) * D;
+    float* yrow = y + static_cast<size_t>(i) * D;
+    float max = -std::numeric_limits<float>::infinity();
+    for (int j = 0; j < D; ++j) {
+      max = std::max(max, xrow[j]);
+    }
+    // Accumulated in double, as the scalar sum is not split between lanes
+    double accumulator = 0;
+    for (int j = 0; j < D; ++j) {
+      const float e = std::exp(xrow[j] - max);
+      if (!logarithmic) {
+        yrow[j] = e;
+      }
+      accumulator += e;
+    }
+    const float sum = accumulator;
+    if (logarithmic) {
+      const float shift = max + std::log(std::max(sum, 1e-20f));
+      for (int j = 0; j < D; ++j) {
+        yrow[j] = xrow[j] - shift;
+      }
+    } else {
+      const float inv = 1.0f / sum;
+      for (int j = 0; j < D; ++j) {
+        yrow[j] *= inv;
+      }
+    }
+    if (rowmax) {
+      rowmax[i] = max;
+    }
+    if (rowsum) {
+      rowsum[i] = sum;
+    }
+  }
+}
+
+void VectorizedSoftmax(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    const bool logarithmic,
+    float* rowmax,
+    float* rowsum) {
+  // The online pass computes more exponentials, which only pays off once the
+  // rows, here of 1MB and more, fall out of L2 before the third pass
+  const bool online = D >= (1 << 18);
+  AVX512_DO(
+      VectorizedSoftmax, N, D, x, y, logarithmic, online, rowmax, rowsum);
+  AVX2_FMA_DO(
+      VectorizedSoftmax, N, D, x, y, logarithmic, online, rowmax, rowsum);
+  BASE_DO(VectorizedSoftmax, N, D, x, y, logarithmic, online, rowmax, rowsum);
+}
+
+void VectorizedSoftmaxGradient__base(
+    const int N,
+    const int D,
+    const float* y,
+    const float* dy,
+    float* dx) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    float dot = 0;
+    for (int j = 0; j < D; ++j) {
+      dot += y[offset + j] * dy[offset + j];
+    }
+    for (int j = 0; j < D; ++j) {
+      dx[offset + j] = y[offset + j] * (dy[offset + j] - dot);
+    }
+  }
+}
+
+void VectorizedSoftmaxGradient(
+    const int N,
+    const int D,
+    const float* y,
+    const float* dy,
+    float* dx) {
+  AVX512_DO(VectorizedSoftmaxGradient, N, D, y, dy, dx);
+  AVX2_FMA_DO(VectorizedSoftmaxGradient, N, D, y, dy, dx);
+  BASE_DO(VectorizedSoftmaxGradient, N, D, y, dy, dx);
+}
+
+void VectorizedBoxCox__base(
+    const int N,
+    const int D,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    const float eps,
+    float* y) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    for (int j = 0; j < D; ++j) {
+      const float t = std::max(x[offset + j] + lambda2[j], eps);
+      y[offset + j] = lambda1[j] == 0
+          ? std::log(t)
+          : (std::pow(t, lambda1[j]) - 1) / lambda1[j];
+    }
+  }
+}
+
+void VectorizedBoxCox(
+    const int N,
+    const int D,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    const float eps,
+    float* y) {
+  AVX512_DO(VectorizedBoxCox, N, D, x, lambda1, lambda2, eps, y);
+  AVX2_FMA_DO(VectorizedBoxCox, N, D, x, lambda1, lambda2, eps, y);
+  BASE_DO(VectorizedBoxCox, N, D, x, lambda1, lambda2, eps, y);
+}
+
+float VectorizedSum__base(const int N, const float* x) {
+  return ConstEigenVectorMap<float>(x, N).sum();
+}
+
+float VectorizedSum(const int N, const float* x) {
+  AVX512_DO(VectorizedSum, N, x);
+  AVX2_FMA_DO(VectorizedSum, N, x);
+  BASE_DO(VectorizedSum, N, x);
+}
+
+float VectorizedSumSqr__base(const int N, const float* x) {
+  return ConstEigenVectorMap<float>(x, N).squaredNorm();
+}
+
+float VectorizedSumSqr(const int N, const float* x) {
+  AVX512_DO(VectorizedSumSqr, N, x);
+  AVX2_FMA_DO(VectorizedSumSqr, N, x);
+  BASE_DO(VectorizedSumSqr, N, x);
+}
+
+void VectorizedAdd__base(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  EigenVectorMap<float>(y, N) = ConstEigenVectorMap<float>(a, N).array() +
+      ConstEigenVectorMap<float>(b, N).array();
+}
+
+void VectorizedAdd(const int N, const float* a, const float* b, float* y) {
+  AVX512_DO(VectorizedAdd, N, a, b, y);
+  AVX2_FMA_DO(VectorizedAdd, N, a, b, y);
+  BASE_DO(VectorizedAdd, N, a, b, y);
+}
+
+void VectorizedMul__base(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  EigenVectorMap<float>(y, N) = ConstEigenVectorMap<float>(a, N).array() *
+      ConstEigenVectorMap<float>(b, N).array();
+}
+
+void VectorizedMul(const int N, const float* a, const float* b, float* y) {
+  AVX512_DO(VectorizedMul, N, a, b, y);
+  AVX2_FMA_DO(VectorizedMul, N, a, b, y);
+  BASE_DO(VectorizedMul, N, a, b, y);
+}
+
+void VectorizedAddToRow__base(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  EigenArrayMap<float>(y, N, M) = ConstEigenArrayMap<float>(a, N, M).colwise() +
+      ConstEigenVectorArrayMap<float>(b, N);
+}
+
+void VectorizedAddToRow(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  AVX512_DO(VectorizedAddToRow, M, N, a, b, y);
+  AVX2_FMA_DO(VectorizedAddToRow, M, N, a, b, y);
+  BASE_DO(VectorizedAddToRow, M, N, a, b, y);
+}
+
+void VectorizedMulToRow__base(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  EigenArrayMap<float>(y, N, M) = ConstEigenArrayMap<float>(a, N, M).colwise() *
+      ConstEigenVectorArrayMap<float>(b, N);
+}
+
+void VectorizedMulToRow(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  AVX512_DO(VectorizedMulToRow, M, N, a, b, y);
+  AVX2_FMA_DO(VectorizedMulToRow, M, N, a, b, y);
+  BASE_DO(VectorizedMulToRow, M, N, a, b, y);
+}
+
+#define VECTORIZED_BROADCAST_FUNCTION(name, expr)                         \
+  void VectorizedBroadcast##name##__base(                                 \
+      const int N,                                                        \
+      const float* a,                                                     \
+      const bool a_scalar,                                                \
+      const float* b,                                                     \
+      const bool b_scalar,                                                \
+      float* y) {                                                         \
+    if (a_scalar) {                                                       \
+      EigenVectorArrayMap<float>(y, N) =                                  \
+          Eigen::ArrayXf::Constant(N, a[0]) expr                          \
+          ConstEigenVectorArrayMap<float>(b, N);                          \
+    } else if (b_scalar) {                                                \
+      EigenVectorArrayMap<float>(y, N) =                                  \
+          ConstEigenVectorArrayMap<float>(a, N) expr                      \
+          Eigen::ArrayXf::Constant(N, b[0]);                              \
+    } else {                                                              \
+      EigenVectorArrayMap<float>(y, N) =                                  \
+          ConstEigenVectorArrayMap<float>(a, N) expr                      \
+          ConstEigenVectorArrayMap<float>(b, N);                          \
+    }                                                                     \
+  }                                                                       \
+                                                                          \
+  void VectorizedBroadcast##name(                                         \
+      const int N,                                                        \
+      const float* a,                                                     \
+      const bool a_scalar,                                                \
+      const float* b,                                                     \
+      const bool b_scalar,                                                \
+      float* y) {                                                         \
+    AVX512_DO(VectorizedBroadcast##name, N, a, a_scalar, b, b_scalar, y); \
+    AVX2_FMA_DO(                                                          \
+        VectorizedBroadcast##name, N, a, a_scalar, b, b_scalar, y);       \
+    BASE_DO(VectorizedBroadcast##name, N, a, a_scalar, b, b_scalar, y);   \
+  }
+VECTORIZED_BROADCAST_FUNCTION(Add, +)
+VECTORIZED_BROADCAST_FUNCTION(Sub, -)
+VECTORIZED_BROADCAST_FUNCTION(Mul, *)
+VECTORIZED_BROADCAST_FUNCTION(Div, /)
+#undef VECTORIZED_BROADCAST_FUNCTION
+
+void VectorizedTranspose__base(
+    const int M,
+    const int N,
+    const float* x,
+    const int ldx,
+    float* y,
+    const int ldy) {
+  for (int i = 0; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      y[j * ldy + i] = x[i * ldx + j];
+    }
+  }
+}
+
+void VectorizedTranspose(
+    const int M,
+    const int N,
+    const float* x,
+    const int ldx,
+    float* y,
+    const int ldy) {
+  AVX2_FMA_DO(VectorizedTranspose, M, N, x, ldx, y, ldy);
+  BASE_DO(VectorizedTranspose, M, N, x, ldx, y, ldy);
+}
+
+} // namespace caffe2
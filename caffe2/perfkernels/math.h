@@ -0,0 +1,142 @@
+#pragma once
+
+namespace caffe2 {
+
+// Float primitives of utils/math_cpu.cc with runtime ISA dispatch. The base
+// versions are the Eigen implementations math_cpu.cc used to inline, the
+// AVX2 and AVX512 versions are picked at run time from cpuid, so portable
+// builds still use the widest vectors of the host.
+//
+// The vectorized Exp and Log use the same Cephes polynomials as Eigen and
+// are accurate to a couple of ulp, with Exp results below the normal range
+// flushed to zero. Special values follow the C library: Exp(-inf) = 0,
+// Exp(inf) = inf, Log(0) = -inf, Log(inf) = inf, Log(x < 0) = NaN, and NaN
+// inputs give NaN.
+
+void VectorizedExp(const int N, const float* x, float* y);
+void VectorizedLog(const int N, const float* x, float* y);
+void VectorizedSqrt(const int N, const float* x, float* y);
+
+// y = 1 / (1 + exp(-x)) and y = tanh(x) = 1 - 2 / (exp(2x) + 1), from Exp:
+// their absolute error is below 1e-7 and 2e-7. With fast, tanh is the
+// rational approximation of Eigen instead, saturated to +-1 outside of
+// [-9, 9], and sigmoid(x) = 0.5 + 0.5 * tanh(x / 2): 1.4 to 1.8 times
+// faster, with an absolute error below 4e-7 for both. NaN inputs give NaN.
+void VectorizedSigmoid(const int N, const float* x, float* y, const bool fast);
+void VectorizedTanh(const int N, const float* x, float* y, const bool fast);
+
+// y = a ^ b. Only b in {-1, 0.5, 1, 2} is vectorized, where the result is
+// computed with a division, a square root, a copy or a multiplication.
+void VectorizedPowx(const int N, const float* a, const float b, float* y);
+
+// y[i] = max_j x[i * D + j] for N rows of D columns.
+void VectorizedRowwiseMax(const int N, const int D, const float* x, float* y);
+
+// Softmax of N rows of D columns, y = exp(x - max) / sum, where max is the
+// row maximum and sum that of exp(x - max), or log softmax
+// y = x - max - log(sum) with logarithmic. The max and sum of every row are
+// written to rowmax and rowsum unless they are null. y can be x.
+//
+// Rows that fit in cache are read once for the maximum, once for the
+// exponentials and once to normalize them. Rows too long for L2 get their
+// maximum and sum in a single online pass instead, rescaling the partial sums
+// by exp(old max - new max) whenever the maximum grows, so that they are only
+// read twice from memory.
+void VectorizedSoftmax(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    const bool logarithmic,
+    float* rowmax,
+    float* rowsum);
+
+// Softmax gradient dx = y * (dy - dot(y, dy)) for N rows of D columns. dx can
+// be dy.
+void VectorizedSoftmaxGradient(
+    const int N,
+    const int D,
+    const float* y,
+    const float* dy,
+    float* dx);
+
+// Box-Cox transform of the columns of an N x D matrix, with t = max(x +
+// lambda2, eps): y = log(t) in the columns where lambda1 is 0, and
+// y = (t ^ lambda1 - 1) / lambda1 = (exp(lambda1 * log(t)) - 1) / lambda1 in
+// the others. Both are computed for every element and the result selected by
+// a mask of the zero lambda1, so that mixed columns run the same vector code
+// without branches. y can be x.
+void VectorizedBoxCox(
+    const int N,
+    const int D,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    const float eps,
+    float* y);
+
+float VectorizedSum(const int N, const float* x);
+float VectorizedSumSqr(const int N, const float* x);
+
+void VectorizedAdd(const int N, const float* a, const float* b, float* y);
+void VectorizedMul(const int N, const float* a, const float* b, float* y);
+
+// Broadcast the vector b of size N to every row of the M x N matrix a.
+// y can be a.
+void VectorizedAddToRow(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y);
+void VectorizedMulToRow(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y);
+
+// The float kernels of math::Broadcast{Add,Sub,Mul,Div}: y = a op b for N
+// values, where a_scalar or b_scalar broadcast a[0] or b[0] to all of them.
+// y can be a or b.
+void VectorizedBroadcastAdd(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y);
+void VectorizedBroadcastSub(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y);
+void VectorizedBroadcastMul(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y);
+void VectorizedBroadcastDiv(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y);
+
+// y[j * ldy + i] = x[i * ldx + j] for the M x N matrix x, with the leading
+// dimensions ldx and ldy. Meant for tiles that fit in cache, the AVX2
+// version transposes blocks of 8 x 8 in registers.
+void VectorizedTranspose(
+    const int M,
+    const int N,
+    const float* x,
+    const int ldx,
+    float* y,
+    const int ldy);
+
+} // namespace caffe2
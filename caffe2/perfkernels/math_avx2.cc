@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+// Cephes expf: exp(x) = 2^n * exp(r) with r = x - n * ln(2) in
+// [-ln(2) / 2, ln(2) / 2], ln(2) being split in two for an exact reduction.
+inline __m256 Exp(__m256 x) {
+  const __m256 nan_mask = _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+  const __m256 input = x;
+  x = _mm256_min_ps(x, _mm256_set1_ps(88.3762626647950f));
+  x = _mm256_max_ps(x, _mm256_set1_ps(-88.3762626647949f));
+
+  const __m256 fx = _mm256_floor_ps(_mm256_fmadd_ps(
+      x, _mm256_set1_ps(1.44269504088896341f), _mm256_set1_ps(0.5f)));
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(0.693359375f), x);
+  x = _mm256_fnmadd_ps(fx, _mm256_set1_ps(-2.12194440e-4f), x);
+
+  const __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+  y = _mm256_fmadd_ps(y, z, x);
+  y = _mm256_add_ps(y, _mm256_set1_ps(1.0f));
+
+  // 2^n, which is 0 for n = -127 and inf for n = 128
+  const __m256i n = _mm256_add_epi32(
+      _mm256_cvttps_epi32(fx), _mm256_set1_epi32(0x7f));
+  y = _mm256_mul_ps(y, _mm256_castsi256_ps(_mm256_slli_epi32(n, 23)));
+  return _mm256_blendv_ps(y, input, nan_mask);
+}
+
+// Cephes logf: log(x) = log(m) + e * ln(2) with m in [sqrt(0.5), sqrt(2)).
+inline __m256 Log(__m256 x) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+  const __m256 nan_mask = _mm256_cmp_ps(x, zero, _CMP_NGE_UQ);
+  const __m256 zero_mask = _mm256_cmp_ps(x, zero, _CMP_EQ_OQ);
+  const __m256 inf_mask = _mm256_cmp_ps(x, inf, _CMP_EQ_OQ);
+
+  // Subnormals are scaled by 2^23 into the normal range
+  const __m256 subnormal_mask = _mm256_cmp_ps(
+      x, _mm256_set1_ps(std::numeric_limits<float>::min()), _CMP_LT_OQ);
+  x = _mm256_blendv_ps(
+      x, _mm256_mul_ps(x, _mm256_set1_ps(8388608.0f)), subnormal_mask);
+
+  const __m256i bits = _mm256_castps_si256(x);
+  __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(
+      _mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0x7e)));
+  e = _mm256_sub_ps(e, _mm256_and_ps(subnormal_mask, _mm256_set1_ps(23.0f)));
+  x = _mm256_castsi256_ps(_mm256_or_si256(
+      _mm256_and_si256(bits, _mm256_set1_epi32(0x807fffff)),
+      _mm256_set1_epi32(0x3f000000)));
+
+  const __m256 small_mask =
+      _mm256_cmp_ps(x, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(small_mask, one));
+  x = _mm256_add_ps(_mm256_sub_ps(x, one), _mm256_and_ps(small_mask, x));
+
+  const __m256 z = _mm256_mul_ps(x, x);
+  __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.1514610310e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.1676998740e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.2420140846e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.4249322787e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-1.6668057665e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(2.0000714765e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(-2.4999993993e-1f));
+  y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(3.3333331174e-1f));
+  y = _mm256_mul_ps(_mm256_mul_ps(y, x), z);
+  y = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), y);
+  y = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), y);
+  y = _mm256_add_ps(x, y);
+  y = _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), y);
+
+  y = _mm256_blendv_ps(y, _mm256_sub_ps(zero, inf), zero_mask);
+  y = _mm256_blendv_ps(y, inf, inf_mask);
+  return _mm256_blendv_ps(
+      y, _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN()), nan_mask);
+}
+
+// Rational approximation of tanh on [-9, 9] from Eigen, see math.h
+inline __m256 FastTanh(__m256 x) {
+  // NaN is the second operand so that it propagates
+  x = _mm256_min_ps(_mm256_set1_ps(9.0f), x);
+  x = _mm256_max_ps(_mm256_set1_ps(-9.0f), x);
+  const __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_set1_ps(-2.76076847742355e-16f);
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(2.00018790482477e-13f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-8.60467152213735e-11f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(5.12229709037114e-08f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.48572235717979e-05f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(6.37261928875436e-04f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(4.89352455891786e-03f));
+  __m256 q = _mm256_set1_ps(1.19825839466702e-06f);
+  q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(1.18534705686654e-04f));
+  q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(2.26843463243900e-03f));
+  q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(4.89352518554385e-03f));
+  return _mm256_div_ps(_mm256_mul_ps(x, p), q);
+}
+
+inline float HorizontalSum(__m256 v) {
+  __m128 s =
+      _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+inline float HorizontalMax(__m256 v) {
+  __m128 s =
+      _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_max_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+// Applies f to full vectors, and to the tail through a zero padded buffer so
+// that every element goes through the same code.
+template <typename F>
+inline void UnaryKernel(const int N, const float* x, float* y, F f) {
+  int i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(y + i, f(_mm256_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    float buffer[8] = {0};
+    memcpy(buffer, x + i, (N - i) * sizeof(float));
+    _mm256_storeu_ps(buffer, f(_mm256_loadu_ps(buffer)));
+    memcpy(y + i, buffer, (N - i) * sizeof(float));
+  }
+}
+
+} // namespace
+
+void VectorizedExp__avx2_fma(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m256 v) { return Exp(v); });
+}
+
+void VectorizedSigmoid__avx2_fma(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  if (fast) {
+    UnaryKernel(N, x, y, [half](__m256 v) {
+      return _mm256_fmadd_ps(half, FastTanh(_mm256_mul_ps(half, v)), half);
+    });
+  } else {
+    UnaryKernel(N, x, y, [one](__m256 v) {
+      return _mm256_div_ps(
+          one, _mm256_add_ps(one, Exp(_mm256_sub_ps(_mm256_setzero_ps(), v))));
+    });
+  }
+}
+
+void VectorizedTanh__avx2_fma(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 two = _mm256_set1_ps(2.0f);
+  if (fast) {
+    UnaryKernel(N, x, y, [](__m256 v) { return FastTanh(v); });
+  } else {
+    UnaryKernel(N, x, y, [one, two](__m256 v) {
+      return _mm256_sub_ps(
+          one,
+          _mm256_div_ps(two, _mm256_add_ps(Exp(_mm256_mul_ps(two, v)), one)));
+    });
+  }
+}
+
+void VectorizedLog__avx2_fma(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m256 v) { return Log(v); });
+}
+
+void VectorizedSqrt__avx2_fma(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m256 v) { return _mm256_sqrt_ps(v); });
+}
+
+void VectorizedPowx__avx2_fma(
+    const int N,
+    const float* a,
+    const float b,
+    float* y) {
+  if (b == -1.0f) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    UnaryKernel(N, a, y, [one](__m256 v) { return _mm256_div_ps(one, v); });
+  } else if (b == 0.5f) {
+    UnaryKernel(N, a, y, [](__m256 v) { return _mm256_sqrt_ps(v); });
+  } else if (b == 1.0f) {
+    if (y != a) {
+      memcpy(y, a, N * sizeof(float));
+    }
+  } else {
+    UnaryKernel(N, a, y, [](__m256 v) { return _mm256_mul_ps(v, v); });
+  }
+}
+
+void VectorizedRowwiseMax__avx2_fma(
+    const int N,
+    const int D,
+    const float* x,
+    float* y) {
+  for (int i = 0; i < N; ++i) {
+    const float* row = x + static_cast<size_t>(i) * D;
+    float result = -std::numeric_limits<float>::infinity();
+    int j = 0;
+    if (D >= 8) {
+      __m256 vmax = _mm256_loadu_ps(row);
+      for (j = 8; j + 8 <= D; j += 8) {
+        vmax = _mm256_max_ps(vmax, _mm256_loadu_ps(row + j));
+      }
+      result = HorizontalMax(vmax);
+    }
+    for (; j < D; ++j) {
+      result = std::max(result, row[j]);
+    }
+    y[i] = result;
+  }
+}
+
+float VectorizedSum__avx2_fma(const int N, const float* x) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(x + i));
+    acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(x + i + 8));
+  }
+  if (i + 8 <= N) {
+    acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(x + i));
+    i += 8;
+  }
+  float sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+  for (; i < N; ++i) {
+    sum += x[i];
+  }
+  return sum;
+}
+
+float VectorizedSumSqr__avx2_fma(const int N, const float* x) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  int i = 0;
+  for (; i + 16 <= N; i += 16) {
+    const __m256 v0 = _mm256_loadu_ps(x + i);
+    const __m256 v1 = _mm256_loadu_ps(x + i + 8);
+    acc0 = _mm256_fmadd_ps(v0, v0, acc0);
+    acc1 = _mm256_fmadd_ps(v1, v1, acc1);
+  }
+  if (i + 8 <= N) {
+    const __m256 v0 = _mm256_loadu_ps(x + i);
+    acc0 = _mm256_fmadd_ps(v0, v0, acc0);
+    i += 8;
+  }
+  float sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+  for (; i < N; ++i) {
+    sum += x[i] * x[i];
+  }
+  return sum;
+}
+
+void VectorizedAdd__avx2_fma(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  int i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = a[i] + b[i];
+  }
+}
+
+void VectorizedMul__avx2_fma(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  int i = 0;
+  for (; i + 8 <= N; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  for (; i < N; ++i) {
+    y[i] = a[i] * b[i];
+  }
+}
+
+void VectorizedAddToRow__avx2_fma(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  for (int i = 0; i < M; ++i) {
+    VectorizedAdd__avx2_fma(
+        N,
+        a + static_cast<size_t>(i) * N,
+        b,
+        y + static_cast<size_t>(i) * N);
+  }
+}
+
+void VectorizedMulToRow__avx2_fma(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  for (int i = 0; i < M; ++i) {
+    VectorizedMul__avx2_fma(
+        N,
+        a + static_cast<size_t>(i) * N,
+        b,
+        y + static_cast<size_t>(i) * N);
+  }
+}
+
+namespace {
+
+// y = a op b, see VectorizedBroadcastAdd
+template <class Op>
+inline void VectorizedBroadcast(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y) {
+  int i = 0;
+  if (a_scalar) {
+    const float a0 = a[0];
+    const __m256 va = _mm256_set1_ps(a0);
+    for (; i + 8 <= N; i += 8) {
+      _mm256_storeu_ps(y + i, Op::Packet(va, _mm256_loadu_ps(b + i)));
+    }
+    for (; i < N; ++i) {
+      y[i] = Op::Scalar(a0, b[i]);
+    }
+  } else if (b_scalar) {
+    const float b0 = b[0];
+    const __m256 vb = _mm256_set1_ps(b0);
+    for (; i + 8 <= N; i += 8) {
+      _mm256_storeu_ps(y + i, Op::Packet(_mm256_loadu_ps(a + i), vb));
+    }
+    for (; i < N; ++i) {
+      y[i] = Op::Scalar(a[i], b0);
+    }
+  } else {
+    for (; i + 8 <= N; i += 8) {
+      _mm256_storeu_ps(
+          y + i, Op::Packet(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    for (; i < N; ++i) {
+      y[i] = Op::Scalar(a[i], b[i]);
+    }
+  }
+}
+
+#define VECTORIZED_BROADCAST_OP(name, intrinsic, expr) \
+  struct name##Op {                                    \
+    static inline __m256 Packet(__m256 a, __m256 b) {  \
+      return intrinsic(a, b);                          \
+    }                                                  \
+    static inline float Scalar(float a, float b) {     \
+      return a expr b;                                 \
+    }                                                  \
+  };
+VECTORIZED_BROADCAST_OP(Add, _mm256_add_ps, +)
+VECTORIZED_BROADCAST_OP(Sub, _mm256_sub_ps, -)
+VECTORIZED_BROADCAST_OP(Mul, _mm256_mul_ps, *)
+VECTORIZED_BROADCAST_OP(Div, _mm256_div_ps, /)
+#undef VECTORIZED_BROADCAST_OP
+
+} // namespace
+
+#define VECTORIZED_BROADCAST_FUNCTION(name)                         \
+  void VectorizedBroadcast##name##__avx2_fma(                       \
+      const int N,                                                  \
+      const float* a,                                               \
+      const bool a_scalar,                                          \
+      const float* b,                                               \
+      const bool b_scalar,                                          \
+      float* y) {                                                   \
+    VectorizedBroadcast<name##Op>(N, a, a_scalar, b, b_scalar, y); \
+  }
+VECTORIZED_BROADCAST_FUNCTION(Add)
+VECTORIZED_BROADCAST_FUNCTION(Sub)
+VECTORIZED_BROADCAST_FUNCTION(Mul)
+VECTORIZED_BROADCAST_FUNCTION(Div)
+#undef VECTORIZED_BROADCAST_FUNCTION
+
+namespace {
+
+// Transposes the 8 x 8 block of x into y
+inline void
+Transpose8x8(const float* x, const int ldx, float* y, const int ldy) {
+  __m256 r[8];
+  for (int i = 0; i < 8; ++i) {
+    r[i] = _mm256_loadu_ps(x + i * ldx);
+  }
+  __m256 t[8];
+  for (int i = 0; i < 8; i += 2) {
+    t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+    t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+  }
+  for (int i = 0; i < 8; i += 4) {
+    r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+    r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+    r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+    r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+  }
+  for (int i = 0; i < 4; ++i) {
+    _mm256_storeu_ps(y + i * ldy, _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+    _mm256_storeu_ps(
+        y + (i + 4) * ldy, _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+  }
+}
+
+} // namespace
+
+void VectorizedTranspose__avx2_fma(
+    const int M,
+    const int N,
+    const float* x,
+    const int ldx,
+    float* y,
+    const int ldy) {
+  int i = 0;
+  for (; i + 8 <= M; i += 8) {
+    int j = 0;
+    for (; j + 8 <= N; j += 8) {
+      Transpose8x8(x + i * ldx + j, ldx, y + j * ldy + i, ldy);
+    }
+    for (; j < N; ++j) {
+      for (int k = i; k < i + 8; ++k) {
+        y[j * ldy + k] = x[k * ldx + j];
+      }
+    }
+  }
+  for (; i < M; ++i) {
+    for (int j = 0; j < N; ++j) {
+      y[j * ldy + i] = x[i * ldx + j];
+    }
+  }
+}
+
+namespace {
+
+// Lanes [0, n) of a vector, for the masked loads and stores of row tails
+inline __m256i RangeMask(const int j, const int D) {
+  return _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(std::min(D - j, 8)),
+      _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+// Masked load with the other lanes set to -inf
+inline __m256 MaskLoadNegInf(const float* x, const __m256i mask) {
+  return _mm256_blendv_ps(
+      _mm256_set1_ps(-std::numeric_limits<float>::infinity()),
+      _mm256_maskload_ps(x, mask),
+      _mm256_castsi256_ps(mask));
+}
+
+// Row maximum and sum of exp(x - max) in one pass. Every lane keeps its own
+// maximum and sum, rescaled by exp(old max - new max) once per 4 vectors.
+inline void OnlineMaxSum(const int D, const float* x, float* max, float* sum) {
+  // Not -inf, for exp(vmax - new max) to be 0 rather than NaN
+  __m256 vmax = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+  __m256 vsum = _mm256_setzero_ps();
+  int j = 0;
+  for (; j + 32 <= D; j += 32) {
+    const __m256 x0 = _mm256_loadu_ps(x + j);
+    const __m256 x1 = _mm256_loadu_ps(x + j + 8);
+    const __m256 x2 = _mm256_loadu_ps(x + j + 16);
+    const __m256 x3 = _mm256_loadu_ps(x + j + 24);
+    const __m256 new_max = _mm256_max_ps(
+        vmax,
+        _mm256_max_ps(_mm256_max_ps(x0, x1), _mm256_max_ps(x2, x3)));
+    vsum = _mm256_mul_ps(vsum, Exp(_mm256_sub_ps(vmax, new_max)));
+    vsum = _mm256_add_ps(
+        vsum,
+        _mm256_add_ps(
+            _mm256_add_ps(
+                Exp(_mm256_sub_ps(x0, new_max)),
+                Exp(_mm256_sub_ps(x1, new_max))),
+            _mm256_add_ps(
+                Exp(_mm256_sub_ps(x2, new_max)),
+                Exp(_mm256_sub_ps(x3, new_max)))));
+    vmax = new_max;
+  }
+  for (; j < D; j += 8) {
+    const __m256 xj = MaskLoadNegInf(x + j, RangeMask(j, D));
+    const __m256 new_max = _mm256_max_ps(vmax, xj);
+    vsum = _mm256_fmadd_ps(
+        vsum,
+        Exp(_mm256_sub_ps(vmax, new_max)),
+        Exp(_mm256_sub_ps(xj, new_max)));
+    vmax = new_max;
+  }
+  *max = HorizontalMax(vmax);
+  *sum = HorizontalSum(_mm256_mul_ps(
+      vsum, Exp(_mm256_sub_ps(vmax, _mm256_set1_ps(*max)))));
+}
+
+} // namespace
+
+void VectorizedSoftmax__avx2_fma(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    const bool logarithmic,
+    const bool online,
+    float* rowmax,
+    float* rowsum) {
+  const __m256 neg_inf =
+      _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+  for (int i = 0; i < N; ++i) {
+    const float* xrow = x + static_cast<size_t>(i) * D;
+    float* yrow = y + static_cast<size_t>(i) * D;
+    float max;
+    float sum;
+    if (online) {
+      OnlineMaxSum(D, xrow, &max, &sum);
+    } else {
+      __m256 vmax0 = neg_inf;
+      __m256 vmax1 = neg_inf;
+      int j = 0;
+      for (; j + 16 <= D; j += 16) {
+        vmax0 = _mm256_max_ps(vmax0, _mm256_loadu_ps(xrow + j));
+        vmax1 = _mm256_max_ps(vmax1, _mm256_loadu_ps(xrow + j + 8));
+      }
+      for (; j < D; j += 8) {
+        vmax0 = _mm256_max_ps(
+            vmax0, MaskLoadNegInf(xrow + j, RangeMask(j, D)));
+      }
+      max = HorizontalMax(_mm256_max_ps(vmax0, vmax1));
+      // The exponentials are kept in y to be normalized below
+      const __m256 vmax = _mm256_set1_ps(max);
+      __m256 vsum = _mm256_setzero_ps();
+      for (j = 0; j + 8 <= D; j += 8) {
+        const __m256 e = Exp(_mm256_sub_ps(_mm256_loadu_ps(xrow + j), vmax));
+        if (!logarithmic) {
+          _mm256_storeu_ps(yrow + j, e);
+        }
+        vsum = _mm256_add_ps(vsum, e);
+      }
+      if (j < D) {
+        const __m256i mask = RangeMask(j, D);
+        const __m256 e =
+            Exp(_mm256_sub_ps(MaskLoadNegInf(xrow + j, mask), vmax));
+        if (!logarithmic) {
+          _mm256_maskstore_ps(yrow + j, mask, e);
+        }
+        vsum = _mm256_add_ps(vsum, e);
+      }
+      sum = HorizontalSum(vsum);
+    }
+    if (logarithmic) {
+      const __m256 shift =
+          _mm256_set1_ps(max + std::log(std::max(sum, 1e-20f)));
+      UnaryKernel(D, xrow, yrow, [shift](__m256 v) {
+        return _mm256_sub_ps(v, shift);
+      });
+    } else if (online) {
+      const __m256 vmax = _mm256_set1_ps(max);
+      const __m256 inv = _mm256_set1_ps(1.0f / sum);
+      UnaryKernel(D, xrow, yrow, [vmax, inv](__m256 v) {
+        return _mm256_mul_ps(Exp(_mm256_sub_ps(v, vmax)), inv);
+      });
+    } else {
+      const __m256 inv = _mm256_set1_ps(1.0f / sum);
+      UnaryKernel(
+          D, yrow, yrow, [inv](__m256 v) { return _mm256_mul_ps(v, inv); });
+    }
+    if (rowmax) {
+      rowmax[i] = max;
+    }
+    if (rowsum) {
+      rowsum[i] = sum;
+    }
+  }
+}
+
+void VectorizedSoftmaxGradient__avx2_fma(
+    const int N,
+    const int D,
+    const float* y,
+    const float* dy,
+    float* dx) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    __m256 vdot = _mm256_setzero_ps();
+    for (int j = 0; j < D; j += 8) {
+      const __m256i mask = RangeMask(j, D);
+      vdot = _mm256_fmadd_ps(
+          _mm256_maskload_ps(y + offset + j, mask),
+          _mm256_maskload_ps(dy + offset + j, mask),
+          vdot);
+    }
+    const __m256 dot = _mm256_set1_ps(HorizontalSum(vdot));
+    for (int j = 0; j < D; j += 8) {
+      const __m256i mask = RangeMask(j, D);
+      _mm256_maskstore_ps(
+          dx + offset + j,
+          mask,
+          _mm256_mul_ps(
+              _mm256_maskload_ps(y + offset + j, mask),
+              _mm256_sub_ps(_mm256_maskload_ps(dy + offset + j, mask), dot)));
+    }
+  }
+}
+
+void VectorizedBoxCox__avx2_fma(
+    const int N,
+    const int D,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    const float eps,
+    float* y) {
+  const __m256 veps = _mm256_set1_ps(eps);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    for (int j = 0; j < D; j += 8) {
+      // The masked out lanes compute log(eps) from zeros and are not stored
+      const __m256i mask = RangeMask(j, D);
+      const __m256 l1 = _mm256_maskload_ps(lambda1 + j, mask);
+      const __m256 t = _mm256_max_ps(
+          _mm256_add_ps(
+              _mm256_maskload_ps(x + offset + j, mask),
+              _mm256_maskload_ps(lambda2 + j, mask)),
+          veps);
+      const __m256 log_t = Log(t);
+      const __m256 pow_t =
+          _mm256_div_ps(_mm256_sub_ps(Exp(_mm256_mul_ps(l1, log_t)), one), l1);
+      const __m256 zero_l1 =
+          _mm256_cmp_ps(l1, _mm256_setzero_ps(), _CMP_EQ_OQ);
+      _mm256_maskstore_ps(
+          y + offset + j, mask, _mm256_blendv_ps(pow_t, log_t, zero_l1));
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,615 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+namespace {
+
+inline __mmask16 TailMask(const int N) {
+  return (1 << (N % 16)) - 1;
+}
+
+inline __m512 And(__m512 a, __m512 b) {
+  return _mm512_castsi512_ps(
+      _mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+}
+
+// Same Cephes expf as the AVX2 kernel, see math_avx2.cc.
+inline __m512 Exp(__m512 x) {
+  const __mmask16 nan_mask = _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q);
+  const __m512 input = x;
+  x = _mm512_min_ps(x, _mm512_set1_ps(88.3762626647950f));
+  x = _mm512_max_ps(x, _mm512_set1_ps(-88.3762626647949f));
+
+  const __m512 fx = _mm512_roundscale_ps(
+      _mm512_fmadd_ps(
+          x, _mm512_set1_ps(1.44269504088896341f), _mm512_set1_ps(0.5f)),
+      _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(0.693359375f), x);
+  x = _mm512_fnmadd_ps(fx, _mm512_set1_ps(-2.12194440e-4f), x);
+
+  const __m512 z = _mm512_mul_ps(x, x);
+  __m512 y = _mm512_set1_ps(1.9875691500e-4f);
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.3981999507e-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(8.3334519073e-3f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(4.1665795894e-2f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.6666665459e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(5.0000001201e-1f));
+  y = _mm512_fmadd_ps(y, z, x);
+  y = _mm512_add_ps(y, _mm512_set1_ps(1.0f));
+
+  // 2^n, which is 0 for n = -127 and inf for n = 128
+  const __m512i n = _mm512_add_epi32(
+      _mm512_cvttps_epi32(fx), _mm512_set1_epi32(0x7f));
+  y = _mm512_mul_ps(y, _mm512_castsi512_ps(_mm512_slli_epi32(n, 23)));
+  return _mm512_mask_blend_ps(nan_mask, y, input);
+}
+
+// Same Cephes logf as the AVX2 kernel, see math_avx2.cc.
+inline __m512 Log(__m512 x) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.0f);
+  const __m512 inf = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+  const __mmask16 nan_mask = _mm512_cmp_ps_mask(x, zero, _CMP_NGE_UQ);
+  const __mmask16 zero_mask = _mm512_cmp_ps_mask(x, zero, _CMP_EQ_OQ);
+  const __mmask16 inf_mask = _mm512_cmp_ps_mask(x, inf, _CMP_EQ_OQ);
+
+  // Subnormals are scaled by 2^23 into the normal range
+  const __mmask16 subnormal_mask = _mm512_cmp_ps_mask(
+      x, _mm512_set1_ps(std::numeric_limits<float>::min()), _CMP_LT_OQ);
+  x = _mm512_mask_mul_ps(x, subnormal_mask, x, _mm512_set1_ps(8388608.0f));
+
+  const __m512i bits = _mm512_castps_si512(x);
+  __m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(
+      _mm512_srli_epi32(bits, 23), _mm512_set1_epi32(0x7e)));
+  e = _mm512_mask_sub_ps(e, subnormal_mask, e, _mm512_set1_ps(23.0f));
+  x = _mm512_castsi512_ps(_mm512_or_si512(
+      _mm512_and_si512(bits, _mm512_set1_epi32(0x807fffff)),
+      _mm512_set1_epi32(0x3f000000)));
+
+  const __mmask16 small_mask = _mm512_cmp_ps_mask(
+      x, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm512_mask_sub_ps(e, small_mask, e, one);
+  x = _mm512_mask_add_ps(
+      _mm512_sub_ps(x, one), small_mask, _mm512_sub_ps(x, one), x);
+
+  const __m512 z = _mm512_mul_ps(x, x);
+  __m512 y = _mm512_set1_ps(7.0376836292e-2f);
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.1514610310e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.1676998740e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.2420140846e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(1.4249322787e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-1.6668057665e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(2.0000714765e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(-2.4999993993e-1f));
+  y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(3.3333331174e-1f));
+  y = _mm512_mul_ps(_mm512_mul_ps(y, x), z);
+  y = _mm512_fmadd_ps(e, _mm512_set1_ps(-2.12194440e-4f), y);
+  y = _mm512_fnmadd_ps(z, _mm512_set1_ps(0.5f), y);
+  y = _mm512_add_ps(x, y);
+  y = _mm512_fmadd_ps(e, _mm512_set1_ps(0.693359375f), y);
+
+  y = _mm512_mask_blend_ps(zero_mask, y, _mm512_sub_ps(zero, inf));
+  y = _mm512_mask_blend_ps(inf_mask, y, inf);
+  return _mm512_mask_blend_ps(
+      nan_mask, y, _mm512_set1_ps(std::numeric_limits<float>::quiet_NaN()));
+}
+
+// Rational approximation of tanh on [-9, 9] from Eigen, see math.h
+inline __m512 FastTanh(__m512 x) {
+  // NaN is the second operand so that it propagates
+  x = _mm512_min_ps(_mm512_set1_ps(9.0f), x);
+  x = _mm512_max_ps(_mm512_set1_ps(-9.0f), x);
+  const __m512 x2 = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_set1_ps(-2.76076847742355e-16f);
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(2.00018790482477e-13f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(-8.60467152213735e-11f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(5.12229709037114e-08f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(1.48572235717979e-05f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(6.37261928875436e-04f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(4.89352455891786e-03f));
+  __m512 q = _mm512_set1_ps(1.19825839466702e-06f);
+  q = _mm512_fmadd_ps(q, x2, _mm512_set1_ps(1.18534705686654e-04f));
+  q = _mm512_fmadd_ps(q, x2, _mm512_set1_ps(2.26843463243900e-03f));
+  q = _mm512_fmadd_ps(q, x2, _mm512_set1_ps(4.89352518554385e-03f));
+  return _mm512_div_ps(_mm512_mul_ps(x, p), q);
+}
+
+// Applies f to full vectors and to the tail with masked loads and stores.
+template <typename F>
+inline void UnaryKernel(const int N, const float* x, float* y, F f) {
+  int i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(y + i, f(_mm512_loadu_ps(x + i)));
+  }
+  if (i < N) {
+    const __mmask16 mask = TailMask(N);
+    _mm512_mask_storeu_ps(y + i, mask, f(_mm512_maskz_loadu_ps(mask, x + i)));
+  }
+}
+
+} // namespace
+
+void VectorizedExp__avx512(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m512 v) { return Exp(v); });
+}
+
+void VectorizedSigmoid__avx512(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  const __m512 half = _mm512_set1_ps(0.5f);
+  const __m512 one = _mm512_set1_ps(1.0f);
+  if (fast) {
+    UnaryKernel(N, x, y, [half](__m512 v) {
+      return _mm512_fmadd_ps(half, FastTanh(_mm512_mul_ps(half, v)), half);
+    });
+  } else {
+    UnaryKernel(N, x, y, [one](__m512 v) {
+      return _mm512_div_ps(
+          one, _mm512_add_ps(one, Exp(_mm512_sub_ps(_mm512_setzero_ps(), v))));
+    });
+  }
+}
+
+void VectorizedTanh__avx512(
+    const int N,
+    const float* x,
+    float* y,
+    const bool fast) {
+  const __m512 one = _mm512_set1_ps(1.0f);
+  const __m512 two = _mm512_set1_ps(2.0f);
+  if (fast) {
+    UnaryKernel(N, x, y, [](__m512 v) { return FastTanh(v); });
+  } else {
+    UnaryKernel(N, x, y, [one, two](__m512 v) {
+      return _mm512_sub_ps(
+          one,
+          _mm512_div_ps(two, _mm512_add_ps(Exp(_mm512_mul_ps(two, v)), one)));
+    });
+  }
+}
+
+void VectorizedLog__avx512(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m512 v) { return Log(v); });
+}
+
+void VectorizedSqrt__avx512(const int N, const float* x, float* y) {
+  UnaryKernel(N, x, y, [](__m512 v) { return _mm512_sqrt_ps(v); });
+}
+
+void VectorizedPowx__avx512(
+    const int N,
+    const float* a,
+    const float b,
+    float* y) {
+  if (b == -1.0f) {
+    const __m512 one = _mm512_set1_ps(1.0f);
+    UnaryKernel(N, a, y, [one](__m512 v) { return _mm512_div_ps(one, v); });
+  } else if (b == 0.5f) {
+    UnaryKernel(N, a, y, [](__m512 v) { return _mm512_sqrt_ps(v); });
+  } else if (b == 1.0f) {
+    if (y != a) {
+      memcpy(y, a, N * sizeof(float));
+    }
+  } else {
+    UnaryKernel(N, a, y, [](__m512 v) { return _mm512_mul_ps(v, v); });
+  }
+}
+
+void VectorizedRowwiseMax__avx512(
+    const int N,
+    const int D,
+    const float* x,
+    float* y) {
+  const __mmask16 tail_mask = TailMask(D);
+  for (int i = 0; i < N; ++i) {
+    const float* row = x + static_cast<size_t>(i) * D;
+    __m512 vmax = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+    int j = 0;
+    for (; j + 16 <= D; j += 16) {
+      vmax = _mm512_max_ps(vmax, _mm512_loadu_ps(row + j));
+    }
+    if (j < D) {
+      vmax = _mm512_mask_max_ps(
+          vmax, tail_mask, vmax, _mm512_maskz_loadu_ps(tail_mask, row + j));
+    }
+    y[i] = _mm512_reduce_max_ps(vmax);
+  }
+}
+
+float VectorizedSum__avx512(const int N, const float* x) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  int i = 0;
+  for (; i + 32 <= N; i += 32) {
+    acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(x + i));
+    acc1 = _mm512_add_ps(acc1, _mm512_loadu_ps(x + i + 16));
+  }
+  for (; i + 16 <= N; i += 16) {
+    acc0 = _mm512_add_ps(acc0, _mm512_loadu_ps(x + i));
+  }
+  if (i < N) {
+    acc1 = _mm512_add_ps(acc1, _mm512_maskz_loadu_ps(TailMask(N), x + i));
+  }
+  return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+float VectorizedSumSqr__avx512(const int N, const float* x) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  int i = 0;
+  for (; i + 32 <= N; i += 32) {
+    const __m512 v0 = _mm512_loadu_ps(x + i);
+    const __m512 v1 = _mm512_loadu_ps(x + i + 16);
+    acc0 = _mm512_fmadd_ps(v0, v0, acc0);
+    acc1 = _mm512_fmadd_ps(v1, v1, acc1);
+  }
+  for (; i + 16 <= N; i += 16) {
+    const __m512 v0 = _mm512_loadu_ps(x + i);
+    acc0 = _mm512_fmadd_ps(v0, v0, acc0);
+  }
+  if (i < N) {
+    const __m512 v1 = _mm512_maskz_loadu_ps(TailMask(N), x + i);
+    acc1 = _mm512_fmadd_ps(v1, v1, acc1);
+  }
+  return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+void VectorizedAdd__avx512(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  int i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+  }
+  if (i < N) {
+    const __mmask16 mask = TailMask(N);
+    _mm512_mask_storeu_ps(
+        y + i,
+        mask,
+        _mm512_add_ps(
+            _mm512_maskz_loadu_ps(mask, a + i),
+            _mm512_maskz_loadu_ps(mask, b + i)));
+  }
+}
+
+void VectorizedMul__avx512(
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  int i = 0;
+  for (; i + 16 <= N; i += 16) {
+    _mm512_storeu_ps(
+        y + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+  }
+  if (i < N) {
+    const __mmask16 mask = TailMask(N);
+    _mm512_mask_storeu_ps(
+        y + i,
+        mask,
+        _mm512_mul_ps(
+            _mm512_maskz_loadu_ps(mask, a + i),
+            _mm512_maskz_loadu_ps(mask, b + i)));
+  }
+}
+
+void VectorizedAddToRow__avx512(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  for (int i = 0; i < M; ++i) {
+    VectorizedAdd__avx512(
+        N,
+        a + static_cast<size_t>(i) * N,
+        b,
+        y + static_cast<size_t>(i) * N);
+  }
+}
+
+void VectorizedMulToRow__avx512(
+    const int M,
+    const int N,
+    const float* a,
+    const float* b,
+    float* y) {
+  for (int i = 0; i < M; ++i) {
+    VectorizedMul__avx512(
+        N,
+        a + static_cast<size_t>(i) * N,
+        b,
+        y + static_cast<size_t>(i) * N);
+  }
+}
+
+namespace {
+
+// y = a op b, see VectorizedBroadcastAdd
+template <class Op>
+inline void VectorizedBroadcast(
+    const int N,
+    const float* a,
+    const bool a_scalar,
+    const float* b,
+    const bool b_scalar,
+    float* y) {
+  const __mmask16 mask = TailMask(N);
+  const int tail = N - N % 16;
+  // The masked out lanes of the tail are 1, so that Div raises no exception
+  const __m512 one = _mm512_set1_ps(1);
+  if (a_scalar) {
+    const __m512 va = _mm512_set1_ps(a[0]);
+    for (int i = 0; i < tail; i += 16) {
+      _mm512_storeu_ps(y + i, Op::Packet(va, _mm512_loadu_ps(b + i)));
+    }
+    if (mask) {
+      _mm512_mask_storeu_ps(
+          y + tail,
+          mask,
+          Op::Packet(va, _mm512_mask_loadu_ps(one, mask, b + tail)));
+    }
+  } else if (b_scalar) {
+    const __m512 vb = _mm512_set1_ps(b[0]);
+    for (int i = 0; i < tail; i += 16) {
+      _mm512_storeu_ps(y + i, Op::Packet(_mm512_loadu_ps(a + i), vb));
+    }
+    if (mask) {
+      _mm512_mask_storeu_ps(
+          y + tail,
+          mask,
+          Op::Packet(_mm512_mask_loadu_ps(one, mask, a + tail), vb));
+    }
+  } else {
+    for (int i = 0; i < tail; i += 16) {
+      _mm512_storeu_ps(
+          y + i, Op::Packet(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    if (mask) {
+      _mm512_mask_storeu_ps(
+          y + tail,
+          mask,
+          Op::Packet(
+              _mm512_mask_loadu_ps(one, mask, a + tail),
+              _mm512_mask_loadu_ps(one, mask, b + tail)));
+    }
+  }
+}
+
+#define VECTORIZED_BROADCAST_OP(name, intrinsic)      \
+  struct name##Op {                                   \
+    static inline __m512 Packet(__m512 a, __m512 b) { \
+      return intrinsic(a, b);                         \
+    }                                                 \
+  };
+VECTORIZED_BROADCAST_OP(Add, _mm512_add_ps)
+VECTORIZED_BROADCAST_OP(Sub, _mm512_sub_ps)
+VECTORIZED_BROADCAST_OP(Mul, _mm512_mul_ps)
+VECTORIZED_BROADCAST_OP(Div, _mm512_div_ps)
+#undef VECTORIZED_BROADCAST_OP
+
+} // namespace
+
+#define VECTORIZED_BROADCAST_FUNCTION(name)                         \
+  void VectorizedBroadcast##name##__avx512(                         \
+      const int N,                                                  \
+      const float* a,                                               \
+      const bool a_scalar,                                          \
+      const float* b,                                               \
+      const bool b_scalar,                                          \
+      float* y) {                                                   \
+    VectorizedBroadcast<name##Op>(N, a, a_scalar, b, b_scalar, y); \
+  }
+VECTORIZED_BROADCAST_FUNCTION(Add)
+VECTORIZED_BROADCAST_FUNCTION(Sub)
+VECTORIZED_BROADCAST_FUNCTION(Mul)
+VECTORIZED_BROADCAST_FUNCTION(Div)
+#undef VECTORIZED_BROADCAST_FUNCTION
+
+namespace {
+
+inline __mmask16 RangeMask(const int j, const int D) {
+  return j + 16 <= D ? static_cast<__mmask16>(0xffff) : TailMask(D);
+}
+
+// Row maximum and sum of exp(x - max) in one pass. Every lane keeps its own
+// maximum and sum, rescaled by exp(old max - new max) once per 4 vectors.
+inline void OnlineMaxSum(const int D, const float* x, float* max, float* sum) {
+  const __m512 neg_inf =
+      _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+  // Not -inf, for exp(vmax - new max) to be 0 rather than NaN
+  __m512 vmax = _mm512_set1_ps(std::numeric_limits<float>::lowest());
+  __m512 vsum = _mm512_setzero_ps();
+  int j = 0;
+  for (; j + 64 <= D; j += 64) {
+    const __m512 x0 = _mm512_loadu_ps(x + j);
+    const __m512 x1 = _mm512_loadu_ps(x + j + 16);
+    const __m512 x2 = _mm512_loadu_ps(x + j + 32);
+    const __m512 x3 = _mm512_loadu_ps(x + j + 48);
+    const __m512 new_max = _mm512_max_ps(
+        vmax,
+        _mm512_max_ps(_mm512_max_ps(x0, x1), _mm512_max_ps(x2, x3)));
+    vsum = _mm512_mul_ps(vsum, Exp(_mm512_sub_ps(vmax, new_max)));
+    vsum = _mm512_add_ps(
+        vsum,
+        _mm512_add_ps(
+            _mm512_add_ps(
+                Exp(_mm512_sub_ps(x0, new_max)),
+                Exp(_mm512_sub_ps(x1, new_max))),
+            _mm512_add_ps(
+                Exp(_mm512_sub_ps(x2, new_max)),
+                Exp(_mm512_sub_ps(x3, new_max)))));
+    vmax = new_max;
+  }
+  for (; j < D; j += 16) {
+    const __m512 xj = _mm512_mask_loadu_ps(neg_inf, RangeMask(j, D), x + j);
+    const __m512 new_max = _mm512_max_ps(vmax, xj);
+    vsum = _mm512_fmadd_ps(
+        vsum,
+        Exp(_mm512_sub_ps(vmax, new_max)),
+        Exp(_mm512_sub_ps(xj, new_max)));
+    vmax = new_max;
+  }
+  *max = _mm512_reduce_max_ps(vmax);
+  *sum = _mm512_reduce_add_ps(_mm512_mul_ps(
+      vsum, Exp(_mm512_sub_ps(vmax, _mm512_set1_ps(*max)))));
+}
+
+} // namespace
+
+void VectorizedSoftmax__avx512(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    const bool logarithmic,
+    const bool online,
+    float* rowmax,
+    float* rowsum) {
+  const __m512 neg_inf =
+      _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+  for (int i = 0; i < N; ++i) {
+    const float* xrow = x + static_cast<size_t>(i) * D;
+    float* yrow = y + static_cast<size_t>(i) * D;
+    float max;
+    float sum;
+    if (online) {
+      OnlineMaxSum(D, xrow, &max, &sum);
+    } else {
+      __m512 vmax0 = neg_inf;
+      __m512 vmax1 = neg_inf;
+      int j = 0;
+      for (; j + 32 <= D; j += 32) {
+        vmax0 = _mm512_max_ps(vmax0, _mm512_loadu_ps(xrow + j));
+        vmax1 = _mm512_max_ps(vmax1, _mm512_loadu_ps(xrow + j + 16));
+      }
+      for (; j < D; j += 16) {
+        vmax0 = _mm512_max_ps(
+            vmax0, _mm512_mask_loadu_ps(neg_inf, RangeMask(j, D), xrow + j));
+      }
+      max = _mm512_reduce_max_ps(_mm512_max_ps(vmax0, vmax1));
+      // The exponentials are kept in y to be normalized below
+      const __m512 vmax = _mm512_set1_ps(max);
+      __m512 vsum = _mm512_setzero_ps();
+      for (j = 0; j < D; j += 16) {
+        const __mmask16 mask = RangeMask(j, D);
+        const __m512 e = Exp(
+            _mm512_sub_ps(_mm512_mask_loadu_ps(neg_inf, mask, xrow + j), vmax));
+        if (!logarithmic) {
+          _mm512_mask_storeu_ps(yrow + j, mask, e);
+        }
+        vsum = _mm512_add_ps(vsum, e);
+      }
+      sum = _mm512_reduce_add_ps(vsum);
+    }
+    if (logarithmic) {
+      const __m512 shift =
+          _mm512_set1_ps(max + std::log(std::max(sum, 1e-20f)));
+      for (int j = 0; j < D; j += 16) {
+        const __mmask16 mask = RangeMask(j, D);
+        _mm512_mask_storeu_ps(
+            yrow + j,
+            mask,
+            _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, xrow + j), shift));
+      }
+    } else if (online) {
+      const __m512 vmax = _mm512_set1_ps(max);
+      const __m512 inv = _mm512_set1_ps(1.0f / sum);
+      for (int j = 0; j < D; j += 16) {
+        const __mmask16 mask = RangeMask(j, D);
+        const __m512 e = Exp(
+            _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, xrow + j), vmax));
+        _mm512_mask_storeu_ps(yrow + j, mask, _mm512_mul_ps(e, inv));
+      }
+    } else {
+      const __m512 inv = _mm512_set1_ps(1.0f / sum);
+      for (int j = 0; j < D; j += 16) {
+        const __mmask16 mask = RangeMask(j, D);
+        _mm512_mask_storeu_ps(
+            yrow + j,
+            mask,
+            _mm512_mul_ps(_mm512_maskz_loadu_ps(mask, yrow + j), inv));
+      }
+    }
+    if (rowmax) {
+      rowmax[i] = max;
+    }
+    if (rowsum) {
+      rowsum[i] = sum;
+    }
+  }
+}
+
+void VectorizedSoftmaxGradient__avx512(
+    const int N,
+    const int D,
+    const float* y,
+    const float* dy,
+    float* dx) {
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    __m512 vdot = _mm512_setzero_ps();
+    for (int j = 0; j < D; j += 16) {
+      const __mmask16 mask = RangeMask(j, D);
+      vdot = _mm512_fmadd_ps(
+          _mm512_maskz_loadu_ps(mask, y + offset + j),
+          _mm512_maskz_loadu_ps(mask, dy + offset + j),
+          vdot);
+    }
+    const __m512 dot = _mm512_set1_ps(_mm512_reduce_add_ps(vdot));
+    for (int j = 0; j < D; j += 16) {
+      const __mmask16 mask = RangeMask(j, D);
+      _mm512_mask_storeu_ps(
+          dx + offset + j,
+          mask,
+          _mm512_mul_ps(
+              _mm512_maskz_loadu_ps(mask, y + offset + j),
+              _mm512_sub_ps(
+                  _mm512_maskz_loadu_ps(mask, dy + offset + j), dot)));
+    }
+  }
+}
+
+void VectorizedBoxCox__avx512(
+    const int N,
+    const int D,
+    const float* x,
+    const float* lambda1,
+    const float* lambda2,
+    const float eps,
+    float* y) {
+  const __m512 veps = _mm512_set1_ps(eps);
+  const __m512 one = _mm512_set1_ps(1.0f);
+  for (int i = 0; i < N; ++i) {
+    const size_t offset = static_cast<size_t>(i) * D;
+    for (int j = 0; j < D; j += 16) {
+      // The masked out lanes compute log(eps) from zeros and are not stored
+      const __mmask16 mask = RangeMask(j, D);
+      const __m512 l1 = _mm512_maskz_loadu_ps(mask, lambda1 + j);
+      const __m512 t = _mm512_max_ps(
+          _mm512_add_ps(
+              _mm512_maskz_loadu_ps(mask, x + offset + j),
+              _mm512_maskz_loadu_ps(mask, lambda2 + j)),
+          veps);
+      const __m512 log_t = Log(t);
+      const __m512 pow_t =
+          _mm512_div_ps(_mm512_sub_ps(Exp(_mm512_mul_ps(l1, log_t)), one), l1);
+      const __mmask16 zero_l1 =
+          _mm512_cmp_ps_mask(l1, _mm512_setzero_ps(), _CMP_EQ_OQ);
+      _mm512_mask_storeu_ps(
+          y + offset + j, mask, _mm512_mask_blend_ps(zero_l1, pow_t, log_t));
+    }
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,81 @@
+#include "caffe2/perfkernels/packed_gemm.h"
+
+#include <algorithm>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+TIndex PackedMatrixSize(const TIndex N, const TIndex K) {
+  const TIndex num_panels = (N + kPackedPanelWidth - 1) / kPackedPanelWidth;
+  return num_panels * K * kPackedPanelWidth;
+}
+
+void PackMatrix(
+    const bool transposed,
+    const TIndex N,
+    const TIndex K,
+    const float* W,
+    float* packed) {
+  const TIndex num_panels = (N + kPackedPanelWidth - 1) / kPackedPanelWidth;
+  for (TIndex p = 0; p < num_panels; ++p) {
+    float* panel = packed + p * K * kPackedPanelWidth;
+    for (TIndex k = 0; k < K; ++k) {
+      for (int j = 0; j < kPackedPanelWidth; ++j) {
+        const TIndex n = p * kPackedPanelWidth + j;
+        panel[k * kPackedPanelWidth + j] =
+            n < N ? (transposed ? W[n * K + k] : W[k * N + n]) : 0;
+      }
+    }
+  }
+}
+
+// Base implementation computes one row of one panel at a time
+void PackedGemm__base(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  const TIndex num_panels = (N + kPackedPanelWidth - 1) / kPackedPanelWidth;
+  for (TIndex p = 0; p < num_panels; ++p) {
+    const float* panel = packed + p * K * kPackedPanelWidth;
+    const TIndex n0 = p * kPackedPanelWidth;
+    const int n_valid =
+        static_cast<int>(std::min<TIndex>(kPackedPanelWidth, N - n0));
+    for (TIndex m = 0; m < M; ++m) {
+      const float* x = X + m * K;
+      float acc[kPackedPanelWidth];
+      for (int j = 0; j < kPackedPanelWidth; ++j) {
+        acc[j] = bias && j < n_valid ? bias[n0 + j] : 0;
+      }
+      for (TIndex k = 0; k < K; ++k) {
+        const float xk = x[k];
+        const float* w = panel + k * kPackedPanelWidth;
+        for (int j = 0; j < kPackedPanelWidth; ++j) {
+          acc[j] += xk * w[j];
+        }
+      }
+      std::copy(acc, acc + n_valid, Y + m * N + n0);
+    }
+  }
+}
+
+void PackedGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  AVX512_DO(PackedGemm, M, N, K, X, packed, bias, Y);
+  AVX2_FMA_DO(PackedGemm, M, N, K, X, packed, bias, Y);
+  BASE_DO(PackedGemm, M, N, K, X, packed, bias, Y);
+}
+
+} // namespace caffe2
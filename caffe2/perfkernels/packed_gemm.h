@@ -0,0 +1,50 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+// Number of output columns of a panel of a packed matrix.
+constexpr int kPackedPanelWidth = 16;
+
+/**
+ * Number of floats of an N x K weight matrix packed by PackMatrix.
+ */
+TIndex PackedMatrixSize(const TIndex N, const TIndex K);
+
+/**
+ * Packs the weight matrix of a fully connected layer for PackedGemm. W is
+ * N x K (the FC layout) if transposed, and K x N (the FCTransposed layout)
+ * otherwise.
+ *
+ * The packed matrix is made of ceil(N / kPackedPanelWidth) panels of K x
+ * kPackedPanelWidth floats: row k of panel p holds W[n][k] for n in
+ * [p * kPackedPanelWidth, (p + 1) * kPackedPanelWidth), zero padded past N.
+ * PackedGemm then reads the weights of the outputs it computes as one
+ * contiguous stream.
+ */
+void PackMatrix(
+    const bool transposed,
+    const TIndex N,
+    const TIndex K,
+    const float* W,
+    float* packed);
+
+/**
+ * Y = X W^T + bias, for the M x K row major matrix X and the N x K matrix W
+ * packed by PackMatrix. bias has N elements, or is nullptr for no bias, and
+ * Y is M x N.
+ *
+ * A few panels are multiplied at a time with all the rows of X, in blocks of
+ * K, so that they stay in cache while they are reused.
+ */
+void PackedGemm(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y);
+
+} // namespace caffe2
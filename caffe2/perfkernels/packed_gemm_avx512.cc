@@ -0,0 +1,181 @@
+#include <algorithm>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Panels multiplied at a time, and size of the blocks of K
+constexpr TIndex kPanelsPerChunk = 8;
+constexpr TIndex kBlockK = 512;
+
+// Loads the first n, up to 16, floats of p
+inline __m512 LoadPartial(const float* p, const int n) {
+  if (n >= 16) {
+    return _mm512_loadu_ps(p);
+  }
+  return _mm512_maskz_loadu_ps((1U << n) - 1, p);
+}
+
+inline void StorePartial(float* p, const __m512 v, const int n) {
+  if (n >= 16) {
+    _mm512_storeu_ps(p, v);
+  } else {
+    _mm512_mask_storeu_ps(p, (1U << n) - 1, v);
+  }
+}
+
+// Computes columns [0, NP * 16) of MR rows of Y from NP panels, for one block
+// of k_size values of K. The first block starts from the bias, the others
+// from the values of Y. Only the first n_valid columns of the last panel are
+// read from the bias and Y, and written to Y.
+template <int MR, int NP>
+void Kernel(
+    const TIndex k_size,
+    const float* x,
+    const TIndex ldx,
+    const float* panels,
+    const TIndex panel_stride,
+    const float* bias,
+    const bool first,
+    const int n_valid,
+    float* y,
+    const TIndex ldy) {
+  __m512 acc[MR][NP];
+  for (int q = 0; q < NP; ++q) {
+    const int valid = q == NP - 1 ? n_valid : kPackedPanelWidth;
+    const int offset = q * kPackedPanelWidth;
+    for (int i = 0; i < MR; ++i) {
+      if (!first) {
+        acc[i][q] = LoadPartial(y + i * ldy + offset, valid);
+      } else if (bias) {
+        acc[i][q] = LoadPartial(bias + offset, valid);
+      } else {
+        acc[i][q] = _mm512_setzero_ps();
+      }
+    }
+  }
+  for (TIndex k = 0; k < k_size; ++k) {
+    __m512 w[NP];
+    for (int q = 0; q < NP; ++q) {
+      w[q] = _mm512_loadu_ps(
+          panels + q * panel_stride + k * kPackedPanelWidth);
+    }
+    for (int i = 0; i < MR; ++i) {
+      const __m512 a = _mm512_set1_ps(x[i * ldx + k]);
+      for (int q = 0; q < NP; ++q) {
+        acc[i][q] = _mm512_fmadd_ps(a, w[q], acc[i][q]);
+      }
+    }
+  }
+  for (int q = 0; q < NP; ++q) {
+    const int valid = q == NP - 1 ? n_valid : kPackedPanelWidth;
+    const int offset = q * kPackedPanelWidth;
+    for (int i = 0; i < MR; ++i) {
+      StorePartial(y + i * ldy + offset, acc[i][q], valid);
+    }
+  }
+}
+
+// Runs the kernel on panels [p, p_end), NP panels at a time
+template <int MR, int NP>
+void RunPanels(
+    TIndex p,
+    const TIndex p_end,
+    const TIndex N,
+    const TIndex K,
+    const TIndex k0,
+    const TIndex k_size,
+    const float* x,
+    const float* packed,
+    const float* bias,
+    float* y) {
+  const TIndex panel_stride = K * kPackedPanelWidth;
+  const auto run = [&](const TIndex panel, const int np) {
+    const TIndex n0 = panel * kPackedPanelWidth;
+    const int n_valid = static_cast<int>(std::min<TIndex>(
+        kPackedPanelWidth, N - (panel + np - 1) * kPackedPanelWidth));
+    const float* panels =
+        packed + panel * panel_stride + k0 * kPackedPanelWidth;
+    if (np == NP) {
+      Kernel<MR, NP>(
+          k_size,
+          x + k0,
+          K,
+          panels,
+          panel_stride,
+          bias ? bias + n0 : nullptr,
+          k0 == 0,
+          n_valid,
+          y + n0,
+          N);
+    } else {
+      Kernel<MR, 1>(
+          k_size,
+          x + k0,
+          K,
+          panels,
+          panel_stride,
+          bias ? bias + n0 : nullptr,
+          k0 == 0,
+          n_valid,
+          y + n0,
+          N);
+    }
+  };
+  for (; p + NP <= p_end; p += NP) {
+    run(p, NP);
+  }
+  for (; p < p_end; ++p) {
+    run(p, 1);
+  }
+}
+
+} // namespace
+
+void PackedGemm__avx512(
+    const TIndex M,
+    const TIndex N,
+    const TIndex K,
+    const float* X,
+    const float* packed,
+    const float* bias,
+    float* Y) {
+  const TIndex num_panels = (N + kPackedPanelWidth - 1) / kPackedPanelWidth;
+  for (TIndex p0 = 0; p0 < num_panels; p0 += kPanelsPerChunk) {
+    const TIndex p1 = std::min(num_panels, p0 + kPanelsPerChunk);
+    for (TIndex k0 = 0; k0 == 0 || k0 < K; k0 += kBlockK) {
+      const TIndex k_size = std::min(kBlockK, K - k0);
+      TIndex m = 0;
+      for (; m + 6 <= M; m += 6) {
+        RunPanels<6, 2>(
+            p0, p1, N, K, k0, k_size, X + m * K, packed, bias, Y + m * N);
+      }
+      const float* x = X + m * K;
+      float* y = Y + m * N;
+      switch (M - m) {
+        case 5:
+          RunPanels<5, 2>(p0, p1, N, K, k0, k_size, x, packed, bias, y);
+          break;
+        case 4:
+          RunPanels<4, 2>(p0, p1, N, K, k0, k_size, x, packed, bias, y);
+          break;
+        case 3:
+          RunPanels<3, 4>(p0, p1, N, K, k0, k_size, x, packed, bias, y);
+          break;
+        case 2:
+          RunPanels<2, 4>(p0, p1, N, K, k0, k_size, x, packed, bias, y);
+          break;
+        case 1:
+          RunPanels<1, 8>(p0, p1, N, K, k0, k_size, x, packed, bias, y);
+          break;
+      }
+    }
+  }
+}
+
+} // namespace caffe2
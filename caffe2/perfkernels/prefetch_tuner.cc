@@ -0,0 +1,159 @@
+#include "caffe2/perfkernels/prefetch_tuner.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/stats.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_embedding_lookup_prefetch_distance,
+    16,
+    "Number of rows ahead that the embedding lookup kernels prefetch. "
+    "0 disables software prefetching.");
+CAFFE2_DEFINE_bool(
+    caffe2_embedding_lookup_autotune_prefetch,
+    false,
+    "If set, the first embedding lookup calls for every kernel and block "
+    "size try a few prefetch distances and keep the fastest one.");
+CAFFE2_DEFINE_int(
+    caffe2_embedding_lookup_autotune_calls,
+    5,
+    "Number of calls timed for each candidate prefetch distance when "
+    "autotuning.");
+
+namespace caffe2 {
+
+namespace {
+
+struct PrefetchTuningStats {
+  CAFFE_STAT_CTOR(PrefetchTuningStats);
+  CAFFE_EXPORTED_STAT(distance);
+  CAFFE_EXPORTED_STAT(speedup_percent);
+};
+
+// Candidate distances, on top of the default one
+const int kPrefetchCandidates[] = {0, 4, 8, 16, 32, 64};
+
+} // namespace
+
+struct PrefetchDistance::Tuning {
+  using Key = std::pair<std::string, TIndex>;
+
+  // All tunings of the process, guarded by Mutex()
+  static std::map<Key, std::unique_ptr<Tuning>>& All() {
+    static std::map<Key, std::unique_ptr<Tuning>> tunings;
+    return tunings;
+  }
+
+  static std::mutex& Mutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  explicit Tuning(const std::string& n) : name(n) {
+    const int default_distance =
+        std::max(0, FLAGS_caffe2_embedding_lookup_prefetch_distance);
+    candidates.assign(
+        std::begin(kPrefetchCandidates), std::end(kPrefetchCandidates));
+    if (std::find(candidates.begin(), candidates.end(), default_distance) ==
+        candidates.end()) {
+      candidates.push_back(default_distance);
+    }
+    default_index =
+        std::find(candidates.begin(), candidates.end(), default_distance) -
+        candidates.begin();
+    best_ns_per_row.assign(
+        candidates.size(), std::numeric_limits<double>::infinity());
+  }
+
+  const std::string name;
+  std::vector<int> candidates;
+  size_t default_index;
+  // Fastest trial of every candidate, the minimum filters out preemptions
+  std::vector<double> best_ns_per_row;
+  int64_t started = 0;
+  int64_t finished = 0;
+  bool done = false;
+  int distance = 0;
+  std::unique_ptr<PrefetchTuningStats> stats;
+};
+
+PrefetchDistance::PrefetchDistance(
+    const char* kernel,
+    TIndex block_size,
+    TIndex rows)
+    : tuning_(nullptr),
+      distance_(std::max(0, FLAGS_caffe2_embedding_lookup_prefetch_distance)),
+      rows_(rows) {
+  if (!FLAGS_caffe2_embedding_lookup_autotune_prefetch || rows == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(Tuning::Mutex());
+  auto& tuning = Tuning::All()[Tuning::Key(kernel, block_size)];
+  if (!tuning) {
+    tuning.reset(
+        new Tuning(std::string(kernel) + "_" + caffe2::to_string(block_size)));
+  }
+  if (tuning->done) {
+    distance_ = tuning->distance;
+    return;
+  }
+  // Interleave the candidates so that they all see similar cache states
+  distance_ =
+      tuning->candidates[tuning->started++ % tuning->candidates.size()];
+  tuning_ = tuning.get();
+  start_ = std::chrono::steady_clock::now();
+}
+
+PrefetchDistance::~PrefetchDistance() {
+  if (!tuning_ || std::uncaught_exception()) {
+    return;
+  }
+  const double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_)
+                        .count();
+  std::lock_guard<std::mutex> guard(Tuning::Mutex());
+  if (tuning_->done) {
+    return;
+  }
+  const size_t index = std::find(
+                           tuning_->candidates.begin(),
+                           tuning_->candidates.end(),
+                           distance_) -
+      tuning_->candidates.begin();
+  tuning_->best_ns_per_row[index] =
+      std::min(tuning_->best_ns_per_row[index], ns / rows_);
+  const int64_t trials =
+      std::max(1, FLAGS_caffe2_embedding_lookup_autotune_calls) *
+      tuning_->candidates.size();
+  if (++tuning_->finished < trials) {
+    return;
+  }
+
+  const auto& times = tuning_->best_ns_per_row;
+  const size_t best =
+      std::min_element(times.begin(), times.end()) - times.begin();
+  tuning_->distance = tuning_->candidates[best];
+  tuning_->done = true;
+  const int speedup_percent = times[best] > 0
+      ? static_cast<int>(
+            100 * (times[tuning_->default_index] / times[best] - 1))
+      : 0;
+  VLOG(1) << "Prefetch distance of " << tuning_->name << ": "
+          << tuning_->distance << " (" << times[best] << " ns per row, "
+          << speedup_percent << "% faster than the default distance)";
+  tuning_->stats.reset(
+      new PrefetchTuningStats("embedding_lookup_prefetch/" + tuning_->name));
+  auto& stats = *tuning_->stats;
+  CAFFE_EVENT(stats, distance, tuning_->distance);
+  CAFFE_EVENT(stats, speedup_percent, speedup_percent);
+}
+
+} // namespace caffe2
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/flags.h"
+
+CAFFE2_DECLARE_int(caffe2_embedding_lookup_prefetch_distance);
+CAFFE2_DECLARE_bool(caffe2_embedding_lookup_autotune_prefetch);
+CAFFE2_DECLARE_int(caffe2_embedding_lookup_autotune_calls);
+
+namespace caffe2 {
+
+/**
+ * Picks the software prefetch distance, in rows ahead, for one call of an
+ * embedding lookup kernel. A distance of 0 disables prefetching, which is
+ * usually the fastest for tables that fit in the last level cache.
+ *
+ * By default the distance is --caffe2_embedding_lookup_prefetch_distance.
+ * With --caffe2_embedding_lookup_autotune_prefetch, the first calls for each
+ * kernel and block size cycle through a few candidate distances, each of them
+ * --caffe2_embedding_lookup_autotune_calls times; the fastest one in
+ * nanoseconds per looked up row is cached for the rest of the process and
+ * exported to the StatRegistry as
+ *   embedding_lookup_prefetch/<kernel>_<block_size>/distance
+ *   embedding_lookup_prefetch/<kernel>_<block_size>/speedup_percent
+ * where the speedup is relative to the default distance.
+ *
+ * Usage, around a single kernel call:
+ *   PrefetchDistance prefetch("EmbeddingLookup_int32_t_float_float_false",
+ *                             block_size, index_size);
+ *   Kernel(..., prefetch.distance(), out);
+ * While tuning, the destructor records the time since construction.
+ */
+class PrefetchDistance {
+ public:
+  PrefetchDistance(const char* kernel, TIndex block_size, TIndex rows);
+  ~PrefetchDistance();
+
+  int distance() const {
+    return distance_;
+  }
+
+ private:
+  struct Tuning;
+
+  Tuning* tuning_; // nullptr unless this call is a tuning trial
+  int distance_;
+  TIndex rows_;
+  std::chrono::steady_clock::time_point start_;
+
+  DISABLE_COPY_AND_ASSIGN(PrefetchDistance);
+};
+
+} // namespace caffe2
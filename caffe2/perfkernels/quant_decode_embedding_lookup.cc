@@ -0,0 +1,133 @@
+#include "caffe2/perfkernels/quant_decode_embedding_lookup.h"
+
+#include <cstring>
+
+#include "caffe2/core/types.h"
+#include "caffe2/perfkernels/common.h"
+#include "caffe2/utils/cpuid.h"
+
+namespace caffe2 {
+
+// Base implementation decodes one code at a time
+template <typename IndexType, typename CodeType>
+static void QuantDecodeEmbeddingLookupGenericSlow(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* codebook,
+    const TIndex codebook_size,
+    const CodeType* codes,
+    const IndexType* indices,
+    const int* lengths,
+    float* out) {
+  TIndex current = 0;
+  for (int m = 0; m < output_size; ++m) {
+    memset(out, 0, sizeof(float) * block_size);
+    for (int i = 0; i < lengths[m]; ++i) {
+      CAFFE_ENFORCE_LT(current, index_size);
+      TIndex idx = indices[current];
+      CAFFE_ENFORCE(
+          0 <= idx && idx < data_size,
+          "Index ",
+          current,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+#ifdef __GNUC__
+      if (current + 1 < index_size) {
+        __builtin_prefetch(codes + block_size * indices[current + 1], 0, 1);
+      }
+#endif // __GNUC__
+
+      const CodeType* row = codes + block_size * idx;
+      for (TIndex k = 0; k < block_size; ++k) {
+        DCHECK_LT(row[k], codebook_size);
+        out[k] += codebook[row[k]];
+      }
+
+      ++current;
+    }
+    out += block_size;
+  }
+  CAFFE_ENFORCE_EQ(
+      current,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+// Proxy back to generic implementation
+#define QUANT_DECODE_EMBEDDING_SPECIALIZATION(IndexType, CodeType)         \
+  void QuantDecodeEmbeddingLookup_##IndexType##_##CodeType##__base(        \
+      const TIndex block_size,                                             \
+      const TIndex output_size,                                            \
+      const TIndex index_size,                                             \
+      const TIndex data_size,                                              \
+      const float* codebook,                                               \
+      const TIndex codebook_size,                                          \
+      const CodeType* codes,                                               \
+      const IndexType* indices,                                            \
+      const int* lengths,                                                  \
+      float* out) {                                                        \
+    QuantDecodeEmbeddingLookupGenericSlow<IndexType, CodeType>(            \
+        block_size,                                                        \
+        output_size,                                                       \
+        index_size,                                                        \
+        data_size,                                                         \
+        codebook,                                                          \
+        codebook_size,                                                     \
+        codes,                                                             \
+        indices,                                                           \
+        lengths,                                                           \
+        out);                                                              \
+  }                                                                        \
+  template <>                                                              \
+  void QuantDecodeEmbeddingLookup<IndexType, CodeType>(                    \
+      const TIndex block_size,                                             \
+      const TIndex output_size,                                            \
+      const TIndex index_size,                                             \
+      const TIndex data_size,                                              \
+      const float* codebook,                                               \
+      const TIndex codebook_size,                                          \
+      const CodeType* codes,                                               \
+      const IndexType* indices,                                            \
+      const int* lengths,                                                  \
+      float* out) {                                                        \
+    AVX2_DO(                                                               \
+        QuantDecodeEmbeddingLookup_##IndexType##_##CodeType,               \
+        block_size,                                                        \
+        output_size,                                                       \
+        index_size,                                                        \
+        data_size,                                                         \
+        codebook,                                                          \
+        codebook_size,                                                     \
+        codes,                                                             \
+        indices,                                                           \
+        lengths,                                                           \
+        out);                                                              \
+    BASE_DO(                                                               \
+        QuantDecodeEmbeddingLookup_##IndexType##_##CodeType,               \
+        block_size,                                                        \
+        output_size,                                                       \
+        index_size,                                                        \
+        data_size,                                                         \
+        codebook,                                                          \
+        codebook_size,                                                     \
+        codes,                                                             \
+        indices,                                                           \
+        lengths,                                                           \
+        out);                                                              \
+  }
+
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int32_t, uint8_t);
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int64_t, uint8_t);
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int32_t, uint16_t);
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int64_t, uint16_t);
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int32_t, int32_t);
+QUANT_DECODE_EMBEDDING_SPECIALIZATION(int64_t, int32_t);
+
+#undef QUANT_DECODE_EMBEDDING_SPECIALIZATION
+
+} // namespace caffe2
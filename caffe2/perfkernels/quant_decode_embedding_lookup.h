@@ -0,0 +1,45 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+
+namespace caffe2 {
+
+/**
+ * Embedding lookup with sum reduction over rows of codes decoded with a
+ * codebook, see QuantDecode. Equivalent to QuantDecode followed by
+ * SparseLengthsSum, without materializing the decoded rows.
+ *
+ * `codebook` of size codebook_size
+ * `codes` of size data_size * block_size, every code < codebook_size
+ * `indices` of size index_size
+ * `lengths` of size output_size
+ * `out` of size output_size * block_size
+ * sum(lengths[i]) == index_size
+ *
+ * Behavior is roughly equivalent to pseudocode:
+ *
+ * pos = 0
+ * for (i = 0..output_size-1)
+ *   for (k = 0..block_size-1)
+ *     out[i*block_size + k] = 0
+ *   for (j = 0..lengths[i]-1)
+ *     for (k = 0..block_size-1)
+ *       out[i*block_size + k] +=
+ *           codebook[codes[indices[pos]*block_size + k]]
+ *     pos += 1
+ *
+ */
+template <typename IndexType, typename CodeType>
+void QuantDecodeEmbeddingLookup(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* codebook,
+    const TIndex codebook_size,
+    const CodeType* codes,
+    const IndexType* indices,
+    const int* lengths,
+    float* out);
+
+} // namespace caffe2
@@ -0,0 +1,148 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Loads 8 codes widened to the 32 bit lanes the gathers index with.
+template <typename CodeType>
+struct LoadCodes;
+
+template <>
+struct LoadCodes<uint8_t> {
+  static inline __m256i Load(const uint8_t* p) {
+    return _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+  }
+};
+
+template <>
+struct LoadCodes<uint16_t> {
+  static inline __m256i Load(const uint16_t* p) {
+    return _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+  }
+};
+
+template <>
+struct LoadCodes<int32_t> {
+  static inline __m256i Load(const int32_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+};
+
+template <typename IndexType, typename CodeType>
+void QuantDecodeEmbeddingLookupKernel(
+    const TIndex block_size,
+    const TIndex output_size,
+    const TIndex index_size,
+    const TIndex data_size,
+    const float* codebook,
+    const TIndex codebook_size,
+    const CodeType* codes,
+    const IndexType* indices,
+    const int* lengths,
+    float* out) {
+  const IndexType prefdist_T0 = 16;
+  const TIndex row_bytes = block_size * sizeof(CodeType);
+
+  IndexType dataInd = 0;
+  for (IndexType rangeIndex = 0; rangeIndex < output_size; ++rangeIndex) {
+    float* op = &out[rangeIndex * block_size];
+    memset(op, 0, sizeof(float) * block_size);
+    for (IndexType start = dataInd; dataInd < start + lengths[rangeIndex];
+         ++dataInd) {
+      const IndexType idx = indices[dataInd];
+      CAFFE_ENFORCE(
+          idx >= 0 && idx < data_size,
+          "Index ",
+          dataInd,
+          " is out of bounds: ",
+          idx,
+          ", range 0 to ",
+          data_size);
+      const CodeType* ip = &codes[idx * block_size];
+      const IndexType next_T0 = (dataInd < index_size - prefdist_T0)
+          ? (dataInd + prefdist_T0)
+          : dataInd;
+      const IndexType idx_pref_T0 = indices[next_T0];
+      CAFFE_ENFORCE(idx_pref_T0 >= 0 && idx_pref_T0 < data_size);
+      const char* ip_next_T0 =
+          reinterpret_cast<const char*>(&codes[idx_pref_T0 * block_size]);
+      for (TIndex offset = 0; offset < row_bytes; offset += 64) {
+        _mm_prefetch(ip_next_T0 + offset, _MM_HINT_T0);
+      }
+
+      // The centroids are gathered 8 at a time and added to the output row
+      // in place, the decoded row never goes through memory.
+      TIndex j = 0;
+      for (; j + 16 <= block_size; j += 16) {
+        const __m256 c0 = _mm256_i32gather_ps(
+            codebook, LoadCodes<CodeType>::Load(ip + j), sizeof(float));
+        const __m256 c1 = _mm256_i32gather_ps(
+            codebook, LoadCodes<CodeType>::Load(ip + j + 8), sizeof(float));
+        _mm256_storeu_ps(op + j, _mm256_add_ps(_mm256_loadu_ps(op + j), c0));
+        _mm256_storeu_ps(
+            op + j + 8, _mm256_add_ps(_mm256_loadu_ps(op + j + 8), c1));
+      }
+      for (; j + 8 <= block_size; j += 8) {
+        const __m256 c = _mm256_i32gather_ps(
+            codebook, LoadCodes<CodeType>::Load(ip + j), sizeof(float));
+        _mm256_storeu_ps(op + j, _mm256_add_ps(_mm256_loadu_ps(op + j), c));
+      }
+      for (; j < block_size; ++j) {
+        DCHECK_LT(ip[j], codebook_size);
+        op[j] += codebook[ip[j]];
+      }
+    }
+  }
+  CAFFE_ENFORCE_EQ(
+      dataInd,
+      index_size,
+      "Your input seems to be incorrect: the sum of lengths values should be "
+      "the size of the indices tensor, but it appears not.");
+}
+
+} // namespace
+
+#define QUANT_DECODE_EMBEDDING_AVX2(IndexType, CodeType)                   \
+  void QuantDecodeEmbeddingLookup_##IndexType##_##CodeType##__avx2(        \
+      const TIndex block_size,                                             \
+      const TIndex output_size,                                            \
+      const TIndex index_size,                                             \
+      const TIndex data_size,                                              \
+      const float* codebook,                                               \
+      const TIndex codebook_size,                                          \
+      const CodeType* codes,                                               \
+      const IndexType* indices,                                            \
+      const int* lengths,                                                  \
+      float* out) {                                                        \
+    QuantDecodeEmbeddingLookupKernel<IndexType, CodeType>(                 \
+        block_size,                                                        \
+        output_size,                                                       \
+        index_size,                                                        \
+        data_size,                                                         \
+        codebook,                                                          \
+        codebook_size,                                                     \
+        codes,                                                             \
+        indices,                                                           \
+        lengths,                                                           \
+        out);                                                              \
+  }
+
+QUANT_DECODE_EMBEDDING_AVX2(int32_t, uint8_t);
+QUANT_DECODE_EMBEDDING_AVX2(int64_t, uint8_t);
+QUANT_DECODE_EMBEDDING_AVX2(int32_t, uint16_t);
+QUANT_DECODE_EMBEDDING_AVX2(int64_t, uint16_t);
+QUANT_DECODE_EMBEDDING_AVX2(int32_t, int32_t);
+QUANT_DECODE_EMBEDDING_AVX2(int64_t, int32_t);
+
+#undef QUANT_DECODE_EMBEDDING_AVX2
+
+} // namespace caffe2
@@ -0,0 +1,51 @@
+#pragma once
+
+// Stochastic rounding of float to float16, shared by the kernels that keep
+// optimizer state in float16. The helpers are static, since this header is
+// compiled both with the default flags and with the AVX flags, and the linker
+// must not pick the latter for the former.
+
+#include <cstdint>
+#include <cstring>
+
+#include "caffe2/core/types.h"
+
+namespace caffe2 {
+
+// xorshift32, which is enough to dither the dropped mantissa bits
+static inline uint32_t NextRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+// Adds random bits to the 13 low mantissa bits of x that float16 drops, then
+// rounds towards zero. Infinities and NaNs are left alone.
+static inline float16 StochasticRoundToFloat16(float x, uint32_t noise) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t u = bits & 0x7fffffff;
+  float16 ret;
+  if (u >= 0x7f800000) {
+    ret.x = sign | (u > 0x7f800000 ? 0x7e00 : 0x7c00);
+    return ret;
+  }
+  u += noise & 0x1fff;
+  const uint32_t exponent = u >> 23;
+  if (u >= 0x47800000) {
+    // The largest finite float16, rounding towards zero never overflows
+    ret.x = sign | 0x7bff;
+  } else if (exponent > 0x70) {
+    ret.x = sign | ((exponent - 0x70) << 10) | ((u >> 13) & 0x3ff);
+  } else if (exponent >= 0x66) {
+    ret.x = sign | (((u & 0x7fffff) | 0x800000) >> (0x7e - exponent));
+  } else {
+    ret.x = sign;
+  }
+  return ret;
+}
+
+} // namespace caffe2
@@ -0,0 +1,53 @@
+#pragma once
+
+// AVX2 versions of the helpers of stochastic_rounding.h, only included by the
+// kernels compiled with the AVX2 and F16C flags.
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+namespace caffe2 {
+
+// Seeds the xorshift32 generators of the 8 lanes. Every lane has its own
+// generator, or-ing 1 keeps them out of the all zero state.
+static inline __m256i InitRandom(const uint32_t seed) {
+  const uint32_t kGolden = 0x9e3779b9;
+  return _mm256_or_si256(
+      _mm256_setr_epi32(
+          seed + kGolden,
+          seed + 2 * kGolden,
+          seed + 3 * kGolden,
+          seed + 4 * kGolden,
+          seed + 5 * kGolden,
+          seed + 6 * kGolden,
+          seed + 7 * kGolden,
+          seed + 8 * kGolden),
+      _mm256_set1_epi32(1));
+}
+
+// Advances the xorshift32 generator of every lane.
+static inline __m256i NextRandom(__m256i* state) {
+  __m256i x = *state;
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+  x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+  x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+  return *state = x;
+}
+
+// Adds random bits to the 13 low mantissa bits that float16 drops, then
+// rounds towards zero. Infinities and NaNs are left alone.
+static inline __m128i StochasticRoundToFloat16(
+    const __m256 x,
+    __m256i* state) {
+  const __m256i bits = _mm256_castps_si256(x);
+  const __m256i finite = _mm256_cmpgt_epi32(
+      _mm256_set1_epi32(0x7f800000),
+      _mm256_and_si256(bits, _mm256_set1_epi32(0x7fffffff)));
+  const __m256i noise = _mm256_and_si256(
+      _mm256_and_si256(NextRandom(state), _mm256_set1_epi32(0x1fff)), finite);
+  return _mm256_cvtps_ph(
+      _mm256_castsi256_ps(_mm256_add_epi32(bits, noise)), _MM_FROUND_TO_ZERO);
+}
+
+} // namespace caffe2
@@ -8,9 +8,11 @@ from collections import OrderedDict
 from future.utils import viewitems, viewkeys, viewvalues
 import logging
 import copy
+import threading
 
 from caffe2.python import \
     model_helper, dyndep, scope, workspace, core, memonger, utils
+from caffe2.python import optimizer as optimizer_lib
 from caffe2.proto import caffe2_pb2
 
 import numpy as np
@@ -55,6 +57,11 @@ def Parallelize(
     num_threads_per_device=4,
     shared_model=False,
     combine_spatial_bn=False,
+    nccl_bucket_size_mb=0,
+    gloo_bucket_size_mb=0,
+    hierarchical_allreduce=False,
+    gloo_compression=None,
+    dynamic_loss_scale=None,
 ):
     '''
     Function to create a model that can run on many GPUs or CPUs.
@@ -105,6 +112,44 @@ def Parallelize(
                         all devices within the node. If False, batch
                         normalization will be done separately for each device.
                         This option is currently only supported on the CPU.
+      nccl_bucket_size_mb:
+                        With use_nccl on a single host, reduce the dense
+                        gradients with one NCCLBucketedAllreduce per group of
+                        gradients of about this many MB, in the order they
+                        are computed by the backward pass, instead of one
+                        NCCLAllreduce per gradient. 0 disables the buckets.
+      gloo_bucket_size_mb:
+                        With the GLOO engine on several hosts, reduce the
+                        gradients with one Allreduce per group of gradients
+                        of about this many MB, fused in one buffer. The
+                        groups follow the backward pass, so every Allreduce
+                        runs as soon as its gradients are computed while the
+                        backward pass goes on. 0 disables the buckets.
+      hierarchical_allreduce:
+                        With the GLOO engine on several hosts with several
+                        GPUs each, reduce-scatter every dense gradient
+                        between the local GPUs with NCCL, allreduce the shard
+                        of every GPU between the hosts, one Gloo Allreduce
+                        per GPU, and all-gather the shards between the local
+                        GPUs. Every host then sends 1 / len(devices) of the
+                        gradient from each GPU instead of all of it from one.
+                        Gradients of unknown size, or whose size is not a
+                        multiple of len(devices), are reduced as usual.
+      gloo_compression:
+                        With the GLOO engine on several CPU hosts, "fp16" or
+                        "int8" to send the gradients compressed, keeping the
+                        error of the compression of every gradient for the
+                        next iteration. None sends them in full precision.
+      dynamic_loss_scale:
+                        Initial loss scale of dynamic loss scaling, for mixed
+                        precision training with float16 gradients, such as
+                        2 ** 16. The gradient of the losses is multiplied by
+                        the loss scale, the reduced gradients are checked by
+                        an AllFinite and the loss scale is updated after the
+                        parameter updates, which have to unscale the
+                        gradients and skip the iterations with non finite
+                        gradients, as optimizer.build_mixed_precision does.
+                        None does not scale the losses.
     '''
     assert scope.CurrentDeviceScope() is None \
         or scope.CurrentDeviceScope().device_type == caffe2_pb2.CPU, \
@@ -114,6 +159,11 @@ def Parallelize(
     if devices is None:
         devices = list(range(0, workspace.NumCudaDevices())),
 
+    assert not (hierarchical_allreduce and gloo_bucket_size_mb > 0), \
+        "hierarchical_allreduce and gloo_bucket_size_mb cannot be combined"
+    assert gloo_compression is None or cpu_device, \
+        "gloo_compression is only supported with cpu_device"
+
     if not cpu_device:
         for gpu in devices:
             if gpu >= workspace.NumCudaDevices():
@@ -222,8 +272,14 @@ def Parallelize(
         _InferBlobDevice(model_helper_obj)
         return
 
+    loss_scale_blob = None
+    if dynamic_loss_scale is not None:
+        loss_scale_blob = optimizer_lib.add_dynamic_loss_scale(
+            model_helper_obj.param_init_net, dynamic_loss_scale)
+
     log.info("Adding gradient operators")
-    _AddGradientOperators(devices, model_helper_obj, losses_by_gpu)
+    _AddGradientOperators(
+        devices, model_helper_obj, losses_by_gpu, loss_scale_blob)
 
     if combine_spatial_bn:
         assert(cpu_device), \
@@ -269,10 +325,25 @@ def Parallelize(
             rendezvous,
             use_nccl,
             max_concurrent_distributed_ops,
+            nccl_bucket_size_mb,
+            gloo_bucket_size_mb,
+            hierarchical_allreduce,
+            gloo_compression,
         )
     else:
         log.info("NOTE: Param builder function did not create any parameters.")
 
+    if loss_scale_blob is not None:
+        # The reduced gradients are the same on every device
+        master_device = devices[0]
+        with core.DeviceScope(
+            core.DeviceOption(model_helper_obj._device_type, master_device)
+        ):
+            optimizer_lib.add_gradients_check(
+                model_helper_obj.net,
+                [model_helper_obj._device_grouped_blobs[g][master_device]
+                 for g in model_helper_obj._grad_names])
+
     log.info("Post-iteration operators for updating params")
     num_shards = 1 if rendezvous is None else rendezvous['num_shards']
 
@@ -293,6 +364,9 @@ def Parallelize(
         optimizer = optimizer_builder_fun(model_helper_obj)
         model_helper_obj._optimizer = optimizer
 
+    if loss_scale_blob is not None:
+        optimizer_lib.add_loss_scale_update(model_helper_obj.net)
+
     (sync_blobs, sync_names) = _ComputeBlobsToSync(model_helper_obj)
     sync_blobs_grouped = _GroupByDevice(
         model_helper_obj,
@@ -382,7 +456,8 @@ def Parallelize_BMUF(
     max_concurrent_distributed_ops=4,
     add_blobs_to_sync=None,
     num_threads_per_device=4,
-    cpu_device=False
+    cpu_device=False,
+    pipelined_sync=False
 ):
     '''
     Function to create model that run on many GPUs and creates a net for
@@ -392,6 +467,13 @@ def Parallelize_BMUF(
     in : Scalable Training of Deep Learning Machines by Incremental Block
     Training with Intra-block Parallel Optimization and Blockwise Model-Update
     Filtering (ICASSP 2016).
+
+    With pipelined_sync, RunNet does not wait for the average of the models
+    at the end of a block: it snapshots the parameters, and averages the
+    snapshots in the background while the devices run the next block. The
+    block update is applied at the end of the next block, on top of the local
+    steps taken meanwhile. Every device keeps its own copy of the global
+    model. Call FinishBMUFSync to apply the last pending update.
     '''
     assert scope.CurrentDeviceScope() is None \
         or scope.CurrentDeviceScope().device_type == caffe2_pb2.CPU, \
@@ -467,6 +549,10 @@ def Parallelize_BMUF(
     def _v_prev(param):
         return "{}_prev".format(param)
 
+    # With pipelined_sync, every device updates its own copy of the global
+    # model, otherwise the master device updates it and broadcasts it
+    bmuf_devices = devices if pipelined_sync else [master_device]
+
     # Keep track of params that were in the model before: they are not
     # data parallel, so we need to handle them separately
     non_datapar_params = copy.copy(model_helper_obj.params)
@@ -531,95 +617,127 @@ def Parallelize_BMUF(
             max_concurrent_distributed_ops
         )
         for param_name in viewkeys(model_helper_obj._device_grouped_blobs):
-            param = model_helper_obj._device_grouped_blobs[param_name][master_device]
-            with core.DeviceScope(master_dev_opt):
-                model_helper_obj._warmup_broadcast.Copy(param, _g(param))
+            for device in bmuf_devices:
+                param = model_helper_obj._device_grouped_blobs[param_name][device]
+                with core.DeviceScope(
+                        core.DeviceOption(model_helper_obj._device_type, device)):
+                    model_helper_obj._warmup_broadcast.Copy(param, _g(param))
+
+    if pipelined_sync:
+        # All the devices start from the same global model
+        _SyncAllParams(
+            devices,
+            model_helper_obj,
+            model_helper_obj.param_init_net,
+            model_helper_obj.param_init_net,
+            rendezvous,
+            model_parameter_names,
+            max_concurrent_distributed_ops
+        )
 
     # (Step-0) Initialize momentum parameters on master device.
     for param_name in viewkeys(model_helper_obj._device_grouped_blobs):
-        param = model_helper_obj._device_grouped_blobs[param_name][master_device]
-        with core.DeviceScope(master_dev_opt):
-            model_helper_obj._global_model_init_net.ConstantFill(
-                param, _v(param), value=0.0
-            )
-            model_helper_obj._global_model_init_net.Copy(param, _g(param))
-            if nesterov:
+        for device in bmuf_devices:
+            param = model_helper_obj._device_grouped_blobs[param_name][device]
+            with core.DeviceScope(
+                    core.DeviceOption(model_helper_obj._device_type, device)):
                 model_helper_obj._global_model_init_net.ConstantFill(
-                    param, _v_prev(param), value=0.0
+                    param, _v(param), value=0.0
                 )
+                model_helper_obj._global_model_init_net.Copy(param, _g(param))
+                if nesterov:
+                    model_helper_obj._global_model_init_net.ConstantFill(
+                        param, _v_prev(param), value=0.0
+                    )
 
     # (Step-1) Update models for num_local_iterations.
 
-    # (Step-2) Compute post-local-updates average of the params.
-    # Sum model params across GPUs and store resutls in param_avg blob.
-    _AllReduceBlobs(
-        model_parameter_names,
-        devices,
-        model_helper_obj,
-        model_helper_obj._global_model_param_updates_net,
-        rendezvous,
-        use_nccl,
-        max_concurrent_distributed_ops
-    )
+    if pipelined_sync:
+        _AddPipelinedBMUFSync(
+            model_helper_obj,
+            devices,
+            model_parameter_names,
+            rendezvous,
+            use_nccl,
+            max_concurrent_distributed_ops,
+            num_devices,
+            block_learning_rate,
+            block_momentum,
+            nesterov,
+            net_type,
+            num_workers,
+        )
+    else:
+        # (Step-2) Compute post-local-updates average of the params.
+        # Sum model params across GPUs and store resutls in param_avg blob.
+        _AllReduceBlobs(
+            model_parameter_names,
+            devices,
+            model_helper_obj,
+            model_helper_obj._global_model_param_updates_net,
+            rendezvous,
+            use_nccl,
+            max_concurrent_distributed_ops
+        )
 
-    # (Step-3) Update momentum params :
-    # param_v = block_momentum * param_v
-    # + block_learning_Rate * (param_avg - param)
-    # if nesterov momentum:
-    # param = param + param_v
-    # - block_momentum * (param_v - param_v_prev)
-    # param_v_prev = param_v
-    # else:
-    # param = param + param_v
-    for param_name in model_parameter_names:
-        param = model_helper_obj._device_grouped_blobs[param_name][master_device]
-        with core.DeviceScope(master_dev_opt):
-            # TODO(ataei) : Stop building the graph here to get model average ?
-            model_helper_obj._global_model_param_updates_net.Scale(
-                param, param, scale=1.0 / num_devices
-            )
-            model_helper_obj._global_model_param_updates_net.Sub(
-                [param, _g(param)], param
-            )
-            model_helper_obj._global_model_param_updates_net.Scale(
-                param, param, scale=block_learning_rate
-            )
-            model_helper_obj._global_model_param_updates_net.Scale(
-                _v(param), _v(param), scale=block_momentum
-            )
-            model_helper_obj._global_model_param_updates_net.Add(
-                [_v(param), param], _v(param)
-            )
-            model_helper_obj._global_model_param_updates_net.Add(
-                [_g(param), _v(param)], _g(param)
-            )
-            if nesterov:
+        # (Step-3) Update momentum params :
+        # param_v = block_momentum * param_v
+        # + block_learning_Rate * (param_avg - param)
+        # if nesterov momentum:
+        # param = param + param_v
+        # - block_momentum * (param_v - param_v_prev)
+        # param_v_prev = param_v
+        # else:
+        # param = param + param_v
+        for param_name in model_parameter_names:
+            param = model_helper_obj._device_grouped_blobs[param_name][master_device]
+            with core.DeviceScope(master_dev_opt):
+                # TODO(ataei) : Stop building the graph here to get model average ?
+                model_helper_obj._global_model_param_updates_net.Scale(
+                    param, param, scale=1.0 / num_devices
+                )
                 model_helper_obj._global_model_param_updates_net.Sub(
-                    [_v(param), _v_prev(param)], _v_prev(param)
+                    [param, _g(param)], param
                 )
                 model_helper_obj._global_model_param_updates_net.Scale(
-                    _v_prev(param), _v_prev(param), scale=block_momentum
+                    param, param, scale=block_learning_rate
                 )
-                model_helper_obj._global_model_param_updates_net.Sub(
-                    [_g(param), _v_prev(param)], _g(param)
+                model_helper_obj._global_model_param_updates_net.Scale(
+                    _v(param), _v(param), scale=block_momentum
+                )
+                model_helper_obj._global_model_param_updates_net.Add(
+                    [_v(param), param], _v(param)
                 )
+                model_helper_obj._global_model_param_updates_net.Add(
+                    [_g(param), _v(param)], _g(param)
+                )
+                if nesterov:
+                    model_helper_obj._global_model_param_updates_net.Sub(
+                        [_v(param), _v_prev(param)], _v_prev(param)
+                    )
+                    model_helper_obj._global_model_param_updates_net.Scale(
+                        _v_prev(param), _v_prev(param), scale=block_momentum
+                    )
+                    model_helper_obj._global_model_param_updates_net.Sub(
+                        [_g(param), _v_prev(param)], _g(param)
+                    )
+                    model_helper_obj._global_model_param_updates_net.Copy(
+                        _v(param), _v_prev(param)
+                    )
                 model_helper_obj._global_model_param_updates_net.Copy(
-                    _v(param), _v_prev(param)
+                    _g(param), param
                 )
-            model_helper_obj._global_model_param_updates_net.Copy(
-                _g(param), param
-            )
 
 
-    _SyncAllParams(
-        devices,
-        model_helper_obj,
-        model_helper_obj.param_init_net,
-        model_helper_obj._global_model_param_updates_net,
-        rendezvous,
-        model_parameter_names,
-        max_concurrent_distributed_ops
-    )
+        _SyncAllParams(
+            devices,
+            model_helper_obj,
+            model_helper_obj.param_init_net,
+            model_helper_obj._global_model_param_updates_net,
+            rendezvous,
+            model_parameter_names,
+            max_concurrent_distributed_ops
+        )
 
     # Add additional syncs
     if add_blobs_to_sync is not None:
@@ -653,6 +771,122 @@ def Parallelize_BMUF(
         model_helper_obj.net,
         (model_helper_obj._global_model_param_updates_net, 1)
     ]
+    if pipelined_sync:
+        model_helper_obj._bmuf_sync = _PipelinedBMUFSync(model_helper_obj)
+
+
+def _AddPipelinedBMUFSync(
+    model,
+    devices,
+    param_names,
+    rendezvous,
+    use_nccl,
+    max_concurrent_distributed_ops,
+    num_devices,
+    block_learning_rate,
+    block_momentum,
+    nesterov,
+    net_type,
+    num_workers,
+):
+    '''
+    Adds the nets of the pipelined BMUF sync: the snapshot net copies the
+    parameters of every device to a snapshot and to a buffer, the allreduce
+    net sums the buffers in the background, and the global model net applies
+    the block update with the sum once it is done.
+    '''
+    def new_net(name):
+        net = core.Net(name)
+        net.Proto().type = net_type
+        net.Proto().num_workers = num_workers
+        return net
+
+    model._global_model_snapshot_net = new_net('global_model_snapshot')
+    model._global_model_allreduce_net = new_net('global_model_allreduce')
+    updates_net = model._global_model_param_updates_net
+
+    sum_names = []
+    for param_name in param_names:
+        sum_name = "{}_bmuf_sum".format(param_name)
+        model._device_grouped_blobs[sum_name] = OrderedDict()
+        for device in devices:
+            param = model._device_grouped_blobs[param_name][device]
+            snapshot = "{}_snapshot".format(param)
+            with core.DeviceScope(core.DeviceOption(model._device_type, device)):
+                model._global_model_snapshot_net.Copy(param, snapshot)
+                sum_blob = model._global_model_snapshot_net.Copy(
+                    param, "{}_bmuf_sum".format(param))
+                inputs = [param, snapshot, sum_blob, "{}_g".format(param),
+                          "{}_v".format(param)]
+                outputs = [param, "{}_g".format(param), "{}_v".format(param)]
+                if nesterov:
+                    inputs.append("{}_prev".format(param))
+                    outputs.append("{}_prev".format(param))
+                updates_net.BlockMomentumUpdate(
+                    inputs,
+                    outputs,
+                    scale=1.0 / num_devices,
+                    block_learning_rate=block_learning_rate,
+                    block_momentum=block_momentum,
+                    nesterov=int(nesterov),
+                )
+            model._device_grouped_blobs[sum_name][device] = sum_blob
+        sum_names.append(sum_name)
+
+    _AllReduceBlobs(
+        sum_names,
+        devices,
+        model,
+        model._global_model_allreduce_net,
+        rendezvous,
+        use_nccl,
+        max_concurrent_distributed_ops
+    )
+    # The buffers are only grouped to build the allreduce
+    for sum_name in sum_names:
+        del model._device_grouped_blobs[sum_name]
+
+
+class _PipelinedBMUFSync(object):
+    '''
+    Runs the allreduce net of the pipelined BMUF sync in a thread, the
+    workspace releases the GIL while it runs.
+    '''
+    def __init__(self, model):
+        self._model = model
+        self._thread = None
+        self._error = None
+
+    def nets(self):
+        return [
+            self._model._global_model_snapshot_net,
+            self._model._global_model_allreduce_net,
+        ]
+
+    def _allreduce(self):
+        try:
+            workspace.RunNet(self._model._global_model_allreduce_net)
+        except Exception as e:
+            self._error = e
+
+    def finish(self):
+        if self._thread is None:
+            return
+        self._thread.join()
+        self._thread = None
+        if self._error is not None:
+            error = self._error
+            self._error = None
+            raise error
+        workspace.RunNet(self._model._global_model_param_updates_net)
+
+    def run(self, num_iterations):
+        workspace.RunNet(self._model.net, num_iterations)
+        self.finish()
+        workspace.RunNet(self._model._global_model_snapshot_net)
+        self._thread = threading.Thread(target=self._allreduce)
+        self._thread.daemon = True
+        self._thread.start()
 
 
 def RunInitNet(model):
@@ -663,6 +897,9 @@ def RunInitNet(model):
             workspace.CreateNet(net_iters[0])
         else:
             workspace.CreateNet(net_iters)
+    if getattr(model, '_bmuf_sync', None) is not None:
+        for net in model._bmuf_sync.nets():
+            workspace.CreateNet(net)
 
 
 def RunWarmup(model):
@@ -671,6 +908,9 @@ def RunWarmup(model):
 
 
 def RunNet(model, num_iterations):
+    if getattr(model, '_bmuf_sync', None) is not None:
+        model._bmuf_sync.run(num_iterations)
+        return
     for net_iter in model._data_parallel_model_nets:
         if isinstance(net_iter, tuple):
             workspace.RunNet(net_iter[0].Proto().name, net_iter[1])
@@ -678,6 +918,15 @@ def RunNet(model, num_iterations):
             workspace.RunNet(net_iter, num_iterations)
 
 
+def FinishBMUFSync(model):
+    '''
+    Waits for the pending sync of a BMUF model with pipelined_sync and
+    applies its block update, e.g. before evaluating or saving the model.
+    '''
+    if getattr(model, '_bmuf_sync', None) is not None:
+        model._bmuf_sync.finish()
+
+
 barrier_instance = 0
 
 
@@ -758,9 +1007,18 @@ def _ForEachDevice(devices, f, device_type, device_prefix, scoped=False,
                 f(device, *args, **kwargs)
 
 
-def _AddGradientOperators(devices, model, losses_by_gpu):
+def _AddGradientOperators(devices, model, losses_by_gpu, loss_scale=None):
     def create_grad(lossp):
-        return model.ConstantFill(lossp, str(lossp) + "_grad", value=1.0)
+        grad = model.ConstantFill(lossp, str(lossp) + "_grad", value=1.0)
+        if loss_scale is None:
+            return grad
+        # The loss scale lives on the CPU
+        if model._device_type == caffe2_pb2.CUDA:
+            scale = model.net.CopyFromCPUInput(
+                loss_scale, str(lossp) + "_loss_scale")
+        else:
+            scale = loss_scale
+        return model.net.Mul([grad, scale], grad, broadcast=1)
 
     loss_grad = {}
     # Explicitly need to create gradients on each GPU
@@ -932,7 +1190,7 @@ def _AllReduce(devices, model, net, param, use_nccl=False, control_input=None):
     blobs_group = list(viewvalues(model._device_grouped_blobs[param]))
     if model._device_type == caffe2_pb2.CUDA and use_nccl:
         # TODO: for _shared_model, do only NCCLReduce
-        model.NCCLAllreduce(
+        net.NCCLAllreduce(
             blobs_group, blobs_group, control_input=control_input
         )
         return
@@ -959,7 +1217,7 @@ def _AllReduce(devices, model, net, param, use_nccl=False, control_input=None):
                 devices[0], peer
             ]:
                 # Copy from peer to d0
-                blobs[i] = model.Copy(
+                blobs[i] = net.Copy(
                     blobs[i],
                     'gpu_{}/{}_gpu{}_copy'.format(devices[0], param, peer)
                 )
@@ -1130,14 +1388,17 @@ def _SyncAllParamsSingleHost(devices, model, net, unique_param_names):
 
 
 def _AllReduceBlobs(blob_names, devices, model, net, rendezvous, use_nccl,
-                    max_concurrent_distributed_ops):
+                    max_concurrent_distributed_ops, nccl_bucket_size_mb=0,
+                    gloo_bucket_size_mb=0, hierarchical_allreduce=False,
+                    gloo_compression=None):
     if rendezvous is None or rendezvous['num_shards'] <= 1:
         _AllReduceBlobsSingleHost(
             blob_names,
             devices,
             model,
             net,
-            use_nccl
+            use_nccl,
+            nccl_bucket_size_mb,
         )
     else:
         _AllReduceBlobsDistributed(
@@ -1147,6 +1408,9 @@ def _AllReduceBlobs(blob_names, devices, model, net, rendezvous, use_nccl,
             net,
             rendezvous,
             max_concurrent_distributed_ops,
+            gloo_bucket_size_mb,
+            hierarchical_allreduce,
+            gloo_compression,
         )
 
 
@@ -1250,6 +1514,9 @@ def _AllReduceBlobsDistributed(
     net,
     rendezvous,
     max_concurrent_distributed_ops,
+    gloo_bucket_size_mb=0,
+    hierarchical_allreduce=False,
+    gloo_compression=None,
 ):
     num_workers = model.net.Proto().num_workers
     assert num_workers > 1, "Please specify more than 1 worker"
@@ -1268,12 +1535,61 @@ def _AllReduceBlobsDistributed(
 
     nccl_control_blob = None
 
+    if all_reduce_engine == 'GLOO' and gloo_bucket_size_mb > 0:
+        _AllReduceBucketsDistributed(
+            blob_names, devices, model, net, rendezvous, context,
+            reducing_device_opt, gloo_bucket_size_mb, gloo_compression)
+        return
+
+    use_hierarchical = hierarchical_allreduce and \
+        all_reduce_engine == 'GLOO' and len(devices) > 1 and \
+        model._device_type == caffe2_pb2.CUDA
+    grad_sizes = _GetGradientSizes(model, blob_names, devices[0]) \
+        if use_hierarchical else {}
+    # The reduce-scatters, and the all-gathers, run one after the other
+    last_reduce_scatter = None
+    last_all_gather = None
+
     for blob_name in blob_names:
         master_blob = model._device_grouped_blobs[blob_name][devices[0]]
         blobs_group = list(viewvalues(model._device_grouped_blobs[blob_name]))
 
         assert master_blob in blobs_group
 
+        if use_hierarchical and blob_name in grad_sizes and \
+                grad_sizes[blob_name][0] % len(devices) == 0:
+            blobs_group = [
+                model._device_grouped_blobs[blob_name][d] for d in devices
+            ]
+            shards = [str(blob) + "_shard" for blob in blobs_group]
+            with core.DeviceScope(master_device_opt):
+                net.NCCLReduceScatter(
+                    blobs_group, shards, flat=True,
+                    control_input=last_reduce_scatter)
+            last_reduce_scatter = shards[0]
+            for device, shard in zip(devices, shards):
+                with core.DeviceScope(
+                        core.DeviceOption(model._device_type, device)):
+                    comm_world, control_input = \
+                        context.get_control_and_context(shard)
+                    net.Allreduce(
+                        inputs=[comm_world, shard],
+                        outputs=[shard],
+                        name="{}_shard_{}".format(blob_name, device),
+                        engine=all_reduce_engine,
+                        control_input=control_input,
+                        status_blob="allreduce_{}_shard_{}_status".format(
+                            blob_name, device),
+                        gpu_direct=(
+                            rendezvous.get("transport", None) == "ibverbs"),
+                    )
+            with core.DeviceScope(master_device_opt):
+                net.NCCLAllGather(
+                    shards, blobs_group, flat=True,
+                    control_input=last_all_gather)
+            last_all_gather = blobs_group[0]
+            continue
+
         # Remark: NCCLReduce does not support in-place modifications
         # so we need a temporary blob
         reduced_blob = str(master_blob) + "_red"
@@ -1296,9 +1612,13 @@ def _AllReduceBlobsDistributed(
             # With Gloo cross GPU and cross machine allreduce
             # can be executed in a single operation.
             # Try to use GPUDirect if transport == ibverbs.
+            kwargs = {}
+            if gloo_compression is not None:
+                kwargs['compression'] = gloo_compression
             allreduce(
                 blobs_group,
                 gpu_direct=(rendezvous.get("transport", None) == "ibverbs"),
+                **kwargs
             )
         else:
             # Step 1: sum blobs from local GPUs to master GPU
@@ -1324,7 +1644,94 @@ def _AllReduceBlobsDistributed(
             _Broadcast(devices, model, net, blob_name)
 
 
-def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl):
+def _AllReduceBucketsDistributed(
+    blob_names,
+    devices,
+    model,
+    net,
+    rendezvous,
+    context,
+    reducing_device_opt,
+    bucket_size_mb,
+    compression=None,
+):
+    """Allreduces the gradients with one Gloo Allreduce per bucket of about
+    bucket_size_mb. Every Allreduce only depends on the gradients of its
+    bucket, so async nets run it while the backward pass goes on."""
+    bucket_size_bytes = int(bucket_size_mb * (1 << 20))
+    kwargs = {}
+    if compression is not None:
+        kwargs['compression'] = compression
+    grad_sizes = _GetGradientSizesInBytes(model, blob_names, devices[0])
+    buckets = [[]]
+    bucket_bytes = 0
+    for blob_name in blob_names:
+        size = grad_sizes.get(blob_name, bucket_size_bytes)
+        if len(buckets[-1]) > 0 and bucket_bytes + size > bucket_size_bytes:
+            buckets.append([])
+            bucket_bytes = 0
+        buckets[-1].append(blob_name)
+        bucket_bytes += size
+
+    for i, bucket in enumerate(buckets):
+        blobs = []
+        for blob_name in bucket:
+            blobs_group = [
+                model._device_grouped_blobs[blob_name][d] for d in devices
+            ]
+            blobs.extend(blobs_group)
+        with core.DeviceScope(reducing_device_opt):
+            comm_world, control_input = \
+                context.get_control_and_context(blobs[0])
+            net.Allreduce(
+                inputs=[comm_world] + blobs,
+                outputs=blobs,
+                name="allreduce_bucket_{}".format(i),
+                engine='GLOO',
+                control_input=control_input,
+                status_blob="allreduce_bucket_{}_status".format(i),
+                num_devices=len(devices),
+                gpu_direct=(rendezvous.get("transport", None) == "ibverbs"),
+                **kwargs
+            )
+
+
+def _GetGradientSizes(model, blob_names, device):
+    """Numbers of elements and item sizes of the gradients on the device, from
+    the shapes of their params in the param init net. Gradients of unknown
+    size are left out."""
+    grad_to_param = {
+        str(grad): str(param) for param, grad in viewitems(model.param_to_grad)
+        if not isinstance(grad, core.GradientSlice)
+    }
+    try:
+        shapes, types = workspace.InferShapesAndTypes([model.param_init_net])
+    except Exception as e:
+        log.warning("Could not infer the sizes of the params: {}".format(e))
+        return {}
+    sizes = {}
+    for blob_name in blob_names:
+        grad = model._device_grouped_blobs[blob_name].get(device)
+        param = grad_to_param.get(str(grad))
+        if param not in shapes:
+            continue
+        itemsize = 2 if types.get(param) == caffe2_pb2.TensorProto.FLOAT16 \
+            else 4
+        sizes[blob_name] = (int(np.prod(shapes[param])), itemsize)
+    return sizes
+
+
+def _GetGradientSizesInBytes(model, blob_names, device):
+    """Sizes of the gradients on the device, see _GetGradientSizes."""
+    return {
+        blob_name: num_elements * itemsize
+        for blob_name, (num_elements, itemsize) in
+        viewitems(_GetGradientSizes(model, blob_names, device))
+    }
+
+
+def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl,
+                              nccl_bucket_size_mb=0):
     """Performs NCCL AllReduce to distribute blobs to all the GPUs."""
 
     if len(devices) == 1:
@@ -1336,6 +1743,30 @@ def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl):
     last_out = None
     concatenated_idx = set()
 
+    # Dense gradients waiting for their bucket to fill. A bucket is reduced
+    # as soon as all its gradients are computed, while the backward pass goes
+    # on with the next ones
+    use_buckets = use_nccl and nccl_bucket_size_mb > 0 and \
+        model._device_type == caffe2_pb2.CUDA
+    bucket_size_bytes = int(nccl_bucket_size_mb * (1 << 20))
+    grad_sizes = _GetGradientSizesInBytes(model, blob_names, devices[0]) \
+        if use_buckets else {}
+    bucket = []
+    bucket_bytes = [0]
+
+    def flush_bucket():
+        inputs = []
+        for name in bucket:
+            inputs.extend(viewvalues(model._device_grouped_blobs[name]))
+        with core.DeviceScope(master_device_opt):
+            model.NCCLBucketedAllreduce(
+                inputs, inputs, control_input=last_out,
+                num_devices=len(devices),
+                bucket_size_bytes=bucket_size_bytes)
+        del bucket[:]
+        bucket_bytes[0] = 0
+        return inputs[0]
+
     for blob_name in blob_names:
         # Group by blob_name for reduce.
         blobs_group = list(viewvalues(model._device_grouped_blobs[blob_name]))
@@ -1346,6 +1777,18 @@ def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl):
             "Each GPU from {}, should have a copy of {}.".format(
                 devices, blob_name)
 
+        if use_buckets and _IsGPUBlob(model, blob_name) and \
+                not isinstance(blobs_group[0], core.GradientSlice):
+            size = grad_sizes.get(blob_name, bucket_size_bytes)
+            if len(bucket) > 0 and \
+                    bucket_bytes[0] + size > bucket_size_bytes:
+                last_out = flush_bucket()
+            bucket.append(blob_name)
+            bucket_bytes[0] += size
+            continue
+        if len(bucket) > 0:
+            last_out = flush_bucket()
+
         if _IsGPUBlob(model, blob_name):
             with core.DeviceScope(master_device_opt):
                 if not isinstance(blobs_group[0], core.GradientSlice):
@@ -1403,6 +1846,9 @@ def _AllReduceBlobsSingleHost(blob_names, devices, model, net, use_nccl):
                 if not model._shared_model:
                     _Broadcast(devices, model, net, blob_name)
 
+    if len(bucket) > 0:
+        flush_bucket()
+
 
 def _BroadcastComputedParams(devices, model, rendezvous, use_nccl=False):
     if rendezvous is None:
@@ -1744,6 +2190,10 @@ def _CreateOrCloneCommonWorld(
             kwargs['interface'] = rendezvous['interface']
         if 'mpi_rendezvous' in rendezvous:
             kwargs['mpi_rendezvous'] = rendezvous['mpi_rendezvous']
+        if 'topology_aware' in rendezvous:
+            kwargs['topology_aware'] = rendezvous['topology_aware']
+        if 'rack' in rendezvous:
+            kwargs['rack'] = rendezvous['rack']
         comm_world = net.CreateCommonWorld(
             rendezvous['kv_handler'] or [],
             common_world_blob,
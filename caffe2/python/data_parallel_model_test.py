@@ -193,6 +193,75 @@ class DataParallelModelTest(TestCase):
                 result_16gpus = self.run_model(list(range(16)), gpu=gpu)
                 self.assertTrue(np.allclose(result_1gpus, result_16gpus))
 
+    def run_loss_scale_model(self, mixed_precision, num_iters, nan_iter=None):
+        '''
+        Helper function for test_dynamic_loss_scale
+        '''
+        def input_builder_fun(model):
+            return None
+
+        def model_build_fun(model, loss_scale):
+            fc = model.FC("data", "fc", 16, 1,
+                          ("ConstantFill", {}), ("ConstantFill", {}))
+            fc_fl = model.FlattenToVec(fc, "fc_fl")
+            sigm = model.Sigmoid(fc_fl, "sigm")
+            sq = model.SquaredL2Distance([sigm, "label"], "sq")
+            loss = model.AveragedLoss(sq, "loss")
+            loss = model.Scale(loss, scale=loss_scale)
+            return [loss]
+
+        def add_optimizer(model):
+            if mixed_precision:
+                return optimizer.build_mixed_precision(
+                    model, 0.1, optimizer='sgd', momentum=0.9)
+            return optimizer.build_sgd(model, 0.1, momentum=0.9)
+
+        workspace.ResetWorkspace()
+        model = cnn.CNNModelHelper(order="NHWC", name="test_loss_scale")
+        devices = [0, 1]
+        data_parallel_model.Parallelize(
+            model,
+            input_builder_fun=input_builder_fun,
+            forward_pass_builder_fun=model_build_fun,
+            optimizer_builder_fun=add_optimizer,
+            devices=devices,
+            cpu_device=True,
+            shared_model=True,
+            dynamic_loss_scale=2. ** 10 if mixed_precision else None,
+        )
+
+        np.random.seed(2603)
+        for i in range(num_iters):
+            for j in devices:
+                data = np.random.rand(32, 16).astype(np.float32)
+                labels = np.round(data[:, 0]).astype(np.float32)
+                if i == nan_iter:
+                    data[0, 0] = np.nan
+                workspace.FeedBlob("cpu_{}/data".format(j), data)
+                workspace.FeedBlob("cpu_{}/label".format(j), labels)
+            if i == 0:
+                workspace.RunNetOnce(model.param_init_net)
+                workspace.CreateNet(model.net)
+            workspace.RunNet(model.net.Proto().name)
+
+        loss_scale = workspace.FetchBlob("loss_scale")[0] \
+            if mixed_precision else None
+        return workspace.FetchBlob("cpu_0/fc_w"), loss_scale
+
+    def test_dynamic_loss_scale(self):
+        '''
+        Test that dynamic loss scaling gives the same updates as the float
+        optimizer, and skips the iterations with non finite gradients.
+        '''
+        expected, _ = self.run_loss_scale_model(False, 4)
+        result, loss_scale = self.run_loss_scale_model(True, 4)
+        np.testing.assert_allclose(result, expected, rtol=1e-5, atol=1e-6)
+        self.assertEqual(loss_scale, 2. ** 10)
+
+        skipped, loss_scale = self.run_loss_scale_model(True, 5, nan_iter=4)
+        np.testing.assert_array_equal(skipped, result)
+        self.assertEqual(loss_scale, 2. ** 9)
+
     def test_checkpoint_params(self):
         def add_input_ops(model):
             pass
@@ -841,6 +910,76 @@ class ParallelizeBMUFTest(TestCase):
         np.testing.assert_equal(w_0, w_g_ + v_w)
         np.testing.assert_equal(b_0, b_g_ + v_b)
 
+    @given(
+        cpu_device=st.booleans()
+    )
+    def test_parallelize_bmuf_pipelined(self, cpu_device):
+        assume(cpu_device or workspace.has_gpu_support)
+
+        workspace.ResetWorkspace()
+
+        model = cnn.CNNModelHelper(
+            order="NHWC",
+            name="test"
+        )
+        devices = [0, 1]
+
+        def input_builder_fun(model):
+            return None
+
+        if not cpu_device:
+            device_type = caffe2_pb2.CUDA
+            device_prefix = "gpu"
+        else:
+            device_type = caffe2_pb2.CPU
+            device_prefix = "cpu"
+        self._generate_data(devices, device_type, device_prefix)
+
+        data_parallel_model.Parallelize_BMUF(
+            model,
+            input_builder_fun,
+            self._model_build_fun,
+            self._param_update_fun,
+            devices=devices,
+            cpu_device=cpu_device,
+            pipelined_sync=True
+        )
+
+        data_parallel_model.RunInitNet(model)
+
+        def fetch(blob, device):
+            return workspace.FetchBlob(
+                '{}_{}/{}'.format(device_prefix, device, blob))
+
+        # The first block starts the sync of its snapshots
+        data_parallel_model.RunNet(model, 1)
+        snapshots = {
+            (p, d): fetch(p + '_snapshot', d)
+            for p in ['fc_w', 'fc_b'] for d in devices
+        }
+        g_ = {p: fetch(p + '_g', 0) for p in ['fc_w', 'fc_b']}
+        v_ = {p: fetch(p + '_v', 0) for p in ['fc_w', 'fc_b']}
+
+        # The devices keep training while the snapshots are reduced
+        workspace.RunNet(model.net)
+        params = {
+            (p, d): fetch(p, d) for p in ['fc_w', 'fc_b'] for d in devices
+        }
+        data_parallel_model.FinishBMUFSync(model)
+
+        for p in ['fc_w', 'fc_b']:
+            avg = (snapshots[(p, 0)] + snapshots[(p, 1)]) / 2
+            v = 0.5 * v_[p] + avg - g_[p]
+            g = g_[p] + v
+            for d in devices:
+                np.testing.assert_allclose(fetch(p + '_v', d), v, rtol=1e-5)
+                np.testing.assert_allclose(fetch(p + '_g', d), g, rtol=1e-5)
+                # The local steps of the second block are kept
+                np.testing.assert_allclose(
+                    fetch(p, d),
+                    params[(p, d)] + g - snapshots[(p, d)],
+                    rtol=1e-5, atol=1e-6)
+
 
 @unittest.skipIf(not workspace.has_gpu_support, "No gpu support.")
 @unittest.skipIf(workspace.NumCudaDevices() < 2, "Need at least 2 GPUs.")
@@ -58,7 +58,7 @@ class _DatasetReader(Reader):
 
 class _DatasetRandomReader(Reader):
     def __init__(self, dataset, name, indices, batch_size=1, loop_over=False,
-                 enforce_batch_size=False):
+                 enforce_batch_size=False, num_threads=1):
         """Don't call this directly. Instead, use dataset.random_reader()"""
         Reader.__init__(self, dataset.content())
         self.dataset = dataset
@@ -68,6 +68,7 @@ class _DatasetRandomReader(Reader):
         self.batch_size = batch_size
         self.loop_over = loop_over
         self.enforce_batch_size = enforce_batch_size
+        self.num_threads = num_threads
 
     def setup_ex(self, init_net, exit_net):
         if self.cursor is None:
@@ -87,7 +88,7 @@ class _DatasetRandomReader(Reader):
         self.offsets = offsets
 
     def sort_and_shuffle(self, net, sort_by_field=None,
-                         shuffle_size=1, batch_size=1):
+                         shuffle_size=1, batch_size=1, block_size=0):
         # no sorting by default
         content = self.dataset.content()
         sort_by_field_idx = -1
@@ -102,7 +103,8 @@ class _DatasetRandomReader(Reader):
             'indices',
             sort_by_field_idx=sort_by_field_idx,
             shuffle_size=shuffle_size,
-            batch_size=batch_size)
+            batch_size=batch_size,
+            block_size=block_size)
         self.indices = indices
 
     def read(self, read_net):
@@ -113,7 +115,8 @@ class _DatasetRandomReader(Reader):
                 self.dataset.content().field_names(),
                 batch_size=self.batch_size,
                 enforce_batch_size=self.enforce_batch_size,
-                loop_over=self.loop_over)
+                loop_over=self.loop_over,
+                num_threads=self.num_threads)
             return (read_net.IsEmpty([fields[0]]), fields)
 
 
@@ -296,7 +299,8 @@ class Dataset(object):
         return reader
 
     def random_reader(self, init_net=None, indices=None, cursor_name=None,
-                      batch_size=1, loop_over=False, enforce_batch_size=False):
+                      batch_size=1, loop_over=False, enforce_batch_size=False,
+                      num_threads=1):
         """Create a Reader object that is used to iterate through the dataset.
 
         NOTE: The reader order depends on the order in indices.
@@ -308,6 +312,7 @@ class Dataset(object):
                          to the cursor.
             batch_size: how many samples to read per iteration.
             loop_over: repeat the dataset indefinitely (in the same order)
+            num_threads: how many threads gather the fields of a batch.
 
         Returns:
             A DatasetReader that can be used to create operators that will
@@ -316,7 +321,7 @@ class Dataset(object):
         assert self.field_blobs, 'Dataset not initialized.'
         reader = _DatasetRandomReader(
             self, cursor_name, indices, batch_size, loop_over,
-            enforce_batch_size)
+            enforce_batch_size, num_threads)
         if init_net is not None:
             reader.setup_ex(init_net, None)
         return reader
@@ -0,0 +1,115 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+import numpy as np
+from hypothesis import given
+import hypothesis.strategies as st
+
+
+def generate_input_data(bit_rate, rows, blocks, seed):
+    np.random.seed(seed)
+    # The number of columns has to be a multiple of 8 / bit_rate
+    columns = blocks * (8 // bit_rate)
+    return np.random.uniform(-10, 10, size=[rows, columns]).astype(np.float32)
+
+
+class TestFusedNBitRowwiseOps(hu.HypothesisTestCase):
+    @given(
+        bit_rate=st.sampled_from([2, 4]),
+        rows=st.integers(1, 20),
+        blocks=st.integers(1, 40),
+        seed=st.integers(0, 2**32 - 1),
+    )
+    def test_quantize_dequantize(self, bit_rate, rows, blocks, seed):
+        input_data = generate_input_data(bit_rate, rows, blocks, seed)
+        workspace.FeedBlob('input_data', input_data)
+
+        quantize = core.CreateOperator(
+            'FloatToFused{}BitRowwiseQuantized'.format(bit_rate),
+            ['input_data'],
+            ['quantized_data'],
+        )
+        dequantize = core.CreateOperator(
+            'Fused{}BitRowwiseQuantizedToFloat'.format(bit_rate),
+            ['quantized_data'],
+            ['dequantized_data'],
+        )
+        workspace.RunOperatorOnce(quantize)
+        workspace.RunOperatorOnce(dequantize)
+
+        quantized_data = workspace.FetchBlob('quantized_data')
+        dequantized_data = workspace.FetchBlob('dequantized_data')
+        self.assertEqual(
+            quantized_data.shape,
+            (rows, input_data.shape[1] // (8 // bit_rate) + 8),
+        )
+        self.assertEqual(dequantized_data.shape, input_data.shape)
+
+        # Every value is within half a quantization step of the original
+        span = np.max(input_data, axis=1) - np.min(input_data, axis=1)
+        half_step = span / (2 ** bit_rate - 1) / 2
+        error = np.abs(dequantized_data - input_data)
+        self.assertTrue(np.all(error <= half_step[:, None] + 1e-4))
+
+    @given(
+        bit_rate=st.sampled_from([2, 4]),
+        reducer=st.sampled_from(['Sum', 'WeightedSum', 'Mean']),
+        rows=st.integers(1, 20),
+        blocks=st.integers(1, 40),
+        seed=st.integers(0, 2**32 - 1),
+    )
+    def test_sparse_lengths_reducers(
+        self, bit_rate, reducer, rows, blocks, seed
+    ):
+        input_data = generate_input_data(bit_rate, rows, blocks, seed)
+        indices = np.random.randint(
+            low=0, high=rows, size=[np.random.randint(1, 30)], dtype=np.int32
+        )
+        weights = np.random.uniform(size=[len(indices)]).astype(np.float32)
+        lengths_split = np.clip(1, len(indices) // 2, 10)
+        lengths = np.ones(
+            [len(indices) // lengths_split], dtype=np.int32
+        ) * lengths_split
+        indices = indices[:np.sum(lengths)]
+        weights = weights[:np.sum(lengths)]
+
+        net = core.Net('bench')
+        quantized_data = net.__getattr__(
+            'FloatToFused{}BitRowwiseQuantized'.format(bit_rate)
+        )('input_data', 'quantized_data')
+        dequantized_data = net.__getattr__(
+            'Fused{}BitRowwiseQuantizedToFloat'.format(bit_rate)
+        )(quantized_data, 'dequantized_data')
+
+        if reducer == 'WeightedSum':
+            reference_inputs = [
+                dequantized_data, 'weights', 'indices', 'lengths'
+            ]
+            quantized_inputs = [quantized_data, 'weights', 'indices', 'lengths']
+        else:
+            reference_inputs = [dequantized_data, 'indices', 'lengths']
+            quantized_inputs = [quantized_data, 'indices', 'lengths']
+        net.__getattr__('SparseLengths{}'.format(reducer))(
+            reference_inputs, 'reference'
+        )
+        net.__getattr__(
+            'SparseLengths{}Fused{}BitRowwise'.format(reducer, bit_rate)
+        )(quantized_inputs, 'quantized')
+
+        workspace.FeedBlob('input_data', input_data)
+        workspace.FeedBlob('weights', weights)
+        workspace.FeedBlob('indices', indices)
+        workspace.FeedBlob('lengths', lengths)
+
+        workspace.GlobalInit(['caffe2', '--caffe2_log_level=0'])
+        workspace.CreateNet(net)
+        workspace.RunNetOnce(net)
+
+        reference = workspace.FetchBlob('reference')
+        quantized = workspace.FetchBlob('quantized')
+        np.testing.assert_array_almost_equal(reference, quantized, decimal=3)
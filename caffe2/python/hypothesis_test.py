@@ -1102,13 +1102,15 @@ class TestOperators(hu.HypothesisTestCase):
             reference=log_ref)
         self.assertGradientChecks(gc, op, [input_tensor], 0, [0])
 
-    def test_blobs_dequeue_timeout(self):
+    @given(lock_free=st.booleans())
+    def test_blobs_dequeue_timeout(self, lock_free):
         op = core.CreateOperator(
             "CreateBlobsQueue",
             [],
             ["queue"],
             capacity=5,
-            num_blobs=1)
+            num_blobs=1,
+            lock_free=lock_free)
         self.ws.run(op)
         t = time.time()
         op = core.CreateOperator(
@@ -1120,13 +1122,56 @@ class TestOperators(hu.HypothesisTestCase):
         t = time.time() - t
         self.assertGreater(t, 0.19)
 
+    def test_shuffle_blobs_queue(self):
+        num_elements = 100
+        self.ws.run(core.CreateOperator(
+            "CreateBlobsQueue", [], ["queue"],
+            capacity=10, num_blobs=1, shuffle=True, seed=1))
+        for i in range(num_elements):
+            self.ws.create_blob("x").feed(np.array([i], dtype=np.int32))
+            self.ws.run(core.CreateOperator(
+                "EnqueueBlobs", ["queue", "x"], ["x"]))
+            if i >= 9:
+                # the queue is full, make room for the next record
+                self.ws.run(core.CreateOperator(
+                    "DequeueBlobs", ["queue"], ["y_{}".format(i - 9)]))
+        self.ws.run(core.CreateOperator("CloseBlobsQueue", ["queue"], []))
+        for i in range(num_elements - 9, num_elements):
+            self.ws.run(core.CreateOperator(
+                "DequeueBlobs", ["queue"], ["y_{}".format(i)]))
+        ys = [self.ws.blobs["y_{}".format(i)].fetch()[0]
+              for i in range(num_elements)]
+        self.assertEqual(sorted(ys), list(range(num_elements)))
+        self.assertNotEqual(ys, list(range(num_elements)))
+        # a record is read at most 9 records before it was written
+        self.assertTrue(all(y <= i + 9 for i, y in enumerate(ys)))
+
+    def test_shuffle_blobs_queue_capacity_bytes(self):
+        self.ws.run(core.CreateOperator(
+            "CreateBlobsQueue", [], ["queue"],
+            capacity=100, num_blobs=1, shuffle=True, capacity_bytes=100))
+        for i in range(3):
+            self.ws.create_blob("x").feed(np.zeros(10, dtype=np.float32))
+            self.ws.run(core.CreateOperator(
+                "EnqueueBlobs", ["queue", "x"], ["x"]))
+        # 3 records of 40 bytes fill the queue, which can be read from
+        self.ws.run(core.CreateOperator(
+            "DequeueBlobs", ["queue"], ["y"], timeout_secs=1.0))
+        np.testing.assert_array_equal(
+            self.ws.blobs["y"].fetch(), np.zeros(10, dtype=np.float32))
+        # but not anymore once a record was read
+        op = core.CreateOperator(
+            "DequeueBlobs", ["queue"], ["y"], timeout_secs=0.2)
+        self.assertRaises(RuntimeError, lambda: self.ws.run(op))
+
     @given(num_threads=st.integers(1, 10),  # noqa
            num_elements=st.integers(1, 100),
            capacity=st.integers(1, 5),
            num_blobs=st.integers(1, 3),
+           lock_free=st.booleans(),
            do=st.sampled_from(hu.device_options))
     def test_blobs_queue_threading(self, num_threads, num_elements,
-                                   capacity, num_blobs, do):
+                                   capacity, num_blobs, lock_free, do):
         """
         - Construct matrices of size N x D
         - Start K threads
@@ -1147,6 +1192,7 @@ class TestOperators(hu.HypothesisTestCase):
             ["queue"],
             capacity=capacity,
             num_blobs=num_blobs,
+            lock_free=lock_free,
             device_option=do)
         self.ws.run(op)
 
@@ -1213,12 +1259,14 @@ class TestOperators(hu.HypothesisTestCase):
            num_consumers=st.integers(1, 10),
            capacity=st.integers(1, 5),
            num_blobs=st.integers(1, 3),
+           lock_free=st.booleans(),
            do=st.sampled_from(hu.device_options))
     def test_safe_blobs_queue(self, num_producers, num_consumers,
-                              capacity, num_blobs, do):
+                              capacity, num_blobs, lock_free, do):
         init_net = core.Net('init_net')
         queue = init_net.CreateBlobsQueue(
-            [], 1, capacity=capacity, num_blobs=num_blobs)
+            [], 1, capacity=capacity, num_blobs=num_blobs,
+            lock_free=lock_free)
         producer_steps = []
         truth = 0
         for i in range(num_producers):
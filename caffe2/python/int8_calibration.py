@@ -0,0 +1,54 @@
+## @package int8_calibration
+# Module caffe2.python.int8_calibration
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import workspace
+
+'''
+    Calibration of the activations of the Int8 operators:
+    1) add_range_recorders() adds Int8RecordRange after the float activations
+       of a net
+    2) running the net over a few sample batches records the range of each
+       activation
+    3) quantization_params() gives the Y_scale and Y_zero_point arguments of
+       Int8Quantize, Int8FC and Int8Conv from a recorded range
+'''
+
+
+def add_range_recorders(net, blobs):
+    '''
+    Records the range of each blob of blobs over the runs of net, in a blob
+    named after it. Returns the names of the range blobs, in order.
+    '''
+    ranges = []
+    for blob in blobs:
+        range_blob = net.NextScopedBlob(str(blob) + '_range')
+        net.Int8RecordRange([blob], [range_blob])
+        ranges.append(range_blob)
+    return ranges
+
+
+def quantization_params(range_blob):
+    '''
+    Returns the (scale, zero_point) of the uint8 quantization of a range
+    recorded in the workspace, as Int8Quantize chooses them.
+    '''
+    minimum, maximum = workspace.FetchBlob(range_blob).tolist()
+    return range_quantization_params(minimum, maximum)
+
+
+def range_quantization_params(minimum, maximum):
+    '''
+    Returns the (scale, zero_point) of the uint8 quantization of the range
+    [minimum, maximum], as Int8Quantize chooses them.
+    '''
+    minimum = min(minimum, 0.0)
+    maximum = max(maximum, 0.0)
+    scale = (maximum - minimum) / 255
+    if scale == 0:
+        scale = 1.0
+    zero_point = min(255, max(0, int(round(-minimum / scale))))
+    return scale, zero_point
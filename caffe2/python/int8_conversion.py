@@ -0,0 +1,213 @@
+## @package int8_conversion
+# Module caffe2.python.int8_conversion
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.proto import caffe2_pb2
+from caffe2.python import core, int8_calibration, utils, workspace
+
+'''
+    Conversion of a float inference net to the Int8 operators:
+    1) calibrate() runs the float net over a few sample batches and returns
+       the range of its activations
+    2) convert_to_int8() rewrites the FC and NHWC Conv operators, depthwise
+       ones included, to Int8FC and Int8Conv, quantizes their weights in the
+       init net, and quantizes and dequantizes the activations where the
+       int8 operators meet the float ones
+'''
+
+
+def calibrate(predict_net, init_net, batches):
+    '''
+    Runs init_net, then predict_net over batches, a list of dicts of input
+    name to numpy array, and returns the dict of the (min, max) range of the
+    activations of predict_net, its inputs included. The range of a blob
+    written several times covers all its versions.
+    '''
+    workspace.RunNetOnce(init_net)
+    params = set(_outputs(init_net))
+    net = core.Net((predict_net.name or 'predict') + '_calibration')
+    range_blobs = {}
+
+    def record(blob):
+        if blob not in range_blobs:
+            range_blobs[blob] = net.NextScopedBlob(str(blob) + '_range')
+        net.Int8RecordRange([blob], [range_blobs[blob]])
+
+    for op in predict_net.op:
+        for blob in op.input:
+            if blob not in params and blob not in range_blobs:
+                record(blob)
+        net.Proto().op.extend([op])
+        for blob in op.output:
+            record(blob)
+    for batch in batches:
+        for name, value in batch.items():
+            workspace.FeedBlob(name, value)
+        workspace.RunNetOnce(net)
+    return {
+        blob: tuple(workspace.FetchBlob(range_blob).tolist())
+        for blob, range_blob in range_blobs.items()
+    }
+
+
+def convert_to_int8(predict_net, init_net, ranges, per_channel=True):
+    '''
+    Returns the (predict_net, init_net) running the FC and Conv operators of
+    predict_net in int8, for the activation ranges given by calibrate().
+
+    The operators are converted when their weights come from init_net, the
+    ranges of their input and output are known, and, for Conv, they are 2D
+    NHWC without groups, or depthwise with square kernels. A Relu that is
+    the only reader of their output is folded into them, since the uint8
+    quantization of its range, which starts at 0, clamps the negative
+    values. The weights are quantized to int8 in the init net, per output
+    channel if per_channel. The activations are quantized before the first
+    int8 operator reading them, and dequantized before the first float
+    operator reading them, so that chains of int8 operators stay in int8.
+    '''
+    params = _param_shapes(init_net)
+    new_init_net = caffe2_pb2.NetDef()
+    new_init_net.CopyFrom(init_net)
+    new_predict_net = caffe2_pb2.NetDef()
+    new_predict_net.CopyFrom(predict_net)
+    del new_predict_net.op[:]
+
+    external_outputs = set(predict_net.external_output)
+
+    # The int8 version of the activations, and whether their float version
+    # is up to date
+    int8_blobs = {}
+    has_float = set(predict_net.external_input)
+    quantized_weights = set()
+    skip = set()
+    for i, op in enumerate(predict_net.op):
+        if i in skip:
+            continue
+        output = op.output[0] if len(op.output) == 1 else None
+        fused = None
+        if output is not None and output not in external_outputs:
+            readers = _readers(predict_net, i, output)
+            if len(readers) == 1 and \
+                    predict_net.op[readers[0]].type == 'Relu' and \
+                    list(predict_net.op[readers[0]].input) == [output]:
+                fused = readers[0]
+        final_output = \
+            predict_net.op[fused].output[0] if fused is not None else output
+        if _is_convertible(op, params, ranges) and final_output in ranges:
+            X, W = op.input[0], op.input[1]
+            if X not in int8_blobs:
+                _add_quantize(new_predict_net, X, ranges[X], int8_blobs)
+            Wq = W + '_int8'
+            if W not in quantized_weights:
+                new_init_net.op.extend([core.CreateOperator(
+                    'Int8Quantize', [W], [Wq],
+                    signed=1, per_channel=int(per_channel))])
+                new_init_net.external_output.append(Wq)
+                quantized_weights.add(W)
+            Y_range = ranges[final_output]
+            if fused is not None:
+                # The range of a Relu written in place also covers its input
+                Y_range = (0.0, Y_range[1])
+            Y_scale, Y_zero_point = \
+                int8_calibration.range_quantization_params(*Y_range)
+            Yq = final_output + '_int8'
+            int8_op = core.CreateOperator(
+                'Int8' + op.type,
+                [int8_blobs[X], Wq] + list(op.input[2:]),
+                [Yq],
+                name=op.name,
+                Y_scale=Y_scale,
+                Y_zero_point=Y_zero_point)
+            int8_op.arg.extend(op.arg)
+            new_predict_net.op.extend([int8_op])
+            if fused is not None:
+                skip.add(fused)
+            int8_blobs.pop(output, None)
+            has_float.discard(output)
+            int8_blobs[final_output] = Yq
+            has_float.discard(final_output)
+            continue
+        for blob in op.input:
+            if blob in int8_blobs and blob not in has_float:
+                _add_dequantize(new_predict_net, blob, int8_blobs)
+                has_float.add(blob)
+        new_predict_net.op.extend([op])
+        for blob in op.output:
+            int8_blobs.pop(blob, None)
+            has_float.add(blob)
+    for blob in predict_net.external_output:
+        if blob in int8_blobs and blob not in has_float:
+            _add_dequantize(new_predict_net, blob, int8_blobs)
+    return new_predict_net, new_init_net
+
+
+def _outputs(net):
+    return [blob for op in net.op for blob in op.output]
+
+
+def _readers(net, i, blob):
+    '''
+    Returns the indices of the operators of net reading the version of blob
+    written by operator i.
+    '''
+    readers = []
+    for j in range(i + 1, len(net.op)):
+        if blob in net.op[j].input:
+            readers.append(j)
+        if blob in net.op[j].output:
+            break
+    return readers
+
+
+def _param_shapes(net):
+    '''
+    Returns the dict of the blobs written by net, to their shape when the
+    fill operator writing them has one.
+    '''
+    shapes = {}
+    for op in net.op:
+        shape = utils.ArgsToDict(op.arg).get('shape')
+        for blob in op.output:
+            shapes[blob] = list(shape) if shape is not None else None
+    return shapes
+
+
+def _is_convertible(op, params, ranges):
+    if op.type not in ('FC', 'Conv') or len(op.output) != 1 or \
+            len(op.input) < 2 or op.input[1] not in params or \
+            op.input[0] not in ranges:
+        return False
+    if op.type == 'FC':
+        return len(op.input) == 3
+    args = utils.ArgsToDict(op.arg)
+    if args.get('order', b'NCHW') not in (b'NHWC', 'NHWC') or \
+            len(args.get('kernels', [0, 0])) != 2:
+        return False
+    group = args.get('group', 1)
+    if group == 1:
+        return True
+    # Int8Conv only runs depthwise groups, of a M x kernel x kernel x 1
+    # filter with M = group, square kernels, equal strides and no dilation
+    shape = params[op.input[1]]
+    return shape is not None and shape[0] == group and shape[3] == 1 and \
+        'kernel' in args and args.get('dilation', 1) == 1 and not any(
+            name in args for name in (
+                'kernel_h', 'kernel_w', 'kernels', 'stride_h', 'stride_w',
+                'strides', 'dilation_h', 'dilation_w', 'dilations'))
+
+
+def _add_quantize(net, blob, blob_range, int8_blobs):
+    scale, zero_point = int8_calibration.range_quantization_params(
+        *blob_range)
+    int8_blobs[blob] = blob + '_int8'
+    net.op.extend([core.CreateOperator(
+        'Int8Quantize', [blob], [int8_blobs[blob]],
+        Y_scale=scale, Y_zero_point=zero_point)])
+
+
+def _add_dequantize(net, blob, int8_blobs):
+    net.op.extend([core.CreateOperator(
+        'Int8Dequantize', [int8_blobs[blob]], [blob])])
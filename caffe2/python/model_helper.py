@@ -47,6 +47,7 @@ _known_working_ops = [
     "MakeTwoClass",
     "MatMul",
     "NCCLAllreduce",
+    "NCCLBucketedAllreduce",
     "NHWC2NCHW",
     "PackSegments",
     "Print",
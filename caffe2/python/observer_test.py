@@ -35,6 +35,25 @@ class TestObservers(unittest.TestCase):
         self.model.net.RemoveObserver(ob)
         assert(self.model.net.NumObservers() + 1 == num)
 
+    def testBlobMemoryObserver(self):
+        ob = self.model.net.AddObserver("BlobMemoryObserver")
+        ws.RunNet(self.model.net)
+        stats = ob.memory_stats()
+        # data, y_w and y_b, then the 2 floats of y written by the FC
+        self.assertEqual(stats["start_bytes"], 16 + 32 + 8)
+        self.assertEqual(stats["operator_bytes"], [8])
+        self.assertEqual(stats["peak_bytes"], 16 + 32 + 8 + 8)
+        self.assertEqual(stats["end_bytes"], stats["peak_bytes"])
+        self.assertEqual(stats["peak_blobs"][0], ("y_w", 32))
+        self.assertEqual(len(stats["peak_blobs"]), 4)
+
+        ws.RunNet(self.model.net)
+        stats = ob.memory_stats()
+        self.assertEqual(stats["operator_bytes"], [0])
+        self.assertEqual(stats["start_bytes"], stats["peak_bytes"])
+        self.assertEqual(stats["max_peak_bytes"], stats["peak_bytes"])
+        self.model.net.RemoveObserver(ob)
+
     @given(
         num_layers=st.integers(1, 4),
         forward_only=st.booleans()
@@ -63,6 +63,48 @@ class TestAdagrad(hu.HypothesisTestCase):
             [param, momentum, grad, lr],
             functools.partial(self.ref_adagrad, epsilon=epsilon))
 
+    # Sizes up to two chunks of the multi-tensor operators
+    @given(sizes=st.lists(st.integers(1, 1 << 17), min_size=1, max_size=4),
+           lr=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           epsilon=st.floats(min_value=0.01, max_value=0.99,
+                             allow_nan=False, allow_infinity=False),
+           num_threads=st.integers(0, 2),
+           **hu.gcs)
+    @settings(max_examples=10)
+    def test_multi_tensor_adagrad(self, sizes, lr, epsilon, num_threads,
+                                  gc, dc):
+        lr = np.array([lr], dtype=np.float32)
+        inputs = []
+        for n in sizes:
+            inputs += [np.random.randn(n).astype(np.float32),
+                       np.random.rand(n).astype(np.float32),
+                       np.random.randn(n).astype(np.float32)]
+        names = ["{}_{}".format(name, i)
+                 for i in range(len(sizes))
+                 for name in ["param", "momentum", "grad"]]
+
+        def ref_multi_tensor_adagrad(*inputs):
+            outputs = []
+            for i in range(len(sizes)):
+                outputs += self.ref_adagrad(
+                    *inputs[3 * i:3 * i + 3], lr=inputs[-1], epsilon=epsilon)
+            return outputs
+
+        op = core.CreateOperator(
+            "MultiTensorAdagrad",
+            names + ["lr"],
+            [name for name in names if not name.startswith("grad")],
+            epsilon=epsilon,
+            num_threads=num_threads,
+            device_option=gc,
+        )
+
+        self.assertReferenceChecks(
+            gc, op,
+            inputs + [lr],
+            ref_multi_tensor_adagrad)
+
     # Suppress filter_too_much health check.
     # Likely caused by `assume` call falling through too often.
     @settings(suppress_health_check=[HealthCheck.filter_too_much])
@@ -283,3 +325,106 @@ class TestAdagrad(hu.HypothesisTestCase):
             gc, op,
             [param, momentum, indices, grad, lr],
             ref_row_wise_sparse)
+
+    @given(inputs=hu.tensors(n=2, min_dim=2, max_dim=2),
+           lr=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           epsilon=st.floats(min_value=0.01, max_value=0.99,
+                             allow_nan=False, allow_infinity=False),
+           is_rowwise=st.booleans(),
+           index_type=st.sampled_from([np.int32, np.int64]),
+           data_strategy=st.data(),
+           **hu.gcs_cpu_only)
+    def test_sparse_lengths_sum_sparse_adagrad(self, inputs, lr, epsilon,
+                                               is_rowwise, index_type,
+                                               data_strategy, gc, dc):
+        param, momentum = inputs
+        momentum = np.abs(momentum)
+        if is_rowwise:
+            momentum = momentum[:, 0].copy()
+        lr = np.array([lr], dtype=np.float32)
+
+        lengths = data_strategy.draw(
+            hu.tensor1d(min_len=1, max_len=5, dtype=np.int32,
+                        elements=st.integers(min_value=0, max_value=5))
+        )
+        # Indices can repeat, the updates are applied one after the other
+        indices = data_strategy.draw(
+            hu.tensor1d(min_len=np.sum(lengths), max_len=np.sum(lengths),
+                        dtype=index_type,
+                        elements=st.sampled_from(np.arange(param.shape[0])))
+        )
+        # One gradient row per segment
+        grad = data_strategy.draw(
+            hu.arrays(dims=[lengths.size, param.shape[1]])
+        )
+
+        op = core.CreateOperator(
+            "SparseLengthsSumRowWiseSparseAdagrad" if is_rowwise
+            else "SparseLengthsSumSparseAdagrad",
+            ["param", "momentum", "indices", "grad", "lr", "lengths"],
+            ["param", "momentum"],
+            epsilon=epsilon,
+            device_option=gc)
+
+        def ref_sparse_lengths_sum(param, momentum, indices, grad, lr,
+                                   lengths):
+            ref = (self.ref_row_wise_adagrad if is_rowwise
+                   else self.ref_adagrad)
+            param_out = np.copy(param)
+            momentum_out = np.copy(momentum)
+            segments = np.repeat(np.arange(lengths.size), lengths)
+            for segment, index in zip(segments, indices):
+                param_out[index], momentum_out[index] = ref(
+                    param_out[index], momentum_out[index], grad[segment],
+                    lr, epsilon)
+            return (param_out, momentum_out)
+
+        self.assertReferenceChecks(
+            gc, op,
+            [param, momentum, indices, grad, lr, lengths],
+            ref_sparse_lengths_sum)
+
+    @given(inputs=hu.tensors(n=3),
+           lr=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           epsilon=st.floats(min_value=0.01, max_value=0.99,
+                             allow_nan=False, allow_infinity=False),
+           data_strategy=st.data(),
+           **hu.gcs_cpu_only)
+    def test_sparse_adagrad_fp16(self, inputs, lr, epsilon,
+                                 data_strategy, gc, dc):
+        param, momentum, grad = inputs
+        param = param.astype(np.float16)
+        momentum = np.abs(momentum).astype(np.float16)
+        lr = np.array([lr], dtype=np.float32)
+
+        indices = data_strategy.draw(
+            hu.tensor(dtype=np.int64,
+                      elements=st.sampled_from(np.arange(grad.shape[0]))),
+        )
+        hypothesis.assume(np.array_equal(np.unique(indices.flatten()),
+                                         np.sort(indices.flatten())))
+        grad = grad[indices]
+
+        op = core.CreateOperator(
+            "SparseAdagrad",
+            ["param", "momentum", "indices", "grad", "lr"],
+            ["param", "momentum"],
+            epsilon=epsilon,
+            device_option=gc)
+
+        # The outputs are stochastically rounded to one of the two float16
+        # values around the float result
+        def ref_sparse(param, momentum, indices, grad, lr):
+            param_out = param.astype(np.float32)
+            momentum_out = momentum.astype(np.float32)
+            for i, index in enumerate(indices):
+                param_out[index], momentum_out[index] = self.ref_adagrad(
+                    param_out[index], momentum_out[index], grad[i], lr,
+                    epsilon)
+            return (param_out, momentum_out)
+
+        self.assertReferenceChecks(
+            gc, op, [param, momentum, indices, grad, lr], ref_sparse,
+            threshold=2e-3)
@@ -74,6 +74,52 @@ class TestAdam(hu.HypothesisTestCase):
                 beta1=beta1, beta2=beta2, epsilon=epsilon),
             input_device_options=input_device_options)
 
+    # Sizes up to two chunks of the multi-tensor operators
+    @given(sizes=st.lists(st.integers(1, 1 << 17), min_size=1, max_size=4),
+           ITER=st.integers(min_value=0, max_value=10000),
+           LR=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           num_threads=st.integers(0, 2),
+           **hu.gcs)
+    @hypothesis.settings(max_examples=10)
+    def test_multi_tensor_adam(self, sizes, ITER, LR, num_threads, gc, dc):
+        beta1, beta2, epsilon = 0.9, 0.999, 1e-5
+        ITER = np.array([ITER], dtype=np.int64)
+        LR = np.array([LR], dtype=np.float32)
+        inputs = []
+        for n in sizes:
+            inputs += [np.random.randn(n).astype(np.float32),
+                       np.random.randn(n).astype(np.float32),
+                       np.random.rand(n).astype(np.float32),
+                       np.random.randn(n).astype(np.float32)]
+        names = ["{}_{}".format(name, i)
+                 for i in range(len(sizes))
+                 for name in ["param", "mom1", "mom2", "grad"]]
+
+        def ref_multi_tensor_adam(*inputs):
+            outputs = []
+            for i in range(len(sizes)):
+                outputs += self.ref_adam(
+                    *(inputs[4 * i:4 * i + 4] + inputs[-2:]),
+                    beta1=beta1, beta2=beta2, epsilon=epsilon)
+            return outputs
+
+        op = core.CreateOperator(
+            "MultiTensorAdam",
+            names + ["lr", "iter"],
+            [name for name in names if not name.startswith("grad")],
+            beta1=beta1, beta2=beta2, epsilon=epsilon,
+            num_threads=num_threads)
+
+        # Iter lives on the CPU
+        input_device_options = {'iter': hu.cpu_do}
+
+        self.assertReferenceChecks(
+            gc, op,
+            inputs + [LR, ITER],
+            ref_multi_tensor_adam,
+            input_device_options=input_device_options)
+
     @given(inputs=hu.tensors(n=4),
            ITER=st.integers(min_value=0, max_value=10000),
            LR=st.floats(min_value=0.01, max_value=0.99,
@@ -139,6 +185,116 @@ class TestAdam(hu.HypothesisTestCase):
             ref_sparse,
             input_device_options=input_device_options)
 
+    @given(rows=st.integers(2, 10),
+           block_size=st.integers(1, 20),
+           iters=st.integers(1, 5),
+           **hu.gcs_cpu_only)
+    def test_lazy_sparse_adam(self, rows, block_size, iters, gc, dc):
+        beta1, beta2, epsilon = 0.9, 0.999, 1e-5
+        param = np.random.randn(rows, block_size).astype(np.float32)
+        mom1 = np.zeros_like(param)
+        mom2 = np.zeros_like(param)
+        last_iter = np.zeros(rows, dtype=np.int64)
+        LR = np.array([0.1], dtype=np.float32)
+        for name, value in [("param", param), ("mom1", mom1), ("mom2", mom2),
+                            ("last_iter", last_iter), ("lr", LR)]:
+            workspace.FeedBlob(name, value, device_option=gc)
+
+        op = core.CreateOperator(
+            "SparseAdam",
+            ["param", "mom1", "mom2", "indices", "grad", "lr", "iter",
+             "last_iter"],
+            ["param", "mom1", "mom2", "last_iter"],
+            beta1=beta1, beta2=beta2, epsilon=epsilon,
+            device_option=gc)
+        # Every iteration updates a random subset of the rows, the moments of
+        # the others being decayed on their next update
+        for it in range(1, iters + 1):
+            indices = np.random.choice(
+                rows, np.random.randint(1, rows + 1), replace=False)
+            grad = np.random.randn(
+                len(indices), block_size).astype(np.float32)
+            workspace.FeedBlob("indices", indices.astype(np.int64))
+            workspace.FeedBlob("grad", grad)
+            workspace.FeedBlob("iter", np.array([it], dtype=np.int64))
+            workspace.RunOperatorOnce(op)
+
+            t = it + 1
+            corrected_local_rate = LR * np.sqrt(1 - np.power(beta2, t)) / \
+                (1 - np.power(beta1, t))
+            for i, index in enumerate(indices):
+                skipped = it - last_iter[index]
+                mom1[index] = np.power(beta1, skipped) * mom1[index] + \
+                    (1 - beta1) * grad[i]
+                mom2[index] = np.power(beta2, skipped) * mom2[index] + \
+                    (1 - beta2) * np.square(grad[i])
+                param[index] += corrected_local_rate * mom1[index] / \
+                    (np.sqrt(mom2[index]) + epsilon)
+                last_iter[index] = it
+
+        np.testing.assert_array_equal(
+            workspace.FetchBlob("last_iter"), last_iter)
+        for name, value in [("param", param), ("mom1", mom1), ("mom2", mom2)]:
+            np.testing.assert_allclose(
+                workspace.FetchBlob(name), value, rtol=1e-4, atol=1e-4)
+
+    @given(inputs=hu.tensors(n=4),
+           ITER=st.integers(min_value=0, max_value=10000),
+           LR=st.floats(min_value=0.01, max_value=0.99,
+                        allow_nan=False, allow_infinity=False),
+           data_strategy=st.data(),
+           **hu.gcs_cpu_only)
+    def test_sparse_adam_float16_moments(self, inputs, ITER, LR,
+                                         data_strategy, gc, dc):
+        beta1, beta2, epsilon = 0.9, 0.999, 1e-5
+        param, mom1, mom2, grad = inputs
+        mom2 = np.absolute(mom2)
+        ITER = np.array([ITER], dtype=np.int64)
+        LR = np.array([LR], dtype=np.float32)
+        indices = data_strategy.draw(
+            hu.tensor(
+                max_dim=1,
+                min_value=1,
+                max_value=grad.shape[0],
+                dtype=np.int64,
+                elements=st.sampled_from(np.arange(grad.shape[0])),
+            ),
+        )
+        hypothesis.assume(
+            np.array_equal(
+                np.unique(indices.flatten()),
+                np.sort(indices.flatten())))
+        grad = grad[indices]
+        mom1 = mom1.astype(np.float16)
+        mom2 = mom2.astype(np.float16)
+
+        op = core.CreateOperator(
+            "SparseAdam",
+            ["param", "mom1", "mom2", "indices", "grad", "lr", "iter"],
+            ["param", "mom1", "mom2"],
+            beta1=beta1, beta2=beta2, epsilon=epsilon)
+
+        def ref_sparse(param, mom1, mom2, indices, grad, LR, ITER):
+            param_out = np.copy(param)
+            mom1_out = np.copy(mom1)
+            mom2_out = np.copy(mom2)
+            for i, index in enumerate(indices):
+                param_out[index], mom1_out[index], mom2_out[index] = \
+                    self.ref_adam(param[index],
+                                  mom1[index].astype(np.float32),
+                                  mom2[index].astype(np.float32),
+                                  grad[i], LR, ITER,
+                                  beta1, beta2, epsilon)
+            return (param_out, mom1_out, mom2_out)
+
+        # The moments are stochastically rounded to float16, so they are off
+        # by at most one float16 ulp
+        self.assertReferenceChecks(
+            gc, op,
+            [param, mom1, mom2, indices, grad, LR, ITER],
+            ref_sparse,
+            threshold=1e-2)
+
     @given(inputs=hu.tensors(n=3),
            ITER=st.integers(min_value=0, max_value=10000),
            LR=st.floats(min_value=0.01, max_value=0.99,
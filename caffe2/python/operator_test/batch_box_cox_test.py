@@ -91,6 +91,17 @@ class TestBatchBoxCox(hu.HypothesisTestCase):
                   [0, 0, 0], [0, 0, 1e-6])
         self.batch_box_cox(inputs, gc, dc)
 
+    @given(N=st.integers(1, 20), D=st.integers(1, 40), **hu.gcs_cpu_only)
+    def test_wide_rows_mixed_lambda1(self, N, D, gc, dc):
+        # Rows wider than the vectors, with their tails and zero lambda1 in
+        # every other column
+        data = np.random.uniform(-1, 10, size=(N, D))
+        lambda1 = np.random.uniform(0.1, 1.5, size=D)
+        lambda1[::2] = 0
+        lambda2 = np.random.uniform(0, 2, size=D)
+        inputs = (N, D, data.tolist(), lambda1.tolist(), lambda2.tolist())
+        self.batch_box_cox(inputs, gc, dc)
+
     def batch_box_cox(self, inputs, gc, dc):
         N, D, data, lambda1, lambda2 = inputs
 
@@ -0,0 +1,119 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+from caffe2.python import core, workspace
+from caffe2.python.test_util import TestCase
+
+import numpy as np
+import numpy.testing as npt
+
+from hypothesis import given, settings
+import hypothesis.strategies as st
+
+
+GO_ID = 1
+EOS_ID = 2
+
+
+def _beam_search_ref(log_probs_fn, batch_size, beam_size, max_length):
+    tokens = np.full((batch_size, beam_size), GO_ID, dtype=np.int32)
+    scores = np.zeros((batch_size, beam_size), dtype=np.float32)
+    all_tokens, all_prev, all_scores = [], [], []
+    for t in range(max_length):
+        step_tokens = np.zeros_like(tokens)
+        step_prev = np.zeros_like(tokens)
+        step_scores = np.zeros_like(scores)
+        for b in range(batch_size):
+            candidates = []
+            for k in range(1 if t == 0 else beam_size):
+                if t > 0 and tokens[b, k] == EOS_ID:
+                    candidates.append((-scores[b, k], k, EOS_ID))
+                    continue
+                log_probs = log_probs_fn(tokens[b, k])
+                for token in range(len(log_probs)):
+                    candidates.append(
+                        (-(scores[b, k] + log_probs[token]), k, token))
+            candidates.sort()
+            for k, (score, prev, token) in enumerate(candidates[:beam_size]):
+                step_tokens[b, k] = token
+                step_prev[b, k] = prev
+                step_scores[b, k] = -score
+        tokens, scores = step_tokens, step_scores
+        all_tokens.append(step_tokens)
+        all_prev.append(step_prev)
+        all_scores.append(step_scores)
+        if (tokens == EOS_ID).all():
+            break
+    return np.array(all_tokens), np.array(all_prev), np.array(all_scores)
+
+
+class TestBeamSearch(TestCase):
+    @given(
+        batch_size=st.integers(1, 4),
+        beam_size=st.integers(1, 4),
+        vocab_size=st.integers(4, 8),
+        max_length=st.integers(1, 6),
+    )
+    @settings(max_examples=20)
+    def test_beam_search_bigram(
+            self, batch_size, beam_size, vocab_size, max_length):
+        # The next token only depends on the previous one
+        transitions = np.log(np.random.dirichlet(
+            np.ones(vocab_size), size=vocab_size)).astype(np.float32)
+        workspace.FeedBlob("transitions", transitions)
+        workspace.FeedBlob(
+            "hidden_init",
+            np.arange(batch_size, dtype=np.float32).reshape(batch_size, 1))
+
+        step_net = core.Net("step_net")
+        step_net.Gather(["transitions", "tokens_t_prev"], "log_probs")
+        step_net.Copy("hidden_t_prev", "hidden_t")
+
+        net = core.Net("net")
+        net.BeamSearch(
+            ["hidden_init"],
+            ["tokens", "prev_index", "scores",
+             "final_tokens", "final_lengths", "final_scores"],
+            step_net=step_net.Proto(),
+            beam_size=beam_size,
+            max_length=max_length,
+            go_token_id=GO_ID,
+            eos_token_id=EOS_ID,
+            states_prev=["hidden_t_prev"],
+            states=["hidden_t"],
+        )
+        workspace.RunNetOnce(net)
+
+        tokens, prev_index, scores = _beam_search_ref(
+            lambda token: transitions[token],
+            batch_size, beam_size, max_length)
+        npt.assert_array_equal(workspace.FetchBlob("tokens"), tokens)
+        npt.assert_array_equal(workspace.FetchBlob("prev_index"), prev_index)
+        npt.assert_allclose(
+            workspace.FetchBlob("scores"), scores, rtol=1e-4, atol=1e-4)
+
+        final_tokens = workspace.FetchBlob("final_tokens")
+        final_lengths = workspace.FetchBlob("final_lengths")
+        num_steps = tokens.shape[0]
+        self.assertEqual(
+            final_tokens.shape, (batch_size, beam_size, num_steps))
+        for b in range(batch_size):
+            for k in range(beam_size):
+                beam = k
+                for t in reversed(range(num_steps)):
+                    self.assertEqual(final_tokens[b, k, t], tokens[t, b, beam])
+                    beam = prev_index[t, b, beam]
+                hypothesis = list(final_tokens[b, k])
+                self.assertEqual(
+                    final_lengths[b, k],
+                    hypothesis.index(EOS_ID) + 1
+                    if EOS_ID in hypothesis else num_steps)
+        npt.assert_allclose(
+            workspace.FetchBlob("final_scores"), scores[-1],
+            rtol=1e-4, atol=1e-4)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
@@ -33,7 +33,17 @@ class BlobsQueueDBTest(unittest.TestCase):
                 )
         self._test_create_blobs_queue_db(add_blobs)
 
-    def _test_create_blobs_queue_db(self, add_blobs_fun):
+    def test_create_blobs_queue_db_prefetch_depth(self):
+        def add_blobs(queue, num_samples):
+            blob = core.BlobReference("blob")
+            status = core.BlobReference("blob_status")
+            for i in range(num_samples):
+                self._add_blob_to_queue(
+                    queue, self._create_test_tensor_protos(i), blob, status
+                )
+        self._test_create_blobs_queue_db(add_blobs, prefetch_depth=3)
+
+    def _test_create_blobs_queue_db(self, add_blobs_fun, prefetch_depth=1):
         num_samples = 10000
         batch_size = 10
         init_net = core.Net('init_net')
@@ -50,7 +60,8 @@ class BlobsQueueDBTest(unittest.TestCase):
         add_blobs_fun(queue, num_samples)
 
         net.TensorProtosDBInput(
-            [reader], ['image', 'label'], batch_size=batch_size)
+            [reader], ['image', 'label'], batch_size=batch_size,
+            prefetch_depth=prefetch_depth)
         workspace.CreateNet(net)
 
         close_net = core.Net('close_net')
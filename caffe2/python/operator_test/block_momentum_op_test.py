@@ -0,0 +1,54 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+import unittest
+
+
+class TestBlockMomentumUpdate(hu.HypothesisTestCase):
+    @given(n=st.integers(1, 64), nesterov=st.booleans(), **hu.gcs)
+    def test_block_momentum_update(self, n, nesterov, gc, dc):
+        inputs = [np.random.rand(n).astype(np.float32)
+                  for _ in range(6 if nesterov else 5)]
+        scale = 0.5
+        block_lr = 0.9
+        block_momentum = 0.75
+
+        def block_momentum_update(param, snapshot, sum, glob, v, v_prev=None):
+            v_new = block_momentum * v + block_lr * (scale * sum - glob)
+            glob_new = glob + v_new
+            if nesterov:
+                glob_new = glob_new - block_momentum * (v_new - v_prev)
+            param_new = param + glob_new - snapshot
+            outputs = [param_new, glob_new, v_new]
+            if nesterov:
+                outputs.append(v_new)
+            return outputs
+
+        names = ["param", "snapshot", "sum", "global", "v", "v_prev"]
+        op = core.CreateOperator(
+            "BlockMomentumUpdate",
+            names[:len(inputs)],
+            ["param", "global", "v"] + (["v_prev"] if nesterov else []),
+            scale=scale,
+            block_learning_rate=block_lr,
+            block_momentum=block_momentum,
+            nesterov=int(nesterov),
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=inputs,
+            reference=block_momentum_update,
+        )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,98 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+import tempfile
+
+
+class BlockSparseFCTest(hu.HypothesisTestCase):
+    def _pruned(self, n, k, sparsity):
+        W = np.random.rand(n, k).astype(np.float32) - 0.5
+        W[np.random.rand(n, k) < sparsity] = 0
+        return W
+
+    @given(n=st.integers(1, 40),
+           m=st.integers(0, 10),
+           k=st.integers(1, 100),
+           block_size=st.sampled_from([4, 8, 16]),
+           sparsity=st.sampled_from([0, 0.5, 0.9, 1]),
+           num_threads=st.sampled_from([0, 1]),
+           **hu.gcs_cpu_only)
+    def test_block_sparse_fc(
+            self, n, m, k, block_size, sparsity, num_threads, gc, dc):
+        X = np.random.rand(m, k).astype(np.float32) - 0.5
+        W = self._pruned(n, k, sparsity)
+        b = np.random.rand(n).astype(np.float32) - 0.5
+        expected = np.dot(X, W.T) + b
+        workspace.FeedBlob('X', X)
+        workspace.FeedBlob('W', W)
+        workspace.FeedBlob('b', b)
+
+        # Dense weights converted by the operator, through the FC engine too
+        for op in [
+            core.CreateOperator(
+                'BlockSparseFC', ['X', 'W', 'b'], 'Y',
+                block_size=block_size, num_threads=num_threads),
+            core.CreateOperator(
+                'FC', ['X', 'W', 'b'], 'Y', engine='BLOCK_SPARSE',
+                block_size=block_size, num_threads=num_threads),
+        ]:
+            workspace.RunOperatorOnce(op)
+            np.testing.assert_allclose(
+                workspace.FetchBlob('Y'), expected, rtol=1e-4, atol=1e-4)
+
+        # Weights converted ahead, saved and loaded back
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'BlockSparseFromDense', ['W'], ['W_sparse'],
+            block_size=block_size))
+        with tempfile.NamedTemporaryFile() as tmp:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                'Save', ['W_sparse'], [],
+                absolute_path=1, db_type='minidb', db=tmp.name))
+            workspace.ResetWorkspace()
+            workspace.RunOperatorOnce(core.CreateOperator(
+                'Load', [], ['W_sparse'],
+                absolute_path=1, db_type='minidb', db=tmp.name))
+        workspace.FeedBlob('X', X)
+        workspace.FeedBlob('b', b)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'BlockSparseFC', ['X', 'W_sparse', 'b'], 'Y',
+            num_threads=num_threads))
+        np.testing.assert_allclose(
+            workspace.FetchBlob('Y'), expected, rtol=1e-4, atol=1e-4)
+
+    @given(n=st.integers(1, 40),
+           m=st.integers(1, 10),
+           k=st.integers(1, 100),
+           **hu.gcs_cpu_only)
+    def test_block_sparse_fc_weight_update(self, n, m, k, gc, dc):
+        X = np.random.rand(m, k).astype(np.float32) - 0.5
+        b = np.random.rand(n).astype(np.float32) - 0.5
+        op = core.CreateOperator(
+            'FC', ['X', 'W', 'b'], 'out', engine='BLOCK_SPARSE')
+        net = core.Net('fc_block_sparse')
+        net.Proto().op.extend([op])
+        workspace.FeedBlob('X', X)
+        workspace.FeedBlob('b', b)
+        # The converted weights must follow every update of W.
+        for i in range(3):
+            W = self._pruned(n, k, 0.9)
+            workspace.FeedBlob('W', W)
+            if i == 0:
+                workspace.CreateNet(net, overwrite=True)
+            workspace.RunNet(net.Name())
+            np.testing.assert_allclose(
+                workspace.FetchBlob('out'), np.dot(X, W.T) + b,
+                rtol=1e-4, atol=1e-4)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
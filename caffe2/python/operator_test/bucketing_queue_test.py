@@ -0,0 +1,98 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+from caffe2.python import core, workspace
+from caffe2.python.test_util import TestCase
+
+import numpy as np
+import numpy.testing as npt
+
+from hypothesis import given
+import hypothesis.strategies as st
+
+
+def _split(lengths, values):
+    offsets = np.cumsum([0] + list(lengths))
+    return [
+        values[offsets[i]:offsets[i + 1]] for i in range(len(lengths))
+    ]
+
+
+class TestBucketingQueue(TestCase):
+    def test_bucketing_queue_batches_by_length(self):
+        lengths = np.array([1, 9, 2, 8, 1, 10, 2, 9], dtype=np.int32)
+        values = np.arange(lengths.sum(), dtype=np.float32)
+        workspace.FeedBlob("lengths", lengths)
+        workspace.FeedBlob("values", values)
+
+        net = core.Net('net')
+        queue = net.CreateBucketingQueue(
+            [], 1, capacity=8, num_blobs=1, boundaries=[4])
+        net.EnqueueBucketingQueue([queue, "lengths", "values"], [])
+        results = [
+            net.DequeueBucketingQueue([queue], 2, batch_size=4)
+            for _ in range(2)
+        ]
+        workspace.RunNetOnce(net)
+
+        examples = _split(lengths, values)
+        for batch_lengths, batch_values in results:
+            batch_lengths = workspace.FetchBlob(batch_lengths)
+            batch_values = workspace.FetchBlob(batch_values)
+            # All the short or all the long examples, sorted by length
+            self.assertEqual(len(batch_lengths), 4)
+            self.assertTrue(
+                all(batch_lengths <= 4) or all(batch_lengths > 4))
+            self.assertEqual(list(batch_lengths), sorted(batch_lengths))
+            for length, example in zip(
+                    batch_lengths, _split(batch_lengths, batch_values)):
+                self.assertTrue(any(
+                    len(e) == length and np.array_equal(e, example)
+                    for e in examples))
+
+    @given(
+        lengths=st.lists(st.integers(0, 20), min_size=1, max_size=50),
+        batch_size=st.integers(1, 8),
+        max_padding=st.floats(0.0, 1.0),
+    )
+    def test_bucketing_queue_dequeues_everything(
+            self, lengths, batch_size, max_padding):
+        lengths = np.array(lengths, dtype=np.int32)
+        values = np.random.rand(lengths.sum(), 3).astype(np.float32)
+        workspace.FeedBlob("lengths", lengths)
+        workspace.FeedBlob("values", values)
+
+        init_net = core.Net('init_net')
+        queue = init_net.CreateBucketingQueue(
+            [], 1, capacity=len(lengths), num_blobs=1,
+            boundaries=[3, 10], max_padding=max_padding)
+        init_net.EnqueueBucketingQueue([queue, "lengths", "values"], [])
+        init_net.CloseBucketingQueue([queue], 0)
+        workspace.RunNetOnce(init_net)
+
+        net = core.Net('net')
+        net.DequeueBucketingQueue(
+            [queue], ["batch_lengths", "batch_values"], batch_size=batch_size)
+        workspace.CreateNet(net)
+
+        dequeued = []
+        while workspace.RunNet(net, allow_fail=True):
+            batch_lengths = workspace.FetchBlob("batch_lengths")
+            batch_values = workspace.FetchBlob("batch_values")
+            self.assertLessEqual(len(batch_lengths), batch_size)
+            self.assertEqual(batch_values.shape[0], batch_lengths.sum())
+            dequeued.extend(_split(batch_lengths, batch_values))
+
+        # Every example is dequeued once
+        self.assertEqual(len(dequeued), len(lengths))
+        expected = sorted(
+            _split(lengths, values), key=lambda e: (len(e), e.tobytes()))
+        dequeued.sort(key=lambda e: (len(e), e.tobytes()))
+        for e, d in zip(expected, dequeued):
+            npt.assert_array_equal(e, d)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
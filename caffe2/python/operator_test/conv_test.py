@@ -166,6 +166,111 @@ class TestConvolution(hu.HypothesisTestCase):
             atol=1e-4,
             rtol=1e-4)
 
+    @given(op_type=st.sampled_from(["Conv", "Conv2D"]),
+           pad_t=st.integers(0, 2),
+           pad_l=st.integers(0, 2),
+           pad_b=st.integers(0, 2),
+           pad_r=st.integers(0, 2),
+           size=st.integers(3, 17),
+           input_channels=st.integers(1, 8),
+           output_channels=st.integers(1, 8),
+           batch_size=st.integers(1, 3),
+           winograd_tile=st.sampled_from([0, 2, 4]),
+           num_threads=st.sampled_from([0, 1, 2]),
+           use_bias=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_winograd_convolution(self, op_type, pad_t, pad_l, pad_b, pad_r,
+                                  size, input_channels, output_channels,
+                                  batch_size, winograd_tile, num_threads,
+                                  use_bias, gc, dc):
+        X = np.random.rand(
+            batch_size, input_channels, size, size).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        ops = {}
+        for engine in ["", "WINOGRAD"]:
+            ops[engine] = core.CreateOperator(
+                op_type,
+                ["X", "w", "b"] if use_bias else ["X", "w"],
+                ["Y_" + engine],
+                kernel=3,
+                pad_t=pad_t,
+                pad_l=pad_l,
+                pad_b=pad_b,
+                pad_r=pad_r,
+                engine=engine,
+                winograd_tile=winograd_tile,
+                num_threads=num_threads,
+                device_option=gc,
+            )
+        self.ws.create_blob("X").feed(X, device_option=gc)
+        self.ws.create_blob("b").feed(b, device_option=gc)
+        # The second filter checks that cached filter transforms are updated
+        for _ in range(2):
+            w = np.random.rand(
+                output_channels, input_channels, 3, 3).astype(np.float32) - 0.5
+            self.ws.create_blob("w").feed(w, device_option=gc)
+            for op in ops.values():
+                self.ws.run(op)
+            np.testing.assert_allclose(
+                self.ws.blobs["Y_"].fetch(),
+                self.ws.blobs["Y_WINOGRAD"].fetch(),
+                atol=1e-4,
+                rtol=1e-4)
+
+    @given(kernel=st.sampled_from([3, 5]),
+           stride=st.integers(1, 2),
+           pad=st.integers(0, 2),
+           size=st.integers(5, 20),
+           channels=st.integers(1, 20),
+           batch_size=st.integers(1, 3),
+           order=st.sampled_from(["NCHW", "NHWC"]),
+           num_threads=st.sampled_from([0, 1, 2]),
+           use_bias=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_depthwise_convolution(self, kernel, stride, pad, size, channels,
+                                   batch_size, order, num_threads, use_bias,
+                                   gc, dc):
+        X = np.random.rand(
+            batch_size, channels, size, size).astype(np.float32) - 0.5
+        w = np.random.rand(
+            channels, 1, kernel, kernel).astype(np.float32) - 0.5
+        b = np.random.rand(channels).astype(np.float32) - 0.5
+        if use_bias:
+            Y = np.tile(b[None, :, None, None], (batch_size, 1, 1, 1))
+        else:
+            Y = 0
+        out_size = (size + 2 * pad - kernel) // stride + 1
+        Xpad = np.pad(X, ((0, 0), (0, 0), (pad, pad), (pad, pad)), "constant")
+        for kh in range(kernel):
+            for kw in range(kernel):
+                Y = Y + w[None, :, 0, kh, kw, None, None] * Xpad[
+                    :, :,
+                    kh:kh + stride * (out_size - 1) + 1:stride,
+                    kw:kw + stride * (out_size - 1) + 1:stride]
+        if order == "NHWC":
+            X = X.transpose((0, 2, 3, 1))
+            w = w.transpose((0, 2, 3, 1))
+            Y = Y.transpose((0, 2, 3, 1))
+
+        op = core.CreateOperator(
+            "Conv",
+            ["X", "w", "b"] if use_bias else ["X", "w"],
+            ["Y"],
+            kernel=kernel,
+            stride=stride,
+            pad=pad,
+            group=channels,
+            order=order,
+            num_threads=num_threads,
+            device_option=gc,
+        )
+        self.ws.create_blob("X").feed(X, device_option=gc)
+        self.ws.create_blob("w").feed(w, device_option=gc)
+        self.ws.create_blob("b").feed(b, device_option=gc)
+        self.ws.run(op)
+        np.testing.assert_allclose(
+            self.ws.blobs["Y"].fetch(), Y, atol=1e-4, rtol=1e-4)
+
     @given(op_type=st.sampled_from(["Conv", "Conv2D"]),
            stride=st.integers(1, 3),
            pad=st.integers(0, 3),
@@ -537,6 +537,56 @@ class TestDatasetOps(TestCase):
         actual_sizes = [d.shape[0] for d in trimmed.field_blobs()]
         self.assertEquals(EXPECTED_SIZES, actual_sizes)
 
+    def test_block_shuffle_random_reader(self):
+        schema = Struct(
+            ('id', Scalar(np.int64)),
+            ('values', List(Scalar(np.float32))),
+        )
+        num_rows, batch_size, block_size = 24, 2, 4
+        lengths = np.arange(num_rows, dtype=np.int32) % 3
+        contents = from_blob_list(schema, [
+            np.arange(num_rows, dtype=np.int64),
+            lengths,
+            np.repeat(np.arange(num_rows), lengths).astype(np.float32),
+        ])
+        ds = dataset.Dataset(schema, name='block_shuffled')
+        init_net = core.Net('init')
+        with core.NameScope('init'):
+            ds.init_empty(init_net)
+            content_blobs = NewRecord(init_net, contents)
+            FeedRecord(content_blobs, contents)
+            ds.writer(init_net=init_net).write_record(init_net, content_blobs)
+        workspace.RunNetOnce(init_net)
+
+        read_init_net = core.Net('read_init')
+        read_next_net = core.Net('read_next')
+        reader = ds.random_reader(
+            read_init_net, batch_size=batch_size, num_threads=2)
+        reader.sort_and_shuffle(
+            read_init_net, batch_size=batch_size, block_size=block_size)
+        reader.computeoffset(read_init_net)
+        should_stop, batch = reader.read_record(read_next_net)
+        workspace.RunNetOnce(read_init_net)
+        workspace.CreateNet(read_next_net, True)
+
+        indices = workspace.FetchBlob(reader.indices)
+        self.assertEqual(sorted(indices), list(range(num_rows)))
+        for i in range(0, num_rows, block_size):
+            # the blocks stay together
+            self.assertEqual(len(set(indices[i:i + block_size] // block_size)),
+                             1)
+
+        for i in range(0, num_rows, batch_size):
+            workspace.RunNet(str(read_next_net))
+            actual = FetchRecord(batch)
+            expected = indices[i:i + batch_size]
+            npt.assert_array_equal(actual.id(), expected)
+            npt.assert_array_equal(actual.values.lengths(), lengths[expected])
+            npt.assert_array_equal(
+                actual.values.items(), np.repeat(expected, lengths[expected]))
+        workspace.RunNet(str(read_next_net))
+        self.assertTrue(workspace.FetchBlob(should_stop))
+
     def test_last_n_window_ops(self):
         collect_net = core.Net('collect_net')
         collect_net.GivenTensorFill(
@@ -584,6 +634,28 @@ class TestDatasetOps(TestCase):
         npt.assert_array_equal(input_array[[2, 0, 1, 2, 2, 0, 1]],
                                reference_result)
 
+    def test_last_n_window_ops_concurrent_copies(self):
+        input_array =\
+            np.array(list(range(1, 7)), dtype=np.float32).reshape(3, 2)
+        workspace.FeedBlob('input', input_array)
+        workspace.CreateBlob('output')
+        workspace.FeedBlob('next', np.array(0, dtype=np.int32))
+        workspace.RunOperatorOnce(
+            core.CreateOperator('CreateMutex', [], ['mutex']))
+
+        collect_net = core.Net('collect_net')
+        collect_net.LastNWindowCollector(
+            ['output', 'next', 'input', 'mutex'],
+            ['output', 'next'],
+            num_to_collect=7,
+            concurrent_copies=True,
+        )
+        workspace.CreateNet(collect_net)
+        for _ in range(3):
+            workspace.RunNet(collect_net.Proto().name)
+        npt.assert_array_equal(input_array[[2, 0, 1, 2, 2, 0, 1]],
+                               workspace.FetchBlob('output'))
+
     def test_collect_tensor_ops(self):
         init_net = core.Net('init_net')
         blobs = ['blob_1', 'blob_2', 'blob_3']
@@ -515,6 +515,109 @@ class TestConvolution(hu.HypothesisTestCase):
         for i in range(len(inputs)):
             self.assertGradientChecks(gc, op, inputs, i, [0])
 
+    @given(stride=st.integers(1, 3),
+           pad=st.integers(0, 3),
+           kernel=st.integers(1, 5),
+           dilation=st.integers(1, 3),
+           size=st.integers(7, 10),
+           input_channels=st.integers(1, 8),
+           output_channels=st.integers(1, 8),
+           batch_size=st.integers(1, 3),
+           group=st.integers(1, 2),
+           use_bias=st.booleans(),
+           deformable_group=st.integers(1, 3),
+           num_threads=st.integers(0, 2),
+           **hu.gcs_cpu_only)
+    def test_cpu_null_offset_convolution(self, stride, pad, kernel, dilation,
+                                         size, input_channels, output_channels,
+                                         batch_size, group, use_bias,
+                                         deformable_group, num_threads, gc, dc):
+        dkernel = dilation * (kernel - 1) + 1
+        assume(size + pad + pad >= dkernel)
+        input_channels *= group * deformable_group
+        output_channels *= group * deformable_group
+
+        op = core.CreateOperator(
+            "DeformConv",
+            ["X", "o", "w", "b"] if use_bias else ["X", "o", "w"],
+            ["Y"],
+            stride=stride,
+            kernel=kernel,
+            dilation=dilation,
+            pad=pad,
+            group=group,
+            deformable_group=deformable_group,
+            num_threads=num_threads,
+        )
+        offset_dims = _conv_2d_offsets_dims(batch_size, size, kernel, pad, pad,
+                                            dilation, stride, stride,
+                                            deformable_group)
+        X = np.random.rand(
+            batch_size, input_channels, size, size).astype(np.float32) - 0.5
+        o = np.zeros(tuple(offset_dims), np.float32)
+        w = np.random.rand(
+            output_channels, input_channels // group, kernel, kernel
+        ).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        inputs = [X, o, w, b] if use_bias else [X, o, w]
+
+        def reference_conv_op(*args):
+            reference_op = core.CreateOperator(
+                "Conv",
+                ["X", "w", "b"] if use_bias else ["X", "w"],
+                ["Y0"],
+                stride=stride,
+                kernel=kernel,
+                dilation=dilation,
+                pad=pad,
+                group=group,
+                device_option=gc
+            )
+            workspace.RunOperatorOnce(reference_op)
+            reference_blob = workspace.FetchBlob("Y0")
+            return (reference_blob,)
+
+        self.assertReferenceChecks(gc, op, inputs, reference_conv_op)
+
+    @given(stride=st.integers(1, 2),
+           pad=st.integers(0, 2),
+           kernel=st.integers(2, 3),
+           size=st.integers(5, 7),
+           input_channels=st.integers(1, 3),
+           output_channels=st.integers(1, 3),
+           batch_size=st.integers(1, 2),
+           use_bias=st.booleans(),
+           deformable_group=st.integers(1, 2),
+           **hu.gcs_cpu_only)
+    def test_cpu_conv_gradients(self, stride, pad, kernel, size,
+                                input_channels, output_channels, batch_size,
+                                use_bias, deformable_group, gc, dc):
+        input_channels *= deformable_group
+        output_channels *= deformable_group
+        op = core.CreateOperator(
+            "DeformConv",
+            ["X", "o", "w", "b"] if use_bias else ["X", "o", "w"],
+            ["Y"],
+            stride=stride,
+            kernel=kernel,
+            pad=pad,
+            deformable_group=deformable_group,
+        )
+        X = np.random.rand(
+            batch_size, input_channels, size, size).astype(np.float32) - 0.5
+        output_size = _conv_2d_output_size(size, kernel, pad, pad,
+                                           1, stride, stride)
+        o = _conv_2d_random_offsets(batch_size, kernel, output_size,
+                                    deformable_group)
+        w = np.random.rand(
+            output_channels, input_channels, kernel, kernel
+        ).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        inputs = [X, o, w, b] if use_bias else [X, o, w]
+
+        for i in range(len(inputs)):
+            self.assertGradientChecks(gc, op, inputs, i, [0])
+
 
 if __name__ == "__main__":
     import unittest
@@ -298,6 +298,29 @@ class TestElementwiseBroadcast(hu.HypothesisTestCase):
             out, X + Y)
         self.assertDeviceChecks(dc, op, [X, Y], [0])
 
+    @given(**hu.gcs_cpu_only)
+    def test_broadcast_threaded(self, gc, dc):
+        # Large enough to be split across the threads
+        X = np.random.rand(8, 16, 32, 33).astype(np.float32)
+        Y = np.random.rand(16).astype(np.float32)
+        op = core.CreateOperator(
+            "Mul", ["X", "Y"], "out", broadcast=1, axis=1, num_threads=4)
+        workspace.FeedBlob("X", X)
+        workspace.FeedBlob("Y", Y)
+        workspace.RunOperatorOnce(op)
+        out = workspace.FetchBlob("out")
+        np.testing.assert_array_almost_equal(
+            out, X * Y[:, np.newaxis, np.newaxis])
+
+        # Comparisons broadcast the same way
+        Y = np.random.rand(32, 33).astype(np.float32)
+        op = core.CreateOperator(
+            "LT", ["X", "Y"], "out", broadcast=1, num_threads=4)
+        workspace.FeedBlob("Y", Y)
+        workspace.RunOperatorOnce(op)
+        out = workspace.FetchBlob("out")
+        np.testing.assert_array_equal(out, X < Y)
+
     @given(**hu.gcs)
     def test_semantic_broadcast(self, gc, dc):
         # NCHW as default
@@ -0,0 +1,57 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+
+class TestEmbeddingCacheOps(hu.HypothesisTestCase):
+
+    @given(op_name=st.sampled_from(["SparseLengthsSum",
+                                    "SparseLengthsWeightedSum",
+                                    "SparseLengthsMean"]),
+           block_size=st.sampled_from([1, 7, 16, 32]),
+           capacity=st.integers(min_value=0, max_value=60),
+           refresh_interval=st.integers(min_value=1, max_value=4),
+           seed=st.integers(min_value=0, max_value=1000))
+    def test_cached_sparse_lengths(self, op_name, block_size, capacity,
+                                   refresh_interval, seed):
+        np.random.seed(seed)
+        num_rows = 200
+        data = np.random.rand(num_rows, block_size).astype(np.float32)
+        workspace.FeedBlob("data", data)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "CreateEmbeddingCache", [], ["cache"],
+            capacity=capacity, refresh_interval=refresh_interval))
+
+        weighted = op_name == "SparseLengthsWeightedSum"
+        inputs = ["data", "weights", "indices", "lengths"] if weighted \
+            else ["data", "indices", "lengths"]
+        for _ in range(8):
+            lengths = np.random.randint(1, 10, size=20).astype(np.int32)
+            indices = np.minimum(
+                np.random.zipf(1.5, size=lengths.sum()) - 1,
+                num_rows - 1).astype(np.int64)
+            workspace.FeedBlob("lengths", lengths)
+            workspace.FeedBlob("indices", indices)
+            workspace.FeedBlob(
+                "weights", np.random.rand(len(indices)).astype(np.float32))
+            workspace.RunOperatorOnce(
+                core.CreateOperator(op_name, inputs, ["expected"]))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "Cached" + op_name, ["cache"] + inputs, ["actual"]))
+            np.testing.assert_allclose(
+                workspace.FetchBlob("actual"),
+                workspace.FetchBlob("expected"),
+                rtol=1e-5, atol=1e-5)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
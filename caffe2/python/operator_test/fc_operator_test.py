@@ -4,7 +4,7 @@ from __future__ import print_function
 from __future__ import unicode_literals
 
 from caffe2.proto import caffe2_pb2
-from caffe2.python import core
+from caffe2.python import core, workspace
 from hypothesis import assume, given, settings
 import caffe2.python.hypothesis_test_util as hu
 import hypothesis.strategies as st
@@ -14,7 +14,7 @@ import numpy as np
 class TestFcOperator(hu.HypothesisTestCase):
     def _run_test(self, n, m, k, transposed, multi_dim, dtype, engine, gc, dc):
         if dtype == np.float16:
-            # fp16 only supported with CUDA
+            # fp16 weights are only supported with CUDA
             assume(gc.device_type == caffe2_pb2.CUDA)
             dc = [d for d in dc if d.device_type == caffe2_pb2.CUDA]
 
@@ -81,7 +81,7 @@ class TestFcOperator(hu.HypothesisTestCase):
            k=st.integers(1, 5),
            multi_dim=st.sampled_from([True, False]),
            dtype=st.sampled_from([np.float32, np.float16]),
-           engine=st.sampled_from(['', 'TENSORCORE']),
+           engine=st.sampled_from(['', 'TENSORCORE', 'PACKED']),
            **hu.gcs)
     def test_fc(self, **kwargs):
         self._run_test(transposed=False, **kwargs)
@@ -92,11 +92,65 @@ class TestFcOperator(hu.HypothesisTestCase):
            k=st.integers(1, 5),
            multi_dim=st.sampled_from([True, False]),
            dtype=st.sampled_from([np.float32, np.float16]),
-           engine=st.sampled_from(['', 'TENSORCORE']),
+           engine=st.sampled_from(['', 'TENSORCORE', 'PACKED']),
            **hu.gcs)
     def test_fc_transposed(self, **kwargs):
         self._run_test(transposed=True, **kwargs)
 
+    @given(n=st.integers(1, 40),
+           m=st.integers(1, 10),
+           k=st.integers(1, 600),
+           transposed=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_fc_packed_weight_update(self, n, m, k, transposed, gc, dc):
+        X = np.random.rand(m, k).astype(np.float32) - 0.5
+        b = np.random.rand(n).astype(np.float32) - 0.5
+        op = core.CreateOperator(
+            'FCTransposed' if transposed else 'FC',
+            ['X', 'W', 'b'],
+            'out',
+            engine='PACKED',
+        )
+        net = core.Net('fc_packed')
+        net.Proto().op.extend([op])
+        workspace.FeedBlob('X', X)
+        workspace.FeedBlob('b', b)
+        # The packed weights must follow every update of W.
+        for i in range(3):
+            W = np.random.rand(n, k).astype(np.float32) - 0.5
+            workspace.FeedBlob('W', W.T.copy() if transposed else W)
+            if i == 0:
+                workspace.CreateNet(net, overwrite=True)
+            workspace.RunNet(net.Name())
+            np.testing.assert_allclose(
+                workspace.FetchBlob('out'), np.dot(X, W.T) + b,
+                rtol=1e-4, atol=1e-4)
+
+    @given(n=st.integers(1, 40),
+           m=st.integers(0, 10),
+           k=st.integers(1, 100),
+           transposed=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_fc_float16_activations(self, n, m, k, transposed, gc, dc):
+        # float16 X and Y, computed in float from float W and b
+        X = (np.random.rand(m, k) - 0.5).astype(np.float16)
+        W = np.random.rand(n, k).astype(np.float32) - 0.5
+        b = np.random.rand(n).astype(np.float32) - 0.5
+        op = core.CreateOperator(
+            'FCTransposed' if transposed else 'FC',
+            ['X', 'W', 'b'],
+            'out',
+        )
+        workspace.FeedBlob('X', X)
+        workspace.FeedBlob('W', W.T.copy() if transposed else W)
+        workspace.FeedBlob('b', b)
+        workspace.RunOperatorOnce(op)
+        out = workspace.FetchBlob('out')
+        self.assertEqual(out.dtype, np.float16)
+        np.testing.assert_allclose(
+            out, np.dot(X.astype(np.float32), W.T) + b,
+            rtol=1e-2, atol=1e-2)
+
 
 if __name__ == "__main__":
     import unittest
@@ -0,0 +1,179 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, workspace
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+import unittest
+
+
+class TestFusedElementwise(hu.HypothesisTestCase):
+    @given(n=st.integers(1, 5000),
+           scale=st.floats(-2, 2),
+           in_place=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_fused_elementwise(self, n, scale, in_place, gc, dc):
+        X = np.random.randn(n).astype(np.float32)
+        W = np.random.randn(n).astype(np.float32)
+
+        # (sigmoid(X * W * scale + X) - W)^2, and the sigmoid
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["X", "W"],
+            ["X" if in_place else "Y", "Z"],
+            ops=["Mul", "Scale", "Add", "Sigmoid", "Sub", "Sqr"],
+            lhs=[0, 2, 3, 4, 5, 6],
+            rhs=[1, -1, 0, -1, 1, -1],
+            scale=[1, scale, 1, 1, 1, 1],
+            outputs=[7, 5],
+        )
+
+        def ref(X, W):
+            S = 1. / (1. + np.exp(-(X * W * scale + X)))
+            return [(S - W) ** 2, S]
+
+        self.assertReferenceChecks(gc, op, [X, W], ref)
+
+    @given(n=st.integers(1, 3000), **hu.gcs_cpu_only)
+    def test_unary_ops(self, n, gc, dc):
+        X = np.random.rand(n).astype(np.float32) + 0.5
+        unary_ops = [
+            ("Relu", lambda x: np.maximum(x, 0)),
+            ("Tanh", np.tanh),
+            ("Exp", np.exp),
+            ("Log", np.log),
+            ("Sqrt", np.sqrt),
+            ("Abs", np.abs),
+            ("Negative", np.negative),
+            ("Copy", lambda x: x),
+        ]
+        for op_type, fn in unary_ops:
+            op = core.CreateOperator(
+                "FusedElementwise",
+                ["X"],
+                ["Y"],
+                ops=[op_type],
+                lhs=[0],
+                rhs=[-1],
+                outputs=[1],
+            )
+            self.assertReferenceChecks(gc, op, [X], lambda X: [fn(X)])
+
+    @given(n=st.integers(1, 3000),
+           eps=st.floats(1e-6, 0.1),
+           **hu.gcs_cpu_only)
+    def test_clip_and_logit(self, n, eps, gc, dc):
+        X = np.random.randn(n).astype(np.float32)
+
+        # logit(clip(sigmoid(X), 0.2, 0.9)) clamped to [eps, 1 - eps], and
+        # the clipped value
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["X"],
+            ["Y", "Z"],
+            ops=["Sigmoid", "Clip", "Logit"],
+            lhs=[0, 1, 2],
+            rhs=[-1, -1, -1],
+            min=[0, 0.2, eps],
+            max=[0, 0.9, 1 - eps],
+            outputs=[3, 2],
+        )
+
+        def ref(X):
+            C = np.clip(1. / (1. + np.exp(-X)), 0.2, 0.9)
+            P = np.clip(C, eps, 1 - eps)
+            return [np.log(P / (1 - P)), C]
+
+        self.assertReferenceChecks(gc, op, [X], ref)
+
+    @given(n=st.integers(1, 5000), **hu.gcs_cpu_only)
+    def test_float16_storage(self, n, gc, dc):
+        X = np.random.randn(n).astype(np.float16)
+        W = np.random.randn(n).astype(np.float32)
+
+        # float16 relu(X) * W in place of X, and float sigmoid(X)
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["X", "W"],
+            ["X", "S"],
+            ops=["Relu", "Mul", "Sigmoid"],
+            lhs=[0, 2, 0],
+            rhs=[-1, 1, -1],
+            outputs=[3, 4],
+            float16_outputs=[1, 0],
+        )
+        workspace.FeedBlob("X", X)
+        workspace.FeedBlob("W", W)
+        workspace.RunOperatorOnce(op)
+        Y = workspace.FetchBlob("X")
+        S = workspace.FetchBlob("S")
+        self.assertEqual(Y.dtype, np.float16)
+        self.assertEqual(S.dtype, np.float32)
+        X = X.astype(np.float32)
+        np.testing.assert_allclose(
+            Y, (np.maximum(X, 0) * W).astype(np.float16), rtol=1e-3)
+        np.testing.assert_allclose(
+            S, 1. / (1. + np.exp(-X)), rtol=1e-5, atol=1e-6)
+
+    @given(n=st.integers(2, 3000), **hu.gcs_cpu_only)
+    def test_scalar_broadcast(self, n, gc, dc):
+        X = np.random.randn(n).astype(np.float32)
+        S = np.random.randn(1).astype(np.float32)
+        T = np.random.randn(1).astype(np.float32)
+
+        # (X * S + S * T), and S * T computed once as a scalar output
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["X", "S", "T"],
+            ["Y", "P"],
+            ops=["Mul", "Mul", "Add"],
+            lhs=[0, 1, 3],
+            rhs=[1, 2, 4],
+            outputs=[5, 4],
+            broadcast=1,
+        )
+
+        def ref(X, S, T):
+            return [X * S + S * T, S * T]
+
+        self.assertReferenceChecks(gc, op, [X, S, T], ref)
+
+    def test_broadcast_needs_full_first_operand(self):
+        workspace.FeedBlob("X", np.zeros(4, dtype=np.float32))
+        workspace.FeedBlob("S", np.zeros(1, dtype=np.float32))
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["S", "X"],
+            ["Y"],
+            ops=["Sub"],
+            lhs=[0],
+            rhs=[1],
+            outputs=[2],
+            broadcast=1,
+        )
+        with self.assertRaises(RuntimeError):
+            workspace.RunOperatorOnce(op)
+
+    def test_input_sizes_must_match(self):
+        workspace.FeedBlob("X", np.zeros(4, dtype=np.float32))
+        workspace.FeedBlob("W", np.zeros(5, dtype=np.float32))
+        op = core.CreateOperator(
+            "FusedElementwise",
+            ["X", "W"],
+            ["Y"],
+            ops=["Add"],
+            lhs=[0],
+            rhs=[1],
+            outputs=[2],
+        )
+        with self.assertRaises(RuntimeError):
+            workspace.RunOperatorOnce(op)
+
+
+if __name__ == "__main__":
+    unittest.main()
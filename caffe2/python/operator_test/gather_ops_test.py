@@ -71,6 +71,23 @@ class TestBatchGatherOps(hu.HypothesisTestCase):
         self.assertReferenceChecks(gc, op, [data, ind], ref_batch_gather)
         self.assertGradientChecks(gc, op, [data, ind], 0, [0])
 
+    @given(inputs=_inputs(),
+           num_threads=st.sampled_from([0, 2]),
+           **hu.gcs_cpu_only)
+    def test_batch_gather_ops_multithreaded(
+            self, inputs, num_threads, gc, dc):
+        data, ind = inputs
+        op = core.CreateOperator(
+            'BatchGather',
+            ['data', 'ind'],
+            ['output'],
+            num_threads=num_threads)
+
+        def ref_batch_gather(data, ind):
+            return [np.stack([data[b][ind] for b in range(data.shape[0])])]
+
+        self.assertReferenceChecks(gc, op, [data, ind], ref_batch_gather)
+
 
 class TestGatherFused8BitRowwise(hu.HypothesisTestCase):
     @given(rows_num=st.integers(1, 10000),
@@ -102,6 +119,45 @@ class TestGatherFused8BitRowwise(hu.HypothesisTestCase):
         gather_quantized = workspace.FetchBlob('gather_quantized')
         np.testing.assert_array_almost_equal(gather_reference, gather_quantized)
 
+    @given(rows_num=st.integers(1, 1000),
+           cols_num=st.integers(1, 128),
+           index_num=st.integers(0, 5000),
+           num_threads=st.sampled_from([1, 0, 2]),
+           **hu.gcs_cpu_only)
+    def test_gather_fused_8bit_rowwise_options(
+            self, rows_num, cols_num, index_num, num_threads, gc, dc):
+        data = np.random.random((rows_num, cols_num)).astype(np.float32)
+        ind = np.random.randint(rows_num, size=(index_num, )).astype('int64')
+
+        net = core.Net("bench")
+
+        quantized_data = net.FloatToFused8BitRowwiseQuantized(
+            'data', 'quantized_data')
+        dequantized_data = net.Fused8BitRowwiseQuantizedToFloat(
+            quantized_data, 'dequantized_data')
+
+        net.Gather([dequantized_data, 'ind'], 'gather_reference')
+        net.Gather([quantized_data, 'ind'], 'gather_fused_reference')
+        net.GatherFused8BitRowwise(
+            [quantized_data, 'ind'], 'gather_quantized',
+            num_threads=num_threads, min_indices_per_thread=64)
+        net.GatherFused8BitRowwise(
+            [quantized_data, 'ind'], 'gather_fused',
+            dequantize=False, num_threads=num_threads,
+            min_indices_per_thread=64)
+
+        workspace.FeedBlob('data', data)
+        workspace.FeedBlob('ind', ind)
+        workspace.CreateNet(net)
+        workspace.RunNetOnce(net)
+
+        np.testing.assert_array_almost_equal(
+            workspace.FetchBlob('gather_reference'),
+            workspace.FetchBlob('gather_quantized'))
+        np.testing.assert_array_equal(
+            workspace.FetchBlob('gather_fused_reference'),
+            workspace.FetchBlob('gather_fused'))
+
 
 
 if __name__ == "__main__":
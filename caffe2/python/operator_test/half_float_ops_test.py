@@ -0,0 +1,39 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from hypothesis import given
+import numpy as np
+
+from caffe2.python import core
+import caffe2.python.hypothesis_test_util as hu
+
+
+class TestHalfFloatOps(hu.HypothesisTestCase):
+
+    @given(X=hu.tensor(), **hu.gcs)
+    def test_float_to_half(self, X, gc, dc):
+        op = core.CreateOperator("FloatToHalf", ["X"], ["Y"])
+        self.assertReferenceChecks(
+            gc, op, [X], lambda X: (X.astype(np.float16),))
+
+    @given(X=hu.tensor(), **hu.gcs)
+    def test_half_to_float(self, X, gc, dc):
+        X = X.astype(np.float16)
+        op = core.CreateOperator("HalfToFloat", ["X"], ["Y"])
+        self.assertReferenceChecks(
+            gc, op, [X], lambda X: (X.astype(np.float32),))
+
+    def test_float16_constant_fill(self):
+        op = core.CreateOperator(
+            "Float16ConstantFill", [], ["Y"], value=1.5, shape=[3, 4])
+        self.ws.run(op)
+        Y = self.ws.blobs["Y"].fetch()
+        self.assertEqual(Y.dtype, np.float16)
+        np.testing.assert_array_equal(Y, np.full((3, 4), 1.5, np.float16))
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
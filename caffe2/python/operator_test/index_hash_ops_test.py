@@ -61,3 +61,16 @@ class TestIndexHashOps(hu.HypothesisTestCase):
 
             self.assertEqual(shapes["values_output"], [2, 32])
             self.assertEqual(types["values_output"], core.DataType.INT32)
+
+    def test_index_hash_ops_large(self):
+        # Hashed by ranges in parallel, with the same result as one range
+        indices = np.random.randint(
+            -2 ** 62, 2 ** 62, size=300000, dtype=np.int64)
+        workspace.FeedBlob('indices', indices)
+        for num_threads in [0, 1]:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "IndexHash", ["indices"], ["hashed_%d" % num_threads],
+                seed=3, modulo=1000003, num_threads=num_threads))
+        hashed = workspace.FetchBlob('hashed_0')
+        np.testing.assert_array_equal(hashed, workspace.FetchBlob('hashed_1'))
+        self.assertTrue(np.all((hashed >= 0) & (hashed < 1000003)))
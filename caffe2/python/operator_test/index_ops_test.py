@@ -132,6 +132,30 @@ class TestIndexOps(TestCase):
     def test_long_index_ops(self):
         self._test_index_ops(list(range(8)), np.int64, 'LongIndexCreate')
 
+    def test_concurrent_index_get(self):
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'LongIndexCreate', [], ['index']))
+        # Enough keys for the index to grow while the gets run
+        keys = np.random.permutation(10000).astype(np.int64)
+        workspace.FeedBlob('keys', keys)
+        net = core.Net('concurrent_index_get')
+        net.Proto().type = 'dag'
+        net.Proto().num_workers = 8
+        for i in range(8):
+            net.IndexGet(['index', 'keys'], ['result_%d' % i])
+        workspace.RunNetOnce(net)
+        result = workspace.FetchBlob('result_0')
+        for i in range(1, 8):
+            np.testing.assert_array_equal(
+                result, workspace.FetchBlob('result_%d' % i))
+        np.testing.assert_array_equal(
+            np.arange(1, 10001), np.sort(result))
+
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'IndexStore', ['index'], ['stored']))
+        np.testing.assert_array_equal(
+            keys, workspace.FetchBlob('stored')[result - 1])
+
 if __name__ == "__main__":
     import unittest
     unittest.main()
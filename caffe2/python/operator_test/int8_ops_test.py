@@ -0,0 +1,186 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, int8_calibration, int8_conversion, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+
+
+class Int8OpsTest(hu.HypothesisTestCase):
+    def _run_int8(self, float_op, int8_op_type, inputs, **kwargs):
+        '''
+        Runs float_op on inputs, calibrates its output, then runs the int8
+        version of the op and returns the float output, the dequantized int8
+        output and the scale of the output.
+        '''
+        for name, value in zip(['X', 'W', 'b'], inputs):
+            workspace.FeedBlob(name, value)
+        calibration = core.Net('calibration')
+        calibration.Proto().op.extend([float_op])
+        ranges = int8_calibration.add_range_recorders(calibration, ['Y'])
+        workspace.RunNetOnce(calibration)
+        Y_scale, Y_zero_point = int8_calibration.quantization_params(
+            ranges[0])
+
+        net = core.Net('int8')
+        net.Int8Quantize(['X'], ['Xq'])
+        net.Int8Quantize(['W'], ['Wq'], signed=1, per_channel=1)
+        getattr(net, int8_op_type)(
+            ['Xq', 'Wq', 'b'], ['Yq'],
+            Y_scale=Y_scale, Y_zero_point=Y_zero_point, **kwargs)
+        net.Int8Dequantize(['Yq'], ['Y_int8'])
+        workspace.RunNetOnce(net)
+        return (
+            workspace.FetchBlob('Y'), workspace.FetchBlob('Y_int8'), Y_scale)
+
+    @given(n=st.integers(1, 3),
+           m=st.integers(1, 40),
+           k=st.integers(1, 40),
+           **hu.gcs_cpu_only)
+    def test_quantize_dequantize(self, n, m, k, gc, dc):
+        X = np.random.rand(n, m, k).astype(np.float32) * 4 - 1
+        op = core.CreateOperator('Int8Quantize', ['X'], ['Xq'])
+        dequantize = core.CreateOperator('Int8Dequantize', ['Xq'], ['Y'])
+        workspace.FeedBlob('X', X)
+        workspace.RunOperatorOnce(op)
+        workspace.RunOperatorOnce(dequantize)
+        # Half a step of the range [-1, 3] rounded to 255 levels
+        np.testing.assert_allclose(
+            workspace.FetchBlob('Y'), X, atol=4.0 / 255 / 2 + 1e-6)
+
+        # Per channel scales along the first dimension
+        op = core.CreateOperator(
+            'Int8Quantize', ['X'], ['Xq'], signed=1, per_channel=1)
+        workspace.RunOperatorOnce(op)
+        workspace.RunOperatorOnce(dequantize)
+        step = np.abs(X).reshape(n, -1).max(axis=1) / 127
+        np.testing.assert_allclose(
+            workspace.FetchBlob('Y'), X,
+            atol=float(step.max()) / 2 + 1e-6)
+
+    @given(batch_size=st.integers(1, 20),
+           input_channels=st.integers(1, 64),
+           output_channels=st.integers(1, 48),
+           **hu.gcs_cpu_only)
+    def test_int8_fc(self, batch_size, input_channels, output_channels,
+                     gc, dc):
+        X = np.random.rand(batch_size, input_channels).astype(np.float32)
+        W = np.random.rand(
+            output_channels, input_channels).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        op = core.CreateOperator('FC', ['X', 'W', 'b'], ['Y'])
+        Y, Y_int8, Y_scale = self._run_int8(op, 'Int8FC', [X, W, b])
+        # The rounding of the output, plus the rounding of X and W that adds
+        # up over the input channels
+        np.testing.assert_allclose(
+            Y_int8, Y, atol=Y_scale + 0.01 * np.sqrt(input_channels))
+
+    @given(stride=st.integers(1, 2),
+           pad=st.integers(0, 1),
+           kernel=st.sampled_from([1, 3]),
+           size=st.integers(5, 9),
+           input_channels=st.integers(1, 8),
+           output_channels=st.integers(1, 20),
+           batch_size=st.integers(1, 3),
+           **hu.gcs_cpu_only)
+    def test_int8_conv(self, stride, pad, kernel, size, input_channels,
+                       output_channels, batch_size, gc, dc):
+        X = np.random.rand(
+            batch_size, size, size, input_channels).astype(np.float32)
+        W = np.random.rand(
+            output_channels, kernel, kernel, input_channels
+        ).astype(np.float32) - 0.5
+        b = np.random.rand(output_channels).astype(np.float32) - 0.5
+        args = dict(stride=stride, pad=pad, kernel=kernel, order='NHWC')
+        op = core.CreateOperator('Conv', ['X', 'W', 'b'], ['Y'], **args)
+        Y, Y_int8, Y_scale = self._run_int8(op, 'Int8Conv', [X, W, b], **args)
+        np.testing.assert_allclose(
+            Y_int8, Y,
+            atol=Y_scale + 0.01 * np.sqrt(kernel * kernel * input_channels))
+
+    @given(stride=st.integers(1, 2),
+           pad=st.integers(0, 2),
+           kernel=st.sampled_from([3, 5]),
+           size=st.integers(5, 9),
+           channels=st.integers(1, 20),
+           batch_size=st.integers(1, 3),
+           **hu.gcs_cpu_only)
+    def test_int8_depthwise_conv(self, stride, pad, kernel, size, channels,
+                                 batch_size, gc, dc):
+        X = np.random.rand(
+            batch_size, size, size, channels).astype(np.float32)
+        W = np.random.rand(
+            channels, kernel, kernel, 1).astype(np.float32) - 0.5
+        b = np.random.rand(channels).astype(np.float32) - 0.5
+        args = dict(stride=stride, pad=pad, kernel=kernel, order='NHWC',
+                    group=channels)
+        op = core.CreateOperator('Conv', ['X', 'W', 'b'], ['Y'], **args)
+        Y, Y_int8, Y_scale = self._run_int8(op, 'Int8Conv', [X, W, b], **args)
+        np.testing.assert_allclose(
+            Y_int8, Y, atol=Y_scale + 0.01 * kernel)
+
+    def test_convert_to_int8(self):
+        init_net = core.Net('init')
+        init_net.GivenTensorFill(
+            [], 'conv_w', shape=[8, 3, 3, 4],
+            values=np.random.rand(8 * 3 * 3 * 4) - 0.5)
+        init_net.GivenTensorFill(
+            [], 'conv_b', shape=[8], values=np.random.rand(8) - 0.5)
+        init_net.GivenTensorFill(
+            [], 'dw_w', shape=[8, 3, 3, 1],
+            values=np.random.rand(8 * 3 * 3) - 0.5)
+        init_net.GivenTensorFill(
+            [], 'dw_b', shape=[8], values=np.random.rand(8) - 0.5)
+        init_net.GivenTensorFill(
+            [], 'fc_w', shape=[10, 8 * 6 * 6],
+            values=np.random.rand(10 * 8 * 6 * 6) - 0.5)
+        init_net.GivenTensorFill(
+            [], 'fc_b', shape=[10], values=np.random.rand(10) - 0.5)
+        net = core.Net('predict')
+        net.Conv(['data', 'conv_w', 'conv_b'], 'conv',
+                 kernel=3, pad=1, order='NHWC')
+        net.Relu('conv', 'conv')
+        net.Conv(['conv', 'dw_w', 'dw_b'], 'dw',
+                 kernel=3, pad=1, group=8, order='NHWC')
+        net.Relu('dw', 'relu')
+        net.FC(['relu', 'fc_w', 'fc_b'], 'fc')
+        net.Softmax('fc', 'prob')
+        net.Proto().external_input.append('data')
+        net.Proto().external_output.append('prob')
+
+        batches = [
+            {'data': np.random.rand(2, 6, 6, 4).astype(np.float32)}
+            for _ in range(4)
+        ]
+        ranges = int8_conversion.calibrate(
+            net.Proto(), init_net.Proto(), batches)
+        int8_net, int8_init_net = int8_conversion.convert_to_int8(
+            net.Proto(), init_net.Proto(), ranges)
+        # The Relus are folded, and FC reads the int8 output of the
+        # depthwise Conv, so that only the input is quantized and only the
+        # input of Softmax is dequantized
+        self.assertEqual(
+            [op.type for op in int8_net.op],
+            ['Int8Quantize', 'Int8Conv', 'Int8Conv', 'Int8FC',
+             'Int8Dequantize', 'Softmax'])
+
+        workspace.FeedBlob('data', batches[0]['data'])
+        workspace.RunNetOnce(init_net)
+        workspace.RunNetOnce(net)
+        expected = workspace.FetchBlob('fc')
+        workspace.RunNetOnce(int8_init_net)
+        workspace.RunNetOnce(int8_net)
+        # A few steps of the quantization of the output of FC
+        np.testing.assert_allclose(
+            workspace.FetchBlob('fc'), expected,
+            atol=0.05 * np.abs(expected).max())
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
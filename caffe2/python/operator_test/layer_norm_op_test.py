@@ -5,6 +5,7 @@ from __future__ import unicode_literals
 
 from caffe2.python import brew, core
 from hypothesis import given
+import hypothesis.strategies as st
 import caffe2.python.hypothesis_test_util as hu
 import numpy as np
 
@@ -124,6 +125,47 @@ class TestLayerNormOp(hu.HypothesisTestCase):
             outputs_to_check=[0, 1, 2],
         )
 
+    @given(N=st.sampled_from([1, 5, 64]),
+           D=st.sampled_from([1, 7, 64, 1000]),
+           num_threads=st.sampled_from([0, 1]),
+           **hu.gcs)
+    def test_layer_norm_affine(self, N, D, num_threads, gc, dc):
+        X = (np.random.randn(N, D) * 3 + 100).astype(np.float32)
+        gamma = np.random.randn(D).astype(np.float32)
+        beta = np.random.randn(D).astype(np.float32)
+        epsilon = 1e-4
+        op = core.CreateOperator(
+            "LayerNorm",
+            ["X", "gamma", "beta"],
+            ["Y", "mean", "stdev"],
+            epsilon=epsilon,
+            num_threads=num_threads,
+        )
+
+        def layer_norm_affine_ref(X, gamma, beta):
+            mean = np.mean(X, axis=1, keepdims=True)
+            stdev = np.sqrt(np.var(X, axis=1, keepdims=True) + epsilon)
+            return [(X - mean) / stdev * gamma + beta, mean, stdev]
+
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=[X, gamma, beta],
+            reference=layer_norm_affine_ref,
+        )
+        self.assertDeviceChecks(
+            device_options=dc,
+            op=op,
+            inputs=[X, gamma, beta],
+            outputs_to_check=[0, 1, 2],
+        )
+        if D > 1:
+            X = X - 100
+            for i in range(3):
+                self.assertGradientChecks(
+                    gc, op, [X, gamma, beta], i, [0],
+                    stepsize=1e-2, threshold=1e-2)
+
     @given(X=hu.tensors(n=1), **hu.gcs)
     def test_layer_norm_brew_wrapper(self, X, gc, dc):
         X = X[0]
@@ -0,0 +1,78 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+from caffe2.python.rnn.rnn_cell_test_util import sigmoid, tanh
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+
+def lstm_layer_reference(input, hidden_init, cell_init, i2h_w, i2h_b,
+                         gates_w, gates_b, seq_lengths, forget_bias,
+                         drop_states):
+    T, N, _ = input.shape
+    D = gates_w.shape[1]
+    hidden = hidden_init.reshape(N, D)
+    cell = cell_init.reshape(N, D)
+    hidden_all = np.zeros((T, N, D), dtype=np.float32)
+    cell_all = np.zeros((T, N, D), dtype=np.float32)
+    for t in range(T):
+        gates = (np.dot(input[t], i2h_w.T) + i2h_b +
+                 np.dot(hidden, gates_w.T) + gates_b)
+        i, f, o, g = np.split(gates, 4, axis=1)
+        new_cell = sigmoid(f + forget_bias) * cell + sigmoid(i) * tanh(g)
+        new_hidden = sigmoid(o) * tanh(new_cell)
+        valid = (t < seq_lengths).reshape(N, 1)
+        keep = 0 if drop_states else 1
+        hidden = np.where(valid, new_hidden, keep * hidden)
+        cell = np.where(valid, new_cell, keep * cell)
+        hidden_all[t] = hidden
+        cell_all[t] = cell
+    return (hidden_all, hidden.reshape(1, N, D),
+            cell_all, cell.reshape(1, N, D))
+
+
+class TestLSTMLayerOp(hu.HypothesisTestCase):
+
+    @given(T=st.integers(0, 5), N=st.integers(1, 4),
+           input_dim=st.integers(1, 6), D=st.integers(1, 8),
+           forget_bias=st.floats(0, 1), drop_states=st.booleans(),
+           **hu.gcs_cpu_only)
+    def test_lstm_layer(self, T, N, input_dim, D, forget_bias, drop_states,
+                        gc, dc):
+        def rand(*shape):
+            return np.random.randn(*shape).astype(np.float32)
+
+        inputs = [
+            rand(T, N, input_dim),
+            rand(1, N, D),
+            rand(1, N, D),
+            rand(4 * D, input_dim),
+            rand(4 * D),
+            rand(4 * D, D),
+            rand(4 * D),
+            np.random.randint(0, T + 1, size=N).astype(np.int32),
+        ]
+        op = core.CreateOperator(
+            'LSTMLayer',
+            ['input', 'hidden_init', 'cell_init', 'i2h_w', 'i2h_b',
+             'gates_t_w', 'gates_t_b', 'seq_lengths'],
+            ['hidden_all', 'hidden_last', 'cell_all', 'cell_last'],
+            forget_bias=forget_bias,
+            drop_states=drop_states,
+        )
+
+        def reference(*args):
+            return lstm_layer_reference(
+                *args, forget_bias=forget_bias, drop_states=drop_states)
+
+        self.assertReferenceChecks(gc, op, inputs, reference, threshold=1e-3)
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
@@ -4,6 +4,7 @@ from __future__ import print_function
 from __future__ import unicode_literals
 
 import inspect
+import unittest
 
 import numpy as np
 
@@ -11,7 +12,7 @@ from hypothesis import assume, given, settings
 import hypothesis.strategies as st
 
 from caffe2.proto import caffe2_pb2
-from caffe2.python import core
+from caffe2.python import core, workspace
 import caffe2.python.hypothesis_test_util as hu
 
 
@@ -51,6 +52,42 @@ class TestMatMul(hu.HypothesisTestCase):
         # Gradient check wrt Y
         self.assertGradientChecks(gc, op, [X, Y], 1, [0])
 
+    @unittest.skipIf(not workspace.has_gpu_support, "No gpu support")
+    @settings(max_examples=10)
+    @given(
+        M=st.integers(min_value=1, max_value=4),
+        K=st.integers(min_value=1, max_value=4),
+        N=st.integers(min_value=1, max_value=4),
+        trans_a=st.booleans(),
+        trans_b=st.booleans(),
+        engine=st.sampled_from(['', 'TENSORCORE']),
+        **hu.gcs_gpu_only
+    )
+    def test_matmul_fp16(self, M, K, N, trans_a, trans_b, engine, gc, dc):
+        # multiples of 8 let the tensor cores be used
+        M, K, N = 8 * M, 8 * K, 8 * N
+        X = np.random.rand(M, K).astype(np.float16) - 0.5
+        if trans_a:
+            X = X.transpose()
+
+        Y = np.random.rand(K, N).astype(np.float16) - 0.5
+        if trans_b:
+            Y = Y.transpose()
+
+        op = core.CreateOperator(
+            'MatMul', ['X', 'Y'], 'out', trans_a=trans_a, trans_b=trans_b,
+            engine=engine
+        )
+
+        def matmul_ref(X, Y, trans_a, trans_b):
+            XX = (X.transpose() if trans_a else X).astype(np.float32)
+            YY = (Y.transpose() if trans_b else Y).astype(np.float32)
+            return (XX.dot(YY).astype(np.float16), )
+
+        self.assertReferenceChecks(
+            gc, op, [X, Y, trans_a, trans_b], matmul_ref, threshold=0.05
+        )
+
     @given(
         M=st.integers(min_value=1, max_value=10),
         K=st.integers(min_value=1, max_value=10),
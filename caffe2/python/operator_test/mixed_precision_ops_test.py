@@ -0,0 +1,211 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+from hypothesis import given
+import hypothesis.strategies as st
+import numpy as np
+import unittest
+
+
+# The loss scale and the check of the gradients live on the CPU
+_cpu_inputs = {
+    'loss_scale': hu.cpu_do,
+    'all_finite': hu.cpu_do,
+    'iter': hu.cpu_do,
+}
+
+
+def _scaled_grad(n, loss_scale, dtype):
+    # Gradients exactly representable once scaled
+    grad = (np.random.randn(n) * loss_scale).astype(dtype)
+    return grad, grad.astype(np.float32) / loss_scale
+
+
+class TestMixedPrecisionOps(hu.HypothesisTestCase):
+    @given(sizes=st.lists(st.integers(1, 1 << 17), min_size=1, max_size=4),
+           bad=st.sampled_from([None, np.inf, -np.inf, np.nan]),
+           num_threads=st.sampled_from([0, 1, 2]),
+           **hu.gcs)
+    def test_all_finite(self, sizes, bad, num_threads, gc, dc):
+        inputs = [
+            np.random.randn(n).astype(np.float16 if i % 2 else np.float32)
+            for i, n in enumerate(sizes)
+        ]
+        if bad is not None:
+            x = inputs[np.random.randint(len(inputs))]
+            x[np.random.randint(x.size)] = bad
+        names = ["X_{}".format(i) for i in range(len(inputs))]
+        for name, x in zip(names, inputs):
+            workspace.FeedBlob(name, x, device_option=gc)
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "AllFinite", names, ["all_finite"],
+            num_threads=num_threads, device_option=gc))
+        self.assertEqual(
+            bool(workspace.FetchBlob("all_finite")[0]), bad is None)
+
+    @given(overflows=st.lists(st.booleans(), min_size=1, max_size=40),
+           growth_interval=st.integers(1, 4),
+           **hu.gcs_cpu_only)
+    def test_update_loss_scale(self, overflows, growth_interval, gc, dc):
+        growth_factor, backoff_factor = 2.0, 0.5
+        min_loss_scale, max_loss_scale = 1.0, 2.0 ** 12
+        workspace.FeedBlob("loss_scale", np.array([2. ** 8], np.float32))
+        workspace.FeedBlob("good_steps", np.array([0], np.int64))
+        op = core.CreateOperator(
+            "UpdateLossScale",
+            ["loss_scale", "good_steps", "all_finite"],
+            ["loss_scale", "good_steps"],
+            growth_factor=growth_factor,
+            backoff_factor=backoff_factor,
+            growth_interval=growth_interval,
+            min_loss_scale=min_loss_scale,
+            max_loss_scale=max_loss_scale)
+
+        loss_scale, good_steps = 2. ** 8, 0
+        for overflow in overflows:
+            workspace.FeedBlob("all_finite", np.array([not overflow]))
+            workspace.RunOperatorOnce(op)
+            if overflow:
+                loss_scale = max(loss_scale * backoff_factor, min_loss_scale)
+                good_steps = 0
+            else:
+                good_steps += 1
+                if good_steps == growth_interval:
+                    loss_scale = min(
+                        loss_scale * growth_factor, max_loss_scale)
+                    good_steps = 0
+            self.assertEqual(workspace.FetchBlob("loss_scale")[0], loss_scale)
+            self.assertEqual(workspace.FetchBlob("good_steps")[0], good_steps)
+
+    @given(n=st.integers(1, 64),
+           nesterov=st.booleans(),
+           half=st.booleans(),
+           finite=st.booleans(),
+           **hu.gcs)
+    def test_momentum_sgd(self, n, nesterov, half, finite, gc, dc):
+        loss_scale = np.array([2. ** 10], dtype=np.float32)
+        grad, unscaled = _scaled_grad(
+            n, loss_scale[0], np.float16 if half else np.float32)
+        momentum_data = np.random.randn(n).astype(np.float32)
+        lr = np.array([0.1], dtype=np.float32)
+        param = np.random.randn(n).astype(np.float32)
+        all_finite = np.array([finite])
+        momentum, weight_decay = 0.9, 1e-4
+
+        op = core.CreateOperator(
+            "MixedPrecisionMomentumSGDUpdate",
+            ["grad", "momentum", "lr", "param", "loss_scale", "all_finite"],
+            ["momentum", "param", "param_half"],
+            momentum=momentum,
+            nesterov=int(nesterov),
+            weight_decay=weight_decay)
+
+        def ref(grad, m, lr, param, loss_scale, all_finite):
+            if not all_finite[0]:
+                return [m, param, param.astype(np.float16)]
+            g = unscaled + weight_decay * param
+            if not nesterov:
+                m_new = lr * g + momentum * m
+                param_new = param - m_new
+            else:
+                m_new = momentum * m + lr * g
+                param_new = param - ((1 + momentum) * m_new - momentum * m)
+            return [m_new, param_new, param_new.astype(np.float16)]
+
+        self.assertReferenceChecks(
+            gc, op,
+            [grad, momentum_data, lr, param, loss_scale, all_finite],
+            ref,
+            input_device_options=_cpu_inputs,
+            threshold=1e-3,
+            outputs_to_check=[0, 1] + ([2] if finite else []))
+
+    @given(n=st.integers(1, 64),
+           ITER=st.integers(min_value=0, max_value=10000),
+           half=st.booleans(),
+           finite=st.booleans(),
+           **hu.gcs)
+    def test_adam(self, n, ITER, half, finite, gc, dc):
+        loss_scale = np.array([2. ** 10], dtype=np.float32)
+        grad, unscaled = _scaled_grad(
+            n, loss_scale[0], np.float16 if half else np.float32)
+        param = np.random.randn(n).astype(np.float32)
+        mom1 = np.random.randn(n).astype(np.float32)
+        mom2 = np.abs(np.random.randn(n)).astype(np.float32)
+        lr = np.array([-0.01], dtype=np.float32)
+        ITER = np.array([ITER], dtype=np.int64)
+        all_finite = np.array([finite])
+        beta1, beta2, epsilon = 0.9, 0.999, 1e-5
+
+        op = core.CreateOperator(
+            "MixedPrecisionAdam",
+            ["param", "mom1", "mom2", "grad", "lr", "iter", "loss_scale",
+             "all_finite"],
+            ["param", "mom1", "mom2", "param_half"],
+            beta1=beta1, beta2=beta2, epsilon=epsilon)
+
+        def ref(param, mom1, mom2, grad, lr, ITER, loss_scale, all_finite):
+            if not all_finite[0]:
+                return [param, mom1, mom2, param.astype(np.float16)]
+            t = ITER + 1
+            corrected_local_rate = lr * np.sqrt(1 - np.power(beta2, t)) / \
+                (1 - np.power(beta1, t))
+            mom1_out = beta1 * mom1 + (1 - beta1) * unscaled
+            mom2_out = beta2 * mom2 + (1 - beta2) * np.square(unscaled)
+            param_out = param + corrected_local_rate * mom1_out / \
+                (np.sqrt(mom2_out) + epsilon)
+            return [param_out, mom1_out, mom2_out,
+                    param_out.astype(np.float16)]
+
+        self.assertReferenceChecks(
+            gc, op,
+            [param, mom1, mom2, grad, lr, ITER, loss_scale, all_finite],
+            ref,
+            input_device_options=_cpu_inputs,
+            threshold=1e-3,
+            outputs_to_check=[0, 1, 2] + ([3] if finite else []))
+
+    @given(n=st.integers(1, 64),
+           half=st.booleans(),
+           finite=st.booleans(),
+           **hu.gcs)
+    def test_adagrad(self, n, half, finite, gc, dc):
+        loss_scale = np.array([2. ** 10], dtype=np.float32)
+        grad, unscaled = _scaled_grad(
+            n, loss_scale[0], np.float16 if half else np.float32)
+        param = np.random.randn(n).astype(np.float32)
+        moment = np.abs(np.random.randn(n)).astype(np.float32)
+        lr = np.array([-0.01], dtype=np.float32)
+        all_finite = np.array([finite])
+        epsilon, decay = 1e-5, 0.95
+
+        op = core.CreateOperator(
+            "MixedPrecisionAdagrad",
+            ["param", "moment", "grad", "lr", "loss_scale", "all_finite"],
+            ["param", "moment", "param_half"],
+            epsilon=epsilon, decay=decay)
+
+        def ref(param, moment, grad, lr, loss_scale, all_finite):
+            if not all_finite[0]:
+                return [param, moment, param.astype(np.float16)]
+            moment_out = decay * moment + np.square(unscaled)
+            param_out = param + lr * unscaled / \
+                (np.sqrt(moment_out) + epsilon)
+            return [param_out, moment_out, param_out.astype(np.float16)]
+
+        self.assertReferenceChecks(
+            gc, op,
+            [param, moment, grad, lr, loss_scale, all_finite],
+            ref,
+            input_device_options=_cpu_inputs,
+            threshold=1e-3,
+            outputs_to_check=[0, 1] + ([2] if finite else []))
+
+
+if __name__ == "__main__":
+    unittest.main()
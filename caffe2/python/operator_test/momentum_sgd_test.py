@@ -138,6 +138,53 @@ class TestMomentumSGD(hu.HypothesisTestCase):
             [grad, m, lr, w, indices],
             sparse)
 
+    # Sizes up to two chunks of the multi-tensor operators
+    @given(sizes=st.lists(st.integers(1, 1 << 17), min_size=1, max_size=4),
+           nesterov=st.booleans(),
+           num_threads=st.integers(0, 2),
+           **hu.gcs)
+    @hypothesis.settings(max_examples=10)
+    def test_multi_tensor_momentum_sgd(self, sizes, nesterov, num_threads,
+                                       gc, dc):
+        momentum = 0.9
+        lr = np.random.rand(1).astype(np.float32)
+        inputs = []
+        for n in sizes:
+            inputs += [np.random.rand(n).astype(np.float32) for _ in range(3)]
+        names = ["{}_{}".format(name, i)
+                 for i in range(len(sizes))
+                 for name in ["grad", "param_momentum", "param"]]
+
+        def momentum_sgd(*inputs):
+            lr = inputs[-1]
+            outputs = []
+            for grad, param_momentum, param in zip(*[iter(inputs[:-1])] * 3):
+                if not nesterov:
+                    m_new = lr * grad + momentum * param_momentum
+                    grad_new = m_new
+                else:
+                    m_new = momentum * param_momentum + lr * grad
+                    grad_new = (1 + momentum) * m_new - \
+                        momentum * param_momentum
+                outputs += [grad_new, m_new, param - grad_new]
+            return outputs
+
+        op = core.CreateOperator(
+            "MultiTensorMomentumSGDUpdate",
+            names + ["lr"],
+            names,
+            momentum=momentum,
+            nesterov=int(nesterov),
+            num_threads=num_threads,
+        )
+
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=inputs + [lr],
+            reference=momentum_sgd
+        )
+
     @given(n=st.integers(4, 8), nesterov=st.booleans(), **hu.gcs_gpu_only)
     @unittest.skipIf(not workspace.has_gpu_support, "No gpu support.")
     def test_fp16momentum_sgd(self, n, nesterov, gc, dc):
@@ -0,0 +1,82 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+
+def _attention_ref(queries, keys, values, lengths, num_heads, causal):
+    B, T_q, _ = queries.shape
+    T_k = keys.shape[1]
+    q = queries.reshape(B, T_q, num_heads, -1).transpose(0, 2, 1, 3)
+    k = keys.reshape(B, T_k, num_heads, -1).transpose(0, 2, 1, 3)
+    v = values.reshape(B, T_k, num_heads, -1).transpose(0, 2, 1, 3)
+    scores = np.matmul(q, k.transpose(0, 1, 3, 2)) / np.sqrt(q.shape[-1])
+    mask = np.ones((B, 1, T_q, T_k), dtype=bool)
+    if lengths is not None:
+        mask &= (np.arange(T_k) < lengths[:, None, None, None])
+    if causal:
+        mask &= (np.arange(T_k)[None, :] <= np.arange(T_q)[:, None])
+    scores = np.where(mask, scores, -np.inf)
+    max_scores = np.max(scores, axis=-1, keepdims=True)
+    max_scores[~np.isfinite(max_scores)] = 0
+    probs = np.exp(scores - max_scores)
+    sums = np.sum(probs, axis=-1, keepdims=True)
+    probs = np.where(sums > 0, probs / np.maximum(sums, 1e-30), 0)
+    output = np.matmul(probs, v).transpose(0, 2, 1, 3)
+    return output.reshape(B, T_q, -1).astype(np.float32)
+
+
+class TestMultiHeadAttentionOp(hu.HypothesisTestCase):
+    @given(
+        batch_size=st.integers(1, 3),
+        num_queries=st.integers(1, 6),
+        num_keys=st.integers(1, 6),
+        num_heads=st.integers(1, 3),
+        head_dim=st.integers(1, 4),
+        value_dim=st.integers(1, 4),
+        block_size=st.integers(1, 8),
+        use_lengths=st.booleans(),
+        causal=st.booleans(),
+        **hu.gcs)
+    def test_multi_head_attention(
+            self, batch_size, num_queries, num_keys, num_heads, head_dim,
+            value_dim, block_size, use_lengths, causal, gc, dc):
+        queries = np.random.randn(
+            batch_size, num_queries, num_heads * head_dim).astype(np.float32)
+        keys = np.random.randn(
+            batch_size, num_keys, num_heads * head_dim).astype(np.float32)
+        values = np.random.randn(
+            batch_size, num_keys, num_heads * value_dim).astype(np.float32)
+        lengths = np.random.randint(
+            0, num_keys + 1, size=batch_size).astype(np.int32)
+        inputs = [queries, keys, values] + ([lengths] if use_lengths else [])
+
+        op = core.CreateOperator(
+            "MultiHeadAttention",
+            ["queries", "keys", "values"] +
+            (["lengths"] if use_lengths else []),
+            ["output", "log_sum_exp"],
+            num_heads=num_heads,
+            causal=causal,
+            block_size=block_size,
+        )
+
+        def ref(queries, keys, values, lengths=None):
+            return [_attention_ref(
+                queries, keys, values, lengths, num_heads, causal)]
+
+        self.assertReferenceChecks(gc, op, inputs, ref, outputs_to_check=[0])
+        self.assertDeviceChecks(dc, op, inputs, [0])
+        for i in range(3):
+            self.assertGradientChecks(gc, op, inputs, i, [0])
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
@@ -100,6 +100,28 @@ class TestPartitionOps(TestCase):
                     actual = workspace.FetchBlob(actual_out)
                     np.testing.assert_array_equal(expected, actual)
 
+    def testPartitionLarge(self):
+        # Large enough to be partitioned by several threads
+        parts = 7
+        keys = np.random.randint(-10 ** 9, 10 ** 9, 100000).astype(np.int64)
+        values = rand_array(100000, 3)
+        workspace.FeedBlob('keys', keys)
+        workspace.FeedBlob('values', values)
+        outs = [
+            '{}_p{}'.format(name, i)
+            for i in range(parts) for name in ['keys', 'values']
+        ]
+        for pack in [0, 1]:
+            workspace.RunOperatorOnce(core.CreateOperator(
+                'Partition', ['keys', 'values'], outs,
+                pack_first_input=pack))
+            shards = keys % parts
+            for i in range(parts):
+                np.testing.assert_array_equal(
+                    keys[shards == i] // parts if pack else keys[shards == i],
+                    workspace.FetchBlob(outs[2 * i]))
+                np.testing.assert_array_equal(
+                    values[shards == i], workspace.FetchBlob(outs[2 * i + 1]))
 
     def testLengthsPartition(self):
         for main_dims, parts, main_type, extra_ins, pack in self.test_configs():
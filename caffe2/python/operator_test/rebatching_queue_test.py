@@ -77,6 +77,35 @@ class TestReBatchingQueue(TestCase):
             workspace.FetchBlob(results[1]), workspace.FetchBlob("tensors")[5:]
         )
 
+    def test_rebatching_queue_rows_across_batches(self):
+        first = np.arange(12, dtype=np.float32).reshape(4, 3)
+        second = first + 100
+        workspace.FeedBlob("first", first)
+        workspace.FeedBlob("second", second)
+
+        init_net = core.Net('init_net')
+        queue = init_net.CreateRebatchingQueue(
+            [], 1, capacity=10, num_blobs=1)
+        init_net.EnqueueRebatchingQueue(
+            [queue, "first"], [], enqueue_batch=True)
+        init_net.EnqueueRebatchingQueue(
+            [queue, "second"], [], enqueue_batch=True)
+        workspace.RunNetOnce(init_net)
+
+        def dequeue(num_elements):
+            net = core.Net('dequeue')
+            net.DequeueRebatchingQueue([queue], ["out"],
+                                       num_elements=num_elements)
+            workspace.RunNetOnce(net)
+            return workspace.FetchBlob("out")
+
+        # Rows of a single batch, then rows of both batches written to the
+        # same output, which must not overwrite the rows still queued
+        npt.assert_array_equal(dequeue(2), first[:2])
+        npt.assert_array_equal(
+            dequeue(4), np.concatenate([first[2:], second[:2]]))
+        npt.assert_array_equal(dequeue(2), second[2:])
+
     def test_rebatching_queue_closes_properly(self):
         net = core.Net('net')
         workspace.FeedBlob(
@@ -221,13 +221,15 @@ class RecurrentNetworkTest(hu.HypothesisTestCase):
     @given(sequence_length=st.integers(3, 7),
            conv_window=st.integers(1, 3),
            batch_size=st.integers(1, 5),
-           state_size=st.integers(1, 5))
+           state_size=st.integers(1, 5),
+           plan_step_memory=st.booleans())
     def test_stateful_convolution_forward_only(
         self,
         sequence_length,
         conv_window,
         batch_size,
         state_size,
+        plan_step_memory,
     ):
         '''
         This unit test demonstrates another ways of using RecurrentNetwork.
@@ -359,6 +361,7 @@ class RecurrentNetworkTest(hu.HypothesisTestCase):
             step_net=step_model.net.Proto(),
             timestep='timestep' if timestep is None else str(timestep),
             outputs_with_grads=[],
+            plan_step_memory=plan_step_memory,
         )
 
         output_states_2 = self._convolution_1d(
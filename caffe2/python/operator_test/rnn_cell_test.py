@@ -980,6 +980,45 @@ class RNNCellTest(hu.HypothesisTestCase):
             inputs_with_grads=inputs[0],
         )
 
+    @given(
+        input_tensor=hu.tensor(min_dim=3, max_dim=3, max_value=3),
+        forget_bias=st.floats(-10.0, 10.0),
+        drop_states=st.booleans(),
+        memory_optim=st.booleans(),
+        dim_out=st.lists(
+            elements=st.integers(min_value=1, max_value=3),
+            min_size=1, max_size=3,
+        ),
+        segment_length=st.integers(min_value=1, max_value=4),
+        outputs_with_grads=st.sampled_from(
+            [[0], [1], [0, 1], [0, 2], [0, 1, 2, 3]]
+        )
+    )
+    @ht_settings(max_examples=10)
+    @utils.debug
+    def test_lstm_recompute_segments(self, input_tensor, dim_out,
+                                     segment_length, outputs_with_grads,
+                                     **kwargs):
+        lstms = [
+            _prepare_rnn(
+                *input_tensor.shape,
+                create_rnn=rnn_cell.LSTM,
+                outputs_with_grads=outputs_with_grads,
+                two_d_initial_states=False,
+                dim_out=dim_out,
+                recompute_segment_length=recompute_segment_length,
+                **kwargs
+            ) for recompute_segment_length in [segment_length, None]
+        ]
+        outputs, nets, inputs = zip(*lstms)
+        workspace.FeedBlob(inputs[0][-1], input_tensor)
+
+        assert inputs[0] == inputs[1]
+        gradient_checker.NetGradientChecker.CompareNets(
+            nets, outputs, outputs_with_grads,
+            inputs_with_grads=inputs[0],
+        )
+
     @given(
         input_tensor=hu.tensor(min_dim=3, max_dim=3, max_value=3),
         encoder_length=st.integers(min_value=1, max_value=3),
@@ -1560,9 +1599,11 @@ class RNNCellTest(hu.HypothesisTestCase):
            t=st.integers(1, 10),
            dtype=st.sampled_from([np.float32, np.float16]),
            use_sequence_lengths=st.booleans(),
+           fast_activations=st.booleans(),
            **hu.gcs)
     def test_lstm_unit_recurrent_network(
-            self, seed, n, d, t, dtype, dc, use_sequence_lengths, gc):
+            self, seed, n, d, t, dtype, dc, use_sequence_lengths,
+            fast_activations, gc):
         np.random.seed(seed)
         if dtype == np.float16:
             # only supported with CUDA
@@ -1579,6 +1620,7 @@ class RNNCellTest(hu.HypothesisTestCase):
             op_inputs,
             ['hidden_t', 'cell_t'],
             sequence_lengths=use_sequence_lengths,
+            fast_activations=fast_activations,
         )
         cell_t_prev = np.random.randn(1, n, d).astype(dtype)
         hidden_t_prev = np.random.randn(1, n, d).astype(dtype)
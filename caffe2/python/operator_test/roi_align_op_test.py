@@ -0,0 +1,112 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+from caffe2.python import core, workspace
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+
+def _rois(num_rois, batch_size, height, width, spatial_scale):
+    # RoIs in image coordinates, some of them partly out of the feature map
+    x1 = np.random.uniform(-2, width, num_rois) / spatial_scale
+    y1 = np.random.uniform(-2, height, num_rois) / spatial_scale
+    x2 = x1 + np.random.uniform(0, width, num_rois) / spatial_scale
+    y2 = y1 + np.random.uniform(0, height, num_rois) / spatial_scale
+    batch_ind = np.random.randint(0, batch_size, num_rois)
+    return np.stack([batch_ind, x1, y1, x2, y2], axis=1).astype(np.float32)
+
+
+class RoIAlignOpTest(hu.HypothesisTestCase):
+    @given(batch_size=st.integers(1, 3),
+           channels=st.integers(1, 5),
+           height=st.integers(2, 8),
+           width=st.integers(2, 8),
+           num_rois=st.integers(1, 6),
+           pooled=st.integers(1, 3),
+           sampling_ratio=st.integers(0, 2),
+           **hu.gcs_cpu_only)
+    def test_nhwc_matches_nchw(self, batch_size, channels, height, width,
+                               num_rois, pooled, sampling_ratio, gc, dc):
+        spatial_scale = 0.5
+        X = np.random.randn(
+            batch_size, channels, height, width).astype(np.float32)
+        R = _rois(num_rois, batch_size, height, width, spatial_scale)
+        dY = np.random.randn(
+            num_rois, channels, pooled, pooled).astype(np.float32)
+
+        def run(order, num_threads):
+            transpose = order == "NHWC"
+            op = core.CreateOperator(
+                "RoIAlign", ["X", "R"], ["Y"],
+                spatial_scale=spatial_scale,
+                pooled_h=pooled,
+                pooled_w=pooled,
+                sampling_ratio=sampling_ratio,
+                order=order,
+                num_threads=num_threads,
+                device_option=gc,
+            )
+            grad_op = core.CreateOperator(
+                "RoIAlignGradient", ["X", "R", "dY"], ["dX"],
+                spatial_scale=spatial_scale,
+                pooled_h=pooled,
+                pooled_w=pooled,
+                sampling_ratio=sampling_ratio,
+                order=order,
+                num_threads=num_threads,
+                device_option=gc,
+            )
+            workspace.FeedBlob(
+                "X", X.transpose((0, 2, 3, 1)) if transpose else X)
+            workspace.FeedBlob("R", R)
+            workspace.FeedBlob(
+                "dY", dY.transpose((0, 2, 3, 1)) if transpose else dY)
+            workspace.RunOperatorOnce(op)
+            workspace.RunOperatorOnce(grad_op)
+            Y = workspace.FetchBlob("Y")
+            dX = workspace.FetchBlob("dX")
+            if transpose:
+                Y = Y.transpose((0, 3, 1, 2))
+                dX = dX.transpose((0, 3, 1, 2))
+            return Y, dX
+
+        Y, dX = run("NCHW", 1)
+        for order in ["NCHW", "NHWC"]:
+            for num_threads in [0, 1, 2]:
+                Y_order, dX_order = run(order, num_threads)
+                np.testing.assert_allclose(Y_order, Y, rtol=1e-5, atol=1e-5)
+                np.testing.assert_allclose(
+                    dX_order, dX, rtol=1e-5, atol=1e-5)
+
+    @given(batch_size=st.integers(1, 2),
+           channels=st.integers(1, 3),
+           size=st.integers(3, 6),
+           num_rois=st.integers(1, 4),
+           order=st.sampled_from(["NCHW", "NHWC"]),
+           **hu.gcs_cpu_only)
+    def test_gradient(self, batch_size, channels, size, num_rois, order,
+                      gc, dc):
+        spatial_scale = 0.5
+        X = np.random.randn(
+            batch_size, channels, size, size).astype(np.float32)
+        if order == "NHWC":
+            X = X.transpose((0, 2, 3, 1))
+        R = _rois(num_rois, batch_size, size, size, spatial_scale)
+        op = core.CreateOperator(
+            "RoIAlign", ["X", "R"], ["Y"],
+            spatial_scale=spatial_scale,
+            pooled_h=2,
+            pooled_w=2,
+            sampling_ratio=2,
+            order=order,
+            device_option=gc,
+        )
+        self.assertGradientChecks(gc, op, [X, R], 0, [0])
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
@@ -0,0 +1,93 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+import collections
+import numpy as np
+import os
+import tempfile
+import unittest
+
+from caffe2.python import core, workspace
+import caffe2.python.hypothesis_test_util as hu
+
+
+class TestSketchOps(hu.HypothesisTestCase):
+
+    def _save_and_load(self, blob):
+        model_file = os.path.join(tempfile.mkdtemp(), 'db')
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Save", [blob], [],
+            db=model_file, db_type="minidb", absolute_path=True))
+        workspace.ResetWorkspace()
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Load", [], [blob],
+            db=model_file, db_type="minidb", absolute_path=True))
+
+    def test_count_min_sketch(self):
+        np.random.seed(0)
+        for key_type in [np.int32, np.int64]:
+            keys = np.random.zipf(1.5, size=5000).astype(key_type)
+            counts = np.random.randint(1, 4, size=len(keys)).astype(np.int64)
+            exact = collections.Counter()
+            for key, count in zip(keys, counts):
+                exact[key] += 2 * count
+
+            width = 1000
+            for sketch in ["sketch", "other"]:
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    "CreateCountMinSketch", [], [sketch],
+                    width=width, depth=4, seed=1))
+                workspace.FeedBlob("keys", keys)
+                workspace.FeedBlob("counts", counts)
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    "CountMinSketchUpdate",
+                    [sketch, "keys", "counts"], [sketch]))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "CountMinSketchMerge", ["sketch", "other"], ["sketch"]))
+            self._save_and_load("sketch")
+
+            unique_keys = np.array(list(exact.keys()), dtype=key_type)
+            workspace.FeedBlob("keys", unique_keys)
+            workspace.RunOperatorOnce(core.CreateOperator(
+                "CountMinSketchQuery", ["sketch", "keys"], ["estimates"]))
+            estimates = workspace.FetchBlob("estimates")
+            self.assertEqual(estimates.dtype, np.int64)
+            total = sum(exact.values())
+            for key, estimate in zip(unique_keys, estimates):
+                self.assertGreaterEqual(estimate, exact[key])
+            errors = estimates - np.array([exact[k] for k in unique_keys])
+            # The error bound holds for each key with probability
+            # 1 - exp(-depth)
+            self.assertLess(
+                np.mean(errors > np.e * total / width), 0.05)
+
+    def test_hyper_log_log(self):
+        np.random.seed(1)
+        for key_type in [np.int32, np.int64]:
+            for precision in [4, 10, 14]:
+                keys = np.random.randint(
+                    0, 20000, size=50000).astype(key_type)
+                workspace.ResetWorkspace()
+                for hll, part in zip(["hll", "other"], np.split(keys, 2)):
+                    workspace.RunOperatorOnce(core.CreateOperator(
+                        "CreateHyperLogLog", [], [hll], precision=precision))
+                    workspace.FeedBlob("keys", part)
+                    workspace.RunOperatorOnce(core.CreateOperator(
+                        "HyperLogLogUpdate", [hll, "keys"], [hll]))
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    "HyperLogLogMerge", ["hll", "other"], ["hll"]))
+                self._save_and_load("hll")
+                workspace.RunOperatorOnce(core.CreateOperator(
+                    "HyperLogLogEstimate", ["hll"], ["estimate"]))
+
+                estimate = workspace.FetchBlob("estimate")
+                distinct = len(np.unique(keys))
+                error = 1.04 / np.sqrt(2 ** precision)
+                self.assertLess(
+                    abs(estimate - distinct), 4 * error * distinct)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -291,6 +291,59 @@ class TestSoftmaxOps(hu.HypothesisTestCase):
                     reference=label_softmax_crossent,
                 )
 
+    @given(n=st.sampled_from([1, 3, 64]),
+           D=st.sampled_from([7, 1000, 300001]),
+           num_threads=st.sampled_from([0, 1]),
+           **hu.gcs_cpu_only)
+    def test_softmax_cpu_threads(self, n, D, num_threads, gc, dc):
+        # Covers the rows split between threads and the rows long enough to
+        # get their max and sum in a single pass
+        if n * D > 4000000:
+            return
+        X = np.random.randn(n, D).astype(np.float32) * 10
+        dY = np.random.randn(n, D).astype(np.float32)
+        label = (np.random.rand(n) * D).astype(np.int32)
+
+        def softmax(X):
+            Y = np.exp(X - X.max(axis=1, keepdims=True))
+            return Y / Y.sum(axis=1, keepdims=True)
+
+        def softmax_ref(X):
+            return [softmax(X)]
+
+        def softmax_grad_ref(Y, dY):
+            return [Y * (dY - (Y * dY).sum(axis=1, keepdims=True))]
+
+        def softmax_with_loss_ref(X, label):
+            probs = softmax(X)
+            log_probs = X - X.max(axis=1, keepdims=True)
+            log_probs -= np.log(np.exp(log_probs).sum(axis=1, keepdims=True))
+            return (probs, -np.mean(log_probs[np.arange(n), label]))
+
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=core.CreateOperator(
+                "Softmax", ["X"], ["Y"], num_threads=num_threads),
+            inputs=[X],
+            reference=softmax_ref,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=core.CreateOperator(
+                "SoftmaxGradient", ["Y", "dY"], ["dX"],
+                num_threads=num_threads),
+            inputs=[softmax(X), dY],
+            reference=softmax_grad_ref,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=core.CreateOperator(
+                "SoftmaxWithLoss", ["X", "label"], ["probs", "avgloss"],
+                num_threads=num_threads),
+            inputs=[X, label],
+            reference=softmax_with_loss_ref,
+        )
+
     @given(n=st.integers(2, 10), D=st.integers(4, 16), **hu.gcs)
     def test_softmax_with_loss_label_prob(self, n, D, gc, dc):
         # n = number of examples, D = |labels|
@@ -0,0 +1,64 @@
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+from __future__ import unicode_literals
+
+from caffe2.python import core
+from hypothesis import given
+import caffe2.python.hypothesis_test_util as hu
+import hypothesis.strategies as st
+import numpy as np
+
+
+class TestSparseLengthsSumQuantDecode(hu.HypothesisTestCase):
+
+    @given(
+        num_rows=st.integers(1, 20),
+        block_size=st.integers(1, 40),
+        num_segments=st.integers(0, 30),
+        code_type=st.sampled_from([np.uint8, np.uint16, np.int32]),
+        index_type=st.sampled_from([np.int32, np.int64]),
+        num_threads=st.sampled_from([0, 1, 4]),
+        seed=st.integers(0, 2 ** 32 - 1),
+        **hu.gcs_cpu_only)
+    def test_sparse_lengths_sum_quant_decode(
+            self, num_rows, block_size, num_segments, code_type, index_type,
+            num_threads, seed, gc, dc):
+        np.random.seed(seed)
+        codebook = np.random.randn(200).astype(np.float32)
+        codes = np.random.randint(
+            0, len(codebook), size=(num_rows, block_size)).astype(code_type)
+        lengths = np.random.randint(
+            0, 6, size=num_segments).astype(np.int32)
+        indices = np.random.randint(
+            0, num_rows, size=np.sum(lengths)).astype(index_type)
+
+        def quant_decode_sparse_lengths_sum(codebook, codes, indices, lengths):
+            decoded = codebook[codes]
+            output = np.zeros((len(lengths), block_size), dtype=np.float32)
+            offset = 0
+            for i, length in enumerate(lengths):
+                output[i] = np.sum(
+                    decoded[indices[offset:offset + length]], axis=0)
+                offset += length
+            return [output]
+
+        op = core.CreateOperator(
+            "SparseLengthsSumQuantDecode",
+            ["codebook", "codes", "indices", "lengths"],
+            ["output"],
+            num_threads=num_threads,
+            min_indices_per_thread=1,
+        )
+        self.assertReferenceChecks(
+            device_option=gc,
+            op=op,
+            inputs=[codebook, codes, indices, lengths],
+            reference=quant_decode_sparse_lengths_sum,
+            threshold=1e-4,
+        )
+
+
+if __name__ == "__main__":
+    import unittest
+    unittest.main()
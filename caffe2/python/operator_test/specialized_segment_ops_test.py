@@ -266,5 +266,92 @@ class TestSpecializedSegmentOps(hu.HypothesisTestCase):
             self.ws.run(op)
 
 
+    @given(batchsize=st.integers(1, 200),
+           blocksize=st.sampled_from([1, 8, 17, 32, 64, 85, 128]),
+           op_type=st.sampled_from([
+               "SparseLengthsSum", "SparseLengthsWeightedSum",
+               "SparseLengthsMean", "SparseLengthsPositionalWeightedSum"]),
+           num_threads=st.sampled_from([0, 2, 3]),
+           **hu.gcs_cpu_only)
+    def test_sparse_lengths_reduction_intra_op_parallel(
+            self, batchsize, blocksize, op_type, num_threads, gc, dc):
+
+        tblsize = 300
+        Tbl = np.random.rand(tblsize, blocksize).astype(np.float32)
+        # include empty segments, they have to be written as well
+        Lengths = np.random.randint(0, 30, size=batchsize).astype(np.int32)
+        Indices = np.random.randint(
+            0, tblsize, size=sum(Lengths)).astype(np.int64)
+        Weights = np.random.rand(max(sum(Lengths), 30)).astype(np.float32)
+        if op_type != "SparseLengthsPositionalWeightedSum":
+            Weights = Weights[:sum(Lengths)]
+
+        inputs = ["Tbl", "Indices", "Lengths"]
+        if "Weighted" in op_type:
+            inputs = ["Tbl", "Weights", "Indices", "Lengths"]
+        serial = core.CreateOperator(
+            op_type, inputs, "out_serial", num_threads=1)
+        parallel = core.CreateOperator(
+            op_type, inputs, "out_parallel",
+            num_threads=num_threads, min_indices_per_thread=1)
+
+        self.ws.create_blob("Tbl").feed(Tbl)
+        self.ws.create_blob("Weights").feed(Weights)
+        self.ws.create_blob("Indices").feed(Indices)
+        self.ws.create_blob("Lengths").feed(Lengths)
+        self.ws.run(serial)
+        self.ws.run(parallel)
+
+        np.testing.assert_allclose(self.ws.blobs[("out_parallel")].fetch(),
+                                   self.ws.blobs[("out_serial")].fetch(),
+                                   rtol=1e-5, atol=1e-5)
+
+    @given(batchsize=st.integers(1, 200),
+           blocksize=st.sampled_from([1, 8, 17, 64]),
+           op_type=st.sampled_from(["SparseLengthsSum", "SparseLengthsMean"]),
+           index_type=st.sampled_from([np.int32, np.int64]),
+           num_threads=st.sampled_from([0, 1, 3]),
+           **hu.gcs_cpu_only)
+    def test_sparse_lengths_dedup_gradient(
+            self, batchsize, blocksize, op_type, index_type, num_threads,
+            gc, dc):
+
+        tblsize = 50
+        Lengths = np.random.randint(0, 30, size=batchsize).astype(np.int32)
+        # skewed ids, so that most of them are repeated
+        Indices = np.minimum(
+            np.random.randint(0, tblsize, size=sum(Lengths)),
+            np.random.randint(0, tblsize, size=sum(Lengths))
+        ).astype(index_type)
+        OutGrad = np.random.rand(batchsize, blocksize).astype(np.float32)
+
+        op = core.CreateOperator(
+            op_type, ["Tbl", "Indices", "Lengths"], "out",
+            dedup_gradient=True, num_threads=num_threads,
+            min_indices_per_thread=1)
+        grad_ops, g_input = core.GradientRegistry.GetGradientForOp(
+            op, ["out_grad"])
+        self.assertEqual(len(grad_ops), 1)
+        self.assertEqual(grad_ops[0].type, op_type + "DedupGradient")
+        self.assertTrue(isinstance(g_input[0], core.GradientSlice))
+
+        def ref(out_grad, lengths, indices):
+            unique, rows = [], {}
+            segments = np.repeat(np.arange(batchsize), lengths)
+            for i, s in zip(indices, segments):
+                row = out_grad[s]
+                if op_type == "SparseLengthsMean":
+                    row = row / lengths[s]
+                if i not in rows:
+                    unique.append(i)
+                    rows[i] = np.zeros(blocksize, dtype=np.float32)
+                rows[i] += row
+            return [np.array(unique, dtype=index_type),
+                    np.array([rows[i] for i in unique],
+                             dtype=np.float32).reshape(-1, blocksize)]
+
+        self.assertReferenceChecks(
+            gc, grad_ops[0], [OutGrad, Lengths, Indices], ref)
+
 if __name__ == "__main__":
     unittest.main()
@@ -49,3 +49,22 @@ class TestCounterOps(TestCase):
         self.assertEqual(len(t3), len(k3))
         for key in keys:
             self.assertIn(key, k3)
+
+    def test_pipeline_report(self):
+        queue_name = '_'.join([__name__, 'test_pipeline_report', 'queue'])
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'CreateBlobsQueue', [], [queue_name], capacity=4, num_blobs=1))
+        workspace.FeedBlob('x', np.ones((8, 8), dtype=np.float32))
+        for _ in range(3):
+            workspace.RunOperatorOnce(core.CreateOperator(
+                'EnqueueBlobs', [queue_name, 'x'], ['x']))
+            workspace.RunOperatorOnce(core.CreateOperator(
+                'DequeueBlobs', [queue_name], ['x']))
+        workspace.RunOperatorOnce(core.CreateOperator(
+            'PipelineReport', [], ['report']))
+        lines = [
+            line for line in workspace.FetchBlob('report')
+            if line.decode('utf-8').startswith(queue_name + ':')
+        ]
+        self.assertEqual(len(lines), 1)
+        self.assertIn(b'items/s', lines[0])
@@ -6,6 +6,7 @@ from caffe2.python import core, workspace
 from caffe2.python.text_file_reader import TextFileReader
 from caffe2.python.test_util import TestCase
 from caffe2.python.schema import Struct, Scalar, FetchRecord
+import itertools
 import tempfile
 import numpy as np
 
@@ -32,7 +33,9 @@ class TestTextFileReader(TestCase):
             )
             txt_file.flush()
 
-            for num_passes in range(1, 3):
+            modes = [(False, 1), (True, 1), (True, 3)]
+            for (mmap, num_threads), num_passes in itertools.product(
+                    modes, range(1, 3)):
                 for batch_size in range(1, len(row_data) + 2):
                     init_net = core.Net('init_net')
                     reader = TextFileReader(
@@ -40,7 +43,9 @@ class TestTextFileReader(TestCase):
                         filename=txt_file.name,
                         schema=schema,
                         batch_size=batch_size,
-                        num_passes=num_passes)
+                        num_passes=num_passes,
+                        mmap=mmap,
+                        num_threads=num_threads)
                     workspace.RunNetOnce(init_net)
 
                     net = core.Net('read_net')
@@ -62,6 +67,47 @@ class TestTextFileReader(TestCase):
                         else:
                             np.testing.assert_array_equal(col_batch, results[i])
 
+    def test_text_file_reader_parallel(self):
+        schema = Struct(
+            ('label', Scalar(dtype=np.float32)),
+            ('text', Scalar(dtype=str)))
+        num_rows = 1000
+        labels = np.arange(num_rows, dtype=np.float32)
+        texts = ['row{}'.format(i) for i in range(num_rows)]
+        with tempfile.NamedTemporaryFile(mode='w+', delete=False) as txt_file:
+            txt_file.write(''.join(
+                '{}\t{}\n'.format(label, text)
+                for label, text in zip(labels, texts)))
+            txt_file.flush()
+
+            init_net = core.Net('init_net')
+            reader = TextFileReader(
+                init_net,
+                filename=txt_file.name,
+                schema=schema,
+                batch_size=300,
+                num_passes=2,
+                mmap=True,
+                num_threads=4)
+            workspace.RunNetOnce(init_net)
+
+            net = core.Net('read_net')
+            should_stop, record = reader.read_record(net)
+            results = [[], []]
+            while True:
+                workspace.RunNetOnce(net)
+                arrays = FetchRecord(record).field_blobs()
+                for i in range(2):
+                    results[i].extend(arrays[i])
+                if workspace.FetchBlob(should_stop):
+                    break
+            # the rows are in the order of the file, pass after pass
+            np.testing.assert_array_equal(np.tile(labels, 2), results[0])
+            self.assertEqual(
+                texts * 2,
+                [t.decode('utf-8') if isinstance(t, bytes) else t
+                 for t in results[1]])
+
 if __name__ == "__main__":
     import unittest
     unittest.main()
@@ -8,7 +8,7 @@ import numpy as np
 import random
 
 from caffe2.python import core
-from hypothesis import given
+from hypothesis import given, settings
 import caffe2.python.hypothesis_test_util as hu
 
 
@@ -183,6 +183,69 @@ class TestTopK(hu.HypothesisTestCase):
         self.assertReferenceChecks(gc, op, [X], bind_ref)
         self.assertDeviceChecks(dc, op, [X], [0])
 
+    @given(bs=st.integers(1, 2), n=st.integers(100000, 200000),
+           k=st.sampled_from([1000, 3000, 5000]),
+           flatten_indices=st.booleans(), **hu.gcs)
+    @settings(max_examples=3, timeout=100)
+    def test_top_k_large(self, bs, n, k, flatten_indices, gc, dc):
+        # Few long rows are split across blocks on the GPU, rows with more
+        # than 4096 results are sorted without shared memory
+        X = np.random.rand(bs, n).astype(dtype=np.float32)
+
+        output_list = ["Values", "Indices"]
+        if flatten_indices:
+            output_list.append("FlattenIndices")
+        op = core.CreateOperator("TopK", ["X"], output_list,
+                                 k=k, device_option=gc)
+
+        def bind_ref(X_loc):
+            return self.top_k_ref(X_loc, k, flatten_indices)
+
+        self.assertReferenceChecks(gc, op, [X], bind_ref)
+        self.assertDeviceChecks(dc, op, [X], [0])
+
+    @given(bs=st.integers(2, 64), n=st.integers(1000, 3000),
+           k_ratio=st.sampled_from([0.001, 0.01, 0.5, 1.0]),
+           num_threads=st.sampled_from([0, 1, 3]),
+           ties=st.booleans(), **hu.gcs_cpu_only)
+    @settings(max_examples=10, timeout=100)
+    def test_top_k_threads(self, bs, n, k_ratio, num_threads, ties, gc, dc):
+        # Both the heap and the full row selections, on rows split between
+        # threads
+        k = max(1, int(n * k_ratio))
+        if ties:
+            X = np.random.randint(0, 10, size=(bs, n)).astype(np.float32)
+        else:
+            X = np.random.rand(bs, n).astype(dtype=np.float32)
+        op = core.CreateOperator(
+            "TopK", ["X"], ["Values", "Indices", "FlattenIndices"], k=k,
+            num_threads=num_threads, device_option=gc)
+
+        def bind_ref(X_loc):
+            return self.top_k_ref(X_loc, k, True)
+
+        self.assertReferenceChecks(gc, op, [X], bind_ref)
+
+    @given(X=hu.tensor(dtype=np.float32), k=st.integers(1, 5),
+           axis=st.integers(-1, 5), **hu.gcs_cpu_only)
+    def test_softmax_top_k(self, X, k, axis, gc, dc):
+        dims = X.shape
+        if axis >= len(dims):
+            axis %= len(dims)
+        if k > dims[axis]:
+            k = (k - 1) % dims[axis] + 1
+        op = core.CreateOperator(
+            "SoftmaxTopK", ["X"], ["Values", "Indices"], k=k, axis=axis,
+            device_option=gc)
+
+        def softmax_top_k_ref(X_loc):
+            X_max = np.max(X_loc, axis=axis, keepdims=True)
+            X_sum = np.sum(np.exp(X_loc - X_max), axis=axis, keepdims=True)
+            values, indices = self.top_k_ref(X_loc, k, False, axis)
+            return (np.exp(values - X_max) / X_sum, indices)
+
+        self.assertReferenceChecks(gc, op, [X], softmax_top_k_ref)
+
     @given(X=hu.tensor(dtype=np.float32), k=st.integers(1, 5),
            axis=st.integers(-1, 5), flatten_indices=st.booleans(),
            **hu.gcs)
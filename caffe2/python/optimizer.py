@@ -17,6 +17,9 @@ from caffe2.proto import caffe2_pb2
 
 _OPTIMIZER_ITERATION_NAME = "optimizer_iteration"
 _LEARNING_RATE_INJECTION = "lr_injection"
+_LOSS_SCALE_NAME = "loss_scale"
+_LOSS_SCALE_GOOD_STEPS_NAME = "loss_scale_good_steps"
+_ALL_FINITE_NAME = "all_finite"
 
 AuxOptimizerParams = namedtuple("AuxOptimizerParams", ["local", "shared"])
 _optimizer_instance_count = defaultdict(int)
@@ -437,6 +440,140 @@ class FP16SgdOptimizer(SgdOptimizer):
                 weight_decay=self.weight_decay)
 
 
+class MixedPrecisionOptimizer(Optimizer):
+    """Mixed precision training with dynamic loss scaling: the gradients,
+    scaled by the loss scale, are unscaled, the float master weights
+    param_info.blob_copy[core.DataType.FLOAT] and the optimizer state are
+    updated and the float16 parameter refreshed by a single fused operator,
+    which skips the update when some gradient of the iteration is not finite.
+    Parameters without a float copy are updated in place.
+
+    The loss scale and the check of the gradients are added with
+    add_dynamic_loss_scale, add_gradients_check and add_loss_scale_update,
+    as data_parallel_model does with dynamic_loss_scale.
+
+    optimizer is 'sgd' (momentum SGD), 'adam' or 'adagrad'.
+    """
+    def __init__(self, optimizer='sgd', base_learning_rate=0.1,
+                 policy='fixed', momentum=0.9, nesterov=1, weight_decay=0.0,
+                 beta1=0.9, beta2=0.999, epsilon=1e-5, decay=1.0, **kwargs):
+        super(MixedPrecisionOptimizer, self).__init__()
+        assert optimizer in ('sgd', 'adam', 'adagrad'), (
+            "Unsupported mixed precision optimizer {}".format(optimizer))
+        self.optimizer = optimizer
+        self.base_learning_rate = base_learning_rate
+        self.policy = policy
+        self.momentum = momentum
+        self.nesterov = nesterov
+        self.weight_decay = weight_decay
+        self.beta1 = beta1
+        self.beta2 = beta2
+        self.epsilon = epsilon
+        self.decay = decay
+        self.init_kwargs = kwargs
+
+    def _run(self, net, param_init_net, param_info):
+        param = param_info.blob
+        grad = param_info.grad
+        if self.base_learning_rate == 0:
+            return
+        assert self.base_learning_rate > 0, (
+            "Expect positive base learning rate, got {}".format(
+                self.base_learning_rate))
+        assert not isinstance(grad, core.GradientSlice), (
+            "MixedPrecisionOptimizer does not support sparse gradients")
+
+        param_fp32 = param_info.blob_copy[core.DataType.FLOAT] \
+            if param_info.blob_copy is not None else None
+        if param_fp32 is None:
+            param_fp32 = param
+            param_half = []
+        else:
+            param_half = [param]
+
+        # Momentum SGD subtracts the update while Adam and Adagrad add it
+        lr_sign = -1 if self.optimizer == 'sgd' else 1
+        lr, iteration = self.build_lr(
+            net, param_init_net,
+            base_learning_rate=self.base_learning_rate * lr_sign,
+            policy=self.policy,
+            **(self.init_kwargs)
+        )
+        scaling = [_LOSS_SCALE_NAME, _ALL_FINITE_NAME]
+
+        if self.optimizer == 'sgd':
+            momentum_data = param_init_net.ConstantFill(
+                param_fp32, str(param) + "_momentum", value=0.)
+            self._aux_params.local.append(momentum_data)
+            net.MixedPrecisionMomentumSGDUpdate(
+                [grad, momentum_data, lr, param_fp32] + scaling,
+                [momentum_data, param_fp32] + param_half,
+                momentum=self.momentum,
+                nesterov=self.nesterov,
+                weight_decay=self.weight_decay)
+        elif self.optimizer == 'adam':
+            m1 = param_init_net.ConstantFill(
+                param_fp32, str(param) + "_first_moment", value=0.)
+            m2 = param_init_net.ConstantFill(
+                param_fp32, str(param) + "_second_moment", value=0.)
+            self._aux_params.shared.append(iteration)
+            self._aux_params.local.append(m1)
+            self._aux_params.local.append(m2)
+            net.MixedPrecisionAdam(
+                [param_fp32, m1, m2, grad, lr, iteration] + scaling,
+                [param_fp32, m1, m2] + param_half,
+                beta1=self.beta1,
+                beta2=self.beta2,
+                epsilon=self.epsilon)
+        else:
+            param_squared_sum = param_init_net.ConstantFill(
+                param_fp32, str(param) + "_squared_sum", value=0.)
+            self._aux_params.local.append(param_squared_sum)
+            net.MixedPrecisionAdagrad(
+                [param_fp32, param_squared_sum, grad, lr] + scaling,
+                [param_fp32, param_squared_sum] + param_half,
+                epsilon=self.epsilon,
+                decay=float(self.decay))
+
+    def scale_learning_rate(self, scale):
+        self.base_learning_rate *= scale
+        return
+
+
+def add_dynamic_loss_scale(param_init_net, init_loss_scale=2. ** 16):
+    """Creates the loss scale read by MixedPrecisionOptimizer, and the number
+    of iterations since its last change, on the CPU. Returns the loss scale,
+    by which the gradient of the loss has to be multiplied.
+    """
+    with core.DeviceScope(core.DeviceOption(caffe2_pb2.CPU)):
+        param_init_net.ConstantFill(
+            [], _LOSS_SCALE_GOOD_STEPS_NAME, shape=[1], value=0,
+            dtype=core.DataType.INT64)
+        return param_init_net.ConstantFill(
+            [], _LOSS_SCALE_NAME, shape=[1], value=float(init_loss_scale))
+
+
+def add_gradients_check(net, grads):
+    """Checks that the gradients grads, all the gradients of the model once
+    reduced between the devices, are finite, before the MixedPrecisionOptimizer
+    updates. Runs in the current device scope.
+    """
+    return net.AllFinite(
+        [g.values if isinstance(g, core.GradientSlice) else g for g in grads],
+        _ALL_FINITE_NAME)
+
+
+def add_loss_scale_update(net, **kwargs):
+    """Updates the loss scale after the MixedPrecisionOptimizer updates of the
+    iteration, kwargs being the arguments of UpdateLossScale.
+    """
+    with core.DeviceScope(core.DeviceOption(caffe2_pb2.CPU)):
+        net.UpdateLossScale(
+            [_LOSS_SCALE_NAME, _LOSS_SCALE_GOOD_STEPS_NAME, _ALL_FINITE_NAME],
+            [_LOSS_SCALE_NAME, _LOSS_SCALE_GOOD_STEPS_NAME],
+            **kwargs)
+
+
 class WeightDecayBuilder(Optimizer):
     def __init__(self, weight_decay):
         self.weight_decay = weight_decay
@@ -1165,6 +1302,25 @@ def build_fp16_sgd(model, base_learning_rate, **kwargs):
     return _build(model, fp16_sgd_optimizer)
 
 
+def build_mixed_precision(
+    model,
+    base_learning_rate,
+    optimizer='sgd',
+    max_gradient_norm=None,
+    allow_lr_injection=False,
+    **kwargs
+):
+    mixed_precision_optimizer = MixedPrecisionOptimizer(
+        optimizer, base_learning_rate, **kwargs
+    )
+    return _build(
+        model,
+        mixed_precision_optimizer,
+        max_gradient_norm=max_gradient_norm,
+        allow_lr_injection=allow_lr_injection,
+    )
+
+
 def build_ftrl(model, engine="SIMD", **kwargs):
     if engine == "SIMD":
         assert core.IsOperator('Ftrl_ENGINE_SIMD')
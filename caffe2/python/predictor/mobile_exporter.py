@@ -5,9 +5,10 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 from __future__ import unicode_literals
-from caffe2.python import core, utils
+from caffe2.python import core, utils, workspace
 from caffe2.proto import caffe2_pb2
 import numpy as np
+import os
 
 
 def add_tensor(net, name, blob):
@@ -92,3 +93,74 @@ def Export(workspace, net, params):
     del predict_net.external_output[:]
     predict_net.external_output.extend(output_blobs)
     return init_net, predict_net
+
+
+# Fill operators whose tensors ExportMapped moves to the weights file
+kMappableFills = (
+    "GivenTensorFill",
+    "GivenTensorDoubleFill",
+    "GivenTensorBoolFill",
+    "GivenTensorIntFill",
+    "GivenTensorInt64Fill",
+)
+
+
+def ExportMapped(init_net, weights_path, db=None, alignment=4096):
+    """Returns the init_net loading the tensors of the GivenTensor*Fill ops
+       of init_net from a file written to weights_path, instead of parsing
+       them from the protobuf.
+
+       The file is the flat tensor format of Save and Load with mmap, with
+       the data of every tensor aligned to alignment, the page size by
+       default (16384 for arm64 iOS). The fills are replaced by a single Load
+       that maps the file and binds the blobs to it, so the weights are
+       neither parsed nor copied, the pages of the weights that are not used
+       are never read, and processes running the same model share them. The
+       loaded tensors are read-only.
+
+       db is the path of the file on the device, by default the file name of
+       weights_path. A relative path is relative to the root folder of the
+       workspace running the init_net, for the Predictor the root folder of
+       its parent workspace. The file has to be stored uncompressed to be
+       mapped, e.g. not compressed in an Android APK.
+    """
+    mapped = [i for i, op in enumerate(init_net.op) if _is_mappable(op)]
+    blobs = [init_net.op[i].output[0] for i in mapped]
+    assert len(set(blobs)) == len(blobs), \
+        "Blobs written by several fill ops can't be mapped"
+
+    current = workspace.CurrentWorkspace()
+    workspace.SwitchWorkspace("_mobile_exporter_mapped", True)
+    try:
+        for i in mapped:
+            workspace.RunOperatorOnce(init_net.op[i])
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "Save", blobs, [],
+            db=weights_path,
+            absolute_path=1,
+            mmap=1,
+            alignment=alignment))
+    finally:
+        workspace.ResetWorkspace()
+        workspace.SwitchWorkspace(current)
+
+    if db is None:
+        db = os.path.basename(weights_path)
+    mapped_init_net = caffe2_pb2.NetDef()
+    mapped_init_net.CopyFrom(init_net)
+    del mapped_init_net.op[:]
+    for i, op in enumerate(init_net.op):
+        if mapped and i == mapped[0]:
+            mapped_init_net.op.extend([core.CreateOperator(
+                "Load", [], blobs,
+                db=db,
+                absolute_path=int(os.path.isabs(db)),
+                mmap=1)])
+        if not _is_mappable(op):
+            mapped_init_net.op.extend([op])
+    return mapped_init_net
+
+
+def _is_mappable(op):
+    # Fills taking their shape from an input can't be run on their own
+    return op.type in kMappableFills and len(op.input) == 0
@@ -7,6 +7,9 @@ from caffe2.python import workspace, brew
 from caffe2.python.model_helper import ModelHelper
 from caffe2.python.predictor import mobile_exporter
 import numpy as np
+import os
+import shutil
+import tempfile
 
 
 class TestMobileExporter(TestCase):
@@ -117,3 +120,41 @@ class TestMobileExporter(TestCase):
         np.testing.assert_allclose(
             ref_out, predictor_out, atol=1e-10, rtol=1e-10
         )
+
+    def test_mobile_exporter_mapped(self):
+        model = ModelHelper(name="mobile_exporter_test_model")
+        brew.conv(model, 'data', 'conv1', dim_in=1, dim_out=20, kernel=5)
+        brew.fc(model, 'conv1', 'fc2', dim_in=20 * 24 * 24, dim_out=10)
+        brew.softmax(model, 'fc2', 'out')
+
+        workspace.RunNetOnce(model.param_init_net)
+        init_net, predict_net = mobile_exporter.Export(
+            workspace, model.net, model.params
+        )
+        np_data = np.random.rand(1, 1, 28, 28).astype(np.float32)
+        workspace.FeedBlob("data", np_data)
+        workspace.CreateNet(model.net)
+        workspace.RunNet(model.net)
+        ref_out = workspace.FetchBlob("out")
+        workspace.ResetWorkspace()
+
+        weights_path = os.path.join(tempfile.mkdtemp(), "weights.c2map")
+        try:
+            mapped_init_net = mobile_exporter.ExportMapped(
+                init_net, weights_path, db=weights_path)
+            self.assertEqual(
+                [op.type for op in mapped_init_net.op], ["Load"])
+            self.assertEqual(
+                sorted(mapped_init_net.op[0].output),
+                sorted(op.output[0] for op in init_net.op))
+
+            predictor = workspace.Predictor(
+                mapped_init_net.SerializeToString(),
+                predict_net.SerializeToString()
+            )
+            predictor_out = predictor.run([np_data])[0]
+            np.testing.assert_allclose(
+                ref_out, predictor_out, atol=1e-10, rtol=1e-10
+            )
+        finally:
+            shutil.rmtree(os.path.dirname(weights_path))
@@ -12,7 +12,9 @@
 #include "caffe2/core/stats.h"
 #include "caffe2/core/transform.h"
 #include "caffe2/mkl/mkl_utils.h"
+#include "caffe2/observers/blob_memory_observer.h"
 #include "caffe2/observers/runcnt_observer.h"
+#include "caffe2/observers/throughput_observer.h"
 #include "caffe2/observers/time_observer.h"
 #include "caffe2/onnx/backend.h"
 #include "caffe2/onnx/helper.h"
@@ -155,9 +157,14 @@ const Func& getGradientFunc(const std::string& token) {
   return getOpFunc(token + "_gradient");
 }
 
-py::object fetchBlob(Workspace* ws, const std::string& name) {
+py::object
+fetchBlob(Workspace* ws, const std::string& name, bool zero_copy) {
   CAFFE_ENFORCE(ws->HasBlob(name), "Can't find blob: ", name);
-  const caffe2::Blob& blob = *(ws->GetBlob(name));
+  caffe2::Blob& blob = *(ws->GetBlob(name));
+  if (zero_copy && blob.IsType<TensorCPU>()) {
+    return TensorFetcher<CPUContext>().FetchTensorView(
+        blob.GetMutable<TensorCPU>());
+  }
   auto fetcher = CreateFetcher(blob.meta().id());
   if (fetcher) {
     return fetcher->Fetch(blob);
@@ -234,6 +241,35 @@ OPERATOR_SCHEMA(PythonDLPackGradient).AllowInplace([](int, int) {
 });
 REGISTER_GRADIENT(PythonDLPack, GetPythonGradient);
 
+// Attaches a new observer of the given type to the net
+const Observable<NetBase>::Observer* attachObserver(
+    NetBase* net,
+    const std::string& observer_type) {
+  const Observable<NetBase>::Observer* observer = nullptr;
+
+#define REGISTER_PYTHON_EXPOSED_OBSERVER(ob_type)             \
+  {                                                           \
+    if (observer_type.compare(#ob_type) == 0) {               \
+      unique_ptr<ob_type> net_ob = make_unique<ob_type>(net); \
+      observer = net->AttachObserver(std::move(net_ob));      \
+    }                                                         \
+  }
+
+  REGISTER_PYTHON_EXPOSED_OBSERVER(TimeObserver);
+  REGISTER_PYTHON_EXPOSED_OBSERVER(BlobMemoryObserver);
+  REGISTER_PYTHON_EXPOSED_OBSERVER(ThroughputNetObserver);
+#undef REGISTER_PYTHON_EXPOSED_OBSERVER
+
+  if (observer_type.compare("RunCountObserver") == 0) {
+    unique_ptr<RunCountNetObserver> net_ob =
+        make_unique<RunCountNetObserver>(net);
+    observer = net->AttachObserver(std::move(net_ob));
+  }
+
+  CAFFE_ENFORCE(observer != nullptr, "Unknown observer type ", observer_type);
+  return observer;
+}
+
 void addObjectMethods(py::module& m) {
   py::class_<NetBase>(m, "Net").def("run", [](NetBase* net) {
     py::gil_scoped_release g;
@@ -257,6 +293,22 @@ void addObjectMethods(py::module& m) {
                 cast_ob, "Observer does not implement this function.");
             return cast_ob->average_time_children();
           })
+      .def(
+          "memory_stats",
+          [](ObserverBase<NetBase>* ob) {
+            auto* cast_ob = dynamic_cast_if_rtti<BlobMemoryObserver*>(ob);
+            CAFFE_ENFORCE(
+                cast_ob, "Observer does not implement this function.");
+            const auto stats = cast_ob->last_run();
+            py::dict result;
+            result["start_bytes"] = stats.start_bytes;
+            result["peak_bytes"] = stats.peak_bytes;
+            result["end_bytes"] = stats.end_bytes;
+            result["operator_bytes"] = stats.operator_bytes;
+            result["peak_blobs"] = stats.peak_blobs;
+            result["max_peak_bytes"] = cast_ob->max_peak_bytes();
+            return result;
+          })
       .def("debug_info", [](ObserverBase<NetBase>* ob) {
         return ob->debugInfo();
       });
@@ -342,7 +394,7 @@ void addObjectMethods(py::module& m) {
           "Copy data from given DLPack tensor into this tensor.")
       .def_property_readonly(
           "_shape",
-          [](const DLPackWrapper<CPUContext>& t) {
+          [](const DLPackWrapper<CPUContext>& t) -> std::vector<TIndex> {
             auto* tensor = t.tensor;
             return tensor->dims();
           })
@@ -398,7 +450,8 @@ void addObjectMethods(py::module& m) {
           "Initialize this tensor to given shape and data type. "
           "Fail if the given data type cannot be accessed from python.")
       .def_property_readonly(
-          "_shape", [](const TensorCPU& t) { return t.dims(); })
+          "_shape",
+          [](const TensorCPU& t) -> std::vector<TIndex> { return t.dims(); })
       .def("_reshape", [](TensorCPU* t, std::vector<TIndex> dims) {
         t->Resize(dims);
       });
@@ -448,7 +501,11 @@ void addObjectMethods(py::module& m) {
             return py::cast(self->CreateBlob(name));
           },
           py::return_value_policy::reference_internal)
-      .def("fetch_blob", &python_detail::fetchBlob)
+      .def(
+          "fetch_blob",
+          &python_detail::fetchBlob,
+          py::arg("name"),
+          py::arg("zero_copy") = false)
       .def(
           "has_blob",
           [](Workspace* self, const std::string& name) {
@@ -763,6 +820,13 @@ void addObjectMethods(py::module& m) {
                 predict_net.cast<std::string>(), &predict_net_));
             return new Predictor(init_net_, predict_net_, gWorkspace);
           }))
+      .def(
+          "add_observer",
+          [](Predictor& instance, const std::string& observer_type) {
+            py::gil_scoped_release g;
+            return attachObserver(instance.net(), observer_type);
+          },
+          py::return_value_policy::reference)
       .def(
           "run",
           [](Predictor& instance,
@@ -818,7 +882,7 @@ void addObjectMethods(py::module& m) {
           });
 
   py::class_<script::CompilationUnit>(m, "CompilationUnit")
-      .def(py::init<>())
+      .def(py::init<bool>(), py::arg("optimize") = false)
       .def("define", &script::CompilationUnit::define)
       .def("get_proto", &script::CompilationUnit::getProto)
       .def(
@@ -1016,27 +1080,7 @@ void addGlobalMethods(py::module& m) {
         py::gil_scoped_release g;
 
         NetBase* net = gWorkspace->GetNet(net_name);
-        const Observable<NetBase>::Observer* observer = nullptr;
-
-#define REGISTER_PYTHON_EXPOSED_OBSERVER(ob_type)             \
-  {                                                           \
-    if (observer_type.compare(#ob_type) == 0) {               \
-      unique_ptr<ob_type> net_ob = make_unique<ob_type>(net); \
-      observer = net->AttachObserver(std::move(net_ob));      \
-    }                                                         \
-  }
-
-        REGISTER_PYTHON_EXPOSED_OBSERVER(TimeObserver);
-#undef REGISTER_PYTHON_EXPOSED_OBSERVER
-
-        if (observer_type.compare("RunCountObserver") == 0) {
-          unique_ptr<RunCountNetObserver> net_ob =
-              make_unique<RunCountNetObserver>(net);
-          observer = net->AttachObserver(std::move(net_ob));
-        }
-
-        CAFFE_ENFORCE(observer != nullptr);
-        return py::cast(observer);
+        return py::cast(attachObserver(net, observer_type));
       });
   m.def(
       "remove_observer_from_net",
@@ -1104,7 +1148,7 @@ void addGlobalMethods(py::module& m) {
           shapes.emplace_back(GetTensorShapeOfBlob(blob));
         }
         const auto c = schema->InferCost(def, shapes);
-        return std::make_tuple(c.flops, c.bytes_moved);
+        return std::make_tuple(c.flops, c.bytes_read + c.bytes_written);
       });
   m.def("run_net_once", [](const py::bytes& net_def) {
     CAFFE_ENFORCE(gWorkspace);
@@ -1253,12 +1297,19 @@ void addGlobalMethods(py::module& m) {
     CAFFE_ENFORCE(gWorkspace->CreateBlob(name));
     return true;
   });
-  m.def("fetch_blob", [](const std::string& name) -> py::object {
-    return python_detail::fetchBlob(gWorkspace, name);
-  });
+  m.def(
+      "fetch_blob",
+      [](const std::string& name, bool zero_copy) -> py::object {
+        return python_detail::fetchBlob(gWorkspace, name, zero_copy);
+      },
+      py::arg("name"),
+      py::arg("zero_copy") = false);
   m.def(
       "feed_blob",
-      [](const std::string& name, py::object arg, py::object device_option) {
+      [](const std::string& name,
+         py::object arg,
+         py::object device_option,
+         bool zero_copy) {
         DeviceOption option;
         if (!device_option.is(py::none())) {
           // If we have a device option passed in, read it.
@@ -1268,6 +1319,11 @@ void addGlobalMethods(py::module& m) {
         auto* blob = gWorkspace->CreateBlob(name);
         if (PyArray_Check(arg.ptr())) { // numpy array
           PyArrayObject* array = reinterpret_cast<PyArrayObject*>(arg.ptr());
+          if (zero_copy && option.device_type() == CPU &&
+              TensorFeeder<CPUContext>().ShareTensor(
+                  array, blob->GetMutable<TensorCPU>())) {
+            return true;
+          }
           auto feeder = CreateFeeder(option.device_type());
           CAFFE_ENFORCE(feeder, "Unknown device type encountered in FeedBlob.");
           feeder->Feed(option, array, blob);
@@ -1285,7 +1341,8 @@ void addGlobalMethods(py::module& m) {
       "",
       py::arg("name"),
       py::arg("arg"),
-      py::arg("device_option") = py::none());
+      py::arg("device_option") = py::none(),
+      py::arg("zero_copy") = false);
   m.def("serialize_blob", [](const std::string& name) {
     CAFFE_ENFORCE(gWorkspace);
     auto* blob = gWorkspace->GetBlob(name);
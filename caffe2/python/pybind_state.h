@@ -150,6 +150,44 @@ class TensorFetcher : public BlobFetcherBase {
     }
     return result;
   }
+
+  /**
+   * Returns a read-only numpy array of the data of tensor, without copying it
+   * if possible (CPU tensors of numeric types), a copy otherwise.
+   *
+   * The array shares the storage of tensor copy-on-write: it keeps the
+   * storage alive on its own, and the first write to tensor while the array
+   * is alive gives tensor a new copy of the data instead of changing the
+   * array. The array is thus a snapshot of tensor, which costs a copy only if
+   * tensor is written before the array is released. Tensor is marked
+   * copy-on-write, so no net may write it during the call.
+   */
+  pybind11::object FetchTensorView(Tensor<Context>* tensor) {
+    const int numpy_type = CaffeToNumpyType(tensor->meta());
+    if (numpy_type == -1 || NeedsCopy(tensor->meta()) || tensor->size() <= 0) {
+      return FetchTensor(*tensor, true).obj;
+    }
+    std::unique_ptr<Tensor<Context>> view(new Tensor<Context>());
+    view->ShareDataCopyOnWrite(tensor);
+    std::vector<npy_intp> npy_dims(view->dims().begin(), view->dims().end());
+    // Not through raw_mutable_data(), which would copy the shared storage
+    auto obj = py::reinterpret_steal<py::object>(PyArray_SimpleNewFromData(
+        view->ndim(),
+        npy_dims.data(),
+        numpy_type,
+        const_cast<void*>(view->raw_data())));
+    CAFFE_ENFORCE(obj, "Failed to create a numpy array for the tensor.");
+    auto* array = reinterpret_cast<PyArrayObject*>(obj.ptr());
+    PyArray_CLEARFLAGS(array, NPY_ARRAY_WRITEABLE);
+    PyObject* base = PyCapsule_New(view.get(), nullptr, [](PyObject* capsule) {
+      delete static_cast<Tensor<Context>*>(
+          PyCapsule_GetPointer(capsule, nullptr));
+    });
+    CAFFE_ENFORCE(base, "Failed to keep the tensor alive in its view.");
+    view.release();
+    PyArray_SetBaseObject(array, base);
+    return obj;
+  }
 };
 
 template <class Context>
@@ -225,10 +263,60 @@ class TensorFeeder : public BlobFeederBase {
     context.FinishDeviceComputation();
   }
 
+  /**
+   * Makes tensor use the buffer of array instead of copying it, if array is
+   * a writeable, aligned and C-contiguous numpy array of a numeric type and
+   * tensor is on CPU. Returns false, leaving tensor untouched, otherwise.
+   *
+   * tensor keeps a reference to array until it is freed, resized beyond the
+   * buffer or fed again, so array stays valid even if python drops it. The
+   * memory is shared both ways: operators writing to tensor in place write
+   * to array, and python must not modify array while tensor uses it.
+   */
+  bool ShareTensor(PyArrayObject* array, Tensor<Context>* tensor) {
+    if (!std::is_same<Context, CPUContext>::value ||
+        !PyArray_CHKFLAGS(
+            array,
+            NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED | NPY_ARRAY_WRITEABLE)) {
+      return false;
+    }
+    const auto npy_type = PyArray_TYPE(array);
+    if (npy_type == NPY_OBJECT || npy_type == NPY_UNICODE) {
+      return false;
+    }
+    const TypeMeta& meta = NumpyTypeToCaffe(npy_type);
+    if (meta.id() == 0) {
+      return false;
+    }
+    const int ndim = PyArray_NDIM(array);
+    const npy_intp* npy_dims = PyArray_DIMS(array);
+    tensor->Resize(std::vector<TIndex>(npy_dims, npy_dims + ndim));
+    Py_INCREF(array);
+    tensor->ShareExternalPointer(
+        PyArray_DATA(array),
+        meta,
+        tensor->size() * meta.itemsize(),
+        ArrayReleaser{reinterpret_cast<PyObject*>(array)});
+    return true;
+  }
+
   virtual void
   Feed(const DeviceOption& option, PyArrayObject* original_array, Blob* blob) {
     FeedTensor(option, original_array, blob->GetMutable<Tensor<Context>>());
   }
+
+ private:
+  // Deleter of the tensors sharing the buffer of a numpy array
+  struct ArrayReleaser {
+    PyObject* array;
+    void operator()(void* /* unused */) const {
+      if (!Py_IsInitialized()) {
+        return;
+      }
+      pybind11::gil_scoped_acquire g;
+      Py_DECREF(array);
+    }
+  };
 };
 
 namespace python_detail {
@@ -12,6 +12,7 @@
 
 #include "caffe2/core/common_cudnn.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/operators/conv_op_cache_cudnn.h"
 #include "caffe2/operators/operator_fallback_gpu.h"
 
 namespace caffe2 {
@@ -50,6 +51,34 @@ void addCUDAGlobalMethods(py::module& m) {
     obj["totalGlobalMem"] = py::cast(prop.totalGlobalMem);
     return obj;
   });
+  m.def("load_cudnn_algorithms", [](const std::string& path) {
+    return PersistentAlgorithmsCache::Get().Load(path);
+  });
+  m.def("save_cudnn_algorithms", [](const std::string& path) {
+    PersistentAlgorithmsCache::Get().Save(path);
+  });
+  m.def("clear_cudnn_algorithms", []() {
+    PersistentAlgorithmsCache::Get().Clear();
+  });
+  m.def("cudnn_algorithms_stats", []() {
+    const auto& cache = PersistentAlgorithmsCache::Get();
+    std::map<std::string, size_t> stats;
+    stats["size"] = cache.size();
+    stats["hits"] = cache.hits();
+    stats["misses"] = cache.misses();
+    return stats;
+  });
+  m.def("cuda_memory_pool_stats", [](int gpu_id) {
+    const auto pool_stats = GetCudaMemoryPoolStats(gpu_id);
+    std::map<std::string, size_t> stats;
+    stats["allocated_bytes"] = pool_stats.allocated_bytes;
+    stats["peak_allocated_bytes"] = pool_stats.peak_allocated_bytes;
+    stats["cached_bytes"] = pool_stats.cached_bytes;
+    stats["num_allocs"] = pool_stats.num_allocs;
+    return stats;
+  });
+  m.def("reset_cuda_memory_pool_peaks", &ResetCudaMemoryPoolPeaks);
+  m.def("free_cached_cuda_memory", &FreeCachedCudaMemory);
 };
 
 void addCUDAObjectMethods(py::module& m) {
@@ -77,7 +106,9 @@ void addCUDAObjectMethods(py::module& m) {
           "Copy data from given DLPack tensor into this tensor.")
       .def_property_readonly(
           "_shape",
-          [](const DLPackWrapper<CUDAContext>& t) { return t.tensor->dims(); })
+          [](const DLPackWrapper<CUDAContext>& t) -> std::vector<TIndex> {
+            return t.tensor->dims();
+          })
       .def(
           "_reshape",
           [](DLPackWrapper<CUDAContext>* t, std::vector<TIndex> dims) {
@@ -74,13 +74,20 @@ class QueueWrapper(dataio.Pipe):
 
 class Queue(QueueWrapper):
     def __init__(self, capacity, schema=None, name='queue',
-                 num_dequeue_records=1):
+                 num_dequeue_records=1, shuffle=False, capacity_bytes=0):
+        """
+        With shuffle, the queue is a shuffle buffer: the readers wait for it
+        to hold capacity records, or capacity_bytes bytes when positive, and
+        get a random record of it.
+        """
         # find a unique blob name for the queue
         net = core.Net(name)
         queue_blob = net.AddExternalInput(net.NextName('handler'))
         QueueWrapper.__init__(
             self, queue_blob, schema, num_dequeue_records=num_dequeue_records)
         self.capacity = capacity
+        self.shuffle = shuffle
+        self.capacity_bytes = capacity_bytes
         self._setup_done = False
 
     def setup(self, global_init_net):
@@ -91,7 +98,9 @@ class Queue(QueueWrapper):
             [self._queue],
             capacity=self.capacity,
             num_blobs=len(self._schema.field_names()),
-            field_names=self._schema.field_names())
+            field_names=self._schema.field_names(),
+            shuffle=self.shuffle,
+            capacity_bytes=self.capacity_bytes)
 
 
 def enqueue(net, queue, data_blobs, status=None):
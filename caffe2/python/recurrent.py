@@ -12,6 +12,7 @@ def recurrent_net(
         net, cell_net, inputs, initial_cell_inputs,
         links, timestep=None, scope=None, outputs_with_grads=(0,),
         recompute_blobs_on_backward=None, forward_only=False,
+        recompute_segment_length=None, plan_step_memory=False,
 ):
     '''
     net: the main net operator should be added to
@@ -45,6 +46,16 @@ def recurrent_net(
                  stored for each forward timestep.
 
     forward_only: if True, only forward steps are executed
+
+    recompute_segment_length: if set, only the step workspaces of this many
+                 timesteps are stored on forward pass, and the backward pass
+                 recomputes the forward steps segment by segment. The memory
+                 of the intermediate blobs of the cell net then does not
+                 grow with the sequence length.
+
+    plan_step_memory: if True and forward_only, the intermediate blobs of the
+                 cell net are shared by all the timesteps, which run one
+                 after the other.
     '''
     assert len(inputs) == 1, "Only one input blob is supported so far"
 
@@ -257,6 +268,11 @@ def recurrent_net(
         }
         if len(backward_cell_net.Proto().op) != 0:
             backward_args['backward_step_net'] = backward_cell_net.Proto()
+        if recompute_segment_length is not None:
+            backward_args['recompute_segment_length'] = \
+                recompute_segment_length
+    elif plan_step_memory:
+        backward_args['plan_step_memory'] = True
 
 
     results = net.RecurrentNetwork(
@@ -286,7 +302,8 @@ def recurrent_net(
     return results[:-1]
 
 
-def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None):
+def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None,
+                            max_parallel_timesteps=None, wavefront=None):
     from caffe2.proto import caffe2_pb2
     assert rnn_op.type in {'RecurrentNetwork', 'RecurrentNetworkGradient'}
 
@@ -300,6 +317,10 @@ def set_rnn_executor_config(rnn_op, num_threads=None, max_cuda_streams=None):
         add_arg('num_threads', num_threads)
     if max_cuda_streams is not None:
         add_arg('max_cuda_streams', max_cuda_streams)
+    if max_parallel_timesteps is not None:
+        add_arg('max_parallel_timesteps', max_parallel_timesteps)
+    if wavefront is not None:
+        add_arg('wavefront', int(wavefront))
 
 
 def retrieve_step_blobs(net, prefix='rnn'):
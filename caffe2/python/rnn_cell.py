@@ -82,6 +82,7 @@ class RNNCell(object):
         seq_lengths=None,
         initial_states=None,
         outputs_with_grads=None,
+        recompute_segment_length=None,
     ):
         if initial_states is None:
             with scope.NameScope(self.name):
@@ -134,6 +135,7 @@ class RNNCell(object):
             forward_only=self.forward_only,
             outputs_with_grads=outputs_with_grads,
             recompute_blobs_on_backward=self.recompute_blobs,
+            recompute_segment_length=recompute_segment_length,
         )
 
         output = self._prepare_output_sequence(
@@ -1486,6 +1488,7 @@ def _LSTM(
     drop_states=False,
     return_last_layer_only=True,
     static_rnn_unroll_size=None,
+    recompute_segment_length=None,
     **cell_kwargs
 ):
     '''
@@ -1532,6 +1535,11 @@ def _LSTM(
     static_rnn_unroll_size: if not None, we will use static RNN which is
     unrolled into Caffe2 graph. The size of the unroll is the value of
     this parameter.
+
+    recompute_segment_length: if not None, only the activations of this
+    many timesteps are stored on forward pass, and the backward pass
+    recomputes them segment by segment, so that the memory they take does
+    not grow with the sequence length.
     '''
     if type(dim_out) is not list and type(dim_out) is not tuple:
         dim_out = [dim_out]
@@ -1569,6 +1577,7 @@ def _LSTM(
         seq_lengths=seq_lengths,
         initial_states=initial_states,
         outputs_with_grads=outputs_with_grads,
+        recompute_segment_length=recompute_segment_length,
     )
 
     if return_last_layer_only:
@@ -1600,7 +1609,10 @@ class UnrolledCell(RNNCell):
         seq_lengths,
         initial_states,
         outputs_with_grads=None,
+        recompute_segment_length=None,
     ):
+        # There is no recurrent op to recompute the steps of, the unrolled
+        # steps are plain ops of the net
         inputs = self.cell.prepare_input(model, inputs)
 
         # Now they are blob references - outputs of splitting the input sequence
@@ -72,6 +72,38 @@ class DoOpTest(TestCase):
         outer_Z_val = workspace.FetchBlob("outer_Z")
         self.assertTrue(np.all(outer_Z_val == np.asarray([3])))
 
+    def test_repeated_runs(self):
+        init_subnet = core.Net("init_subnet")
+        init_subnet.ConstantFill([], "Y", shape=[2], value=1)
+
+        subnet = core.Net("subnet")
+        subnet.Add(["X", "Y"], "Z")
+
+        net = core.Net("net")
+        net.CreateScope([], "W")
+        net.Do(
+            "W", "W",
+            net=init_subnet.Proto(),
+            inner_blobs=[],
+            outer_blobs_idx=[],
+        )
+        net.Do(
+            ["outer_X", "W"],
+            ["outer_Z", "W"],
+            net=subnet.Proto(),
+            inner_blobs=["X", "Z"],
+            outer_blobs_idx=[0, 1],
+            reuse_workspace=True,
+        )
+
+        workspace.ResetWorkspace()
+        workspace.CreateNet(net)
+        # The pooled and reused workspace reads the new outer blobs
+        for i in range(3):
+            workspace.FeedBlob("outer_X", np.asarray([i, 2 * i]))
+            workspace.RunNet(net)
+            np.testing.assert_array_equal(
+                workspace.FetchBlob("outer_Z"), [i + 1, 2 * i + 1])
 
 if __name__ == '__main__':
     unittest.main()
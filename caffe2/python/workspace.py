@@ -50,6 +50,13 @@ if has_gpu_support:
         return np.asarray(C.get_cuda_peer_access_pattern())
 
     GetDeviceProperties = C.get_device_properties
+    LoadCuDNNAlgorithms = C.load_cudnn_algorithms
+    SaveCuDNNAlgorithms = C.save_cudnn_algorithms
+    ClearCuDNNAlgorithms = C.clear_cudnn_algorithms
+    GetCuDNNAlgorithmsStats = C.cudnn_algorithms_stats
+    GetCudaMemoryPoolStats = C.cuda_memory_pool_stats
+    ResetCudaMemoryPoolPeaks = C.reset_cuda_memory_pool_peaks
+    FreeCachedCudaMemory = C.free_cached_cuda_memory
 else:
     NumCudaDevices = lambda: 0 # noqa
     GetCuDNNVersion = lambda: 0 # noqa
@@ -279,7 +286,7 @@ def GetNetName(net):
     raise Exception("Not a Net object: {}".format(str(net)))
 
 
-def FeedBlob(name, arr, device_option=None):
+def FeedBlob(name, arr, device_option=None, zero_copy=False):
     """Feeds a blob into the workspace.
 
     Inputs:
@@ -287,6 +294,12 @@ def FeedBlob(name, arr, device_option=None):
       arr: either a TensorProto object or a numpy array object to be fed into
           the workspace.
       device_option (optional): the device option to feed the data with.
+      zero_copy (optional): if True, a writeable, aligned and C-contiguous
+          numeric numpy array fed on CPU is not copied: the blob uses its
+          buffer and keeps a reference to it. Operators writing to the blob
+          in place then write to arr, and arr must not be modified while the
+          blob uses it, i.e. until the blob is fed again or resized. Other
+          arrays are copied as usual.
     Returns:
       True or False, stating whether the feed is successful.
     """
@@ -310,9 +323,10 @@ def FeedBlob(name, arr, device_option=None):
 
     name = StringifyBlobName(name)
     if device_option is not None:
-        return C.feed_blob(name, arr, StringifyProto(device_option))
+        return C.feed_blob(
+            name, arr, StringifyProto(device_option), zero_copy=zero_copy)
     else:
-        return C.feed_blob(name, arr)
+        return C.feed_blob(name, arr, zero_copy=zero_copy)
 
 
 def FetchBlobs(names):
@@ -326,15 +340,20 @@ def FetchBlobs(names):
     return [FetchBlob(name) for name in names]
 
 
-def FetchBlob(name):
+def FetchBlob(name, zero_copy=False):
     """Fetches a blob from the workspace.
 
     Inputs:
       name: the name of the blob - a string or a BlobReference
+      zero_copy (optional): if True, a numeric CPU tensor is returned as a
+          read-only numpy array viewing the tensor memory instead of a copy.
+          The array keeps the memory alive and is a snapshot: when the blob
+          is written while the array is alive, the blob gets a copy of the
+          data first, so the array never changes.
     Returns:
       Fetched blob (numpy array or string) if successful
     """
-    return C.fetch_blob(StringifyBlobName(name))
+    return C.fetch_blob(StringifyBlobName(name), zero_copy=zero_copy)
 
 
 def ApplyTransform(transform_key, net):
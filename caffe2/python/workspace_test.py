@@ -196,6 +196,24 @@ class TestWorkspace(unittest.TestCase):
         self.assertEqual(fetched_back.shape, (2, 0, 3))
         self.assertEqual(fetched_back.dtype, np.float32)
 
+    def testFetchFeedBlobZeroCopy(self):
+        data = np.ones((2, 3), dtype=np.float32)
+        self.assertEqual(
+            workspace.FeedBlob("testblob_shared", data, zero_copy=True), True)
+        # The blob uses the buffer of data
+        data[0, 0] = 2.0
+        self.assertEqual(workspace.FetchBlob("testblob_shared")[0, 0], 2.0)
+
+        fetched = workspace.FetchBlob("testblob_shared", zero_copy=True)
+        self.assertFalse(fetched.flags.writeable)
+        np.testing.assert_array_equal(fetched, data)
+        # Writing to the blob doesn't change what was fetched
+        workspace.RunOperatorOnce(core.CreateOperator(
+            "ConstantFill", [], ["testblob_shared"], shape=[2, 3], value=3.0))
+        np.testing.assert_array_equal(fetched, data)
+        np.testing.assert_array_equal(
+            workspace.FetchBlob("testblob_shared"), 3.0)
+
     def testFetchFeedLongStringTensor(self):
         # long strings trigger array of object creation
         strs = np.array([
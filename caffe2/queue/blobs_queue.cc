@@ -69,12 +69,18 @@ bool BlobsQueue::blockingRead(
   // Decrease queue balance before reading to indicate queue read pressure
   // is being increased (-ve queue balance indicates more reads than writes)
   CAFFE_EVENT(stats_, queue_balance, -1);
-  if (timeout_secs > 0) {
-    std::chrono::milliseconds timeout_ms(int(timeout_secs * 1000));
-    cv_.wait_for(
-        g, timeout_ms, [this, canRead]() { return closing_ || canRead(); });
-  } else {
-    cv_.wait(g, [this, canRead]() { return closing_ || canRead(); });
+  if (!canRead()) {
+    Timer blockedTimer;
+    CAFFE_SDT(queue_read_block, name, (void*)this);
+    if (timeout_secs > 0) {
+      std::chrono::milliseconds timeout_ms(int(timeout_secs * 1000));
+      cv_.wait_for(
+          g, timeout_ms, [this, canRead]() { return closing_ || canRead(); });
+    } else {
+      cv_.wait(g, [this, canRead]() { return closing_ || canRead(); });
+    }
+    CAFFE_SDT(queue_read_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
   }
   if (!canRead()) {
     if (timeout_secs > 0 && !closing_) {
@@ -86,6 +92,7 @@ bool BlobsQueue::blockingRead(
     return false;
   }
   DCHECK(canRead());
+  CAFFE_EVENT(stats_, queue_occupancy, writer_ - reader_);
   auto& result = queue_[reader_ % queue_.size()];
   CAFFE_ENFORCE(inputs.size() >= result.size());
   for (auto i = 0; i < result.size(); ++i) {
@@ -130,7 +137,13 @@ bool BlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
   // Increase queue balance before writing to indicate queue write pressure is
   // being increased (+ve queue balance indicates more writes than reads)
   CAFFE_EVENT(stats_, queue_balance, 1);
-  cv_.wait(g, [this]() { return closing_ || canWrite(); });
+  if (!canWrite()) {
+    Timer blockedTimer;
+    CAFFE_SDT(queue_write_block, name, (void*)this);
+    cv_.wait(g, [this]() { return closing_ || canWrite(); });
+    CAFFE_SDT(queue_write_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+  }
   if (!canWrite()) {
     CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
     return false;
@@ -157,6 +170,7 @@ bool BlobsQueue::canWrite() {
 }
 
 void BlobsQueue::doWrite(const std::vector<Blob*>& inputs) {
+  CAFFE_EVENT(stats_, queue_occupancy, writer_ - reader_);
   auto& result = queue_[writer_ % queue_.size()];
   CAFFE_ENFORCE(inputs.size() >= result.size());
   const auto& name = name_.c_str();
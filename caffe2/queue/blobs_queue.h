@@ -30,21 +30,21 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
       bool enforceUniqueName,
       const std::vector<std::string>& fieldNames = {});
 
-  ~BlobsQueue() {
+  virtual ~BlobsQueue() {
     close();
   }
 
-  bool blockingRead(
+  virtual bool blockingRead(
       const std::vector<Blob*>& inputs,
       float timeout_secs = 0.0f);
-  bool tryWrite(const std::vector<Blob*>& inputs);
-  bool blockingWrite(const std::vector<Blob*>& inputs);
-  void close();
+  virtual bool tryWrite(const std::vector<Blob*>& inputs);
+  virtual bool blockingWrite(const std::vector<Blob*>& inputs);
+  virtual void close();
   size_t getNumBlobs() const {
     return numBlobs_;
   }
 
- private:
+ protected:
   bool canWrite();
   void doWrite(const std::vector<Blob*>& inputs);
 
@@ -58,11 +58,18 @@ class BlobsQueue : public std::enable_shared_from_this<BlobsQueue> {
   std::vector<std::vector<Blob*>> queue_;
   const std::string name_;
 
+  // The queue_* stats are shared by the stages of an input pipeline, see
+  // PipelineReport in operators/stats_ops.cc
   struct QueueStats {
     CAFFE_STAT_CTOR(QueueStats);
     CAFFE_EXPORTED_STAT(queue_balance);
     CAFFE_EXPORTED_STAT(queue_dequeued_records);
     CAFFE_DETAILED_EXPORTED_STAT(queue_dequeued_bytes);
+    // time readers waited on an empty queue, and writers on a full one
+    CAFFE_EXPORTED_STAT(queue_read_blocked_ns);
+    CAFFE_EXPORTED_STAT(queue_write_blocked_ns);
+    // records in the queue, sampled at every read and write
+    CAFFE_HISTOGRAM_EXPORTED_STAT(queue_occupancy);
     CAFFE_AVG_EXPORTED_STAT(read_time_ns);
     CAFFE_AVG_EXPORTED_STAT(write_time_ns);
   } stats_;
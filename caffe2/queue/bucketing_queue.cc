@@ -0,0 +1,318 @@
+#include "bucketing_queue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "caffe2/core/timer.h"
+
+namespace caffe2 {
+
+BucketingQueue::BucketingQueue(
+    size_t capacity,
+    size_t numBlobs,
+    std::vector<int> boundaries,
+    float maxPadding,
+    const std::string& name)
+    : capacity_(capacity),
+      numBlobs_(numBlobs),
+      boundaries_(std::move(boundaries)),
+      maxPadding_(maxPadding),
+      buckets_(boundaries_.size() + 1),
+      stats_(name) {
+  CAFFE_ENFORCE_GT(capacity_, 0);
+  for (size_t i = 1; i < boundaries_.size(); ++i) {
+    CAFFE_ENFORCE_LT(
+        boundaries_[i - 1],
+        boundaries_[i],
+        "Bucket boundaries must be increasing");
+  }
+}
+
+BucketingQueue::~BucketingQueue() {
+  close();
+}
+
+size_t BucketingQueue::bucketIndex(int length) const {
+  return std::lower_bound(boundaries_.begin(), boundaries_.end(), length) -
+      boundaries_.begin();
+}
+
+BucketingQueue::Window BucketingQueue::bestWindow(size_t batchSize) const {
+  Window best{0, 0, 0, 2.0};
+  size_t fullest = 0;
+  for (size_t b = 0; b < buckets_.size(); ++b) {
+    const auto& bucket = buckets_[b];
+    if (bucket.size() > buckets_[fullest].size()) {
+      fullest = b;
+    }
+    if (bucket.size() < batchSize) {
+      continue;
+    }
+    // The examples are sorted by length, so the last one of a window is the
+    // longest
+    int64_t sum = 0;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      sum += bucket[i].length;
+      if (i >= batchSize) {
+        sum -= bucket[i - batchSize].length;
+      }
+      if (i + 1 < batchSize) {
+        continue;
+      }
+      const int64_t padded = batchSize * bucket[i].length;
+      const double padding = padded > 0 ? 1.0 - double(sum) / padded : 0.0;
+      if (padding < best.padding) {
+        best = {b, i + 1 - batchSize, i + 1, padding};
+      }
+    }
+  }
+  if (best.end > 0) {
+    return best;
+  }
+
+  // No bucket has batchSize examples
+  const auto& bucket = buckets_[fullest];
+  CAFFE_ENFORCE(!bucket.empty());
+  int64_t sum = 0;
+  for (const auto& example : bucket) {
+    sum += example.length;
+  }
+  const int64_t padded = bucket.size() * bucket.back().length;
+  return {fullest,
+          0,
+          bucket.size(),
+          padded > 0 ? 1.0 - double(sum) / padded : 0.0};
+}
+
+void BucketingQueue::gather(
+    CPUContext& context,
+    const std::vector<Example>& examples,
+    TensorCPU* lengths,
+    const std::vector<TensorCPU*>& outputs) {
+  CAFFE_ENFORCE(!examples.empty());
+
+  lengths->Resize(examples.size());
+  auto* lengthsData = lengths->mutable_data<int>();
+  TIndex totalLength = 0;
+  for (size_t i = 0; i < examples.size(); ++i) {
+    lengthsData[i] = examples[i].length;
+    totalLength += examples[i].length;
+  }
+
+  // Empty examples may come from empty tensors without a type, the outputs
+  // are shaped like the first example with values
+  const auto* reference = &examples[0];
+  for (const auto& example : examples) {
+    if (example.length > 0) {
+      reference = &example;
+      break;
+    }
+  }
+  const auto& batchZero = *reference->batch;
+  for (size_t j = 0; j < outputs.size(); ++j) {
+    const auto& meta = batchZero[j].meta();
+    auto outputDims = batchZero[j].dims();
+    outputDims[0] = totalLength;
+    const auto innerSize = batchZero[j].size_from_dim(1);
+    const auto rowBytes = innerSize * meta.itemsize();
+
+    outputs[j]->Resize(outputDims);
+    auto* destination = (char*)outputs[j]->raw_mutable_data(meta);
+    for (const auto& example : examples) {
+      // Skip empty examples
+      if (example.length == 0) {
+        continue;
+      }
+      const auto& input = (*example.batch)[j];
+      CAFFE_ENFORCE(input.meta() == meta);
+      CAFFE_ENFORCE_EQ(input.ndim(), batchZero[j].ndim());
+      for (int k = 1; k < input.ndim(); ++k) {
+        CAFFE_ENFORCE_EQ(input.dims()[k], batchZero[j].dims()[k]);
+      }
+      const auto numItems = example.length * innerSize;
+      if (numItems == 0) {
+        continue;
+      }
+      context.CopyItems<CPUContext, CPUContext>(
+          meta,
+          numItems,
+          (char*)input.raw_data() + example.offset * rowBytes /* src */,
+          destination /* dst */);
+      destination += numItems * meta.itemsize();
+    }
+  }
+}
+
+bool BucketingQueue::enqueue(
+    CPUContext& context,
+    const TensorCPU& lengths,
+    const std::vector<const TensorCPU*>& inputs) {
+  CAFFE_ENFORCE_EQ(numBlobs_, inputs.size());
+  CAFFE_ENFORCE_EQ(lengths.ndim(), 1);
+  const auto* lengthsData = lengths.data<int>();
+  TIndex totalLength = 0;
+  for (TIndex i = 0; i < lengths.size(); ++i) {
+    CAFFE_ENFORCE_GE(lengthsData[i], 0);
+    totalLength += lengthsData[i];
+  }
+
+  auto batch = std::make_shared<std::vector<TensorCPU>>();
+  batch->reserve(inputs.size());
+  for (const auto* tensorPtr : inputs) {
+    CAFFE_ENFORCE(tensorPtr);
+    CAFFE_ENFORCE(tensorPtr->ndim() > 0);
+    CAFFE_ENFORCE_EQ(
+        tensorPtr->dims().at(0),
+        totalLength,
+        "The values must have sum(lengths) rows");
+    batch->emplace_back(*tensorPtr, &context);
+  }
+
+  std::vector<Example> examples;
+  examples.reserve(lengths.size());
+  TIndex offset = 0;
+  for (TIndex i = 0; i < lengths.size(); ++i) {
+    examples.push_back(Example{batch, offset, lengthsData[i]});
+    offset += lengthsData[i];
+  }
+
+  size_t idx = 0;
+  while (idx < examples.size()) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      if (size_ >= capacity_ && !isClosed_) {
+        Timer blockedTimer;
+        cvOverflow_.wait(
+            lock, [this] { return size_ < capacity_ || isClosed_; });
+        CAFFE_EVENT(
+            stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+      }
+
+      if (isClosed_) {
+        // As for RebatchingQueue, a batch closed in the middle of enqueuing
+        // is a failure
+        return false;
+      }
+
+      CAFFE_EVENT(stats_, queue_occupancy, size_);
+      do {
+        auto& example = examples[idx++];
+        auto& bucket = buckets_[bucketIndex(example.length)];
+        // After the examples of the same length, to keep them in order
+        auto it = std::upper_bound(
+            bucket.begin(),
+            bucket.end(),
+            example.length,
+            [](int length, const Example& e) { return length < e.length; });
+        bucket.insert(it, std::move(example));
+        ++size_;
+      } while (size_ < capacity_ && idx < examples.size());
+    }
+
+    cvEmpty_.notify_all();
+  }
+
+  return true;
+}
+
+bool BucketingQueue::dequeue(
+    CPUContext& context,
+    size_t batchSize,
+    TensorCPU* lengths,
+    const std::vector<TensorCPU*>& outputs) {
+  CAFFE_ENFORCE_GT(batchSize, 0);
+  CAFFE_ENFORCE_EQ(numBlobs_, outputs.size());
+
+  std::vector<Example> results;
+  Window window;
+  bool forced = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    Timer blockedTimer;
+    bool blocked = false;
+    for (;;) {
+      if (size_ > 0) {
+        window = bestWindow(batchSize);
+        if (window.end - window.begin == batchSize &&
+            window.padding <= maxPadding_) {
+          break;
+        }
+        // Waiting for more examples would block the writers, or there won't
+        // be more
+        if (size_ >= capacity_ || isClosed_) {
+          forced = true;
+          break;
+        }
+      } else if (isClosed_) {
+        return false;
+      }
+      blocked = true;
+      cvEmpty_.wait(lock);
+    }
+    if (blocked) {
+      CAFFE_EVENT(stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+    }
+
+    CAFFE_EVENT(stats_, queue_occupancy, size_);
+    auto& bucket = buckets_[window.bucket];
+    results.assign(
+        std::make_move_iterator(bucket.begin() + window.begin),
+        std::make_move_iterator(bucket.begin() + window.end));
+    bucket.erase(bucket.begin() + window.begin, bucket.begin() + window.end);
+    size_ -= results.size();
+  }
+  cvOverflow_.notify_all();
+
+  gather(context, results, lengths, outputs);
+
+  int64_t realElements = 0;
+  for (const auto& example : results) {
+    realElements += example.length;
+  }
+  CAFFE_EVENT(stats_, queue_dequeued_records, results.size());
+  for (const auto* output : outputs) {
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, output->nbytes());
+  }
+  CAFFE_EVENT(stats_, bucketing_real_elements, realElements);
+  CAFFE_EVENT(
+      stats_,
+      bucketing_padded_elements,
+      results.size() * results.back().length);
+  CAFFE_EVENT(
+      stats_, bucketing_padding_pct, std::lround(window.padding * 100));
+  if (forced) {
+    CAFFE_EVENT(stats_, bucketing_forced_batches, 1);
+  }
+  return true;
+}
+
+size_t BucketingQueue::capacity() const {
+  return capacity_;
+}
+
+size_t BucketingQueue::numBlobs() const {
+  return numBlobs_;
+}
+
+size_t BucketingQueue::numBuckets() const {
+  return buckets_.size();
+}
+
+bool BucketingQueue::isClosed() const {
+  std::lock_guard<std::mutex> g(mutex_);
+  return isClosed_;
+}
+
+void BucketingQueue::close() {
+  {
+    std::lock_guard<std::mutex> g(mutex_);
+    isClosed_ = true;
+  }
+
+  cvEmpty_.notify_all();
+  cvOverflow_.notify_all();
+}
+} // caffe2
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/stats.h"
+#include "caffe2/core/tensor.h"
+
+namespace caffe2 {
+
+// A queue of variable-length examples which batches them by length, so that
+// padding the batches wastes little compute.
+//
+// The examples are enqueued in the lengths + values format: a lengths tensor
+// of the N examples and, for every blob, the values of all the examples
+// concatenated along the first dimension. An example goes to the bucket of
+// its length, bucket i holding the lengths in (boundaries[i - 1],
+// boundaries[i]] and the last one the lengths above the last boundary.
+//
+// A dequeue returns batch_size examples of a single bucket in the same
+// format, picked among the examples of the bucket with the closest lengths.
+// The padding of a batch is the fraction of the batch_size * max length
+// elements of the padded batch which are padding. A batch is only returned
+// if its padding is at most max_padding, unless the queue is full or closed:
+// then the best batch available is returned anyway, and the last ones may
+// have less than batch_size examples.
+class BucketingQueue {
+ public:
+  BucketingQueue(
+      size_t capacity,
+      size_t numBlobs,
+      std::vector<int> boundaries,
+      float maxPadding = 1.0,
+      const std::string& name = "bucketing_queue");
+
+  ~BucketingQueue();
+
+  bool enqueue(
+      CPUContext& context,
+      const TensorCPU& lengths,
+      const std::vector<const TensorCPU*>& inputs);
+
+  bool dequeue(
+      CPUContext& context,
+      size_t batchSize,
+      TensorCPU* lengths,
+      const std::vector<TensorCPU*>& outputs);
+
+  size_t capacity() const;
+
+  size_t numBlobs() const;
+
+  size_t numBuckets() const;
+
+  bool isClosed() const;
+
+  void close();
+
+ private:
+  // An example, as a range of rows of an enqueued batch. The tensors of a
+  // batch are freed with the last of its examples.
+  struct Example {
+    std::shared_ptr<const std::vector<TensorCPU>> batch;
+    TIndex offset;
+    int length;
+  };
+
+  // A batch of the examples [begin, end) of a bucket, sorted by length
+  struct Window {
+    size_t bucket;
+    size_t begin;
+    size_t end;
+    double padding;
+  };
+
+  size_t bucketIndex(int length) const;
+
+  // The window of at most batchSize examples of a bucket with the least
+  // padding, or the first one of the fullest bucket if no bucket has
+  // batchSize examples. Requires a non-empty queue.
+  Window bestWindow(size_t batchSize) const;
+
+  static void gather(
+      CPUContext& context,
+      const std::vector<Example>& examples,
+      TensorCPU* lengths,
+      const std::vector<TensorCPU*>& outputs);
+
+  const size_t capacity_;
+  const size_t numBlobs_;
+  const std::vector<int> boundaries_;
+  const float maxPadding_;
+
+  mutable std::mutex mutex_;
+
+  bool isClosed_{false};
+  size_t size_{0};
+
+  std::condition_variable cvEmpty_;
+  std::condition_variable cvOverflow_;
+
+  // The examples of every bucket, sorted by length
+  std::vector<std::vector<Example>> buckets_;
+
+  // Same stats as BlobsQueue, in examples, and the padding of the batches
+  struct QueueStats {
+    CAFFE_STAT_CTOR(QueueStats);
+    CAFFE_EXPORTED_STAT(queue_dequeued_records);
+    CAFFE_EXPORTED_STAT(queue_dequeued_bytes);
+    CAFFE_EXPORTED_STAT(queue_read_blocked_ns);
+    CAFFE_EXPORTED_STAT(queue_write_blocked_ns);
+    CAFFE_HISTOGRAM_EXPORTED_STAT(queue_occupancy);
+    // Sum of the lengths of the dequeued examples, and number of elements
+    // of the batches padded to their max length
+    CAFFE_EXPORTED_STAT(bucketing_real_elements);
+    CAFFE_EXPORTED_STAT(bucketing_padded_elements);
+    // Padding of the batches, in percent
+    CAFFE_HISTOGRAM_EXPORTED_STAT(bucketing_padding_pct);
+    // Batches returned short of batch_size or above max_padding, because
+    // the queue was full or closed
+    CAFFE_EXPORTED_STAT(bucketing_forced_batches);
+  } stats_;
+};
+} // caffe2
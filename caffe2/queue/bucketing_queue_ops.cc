@@ -0,0 +1,83 @@
+#include "bucketing_queue_ops.h"
+
+namespace caffe2 {
+
+CAFFE_KNOWN_TYPE(BucketingQueuePtr);
+
+namespace {
+
+REGISTER_CPU_OPERATOR(CreateBucketingQueue, CreateBucketingQueueOp);
+REGISTER_CPU_OPERATOR(EnqueueBucketingQueue, EnqueueBucketingQueueOp);
+REGISTER_CPU_OPERATOR(DequeueBucketingQueue, DequeueBucketingQueueOp);
+REGISTER_CPU_OPERATOR(CloseBucketingQueue, CloseBucketingQueueOp);
+
+NO_GRADIENT(CreateBucketingQueue);
+NO_GRADIENT(EnqueueBucketingQueue);
+NO_GRADIENT(DequeueBucketingQueue);
+NO_GRADIENT(CloseBucketingQueue);
+
+OPERATOR_SCHEMA(CreateBucketingQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .SetDoc(R"DOC(
+Creates a queue which batches variable-length examples by length, to limit
+the padding of the batches.
+
+The examples go to the bucket of their length: bucket i holds the lengths in
+(boundaries[i - 1], boundaries[i]], the last bucket the lengths above the
+last boundary. A dequeue returns the examples of a single bucket with the
+closest lengths. The queue exports the usual queue stats, and the padding
+of the batches: bucketing_real_elements (sum of the lengths),
+bucketing_padded_elements (batch size times max length),
+bucketing_padding_pct and bucketing_forced_batches.
+)DOC")
+    .Output(0, "queue", "object representing the queue")
+    .Arg("num_blobs", "Number of value tensors of an example")
+    .Arg(
+        "capacity",
+        "Maximal number of examples the queue can hold at any given point")
+    .Arg("boundaries", "Increasing upper bounds of the lengths of the buckets")
+    .Arg(
+        "max_padding",
+        "Maximal fraction of padding of a batch padded to its max length. "
+        "Batches above it are only returned when the queue is full or "
+        "closed. 1 by default, i.e. any batch of a bucket.");
+
+OPERATOR_SCHEMA(CloseBucketingQueue)
+    .NumInputs(1)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Closes the Queue.
+)DOC")
+    .Input(0, "queue", "object representing the queue");
+
+OPERATOR_SCHEMA(EnqueueBucketingQueue)
+    .NumInputs(3, INT_MAX)
+    .NumOutputs(0)
+    .SetDoc(R"DOC(
+Enqueues examples into the queue, in the lengths + values format: the
+lengths of the N examples, then for every blob the values of the examples
+concatenated along the first dimension, which has sum(lengths) rows.
+If the Queue is closed this operation will fail.
+)DOC")
+    .Input(0, "queue", "object representing the queue")
+    .Input(1, "lengths", "int32 tensor of the lengths of the examples")
+    .Input(2, "values", "First tensor of values of the examples");
+
+OPERATOR_SCHEMA(DequeueBucketingQueue)
+    .NumInputs(1)
+    .NumOutputs(2, INT_MAX)
+    .SetDoc(R"DOC(
+Dequeues a batch of examples of a single bucket, in the same lengths + values
+format as they were enqueued, e.g. to be padded with PackSegments.
+The batch has batch_size examples and at most max_padding padding, unless the
+queue is full or closed: the best batch available is returned then, with less
+than batch_size examples if there are not enough. Fails once the queue is
+closed and empty.
+)DOC")
+    .Input(0, "queue", "object representing the queue")
+    .Output(0, "lengths", "int32 tensor of the lengths of the examples")
+    .Output(1, "values", "First tensor of values of the examples")
+    .Arg("batch_size", "Number of examples to dequeue, 1 by default.");
+}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bucketing_queue.h"
+
+namespace caffe2 {
+
+using BucketingQueuePtr = std::unique_ptr<BucketingQueue>;
+
+class CreateBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  CreateBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws), name_(operator_def.output().Get(0)) {}
+
+  bool RunOnDevice() override {
+    *OperatorBase::Output<BucketingQueuePtr>(0) =
+        BucketingQueuePtr(new BucketingQueue(
+            OperatorBase::GetSingleArgument<int>("capacity", 1),
+            OperatorBase::GetSingleArgument<int>("num_blobs", 1),
+            OperatorBase::GetRepeatedArgument<int>("boundaries"),
+            OperatorBase::GetSingleArgument<float>("max_padding", 1.0),
+            name_));
+    return true;
+  }
+
+ private:
+  const std::string name_;
+};
+
+class EnqueueBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  EnqueueBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CHECK(queue);
+    CAFFE_ENFORCE_EQ(InputSize(), queue->numBlobs() + 2);
+    std::vector<const TensorCPU*> inputTensors;
+    inputTensors.reserve(InputSize() - 2);
+    for (int i = 2; i < InputSize(); ++i) {
+      inputTensors.push_back(&Input(i));
+    }
+
+    return queue->enqueue(context_, Input(1), inputTensors);
+  }
+};
+
+class DequeueBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  DequeueBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws),
+        batchSize_(OperatorBase::GetSingleArgument<int>("batch_size", 1)) {}
+
+  bool RunOnDevice() override {
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CHECK(queue);
+
+    std::vector<TensorCPU*> outputTensors;
+    outputTensors.reserve(OutputSize() - 1);
+    for (int i = 1; i < OutputSize(); ++i) {
+      outputTensors.push_back(Output(i));
+    }
+
+    return queue->dequeue(context_, batchSize_, Output(0), outputTensors);
+  }
+
+ private:
+  int batchSize_;
+};
+
+class CloseBucketingQueueOp : public Operator<CPUContext> {
+ public:
+  CloseBucketingQueueOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator(operator_def, ws) {}
+
+  bool RunOnDevice() override {
+    CAFFE_ENFORCE_EQ(InputSize(), 1);
+    auto& queue = Inputs()[0]->template Get<BucketingQueuePtr>();
+    CAFFE_ENFORCE(queue);
+    queue->close();
+    return true;
+  }
+};
+} // caffe2
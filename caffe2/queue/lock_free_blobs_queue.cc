@@ -0,0 +1,253 @@
+#include "caffe2/queue/lock_free_blobs_queue.h"
+
+#include <chrono>
+
+#include "caffe2/core/blob_stats.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+
+namespace caffe2 {
+
+// Constants for user tracepoints
+static constexpr int SDT_NONBLOCKING_OP = 0;
+static constexpr int SDT_BLOCKING_OP = 1;
+static constexpr uint64_t SDT_TIMEOUT = (uint64_t)-1;
+static constexpr uint64_t SDT_ABORT = (uint64_t)-2;
+static constexpr uint64_t SDT_CANCEL = (uint64_t)-3;
+
+LockFreeBlobsQueue::LockFreeBlobsQueue(
+    Workspace* ws,
+    const std::string& queueName,
+    size_t capacity,
+    size_t numBlobs,
+    bool enforceUniqueName,
+    const std::vector<std::string>& fieldNames)
+    : BlobsQueue(
+          ws,
+          queueName,
+          capacity,
+          numBlobs,
+          enforceUniqueName,
+          fieldNames),
+      capacity_(capacity),
+      sequences_(capacity) {
+  CAFFE_ENFORCE_GT(capacity, 0);
+  // The sequence of a slot is 2 * pos when the slot is free for the writer
+  // of position pos, and 2 * pos + 1 when it is full for the reader of pos.
+  // Doubling keeps the two apart when the capacity is 1.
+  for (int64_t i = 0; i < capacity_; ++i) {
+    sequences_[i].store(2 * i, std::memory_order_relaxed);
+  }
+}
+
+bool LockFreeBlobsQueue::slotReadable() {
+  auto pos = readPos_.load(std::memory_order_relaxed);
+  return sequences_[pos % capacity_].load(std::memory_order_acquire) ==
+      2 * pos + 1;
+}
+
+bool LockFreeBlobsQueue::slotWritable() {
+  auto pos = writePos_.load(std::memory_order_relaxed);
+  return sequences_[pos % capacity_].load(std::memory_order_acquire) ==
+      2 * pos;
+}
+
+bool LockFreeBlobsQueue::tryRead(const std::vector<Blob*>& inputs) {
+  auto pos = readPos_.load(std::memory_order_relaxed);
+  while (true) {
+    auto& sequence = sequences_[pos % capacity_];
+    auto diff = sequence.load(std::memory_order_acquire) - (2 * pos + 1);
+    if (diff == 0) {
+      if (readPos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The writer of this position hasn't finished
+      return false;
+    } else {
+      pos = readPos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  CAFFE_EVENT(
+      stats_,
+      queue_occupancy,
+      writePos_.load(std::memory_order_relaxed) - pos);
+  auto& result = queue_[pos % capacity_];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  for (auto i = 0; i < result.size(); ++i) {
+    auto bytes = BlobStat::sizeBytes(*result[i]);
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, bytes, i);
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  // Free the slot for the writer of the position a lap later
+  sequences_[pos % capacity_].store(
+      2 * (pos + capacity_), std::memory_order_release);
+  CAFFE_SDT(
+      queue_read_end,
+      name_.c_str(),
+      (void*)this,
+      writePos_.load(std::memory_order_relaxed) - pos - 1);
+  CAFFE_EVENT(stats_, queue_dequeued_records);
+  notify(&writers_);
+  return true;
+}
+
+bool LockFreeBlobsQueue::doTryWrite(const std::vector<Blob*>& inputs) {
+  auto pos = writePos_.load(std::memory_order_relaxed);
+  while (true) {
+    auto& sequence = sequences_[pos % capacity_];
+    auto diff = sequence.load(std::memory_order_acquire) - 2 * pos;
+    if (diff == 0) {
+      if (writePos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The reader of the previous lap hasn't finished
+      return false;
+    } else {
+      pos = writePos_.load(std::memory_order_relaxed);
+    }
+  }
+
+  CAFFE_EVENT(
+      stats_,
+      queue_occupancy,
+      pos - readPos_.load(std::memory_order_relaxed));
+  auto& result = queue_[pos % capacity_];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  for (auto i = 0; i < result.size(); ++i) {
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  sequences_[pos % capacity_].store(2 * pos + 1, std::memory_order_release);
+  CAFFE_SDT(
+      queue_write_end,
+      name_.c_str(),
+      (void*)this,
+      readPos_.load(std::memory_order_relaxed) + capacity_ - pos - 1);
+  notify(&readers_);
+  return true;
+}
+
+void LockFreeBlobsQueue::notify(Waiters* waiters) {
+  // Pairs with the fence of a thread going to block: either it sees the
+  // slot we just published, or we see it waiting
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiters->count.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> g(waiters->mutex);
+    waiters->cv.notify_one();
+  }
+}
+
+bool LockFreeBlobsQueue::blockingRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  Timer readTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
+  // Decrease queue balance before reading to indicate queue read pressure
+  // is being increased (-ve queue balance indicates more reads than writes)
+  CAFFE_EVENT(stats_, queue_balance, -1);
+  bool read = tryRead(inputs);
+  if (!read) {
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(int(timeout_secs * 1000));
+    bool timedOut = false;
+    Timer blockedTimer;
+    CAFFE_SDT(queue_read_block, name, (void*)this);
+    readers_.count.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!(read = tryRead(inputs)) && !closing_ && !timedOut) {
+      // Only check the slot under the lock, reading it would notify the
+      // writers while holding the lock of the readers
+      std::unique_lock<std::mutex> g(readers_.mutex);
+      if (slotReadable() || closing_) {
+        continue;
+      }
+      if (timeout_secs > 0) {
+        timedOut =
+            readers_.cv.wait_until(g, deadline) == std::cv_status::timeout;
+      } else {
+        readers_.cv.wait(g);
+      }
+    }
+    readers_.count.fetch_sub(1, std::memory_order_relaxed);
+    CAFFE_SDT(queue_read_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+    if (!read) {
+      if (timedOut && !closing_) {
+        LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+        CAFFE_SDT(queue_read_end, name, (void*)this, SDT_TIMEOUT);
+      } else {
+        CAFFE_SDT(queue_read_end, name, (void*)this, SDT_CANCEL);
+      }
+      return false;
+    }
+  }
+  CAFFE_EVENT(stats_, read_time_ns, readTimer.NanoSeconds());
+  return true;
+}
+
+bool LockFreeBlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_NONBLOCKING_OP);
+  if (!doTryWrite(inputs)) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  // Increase queue balance to indicate queue write pressure is being
+  // increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+bool LockFreeBlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_BLOCKING_OP);
+  // Increase queue balance before writing to indicate queue write pressure is
+  // being increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  bool written = doTryWrite(inputs);
+  if (!written) {
+    Timer blockedTimer;
+    CAFFE_SDT(queue_write_block, name, (void*)this);
+    writers_.count.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!(written = doTryWrite(inputs)) && !closing_) {
+      std::unique_lock<std::mutex> g(writers_.mutex);
+      if (!slotWritable() && !closing_) {
+        writers_.cv.wait(g);
+      }
+    }
+    writers_.count.fetch_sub(1, std::memory_order_relaxed);
+    CAFFE_SDT(queue_write_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+    if (!written) {
+      CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+      return false;
+    }
+  }
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+void LockFreeBlobsQueue::close() {
+  closing_ = true;
+
+  for (auto* waiters : {&readers_, &writers_}) {
+    std::lock_guard<std::mutex> g(waiters->mutex);
+    waiters->cv.notify_all();
+  }
+}
+
+} // namespace caffe2
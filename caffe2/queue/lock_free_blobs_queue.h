@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "caffe2/queue/blobs_queue.h"
+
+namespace caffe2 {
+
+// A BlobsQueue whose readers and writers don't share a lock.
+// Modelled as a bounded multi-producer multi-consumer ring buffer: every slot
+// has a sequence number telling whether it is free for the writer or full for
+// the reader of a position, and readers and writers claim positions with a
+// compare and swap. The mutexes and condition variables are only used by
+// the threads which have to block, and an operation wakes a single blocked
+// thread of the other side.
+//
+// Reads and writes swap the blobs with the slots, and reads keep returning
+// the blobs written before close, like BlobsQueue.
+class LockFreeBlobsQueue : public BlobsQueue {
+ public:
+  LockFreeBlobsQueue(
+      Workspace* ws,
+      const std::string& queueName,
+      size_t capacity,
+      size_t numBlobs,
+      bool enforceUniqueName,
+      const std::vector<std::string>& fieldNames = {});
+
+  ~LockFreeBlobsQueue() {
+    close();
+  }
+
+  bool blockingRead(
+      const std::vector<Blob*>& inputs,
+      float timeout_secs = 0.0f) override;
+  bool tryWrite(const std::vector<Blob*>& inputs) override;
+  bool blockingWrite(const std::vector<Blob*>& inputs) override;
+  void close() override;
+
+ private:
+  // Threads blocked on one side of the queue
+  struct Waiters {
+    std::atomic<int> count{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+
+  // Whether the next position can be claimed, without claiming it
+  bool slotReadable();
+  bool slotWritable();
+  bool tryRead(const std::vector<Blob*>& inputs);
+  bool doTryWrite(const std::vector<Blob*>& inputs);
+  void notify(Waiters* waiters);
+
+  const int64_t capacity_;
+  std::vector<std::atomic<int64_t>> sequences_;
+  // The positions are padded to keep readers and writers on different
+  // cache lines
+  std::atomic<int64_t> readPos_{0};
+  char padding0_[64];
+  std::atomic<int64_t> writePos_{0};
+  char padding1_[64];
+
+  Waiters readers_;
+  Waiters writers_;
+};
+} // namespace caffe2
@@ -17,7 +17,26 @@ REGISTER_CPU_OPERATOR(
     WeightedSampleDequeueBlobs,
     WeightedSampleDequeueBlobsOp<CPUContext>);
 
-OPERATOR_SCHEMA(CreateBlobsQueue).NumInputs(0).NumOutputs(1);
+OPERATOR_SCHEMA(CreateBlobsQueue)
+    .NumInputs(0)
+    .NumOutputs(1)
+    .Arg("capacity", "Number of records the queue holds, default: 1")
+    .Arg("num_blobs", "Number of blobs of a record, default: 1")
+    .Arg(
+        "lock_free",
+        "Whether readers and writers use a lock-free ring buffer instead of "
+        "sharing a lock, default: false. It scales better with many threads "
+        "blocked on the queue.")
+    .Arg(
+        "shuffle",
+        "Whether the queue is a shuffle buffer, default: false. Reads wait "
+        "for the queue to be full, or closed, and return a random record of "
+        "it, so records streamed in order come out in near random order.")
+    .Arg(
+        "capacity_bytes",
+        "With shuffle, the queue is also full once its records take this "
+        "many bytes, default: 0 for no limit")
+    .Arg("seed", "With shuffle, seed of the sampling, default: random");
 OPERATOR_SCHEMA(EnqueueBlobs)
     .NumInputsOutputs([](int inputs, int outputs) {
       return inputs >= 2 && outputs >= 1 && inputs == outputs + 1;
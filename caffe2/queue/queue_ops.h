@@ -2,6 +2,8 @@
 
 #include <memory>
 #include "blobs_queue.h"
+#include "lock_free_blobs_queue.h"
+#include "shuffle_blobs_queue.h"
 #include "caffe2/core/operator.h"
 #include "caffe2/utils/math.h"
 
@@ -24,12 +26,35 @@ class CreateBlobsQueueOp final : public Operator<Context> {
         GetSingleArgument("enforce_unique_name", false);
     const auto fieldNames =
         OperatorBase::template GetRepeatedArgument<std::string>("field_names");
+    const auto lockFree = GetSingleArgument("lock_free", false);
+    const auto shuffle = GetSingleArgument("shuffle", false);
+    CAFFE_ENFORCE(
+        !(lockFree && shuffle), "A shuffle queue can't be lock-free");
     CAFFE_ENFORCE_EQ(this->OutputSize(), 1);
     auto queuePtr = Operator<Context>::Outputs()[0]
                         ->template GetMutable<std::shared_ptr<BlobsQueue>>();
     CAFFE_ENFORCE(queuePtr);
-    *queuePtr = std::make_shared<BlobsQueue>(
-        ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    if (shuffle) {
+      const auto capacityBytes =
+          OperatorBase::template GetSingleArgument<int64_t>(
+              "capacity_bytes", 0);
+      const auto seed = GetSingleArgument("seed", -1);
+      *queuePtr = std::make_shared<ShuffleBlobsQueue>(
+          ws_,
+          name,
+          capacity,
+          numBlobs,
+          enforceUniqueName,
+          fieldNames,
+          capacityBytes,
+          seed);
+    } else if (lockFree) {
+      *queuePtr = std::make_shared<LockFreeBlobsQueue>(
+          ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    } else {
+      *queuePtr = std::make_shared<BlobsQueue>(
+          ws_, name, capacity, numBlobs, enforceUniqueName, fieldNames);
+    }
     return true;
   }
 
@@ -1,104 +1,98 @@
 #include "rebatching_queue.h"
-#include "caffe2/utils/smart_tensor_printer.h"
 
-namespace caffe2 {
+#include "caffe2/core/timer.h"
 
-namespace {
+namespace caffe2 {
 
-// This concat function will always create a new first dimension to concat
-void concat(
+void RebatchingQueue::gather(
     CPUContext& context,
-    const std::vector<std::vector<TensorCPU>>& inputs,
+    const std::vector<Row>& rows,
     const std::vector<TensorCPU*>& outputs) {
-  CAFFE_ENFORCE(!inputs.empty());
-
-  const auto& inputZero = inputs[0];
-  const auto numTensors = inputZero.size();
-  const auto numRows = inputs.size();
-
-  // Precompute the output sizes to avoid resizing
-  std::vector<std::vector<TIndex>> outputDims(numTensors);
-
-  for (int i = 0; i < numTensors; ++i) {
-    SmartTensorPrinter::PrintTensor(inputZero.at(i));
-    outputDims[i] = inputZero.at(i).dims();
-    outputDims[i].insert(outputDims[i].begin(), numRows);
-  }
-
-  // Resize to the final output size
-  std::vector<void*> destinations(numTensors);
-  for (int i = 0; i < numTensors; ++i) {
-    outputs[i]->Resize(outputDims[i]);
-    destinations[i] = outputs[i]->raw_mutable_data(inputZero[i].meta());
-  }
-
-  for (int i = 0; i < numRows; ++i) {
-    CAFFE_ENFORCE_EQ(inputs[i].size(), numTensors);
+  CAFFE_ENFORCE(!rows.empty());
+
+  const auto& batchZero = *rows[0].batch;
+  const auto numTensors = batchZero.size();
+  const auto numRows = rows.size();
+
+  // Contiguous rows of a batch are copied at once
+  struct Range {
+    const std::vector<TensorCPU>* batch;
+    TIndex begin;
+    TIndex end;
+  };
+  std::vector<Range> ranges;
+  for (const auto& row : rows) {
+    const auto* batch = row.batch.get();
+    if (!ranges.empty() && ranges.back().batch == batch &&
+        ranges.back().end == row.index) {
+      ranges.back().end++;
+      continue;
+    }
 
+    CAFFE_ENFORCE_EQ(batch->size(), numTensors);
     for (int j = 0; j < numTensors; ++j) {
-      const auto& input = inputs[i][j];
-
-      CAFFE_ENFORCE(inputZero[j].meta() == input.meta());
-      CAFFE_ENFORCE_EQ(inputZero[j].itemsize(), input.itemsize());
-      CAFFE_ENFORCE_EQ(inputZero[j].ndim(), input.ndim());
-      for (int k = 0; k < input.ndim(); ++k) {
-        CAFFE_ENFORCE_EQ(input.dims()[k], inputZero[j].dims()[k]);
-      }
-
-      // Skip empty tensors
-      if (input.size() == 0) {
-        continue;
+      const auto& input = (*batch)[j];
+      CAFFE_ENFORCE(batchZero[j].meta() == input.meta());
+      CAFFE_ENFORCE_EQ(batchZero[j].ndim(), input.ndim());
+      for (int k = 1; k < input.ndim(); ++k) {
+        CAFFE_ENFORCE_EQ(input.dims()[k], batchZero[j].dims()[k]);
       }
-
-      context.CopyItems<CPUContext, CPUContext>(
-          input.meta(),
-          input.size(),
-          input.raw_data() /* src */,
-          destinations[j] /* dst */
-          );
-
-      destinations[j] =
-          (char*)destinations[j] + input.size() * input.itemsize();
     }
+    ranges.push_back({batch, row.index, row.index + 1});
   }
-}
 
-std::vector<std::vector<TensorCPU>> split(
-    CPUContext& context,
-    const std::vector<const TensorCPU*>& inputs) {
-  CAFFE_ENFORCE(!inputs.empty());
-
-  const auto outputSize = inputs[0]->dims().at(0);
-  std::vector<std::vector<TensorCPU>> outputs(outputSize);
-
-  for (const auto* inputPtr : inputs) {
-    CAFFE_ENFORCE(inputPtr);
-
-    const auto& input = *inputPtr;
-    const auto innerSize = input.size_from_dim(1);
-    const auto itemSize = input.meta().itemsize();
+  for (int j = 0; j < numTensors; ++j) {
+    auto outputDims = batchZero[j].dims();
+    outputDims[0] = numRows;
+    const auto& meta = batchZero[j].meta();
+    const auto innerSize = batchZero[j].size_from_dim(1);
+    const auto rowBytes = innerSize * meta.itemsize();
+
+    if (ranges.size() == 1 && numRows * rowBytes > 0) {
+      // Share the rows with the output, which keeps the batch alive
+      const auto& range = ranges[0];
+      auto batch = rows[0].batch;
+      outputs[j]->Resize(outputDims);
+      outputs[j]->ShareExternalPointer(
+          (char*)(*batch)[j].raw_data() + range.begin * rowBytes,
+          meta,
+          numRows * rowBytes,
+          [batch](void*) {});
+      continue;
+    }
 
-    auto outputDims = input.dims();
-    CAFFE_ENFORCE(!outputDims.empty());
-    outputDims.erase(outputDims.begin());
-    CAFFE_ENFORCE_EQ(input.dims().at(0), outputSize);
+    // The output may share the rows of a batch which are still queued
+    if (outputs[j]->shares_data()) {
+      outputs[j]->FreeMemory();
+    }
+    outputs[j]->Resize(outputDims);
+    auto* destination = (char*)outputs[j]->raw_mutable_data(meta);
+    for (const auto& range : ranges) {
+      const auto& input = (*range.batch)[j];
+      const auto numItems = (range.end - range.begin) * innerSize;
+      // Skip empty tensors
+      if (numItems == 0) {
+        continue;
+      }
 
-    for (int i = 0; i < outputSize; ++i) {
-      outputs[i].push_back(TensorCPU(outputDims));
       context.CopyItems<CPUContext, CPUContext>(
-          input.meta(),
-          innerSize,
-          (char*)input.raw_data() + i * innerSize * itemSize /* src */,
-          outputs[i].back().raw_mutable_data(input.meta()) /* dst */);
+          meta,
+          numItems,
+          (char*)input.raw_data() + range.begin * rowBytes /* src */,
+          destination /* dst */);
+      destination += numItems * meta.itemsize();
     }
   }
-
-  return outputs;
 }
-} // anonymous namespace
 
-RebatchingQueue::RebatchingQueue(size_t capacity, size_t numBlobs)
-    : capacity_(capacity), numBlobs_(numBlobs), queue_(capacity) {}
+RebatchingQueue::RebatchingQueue(
+    size_t capacity,
+    size_t numBlobs,
+    const std::string& name)
+    : capacity_(capacity),
+      numBlobs_(numBlobs),
+      queue_(capacity),
+      stats_(name) {}
 
 RebatchingQueue::~RebatchingQueue() {
   close();
@@ -112,7 +106,7 @@ bool RebatchingQueue::dequeue(
     CPUContext& context,
     size_t numElements,
     const std::vector<TensorCPU*>& outputs) {
-  std::vector<std::vector<TensorCPU>> results;
+  std::vector<Row> results;
   results.reserve(numElements);
 
   for (;;) {
@@ -123,13 +117,20 @@ bool RebatchingQueue::dequeue(
     {
       std::unique_lock<std::mutex> lock(mutex_);
 
-      cvEmpty_.wait(lock, [this] { return canRead() || isClosed_; });
+      if (!canRead() && !isClosed_) {
+        Timer blockedTimer;
+        cvEmpty_.wait(lock, [this] { return canRead() || isClosed_; });
+        CAFFE_EVENT(
+            stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+      }
 
       // We only want to stop reading if the queue is empty and closed
       if (!canRead() && isClosed_) {
         break;
       }
 
+      CAFFE_EVENT(stats_, queue_occupancy, head_ - tail_);
+
       do {
         results.push_back(std::move(queue_[tail_++ % capacity()]));
       } while (canRead() && results.size() < numElements);
@@ -146,8 +147,12 @@ bool RebatchingQueue::dequeue(
     return false;
   }
 
-  concat(context, results, outputs);
+  gather(context, results, outputs);
 
+  CAFFE_EVENT(stats_, queue_dequeued_records, results.size());
+  for (const auto* output : outputs) {
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, output->nbytes());
+  }
   return true;
 }
 
@@ -156,41 +161,62 @@ bool RebatchingQueue::canWrite() const {
 }
 
 bool RebatchingQueue::enqueueOne(
-    CPUContext& /*context*/,
+    CPUContext& context,
     const std::vector<const TensorCPU*>& inputs) {
-  std::vector<std::vector<TensorCPU>> splittedInputs;
-  splittedInputs.emplace_back();
-  auto& tensorVector = splittedInputs.back();
-  tensorVector.reserve(inputs.size());
+  // Stored as a batch of one row
+  auto batch = std::make_shared<std::vector<TensorCPU>>();
+  batch->reserve(inputs.size());
   for (const auto* tensorPtr : inputs) {
-    tensorVector.push_back(*tensorPtr);
+    CAFFE_ENFORCE(tensorPtr);
+    batch->emplace_back(*tensorPtr, &context);
+    auto dims = tensorPtr->dims();
+    dims.insert(dims.begin(), 1);
+    batch->back().Reshape(dims);
   }
 
-  return enqueue(std::move(splittedInputs));
+  return enqueue({Row{std::move(batch), 0}});
 }
 
 bool RebatchingQueue::enqueueMany(
     CPUContext& context,
     const std::vector<const TensorCPU*>& inputs) {
   CAFFE_ENFORCE_EQ(numBlobs_, inputs.size());
+  CAFFE_ENFORCE(!inputs.empty());
 
-  std::vector<std::vector<TensorCPU>> splittedInputs;
-  splittedInputs = split(context, inputs);
-  return enqueue(std::move(splittedInputs));
+  const auto numRows = inputs[0]->dims().at(0);
+  auto batch = std::make_shared<std::vector<TensorCPU>>();
+  batch->reserve(inputs.size());
+  for (const auto* tensorPtr : inputs) {
+    CAFFE_ENFORCE(tensorPtr);
+    CAFFE_ENFORCE(tensorPtr->ndim() > 0);
+    CAFFE_ENFORCE_EQ(tensorPtr->dims().at(0), numRows);
+    batch->emplace_back(*tensorPtr, &context);
+  }
+
+  std::vector<Row> rows;
+  rows.reserve(numRows);
+  for (TIndex i = 0; i < numRows; ++i) {
+    rows.push_back(Row{batch, i});
+  }
+  return enqueue(std::move(rows));
 }
 
-bool RebatchingQueue::enqueue(
-    std::vector<std::vector<TensorCPU>> splittedInputs) {
+bool RebatchingQueue::enqueue(std::vector<Row> rows) {
   int idx = 0;
   for (;;) {
-    if (idx >= splittedInputs.size()) {
+    if (idx >= rows.size()) {
       break;
     }
 
     {
       std::unique_lock<std::mutex> lock(mutex_);
 
-      cvOverflow_.wait(lock, [this] { return canWrite() || isClosed_; });
+      if (!canWrite() && !isClosed_) {
+        Timer blockedTimer;
+        cvOverflow_.wait(lock, [this] { return canWrite() || isClosed_; });
+        CAFFE_EVENT(
+            stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+      }
 
       if (isClosed_) {
         // If we are here it means that we didn't apply the entire batch and if
@@ -198,9 +224,10 @@ bool RebatchingQueue::enqueue(
         return false;
       }
 
+      CAFFE_EVENT(stats_, queue_occupancy, head_ - tail_);
       do {
-        queue_[head_++ % capacity()] = std::move(splittedInputs[idx++]);
-      } while (canWrite() && idx < splittedInputs.size());
+        queue_[head_++ % capacity()] = std::move(rows[idx++]);
+      } while (canWrite() && idx < rows.size());
     }
 
     cvEmpty_.notify_all();
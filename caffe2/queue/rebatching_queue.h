@@ -17,9 +17,17 @@ namespace caffe2 {
 // atomic index + circular queue optimizations or pull something more
 // heavy-weight later
 
+// The enqueued tensors are copied once, and the queue holds references to
+// their rows. A dequeue gathers the rows with a copy per contiguous range of
+// an enqueued batch, and doesn't copy at all when the rows are a single range:
+// the outputs then share the memory of the enqueued batch.
+
 class RebatchingQueue {
  public:
-  RebatchingQueue(size_t capacity, size_t numBlobs);
+  RebatchingQueue(
+      size_t capacity,
+      size_t numBlobs,
+      const std::string& name = "rebatching_queue");
 
   ~RebatchingQueue();
 
@@ -45,7 +53,20 @@ class RebatchingQueue {
   void close();
 
  private:
-  bool enqueue(std::vector<std::vector<TensorCPU>> splittedInputs);
+  // A row of an enqueued batch. The tensors of a batch are freed with the
+  // last of its rows, or output sharing them.
+  struct Row {
+    std::shared_ptr<const std::vector<TensorCPU>> batch;
+    TIndex index;
+  };
+
+  bool enqueue(std::vector<Row> rows);
+
+  // Writes the rows to the outputs, with a new first dimension
+  static void gather(
+      CPUContext& context,
+      const std::vector<Row>& rows,
+      const std::vector<TensorCPU*>& outputs);
 
   bool canWrite() const;
   bool canRead() const;
@@ -63,6 +84,16 @@ class RebatchingQueue {
   std::condition_variable cvEmpty_;
   std::condition_variable cvOverflow_;
 
-  std::vector<std::vector<TensorCPU>> queue_;
+  std::vector<Row> queue_;
+
+  // Same stats as BlobsQueue, in rows
+  struct QueueStats {
+    CAFFE_STAT_CTOR(QueueStats);
+    CAFFE_EXPORTED_STAT(queue_dequeued_records);
+    CAFFE_EXPORTED_STAT(queue_dequeued_bytes);
+    CAFFE_EXPORTED_STAT(queue_read_blocked_ns);
+    CAFFE_EXPORTED_STAT(queue_write_blocked_ns);
+    CAFFE_HISTOGRAM_EXPORTED_STAT(queue_occupancy);
+  } stats_;
 };
 } // caffe2
@@ -0,0 +1,168 @@
+#include "caffe2/queue/shuffle_blobs_queue.h"
+
+#include "caffe2/core/blob_stats.h"
+#include "caffe2/core/logging.h"
+#include "caffe2/core/timer.h"
+
+namespace caffe2 {
+
+// Constants for user tracepoints
+static constexpr int SDT_NONBLOCKING_OP = 0;
+static constexpr int SDT_BLOCKING_OP = 1;
+static constexpr uint64_t SDT_TIMEOUT = (uint64_t)-1;
+static constexpr uint64_t SDT_ABORT = (uint64_t)-2;
+static constexpr uint64_t SDT_CANCEL = (uint64_t)-3;
+
+ShuffleBlobsQueue::ShuffleBlobsQueue(
+    Workspace* ws,
+    const std::string& queueName,
+    size_t capacity,
+    size_t numBlobs,
+    bool enforceUniqueName,
+    const std::vector<std::string>& fieldNames,
+    size_t capacityBytes,
+    int seed)
+    : BlobsQueue(
+          ws,
+          queueName,
+          capacity,
+          numBlobs,
+          enforceUniqueName,
+          fieldNames),
+      capacityBytes_(capacityBytes),
+      recordBytes_(capacity),
+      randgen_(seed >= 0 ? seed : std::random_device()()) {
+  CAFFE_ENFORCE_GT(capacity, 0);
+}
+
+bool ShuffleBlobsQueue::full() const {
+  return size_ == queue_.size() ||
+      (capacityBytes_ > 0 && bytes_ >= capacityBytes_);
+}
+
+bool ShuffleBlobsQueue::blockingRead(
+    const std::vector<Blob*>& inputs,
+    float timeout_secs) {
+  Timer readTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_read_start, name, (void*)this, SDT_BLOCKING_OP);
+  std::unique_lock<std::mutex> g(mutex_);
+  // The records are only sampled from a full reservoir, until the writers
+  // are done
+  auto canRead = [this]() { return size_ > 0 && (full() || closing_); };
+  // Decrease queue balance before reading to indicate queue read pressure
+  // is being increased (-ve queue balance indicates more reads than writes)
+  CAFFE_EVENT(stats_, queue_balance, -1);
+  if (!canRead()) {
+    Timer blockedTimer;
+    CAFFE_SDT(queue_read_block, name, (void*)this);
+    if (timeout_secs > 0) {
+      std::chrono::milliseconds timeout_ms(int(timeout_secs * 1000));
+      cv_.wait_for(
+          g, timeout_ms, [this, canRead]() { return closing_ || canRead(); });
+    } else {
+      cv_.wait(g, [this, canRead]() { return closing_ || canRead(); });
+    }
+    CAFFE_SDT(queue_read_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_read_blocked_ns, blockedTimer.NanoSeconds());
+  }
+  if (!canRead()) {
+    if (timeout_secs > 0 && !closing_) {
+      LOG(ERROR) << "DequeueBlobs timed out in " << timeout_secs << " secs";
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_TIMEOUT);
+    } else {
+      CAFFE_SDT(queue_read_end, name, (void*)this, SDT_CANCEL);
+    }
+    return false;
+  }
+  CAFFE_EVENT(stats_, queue_occupancy, size_);
+  const auto index = std::uniform_int_distribution<size_t>(0, size_ - 1)(
+      randgen_);
+  auto& result = queue_[index];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  for (auto i = 0; i < result.size(); ++i) {
+    auto bytes = BlobStat::sizeBytes(*result[i]);
+    CAFFE_EVENT(stats_, queue_dequeued_bytes, bytes, i);
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+  }
+  // Move the last record in the hole, the blobs of the slot we read from
+  // now hold the data given by the reader, and are reused by the next write
+  --size_;
+  bytes_ -= recordBytes_[index];
+  std::swap(queue_[index], queue_[size_]);
+  std::swap(recordBytes_[index], recordBytes_[size_]);
+  ++reader_;
+  CAFFE_SDT(queue_read_end, name, (void*)this, size_);
+  CAFFE_EVENT(stats_, queue_dequeued_records);
+  cv_.notify_all();
+  CAFFE_EVENT(stats_, read_time_ns, readTimer.NanoSeconds());
+  return true;
+}
+
+bool ShuffleBlobsQueue::tryWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_NONBLOCKING_OP);
+  std::unique_lock<std::mutex> g(mutex_);
+  if (full()) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  // Increase queue balance before writing to indicate queue write pressure is
+  // being increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  insert(inputs);
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+bool ShuffleBlobsQueue::blockingWrite(const std::vector<Blob*>& inputs) {
+  Timer writeTimer;
+  auto keeper = this->shared_from_this();
+  const auto& name = name_.c_str();
+  CAFFE_SDT(queue_write_start, name, (void*)this, SDT_BLOCKING_OP);
+  std::unique_lock<std::mutex> g(mutex_);
+  // Increase queue balance before writing to indicate queue write pressure is
+  // being increased (+ve queue balance indicates more writes than reads)
+  CAFFE_EVENT(stats_, queue_balance, 1);
+  if (full()) {
+    Timer blockedTimer;
+    CAFFE_SDT(queue_write_block, name, (void*)this);
+    cv_.wait(g, [this]() { return closing_ || !full(); });
+    CAFFE_SDT(queue_write_unblock, name, (void*)this);
+    CAFFE_EVENT(stats_, queue_write_blocked_ns, blockedTimer.NanoSeconds());
+  }
+  if (full()) {
+    CAFFE_SDT(queue_write_end, name, (void*)this, SDT_ABORT);
+    return false;
+  }
+  insert(inputs);
+  CAFFE_EVENT(stats_, write_time_ns, writeTimer.NanoSeconds());
+  return true;
+}
+
+void ShuffleBlobsQueue::insert(const std::vector<Blob*>& inputs) {
+  CAFFE_EVENT(stats_, queue_occupancy, size_);
+  auto& result = queue_[size_];
+  CAFFE_ENFORCE(inputs.size() >= result.size());
+  size_t bytes = 0;
+  for (auto i = 0; i < result.size(); ++i) {
+    using std::swap;
+    swap(*(inputs[i]), *(result[i]));
+    if (capacityBytes_ > 0) {
+      bytes += BlobStat::sizeBytes(*result[i]);
+    }
+  }
+  recordBytes_[size_] = bytes;
+  bytes_ += bytes;
+  ++size_;
+  ++writer_;
+  CAFFE_SDT(
+      queue_write_end, name_.c_str(), (void*)this, queue_.size() - size_);
+  cv_.notify_all();
+}
+
+} // namespace caffe2
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "caffe2/queue/blobs_queue.h"
+
+namespace caffe2 {
+
+// A BlobsQueue returning its records in random order, used as a shuffle
+// buffer in front of readers which only read sequentially.
+// The queue is a reservoir of up to capacity records, and of up to
+// capacityBytes bytes when it is positive: reads wait for the reservoir to
+// be full, or closed, and take a random record out of it, making room for
+// the next record written. The blobs are swapped in and out of the
+// reservoir like BlobsQueue, so no record is copied.
+//
+// Once closed, reads drain the records left in random order.
+class ShuffleBlobsQueue : public BlobsQueue {
+ public:
+  ShuffleBlobsQueue(
+      Workspace* ws,
+      const std::string& queueName,
+      size_t capacity,
+      size_t numBlobs,
+      bool enforceUniqueName,
+      const std::vector<std::string>& fieldNames = {},
+      size_t capacityBytes = 0,
+      int seed = -1);
+
+  bool blockingRead(
+      const std::vector<Blob*>& inputs,
+      float timeout_secs = 0.0f) override;
+  bool tryWrite(const std::vector<Blob*>& inputs) override;
+  bool blockingWrite(const std::vector<Blob*>& inputs) override;
+
+ private:
+  // Whether the reservoir is full, in records or in bytes
+  bool full() const;
+  void insert(const std::vector<Blob*>& inputs);
+
+  const size_t capacityBytes_;
+  // the records of the reservoir are queue_[0, size_), with their sizes
+  size_t size_{0};
+  size_t bytes_{0};
+  std::vector<size_t> recordBytes_;
+  std::mt19937 randgen_;
+};
+} // namespace caffe2
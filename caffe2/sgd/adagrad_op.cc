@@ -31,6 +31,49 @@ and returns (new_param, new_moment).
         "Default 1. If it is in (0, 1), the gradient square sum "
         "is decayed by this factor.");
 
+REGISTER_CPU_OPERATOR(
+    MultiTensorAdagrad,
+    MultiTensorAdagradOp<float, CPUContext>);
+OPERATOR_SCHEMA(MultiTensorAdagrad)
+    .NumInputsOutputs([](int in, int out) {
+      return in % 3 == 1 && out == (in - 1) / 3 * 2;
+    })
+    .AllowInplace([](int in, int out) {
+      return in % 3 != 2 && out == in / 3 * 2 + in % 3;
+    })
+    .TensorInferenceFunction(
+        [](const OperatorDef& /* unused */, const vector<TensorShape>& in) {
+          vector<TensorShape> out;
+          for (int i = 0; i + 1 < in.size(); i += 3) {
+            out.push_back(in[i]);
+            out.push_back(in[i + 1]);
+          }
+          return out;
+        })
+    .SetDoc(R"DOC(
+
+Computes the AdaGrad update of a list of parameters in one operator, which
+saves the overhead of running an operator, or launching a kernel, for every
+parameter of models with many small parameters. The inputs are
+(param, moment, grad) for every parameter then the learning rate shared by
+all of them, and the outputs (output_param, output_moment) for every
+parameter, computed as by Adagrad.
+
+The elements of all parameters are split in chunks, which are spread over the
+threads of the workspace pool on CPU and computed by a single kernel on CUDA.
+
+)DOC")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "decay",
+        "Default 1. If it is in (0, 1), the gradient square sum "
+        "is decayed by this factor.")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the chunks are split "
+        "between on CPU: 0, the default, uses all of them and 1 the calling "
+        "thread");
+
 REGISTER_CPU_OPERATOR(SparseAdagrad, SparseAdagradOp<float, CPUContext>);
 OPERATOR_SCHEMA(SparseAdagrad)
     .NumInputs(5)
@@ -42,6 +85,9 @@ Given inputs (param, moment, indices, grad, lr), runs the dense AdaGrad
 update on (param, grad, moment[indices], lr), and returns (new_param,
 new_moment) as in the dense case.
 
+param and moment can also be float16 tables. The update is then computed in
+float and written back with stochastic rounding.
+
 )DOC")
     .Input(0, "param", "Parameters to be updated")
     .Input(1, "moment", "Moment history")
@@ -79,7 +125,62 @@ also be a 1D tensor indexing into the rows of param.
     .Output(1, "output_moment_1", "Updated moment")
     .Arg("epsilon", "Default 1e-5");
 
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumSparseAdagrad,
+    SparseLengthsSumSparseAdagradOp<float, CPUContext, false>);
+OPERATOR_SCHEMA(SparseLengthsSumSparseAdagrad)
+    .NumInputs(6)
+    .NumOutputs(2)
+    .EnforceOneToOneInplace()
+    .SetDoc(R"DOC(
+
+Fused SparseLengthsSumGradient and SparseAdagrad. Given inputs (param, moment,
+indices, grad, lr, lengths), where grad is the gradient of the output of
+SparseLengthsSum(param, indices, lengths), runs the SparseAdagrad update on
+(param, moment, indices, lr) with the gradient of each row of param looked up
+by indices, and returns (new_param, new_moment). The gradient of every looked
+up row is the row of grad of its segment; it is never materialized.
+
+)DOC")
+    .Input(0, "param", "Parameters to be updated")
+    .Input(1, "moment", "Moment history")
+    .Input(2, "indices", "Sparse indices")
+    .Input(3, "grad", "Gradient of the output of SparseLengthsSum")
+    .Input(4, "lr", "learning rate")
+    .Input(5, "lengths", "Lengths of the segments of indices")
+    .Output(0, "output_param", "Updated parameters")
+    .Output(1, "output_moment_1", "Updated moment")
+    .Arg("epsilon", "Default 1e-5");
+
+REGISTER_CPU_OPERATOR(
+    SparseLengthsSumRowWiseSparseAdagrad,
+    SparseLengthsSumSparseAdagradOp<float, CPUContext, true>);
+OPERATOR_SCHEMA(SparseLengthsSumRowWiseSparseAdagrad)
+    .NumInputs(6)
+    .NumOutputs(2)
+    .EnforceOneToOneInplace()
+    .SetDoc(R"DOC(
+
+Fused SparseLengthsSumGradient and RowWiseSparseAdagrad. Same as
+SparseLengthsSumSparseAdagrad, with the row-wise moment of RowWiseSparseAdagrad:
+shape(moment) == shape(param)[0]. All the rows of a segment get the same
+gradient, so the average squared sum is computed once per segment.
+
+)DOC")
+    .Input(0, "param", "Parameters to be updated")
+    .Input(1, "moment", "Moment history")
+    .Input(2, "indices", "Sparse indices")
+    .Input(3, "grad", "Gradient of the output of SparseLengthsSum")
+    .Input(4, "lr", "learning rate")
+    .Input(5, "lengths", "Lengths of the segments of indices")
+    .Output(0, "output_param", "Updated parameters")
+    .Output(1, "output_moment_1", "Updated moment")
+    .Arg("epsilon", "Default 1e-5");
+
 SHOULD_NOT_DO_GRADIENT(Adagrad);
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdagrad);
 SHOULD_NOT_DO_GRADIENT(SparseAdagrad);
 SHOULD_NOT_DO_GRADIENT(RowWiseSparseAdagrad);
+SHOULD_NOT_DO_GRADIENT(SparseLengthsSumSparseAdagrad);
+SHOULD_NOT_DO_GRADIENT(SparseLengthsSumRowWiseSparseAdagrad);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/adagrad.h"
+#include "caffe2/sgd/multi_tensor.h"
 
 namespace caffe2 {
 
@@ -23,6 +25,42 @@ void adagrad_update(
   }
 }
 
+// The elements of a chunk of a MultiTensorAdagrad
+struct AdagradChunk {
+  const float* w;
+  const float* g;
+  const float* h;
+  float* nw;
+  float* nh;
+  int n;
+};
+
+template <typename Context>
+void multi_tensor_adagrad_update(
+    const std::vector<AdagradChunk>& chunks,
+    float epsilon,
+    float decay,
+    const float* lr,
+    Workspace* ws,
+    const int num_threads,
+    Tensor<Context>* /*scratch*/,
+    Context* context) {
+  RunMultiTensorChunks<AdagradChunk>(
+      chunks, ws, num_threads, [&](const AdagradChunk& chunk) {
+        adagrad_update<Context>(
+            chunk.n,
+            chunk.w,
+            chunk.g,
+            chunk.h,
+            chunk.nw,
+            chunk.nh,
+            epsilon,
+            decay,
+            lr,
+            context);
+      });
+}
+
 template <typename T, class Context>
 class AdagradOp final : public Operator<Context> {
  public:
@@ -58,6 +96,73 @@ class AdagradOp final : public Operator<Context> {
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
 
+// Adagrad of a list of parameters: the inputs are (param, moment, grad) for
+// every parameter, then lr, and the outputs (param, moment) for every
+// parameter
+template <typename T, class Context>
+class MultiTensorAdagradOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorAdagradOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        epsilon_(OperatorBase::GetSingleArgument<T>("epsilon", 1e-5f)),
+        decay_(OperatorBase::GetSingleArgument<T>("decay", 1.0f)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+    CAFFE_ENFORCE_EQ((InputSize() - 1) % 3, 0);
+    CAFFE_ENFORCE_EQ(OutputSize(), (InputSize() - 1) / 3 * 2);
+  }
+
+  bool RunOnDevice() override {
+    const int num_tensors = OutputSize() / 2;
+    const auto& lr = Input(InputSize() - 1);
+    CAFFE_ENFORCE_EQ(lr.size(), 1);
+    sizes_.clear();
+    for (int i = 0; i < num_tensors; ++i) {
+      const auto& param = Input(3 * i);
+      CAFFE_ENFORCE_EQ(Input(3 * i + 1).size(), param.size());
+      CAFFE_ENFORCE_EQ(Input(3 * i + 2).size(), param.size());
+      Output(2 * i)->ResizeLike(param);
+      Output(2 * i + 1)->ResizeLike(Input(3 * i + 1));
+      sizes_.push_back(param.size());
+    }
+
+    chunks_.clear();
+    ForEachMultiTensorChunk(sizes_, [this](int i, TIndex offset, int n) {
+      chunks_.push_back(AdagradChunk{
+          Input(3 * i).template data<T>() + offset,
+          Input(3 * i + 2).template data<T>() + offset,
+          Input(3 * i + 1).template data<T>() + offset,
+          Output(2 * i)->template mutable_data<T>() + offset,
+          Output(2 * i + 1)->template mutable_data<T>() + offset,
+          n});
+    });
+    multi_tensor_adagrad_update<Context>(
+        chunks_,
+        epsilon_,
+        decay_,
+        lr.template data<T>(),
+        ws_,
+        num_threads_,
+        &scratch_,
+        &context_);
+    return true;
+  }
+
+ protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the chunks are split between on
+  // CPU: 0 uses all of them, 1 the calling thread
+  int num_threads_;
+  T epsilon_;
+  T decay_;
+  std::vector<TIndex> sizes_;
+  std::vector<AdagradChunk> chunks_;
+  // The chunks copied to the device
+  Tensor<Context> scratch_;
+};
+
 template <typename T, class Context>
 class SparseAdagradOp final : public Operator<Context> {
  public:
@@ -80,6 +185,10 @@ class SparseAdagradOp final : public Operator<Context> {
 
   template <typename SIndex>
   bool DoRunWithType() {
+    if (Input(PARAM).template IsType<float16>()) {
+      return DoRunWithFloat16<SIndex>();
+    }
+
     const auto* lr = Input(LR).template data<T>();
     const auto* indices = Input(INDICES).template data<SIndex>();
     const auto* gradIn = Input(GRAD).template data<T>();
@@ -140,6 +249,33 @@ class SparseAdagradOp final : public Operator<Context> {
     return true;
   }
 
+  // Half precision tables: the update is computed in float and written back
+  // with stochastic rounding.
+  template <typename SIndex>
+  bool DoRunWithFloat16() {
+    CAFFE_ENFORCE(
+        Input(MOMENT_1).template IsType<float16>(),
+        "float16 parameters need float16 moments");
+    const auto n = Input(INDICES).size();
+    if (n == 0) {
+      return true;
+    }
+    SparseAdagradFloat16<SIndex>(
+        Input(GRAD).size() / n,
+        n,
+        Input(PARAM).dim(0),
+        Input(PARAM).template data<float16>(),
+        Input(MOMENT_1).template data<float16>(),
+        Input(INDICES).template data<SIndex>(),
+        Input(GRAD).template data<T>(),
+        Input(LR).template data<T>()[0],
+        epsilon_,
+        context_.RandGenerator()(),
+        Output(OUTPUT_PARAM)->template mutable_data<float16>(),
+        Output(OUTPUT_MOMENT_1)->template mutable_data<float16>());
+    return true;
+  }
+
  protected:
   T epsilon_;
   INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
@@ -182,61 +318,94 @@ class RowWiseSparseAdagradOp final : public Operator<Context> {
     }
 
     auto block_size = Input(GRAD).size() / n;
+    RowWiseSparseAdagrad<SIndex>(
+        block_size,
+        n,
+        Input(PARAM).dim(0),
+        paramIn,
+        momentIn,
+        indices,
+        gradIn,
+        lr[0],
+        epsilon_,
+        paramOut,
+        momentOut);
+    return true;
+  }
 
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-      if (block_size == 1) {
-        float gi = gradIn[i];
-        float hi = momentOut[idx] = momentIn[idx] + gi * gi;
-        paramOut[idx] = paramIn[idx] + lr[0] * gi / (std::sqrt(hi) + epsilon_);
-      } else {
-        auto offsetI = i * block_size;
-        auto offsetIdx = idx * block_size;
+ protected:
+  T epsilon_;
+  INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
+  OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
+};
 
-#ifndef NDEBUG
-        CAFFE_ENFORCE_GE(
-            Input(PARAM).size(),
-            block_size + offsetIdx,
-            this->debug_def().input(PARAM),
-            ", out of bound,  idx:",
-            idx,
-            " for input i:",
-            i,
-            " and block size:",
-            block_size);
-        CAFFE_ENFORCE_GE(
-            Input(GRAD).size(),
-            block_size + offsetI,
-            this->debug_def().input(GRAD),
-            ", out of bound idx, idx:",
-            idx,
-            " for input i:",
-            i);
-#endif
+// SparseLengthsSumGradient followed by SparseAdagrad (or RowWiseSparseAdagrad
+// if is_rowwise), without materializing the gradient of every looked up row.
+template <typename T, class Context, bool is_rowwise>
+class SparseLengthsSumSparseAdagradOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  SparseLengthsSumSparseAdagradOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
 
-        const float* w = paramIn + offsetIdx;
-        const float* g = gradIn + offsetI;
-        const float* h = momentIn + idx;
-        float* nw = paramOut + offsetIdx;
-        float* nh = momentOut + idx;
-        float hs = 0.;
-        for (auto j = 0; j < block_size; ++j) {
-          float gj = g[j];
-          hs += gj * gj;
-        }
-        float hi = nh[0] = h[0] + hs / block_size;
-        float step = lr[0] / (std::sqrt(hi) + epsilon_);
-        for (auto j = 0; j < block_size; ++j) {
-          nw[j] = w[j] + g[j] * step;
-        }
-      }
+  bool RunOnDevice() override {
+    // Enforce shapes
+    if (is_rowwise) {
+      CAFFE_ENFORCE_EQ(Input(PARAM).dims()[0], Input(MOMENT_1).size());
+    } else {
+      CAFFE_ENFORCE_EQ(Input(PARAM).size(), Input(MOMENT_1).size());
+    }
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(INDICES).ndim(), 1, "INDICES must be a vector");
+    CAFFE_ENFORCE_EQ(Input(LENGTHS).ndim(), 1, "LENGTHS must be a vector");
+    CAFFE_ENFORCE_GT(Input(GRAD).ndim(), 0, "GRAD can not be a scalar");
+    CAFFE_ENFORCE_EQ(
+        Input(GRAD).dim(0),
+        Input(LENGTHS).size(),
+        "GRAD must have one row per segment");
+    CAFFE_ENFORCE_EQ(
+        Input(PARAM).size_from_dim(1), Input(GRAD).size_from_dim(1));
+
+    return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
+        this, Input(INDICES));
+  }
+
+  template <typename SIndex>
+  bool DoRunWithType() {
+    const auto& param = Input(PARAM);
+    const auto& indices = Input(INDICES);
+    const auto& lengths = Input(LENGTHS);
+
+    if (indices.size() == 0) {
+      return true;
     }
+
+    const auto kernel = is_rowwise
+        ? SparseLengthsSumRowWiseSparseAdagrad<SIndex>
+        : SparseLengthsSumSparseAdagrad<SIndex>;
+    kernel(
+        param.size_from_dim(1),
+        lengths.size(),
+        indices.size(),
+        param.dim(0),
+        param.template data<T>(),
+        Input(MOMENT_1).template data<T>(),
+        indices.template data<SIndex>(),
+        lengths.template data<int>(),
+        Input(GRAD).template data<T>(),
+        Input(LR).template data<T>()[0],
+        epsilon_,
+        Output(OUTPUT_PARAM)->template mutable_data<T>(),
+        Output(OUTPUT_MOMENT_1)->template mutable_data<T>());
     return true;
   }
 
  protected:
   T epsilon_;
-  INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR);
+  INPUT_TAGS(PARAM, MOMENT_1, INDICES, GRAD, LR, LENGTHS);
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1);
 };
 }
@@ -2,6 +2,7 @@
 #include "adagrad_op.h"
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/multi_tensor_gpu.h"
 #include "caffe2/utils/mixed_utils.h"
 
 namespace caffe2 {
@@ -42,6 +43,41 @@ void adagrad_update<CUDAContext>(
       context->cuda_stream()>>>(N, w, g, h, nw, nh, epsilon, decay, lr);
 }
 
+__global__ void MultiTensorAdagradKernel(
+    const AdagradChunk* chunks,
+    float epsilon,
+    float decay,
+    const float* lr) {
+  const AdagradChunk chunk = chunks[blockIdx.x];
+  const float LR = lr[0];
+  for (int i = threadIdx.x; i < chunk.n; i += blockDim.x) {
+    float gi = chunk.g[i];
+    float hi = chunk.nh[i] = decay * chunk.h[i] + gi * gi;
+    chunk.nw[i] = chunk.w[i] + LR * gi / (std::sqrt(hi) + epsilon);
+  }
+}
+
+template <>
+void multi_tensor_adagrad_update<CUDAContext>(
+    const std::vector<AdagradChunk>& chunks,
+    float epsilon,
+    float decay,
+    const float* lr,
+    Workspace* /*ws*/,
+    const int /*num_threads*/,
+    Tensor<CUDAContext>* scratch,
+    CUDAContext* context) {
+  if (chunks.empty()) {
+    return;
+  }
+  MultiTensorAdagradKernel<<<
+      chunks.size(),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      CopyMultiTensorChunks(chunks, scratch, context), epsilon, decay, lr);
+}
+
 template <typename SIndex, typename THalf>
 __global__ void SparseAdagradKernel(
     const size_t N,
@@ -215,6 +251,9 @@ bool RowWiseSparseAdagradOp<float, CUDAContext>::DoRunWithType() {
 }
 
 REGISTER_CUDA_OPERATOR(Adagrad, AdagradOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MultiTensorAdagrad,
+    MultiTensorAdagradOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(SparseAdagrad, CUDASparseAdagradOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(
     RowWiseSparseAdagrad,
@@ -38,11 +38,53 @@ and returns (param_o, m1_o, m2_o)
     .Arg("beta2", "Default 0.999")
     .Arg("epsilon", "Default 1e-5");
 
+REGISTER_CPU_OPERATOR(MultiTensorAdam, MultiTensorAdamOp<float, CPUContext>);
+OPERATOR_SCHEMA(MultiTensorAdam)
+    .NumInputsOutputs([](int in, int out) {
+      return in >= 2 && (in - 2) % 4 == 0 && out == (in - 2) / 4 * 3;
+    })
+    .AllowInplace([](int in, int out) {
+      return in % 4 != 3 && out == in / 4 * 3 + in % 4;
+    })
+    .TensorInferenceFunction(
+        [](const OperatorDef& /* unused */, const vector<TensorShape>& in) {
+          vector<TensorShape> out;
+          for (int i = 0; i + 2 < in.size(); i += 4) {
+            out.push_back(in[i]);
+            out.push_back(in[i + 1]);
+            out.push_back(in[i + 2]);
+          }
+          return out;
+        })
+    .SetDoc(R"DOC(
+
+Computes the Adam update of a list of parameters in one operator, which saves
+the overhead of running an operator, or launching a kernel, for every
+parameter of models with many small parameters. The inputs are
+(param, moment_1, moment_2, grad) for every parameter then the learning rate
+and the iteration number shared by all of them, and the outputs
+(output_param, output_moment_1, output_moment_2) for every parameter,
+computed as by Adam.
+
+The elements of all parameters are split in chunks, which are spread over the
+threads of the workspace pool on CPU and computed by a single kernel on CUDA.
+
+)DOC")
+    .Arg("beta1", "Default 0.9")
+    .Arg("beta2", "Default 0.999")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the chunks are split "
+        "between on CPU: 0, the default, uses all of them and 1 the calling "
+        "thread");
+
 REGISTER_CPU_OPERATOR(SparseAdam, SparseAdamOp<float, CPUContext>);
 OPERATOR_SCHEMA(SparseAdam)
-    .NumInputs(7)
-    .NumOutputs(3)
-    .EnforceInplace({{0, 0}, {1, 1}, {2, 2}})
+    .NumInputsOutputs([](int in, int out) {
+      return (in == 7 && out == 3) || (in == 8 && out == 4);
+    })
+    .EnforceInplace({{0, 0}, {1, 1}, {2, 2}, {7, 3}})
     .SetDoc(R"DOC(
 
 Computes the Adam Update for the sparse case.
@@ -50,6 +92,16 @@ Given inputs (param, moment1, moment2, indices, grad, lr, iter), runs the dense
 Adam on (param, moment1[indices], momemnt2[indices], lr, iter) and returns
 (new_param, new_moment1, new_moment2) as in dense case
 
+With the optional last_iter input, the update is lazy: last_iter holds the
+iteration of the last update of every row, and the moments of a row are
+decayed for all the iterations since its last update when it is touched
+again, instead of only once. The parameter steps of the iterations a row
+missed are not applied.
+
+On CPU, the moments can be float16, which halves the optimizer state of big
+embedding tables. The update is then computed in float and the moments are
+written back with stochastic rounding.
+
 )DOC")
     .Input(0, "param", "Parameters to be updated")
     .Input(1, "moment_1", "First moment history")
@@ -58,9 +110,15 @@ Adam on (param, moment1[indices], momemnt2[indices], lr, iter) and returns
     .Input(4, "grad", "Gradient computed")
     .Input(5, "lr", "learning rate")
     .Input(6, "iter", "iteration number")
+    .Input(
+        7,
+        "last_iter",
+        "(optional, int64) Iteration of the last update of every row, for "
+        "the lazy update. CPU only.")
     .Output(0, "output_param", "Updated parameters")
     .Output(1, "output_moment_1", "Updated first moment")
     .Output(2, "output_moment_2", "Updated second moment")
+    .Output(3, "output_last_iter", "Updated last_iter, in place")
     .Arg("beta1", "Default 0.9")
     .Arg("beta2", "Default 0.999")
     .Arg("epsilon", "Default 1e-5");
@@ -99,6 +157,7 @@ calculated by averaging across the row.
     .Arg("epsilon", "Default 1e-5");
 
 SHOULD_NOT_DO_GRADIENT(Adam);
+SHOULD_NOT_DO_GRADIENT(MultiTensorAdam);
 SHOULD_NOT_DO_GRADIENT(SparseAdam);
 SHOULD_NOT_DO_GRADIENT(RowWiseSparseAdam);
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/perfkernels/adam.h"
+#include "caffe2/sgd/multi_tensor.h"
 
 namespace caffe2 {
 
@@ -52,6 +54,50 @@ void adam_compute(
   }
 }
 
+// The elements of a chunk of a MultiTensorAdam
+struct AdamChunk {
+  const float* w;
+  const float* g;
+  const float* m;
+  const float* v;
+  float* nw;
+  float* nm;
+  float* nv;
+  int n;
+};
+
+template <typename Context>
+void multi_tensor_adam_compute(
+    const std::vector<AdamChunk>& chunks,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    const float* lr,
+    Workspace* ws,
+    const int num_threads,
+    Tensor<Context>* /*scratch*/,
+    Context* context) {
+  RunMultiTensorChunks<AdamChunk>(
+      chunks, ws, num_threads, [&](const AdamChunk& chunk) {
+        adam_compute<Context>(
+            chunk.n,
+            chunk.w,
+            chunk.g,
+            chunk.m,
+            chunk.v,
+            chunk.nw,
+            chunk.nm,
+            chunk.nv,
+            beta1,
+            beta2,
+            eps_hat,
+            correction,
+            lr,
+            context);
+      });
+}
+
 template <typename T, class Context>
 class AdamOp final : public Operator<Context> {
  public:
@@ -62,7 +108,7 @@ class AdamOp final : public Operator<Context> {
         beta2_(OperatorBase::GetSingleArgument<float>("beta2", 0.999f)),
         epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
   bool RunOnDevice() override {
-    // Iter live on the CPU
+    // iter lives on the CPU
     CAFFE_ENFORCE(OperatorBase::InputIsType<TensorCPU>(ITER));
     CAFFE_ENFORCE(Input(LR).size() == 1);
     CAFFE_ENFORCE(Input(GRAD).size() == Input(PARAM).size());
@@ -104,6 +150,89 @@ class AdamOp final : public Operator<Context> {
   OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1, OUTPUT_MOMENT_2);
 };
 
+// Adam of a list of parameters: the inputs are (param, moment_1, moment_2,
+// grad) for every parameter, then lr and iter, and the outputs (param,
+// moment_1, moment_2) for every parameter
+template <typename T, class Context>
+class MultiTensorAdamOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorAdamOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        beta1_(OperatorBase::GetSingleArgument<float>("beta1", 0.9f)),
+        beta2_(OperatorBase::GetSingleArgument<float>("beta2", 0.999f)),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+    CAFFE_ENFORCE_EQ((InputSize() - 2) % 4, 0);
+    CAFFE_ENFORCE_EQ(OutputSize(), (InputSize() - 2) / 4 * 3);
+  }
+
+  bool RunOnDevice() override {
+    const int num_tensors = OutputSize() / 3;
+    const auto& lr = Input(InputSize() - 2);
+    // iter lives on the CPU
+    CAFFE_ENFORCE(OperatorBase::InputIsType<TensorCPU>(InputSize() - 1));
+    CAFFE_ENFORCE_EQ(lr.size(), 1);
+    sizes_.clear();
+    for (int i = 0; i < num_tensors; ++i) {
+      const auto& param = Input(4 * i);
+      CAFFE_ENFORCE_EQ(Input(4 * i + 3).size(), param.size());
+      CAFFE_ENFORCE_EQ(Input(4 * i + 1).size(), param.size());
+      CAFFE_ENFORCE_EQ(Input(4 * i + 2).size(), param.size());
+      Output(3 * i)->ResizeLike(param);
+      Output(3 * i + 1)->ResizeLike(Input(4 * i + 1));
+      Output(3 * i + 2)->ResizeLike(Input(4 * i + 2));
+      sizes_.push_back(param.size());
+    }
+
+    const auto iter = OperatorBase::Input<TensorCPU>(InputSize() - 1)
+                          .template data<int64_t>()[0];
+    const auto t = iter + 1;
+    const auto correction =
+        std::sqrt(T(1.) - std::pow(beta2_, t)) / (T(1.) - std::pow(beta1_, t));
+
+    chunks_.clear();
+    ForEachMultiTensorChunk(sizes_, [this](int i, TIndex offset, int n) {
+      chunks_.push_back(AdamChunk{
+          Input(4 * i).template data<T>() + offset,
+          Input(4 * i + 3).template data<T>() + offset,
+          Input(4 * i + 1).template data<T>() + offset,
+          Input(4 * i + 2).template data<T>() + offset,
+          Output(3 * i)->template mutable_data<T>() + offset,
+          Output(3 * i + 1)->template mutable_data<T>() + offset,
+          Output(3 * i + 2)->template mutable_data<T>() + offset,
+          n});
+    });
+    multi_tensor_adam_compute<Context>(
+        chunks_,
+        beta1_,
+        beta2_,
+        epsilon_,
+        correction,
+        lr.template data<T>(),
+        ws_,
+        num_threads_,
+        &scratch_,
+        &context_);
+    return true;
+  }
+
+ protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the chunks are split between on
+  // CPU: 0 uses all of them, 1 the calling thread
+  int num_threads_;
+  T beta1_{0.9};
+  T beta2_{0.999};
+  T epsilon_{1e-8};
+  std::vector<TIndex> sizes_;
+  std::vector<AdamChunk> chunks_;
+  // The chunks copied to the device
+  Tensor<Context> scratch_;
+};
+
 template <typename T, class Context>
 class SparseAdamOp final : public Operator<Context> {
  public:
@@ -122,6 +251,12 @@ class SparseAdamOp final : public Operator<Context> {
         Input(PARAM).size_from_dim(1),
         Input(GRAD).size_from_dim(Input(INDICES).ndim()));
     CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    if (InputSize() > LAST_ITER) {
+      CAFFE_ENFORCE(
+          Input(LAST_ITER).template IsType<int64_t>(),
+          "last_iter should be int64");
+      CAFFE_ENFORCE_EQ(Input(LAST_ITER).size(), Input(PARAM).dim(0));
+    }
 
     return DispatchHelper<TensorTypes<int32_t, int64_t>>::call(
         this, Input(INDICES));
@@ -129,6 +264,10 @@ class SparseAdamOp final : public Operator<Context> {
 
   template <typename SIndex>
   bool DoRunWithType() {
+    if (Input(MOMENT_1).template IsType<float16>()) {
+      return DoRunWithFloat16Moments<SIndex>();
+    }
+
     const auto* lr = Input(LR).template data<T>();
     const auto iter =
         OperatorBase::Input<TensorCPU>(ITER).template data<int64_t>()[0];
@@ -149,69 +288,83 @@ class SparseAdamOp final : public Operator<Context> {
     auto* moment1Out = Output(OUTPUT_MOMENT_1)->template mutable_data<T>();
     auto* moment2Out = Output(OUTPUT_MOMENT_2)->template mutable_data<T>();
 
-    for (auto i = 0; i < n; ++i) {
-      auto idx = indices[i];
-
-      if (block_size == 1) {
-        float gi = gradIn[i];
-        float mi = moment1Out[idx] =
-            moment1In[idx] * beta1_ + gi * (1 - beta1_);
-        float vi = moment2Out[idx] =
-            moment2In[idx] * beta2_ + gi * gi * (1 - beta2_);
-        paramOut[idx] =
-            paramIn[idx] + lr[0] * correction * mi / (std::sqrt(vi) + epsilon_);
-
-      } else {
-        auto offsetI = i * block_size;
-        auto offsetIdx = idx * block_size;
+    SparseAdam<SIndex>(
+        block_size,
+        n,
+        Input(PARAM).dim(0),
+        paramIn,
+        moment1In,
+        moment2In,
+        indices,
+        gradIn,
+        lr[0],
+        beta1_,
+        beta2_,
+        epsilon_,
+        correction,
+        iter,
+        LastIter(),
+        paramOut,
+        moment1Out,
+        moment2Out);
+    return true;
+  }
 
-#ifndef NDEBUG
-        CAFFE_ENFORCE_GE(
-            Input(PARAM).size(),
-            block_size + offsetIdx,
-            this->debug_def().input(PARAM),
-            ", out of bound,  idx:",
-            idx,
-            " for input i:",
-            i,
-            " and block size:",
-            block_size);
-        CAFFE_ENFORCE_GE(
-            Input(GRAD).size(),
-            block_size + offsetI,
-            this->debug_def().input(GRAD),
-            ", out of bound idx, idx:",
-            idx,
-            " for input i:",
-            i);
-#endif
+  // Half precision moments: the update is computed in float and the moments
+  // are written back with stochastic rounding.
+  template <typename SIndex>
+  bool DoRunWithFloat16Moments() {
+    CAFFE_ENFORCE(
+        Input(MOMENT_2).template IsType<float16>(),
+        "Both moments should be float16");
+    const auto iter =
+        OperatorBase::Input<TensorCPU>(ITER).template data<int64_t>()[0];
+    const auto t = iter + 1;
+    const auto correction =
+        std::sqrt(T(1.) - std::pow(beta2_, t)) / (T(1.) - std::pow(beta1_, t));
+    const auto block_size = Input(PARAM).size() / Input(PARAM).dim(0);
 
-        adam_compute(
-            block_size,
-            paramIn + offsetIdx,
-            gradIn + offsetI,
-            moment1In + offsetIdx,
-            moment2In + offsetIdx,
-            paramOut + offsetIdx,
-            moment1Out + offsetIdx,
-            moment2Out + offsetIdx,
-            beta1_,
-            beta2_,
-            epsilon_,
-            correction,
-            lr,
-            &context_);
-      }
-    }
+    SparseAdamFloat16Moments<SIndex>(
+        block_size,
+        Input(GRAD).size() / block_size,
+        Input(PARAM).dim(0),
+        Input(PARAM).template data<T>(),
+        Input(MOMENT_1).template data<float16>(),
+        Input(MOMENT_2).template data<float16>(),
+        Input(INDICES).template data<SIndex>(),
+        Input(GRAD).template data<T>(),
+        Input(LR).template data<T>()[0],
+        beta1_,
+        beta2_,
+        epsilon_,
+        correction,
+        iter,
+        LastIter(),
+        context_.RandGenerator()(),
+        Output(OUTPUT_PARAM)->template mutable_data<T>(),
+        Output(OUTPUT_MOMENT_1)->template mutable_data<float16>(),
+        Output(OUTPUT_MOMENT_2)->template mutable_data<float16>());
     return true;
   }
 
  protected:
+  // The iterations of the last updates of the rows of the lazy update, null
+  // if it is not lazy
+  int64_t* LastIter() {
+    return InputSize() > LAST_ITER
+        ? Output(OUTPUT_LAST_ITER)->template mutable_data<int64_t>()
+        : nullptr;
+  }
+
   T beta1_;
   T beta2_;
   T epsilon_;
-  INPUT_TAGS(PARAM, MOMENT_1, MOMENT_2, INDICES, GRAD, LR, ITER);
-  OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1, OUTPUT_MOMENT_2);
+  INPUT_TAGS(PARAM, MOMENT_1, MOMENT_2, INDICES, GRAD, LR, ITER, LAST_ITER);
+  OUTPUT_TAGS(
+      OUTPUT_PARAM,
+      OUTPUT_MOMENT_1,
+      OUTPUT_MOMENT_2,
+      OUTPUT_LAST_ITER);
 };
 
 template <typename T, class Context>
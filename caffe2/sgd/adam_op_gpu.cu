@@ -1,6 +1,7 @@
 #include "adam_op.h"
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/multi_tensor_gpu.h"
 
 namespace caffe2 {
 
@@ -87,6 +88,52 @@ void adam_compute<CUDAContext>(
       N, w, g, m, v, nw, nm, nv, beta1, beta2, eps_hat, correction, lr);
 }
 
+__global__ void MultiTensorAdamKernel(
+    const AdamChunk* chunks,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    const float* lr) {
+  const AdamChunk chunk = chunks[blockIdx.x];
+  const float LR = lr[0];
+  for (int i = threadIdx.x; i < chunk.n; i += blockDim.x) {
+    float gi = chunk.g[i];
+    float mi = chunk.nm[i] = chunk.m[i] * beta1 + gi * (1 - beta1);
+    float vi = chunk.nv[i] = chunk.v[i] * beta2 + gi * gi * (1 - beta2);
+    float ng = LR * correction * mi / (std::sqrt(vi) + eps_hat);
+    chunk.nw[i] = chunk.w[i] + ng;
+  }
+}
+
+template <>
+void multi_tensor_adam_compute<CUDAContext>(
+    const std::vector<AdamChunk>& chunks,
+    float beta1,
+    float beta2,
+    float eps_hat,
+    float correction,
+    const float* lr,
+    Workspace* /*ws*/,
+    const int /*num_threads*/,
+    Tensor<CUDAContext>* scratch,
+    CUDAContext* context) {
+  if (chunks.empty()) {
+    return;
+  }
+  MultiTensorAdamKernel<<<
+      chunks.size(),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      CopyMultiTensorChunks(chunks, scratch, context),
+      beta1,
+      beta2,
+      eps_hat,
+      correction,
+      lr);
+}
+
 template <typename SIndex>
 __global__ void SparseAdamKernel(
     const size_t N,
@@ -121,6 +168,8 @@ template<>
 template<typename SIndex>
 bool SparseAdamOp<float, CUDAContext>::DoRunWithType()
 {
+  CAFFE_ENFORCE_EQ(
+      InputSize(), 7, "The lazy SparseAdam is not supported on CUDA");
   auto N = Input(GRAD).size();
   auto grad_slice_sz = Input(GRAD).size_from_dim(Input(INDICES).ndim());
   const auto iter =
@@ -146,5 +195,8 @@ bool SparseAdamOp<float, CUDAContext>::DoRunWithType()
 
 REGISTER_CUDA_OPERATOR(Adam, AdamOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(SparseAdam, SparseAdamOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MultiTensorAdam,
+    MultiTensorAdamOp<float, CUDAContext>);
 
 }
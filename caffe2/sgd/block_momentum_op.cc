@@ -0,0 +1,87 @@
+#include "block_momentum_op.h"
+
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+template <>
+void block_momentum_update<CPUContext>(
+    int N,
+    const float* param,
+    const float* snapshot,
+    const float* sum,
+    const float* global,
+    const float* v,
+    const float* v_prev,
+    float* nparam,
+    float* nglobal,
+    float* nv,
+    float* nv_prev,
+    float scale,
+    float block_lr,
+    float block_momentum,
+    CPUContext* /*context*/) {
+  ConstEigenVectorArrayMap<float> snapshotVec(snapshot, N);
+  ConstEigenVectorArrayMap<float> globalVec(global, N);
+  // The block gradient is the step from the global model to the average of
+  // the snapshots
+  EigenVectorArrayMap<float> nvVec(nv, N);
+  nvVec = block_momentum * ConstEigenVectorArrayMap<float>(v, N) +
+      block_lr * (scale * ConstEigenVectorArrayMap<float>(sum, N) - globalVec);
+  EigenVectorArrayMap<float> nglobalVec(nglobal, N);
+  if (v_prev) {
+    ConstEigenVectorArrayMap<float> vPrevVec(v_prev, N);
+    nglobalVec = globalVec + nvVec - block_momentum * (nvVec - vPrevVec);
+    EigenVectorArrayMap<float>(nv_prev, N) = nvVec;
+  } else {
+    nglobalVec = globalVec + nvVec;
+  }
+  // The local steps taken since the snapshot are kept on top of the new
+  // global model
+  EigenVectorArrayMap<float>(nparam, N) =
+      ConstEigenVectorArrayMap<float>(param, N) + nglobalVec - snapshotVec;
+}
+
+REGISTER_CPU_OPERATOR(
+    BlockMomentumUpdate,
+    BlockMomentumUpdateOp<float, CPUContext>);
+OPERATOR_SCHEMA(BlockMomentumUpdate)
+    .NumInputs(5, 6)
+    .NumOutputs(3, 4)
+    .AllowInplace({{0, 0}, {3, 1}, {4, 2}, {5, 3}})
+    .SetDoc(R"DOC(
+Applies the block momentum update of BMUF (blockwise model-update
+filtering), given the local parameter, its snapshot at the end of the
+block, the sum of the snapshots of all the workers, the global model and
+the block momentum. Concretely, computes:
+
+    momentum_o = block_momentum * momentum +
+        block_learning_rate * (scale * sum - global)
+    global_o = global + momentum_o
+    param_o = param + global_o - snapshot
+
+With nesterov, global_o is also corrected by
+-block_momentum * (momentum_o - momentum_prev), and momentum_prev_o is
+momentum_o.
+
+When param is its snapshot, param_o is the new global model. When the
+workers keep training while the snapshots are reduced, param_o keeps the
+local steps taken since the snapshot.
+)DOC")
+    .Arg("scale", "(float, default 1) scale of the sum, 1 / number of workers")
+    .Arg("block_learning_rate", "(float, default 1) block learning rate")
+    .Arg("block_momentum", "(float, default 0) block momentum")
+    .Arg("nesterov", "(bool, default false) use nesterov block momentum")
+    .Input(0, "param", "local parameter")
+    .Input(1, "snapshot", "snapshot of the local parameter")
+    .Input(2, "sum", "sum of the snapshots of all the workers")
+    .Input(3, "global", "global model")
+    .Input(4, "momentum", "block momentum")
+    .Input(5, "momentum_prev", "previous block momentum, with nesterov")
+    .Output(0, "output_param", "updated local parameter")
+    .Output(1, "output_global", "updated global model")
+    .Output(2, "output_momentum", "updated block momentum")
+    .Output(3, "output_momentum_prev", "updated previous block momentum");
+SHOULD_NOT_DO_GRADIENT(BlockMomentumUpdate);
+
+} // namespace caffe2
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "caffe2/core/operator.h"
+
+namespace caffe2 {
+
+template <typename Context>
+void block_momentum_update(
+    int N,
+    const float* param,
+    const float* snapshot,
+    const float* sum,
+    const float* global,
+    const float* v,
+    const float* v_prev,
+    float* nparam,
+    float* nglobal,
+    float* nv,
+    float* nv_prev,
+    float scale,
+    float block_lr,
+    float block_momentum,
+    Context* context);
+
+template <typename T, class Context>
+class BlockMomentumUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  BlockMomentumUpdateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        scale_(OperatorBase::GetSingleArgument<float>("scale", 1.0f)),
+        block_lr_(OperatorBase::GetSingleArgument<float>(
+            "block_learning_rate",
+            1.0f)),
+        block_momentum_(
+            OperatorBase::GetSingleArgument<float>("block_momentum", 0.0f)),
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)) {
+    CAFFE_ENFORCE_EQ(InputSize(), nesterov_ ? 6 : 5);
+  }
+
+  bool RunOnDevice() override {
+    const auto N = Input(PARAM).size();
+    for (int i = 1; i < InputSize(); ++i) {
+      CAFFE_ENFORCE_EQ(Input(i).size(), N);
+    }
+    for (int i = 0; i < OutputSize(); ++i) {
+      Output(i)->ResizeLike(Input(PARAM));
+    }
+    block_momentum_update<Context>(
+        N,
+        Input(PARAM).template data<T>(),
+        Input(SNAPSHOT).template data<T>(),
+        Input(SUM).template data<T>(),
+        Input(GLOBAL).template data<T>(),
+        Input(MOMENTUM).template data<T>(),
+        nesterov_ ? Input(MOMENTUM_PREV).template data<T>() : nullptr,
+        Output(OUTPUT_PARAM)->template mutable_data<T>(),
+        Output(OUTPUT_GLOBAL)->template mutable_data<T>(),
+        Output(OUTPUT_MOMENTUM)->template mutable_data<T>(),
+        nesterov_ ? Output(OUTPUT_MOMENTUM_PREV)->template mutable_data<T>()
+                  : nullptr,
+        scale_,
+        block_lr_,
+        block_momentum_,
+        &context_);
+    return true;
+  }
+
+ protected:
+  float scale_;
+  float block_lr_;
+  float block_momentum_;
+  bool nesterov_;
+  INPUT_TAGS(PARAM, SNAPSHOT, SUM, GLOBAL, MOMENTUM, MOMENTUM_PREV);
+  OUTPUT_TAGS(
+      OUTPUT_PARAM,
+      OUTPUT_GLOBAL,
+      OUTPUT_MOMENTUM,
+      OUTPUT_MOMENTUM_PREV);
+};
+
+} // namespace caffe2
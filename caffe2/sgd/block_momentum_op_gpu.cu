@@ -0,0 +1,78 @@
+#include "block_momentum_op.h"
+#include "caffe2/core/common_gpu.h"
+#include "caffe2/core/context_gpu.h"
+
+namespace caffe2 {
+
+__global__ void BlockMomentumUpdateKernel(
+    int N,
+    const float* param,
+    const float* snapshot,
+    const float* sum,
+    const float* global,
+    const float* v,
+    const float* v_prev,
+    float* nparam,
+    float* nglobal,
+    float* nv,
+    float* nv_prev,
+    float scale,
+    float block_lr,
+    float block_momentum) {
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    const float vi =
+        block_momentum * v[i] + block_lr * (scale * sum[i] - global[i]);
+    float gi = global[i] + vi;
+    if (v_prev) {
+      gi -= block_momentum * (vi - v_prev[i]);
+      nv_prev[i] = vi;
+    }
+    nv[i] = vi;
+    nparam[i] = param[i] + gi - snapshot[i];
+    nglobal[i] = gi;
+  }
+}
+
+template <>
+void block_momentum_update<CUDAContext>(
+    int N,
+    const float* param,
+    const float* snapshot,
+    const float* sum,
+    const float* global,
+    const float* v,
+    const float* v_prev,
+    float* nparam,
+    float* nglobal,
+    float* nv,
+    float* nv_prev,
+    float scale,
+    float block_lr,
+    float block_momentum,
+    CUDAContext* context) {
+  BlockMomentumUpdateKernel<<<
+      CAFFE_GET_BLOCKS(N),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      N,
+      param,
+      snapshot,
+      sum,
+      global,
+      v,
+      v_prev,
+      nparam,
+      nglobal,
+      nv,
+      nv_prev,
+      scale,
+      block_lr,
+      block_momentum);
+}
+
+REGISTER_CUDA_OPERATOR(
+    BlockMomentumUpdate,
+    BlockMomentumUpdateOp<float, CUDAContext>);
+
+} // namespace caffe2
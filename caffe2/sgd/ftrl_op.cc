@@ -1,4 +1,5 @@
 #include "ftrl_op.h"
+#include "caffe2/perfkernels/ftrl.h"
 
 namespace caffe2 {
 
@@ -96,38 +97,21 @@ void SparseFtrlOp<T>::DoRun() {
   DCHECK_EQ(grad.size(), K * block_size);
   T* w = var->template mutable_data<T>();
   T* nz = n_z->template mutable_data<T>();
-  const SIndex* idxs = indices.template data<SIndex>();
-  const T* g = grad.template data<T>();
 
-  // TODO(cxj): use OMP when it is reliable
-  // #pragma omp parallel for
-  for (TIndex i = 0; i < K; ++i) {
-    SIndex idx = idxs[i];
-    DCHECK(0 <= idx && idx < N) << "Index out of bounds: " << idx
-                                << ", range 0 to " << N;
-    if (block_size == 1) {
-      ftrl_compute(
-          w[idx],
-          nz[idx * 2],
-          nz[idx * 2 + 1],
-          g[i],
-          w[idx],
-          nz[idx * 2],
-          nz[idx * 2 + 1],
-          params_);
-    } else {
-      TIndex x = block_size * idx;
-      ftrl_update(
-          block_size,
-          w + x,
-          nz + x * 2,
-          g + i * block_size,
-          w + x,
-          nz + x * 2,
-          params_,
-          &context_);
-    }
-  }
+  SparseFtrl<SIndex>(
+      block_size,
+      K,
+      N,
+      w,
+      nz,
+      indices.template data<SIndex>(),
+      grad.template data<T>(),
+      params_.alphaInv,
+      params_.beta,
+      params_.lambda1,
+      params_.lambda2,
+      w,
+      nz);
 }
 
 namespace {
@@ -0,0 +1,187 @@
+#include "caffe2/sgd/mixed_precision_ops.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The inputs from first_cpu_input on live on the CPU
+OpSchema::DeviceInferenceFunctionType MixedPrecisionDevInfer(
+    const int first_cpu_input) {
+  return [first_cpu_input](const OperatorDef& def) {
+    std::vector<DeviceOption> in_dev(def.input_size(), def.device_option());
+    for (int i = first_cpu_input; i < def.input_size(); ++i) {
+      in_dev[i] = DeviceOption();
+    }
+    std::vector<DeviceOption> out_dev(def.output_size(), def.device_option());
+    return std::make_pair(in_dev, out_dev);
+  };
+}
+
+} // namespace
+
+REGISTER_CPU_OPERATOR(AllFinite, AllFiniteOp<CPUContext>);
+OPERATOR_SCHEMA(AllFinite)
+    .NumInputs(1, INT_MAX)
+    .NumOutputs(1)
+    .TensorInferenceFunction([](const OperatorDef& /* unused */,
+                                const vector<TensorShape>& /* unused */) {
+      vector<TensorShape> out(1);
+      out[0].add_dims(1);
+      out[0].set_data_type(TensorProto::BOOL);
+      return out;
+    })
+    .DeviceInferenceFunction([](const OperatorDef& def) {
+      return std::make_pair(
+          std::vector<DeviceOption>(def.input_size(), def.device_option()),
+          std::vector<DeviceOption>{DeviceOption()});
+    })
+    .SetDoc(R"DOC(
+
+Checks whether the elements of the float or float16 tensors X_1, ..., X_n,
+typically all the gradients of a mixed precision model, are all finite. The
+tensors are split in chunks checked by the threads of the workspace pool on
+CPU and by a single kernel on CUDA, and the result is a bool on the CPU, read
+by the mixed precision optimizers and UpdateLossScale.
+
+)DOC")
+    .Input(0, "X_1", "First float or float16 tensor")
+    .Output(0, "all_finite", "Whether no element is an infinity or a NaN")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the chunks are split "
+        "between on CPU: 0, the default, uses all of them and 1 the calling "
+        "thread");
+
+REGISTER_CPU_OPERATOR(UpdateLossScale, UpdateLossScaleOp<CPUContext>);
+OPERATOR_SCHEMA(UpdateLossScale)
+    .NumInputs(3)
+    .NumOutputs(2)
+    .EnforceInplace({{0, 0}, {1, 1}})
+    .DeviceInferenceFunction([](const OperatorDef& def) {
+      return std::make_pair(
+          std::vector<DeviceOption>(def.input_size(), DeviceOption()),
+          std::vector<DeviceOption>(def.output_size(), DeviceOption()));
+    })
+    .SetDoc(R"DOC(
+
+Updates the loss scale of dynamic loss scaling after an iteration of mixed
+precision training. When the gradients of the iteration were not all finite,
+their update having been skipped, the loss scale is multiplied by
+backoff_factor. Otherwise it is multiplied by growth_factor once
+growth_interval iterations in a row had finite gradients. The loss scale is
+kept in [min_loss_scale, max_loss_scale]. All the inputs and outputs live on
+the CPU.
+
+)DOC")
+    .Input(0, "loss_scale", "Loss scale, a float")
+    .Input(
+        1,
+        "good_steps",
+        "Number of iterations with finite gradients since the last change of "
+        "the loss scale, an int64")
+    .Input(2, "all_finite", "Whether the gradients were all finite, a bool")
+    .Output(0, "output_loss_scale", "Updated loss scale")
+    .Output(1, "output_good_steps", "Updated number of iterations")
+    .Arg("growth_factor", "Default 2")
+    .Arg("backoff_factor", "Default 0.5")
+    .Arg("growth_interval", "Default 2000")
+    .Arg("min_loss_scale", "Default 1")
+    .Arg("max_loss_scale", "Default 2^24");
+
+REGISTER_CPU_OPERATOR(
+    MixedPrecisionMomentumSGDUpdate,
+    MixedPrecisionMomentumSGDUpdateOp<CPUContext>);
+OPERATOR_SCHEMA(MixedPrecisionMomentumSGDUpdate)
+    .NumInputs(6)
+    .NumOutputs(2, 3)
+    .EnforceInplace({{1, 0}, {3, 1}})
+    .DeviceInferenceFunction(MixedPrecisionDevInfer(4))
+    .SetDoc(R"DOC(
+
+Computes the FP32MomentumSGDUpdate of the float master weights of a mixed
+precision parameter in a single pass: the float16 or float gradient is
+divided by the loss scale, the momentum and the master weights are updated,
+and the updated weights are converted to the float16 parameter. When the
+gradients of the iteration are not all finite nothing is updated.
+
+)DOC")
+    .Input(0, "grad", "Float16 or float gradient, scaled by the loss scale")
+    .Input(1, "momentum", "Float momentum")
+    .Input(2, "lr", "Learning rate")
+    .Input(3, "param", "Float master weights")
+    .Input(4, "loss_scale", "Loss scale, a float on the CPU")
+    .Input(5, "all_finite", "Whether all the gradients are finite, on the CPU")
+    .Output(0, "output_momentum", "Updated momentum")
+    .Output(1, "output_param", "Updated master weights")
+    .Output(2, "output_param_half", "Optional float16 copy of the weights")
+    .Arg("momentum", "Momentum hyperparameter")
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.")
+    .Arg("weight_decay", "Weight decay, default 0");
+
+REGISTER_CPU_OPERATOR(MixedPrecisionAdam, MixedPrecisionAdamOp<CPUContext>);
+OPERATOR_SCHEMA(MixedPrecisionAdam)
+    .NumInputs(8)
+    .NumOutputs(3, 4)
+    .EnforceInplace({{0, 0}, {1, 1}, {2, 2}})
+    .DeviceInferenceFunction(MixedPrecisionDevInfer(5))
+    .SetDoc(R"DOC(
+
+Computes the Adam update of the float master weights of a mixed precision
+parameter in a single pass: the float16 or float gradient is divided by the
+loss scale, the moments and the master weights are updated as by Adam, and the
+updated weights are converted to the float16 parameter. When the gradients of
+the iteration are not all finite nothing is updated.
+
+)DOC")
+    .Input(0, "param", "Float master weights")
+    .Input(1, "moment_1", "First moment history")
+    .Input(2, "moment_2", "Second moment history")
+    .Input(3, "grad", "Float16 or float gradient, scaled by the loss scale")
+    .Input(4, "lr", "Learning rate")
+    .Input(5, "iter", "Iteration number")
+    .Input(6, "loss_scale", "Loss scale, a float on the CPU")
+    .Input(7, "all_finite", "Whether all the gradients are finite, on the CPU")
+    .Output(0, "output_param", "Updated master weights")
+    .Output(1, "output_moment_1", "Updated first moment")
+    .Output(2, "output_moment_2", "Updated second moment")
+    .Output(3, "output_param_half", "Optional float16 copy of the weights")
+    .Arg("beta1", "Default 0.9")
+    .Arg("beta2", "Default 0.999")
+    .Arg("epsilon", "Default 1e-5");
+
+REGISTER_CPU_OPERATOR(
+    MixedPrecisionAdagrad,
+    MixedPrecisionAdagradOp<CPUContext>);
+OPERATOR_SCHEMA(MixedPrecisionAdagrad)
+    .NumInputs(6)
+    .NumOutputs(2, 3)
+    .EnforceInplace({{0, 0}, {1, 1}})
+    .DeviceInferenceFunction(MixedPrecisionDevInfer(4))
+    .SetDoc(R"DOC(
+
+Computes the Adagrad update of the float master weights of a mixed precision
+parameter in a single pass: the float16 or float gradient is divided by the
+loss scale, the moment and the master weights are updated as by Adagrad, and
+the updated weights are converted to the float16 parameter. When the
+gradients of the iteration are not all finite nothing is updated.
+
+)DOC")
+    .Input(0, "param", "Float master weights")
+    .Input(1, "moment", "Moment history")
+    .Input(2, "grad", "Float16 or float gradient, scaled by the loss scale")
+    .Input(3, "lr", "Learning rate")
+    .Input(4, "loss_scale", "Loss scale, a float on the CPU")
+    .Input(5, "all_finite", "Whether all the gradients are finite, on the CPU")
+    .Output(0, "output_param", "Updated master weights")
+    .Output(1, "output_moment", "Updated moment")
+    .Output(2, "output_param_half", "Optional float16 copy of the weights")
+    .Arg("epsilon", "Default 1e-5")
+    .Arg("decay", "Default 1");
+
+SHOULD_NOT_DO_GRADIENT(AllFinite);
+SHOULD_NOT_DO_GRADIENT(UpdateLossScale);
+SHOULD_NOT_DO_GRADIENT(MixedPrecisionMomentumSGDUpdate);
+SHOULD_NOT_DO_GRADIENT(MixedPrecisionAdam);
+SHOULD_NOT_DO_GRADIENT(MixedPrecisionAdagrad);
+
+} // namespace caffe2
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "caffe2/core/operator.h"
+#include "caffe2/core/types.h"
+#include "caffe2/sgd/multi_tensor.h"
+#include "caffe2/utils/conversions.h"
+
+namespace caffe2 {
+
+// Dynamic loss scaling of mixed precision training: the loss gradient is
+// multiplied by the loss scale so that small float16 gradients do not flush to
+// zero, and the optimizers divide the gradients by it before the update of the
+// float master weights. The update of an iteration whose gradients overflowed
+// is skipped and the loss scale multiplied by backoff_factor, while it is
+// multiplied by growth_factor after growth_interval iterations in a row
+// without overflow.
+struct DynamicLossScaler {
+  float growth_factor;
+  float backoff_factor;
+  int64_t growth_interval;
+  float min_loss_scale;
+  float max_loss_scale;
+
+  // Updates loss_scale, and good_steps the number of iterations without
+  // overflow since its last change, after an iteration whose gradients were
+  // all finite or not
+  void Update(const bool all_finite, float* loss_scale, int64_t* good_steps)
+      const {
+    if (!all_finite) {
+      *loss_scale = std::max(*loss_scale * backoff_factor, min_loss_scale);
+      *good_steps = 0;
+    } else if (++*good_steps >= growth_interval) {
+      *loss_scale = std::min(*loss_scale * growth_factor, max_loss_scale);
+      *good_steps = 0;
+    }
+  }
+};
+
+// Returns whether the update of the mixed precision optimizers is to be done,
+// the gradients of the iteration being all finite, and the factor unscaling
+// the gradients
+inline bool MixedPrecisionUnscale(
+    const TensorCPU& loss_scale,
+    const TensorCPU& all_finite,
+    float* inv_scale) {
+  CAFFE_ENFORCE_EQ(loss_scale.size(), 1);
+  CAFFE_ENFORCE_EQ(all_finite.size(), 1);
+  if (!all_finite.template data<bool>()[0]) {
+    return false;
+  }
+  *inv_scale = 1.0f / loss_scale.template data<float>()[0];
+  return true;
+}
+
+// The elements of a chunk of an AllFinite, of float16 type if half and float
+// otherwise
+struct FiniteChunk {
+  const void* x;
+  int n;
+  bool half;
+};
+
+inline bool AllFiniteFloat(const float* x, const int n) {
+  bool finite = true;
+  for (int i = 0; i < n; ++i) {
+    finite &= std::isfinite(x[i]);
+  }
+  return finite;
+}
+
+// Infinities and NaNs are the float16 with all the exponent bits set
+inline bool AllFiniteFloat16(const float16* x, const int n) {
+  bool finite = true;
+  for (int i = 0; i < n; ++i) {
+    finite &= (x[i].x & 0x7c00) != 0x7c00;
+  }
+  return finite;
+}
+
+template <typename Context>
+bool all_finite(
+    const std::vector<FiniteChunk>& chunks,
+    Workspace* ws,
+    const int num_threads,
+    Tensor<Context>* /*scratch*/,
+    Tensor<Context>* /*flag*/,
+    Context* /*context*/) {
+  std::atomic<bool> finite(true);
+  RunMultiTensorChunks<FiniteChunk>(
+      chunks, ws, num_threads, [&](const FiniteChunk& chunk) {
+        if (!finite.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (!(chunk.half ? AllFiniteFloat16(
+                               static_cast<const float16*>(chunk.x), chunk.n)
+                         : AllFiniteFloat(
+                               static_cast<const float*>(chunk.x), chunk.n))) {
+          finite = false;
+        }
+      });
+  return finite;
+}
+
+// MomentumSGDUpdate of the float master weights param, with the weight decay
+// of FP16MomentumSGDUpdate, from the gradients g scaled by 1 / inv_scale. The
+// updated weights are also written as float16 to param_half if not null.
+template <typename T, typename Context>
+void mixed_precision_momentum_sgd_update(
+    const int N,
+    const T* g,
+    const float* m,
+    float* nm,
+    const float* lr,
+    const float inv_scale,
+    const float momentum,
+    const bool nesterov,
+    const float weight_decay,
+    float* param,
+    float16* param_half,
+    Context* /*context*/) {
+  const float LR = lr[0];
+  for (auto i = 0; i < N; ++i) {
+    const float gi =
+        convert::To<T, float>(g[i]) * inv_scale + weight_decay * param[i];
+    float ng;
+    if (!nesterov) {
+      ng = nm[i] = LR * gi + momentum * m[i];
+    } else {
+      const float mi = m[i];
+      const float mi_new = nm[i] = momentum * mi + LR * gi;
+      ng = (1 + momentum) * mi_new - momentum * mi;
+    }
+    param[i] -= ng;
+    if (param_half) {
+      param_half[i] = convert::To<float, float16>(param[i]);
+    }
+  }
+}
+
+// Adam of the float master weights w from the gradients g scaled by
+// 1 / inv_scale, the updated weights being also written as float16 to w_half
+// if not null
+template <typename T, typename Context>
+void mixed_precision_adam_update(
+    const int N,
+    const float* w,
+    const T* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    const float beta1,
+    const float beta2,
+    const float eps_hat,
+    const float correction,
+    const float* lr,
+    const float inv_scale,
+    float16* w_half,
+    Context* /*context*/) {
+  for (auto i = 0; i < N; ++i) {
+    const float gi = convert::To<T, float>(g[i]) * inv_scale;
+    const float mi = nm[i] = m[i] * beta1 + gi * (1 - beta1);
+    const float vi = nv[i] = v[i] * beta2 + gi * gi * (1 - beta2);
+    nw[i] = w[i] + lr[0] * correction * mi / (std::sqrt(vi) + eps_hat);
+    if (w_half) {
+      w_half[i] = convert::To<float, float16>(nw[i]);
+    }
+  }
+}
+
+// Adagrad of the float master weights w from the gradients g scaled by
+// 1 / inv_scale, the updated weights being also written as float16 to w_half
+// if not null
+template <typename T, typename Context>
+void mixed_precision_adagrad_update(
+    const int N,
+    const float* w,
+    const T* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    const float epsilon,
+    const float decay,
+    const float* lr,
+    const float inv_scale,
+    float16* w_half,
+    Context* /*context*/) {
+  for (auto i = 0; i < N; ++i) {
+    const float gi = convert::To<T, float>(g[i]) * inv_scale;
+    const float hi = nh[i] = decay * h[i] + gi * gi;
+    nw[i] = w[i] + lr[0] * gi / (std::sqrt(hi) + epsilon);
+    if (w_half) {
+      w_half[i] = convert::To<float, float16>(nw[i]);
+    }
+  }
+}
+
+// Whether the float or float16 tensors X_1, ..., X_n are all finite, as a
+// bool on the CPU
+template <class Context>
+class AllFiniteOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  AllFiniteOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+  }
+
+  bool RunOnDevice() override {
+    sizes_.clear();
+    for (int i = 0; i < InputSize(); ++i) {
+      const auto& X = Input(i);
+      CAFFE_ENFORCE(
+          X.template IsType<float>() || X.template IsType<float16>(),
+          "AllFinite only supports float and float16 tensors, got ",
+          X.meta().name());
+      sizes_.push_back(X.size());
+    }
+    chunks_.clear();
+    ForEachMultiTensorChunk(sizes_, [this](int i, TIndex offset, int n) {
+      const auto& X = Input(i);
+      if (X.template IsType<float16>()) {
+        chunks_.push_back(
+            FiniteChunk{X.template data<float16>() + offset, n, true});
+      } else {
+        chunks_.push_back(
+            FiniteChunk{X.template data<float>() + offset, n, false});
+      }
+    });
+    auto* Y = OperatorBase::Output<TensorCPU>(0);
+    Y->Resize(1);
+    Y->template mutable_data<bool>()[0] = all_finite<Context>(
+        chunks_, ws_, num_threads_, &scratch_, &flag_, &context_);
+    return true;
+  }
+
+ protected:
+  Workspace* ws_;
+  int num_threads_;
+  std::vector<TIndex> sizes_;
+  std::vector<FiniteChunk> chunks_;
+  Tensor<Context> scratch_;
+  Tensor<Context> flag_;
+};
+
+// Updates the loss scale of dynamic loss scaling, see DynamicLossScaler. Its
+// inputs and outputs live on the CPU.
+template <class Context>
+class UpdateLossScaleOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  UpdateLossScaleOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        scaler_{
+            OperatorBase::GetSingleArgument<float>("growth_factor", 2.0f),
+            OperatorBase::GetSingleArgument<float>("backoff_factor", 0.5f),
+            OperatorBase::GetSingleArgument<int64_t>("growth_interval", 2000),
+            OperatorBase::GetSingleArgument<float>("min_loss_scale", 1.0f),
+            OperatorBase::GetSingleArgument<float>(
+                "max_loss_scale", 16777216.0f)} {
+    CAFFE_ENFORCE_GE(scaler_.growth_factor, 1.0f);
+    CAFFE_ENFORCE(
+        scaler_.backoff_factor > 0 && scaler_.backoff_factor < 1,
+        "backoff_factor has to be in (0, 1)");
+    CAFFE_ENFORCE_GT(scaler_.growth_interval, 0);
+    CAFFE_ENFORCE_GT(scaler_.min_loss_scale, 0);
+    CAFFE_ENFORCE_LE(scaler_.min_loss_scale, scaler_.max_loss_scale);
+  }
+
+  bool RunOnDevice() override {
+    const auto& all_finite = OperatorBase::Input<TensorCPU>(ALL_FINITE);
+    CAFFE_ENFORCE_EQ(OperatorBase::Input<TensorCPU>(LOSS_SCALE).size(), 1);
+    CAFFE_ENFORCE_EQ(OperatorBase::Input<TensorCPU>(GOOD_STEPS).size(), 1);
+    CAFFE_ENFORCE_EQ(all_finite.size(), 1);
+    scaler_.Update(
+        all_finite.template data<bool>()[0],
+        OperatorBase::Output<TensorCPU>(OUTPUT_LOSS_SCALE)
+            ->template mutable_data<float>(),
+        OperatorBase::Output<TensorCPU>(OUTPUT_GOOD_STEPS)
+            ->template mutable_data<int64_t>());
+    return true;
+  }
+
+ protected:
+  DynamicLossScaler scaler_;
+  INPUT_TAGS(LOSS_SCALE, GOOD_STEPS, ALL_FINITE);
+  OUTPUT_TAGS(OUTPUT_LOSS_SCALE, OUTPUT_GOOD_STEPS);
+};
+
+template <class Context>
+class MixedPrecisionMomentumSGDUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MixedPrecisionMomentumSGDUpdateOp(
+      const OperatorDef& operator_def,
+      Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        momentum_(OperatorBase::GetSingleArgument<float>("momentum", 0.0)),
+        weight_decay_(
+            OperatorBase::GetSingleArgument<float>("weight_decay", 0.0)),
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, float16>>::call(this, Input(GRAD));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(MOMENTUM).size());
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(PARAM).size());
+    float inv_scale;
+    if (!MixedPrecisionUnscale(
+            OperatorBase::Input<TensorCPU>(LOSS_SCALE),
+            OperatorBase::Input<TensorCPU>(ALL_FINITE),
+            &inv_scale)) {
+      return true;
+    }
+    float16* param_half = nullptr;
+    if (OutputSize() > OUTPUT_PARAM_HALF) {
+      Output(OUTPUT_PARAM_HALF)->ResizeLike(Input(PARAM));
+      param_half = Output(OUTPUT_PARAM_HALF)->template mutable_data<float16>();
+    }
+    mixed_precision_momentum_sgd_update<T, Context>(
+        Input(GRAD).size(),
+        Input(GRAD).template data<T>(),
+        Input(MOMENTUM).template data<float>(),
+        Output(OUTPUT_MOMENTUM)->template mutable_data<float>(),
+        Input(LR).template data<float>(),
+        inv_scale,
+        momentum_,
+        nesterov_,
+        weight_decay_,
+        Output(OUTPUT_PARAM)->template mutable_data<float>(),
+        param_half,
+        &context_);
+    return true;
+  }
+
+ protected:
+  float momentum_;
+  float weight_decay_;
+  bool nesterov_;
+  INPUT_TAGS(GRAD, MOMENTUM, LR, PARAM, LOSS_SCALE, ALL_FINITE);
+  OUTPUT_TAGS(OUTPUT_MOMENTUM, OUTPUT_PARAM, OUTPUT_PARAM_HALF);
+};
+
+template <class Context>
+class MixedPrecisionAdamOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MixedPrecisionAdamOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        beta1_(OperatorBase::GetSingleArgument<float>("beta1", 0.9f)),
+        beta2_(OperatorBase::GetSingleArgument<float>("beta2", 0.999f)),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, float16>>::call(this, Input(GRAD));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    // iter lives on the CPU
+    CAFFE_ENFORCE(OperatorBase::InputIsType<TensorCPU>(ITER));
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(PARAM).size());
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(MOMENT_1).size());
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(MOMENT_2).size());
+    float inv_scale;
+    if (!MixedPrecisionUnscale(
+            OperatorBase::Input<TensorCPU>(LOSS_SCALE),
+            OperatorBase::Input<TensorCPU>(ALL_FINITE),
+            &inv_scale)) {
+      return true;
+    }
+    float16* param_half = nullptr;
+    if (OutputSize() > OUTPUT_PARAM_HALF) {
+      Output(OUTPUT_PARAM_HALF)->ResizeLike(Input(PARAM));
+      param_half = Output(OUTPUT_PARAM_HALF)->template mutable_data<float16>();
+    }
+
+    const auto iter =
+        OperatorBase::Input<TensorCPU>(ITER).template data<int64_t>()[0];
+    const auto t = iter + 1;
+    const auto correction = std::sqrt(1.0f - std::pow(beta2_, t)) /
+        (1.0f - std::pow(beta1_, t));
+    mixed_precision_adam_update<T, Context>(
+        Input(GRAD).size(),
+        Input(PARAM).template data<float>(),
+        Input(GRAD).template data<T>(),
+        Input(MOMENT_1).template data<float>(),
+        Input(MOMENT_2).template data<float>(),
+        Output(OUTPUT_PARAM)->template mutable_data<float>(),
+        Output(OUTPUT_MOMENT_1)->template mutable_data<float>(),
+        Output(OUTPUT_MOMENT_2)->template mutable_data<float>(),
+        beta1_,
+        beta2_,
+        epsilon_,
+        correction,
+        Input(LR).template data<float>(),
+        inv_scale,
+        param_half,
+        &context_);
+    return true;
+  }
+
+ protected:
+  float beta1_;
+  float beta2_;
+  float epsilon_;
+  INPUT_TAGS(
+      PARAM,
+      MOMENT_1,
+      MOMENT_2,
+      GRAD,
+      LR,
+      ITER,
+      LOSS_SCALE,
+      ALL_FINITE);
+  OUTPUT_TAGS(
+      OUTPUT_PARAM,
+      OUTPUT_MOMENT_1,
+      OUTPUT_MOMENT_2,
+      OUTPUT_PARAM_HALF);
+};
+
+template <class Context>
+class MixedPrecisionAdagradOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MixedPrecisionAdagradOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        epsilon_(OperatorBase::GetSingleArgument<float>("epsilon", 1e-5f)),
+        decay_(OperatorBase::GetSingleArgument<float>("decay", 1.0f)) {}
+
+  bool RunOnDevice() override {
+    return DispatchHelper<TensorTypes<float, float16>>::call(this, Input(GRAD));
+  }
+
+  template <typename T>
+  bool DoRunWithType() {
+    CAFFE_ENFORCE_EQ(Input(LR).size(), 1);
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(PARAM).size());
+    CAFFE_ENFORCE_EQ(Input(GRAD).size(), Input(MOMENT_1).size());
+    float inv_scale;
+    if (!MixedPrecisionUnscale(
+            OperatorBase::Input<TensorCPU>(LOSS_SCALE),
+            OperatorBase::Input<TensorCPU>(ALL_FINITE),
+            &inv_scale)) {
+      return true;
+    }
+    float16* param_half = nullptr;
+    if (OutputSize() > OUTPUT_PARAM_HALF) {
+      Output(OUTPUT_PARAM_HALF)->ResizeLike(Input(PARAM));
+      param_half = Output(OUTPUT_PARAM_HALF)->template mutable_data<float16>();
+    }
+    mixed_precision_adagrad_update<T, Context>(
+        Input(GRAD).size(),
+        Input(PARAM).template data<float>(),
+        Input(GRAD).template data<T>(),
+        Input(MOMENT_1).template data<float>(),
+        Output(OUTPUT_PARAM)->template mutable_data<float>(),
+        Output(OUTPUT_MOMENT_1)->template mutable_data<float>(),
+        epsilon_,
+        decay_,
+        Input(LR).template data<float>(),
+        inv_scale,
+        param_half,
+        &context_);
+    return true;
+  }
+
+ protected:
+  float epsilon_;
+  float decay_;
+  INPUT_TAGS(PARAM, MOMENT_1, GRAD, LR, LOSS_SCALE, ALL_FINITE);
+  OUTPUT_TAGS(OUTPUT_PARAM, OUTPUT_MOMENT_1, OUTPUT_PARAM_HALF);
+};
+
+} // namespace caffe2
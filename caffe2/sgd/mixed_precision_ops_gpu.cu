@@ -0,0 +1,252 @@
+#include "caffe2/core/common_gpu.h"
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/mixed_precision_ops.h"
+#include "caffe2/sgd/multi_tensor_gpu.h"
+#include "caffe2/utils/math.h"
+
+namespace caffe2 {
+
+namespace {
+
+__global__ void AllFiniteKernel(const FiniteChunk* chunks, int* finite) {
+  const FiniteChunk chunk = chunks[blockIdx.x];
+  bool chunk_finite = true;
+  if (chunk.half) {
+    const float16* x = static_cast<const float16*>(chunk.x);
+    for (int i = threadIdx.x; i < chunk.n; i += blockDim.x) {
+      chunk_finite &= (x[i].x & 0x7c00) != 0x7c00;
+    }
+  } else {
+    const float* x = static_cast<const float*>(chunk.x);
+    for (int i = threadIdx.x; i < chunk.n; i += blockDim.x) {
+      chunk_finite &= isfinite(x[i]);
+    }
+  }
+  // All the threads which see an overflow write the same value
+  if (!chunk_finite) {
+    *finite = 0;
+  }
+}
+
+template <typename T>
+__global__ void MixedPrecisionMomentumSGDKernel(
+    const int N,
+    const T* g,
+    const float* m,
+    float* nm,
+    const float* lr,
+    const float inv_scale,
+    const float momentum,
+    const bool nesterov,
+    const float weight_decay,
+    float* param,
+    float16* param_half) {
+  const float LR = lr[0];
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    const float gi =
+        convert::To<T, float>(g[i]) * inv_scale + weight_decay * param[i];
+    float ng;
+    if (!nesterov) {
+      ng = nm[i] = LR * gi + momentum * m[i];
+    } else {
+      const float mi = m[i];
+      const float mi_new = nm[i] = momentum * mi + LR * gi;
+      ng = (1 + momentum) * mi_new - momentum * mi;
+    }
+    const float pi = param[i] -= ng;
+    if (param_half) {
+      param_half[i] = convert::To<float, float16>(pi);
+    }
+  }
+}
+
+template <typename T>
+__global__ void MixedPrecisionAdamKernel(
+    const int N,
+    const float* w,
+    const T* g,
+    const float* m,
+    const float* v,
+    float* nw,
+    float* nm,
+    float* nv,
+    const float beta1,
+    const float beta2,
+    const float eps_hat,
+    const float correction,
+    const float* lr,
+    const float inv_scale,
+    float16* w_half) {
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    const float gi = convert::To<T, float>(g[i]) * inv_scale;
+    const float mi = nm[i] = m[i] * beta1 + gi * (1 - beta1);
+    const float vi = nv[i] = v[i] * beta2 + gi * gi * (1 - beta2);
+    const float wi = nw[i] =
+        w[i] + lr[0] * correction * mi / (sqrtf(vi) + eps_hat);
+    if (w_half) {
+      w_half[i] = convert::To<float, float16>(wi);
+    }
+  }
+}
+
+template <typename T>
+__global__ void MixedPrecisionAdagradKernel(
+    const int N,
+    const float* w,
+    const T* g,
+    const float* h,
+    float* nw,
+    float* nh,
+    const float epsilon,
+    const float decay,
+    const float* lr,
+    const float inv_scale,
+    float16* w_half) {
+  CUDA_1D_KERNEL_LOOP(i, N) {
+    const float gi = convert::To<T, float>(g[i]) * inv_scale;
+    const float hi = nh[i] = decay * h[i] + gi * gi;
+    const float wi = nw[i] = w[i] + lr[0] * gi / (sqrtf(hi) + epsilon);
+    if (w_half) {
+      w_half[i] = convert::To<float, float16>(wi);
+    }
+  }
+}
+
+} // namespace
+
+template <>
+bool all_finite<CUDAContext>(
+    const std::vector<FiniteChunk>& chunks,
+    Workspace* /*ws*/,
+    const int /*num_threads*/,
+    Tensor<CUDAContext>* scratch,
+    Tensor<CUDAContext>* flag,
+    CUDAContext* context) {
+  if (chunks.empty()) {
+    return true;
+  }
+  flag->Resize(1);
+  int* finite_data = flag->template mutable_data<int>();
+  math::Set<int, CUDAContext>(1, 1, finite_data, context);
+  AllFiniteKernel<<<
+      chunks.size(),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      CopyMultiTensorChunks(chunks, scratch, context), finite_data);
+  int finite;
+  context->template CopyBytes<CUDAContext, CPUContext>(
+      sizeof(int), finite_data, &finite);
+  context->FinishDeviceComputation();
+  return finite;
+}
+
+#define CAFFE2_MIXED_PRECISION_UPDATES_CUDA(T)                            \
+  template <>                                                             \
+  void mixed_precision_momentum_sgd_update<T, CUDAContext>(               \
+      const int N,                                                        \
+      const T* g,                                                         \
+      const float* m,                                                     \
+      float* nm,                                                          \
+      const float* lr,                                                    \
+      const float inv_scale,                                              \
+      const float momentum,                                               \
+      const bool nesterov,                                                \
+      const float weight_decay,                                           \
+      float* param,                                                       \
+      float16* param_half,                                                \
+      CUDAContext* context) {                                             \
+    MixedPrecisionMomentumSGDKernel<T><<<                                 \
+        CAFFE_GET_BLOCKS(N),                                              \
+        CAFFE_CUDA_NUM_THREADS,                                           \
+        0,                                                                \
+        context->cuda_stream()>>>(                                        \
+        N,                                                                \
+        g,                                                                \
+        m,                                                                \
+        nm,                                                               \
+        lr,                                                               \
+        inv_scale,                                                        \
+        momentum,                                                         \
+        nesterov,                                                         \
+        weight_decay,                                                     \
+        param,                                                            \
+        param_half);                                                      \
+  }                                                                       \
+  template <>                                                             \
+  void mixed_precision_adam_update<T, CUDAContext>(                       \
+      const int N,                                                        \
+      const float* w,                                                     \
+      const T* g,                                                         \
+      const float* m,                                                     \
+      const float* v,                                                     \
+      float* nw,                                                          \
+      float* nm,                                                          \
+      float* nv,                                                          \
+      const float beta1,                                                  \
+      const float beta2,                                                  \
+      const float eps_hat,                                                \
+      const float correction,                                             \
+      const float* lr,                                                    \
+      const float inv_scale,                                              \
+      float16* w_half,                                                    \
+      CUDAContext* context) {                                             \
+    MixedPrecisionAdamKernel<T><<<                                        \
+        CAFFE_GET_BLOCKS(N),                                              \
+        CAFFE_CUDA_NUM_THREADS,                                           \
+        0,                                                                \
+        context->cuda_stream()>>>(                                        \
+        N,                                                                \
+        w,                                                                \
+        g,                                                                \
+        m,                                                                \
+        v,                                                                \
+        nw,                                                               \
+        nm,                                                               \
+        nv,                                                               \
+        beta1,                                                            \
+        beta2,                                                            \
+        eps_hat,                                                          \
+        correction,                                                       \
+        lr,                                                               \
+        inv_scale,                                                        \
+        w_half);                                                          \
+  }                                                                       \
+  template <>                                                             \
+  void mixed_precision_adagrad_update<T, CUDAContext>(                    \
+      const int N,                                                        \
+      const float* w,                                                     \
+      const T* g,                                                         \
+      const float* h,                                                     \
+      float* nw,                                                          \
+      float* nh,                                                          \
+      const float epsilon,                                                \
+      const float decay,                                                  \
+      const float* lr,                                                    \
+      const float inv_scale,                                              \
+      float16* w_half,                                                    \
+      CUDAContext* context) {                                             \
+    MixedPrecisionAdagradKernel<T><<<                                     \
+        CAFFE_GET_BLOCKS(N),                                              \
+        CAFFE_CUDA_NUM_THREADS,                                           \
+        0,                                                                \
+        context->cuda_stream()>>>(                                        \
+        N, w, g, h, nw, nh, epsilon, decay, lr, inv_scale, w_half);       \
+  }
+CAFFE2_MIXED_PRECISION_UPDATES_CUDA(float);
+CAFFE2_MIXED_PRECISION_UPDATES_CUDA(float16);
+#undef CAFFE2_MIXED_PRECISION_UPDATES_CUDA
+
+REGISTER_CUDA_OPERATOR(AllFinite, AllFiniteOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(UpdateLossScale, UpdateLossScaleOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MixedPrecisionMomentumSGDUpdate,
+    MixedPrecisionMomentumSGDUpdateOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MixedPrecisionAdam,
+    MixedPrecisionAdamOp<CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MixedPrecisionAdagrad,
+    MixedPrecisionAdagradOp<CUDAContext>);
+
+} // namespace caffe2
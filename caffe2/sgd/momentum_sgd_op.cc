@@ -72,6 +72,40 @@ but does not perform the parameter update.
 )DOC");
 SHOULD_NOT_DO_GRADIENT(MomentumSGDUpdate);
 
+REGISTER_CPU_OPERATOR(
+    MultiTensorMomentumSGDUpdate,
+    MultiTensorMomentumSGDUpdateOp<float, CPUContext>);
+OPERATOR_SCHEMA(MultiTensorMomentumSGDUpdate)
+    .NumInputsOutputs(
+        [](int in, int out) { return in % 3 == 1 && out == in - 1; })
+    .AllowInplace([](int in, int out) { return in == out; })
+    .EnforceInplace([](int in, int out) { return in == out && in % 3 == 2; })
+    .TensorInferenceFunction(
+        [](const OperatorDef& /* unused */, const vector<TensorShape>& in) {
+          return vector<TensorShape>(in.begin(), in.end() - 1);
+        })
+    .SetDoc(R"DOC(
+
+Performs the MomentumSGDUpdate of a list of parameters in one operator, which
+saves the overhead of running an operator, or launching a kernel, for every
+parameter of models with many small parameters. The inputs are
+(grad, moment, param) for every parameter then the learning rate shared by
+all of them, and the outputs (grad, moment, param) for every parameter, with
+the parameters updated in place.
+
+The elements of all parameters are split in chunks, which are spread over the
+threads of the workspace pool on CPU and computed by a single kernel on CUDA.
+
+)DOC")
+    .Arg("momentum", "Momentum hyperparameter.")
+    .Arg("nesterov", "(boolean) Whether to use Nesterov Accelerated Gradient.")
+    .Arg(
+        "num_threads",
+        "(int) Number of threads of the workspace pool the chunks are split "
+        "between on CPU: 0, the default, uses all of them and 1 the calling "
+        "thread");
+SHOULD_NOT_DO_GRADIENT(MultiTensorMomentumSGDUpdate);
+
 REGISTER_CPU_OPERATOR(
     SparseMomentumSGDUpdate,
     SparseMomentumSGDUpdateOp<float, CPUContext>);
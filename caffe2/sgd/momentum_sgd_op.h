@@ -1,6 +1,7 @@
 #pragma once
 
 #include "caffe2/core/operator.h"
+#include "caffe2/sgd/multi_tensor.h"
 
 namespace caffe2 {
 
@@ -35,6 +36,42 @@ void momentum_sgd_update(
   }
 }
 
+// The elements of a chunk of a MultiTensorMomentumSGDUpdate
+struct MomentumSGDChunk {
+  const float* g;
+  const float* m;
+  float* ng;
+  float* nm;
+  float* param;
+  int n;
+};
+
+template <typename Context>
+void multi_tensor_momentum_sgd_update(
+    const std::vector<MomentumSGDChunk>& chunks,
+    const float* lr,
+    const float momentum,
+    const bool nesterov,
+    Workspace* ws,
+    const int num_threads,
+    Tensor<Context>* /*scratch*/,
+    Context* context) {
+  RunMultiTensorChunks<MomentumSGDChunk>(
+      chunks, ws, num_threads, [&](const MomentumSGDChunk& chunk) {
+        momentum_sgd_update<Context>(
+            chunk.n,
+            chunk.g,
+            chunk.m,
+            chunk.ng,
+            chunk.nm,
+            lr,
+            momentum,
+            nesterov,
+            chunk.param,
+            context);
+      });
+}
+
 template <typename T, class Context>
 class MomentumSGDOp final : public Operator<Context> {
  public:
@@ -113,6 +150,75 @@ class MomentumSGDUpdateOp final : public Operator<Context> {
   OUTPUT_TAGS(OUTPUT_GRAD, OUTPUT_MOMENTUM, OUTPUT_PARAM);
 };
 
+// MomentumSGDUpdate of a list of parameters: the inputs are (grad, moment,
+// param) for every parameter, then lr, and the outputs (grad, moment, param)
+// for every parameter
+template <typename T, class Context>
+class MultiTensorMomentumSGDUpdateOp final : public Operator<Context> {
+ public:
+  USE_OPERATOR_CONTEXT_FUNCTIONS;
+  MultiTensorMomentumSGDUpdateOp(const OperatorDef& operator_def, Workspace* ws)
+      : Operator<Context>(operator_def, ws),
+        ws_(ws),
+        num_threads_(OperatorBase::GetSingleArgument<int>("num_threads", 0)),
+        momentum_(OperatorBase::GetSingleArgument<T>("momentum", 0.0)),
+        nesterov_(OperatorBase::GetSingleArgument<int>("nesterov", 0)) {
+    CAFFE_ENFORCE_GE(num_threads_, 0, "num_threads has to be non negative");
+    CAFFE_ENFORCE_EQ((InputSize() - 1) % 3, 0);
+    CAFFE_ENFORCE_EQ(OutputSize(), InputSize() - 1);
+  }
+
+  bool RunOnDevice() override {
+    const int num_tensors = OutputSize() / 3;
+    const auto& lr = Input(InputSize() - 1);
+    CAFFE_ENFORCE_EQ(lr.size(), 1);
+    sizes_.clear();
+    for (int i = 0; i < num_tensors; ++i) {
+      CAFFE_ENFORCE(OperatorBase::InputIsType<Tensor<Context>>(3 * i));
+      CAFFE_ENFORCE(OperatorBase::InputIsType<Tensor<Context>>(3 * i + 1));
+      const auto& grad = Input(3 * i);
+      CAFFE_ENFORCE_EQ(grad.size(), Input(3 * i + 1).size());
+      CAFFE_ENFORCE_EQ(grad.size(), Input(3 * i + 2).size());
+      Output(3 * i)->ResizeLike(grad);
+      Output(3 * i + 1)->ResizeLike(Input(3 * i + 1));
+      sizes_.push_back(grad.size());
+    }
+
+    chunks_.clear();
+    ForEachMultiTensorChunk(sizes_, [this](int i, TIndex offset, int n) {
+      chunks_.push_back(MomentumSGDChunk{
+          Input(3 * i).template data<T>() + offset,
+          Input(3 * i + 1).template data<T>() + offset,
+          Output(3 * i)->template mutable_data<T>() + offset,
+          Output(3 * i + 1)->template mutable_data<T>() + offset,
+          Output(3 * i + 2)->template mutable_data<T>() + offset,
+          n});
+    });
+    multi_tensor_momentum_sgd_update<Context>(
+        chunks_,
+        lr.template data<T>(),
+        momentum_,
+        nesterov_,
+        ws_,
+        num_threads_,
+        &scratch_,
+        &context_);
+    return true;
+  }
+
+ protected:
+  Workspace* ws_;
+  // Number of threads of the workspace pool the chunks are split between on
+  // CPU: 0 uses all of them, 1 the calling thread
+  int num_threads_;
+  T momentum_;
+  bool nesterov_;
+  std::vector<TIndex> sizes_;
+  std::vector<MomentumSGDChunk> chunks_;
+  // The chunks copied to the device
+  Tensor<Context> scratch_;
+};
+
 template <typename T, class Context>
 class SparseMomentumSGDUpdateOp final : public Operator<Context> {
  public:
@@ -1,6 +1,7 @@
 #include "momentum_sgd_op.h"
 #include "caffe2/core/common_gpu.h"
 #include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/multi_tensor_gpu.h"
 
 namespace caffe2 {
 
@@ -97,6 +98,50 @@ __global__ void SparseMomentumSGDKernel(
   }
 }
 
+__global__ void MultiTensorMomentumSGDKernel(
+    const MomentumSGDChunk* chunks,
+    const float* lr,
+    const float momentum,
+    const bool nesterov) {
+  const MomentumSGDChunk chunk = chunks[blockIdx.x];
+  const float LR = lr[0];
+  for (int i = threadIdx.x; i < chunk.n; i += blockDim.x) {
+    const float mi = chunk.m[i];
+    float adjusted_gradient;
+    if (!nesterov) {
+      adjusted_gradient = LR * chunk.g[i] + momentum * mi;
+      chunk.nm[i] = adjusted_gradient;
+    } else {
+      const float mi_new = momentum * mi + LR * chunk.g[i];
+      chunk.nm[i] = mi_new;
+      adjusted_gradient = (1 + momentum) * mi_new - momentum * mi;
+    }
+    chunk.ng[i] = adjusted_gradient;
+    chunk.param[i] -= adjusted_gradient;
+  }
+}
+
+template <>
+void multi_tensor_momentum_sgd_update<CUDAContext>(
+    const std::vector<MomentumSGDChunk>& chunks,
+    const float* lr,
+    const float momentum,
+    const bool nesterov,
+    Workspace* /*ws*/,
+    const int /*num_threads*/,
+    Tensor<CUDAContext>* scratch,
+    CUDAContext* context) {
+  if (chunks.empty()) {
+    return;
+  }
+  MultiTensorMomentumSGDKernel<<<
+      chunks.size(),
+      CAFFE_CUDA_NUM_THREADS,
+      0,
+      context->cuda_stream()>>>(
+      CopyMultiTensorChunks(chunks, scratch, context), lr, momentum, nesterov);
+}
+
 
 // Specialization of DoRunWithType for CUDA
 template <>
@@ -122,5 +167,8 @@ bool SparseMomentumSGDUpdateOp<float, CUDAContext>::DoRunWithType() {
 REGISTER_CUDA_OPERATOR(MomentumSGD, MomentumSGDOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(MomentumSGDUpdate, MomentumSGDUpdateOp<float, CUDAContext>);
 REGISTER_CUDA_OPERATOR(SparseMomentumSGDUpdate, SparseMomentumSGDUpdateOp<float, CUDAContext>);
+REGISTER_CUDA_OPERATOR(
+    MultiTensorMomentumSGDUpdate,
+    MultiTensorMomentumSGDUpdateOp<float, CUDAContext>);
 
 }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
+
+namespace caffe2 {
+
+// The multi-tensor optimizer operators update a list of parameters in one
+// operator. The elements of all parameters are split in chunks of at most
+// kMultiTensorChunkSize elements, run by the threads of the workspace pool on
+// CPU and by the blocks of a single kernel on CUDA.
+constexpr int kMultiTensorChunkSize = 1 << 16;
+
+// Calls make_chunk(tensor, offset, n) for every chunk of the tensors of the
+// given sizes, in order
+template <typename MakeChunk>
+void ForEachMultiTensorChunk(
+    const std::vector<TIndex>& sizes,
+    MakeChunk make_chunk) {
+  for (int tensor = 0; tensor < sizes.size(); ++tensor) {
+    for (TIndex offset = 0; offset < sizes[tensor];
+         offset += kMultiTensorChunkSize) {
+      make_chunk(
+          tensor,
+          offset,
+          static_cast<int>(std::min<TIndex>(
+              kMultiTensorChunkSize, sizes[tensor] - offset)));
+    }
+  }
+}
+
+// Calls fn on every chunk, split between num_threads threads of the pool of
+// ws: 0 uses all of them and 1 the calling thread
+template <typename Chunk>
+void RunMultiTensorChunks(
+    const std::vector<Chunk>& chunks,
+    Workspace* ws,
+    const int num_threads,
+    const std::function<void(const Chunk&)>& fn) {
+  int num_ranges = 1;
+  if (num_threads != 1 && chunks.size() > 1) {
+    const int pool_threads = ws->GetThreadPool()->getNumThreads();
+    num_ranges = std::min<int>(
+        chunks.size(),
+        num_threads == 0 ? pool_threads : std::min(num_threads, pool_threads));
+  }
+  if (num_ranges <= 1) {
+    for (const auto& chunk : chunks) {
+      fn(chunk);
+    }
+    return;
+  }
+  ws->GetThreadPool()->runRanges(num_ranges, [&](size_t range) {
+    const size_t begin = chunks.size() * range / num_ranges;
+    const size_t end = chunks.size() * (range + 1) / num_ranges;
+    for (size_t i = begin; i < end; ++i) {
+      fn(chunks[i]);
+    }
+  });
+}
+
+} // namespace caffe2
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include "caffe2/core/context_gpu.h"
+#include "caffe2/sgd/multi_tensor.h"
+
+namespace caffe2 {
+
+// Copies the chunks of a multi-tensor operator to scratch on the device, for
+// the kernel running one block per chunk
+template <typename Chunk>
+const Chunk* CopyMultiTensorChunks(
+    const std::vector<Chunk>& chunks,
+    Tensor<CUDAContext>* scratch,
+    CUDAContext* context) {
+  const size_t nbytes = chunks.size() * sizeof(Chunk);
+  scratch->Resize(nbytes);
+  auto* data = scratch->template mutable_data<uint8_t>();
+  context->template CopyBytes<CPUContext, CUDAContext>(
+      nbytes, chunks.data(), data);
+  return reinterpret_cast<const Chunk*>(data);
+}
+
+} // namespace caffe2
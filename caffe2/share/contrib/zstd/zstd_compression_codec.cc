@@ -0,0 +1,61 @@
+#include "caffe2/core/compression_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <zstd.h>
+
+#include "caffe2/core/flags.h"
+
+CAFFE2_DEFINE_int(
+    caffe2_zstd_compression_level,
+    3,
+    "Compression level of the zstd codec used in tensor serialization");
+
+namespace caffe2 {
+
+namespace {
+
+// The compressed data is prefixed by the size of the original data, which
+// avoids depending on the frame content size API of newer zstd versions
+class ZstdCodec final : public CompressionCodec {
+ public:
+  std::string Compress(const std::string& data) override {
+    const uint64_t size = data.size();
+    std::string out(sizeof(size) + ZSTD_compressBound(data.size()), '\0');
+    memcpy(&out[0], &size, sizeof(size));
+    size_t compressed_size = ZSTD_compress(
+        &out[sizeof(size)],
+        out.size() - sizeof(size),
+        data.data(),
+        data.size(),
+        FLAGS_caffe2_zstd_compression_level);
+    CAFFE_ENFORCE(
+        !ZSTD_isError(compressed_size), ZSTD_getErrorName(compressed_size));
+    out.resize(sizeof(size) + compressed_size);
+    return out;
+  }
+
+  std::string Decompress(const std::string& data) override {
+    uint64_t size;
+    CAFFE_ENFORCE_GE(data.size(), sizeof(size), "Truncated compressed data");
+    memcpy(&size, data.data(), sizeof(size));
+    std::string out(size, '\0');
+    size_t decompressed_size = ZSTD_decompress(
+        &out[0],
+        out.size(),
+        data.data() + sizeof(size),
+        data.size() - sizeof(size));
+    CAFFE_ENFORCE(
+        !ZSTD_isError(decompressed_size),
+        ZSTD_getErrorName(decompressed_size));
+    CAFFE_ENFORCE_EQ(decompressed_size, size);
+    return out;
+  }
+};
+
+} // namespace
+
+REGISTER_COMPRESSION_CODEC(zstd, ZstdCodec);
+
+} // namespace caffe2
@@ -1,5 +1,7 @@
 #include "caffe2/transforms/common_subexpression_elimination.h"
 
+#include <algorithm>
+
 #include "caffe2/core/common.h"
 #include "caffe2/core/net.h"
 #include "caffe2/proto/caffe2.pb.h"
@@ -9,6 +11,45 @@ namespace caffe2 {
 using transform::Graph;
 using transform::Node;
 
+namespace {
+
+// Checks if the inputs of op can be reordered without changing its outputs.
+bool is_commutative(const OperatorDef& op) {
+  static const std::set<string> commutative_ops = {"Sum", "Max", "Min", "Mean"};
+  // Add and Mul broadcast their second input to the first one, if asked to.
+  static const std::set<string> broadcast_ops = {"Add", "Mul"};
+  if (commutative_ops.count(op.type())) {
+    return true;
+  }
+  if (!broadcast_ops.count(op.type())) {
+    return false;
+  }
+  for (const auto& arg : op.arg()) {
+    if (arg.name() == "broadcast" && arg.i() != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The arguments of op keyed by name, so that their order doesn't matter.
+std::map<string, string> normalized_arguments(const OperatorDef& op) {
+  std::map<string, string> args;
+  for (const auto& arg : op.arg()) {
+    args[arg.name()] = arg.SerializeAsString();
+  }
+  return args;
+}
+
+// The parents of node, with the blobs of every edge in sorted order.
+std::map<int, std::vector<string>> sorted_parents(const Node& node) {
+  auto parents = node.parents;
+  for (auto& parent : parents) {
+    std::sort(parent.second.begin(), parent.second.end());
+  }
+  return parents;
+}
+
 // Checks if the node at model_idx and the node at candidate_idx are
 // "common subexpressions". That is, do they have the same function, and
 // take in the exact same input. If so, then their function is duplicated.
@@ -21,28 +62,38 @@ bool are_nodes_common(const Graph& g, int model_idx, int candidate_idx) {
   if (model_node.op.type() != candidate_node.op.type()) {
     return false;
   }
-  // Arguments need to match.
-  if (!MatchArguments(model_node.op, candidate_node.op)) {
+  // So do the engine and the device they run on.
+  if (model_node.op.engine() != candidate_node.op.engine() ||
+      model_node.op.device_option().SerializeAsString() !=
+          candidate_node.op.device_option().SerializeAsString()) {
+    return false;
+  }
+  // Arguments need to match, in any order.
+  if (normalized_arguments(model_node.op) !=
+      normalized_arguments(candidate_node.op)) {
     return false;
   }
   // Inputs need to match.
   if (model_node.op.input_size() != candidate_node.op.input_size()) {
     return false;
   }
-  // If any input_blob name is different, this is not okay.
-  for (int i = 0; i < model_node.op.input_size(); i++) {
-    if (candidate_node.op.input(i) != model_node.op.input(i)) {
-      return false;
-    }
+  // If any input_blob name is different, this is not okay. Commutative
+  // operators may read them in any order.
+  std::vector<string> model_inputs(
+      model_node.op.input().begin(), model_node.op.input().end());
+  std::vector<string> candidate_inputs(
+      candidate_node.op.input().begin(), candidate_node.op.input().end());
+  if (is_commutative(model_node.op)) {
+    std::sort(model_inputs.begin(), model_inputs.end());
+    std::sort(candidate_inputs.begin(), candidate_inputs.end());
+  }
+  if (model_inputs != candidate_inputs) {
+    return false;
   }
   // Now, we also need to check that each blob comes from the same parent, or
   // if they are external (isn't in parents). This is equivalent to a
   // map equality (since parent edges can only contain up to one blob).
-  if (model_node.parents.size() != candidate_node.parents.size() ||
-      !std::equal(
-          model_node.parents.begin(),
-          model_node.parents.end(),
-          candidate_node.parents.begin())) {
+  if (sorted_parents(model_node) != sorted_parents(candidate_node)) {
     return false;
   }
 
@@ -53,10 +104,27 @@ bool are_nodes_common(const Graph& g, int model_idx, int candidate_idx) {
   return true;
 }
 
+// Merged outputs are renamed, so the ones the net exposes can't be.
+bool writes_external_output(const Graph& g, int idx) {
+  const auto& external_output = g.netdef().external_output();
+  for (const auto& blob : g.node(idx).op.output()) {
+    if (std::find(external_output.begin(), external_output.end(), blob) !=
+        external_output.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
 bool CommonSubexpressionEliminationTransform::PatternRule(
     const Graph& g,
     const std::vector<int>& subgraph,
     int idx) {
+  if (writes_external_output(g, idx)) {
+    return false;
+  }
   if (subgraph.size() == 0) {
     if (IsWhitelisted(g.node(idx).op.type()))
       return true;
@@ -22,8 +22,11 @@ namespace caffe2 {
  * Then, we can eliminate the common subexpressions X and Y, and merge them to
  * Z, where X_a, X_b, Y_a, Y_b, and Y_c all read from Z.
  *
- *
- * TODO(benz): Fix the error to not match nodes that write to external output.
+ * Arguments are compared as sets, regardless of their order. The inputs of
+ * commutative operators (Sum, Max, Min, Mean, and Add and Mul without
+ * broadcast) are compared regardless of their order too. Operators only
+ * match on the same engine and device, and operators writing external
+ * outputs of the net are never merged, since their outputs are renamed.
  */
 class CommonSubexpressionEliminationTransform : public Transform {
  public:
@@ -46,7 +49,24 @@ class CommonSubexpressionEliminationTransform : public Transform {
   bool IsWhitelisted(string op_type) {
     return whitelisted_ops_.count(op_type);
   }
-  std::set<string> whitelisted_ops_ = {"LearningRate", "FC"};
+  std::set<string> whitelisted_ops_ = {"LearningRate",
+                                      "FC",
+                                      "MatMul",
+                                      "Add",
+                                      "Sub",
+                                      "Mul",
+                                      "Div",
+                                      "Sum",
+                                      "Max",
+                                      "Min",
+                                      "Mean",
+                                      "Scale",
+                                      "Relu",
+                                      "Sigmoid",
+                                      "Tanh",
+                                      "Softmax",
+                                      "Transpose",
+                                      "Cast"};
 };
 
 } // namespace caffe2
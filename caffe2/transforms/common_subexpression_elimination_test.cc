@@ -98,6 +98,62 @@ TEST(CommonSubexpressionEliminationTest, TestFromExternal) {
       transformed_netdef.op(0).output(0), transformed_netdef.op(3).input(0));
 }
 
+/**
+ * Commutative inputs and arguments are matched in any order, but not the
+ * inputs of non commutative operators, nor operators on other devices.
+ */
+TEST(CommonSubexpressionEliminationTest, TestNormalization) {
+  NetDef netdef;
+  OperatorDef* op;
+
+  op = AddOp(&netdef, "Add", {"a", "b"}, {"add1"});
+  op = AddOp(&netdef, "Add", {"b", "a"}, {"add2"});
+  op = AddOp(&netdef, "Sub", {"a", "b"}, {"sub1"});
+  op = AddOp(&netdef, "Sub", {"b", "a"}, {"sub2"});
+  op = AddOp(&netdef, "Scale", {"a"}, {"scale1"});
+  op->add_arg()->CopyFrom(MakeArgument<float>("scale", 2));
+  op->add_arg()->CopyFrom(MakeArgument<int>("foo", 1));
+  op = AddOp(&netdef, "Scale", {"a"}, {"scale2"});
+  op->add_arg()->CopyFrom(MakeArgument<int>("foo", 1));
+  op->add_arg()->CopyFrom(MakeArgument<float>("scale", 2));
+  op = AddOp(&netdef, "Scale", {"a"}, {"scale3"});
+  op->add_arg()->CopyFrom(MakeArgument<int>("foo", 1));
+  op->add_arg()->CopyFrom(MakeArgument<float>("scale", 2));
+  op->mutable_device_option()->set_device_type(CUDA);
+  op = AddOp(
+      &netdef,
+      "Sum",
+      {"add1", "add2", "sub1", "sub2", "scale1", "scale2", "scale3"},
+      {"out"});
+  netdef.add_external_output("out");
+
+  auto t = TransformRegistry()->Create("CommonSubexpressionElimination");
+  CHECK(t);
+  const auto matches = t->PatternMatch(Graph(netdef));
+  ASSERT_EQ(matches.size(), 2);
+  EXPECT_EQ(matches.at(0), std::vector<int>({0, 1}));
+  EXPECT_EQ(matches.at(1), std::vector<int>({4, 5}));
+  NetDef transformed_netdef = t->ApplyTo(netdef);
+  EXPECT_EQ(transformed_netdef.op_size(), 6);
+}
+
+/**
+ * The outputs of merged operators are renamed, so the ones that are external
+ * outputs of the net are left alone.
+ */
+TEST(CommonSubexpressionEliminationTest, TestExternalOutput) {
+  NetDef netdef;
+  AddOp(&netdef, "FC", {"in", "w", "b"}, {"out1"});
+  AddOp(&netdef, "FC", {"in", "w", "b"}, {"out2"});
+  netdef.add_external_output("out1");
+  netdef.add_external_output("out2");
+
+  auto t = TransformRegistry()->Create("CommonSubexpressionElimination");
+  CHECK(t);
+  EXPECT_EQ(t->PatternMatch(Graph(netdef)).size(), 0);
+  EXPECT_EQ(t->ApplyTo(netdef).op_size(), 2);
+}
+
 } // namespace
 
 } // namespace Caffe2
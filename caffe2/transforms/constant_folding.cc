@@ -0,0 +1,178 @@
+#include "caffe2/transforms/constant_folding.h"
+
+#include <map>
+#include <set>
+
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Operators whose outputs only depend on their inputs and arguments, so
+// that they compute the same outputs from the same constants at every run.
+// Random fills, readers, counters and queues are not.
+const std::set<std::string>& FoldableOps() {
+  static const std::set<std::string> ops{
+      // Layout and shape
+      "Transpose",
+      "Reshape",
+      "Flatten",
+      "FlattenToVec",
+      "ExpandDims",
+      "Squeeze",
+      "Concat",
+      "Split",
+      "Slice",
+      "Tile",
+      "Gather",
+      "Copy",
+      "Cast",
+      "Shape",
+      "Size",
+      // Fills
+      "ConstantFill",
+      "GivenTensorFill",
+      "GivenTensorIntFill",
+      "GivenTensorInt64Fill",
+      "GivenTensorDoubleFill",
+      "GivenTensorBoolFill",
+      "Range",
+      // Math
+      "Add",
+      "Sub",
+      "Mul",
+      "Div",
+      "Sum",
+      "Mean",
+      "Max",
+      "Min",
+      "Pow",
+      "Sqr",
+      "Sqrt",
+      "Exp",
+      "Log",
+      "Negative",
+      "Abs",
+      "Scale",
+      "Clip",
+      "Relu",
+      "Sigmoid",
+      "Tanh",
+      "Softmax",
+      "Normalize",
+      "SumReduceLike",
+      "ReduceSum",
+      "ReduceMean",
+      "ReduceFrontSum",
+      "ReduceBackSum",
+      "MatMul",
+      "BatchMatMul",
+      "FC",
+  };
+  return ops;
+}
+
+// Control flow operators run nets given as arguments
+bool HasNetArgument(const OperatorDef& op) {
+  for (const auto& arg : op.arg()) {
+    if (arg.has_n() || arg.nets_size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+NetDef FoldConstants(
+    const NetDef& run_net,
+    const std::vector<std::string>& inputs,
+    NetDef* init_net) {
+  CAFFE_ENFORCE(init_net);
+  for (const auto& op : run_net.op()) {
+    if (HasNetArgument(op)) {
+      return run_net;
+    }
+  }
+
+  // Number of operators of run_net writing every blob
+  std::map<std::string, int> writers;
+  for (const auto& op : run_net.op()) {
+    for (const auto& output : op.output()) {
+      ++writers[output];
+    }
+  }
+  std::set<std::string> constants;
+  for (const auto& op : init_net->op()) {
+    for (const auto& output : op.output()) {
+      if (!writers.count(output)) {
+        constants.insert(output);
+      }
+    }
+  }
+  for (const auto& input : inputs) {
+    constants.erase(input);
+  }
+  const std::set<std::string> external_inputs(
+      run_net.external_input().begin(), run_net.external_input().end());
+
+  NetDef folded_net = run_net;
+  folded_net.clear_op();
+  std::vector<OperatorDef> folded_ops;
+  // Blobs read by the operators so far, whose writers can't be folded: the
+  // readers would see the value of the previous run
+  std::set<std::string> read;
+  for (const auto& op : run_net.op()) {
+    bool foldable = FoldableOps().count(op.type()) > 0;
+    for (const auto& input : op.input()) {
+      foldable = foldable && constants.count(input);
+    }
+    for (const auto& output : op.output()) {
+      foldable = foldable && writers[output] == 1 && !read.count(output) &&
+          !constants.count(output) && !external_inputs.count(output);
+    }
+    if (foldable) {
+      folded_ops.push_back(op);
+      if (!op.has_device_option() && run_net.has_device_option()) {
+        folded_ops.back().mutable_device_option()->CopyFrom(
+            run_net.device_option());
+      }
+      constants.insert(op.output().begin(), op.output().end());
+    } else {
+      folded_net.add_op()->CopyFrom(op);
+    }
+    read.insert(op.input().begin(), op.input().end());
+  }
+  if (folded_ops.empty()) {
+    return run_net;
+  }
+
+  // The folded outputs that run_net still needs
+  std::set<std::string> needed(
+      run_net.external_output().begin(), run_net.external_output().end());
+  for (const auto& op : folded_net.op()) {
+    needed.insert(op.input().begin(), op.input().end());
+  }
+  std::set<std::string> init_outputs(
+      init_net->external_output().begin(), init_net->external_output().end());
+  for (const auto& op : folded_ops) {
+    init_net->add_op()->CopyFrom(op);
+    for (const auto& output : op.output()) {
+      if (!needed.count(output)) {
+        continue;
+      }
+      if (!external_inputs.count(output)) {
+        folded_net.add_external_input(output);
+      }
+      if (init_outputs.insert(output).second) {
+        init_net->add_external_output(output);
+      }
+    }
+  }
+  VLOG(1) << "Folded " << folded_ops.size() << " constant operators of "
+          << run_net.name() << " into " << init_net->name();
+  return folded_net;
+}
+
+} // namespace caffe2
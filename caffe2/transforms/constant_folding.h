@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Constant folding for inference nets.
+ *
+ * The blobs written by init_net are constants of run_net, unless run_net
+ * writes them too or they are among inputs, the blobs fed before every run.
+ * The operators of run_net that only read constants, are pure tensor
+ * computations (transposes, reshapes, fills, pointwise math, FC and MatMul
+ * and the like, see constant_folding.cc) and are the only writers of their
+ * outputs are constants of the same kind: they are moved to the end of
+ * init_net, which then computes their outputs once, and removed from
+ * run_net. Operators keep the device option of run_net if they had none.
+ *
+ * Folded outputs that run_net still reads become external inputs of run_net
+ * and external outputs of init_net. Returns the transformed run_net; both
+ * are left as is if run_net has control flow.
+ */
+NetDef FoldConstants(
+    const NetDef& run_net,
+    const std::vector<std::string>& inputs,
+    NetDef* init_net);
+
+} // namespace caffe2
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/constant_folding.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddFill(
+    NetDef* net,
+    const std::string& name,
+    const std::vector<int>& shape,
+    const std::vector<float>& values) {
+  auto* op = AddOp(net, "GivenTensorFill", {}, {name});
+  op->add_arg()->CopyFrom(MakeArgument<vector<int>>("shape", shape));
+  op->add_arg()->CopyFrom(MakeArgument<vector<float>>("values", values));
+}
+
+// Init net of the weights W [2, 3] and b [2], and of the input X [2, 3]
+NetDef InitNet() {
+  NetDef init_net;
+  init_net.set_name("init");
+  AddFill(&init_net, "W", {3, 2}, {1, -2, 3, 0.5f, -1, 2});
+  AddFill(&init_net, "b", {2}, {0.25f, -0.5f});
+  AddFill(&init_net, "X", {2, 3}, {1, 2, 3, -1, 0, 4});
+  return init_net;
+}
+
+// Runs both pairs of nets in new workspaces and compares output Y
+void RunAndCompare(
+    const NetDef& init_net,
+    const NetDef& run_net,
+    const NetDef& folded_init_net,
+    const NetDef& folded_run_net) {
+  Workspace ws;
+  CAFFE_ENFORCE(ws.RunNetOnce(init_net));
+  CAFFE_ENFORCE(ws.RunNetOnce(run_net));
+  const auto& expected = ws.GetBlob("Y")->Get<TensorCPU>();
+  Workspace folded_ws;
+  CAFFE_ENFORCE(folded_ws.RunNetOnce(folded_init_net));
+  CAFFE_ENFORCE(folded_ws.RunNetOnce(folded_run_net));
+  const auto& Y = folded_ws.GetBlob("Y")->Get<TensorCPU>();
+  ASSERT_EQ(Y.dims(), expected.dims());
+  for (TIndex i = 0; i < Y.size(); ++i) {
+    EXPECT_FLOAT_EQ(Y.data<float>()[i], expected.data<float>()[i]);
+  }
+}
+
+TEST(ConstantFoldingTest, TestWeightTransposeAndScale) {
+  const NetDef init_net = InitNet();
+  NetDef run_net;
+  run_net.set_name("run");
+  run_net.add_external_input("X");
+  run_net.add_external_input("W");
+  run_net.add_external_input("b");
+  AddOp(&run_net, "Transpose", {"W"}, {"Wt"});
+  auto* fill = AddOp(&run_net, "ConstantFill", {}, {"s"});
+  fill->add_arg()->CopyFrom(MakeArgument<vector<int>>("shape", {2}));
+  fill->add_arg()->CopyFrom(MakeArgument<float>("value", 3));
+  AddOp(&run_net, "Mul", {"b", "s"}, {"b3"});
+  AddOp(&run_net, "FC", {"X", "Wt", "b3"}, {"Y"});
+  run_net.add_external_output("Y");
+
+  NetDef folded_init_net = init_net;
+  const NetDef folded_run_net = FoldConstants(run_net, {"X"}, &folded_init_net);
+  ASSERT_EQ(folded_run_net.op_size(), 1);
+  EXPECT_EQ(folded_run_net.op(0).type(), "FC");
+  ASSERT_EQ(folded_init_net.op_size(), init_net.op_size() + 3);
+  EXPECT_EQ(folded_init_net.op(3).type(), "Transpose");
+  // Only the folded blobs FC reads are passed on
+  const std::vector<std::string> external_inputs(
+      folded_run_net.external_input().begin(),
+      folded_run_net.external_input().end());
+  EXPECT_EQ(
+      external_inputs,
+      std::vector<std::string>({"X", "W", "b", "Wt", "b3"}));
+  EXPECT_EQ(folded_init_net.external_output_size(), 2);
+  RunAndCompare(init_net, run_net, folded_init_net, folded_run_net);
+}
+
+TEST(ConstantFoldingTest, TestInputsAndWrittenBlobsAreKept) {
+  const NetDef init_net = InitNet();
+  NetDef run_net;
+  run_net.add_external_input("X");
+  run_net.add_external_input("W");
+  run_net.add_external_input("b");
+  // X is fed, even if the init net fills it
+  AddOp(&run_net, "Relu", {"X"}, {"X2"});
+  // b is written by the net, so it isn't constant
+  AddOp(&run_net, "Scale", {"b"}, {"b"});
+  AddOp(&run_net, "FC", {"X2", "W", "b"}, {"Y"});
+  // Random fills differ at every run
+  auto* fill = AddOp(&run_net, "UniformFill", {}, {"noise"});
+  fill->add_arg()->CopyFrom(MakeArgument<vector<int>>("shape", {2}));
+  run_net.add_external_output("Y");
+
+  NetDef folded_init_net = init_net;
+  const NetDef folded_run_net = FoldConstants(run_net, {"X"}, &folded_init_net);
+  EXPECT_EQ(folded_run_net.op_size(), run_net.op_size());
+  EXPECT_EQ(folded_init_net.op_size(), init_net.op_size());
+}
+
+TEST(ConstantFoldingTest, TestReadBeforeWrittenIsKept) {
+  const NetDef init_net = InitNet();
+  NetDef run_net;
+  run_net.add_external_input("W");
+  // Reads the value of Wt of the previous run
+  AddOp(&run_net, "Copy", {"Wt"}, {"Y"});
+  AddOp(&run_net, "Transpose", {"W"}, {"Wt"});
+
+  NetDef folded_init_net = init_net;
+  const NetDef folded_run_net = FoldConstants(run_net, {}, &folded_init_net);
+  EXPECT_EQ(folded_run_net.op_size(), 2);
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,346 @@
+#include "caffe2/transforms/conv_bn_relu_fusion.h"
+
+#include <cmath>
+#include <set>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator_schema.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/utils/proto_utils.h"
+#include "nomnigraph/Converters/Caffe2.h"
+#include "nomnigraph/Support/Casting.h"
+#include "nomnigraph/Support/Pointer.h"
+
+namespace caffe2 {
+
+namespace {
+
+using nom::repr::NNGraph;
+namespace nn = nom::repr::nn;
+
+OperatorDef* GetOperatorDef(NNGraph::NodeRef node) {
+  auto* op = nn::get<nom::repr::NeuralNetOperator>(node);
+  return reinterpret_cast<OperatorDef*>(op->getMutableAnnotation()->getSaved());
+}
+
+std::string GetName(NNGraph::NodeRef node) {
+  return nn::get<nom::repr::NeuralNetData>(node)->getName();
+}
+
+// The float tensor of ws a tensor node stands for, if the net does not
+// compute it, or else nullptr
+const TensorCPU* GetConstantTensor(const Workspace* ws, NNGraph::NodeRef node) {
+  if (nn::hasProducer(node)) {
+    return nullptr;
+  }
+  const Blob* blob = ws->GetBlob(GetName(node));
+  if (!blob || !blob->IsType<TensorCPU>()) {
+    return nullptr;
+  }
+  const auto& tensor = blob->Get<TensorCPU>();
+  return tensor.IsType<float>() ? &tensor : nullptr;
+}
+
+const TensorCPU* GetChannelTensor(
+    const Workspace* ws,
+    NNGraph::NodeRef node,
+    const TIndex channels) {
+  const TensorCPU* tensor = GetConstantTensor(ws, node);
+  return tensor && tensor->ndim() == 1 && tensor->size() == channels
+      ? tensor
+      : nullptr;
+}
+
+class ConvBNReluFusion {
+ public:
+  ConvBNReluFusion(const NetDef& net, Workspace* ws)
+      : net_(net),
+        ws_(ws),
+        external_outputs_(
+            net.external_output().begin(),
+            net.external_output().end()),
+        used_names_(net.external_input().begin(), net.external_input().end()) {
+    for (const auto& op : net.op()) {
+      used_names_.insert(op.input().begin(), op.input().end());
+      used_names_.insert(op.output().begin(), op.output().end());
+    }
+  }
+
+  NetDef Run() {
+    // The module points into its net, which thus has to outlive it
+    NetDef fused_net = net_;
+    for (int i = 0; i < fused_net.op_size(); ++i) {
+      op_index_[fused_net.mutable_op(i)] = i;
+    }
+    fused_net_ = &fused_net;
+    auto module = nom::converters::convertFromCaffe2Proto(fused_net);
+    graph_ = &module.dataFlow;
+
+    // Collected first, as the fusions delete nodes
+    std::vector<NNGraph::NodeRef> convs;
+    for (auto node : graph_->getMutableNodes()) {
+      if (nn::is<nom::repr::NeuralNetOperator>(node) &&
+          nn::is<nom::repr::Conv>(node)) {
+        convs.push_back(node);
+      }
+    }
+    for (auto conv : convs) {
+      FoldAffine(conv);
+      FuseRelu(conv);
+    }
+
+    const NetDef converted = nom::converters::convertToCaffe2Proto(module);
+    NetDef result = net_;
+    result.mutable_op()->CopyFrom(converted.op());
+    return result;
+  }
+
+ private:
+  // The only reader of the output of conv, if the output is not an output
+  // of the net and is only read as the first input of the reader
+  NNGraph::NodeRef GetOnlyConsumer(NNGraph::NodeRef conv) {
+    const auto outputs = nn::getOutputs(conv);
+    if (outputs.size() != 1 || external_outputs_.count(GetName(outputs[0]))) {
+      return nullptr;
+    }
+    const auto consumers = nn::getConsumers(outputs[0]);
+    if (consumers.size() != 1 ||
+        nn::getOutputs(consumers[0]).size() != 1) {
+      return nullptr;
+    }
+    const auto inputs = nn::getInputs(consumers[0]);
+    for (size_t i = 1; i < inputs.size(); ++i) {
+      if (inputs[i] == outputs[0]) {
+        return nullptr;
+      }
+    }
+    return inputs[0] == outputs[0] ? consumers[0] : nullptr;
+  }
+
+  // Whether conv can write the output of next in its place: no op left
+  // between them may use the name
+  bool CanMoveOutput(NNGraph::NodeRef conv, NNGraph::NodeRef next) {
+    const auto name = GetName(nn::getOutputs(next)[0]);
+    const int first = op_index_.at(GetOperatorDef(conv));
+    const int last = op_index_.at(GetOperatorDef(next));
+    for (int i = first + 1; i < last; ++i) {
+      const auto& op = fused_net_->op(i);
+      if (removed_ops_.count(&op)) {
+        continue;
+      }
+      for (const auto& blob : op.input()) {
+        if (blob == name) {
+          return false;
+        }
+      }
+      for (const auto& blob : op.output()) {
+        if (blob == name) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Makes conv write the output of next, and drops next with the output of
+  // conv it read
+  void RemoveConsumer(NNGraph::NodeRef conv, NNGraph::NodeRef next) {
+    auto Y = nn::getOutputs(conv)[0];
+    auto Z = nn::getOutputs(next)[0];
+    removed_ops_.insert(GetOperatorDef(next));
+    graph_->deleteNode(next);
+    graph_->deleteNode(Y);
+    graph_->createEdge(conv, Z);
+  }
+
+  // Folds the SpatialBN next into the per channel scale and shift of the
+  // output of the conv
+  bool FoldSpatialBN(
+      NNGraph::NodeRef next,
+      const std::string& order,
+      std::vector<float>* scale,
+      std::vector<float>* shift) {
+    const auto& def = *GetOperatorDef(next);
+    ArgumentHelper args(def);
+    if (def.type() != "SpatialBN" ||
+        !args.GetSingleArgument<int>(OpSchema::Arg_IsTest, 0) ||
+        args.GetSingleArgument<std::string>("order", "NCHW") != order) {
+      return false;
+    }
+    const auto inputs = nn::getInputs(next);
+    if (inputs.size() != 5) {
+      return false;
+    }
+    const TIndex M = scale->size();
+    const TensorCPU* bn_scale = GetChannelTensor(ws_, inputs[1], M);
+    const TensorCPU* bn_bias = GetChannelTensor(ws_, inputs[2], M);
+    const TensorCPU* mean = GetChannelTensor(ws_, inputs[3], M);
+    const TensorCPU* var = GetChannelTensor(ws_, inputs[4], M);
+    if (!bn_scale || !bn_bias || !mean || !var) {
+      return false;
+    }
+    const double epsilon = args.GetSingleArgument<float>("epsilon", 1e-5f);
+    for (TIndex m = 0; m < M; ++m) {
+      const double s = bn_scale->data<float>()[m] /
+          std::sqrt(var->data<float>()[m] + epsilon);
+      (*scale)[m] *= s;
+      (*shift)[m] = ((*shift)[m] - mean->data<float>()[m]) * s +
+          bn_bias->data<float>()[m];
+    }
+    return true;
+  }
+
+  // Folds the Add of a per channel bias next into the shift
+  bool FoldAdd(
+      NNGraph::NodeRef next,
+      const std::string& order,
+      std::vector<float>* shift) {
+    const auto& def = *GetOperatorDef(next);
+    ArgumentHelper args(def);
+    // The bias has to be broadcast along the channels
+    const int axis = args.GetSingleArgument<int>("axis", -1);
+    if (def.type() != "Add" || !args.GetSingleArgument<int>("broadcast", 0) ||
+        args.HasArgument("axis_str") ||
+        axis != (order == "NCHW" ? 1 : -1)) {
+      return false;
+    }
+    const auto inputs = nn::getInputs(next);
+    const TIndex M = shift->size();
+    const TensorCPU* bias =
+        inputs.size() == 2 ? GetChannelTensor(ws_, inputs[1], M) : nullptr;
+    if (!bias) {
+      return false;
+    }
+    for (TIndex m = 0; m < M; ++m) {
+      (*shift)[m] += bias->data<float>()[m];
+    }
+    return true;
+  }
+
+  void FoldAffine(NNGraph::NodeRef conv) {
+    const auto order = ArgumentHelper(*GetOperatorDef(conv))
+                           .GetSingleArgument<std::string>("order", "NCHW");
+    const auto inputs = nn::getInputs(conv);
+    if (inputs.size() < 2) {
+      return;
+    }
+    const TensorCPU* filter = GetConstantTensor(ws_, inputs[1]);
+    if (!filter || filter->ndim() < 1) {
+      return;
+    }
+    const TIndex M = filter->dim(0);
+    const TensorCPU* bias = nullptr;
+    if (inputs.size() == 3) {
+      bias = GetChannelTensor(ws_, inputs[2], M);
+      if (!bias) {
+        return;
+      }
+    }
+
+    std::vector<float> scale(M, 1);
+    std::vector<float> shift(M, 0);
+    if (bias) {
+      shift.assign(bias->data<float>(), bias->data<float>() + M);
+    }
+    bool folded = false;
+    while (true) {
+      auto next = GetOnlyConsumer(conv);
+      if (!next || !CanMoveOutput(conv, next) ||
+          !(FoldSpatialBN(next, order, &scale, &shift) ||
+            FoldAdd(next, order, &shift))) {
+        break;
+      }
+      RemoveConsumer(conv, next);
+      folded = true;
+    }
+    if (!folded) {
+      return;
+    }
+
+    // filter'[m] = filter[m] * scale[m] in every layout, as M is the first
+    // dimension of the filter
+    const auto filter_name = NewBlobName(GetName(inputs[1]));
+    auto* new_filter = ws_->CreateBlob(filter_name)->GetMutable<TensorCPU>();
+    new_filter->Resize(filter->dims());
+    const TIndex filter_size = filter->size_from_dim(1);
+    const float* filter_data = filter->data<float>();
+    float* new_filter_data = new_filter->mutable_data<float>();
+    for (TIndex m = 0; m < M; ++m) {
+      for (TIndex i = m * filter_size; i < (m + 1) * filter_size; ++i) {
+        new_filter_data[i] = filter_data[i] * scale[m];
+      }
+    }
+    const auto bias_name = NewBlobName(
+        inputs.size() == 3 ? GetName(inputs[2])
+                           : GetName(nn::getOutputs(conv)[0]) + "_b");
+    auto* new_bias = ws_->CreateBlob(bias_name)->GetMutable<TensorCPU>();
+    new_bias->Resize(M);
+    std::copy(shift.begin(), shift.end(), new_bias->mutable_data<float>());
+
+    // The inputs of the op are emitted in the order of the in-edges
+    const auto in_edges = conv->getInEdges();
+    for (auto edge : in_edges) {
+      graph_->deleteEdge(edge);
+    }
+    graph_->createEdge(inputs[0], conv);
+    graph_->createEdge(CreateTensorNode(filter_name), conv);
+    graph_->createEdge(CreateTensorNode(bias_name), conv);
+  }
+
+  void FuseRelu(NNGraph::NodeRef conv) {
+    auto* def = GetOperatorDef(conv);
+    const auto& device = def->has_device_option() ? def->device_option()
+                                                  : net_.device_option();
+    if (!def->engine().empty() ||
+        (device.device_type() != CPU && device.device_type() != CUDA)) {
+      return;
+    }
+    auto next = GetOnlyConsumer(conv);
+    if (!next || !nn::is<nom::repr::Relu>(next) || !CanMoveOutput(conv, next)) {
+      return;
+    }
+    RemoveConsumer(conv, next);
+    def->set_type("ConvRelu");
+  }
+
+  // A name for a new blob, unused by ws and the net
+  std::string NewBlobName(const std::string& base) {
+    std::string name = base + "_fused";
+    for (int i = 1; ws_->HasBlob(name) || used_names_.count(name); ++i) {
+      name = base + "_fused_" + caffe2::to_string(i);
+    }
+    used_names_.insert(name);
+    return name;
+  }
+
+  NNGraph::NodeRef CreateTensorNode(const std::string& name) {
+    auto tensor = nom::util::make_unique<nom::repr::Tensor>(name);
+    return graph_->createNode(
+        unique_dyn_cast<nom::repr::NeuralNetData>(tensor));
+  }
+
+  const NetDef& net_;
+  Workspace* ws_;
+  const std::set<std::string> external_outputs_;
+  std::set<std::string> used_names_;
+  NetDef* fused_net_ = nullptr;
+  NNGraph* graph_ = nullptr;
+  std::unordered_map<const OperatorDef*, int> op_index_;
+  std::set<const OperatorDef*> removed_ops_;
+};
+
+} // namespace
+
+NetDef FuseConvBNRelu(const NetDef& net, Workspace* ws) {
+  CAFFE_ENFORCE(ws);
+  // The Caffe2 converter cannot write control flow back
+  for (const auto& op : net.op()) {
+    if (op.type() == "While") {
+      return net;
+    }
+  }
+  return ConvBNReluFusion(net, ws).Run();
+}
+
+} // namespace caffe2
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Conv + SpatialBN + Relu fusion for inference nets.
+ *
+ * A SpatialBN in test mode, or an Add of a per channel bias, that is the only
+ * reader of the output of a Conv is an affine map of each output channel, so
+ * it is folded into the filter and bias of the Conv:
+ *
+ *   s = scale / sqrt(var + epsilon)
+ *   filter'[m] = filter[m] * s[m]
+ *   bias'[m] = (bias[m] - mean[m]) * s[m] + bn_bias[m]
+ *
+ * A Relu that then is the only reader of the output of the Conv turns it
+ * into a ConvRelu, which applies the Relu to each output image while it is
+ * still in cache. This is only done for the default engine on CPU and CUDA,
+ * the devices ConvRelu is registered for.
+ *
+ * The folded filters and biases are written to new blobs of ws, which must
+ * hold the weights of the net, so the original blobs are left untouched.
+ * Their values are read once, so the net must not change them afterwards.
+ * Outputs of the net (external_output) are never fused away. Returns the
+ * transformed net; the net is returned as is if it has control flow.
+ */
+NetDef FuseConvBNRelu(const NetDef& net, Workspace* ws);
+
+} // namespace caffe2
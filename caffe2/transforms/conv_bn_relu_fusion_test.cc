@@ -0,0 +1,152 @@
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/conv_bn_relu_fusion.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddTensor(
+    Workspace* ws,
+    const std::string& name,
+    const std::vector<TIndex>& dims,
+    const float offset) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  float* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = offset + std::sin(i * 0.7f + offset);
+  }
+}
+
+OperatorDef* AddConv(
+    NetDef* net,
+    const std::vector<string>& inputs,
+    const std::string& order) {
+  auto* op = AddOp(net, "Conv", inputs, {"Y"});
+  op->add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  op->add_arg()->CopyFrom(MakeArgument<int>("pad", 1));
+  op->add_arg()->CopyFrom(MakeArgument<string>("order", order));
+  return op;
+}
+
+OperatorDef* AddSpatialBN(
+    NetDef* net,
+    const std::string& order,
+    const std::string& output = "Y") {
+  auto* op =
+      AddOp(net, "SpatialBN", {"Y", "s", "bn_b", "mean", "var"}, {output});
+  op->add_arg()->CopyFrom(MakeArgument<int>("is_test", 1));
+  op->add_arg()->CopyFrom(MakeArgument<float>("epsilon", 1e-3f));
+  op->add_arg()->CopyFrom(MakeArgument<string>("order", order));
+  return op;
+}
+
+void AddWeights(Workspace* ws, const std::vector<TIndex>& filter_dims) {
+  const TIndex M = filter_dims[0];
+  AddTensor(ws, "W", filter_dims, 0);
+  AddTensor(ws, "b", {M}, 0.1f);
+  AddTensor(ws, "s", {M}, 1);
+  AddTensor(ws, "bn_b", {M}, 0.2f);
+  AddTensor(ws, "mean", {M}, 0.3f);
+  // Positive variances
+  AddTensor(ws, "var", {M}, 2);
+  AddTensor(ws, "c", {M}, -0.5f);
+}
+
+// Runs net and then its fusion in ws, and checks that the outputs match
+NetDef RunAndCompare(const NetDef& net, Workspace* ws) {
+  CAFFE_ENFORCE(ws->RunNetOnce(net));
+  TensorCPU expected(ws->GetBlob("Z")->Get<TensorCPU>());
+  const NetDef fused = FuseConvBNRelu(net, ws);
+  ws->GetBlob("Z")->GetMutable<TensorCPU>()->Resize(0);
+  CAFFE_ENFORCE(ws->RunNetOnce(fused));
+  const auto& Z = ws->GetBlob("Z")->Get<TensorCPU>();
+  EXPECT_EQ(Z.dims(), expected.dims());
+  for (TIndex i = 0; i < Z.size(); ++i) {
+    EXPECT_NEAR(Z.data<float>()[i], expected.data<float>()[i], 1e-4);
+  }
+  return fused;
+}
+
+TEST(ConvBNReluFusionTest, TestConvBNAddRelu) {
+  Workspace ws;
+  AddTensor(&ws, "X", {2, 3, 6, 5}, 0);
+  AddWeights(&ws, {4, 3, 3, 3});
+  NetDef net;
+  AddConv(&net, {"X", "W", "b"}, "NCHW");
+  AddSpatialBN(&net, "NCHW");
+  auto* add = AddOp(&net, "Add", {"Y", "c"}, {"Y2"});
+  add->add_arg()->CopyFrom(MakeArgument<int>("broadcast", 1));
+  add->add_arg()->CopyFrom(MakeArgument<int>("axis", 1));
+  AddOp(&net, "Relu", {"Y2"}, {"Z"});
+  net.add_external_output("Z");
+
+  const NetDef fused = RunAndCompare(net, &ws);
+  ASSERT_EQ(fused.op_size(), 1);
+  EXPECT_EQ(fused.op(0).type(), "ConvRelu");
+  ASSERT_EQ(fused.op(0).input_size(), 3);
+  EXPECT_EQ(fused.op(0).input(0), "X");
+  EXPECT_EQ(fused.op(0).output(0), "Z");
+  EXPECT_EQ(fused.external_output(0), "Z");
+  // The original weights are left alone
+  EXPECT_NE(fused.op(0).input(1), "W");
+  EXPECT_NE(fused.op(0).input(2), "b");
+}
+
+TEST(ConvBNReluFusionTest, TestNHWCWithoutBias) {
+  Workspace ws;
+  AddTensor(&ws, "X", {2, 6, 5, 3}, 0);
+  AddWeights(&ws, {4, 3, 3, 3});
+  NetDef net;
+  AddConv(&net, {"X", "W"}, "NHWC");
+  AddSpatialBN(&net, "NHWC");
+  AddOp(&net, "Relu", {"Y"}, {"Z"});
+  net.add_external_output("Z");
+
+  const NetDef fused = RunAndCompare(net, &ws);
+  ASSERT_EQ(fused.op_size(), 1);
+  EXPECT_EQ(fused.op(0).type(), "ConvRelu");
+  EXPECT_EQ(fused.op(0).input_size(), 3);
+}
+
+TEST(ConvBNReluFusionTest, TestOutputsAreKept) {
+  Workspace ws;
+  AddTensor(&ws, "X", {1, 3, 5, 5}, 0);
+  AddWeights(&ws, {4, 3, 3, 3});
+  NetDef net;
+  AddConv(&net, {"X", "W", "b"}, "NCHW");
+  AddSpatialBN(&net, "NCHW", "Y2");
+  AddOp(&net, "Relu", {"Y2"}, {"Z"});
+  // The output of the BN is an output of the net, so only the BN is folded
+  net.add_external_output("Y2");
+  net.add_external_output("Z");
+
+  const NetDef fused = RunAndCompare(net, &ws);
+  ASSERT_EQ(fused.op_size(), 2);
+  EXPECT_EQ(fused.op(0).type(), "Conv");
+  EXPECT_EQ(fused.op(1).type(), "Relu");
+}
+
+TEST(ConvBNReluFusionTest, TestTrainingBNIsKept) {
+  Workspace ws;
+  AddTensor(&ws, "X", {1, 3, 5, 5}, 0);
+  AddWeights(&ws, {4, 3, 3, 3});
+  NetDef net;
+  AddConv(&net, {"X", "W", "b"}, "NCHW");
+  AddOp(&net, "SpatialBN", {"Y", "s", "bn_b", "mean", "var"}, {"Z"});
+  net.add_external_output("Z");
+
+  const NetDef fused = FuseConvBNRelu(net, &ws);
+  ASSERT_EQ(fused.op_size(), 2);
+  EXPECT_EQ(fused.op(0).type(), "Conv");
+  EXPECT_EQ(fused.op(1).type(), "SpatialBN");
+}
+
+} // namespace
+
+} // namespace caffe2
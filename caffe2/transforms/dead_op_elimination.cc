@@ -0,0 +1,50 @@
+#include "caffe2/transforms/dead_op_elimination.h"
+
+#include <set>
+
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+NetDef EliminateDeadOps(
+    const NetDef& net,
+    const std::vector<std::string>& outputs) {
+  for (const auto& op : net.op()) {
+    for (const auto& arg : op.arg()) {
+      if (arg.has_n() || arg.nets_size() > 0) {
+        return net;
+      }
+    }
+  }
+
+  // Walk the net backwards, keeping track of the blobs that the kept
+  // operators and outputs need from the operators before
+  std::set<std::string> live(outputs.begin(), outputs.end());
+  std::vector<bool> keep(net.op_size(), false);
+  for (int i = net.op_size() - 1; i >= 0; --i) {
+    const auto& op = net.op(i);
+    for (const auto& output : op.output()) {
+      keep[i] = keep[i] || live.count(output);
+    }
+    if (!keep[i]) {
+      continue;
+    }
+    for (const auto& output : op.output()) {
+      live.erase(output);
+    }
+    live.insert(op.input().begin(), op.input().end());
+  }
+
+  NetDef pruned_net = net;
+  pruned_net.clear_op();
+  for (int i = 0; i < net.op_size(); ++i) {
+    if (keep[i]) {
+      pruned_net.add_op()->CopyFrom(net.op(i));
+    }
+  }
+  VLOG(1) << "Removed " << net.op_size() - pruned_net.op_size()
+          << " dead operators of " << net.name();
+  return pruned_net;
+}
+
+} // namespace caffe2
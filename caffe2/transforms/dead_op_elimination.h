@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Dead operator elimination.
+ *
+ * Removes the operators of net that don't contribute to outputs, such as the
+ * metrics, summaries and gradient leftovers exported training nets carry
+ * into inference. An operator is kept if it writes a blob that a later kept
+ * operator reads before it is overwritten, or that is among outputs at the
+ * end of the net. Operators without outputs are removed too.
+ *
+ * External inputs and outputs are kept as is, since the Predictor feeds and
+ * fetches them by position. Returns net as is if it has control flow, whose
+ * nested nets read blobs the operators don't list.
+ */
+NetDef EliminateDeadOps(
+    const NetDef& net,
+    const std::vector<std::string>& outputs);
+
+} // namespace caffe2
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/transforms/dead_op_elimination.h"
+
+namespace caffe2 {
+
+namespace {
+
+TEST(DeadOpEliminationTest, TestUnusedBranches) {
+  NetDef netdef;
+  AddOp(&netdef, "FC", {"X", "W", "b"}, {"fc"});
+  AddOp(&netdef, "Relu", {"fc"}, {"relu"});
+  // Metrics and summaries of the training net
+  AddOp(&netdef, "LabelCrossEntropy", {"relu", "label"}, {"xent"});
+  AddOp(&netdef, "AveragedLoss", {"xent"}, {"loss"});
+  AddOp(&netdef, "Print", {"loss"}, {});
+  AddOp(&netdef, "Softmax", {"relu"}, {"Y"});
+  netdef.add_external_output("Y");
+
+  NetDef pruned_netdef = EliminateDeadOps(netdef, {"Y"});
+  ASSERT_EQ(pruned_netdef.op_size(), 3);
+  EXPECT_EQ(pruned_netdef.op(0).type(), "FC");
+  EXPECT_EQ(pruned_netdef.op(1).type(), "Relu");
+  EXPECT_EQ(pruned_netdef.op(2).type(), "Softmax");
+  EXPECT_EQ(pruned_netdef.external_output_size(), 1);
+}
+
+TEST(DeadOpEliminationTest, TestOverwrittenAndInPlace) {
+  NetDef netdef;
+  // Overwritten before anyone reads it
+  AddOp(&netdef, "Sigmoid", {"X"}, {"Y"});
+  AddOp(&netdef, "Tanh", {"X"}, {"Y"});
+  // In place, so Tanh is needed
+  AddOp(&netdef, "Relu", {"Y"}, {"Y"});
+
+  NetDef pruned_netdef = EliminateDeadOps(netdef, {"Y"});
+  ASSERT_EQ(pruned_netdef.op_size(), 2);
+  EXPECT_EQ(pruned_netdef.op(0).type(), "Tanh");
+  EXPECT_EQ(pruned_netdef.op(1).type(), "Relu");
+  EXPECT_EQ(EliminateDeadOps(netdef, {}).op_size(), 0);
+}
+
+TEST(DeadOpEliminationTest, TestControlFlowIsKept) {
+  NetDef netdef;
+  AddOp(&netdef, "Relu", {"X"}, {"unused"});
+  auto* op = AddOp(&netdef, "If", {"cond"}, {});
+  NetDef then_net;
+  AddOp(&then_net, "Copy", {"unused"}, {"Y"});
+  auto* arg = op->add_arg();
+  arg->set_name("then_net");
+  arg->mutable_n()->CopyFrom(then_net);
+
+  EXPECT_EQ(EliminateDeadOps(netdef, {"Y"}).op_size(), 2);
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,435 @@
+#include "caffe2/transforms/device_partitioning.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/types.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// Passes of the refinement of the greedy placement, each of which tries to
+// move every run of operators
+constexpr int kMaxRefinementPasses = 10;
+
+bool IsCPU(const DeviceOption& device) {
+  return device.device_type() == CPU;
+}
+
+// The suffix of the copies of blobs on device
+std::string DeviceTag(const DeviceOption& device) {
+  switch (device.device_type()) {
+    case CPU:
+      return device.numa_node_id() >= 0
+          ? "cpu" + caffe2::to_string(device.numa_node_id())
+          : "cpu";
+    case CUDA:
+      return "cuda" + caffe2::to_string(device.cuda_gpu_id());
+    case MKLDNN:
+      return "mkldnn";
+    case OPENGL:
+      return "opengl";
+    default:
+      return "device" + caffe2::to_string(device.device_type());
+  }
+}
+
+bool RunsNets(const OperatorDef& op) {
+  for (const auto& arg : op.arg()) {
+    if (arg.has_n() || arg.nets_size() > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The operator copying src on from into dst on to, for devices one of which
+// is CPU, or both CUDA
+OperatorDef CopyOp(
+    const DeviceOption& from,
+    const DeviceOption& to,
+    const std::string& src,
+    const std::string& dst) {
+  std::string type;
+  DeviceOption device = to;
+  if (IsCPU(from) && IsCPU(to)) {
+    type = "Copy";
+  } else if (IsCPU(from) && to.device_type() == CUDA) {
+    type = "CopyCPUToGPU";
+  } else if (from.device_type() == CUDA && IsCPU(to)) {
+    type = "CopyGPUToCPU";
+    device = from;
+  } else if (from.device_type() == CUDA && to.device_type() == CUDA) {
+    type = "Copy";
+  } else if (IsCPU(from) && to.device_type() == MKLDNN) {
+    type = "CopyCPUToMKL";
+  } else if (from.device_type() == MKLDNN && IsCPU(to)) {
+    type = "CopyMKLToCPU";
+    device = from;
+  } else if (IsCPU(from) && to.device_type() == OPENGL) {
+    // The OpenGL copies run on CPU
+    type = "CopyToOpenGL";
+    device = from;
+  } else if (from.device_type() == OPENGL && IsCPU(to)) {
+    type = "CopyFromOpenGL";
+  } else {
+    CAFFE_THROW(
+        "Don't know how to copy blobs from ",
+        DeviceTag(from),
+        " to ",
+        DeviceTag(to));
+  }
+  return CreateOperatorDef(
+      type, "", std::vector<string>{src}, std::vector<string>{dst}, device);
+}
+
+class DevicePartitioner {
+ public:
+  DevicePartitioner(const NetDef& net, const DevicePartitionOptions& options)
+      : net_(net), options_(options) {
+    AddDevice(options.io_device);
+    for (const auto& device : options.devices) {
+      AddDevice(device);
+    }
+    // The device of every operator staying on its device, -1 for the others
+    std::vector<int> pinned;
+    for (const auto& op : net.op()) {
+      const bool keep = RunsNets(op) ||
+          (op.has_device_option() &&
+           !IsSameDevice(op.device_option(), net.device_option()));
+      pinned.push_back(
+          keep ? AddDevice(
+                     op.has_device_option() ? op.device_option()
+                                            : net.device_option())
+               : -1);
+    }
+    const int num_ops = net.op_size();
+    costs_.resize(num_ops);
+    for (int i = 0; i < num_ops; ++i) {
+      const auto& op = net.op(i);
+      const int own = pinned[i];
+      costs_[i].assign(
+          devices_.size(), std::numeric_limits<float>::infinity());
+      for (int d = 0; d < devices_.size(); ++d) {
+        if (own < 0 || d == own) {
+          costs_[i][d] = options.placement_cost(op, devices_[d]);
+        }
+      }
+      if (own >= 0 && !std::isfinite(costs_[i][own])) {
+        costs_[i][own] = 0;
+      }
+      for (const auto& output : op.output()) {
+        last_write_[output] = i;
+      }
+    }
+    external_outputs_.insert(
+        net.external_output().begin(), net.external_output().end());
+  }
+
+  NetDef Run(DevicePartitionStats* stats) {
+    std::vector<int> placement = GreedyPlacement();
+    float cost = Evaluate(placement, nullptr, nullptr);
+    for (int pass = 0; pass < kMaxRefinementPasses; ++pass) {
+      bool improved = false;
+      for (const auto& run : Runs(placement)) {
+        for (int d = 0; d < devices_.size(); ++d) {
+          if (d == placement[run.first] || !CanMove(run, d)) {
+            continue;
+          }
+          std::vector<int> moved = placement;
+          std::fill(
+              moved.begin() + run.first, moved.begin() + run.second, d);
+          const float moved_cost = Evaluate(moved, nullptr, nullptr);
+          if (moved_cost < cost) {
+            placement = moved;
+            cost = moved_cost;
+            improved = true;
+            break;
+          }
+        }
+      }
+      if (!improved) {
+        break;
+      }
+    }
+
+    NetDef result = net_;
+    result.clear_op();
+    DevicePartitionStats result_stats;
+    result_stats.cost = Evaluate(placement, &result, &result_stats);
+    for (const auto& run : Runs(placement)) {
+      result_stats.subgraphs.emplace_back(
+          devices_[placement[run.first]], std::vector<int>());
+      for (int i = run.first; i < run.second; ++i) {
+        result_stats.subgraphs.back().second.push_back(i);
+      }
+    }
+    LOG(INFO) << "Partitioned " << net_.name() << " into "
+              << result_stats.subgraphs.size() << " subgraphs, with "
+              << result_stats.num_copies << " copies of "
+              << result_stats.transfer_bytes << " bytes per run";
+    if (stats) {
+      *stats = result_stats;
+    }
+    return result;
+  }
+
+ private:
+  // Where the current version of a blob is
+  struct BlobLocation {
+    DeviceOption home;
+    // The name of the blob on every device it is on, by DeviceTag
+    std::map<std::string, std::string> names;
+  };
+
+  using State = std::unordered_map<std::string, BlobLocation>;
+
+  struct Evaluation {
+    float cost = 0;
+    NetDef* result = nullptr;
+    DevicePartitionStats* stats = nullptr;
+  };
+
+  int AddDevice(const DeviceOption& device) {
+    for (int d = 0; d < devices_.size(); ++d) {
+      if (IsSameDevice(devices_[d], device)) {
+        return d;
+      }
+    }
+    devices_.push_back(device);
+    return devices_.size() - 1;
+  }
+
+  size_t BlobBytes(const std::string& blob) const {
+    auto it = options_.shapes.find(blob);
+    if (it == options_.shapes.end() || it->second.unknown_shape()) {
+      return 0;
+    }
+    size_t size = DataTypeToTypeMeta(it->second.data_type()).itemsize();
+    for (auto d : it->second.dims()) {
+      size *= d;
+    }
+    return size;
+  }
+
+  BlobLocation* Locate(const std::string& blob, State* state) const {
+    auto it = state->find(blob);
+    if (it == state->end()) {
+      // Not written by the net yet, so an input of the net
+      BlobLocation location;
+      location.home = devices_[0];
+      location.names[DeviceTag(devices_[0])] = blob;
+      it = state->emplace(blob, location).first;
+    }
+    return &it->second;
+  }
+
+  // The name of blob on device, copying it there if needed, into dst if not
+  // empty
+  std::string Fetch(
+      const std::string& blob,
+      BlobLocation* location,
+      const DeviceOption& device,
+      const std::string& dst,
+      Evaluation* evaluation) const {
+    const std::string tag = DeviceTag(device);
+    auto it = location->names.find(tag);
+    if (it != location->names.end() && dst.empty()) {
+      return it->second;
+    }
+    DeviceOption from = location->home;
+    std::string src = location->names.at(DeviceTag(from));
+    if (!IsCPU(from) && !IsCPU(device) &&
+        !(from.device_type() == CUDA && device.device_type() == CUDA)) {
+      from = DeviceOption();
+      src = Fetch(blob, location, from, "", evaluation);
+    }
+    const std::string name = dst.empty() ? blob + "_" + tag : dst;
+    const size_t nbytes = BlobBytes(blob);
+    evaluation->cost += options_.transfer_cost(from, device, nbytes);
+    if (evaluation->result) {
+      *evaluation->result->add_op() = CopyOp(from, device, src, name);
+    }
+    if (evaluation->stats) {
+      ++evaluation->stats->num_copies;
+      evaluation->stats->transfer_bytes += nbytes;
+    }
+    if (dst.empty()) {
+      location->names[tag] = name;
+    }
+    return name;
+  }
+
+  // Runs operator index on device d
+  void Step(int index, int d, State* state, Evaluation* evaluation) const {
+    const auto& op = net_.op(index);
+    const auto& device = devices_[d];
+    evaluation->cost += costs_[index][d];
+    OperatorDef placed = op;
+    for (int j = 0; j < op.input_size(); ++j) {
+      auto* location = Locate(op.input(j), state);
+      placed.set_input(j, Fetch(op.input(j), location, device, "", evaluation));
+    }
+    const std::string tag = DeviceTag(device);
+    const bool on_io_device = IsSameDevice(device, devices_[0]);
+    for (int j = 0; j < op.output_size(); ++j) {
+      const auto& output = op.output(j);
+      // The last version of the external outputs is copied back to them
+      if (!on_io_device && external_outputs_.count(output) &&
+          last_write_.at(output) == index) {
+        placed.set_output(j, output + "_" + tag);
+      }
+      BlobLocation location;
+      location.home = device;
+      location.names[tag] = placed.output(j);
+      (*state)[output] = location;
+    }
+    if (evaluation->result) {
+      auto* device_option = placed.mutable_device_option();
+      if (!op.has_device_option()) {
+        device_option->CopyFrom(net_.device_option());
+      }
+      device_option->set_device_type(device.device_type());
+      device_option->clear_cuda_gpu_id();
+      device_option->clear_numa_node_id();
+      if (device.has_cuda_gpu_id()) {
+        device_option->set_cuda_gpu_id(device.cuda_gpu_id());
+      }
+      if (device.has_numa_node_id()) {
+        device_option->set_numa_node_id(device.numa_node_id());
+      }
+      *evaluation->result->add_op() = placed;
+    }
+  }
+
+  // The total cost of placement, appending the partitioned operators to
+  // result if given
+  float Evaluate(
+      const std::vector<int>& placement,
+      NetDef* result,
+      DevicePartitionStats* stats) const {
+    State state;
+    Evaluation evaluation;
+    evaluation.result = result;
+    evaluation.stats = stats;
+    for (int i = 0; i < placement.size(); ++i) {
+      Step(i, placement[i], &state, &evaluation);
+    }
+    for (const auto& output : net_.external_output()) {
+      auto* location = Locate(output, &state);
+      if (!IsSameDevice(location->home, devices_[0])) {
+        Fetch(output, location, devices_[0], output, &evaluation);
+      }
+    }
+    return evaluation.cost;
+  }
+
+  // Places every operator in order on the device on which it and the copies
+  // of its inputs cost the least
+  std::vector<int> GreedyPlacement() const {
+    std::vector<int> placement;
+    State state;
+    for (int i = 0; i < net_.op_size(); ++i) {
+      int best = -1;
+      float best_cost = std::numeric_limits<float>::infinity();
+      for (int d = 0; d < devices_.size(); ++d) {
+        if (!std::isfinite(costs_[i][d])) {
+          continue;
+        }
+        State inputs;
+        for (const auto& input : net_.op(i).input()) {
+          inputs[input] = *Locate(input, &state);
+        }
+        Evaluation evaluation;
+        Step(i, d, &inputs, &evaluation);
+        if (best < 0 || evaluation.cost < best_cost) {
+          best = d;
+          best_cost = evaluation.cost;
+        }
+      }
+      CAFFE_ENFORCE_GE(
+          best,
+          0,
+          "Operator ",
+          i,
+          " (",
+          net_.op(i).type(),
+          ") of ",
+          net_.name(),
+          " can't run on any of the devices");
+      Evaluation evaluation;
+      Step(i, best, &state, &evaluation);
+      placement.push_back(best);
+    }
+    return placement;
+  }
+
+  // The runs [first, second) of consecutive operators on the same device
+  static std::vector<std::pair<int, int>> Runs(
+      const std::vector<int>& placement) {
+    std::vector<std::pair<int, int>> runs;
+    for (int i = 0; i < placement.size(); ++i) {
+      if (i == 0 || placement[i] != placement[i - 1]) {
+        runs.emplace_back(i, i);
+      }
+      runs.back().second = i + 1;
+    }
+    return runs;
+  }
+
+  bool CanMove(const std::pair<int, int>& run, int d) const {
+    for (int i = run.first; i < run.second; ++i) {
+      if (!std::isfinite(costs_[i][d])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const NetDef& net_;
+  const DevicePartitionOptions& options_;
+  // The io device first
+  std::vector<DeviceOption> devices_;
+  // The cost of every operator on every device
+  std::vector<std::vector<float>> costs_;
+  std::unordered_map<std::string, int> last_write_;
+  std::set<std::string> external_outputs_;
+};
+
+} // namespace
+
+float DefaultPlacementCost(const OperatorDef& op, const DeviceOption& device) {
+  auto it = gDeviceTypeRegistry()->find(device.device_type());
+  if (it == gDeviceTypeRegistry()->end()) {
+    return std::numeric_limits<float>::infinity();
+  }
+  // Operators whose engine isn't registered fall back to the default one
+  if (!it->second->Has(op.type()) &&
+      !it->second->Has(op.type() + "_ENGINE_" + op.engine())) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return IsCPU(device) ? 1.0f : 0.1f;
+}
+
+float DefaultTransferCost(
+    const DeviceOption& /* unused */,
+    const DeviceOption& /* unused */,
+    size_t nbytes) {
+  return 0.1f + 0.1f * nbytes / (1 << 20);
+}
+
+NetDef PartitionNetByDevice(
+    const NetDef& net,
+    const DevicePartitionOptions& options,
+    DevicePartitionStats* stats) {
+  return DevicePartitioner(net, options).Run(stats);
+}
+
+} // namespace caffe2
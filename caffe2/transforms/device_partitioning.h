@@ -0,0 +1,93 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * The cost of running op on device, or infinity if device can't run op.
+ */
+using PlacementCostFunction =
+    std::function<float(const OperatorDef& op, const DeviceOption& device)>;
+
+/**
+ * The cost of copying a blob of nbytes bytes from one device to the other.
+ * nbytes is 0 for the blobs whose shape is unknown.
+ */
+using TransferCostFunction = std::function<
+    float(const DeviceOption& from, const DeviceOption& to, size_t nbytes)>;
+
+/**
+ * The default cost model: infinity on the devices with no operator registered
+ * for the type and engine of op, 1 on CPU, and 0.1 on the other devices,
+ * whose operators are assumed to be ten times faster.
+ */
+float DefaultPlacementCost(const OperatorDef& op, const DeviceOption& device);
+
+/**
+ * The default transfer cost: 0.1 per copy, plus 0.1 per MB copied.
+ */
+float DefaultTransferCost(
+    const DeviceOption& from,
+    const DeviceOption& to,
+    size_t nbytes);
+
+struct DevicePartitionOptions {
+  // The devices operators may be placed on, besides io_device
+  std::vector<DeviceOption> devices;
+  // Where the external inputs are, and the external outputs are expected
+  DeviceOption io_device;
+  PlacementCostFunction placement_cost = DefaultPlacementCost;
+  TransferCostFunction transfer_cost = DefaultTransferCost;
+  // Shapes of the blobs, as given by shape inference, used for the size of
+  // the copies
+  std::map<std::string, TensorShape> shapes;
+};
+
+struct DevicePartitionStats {
+  // Device homogeneous runs of operators of the partitioned net, as indices
+  // of the operators of the original net
+  std::vector<std::pair<DeviceOption, std::vector<int>>> subgraphs;
+  int num_copies = 0;
+  // Bytes copied between devices per run of the net, for the blobs whose
+  // shape is known
+  size_t transfer_bytes = 0;
+  // Operator plus transfer costs of the partitioned net
+  float cost = 0;
+};
+
+/**
+ * Cost based partitioning of a net over several devices.
+ *
+ * Places every operator on io_device or one of options.devices, so as to
+ * minimize the cost of the operators plus the cost of the copies between
+ * devices. Operators are first placed greedily in order, then runs of
+ * operators placed on the same device are moved to the other devices while
+ * that lowers the total cost, which merges the runs into device homogeneous
+ * subgraphs.
+ *
+ * Every operator then gets the device it was placed on, and blobs read on
+ * another device than the one they were written on are copied once per
+ * version, right before their first reader on that device, into
+ * `<blob>_<device>` (e.g. X_cuda0). Copies between CPU and CUDA, MKLDNN or
+ * OPENGL use the operators of those devices, other copies go through CPU.
+ * The external outputs written on another device than io_device are copied
+ * back under their name at the end of the net.
+ *
+ * Operators with a device option differing from the one of the net, and
+ * operators running nets (control flow), stay on their device. Throws if an
+ * operator can't run on any device. Fills stats with the subgraphs and
+ * expected transfers if given, and returns the partitioned net.
+ */
+NetDef PartitionNetByDevice(
+    const NetDef& net,
+    const DevicePartitionOptions& options,
+    DevicePartitionStats* stats = nullptr);
+
+} // namespace caffe2
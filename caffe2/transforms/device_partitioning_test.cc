@@ -0,0 +1,134 @@
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/transforms/device_partitioning.h"
+
+namespace caffe2 {
+
+namespace {
+
+DeviceOption CUDADevice() {
+  DeviceOption device;
+  device.set_device_type(CUDA);
+  device.set_cuda_gpu_id(0);
+  return device;
+}
+
+// The Cpu operators only run on CPU, the others run ten times faster on CUDA
+float TestCost(const OperatorDef& op, const DeviceOption& device) {
+  if (device.device_type() == CPU) {
+    return 1;
+  }
+  return op.type().compare(0, 3, "Cpu") == 0
+      ? std::numeric_limits<float>::infinity()
+      : 0.1;
+}
+
+DevicePartitionOptions TestOptions(TIndex size) {
+  DevicePartitionOptions options;
+  options.devices = {CUDADevice()};
+  options.placement_cost = TestCost;
+  options.transfer_cost =
+      [](const DeviceOption&, const DeviceOption&, size_t nbytes) {
+        return 0.1f + nbytes / 4000.0f;
+      };
+  for (const auto& blob : {"X", "A", "B", "C", "D"}) {
+    TensorShape shape;
+    shape.add_dims(size);
+    shape.set_data_type(TensorProto::FLOAT);
+    options.shapes[blob] = shape;
+  }
+  return options;
+}
+
+NetDef TestNet() {
+  NetDef net;
+  net.set_name("test");
+  AddOp(&net, "CpuOp", {"X"}, {"A"});
+  AddOp(&net, "Op", {"A"}, {"B"});
+  AddOp(&net, "Op", {"B"}, {"C"});
+  AddOp(&net, "Op", {"C"}, {"C"});
+  AddOp(&net, "CpuOp", {"C", "A"}, {"D"});
+  net.add_external_input("X");
+  net.add_external_output("D");
+  return net;
+}
+
+TEST(DevicePartitioningTest, TestChainIsSplit) {
+  DevicePartitionStats stats;
+  const NetDef net =
+      PartitionNetByDevice(TestNet(), TestOptions(100), &stats);
+  ASSERT_EQ(net.op_size(), 7);
+  EXPECT_EQ(net.op(0).type(), "CpuOp");
+  EXPECT_EQ(net.op(0).device_option().device_type(), CPU);
+  EXPECT_EQ(net.op(1).type(), "CopyCPUToGPU");
+  EXPECT_EQ(net.op(1).input(0), "A");
+  EXPECT_EQ(net.op(1).output(0), "A_cuda0");
+  EXPECT_EQ(net.op(1).device_option().device_type(), CUDA);
+  for (int i = 2; i < 5; ++i) {
+    EXPECT_EQ(net.op(i).type(), "Op");
+    EXPECT_EQ(net.op(i).device_option().device_type(), CUDA);
+  }
+  EXPECT_EQ(net.op(2).input(0), "A_cuda0");
+  EXPECT_EQ(net.op(5).type(), "CopyGPUToCPU");
+  EXPECT_EQ(net.op(5).input(0), "C");
+  EXPECT_EQ(net.op(5).output(0), "C_cpu");
+  // A is still on CPU
+  EXPECT_EQ(net.op(6).input(0), "C_cpu");
+  EXPECT_EQ(net.op(6).input(1), "A");
+  EXPECT_EQ(net.op(6).device_option().device_type(), CPU);
+
+  EXPECT_EQ(stats.num_copies, 2);
+  EXPECT_EQ(stats.transfer_bytes, 800);
+  EXPECT_NEAR(stats.cost, 2 + 0.3 + 2 * 0.2, 1e-5);
+  ASSERT_EQ(stats.subgraphs.size(), 3);
+  EXPECT_EQ(stats.subgraphs[1].first.device_type(), CUDA);
+  EXPECT_EQ(stats.subgraphs[1].second, std::vector<int>({1, 2, 3}));
+}
+
+TEST(DevicePartitioningTest, TestTransfersOutweighSpeedup) {
+  DevicePartitionStats stats;
+  const NetDef net =
+      PartitionNetByDevice(TestNet(), TestOptions(10000), &stats);
+  ASSERT_EQ(net.op_size(), 5);
+  for (const auto& op : net.op()) {
+    EXPECT_EQ(op.device_option().device_type(), CPU);
+  }
+  EXPECT_EQ(stats.num_copies, 0);
+  EXPECT_EQ(stats.subgraphs.size(), 1);
+}
+
+TEST(DevicePartitioningTest, TestExternalOutputsAreCopiedBack) {
+  NetDef net;
+  AddOp(&net, "Op", {"X"}, {"A"});
+  AddOp(&net, "Op", {"A"}, {"B"});
+  // Operators placed on another device than the one of the net stay there
+  auto* placed = AddOp(&net, "Op", {"B"}, {"C"});
+  placed->mutable_device_option()->set_numa_node_id(0);
+  net.add_external_input("X");
+  net.add_external_output("B");
+
+  const NetDef partitioned =
+      PartitionNetByDevice(net, TestOptions(100), nullptr);
+  ASSERT_EQ(partitioned.op_size(), 6);
+  EXPECT_EQ(partitioned.op(0).type(), "CopyCPUToGPU");
+  EXPECT_EQ(partitioned.op(0).output(0), "X_cuda0");
+  EXPECT_EQ(partitioned.op(1).device_option().device_type(), CUDA);
+  // The last version of B is written aside, then copied to B
+  EXPECT_EQ(partitioned.op(2).output(0), "B_cuda0");
+  EXPECT_EQ(partitioned.op(2).device_option().device_type(), CUDA);
+  EXPECT_EQ(partitioned.op(3).type(), "CopyGPUToCPU");
+  EXPECT_EQ(partitioned.op(3).output(0), "B_cpu0");
+  EXPECT_EQ(partitioned.op(4).input(0), "B_cpu0");
+  EXPECT_EQ(partitioned.op(4).device_option().device_type(), CPU);
+  EXPECT_EQ(partitioned.op(4).device_option().numa_node_id(), 0);
+  EXPECT_EQ(partitioned.op(5).type(), "CopyGPUToCPU");
+  EXPECT_EQ(partitioned.op(5).input(0), "B_cuda0");
+  EXPECT_EQ(partitioned.op(5).output(0), "B");
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,328 @@
+#include "caffe2/transforms/elementwise_fusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+// The instructions of a FusedElementwise operator. Until the inputs of the
+// chain are all known, values are numbered by instruction, and the inputs
+// get the negative values -1, -2, ... Unary instructions have no rhs.
+struct Program {
+  static constexpr int kNone = std::numeric_limits<int>::min();
+
+  std::vector<std::string> ops;
+  std::vector<int> lhs;
+  std::vector<int> rhs;
+  std::vector<float> scale;
+  std::vector<float> min;
+  std::vector<float> max;
+
+  int Append(
+      const std::string& op,
+      int a,
+      int b = kNone,
+      float s = 1.0f,
+      float lo = std::numeric_limits<float>::lowest(),
+      float hi = std::numeric_limits<float>::max()) {
+    ops.push_back(op);
+    lhs.push_back(a);
+    rhs.push_back(b);
+    scale.push_back(s);
+    min.push_back(lo);
+    max.push_back(hi);
+    return ops.size() - 1;
+  }
+};
+
+// Whether op is a binary operator broadcasting its second input to the
+// trailing dims of the first one
+bool IsBroadcast(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<int>("broadcast", 0) &&
+      (op.type() == "Add" || op.type() == "Sub" || op.type() == "Mul" ||
+       op.type() == "Div");
+}
+
+// Appends the instructions computing the output of op from the values args
+// of its inputs, or returns false if it cannot be fused
+bool AppendPointwise(
+    const OperatorDef& op,
+    const std::vector<int>& args,
+    bool fuse_scalar_broadcast,
+    Program* program) {
+  if (op.output_size() != 1 || !op.engine().empty()) {
+    return false;
+  }
+  ArgumentHelper helper(op);
+  const auto& type = op.type();
+  if (type == "Add" || type == "Sub" || type == "Mul" || type == "Div") {
+    if (op.input_size() != 2) {
+      return false;
+    }
+    if (IsBroadcast(op) &&
+        (!fuse_scalar_broadcast || helper.HasArgument("axis") ||
+         helper.HasArgument("axis_str"))) {
+      return false;
+    }
+    program->Append(type, args[0], args[1]);
+    return true;
+  }
+  if (type == "Sum") {
+    if (op.input_size() == 0) {
+      return false;
+    }
+    int value = args[0];
+    if (op.input_size() == 1) {
+      program->Append("Copy", value);
+    }
+    for (int i = 1; i < op.input_size(); ++i) {
+      value = program->Append("Add", value, args[i]);
+    }
+    return true;
+  }
+  static const std::set<std::string> unary_ops = {"Relu",
+                                                  "Sigmoid",
+                                                  "Tanh",
+                                                  "Exp",
+                                                  "Log",
+                                                  "Sqrt",
+                                                  "Sqr",
+                                                  "Abs",
+                                                  "Negative"};
+  if (op.input_size() != 1) {
+    return false;
+  }
+  // FusedElementwise converts its float16 inputs and outputs itself
+  if (type == "HalfToFloat" || type == "FloatToHalf") {
+    program->Append("Copy", args[0]);
+    return true;
+  }
+  if (type == "Scale") {
+    const float scale = helper.GetSingleArgument<float>("scale", 1.0f);
+    if (!std::isfinite(scale)) {
+      return false;
+    }
+    program->Append(type, args[0], Program::kNone, scale);
+    return true;
+  }
+  if (type == "Clip") {
+    const float lo = helper.GetSingleArgument<float>(
+        "min", std::numeric_limits<float>::lowest());
+    const float hi = helper.GetSingleArgument<float>(
+        "max", std::numeric_limits<float>::max());
+    program->Append(type, args[0], Program::kNone, 1.0f, lo, hi);
+    return true;
+  }
+  if (type == "Logit") {
+    const float eps = helper.GetSingleArgument<float>("eps", 1e-6f);
+    if (!(eps > 0 && eps < 0.5f)) {
+      return false;
+    }
+    program->Append(type, args[0], Program::kNone, 1.0f, eps, 1.0f - eps);
+    return true;
+  }
+  if (!unary_ops.count(type)) {
+    return false;
+  }
+  program->Append(type, args[0]);
+  return true;
+}
+
+class ElementwiseFusion {
+ public:
+  ElementwiseFusion(const NetDef& net, const ElementwiseFusionOptions& options)
+      : net_(net),
+        options_(options),
+        external_outputs_(
+            net.external_output().begin(),
+            net.external_output().end()) {}
+
+  NetDef Run() {
+    NetDef result = net_;
+    result.clear_op();
+    int begin = 0;
+    while (begin < net_.op_size()) {
+      int end = begin;
+      while (end < net_.op_size() && IsFusable(end) &&
+             GetDevice(end).SerializeAsString() ==
+                 GetDevice(begin).SerializeAsString() &&
+             !ConvertsFusedValue(begin, end)) {
+        ++end;
+      }
+      OperatorDef fused;
+      if (end - begin >= 2 && Fuse(begin, end, &fused)) {
+        *result.add_op() = fused;
+        begin = end;
+      } else {
+        *result.add_op() = net_.op(begin);
+        ++begin;
+      }
+    }
+    return result;
+  }
+
+ private:
+  const DeviceOption& GetDevice(int index) const {
+    const auto& op = net_.op(index);
+    return op.has_device_option() ? op.device_option() : net_.device_option();
+  }
+
+  bool IsFusable(int index) const {
+    const auto& op = net_.op(index);
+    for (const auto* blobs : {&op.input(), &op.output()}) {
+      for (const auto& blob : *blobs) {
+        if (options_.non_float_blobs.count(blob)) {
+          return false;
+        }
+      }
+    }
+    Program program;
+    return GetDevice(index).device_type() == CPU &&
+        AppendPointwise(
+               op,
+               std::vector<int>(op.input_size()),
+               options_.fuse_scalar_broadcast,
+               &program);
+  }
+
+  // Whether the operator index converts from float16 a blob written by the
+  // operators [begin, index), which would not be rounded to float16 in
+  // between once fused
+  bool ConvertsFusedValue(int begin, int index) const {
+    const auto& op = net_.op(index);
+    if (op.type() != "HalfToFloat") {
+      return false;
+    }
+    for (int i = begin; i < index; ++i) {
+      if (net_.op(i).output(0) == op.input(0)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Whether an operator from index on, or the caller of the net, reads blob
+  bool IsReadFrom(int index, const std::string& blob) const {
+    if (external_outputs_.count(blob)) {
+      return true;
+    }
+    for (int i = index; i < net_.op_size(); ++i) {
+      for (const auto& input : net_.op(i).input()) {
+        if (input == blob) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Makes the FusedElementwise operator computing the operators [begin, end)
+  bool Fuse(int begin, int end, OperatorDef* fused) const {
+    std::vector<std::string> inputs;
+    std::vector<std::string> written;
+    // The current value of every blob
+    std::unordered_map<std::string, int> values;
+    // The values converted to float16
+    std::set<int> float16_values;
+    bool broadcast = false;
+    Program program;
+    for (int i = begin; i < end; ++i) {
+      const auto& op = net_.op(i);
+      std::vector<int> args;
+      for (const auto& input : op.input()) {
+        auto it = values.find(input);
+        if (it == values.end()) {
+          inputs.push_back(input);
+          it = values.emplace(input, -static_cast<int>(inputs.size())).first;
+        }
+        args.push_back(it->second);
+      }
+      CAFFE_ENFORCE(
+          AppendPointwise(op, args, options_.fuse_scalar_broadcast, &program));
+      broadcast |= IsBroadcast(op);
+      if (op.type() == "FloatToHalf") {
+        float16_values.insert(program.ops.size() - 1);
+      }
+      if (std::find(written.begin(), written.end(), op.output(0)) ==
+          written.end()) {
+        written.push_back(op.output(0));
+      }
+      values[op.output(0)] = program.ops.size() - 1;
+    }
+
+    // Number the inputs from 0 and the instructions after them
+    const int num_inputs = inputs.size();
+    auto reg = [num_inputs](int value) {
+      if (value == Program::kNone) {
+        return -1;
+      }
+      return value < 0 ? -value - 1 : num_inputs + value;
+    };
+    std::vector<std::string> outputs;
+    std::vector<int> output_registers;
+    std::vector<int> float16_outputs;
+    for (const auto& blob : written) {
+      if (IsReadFrom(end, blob)) {
+        outputs.push_back(blob);
+        output_registers.push_back(reg(values.at(blob)));
+        float16_outputs.push_back(float16_values.count(values.at(blob)));
+      }
+    }
+    if (outputs.empty()) {
+      return false;
+    }
+    std::vector<int> lhs;
+    std::vector<int> rhs;
+    for (int i = 0; i < program.ops.size(); ++i) {
+      lhs.push_back(reg(program.lhs[i]));
+      rhs.push_back(reg(program.rhs[i]));
+    }
+    std::vector<Argument> args{
+        MakeArgument<vector<string>>("ops", program.ops),
+        MakeArgument<vector<int>>("lhs", lhs),
+        MakeArgument<vector<int>>("rhs", rhs),
+        MakeArgument<vector<float>>("scale", program.scale),
+        MakeArgument<vector<float>>("min", program.min),
+        MakeArgument<vector<float>>("max", program.max),
+        MakeArgument<vector<int>>("outputs", output_registers),
+        MakeArgument<vector<int>>("float16_outputs", float16_outputs)};
+    if (broadcast) {
+      args.push_back(MakeArgument<int>("broadcast", 1));
+    }
+    *fused = CreateOperatorDef(
+        "FusedElementwise",
+        net_.op(begin).name(),
+        inputs,
+        outputs,
+        args,
+        net_.op(begin).device_option());
+    if (!net_.op(begin).has_device_option()) {
+      fused->clear_device_option();
+    }
+    return true;
+  }
+
+  const NetDef& net_;
+  const ElementwiseFusionOptions& options_;
+  const std::set<std::string> external_outputs_;
+};
+
+constexpr int Program::kNone;
+
+} // namespace
+
+NetDef FuseElementwise(
+    const NetDef& net,
+    const ElementwiseFusionOptions& options) {
+  return ElementwiseFusion(net, options).Run();
+}
+
+} // namespace caffe2
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+struct ElementwiseFusionOptions {
+  // Whether to fuse Add, Sub, Mul and Div with broadcast and without axis.
+  // The fused operators then broadcast inputs of a single element, but fail
+  // on the other broadcasts, so this is for nets whose broadcasts are all of
+  // scalars, like those of the script compiler.
+  bool fuse_scalar_broadcast = false;
+  // The blobs known not to hold float tensors, whose readers and writers are
+  // not fused
+  std::set<std::string> non_float_blobs;
+};
+
+/**
+ * Fusion of chains of pointwise operators of CPU nets.
+ *
+ * The CPU counterpart of FuseElementwiseRTC: consecutive operators that
+ * compute every element of their output from the same element of their
+ * inputs (Add, Sub, Mul and Div without broadcast, Sum, Relu, Sigmoid, Tanh,
+ * Exp, Log, Sqrt, Sqr, Abs, Negative, Scale, Clip, Logit, HalfToFloat and
+ * FloatToHalf) on the CPU and with the default engine are replaced by one
+ * FusedElementwise operator, so that chains of feature transforms such as
+ * Clip then Logit read and write their features once. It runs the whole chain
+ * over tiles of its inputs that fit in cache, and only writes the blobs read
+ * after the chain or output by the net.
+ *
+ * Like FusedElementwise, the fused operators compute in float. Nets storing
+ * their activations as float16 around float pointwise operators have the
+ * HalfToFloat and FloatToHalf conversions fused too, so that the chain reads
+ * and writes float16. Returns the transformed net.
+ */
+NetDef FuseElementwise(
+    const NetDef& net,
+    const ElementwiseFusionOptions& options = ElementwiseFusionOptions());
+
+} // namespace caffe2
@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/elementwise_fusion.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddInput(Workspace* ws, const std::string& name, float offset) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(3, 1000);
+  auto* data = tensor->mutable_data<float>();
+  for (int i = 0; i < tensor->size(); ++i) {
+    data[i] = offset + (i % 17) * 0.25f - 2;
+  }
+}
+
+// Runs both nets on the same inputs and compares blob out
+void RunAndCompare(const NetDef& net, const NetDef& fused_net) {
+  Workspace ws;
+  Workspace fused_ws;
+  for (auto* workspace : {&ws, &fused_ws}) {
+    AddInput(workspace, "X", 0);
+    AddInput(workspace, "W", 1);
+  }
+  CAFFE_ENFORCE(ws.RunNetOnce(net));
+  CAFFE_ENFORCE(fused_ws.RunNetOnce(fused_net));
+  const auto& expected = ws.GetBlob("out")->Get<TensorCPU>();
+  const auto& out = fused_ws.GetBlob("out")->Get<TensorCPU>();
+  ASSERT_EQ(out.dims(), expected.dims());
+  for (TIndex i = 0; i < out.size(); ++i) {
+    EXPECT_NEAR(out.data<float>()[i], expected.data<float>()[i], 1e-5);
+  }
+}
+
+TEST(ElementwiseFusionTest, TestChainIsFused) {
+  NetDef net;
+  AddOp(&net, "Mul", {"X", "W"}, {"Y"});
+  auto* scale = AddOp(&net, "Scale", {"Y"}, {"Y"});
+  scale->add_arg()->CopyFrom(MakeArgument<float>("scale", 0.5f));
+  AddOp(&net, "Add", {"Y", "X"}, {"Z"});
+  AddOp(&net, "Sigmoid", {"Z"}, {"Z"});
+  AddOp(&net, "Sub", {"Z", "W"}, {"D"});
+  AddOp(&net, "Sqr", {"D"}, {"D"});
+  AddOp(&net, "Sum", {"D", "Z", "X"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwise(net);
+  ASSERT_EQ(fused.op_size(), 1);
+  const auto& op = fused.op(0);
+  EXPECT_EQ(op.type(), "FusedElementwise");
+  ASSERT_EQ(op.input_size(), 2);
+  EXPECT_EQ(op.input(0), "X");
+  EXPECT_EQ(op.input(1), "W");
+  // Y, Z and D are not read after the chain
+  ASSERT_EQ(op.output_size(), 1);
+  EXPECT_EQ(op.output(0), "out");
+  ArgumentHelper helper(op);
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<string>("ops"),
+      std::vector<string>(
+          {"Mul", "Scale", "Add", "Sigmoid", "Sub", "Sqr", "Add", "Add"}));
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<int>("lhs"),
+      std::vector<int>({0, 2, 3, 4, 5, 6, 7, 8}));
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<int>("rhs"),
+      std::vector<int>({1, -1, 0, -1, 1, -1, 5, 0}));
+  EXPECT_EQ(helper.GetRepeatedArgument<float>("scale")[1], 0.5f);
+  EXPECT_EQ(helper.GetRepeatedArgument<int>("outputs"), std::vector<int>({9}));
+  RunAndCompare(net, fused);
+}
+
+TEST(ElementwiseFusionTest, TestFeatureTransformsAreFused) {
+  NetDef net;
+  AddOp(&net, "Sigmoid", {"X"}, {"P"});
+  auto* clip = AddOp(&net, "Clip", {"P"}, {"P"});
+  clip->add_arg()->CopyFrom(MakeArgument<float>("min", 0.1f));
+  clip->add_arg()->CopyFrom(MakeArgument<float>("max", 0.8f));
+  auto* logit = AddOp(&net, "Logit", {"P"}, {"L"});
+  logit->add_arg()->CopyFrom(MakeArgument<float>("eps", 0.25f));
+  AddOp(&net, "Mul", {"L", "W"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwise(net);
+  ASSERT_EQ(fused.op_size(), 1);
+  ArgumentHelper helper(fused.op(0));
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<string>("ops"),
+      std::vector<string>({"Sigmoid", "Clip", "Logit", "Mul"}));
+  const auto min = helper.GetRepeatedArgument<float>("min");
+  const auto max = helper.GetRepeatedArgument<float>("max");
+  ASSERT_EQ(min.size(), 4);
+  ASSERT_EQ(max.size(), 4);
+  EXPECT_EQ(min[1], 0.1f);
+  EXPECT_EQ(max[1], 0.8f);
+  EXPECT_EQ(min[2], 0.25f);
+  EXPECT_EQ(max[2], 0.75f);
+  RunAndCompare(net, fused);
+}
+
+TEST(ElementwiseFusionTest, TestOutputsReadLaterAreKept) {
+  NetDef net;
+  AddOp(&net, "Sigmoid", {"X"}, {"Y"});
+  AddOp(&net, "Tanh", {"Y"}, {"Z"});
+  AddOp(&net, "Transpose", {"Y"}, {"Yt"});
+  AddOp(&net, "Transpose", {"Yt"}, {"Y2"});
+  AddOp(&net, "Mul", {"Y2", "Z"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwise(net);
+  ASSERT_EQ(fused.op_size(), 4);
+  ASSERT_EQ(fused.op(0).type(), "FusedElementwise");
+  ASSERT_EQ(fused.op(0).output_size(), 2);
+  EXPECT_EQ(fused.op(0).output(0), "Y");
+  EXPECT_EQ(fused.op(0).output(1), "Z");
+  // A single operator is left as is
+  EXPECT_EQ(fused.op(3).type(), "Mul");
+  RunAndCompare(net, fused);
+}
+
+TEST(ElementwiseFusionTest, TestFloat16ConversionsAreFused) {
+  NetDef net;
+  AddOp(&net, "FloatToHalf", {"X"}, {"Xh"});
+  // Not fused with the FloatToHalf above, which rounds X to float16
+  AddOp(&net, "HalfToFloat", {"Xh"}, {"Xf"});
+  AddOp(&net, "Relu", {"Xf"}, {"R"});
+  AddOp(&net, "Mul", {"R", "W"}, {"M"});
+  AddOp(&net, "FloatToHalf", {"M"}, {"Mh"});
+  AddOp(&net, "HalfToFloat", {"Mh"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwise(net);
+  ASSERT_EQ(fused.op_size(), 3);
+  EXPECT_EQ(fused.op(0).type(), "FloatToHalf");
+  const auto& op = fused.op(1);
+  EXPECT_EQ(op.type(), "FusedElementwise");
+  ASSERT_EQ(op.input_size(), 2);
+  EXPECT_EQ(op.input(0), "Xh");
+  EXPECT_EQ(op.input(1), "W");
+  ASSERT_EQ(op.output_size(), 1);
+  EXPECT_EQ(op.output(0), "Mh");
+  ArgumentHelper helper(op);
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<string>("ops"),
+      std::vector<string>({"Copy", "Relu", "Mul", "Copy"}));
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<int>("float16_outputs"),
+      std::vector<int>({1}));
+  EXPECT_EQ(fused.op(2).type(), "HalfToFloat");
+  RunAndCompare(net, fused);
+}
+
+TEST(ElementwiseFusionTest, TestUnsupportedOpsAreKept) {
+  NetDef net;
+  auto* add = AddOp(&net, "Add", {"X", "b"}, {"Y"});
+  add->add_arg()->CopyFrom(MakeArgument<int>("broadcast", 1));
+  auto* relu = AddOp(&net, "Relu", {"Y"}, {"Z"});
+  relu->set_engine("CUDNN");
+  AddOp(&net, "Exp", {"Z"}, {"E"});
+  auto* gpu_log = AddOp(&net, "Log", {"E"}, {"out"});
+  gpu_log->mutable_device_option()->set_device_type(CUDA);
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwise(net);
+  ASSERT_EQ(fused.op_size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(fused.op(i).type(), net.op(i).type());
+  }
+}
+
+TEST(ElementwiseFusionTest, TestScalarBroadcastIsFusedOnRequest) {
+  NetDef net;
+  auto* fill = AddOp(&net, "ConstantFill", {}, {"s"});
+  fill->add_arg()->CopyFrom(MakeArgument<std::vector<int>>("shape", {1}));
+  fill->add_arg()->CopyFrom(MakeArgument<float>("value", 0.5f));
+  auto* mul = AddOp(&net, "Mul", {"X", "s"}, {"Y"});
+  mul->add_arg()->CopyFrom(MakeArgument<int>("broadcast", 1));
+  auto* add = AddOp(&net, "Add", {"Y", "s"}, {"Z"});
+  add->add_arg()->CopyFrom(MakeArgument<int>("broadcast", 1));
+  AddOp(&net, "Sub", {"Z", "W"}, {"out"});
+  net.add_external_output("out");
+
+  // Broadcasts are not fused by default
+  const NetDef unfused = FuseElementwise(net);
+  ASSERT_EQ(unfused.op_size(), 4);
+  EXPECT_EQ(unfused.op(3).type(), "Sub");
+
+  ElementwiseFusionOptions options;
+  options.fuse_scalar_broadcast = true;
+  const NetDef fused = FuseElementwise(net, options);
+  ASSERT_EQ(fused.op_size(), 2);
+  const auto& op = fused.op(1);
+  EXPECT_EQ(op.type(), "FusedElementwise");
+  ArgumentHelper helper(op);
+  EXPECT_EQ(helper.GetSingleArgument<int>("broadcast", 0), 1);
+  EXPECT_EQ(
+      helper.GetRepeatedArgument<string>("ops"),
+      std::vector<string>({"Mul", "Add", "Sub"}));
+  RunAndCompare(net, fused);
+
+  // Nor are the operators reading blobs which are not float
+  options.non_float_blobs = {"W"};
+  const NetDef partial = FuseElementwise(net, options);
+  ASSERT_EQ(partial.op_size(), 3);
+  EXPECT_EQ(partial.op(1).type(), "FusedElementwise");
+  EXPECT_EQ(partial.op(2).type(), "Sub");
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,205 @@
+#include "caffe2/transforms/elementwise_rtc_fusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+std::string FloatLiteral(float value) {
+  std::ostringstream ss;
+  ss << "((float)"
+     << std::setprecision(std::numeric_limits<float>::max_digits10) << value
+     << ")";
+  return ss.str();
+}
+
+// How op computes an element of its output from the elements of its inputs
+// named args, or an empty string if it cannot be fused
+std::string PointwiseExpression(
+    const OperatorDef& op,
+    const std::vector<std::string>& args) {
+  if (op.output_size() != 1 ||
+      (!op.engine().empty() && op.engine() != "CUDNN")) {
+    return "";
+  }
+  ArgumentHelper helper(op);
+  const auto& type = op.type();
+  if (op.input_size() == 2) {
+    if (helper.GetSingleArgument<int>("broadcast", 0)) {
+      return "";
+    }
+    const std::unordered_map<std::string, std::string> binary_ops = {
+        {"Add", " + "}, {"Sub", " - "}, {"Mul", " * "}, {"Div", " / "}};
+    auto it = binary_ops.find(type);
+    return it == binary_ops.end() ? "" : args[0] + it->second + args[1];
+  }
+  if (op.input_size() != 1) {
+    return "";
+  }
+  const auto& x = args[0];
+  if (type == "Relu") {
+    return "fmaxf(" + x + ", 0.f)";
+  } else if (type == "Sigmoid") {
+    return "1.f / (1.f + expf(-" + x + "))";
+  } else if (type == "Tanh") {
+    return "tanhf(" + x + ")";
+  } else if (type == "Exp") {
+    return "expf(" + x + ")";
+  } else if (type == "Log") {
+    return "logf(" + x + ")";
+  } else if (type == "Sqrt") {
+    return "sqrtf(" + x + ")";
+  } else if (type == "Sqr") {
+    return x + " * " + x;
+  } else if (type == "Abs") {
+    return "fabsf(" + x + ")";
+  } else if (type == "Negative") {
+    return "-" + x;
+  } else if (type == "Scale") {
+    const float scale = helper.GetSingleArgument<float>("scale", 1.0f);
+    return std::isfinite(scale) ? x + " * " + FloatLiteral(scale) : "";
+  } else if (type == "Cast") {
+    return helper.HasSingleArgumentOfType<int>("to") &&
+            helper.GetSingleArgument<int>("to", 0) == TensorProto::FLOAT
+        ? x
+        : "";
+  }
+  return "";
+}
+
+class ElementwiseRTCFusion {
+ public:
+  explicit ElementwiseRTCFusion(const NetDef& net)
+      : net_(net),
+        external_outputs_(
+            net.external_output().begin(),
+            net.external_output().end()) {}
+
+  NetDef Run() {
+    NetDef result = net_;
+    result.clear_op();
+    int begin = 0;
+    while (begin < net_.op_size()) {
+      int end = begin;
+      while (end < net_.op_size() && IsFusable(end) &&
+             GetDevice(end).SerializeAsString() ==
+                 GetDevice(begin).SerializeAsString()) {
+        ++end;
+      }
+      OperatorDef fused;
+      if (end - begin >= 2 && Fuse(begin, end, &fused)) {
+        *result.add_op() = fused;
+        begin = end;
+      } else {
+        *result.add_op() = net_.op(begin);
+        ++begin;
+      }
+    }
+    return result;
+  }
+
+ private:
+  const DeviceOption& GetDevice(int index) const {
+    const auto& op = net_.op(index);
+    return op.has_device_option() ? op.device_option() : net_.device_option();
+  }
+
+  bool IsFusable(int index) const {
+    const auto& op = net_.op(index);
+    return GetDevice(index).device_type() == CUDA &&
+        !PointwiseExpression(op, std::vector<std::string>(op.input_size()))
+             .empty();
+  }
+
+  // Whether an operator from index on, or the caller of the net, reads blob
+  bool IsReadFrom(int index, const std::string& blob) const {
+    if (external_outputs_.count(blob)) {
+      return true;
+    }
+    for (int i = index; i < net_.op_size(); ++i) {
+      for (const auto& input : net_.op(i).input()) {
+        if (input == blob) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Makes the ElementwiseRTC operator computing the operators [begin, end)
+  bool Fuse(int begin, int end, OperatorDef* fused) const {
+    std::vector<std::string> inputs;
+    std::vector<std::string> written;
+    // The kernel variable holding the current value of every blob
+    std::unordered_map<std::string, std::string> values;
+    std::ostringstream src;
+    int num_values = 0;
+    for (int i = begin; i < end; ++i) {
+      const auto& op = net_.op(i);
+      std::vector<std::string> args;
+      for (const auto& input : op.input()) {
+        auto it = values.find(input);
+        if (it == values.end()) {
+          const auto value = "v" + caffe2::to_string(num_values++);
+          src << "const float " << value << " = in" << inputs.size()
+              << "[index];\n";
+          inputs.push_back(input);
+          it = values.emplace(input, value).first;
+        }
+        args.push_back(it->second);
+      }
+      const auto value = "v" + caffe2::to_string(num_values++);
+      src << "const float " << value << " = "
+          << PointwiseExpression(op, args) << ";\n";
+      if (std::find(written.begin(), written.end(), op.output(0)) ==
+          written.end()) {
+        written.push_back(op.output(0));
+      }
+      values[op.output(0)] = value;
+    }
+    std::vector<std::string> outputs;
+    for (const auto& blob : written) {
+      if (IsReadFrom(end, blob)) {
+        src << "out" << outputs.size() << "[index] = " << values.at(blob)
+            << ";\n";
+        outputs.push_back(blob);
+      }
+    }
+    if (outputs.empty()) {
+      return false;
+    }
+    *fused = CreateOperatorDef(
+        "ElementwiseRTC",
+        net_.op(begin).name(),
+        inputs,
+        outputs,
+        std::vector<Argument>{MakeArgument<string>("rtc_src", src.str())},
+        net_.op(begin).device_option(),
+        "NVRTC");
+    if (!net_.op(begin).has_device_option()) {
+      fused->clear_device_option();
+    }
+    return true;
+  }
+
+  const NetDef& net_;
+  const std::set<std::string> external_outputs_;
+};
+
+} // namespace
+
+NetDef FuseElementwiseRTC(const NetDef& net) {
+  return ElementwiseRTCFusion(net).Run();
+}
+
+} // namespace caffe2
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Fusion of chains of pointwise operators of CUDA nets.
+ *
+ * Consecutive operators that compute every element of their output from the
+ * same element of their inputs (Add, Sub, Mul and Div without broadcast,
+ * Relu, Sigmoid, Tanh, Exp, Log, Sqrt, Sqr, Abs, Negative, Scale and Cast to
+ * float) on the same GPU are replaced by one ElementwiseRTC operator of the
+ * NVRTC engine, whose kernel reads every input once, keeps the intermediate
+ * values in registers and only writes the blobs read after the chain or
+ * output by the net. Operators with other engines than the default and
+ * cuDNN ones are left alone.
+ *
+ * Like ElementwiseRTC, the fused operators only support float tensors, so
+ * the net must compute its pointwise operators in float. Returns the
+ * transformed net.
+ */
+NetDef FuseElementwiseRTC(const NetDef& net);
+
+} // namespace caffe2
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/transforms/elementwise_rtc_fusion.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+NetDef CUDANet() {
+  NetDef net;
+  net.mutable_device_option()->set_device_type(CUDA);
+  return net;
+}
+
+TEST(ElementwiseRTCFusionTest, TestChainIsFused) {
+  NetDef net = CUDANet();
+  AddOp(&net, "Mul", {"X", "W"}, {"Y"});
+  auto* scale = AddOp(&net, "Scale", {"Y"}, {"Y"});
+  scale->add_arg()->CopyFrom(MakeArgument<float>("scale", 0.5f));
+  AddOp(&net, "Add", {"Y", "X"}, {"Z"});
+  AddOp(&net, "Relu", {"Z"}, {"Z"});
+  AddOp(&net, "FC", {"Z", "W2", "b2"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwiseRTC(net);
+  ASSERT_EQ(fused.op_size(), 2);
+  const auto& op = fused.op(0);
+  EXPECT_EQ(op.type(), "ElementwiseRTC");
+  EXPECT_EQ(op.engine(), "NVRTC");
+  ASSERT_EQ(op.input_size(), 2);
+  EXPECT_EQ(op.input(0), "X");
+  EXPECT_EQ(op.input(1), "W");
+  // Y is not read after the chain
+  ASSERT_EQ(op.output_size(), 1);
+  EXPECT_EQ(op.output(0), "Z");
+  const auto src = ArgumentHelper(op).GetSingleArgument<string>("rtc_src", "");
+  EXPECT_EQ(
+      src,
+      "const float v0 = in0[index];\n"
+      "const float v1 = in1[index];\n"
+      "const float v2 = v0 * v1;\n"
+      "const float v3 = v2 * ((float)0.5);\n"
+      "const float v4 = v3 + v0;\n"
+      "const float v5 = fmaxf(v4, 0.f);\n"
+      "out0[index] = v5;\n");
+  EXPECT_EQ(fused.op(1).type(), "FC");
+}
+
+TEST(ElementwiseRTCFusionTest, TestOutputsReadLaterAreKept) {
+  NetDef net = CUDANet();
+  AddOp(&net, "Sigmoid", {"X"}, {"Y"});
+  AddOp(&net, "Tanh", {"Y"}, {"Z"});
+  AddOp(&net, "Sum", {"Y", "Z"}, {"S"});
+  net.add_external_output("S");
+
+  const NetDef fused = FuseElementwiseRTC(net);
+  ASSERT_EQ(fused.op_size(), 2);
+  ASSERT_EQ(fused.op(0).type(), "ElementwiseRTC");
+  ASSERT_EQ(fused.op(0).output_size(), 2);
+  EXPECT_EQ(fused.op(0).output(0), "Y");
+  EXPECT_EQ(fused.op(0).output(1), "Z");
+}
+
+TEST(ElementwiseRTCFusionTest, TestUnsupportedOpsAreKept) {
+  NetDef net = CUDANet();
+  auto* add = AddOp(&net, "Add", {"X", "b"}, {"Y"});
+  add->add_arg()->CopyFrom(MakeArgument<int>("broadcast", 1));
+  AddOp(&net, "Relu", {"Y"}, {"Z"});
+  auto* cast = AddOp(&net, "Cast", {"Z"}, {"Z_int"});
+  cast->add_arg()->CopyFrom(MakeArgument<int>("to", TensorProto::INT32));
+  AddOp(&net, "Exp", {"Z_int"}, {"out"});
+  net.add_external_output("out");
+
+  const NetDef fused = FuseElementwiseRTC(net);
+  ASSERT_EQ(fused.op_size(), 4);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(fused.op(i).type(), net.op(i).type());
+  }
+}
+
+TEST(ElementwiseRTCFusionTest, TestCPUNetIsKept) {
+  NetDef net;
+  AddOp(&net, "Relu", {"X"}, {"Y"});
+  AddOp(&net, "Sigmoid", {"Y"}, {"Z"});
+  net.add_external_output("Z");
+
+  const NetDef fused = FuseElementwiseRTC(net);
+  ASSERT_EQ(fused.op_size(), 2);
+  EXPECT_EQ(fused.op(0).type(), "Relu");
+}
+
+} // namespace
+
+} // namespace caffe2
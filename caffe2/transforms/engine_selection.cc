@@ -0,0 +1,263 @@
+#include "caffe2/transforms/engine_selection.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/tensor.h"
+#include "caffe2/core/timer.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/utils/cpuid.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+constexpr char kEngineCacheHeader[] = "caffe2 engine selection cache v1";
+
+struct EngineChoice {
+  std::string engine;
+  // Average run time of the operator with the engine, in ms
+  float time;
+};
+
+using EngineCache = std::map<std::string, EngineChoice>;
+
+// Reads a file written by WriteEngineCache, if it exists
+EngineCache ReadEngineCache(const std::string& path) {
+  EngineCache cache;
+  std::ifstream file(path);
+  if (!file.good()) {
+    return cache;
+  }
+  std::string line;
+  std::getline(file, line);
+  CAFFE_ENFORCE_EQ(
+      line, kEngineCacheHeader, path, " is not an engine selection cache");
+  while (std::getline(file, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    // key \t engine \t time, the engine of the default one being empty
+    const auto tab = line.find('\t');
+    const auto time_tab = line.rfind('\t');
+    CAFFE_ENFORCE(
+        tab != std::string::npos && time_tab > tab,
+        "Bad line in ",
+        path,
+        ": ",
+        line);
+    EngineChoice choice;
+    choice.engine = line.substr(tab + 1, time_tab - tab - 1);
+    std::istringstream values(line.substr(time_tab + 1));
+    CAFFE_ENFORCE(values >> choice.time, "Bad line in ", path, ": ", line);
+    cache[line.substr(0, tab)] = choice;
+  }
+  return cache;
+}
+
+void WriteEngineCache(const std::string& path, const EngineCache& cache) {
+  // Written aside and renamed, so that concurrent readers never see a
+  // partial file
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path);
+    CAFFE_ENFORCE(file.good(), "Cannot write ", tmp_path);
+    file << kEngineCacheHeader << "\n";
+    for (const auto& it : cache) {
+      file << it.first << "\t" << it.second.engine << "\t" << it.second.time
+           << "\n";
+    }
+    CAFFE_ENFORCE(file.good(), "Cannot write ", tmp_path);
+  }
+  CAFFE_ENFORCE_EQ(
+      std::rename(tmp_path.c_str(), path.c_str()), 0, "Cannot write ", path);
+}
+
+// 64 bit FNV-1a, stable across builds unlike std::hash
+uint64_t Fingerprint(const std::string& data) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// The key of the decision for op reading the blobs of ws, or an empty string
+// if some of its inputs are missing
+std::string CacheKey(
+    const std::string& hardware,
+    const OperatorDef& op,
+    const Workspace& ws) {
+  std::ostringstream key;
+  key << hardware << ';' << op.type() << ';'
+      << op.device_option().device_type() << ';';
+  for (const auto& input : op.input()) {
+    const Blob* blob = ws.GetBlob(input);
+    if (!blob) {
+      return "";
+    }
+    const auto shape = GetTensorShapeOfBlob(blob);
+    key << shape.data_type();
+    for (auto d : shape.dims()) {
+      key << 'x' << d;
+    }
+    key << ',';
+  }
+  // The arguments of the operator, whatever its blobs and engine
+  OperatorDef args;
+  args.mutable_arg()->CopyFrom(op.arg());
+  key << ';' << std::hex << Fingerprint(args.SerializeAsString());
+  return key.str();
+}
+
+// The engines registered for op, starting with the default one
+std::vector<std::string> CandidateEngines(const OperatorDef& op) {
+  std::vector<std::string> engines{""};
+  auto it = gDeviceTypeRegistry()->find(op.device_option().device_type());
+  if (it == gDeviceTypeRegistry()->end()) {
+    return engines;
+  }
+  const std::string prefix = op.type() + "_ENGINE_";
+  for (const auto& key : it->second->Keys()) {
+    if (key.compare(0, prefix.size(), prefix) == 0) {
+      engines.push_back(key.substr(prefix.size()));
+    }
+  }
+  return engines;
+}
+
+// Average run time of op with engine in ms, or infinity if the engine can't
+// run it
+float TimeEngine(
+    const OperatorDef& op,
+    const std::string& engine,
+    const EngineSelectionOptions& options,
+    Workspace* ws) {
+  OperatorDef candidate = op;
+  candidate.set_engine(engine);
+  try {
+    auto bench = CreateOperator(candidate, ws);
+    // Engines that aren't available fall back to the default one
+    if (bench->engine() != engine) {
+      return std::numeric_limits<float>::infinity();
+    }
+    for (int i = 0; i < options.warmup_runs; ++i) {
+      if (!bench->Run()) {
+        return std::numeric_limits<float>::infinity();
+      }
+    }
+    Timer timer;
+    for (int i = 0; i < options.main_runs; ++i) {
+      if (!bench->Run()) {
+        return std::numeric_limits<float>::infinity();
+      }
+    }
+    return timer.MilliSeconds() / options.main_runs;
+  } catch (const std::exception& e) {
+    VLOG(1) << "Engine " << engine << " can't run " << op.type() << ": "
+            << e.what();
+    return std::numeric_limits<float>::infinity();
+  }
+}
+
+} // namespace
+
+std::string DefaultHardwareKey() {
+  const auto& cpuid = GetCpuId();
+  std::ostringstream key;
+  key << "cpu";
+  if (cpuid.avx()) {
+    key << "-avx";
+  }
+  if (cpuid.avx2()) {
+    key << "-avx2";
+  }
+  if (cpuid.fma()) {
+    key << "-fma";
+  }
+  if (cpuid.avx512f()) {
+    key << "-avx512f";
+  }
+  key << "-" << std::thread::hardware_concurrency() << "threads";
+  return key.str();
+}
+
+NetDef SelectEngines(
+    const NetDef& net,
+    const NetDef& init_net,
+    const EngineSelectionOptions& options) {
+  CAFFE_ENFORCE_GE(options.warmup_runs, 0);
+  CAFFE_ENFORCE_GT(options.main_runs, 0);
+  const std::string hardware =
+      options.hardware.empty() ? DefaultHardwareKey() : options.hardware;
+  EngineCache cache;
+  if (!options.cache_file.empty()) {
+    cache = ReadEngineCache(options.cache_file);
+  }
+  const auto cache_size = cache.size();
+
+  Workspace ws;
+  CAFFE_ENFORCE(ws.RunNetOnce(init_net), "Init run has failed!");
+  for (const auto& kv : options.input_dims) {
+    auto* tensor = ws.CreateBlob(kv.first)->GetMutable<TensorCPU>();
+    tensor->Resize(kv.second);
+    auto* data = tensor->mutable_data<float>();
+    std::fill(data, data + tensor->size(), 0.5f);
+  }
+
+  NetDef result = net;
+  for (int i = 0; i < result.op_size(); ++i) {
+    auto* op = result.mutable_op(i);
+    OperatorDef device_op = *op;
+    if (!op->has_device_option() && net.has_device_option()) {
+      device_op.mutable_device_option()->CopyFrom(net.device_option());
+    }
+    const auto engines = CandidateEngines(device_op);
+    const std::string key = engines.size() > 1 &&
+            std::find(
+                options.op_types.begin(),
+                options.op_types.end(),
+                op->type()) != options.op_types.end()
+        ? CacheKey(hardware, device_op, ws)
+        : "";
+    if (!key.empty()) {
+      auto it = cache.find(key);
+      if (it == cache.end()) {
+        EngineChoice best{op->engine(),
+                          std::numeric_limits<float>::infinity()};
+        for (const auto& engine : engines) {
+          const float time = TimeEngine(device_op, engine, options, &ws);
+          VLOG(1) << op->type() << " " << i << " with engine " << engine
+                  << ": " << time << " ms";
+          if (time < best.time) {
+            best = EngineChoice{engine, time};
+          }
+        }
+        it = cache.emplace(key, best).first;
+      }
+      op->set_engine(it->second.engine);
+      device_op.set_engine(it->second.engine);
+    }
+    // Computes the inputs of the next operators
+    CAFFE_ENFORCE(
+        CreateOperator(device_op, &ws)->Run(),
+        "Failed to run operator ",
+        i,
+        " of ",
+        net.name());
+  }
+
+  if (!options.cache_file.empty() && cache.size() > cache_size) {
+    WriteEngineCache(options.cache_file, cache);
+  }
+  return result;
+}
+
+} // namespace caffe2
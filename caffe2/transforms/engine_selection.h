@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+struct EngineSelectionOptions {
+  // The operator types whose engines are benchmarked
+  std::vector<std::string> op_types{"Conv",
+                                    "ConvTranspose",
+                                    "FC",
+                                    "MaxPool",
+                                    "AveragePool"};
+  // Dimensions of the float inputs of the net not written by the init net
+  std::map<std::string, std::vector<TIndex>> input_dims;
+  int warmup_runs = 2;
+  int main_runs = 10;
+  // File the decisions are cached in across runs, none if empty
+  std::string cache_file;
+  // Identifies the hardware in the keys of the cache, DefaultHardwareKey()
+  // if empty. The default one only describes the CPU, so the GPU model has
+  // to be given to share a cache between machines with different GPUs.
+  std::string hardware;
+};
+
+/**
+ * Describes the CPU the process runs on: its vector extensions and number
+ * of threads.
+ */
+std::string DefaultHardwareKey();
+
+/**
+ * Benchmark driven engine selection.
+ *
+ * Runs init_net, then the operators of net one at a time in the same
+ * workspace. Before running an operator of options.op_types, creates it with
+ * every engine registered for its type and device, the default one and the
+ * `<type>_ENGINE_<engine>` keys of the operator registry, runs each
+ * warmup_runs times, then times main_runs runs, and sets the engine of the
+ * operator to the fastest. Engines that can't create the operator or fail to
+ * run it are skipped. Every operator is thus benchmarked with the inputs it
+ * gets in the net.
+ *
+ * Decisions are keyed by hardware, operator type, device, input shapes and
+ * types and arguments, and kept in options.cache_file if given, so that the
+ * same operators are only benchmarked once. Returns the transformed net.
+ */
+NetDef SelectEngines(
+    const NetDef& net,
+    const NetDef& init_net,
+    const EngineSelectionOptions& options = EngineSelectionOptions());
+
+} // namespace caffe2
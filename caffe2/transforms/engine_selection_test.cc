@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/engine_selection.h"
+
+namespace caffe2 {
+
+namespace {
+
+template <int kSleepMs>
+class EngineSelectionSleepOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    Output(0)->ResizeLike(Input(0));
+    Output(0)->mutable_data<float>();
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSleepMs));
+    return true;
+  }
+};
+
+class EngineSelectionFailingOp final : public Operator<CPUContext> {
+ public:
+  using Operator<CPUContext>::Operator;
+  bool RunOnDevice() override {
+    return false;
+  }
+};
+
+OPERATOR_SCHEMA(EngineSelectionTestOp).NumInputs(1).NumOutputs(1);
+REGISTER_CPU_OPERATOR(EngineSelectionTestOp, EngineSelectionSleepOp<3>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    EngineSelectionTestOp,
+    FAST,
+    EngineSelectionSleepOp<0>);
+REGISTER_CPU_OPERATOR_WITH_ENGINE(
+    EngineSelectionTestOp,
+    BROKEN,
+    EngineSelectionFailingOp);
+
+NetDef TestNet() {
+  NetDef net;
+  AddOp(&net, "EngineSelectionTestOp", {"X"}, {"Y"});
+  AddOp(&net, "EngineSelectionTestOp", {"Y"}, {"Z"});
+  net.add_external_input("X");
+  return net;
+}
+
+EngineSelectionOptions TestOptions() {
+  EngineSelectionOptions options;
+  options.op_types = {"EngineSelectionTestOp"};
+  options.input_dims["X"] = {2, 3};
+  options.warmup_runs = 1;
+  options.main_runs = 3;
+  return options;
+}
+
+TEST(EngineSelectionTest, TestFastestEngineIsSelected) {
+  const NetDef net = SelectEngines(TestNet(), NetDef(), TestOptions());
+  ASSERT_EQ(net.op_size(), 2);
+  EXPECT_EQ(net.op(0).engine(), "FAST");
+  EXPECT_EQ(net.op(1).engine(), "FAST");
+
+  // Other operator types are left alone
+  auto options = TestOptions();
+  options.op_types = {"Conv"};
+  EXPECT_EQ(SelectEngines(TestNet(), NetDef(), options).op(0).engine(), "");
+}
+
+TEST(EngineSelectionTest, TestDecisionsAreCached) {
+  auto options = TestOptions();
+  options.cache_file = std::tmpnam(nullptr);
+  options.hardware = "test";
+  SelectEngines(TestNet(), NetDef(), options);
+
+  // Both operators share their decision
+  std::string line;
+  std::vector<std::string> lines;
+  {
+    std::ifstream file(options.cache_file);
+    while (std::getline(file, line)) {
+      lines.push_back(line);
+    }
+  }
+  ASSERT_EQ(lines.size(), 2);
+  EXPECT_EQ(lines[1].compare(0, 5, "test;"), 0);
+  const auto tab = lines[1].find('\t');
+  ASSERT_EQ(lines[1].substr(tab, 6), "\tFAST\t");
+
+  // The cached decision is used instead of benchmarking
+  {
+    std::ofstream file(options.cache_file);
+    file << lines[0] << "\n" << lines[1].substr(0, tab) << "\t\t1\n";
+  }
+  const NetDef net = SelectEngines(TestNet(), NetDef(), options);
+  EXPECT_EQ(net.op(0).engine(), "");
+  std::remove(options.cache_file.c_str());
+}
+
+} // namespace
+
+} // namespace caffe2
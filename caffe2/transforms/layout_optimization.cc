@@ -0,0 +1,712 @@
+#include "caffe2/transforms/layout_optimization.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+#include "nomnigraph/Converters/Caffe2.h"
+#include "nomnigraph/Support/Casting.h"
+#include "nomnigraph/Support/Pointer.h"
+
+namespace caffe2 {
+
+namespace {
+
+using nom::repr::NNGraph;
+namespace nn = nom::repr::nn;
+using NodeSet = std::set<NNGraph::NodeRef>;
+
+enum class LayoutRole {
+  // Reads and writes images in the order it was given
+  kFixed,
+  // Runs in both orders, as told by its order argument
+  kSensitive,
+  // Element wise, runs in the order of its inputs
+  kAgnostic,
+  // NCHW2NHWC or NHWC2NCHW
+  kSwitch,
+};
+
+const std::set<std::string>& SensitiveOps() {
+  static const std::set<std::string> ops{"Conv",
+                                         "ConvTranspose",
+                                         "ConvRelu",
+                                         "MaxPool",
+                                         "AveragePool",
+                                         "SpatialBN",
+                                         "LRN"};
+  return ops;
+}
+
+// Operators whose filter, their second input, depends on the order
+const std::set<std::string>& ConvOps() {
+  static const std::set<std::string> ops{"Conv", "ConvTranspose", "ConvRelu"};
+  return ops;
+}
+
+const std::set<std::string>& AgnosticOps() {
+  static const std::set<std::string> ops{"Relu",
+                                         "LeakyRelu",
+                                         "Elu",
+                                         "Sigmoid",
+                                         "Tanh",
+                                         "Abs",
+                                         "Negative",
+                                         "Sqr",
+                                         "Sqrt",
+                                         "Exp",
+                                         "Log",
+                                         "Scale",
+                                         "Clip",
+                                         "Copy",
+                                         "Sum",
+                                         "Add",
+                                         "Sub",
+                                         "Mul",
+                                         "Div",
+                                         "Max",
+                                         "Min"};
+  return ops;
+}
+
+OperatorDef* GetOperatorDef(NNGraph::NodeRef node) {
+  auto* op = nn::get<nom::repr::NeuralNetOperator>(node);
+  return reinterpret_cast<OperatorDef*>(op->getMutableAnnotation()->getSaved());
+}
+
+std::string GetName(NNGraph::NodeRef node) {
+  return nn::get<nom::repr::NeuralNetData>(node)->getName();
+}
+
+StorageOrder GetOrder(const OperatorDef& op) {
+  return StringToStorageOrder(
+      ArgumentHelper(op).GetSingleArgument<std::string>("order", "NCHW"));
+}
+
+std::string OrderName(StorageOrder order) {
+  return order == StorageOrder::NCHW ? "NCHW" : "NHWC";
+}
+
+std::string SwitchType(StorageOrder from) {
+  return from == StorageOrder::NCHW ? "NCHW2NHWC" : "NHWC2NCHW";
+}
+
+LayoutRole GetRole(const OperatorDef& op) {
+  if (op.type() == "NCHW2NHWC" || op.type() == "NHWC2NCHW") {
+    return LayoutRole::kSwitch;
+  }
+  ArgumentHelper args(op);
+  if (SensitiveOps().count(op.type())) {
+    // NHWC is only supported for 2d images
+    const bool is_2d = !args.HasArgument("kernels") ||
+        args.GetRepeatedArgument<int>("kernels").size() == 2;
+    return is_2d ? LayoutRole::kSensitive : LayoutRole::kFixed;
+  }
+  // Binary operators have to read images of the same shape
+  if (AgnosticOps().count(op.type()) &&
+      !args.GetSingleArgument<int>("broadcast", 0)) {
+    return LayoutRole::kAgnostic;
+  }
+  return LayoutRole::kFixed;
+}
+
+class LayoutOptimization {
+ public:
+  LayoutOptimization(const NetDef& net, const LayoutCostFunction& cost)
+      : net_(net),
+        cost_(cost),
+        used_names_(net.external_input().begin(), net.external_input().end()) {
+    for (const auto& op : net.op()) {
+      used_names_.insert(op.input().begin(), op.input().end());
+      used_names_.insert(op.output().begin(), op.output().end());
+    }
+  }
+
+  NetDef Run() {
+    // The module points into its net, which thus has to outlive it
+    NetDef optimized_net = net_;
+    std::unordered_map<std::string, NNGraph::NodeRef> last_versions;
+    auto module =
+        nom::converters::convertFromCaffe2Proto(optimized_net, &last_versions);
+    graph_ = &module.dataFlow;
+    for (auto bb_node : module.controlFlow.getMutableNodes()) {
+      bb_ = bb_node->mutableData()->get();
+    }
+    for (const auto& name : net_.external_output()) {
+      if (last_versions.count(name)) {
+        external_outputs_.insert(last_versions.at(name));
+      }
+    }
+    ops_ = bb_->getInstructions();
+    for (size_t i = 0; i < ops_.size(); ++i) {
+      position_[ops_[i]] = i;
+      roles_[ops_[i]] = GetRole(*GetOperatorDef(ops_[i]));
+    }
+    FixLeavingSwitches();
+
+    for (const auto& region : GetRegions()) {
+      OptimizeRegion(region);
+    }
+
+    const NetDef converted = nom::converters::convertToCaffe2Proto(module);
+    NetDef result = net_;
+    result.mutable_op()->CopyFrom(converted.op());
+    return result;
+  }
+
+ private:
+  // The inputs of op that are images in its order
+  std::vector<NNGraph::NodeRef> ImageInputs(NNGraph::NodeRef op) {
+    auto inputs = nn::getInputs(op);
+    switch (roles_.at(op)) {
+      case LayoutRole::kFixed:
+        return {};
+      case LayoutRole::kAgnostic:
+        return inputs;
+      default:
+        inputs.resize(std::min<size_t>(inputs.size(), 1));
+        return inputs;
+    }
+  }
+
+  std::vector<NNGraph::NodeRef> ImageOutputs(NNGraph::NodeRef op) {
+    auto outputs = nn::getOutputs(op);
+    switch (roles_.at(op)) {
+      case LayoutRole::kFixed:
+        return {};
+      case LayoutRole::kAgnostic:
+        return outputs;
+      default:
+        outputs.resize(std::min<size_t>(outputs.size(), 1));
+        return outputs;
+    }
+  }
+
+  bool IsImageInput(NNGraph::NodeRef tensor, NNGraph::NodeRef op) {
+    const auto inputs = ImageInputs(op);
+    return std::find(inputs.begin(), inputs.end(), tensor) != inputs.end();
+  }
+
+  // Whether the image tensor is read by an operator that doesn't take it as
+  // an image in its order, or is an output of the net
+  bool IsReadAsIs(NNGraph::NodeRef tensor) {
+    if (external_outputs_.count(tensor)) {
+      return true;
+    }
+    for (auto consumer : nn::getConsumers(tensor)) {
+      if (!IsImageInput(tensor, consumer)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // An order switch whose output is read as is can't be removed, so it
+  // stays as it is
+  void FixLeavingSwitches() {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto op : ops_) {
+        if (roles_.at(op) != LayoutRole::kSwitch) {
+          continue;
+        }
+        const auto outputs = ImageOutputs(op);
+        if (outputs.size() != 1 || IsReadAsIs(outputs[0])) {
+          roles_[op] = LayoutRole::kFixed;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // The connected components of the operators that aren't fixed, linked by
+  // the images they write and read, in the order of the net
+  std::vector<std::vector<NNGraph::NodeRef>> GetRegions() {
+    std::unordered_map<NNGraph::NodeRef, NNGraph::NodeRef> parent;
+    std::function<NNGraph::NodeRef(NNGraph::NodeRef)> find =
+        [&](NNGraph::NodeRef op) {
+          auto root = parent.at(op);
+          if (root != op) {
+            root = find(root);
+            parent[op] = root;
+          }
+          return root;
+        };
+    for (auto op : ops_) {
+      if (roles_.at(op) != LayoutRole::kFixed) {
+        parent[op] = op;
+      }
+    }
+    for (auto op : ops_) {
+      if (!parent.count(op)) {
+        continue;
+      }
+      for (auto tensor : ImageInputs(op)) {
+        if (!nn::hasProducer(tensor)) {
+          continue;
+        }
+        auto producer = nn::getProducer(tensor);
+        const auto outputs = ImageOutputs(producer);
+        if (std::find(outputs.begin(), outputs.end(), tensor) !=
+            outputs.end()) {
+          parent[find(op)] = find(producer);
+        }
+      }
+    }
+    std::map<NNGraph::NodeRef, size_t> index;
+    std::vector<std::vector<NNGraph::NodeRef>> regions;
+    for (auto op : ops_) {
+      if (!parent.count(op)) {
+        continue;
+      }
+      const auto root = find(op);
+      if (!index.count(root)) {
+        index[root] = regions.size();
+        regions.emplace_back();
+      }
+      regions[index.at(root)].push_back(op);
+    }
+    return regions;
+  }
+
+  // The original orders of the images of region, or false if some can't be
+  // told or disagree
+  bool GetOrders(
+      const std::vector<NNGraph::NodeRef>& region,
+      std::map<NNGraph::NodeRef, StorageOrder>* orders) {
+    bool consistent = true;
+    auto set_order = [&](NNGraph::NodeRef tensor, StorageOrder order) {
+      const auto it = orders->find(tensor);
+      if (it == orders->end()) {
+        (*orders)[tensor] = order;
+        return true;
+      }
+      consistent = consistent && it->second == order;
+      return false;
+    };
+    for (auto op : region) {
+      const auto role = roles_.at(op);
+      if (role == LayoutRole::kAgnostic) {
+        continue;
+      }
+      const auto& def = *GetOperatorDef(op);
+      const auto input_order = role == LayoutRole::kSensitive
+          ? GetOrder(def)
+          : (def.type() == "NCHW2NHWC" ? StorageOrder::NCHW
+                                       : StorageOrder::NHWC);
+      const auto output_order = role == LayoutRole::kSensitive
+          ? input_order
+          : (input_order == StorageOrder::NCHW ? StorageOrder::NHWC
+                                               : StorageOrder::NCHW);
+      for (auto tensor : ImageInputs(op)) {
+        set_order(tensor, input_order);
+      }
+      for (auto tensor : ImageOutputs(op)) {
+        set_order(tensor, output_order);
+      }
+    }
+    // Element wise operators read and write images of the same order
+    bool changed = true;
+    while (changed && consistent) {
+      changed = false;
+      for (auto op : region) {
+        if (roles_.at(op) != LayoutRole::kAgnostic) {
+          continue;
+        }
+        auto tensors = ImageInputs(op);
+        const auto outputs = ImageOutputs(op);
+        tensors.insert(tensors.end(), outputs.begin(), outputs.end());
+        const auto known = std::find_if(
+            tensors.begin(), tensors.end(), [&](NNGraph::NodeRef tensor) {
+              return orders->count(tensor);
+            });
+        if (known == tensors.end()) {
+          continue;
+        }
+        const auto order = orders->at(*known);
+        for (auto tensor : tensors) {
+          changed = set_order(tensor, order) || changed;
+        }
+      }
+    }
+    if (!consistent) {
+      return false;
+    }
+    for (auto op : region) {
+      for (auto tensor : ImageInputs(op)) {
+        if (!orders->count(tensor)) {
+          return false;
+        }
+      }
+      for (auto tensor : ImageOutputs(op)) {
+        if (!orders->count(tensor)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void OptimizeRegion(const std::vector<NNGraph::NodeRef>& region) {
+    const NodeSet ops(region.begin(), region.end());
+    std::map<NNGraph::NodeRef, StorageOrder> orders;
+    if (!GetOrders(region, &orders)) {
+      return;
+    }
+
+    // Images read from outside of the region, and images of the region
+    // read outside of it, in the order of the net. The latter are read as
+    // they are, or by order switches which can then become copies.
+    std::vector<NNGraph::NodeRef> entering;
+    std::vector<NNGraph::NodeRef> leaving;
+    std::map<NNGraph::NodeRef, bool> read_as_is;
+    std::map<NNGraph::NodeRef, std::vector<NNGraph::NodeRef>> exits;
+    for (auto op : region) {
+      for (auto tensor : ImageInputs(op)) {
+        if ((!nn::hasProducer(tensor) ||
+             !ops.count(nn::getProducer(tensor))) &&
+            std::find(entering.begin(), entering.end(), tensor) ==
+                entering.end()) {
+          entering.push_back(tensor);
+        }
+      }
+      for (auto tensor : ImageOutputs(op)) {
+        read_as_is[tensor] = external_outputs_.count(tensor);
+        for (auto consumer : nn::getConsumers(tensor)) {
+          if (ops.count(consumer) && IsImageInput(tensor, consumer)) {
+            continue;
+          }
+          const auto& def = *GetOperatorDef(consumer);
+          if (GetRole(def) == LayoutRole::kSwitch &&
+              nn::getInputs(consumer)[0] == tensor &&
+              SwitchType(orders.at(tensor)) == def.type()) {
+            exits[tensor].push_back(consumer);
+          } else {
+            read_as_is[tensor] = true;
+          }
+        }
+        if (read_as_is.at(tensor) || exits.count(tensor)) {
+          leaving.push_back(tensor);
+        }
+      }
+    }
+
+    auto cost = [&](StorageOrder order, bool current) {
+      float total = 0;
+      NodeSet filters;
+      for (auto op : region) {
+        const auto& def = *GetOperatorDef(op);
+        switch (roles_.at(op)) {
+          case LayoutRole::kSensitive: {
+            const auto op_order = current ? GetOrder(def) : order;
+            total += cost_(def, op_order);
+            const auto inputs = nn::getInputs(op);
+            if (op_order != GetOrder(def) && ConvOps().count(def.type()) &&
+                inputs.size() > 1) {
+              filters.insert(inputs[1]);
+            }
+            break;
+          }
+          case LayoutRole::kSwitch:
+            total += current ? 1 : 0;
+            break;
+          default:
+            break;
+        }
+      }
+      total += filters.size();
+      for (auto tensor : leaving) {
+        const bool switched = !current && orders.at(tensor) != order;
+        total += switched ? read_as_is.at(tensor) : exits[tensor].size();
+      }
+      if (!current) {
+        for (auto tensor : entering) {
+          total += orders.at(tensor) != order;
+        }
+      }
+      return total;
+    };
+    const float current_cost = cost(StorageOrder::NCHW, true);
+    const float nchw_cost = cost(StorageOrder::NCHW, false);
+    const float nhwc_cost = cost(StorageOrder::NHWC, false);
+    const auto order =
+        nchw_cost <= nhwc_cost ? StorageOrder::NCHW : StorageOrder::NHWC;
+    const float best_cost = std::min(nchw_cost, nhwc_cost);
+    if (!(best_cost < current_cost)) {
+      return;
+    }
+    VLOG(1) << "Running a region of " << region.size() << " operators in "
+            << OrderName(order) << ", cost " << current_cost << " -> "
+            << best_cost;
+
+    // Operators running in the other order, and their filters
+    std::map<NNGraph::NodeRef, NNGraph::NodeRef> transposed_filters;
+    for (auto op : region) {
+      auto* def = GetOperatorDef(op);
+      if (roles_.at(op) != LayoutRole::kSensitive || GetOrder(*def) == order) {
+        continue;
+      }
+      const auto inputs = nn::getInputs(op);
+      if (ConvOps().count(def->type()) && inputs.size() > 1) {
+        auto filter = inputs[1];
+        if (!transposed_filters.count(filter)) {
+          auto transposed = CreateTensorNode(GetName(filter), order);
+          auto* transpose =
+              CreateOperator("Transpose", filter, transposed, *def, op);
+          transpose->add_arg()->CopyFrom(MakeArgument<std::vector<int>>(
+              "axes",
+              order == StorageOrder::NHWC ? std::vector<int>{0, 2, 3, 1}
+                                          : std::vector<int>{0, 3, 1, 2}));
+          transposed_filters[filter] = transposed;
+        }
+        ReplaceInput(op, filter, transposed_filters.at(filter));
+      }
+      SetOrder(def, order);
+    }
+
+    // Switch the images entering the region before their first reader
+    for (auto tensor : entering) {
+      const auto from = orders.at(tensor);
+      if (from == order) {
+        continue;
+      }
+      std::vector<NNGraph::NodeRef> readers;
+      for (auto consumer : nn::getConsumers(tensor)) {
+        if (ops.count(consumer) && IsImageInput(tensor, consumer) &&
+            std::find(readers.begin(), readers.end(), consumer) ==
+                readers.end()) {
+          readers.push_back(consumer);
+        }
+      }
+      std::sort(
+          readers.begin(),
+          readers.end(),
+          [&](NNGraph::NodeRef a, NNGraph::NodeRef b) {
+            return position_.at(a) < position_.at(b);
+          });
+      auto switched = CreateTensorNode(GetName(tensor), order);
+      CreateOperator(
+          SwitchType(from),
+          tensor,
+          switched,
+          *GetOperatorDef(readers[0]),
+          readers[0]);
+      for (auto reader : readers) {
+        ReplaceInput(reader, tensor, switched);
+      }
+    }
+
+    // The images leaving the region that are read as they are get written
+    // under a new name, and switched back to their name right after. The
+    // order switches reading them now read them in their output order.
+    for (auto tensor : leaving) {
+      if (orders.at(tensor) == order) {
+        continue;
+      }
+      auto value = tensor;
+      if (read_as_is.at(tensor)) {
+        auto producer = nn::getProducer(tensor);
+        value = CreateTensorNode(GetName(tensor), order);
+        ReplaceOutput(producer, tensor, value);
+        for (auto consumer : nn::getConsumers(tensor)) {
+          if (ops.count(consumer) && IsImageInput(tensor, consumer)) {
+            ReplaceInput(consumer, tensor, value);
+          }
+        }
+        const auto& instructions = bb_->getInstructions();
+        const auto it =
+            std::find(instructions.begin(), instructions.end(), producer);
+        CreateOperator(
+            SwitchType(order),
+            value,
+            tensor,
+            *GetOperatorDef(producer),
+            it + 1 == instructions.end() ? nullptr : *(it + 1));
+      }
+      for (auto exit : exits[tensor]) {
+        ReplaceInput(exit, tensor, value);
+        GetOperatorDef(exit)->set_type("Copy");
+      }
+    }
+
+    // The order switches within the region are removed
+    for (auto op : region) {
+      if (roles_.at(op) == LayoutRole::kSwitch) {
+        RemoveSwitch(op);
+      }
+    }
+  }
+
+  // Makes the readers of the output of the order switch op read its input,
+  // unless the name of the input is overwritten before, in which case op
+  // becomes a Copy
+  void RemoveSwitch(NNGraph::NodeRef op) {
+    auto input = nn::getInputs(op)[0];
+    auto output = nn::getOutputs(op)[0];
+    const auto readers = nn::getConsumers(output);
+    const auto name = GetName(input);
+    bool safe = true;
+    if (!new_names_.count(name)) {
+      int last = position_.at(op);
+      for (auto reader : readers) {
+        last = std::max<int>(last, position_.at(reader));
+      }
+      for (int i = position_.at(op) + 1; i < last && safe; ++i) {
+        for (const auto& blob : net_.op(i).output()) {
+          safe = safe && blob != name;
+        }
+      }
+    }
+    if (!safe) {
+      GetOperatorDef(op)->set_type("Copy");
+      return;
+    }
+    for (auto reader : readers) {
+      ReplaceInput(reader, output, input);
+    }
+    // The basic block drops the instructions the graph deletes
+    graph_->deleteNode(op);
+    graph_->deleteNode(output);
+  }
+
+  void SetOrder(OperatorDef* def, StorageOrder order) {
+    for (auto& arg : *def->mutable_arg()) {
+      if (arg.name() == "order") {
+        arg.set_s(OrderName(order));
+        return;
+      }
+    }
+    def->add_arg()->CopyFrom(
+        MakeArgument<std::string>("order", OrderName(order)));
+  }
+
+  // The inputs of ops are emitted in the order of the in-edges, so they are
+  // all recreated
+  void ReplaceInput(
+      NNGraph::NodeRef op,
+      NNGraph::NodeRef from,
+      NNGraph::NodeRef to) {
+    const auto in_edges = op->getInEdges();
+    std::vector<NNGraph::NodeRef> inputs;
+    for (auto edge : in_edges) {
+      inputs.push_back(edge->tail() == from ? to : edge->tail());
+      graph_->deleteEdge(edge);
+    }
+    for (auto input : inputs) {
+      graph_->createEdge(input, op);
+    }
+  }
+
+  void ReplaceOutput(
+      NNGraph::NodeRef op,
+      NNGraph::NodeRef from,
+      NNGraph::NodeRef to) {
+    const auto out_edges = op->getOutEdges();
+    std::vector<NNGraph::NodeRef> outputs;
+    for (auto edge : out_edges) {
+      outputs.push_back(edge->head() == from ? to : edge->head());
+      graph_->deleteEdge(edge);
+    }
+    for (auto output : outputs) {
+      graph_->createEdge(op, output);
+    }
+  }
+
+  // Adds an operator of type from input to output, on the device of like,
+  // before the instruction before, or at the end if it is null
+  OperatorDef* CreateOperator(
+      const std::string& type,
+      NNGraph::NodeRef input,
+      NNGraph::NodeRef output,
+      const OperatorDef& like,
+      NNGraph::NodeRef before) {
+    new_ops_.emplace_back();
+    auto* def = &new_ops_.back();
+    def->set_type(type);
+    if (like.has_device_option()) {
+      def->mutable_device_option()->CopyFrom(like.device_option());
+    }
+    auto op = nom::util::make_unique<nom::repr::GenericOperator>(type);
+    op->setAnnotation(nom::util::make_unique<nom::repr::Annotation>());
+    op->getMutableAnnotation()->setSaved(def);
+    auto node =
+        graph_->createNode(unique_dyn_cast<nom::repr::NeuralNetOperator>(op));
+    graph_->createEdge(input, node);
+    graph_->createEdge(node, output);
+    if (before) {
+      bb_->insertInstructionBefore(node, before);
+    } else {
+      bb_->pushInstructionNode(node);
+    }
+    return def;
+  }
+
+  // A tensor of a new name for base in order
+  NNGraph::NodeRef CreateTensorNode(
+      const std::string& base,
+      StorageOrder order) {
+    const std::string prefix =
+        base + (order == StorageOrder::NCHW ? "_nchw" : "_nhwc");
+    std::string name = prefix;
+    for (int i = 1; used_names_.count(name); ++i) {
+      name = prefix + "_" + caffe2::to_string(i);
+    }
+    used_names_.insert(name);
+    new_names_.insert(name);
+    auto tensor = nom::util::make_unique<nom::repr::Tensor>(name);
+    return graph_->createNode(
+        unique_dyn_cast<nom::repr::NeuralNetData>(tensor));
+  }
+
+  const NetDef& net_;
+  const LayoutCostFunction& cost_;
+  std::set<std::string> used_names_;
+  std::set<std::string> new_names_;
+  NNGraph* graph_ = nullptr;
+  nom::repr::BasicBlockType<NNGraph>* bb_ = nullptr;
+  std::vector<NNGraph::NodeRef> ops_;
+  std::unordered_map<NNGraph::NodeRef, int> position_;
+  std::unordered_map<NNGraph::NodeRef, LayoutRole> roles_;
+  NodeSet external_outputs_;
+  // The operators added, which the module points to
+  std::deque<OperatorDef> new_ops_;
+};
+
+} // namespace
+
+float DefaultLayoutCost(const OperatorDef& op, StorageOrder order) {
+  if (order == StorageOrder::NCHW) {
+    return op.engine() == "EIGEN" ? 2 : 0;
+  }
+  static const std::set<std::string> nchw_engines{
+      "NNPACK", "WINOGRAD", "MKLDNN"};
+  if (nchw_engines.count(op.engine()) ||
+      (ConvOps().count(op.type()) &&
+       ArgumentHelper(op).GetSingleArgument<int>("group", 1) != 1)) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return op.engine() == "CUDNN" ? 1 : 0;
+}
+
+NetDef OptimizeLayout(const NetDef& net, const LayoutCostFunction& cost) {
+  // The Caffe2 converter cannot write control flow back
+  for (const auto& op : net.op()) {
+    if (op.type() == "While") {
+      return net;
+    }
+    for (const auto& arg : op.arg()) {
+      if (arg.has_n() || arg.nets_size() > 0) {
+        return net;
+      }
+    }
+  }
+  return LayoutOptimization(net, cost).Run();
+}
+
+} // namespace caffe2
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/types.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * The cost of running op in order, in units of the cost of switching the
+ * order of one blob, or infinity if op can't run in that order.
+ */
+using LayoutCostFunction =
+    std::function<float(const OperatorDef& op, StorageOrder order)>;
+
+/**
+ * The default cost model: operators run as fast in both orders, except for
+ * the engines that only support NCHW (NNPACK, WINOGRAD, MKLDNN), group
+ * convolutions, which only support NCHW outside of the depthwise kernels,
+ * EIGEN convolutions, which transpose NCHW images internally, and cuDNN,
+ * whose float kernels are faster in NCHW. The pass then mostly minimizes
+ * the number of order switches.
+ */
+float DefaultLayoutCost(const OperatorDef& op, StorageOrder order);
+
+/**
+ * Global data layout optimization.
+ *
+ * Converts the net to the nomnigraph NeuralNet representation and splits the
+ * operators that can run in both orders (Conv, ConvTranspose, ConvRelu,
+ * MaxPool, AveragePool, SpatialBN and LRN on 2d images), the element wise
+ * operators between them and the NCHW2NHWC / NHWC2NCHW order switches into
+ * regions of operators connected by images. For every region, picks the order
+ * minimizing the cost of its operators plus the order switches it needs:
+ *
+ *  - images read from outside of the region, or read outside of it and
+ *    external outputs, keep their original order and are switched at the
+ *    border if the region runs in the other order, while the order switches
+ *    reading images of the region become copies if the region runs in their
+ *    output order;
+ *  - the filters of convolutions changing order are transposed;
+ *  - the order switches within the region are removed.
+ *
+ * A region is only rewritten if that lowers its cost, so that the net is
+ * left as is if it already has the best layout. The images the operators
+ * read and write are assumed to be 4d, as for the order switches. Returns
+ * the transformed net; the net is returned as is if it has control flow.
+ */
+NetDef OptimizeLayout(
+    const NetDef& net,
+    const LayoutCostFunction& cost = DefaultLayoutCost);
+
+} // namespace caffe2
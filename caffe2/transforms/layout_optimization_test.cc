@@ -0,0 +1,175 @@
+#include <cmath>
+#include <limits>
+
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/net.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/transforms/layout_optimization.h"
+
+namespace caffe2 {
+
+namespace {
+
+void AddTensor(
+    Workspace* ws,
+    const std::string& name,
+    const std::vector<TIndex>& dims,
+    const float offset) {
+  auto* tensor = ws->CreateBlob(name)->GetMutable<TensorCPU>();
+  tensor->Resize(dims);
+  float* data = tensor->mutable_data<float>();
+  for (TIndex i = 0; i < tensor->size(); ++i) {
+    data[i] = offset + std::sin(i * 0.7f + offset);
+  }
+}
+
+OperatorDef* AddConv(
+    NetDef* net,
+    const std::vector<string>& inputs,
+    const std::string& output,
+    const std::string& order) {
+  auto* op = AddOp(net, "Conv", inputs, {output});
+  op->add_arg()->CopyFrom(MakeArgument<int>("kernel", 3));
+  op->add_arg()->CopyFrom(MakeArgument<int>("pad", 1));
+  op->add_arg()->CopyFrom(MakeArgument<string>("order", order));
+  return op;
+}
+
+std::string GetOrderArgument(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<std::string>("order", "NCHW");
+}
+
+// Runs net and then its optimization in ws, and checks that the outputs match
+NetDef RunAndCompare(
+    const NetDef& net,
+    Workspace* ws,
+    const LayoutCostFunction& cost = DefaultLayoutCost) {
+  CAFFE_ENFORCE(ws->RunNetOnce(net));
+  TensorCPU expected(ws->GetBlob("Y")->Get<TensorCPU>());
+  const NetDef optimized = OptimizeLayout(net, cost);
+  ws->GetBlob("Y")->GetMutable<TensorCPU>()->Resize(0);
+  CAFFE_ENFORCE(ws->RunNetOnce(optimized));
+  const auto& Y = ws->GetBlob("Y")->Get<TensorCPU>();
+  EXPECT_EQ(Y.dims(), expected.dims());
+  for (TIndex i = 0; i < Y.size(); ++i) {
+    EXPECT_NEAR(Y.data<float>()[i], expected.data<float>()[i], 1e-4);
+  }
+  return optimized;
+}
+
+TEST(LayoutOptimizationTest, TestRemovesOrderSwitches) {
+  Workspace ws;
+  AddTensor(&ws, "X", {2, 3, 6, 5}, 0);
+  AddTensor(&ws, "W1", {4, 3, 3, 3}, 0.1f);
+  // NHWC filter
+  AddTensor(&ws, "W2", {4, 3, 3, 4}, 0.2f);
+  AddTensor(&ws, "W3", {2, 4, 3, 3}, 0.3f);
+  AddTensor(&ws, "b", {4}, 0.4f);
+  NetDef net;
+  AddConv(&net, {"X", "W1", "b"}, "A", "NCHW");
+  AddOp(&net, "NCHW2NHWC", {"A"}, {"B"});
+  AddConv(&net, {"B", "W2", "b"}, "C", "NHWC");
+  AddOp(&net, "Relu", {"C"}, {"D"});
+  AddOp(&net, "NHWC2NCHW", {"D"}, {"E"});
+  AddConv(&net, {"E", "W3"}, "Y", "NCHW");
+  net.add_external_output("Y");
+
+  // The NHWC filter is transposed instead of both images
+  const NetDef optimized = RunAndCompare(net, &ws);
+  ASSERT_EQ(optimized.op_size(), 5);
+  EXPECT_EQ(optimized.op(0).type(), "Conv");
+  EXPECT_EQ(optimized.op(1).type(), "Transpose");
+  EXPECT_EQ(optimized.op(1).input(0), "W2");
+  EXPECT_EQ(optimized.op(2).type(), "Conv");
+  EXPECT_EQ(GetOrderArgument(optimized.op(2)), "NCHW");
+  EXPECT_EQ(optimized.op(2).input(0), "A");
+  EXPECT_EQ(optimized.op(2).input(1), optimized.op(1).output(0));
+  EXPECT_EQ(optimized.op(3).type(), "Relu");
+  EXPECT_EQ(optimized.op(4).input(0), "D");
+  EXPECT_EQ(optimized.op(4).output(0), "Y");
+}
+
+TEST(LayoutOptimizationTest, TestCostModel) {
+  Workspace ws;
+  AddTensor(&ws, "X", {2, 6, 5, 3}, 0);
+  AddTensor(&ws, "W", {4, 3, 3, 3}, 0.1f);
+  NetDef net;
+  AddConv(&net, {"X", "W"}, "A", "NHWC");
+  AddOp(&net, "Relu", {"A"}, {"B"});
+  auto* pool = AddOp(&net, "MaxPool", {"B"}, {"Y"});
+  pool->add_arg()->CopyFrom(MakeArgument<int>("kernel", 2));
+  pool->add_arg()->CopyFrom(MakeArgument<string>("order", "NHWC"));
+  net.add_external_output("Y");
+
+  // Already as good as it gets
+  EXPECT_EQ(OptimizeLayout(net).op_size(), 3);
+
+  // Switches the input, the filter and the output to run in NCHW
+  const NetDef optimized = RunAndCompare(
+      net, &ws, [](const OperatorDef& op, StorageOrder order) {
+        return order == StorageOrder::NHWC ? 10.0f : 0.0f;
+      });
+  ASSERT_EQ(optimized.op_size(), 6);
+  EXPECT_EQ(optimized.op(0).type(), "Transpose");
+  EXPECT_EQ(optimized.op(1).type(), "NHWC2NCHW");
+  EXPECT_EQ(optimized.op(1).input(0), "X");
+  EXPECT_EQ(GetOrderArgument(optimized.op(2)), "NCHW");
+  EXPECT_EQ(GetOrderArgument(optimized.op(4)), "NCHW");
+  EXPECT_EQ(optimized.op(5).type(), "NCHW2NHWC");
+  EXPECT_EQ(optimized.op(5).output(0), "Y");
+}
+
+TEST(LayoutOptimizationTest, TestOutputSwitch) {
+  Workspace ws;
+  AddTensor(&ws, "X", {2, 3, 6, 5}, 0);
+  AddTensor(&ws, "W", {4, 3, 3, 3}, 0.1f);
+  NetDef net;
+  AddOp(&net, "NCHW2NHWC", {"X"}, {"A"});
+  AddConv(&net, {"A", "W"}, "B", "NHWC");
+  AddOp(&net, "NHWC2NCHW", {"B"}, {"Y"});
+  net.add_external_output("Y");
+
+  // The last switch, whose output is an output of the net, becomes a copy
+  const NetDef optimized = RunAndCompare(net, &ws);
+  ASSERT_EQ(optimized.op_size(), 3);
+  EXPECT_EQ(optimized.op(0).type(), "Transpose");
+  EXPECT_EQ(optimized.op(1).type(), "Conv");
+  EXPECT_EQ(optimized.op(1).input(0), "X");
+  EXPECT_EQ(GetOrderArgument(optimized.op(1)), "NCHW");
+  EXPECT_EQ(optimized.op(2).type(), "Copy");
+  EXPECT_EQ(optimized.op(2).output(0), "Y");
+
+  // Unless the Conv can't run in NCHW
+  EXPECT_EQ(
+      DefaultLayoutCost(net.op(1), StorageOrder::NCHW),
+      DefaultLayoutCost(net.op(1), StorageOrder::NHWC));
+  const auto infinity = std::numeric_limits<float>::infinity();
+  const NetDef kept =
+      OptimizeLayout(net, [=](const OperatorDef& op, StorageOrder order) {
+        return order == StorageOrder::NCHW ? infinity : 0.0f;
+      });
+  ASSERT_EQ(kept.op_size(), 3);
+  EXPECT_EQ(kept.op(0).type(), "NCHW2NHWC");
+  EXPECT_EQ(GetOrderArgument(kept.op(1)), "NHWC");
+}
+
+TEST(LayoutOptimizationTest, TestDefaultCost) {
+  NetDef net;
+  AddConv(&net, {"X", "W"}, "Y", "NCHW")->set_engine("NNPACK");
+  auto* group = AddConv(&net, {"X", "W"}, "Y", "NCHW");
+  group->add_arg()->CopyFrom(MakeArgument<int>("group", 2));
+  AddConv(&net, {"X", "W"}, "Y", "NCHW")->set_engine("CUDNN");
+
+  const auto infinity = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(DefaultLayoutCost(net.op(0), StorageOrder::NCHW), 0);
+  EXPECT_EQ(DefaultLayoutCost(net.op(0), StorageOrder::NHWC), infinity);
+  EXPECT_EQ(DefaultLayoutCost(net.op(1), StorageOrder::NHWC), infinity);
+  EXPECT_LT(
+      DefaultLayoutCost(net.op(2), StorageOrder::NCHW),
+      DefaultLayoutCost(net.op(2), StorageOrder::NHWC));
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,322 @@
+#include "caffe2/transforms/mkl_layout_propagation.h"
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+const std::map<std::string, MKLOperatorLayout>& FallbackOperators() {
+  static const std::map<std::string, MKLOperatorLayout> operators = [] {
+    std::map<std::string, MKLOperatorLayout> operators;
+    for (const char* type :
+         {"Softmax",
+          "Reshape",
+          "LabelCrossEntropy",
+          "AveragedLoss",
+          "XavierFill",
+          "ConstantFill",
+          "GaussianFill",
+          "MSRAFill",
+          "Load",
+          "Save",
+          "Dropout",
+          "ElementwiseLinear",
+          "ChannelShuffle"}) {
+      operators[type].kind = MKLLayoutKind::kFallback;
+    }
+    // The old shape and the mask
+    operators["Reshape"].cpu_outputs = {1};
+    operators["Dropout"].cpu_outputs = {1};
+    // They use the names of their blobs as keys
+    operators["Load"].movable = false;
+    operators["Save"].movable = false;
+    return operators;
+  }();
+  return operators;
+}
+
+bool IsMKL(const DeviceOption& device) {
+  return device.device_type() == MKLDNN;
+}
+
+class MKLLayoutPropagator {
+ public:
+  MKLLayoutPropagator(const NetDef& net, const MKLLayoutOptions& options)
+      : net_(net) {
+    for (const auto& op : net.op()) {
+      names_.insert(op.input().begin(), op.input().end());
+      names_.insert(op.output().begin(), op.output().end());
+    }
+    names_.insert(net.external_input().begin(), net.external_input().end());
+    names_.insert(net.external_output().begin(), net.external_output().end());
+    mkl_device_.set_device_type(MKLDNN);
+    if (IsMKL(net.device_option())) {
+      mkl_device_ = net.device_option();
+    }
+
+    // The blobs holding a TensorCPU in the original net, and the conversions
+    // it does
+    cpu_blobs_ = options.cpu_inputs;
+    std::unordered_set<std::string> written;
+    for (int i = 0; i < net.op_size(); ++i) {
+      ops_.push_back(net.op(i));
+      auto& op = ops_.back();
+      if (!op.has_device_option()) {
+        op.mutable_device_option()->CopyFrom(net.device_option());
+      }
+      layouts_.push_back(options.layout(op));
+      const auto& layout = layouts_.back();
+      if (IsCopy(op)) {
+        ++conversions_before_;
+        if (op.type() == "CopyCPUToMKL" && !written.count(op.input(0))) {
+          cpu_blobs_.insert(op.input(0));
+        } else if (op.type() == "CopyMKLToCPU") {
+          cpu_blobs_.insert(op.output(0));
+        }
+      } else if (layout.kind == MKLLayoutKind::kOther) {
+        for (const auto& input : op.input()) {
+          if (!written.count(input)) {
+            cpu_blobs_.insert(input);
+          }
+        }
+        cpu_blobs_.insert(op.output().begin(), op.output().end());
+      } else if (layout.kind == MKLLayoutKind::kFallback) {
+        for (int j : layout.cpu_outputs) {
+          cpu_blobs_.insert(op.output(j));
+        }
+      }
+      written.insert(op.output().begin(), op.output().end());
+    }
+    for (int i = 0; i < ops_.size(); ++i) {
+      if (layouts_[i].kind == MKLLayoutKind::kFallback) {
+        conversions_before_ += FallbackConversions(ops_[i], layouts_[i]);
+      }
+    }
+  }
+
+  NetDef Run(MKLLayoutStats* stats) {
+    NetDef result = net_;
+    result.clear_op();
+    result_ = &result;
+    for (int i = 0; i < ops_.size(); ++i) {
+      const auto& op = ops_[i];
+      const auto& layout = layouts_[i];
+      if (IsCopy(op)) {
+        Copy(op);
+        continue;
+      }
+      bool on_cpu = false;
+      if (layout.kind == MKLLayoutKind::kFallback) {
+        on_cpu = layout.movable;
+      } else if (layout.kind == MKLLayoutKind::kAgnostic) {
+        // Where the last of the inputs was written
+        for (const auto& input : op.input()) {
+          on_cpu |= Locate(input)->mkl.empty();
+        }
+      }
+      if (on_cpu) {
+        RunOnCPU(op);
+      } else {
+        Keep(op, layout);
+      }
+    }
+    for (const auto& output : net_.external_output()) {
+      Fetch(output, !cpu_blobs_.count(output), mkl_device_);
+    }
+
+    LOG(INFO) << "Propagated the MKL layouts of " << net_.name() << ": "
+              << num_moved_ops_ << " operators moved to CPU, "
+              << conversions_after_ << " conversions per run instead of "
+              << conversions_before_;
+    if (stats) {
+      stats->conversions_before = conversions_before_;
+      stats->conversions_after = conversions_after_;
+      stats->num_moved_ops = num_moved_ops_;
+    }
+    return result;
+  }
+
+ private:
+  // The names of the current version of a blob as an MKLMemory and as a
+  // TensorCPU, empty if it has not been converted there
+  struct Location {
+    std::string mkl;
+    std::string cpu;
+  };
+
+  static bool IsCopy(const OperatorDef& op) {
+    return IsMKL(op.device_option()) &&
+        (op.type() == "CopyCPUToMKL" || op.type() == "CopyMKLToCPU");
+  }
+
+  int FallbackConversions(
+      const OperatorDef& op,
+      const MKLOperatorLayout& layout) const {
+    int conversions = 0;
+    for (const auto& input : op.input()) {
+      conversions += !cpu_blobs_.count(input);
+    }
+    return conversions + op.output_size() - layout.cpu_outputs.size();
+  }
+
+  Location* Locate(const std::string& blob) {
+    auto it = state_.find(blob);
+    if (it == state_.end()) {
+      // Not written by the net yet, so an input of the net
+      Location location;
+      (cpu_blobs_.count(blob) ? location.cpu : location.mkl) = blob;
+      it = state_.emplace(blob, location).first;
+    }
+    return &it->second;
+  }
+
+  // The name of the blob as an MKLMemory or as a TensorCPU: the blob itself
+  // for the type it has in the original net, a new name for the other one
+  const std::string& Name(const std::string& blob, bool mkl) {
+    if (mkl != !cpu_blobs_.count(blob)) {
+      auto& name = (mkl ? mkl_names_ : cpu_names_)[blob];
+      if (name.empty()) {
+        name = blob + (mkl ? "_mkl" : "_cpu");
+        while (names_.count(name)) {
+          name += "_";
+        }
+        names_.insert(name);
+      }
+      return name;
+    }
+    return blob;
+  }
+
+  // The blob now holds the version written into name, other blobs sharing
+  // the previous content of name lose it
+  void Write(const std::string& blob, const std::string& name, bool mkl) {
+    for (auto& entry : state_) {
+      for (auto* other : {&entry.second.mkl, &entry.second.cpu}) {
+        if (*other == name) {
+          other->clear();
+        }
+      }
+    }
+    Location location;
+    (mkl ? location.mkl : location.cpu) = name;
+    state_[blob] = location;
+  }
+
+  // The name of the current version of the blob as an MKLMemory or as a
+  // TensorCPU, converting it there if needed
+  std::string
+  Fetch(const std::string& blob, bool mkl, const DeviceOption& device) {
+    auto* location = Locate(blob);
+    const std::string& current = mkl ? location->mkl : location->cpu;
+    if (!current.empty()) {
+      return current;
+    }
+    const std::string src = mkl ? location->cpu : location->mkl;
+    const std::string dst = Name(blob, mkl);
+    CAFFE_ENFORCE(!src.empty(), "Blob ", blob, " was overwritten");
+    *result_->add_op() = CreateOperatorDef(
+        mkl ? "CopyCPUToMKL" : "CopyMKLToCPU",
+        "",
+        std::vector<string>{src},
+        std::vector<string>{dst},
+        IsMKL(device) ? device : mkl_device_);
+    ++conversions_after_;
+    Write(blob, dst, mkl);
+    (mkl ? state_[blob].cpu : state_[blob].mkl) = src;
+    return dst;
+  }
+
+  // An existing copy, whose output keeps the input as its other version
+  void Copy(const OperatorDef& op) {
+    const bool to_mkl = op.type() == "CopyCPUToMKL";
+    OperatorDef placed = op;
+    const std::string src = Fetch(op.input(0), !to_mkl, op.device_option());
+    placed.set_input(0, src);
+    placed.set_output(0, Name(op.output(0), to_mkl));
+    *result_->add_op() = placed;
+    ++conversions_after_;
+    Write(op.output(0), placed.output(0), to_mkl);
+    (to_mkl ? state_[op.output(0)].cpu : state_[op.output(0)].mkl) = src;
+  }
+
+  // Runs the operator with the types of blobs of the original net
+  void Keep(const OperatorDef& op, const MKLOperatorLayout& layout) {
+    OperatorDef placed = op;
+    for (int j = 0; j < op.input_size(); ++j) {
+      placed.set_input(
+          j,
+          Fetch(op.input(j), !cpu_blobs_.count(op.input(j)), op.device_option()));
+    }
+    *result_->add_op() = placed;
+    for (const auto& output : op.output()) {
+      Write(output, output, !cpu_blobs_.count(output));
+    }
+    if (layout.kind == MKLLayoutKind::kFallback) {
+      conversions_after_ += FallbackConversions(op, layout);
+    }
+  }
+
+  // Runs a fallback or layout agnostic operator as the CPU operator
+  void RunOnCPU(const OperatorDef& op) {
+    OperatorDef placed = op;
+    for (int j = 0; j < op.input_size(); ++j) {
+      placed.set_input(j, Fetch(op.input(j), false, op.device_option()));
+    }
+    for (int j = 0; j < op.output_size(); ++j) {
+      placed.set_output(j, Name(op.output(j), false));
+    }
+    placed.mutable_device_option()->set_device_type(CPU);
+    *result_->add_op() = placed;
+    for (int j = 0; j < op.output_size(); ++j) {
+      Write(op.output(j), placed.output(j), false);
+    }
+    ++num_moved_ops_;
+  }
+
+  const NetDef& net_;
+  // The operators, with the device option of the net if they have none
+  std::vector<OperatorDef> ops_;
+  std::vector<MKLOperatorLayout> layouts_;
+  std::unordered_set<std::string> names_;
+  std::set<std::string> cpu_blobs_;
+  std::unordered_map<std::string, std::string> mkl_names_;
+  std::unordered_map<std::string, std::string> cpu_names_;
+  std::unordered_map<std::string, Location> state_;
+  DeviceOption mkl_device_;
+  NetDef* result_ = nullptr;
+  int conversions_before_ = 0;
+  int conversions_after_ = 0;
+  int num_moved_ops_ = 0;
+};
+
+} // namespace
+
+MKLOperatorLayout DefaultMKLOperatorLayout(const OperatorDef& op) {
+  MKLOperatorLayout layout;
+  if (!IsMKL(op.device_option())) {
+    return layout;
+  }
+  const auto& fallbacks = FallbackOperators();
+  auto it = fallbacks.find(op.type());
+  if (it != fallbacks.end()) {
+    return it->second;
+  }
+  layout.kind = op.type() == "Sigmoid" ? MKLLayoutKind::kAgnostic
+                                       : MKLLayoutKind::kNative;
+  return layout;
+}
+
+NetDef PropagateMKLLayouts(
+    const NetDef& net,
+    const MKLLayoutOptions& options,
+    MKLLayoutStats* stats) {
+  return MKLLayoutPropagator(net, options).Run(stats);
+}
+
+} // namespace caffe2
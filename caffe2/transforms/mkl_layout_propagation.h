@@ -0,0 +1,90 @@
+#pragma once
+
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * How an operator deals with the layouts of MKLMemory.
+ */
+enum class MKLLayoutKind {
+  // Operators of other devices, reading and writing TensorCPU
+  kOther,
+  // Native MKL operators, reading MKLMemory in any layout and writing it in
+  // the internal layouts of their primitives
+  kNative,
+  // Operators computing every element on its own, like Sigmoid, which run
+  // on the buffer of an MKLMemory whatever its layout, and as well on CPU
+  kAgnostic,
+  // CPU operators wrapped by MKLFallbackOp, which converts every MKLMemory
+  // input to the plain layout and every output back to MKLMemory
+  kFallback,
+};
+
+struct MKLOperatorLayout {
+  MKLLayoutKind kind = MKLLayoutKind::kOther;
+  // The outputs of a fallback operator which stay TensorCPU
+  std::vector<int> cpu_outputs;
+  // Whether a fallback operator may run on CPU instead. Not the case of the
+  // operators using the names of their inputs, like Save.
+  bool movable = true;
+};
+
+using MKLLayoutFunction = std::function<MKLOperatorLayout(const OperatorDef&)>;
+
+/**
+ * The layout handling of the MKL operators of caffe2/mkl/operators, kOther
+ * for the operators of other devices.
+ */
+MKLOperatorLayout DefaultMKLOperatorLayout(const OperatorDef& op);
+
+struct MKLLayoutOptions {
+  MKLLayoutFunction layout = DefaultMKLOperatorLayout;
+  // The external inputs holding a TensorCPU rather than an MKLMemory,
+  // besides those read by the operators of other devices
+  std::set<std::string> cpu_inputs;
+};
+
+struct MKLLayoutStats {
+  // Conversions between MKLMemory and TensorCPU per run of the net, done by
+  // the fallback operators and the copies, before and after the pass
+  int conversions_before = 0;
+  int conversions_after = 0;
+  // Fallback and layout agnostic operators moved to CPU
+  int num_moved_ops = 0;
+};
+
+/**
+ * Eliminates the layout conversions of the MKL nets running a few
+ * operators with no MKL implementation.
+ *
+ * Every fallback operator converts its MKLMemory inputs to TensorCPU and its
+ * outputs back, so a chain of them, or an MKLMemory read by several of them,
+ * gets converted again and again. The pass tracks where the current version
+ * of every blob is, as an MKLMemory and/or a TensorCPU, runs the fallback
+ * operators as the CPU operators they wrap, and only converts blobs at the
+ * boundaries between MKL and CPU operators, once per version:
+ * `CopyMKLToCPU` into `<blob>_cpu` before the first CPU reader of an
+ * MKLMemory, and `CopyCPUToMKL` back before the first MKL reader of a blob
+ * written on CPU. The MKLMemory written by native operators therefore keep
+ * their internal layouts through chains of MKL operators. Layout agnostic
+ * operators run on MKLMemory when their inputs are there, and on CPU when
+ * they follow CPU operators.
+ *
+ * The existing copies are kept, and tracked as both versions of the blob.
+ * The external outputs get their last version under their name and type.
+ * Conversions between internal layouts inside native operators are not
+ * counted. Fills stats if given, and returns the rewritten net.
+ */
+NetDef PropagateMKLLayouts(
+    const NetDef& net,
+    const MKLLayoutOptions& options = MKLLayoutOptions(),
+    MKLLayoutStats* stats = nullptr);
+
+} // namespace caffe2
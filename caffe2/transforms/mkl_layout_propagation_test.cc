@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/transforms/mkl_layout_propagation.h"
+
+namespace caffe2 {
+
+namespace {
+
+NetDef MKLNet() {
+  NetDef net;
+  net.set_name("test");
+  net.mutable_device_option()->set_device_type(MKLDNN);
+  return net;
+}
+
+void ExpectOp(
+    const OperatorDef& op,
+    const std::string& type,
+    const std::vector<std::string>& inputs,
+    const std::vector<std::string>& outputs,
+    DeviceType device) {
+  EXPECT_EQ(op.type(), type);
+  EXPECT_EQ(
+      std::vector<std::string>(op.input().begin(), op.input().end()), inputs);
+  EXPECT_EQ(
+      std::vector<std::string>(op.output().begin(), op.output().end()),
+      outputs);
+  EXPECT_EQ(op.device_option().device_type(), device);
+}
+
+TEST(MKLLayoutPropagationTest, TestFallbackChainRunsOnCPU) {
+  NetDef net = MKLNet();
+  AddOp(&net, "Conv", {"X", "W"}, {"A"});
+  AddOp(&net, "Softmax", {"A"}, {"B"});
+  AddOp(&net, "Sigmoid", {"B"}, {"C"});
+  AddOp(&net, "ElementwiseLinear", {"C", "w", "b"}, {"D"});
+  AddOp(&net, "Relu", {"D"}, {"E"});
+  AddOp(&net, "Sigmoid", {"E"}, {"F"});
+  net.add_external_output("B");
+  net.add_external_output("F");
+  MKLLayoutOptions options;
+  options.cpu_inputs = {"w", "b"};
+
+  MKLLayoutStats stats;
+  const NetDef result = PropagateMKLLayouts(net, options, &stats);
+  ASSERT_EQ(result.op_size(), 9);
+  ExpectOp(result.op(0), "Conv", {"X", "W"}, {"A"}, MKLDNN);
+  ExpectOp(result.op(1), "CopyMKLToCPU", {"A"}, {"A_cpu"}, MKLDNN);
+  ExpectOp(result.op(2), "Softmax", {"A_cpu"}, {"B_cpu"}, CPU);
+  // Layout agnostic, following a CPU operator
+  ExpectOp(result.op(3), "Sigmoid", {"B_cpu"}, {"C_cpu"}, CPU);
+  ExpectOp(
+      result.op(4), "ElementwiseLinear", {"C_cpu", "w", "b"}, {"D_cpu"}, CPU);
+  ExpectOp(result.op(5), "CopyCPUToMKL", {"D_cpu"}, {"D"}, MKLDNN);
+  ExpectOp(result.op(6), "Relu", {"D"}, {"E"}, MKLDNN);
+  // Layout agnostic, following an MKL operator
+  ExpectOp(result.op(7), "Sigmoid", {"E"}, {"F"}, MKLDNN);
+  ExpectOp(result.op(8), "CopyCPUToMKL", {"B_cpu"}, {"B"}, MKLDNN);
+
+  EXPECT_EQ(stats.conversions_before, 4);
+  EXPECT_EQ(stats.conversions_after, 3);
+  EXPECT_EQ(stats.num_moved_ops, 3);
+}
+
+TEST(MKLLayoutPropagationTest, TestCopiesAreReused) {
+  NetDef net = MKLNet();
+  AddOp(&net, "CopyCPUToMKL", {"X"}, {"X_mkl"});
+  AddOp(&net, "Relu", {"X_mkl"}, {"A"});
+  AddOp(&net, "Softmax", {"X_mkl"}, {"B"});
+  AddOp(&net, "Softmax", {"A"}, {"C"});
+  net.add_external_output("B");
+  MKLLayoutOptions options;
+  options.cpu_inputs = {"X"};
+
+  MKLLayoutStats stats;
+  const NetDef result = PropagateMKLLayouts(net, options, &stats);
+  ASSERT_EQ(result.op_size(), 6);
+  ExpectOp(result.op(0), "CopyCPUToMKL", {"X"}, {"X_mkl"}, MKLDNN);
+  ExpectOp(result.op(1), "Relu", {"X_mkl"}, {"A"}, MKLDNN);
+  // X_mkl is still X on CPU
+  ExpectOp(result.op(2), "Softmax", {"X"}, {"B_cpu"}, CPU);
+  ExpectOp(result.op(3), "CopyMKLToCPU", {"A"}, {"A_cpu"}, MKLDNN);
+  ExpectOp(result.op(4), "Softmax", {"A_cpu"}, {"C_cpu"}, CPU);
+  ExpectOp(result.op(5), "CopyCPUToMKL", {"B_cpu"}, {"B"}, MKLDNN);
+
+  EXPECT_EQ(stats.conversions_before, 5);
+  EXPECT_EQ(stats.conversions_after, 3);
+}
+
+TEST(MKLLayoutPropagationTest, TestPinnedAndCPUOutputs) {
+  NetDef net = MKLNet();
+  AddOp(&net, "Relu", {"X"}, {"A"});
+  AddOp(&net, "Reshape", {"A"}, {"A", "old_shape"});
+  AddOp(&net, "Save", {"A"}, {});
+  net.add_external_output("old_shape");
+
+  MKLLayoutStats stats;
+  const NetDef result = PropagateMKLLayouts(net, MKLLayoutOptions(), &stats);
+  ASSERT_EQ(result.op_size(), 5);
+  ExpectOp(result.op(1), "CopyMKLToCPU", {"A"}, {"A_cpu"}, MKLDNN);
+  // The old shape is a TensorCPU in the original net too
+  ExpectOp(
+      result.op(2), "Reshape", {"A_cpu"}, {"A_cpu", "old_shape"}, CPU);
+  ExpectOp(result.op(3), "CopyCPUToMKL", {"A_cpu"}, {"A"}, MKLDNN);
+  ExpectOp(result.op(4), "Save", {"A"}, {}, MKLDNN);
+
+  EXPECT_EQ(stats.conversions_before, 3);
+  EXPECT_EQ(stats.conversions_after, 3);
+  EXPECT_EQ(stats.num_moved_ops, 1);
+}
+
+} // namespace
+
+} // namespace caffe2
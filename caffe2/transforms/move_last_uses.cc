@@ -0,0 +1,85 @@
+#include "caffe2/transforms/move_last_uses.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+const std::set<std::string>& CopyOps() {
+  static const std::set<std::string> ops{
+      "Copy", "EnsureCPUOutput", "CopyFromCPUInput", "CopyOnDeviceLike"};
+  return ops;
+}
+
+bool Uses(
+    const google::protobuf::RepeatedPtrField<std::string>& blobs,
+    const std::string& blob) {
+  return std::find(blobs.begin(), blobs.end(), blob) != blobs.end();
+}
+
+bool CanMoveInput(const NetDef& net, int idx) {
+  const auto& op = net.op(idx);
+  if (op.input_size() == 0 || op.output_size() != 1) {
+    return false;
+  }
+  const auto& input = op.input(0);
+  if (op.output(0) == input || Uses(net.external_input(), input) ||
+      Uses(net.external_output(), input)) {
+    return false;
+  }
+  bool written = false;
+  for (int i = 0; i < net.op_size(); ++i) {
+    if (i == idx) {
+      continue;
+    }
+    const auto& other = net.op(i);
+    const bool reads = Uses(other.input(), input);
+    const bool writes = Uses(other.output(), input);
+    if (i > idx) {
+      // The input would be read after it's moved, or written while the copy
+      // runs if both only depend on the operator that made the input
+      if (reads || writes) {
+        return false;
+      }
+    } else if (reads && (!writes || !written)) {
+      // Another reader may run concurrently with the copy in a DAG net, and
+      // a read before the first write reads the previous run
+      return false;
+    }
+    written = written || writes;
+  }
+  return written;
+}
+
+} // namespace
+
+NetDef MoveLastUses(const NetDef& net) {
+  for (const auto& op : net.op()) {
+    for (const auto& arg : op.arg()) {
+      if (arg.has_n() || arg.nets_size() > 0) {
+        return net;
+      }
+    }
+  }
+
+  NetDef move_net = net;
+  int num_moves = 0;
+  for (int i = 0; i < move_net.op_size(); ++i) {
+    auto* op = move_net.mutable_op(i);
+    if (CopyOps().count(op->type()) && CanMoveInput(move_net, i)) {
+      AddArgument<int>("move_input", 1, op);
+      ++num_moves;
+    }
+  }
+  VLOG(1) << "Enabled moving the input of " << num_moves << " operators of "
+          << net.name();
+  return move_net;
+}
+
+} // namespace caffe2
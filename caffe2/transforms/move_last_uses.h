@@ -0,0 +1,26 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Lets copy operators move their input into their output when the input is
+ * not used afterwards.
+ *
+ * Sets move_input on the Copy, EnsureCPUOutput, CopyFromCPUInput and
+ * CopyOnDeviceLike operators whose input is made by the net for them: it is
+ * neither an external input nor an external output, the first operator
+ * using it writes it without reading it, the operators before the copy only
+ * read it in place, i.e. while also writing it, and no operator after the
+ * copy uses it. The copy then swaps its input and output tensors instead of
+ * copying when both are on CPU, leaving the input with the previous buffer
+ * of the output.
+ *
+ * Returns net as is if it has control flow, whose nested nets read blobs the
+ * operators don't list.
+ */
+NetDef MoveLastUses(const NetDef& net);
+
+} // namespace caffe2
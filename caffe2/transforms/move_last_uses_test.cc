@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/transforms/move_last_uses.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool MovesInput(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<int>("move_input", 0) != 0;
+}
+
+TEST(MoveLastUsesTest, TestCopyOfIntermediate) {
+  NetDef netdef;
+  AddOp(&netdef, "Relu", {"X"}, {"H"});
+  AddOp(&netdef, "Sigmoid", {"H"}, {"H"});
+  AddOp(&netdef, "EnsureCPUOutput", {"H"}, {"Y"});
+  netdef.add_external_input("X");
+  netdef.add_external_output("Y");
+
+  NetDef move_netdef = MoveLastUses(netdef);
+  ASSERT_EQ(move_netdef.op_size(), 3);
+  EXPECT_TRUE(MovesInput(move_netdef.op(2)));
+}
+
+TEST(MoveLastUsesTest, TestUnsafeInputs) {
+  // Fed by the caller
+  NetDef fed;
+  AddOp(&fed, "Copy", {"X"}, {"Y"});
+  fed.add_external_input("X");
+  // Fetched by the caller
+  NetDef fetched;
+  AddOp(&fetched, "Relu", {"X"}, {"H"});
+  AddOp(&fetched, "Copy", {"H"}, {"Y"});
+  fetched.add_external_output("H");
+  // Read after the copy
+  NetDef read_after;
+  AddOp(&read_after, "Relu", {"X"}, {"H"});
+  AddOp(&read_after, "Copy", {"H"}, {"Y"});
+  AddOp(&read_after, "Sigmoid", {"H"}, {"Z"});
+  // Read by another operator which may run concurrently
+  NetDef read_before;
+  AddOp(&read_before, "Relu", {"X"}, {"H"});
+  AddOp(&read_before, "Sigmoid", {"H"}, {"Z"});
+  AddOp(&read_before, "Copy", {"H"}, {"Y"});
+  // Kept from the previous run
+  NetDef state;
+  AddOp(&state, "Sigmoid", {"H"}, {"H"});
+  AddOp(&state, "Copy", {"H"}, {"Y"});
+
+  for (const auto* netdef : {&fed, &fetched, &read_after, &read_before}) {
+    NetDef move_netdef = MoveLastUses(*netdef);
+    for (const auto& op : move_netdef.op()) {
+      EXPECT_FALSE(MovesInput(op)) << ProtoDebugString(move_netdef);
+    }
+  }
+  EXPECT_FALSE(MovesInput(MoveLastUses(state).op(1)));
+}
+
+TEST(MoveLastUsesTest, TestCopyMovesInput) {
+  Workspace ws;
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(4, 3);
+  const auto* data = X->mutable_data<float>();
+
+  NetDef netdef;
+  AddOp(&netdef, "Copy", {"X"}, {"Y"});
+  AddArgument<int>("move_input", 1, netdef.mutable_op(0));
+  // A tensor sharing the data of another one is still copied
+  ws.CreateBlob("S")->GetMutable<TensorCPU>()->ResizeLike(*X);
+  ws.GetBlob("S")->GetMutable<TensorCPU>()->ShareData(*X);
+  AddOp(&netdef, "Copy", {"S"}, {"T"});
+  AddArgument<int>("move_input", 1, netdef.mutable_op(1));
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+
+  const auto& Y = ws.GetBlob("Y")->Get<TensorCPU>();
+  EXPECT_EQ(Y.data<float>(), data);
+  EXPECT_EQ(Y.dims(), vector<TIndex>({4, 3}));
+  const auto& T = ws.GetBlob("T")->Get<TensorCPU>();
+  EXPECT_NE(T.data<float>(), data);
+  EXPECT_EQ(T.dims(), vector<TIndex>({4, 3}));
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -0,0 +1,26 @@
+#include "caffe2/transforms/optimize_for_inference.h"
+
+#include "caffe2/core/transform.h"
+#include "caffe2/transforms/constant_folding.h"
+#include "caffe2/transforms/dead_op_elimination.h"
+#include "caffe2/transforms/move_last_uses.h"
+#include "caffe2/transforms/tensor_views.h"
+
+namespace caffe2 {
+
+NetDef OptimizeForInference(
+    const NetDef& run_net,
+    const std::vector<std::string>& inputs,
+    NetDef* init_net) {
+  CAFFE_ENFORCE(init_net);
+  const std::vector<std::string> outputs(
+      run_net.external_output().begin(), run_net.external_output().end());
+  NetDef net = EliminateDeadOps(run_net, outputs);
+  net = ApplyTransform("CommonSubexpressionElimination", net);
+  net = FoldConstants(net, inputs, init_net);
+  net = EliminateDeadOps(net, outputs);
+  net = EnableTensorViews(net);
+  return MoveLastUses(net);
+}
+
+} // namespace caffe2
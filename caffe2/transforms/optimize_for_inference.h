@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Optimizes a pair of Predictor nets for inference.
+ *
+ * Runs, in order:
+ *  - EliminateDeadOps on the external outputs of run_net,
+ *  - CommonSubexpressionElimination,
+ *  - FoldConstants, moving the operators on constants into init_net,
+ *  - EliminateDeadOps again, for what the other passes left unused,
+ *  - EnableTensorViews, so Slice and Split share their input where safe,
+ *  - MoveLastUses, so copies of blobs used for the last time move them.
+ *
+ * inputs are the blobs fed before every run, as for FoldConstants. Returns
+ * the optimized run_net; init_net is updated in place.
+ */
+NetDef OptimizeForInference(
+    const NetDef& run_net,
+    const std::vector<std::string>& inputs,
+    NetDef* init_net);
+
+} // namespace caffe2
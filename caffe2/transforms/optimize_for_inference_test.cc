@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/transforms/optimize_for_inference.h"
+
+namespace caffe2 {
+
+namespace {
+
+TEST(OptimizeForInferenceTest, TestPipeline) {
+  NetDef init_netdef;
+  AddOp(&init_netdef, "GivenTensorFill", {}, {"W"});
+  AddOp(&init_netdef, "GivenTensorFill", {}, {"b"});
+
+  NetDef netdef;
+  netdef.add_external_input("X");
+  netdef.add_external_input("W");
+  netdef.add_external_input("b");
+  // Folded into the init net
+  AddOp(&netdef, "Transpose", {"W"}, {"Wt"});
+  AddOp(&netdef, "FC", {"X", "Wt", "b"}, {"fc"});
+  // Merged, since Add is commutative
+  AddOp(&netdef, "Add", {"fc", "X"}, {"sum1"});
+  AddOp(&netdef, "Add", {"X", "fc"}, {"sum2"});
+  AddOp(&netdef, "Relu", {"sum1"}, {"relu1"});
+  AddOp(&netdef, "Relu", {"sum2"}, {"relu2"});
+  AddOp(&netdef, "Sum", {"relu1", "relu2"}, {"Y"});
+  // Dead
+  AddOp(&netdef, "Sigmoid", {"fc"}, {"unused"});
+  netdef.add_external_output("Y");
+
+  NetDef optimized_netdef = OptimizeForInference(netdef, {"X"}, &init_netdef);
+  ASSERT_EQ(optimized_netdef.op_size(), 5);
+  EXPECT_EQ(optimized_netdef.op(0).type(), "FC");
+  EXPECT_EQ(optimized_netdef.op(1).type(), "Add");
+  EXPECT_EQ(optimized_netdef.op(4).type(), "Sum");
+  EXPECT_EQ(optimized_netdef.op(4).output(0), "Y");
+  ASSERT_EQ(init_netdef.op_size(), 3);
+  EXPECT_EQ(init_netdef.op(2).type(), "Transpose");
+}
+
+} // namespace
+
+} // namespace caffe2
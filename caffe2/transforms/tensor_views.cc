@@ -0,0 +1,81 @@
+#include "caffe2/transforms/tensor_views.h"
+
+#include <set>
+#include <string>
+
+#include "caffe2/core/logging.h"
+#include "caffe2/core/operator_schema.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool AcceptsTensorViews(const OperatorDef& op) {
+  const auto* schema = OpSchemaRegistry::Schema(op.type());
+  return schema && schema->accepts_tensor_views();
+}
+
+bool CanOutputViews(const NetDef& net, int idx) {
+  const auto& op = net.op(idx);
+  if (op.input_size() == 0) {
+    return false;
+  }
+  const auto& input = op.input(0);
+  const std::set<std::string> views(op.output().begin(), op.output().end());
+  if (views.count(input)) {
+    return false;
+  }
+  for (const auto& output : net.external_output()) {
+    if (views.count(output)) {
+      return false;
+    }
+  }
+  for (int i = 0; i < net.op_size(); ++i) {
+    if (i == idx) {
+      continue;
+    }
+    const auto& other = net.op(i);
+    for (const auto& output : other.output()) {
+      // Writing a view or, after the views are made, the input would write
+      // to the other tensors sharing the storage
+      if (views.count(output) || (i > idx && output == input)) {
+        return false;
+      }
+    }
+    for (const auto& other_input : other.input()) {
+      if (views.count(other_input) && !AcceptsTensorViews(other)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+NetDef EnableTensorViews(const NetDef& net) {
+  for (const auto& op : net.op()) {
+    for (const auto& arg : op.arg()) {
+      if (arg.has_n() || arg.nets_size() > 0) {
+        return net;
+      }
+    }
+  }
+
+  NetDef view_net = net;
+  int num_views = 0;
+  for (int i = 0; i < view_net.op_size(); ++i) {
+    auto* op = view_net.mutable_op(i);
+    if ((op->type() == "Slice" || op->type() == "Split") &&
+        CanOutputViews(view_net, i)) {
+      AddArgument<int>("output_views", 1, op);
+      ++num_views;
+    }
+  }
+  VLOG(1) << "Enabled output views for " << num_views << " operators of "
+          << net.name();
+  return view_net;
+}
+
+} // namespace caffe2
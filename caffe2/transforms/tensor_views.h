@@ -0,0 +1,24 @@
+#pragma once
+
+#include "caffe2/core/common.h"
+#include "caffe2/proto/caffe2.pb.h"
+
+namespace caffe2 {
+
+/**
+ * Lets Slice and Split output views of their input instead of copies.
+ *
+ * Sets output_views on the Slice and Split operators whose outputs are only
+ * read, and only by operators whose schema AcceptsTensorViews(), so that the
+ * outputs may share the storage of the input, see
+ * Tensor::ShareDataWithOffset(). An operator is skipped if any of its outputs
+ * is written by another operator or is an external output, or if a later
+ * operator writes its input.
+ *
+ * The operators still copy when their output isn't contiguous in the input,
+ * e.g. for slices of an inner dimension. Returns net as is if it has control
+ * flow, whose nested nets read blobs the operators don't list.
+ */
+NetDef EnableTensorViews(const NetDef& net);
+
+} // namespace caffe2
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "caffe2/core/graph.h"
+#include "caffe2/core/operator.h"
+#include "caffe2/core/workspace.h"
+#include "caffe2/transforms/tensor_views.h"
+#include "caffe2/utils/proto_utils.h"
+
+namespace caffe2 {
+
+namespace {
+
+bool OutputsViews(const OperatorDef& op) {
+  return ArgumentHelper(op).GetSingleArgument<int>("output_views", 0) != 0;
+}
+
+TEST(TensorViewsTest, TestSplitIntoTowers) {
+  NetDef netdef;
+  AddOp(&netdef, "Split", {"X"}, {"X0", "X1"});
+  AddOp(&netdef, "FC", {"X0", "W0", "b0"}, {"Y0"});
+  AddOp(&netdef, "FC", {"X1", "W1", "b1"}, {"Y1"});
+  AddOp(&netdef, "Concat", {"Y0", "Y1"}, {"Y", "Y_dims"});
+  netdef.add_external_output("Y");
+
+  NetDef view_netdef = EnableTensorViews(netdef);
+  ASSERT_EQ(view_netdef.op_size(), 4);
+  EXPECT_TRUE(OutputsViews(view_netdef.op(0)));
+  EXPECT_FALSE(OutputsViews(view_netdef.op(1)));
+}
+
+TEST(TensorViewsTest, TestUnsafeReaders) {
+  // Written in place
+  NetDef inplace;
+  AddOp(&inplace, "Split", {"X"}, {"X0", "X1"});
+  AddOp(&inplace, "Relu", {"X0"}, {"X0"});
+  // Shares its input with its output
+  NetDef reshape;
+  AddOp(&reshape, "Slice", {"X"}, {"S"});
+  AddOp(&reshape, "Reshape", {"S"}, {"S_reshaped", "S_shape"});
+  // Fetched by the caller
+  NetDef fetched;
+  AddOp(&fetched, "Slice", {"X"}, {"S"});
+  fetched.add_external_output("S");
+  // Input overwritten while the views are read
+  NetDef overwritten;
+  AddOp(&overwritten, "Split", {"X"}, {"X0", "X1"});
+  AddOp(&overwritten, "Sigmoid", {"Z"}, {"X"});
+  AddOp(&overwritten, "Relu", {"X0"}, {"Y"});
+
+  for (const auto* netdef : {&inplace, &reshape, &fetched, &overwritten}) {
+    NetDef view_netdef = EnableTensorViews(*netdef);
+    EXPECT_FALSE(OutputsViews(view_netdef.op(0)))
+        << ProtoDebugString(view_netdef);
+  }
+
+  // Writing the input before the views are made is fine
+  NetDef safe;
+  AddOp(&safe, "Sigmoid", {"Z"}, {"X"});
+  AddOp(&safe, "Slice", {"X"}, {"S"});
+  AddOp(&safe, "Relu", {"S"}, {"Y"});
+  EXPECT_TRUE(OutputsViews(EnableTensorViews(safe).op(1)));
+}
+
+const float* RawData(Workspace* ws, const std::string& name) {
+  return ws->GetBlob(name)->Get<TensorCPU>().data<float>();
+}
+
+TEST(TensorViewsTest, TestOutputsShareInput) {
+  Workspace ws;
+  auto* X = ws.CreateBlob("X")->GetMutable<TensorCPU>();
+  X->Resize(4, 3);
+  auto* data = X->mutable_data<float>();
+  for (int i = 0; i < X->size(); ++i) {
+    data[i] = i;
+  }
+
+  NetDef netdef;
+  netdef.set_name("views");
+  AddOp(&netdef, "Split", {"X"}, {"X0", "X1"})
+      ->add_arg()
+      ->CopyFrom(MakeArgument<int>("axis", 0));
+  auto* rows = AddOp(&netdef, "Slice", {"X"}, {"rows"});
+  rows->add_arg()->CopyFrom(MakeArgument<vector<int>>("starts", {1, 0}));
+  rows->add_arg()->CopyFrom(MakeArgument<vector<int>>("ends", {3, -1}));
+  auto* cols = AddOp(&netdef, "Slice", {"X"}, {"cols"});
+  cols->add_arg()->CopyFrom(MakeArgument<vector<int>>("starts", {0, 1}));
+  cols->add_arg()->CopyFrom(MakeArgument<vector<int>>("ends", {-1, 2}));
+  for (auto& op : *netdef.mutable_op()) {
+    AddArgument<int>("output_views", 1, &op);
+  }
+  ASSERT_TRUE(ws.RunNetOnce(netdef));
+
+  EXPECT_EQ(RawData(&ws, "X0"), data);
+  EXPECT_EQ(RawData(&ws, "X1"), data + 6);
+  EXPECT_EQ(ws.GetBlob("X1")->Get<TensorCPU>().dims(), vector<TIndex>({2, 3}));
+  EXPECT_EQ(RawData(&ws, "rows"), data + 3);
+  EXPECT_EQ(RawData(&ws, "rows")[5], 8);
+  // A column isn't contiguous, so it is copied
+  const auto& col = ws.GetBlob("cols")->Get<TensorCPU>();
+  EXPECT_EQ(col.dims(), vector<TIndex>({4, 1}));
+  EXPECT_EQ(col.data<float>()[3], 10);
+}
+
+} // namespace
+
+} // namespace caffe2
@@ -1,5 +1,9 @@
 #include "caffe2/utils/cpuid.h"
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
 namespace caffe2 {
 
 const CpuId& GetCpuId() {
@@ -7,6 +11,16 @@ const CpuId& GetCpuId() {
   return cpuid_singleton;
 }
 
+bool ArmHasDotProduct() {
+#if defined(__aarch64__) && defined(__linux__)
+  // HWCAP_ASIMDDP, missing from older headers
+  static const bool has_dot_product = (getauxval(AT_HWCAP) & (1 << 20)) != 0;
+  return has_dot_product;
+#else
+  return false;
+#endif
+}
+
 CAFFE2_API uint32_t CpuId::f1c_ = 0;
 CAFFE2_API uint32_t CpuId::f1d_ = 0;
 CAFFE2_API uint32_t CpuId::f7b_ = 0;
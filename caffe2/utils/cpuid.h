@@ -14,6 +14,12 @@ class CpuId;
 
 CAFFE2_API const CpuId& GetCpuId();
 
+/**
+ * Whether the CPU has the ARMv8.2 int8 dot product instructions, as told by
+ * the hardware capabilities of the kernel. Always false on other CPUs.
+ */
+CAFFE2_API bool ArmHasDotProduct();
+
 ///////////////////////////////////////////////////////////////////////////////
 // Implementation of CpuId that is borrowed from folly.
 ///////////////////////////////////////////////////////////////////////////////
@@ -129,6 +135,7 @@ class CpuId {
 #define E(name, bit) X(name, f7c_, bit)
   E(prefetchwt1, 0)
   E(avx512vbmi, 1)
+  E(avx512vnni, 11)
 #undef E
 
 #undef X
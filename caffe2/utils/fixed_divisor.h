@@ -108,6 +108,109 @@ class FixedDivisor<int32_t> {
   int shift_;
 };
 
+// Works for any positive divisor, 1 to INT64_MAX, and any dividend, negative
+// ones included, rounding the quotient towards zero like `/`. One 128-bit
+// multiplication and one 64-bit shift is used to calculate the result, where
+// the compiler has 128-bit integers, and a division otherwise.
+template <>
+class FixedDivisor<int64_t> {
+ public:
+  FixedDivisor(int64_t d) : d_(d) {
+    calcSignedMagic();
+  }
+
+  int64_t getMagic() const {
+    return magic_;
+  }
+
+  int getShift() const {
+    return shift_;
+  }
+
+  /// Calculates `q = n / d`.
+  inline int64_t div(int64_t n) const {
+#ifdef __SIZEOF_INT128__
+    if (d_ == 1) {
+      return n;
+    }
+    int64_t q = (int64_t) (((__int128) magic_ * n) >> 64);
+    if (magic_ < 0) {
+      // The magic value overflowed into the sign bit
+      q += n;
+    }
+    q >>= shift_;
+    // Round towards zero
+    return q + (int64_t) ((uint64_t) q >> 63);
+#else
+    return n / d_;
+#endif
+  }
+
+  /// Calculates `r = n % d`.
+  inline int64_t mod(int64_t n) const {
+    return n - d_ * div(n);
+  }
+
+  /// Calculates `q = n / d` and `r = n % d` together.
+  inline void divMod(int64_t n, int64_t& q, int64_t& r) const {
+    const int64_t quotient = div(n);
+    q = quotient;
+    r = n - d_ * quotient;
+  }
+
+ private:
+  /**
+     Calculates magic multiplicative value and shift amount for
+     calculating `q = n / d` for signed 64-bit integers.
+     Implementation taken from Hacker's Delight section 10.
+  */
+  void calcSignedMagic() {
+    if (d_ == 1) {
+      magic_ = 1;
+      shift_ = 0;
+      return;
+    }
+
+    const uint64_t two63 = UINT64_C(0x8000000000000000);
+    uint64_t ad = d_;
+    uint64_t anc = two63 - 1 - two63 % ad;  // Absolute value of nc.
+    uint64_t p = 63;                        // Init. p.
+    uint64_t q1 = two63 / anc;              // Init. q1 = 2**p/|nc|.
+    uint64_t r1 = two63 - q1 * anc;         // Init. r1 = rem(2**p, |nc|).
+    uint64_t q2 = two63 / ad;               // Init. q2 = 2**p/|d|.
+    uint64_t r2 = two63 - q2 * ad;          // Init. r2 = rem(2**p, |d|).
+    uint64_t delta = 0;
+
+    do {
+      p = p + 1;
+      q1 = 2 * q1;         // Update q1 = 2**p/|nc|.
+      r1 = 2 * r1;         // Update r1 = rem(2**p, |nc|).
+
+      if (r1 >= anc) {     // (Must be an unsigned
+        q1 = q1 + 1;       // comparison here).
+        r1 = r1 - anc;
+      }
+
+      q2 = 2 * q2;         // Update q2 = 2**p/|d|.
+      r2 = 2 * r2;         // Update r2 = rem(2**p, |d|).
+
+      if (r2 >= ad) {      // (Must be an unsigned
+        q2 = q2 + 1;       // comparison here).
+        r2 = r2 - ad;
+      }
+
+      delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    magic_ = (int64_t) (q2 + 1);
+    shift_ = p - 64;
+  }
+
+  int64_t d_;
+  int64_t magic_;
+  int shift_;
+};
+
 } // namespace caffe2
 
 #endif // CAFFE2_UTILS_FIXED_DIVISOR_H_
@@ -27,6 +27,23 @@ void compareDivMod(int32_t v, int32_t divisor) {
                              << " rem " << fixedR << " " << nativeR;
 }
 
+void compareDivMod64(int64_t v, int64_t divisor) {
+  auto fixed = FixedDivisor<int64_t>(divisor);
+
+  int64_t nativeQ = v / divisor;
+  int64_t nativeR = v % divisor;
+
+  int64_t fixedQ = fixed.div(v);
+  int64_t fixedR = fixed.mod(v);
+
+  EXPECT_EQ(fixedQ, nativeQ) << v << " / " << divisor
+                             << " magic " << fixed.getMagic()
+                             << " shift " << fixed.getShift();
+  EXPECT_EQ(fixedR, nativeR) << v << " % " << divisor
+                             << " magic " << fixed.getMagic()
+                             << " shift " << fixed.getShift();
+}
+
 }
 
 TEST(FixedDivisorTest, Test) {
@@ -76,4 +93,28 @@ TEST(FixedDivisorTest, Test) {
   }
 }
 
+TEST(FixedDivisorTest, Test64) {
+  constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+  constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+
+  for (int64_t divisor : {int64_t(1), int64_t(2), int64_t(3), int64_t(7),
+                          int64_t(100000), kMax - 1, kMax}) {
+    for (int64_t v : {kMin, kMin + 1, int64_t(-1), int64_t(0), int64_t(1),
+                      kMax - 1, kMax}) {
+      compareDivMod64(v, divisor);
+    }
+  }
+
+  // divide random values, negative ones included, by random positive values
+  std::random_device rd;
+  std::uniform_int_distribution<int64_t> vDist(kMin, kMax);
+  std::uniform_int_distribution<int64_t> qDist(1, kMax);
+  std::uniform_int_distribution<int64_t> qSmallDist(1, 1 << 20);
+  for (int i = 0; i < 10000; ++i) {
+    auto v = vDist(rd);
+    compareDivMod64(v, qDist(rd));
+    compareDivMod64(v, qSmallDist(rd));
+  }
+}
+
 }  // namespace caffe2
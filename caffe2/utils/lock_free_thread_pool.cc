@@ -0,0 +1,121 @@
+#include "caffe2/utils/lock_free_thread_pool.h"
+
+#include "caffe2/core/numa.h"
+#include "caffe2/core/static_tracepoint.h"
+
+namespace caffe2 {
+
+namespace {
+// Pool of the worker running on the current thread
+thread_local const LockFreeThreadPool* current_pool_ = nullptr;
+} // namespace
+
+constexpr std::size_t LockFreeThreadPool::kDefaultQueueCapacity;
+constexpr int LockFreeThreadPool::kDefaultSpinCount;
+
+LockFreeThreadPool::LockFreeThreadPool(
+    std::size_t pool_size,
+    int numa_node_id,
+    std::size_t queue_capacity,
+    int spin_count)
+    : tasks_(queue_capacity),
+      spin_count_(spin_count),
+      pending_(0),
+      idle_(0),
+      running_(true),
+      numa_node_id_(numa_node_id) {
+  CAFFE_ENFORCE_GT(pool_size, 0, "Empty lock-free thread pool");
+  threads_.reserve(pool_size);
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    threads_.emplace_back(&LockFreeThreadPool::main_loop, this, i);
+  }
+}
+
+LockFreeThreadPool::~LockFreeThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    running_ = false;
+    sleep_cv_.notify_all();
+  }
+
+  try {
+    for (auto& t : threads_) {
+      t.join();
+    }
+  } catch (const std::exception&) {
+  }
+}
+
+bool LockFreeThreadPool::inThreadPool() const {
+  return current_pool_ == this;
+}
+
+void LockFreeThreadPool::run(const std::function<void()>& func) {
+  while (!tasks_.tryPush(func)) {
+    if (inThreadPool()) {
+      // Waiting for space could deadlock when all of the workers are
+      // submitting tasks
+      try {
+        func();
+      } catch (const std::exception&) {
+      }
+      return;
+    }
+    std::this_thread::yield();
+  }
+  CAFFE_SDT(task_enqueue, (void*)this, 0);
+  ++pending_;
+  // Workers increment idle_ under sleep_mutex_ before checking pending_, so
+  // either the worker sees the new task or we see the parked worker
+  if (idle_ > 0) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.notify_one();
+  }
+}
+
+bool LockFreeThreadPool::tryRunTask() {
+  std::function<void()> task;
+  if (!tasks_.tryPop(&task)) {
+    return false;
+  }
+  CAFFE_SDT(task_dequeue, (void*)this, 0);
+  --pending_;
+  try {
+    task();
+  } catch (const std::exception&) {
+  }
+  return true;
+}
+
+void LockFreeThreadPool::main_loop(std::size_t /* unused */) {
+  NUMABind(numa_node_id_);
+  current_pool_ = this;
+
+  while (running_) {
+    if (tryRunTask()) {
+      continue;
+    }
+
+    bool found = false;
+    for (int i = 0; i < spin_count_ && running_; ++i) {
+      if (pending_ > 0 && tryRunTask()) {
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    ++idle_;
+    // pending_ may briefly be negative when a task is taken before the
+    // submitter has accounted for it
+    while (pending_ <= 0 && running_) {
+      sleep_cv_.wait(lock);
+    }
+    --idle_;
+  }
+}
+
+} // namespace caffe2
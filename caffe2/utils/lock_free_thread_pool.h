@@ -0,0 +1,68 @@
+#ifndef CAFFE2_UTILS_LOCK_FREE_THREAD_POOL_H_
+#define CAFFE2_UTILS_LOCK_FREE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/utils/mpmc_queue.h"
+#include "caffe2/utils/thread_pool.h"
+
+namespace caffe2 {
+
+/**
+ * A thread pool sharing a single bounded lock-free task queue (MPMCQueue).
+ * Submitting a task does not take a lock unless a worker is parked; idle
+ * workers spin on the queue for a while before parking on a condition
+ * variable, so that bursts of small tasks do not go through futex calls.
+ * When the queue is full, submitters from outside of the pool wait for free
+ * space, while tasks submitted from a worker are run inline.
+ */
+class LockFreeThreadPool : public TaskThreadPoolBase {
+ public:
+  static constexpr std::size_t kDefaultQueueCapacity = 4096;
+  static constexpr int kDefaultSpinCount = 2000;
+
+  explicit LockFreeThreadPool(
+      std::size_t pool_size,
+      int numa_node_id = -1,
+      std::size_t queue_capacity = kDefaultQueueCapacity,
+      int spin_count = kDefaultSpinCount);
+  ~LockFreeThreadPool() override;
+
+  void run(const std::function<void()>& func) override;
+
+  std::size_t size() const override {
+    return threads_.size();
+  }
+
+  // Whether the calling thread is one of the workers of this pool
+  bool inThreadPool() const;
+
+ private:
+  void main_loop(std::size_t index);
+  bool tryRunTask();
+
+  MPMCQueue<std::function<void()>> tasks_;
+  std::vector<std::thread> threads_;
+  const int spin_count_;
+
+  // Number of tasks pushed and not yet taken by a worker, and number of
+  // workers parked on sleep_cv_
+  std::atomic<int> pending_;
+  std::atomic<int> idle_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic<bool> running_;
+  int numa_node_id_;
+
+  DISABLE_COPY_AND_ASSIGN(LockFreeThreadPool);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_LOCK_FREE_THREAD_POOL_H_
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caffe2/utils/lock_free_thread_pool.h"
+#include "caffe2/utils/mpmc_queue.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+void WaitForCount(
+    std::mutex& mutex,
+    std::condition_variable& cv,
+    const std::atomic<int>& count,
+    int expected) {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&]() { return count == expected; });
+}
+
+} // namespace
+
+TEST(MPMCQueueTest, BoundedFIFO) {
+  MPMCQueue<int> queue(3);
+  EXPECT_EQ(4, queue.capacity());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.tryPush(i));
+  }
+  EXPECT_FALSE(queue.tryPush(4));
+  int value;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.tryPop(&value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(queue.tryPop(&value));
+}
+
+TEST(MPMCQueueTest, ConcurrentProducersAndConsumers) {
+  MPMCQueue<int> queue(64);
+  const int kNumThreads = 4;
+  const int kNumItems = 10000;
+  std::atomic<long> sum(0);
+  std::atomic<int> popped(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 1; i <= kNumItems; ++i) {
+        while (!queue.tryPush(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    threads.emplace_back([&]() {
+      int value;
+      while (popped < kNumThreads * kNumItems) {
+        if (queue.tryPop(&value)) {
+          sum += value;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(sum, (long)kNumThreads * kNumItems * (kNumItems + 1) / 2);
+}
+
+TEST(LockFreeThreadPoolTest, RunsAllTasks) {
+  LockFreeThreadPool pool(4);
+  EXPECT_EQ(4, pool.size());
+  EXPECT_FALSE(pool.inThreadPool());
+
+  const int kNumTasks = 1000;
+  std::atomic<int> count(0);
+  std::mutex mutex;
+  std::condition_variable cv;
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.run([&]() {
+      if (++count == kNumTasks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    });
+  }
+  WaitForCount(mutex, cv, count, kNumTasks);
+}
+
+TEST(LockFreeThreadPoolTest, FullQueueFromWorkerRunsInline) {
+  // Tiny queue without spinning, so that nested submissions overflow it
+  // and parked workers are woken up
+  LockFreeThreadPool pool(2, -1, 2, 0);
+
+  const int kNumOuter = 10;
+  const int kNumInner = 10;
+  const int kNumTasks = kNumOuter * (kNumInner + 1);
+  std::atomic<int> count(0);
+  std::mutex mutex;
+  std::condition_variable cv;
+  auto done = [&]() {
+    if (++count == kNumTasks) {
+      std::lock_guard<std::mutex> lock(mutex);
+      cv.notify_all();
+    }
+  };
+  for (int i = 0; i < kNumOuter; ++i) {
+    pool.run([&]() {
+      for (int j = 0; j < kNumInner; ++j) {
+        pool.run(done);
+      }
+      done();
+    });
+  }
+  WaitForCount(mutex, cv, count, kNumTasks);
+}
+
+} // namespace caffe2
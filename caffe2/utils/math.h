@@ -131,6 +131,38 @@ CAFFE2_DECLARE_BINARY_OP(Div);
 
 #undef CAFFE2_DECLARE_BINARY_OP
 
+// C = A op B with numpy style broadcasting: A_dims and B_dims have ndim dims
+// each, which are either equal or 1, and C has the larger of each pair. The
+// CPU versions coalesce adjacent dims that broadcast alike, so that the inner
+// loop runs over the longest contiguous run, vectorized for float
+// arithmetic, and split large outputs between the threads of the thread
+// pool of the context, if any. C can be A or B when it has the same shape.
+#define CAFFE2_DECLARE_BROADCAST_BINARY_OP(name, TOut) \
+  template <typename T, class Context>                \
+  void Broadcast##name(                               \
+      const int ndim,                                 \
+      const int* A_dims,                              \
+      const int* B_dims,                              \
+      const T* A,                                     \
+      const T* B,                                     \
+      TOut* C,                                        \
+      Context* context);
+
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Add, T);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Sub, T);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Mul, T);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Div, T);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(EQ, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(LT, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(LE, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(GT, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(GE, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(And, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Or, bool);
+CAFFE2_DECLARE_BROADCAST_BINARY_OP(Xor, bool);
+
+#undef CAFFE2_DECLARE_BROADCAST_BINARY_OP
+
 template <typename T, class Context>
 void ReduceMin(
     const int N,
@@ -341,6 +373,12 @@ void Axpby(
     T* y,
     Context* context);
 
+// In NCHW order, im_shape is C, d_1, ..., d_N and col_shape is C * kernel
+// size, o_1, ..., o_N. In NHWC order, which only has CPU implementations,
+// im_shape is d_1, ..., d_N, C and col_shape is o_1, ..., o_N, kernel size *
+// C, so that the column buffer is the matrix the NHWC convolution Gemm reads.
+// On CPU, Im2col and Col2im split their work between the threads of the
+// thread pool of the context, if any.
 template <typename T, class Context, int order>
 void Im2colNd(
     const T* data_img,
@@ -15,6 +15,7 @@
 #include <atomic>
 #include <chrono>
 #include <cstring>
+#include <functional>
 #include <numeric>
 #include <random>
 #include <unordered_set>
@@ -23,6 +24,9 @@
 #include "caffe2/utils/math.h"
 #include "caffe2/utils/cpu_neon.h"
 #include "caffe2/core/context.h"
+#include "caffe2/perfkernels/math.h"
+#include "caffe2/perfkernels/packed_gemm.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 #include "Eigen/Core"
 #include "Eigen/Dense"
 
@@ -41,6 +45,48 @@
 namespace caffe2 {
 namespace math {
 
+namespace {
+
+// GemmBatched, Im2col, Col2im and the broadcasting binary ops split their
+// work in ranges of at least this many multiply-adds, or elements of the
+// column buffer or output.
+constexpr TIndex kParallelMinRangeSize = 16384;
+
+// Runs fn(begin, end) on ranges splitting [0, n) between the threads of the
+// thread pool of context, for a total work of size elements.
+// Without thread pool, or for small sizes, fn(0, n) runs on the calling
+// thread.
+void ParallelRanges(
+    const int n,
+    const TIndex size,
+    CPUContext* context,
+    const std::function<void(int, int)>& fn) {
+  ThreadPool* pool = context ? context->thread_pool() : nullptr;
+  TIndex num_ranges = 1;
+  if (pool) {
+    num_ranges = pool->getNumThreads();
+    if (context->max_threads() > 0) {
+      num_ranges = std::min<TIndex>(num_ranges, context->max_threads());
+    }
+    num_ranges = std::min<TIndex>(
+        std::min<TIndex>(num_ranges, n),
+        std::max<TIndex>(1, size / kParallelMinRangeSize));
+  }
+  if (num_ranges <= 1) {
+    fn(0, n);
+    return;
+  }
+  pool->runRanges(num_ranges, [&](size_t range) {
+    fn(range * n / num_ranges, (range + 1) * n / num_ranges);
+  });
+}
+
+// Largest M, N and K of the matrices GemmBatched multiplies with PackedGemm
+// instead of the BLAS, when it does not have a batched GEMM.
+constexpr int kSmallGemmMaxDim = 128;
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // BLAS alternatives.
 // Depending on whether we have specified an external BLAS library or not, we
@@ -457,21 +503,57 @@ void GemmBatched<float, CPUContext>(
       1,
       &batch_size);
 #else // CAFFE2_USE_MKL
-  // loop over matrices in the batch
-  for (int i = 0; i < batch_size; ++i) {
-    math::Gemm<float, CPUContext>(
-        TransA,
-        TransB,
-        M,
-        N,
-        K,
-        alpha,
-        A + a_stride * i,
-        B + b_stride * i,
-        beta,
-        C + c_stride * i,
-        context);
+  if (std::max(M, std::max(N, K)) > kSmallGemmMaxDim) {
+    // loop over matrices in the batch
+    for (int i = 0; i < batch_size; ++i) {
+      math::Gemm<float, CPUContext>(
+          TransA,
+          TransB,
+          M,
+          N,
+          K,
+          alpha,
+          A + a_stride * i,
+          B + b_stride * i,
+          beta,
+          C + c_stride * i,
+          context);
+    }
+    return;
   }
+  // Small matrices are too small for the BLAS to amortize its call overhead.
+  // They go to the PackedGemm microkernels instead, with the matrices of the
+  // batch split between the threads of the context.
+  const TIndex work = static_cast<TIndex>(batch_size) * M * N * K;
+  ParallelRanges(batch_size, work, context, [&](int begin, int end) {
+    std::vector<float> packed(PackedMatrixSize(N, K));
+    std::vector<float> a_buffer;
+    std::vector<float> c_buffer;
+    for (int i = begin; i < end; ++i) {
+      const float* a = A + a_stride * i;
+      if (TransA == CblasTrans) {
+        a_buffer.resize(a_stride);
+        EigenMatrixMap<float>(a_buffer.data(), K, M) =
+            ConstEigenMatrixMap<float>(a, M, K).transpose();
+        a = a_buffer.data();
+      }
+      PackMatrix(TransB == CblasTrans, N, K, B + b_stride * i, packed.data());
+      float* c = C + c_stride * i;
+      if (alpha == 1 && beta == 0) {
+        PackedGemm(M, N, K, a, packed.data(), nullptr, c);
+        continue;
+      }
+      c_buffer.resize(c_stride);
+      PackedGemm(M, N, K, a, packed.data(), nullptr, c_buffer.data());
+      EigenVectorMap<float> c_vec(c, c_stride);
+      if (beta == 0) {
+        c_vec = ConstEigenVectorMap<float>(c_buffer.data(), c_stride) * alpha;
+      } else {
+        c_vec = c_vec * beta +
+            ConstEigenVectorMap<float>(c_buffer.data(), c_stride) * alpha;
+      }
+    }
+  });
 #endif
 }
 
@@ -558,16 +640,25 @@ DELEGATE_SIMPLE_BINARY_FUNCTION(double, Div, vdDiv)
   void Funcname<T, CPUContext>(const int N, const T* x, T* y, CPUContext*) { \
     EigenVectorMap<T>(y, N) = ConstEigenVectorMap<T>(x, N).array().expr();   \
   }
-DELEGATE_SIMPLE_UNARY_FUNCTION(float, Exp, exp)
-DELEGATE_SIMPLE_UNARY_FUNCTION(float, Log, log)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Cos, cos)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Sin, sin)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Abs, abs)
-DELEGATE_SIMPLE_UNARY_FUNCTION(float, Sqrt, sqrt)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, InvSqrt, rsqrt)
 DELEGATE_SIMPLE_UNARY_FUNCTION(float, Sqr, square)
 #undef DELEGATE_SIMPLE_UNARY_FUNCTION
 
+// Runtime dispatched to the AVX2 / AVX512 perfkernels
+#define PERFKERNEL_SIMPLE_UNARY_FUNCTION(Funcname)          \
+  template <>                                               \
+  void Funcname<float, CPUContext>(                         \
+      const int N, const float* x, float* y, CPUContext*) { \
+    Vectorized##Funcname(N, x, y);                          \
+  }
+PERFKERNEL_SIMPLE_UNARY_FUNCTION(Exp)
+PERFKERNEL_SIMPLE_UNARY_FUNCTION(Log)
+PERFKERNEL_SIMPLE_UNARY_FUNCTION(Sqrt)
+#undef PERFKERNEL_SIMPLE_UNARY_FUNCTION
+
 #define DELEGATE_SINCOS_FUNCTION(T)                                        \
   template <>                                                              \
   void SinCos<T, CPUContext>(                                              \
@@ -579,13 +670,15 @@ DELEGATE_SINCOS_FUNCTION(float)
 DELEGATE_SINCOS_FUNCTION(double)
 #undef DELEGATE_SINCOS_FUNCTION
 
-#define DELEGATE_POWX_FUNCTION(T)                                             \
-  template <>                                                                 \
-  void Powx<T, CPUContext>(const int N, const T* a, T b, T* y, CPUContext*) { \
-    EigenVectorMap<T>(y, N) = ConstEigenVectorMap<T>(a, N).array().pow(b);    \
-  }
-DELEGATE_POWX_FUNCTION(float)
-#undef DELEGATE_POWX_FUNCTION
+template <>
+void Powx<float, CPUContext>(
+    const int N,
+    const float* a,
+    float b,
+    float* y,
+    CPUContext*) {
+  VectorizedPowx(N, a, b, y);
+}
 
 #endif  // CAFFE2_USE_MKL
 
@@ -609,10 +702,23 @@ EIGEN_SIMPLE_BINARY_FUNCTION(int64_t, Funcname, expr)
 #else
 
 #define DEFINE_SIMPLE_BINARY_FUNCTION(Funcname, expr)                          \
-EIGEN_SIMPLE_BINARY_FUNCTION(float, Funcname, expr)                            \
 EIGEN_SIMPLE_BINARY_FUNCTION(int32_t, Funcname, expr)                          \
 EIGEN_SIMPLE_BINARY_FUNCTION(int64_t, Funcname, expr)
 
+// Runtime dispatched to the AVX2 / AVX512 perfkernels
+#define PERFKERNEL_SIMPLE_BINARY_FUNCTION(Funcname)                            \
+template <>                                                                    \
+void Funcname<float, CPUContext>(                                              \
+    const int N, const float* a, const float* b, float* y,                     \
+    CPUContext*) {                                                             \
+  Vectorized##Funcname(N, a, b, y);                                            \
+}
+PERFKERNEL_SIMPLE_BINARY_FUNCTION(Add)
+PERFKERNEL_SIMPLE_BINARY_FUNCTION(Mul)
+#undef PERFKERNEL_SIMPLE_BINARY_FUNCTION
+EIGEN_SIMPLE_BINARY_FUNCTION(float, Sub, -)
+EIGEN_SIMPLE_BINARY_FUNCTION(float, Div, /)
+
 #endif
 
 DEFINE_SIMPLE_BINARY_FUNCTION(Add, +)
@@ -659,15 +765,15 @@ CAFFE2_SPECIALIZED_REDUCEMAX(int64_t)
 
 #undef CAFFE2_SPECIALIZED_REDUCEMAX
 
-#define CAFFE2_SPECIALIZED_ROWWISEMAX(T)                         \
-  template <>                                                    \
-  void RowwiseMax<T, CPUContext>(                                \
-      const int N, const int D, const T* x, T* y, CPUContext*) { \
-    EigenVectorMap<T>(y, N) =                                    \
-        ConstEigenMatrixMap<T>(x, D, N).colwise().maxCoeff();    \
-  }
-CAFFE2_SPECIALIZED_ROWWISEMAX(float)
-#undef CAFFE2_SPECIALIZED_ROWWISEMAX
+template <>
+void RowwiseMax<float, CPUContext>(
+    const int N,
+    const int D,
+    const float* x,
+    float* y,
+    CPUContext*) {
+  VectorizedRowwiseMax(N, D, x, y);
+}
 
 #define CAFFE2_SPECIALIZED_COLWISEMAX(T)                         \
   template <>                                                    \
@@ -726,14 +832,44 @@ CAFFE2_SPECIALIZED_MAXIMUM(float)
 
 #define DEFINE_BROADCAST_BINARY_FUNCTION(name, op)                       \
   DELEGATE_BROADCAST_BINARY_FUNCTION(int32_t, name, op)                  \
-  DELEGATE_BROADCAST_BINARY_FUNCTION(int64_t, name, op)                  \
-  DELEGATE_BROADCAST_BINARY_FUNCTION(float, name, op)                    \
+  DELEGATE_BROADCAST_BINARY_FUNCTION(int64_t, name, op)
 
 DEFINE_BROADCAST_BINARY_FUNCTION(Add, +)
 DEFINE_BROADCAST_BINARY_FUNCTION(Sub, -)
 DEFINE_BROADCAST_BINARY_FUNCTION(Mul, *)
 DEFINE_BROADCAST_BINARY_FUNCTION(Div, /)
 
+// Float row broadcasts of Add and Mul are runtime dispatched to the AVX2 /
+// AVX512 perfkernels, which also handle the inplace case of y = a.
+#define PERFKERNEL_BROADCAST_BINARY_FUNCTION(Funcname, expr)             \
+  template <>                                                            \
+  void Funcname##ToRow<float, CPUContext>(                               \
+      const int M,                                                       \
+      const int N,                                                       \
+      const float* a,                                                    \
+      const float* b,                                                    \
+      float* y,                                                          \
+      CPUContext*) {                                                     \
+    Vectorized##Funcname##ToRow(M, N, a, b, y);                          \
+  }                                                                      \
+  template <>                                                            \
+  void Funcname##ToRow<float, CPUContext>(                               \
+      const int M, const int N, const float* x, float* y, CPUContext*) { \
+    Vectorized##Funcname##ToRow(M, N, y, x, y);                          \
+  }                                                                      \
+  template <>                                                            \
+  void Funcname##ToCol<float, CPUContext>(                               \
+      const int M, const int N, const float* x, float* y, CPUContext*) { \
+    EigenArrayMap<float>(y, N, M).rowwise() expr## =                     \
+        ConstEigenVectorArrayMap<float>(x, M).transpose();               \
+  }
+
+PERFKERNEL_BROADCAST_BINARY_FUNCTION(Add, +)
+DELEGATE_BROADCAST_BINARY_FUNCTION(float, Sub, -)
+PERFKERNEL_BROADCAST_BINARY_FUNCTION(Mul, *)
+DELEGATE_BROADCAST_BINARY_FUNCTION(float, Div, /)
+
+#undef PERFKERNEL_BROADCAST_BINARY_FUNCTION
 #undef DEFINE_BROADCAST_BINARY_FUNCTION
 #undef DELEGATE_BROADCAST_BINARY_FUNCTION
 
@@ -909,12 +1045,21 @@ void RandGaussian<float, CPUContext>(
     *y = ConstEigenVectorMap<T>(x, N).sum(); \
   }
 
-CAFFE2_SPECIALIZED_SUM(float);
 CAFFE2_SPECIALIZED_SUM(int32_t);
 CAFFE2_SPECIALIZED_SUM(int64_t);
 
 #undef CAFFE2_SPECIALIZED_SUM
 
+template <>
+void Sum<float, CPUContext>(
+    const int N,
+    const float* x,
+    float* y,
+    CPUContext* /* unused */,
+    Tensor<CPUContext>* /* unused */) {
+  *y = VectorizedSum(N, x);
+}
+
 template <>
 void SumSqr<float, CPUContext>(
     const int N,
@@ -922,7 +1067,7 @@ void SumSqr<float, CPUContext>(
     float* y,
     CPUContext* /*context*/ /* unused */,
     Tensor<CPUContext>* /*scratch_ptr*/ /* unused */) {
-  *y = ConstEigenVectorMap<float>(x, N).squaredNorm();
+  *y = VectorizedSumSqr(N, x);
 }
 
 template <>
@@ -938,6 +1083,7 @@ void Select<float, CPUContext>(
     y[i] = x[i * D + idx[i]];
   }
 }
+
 // Ported from caffe 1.
 template <>
 void Im2colNd<float, CPUContext, StorageOrder::NCHW>(
@@ -952,69 +1098,208 @@ void Im2colNd<float, CPUContext, StorageOrder::NCHW>(
     const int* pad,
     const int N,
     float* data_col,
-    CPUContext* /* context */,
+    CPUContext* context,
     bool accumulate_output) {
   int kernel_size = 1;
   for (int i = 0; i < N; ++i) {
     kernel_size *= kernel_shape[i];
   }
   const int channels_col = col_shape[0];
-  vector<int> d_offset(N, 0);
-  vector<int> d_iter(N, 0);
-  for (int c_col = 0; c_col < channels_col; ++c_col) {
-    // Loop over spatial axes in reverse order to compute a per-axis offset.
-    int offset = c_col;
-    for (int d_i = N - 1; d_i >= 0; --d_i) {
-      if (d_i < N - 1) {
-        offset /= kernel_shape[d_i + 1];
-      }
-      d_offset[d_i] = offset % kernel_shape[d_i];
-    }
-    for (bool incremented = true; incremented;) {
-      // Loop over spatial axes in forward order to compute the indices in the
-      // image and column, and whether the index lies in the padding.
-      int index_col = c_col;
-      int index_im = c_col / kernel_size;
-      bool is_padding = false;
-      for (int d_i = 0; d_i < N; ++d_i) {
-        const int d = d_iter[d_i];
-        const int d_im =
-            d * stride[d_i] - pad[d_i] + d_offset[d_i] * dilation[d_i];
-        is_padding |= d_im < 0 || d_im >= im_shape[d_i + 1];
-        index_col *= col_shape[d_i + 1];
-        index_col += d;
-        index_im *= im_shape[d_i + 1];
-        index_im += d_im;
+  TIndex col_size = channels_col;
+  for (int i = 0; i < N; ++i) {
+    col_size *= col_shape[i + 1];
+  }
+  // The columns of an image channel only read, or for col2im only add to,
+  // the plane of that channel, so the channels are split between threads.
+  ParallelRanges(
+      channels_col / kernel_size,
+      col_size,
+      context,
+      [&](const int c_begin, const int c_end) {
+        vector<int> d_offset(N, 0);
+        vector<int> d_iter(N, 0);
+        for (int c_col = c_begin * kernel_size; c_col < c_end * kernel_size;
+             ++c_col) {
+          // Loop over spatial axes in reverse order to compute a per-axis
+          // offset.
+          int offset = c_col;
+          for (int d_i = N - 1; d_i >= 0; --d_i) {
+            if (d_i < N - 1) {
+              offset /= kernel_shape[d_i + 1];
+            }
+            d_offset[d_i] = offset % kernel_shape[d_i];
+          }
+          for (bool incremented = true; incremented;) {
+            // Loop over spatial axes in forward order to compute the indices
+            // in the image and column, and whether the index lies in the
+            // padding.
+            int index_col = c_col;
+            int index_im = c_col / kernel_size;
+            bool is_padding = false;
+            for (int d_i = 0; d_i < N; ++d_i) {
+              const int d = d_iter[d_i];
+              const int d_im =
+                  d * stride[d_i] - pad[d_i] + d_offset[d_i] * dilation[d_i];
+              is_padding |= d_im < 0 || d_im >= im_shape[d_i + 1];
+              index_col *= col_shape[d_i + 1];
+              index_col += d;
+              index_im *= im_shape[d_i + 1];
+              index_im += d_im;
+            }
+            if (!accumulate_output) {
+              if (is_padding) {
+                data_col[index_col] = 0;
+              } else {
+                data_col[index_col] = data_img[index_im];
+              }
+            } else if (!is_padding) { // col2im
+              data_col[index_im] += data_img[index_col];
+            }
+            // Loop over spatial axes in reverse order to choose an index,
+            // like counting.
+            incremented = false;
+            for (int d_i = N - 1; d_i >= 0; --d_i) {
+              const int d_max = col_shape[d_i + 1];
+              DCHECK_LT(d_iter[d_i], d_max);
+              if (d_iter[d_i] == d_max - 1) {
+                d_iter[d_i] = 0;
+              } else { // d_iter[d_i] < d_max - 1
+                ++d_iter[d_i];
+                incremented = true;
+                break;
+              }
+            }
+          } // while(incremented) {
+        } // for (int c = 0; c < channels_col; ++c) {
+      });
+}
+
+template <>
+void Col2imNd<float, CPUContext, StorageOrder::NCHW>(
+    const float* data_col,
+    const int* img_shape,
+    const int* col_shape,
+    const int img_size,
+    const int col_size,
+    const int* kernel_shape,
+    const int* stride,
+    const int* dilation,
+    const int* pad,
+    const int N,
+    float* data_img,
+    CPUContext* context) {
+  Set<float, CPUContext>(img_size, 0, data_img, context);
+  Im2colNd<float, CPUContext, StorageOrder::NCHW>(
+      data_col,
+      img_shape,
+      col_shape,
+      img_size,
+      col_size,
+      kernel_shape,
+      stride,
+      dilation,
+      pad,
+      N,
+      data_img,
+      context,
+      true);
+}
+
+// The columns of an output position are the channels of each kernel
+// position, which is the row of the column matrix the NHWC Gemm reads.
+template <>
+void Im2colNd<float, CPUContext, StorageOrder::NHWC>(
+    const float* data_img,
+    const int* im_shape,
+    const int* col_shape,
+    const int /* img_size*/,
+    const int /* col_size*/,
+    const int* kernel_shape,
+    const int* stride,
+    const int* dilation,
+    const int* pad,
+    const int N,
+    float* data_col,
+    CPUContext* context,
+    bool accumulate_output) {
+  const int channels = im_shape[N];
+  int kernel_size = 1;
+  int output_size = 1;
+  for (int i = 0; i < N; ++i) {
+    kernel_size *= kernel_shape[i];
+    output_size *= col_shape[i];
+  }
+  const TIndex col_size =
+      static_cast<TIndex>(output_size) * kernel_size * channels;
+  // Copies, or for col2im adds, channels [c_begin, c_end) of the windows of
+  // output positions [index_begin, index_end).
+  const auto run = [&](const int index_begin,
+                       const int index_end,
+                       const int c_begin,
+                       const int c_end) {
+    vector<int> d_out(N, 0);
+    vector<int> d_k(N, 0);
+    for (int index = index_begin; index < index_end; ++index) {
+      int rest = index;
+      for (int d_i = N - 1; d_i >= 0; --d_i) {
+        d_out[d_i] = rest % col_shape[d_i];
+        rest /= col_shape[d_i];
       }
-      if (!accumulate_output) {
-        if (is_padding) {
-          data_col[index_col] = 0;
-        } else {
-          data_col[index_col] = data_img[index_im];
+      for (int k = 0; k < kernel_size; ++k) {
+        rest = k;
+        for (int d_i = N - 1; d_i >= 0; --d_i) {
+          d_k[d_i] = rest % kernel_shape[d_i];
+          rest /= kernel_shape[d_i];
         }
-      } else if (!is_padding) { // col2im
-        data_col[index_im] += data_img[index_col];
-      }
-      // Loop over spatial axes in reverse order to choose an index,
-      // like counting.
-      incremented = false;
-      for (int d_i = N - 1; d_i >= 0; --d_i) {
-        const int d_max = col_shape[d_i + 1];
-        DCHECK_LT(d_iter[d_i], d_max);
-        if (d_iter[d_i] == d_max - 1) {
-          d_iter[d_i] = 0;
-        } else { // d_iter[d_i] < d_max - 1
-          ++d_iter[d_i];
-          incremented = true;
-          break;
+        TIndex index_im = 0;
+        bool is_padding = false;
+        for (int d_i = 0; d_i < N; ++d_i) {
+          const int d_im =
+              d_out[d_i] * stride[d_i] - pad[d_i] + d_k[d_i] * dilation[d_i];
+          is_padding |= d_im < 0 || d_im >= im_shape[d_i];
+          index_im = index_im * im_shape[d_i] + d_im;
+        }
+        const TIndex index_col =
+            (static_cast<TIndex>(index) * kernel_size + k) * channels +
+            c_begin;
+        index_im = index_im * channels + c_begin;
+        if (!accumulate_output) {
+          if (is_padding) {
+            memset(data_col + index_col, 0, sizeof(float) * (c_end - c_begin));
+          } else {
+            memcpy(
+                data_col + index_col,
+                data_img + index_im,
+                sizeof(float) * (c_end - c_begin));
+          }
+        } else if (!is_padding) { // col2im
+          Add<float, CPUContext>(
+              c_end - c_begin,
+              data_col + index_im,
+              data_img + index_col,
+              data_col + index_im,
+              context);
         }
       }
-    } // while(incremented) {
-  } // for (int c = 0; c < channels_col; ++c) {
+    }
+  };
+  // The windows of output positions overlap in the image, so col2im splits
+  // the channels between threads instead of the output positions.
+  if (!accumulate_output) {
+    ParallelRanges(
+        output_size, col_size, context, [&](const int begin, const int end) {
+          run(begin, end, 0, channels);
+        });
+  } else {
+    ParallelRanges(
+        channels, col_size, context, [&](const int begin, const int end) {
+          run(0, output_size, begin, end);
+        });
+  }
 }
 
 template <>
-void Col2imNd<float, CPUContext, StorageOrder::NCHW>(
+void Col2imNd<float, CPUContext, StorageOrder::NHWC>(
     const float* data_col,
     const int* img_shape,
     const int* col_shape,
@@ -1028,7 +1313,7 @@ void Col2imNd<float, CPUContext, StorageOrder::NCHW>(
     float* data_img,
     CPUContext* context) {
   Set<float, CPUContext>(img_size, 0, data_img, context);
-  Im2colNd<float, CPUContext, StorageOrder::NCHW>(
+  Im2colNd<float, CPUContext, StorageOrder::NHWC>(
       data_col,
       img_shape,
       col_shape,
@@ -1061,44 +1346,56 @@ void Im2col<float, CPUContext, StorageOrder::NCHW>(
     const int stride_h,
     const int stride_w,
     float* data_col,
-    CPUContext* /*context*/) {
+    CPUContext* context) {
   const int output_h =
       (height + pad_b + pad_t - (dilation_h * (kernel_h - 1) + 1)) / stride_h +
       1;
   const int output_w =
       (width + pad_l + pad_r - (dilation_w * (kernel_w - 1) + 1)) / stride_w +
       1;
+  // The columns of each channel are a contiguous block of the column
+  // buffer, so the channels are split between threads.
+  const TIndex channel_size = height * width;
+  const TIndex channel_col_size = kernel_h * kernel_w * output_h * output_w;
+  const TIndex col_size = channels * channel_col_size;
 
   // Fast path for zero padding and no dilation
   // From Torch, THNN_(unfolded_copy)
   if (dilation_h == 1 && dilation_w == 1 && pad_l == 0 && pad_r == 0 &&
       pad_t == 0 && pad_b == 0) {
-    for (auto k = 0; k < channels * kernel_h * kernel_w; k++) {
-      const auto nip = k / (kernel_h * kernel_w);
-      const auto rest = k % (kernel_h * kernel_w);
-      const auto kh = rest / kernel_w;
-      const auto kw = rest % kernel_w;
-      auto* dst = data_col + nip * (kernel_h * kernel_w * output_h * output_w) +
-          kh * (kernel_w * output_h * output_w) + kw * (output_h * output_w);
-      const auto* src = data_im + nip * (height * width);
-      for (auto y = 0; y < output_h; y++) {
-        const auto iy = y * stride_h + kh;
-        const auto ix = kw;
-        if (stride_w == 1) {
-          memcpy(
-              dst + (y * output_w),
-              src + (iy * width + ix),
-              sizeof(float) * output_w);
-        } else {
-          for (auto x = 0; x < output_w; x++) {
-            memcpy(
-                dst + (y * output_w + x),
-                src + (iy * width + ix + x * stride_w),
-                sizeof(float));
+    ParallelRanges(
+        channels, col_size, context, [&](const int c_begin, const int c_end) {
+          for (auto k = c_begin * kernel_h * kernel_w;
+               k < c_end * kernel_h * kernel_w;
+               k++) {
+            const auto nip = k / (kernel_h * kernel_w);
+            const auto rest = k % (kernel_h * kernel_w);
+            const auto kh = rest / kernel_w;
+            const auto kw = rest % kernel_w;
+            auto* dst = data_col +
+                nip * (kernel_h * kernel_w * output_h * output_w) +
+                kh * (kernel_w * output_h * output_w) +
+                kw * (output_h * output_w);
+            const auto* src = data_im + nip * (height * width);
+            for (auto y = 0; y < output_h; y++) {
+              const auto iy = y * stride_h + kh;
+              const auto ix = kw;
+              if (stride_w == 1) {
+                memcpy(
+                    dst + (y * output_w),
+                    src + (iy * width + ix),
+                    sizeof(float) * output_w);
+              } else {
+                for (auto x = 0; x < output_w; x++) {
+                  memcpy(
+                      dst + (y * output_w + x),
+                      src + (iy * width + ix + x * stride_w),
+                      sizeof(float));
+                }
+              }
+            }
           }
-        }
-      }
-    }
+        });
     return;
   }
 
@@ -1107,32 +1404,39 @@ void Im2col<float, CPUContext, StorageOrder::NCHW>(
     // From Intel, https://github.com/BVLC/caffe/pull/3536
     const int pad_h = pad_t;
     const int pad_w = pad_l;
-    const int channel_size = height * width;
-    for (int channel = channels; channel--; data_im += channel_size) {
-      for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
-        for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
-          int input_row = -pad_h + kernel_row * dilation_h;
-          for (int output_rows = output_h; output_rows; output_rows--) {
-            if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
-              for (int output_cols = output_w; output_cols; output_cols--) {
-                *(data_col++) = 0;
-              }
-            } else {
-              int input_col = -pad_w + kernel_col * dilation_w;
-              for (int output_col = output_w; output_col; output_col--) {
-                if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
-                  *(data_col++) = data_im[input_row * width + input_col];
-                } else {
-                  *(data_col++) = 0;
+    ParallelRanges(
+        channels, col_size, context, [&](const int c_begin, const int c_end) {
+          const float* im = data_im + c_begin * channel_size;
+          float* col = data_col + c_begin * channel_col_size;
+          for (int channel = c_end - c_begin; channel--;
+               im += channel_size) {
+            for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
+              for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
+                int input_row = -pad_h + kernel_row * dilation_h;
+                for (int output_rows = output_h; output_rows; output_rows--) {
+                  if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
+                    for (int output_cols = output_w; output_cols;
+                         output_cols--) {
+                      *(col++) = 0;
+                    }
+                  } else {
+                    int input_col = -pad_w + kernel_col * dilation_w;
+                    for (int output_col = output_w; output_col;
+                         output_col--) {
+                      if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
+                        *(col++) = im[input_row * width + input_col];
+                      } else {
+                        *(col++) = 0;
+                      }
+                      input_col += stride_w;
+                    }
+                  }
+                  input_row += stride_h;
                 }
-                input_col += stride_w;
               }
             }
-            input_row += stride_h;
           }
-        }
-      }
-    }
+        });
     return;
   }
 
@@ -1143,23 +1447,27 @@ void Im2col<float, CPUContext, StorageOrder::NCHW>(
   int height_col = (height + pad_t + pad_b - dkernel_h) / stride_h + 1;
   int width_col = (width + pad_l + pad_r - dkernel_w) / stride_w + 1;
 
-  int channels_col = channels * kernel_h * kernel_w;
-  for (int c = 0; c < channels_col; ++c) {
-    int w_offset = c % kernel_w;
-    int h_offset = (c / kernel_w) % kernel_h;
-    int c_im = c / kernel_h / kernel_w;
-    for (int h = 0; h < height_col; ++h) {
-      for (int w = 0; w < width_col; ++w) {
-        int h_pad = h * stride_h - pad_t + h_offset * dilation_h;
-        int w_pad = w * stride_w - pad_l + w_offset * dilation_w;
-        if (h_pad >= 0 && h_pad < height && w_pad >= 0 && w_pad < width)
-          data_col[(c * height_col + h) * width_col + w] =
-              data_im[(c_im * height + h_pad) * width + w_pad];
-        else
-          data_col[(c * height_col + h) * width_col + w] = 0;
-      }
-    }
-  }
+  ParallelRanges(
+      channels, col_size, context, [&](const int c_begin, const int c_end) {
+        for (int c = c_begin * kernel_h * kernel_w;
+             c < c_end * kernel_h * kernel_w;
+             ++c) {
+          int w_offset = c % kernel_w;
+          int h_offset = (c / kernel_w) % kernel_h;
+          int c_im = c / kernel_h / kernel_w;
+          for (int h = 0; h < height_col; ++h) {
+            for (int w = 0; w < width_col; ++w) {
+              int h_pad = h * stride_h - pad_t + h_offset * dilation_h;
+              int w_pad = w * stride_w - pad_l + w_offset * dilation_w;
+              if (h_pad >= 0 && h_pad < height && w_pad >= 0 && w_pad < width)
+                data_col[(c * height_col + h) * width_col + w] =
+                    data_im[(c_im * height + h_pad) * width + w_pad];
+              else
+                data_col[(c * height_col + h) * width_col + w] = 0;
+            }
+          }
+        }
+      });
 }
 
 template <>
@@ -1179,33 +1487,44 @@ void Im2col<float, CPUContext, StorageOrder::NHWC>(
     const int stride_h,
     const int stride_w,
     float* data_col,
-    CPUContext* /*context*/) {
+    CPUContext* context) {
   const int dkernel_h = dilation_h * (kernel_h - 1) + 1;
   const int dkernel_w = dilation_w * (kernel_w - 1) + 1;
 
   int height_col = (height + pad_t + pad_b - dkernel_h) / stride_h + 1;
   int width_col = (width + pad_l + pad_r - dkernel_w) / stride_w + 1;
-
-  int h_pad = -pad_t;
-  for (int h = 0; h < height_col; ++h) {
-    int w_pad = -pad_l;
-    for (int w = 0; w < width_col; ++w) {
-      for (int ih = h_pad; ih < h_pad + dkernel_h; ih += dilation_h) {
-        for (int iw = w_pad; iw < w_pad + dkernel_w; iw += dilation_w) {
-          if (ih >= 0 && ih < height && iw >= 0 && iw < width) {
-            memcpy(data_col, data_im + (ih * width + iw) * channels,
-                   sizeof(float) * channels);
-          } else {
-            // This should be simply padded with zero.
-            memset(data_col, 0, sizeof(float) * channels);
+  const TIndex row_col_size =
+      static_cast<TIndex>(width_col) * kernel_h * kernel_w * channels;
+
+  // Each output row fills its own block of the column buffer, so the output
+  // rows are split between threads.
+  ParallelRanges(
+      height_col,
+      height_col * row_col_size,
+      context,
+      [&](const int h_begin, const int h_end) {
+        float* col = data_col + h_begin * row_col_size;
+        int h_pad = h_begin * stride_h - pad_t;
+        for (int h = h_begin; h < h_end; ++h) {
+          int w_pad = -pad_l;
+          for (int w = 0; w < width_col; ++w) {
+            for (int ih = h_pad; ih < h_pad + dkernel_h; ih += dilation_h) {
+              for (int iw = w_pad; iw < w_pad + dkernel_w; iw += dilation_w) {
+                if (ih >= 0 && ih < height && iw >= 0 && iw < width) {
+                  memcpy(col, data_im + (ih * width + iw) * channels,
+                         sizeof(float) * channels);
+                } else {
+                  // This should be simply padded with zero.
+                  memset(col, 0, sizeof(float) * channels);
+                }
+                col += channels;
+              }
+            }
+            w_pad += stride_w;
           }
-          data_col += channels;
+          h_pad += stride_h;
         }
-      }
-      w_pad += stride_w;
-    }
-    h_pad += stride_h;
-  }
+      });
 }
 
 template <>
@@ -1232,6 +1551,11 @@ void Col2im<float, CPUContext, StorageOrder::NCHW>(
   const int output_w =
       (width + pad_l + pad_r - (dilation_w * (kernel_w - 1) + 1)) / stride_w +
       1;
+  // The columns of each channel only add to the plane of that channel, so
+  // the channels are split between threads.
+  const TIndex channel_size = height * width;
+  const TIndex channel_col_size = kernel_h * kernel_w * output_h * output_w;
+  const TIndex col_size = channels * channel_col_size;
 
   Set<float, CPUContext>(height * width * channels, 0, data_im, context);
 
@@ -1239,33 +1563,39 @@ void Col2im<float, CPUContext, StorageOrder::NCHW>(
   // From Torch, modified THNN_(unfolded_acc)
   if (dilation_h == 1 && dilation_w == 1 && pad_l == 0 && pad_r == 0 &&
       pad_t == 0 && pad_b == 0) {
-    for (auto k = 0; k < channels * kernel_h * kernel_w; k++) {
-      const auto nip = k / (kernel_h * kernel_w);
-      const auto rest = k % (kernel_h * kernel_w);
-      const auto kh = rest / kernel_w;
-      const auto kw = rest % kernel_w;
-      const auto* dst = data_col +
-          nip * (kernel_h * kernel_w * output_h * output_w) +
-          kh * (kernel_w * output_h * output_w) + kw * (output_h * output_w);
-      auto* src = data_im + nip * (height * width);
-      for (auto y = 0; y < output_h; y++) {
-        const auto iy = y * stride_h + kh;
-        const auto ix = kw;
-        if (stride_w == 1) {
-          auto offsrc = src + (iy * width + ix);
-          const auto offdst = dst + (y * output_w);
-          for (auto i = 0; i < output_w; ++i) {
-            offsrc[i] += offdst[i];
-          }
-        } else {
-          for (auto x = 0; x < output_w; x++) {
-            auto offsrc = src + (iy * width + ix + x * stride_w);
-            const auto offdst = dst + (y * output_w + x);
-            *offsrc += *offdst;
+    ParallelRanges(
+        channels, col_size, context, [&](const int c_begin, const int c_end) {
+          for (auto k = c_begin * kernel_h * kernel_w;
+               k < c_end * kernel_h * kernel_w;
+               k++) {
+            const auto nip = k / (kernel_h * kernel_w);
+            const auto rest = k % (kernel_h * kernel_w);
+            const auto kh = rest / kernel_w;
+            const auto kw = rest % kernel_w;
+            const auto* dst = data_col +
+                nip * (kernel_h * kernel_w * output_h * output_w) +
+                kh * (kernel_w * output_h * output_w) +
+                kw * (output_h * output_w);
+            auto* src = data_im + nip * (height * width);
+            for (auto y = 0; y < output_h; y++) {
+              const auto iy = y * stride_h + kh;
+              const auto ix = kw;
+              if (stride_w == 1) {
+                auto offsrc = src + (iy * width + ix);
+                const auto offdst = dst + (y * output_w);
+                for (auto i = 0; i < output_w; ++i) {
+                  offsrc[i] += offdst[i];
+                }
+              } else {
+                for (auto x = 0; x < output_w; x++) {
+                  auto offsrc = src + (iy * width + ix + x * stride_w);
+                  const auto offdst = dst + (y * output_w + x);
+                  *offsrc += *offdst;
+                }
+              }
+            }
           }
-        }
-      }
-    }
+        });
     return;
   }
 
@@ -1274,29 +1604,35 @@ void Col2im<float, CPUContext, StorageOrder::NCHW>(
     // From Intel, https://github.com/BVLC/caffe/pull/3536
     const int pad_h = pad_t;
     const int pad_w = pad_l;
-    const int channel_size = height * width;
-    for (int channel = channels; channel--; data_im += channel_size) {
-      for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
-        for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
-          int input_row = -pad_h + kernel_row * dilation_h;
-          for (int output_rows = output_h; output_rows; output_rows--) {
-            if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
-              data_col += output_w;
-            } else {
-              int input_col = -pad_w + kernel_col * dilation_w;
-              for (int output_col = output_w; output_col; output_col--) {
-                if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
-                  data_im[input_row * width + input_col] += *data_col;
+    ParallelRanges(
+        channels, col_size, context, [&](const int c_begin, const int c_end) {
+          const float* col = data_col + c_begin * channel_col_size;
+          float* im = data_im + c_begin * channel_size;
+          for (int channel = c_end - c_begin; channel--;
+               im += channel_size) {
+            for (int kernel_row = 0; kernel_row < kernel_h; kernel_row++) {
+              for (int kernel_col = 0; kernel_col < kernel_w; kernel_col++) {
+                int input_row = -pad_h + kernel_row * dilation_h;
+                for (int output_rows = output_h; output_rows; output_rows--) {
+                  if (!is_a_ge_zero_and_a_lt_b(input_row, height)) {
+                    col += output_w;
+                  } else {
+                    int input_col = -pad_w + kernel_col * dilation_w;
+                    for (int output_col = output_w; output_col;
+                         output_col--) {
+                      if (is_a_ge_zero_and_a_lt_b(input_col, width)) {
+                        im[input_row * width + input_col] += *col;
+                      }
+                      col++;
+                      input_col += stride_w;
+                    }
+                  }
+                  input_row += stride_h;
                 }
-                data_col++;
-                input_col += stride_w;
               }
             }
-            input_row += stride_h;
           }
-        }
-      }
-    }
+        });
     return;
   }
 
@@ -1306,22 +1642,27 @@ void Col2im<float, CPUContext, StorageOrder::NCHW>(
 
   int height_col = (height + pad_t + pad_b - dkernel_h) / stride_h + 1;
   int width_col = (width + pad_l + pad_r - dkernel_w) / stride_w + 1;
-  int channels_col = channels * kernel_h * kernel_w;
-  for (int c = 0; c < channels_col; ++c) {
-    int w_offset = c % kernel_w;
-    int h_offset = (c / kernel_w) % kernel_h;
-    int c_im = c / kernel_h / kernel_w;
-    for (int h = 0; h < height_col; ++h) {
-      for (int w = 0; w < width_col; ++w) {
-        int h_pad = h * stride_h - pad_t + h_offset * dilation_h;
-        int w_pad = w * stride_w - pad_l + w_offset * dilation_w;
-        if (h_pad >= 0 && h_pad < height && w_pad >= 0 && w_pad < width) {
-          data_im[(c_im * height + h_pad) * width + w_pad] +=
-              data_col[(c * height_col + h) * width_col + w];
+  ParallelRanges(
+      channels, col_size, context, [&](const int c_begin, const int c_end) {
+        for (int c = c_begin * kernel_h * kernel_w;
+             c < c_end * kernel_h * kernel_w;
+             ++c) {
+          int w_offset = c % kernel_w;
+          int h_offset = (c / kernel_w) % kernel_h;
+          int c_im = c / kernel_h / kernel_w;
+          for (int h = 0; h < height_col; ++h) {
+            for (int w = 0; w < width_col; ++w) {
+              int h_pad = h * stride_h - pad_t + h_offset * dilation_h;
+              int w_pad = w * stride_w - pad_l + w_offset * dilation_w;
+              if (h_pad >= 0 && h_pad < height && w_pad >= 0 &&
+                  w_pad < width) {
+                data_im[(c_im * height + h_pad) * width + w_pad] +=
+                    data_col[(c * height_col + h) * width_col + w];
+              }
+            }
+          }
         }
-      }
-    }
-  }
+      });
 }
 
 template <>
@@ -1345,27 +1686,49 @@ void Col2im<float, CPUContext, StorageOrder::NHWC>(
   const int dkernel_h = dilation_h * (kernel_h - 1) + 1;
   const int dkernel_w = dilation_w * (kernel_w - 1) + 1;
 
-  Set<float, CPUContext>(height * width * channels, 0, data_im, context);
   int height_col = (height + pad_t + pad_b - dkernel_h) / stride_h + 1;
   int width_col = (width + pad_l + pad_r - dkernel_w) / stride_w + 1;
-  int h_pad = -pad_t;
-  for (int h = 0; h < height_col; ++h) {
-    int w_pad = -pad_l;
-    for (int w = 0; w < width_col; ++w) {
-      for (int ih = h_pad; ih < h_pad + dkernel_h; ih += dilation_h) {
-        for (int iw = w_pad; iw < w_pad + dkernel_w; iw += dilation_w) {
-          if (ih >= 0 && ih < height && iw >= 0 && iw < width) {
-            auto* data_im_patch = data_im + (ih * width + iw) * channels;
-            Add<float, CPUContext>(
-                  channels, data_im_patch, data_col, data_im_patch, context);
+  const TIndex row_col_size =
+      static_cast<TIndex>(width_col) * kernel_h * kernel_w * channels;
+  const TIndex row_size = static_cast<TIndex>(width) * channels;
+
+  // The windows of output rows overlap in the image, so the image rows are
+  // split between threads, each adding the columns that fall in its rows.
+  ParallelRanges(
+      height,
+      height_col * row_col_size,
+      context,
+      [&](const int ih_begin, const int ih_end) {
+        Set<float, CPUContext>(
+            (ih_end - ih_begin) * row_size,
+            0,
+            data_im + ih_begin * row_size,
+            context);
+        const float* col = data_col;
+        int h_pad = -pad_t;
+        for (int h = 0; h < height_col; ++h) {
+          if (h_pad + dkernel_h <= ih_begin || h_pad >= ih_end) {
+            col += row_col_size;
+            h_pad += stride_h;
+            continue;
+          }
+          int w_pad = -pad_l;
+          for (int w = 0; w < width_col; ++w) {
+            for (int ih = h_pad; ih < h_pad + dkernel_h; ih += dilation_h) {
+              for (int iw = w_pad; iw < w_pad + dkernel_w; iw += dilation_w) {
+                if (ih >= ih_begin && ih < ih_end && iw >= 0 && iw < width) {
+                  auto* data_im_patch = data_im + (ih * width + iw) * channels;
+                  Add<float, CPUContext>(
+                      channels, data_im_patch, col, data_im_patch, context);
+                }
+                col += channels;
+              }
+            }
+            w_pad += stride_w;
           }
-          data_col += channels;
+          h_pad += stride_h;
         }
-      }
-      w_pad += stride_w;
-    }
-    h_pad += stride_h;
-  }
+      });
 }
 
 template <>
@@ -1610,43 +1973,444 @@ void TransposeCPU(
   }
 }
 
+// Drops the axes of size 1, and merges the axes of X that stay next to each
+// other and in the same order in Y, which does not change the transpose.
+// NCHW to NHWC, for example, becomes the transpose of N matrices of C x HW.
+void CoalesceTransposeAxes(
+    const int num_axes,
+    const int* x_dims,
+    const int* axes,
+    std::vector<int>* dims,
+    std::vector<int>* new_axes) {
+  // Index of each remaining axis of X once the axes of size 1 are dropped
+  std::vector<int> index(num_axes, -1);
+  int num_remaining = 0;
+  for (int i = 0; i < num_axes; ++i) {
+    if (x_dims[i] > 1) {
+      index[i] = num_remaining++;
+    }
+  }
+  // Runs of consecutive axes of X in the order of Y, by their first axis
+  std::vector<int> first;
+  std::vector<int> run_dims(num_remaining, 1);
+  int last = -2;
+  for (int i = 0; i < num_axes; ++i) {
+    const int axis = index[axes[i]];
+    if (axis < 0) {
+      continue;
+    }
+    if (axis != last + 1) {
+      first.push_back(axis);
+    }
+    run_dims[first.back()] *= x_dims[axes[i]];
+    last = axis;
+  }
+  // Runs are numbered in the order of X
+  std::vector<int> rank(num_remaining, -1);
+  dims->clear();
+  for (int axis = 0; axis < num_remaining; ++axis) {
+    if (std::find(first.begin(), first.end(), axis) != first.end()) {
+      rank[axis] = dims->size();
+      dims->push_back(run_dims[axis]);
+    }
+  }
+  new_axes->resize(first.size());
+  for (int i = 0; i < first.size(); ++i) {
+    (*new_axes)[i] = rank[first[i]];
+  }
+}
+
+// Elements of the tiles of TransposeBatched2D along each side
+constexpr int kTransposeTileSize = 64;
+
+// Y[c][r] = X[r][c] for the rows x cols blocks of block_size elements of
+// one tile, X and Y having ldx and ldy blocks per row.
+template <typename T>
+void TransposeTile(
+    const int rows,
+    const int cols,
+    const int block_size,
+    const T* X,
+    const TIndex ldx,
+    T* Y,
+    const TIndex ldy) {
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      std::copy_n(
+          X + (r * ldx + c) * block_size,
+          block_size,
+          Y + (c * ldy + r) * block_size);
+    }
+  }
+}
+
+template <>
+void TransposeTile<float>(
+    const int rows,
+    const int cols,
+    const int block_size,
+    const float* X,
+    const TIndex ldx,
+    float* Y,
+    const TIndex ldy) {
+  if (block_size == 1) {
+    VectorizedTranspose(rows, cols, X, ldx, Y, ldy);
+    return;
+  }
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      memcpy(
+          Y + (c * ldy + r) * block_size,
+          X + (r * ldx + c) * block_size,
+          block_size * sizeof(float));
+    }
+  }
+}
+
+// Y[b][c][r] = X[b][r][c] for batch rows x cols matrices of blocks of
+// block_size elements. The matrices are transposed by tiles that stay in
+// cache, and the rows of tiles are split between the threads of context.
+template <typename T>
+void TransposeBatched2D(
+    const int batch,
+    const int rows,
+    const int cols,
+    const int block_size,
+    const T* X,
+    T* Y,
+    CPUContext* context) {
+  const int tile = std::max(1, kTransposeTileSize / block_size);
+  const int row_tiles = (rows + tile - 1) / tile;
+  const TIndex matrix_size = static_cast<TIndex>(rows) * cols * block_size;
+  ParallelRanges(
+      batch * row_tiles,
+      batch * matrix_size,
+      context,
+      [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+          const int b = t / row_tiles;
+          const int r0 = (t % row_tiles) * tile;
+          const int r_size = std::min(tile, rows - r0);
+          const T* x = X + b * matrix_size;
+          T* y = Y + b * matrix_size;
+          for (int c0 = 0; c0 < cols; c0 += tile) {
+            TransposeTile<T>(
+                r_size,
+                std::min(tile, cols - c0),
+                block_size,
+                x + (static_cast<TIndex>(r0) * cols + c0) * block_size,
+                cols,
+                y + (static_cast<TIndex>(c0) * rows + r0) * block_size,
+                rows);
+          }
+        }
+      });
+}
+
+// Transposes the coalesced axes of X with the 2D kernel when they are a
+// swap of two axes, between an optional batch axis and an optional axis
+// of contiguous blocks, and with TransposeCPU otherwise.
+template <typename T>
+void TransposeCoalesced(
+    const int num_axes,
+    const int* x_dims,
+    const int* axes,
+    const int data_size,
+    const T* X,
+    T* Y,
+    CPUContext* context) {
+  if (data_size == 0) {
+    return;
+  }
+  std::vector<int> dims;
+  std::vector<int> new_axes;
+  CoalesceTransposeAxes(num_axes, x_dims, axes, &dims, &new_axes);
+  const int n = dims.size();
+  if (n <= 1) {
+    memcpy(Y, X, data_size * sizeof(T));
+    return;
+  }
+  const int first = new_axes[0] == 0 ? 1 : 0;
+  const int last = new_axes[n - 1] == n - 1 ? n - 2 : n - 1;
+  if (last - first == 1 && new_axes[first] == last) {
+    TransposeBatched2D<T>(
+        first == 1 ? dims[0] : 1,
+        dims[first],
+        dims[last],
+        last == n - 2 ? dims[n - 1] : 1,
+        X,
+        Y,
+        context);
+    return;
+  }
+  std::vector<int> y_dims(n);
+  for (int i = 0; i < n; ++i) {
+    y_dims[i] = dims[new_axes[i]];
+  }
+  TransposeCPU(n, dims.data(), y_dims.data(), new_axes.data(), data_size, X, Y);
+}
+
 } // namespace
 
 template <>
 void Transpose<float, CPUContext>(
     const int num_axes,
     const int* x_dims,
-    const int* y_dims,
+    const int* /* y_dims */,
     const int* axes,
     const int data_size,
     const float* X,
     float* Y,
-    CPUContext* /* context */) {
+    CPUContext* context) {
 #ifdef CAFFE2_USE_HPTT
   if (TryTransposeWithHPTT(num_axes, x_dims, axes, X, Y)) {
     return;
   }
 #endif // CAFFE2_USE_HPTT
-  TransposeCPU(num_axes, x_dims, y_dims, axes, data_size, X, Y);
+  TransposeCoalesced(num_axes, x_dims, axes, data_size, X, Y, context);
 }
 
-#define CAFFE2_SPECIALIZED_TRANSPOSE(T)                            \
-  template <>                                                      \
-  void Transpose<T, CPUContext>(                                   \
-      const int num_axes,                                          \
-      const int* x_dims,                                           \
-      const int* y_dims,                                           \
-      const int* axes,                                             \
-      const int data_size,                                         \
-      const T* X,                                                  \
-      T* Y,                                                        \
-      CPUContext* /* context */) {                                 \
-    TransposeCPU(num_axes, x_dims, y_dims, axes, data_size, X, Y); \
+#define CAFFE2_SPECIALIZED_TRANSPOSE(T)                                    \
+  template <>                                                              \
+  void Transpose<T, CPUContext>(                                           \
+      const int num_axes,                                                  \
+      const int* x_dims,                                                   \
+      const int* /* y_dims */,                                             \
+      const int* axes,                                                     \
+      const int data_size,                                                 \
+      const T* X,                                                          \
+      T* Y,                                                                \
+      CPUContext* context) {                                               \
+    TransposeCoalesced(num_axes, x_dims, axes, data_size, X, Y, context);  \
   }
 CAFFE2_SPECIALIZED_TRANSPOSE(double)
 CAFFE2_SPECIALIZED_TRANSPOSE(int)
 CAFFE2_SPECIALIZED_TRANSPOSE(long)
 #undef CAFFE2_SPECIALIZED_TRANSPOSE
 
+namespace {
+
+// The broadcast of A and B to C with the dims of C of size 1 dropped, and the
+// adjacent dims that A and B both either read or broadcast merged. [N, C, H,
+// W] + [1, C, 1, 1] becomes [N, C, H * W] with B read along C only, so that
+// the inner loop adds a value of B to H * W values of A.
+struct BroadcastPlan {
+  BroadcastPlan(const int ndim, const int* A_dims, const int* B_dims) {
+    for (int i = 0; i < ndim; ++i) {
+      CAFFE_ENFORCE(
+          A_dims[i] == B_dims[i] || A_dims[i] == 1 || B_dims[i] == 1,
+          "Cannot broadcast dim ",
+          i,
+          ": ",
+          A_dims[i],
+          " vs ",
+          B_dims[i]);
+      const int dim = std::max(A_dims[i], B_dims[i]);
+      if (dim == 1) {
+        continue;
+      }
+      const bool A_read = A_dims[i] != 1;
+      const bool B_read = B_dims[i] != 1;
+      if (!dims.empty() && A_read == A_reads.back() &&
+          B_read == B_reads.back()) {
+        dims.back() *= dim;
+      } else {
+        dims.push_back(dim);
+        A_reads.push_back(A_read);
+        B_reads.push_back(B_read);
+      }
+    }
+    if (dims.empty()) {
+      dims.push_back(1);
+      A_reads.push_back(true);
+      B_reads.push_back(true);
+    }
+    const int n = dims.size();
+    A_strides.resize(n);
+    B_strides.resize(n);
+    TIndex A_stride = 1;
+    TIndex B_stride = 1;
+    for (int i = n - 1; i >= 0; --i) {
+      A_strides[i] = A_reads[i] ? A_stride : 0;
+      B_strides[i] = B_reads[i] ? B_stride : 0;
+      A_stride *= A_reads[i] ? dims[i] : 1;
+      B_stride *= B_reads[i] ? dims[i] : 1;
+    }
+    size = std::accumulate(
+        dims.begin(), dims.end(), TIndex(1), std::multiplies<TIndex>());
+  }
+
+  std::vector<TIndex> dims;
+  std::vector<bool> A_reads;
+  std::vector<bool> B_reads;
+  std::vector<TIndex> A_strides;
+  std::vector<TIndex> B_strides;
+  TIndex size;
+};
+
+// Runs Kernel::Run(n, a, a_scalar, b, b_scalar, c) on the rows of the inner
+// dim of plan, or on blocks of it when it is the only dim, split between
+// the threads of the thread pool of context.
+template <class Kernel, typename T, typename R>
+void RunBroadcastPlan(
+    const BroadcastPlan& plan,
+    const T* A,
+    const T* B,
+    R* C,
+    CPUContext* context) {
+  const int outer_ndim = plan.dims.size() - 1;
+  const TIndex inner = plan.dims.back();
+  const bool A_scalar = !plan.A_reads.back();
+  const bool B_scalar = !plan.B_reads.back();
+  if (outer_ndim == 0) {
+    const int num_blocks = (inner + kParallelMinRangeSize - 1) /
+        kParallelMinRangeSize;
+    ParallelRanges(num_blocks, inner, context, [&](int begin, int end) {
+      const TIndex i = begin * kParallelMinRangeSize;
+      const TIndex n = std::min(end * kParallelMinRangeSize, inner) - i;
+      Kernel::Run(
+          n,
+          A + (A_scalar ? 0 : i),
+          A_scalar,
+          B + (B_scalar ? 0 : i),
+          B_scalar,
+          C + i);
+    });
+    return;
+  }
+  const int rows = plan.size / inner;
+  ParallelRanges(rows, plan.size, context, [&](int begin, int end) {
+    std::vector<TIndex> index(outer_ndim);
+    TIndex A_offset = 0;
+    TIndex B_offset = 0;
+    TIndex row = begin;
+    for (int i = outer_ndim - 1; i >= 0; --i) {
+      index[i] = row % plan.dims[i];
+      row /= plan.dims[i];
+      A_offset += index[i] * plan.A_strides[i];
+      B_offset += index[i] * plan.B_strides[i];
+    }
+    for (TIndex r = begin; r < end; ++r) {
+      Kernel::Run(
+          inner,
+          A + A_offset,
+          A_scalar,
+          B + B_offset,
+          B_scalar,
+          C + r * inner);
+      for (int i = outer_ndim - 1; i >= 0; --i) {
+        A_offset += plan.A_strides[i];
+        B_offset += plan.B_strides[i];
+        if (++index[i] < plan.dims[i]) {
+          break;
+        }
+        A_offset -= plan.A_strides[i] * plan.dims[i];
+        B_offset -= plan.B_strides[i] * plan.dims[i];
+        index[i] = 0;
+      }
+    }
+  });
+}
+
+} // namespace
+
+// The inner loops, with Eigen expressions for their vectorization, and the
+// float arithmetic on the AVX2 / AVX512 perfkernels.
+#define CAFFE2_BROADCAST_KERNEL(name, expr)                          \
+  struct Broadcast##name##Kernel {                                  \
+    template <typename T, typename R>                               \
+    static void Run(                                                \
+        const TIndex n,                                             \
+        const T* a,                                                 \
+        const bool a_scalar,                                        \
+        const T* b,                                                 \
+        const bool b_scalar,                                        \
+        R* c) {                                                     \
+      using Array = Eigen::Array<T, Eigen::Dynamic, 1>;             \
+      if (a_scalar) {                                               \
+        EigenVectorArrayMap<R>(c, n) =                              \
+            Array::Constant(n, a[0]) expr                           \
+            ConstEigenVectorArrayMap<T>(b, n);                      \
+      } else if (b_scalar) {                                        \
+        EigenVectorArrayMap<R>(c, n) =                              \
+            ConstEigenVectorArrayMap<T>(a, n) expr                  \
+            Array::Constant(n, b[0]);                               \
+      } else {                                                      \
+        EigenVectorArrayMap<R>(c, n) =                              \
+            ConstEigenVectorArrayMap<T>(a, n) expr                  \
+            ConstEigenVectorArrayMap<T>(b, n);                      \
+      }                                                             \
+    }                                                               \
+  };
+
+#define CAFFE2_VECTORIZED_BROADCAST_KERNEL(name, expr)               \
+  CAFFE2_BROADCAST_KERNEL(name, expr)                               \
+  template <>                                                       \
+  void Broadcast##name##Kernel::Run<float, float>(                  \
+      const TIndex n,                                               \
+      const float* a,                                               \
+      const bool a_scalar,                                          \
+      const float* b,                                               \
+      const bool b_scalar,                                          \
+      float* c) {                                                   \
+    VectorizedBroadcast##name(n, a, a_scalar, b, b_scalar, c);      \
+  }
+
+CAFFE2_VECTORIZED_BROADCAST_KERNEL(Add, +)
+CAFFE2_VECTORIZED_BROADCAST_KERNEL(Sub, -)
+CAFFE2_VECTORIZED_BROADCAST_KERNEL(Mul, *)
+CAFFE2_VECTORIZED_BROADCAST_KERNEL(Div, /)
+CAFFE2_BROADCAST_KERNEL(EQ, ==)
+CAFFE2_BROADCAST_KERNEL(LT, <)
+CAFFE2_BROADCAST_KERNEL(LE, <=)
+CAFFE2_BROADCAST_KERNEL(GT, >)
+CAFFE2_BROADCAST_KERNEL(GE, >=)
+CAFFE2_BROADCAST_KERNEL(And, &&)
+CAFFE2_BROADCAST_KERNEL(Or, ||)
+CAFFE2_BROADCAST_KERNEL(Xor, !=)
+#undef CAFFE2_VECTORIZED_BROADCAST_KERNEL
+#undef CAFFE2_BROADCAST_KERNEL
+
+#define CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, T, TOut)              \
+  template <>                                                             \
+  void Broadcast##name<T, CPUContext>(                                    \
+      const int ndim,                                                     \
+      const int* A_dims,                                                  \
+      const int* B_dims,                                                  \
+      const T* A,                                                         \
+      const T* B,                                                         \
+      TOut* C,                                                            \
+      CPUContext* context) {                                              \
+    RunBroadcastPlan<Broadcast##name##Kernel>(                            \
+        BroadcastPlan(ndim, A_dims, B_dims), A, B, C, context);           \
+  }
+#define CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP(name)                   \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, int32_t, int32_t)          \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, int64_t, int64_t)          \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, float, float)              \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, double, double)
+#define CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP(name)                   \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, int32_t, bool)             \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, int64_t, bool)             \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, float, bool)               \
+  CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(name, double, bool)
+CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP(Add)
+CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP(Sub)
+CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP(Mul)
+CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP(Div)
+CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP(LT)
+CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP(LE)
+CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP(GT)
+CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP(GE)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(EQ, int32_t, bool)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(EQ, int64_t, bool)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(EQ, bool, bool)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(And, bool, bool)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(Or, bool, bool)
+CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP(Xor, bool, bool)
+#undef CAFFE2_SPECIALIZED_COMPARISON_BROADCAST_OP
+#undef CAFFE2_SPECIALIZED_ARITHMETIC_BROADCAST_OP
+#undef CAFFE2_SPECIALIZED_BROADCAST_BINARY_OP
+
 } // namespace math
 } // namespace caffe2
@@ -12,6 +12,12 @@
 #define THRUST_SUPPORTS_PER_THREAD
 #endif  // THRUST_VERSION >= 100800
 
+CAFFE2_DEFINE_bool(
+    caffe2_cuda_fp16_tensor_op_math,
+    false,
+    "Run the float16 Gemm and GemmBatched of the default engine with float "
+    "math type on the tensor cores, with fp32 accumulation, when available");
+
 namespace caffe2 {
 namespace math {
 
@@ -193,6 +199,142 @@ void Gemm<float, CUDAContext>(
       N));
 }
 
+namespace {
+
+#if CUDA_VERSION >= 9000
+// Enables the tensor cores on the cuBLAS handle of the context for the
+// lifetime of the object
+class TensorOpMathGuard {
+ public:
+  explicit TensorOpMathGuard(CUDAContext* context)
+      : handle_(context->cublas_handle()) {
+    CUBLAS_ENFORCE(cublasSetMathMode(handle_, CUBLAS_TENSOR_OP_MATH));
+  }
+
+  ~TensorOpMathGuard() {
+    CUBLAS_CHECK(cublasSetMathMode(handle_, CUBLAS_DEFAULT_MATH));
+  }
+
+ private:
+  cublasHandle_t handle_;
+};
+
+// cuBLAS only picks tensor core kernels when the dims are multiples of 8
+void CheckTensorOpDims(const int M, const int N, const int K) {
+  if (M % 8 != 0 || N % 8 != 0 || K % 8 != 0) {
+    VLOG(1) << "Gemm of " << M << "x" << K << " and " << K << "x" << N
+            << " matrices does not use the tensor cores, pad the dims to "
+            << "multiples of 8 to use them";
+  }
+}
+
+// Gemm of float16 matrices with fp32 accumulation, on the tensor cores if
+// they are available
+void TensorOpGemmFp16(
+    const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB,
+    const int M,
+    const int N,
+    const int K,
+    const float alpha,
+    const float16* A,
+    const float16* B,
+    const float beta,
+    float16* C,
+    CUDAContext* context) {
+  // Note that cublas follows fortran order, so the order is different from
+  // the cblas convention.
+  const int lda = (TransA == CblasNoTrans) ? K : M;
+  const int ldb = (TransB == CblasNoTrans) ? N : K;
+  cublasOperation_t cuTransA =
+      (TransA == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
+  cublasOperation_t cuTransB =
+      (TransB == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
+  std::unique_ptr<TensorOpMathGuard> guard;
+  if (TensorCoreAvailable()) {
+    guard.reset(new TensorOpMathGuard(context));
+    CheckTensorOpDims(M, N, K);
+  }
+  CUBLAS_ENFORCE(cublasGemmEx(
+      context->cublas_handle(),
+      cuTransB,
+      cuTransA,
+      N,
+      M,
+      K,
+      &alpha,
+      B,
+      CUDA_R_16F,
+      ldb,
+      A,
+      CUDA_R_16F,
+      lda,
+      &beta,
+      C,
+      CUDA_R_16F,
+      N,
+      CUDA_R_32F,
+      CUBLAS_GEMM_DFALT_TENSOR_OP));
+}
+#endif // CUDA_VERSION >= 9000
+
+#if CUDA_VERSION >= 9010
+// Batched Gemm of float16 matrices with fp32 accumulation, on the tensor
+// cores if use_tensor_op and they are available
+void GemmStridedBatchedFp16(
+    const CBLAS_TRANSPOSE TransA,
+    const CBLAS_TRANSPOSE TransB,
+    const int batch_size,
+    const int M,
+    const int N,
+    const int K,
+    const float alpha,
+    const float16* A,
+    const float16* B,
+    const float beta,
+    float16* C,
+    CUDAContext* context,
+    const bool use_tensor_op) {
+  const int lda = (TransA == CblasNoTrans) ? K : M;
+  const int ldb = (TransB == CblasNoTrans) ? N : K;
+  cublasOperation_t cuTransA =
+      (TransA == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
+  cublasOperation_t cuTransB =
+      (TransB == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
+  std::unique_ptr<TensorOpMathGuard> guard;
+  if (use_tensor_op && TensorCoreAvailable()) {
+    guard.reset(new TensorOpMathGuard(context));
+    CheckTensorOpDims(M, N, K);
+  }
+  CUBLAS_ENFORCE(cublasGemmStridedBatchedEx(
+      context->cublas_handle(),
+      cuTransB,
+      cuTransA,
+      N,
+      M,
+      K,
+      &alpha,
+      B,
+      CUDA_R_16F,
+      ldb,
+      static_cast<long long>(K) * N,
+      A,
+      CUDA_R_16F,
+      lda,
+      static_cast<long long>(M) * K,
+      &beta,
+      C,
+      CUDA_R_16F,
+      N,
+      static_cast<long long>(M) * N,
+      batch_size,
+      CUDA_R_32F,
+      use_tensor_op ? CUBLAS_GEMM_DFALT_TENSOR_OP : CUBLAS_GEMM_DFALT));
+}
+#endif // CUDA_VERSION >= 9010
+
+} // namespace
+
 template <>
 void Gemm<float16, CUDAContext>(
     const CBLAS_TRANSPOSE TransA,
@@ -216,6 +358,13 @@ void Gemm<float16, CUDAContext>(
   cublasOperation_t cuTransB =
       (TransB == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
   if (math_type == TensorProto_DataType_FLOAT) {
+#if CUDA_VERSION >= 9000
+    if (FLAGS_caffe2_cuda_fp16_tensor_op_math && TensorCoreAvailable()) {
+      TensorOpGemmFp16(
+          TransA, TransB, M, N, K, alpha, A, B, beta, C, context);
+      return;
+    }
+#endif // CUDA_VERSION >= 9000
     CUBLAS_CHECK(cublasSgemmEx(
         context->cublas_handle(),
         cuTransB,
@@ -432,6 +581,23 @@ void GemmBatched<float16, CUDAContext>(
         context->cuda_stream()>>>(batch_size * M * N, C_fp32, (half*)C);
   } else {
     if (math_type == TensorProto_DataType_FLOAT) {
+#if CUDA_VERSION >= 9010
+      GemmStridedBatchedFp16(
+          TransA,
+          TransB,
+          batch_size,
+          M,
+          N,
+          K,
+          alpha,
+          A,
+          B,
+          beta,
+          C,
+          context,
+          FLAGS_caffe2_cuda_fp16_tensor_op_math);
+      return;
+#endif // CUDA_VERSION >= 9010
       // loop over matrices in the batch
       for (int i = 0; i < batch_size; ++i) {
         math::Gemm<float16, CUDAContext>(
@@ -529,49 +695,7 @@ void Gemm<float16, CUDAContext, TensorCoreEngine>(
     float16* C,
     CUDAContext* context,
     TensorProto::DataType math_type) {
-  // Note that cublas follows fortran order, so the order is different from
-  // the cblas convention.
-  int lda = (TransA == CblasNoTrans) ? K : M;
-  int ldb = (TransB == CblasNoTrans) ? N : K;
-  cublasOperation_t cuTransA =
-      (TransA == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
-  cublasOperation_t cuTransB =
-      (TransB == CblasNoTrans) ? CUBLAS_OP_N : CUBLAS_OP_T;
-
-  // enable TensorCore for this call on this handle
-  if (TensorCoreAvailable()) {
-    CUBLAS_ENFORCE(cublasSetMathMode(
-        context->cublas_handle(),
-        CUBLAS_TENSOR_OP_MATH));
-  }
-
-  CUBLAS_CHECK(cublasGemmEx(
-      context->cublas_handle(),
-      cuTransB,
-      cuTransA,
-      N,
-      M,
-      K,
-      &alpha,
-      B,
-      CUDA_R_16F,
-      ldb,
-      A,
-      CUDA_R_16F,
-      lda,
-      &beta,
-      C,
-      CUDA_R_16F,
-      N,
-      CUDA_R_32F,
-      CUBLAS_GEMM_DFALT_TENSOR_OP));
-
-  // Now disable TensorCore math for subsequent calls to this handle
-  if (TensorCoreAvailable()) {
-    CUBLAS_ENFORCE(cublasSetMathMode(
-        context->cublas_handle(),
-        CUBLAS_DEFAULT_MATH));
-  }
+  TensorOpGemmFp16(TransA, TransB, M, N, K, alpha, A, B, beta, C, context);
 }
 
 template <>
@@ -623,6 +747,25 @@ void GemmBatched<float16, CUDAContext, TensorCoreEngine>(
     CUDAContext* context,
     Tensor<CUDAContext>* scratch,
     TensorProto::DataType math_type) {
+#if CUDA_VERSION >= 9010
+  if (scratch == nullptr && math_type == TensorProto_DataType_FLOAT) {
+    GemmStridedBatchedFp16(
+        TransA,
+        TransB,
+        batch_size,
+        M,
+        N,
+        K,
+        alpha,
+        A,
+        B,
+        beta,
+        C,
+        context,
+        true /* use_tensor_op */);
+    return;
+  }
+#endif // CUDA_VERSION >= 9010
   return GemmBatched<float16, CUDAContext, DefaultEngine>(
       TransA,
       TransB,
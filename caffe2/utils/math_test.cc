@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -9,6 +14,7 @@
 #include "caffe2/proto/caffe2.pb.h"
 #include "caffe2/utils/conversions.h"
 #include "caffe2/utils/math.h"
+#include "caffe2/utils/threadpool/ThreadPool.h"
 
 namespace caffe2 {
 
@@ -366,4 +372,397 @@ TEST(MathTest, TranposeTest) {
   }
 }
 
+TEST(MathTest, TransposeKernels) {
+  CPUContext cpu_context;
+  CPUContext pool_context;
+  std::unique_ptr<ThreadPool> pool = ThreadPool::defaultThreadPool();
+  pool_context.set_thread_pool(pool.get());
+  // X dims and axes: NCHW <-> NHWC, a swap between batch and block axes,
+  // axes of size 1, tails of the 8 x 8 blocks, and a general permutation
+  const std::vector<std::vector<std::vector<int>>> cases = {
+      {{4, 64, 33, 35}, {0, 2, 3, 1}},
+      {{4, 33, 35, 64}, {0, 3, 1, 2}},
+      {{2, 70, 3, 5}, {0, 2, 1, 3}},
+      {{1, 130, 1, 67}, {3, 2, 0, 1}},
+      {{3, 4, 5, 6}, {2, 0, 3, 1}},
+      {{0, 3, 4}, {2, 1, 0}},
+  };
+  for (const auto& test_case : cases) {
+    const auto& x_dims = test_case[0];
+    const auto& axes = test_case[1];
+    const int ndim = x_dims.size();
+    std::vector<int> y_dims(ndim);
+    for (int i = 0; i < ndim; ++i) {
+      y_dims[i] = x_dims[axes[i]];
+    }
+    const int size = std::accumulate(
+        x_dims.begin(), x_dims.end(), 1, std::multiplies<int>());
+    std::vector<float> X(size);
+    std::iota(X.begin(), X.end(), 0.0f);
+
+    // The reference transpose, index by index
+    std::vector<float> expected(size);
+    for (int y = 0; y < size; ++y) {
+      std::vector<int> index(ndim);
+      for (int i = ndim - 1, rest = y; i >= 0; --i) {
+        index[axes[i]] = rest % y_dims[i];
+        rest /= y_dims[i];
+      }
+      int x = 0;
+      for (int i = 0; i < ndim; ++i) {
+        x = x * x_dims[i] + index[i];
+      }
+      expected[y] = X[x];
+    }
+
+    for (CPUContext* context : {&cpu_context, &pool_context}) {
+      std::vector<float> Y(size);
+      math::Transpose<float, CPUContext>(
+          ndim, x_dims.data(), y_dims.data(), axes.data(), size, X.data(),
+          Y.data(), context);
+      EXPECT_EQ(Y, expected);
+      std::vector<int> X_int(X.begin(), X.end());
+      std::vector<int> Y_int(size);
+      math::Transpose<int, CPUContext>(
+          ndim, x_dims.data(), y_dims.data(), axes.data(), size,
+          X_int.data(), Y_int.data(), context);
+      EXPECT_EQ(Y_int, std::vector<int>(expected.begin(), expected.end()));
+    }
+  }
+}
+
+TEST(MathTest, ExpLogSqrt) {
+  DeviceOption option;
+  CPUContext cpu_context(option);
+  // 37 values cover full vectors and a tail with both AVX2 and AVX512
+  std::vector<float> x;
+  for (int i = 0; i < 37; ++i) {
+    x.push_back(-20.0f + 1.1f * i);
+  }
+  std::vector<float> y(x.size());
+  math::Exp<float, CPUContext>(x.size(), x.data(), y.data(), &cpu_context);
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_NEAR(y[i], std::exp(x[i]), 1e-6 * std::exp(x[i])) << x[i];
+  }
+
+  std::vector<float> positive;
+  for (int i = 0; i < 37; ++i) {
+    positive.push_back(std::ldexp(1.0f + 0.03f * i, 3 * i - 60));
+  }
+  positive[0] = std::numeric_limits<float>::denorm_min() * 3;
+  math::Log<float, CPUContext>(
+      positive.size(), positive.data(), y.data(), &cpu_context);
+  for (int i = 0; i < positive.size(); ++i) {
+    const float expected = std::log(positive[i]);
+    EXPECT_NEAR(y[i], expected, 1e-6 * std::abs(expected) + 1e-7)
+        << positive[i];
+  }
+  math::Sqrt<float, CPUContext>(
+      positive.size(), positive.data(), y.data(), &cpu_context);
+  for (int i = 0; i < positive.size(); ++i) {
+    EXPECT_EQ(y[i], std::sqrt(positive[i])) << positive[i];
+  }
+
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> special = {0.0f, -1.0f, inf, -inf, nan, 100.0f};
+  math::Exp<float, CPUContext>(
+      special.size(), special.data(), y.data(), &cpu_context);
+  EXPECT_EQ(y[0], 1.0f);
+  EXPECT_EQ(y[2], inf);
+  EXPECT_EQ(y[3], 0.0f);
+  EXPECT_TRUE(std::isnan(y[4]));
+  EXPECT_EQ(y[5], inf);
+  math::Log<float, CPUContext>(
+      special.size(), special.data(), y.data(), &cpu_context);
+  EXPECT_EQ(y[0], -inf);
+  EXPECT_TRUE(std::isnan(y[1]));
+  EXPECT_EQ(y[2], inf);
+  EXPECT_TRUE(std::isnan(y[3]));
+  EXPECT_TRUE(std::isnan(y[4]));
+}
+
+TEST(MathTest, PowxSumRowwiseMaxBroadcast) {
+  DeviceOption option;
+  CPUContext cpu_context(option);
+  const int M = 3;
+  const int N = 37;
+  std::vector<float> x(M * N);
+  for (int i = 0; i < x.size(); ++i) {
+    x[i] = 0.25f + ((i * 7) % 23) * 0.5f;
+  }
+  std::vector<float> y(x.size());
+  for (const float b : {-1.0f, 0.5f, 1.0f, 2.0f, 1.5f}) {
+    math::Powx<float, CPUContext>(
+        x.size(), x.data(), b, y.data(), &cpu_context);
+    for (int i = 0; i < x.size(); ++i) {
+      EXPECT_FLOAT_EQ(y[i], std::pow(x[i], b)) << b;
+    }
+  }
+
+  float sum = 0;
+  float sumsqr = 0;
+  math::Sum<float, CPUContext>(x.size(), x.data(), &sum, &cpu_context);
+  math::SumSqr<float, CPUContext>(x.size(), x.data(), &sumsqr, &cpu_context);
+  double expected_sum = 0;
+  double expected_sumsqr = 0;
+  for (const float v : x) {
+    expected_sum += v;
+    expected_sumsqr += v * v;
+  }
+  EXPECT_NEAR(sum, expected_sum, 1e-5 * expected_sum);
+  EXPECT_NEAR(sumsqr, expected_sumsqr, 1e-5 * expected_sumsqr);
+
+  math::RowwiseMax<float, CPUContext>(M, N, x.data(), y.data(), &cpu_context);
+  for (int i = 0; i < M; ++i) {
+    EXPECT_EQ(y[i], *std::max_element(&x[i * N], &x[i * N] + N));
+  }
+
+  std::vector<float> b(N);
+  for (int j = 0; j < N; ++j) {
+    b[j] = 1.0f + j;
+  }
+  math::AddToRow<float, CPUContext>(
+      M, N, x.data(), b.data(), y.data(), &cpu_context);
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_EQ(y[i], x[i] + b[i % N]);
+  }
+  math::MulToRow<float, CPUContext>(M, N, b.data(), y.data(), &cpu_context);
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_EQ(y[i], (x[i] + b[i % N]) * b[i % N]);
+  }
+  math::Mul<float, CPUContext>(
+      x.size(), x.data(), x.data(), y.data(), &cpu_context);
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_EQ(y[i], x[i] * x[i]);
+  }
+}
+
+
+TEST(MathTest, Im2colCol2imThreadPool) {
+  DeviceOption option;
+  CPUContext cpu_context(option);
+  CPUContext pool_context(option);
+  std::unique_ptr<ThreadPool> pool = ThreadPool::defaultThreadPool();
+  pool_context.set_thread_pool(pool.get());
+  const int C = 16;
+  const int H = 23;
+  const int W = 19;
+  std::vector<float> im(C * H * W);
+  for (int i = 0; i < im.size(); ++i) {
+    im[i] = ((i * 13) % 29) * 0.25f - 3.0f;
+  }
+  // kernel, dilation, pad_t, pad_l, pad_b, pad_r, stride_h, stride_w
+  const std::vector<std::vector<int>> configs = {
+      {3, 1, 0, 0, 0, 0, 1, 1},
+      {3, 1, 1, 1, 1, 1, 2, 2},
+      {5, 2, 2, 1, 2, 1, 1, 2},
+      {3, 1, 1, 0, 2, 1, 2, 1},
+  };
+  for (const auto& config : configs) {
+    const int kernel = config[0];
+    const int dilation = config[1];
+    const int dkernel = dilation * (kernel - 1) + 1;
+    const int out_h = (H + config[2] + config[4] - dkernel) / config[6] + 1;
+    const int out_w = (W + config[3] + config[5] - dkernel) / config[7] + 1;
+    const int col_size = C * kernel * kernel * out_h * out_w;
+    std::vector<float> col(col_size);
+    std::vector<float> pool_col(col_size);
+    std::vector<float> result(im.size());
+    std::vector<float> pool_result(im.size());
+    // Runs Im2col and Col2im of order with context, writing col and result
+    const auto run = [&](const bool nchw,
+                         CPUContext* context,
+                         float* col_data,
+                         float* result_data) {
+      if (nchw) {
+        math::Im2col<float, CPUContext, StorageOrder::NCHW>(
+            im.data(), C, H, W, kernel, kernel, dilation, dilation,
+            config[2], config[3], config[4], config[5], config[6], config[7],
+            col_data, context);
+        math::Col2im<float, CPUContext, StorageOrder::NCHW>(
+            col_data, C, H, W, kernel, kernel, dilation, dilation,
+            config[2], config[3], config[4], config[5], config[6], config[7],
+            result_data, context);
+      } else {
+        math::Im2col<float, CPUContext, StorageOrder::NHWC>(
+            im.data(), C, H, W, kernel, kernel, dilation, dilation,
+            config[2], config[3], config[4], config[5], config[6], config[7],
+            col_data, context);
+        math::Col2im<float, CPUContext, StorageOrder::NHWC>(
+            col_data, C, H, W, kernel, kernel, dilation, dilation,
+            config[2], config[3], config[4], config[5], config[6], config[7],
+            result_data, context);
+      }
+    };
+    for (const bool nchw : {true, false}) {
+      run(nchw, &cpu_context, col.data(), result.data());
+      run(nchw, &pool_context, pool_col.data(), pool_result.data());
+      EXPECT_EQ(col, pool_col);
+      EXPECT_EQ(result, pool_result);
+    }
+
+    // The NHWC Im2colNd and Col2imNd give the same columns and image as the
+    // 2D functions, whose results are still in col and result.
+    const int im_shape[] = {H, W, C};
+    const int col_shape[] = {out_h, out_w, kernel * kernel * C};
+    const int kernel_shape[] = {kernel, kernel};
+    const int stride[] = {config[6], config[7]};
+    const int dilations[] = {dilation, dilation};
+    const int pad[] = {config[2], config[3]};
+    for (CPUContext* context : {&cpu_context, &pool_context}) {
+      math::Im2colNd<float, CPUContext, StorageOrder::NHWC>(
+          im.data(), im_shape, col_shape, im.size(), col_size, kernel_shape,
+          stride, dilations, pad, 2, pool_col.data(), context);
+      EXPECT_EQ(col, pool_col);
+      math::Col2imNd<float, CPUContext, StorageOrder::NHWC>(
+          col.data(), im_shape, col_shape, im.size(), col_size, kernel_shape,
+          stride, dilations, pad, 2, pool_result.data(), context);
+      for (int i = 0; i < im.size(); ++i) {
+        EXPECT_FLOAT_EQ(result[i], pool_result[i]);
+      }
+    }
+  }
+}
+
+TEST(MathTest, GemmBatched) {
+  CPUContext cpu_context;
+  CPUContext pool_context;
+  std::unique_ptr<ThreadPool> pool = ThreadPool::defaultThreadPool();
+  pool_context.set_thread_pool(pool.get());
+  // batch_size, M, N, K, with sizes around the vector widths and one size
+  // too large for the small matrix path
+  const std::vector<std::vector<int>> shapes = {
+      {64, 32, 32, 32}, {7, 5, 17, 3}, {3, 1, 33, 9}, {2, 130, 4, 6}};
+  for (const auto& shape : shapes) {
+    const int batch_size = shape[0];
+    const int M = shape[1];
+    const int N = shape[2];
+    const int K = shape[3];
+    std::vector<float> A(batch_size * M * K);
+    std::vector<float> B(batch_size * K * N);
+    for (int i = 0; i < A.size(); ++i) {
+      A[i] = (i % 11) * 0.25f - 1;
+    }
+    for (int i = 0; i < B.size(); ++i) {
+      B[i] = (i % 5) * 0.5f - 1;
+    }
+    for (const auto trans_a : {CblasNoTrans, CblasTrans}) {
+      for (const auto trans_b : {CblasNoTrans, CblasTrans}) {
+        for (const float beta : {0.0f, 0.5f}) {
+          const float alpha = beta == 0 ? 1.0f : 2.0f;
+          std::vector<float> expected(batch_size * M * N);
+          for (int i = 0; i < expected.size(); ++i) {
+            expected[i] = i % 3;
+          }
+          std::vector<float> C(expected);
+          for (int b = 0; b < batch_size; ++b) {
+            math::Gemm<float, CPUContext>(
+                trans_a, trans_b, M, N, K, alpha, A.data() + b * M * K,
+                B.data() + b * K * N, beta, expected.data() + b * M * N,
+                &cpu_context);
+          }
+          for (CPUContext* context : {&cpu_context, &pool_context}) {
+            std::vector<float> result(C);
+            math::GemmBatched<float, CPUContext>(
+                trans_a, trans_b, batch_size, M, N, K, alpha, A.data(),
+                B.data(), beta, result.data(), context);
+            for (int i = 0; i < result.size(); ++i) {
+              EXPECT_NEAR(result[i], expected[i], 1e-4);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(MathTest, BroadcastBinaryOps) {
+  CPUContext cpu_context;
+  CPUContext pool_context;
+  std::unique_ptr<ThreadPool> pool = ThreadPool::defaultThreadPool();
+  pool_context.set_thread_pool(pool.get());
+  // A dims, B dims, with both A and B broadcast in some of them
+  const std::vector<std::vector<std::vector<int>>> shapes = {
+      {{2, 3, 4, 5}, {1, 3, 1, 1}},
+      {{2, 4, 5, 3}, {1, 1, 1, 3}},
+      {{2, 3, 4, 5}, {2, 3, 4, 5}},
+      {{2, 3, 4, 5}, {1, 1, 1, 1}},
+      {{1, 1, 1, 7}, {3, 1, 5, 7}},
+      {{3, 1, 5}, {1, 4, 1}},
+      {{8, 64, 33, 17}, {1, 64, 1, 1}},
+      {{70000}, {1}},
+  };
+  for (const auto& shape : shapes) {
+    const auto& A_dims = shape[0];
+    const auto& B_dims = shape[1];
+    const int ndim = A_dims.size();
+    std::vector<int> C_dims(ndim);
+    for (int i = 0; i < ndim; ++i) {
+      C_dims[i] = std::max(A_dims[i], B_dims[i]);
+    }
+    const int A_size = std::accumulate(
+        A_dims.begin(), A_dims.end(), 1, std::multiplies<int>());
+    const int B_size = std::accumulate(
+        B_dims.begin(), B_dims.end(), 1, std::multiplies<int>());
+    const int C_size = std::accumulate(
+        C_dims.begin(), C_dims.end(), 1, std::multiplies<int>());
+    std::vector<float> A(A_size);
+    std::vector<float> B(B_size);
+    for (int i = 0; i < A_size; ++i) {
+      A[i] = (i % 13) - 6.5f;
+    }
+    for (int i = 0; i < B_size; ++i) {
+      B[i] = (i % 7) + 0.5f;
+    }
+
+    // The reference broadcast, index by index
+    std::vector<float> sum(C_size);
+    std::vector<float> quotient(C_size);
+    std::vector<bool> less(C_size);
+    for (int c = 0; c < C_size; ++c) {
+      int a = 0;
+      int b = 0;
+      for (int i = 0, rest = c, stride = C_size; i < ndim; ++i) {
+        stride /= C_dims[i];
+        const int index = rest / stride;
+        rest %= stride;
+        a = a * A_dims[i] + (A_dims[i] == 1 ? 0 : index);
+        b = b * B_dims[i] + (B_dims[i] == 1 ? 0 : index);
+      }
+      sum[c] = A[a] + B[b];
+      quotient[c] = A[a] / B[b];
+      less[c] = A[a] < B[b];
+    }
+
+    for (CPUContext* context : {&cpu_context, &pool_context}) {
+      std::vector<float> C(C_size);
+      math::BroadcastAdd<float, CPUContext>(
+          ndim, A_dims.data(), B_dims.data(), A.data(), B.data(), C.data(),
+          context);
+      EXPECT_EQ(C, sum);
+      math::BroadcastDiv<float, CPUContext>(
+          ndim, A_dims.data(), B_dims.data(), A.data(), B.data(), C.data(),
+          context);
+      EXPECT_EQ(C, quotient);
+      std::unique_ptr<bool[]> C_less(new bool[C_size]);
+      math::BroadcastLT<float, CPUContext>(
+          ndim, A_dims.data(), B_dims.data(), A.data(), B.data(),
+          C_less.get(), context);
+      for (int i = 0; i < C_size; ++i) {
+        EXPECT_EQ(C_less[i], less[i]);
+      }
+      std::vector<double> A_double(A.begin(), A.end());
+      std::vector<double> B_double(B.begin(), B.end());
+      std::vector<double> C_double(C_size);
+      math::BroadcastAdd<double, CPUContext>(
+          ndim, A_dims.data(), B_dims.data(), A_double.data(),
+          B_double.data(), C_double.data(), context);
+      for (int i = 0; i < C_size; ++i) {
+        EXPECT_EQ(C_double[i], sum[i]);
+      }
+    }
+  }
+}
+
 } // namespace caffe2
@@ -0,0 +1,125 @@
+#ifndef CAFFE2_UTILS_MPMC_QUEUE_H_
+#define CAFFE2_UTILS_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "caffe2/core/common.h"
+#include "caffe2/core/logging.h"
+
+namespace caffe2 {
+
+/**
+ * Bounded lock-free multi-producer/multi-consumer queue.
+ *
+ * Every cell carries a sequence number that tells producers and consumers
+ * whether the cell is free for the current lap of the ring; positions are
+ * claimed with a CAS on the enqueue/dequeue counters, so neither operation
+ * ever blocks. tryPush fails when the queue is full, tryPop when it is empty.
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MPMCQueue {
+ public:
+  explicit MPMCQueue(std::size_t capacity)
+      : mask_(roundUpToPowerOfTwo(capacity) - 1),
+        cells_(new Cell[mask_ + 1]),
+        enqueue_pos_(0),
+        dequeue_pos_(0) {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename U>
+  bool tryPush(U&& value) {
+    Cell* cell;
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) -
+          static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The consumer of the previous lap did not free the cell yet
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::forward<U>(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(T* value) {
+    Cell* cell;
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) -
+          static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *value = std::move(cell->data);
+    // Release resources held by the moved-from value before the cell is
+    // handed back to producers
+    cell->data = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const {
+    return mask_ + 1;
+  }
+
+ private:
+  static constexpr std::size_t kCacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+
+  static std::size_t roundUpToPowerOfTwo(std::size_t n) {
+    CAFFE_ENFORCE_GT(n, 0, "MPMCQueue needs a positive capacity");
+    std::size_t result = 2;
+    while (result < n) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const std::size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  // Producers and consumers update different counters, keep them on
+  // separate cache lines
+  char pad0_[kCacheLineSize];
+  std::atomic<std::size_t> enqueue_pos_;
+  char pad1_[kCacheLineSize - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> dequeue_pos_;
+  char pad2_[kCacheLineSize - sizeof(std::atomic<std::size_t>)];
+
+  DISABLE_COPY_AND_ASSIGN(MPMCQueue);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_MPMC_QUEUE_H_
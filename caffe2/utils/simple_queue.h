@@ -4,6 +4,7 @@
 #include <condition_variable>  // NOLINT
 #include <mutex>  // NOLINT
 #include <queue>
+#include <utility>
 
 #include "caffe2/core/logging.h"
 
@@ -18,10 +19,15 @@ namespace caffe2 {
 // nothing is in the queue but NoMoreJobs() is not called yet, the pop calls
 // will wait. If NoMoreJobs() has been called, pop calls will return false,
 // which serves as a message to the workers that they should exit.
-template <typename T>
+//
+// Jobs are popped in FIFO order by default; any other order can be provided
+// by an underlying queue with the std::queue interface (push, front, pop).
+template <typename T, typename Queue = std::queue<T>>
 class SimpleQueue {
  public:
   SimpleQueue() : no_more_jobs_(false) {}
+  explicit SimpleQueue(Queue queue)
+      : queue_(std::move(queue)), no_more_jobs_(false) {}
 
   // Pops a value and writes it to the value pointer. If there is nothing in the
   // queue, this will wait till a value is inserted to the queue. If there are
@@ -68,7 +74,7 @@ class SimpleQueue {
  private:
   std::mutex mutex_;
   std::condition_variable cv_;
-  std::queue<T> queue_;
+  Queue queue_;
   bool no_more_jobs_;
   // We do not allow copy constructors.
   SimpleQueue(const SimpleQueue& /*src*/) {}
@@ -0,0 +1,401 @@
+#ifndef CAFFE2_UTILS_SMALL_VECTOR_H_
+#define CAFFE2_UTILS_SMALL_VECTOR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace caffe2 {
+
+// A vector of trivially copyable values keeping up to N of them inline, so
+// that short vectors - like the dims of a tensor - are created, copied and
+// resized without any heap allocation. Past N values it moves them to the
+// heap, as std::vector does.
+//
+// The interface is the subset of std::vector the code uses, and a SmallVector
+// converts implicitly to a std::vector, so that it can be passed to the
+// functions taking one. The conversion copies the values, so prefer to keep
+// the SmallVector in the hot paths.
+template <typename T, size_t N>
+class SmallVector {
+  static_assert(N > 0, "SmallVector needs some inline capacity");
+  static_assert(
+      std::is_trivially_copyable<T>::value,
+      "SmallVector only holds trivially copyable values");
+
+ public:
+  using value_type = T;
+  using size_type = size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = T*;
+  using const_iterator = const T*;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  SmallVector() {}
+
+  explicit SmallVector(size_type count, const T& value = T()) {
+    assign(count, value);
+  }
+
+  template <
+      typename InputIt,
+      typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+  SmallVector(InputIt first, InputIt last) {
+    assign(first, last);
+  }
+
+  SmallVector(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+  }
+
+  // Explicit, so that mixing SmallVector and std::vector, like in a ternary,
+  // resolves to std::vector.
+  template <typename U>
+  explicit SmallVector(const std::vector<U>& values) {
+    assign(values.begin(), values.end());
+  }
+
+  SmallVector(const SmallVector& other) {
+    assign(other.begin(), other.end());
+  }
+
+  SmallVector(SmallVector&& other) noexcept {
+    moveFrom(other);
+  }
+
+  ~SmallVector() {
+    freeHeap();
+  }
+
+  SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      assign(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) noexcept {
+    if (this != &other) {
+      freeHeap();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  template <typename U>
+  SmallVector& operator=(const std::vector<U>& values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+
+  SmallVector& operator=(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+    return *this;
+  }
+
+  operator std::vector<T>() const {
+    return std::vector<T>(begin(), end());
+  }
+
+  void assign(size_type count, const T& value) {
+    reserveDiscarding(count);
+    std::fill(data_, data_ + count, value);
+    size_ = count;
+  }
+
+  template <
+      typename InputIt,
+      typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+  void assign(InputIt first, InputIt last) {
+    const size_type count = std::distance(first, last);
+    reserveDiscarding(count);
+    std::copy(first, last, data_);
+    size_ = count;
+  }
+
+  size_type size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+  size_type capacity() const {
+    return capacity_;
+  }
+  // Whether the values are stored inline
+  bool is_inline() const {
+    return data_ == inline_;
+  }
+
+  T* data() {
+    return data_;
+  }
+  const T* data() const {
+    return data_;
+  }
+
+  iterator begin() {
+    return data_;
+  }
+  iterator end() {
+    return data_ + size_;
+  }
+  const_iterator begin() const {
+    return data_;
+  }
+  const_iterator end() const {
+    return data_ + size_;
+  }
+  const_iterator cbegin() const {
+    return begin();
+  }
+  const_iterator cend() const {
+    return end();
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  T& operator[](size_type i) {
+    return data_[i];
+  }
+  const T& operator[](size_type i) const {
+    return data_[i];
+  }
+  T& at(size_type i) {
+    checkIndex(i);
+    return data_[i];
+  }
+  const T& at(size_type i) const {
+    checkIndex(i);
+    return data_[i];
+  }
+  T& front() {
+    return data_[0];
+  }
+  const T& front() const {
+    return data_[0];
+  }
+  T& back() {
+    return data_[size_ - 1];
+  }
+  const T& back() const {
+    return data_[size_ - 1];
+  }
+
+  void reserve(size_type capacity) {
+    if (capacity <= capacity_) {
+      return;
+    }
+    T* data = new T[capacity];
+    std::memcpy(data, data_, size_ * sizeof(T));
+    freeHeap();
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  void resize(size_type size, const T& value = T()) {
+    if (size > size_) {
+      grow(size);
+      std::fill(data_ + size_, data_ + size, value);
+    }
+    size_ = size;
+  }
+
+  void clear() {
+    size_ = 0;
+  }
+
+  void push_back(const T& value) {
+    if (size_ == capacity_) {
+      // The value may live in the storage we are about to replace
+      const T copy = value;
+      grow(size_ + 1);
+      data_[size_++] = copy;
+      return;
+    }
+    data_[size_++] = value;
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    push_back(T(std::forward<Args>(args)...));
+  }
+
+  void pop_back() {
+    --size_;
+  }
+
+  iterator insert(const_iterator pos, const T& value) {
+    return insert(pos, size_type(1), value);
+  }
+
+  iterator insert(const_iterator pos, size_type count, const T& value) {
+    const size_type index = pos - begin();
+    const T copy = value;
+    makeRoom(index, count);
+    std::fill(data_ + index, data_ + index + count, copy);
+    return data_ + index;
+  }
+
+  template <
+      typename InputIt,
+      typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+  iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    const size_type index = pos - begin();
+    // Copy first, the range may be a part of this vector
+    const SmallVector values(first, last);
+    makeRoom(index, values.size());
+    std::copy(values.begin(), values.end(), data_ + index);
+    return data_ + index;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> values) {
+    return insert(pos, values.begin(), values.end());
+  }
+
+  iterator erase(const_iterator pos) {
+    return erase(pos, pos + 1);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    const size_type index = first - begin();
+    const size_type count = last - first;
+    std::memmove(
+        data_ + index,
+        data_ + index + count,
+        (size_ - index - count) * sizeof(T));
+    size_ -= count;
+    return data_ + index;
+  }
+
+  void swap(SmallVector& other) {
+    SmallVector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+ private:
+  void checkIndex(size_type i) const {
+    if (i >= size_) {
+      throw std::out_of_range("SmallVector index out of range");
+    }
+  }
+
+  void freeHeap() {
+    if (data_ != inline_) {
+      delete[] data_;
+    }
+  }
+
+  void moveFrom(SmallVector& other) {
+    if (other.data_ == other.inline_) {
+      std::memcpy(inline_, other.inline_, other.size_ * sizeof(T));
+      data_ = inline_;
+      capacity_ = N;
+    } else {
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      other.data_ = other.inline_;
+      other.capacity_ = N;
+    }
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+
+  // Grows the capacity geometrically, as push_back expects
+  void grow(size_type size) {
+    if (size > capacity_) {
+      reserve(std::max(size, 2 * capacity_));
+    }
+  }
+
+  // Makes sure there is room for count values, without keeping the
+  // current ones
+  void reserveDiscarding(size_type count) {
+    if (count > capacity_) {
+      size_ = 0;
+      reserve(count);
+    }
+  }
+
+  // Opens a gap of count values at index
+  void makeRoom(size_type index, size_type count) {
+    grow(size_ + count);
+    std::memmove(
+        data_ + index + count, data_ + index, (size_ - index) * sizeof(T));
+    size_ += count;
+  }
+
+  T inline_[N];
+  T* data_ = inline_;
+  size_type size_ = 0;
+  size_type capacity_ = N;
+};
+
+template <typename T, size_t N, size_t M>
+bool operator==(const SmallVector<T, N>& a, const SmallVector<T, M>& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T, size_t N, size_t M>
+bool operator!=(const SmallVector<T, N>& a, const SmallVector<T, M>& b) {
+  return !(a == b);
+}
+
+template <typename T, size_t N, typename U>
+bool operator==(const SmallVector<T, N>& a, const std::vector<U>& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T, size_t N, typename U>
+bool operator==(const std::vector<U>& a, const SmallVector<T, N>& b) {
+  return b == a;
+}
+
+template <typename T, size_t N, typename U>
+bool operator!=(const SmallVector<T, N>& a, const std::vector<U>& b) {
+  return !(a == b);
+}
+
+template <typename T, size_t N, typename U>
+bool operator!=(const std::vector<U>& a, const SmallVector<T, N>& b) {
+  return !(b == a);
+}
+
+template <typename T, size_t N>
+std::ostream& operator<<(std::ostream& out, const SmallVector<T, N>& values) {
+  bool first = true;
+  for (const auto& value : values) {
+    if (!first) {
+      out << ' ';
+    }
+    out << value;
+    first = false;
+  }
+  return out;
+}
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_SMALL_VECTOR_H_
@@ -0,0 +1,71 @@
+#include <cstdint>
+#include <vector>
+
+#include "caffe2/utils/small_vector.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+TEST(SmallVectorTest, StaysInlineUpToCapacity) {
+  SmallVector<int64_t, 4> v;
+  EXPECT_TRUE(v.empty());
+  for (int i = 0; i < 4; ++i) {
+    v.push_back(i);
+  }
+  EXPECT_TRUE(v.is_inline());
+  EXPECT_EQ(v.size(), 4);
+  v.push_back(4);
+  EXPECT_FALSE(v.is_inline());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(v[i], i);
+  }
+  v.resize(2);
+  EXPECT_EQ(v.back(), 1);
+}
+
+TEST(SmallVectorTest, CopyAndMove) {
+  SmallVector<int64_t, 2> small{1, 2};
+  SmallVector<int64_t, 2> large{1, 2, 3, 4};
+  auto small_copy = small;
+  auto large_copy = large;
+  EXPECT_TRUE(small_copy.is_inline());
+  EXPECT_EQ(small_copy, small);
+  EXPECT_EQ(large_copy, large);
+  large_copy[0] = 5;
+  EXPECT_EQ(large[0], 1);
+
+  auto moved = std::move(large_copy);
+  EXPECT_EQ(moved.size(), 4);
+  EXPECT_EQ(moved[0], 5);
+  EXPECT_TRUE(large_copy.empty());
+
+  moved.swap(small_copy);
+  EXPECT_EQ(moved, small);
+  EXPECT_EQ(small_copy.size(), 4);
+}
+
+TEST(SmallVectorTest, InsertAndErase) {
+  SmallVector<int64_t, 3> v{1, 4};
+  v.insert(v.begin() + 1, {2, 3});
+  EXPECT_EQ(v, std::vector<int64_t>({1, 2, 3, 4}));
+  // Inserting a part of itself
+  v.insert(v.end(), v.begin(), v.begin() + 2);
+  EXPECT_EQ(v, std::vector<int64_t>({1, 2, 3, 4, 1, 2}));
+  v.erase(v.begin(), v.begin() + 4);
+  EXPECT_EQ(v, std::vector<int64_t>({1, 2}));
+  v.erase(v.begin());
+  v.insert(v.begin(), 7);
+  EXPECT_EQ(v, std::vector<int64_t>({7, 2}));
+}
+
+TEST(SmallVectorTest, ConvertsToVector) {
+  SmallVector<int64_t, 3> v{3, 4};
+  std::vector<int64_t> converted = v;
+  EXPECT_EQ(converted, std::vector<int64_t>({3, 4}));
+  EXPECT_TRUE(converted == v);
+  EXPECT_TRUE(v != std::vector<int64_t>({3}));
+  v = std::vector<int>{5, 6, 7, 8};
+  EXPECT_EQ(v, std::vector<int64_t>({5, 6, 7, 8}));
+}
+
+} // namespace caffe2
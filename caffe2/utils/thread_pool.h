@@ -9,10 +9,22 @@
 #include <utility>
 
 #include "caffe2/core/numa.h"
+#include "caffe2/core/static_tracepoint.h"
 
 namespace caffe2 {
 
-class TaskThreadPool {
+// Interface of the thread pools used by the async net executors; pools are
+// created through ThreadPoolRegistry (see core/net_async_base.h)
+class TaskThreadPoolBase {
+ public:
+  virtual void run(const std::function<void()>& func) = 0;
+
+  virtual std::size_t size() const = 0;
+
+  virtual ~TaskThreadPoolBase() noexcept {}
+};
+
+class TaskThreadPool : public TaskThreadPoolBase {
  private:
   struct task_element_t {
     bool run_with_id;
@@ -50,7 +62,7 @@ class TaskThreadPool {
   }
 
   // Set running flag to false then notify all threads.
-  ~TaskThreadPool() {
+  ~TaskThreadPool() override {
     {
       std::unique_lock<std::mutex> lock(mutex_);
       running_ = false;
@@ -74,13 +86,18 @@ class TaskThreadPool {
     // wake up and use the task.
     tasks_.push(task_element_t(static_cast<std::function<void()>>(task)));
     complete_ = false;
+    CAFFE_SDT(task_enqueue, (void*)this, 0);
     condition_.notify_one();
   }
 
-  void run(const std::function<void()>& func) {
+  void run(const std::function<void()>& func) override {
     runTask(func);
   }
 
+  std::size_t size() const override {
+    return total_;
+  }
+
   template <typename Task>
   void runTaskWithID(Task task) {
     std::unique_lock<std::mutex> lock(mutex_);
@@ -90,6 +107,7 @@ class TaskThreadPool {
     tasks_.push(
         task_element_t(static_cast<std::function<void(std::size_t)>>(task)));
     complete_ = false;
+    CAFFE_SDT(task_enqueue, (void*)this, 0);
     condition_.notify_one();
   }
 
@@ -126,6 +144,7 @@ class TaskThreadPool {
       {
         auto tasks = tasks_.front();
         tasks_.pop();
+        CAFFE_SDT(task_dequeue, (void*)this, 0);
         // Decrement count, indicating thread is no longer available.
         --available_;
 
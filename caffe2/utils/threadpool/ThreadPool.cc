@@ -2,8 +2,23 @@
 #include "WorkersPool.h"
 #include "caffe2/core/logging.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <fstream>
+
 #include <cpuinfo.h>
 
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <sys/qos.h>
+#include <sys/sysctl.h>
+#endif
+
 CAFFE2_DEFINE_bool(caffe2_threadpool_force_inline, false,
                    "Force to always run jobs on the calling thread");
 
@@ -13,6 +28,12 @@ CAFFE2_DEFINE_int(caffe2_threadpool_android_cap, true, "");
 // Whether or not threadpool caps apply to iOS
 CAFFE2_DEFINE_int(caffe2_threadpool_ios_cap, true, "");
 
+CAFFE2_DEFINE_string(
+    caffe2_threadpool_cores,
+    "all",
+    "The cores the default thread pool runs on: all, big (for latency) or "
+    "little (for battery life)");
+
 
 namespace caffe2 {
 
@@ -24,6 +45,126 @@ constexpr size_t kDefaultMinWorkSize = 8;
 constexpr size_t kDefaultMinWorkSize = 80;
 #endif
 
+namespace {
+
+// Fraction of the throughput measured by a call of run() in the weights
+constexpr double kWeightUpdate = 0.25;
+
+// Shortest task whose time measures the throughput of its thread
+constexpr auto kMinMeasuredTime = std::chrono::microseconds(20);
+
+// The relative performance of each core: its capacity for the energy aware
+// scheduler, or else its maximum frequency. Empty when unknown.
+std::vector<uint64_t> corePerformance() {
+  std::vector<uint64_t> performance;
+#if defined(__linux__)
+  const long numCores = sysconf(_SC_NPROCESSORS_CONF);
+  for (long cpu = 0; cpu < numCores; ++cpu) {
+    const std::string dir =
+        "/sys/devices/system/cpu/cpu" + caffe2::to_string(cpu) + "/";
+    uint64_t value = 0;
+    for (const char* file : {"cpu_capacity", "cpufreq/cpuinfo_max_freq"}) {
+      std::ifstream stream(dir + file);
+      if (stream >> value) {
+        break;
+      }
+      value = 0;
+    }
+    if (value == 0) {
+      return {};
+    }
+    performance.push_back(value);
+  }
+#endif
+  return performance;
+}
+
+bool isHeterogeneous() {
+  const auto performance = corePerformance();
+  return !performance.empty() &&
+      *std::min_element(performance.begin(), performance.end()) !=
+      *std::max_element(performance.begin(), performance.end());
+}
+
+// The cpus of cores, empty when unknown: kBig has all but the slowest
+// cluster, all the cores on a homogeneous CPU, and kLittle the slowest one.
+std::vector<int> coresCpus(ThreadPoolCores cores) {
+  const auto performance = corePerformance();
+  std::vector<int> cpus;
+  if (performance.empty()) {
+    return cpus;
+  }
+  const uint64_t slowest =
+      *std::min_element(performance.begin(), performance.end());
+  const bool heterogeneous =
+      slowest != *std::max_element(performance.begin(), performance.end());
+  for (int cpu = 0; cpu < performance.size(); ++cpu) {
+    if (cores == ThreadPoolCores::kAll || !heterogeneous ||
+        (cores == ThreadPoolCores::kBig) == (performance[cpu] > slowest)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The number of cores of type cores, or 0 when unknown
+size_t numCores(ThreadPoolCores cores) {
+#if defined(__APPLE__)
+  // The performance levels, from the fastest, of iOS 15 and macOS 12
+  int count = 0;
+  size_t size = sizeof(count);
+  const char* name = cores == ThreadPoolCores::kLittle
+      ? "hw.perflevel1.logicalcpu"
+      : "hw.perflevel0.logicalcpu";
+  if (cores != ThreadPoolCores::kAll &&
+      sysctlbyname(name, &count, &size, nullptr, 0) == 0 && count > 0) {
+    return count;
+  }
+  return 0;
+#else
+  return coresCpus(cores).size();
+#endif
+}
+
+// Moves the calling thread to cpus, or on iOS to the QoS class whose threads
+// are scheduled on cores
+void moveThreadToCores(ThreadPoolCores cores, const std::vector<int>& cpus) {
+#if defined(__linux__)
+  if (cpus.empty()) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    LOG(WARNING) << "Failed to set the affinity of a thread pool thread";
+  }
+#elif defined(__APPLE__)
+  qos_class_t qos = QOS_CLASS_USER_INITIATED;
+  if (cores == ThreadPoolCores::kBig) {
+    qos = QOS_CLASS_USER_INTERACTIVE;
+  } else if (cores == ThreadPoolCores::kLittle) {
+    qos = QOS_CLASS_UTILITY;
+  }
+  pthread_set_qos_class_self_np(qos, 0);
+#endif
+}
+
+} // namespace
+
+ThreadPoolCores ParseThreadPoolCores(const std::string& cores) {
+  if (cores == "all") {
+    return ThreadPoolCores::kAll;
+  } else if (cores == "big") {
+    return ThreadPoolCores::kBig;
+  } else if (cores == "little") {
+    return ThreadPoolCores::kLittle;
+  }
+  CAFFE_THROW("Unknown thread pool cores: ", cores);
+}
+
 std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
   CAFFE_ENFORCE(cpuinfo_initialize(), "cpuinfo initialization failed");
   int numThreads = cpuinfo_get_processors_count();
@@ -77,11 +218,18 @@ std::unique_ptr<ThreadPool> ThreadPool::defaultThreadPool() {
     }
   }
   LOG(INFO) << "Constructing thread pool with " << numThreads << " threads";
-  return caffe2::make_unique<ThreadPool>(numThreads);
+  auto pool = caffe2::make_unique<ThreadPool>(numThreads);
+  const auto cores = ParseThreadPoolCores(FLAGS_caffe2_threadpool_cores);
+  if (cores != ThreadPoolCores::kAll) {
+    pool->setCores(cores);
+  }
+  return pool;
 }
 
 ThreadPool::ThreadPool(int numThreads)
     : minWorkSize_(kDefaultMinWorkSize), numThreads_(numThreads),
+      defaultNumThreads_(numThreads), cores_(ThreadPoolCores::kAll),
+      weighted_(isHeterogeneous()),
       workersPool_(std::make_shared<WorkersPool>()) {}
 
 ThreadPool::~ThreadPool() {}
@@ -99,6 +247,35 @@ void ThreadPool::setMinWorkSize(size_t size) {
   minWorkSize_ = size;
 }
 
+void ThreadPool::setCores(ThreadPoolCores cores) {
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  const auto cpus = coresCpus(cores);
+  const size_t count = numCores(cores);
+  if (cores != ThreadPoolCores::kAll && count == 0) {
+    LOG(WARNING) << "Unknown core types, keeping " << defaultNumThreads_
+                 << " threads";
+  }
+  cores_ = cores;
+  numThreads_ = count > 0 && cores != ThreadPoolCores::kAll
+      ? count
+      : defaultNumThreads_;
+  weights_.clear();
+  workersPool_->SetThreadSetup(
+      [cores, cpus]() { moveThreadToCores(cores, cpus); });
+  LOG(INFO) << "Running the thread pool on " << numThreads_ << " threads";
+}
+
+ThreadPoolCores ThreadPool::getCores() const {
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  return cores_;
+}
+
+void ThreadPool::setWeightedPartitioning(bool weighted) {
+  std::lock_guard<std::mutex> guard(executionMutex_);
+  weighted_ = weighted;
+  weights_.clear();
+}
+
 void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
   std::lock_guard<std::mutex> guard(executionMutex_);
   // If there are no worker threads, or if the range is too small (too
@@ -122,15 +299,17 @@ void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
     int idx_;
     size_t start_;
     size_t end_;
+    std::chrono::steady_clock::duration time_;
     virtual void Run() override {
+      const auto start = std::chrono::steady_clock::now();
       for (auto i = start_; i < end_; ++i) {
         (*fn_)(idx_, i);
       }
+      time_ = std::chrono::steady_clock::now() - start;
     }
   };
 
   CAFFE_ENFORCE_GE(numThreads_, 1);
-  const size_t unitsPerTask = (range + numThreads_ - 1) / numThreads_;
   tasks_.resize(numThreads_);
   for (size_t i = 0; i < numThreads_; ++i) {
     if (!tasks_[i]) {
@@ -139,18 +318,73 @@ void ThreadPool::run(const std::function<void(int, size_t)>& fn, size_t range) {
     auto *task = (FnTask *)tasks_[i].get();
     task->fn_ = &fn;
     task->idx_ = i;
-    task->start_ = std::min<size_t>(range, i * unitsPerTask);
-    task->end_ = std::min<size_t>(range, (i + 1) * unitsPerTask);
-    if (task->start_ >= task->end_) {
-      tasks_.resize(i);
-      break;
+  }
+
+  // Split in proportion to the weights, as long as every task gets work
+  if (weighted_ && weights_.size() != numThreads_) {
+    weights_.assign(numThreads_, 1.0);
+  }
+  bool weighted = weighted_ && range >= numThreads_;
+  if (weighted) {
+    double totalWeight = 0;
+    for (auto weight : weights_) {
+      totalWeight += weight;
+    }
+    double weight = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < numThreads_; ++i) {
+      auto *task = (FnTask *)tasks_[i].get();
+      weight += weights_[i];
+      task->start_ = start;
+      task->end_ = i == numThreads_ - 1
+          ? range
+          : std::min<size_t>(range, std::llround(range * weight / totalWeight));
+      if (task->start_ >= task->end_) {
+        weighted = false;
+        break;
+      }
+      start = task->end_;
+    }
+  }
+  if (!weighted) {
+    const size_t unitsPerTask = (range + numThreads_ - 1) / numThreads_;
+    for (size_t i = 0; i < numThreads_; ++i) {
+      auto *task = (FnTask *)tasks_[i].get();
+      task->start_ = std::min<size_t>(range, i * unitsPerTask);
+      task->end_ = std::min<size_t>(range, (i + 1) * unitsPerTask);
+      if (task->start_ >= task->end_) {
+        tasks_.resize(i);
+        break;
+      }
+      CAFFE_ENFORCE_LE(task->start_, range);
+      CAFFE_ENFORCE_LE(task->end_, range);
     }
-    CAFFE_ENFORCE_LE(task->start_, range);
-    CAFFE_ENFORCE_LE(task->end_, range);
   }
   CAFFE_ENFORCE_LE(tasks_.size(), numThreads_);
   CAFFE_ENFORCE_GE(tasks_.size(), 1);
   workersPool_->Execute(tasks_);
+
+  if (!weighted_ || tasks_.size() != numThreads_) {
+    return;
+  }
+  // Moves the weights towards the measured throughput, relative to the
+  // average one
+  double totalRate = 0;
+  for (size_t i = 0; i < numThreads_; ++i) {
+    const auto* task = (const FnTask*)tasks_[i].get();
+    if (task->time_ < kMinMeasuredTime) {
+      return;
+    }
+    totalRate += (task->end_ - task->start_) /
+        std::chrono::duration<double>(task->time_).count();
+  }
+  for (size_t i = 0; i < numThreads_; ++i) {
+    const auto* task = (const FnTask*)tasks_[i].get();
+    const double rate = (task->end_ - task->start_) /
+        std::chrono::duration<double>(task->time_).count();
+    weights_[i] = (1 - kWeightUpdate) * weights_[i] +
+        kWeightUpdate * rate * numThreads_ / totalRate;
+  }
 }
 
 void ThreadPool::withPool(const std::function<void(WorkersPool*)>& f) {
@@ -158,4 +392,35 @@ void ThreadPool::withPool(const std::function<void(WorkersPool*)>& f) {
   f(workersPool_.get());
 }
 
+void ThreadPool::runRanges(
+    size_t num,
+    const std::function<void(size_t)>& fn) {
+  struct RangeTask : public Task {
+    const std::function<void(size_t)>* fn;
+    size_t range;
+    std::exception_ptr error;
+    void Run() override {
+      try {
+        (*fn)(range);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::shared_ptr<Task>> tasks;
+  for (size_t i = 0; i < num; ++i) {
+    auto task = std::make_shared<RangeTask>();
+    task->fn = &fn;
+    task->range = i;
+    tasks.push_back(task);
+  }
+  withPool([&](WorkersPool* pool) { pool->Execute(tasks); });
+  for (const auto& task : tasks) {
+    const auto& error = static_cast<RangeTask*>(task.get())->error;
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
 } // namespace caffe2
@@ -6,6 +6,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 //
@@ -19,6 +20,19 @@ class WorkersPool;
 
 constexpr size_t kCacheLineSize = 64;
 
+// The cores of a heterogeneous (big.LITTLE) CPU that a ThreadPool runs on
+enum class ThreadPoolCores {
+  // All the cores, with the number of threads the pool was created with
+  kAll,
+  // The fastest cluster of cores only, for latency
+  kBig,
+  // The slowest cluster of cores only, for battery life
+  kLittle,
+};
+
+// Parses "all", "big" or "little"
+ThreadPoolCores ParseThreadPoolCores(const std::string& cores);
+
 // A work-stealing threadpool with the given number of threads.
 // NOTE: the kCacheLineSize alignment is present only for cache
 // performance, and is not strictly enforced (for example, when
@@ -40,14 +54,38 @@ class alignas(kCacheLineSize) ThreadPool {
   size_t getMinWorkSize() const { return minWorkSize_; }
   void run(const std::function<void(int, size_t)>& fn, size_t range);
 
+  // Runs the threads on the given cores: pinned to them on Linux and
+  // Android, and with the matching QoS class on iOS, which cannot pin
+  // threads. kBig and kLittle use one thread per core of their cluster.
+  void setCores(ThreadPoolCores cores);
+  ThreadPoolCores getCores() const;
+
+  // Whether run() splits the range between the threads in proportion to
+  // their throughput measured over the previous calls, rather than evenly.
+  // On by default on heterogeneous CPUs, where an even split finishes at the
+  // speed of the slowest cores.
+  void setWeightedPartitioning(bool weighted);
+
   // Run an arbitrary function in a thread-safe manner accessing the Workers
   // Pool
   void withPool(const std::function<void(WorkersPool*)>& fn);
 
+  // Runs fn(0) .. fn(num - 1) as one task each on the Workers Pool, whatever
+  // the minimum work size, and rethrows the first exception thrown by fn on
+  // the calling thread
+  void runRanges(size_t num, const std::function<void(size_t)>& fn);
+
  private:
   mutable std::mutex executionMutex_;
   size_t minWorkSize_;
   size_t numThreads_;
+  // The number of threads for kAll
+  size_t defaultNumThreads_;
+  ThreadPoolCores cores_;
+  bool weighted_;
+  // The relative throughput of the task of each thread, the first one run on
+  // the calling thread, averaged over the calls of run()
+  std::vector<double> weights_;
   std::shared_ptr<WorkersPool> workersPool_;
   std::vector<std::shared_ptr<Task>> tasks_;
 };
@@ -3,6 +3,7 @@
 #include "caffe2/core/common.h"
 #include "caffe2/core/logging.h"
 #include <atomic>
+#include <functional>
 #include <thread>
 #include <condition_variable>
 
@@ -277,6 +278,12 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
       case State::HasWork:
         // Got work to do! So do it, and then revert to 'Ready' state.
         DCHECK(task_);
+        if (setup_ != applied_setup_) {
+          applied_setup_ = setup_;
+          if (applied_setup_) {
+            (*applied_setup_)();
+          }
+        }
         task_->Run();
         task_ = nullptr;
         ChangeState(State::Ready);
@@ -294,6 +301,13 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
     return nullptr;
   }
 
+  // Called by the master thread to have this worker run setup on its
+  // thread before its next task. It is only legal to call this if the
+  // worker is not working.
+  void SetSetup(const std::shared_ptr<std::function<void()>>& setup) {
+    setup_ = setup;
+  }
+
   // Called by the master thead to give this worker work to do.
   // It is only legal to call this if the worker
   void StartWork(Task* task) {
@@ -311,6 +325,10 @@ class alignas(kGEMMLOWPCacheLineSize) Worker {
   // Visibility of writes to task_ guarded by state_mutex_.
   Task* task_;
 
+  // The setup to run on the thread, and the one last run, set like task_.
+  std::shared_ptr<std::function<void()>> setup_;
+  std::shared_ptr<std::function<void()>> applied_setup_;
+
   // The condition variable and mutex guarding state changes.
   std::condition_variable state_cond_;
   std::mutex state_mutex_;
@@ -344,6 +362,15 @@ class WorkersPool {
     counter_to_decrement_when_ready_.Wait();
   }
 
+  // Runs setup on each worker thread, current or future, before its next
+  // task, e.g. to set the affinity of the thread.
+  void SetThreadSetup(std::function<void()> setup) {
+    thread_setup_ = std::make_shared<std::function<void()>>(std::move(setup));
+    for (auto& worker : workers_) {
+      worker->SetSetup(thread_setup_);
+    }
+  }
+
  private:
   // Ensures that the pool has at least the given count of workers.
   // If any new worker has to be created, this function waits for it to
@@ -355,6 +382,7 @@ class WorkersPool {
     counter_to_decrement_when_ready_.Reset(workers_count - workers_.size());
     while (workers_.size() < workers_count) {
       workers_.push_back(MakeAligned<Worker>::make(&counter_to_decrement_when_ready_));
+      workers_.back()->SetSetup(thread_setup_);
     }
     counter_to_decrement_when_ready_.Wait();
   }
@@ -363,5 +391,6 @@ class WorkersPool {
   std::vector<std::unique_ptr<Worker, AlignedDeleter<Worker>>> workers_;
   // The BlockingCounter used to wait for the workers.
   BlockingCounter counter_to_decrement_when_ready_;
+  std::shared_ptr<std::function<void()>> thread_setup_;
 };
 } // namespace caffe2
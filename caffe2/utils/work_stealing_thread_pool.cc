@@ -0,0 +1,134 @@
+#include "caffe2/utils/work_stealing_thread_pool.h"
+
+#include "caffe2/core/numa.h"
+#include "caffe2/core/static_tracepoint.h"
+
+namespace caffe2 {
+
+namespace {
+// Pool and queue index of the worker running on the current thread
+thread_local const WorkStealingThreadPool* current_pool_ = nullptr;
+thread_local std::size_t current_index_ = 0;
+} // namespace
+
+WorkStealingThreadPool::WorkStealingThreadPool(
+    std::size_t pool_size,
+    int numa_node_id)
+    : next_queue_(0),
+      pending_(0),
+      idle_(0),
+      running_(true),
+      numa_node_id_(numa_node_id) {
+  CAFFE_ENFORCE_GT(pool_size, 0, "Empty work stealing thread pool");
+  queues_.reserve(pool_size);
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    queues_.emplace_back(new WorkerQueue());
+  }
+  threads_.reserve(pool_size);
+  for (std::size_t i = 0; i < pool_size; ++i) {
+    threads_.emplace_back(&WorkStealingThreadPool::main_loop, this, i);
+  }
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    running_ = false;
+    sleep_cv_.notify_all();
+  }
+
+  try {
+    for (auto& t : threads_) {
+      t.join();
+    }
+  } catch (const std::exception&) {
+  }
+}
+
+bool WorkStealingThreadPool::inThreadPool() const {
+  return current_pool_ == this;
+}
+
+void WorkStealingThreadPool::run(const std::function<void()>& func) {
+  std::size_t index;
+  if (inThreadPool()) {
+    index = current_index_;
+  } else {
+    index = next_queue_++ % queues_.size();
+  }
+  {
+    auto& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(func);
+  }
+  CAFFE_SDT(task_enqueue, (void*)this, index);
+  ++pending_;
+  // Workers increment idle_ under sleep_mutex_ before checking pending_, so
+  // either the worker sees the new task or we see the sleeping worker
+  if (idle_ > 0) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    sleep_cv_.notify_one();
+  }
+}
+
+bool WorkStealingThreadPool::popLocal(
+    std::size_t index,
+    std::function<void()>* task) {
+  auto& queue = *queues_[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  *task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  CAFFE_SDT(task_dequeue, (void*)this, index);
+  return true;
+}
+
+bool WorkStealingThreadPool::steal(
+    std::size_t index,
+    std::function<void()>* task) {
+  const auto num_queues = queues_.size();
+  for (std::size_t offset = 1; offset < num_queues; ++offset) {
+    const auto victim = (index + offset) % num_queues;
+    auto& queue = *queues_[victim];
+    std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+    if (!lock.owns_lock() || queue.tasks.empty()) {
+      continue;
+    }
+    *task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    CAFFE_SDT(task_steal, (void*)this, index, victim);
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingThreadPool::main_loop(std::size_t index) {
+  NUMABind(numa_node_id_);
+  current_pool_ = this;
+  current_index_ = index;
+
+  while (running_) {
+    std::function<void()> task;
+    if (popLocal(index, &task) || steal(index, &task)) {
+      --pending_;
+      try {
+        task();
+      } catch (const std::exception&) {
+      }
+      continue;
+    }
+
+    // Either there is nothing to do or the victim queues were locked by
+    // other thieves; only go to sleep when no task is pending
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    ++idle_;
+    while (pending_ == 0 && running_) {
+      sleep_cv_.wait(lock);
+    }
+    --idle_;
+  }
+}
+
+} // namespace caffe2
@@ -0,0 +1,68 @@
+#ifndef CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
+#define CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "caffe2/core/common.h"
+#include "caffe2/utils/thread_pool.h"
+
+namespace caffe2 {
+
+/**
+ * A thread pool in which every worker owns a task deque. Tasks submitted from
+ * a worker thread of the pool go to that worker's own deque and are taken in
+ * LIFO order, so that work spawned by a task (e.g. the children of a finished
+ * chain) runs next on the same thread, while its inputs are still in cache.
+ * Tasks submitted from outside of the pool are distributed round-robin.
+ * Idle workers steal from the opposite (oldest) end of the other deques.
+ */
+class WorkStealingThreadPool : public TaskThreadPoolBase {
+ public:
+  explicit WorkStealingThreadPool(std::size_t pool_size, int numa_node_id = -1);
+  ~WorkStealingThreadPool() override;
+
+  void run(const std::function<void()>& func) override;
+
+  std::size_t size() const override {
+    return threads_.size();
+  }
+
+  // Whether the calling thread is one of the workers of this pool
+  bool inThreadPool() const;
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void main_loop(std::size_t index);
+  bool popLocal(std::size_t index, std::function<void()>* task);
+  bool steal(std::size_t index, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_queue_;
+
+  // Number of tasks pushed and not yet taken by a worker, and number of
+  // workers sleeping on sleep_cv_
+  std::atomic<int> pending_;
+  std::atomic<int> idle_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+  std::atomic<bool> running_;
+  int numa_node_id_;
+
+  DISABLE_COPY_AND_ASSIGN(WorkStealingThreadPool);
+};
+
+} // namespace caffe2
+
+#endif // CAFFE2_UTILS_WORK_STEALING_THREAD_POOL_H_
@@ -0,0 +1,67 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "caffe2/utils/work_stealing_thread_pool.h"
+#include <gtest/gtest.h>
+
+namespace caffe2 {
+
+namespace {
+
+void WaitForCount(
+    std::mutex& mutex,
+    std::condition_variable& cv,
+    const std::atomic<int>& count,
+    int expected) {
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&]() { return count == expected; });
+}
+
+} // namespace
+
+TEST(WorkStealingThreadPoolTest, RunsAllTasks) {
+  WorkStealingThreadPool pool(4);
+  EXPECT_EQ(4, pool.size());
+  EXPECT_FALSE(pool.inThreadPool());
+
+  const int kNumTasks = 1000;
+  std::atomic<int> count(0);
+  std::mutex mutex;
+  std::condition_variable cv;
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.run([&]() {
+      if (++count == kNumTasks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    });
+  }
+  WaitForCount(mutex, cv, count, kNumTasks);
+}
+
+TEST(WorkStealingThreadPoolTest, NestedTasksStayOnWorker) {
+  WorkStealingThreadPool pool(4);
+
+  const int kNumTasks = 100;
+  std::atomic<int> count(0);
+  std::atomic<bool> in_pool(true);
+  std::mutex mutex;
+  std::condition_variable cv;
+  for (int i = 0; i < kNumTasks; ++i) {
+    pool.run([&]() {
+      // Children are pushed into the worker's own queue
+      pool.run([&]() {
+        in_pool = in_pool && pool.inThreadPool();
+        if (++count == kNumTasks) {
+          std::lock_guard<std::mutex> lock(mutex);
+          cv.notify_all();
+        }
+      });
+    });
+  }
+  WaitForCount(mutex, cv, count, kNumTasks);
+  EXPECT_TRUE(in_pool);
+}
+
+} // namespace caffe2
@@ -36,6 +36,22 @@ class ZmqMessage {
     CAFFE_ENFORCE_EQ(rc, 0);
   }
 
+  // Takes over the string without copying it, zmq frees it once the message
+  // is sent.
+  explicit ZmqMessage(string&& data) {
+    auto* owned = new string(std::move(data));
+    int rc = zmq_msg_init_data(
+        &msg_,
+        &(*owned)[0],
+        owned->size(),
+        [](void* /*data*/, void* hint) { delete static_cast<string*>(hint); },
+        owned);
+    if (rc != 0) {
+      delete owned;
+    }
+    CAFFE_ENFORCE_EQ(rc, 0);
+  }
+
   ~ZmqMessage() {
     int rc = zmq_msg_close(&msg_);
     CAFFE_ENFORCE_EQ(rc, 0);
@@ -45,6 +61,7 @@ class ZmqMessage {
 
   void* data() { return zmq_msg_data(&msg_); }
   size_t size() { return zmq_msg_size(&msg_); }
+  bool more() { return zmq_msg_more(&msg_) != 0; }
 
  private:
   zmq_msg_t msg_;
@@ -63,6 +80,8 @@ class ZmqSocket {
     CAFFE_ENFORCE_EQ(rc, 0);
   }
 
+  void* ptr() { return ptr_; }
+
   void Bind(const string& addr) {
     int rc = zmq_bind(ptr_, addr.c_str());
     CAFFE_ENFORCE_EQ(rc, 0);
@@ -83,6 +102,11 @@ class ZmqSocket {
     CAFFE_ENFORCE_EQ(rc, 0);
   }
 
+  void SetOption(int option, int value) {
+    int rc = zmq_setsockopt(ptr_, option, &value, sizeof(value));
+    CAFFE_ENFORCE_EQ(rc, 0);
+  }
+
   int Send(const string& msg, int flags) {
     int nbytes = zmq_send(ptr_, msg.c_str(), msg.size(), flags);
     if (nbytes) {
@@ -118,6 +142,32 @@ class ZmqSocket {
     }
   }
 
+  // Sends the message without copying its data, the message is empty
+  // afterwards.
+  void SendMessage(ZmqMessage* msg, int flags) {
+    int nbytes = 0;
+    do {
+      nbytes = zmq_msg_send(msg->msg(), ptr_, flags);
+    } while (nbytes < 0 && (zmq_errno() == EAGAIN || zmq_errno() == EINTR));
+    CAFFE_ENFORCE_GE(
+        nbytes, 0, "Cannot send zmq message. Error number: ", zmq_errno());
+  }
+
+  // Unlike Recv(), also accepts empty messages. Returns false if no message
+  // arrived, e.g. within the receive timeout or with ZMQ_DONTWAIT.
+  bool TryRecv(ZmqMessage* msg, int flags = 0) {
+    int nbytes = zmq_msg_recv(msg->msg(), ptr_, flags);
+    if (nbytes >= 0) {
+      return true;
+    } else if (zmq_errno() == EAGAIN || zmq_errno() == EINTR) {
+      return false;
+    } else {
+      LOG(FATAL) << "Cannot receive zmq message. Error number: "
+                 << zmq_errno();
+      return false;
+    }
+  }
+
   int RecvTillSuccess(ZmqMessage* msg) {
     int nbytes = 0;
     do {
@@ -118,24 +118,7 @@ void VideoDecoder::decodeLoop(
       return;
     }
 
-    // Initialize codec
-    AVDictionary* opts = nullptr;
     videoCodecContext_ = videoStream_->codec;
-    try {
-      ret = avcodec_open2(
-          videoCodecContext_,
-          avcodec_find_decoder(videoCodecContext_->codec_id),
-          &opts);
-    } catch (const std::exception&) {
-      LOG(ERROR) << "Exception during open video codec";
-      return;
-    }
-
-    if (ret < 0) {
-      LOG(ERROR) << "Cannot open video codec : "
-                 << videoCodecContext_->codec->name;
-      return;
-    }
 
     // Calculate if we need to rescale the frames
     int origWidth = videoCodecContext_->width;
@@ -175,10 +158,47 @@ void VideoDecoder::decodeLoop(
       LOG(ERROR) << "Unknown video_res_type: " << params.video_res_type_;
     }
 
+    // Initialize codec
+    AVDictionary* opts = nullptr;
+    AVCodec* codec = avcodec_find_decoder(videoCodecContext_->codec_id);
+    if (codec == nullptr) {
+      LOG(ERROR) << "Unable to find video codec in " << videoName;
+      return;
+    }
+
+    if (params.decode_lowres_ && outWidth > 0 && outHeight > 0) {
+      // Halve the decoded resolution as long as it stays at least the
+      // output resolution
+      int lowres = 0;
+      while (lowres < codec->max_lowres &&
+             (origWidth >> (lowres + 1)) >= outWidth &&
+             (origHeight >> (lowres + 1)) >= outHeight) {
+        lowres++;
+      }
+      if (lowres > 0) {
+        av_dict_set_int(&opts, "lowres", lowres, 0);
+      }
+    }
+
+    try {
+      ret = avcodec_open2(videoCodecContext_, codec, &opts);
+    } catch (const std::exception&) {
+      LOG(ERROR) << "Exception during open video codec";
+      av_dict_free(&opts);
+      return;
+    }
+    av_dict_free(&opts);
+
+    if (ret < 0) {
+      LOG(ERROR) << "Cannot open video codec : " << codec->name;
+      return;
+    }
+
     // Make sure that we have a valid format
     CAFFE_ENFORCE_NE(videoCodecContext_->pix_fmt, AV_PIX_FMT_NONE);
 
-    // Create a scale context
+    // Create a scale context, from the decoded resolution which lowres
+    // decoding reduces
     scaleContext_ = sws_getContext(
         videoCodecContext_->width,
         videoCodecContext_->height,
@@ -241,8 +261,12 @@ void VideoDecoder::decodeLoop(
 
     /* identify the starting point from where we must start decoding */
     std::mt19937 meta_randgen(time(nullptr));
-    int start_ts = -1;
+    int64_t start_ts = -1;
     bool mustDecodeAll = false;
+    // start timestamps of the clips sampled uniformly, and the clip being
+    // decoded
+    std::vector<int64_t> clipStarts;
+    int clip = 0;
     if (videoStream_->duration > 0 && videoStream_->nb_frames > 0) {
       /* we have a valid duration and nb_frames. We can safely
        * detect an intermediate timestamp to start decoding from. */
@@ -267,7 +291,7 @@ void VideoDecoder::decodeLoop(
         ret = av_seek_frame(
             inputContext,
             videoStreamIndex_,
-            std::max(0, start_ts - margin),
+            std::max<int64_t>(0, start_ts - margin),
             AVSEEK_FLAG_BACKWARD);
 
         // if we need to decode from the start_frm
@@ -278,7 +302,31 @@ void VideoDecoder::decodeLoop(
         ret = av_seek_frame(
             inputContext,
             videoStreamIndex_,
-            std::max(0, start_ts - margin),
+            std::max<int64_t>(0, start_ts - margin),
+            AVSEEK_FLAG_BACKWARD);
+      } else if (
+          params.decode_type_ == DecodeType::DO_UNIFORM_SMP &&
+          params.num_of_clips_ > 0) {
+        // spread the clips between the start of the video and the last
+        // timestamp leaving enough frames for a clip, and only decode the
+        // frames from the key frame before every clip
+        double maxFramesDuration =
+            (videoStream_->duration * params.num_of_required_frame_) /
+            (videoStream_->nb_frames);
+        int64_t lastStart =
+            videoStream_->duration - int64_t(ceil(maxFramesDuration));
+        lastStart = lastStart > 0 ? lastStart : 0;
+        for (int i = 0; i < params.num_of_clips_; i++) {
+          clipStarts.push_back(
+              params.num_of_clips_ > 1
+                  ? (lastStart * i) / (params.num_of_clips_ - 1)
+                  : 0);
+        }
+        start_ts = clipStarts[0];
+        ret = av_seek_frame(
+            inputContext,
+            videoStreamIndex_,
+            std::max<int64_t>(0, start_ts - margin),
             AVSEEK_FLAG_BACKWARD);
       } else {
         mustDecodeAll = true;
@@ -289,6 +337,7 @@ void VideoDecoder::decodeLoop(
         /* fall back to default decoding of all frames from start */
         av_seek_frame(inputContext, videoStreamIndex_, 0, AVSEEK_FLAG_BACKWARD);
         mustDecodeAll = true;
+        clipStarts.clear();
       }
     } else {
       /* we do not have the necessary metadata to selectively decode frames.
@@ -305,6 +354,11 @@ void VideoDecoder::decodeLoop(
     int maxFrames = (params.decode_type_ == DecodeType::DO_UNIFORM_SMP)
         ? MAX_DECODING_FRAMES
         : params.num_of_required_frame_;
+    if (!clipStarts.empty()) {
+      maxFrames = clipStarts.size() * params.num_of_required_frame_;
+    }
+    // timestamp of the last decoded frame
+    int64_t lastDecodedTs = -1;
     // There is a delay between reading packets from the
     // transport and getting decoded frames back.
     // Therefore, after EOF, continue going while
@@ -334,6 +388,15 @@ void VideoDecoder::decodeLoop(
             av_free_packet(&packet);
             continue;
           }
+
+          // The frames before start_ts are only decoded to decode the
+          // frames they are references of, skip the others
+          if (!mustDecodeAll) {
+            videoCodecContext_->skip_frame =
+                (packet.pts != AV_NOPTS_VALUE && packet.pts < start_ts)
+                ? AVDISCARD_NONREF
+                : AVDISCARD_DEFAULT;
+          }
         }
 
         ret = avcodec_decode_video2(
@@ -353,6 +416,7 @@ void VideoDecoder::decodeLoop(
           double frame_ts =
               av_frame_get_best_effort_timestamp(videoStreamFrame_);
           double timestamp = frame_ts * av_q2d(videoStream_->time_base);
+          lastDecodedTs = int64_t(frame_ts);
 
           if ((frame_ts >= start_ts && !mustDecodeAll) || mustDecodeAll) {
             /* process current frame if:
@@ -463,6 +527,25 @@ void VideoDecoder::decodeLoop(
               sampledFrames.push_back(move(frame));
               selectiveDecodedFrames++;
               av_frame_free(&rgbFrame);
+
+              if (!clipStarts.empty() &&
+                  selectiveDecodedFrames % params.num_of_required_frame_ ==
+                      0 &&
+                  selectiveDecodedFrames < maxFrames) {
+                // the clip is complete, go to the next one
+                start_ts = clipStarts[++clip];
+                lastFrameTimestamp = -1.0;
+                if (seekToClip(
+                        inputContext,
+                        videoStream_,
+                        videoStreamIndex_,
+                        std::max<int64_t>(0, start_ts - margin),
+                        start_ts,
+                        lastDecodedTs)) {
+                  avcodec_flush_buffers(videoCodecContext_);
+                  eof = 0;
+                }
+              }
             } catch (const std::exception&) {
               av_frame_free(&rgbFrame);
             }
@@ -516,6 +599,34 @@ void VideoDecoder::decodeFile(
   decodeLoop(file, ioctx, params, start_frm, sampledFrames);
 }
 
+bool VideoDecoder::seekToClip(
+    AVFormatContext* inputContext,
+    AVStream* videoStream,
+    int videoStreamIndex,
+    int64_t seekTs,
+    int64_t startTs,
+    int64_t lastDecodedTs) {
+  if (startTs > lastDecodedTs) {
+    // Keep decoding when the key frame the seek would land on was already
+    // decoded, the frames up to the clip are decoded after a seek anyway
+    int entry = av_index_search_timestamp(
+        videoStream, seekTs, AVSEEK_FLAG_BACKWARD);
+    if (entry >= 0 &&
+        videoStream->index_entries[entry].timestamp <= lastDecodedTs) {
+      return false;
+    }
+  }
+  int ret = av_seek_frame(
+      inputContext, videoStreamIndex, seekTs, AVSEEK_FLAG_BACKWARD);
+  if (ret < 0) {
+    // the frames of the clip are still reached by decoding forward, unless
+    // the clips overlap
+    LOG(ERROR) << "Unable to seek to the next clip " << ffmpegErrorStr(ret);
+    return false;
+  }
+  return true;
+}
+
 string VideoDecoder::ffmpegErrorStr(int result) {
   std::array<char, 128> buf;
   av_strerror(result, buf.data(), buf.size());
@@ -95,6 +95,14 @@ class Params {
   // params for decoding behavior
   int decode_type_ = DecodeType::DO_TMP_JITTER;
   int num_of_required_frame_ = -1;
+  // with DO_UNIFORM_SMP, number of clips of num_of_required_frame_ frames
+  // sampled uniformly. Every clip is decoded from the key frame before it,
+  // and the frames are returned clip after clip. 0 decodes the whole video.
+  int num_of_clips_ = 0;
+  // decode at the smallest resolution, supported by the codec, which is
+  // at least the output resolution, instead of decoding at the original
+  // resolution and scaling down
+  bool decode_lowres_ = false;
 
   // intervals_ control variable sampling fps between different timestamps
   // intervals_ must be ordered strictly ascending by timestamps
@@ -162,6 +170,14 @@ class Params {
     scale_h_ = height;
     return *this;
   }
+
+  /**
+   * Decode at the smallest resolution at least the output resolution
+   */
+  Params& decodeLowres(bool lowres) {
+    decode_lowres_ = lowres;
+    return *this;
+  }
 };
 
 // data structure for storing decoded video frames
@@ -390,6 +406,16 @@ class VideoDecoder {
       int& outHeight,
       int& outWidth);
 
+  // Seeks to the key frame before seekTs for the clip starting at startTs,
+  // unless the key frame was already decoded. Returns whether it sought.
+  bool seekToClip(
+      AVFormatContext* inputContext,
+      AVStream* videoStream,
+      int videoStreamIndex,
+      int64_t seekTs,
+      int64_t startTs,
+      int64_t lastDecodedTs);
+
   void decodeLoop(
       const std::string& videoName,
       VideoIOContext& ioctx,
@@ -52,6 +52,8 @@ class VideoInputOp final : public PrefetchOperator<Context> {
 
   const db::DBReader* reader_;
   CPUContext cpu_context_;
+  // Records of the batch being decoded, reused across batches
+  std::vector<std::string> prefetched_values_;
   TensorCPU prefetched_clip_rgb_;
   TensorCPU prefetched_clip_of_;
   TensorCPU prefetched_label_;
@@ -98,6 +100,7 @@ class VideoInputOp final : public PrefetchOperator<Context> {
   int flow_alg_type_;
   int decode_type_;
   int video_res_type_;
+  bool decode_lowres_;
   bool do_flow_aggregation_;
   bool get_rgb_;
   bool get_optical_flow_;
@@ -231,6 +234,8 @@ void VideoInputOp<Context>::CheckParamsAndPrint() {
   } else {
     LOG(ERROR) << "    Unknown video resolution type";
   }
+  LOG(INFO) << "    Is decoding at a lower resolution enabled: "
+            << decode_lowres_;
 
   if (decode_type_ == DecodeType::DO_TMP_JITTER) {
     LOG(INFO) << "    Do temporal jittering";
@@ -330,6 +335,9 @@ VideoInputOp<Context>::VideoInputOp(
           OperatorBase::template GetSingleArgument<int>("decode_type", 0)),
       video_res_type_(
           OperatorBase::template GetSingleArgument<int>("video_res_type", 0)),
+      decode_lowres_(OperatorBase::template GetSingleArgument<bool>(
+          "decode_lowres",
+          false)),
       do_flow_aggregation_(OperatorBase::template GetSingleArgument<bool>(
           "do_flow_aggregation",
           true)),
@@ -555,6 +563,11 @@ bool VideoInputOp<Context>::GetClipsAndLabelsFromDBValue(
   params.scale_h_ = scale_h_;
   params.decode_type_ = decode_type_;
   params.num_of_required_frame_ = num_of_required_frame_;
+  if (decode_type_ == DecodeType::DO_UNIFORM_SMP) {
+    // only decode the clips instead of the whole video
+    params.num_of_clips_ = clip_per_video_;
+  }
+  params.decode_lowres_ = decode_lowres_;
 
   char* video_buffer = nullptr; // for decoding from buffer
   std::string video_filename; // for decoding from file
@@ -746,6 +759,8 @@ bool VideoInputOp<Context>::Prefetch() {
   }
 
   std::bernoulli_distribution mirror_this_clip(0.5);
+  // read data
+  reader_->ReadBatch(batch_size_, nullptr, &prefetched_values_);
   for (int item_id = 0; item_id < batch_size_; ++item_id) {
     std::mt19937* randgen = &randgen_per_thread[item_id % num_decode_threads_];
 
@@ -769,14 +784,10 @@ bool VideoInputOp<Context>::Prefetch() {
     int* video_id_data = prefetched_video_id_.mutable_data<int>() +
         item_id * clip_per_video_ * multi_crop_count_;
 
-    std::string key, value;
-    // read data
-    reader_->Read(&key, &value);
-
     thread_pool_->runTask(std::bind(
         &VideoInputOp<Context>::DecodeAndTransform,
         this,
-        std::string(value),
+        std::cref(prefetched_values_[item_id]),
         clip_rgb_data,
         clip_of_data,
         label_data,
@@ -549,6 +549,10 @@ if (USE_NNAPI AND NOT ANDROID)
   message(WARNING "NNApi is only used in android builds.")
   set(USE_NNAPI OFF)
 endif()
+if (USE_NNAPI)
+  # ASharedMemory, for the tensors shared by NNApi and the CPU operators
+  list(APPEND Caffe2_DEPENDENCY_LIBS android)
+endif()
 
 if (USE_ATEN)
   list(APPEND Caffe2_DEPENDENCY_LIBS aten_op_header_gen ATen)
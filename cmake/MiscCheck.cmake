@@ -142,6 +142,69 @@ if (CAFFE2_COMPILER_SUPPORTS_AVX2_EXTENSIONS)
 endif()
 cmake_pop_check_state()
 
+# ---[ Check if the compiler has AVX-512 support, with the BW and VL
+# extensions used by the perfkernels.
+cmake_push_check_state(RESET)
+if (MSVC)
+  set(CMAKE_REQUIRED_FLAGS "/arch:AVX512")
+else()
+  set(CMAKE_REQUIRED_FLAGS "-mavx512f -mavx512bw -mavx512vl")
+endif()
+CHECK_CXX_SOURCE_COMPILES(
+    "#include <immintrin.h>
+     int main() {
+       __m512 a = _mm512_set1_ps(1.f);
+       __m128i b = _mm_maskz_loadu_epi8(1, &a);
+       a = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(b));
+       return 0;
+     }" CAFFE2_COMPILER_SUPPORTS_AVX512_EXTENSIONS)
+if (CAFFE2_COMPILER_SUPPORTS_AVX512_EXTENSIONS AND
+    CAFFE2_COMPILER_SUPPORTS_AVX2_EXTENSIONS AND NOT MSVC)
+  message(STATUS "Current compiler supports avx512 extension. Will build avx512 perfkernels.")
+  set(CAFFE2_PERF_WITH_AVX512 1)
+endif()
+cmake_pop_check_state()
+
+# ---[ Check if the compiler has AVX-512 VNNI support, for the int8 dot
+# products of the quantized perfkernels.
+if (CAFFE2_PERF_WITH_AVX512)
+  cmake_push_check_state(RESET)
+  set(CMAKE_REQUIRED_FLAGS "-mavx512f -mavx512bw -mavx512vl -mavx512vnni")
+  CHECK_CXX_SOURCE_COMPILES(
+      "#include <immintrin.h>
+       int main() {
+         __m512i a = _mm512_set1_epi32(1);
+         a = _mm512_dpbusd_epi32(a, a, a);
+         return _mm512_reduce_add_epi32(a);
+       }" CAFFE2_COMPILER_SUPPORTS_AVX512VNNI_EXTENSIONS)
+  if (CAFFE2_COMPILER_SUPPORTS_AVX512VNNI_EXTENSIONS)
+    message(STATUS "Current compiler supports avx512 vnni extension. Will build avx512vnni perfkernels.")
+    set(CAFFE2_PERF_WITH_AVX512VNNI 1)
+  endif()
+  cmake_pop_check_state()
+endif()
+
+# ---[ Check if the compiler has the ARMv8.2 dot product instructions, for
+# the int8 perfkernels on ARM. The kernels only run on the CPUs that have
+# them, so the rest of the build keeps targeting the baseline ARMv8.
+if (CMAKE_SYSTEM_PROCESSOR MATCHES "^(aarch64|arm64)")
+  cmake_push_check_state(RESET)
+  set(CMAKE_REQUIRED_FLAGS "-march=armv8.2-a+dotprod")
+  CHECK_CXX_SOURCE_COMPILES(
+      "#include <arm_neon.h>
+       int main() {
+         int32x4_t a = vdupq_n_s32(0);
+         int8x16_t b = vdupq_n_s8(1);
+         a = vdotq_s32(a, b, b);
+         return vgetq_lane_s32(a, 0);
+       }" CAFFE2_COMPILER_SUPPORTS_NEON_DOTPROD_EXTENSIONS)
+  if (CAFFE2_COMPILER_SUPPORTS_NEON_DOTPROD_EXTENSIONS)
+    message(STATUS "Current compiler supports the arm dot product extension. Will build neon_dotprod perfkernels.")
+    set(CAFFE2_PERF_WITH_NEON_DOTPROD 1)
+  endif()
+  cmake_pop_check_state()
+endif()
+
 # ---[ Checks if compiler supports -fvisibility=hidden
 check_cxx_compiler_flag("-fvisibility=hidden" COMPILER_SUPPORTS_HIDDEN_VISIBILITY)
 check_cxx_compiler_flag("-fvisibility-inlines-hidden" COMPILER_SUPPORTS_HIDDEN_INLINE_VISIBILITY)
@@ -19,17 +19,33 @@ REGISTER_CAFFE2_EARLY_INIT_FUNCTION(
 
 const std::string NetObserverReporterPrint::IDENTIFIER = "Caffe2Observer ";
 
+namespace {
+std::string jsonString(const std::string& s) {
+  std::string escaped = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped + "\"";
+}
+} // namespace
+
+// Every delay is a JSON line, in the format of the reports of
+// binaries/speed_benchmark with report_json:
+// Caffe2Observer {"net": ..., "type": "NET_DELAY" or the operator, "metric":
+// "latency", "unit": "ms", "value": ...}
 void NetObserverReporterPrint::reportDelay(
     NetBase* net,
     std::map<std::string, double>& delays,
     const char* unit) {
   CAFFE_ENFORCE(unit != nullptr, "Unit is null");
-  LOG(INFO) << IDENTIFIER << "Net Name - " << net->Name();
-  LOG(INFO) << IDENTIFIER << "Delay Start";
   for (auto& p : delays) {
-    LOG(INFO) << IDENTIFIER << p.first << " - " << p.second << "\t(" << *unit
-              << ")";
+    LOG(INFO) << IDENTIFIER << "{\"net\": " << jsonString(net->Name())
+              << ", \"type\": " << jsonString(p.first)
+              << ", \"metric\": \"latency\", \"unit\": " << jsonString(unit)
+              << ", \"value\": " << p.second << "}";
   }
-  LOG(INFO) << IDENTIFIER << "Delay End";
 }
 }
@@ -7,6 +7,9 @@ int ObserverConfig::netFollowupSampleRate_ = 0;
 int ObserverConfig::netFollowupSampleCount_ = 0;
 int ObserverConfig::operatorNetSampleRatio_ = 0;
 int ObserverConfig::skipIters_ = 0;
+int ObserverConfig::netSampleEvery_ = 0;
+int ObserverConfig::operatorSampleEvery_ = 0;
+int ObserverConfig::version_ = 0;
 unique_ptr<NetObserverReporter> ObserverConfig::reporter_ = nullptr;
 int ObserverConfig::marker_ = -1;
 }
@@ -23,6 +23,11 @@ namespace caffe2 {
       the following c logs are at odds of 1 / min(n, m), if the random number
       is multiples of o, log operator metrics instead. Then repeat
   skipIters_ == n: skip the first n iterations of the net.
+
+  Instead of the random odds, initSampleEvery logs the net metrics every
+  netSampleEvery_ iterations and the operator metrics, in place of the net
+  ones, every operatorSampleEvery_ iterations, counted from the first one
+  after the skipped ones. 0 disables either.
 */
 class ObserverConfig {
  public:
@@ -39,6 +44,23 @@ class ObserverConfig {
     netFollowupSampleCount_ = netFollowupSampleCount;
     operatorNetSampleRatio_ = operatorNetSampleRatio;
     skipIters_ = skipIters;
+    netSampleEvery_ = 0;
+    operatorSampleEvery_ = 0;
+    version_++;
+  }
+  static void initSampleEvery(
+      int netSampleEvery,
+      int operatorSampleEvery,
+      int skipIters) {
+    CAFFE_ENFORCE(netSampleEvery >= 0 && operatorSampleEvery >= 0);
+    netSampleEvery_ = netSampleEvery;
+    operatorSampleEvery_ = operatorSampleEvery;
+    skipIters_ = skipIters;
+    netInitSampleRate_ = 0;
+    netFollowupSampleRate_ = 0;
+    netFollowupSampleCount_ = 0;
+    operatorNetSampleRatio_ = 0;
+    version_++;
   }
   static int getNetInitSampleRate() {
     return netInitSampleRate_;
@@ -55,6 +77,17 @@ class ObserverConfig {
   static int getSkipIters() {
     return skipIters_;
   }
+  static int getNetSampleEvery() {
+    return netSampleEvery_;
+  }
+  static int getOperatorSampleEvery() {
+    return operatorSampleEvery_;
+  }
+  /* Changes whenever the sampling is configured, the observers schedule
+     their next sampled iteration again then */
+  static int getVersion() {
+    return version_;
+  }
   static void setReporter(unique_ptr<NetObserverReporter> reporter) {
     // Can only set the reporter once
     CAFFE_ENFORCE(reporter_ == nullptr);
@@ -89,6 +122,14 @@ class ObserverConfig {
   /* skip the first few iterations */
   static int skipIters_;
 
+  /* Log the net metric every netSampleEvery_ iterations */
+  static int netSampleEvery_;
+
+  /* Log the operator metric every operatorSampleEvery_ iterations */
+  static int operatorSampleEvery_;
+
+  static int version_;
+
   static unique_ptr<NetObserverReporter> reporter_;
 
   /* marker used in identifying the metrics in certain reporters */
@@ -1,6 +1,8 @@
 #include "observers/perf_observer.h"
 #include "observers/observer_config.h"
 
+#include <cmath>
+#include <limits>
 #include <random>
 #include "caffe2/core/common.h"
 #include "caffe2/core/init.h"
@@ -23,49 +25,97 @@ REGISTER_CAFFE2_EARLY_INIT_FUNCTION(
     "Caffe2 net global observer creator");
 
 PerfNetObserver::PerfNetObserver(NetBase* subject_)
-    : NetObserver(subject_), numRuns_(0) {}
+    : NetObserver(subject_),
+      logType_(PerfNetObserver::NONE),
+      numRuns_(0),
+      nextSampledRun_(0),
+      nextLogType_(PerfNetObserver::NONE),
+      configVersion_(-1) {}
 
 PerfNetObserver::~PerfNetObserver() {}
 
-void PerfNetObserver::Start() {
-  static int visitCount = 0;
-  // Select whether to log the operator or the net.
+void PerfNetObserver::scheduleSample(int64_t run) {
   // We have one sample rate for the entire app.
-  int netInitSampleRate = ObserverConfig::getNetInitSampleRate();
-  int netFollowupSampleRate = ObserverConfig::getNetFollowupSampleRate();
+  static int visitCount = 0;
+  configVersion_ = ObserverConfig::getVersion();
+  const int64_t skipIters = ObserverConfig::getSkipIters();
+  run = std::max(run, skipIters);
+  int netSampleEvery = ObserverConfig::getNetSampleEvery();
+  int operatorSampleEvery = ObserverConfig::getOperatorSampleEvery();
+  if (netSampleEvery > 0 || operatorSampleEvery > 0) {
+    auto nextMultiple = [&](int every) {
+      if (every <= 0) {
+        return std::numeric_limits<int64_t>::max();
+      }
+      return skipIters + (run - skipIters + every - 1) / every * every;
+    };
+    int64_t nextOperatorRun = nextMultiple(operatorSampleEvery);
+    nextSampledRun_ = std::min(nextMultiple(netSampleEvery), nextOperatorRun);
+    nextLogType_ = nextSampledRun_ == nextOperatorRun
+        ? PerfNetObserver::OPERATOR_DELAY
+        : PerfNetObserver::NET_DELAY;
+    return;
+  }
+
   int netFollowupSampleCount = ObserverConfig::getNetFollowupSampleCount();
   int operatorNetSampleRatio = ObserverConfig::getOpoeratorNetSampleRatio();
-  int skipIters = ObserverConfig::getSkipIters();
-  int sampleRate = visitCount > 0 ? netFollowupSampleRate : netInitSampleRate;
-  if (skipIters <= numRuns_ && sampleRate > 0 && rand() % sampleRate == 0) {
-    visitCount++;
-    if (visitCount == netFollowupSampleCount) {
-      visitCount = 0;
-    }
-    if (operatorNetSampleRatio > 0 && rand() % operatorNetSampleRatio == 0) {
-      logType_ = PerfNetObserver::OPERATOR_DELAY;
-    } else {
-      logType_ = PerfNetObserver::NET_DELAY;
-    }
+  int sampleRate = visitCount > 0 ? ObserverConfig::getNetFollowupSampleRate()
+                                  : ObserverConfig::getNetInitSampleRate();
+  if (sampleRate <= 0) {
+    nextSampledRun_ = std::numeric_limits<int64_t>::max();
+    return;
+  }
+  /* Every run is sampled at odds of 1 / sampleRate, so the number of runs
+     skipped before the next sampled one is geometrically distributed. Drawing
+     it once keeps rand() out of the runs that aren't sampled */
+  if (sampleRate > 1) {
+    double u = (rand() + 1.0) / (static_cast<double>(RAND_MAX) + 1.0);
+    run += static_cast<int64_t>(
+        std::floor(std::log(u) / std::log1p(-1.0 / sampleRate)));
+  }
+  nextSampledRun_ = run;
+  visitCount++;
+  if (visitCount == netFollowupSampleCount) {
+    visitCount = 0;
+  }
+  if (operatorNetSampleRatio > 0 && rand() % operatorNetSampleRatio == 0) {
+    nextLogType_ = PerfNetObserver::OPERATOR_DELAY;
   } else {
+    nextLogType_ = PerfNetObserver::NET_DELAY;
+  }
+}
+
+void PerfNetObserver::Start() {
+  const int64_t run = numRuns_++;
+  /* The runs that aren't sampled only take this branch */
+  if (run < nextSampledRun_ &&
+      configVersion_ == ObserverConfig::getVersion()) {
+    logType_ = PerfNetObserver::NONE;
+    return;
+  }
+  if (configVersion_ != ObserverConfig::getVersion()) {
+    scheduleSample(run);
+  }
+  if (run != nextSampledRun_) {
     logType_ = PerfNetObserver::NONE;
+    return;
   }
-  numRuns_++;
+  logType_ = nextLogType_;
+  scheduleSample(run + 1);
 
   if (logType_ == PerfNetObserver::OPERATOR_DELAY) {
     /* Always recreate new operator  observers
        whenever we measure operator delay */
     const auto& operators = subject_->GetOperators();
+    operatorObservers_.clear();
     for (auto* op : operators) {
-      observerMap_[op] = op->AttachObserver(
-          caffe2::make_unique<PerfOperatorObserver>(op, this));
+      operatorObservers_.push_back(op->AttachObserver(
+          caffe2::make_unique<PerfOperatorObserver>(op, this)));
     }
   }
 
-  if (logType_ != PerfNetObserver::NONE) {
-    /* Only start timer when we need to */
-    timer_.Start();
-  }
+  /* Only start timer when we need to */
+  timer_.Start();
 }
 
 void PerfNetObserver::Stop() {
@@ -80,16 +130,17 @@ void PerfNetObserver::Stop() {
     for (int idx = 0; idx < operators.size(); ++idx) {
       const auto* op = operators[idx];
       auto name = getObserverName(op, idx);
-      double delay = static_cast<const PerfOperatorObserver*>(observerMap_[op])
-                         ->getMilliseconds();
+      double delay =
+          static_cast<const PerfOperatorObserver*>(operatorObservers_[idx])
+              ->getMilliseconds();
       delays.insert({name, delay});
     }
     /* clear all operator delay after use so that we don't spent time
        collecting the operator delay info in later runs */
-    for (auto* op : operators) {
-      op->DetachObserver(observerMap_[op]);
+    for (int idx = 0; idx < operators.size(); ++idx) {
+      operators[idx]->DetachObserver(operatorObservers_[idx]);
     }
-    observerMap_.clear();
+    operatorObservers_.clear();
   }
   ObserverConfig::getReporter()->reportDelay(subject_, delays, "ms");
 }
@@ -4,7 +4,7 @@
 #include "caffe2/core/observer.h"
 #include "caffe2/core/timer.h"
 
-#include <unordered_map>
+#include <vector>
 
 namespace caffe2 {
 
@@ -29,10 +29,19 @@ class PerfNetObserver : public NetObserver {
     OPERATOR_DELAY,
     NET_DELAY,
   };
+
+  // Picks the first run from `run` on to sample, and what to log in it
+  void scheduleSample(int64_t run);
+
   LogType logType_;
-  unsigned int numRuns_;
-  std::unordered_map<const OperatorBase*, const ObserverBase<OperatorBase>*>
-      observerMap_;
+  int64_t numRuns_;
+  // The runs before nextSampledRun_ aren't sampled, as long as the
+  // ObserverConfig version is configVersion_
+  int64_t nextSampledRun_;
+  LogType nextLogType_;
+  int configVersion_;
+  // Attached for the runs logging the operator metrics only
+  std::vector<const ObserverBase<OperatorBase>*> operatorObservers_;
 
   caffe2::Timer timer_;
 };
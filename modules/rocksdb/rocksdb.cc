@@ -14,22 +14,128 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <utility>
+
 #include "caffe2/core/db.h"
 #include "caffe2/core/logging.h"
 #include "caffe2/core/flags.h"
+#include "caffe2/core/module.h"
+#include "caffe2/utils/string_utils.h"
+#include "rocksdb/cache.h"
 #include "rocksdb/db.h"
-#include "rocksdb/utilities/leveldb_options.h"
+#include "rocksdb/filter_policy.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/table.h"
 
 CAFFE2_DEFINE_int(caffe2_rocksdb_block_size, 65536,
                   "The caffe2 rocksdb block size when writing a rocksdb.");
+CAFFE2_DEFINE_int(caffe2_rocksdb_block_cache_mb, -1,
+                  "The default block cache size of a rocksdb, in MB. 0 "
+                  "disables the cache, -1 uses the rocksdb default.");
+CAFFE2_DEFINE_int(caffe2_rocksdb_bloom_bits, 0,
+                  "The default bloom filter bits per key when writing a "
+                  "rocksdb, 0 for no bloom filter.");
 
 namespace caffe2 {
 namespace db {
 
+// The source of a rocksdb has the form
+//
+//   <path>[;<option>=<value>...]
+//
+// e.g. /data/train;bulk_load=1;compression=zstd. Options:
+//   block_size:     size of the data blocks when writing, in bytes (defaults
+//                   to --caffe2_rocksdb_block_size)
+//   block_cache_mb: size of the block cache, 0 to disable it (defaults to
+//                   --caffe2_rocksdb_block_cache_mb)
+//   bloom_bits:     bits per key of the bloom filters of the written tables,
+//                   speeding up the seeks to missing keys (defaults to
+//                   --caffe2_rocksdb_bloom_bits)
+//   compression:    none, snappy (the default), zlib, lz4 or zstd
+//   readahead_kb:   size of the reads of the cursors, for sequential scans
+//                   on spinning disks or network file systems
+//   fill_cache:     if 0, the blocks read by the cursors don't evict the
+//                   cached ones, for scans over data read once
+//   bulk_load:      if 1, every commit of a transaction sorts its records
+//                   into a table file which is then ingested by the db,
+//                   rather than going through the write ahead log and the
+//                   memtables. For creating datasets and checkpoints.
+
+namespace {
+
+struct RocksDBOptions {
+  string path;
+  int block_size = FLAGS_caffe2_rocksdb_block_size;
+  int block_cache_mb = FLAGS_caffe2_rocksdb_block_cache_mb;
+  int bloom_bits = FLAGS_caffe2_rocksdb_bloom_bits;
+  rocksdb::CompressionType compression = rocksdb::kSnappyCompression;
+  int readahead_kb = 0;
+  bool fill_cache = true;
+  bool bulk_load = false;
+};
+
+rocksdb::CompressionType parseCompression(const string& name) {
+  if (name == "none") {
+    return rocksdb::kNoCompression;
+  } else if (name == "snappy") {
+    return rocksdb::kSnappyCompression;
+  } else if (name == "zlib") {
+    return rocksdb::kZlibCompression;
+  } else if (name == "lz4") {
+    return rocksdb::kLZ4Compression;
+  } else if (name == "zstd") {
+    return rocksdb::kZSTD;
+  }
+  CAFFE_THROW("Unknown rocksdb compression: ", name);
+}
+
+RocksDBOptions parseSource(const string& source) {
+  RocksDBOptions options;
+  auto parts = split(';', source);
+  CAFFE_ENFORCE(!parts.empty() && !parts[0].empty(), "Empty rocksdb source");
+  options.path = parts[0];
+  for (int i = 1; i < parts.size(); ++i) {
+    if (parts[i].empty()) {
+      continue;
+    }
+    const auto eq = parts[i].find('=');
+    CAFFE_ENFORCE(
+        eq != string::npos, "Rocksdb options are key=value: ", parts[i]);
+    const auto key = parts[i].substr(0, eq);
+    const auto value = parts[i].substr(eq + 1);
+    if (key == "compression") {
+      options.compression = parseCompression(value);
+    } else if (key == "block_size") {
+      options.block_size = std::stoi(value);
+    } else if (key == "block_cache_mb") {
+      options.block_cache_mb = std::stoi(value);
+    } else if (key == "bloom_bits") {
+      options.bloom_bits = std::stoi(value);
+    } else if (key == "readahead_kb") {
+      options.readahead_kb = std::stoi(value);
+    } else if (key == "fill_cache") {
+      options.fill_cache = std::stoi(value) != 0;
+    } else if (key == "bulk_load") {
+      options.bulk_load = std::stoi(value) != 0;
+    } else {
+      CAFFE_THROW("Unknown rocksdb option: ", key);
+    }
+  }
+  CAFFE_ENFORCE_GT(options.block_size, 0);
+  CAFFE_ENFORCE_GE(options.bloom_bits, 0);
+  CAFFE_ENFORCE_GE(options.readahead_kb, 0);
+  return options;
+}
+
+} // namespace
+
 class RocksDBCursor : public Cursor {
  public:
-  explicit RocksDBCursor(rocksdb::DB* db)
-      : iter_(db->NewIterator(rocksdb::ReadOptions())) {
+  RocksDBCursor(rocksdb::DB* db, const rocksdb::ReadOptions& read_options)
+      : iter_(db->NewIterator(read_options)) {
     SeekToFirst();
   }
   ~RocksDBCursor() {}
@@ -69,39 +175,135 @@ class RocksDBTransaction : public Transaction {
   DISABLE_COPY_AND_ASSIGN(RocksDBTransaction);
 };
 
+// Writes the records of every commit into a table file, which the db then
+// takes as it is, in place of going through the write ahead log and the
+// memtables and compacting them later on.
+class RocksDBBulkTransaction : public Transaction {
+ public:
+  RocksDBBulkTransaction(
+      rocksdb::DB* db,
+      const rocksdb::Options& options,
+      const string& file_prefix,
+      std::atomic<int>* num_files)
+      : db_(db),
+        options_(options),
+        file_prefix_(file_prefix),
+        num_files_(num_files) {
+    CAFFE_ENFORCE(db_);
+  }
+  ~RocksDBBulkTransaction() { Commit(); }
+  void Put(const string& key, const string& value) override {
+    records_.emplace_back(key, value);
+  }
+  void Commit() override {
+    if (records_.empty()) {
+      return;
+    }
+    // Table files need sorted and unique keys, the last put wins
+    std::stable_sort(
+        records_.begin(),
+        records_.end(),
+        [](const std::pair<string, string>& a,
+           const std::pair<string, string>& b) { return a.first < b.first; });
+    const string file =
+        file_prefix_ + caffe2::to_string(num_files_->fetch_add(1)) + ".sst";
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options_);
+    rocksdb::Status status = writer.Open(file);
+    for (int i = 0; status.ok() && i < records_.size(); ++i) {
+      if (i + 1 < records_.size() &&
+          records_[i + 1].first == records_[i].first) {
+        continue;
+      }
+      status = writer.Put(records_[i].first, records_[i].second);
+    }
+    if (status.ok()) {
+      status = writer.Finish();
+    }
+    records_.clear();
+    if (status.ok()) {
+      rocksdb::IngestExternalFileOptions ingest_options;
+      ingest_options.move_files = true;
+      status = db_->IngestExternalFile({file}, ingest_options);
+    }
+    // Moved into the db if ingested
+    std::remove(file.c_str());
+    CAFFE_ENFORCE(
+        status.ok(),
+        "Failed to ingest table into rocksdb: " + status.ToString());
+  }
+
+ private:
+  rocksdb::DB* db_;
+  const rocksdb::Options& options_;
+  const string file_prefix_;
+  std::atomic<int>* num_files_;
+  std::vector<std::pair<string, string>> records_;
+
+  DISABLE_COPY_AND_ASSIGN(RocksDBBulkTransaction);
+};
+
 class RocksDB : public DB {
  public:
-  RocksDB(const string& source, Mode mode) : DB(source, mode) {
-    rocksdb::LevelDBOptions options;
-    options.block_size = FLAGS_caffe2_rocksdb_block_size;
-    options.write_buffer_size = 268435456;
-    options.max_open_files = 100;
-    options.error_if_exists = mode == NEW;
-    options.create_if_missing = mode != READ;
-    rocksdb::Options rocksdb_options = rocksdb::ConvertOptions(options);
+  RocksDB(const string& source, Mode mode)
+      : DB(source, mode), options_(parseSource(source)) {
+    rocksdb_options_.write_buffer_size = 268435456;
+    rocksdb_options_.max_open_files = 100;
+    rocksdb_options_.error_if_exists = mode == NEW;
+    rocksdb_options_.create_if_missing = mode != READ;
+    rocksdb_options_.compression = options_.compression;
+    rocksdb::BlockBasedTableOptions table_options;
+    table_options.block_size = options_.block_size;
+    if (options_.block_cache_mb == 0) {
+      table_options.no_block_cache = true;
+    } else if (options_.block_cache_mb > 0) {
+      table_options.block_cache =
+          rocksdb::NewLRUCache(size_t(options_.block_cache_mb) << 20);
+    }
+    if (options_.bloom_bits > 0) {
+      table_options.filter_policy.reset(
+          rocksdb::NewBloomFilterPolicy(options_.bloom_bits, false));
+    }
+    rocksdb_options_.table_factory.reset(
+        rocksdb::NewBlockBasedTableFactory(table_options));
+
+    read_options_.readahead_size = size_t(options_.readahead_kb) << 10;
+    read_options_.fill_cache = options_.fill_cache;
 
     rocksdb::DB* db_temp;
     rocksdb::Status status = rocksdb::DB::Open(
-      rocksdb_options, source, &db_temp);
+      rocksdb_options_, options_.path, &db_temp);
     CAFFE_ENFORCE(
         status.ok(),
         "Failed to open rocksdb ",
-        source,
+        options_.path,
         "\n",
         status.ToString());
     db_.reset(db_temp);
-    VLOG(1) << "Opened rocksdb " << source;
+    VLOG(1) << "Opened rocksdb " << options_.path;
   }
 
   void Close() override { db_.reset(); }
   unique_ptr<Cursor> NewCursor() override {
-    return make_unique<RocksDBCursor>(db_.get());
+    return make_unique<RocksDBCursor>(db_.get(), read_options_);
   }
   unique_ptr<Transaction> NewTransaction() override {
+    if (options_.bulk_load) {
+      // Next to the db rather than in it, rocksdb removes the table files it
+      // doesn't know of
+      return make_unique<RocksDBBulkTransaction>(
+          db_.get(),
+          rocksdb_options_,
+          options_.path + ".ingest.",
+          &num_bulk_files_);
+    }
     return make_unique<RocksDBTransaction>(db_.get());
   }
 
  private:
+  const RocksDBOptions options_;
+  rocksdb::Options rocksdb_options_;
+  rocksdb::ReadOptions read_options_;
+  std::atomic<int> num_bulk_files_{0};
   std::unique_ptr<rocksdb::DB> db_;
 };
 